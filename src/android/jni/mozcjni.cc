@@ -33,7 +33,9 @@
 
 #include <jni.h>
 
+#include <cstring>
 #include <memory>
+#include <string>
 
 #include "base/android_jni_proxy.h"
 #include "base/android_util.h"
@@ -93,6 +95,19 @@ JavaVM *GetJavaVm(JNIEnv *env) {
 // The global instance of Mozc system to be initialized in onPostLoad().
 std::unique_ptr<SessionHandlerInterface> g_session_handler;
 
+// The serialized output of the last evalCommandDirect call which didn't fit
+// in the output buffer.  Guarded by the class lock of MozcJNI as the methods
+// accessing it are static synchronized.
+string g_pending_output;
+
+void EvalCommand(commands::Command *command) {
+  if (g_session_handler) {
+    g_session_handler->EvalCommand(command);
+  } else {
+    LOG(DFATAL) << "Mozc session handler is not yet initialized";
+  }
+}
+
 // Concrete implementation for MozcJni.evalCommand
 jbyteArray JNICALL evalCommand(JNIEnv *env,
                                jclass clazz,
@@ -101,11 +116,7 @@ jbyteArray JNICALL evalCommand(JNIEnv *env,
   const jsize in_size = env->GetArrayLength(in_bytes_array);
   mozc::commands::Command command;
   command.ParseFromArray(in_bytes, in_size);
-  if (g_session_handler) {
-    g_session_handler->EvalCommand(&command);
-  } else {
-    LOG(DFATAL) << "Mozc session handler is not yet initialized";
-  }
+  EvalCommand(&command);
 
   // Use JNI_ABORT because in_bytes is read only.
   env->ReleaseByteArrayElements(in_bytes_array, in_bytes, JNI_ABORT);
@@ -121,6 +132,58 @@ jbyteArray JNICALL evalCommand(JNIEnv *env,
   return out_bytes_array;
 }
 
+// Concrete implementation for MozcJni.evalCommandDirect.  Unlike
+// evalCommand, works on the direct buffers preallocated by the caller, so
+// that no Java object is allocated per key event.  Returns the size of the
+// serialized output, which is not written if it exceeds the capacity of
+// |out_buffer| but is kept for takePendingOutput.  Returns -1 on error.
+jint JNICALL evalCommandDirect(JNIEnv *env,
+                               jclass clazz,
+                               jobject in_buffer,
+                               jint in_size,
+                               jobject out_buffer) {
+  g_pending_output.clear();
+  const void *in_bytes = env->GetDirectBufferAddress(in_buffer);
+  if (in_bytes == nullptr || in_size < 0 ||
+      in_size > env->GetDirectBufferCapacity(in_buffer)) {
+    LOG(DFATAL) << "Invalid input buffer";
+    return -1;
+  }
+  mozc::commands::Command command;
+  command.ParseFromArray(in_bytes, in_size);
+  EvalCommand(&command);
+
+  const int out_size = command.ByteSize();
+  void *out_bytes = env->GetDirectBufferAddress(out_buffer);
+  if (out_bytes != nullptr &&
+      out_size <= env->GetDirectBufferCapacity(out_buffer)) {
+    // The size is cached by ByteSize().
+    command.SerializeWithCachedSizesToArray(static_cast<uint8 *>(out_bytes));
+  } else {
+    command.SerializeToString(&g_pending_output);
+  }
+  return out_size;
+}
+
+// Concrete implementation for MozcJni.takePendingOutput.  Copies the output
+// kept by the last evalCommandDirect call to |out_buffer| and returns its
+// size.  Returns -1 if |out_buffer| is too small.
+jint JNICALL takePendingOutput(JNIEnv *env,
+                               jclass clazz,
+                               jobject out_buffer) {
+  void *out_bytes = env->GetDirectBufferAddress(out_buffer);
+  const jlong out_capacity = env->GetDirectBufferCapacity(out_buffer);
+  if (out_bytes == nullptr || out_capacity < 0 ||
+      g_pending_output.size() > static_cast<uint64>(out_capacity)) {
+    LOG(DFATAL) << "Invalid output buffer";
+    return -1;
+  }
+  const jint out_size = static_cast<jint>(g_pending_output.size());
+  memcpy(out_bytes, g_pending_output.data(), g_pending_output.size());
+  g_pending_output.clear();
+  return out_size;
+}
+
 string JstringToCcString(JNIEnv *env, jstring j_string) {
   const char *cstr = env->GetStringUTFChars(j_string, nullptr);
   const string cc_string(cstr);
@@ -246,6 +309,12 @@ JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM *vm, void *reserved) {
       {"evalCommand",
        "([B)[B",
        reinterpret_cast<void*>(&mozc::jni::evalCommand)},
+      {"evalCommandDirect",
+       "(Ljava/nio/ByteBuffer;ILjava/nio/ByteBuffer;)I",
+       reinterpret_cast<void*>(&mozc::jni::evalCommandDirect)},
+      {"takePendingOutput",
+       "(Ljava/nio/ByteBuffer;)I",
+       reinterpret_cast<void*>(&mozc::jni::takePendingOutput)},
       {"onPostLoad",
        "(Ljava/lang/String;Ljava/lang/String;)Z",
        reinterpret_cast<void*>(&mozc::jni::onPostLoad)},
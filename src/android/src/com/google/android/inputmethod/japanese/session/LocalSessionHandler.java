@@ -31,14 +31,18 @@ package org.mozc.android.inputmethod.japanese.session;
 
 import org.mozc.android.inputmethod.japanese.MozcLog;
 import org.mozc.android.inputmethod.japanese.protobuf.ProtoCommands.Command;
+import com.google.common.annotations.VisibleForTesting;
 import com.google.common.base.Preconditions;
-import com.google.protobuf.InvalidProtocolBufferException;
+import com.google.protobuf.CodedInputStream;
+import com.google.protobuf.CodedOutputStream;
 
 import android.content.Context;
 import android.content.pm.ApplicationInfo;
 import android.content.pm.PackageManager.NameNotFoundException;
 
 import java.io.File;
+import java.io.IOException;
+import java.nio.ByteBuffer;
 import java.util.regex.Matcher;
 import java.util.regex.Pattern;
 
@@ -50,6 +54,25 @@ class LocalSessionHandler implements SessionHandler {
 
   private static final String USER_PROFILE_DIRECTORY_NAME = ".mozc";
 
+  /** Large enough for the commands of typical key events. */
+  private static final int DEFAULT_BUFFER_CAPACITY = 16 * 1024;
+
+  // Direct buffers for the blobs of Command messages, which are reused so that a key event
+  // doesn't allocate byte arrays. Grown when a command doesn't fit.
+  private ByteBuffer inputBuffer;
+  private ByteBuffer outputBuffer;
+
+  LocalSessionHandler() {
+    this(DEFAULT_BUFFER_CAPACITY);
+  }
+
+  @VisibleForTesting
+  LocalSessionHandler(int initialBufferCapacity) {
+    Preconditions.checkArgument(initialBufferCapacity > 0);
+    inputBuffer = ByteBuffer.allocateDirect(initialBufferCapacity);
+    outputBuffer = ByteBuffer.allocateDirect(initialBufferCapacity);
+  }
+
   @Override
   public void initialize(Context context) {
     try {
@@ -85,17 +108,45 @@ class LocalSessionHandler implements SessionHandler {
   }
 
   @Override
-  public Command evalCommand(Command command) {
-    byte[] inBytes = Preconditions.checkNotNull(command).toByteArray();
-    byte[] outBytes = null;
-    outBytes = MozcJNI.evalCommand(inBytes);
+  public synchronized Command evalCommand(Command command) {
+    Preconditions.checkNotNull(command);
     try {
-      return Command.parseFrom(outBytes);
-    } catch (InvalidProtocolBufferException e) {
-      MozcLog.w("InvalidProtocolBufferException is thrown."
+      int inputSize = command.getSerializedSize();
+      inputBuffer = ensureCapacity(inputBuffer, inputSize);
+      inputBuffer.clear();
+      CodedOutputStream output = CodedOutputStream.newInstance(inputBuffer);
+      command.writeTo(output);
+      output.flush();
+
+      int outputSize;
+      synchronized (MozcJNI.class) {
+        outputSize = MozcJNI.evalCommandDirect(inputBuffer, inputSize, outputBuffer);
+        if (outputSize > outputBuffer.capacity()) {
+          outputBuffer = ensureCapacity(outputBuffer, outputSize);
+          outputSize = MozcJNI.takePendingOutput(outputBuffer);
+        }
+      }
+      if (outputSize < 0) {
+        MozcLog.w("evalCommandDirect failed. Just return default instance.");
+        return Command.getDefaultInstance();
+      }
+      outputBuffer.clear();
+      outputBuffer.limit(outputSize);
+      return Command.parseFrom(CodedInputStream.newInstance(outputBuffer));
+    } catch (IOException e) {
+      // Includes InvalidProtocolBufferException.
+      MozcLog.w("IOException is thrown."
           + "We can do nothing so just return default instance.");
       MozcLog.w(e.toString());
       return Command.getDefaultInstance();
     }
   }
+
+  /** Returns {@code buffer} or a new larger direct buffer if it is smaller than {@code size}. */
+  private static ByteBuffer ensureCapacity(ByteBuffer buffer, int size) {
+    if (buffer.capacity() >= size) {
+      return buffer;
+    }
+    return ByteBuffer.allocateDirect(Math.max(size, buffer.capacity() * 2));
+  }
 }
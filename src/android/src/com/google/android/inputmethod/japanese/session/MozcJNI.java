@@ -32,6 +32,8 @@ package org.mozc.android.inputmethod.japanese.session;
 import org.mozc.android.inputmethod.japanese.MozcLog;
 import com.google.common.base.Preconditions;
 
+import java.nio.ByteBuffer;
+
 /**
  * The wrapper for JNI Mozc server.
  *
@@ -95,6 +97,29 @@ class MozcJNI {
    */
   static synchronized native byte[] evalCommand(byte[] command);
 
+  /**
+   * Sends Command message to Mozc server and writes the result, without allocating Java objects.
+   *
+   * <p>If the result doesn't fit in {@code output}, nothing is written and the result is kept in
+   * the native layer until {@link #takePendingOutput} is called. Hold the lock of this class
+   * between the two calls.
+   *
+   * @param input direct buffer which contains the blob of Command message from the beginning.
+   * @param inputSize the size of the blob in {@code input}.
+   * @param output direct buffer to which the blob of the result is written from the beginning.
+   * @return the size of the blob of the result, or -1 on error.
+   */
+  static synchronized native int evalCommandDirect(
+      ByteBuffer input, int inputSize, ByteBuffer output);
+
+  /**
+   * Writes the result kept by the last {@link #evalCommandDirect} call.
+   *
+   * @param output direct buffer to which the blob of the result is written from the beginning.
+   * @return the size of the blob, or -1 if {@code output} is too small.
+   */
+  static synchronized native int takePendingOutput(ByteBuffer output);
+
   /**
    * This method initializes the internal state of mozc server, especially dictionary data
    * and session related stuff. We cannot do this in JNI_OnLoad, which is the callback API
@@ -56,4 +56,18 @@ public class LocalSessionHandlerTest extends InstrumentationTestCase {
         .setOutput(Output.getDefaultInstance()).build();
     handler.evalCommand(command);
   }
+
+  @SmallTest
+  public void testGrowBuffers() {
+    // Neither the input nor the output fits in the initial buffers.
+    LocalSessionHandler handler = new LocalSessionHandler(1);
+    handler.initialize(getInstrumentation().getTargetContext());
+    Command command = Command.newBuilder()
+        .setInput(Input.newBuilder().setType(CommandType.NO_OPERATION))
+        .setOutput(Output.getDefaultInstance()).build();
+    for (int i = 0; i < 2; ++i) {
+      Command result = handler.evalCommand(command);
+      assertEquals(command.getInput(), result.getInput());
+    }
+  }
 }
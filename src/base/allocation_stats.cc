@@ -0,0 +1,113 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "base/allocation_stats.h"
+
+#include <atomic>
+
+#include "base/logging.h"
+
+namespace mozc {
+namespace {
+
+std::atomic<bool> g_hook_installed(false);
+std::atomic<uint64> g_total_allocations(0);
+std::atomic<uint64> g_total_bytes(0);
+
+// Zero-initialized without any dynamic initialization, so that they can be
+// used from operator new.
+thread_local AllocationStats::Counters g_thread_counters;
+thread_local AllocationStats::Stage g_current_stage = AllocationStats::OTHER;
+
+}  // namespace
+
+// static
+bool AllocationStats::IsHookInstalled() {
+  return g_hook_installed.load(std::memory_order_relaxed);
+}
+
+// static
+void AllocationStats::RecordAllocation(size_t size) {
+  if (!g_hook_installed.load(std::memory_order_relaxed)) {
+    g_hook_installed.store(true, std::memory_order_relaxed);
+  }
+  g_total_allocations.fetch_add(1, std::memory_order_relaxed);
+  g_total_bytes.fetch_add(size, std::memory_order_relaxed);
+  ++g_thread_counters.allocations[g_current_stage];
+  g_thread_counters.bytes[g_current_stage] += size;
+}
+
+// static
+AllocationStats::Counters AllocationStats::GetThreadCounters() {
+  return g_thread_counters;
+}
+
+// static
+uint64 AllocationStats::GetTotalAllocations() {
+  return g_total_allocations.load(std::memory_order_relaxed);
+}
+
+// static
+uint64 AllocationStats::GetTotalBytes() {
+  return g_total_bytes.load(std::memory_order_relaxed);
+}
+
+// static
+AllocationStats::Stage AllocationStats::GetCurrentStage() {
+  return g_current_stage;
+}
+
+// static
+void AllocationStats::SetCurrentStage(Stage stage) {
+  DCHECK_LT(stage, NUM_STAGES);
+  g_current_stage = stage;
+}
+
+// static
+const char *AllocationStats::GetStageName(Stage stage) {
+  switch (stage) {
+    case OTHER:
+      return "other";
+    case COMPOSER:
+      return "composer";
+    case CONVERTER:
+      return "converter";
+    case PREDICTOR:
+      return "predictor";
+    case REWRITER:
+      return "rewriter";
+    case OUTPUT:
+      return "output";
+    default:
+      return "unknown";
+  }
+}
+
+}  // namespace mozc
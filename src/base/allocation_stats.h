@@ -0,0 +1,118 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// Per-thread heap allocation counters attributed to the pipeline stages.
+//
+// The counters are updated only when allocation_hook.cc, which replaces the
+// global operator new, is linked into the binary, e.g., by depending on
+// base.gyp:allocation_hook.  Otherwise all the counters stay zero and a stage
+// scope costs a thread-local store.
+//
+// Usage:
+//   void Converter::Convert() {
+//     ScopedAllocationStage stage(AllocationStats::CONVERTER);
+//     ...  // Allocations here are counted for CONVERTER.
+//   }
+
+#ifndef MOZC_BASE_ALLOCATION_STATS_H_
+#define MOZC_BASE_ALLOCATION_STATS_H_
+
+#include <cstddef>
+
+#include "base/port.h"
+
+namespace mozc {
+
+class AllocationStats {
+ public:
+  // The stage which the allocations are attributed to.  The innermost
+  // ScopedAllocationStage wins, so e.g. the conversion run by a predictor is
+  // counted for CONVERTER.
+  enum Stage {
+    OTHER = 0,
+    COMPOSER,
+    CONVERTER,
+    PREDICTOR,
+    REWRITER,
+    OUTPUT,
+    NUM_STAGES,
+  };
+
+  struct Counters {
+    uint64 allocations[NUM_STAGES];
+    uint64 bytes[NUM_STAGES];
+  };
+
+  // Returns true if the allocation hook has recorded any allocation.
+  static bool IsHookInstalled();
+
+  // Called by the allocation hook for every allocation of |size| bytes.
+  // Must not allocate.
+  static void RecordAllocation(size_t size);
+
+  // Returns the counters of the calling thread since it started.
+  static Counters GetThreadCounters();
+
+  // Returns the total of all the threads.
+  static uint64 GetTotalAllocations();
+  static uint64 GetTotalBytes();
+
+  static Stage GetCurrentStage();
+  static void SetCurrentStage(Stage stage);
+
+  // Returns a lower case name of |stage|, e.g., "converter".
+  static const char *GetStageName(Stage stage);
+
+ private:
+  DISALLOW_IMPLICIT_CONSTRUCTORS(AllocationStats);
+};
+
+// Attributes the allocations on the calling thread to |stage| for the
+// lifetime of the object.
+class ScopedAllocationStage {
+ public:
+  explicit ScopedAllocationStage(AllocationStats::Stage stage)
+      : previous_stage_(AllocationStats::GetCurrentStage()) {
+    AllocationStats::SetCurrentStage(stage);
+  }
+
+  ~ScopedAllocationStage() {
+    AllocationStats::SetCurrentStage(previous_stage_);
+  }
+
+ private:
+  const AllocationStats::Stage previous_stage_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedAllocationStage);
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_BASE_ALLOCATION_STATS_H_
@@ -0,0 +1,120 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "base/allocation_stats.h"
+
+#include "base/thread.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace {
+
+// Allocates |size| bytes with operator new.  Unlike new expressions, calls
+// of operator new are never optimized out.
+void AllocateAndFree(size_t size) {
+  ::operator delete(::operator new(size));
+}
+
+class AllocateThread : public Thread {
+ public:
+  void Run() override {
+    ScopedAllocationStage stage(AllocationStats::CONVERTER);
+    AllocateAndFree(1000);
+    counters_ = AllocationStats::GetThreadCounters();
+  }
+
+  const AllocationStats::Counters &counters() const { return counters_; }
+
+ private:
+  AllocationStats::Counters counters_;
+};
+
+TEST(AllocationStatsTest, CountsPerStage) {
+  const AllocationStats::Counters before = AllocationStats::GetThreadCounters();
+  AllocateAndFree(10);
+  {
+    ScopedAllocationStage converter(AllocationStats::CONVERTER);
+    AllocateAndFree(20);
+    {
+      ScopedAllocationStage rewriter(AllocationStats::REWRITER);
+      AllocateAndFree(30);
+    }
+    EXPECT_EQ(AllocationStats::CONVERTER, AllocationStats::GetCurrentStage());
+  }
+  const AllocationStats::Counters after = AllocationStats::GetThreadCounters();
+  EXPECT_EQ(AllocationStats::OTHER, AllocationStats::GetCurrentStage());
+  EXPECT_TRUE(AllocationStats::IsHookInstalled());
+
+  const struct {
+    AllocationStats::Stage stage;
+    uint64 allocations;
+    uint64 bytes;
+  } kExpected[] = {
+    {AllocationStats::OTHER, 1, 10},
+    {AllocationStats::COMPOSER, 0, 0},
+    {AllocationStats::CONVERTER, 1, 20},
+    {AllocationStats::PREDICTOR, 0, 0},
+    {AllocationStats::REWRITER, 1, 30},
+    {AllocationStats::OUTPUT, 0, 0},
+  };
+  for (const auto &expected : kExpected) {
+    SCOPED_TRACE(AllocationStats::GetStageName(expected.stage));
+    EXPECT_EQ(expected.allocations,
+              after.allocations[expected.stage] -
+              before.allocations[expected.stage]);
+    EXPECT_EQ(expected.bytes,
+              after.bytes[expected.stage] - before.bytes[expected.stage]);
+  }
+}
+
+TEST(AllocationStatsTest, CountsPerThread) {
+  const AllocationStats::Counters before = AllocationStats::GetThreadCounters();
+  const uint64 total_bytes = AllocationStats::GetTotalBytes();
+  AllocateThread thread;
+  thread.SetJoinable(true);
+  thread.Start("AllocationStatsTest");
+  thread.Join();
+
+  // The allocation on the thread isn't counted for this thread.
+  const AllocationStats::Counters after = AllocationStats::GetThreadCounters();
+  EXPECT_EQ(before.bytes[AllocationStats::CONVERTER],
+            after.bytes[AllocationStats::CONVERTER]);
+  EXPECT_LE(1000, thread.counters().bytes[AllocationStats::CONVERTER]);
+  EXPECT_LE(total_bytes + 1000, AllocationStats::GetTotalBytes());
+}
+
+TEST(AllocationStatsTest, GetStageName) {
+  EXPECT_STREQ("other", AllocationStats::GetStageName(AllocationStats::OTHER));
+  EXPECT_STREQ("output",
+               AllocationStats::GetStageName(AllocationStats::OUTPUT));
+}
+
+}  // namespace
+}  // namespace mozc
@@ -40,11 +40,13 @@
       'toolsets': ['host', 'target'],
       'sources': [
         'cpu_stats.cc',
+        'parallel_initializer.cc',
         'process.cc',
         'process_mutex.cc',
         'run_level.cc',
         'scheduler.cc',
         'stopwatch.cc',
+        'timer_wheel_scheduler.cc',
         'unnamed_event.cc',
       ],
       'dependencies': [
@@ -101,6 +103,7 @@
       'sources': [
         '<(gen_out_dir)/character_set.inc',
         '<(gen_out_dir)/version_def.h',
+        'allocation_stats.cc',
         'file_stream.cc',
         'file_util.cc',
         'init_mozc.cc',
@@ -111,6 +114,8 @@
         'system_util.cc',
         'text_normalizer.cc',
         'thread.cc',
+        'thread_pool.cc',
+        'trace_events.cc',
         'util.cc',
         'version.cc',
         'win_util.cc',
@@ -163,6 +168,17 @@
         }],
       ],
     },
+    {
+      # Replaces the global operator new to count the allocations.  Depend on
+      # this only from the executables measuring them.
+      'target_name': 'allocation_hook',
+      'type': 'none',
+      'direct_dependent_settings': {
+        'sources': [
+          'allocation_hook.cc',
+        ],
+      },
+    },
     {
       'target_name': 'update_util',
       'type': 'static_library',
@@ -447,6 +463,17 @@
         'debug.cc',
       ],
     },
+    {
+      'target_name': 'perfect_hash_index',
+      'type': 'static_library',
+      'toolsets': ['host', 'target'],
+      'sources': [
+        'perfect_hash_index.cc',
+      ],
+      'dependencies': [
+        'base_core',
+      ],
+    },
     {
       'target_name': 'serialized_string_array',
       'type': 'static_library',
@@ -81,6 +81,7 @@
       'sources': [
         'codegen_bytearray_stream_test.cc',
         'cpu_stats_test.cc',
+        'parallel_initializer_test.cc',
         'process_mutex_test.cc',
         'stopwatch_test.cc',
         'unnamed_event_test.cc',
@@ -139,10 +140,13 @@
         'logging_test.cc',
         'mmap_test.cc',
         'singleton_test.cc',
+        'spsc_queue_test.cc',
         'stl_util_test.cc',
         'string_piece_test.cc',
         'text_normalizer_test.cc',
+        'thread_pool_test.cc',
         'thread_test.cc',
+        'trace_events_test.cc',
         'version_test.cc',
       ],
       'conditions': [
@@ -165,6 +169,21 @@
         'test_size': 'small',
       },
     },
+    {
+      'target_name': 'allocation_stats_test',
+      'type': 'executable',
+      'sources': [
+        'allocation_stats_test.cc',
+      ],
+      'dependencies': [
+        '../testing/testing.gyp:gtest_main',
+        'base.gyp:allocation_hook',
+        'base.gyp:base_core',
+      ],
+      'variables': {
+        'test_size': 'small',
+      },
+    },
     {
       'target_name': 'mutex_test',
       'type': 'executable',
@@ -312,6 +331,7 @@
       'type': 'executable',
       'sources': [
         'scheduler_test.cc',
+        'timer_wheel_scheduler_test.cc',
       ],
       'dependencies': [
         '../testing/testing.gyp:gtest_main',
@@ -454,6 +474,18 @@
         'install_embedded_file_h',
       ],
     },
+    {
+      'target_name': 'perfect_hash_index_test',
+      'type': 'executable',
+      'sources': [
+        'perfect_hash_index_test.cc',
+      ],
+      'dependencies': [
+        '../testing/testing.gyp:gtest_main',
+        'base.gyp:base',
+        'base.gyp:perfect_hash_index',
+      ],
+    },
     {
       'target_name': 'serialized_string_array_test',
       'type': 'executable',
@@ -471,6 +503,7 @@
       'target_name': 'base_all_test',
       'type': 'none',
       'dependencies': [
+        'allocation_stats_test',
         'base_core_test',
         'base_test',
         'clock_mock_test',
@@ -484,6 +517,7 @@
         'mutex_test',
         'number_util_test',
         'obfuscator_support_test',
+        'perfect_hash_index_test',
         'scheduler_stub_test',
         'scheduler_test',
         'serialized_string_array_test',
@@ -39,8 +39,6 @@
 #include <string.h>
 #endif  // platforms (OS_WIN, OS_MACOSX, ...)
 
-#include <memory>
-
 #include "base/logging.h"
 #include "base/password_manager.h"
 #include "base/unverified_aes256.h"
@@ -199,14 +197,14 @@ bool Encryptor::EncryptString(const Encryptor::Key &key, string *data) {
     LOG(ERROR) << "data is NULL or empty";
     return false;
   }
+  // Transforms the string in place to avoid copying large data twice.
   size_t size = data->size();
-  std::unique_ptr<char[]> buf(new char[key.GetEncryptedSize(data->size())]);
-  memcpy(buf.get(), data->data(), data->size());
-  if (!Encryptor::EncryptArray(key, buf.get(), &size)) {
+  data->resize(key.GetEncryptedSize(size));
+  if (!Encryptor::EncryptArray(key, &(*data)[0], &size)) {
     LOG(ERROR) << "EncryptArray() failed";
     return false;
   }
-  data->assign(buf.get(), size);
+  data->resize(size);
   return true;
 }
 
@@ -216,13 +214,11 @@ bool Encryptor::DecryptString(const Encryptor::Key &key, string *data) {
     return false;
   }
   size_t size = data->size();
-  std::unique_ptr<char[]> buf(new char[data->size()]);
-  memcpy(buf.get(), data->data(), data->size());
-  if (!Encryptor::DecryptArray(key, buf.get(), &size)) {
+  if (!Encryptor::DecryptArray(key, &(*data)[0], &size)) {
     LOG(ERROR) << "DecryptArray() failed";
     return false;
   }
-  data->assign(buf.get(), size);
+  data->resize(size);
   return true;
 }
 
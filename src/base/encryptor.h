@@ -99,9 +99,11 @@ class Encryptor {
   static bool DecryptArray(const Key &key, char *buf, size_t *buf_size);
 
   // Encrypt string with key.
+  // |data| is transformed in place, and is left unspecified on failure.
   static bool EncryptString(const Key &key, string *data);
 
   // Encrypt string with key.
+  // |data| is transformed in place, and is left unspecified on failure.
   static bool DecryptString(const Key &key, string *data);
 
   // Encrypt string to protect plain_text which may contain
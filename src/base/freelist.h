@@ -116,6 +116,14 @@ template <class T> class ObjectPool {
     freelist_.Free();
   }
 
+  // Makes all the objects available to Alloc() again without destroying
+  // them, so that the memory they own, e.g. the capacity of their strings,
+  // is reused.  Unlike Free(), the allocated chunks are kept.
+  void Reset() {
+    released_.clear();
+    freelist_.Reset();
+  }
+
   T* Alloc() {
     if (!released_.empty()) {
       T *result = released_.back();
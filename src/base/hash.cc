@@ -29,8 +29,24 @@
 
 #include "base/hash.h"
 
+#include <algorithm>
+#include <cstring>
+
 #include "base/port.h"
 
+// SSE2 is always available on x86-64, so no runtime detection is needed.
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MOZC_USE_SSE2_FINGERPRINT
+#include <emmintrin.h>
+#endif  // __SSE2__ || _M_X64 || _M_IX86_FP >= 2
+
+// The CRC32 instruction of SSE4.2 is detected at runtime.
+#if defined(__GNUC__) && defined(__x86_64__)
+#define MOZC_USE_SSE42_CRC32C
+#include <nmmintrin.h>
+#endif  // __GNUC__ && __x86_64__
+
 namespace mozc {
 namespace {
 
@@ -38,6 +54,17 @@ const uint32 kFingerPrint32Seed = 0xfd12deff;
 const uint32 kFingerPrintSeed0 = 0x6d6f;
 const uint32 kFingerPrintSeed1 = 0x7a63;
 
+// The lanes of Hash::Fingerprinter.
+const int kUpperLane = 0;
+const int kLowerLane = 1;
+const int kFingerprint32Lane = 2;
+
+const size_t kBlockSize = 12;
+
+// The polynomial of CRC-32C in the reversed bit order, which the CRC32
+// instruction of SSE4.2 uses.
+const uint32 kCrc32cPolynomial = 0x82f63b78;
+
 }  // namespace
 
 #define Mix(a, b, c) {            \
@@ -52,69 +79,212 @@ const uint32 kFingerPrintSeed1 = 0x7a63;
   c -= a; c -= b; c ^= (b >> 15); \
 }
 
-uint32 Hash::Fingerprint32(StringPiece str) {
-  return Fingerprint32WithSeed(str, kFingerPrint32Seed);
-}
-
-uint32 Hash::Fingerprint32WithSeed(StringPiece str, uint32 seed) {
 #define U32(x) static_cast<uint32>(x)
 #define ToUint32(a, b, c, d) \
   (U32(a) + (U32(b) << 8) + (U32(c) << 16) + (U32(d) << 24))
 
-  const uint32 str_len = U32(str.size());
-  uint32 a = 0x9e3779b9;
-  uint32 b = a;
-  uint32 c = seed;
-
-  while (str.size() >= 12) {
-    a += ToUint32(str[0], str[1], str[2], str[3]);
-    b += ToUint32(str[4], str[5], str[6], str[7]);
-    c += ToUint32(str[8], str[9], str[10], str[11]);
-    Mix(a, b, c);
-    str.remove_prefix(12);
+namespace {
+
+// The fingerprints below are computed by up to four hash states ("lanes"),
+// which differ only in their seeds and consume the same input.  Each lane
+// computes the same value as the original one-lane implementation.
+
+void InitLanes(const uint32 *seeds, int num_lanes,
+               uint32 *a, uint32 *b, uint32 *c) {
+  for (int i = 0; i < num_lanes; ++i) {
+    a[i] = 0x9e3779b9;
+    b[i] = a[i];
+    c[i] = seeds[i];
+  }
+}
+
+#ifdef MOZC_USE_SSE2_FINGERPRINT
+#define MixStep(x, y, z, shifted) \
+  x = _mm_xor_si128(_mm_sub_epi32(_mm_sub_epi32(x, y), z), shifted)
+
+// Same as Mix() for four lanes at once.
+inline void MixVector(__m128i *va, __m128i *vb, __m128i *vc) {
+  __m128i a = *va;
+  __m128i b = *vb;
+  __m128i c = *vc;
+  MixStep(a, b, c, _mm_srli_epi32(c, 13));
+  MixStep(b, c, a, _mm_slli_epi32(a, 8));
+  MixStep(c, a, b, _mm_srli_epi32(b, 13));
+  MixStep(a, b, c, _mm_srli_epi32(c, 12));
+  MixStep(b, c, a, _mm_slli_epi32(a, 16));
+  MixStep(c, a, b, _mm_srli_epi32(b, 5));
+  MixStep(a, b, c, _mm_srli_epi32(c, 3));
+  MixStep(b, c, a, _mm_slli_epi32(a, 10));
+  MixStep(c, a, b, _mm_srli_epi32(b, 15));
+  *va = a;
+  *vb = b;
+  *vc = c;
+}
+#undef MixStep
+#endif  // MOZC_USE_SSE2_FINGERPRINT
+
+// Consumes |num_blocks| blocks of 12 bytes from |data|.  The states of the
+// lanes must be arrays of four elements for the SIMD implementation.
+template <int kNumLanes>
+void MixBlocks(const char *data, size_t num_blocks,
+               uint32 *a, uint32 *b, uint32 *c) {
+#ifdef MOZC_USE_SSE2_FINGERPRINT
+  if (kNumLanes > 1) {
+    __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a));
+    __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b));
+    __m128i vc = _mm_loadu_si128(reinterpret_cast<const __m128i *>(c));
+    for (; num_blocks > 0; --num_blocks, data += kBlockSize) {
+      const char *d = data;
+      va = _mm_add_epi32(va, _mm_set1_epi32(ToUint32(d[0], d[1], d[2], d[3])));
+      vb = _mm_add_epi32(vb, _mm_set1_epi32(ToUint32(d[4], d[5], d[6], d[7])));
+      vc = _mm_add_epi32(vc,
+                         _mm_set1_epi32(ToUint32(d[8], d[9], d[10], d[11])));
+      MixVector(&va, &vb, &vc);
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(a), va);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(b), vb);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(c), vc);
+    return;
+  }
+#endif  // MOZC_USE_SSE2_FINGERPRINT
+  for (; num_blocks > 0; --num_blocks, data += kBlockSize) {
+    const char *d = data;
+    const uint32 wa = ToUint32(d[0], d[1], d[2], d[3]);
+    const uint32 wb = ToUint32(d[4], d[5], d[6], d[7]);
+    const uint32 wc = ToUint32(d[8], d[9], d[10], d[11]);
+    for (int i = 0; i < kNumLanes; ++i) {
+      a[i] += wa;
+      b[i] += wb;
+      c[i] += wc;
+      Mix(a[i], b[i], c[i]);
+    }
   }
+}
 
-  c += U32(str_len);
-  switch (str.size()) {
+// Consumes the last |tail_size| (< 12) bytes of the input of |length| bytes
+// and finalizes the lanes.  The results are left in |c|.
+void FinishLanes(const char *tail, size_t tail_size, uint32 length,
+                 int num_lanes, uint32 *a, uint32 *b, uint32 *c) {
+  uint32 wa = 0, wb = 0, wc = length;
+  switch (tail_size) {
     case 11:
-      c += U32(str[10]) << 24;
+      wc += U32(tail[10]) << 24;
       FALLTHROUGH_INTENDED;
     case 10:
-      c += U32(str[9]) << 16;
+      wc += U32(tail[9]) << 16;
       FALLTHROUGH_INTENDED;
     case 9:
-      c += U32(str[8]) << 8;
+      wc += U32(tail[8]) << 8;
       FALLTHROUGH_INTENDED;
     case 8:
-      b += U32(str[7]) << 24;
+      wb += U32(tail[7]) << 24;
       FALLTHROUGH_INTENDED;
     case 7:
-      b += U32(str[6]) << 16;
+      wb += U32(tail[6]) << 16;
       FALLTHROUGH_INTENDED;
     case 6:
-      b += U32(str[5]) << 8;
+      wb += U32(tail[5]) << 8;
       FALLTHROUGH_INTENDED;
     case 5:
-      b += U32(str[4]);
+      wb += U32(tail[4]);
       FALLTHROUGH_INTENDED;
     case 4:
-      a += U32(str[3]) << 24;
+      wa += U32(tail[3]) << 24;
       FALLTHROUGH_INTENDED;
     case 3:
-      a += U32(str[2]) << 16;
+      wa += U32(tail[2]) << 16;
       FALLTHROUGH_INTENDED;
     case 2:
-      a += U32(str[1]) << 8;
+      wa += U32(tail[1]) << 8;
       FALLTHROUGH_INTENDED;
     case 1:
-      a += U32(str[0]);
+      wa += U32(tail[0]);
       break;
   }
-  Mix(a, b, c);
+  for (int i = 0; i < num_lanes; ++i) {
+    a[i] += wa;
+    b[i] += wb;
+    c[i] += wc;
+    Mix(a[i], b[i], c[i]);
+  }
+}
+
+uint64 MakeFingerprint64(uint32 hi, uint32 lo) {
+  uint64 result = static_cast<uint64>(hi) << 32 | static_cast<uint64>(lo);
+  if ((hi == 0) && (lo < 2)) {
+    result ^= GG_ULONGLONG(0x130f9bef94a0a928);
+  }
+  return result;
+}
+
+class Crc32cTable {
+ public:
+  Crc32cTable() {
+    for (uint32 i = 0; i < 256; ++i) {
+      uint32 crc = i;
+      for (int j = 0; j < 8; ++j) {
+        crc = (crc >> 1) ^ ((crc & 1) ? kCrc32cPolynomial : 0);
+      }
+      table_[i] = crc;
+    }
+  }
+
+  uint32 operator[](uint8 index) const { return table_[index]; }
+
+ private:
+  uint32 table_[256];
+};
+
+uint32 ExtendCrc32cPortable(uint32 crc, const char *data, size_t size) {
+  // Function-local static initialization is thread safe.
+  static const Crc32cTable table;
+  const uint8 *bytes = reinterpret_cast<const uint8 *>(data);
+  for (size_t i = 0; i < size; ++i) {
+    crc = table[static_cast<uint8>(crc ^ bytes[i])] ^ (crc >> 8);
+  }
+  return crc;
+}
+
+#ifdef MOZC_USE_SSE42_CRC32C
+__attribute__((target("sse4.2")))
+uint32 ExtendCrc32cSse42(uint32 crc, const char *data, size_t size) {
+  uint64 crc64 = crc;
+  for (; size >= 8; data += 8, size -= 8) {
+    uint64 word;
+    memcpy(&word, data, sizeof(word));
+    crc64 = _mm_crc32_u64(crc64, word);
+  }
+  uint32 crc32 = static_cast<uint32>(crc64);
+  for (; size > 0; ++data, --size) {
+    crc32 = _mm_crc32_u8(crc32, static_cast<uint8>(*data));
+  }
+  return crc32;
+}
+
+typedef uint32 (*ExtendCrc32cFunc)(uint32 crc, const char *data, size_t size);
 
+ExtendCrc32cFunc GetExtendCrc32cFunc() {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("sse4.2") ? &ExtendCrc32cSse42
+                                          : &ExtendCrc32cPortable;
+}
+#endif  // MOZC_USE_SSE42_CRC32C
+
+}  // namespace
+
+uint32 Hash::Fingerprint32(StringPiece str) {
+  return Fingerprint32WithSeed(str, kFingerPrint32Seed);
+}
+
+uint32 Hash::Fingerprint32WithSeed(StringPiece str, uint32 seed) {
+  uint32 a = 0, b = 0, c = 0;
+  InitLanes(&seed, 1, &a, &b, &c);
+  const size_t num_blocks = str.size() / kBlockSize;
+  MixBlocks<1>(str.data(), num_blocks, &a, &b, &c);
+  FinishLanes(str.data() + num_blocks * kBlockSize,
+              str.size() - num_blocks * kBlockSize, U32(str.size()), 1,
+              &a, &b, &c);
   return c;
-#undef ToUint32
-#undef U32
 }
 
 uint64 Hash::Fingerprint(StringPiece str) {
@@ -122,13 +292,84 @@ uint64 Hash::Fingerprint(StringPiece str) {
 }
 
 uint64 Hash::FingerprintWithSeed(StringPiece str, uint32 seed) {
-  const uint32 hi = Fingerprint32WithSeed(str, seed);
-  const uint32 lo = Fingerprint32WithSeed(str, kFingerPrintSeed1);
-  uint64 result = static_cast<uint64>(hi) << 32 | static_cast<uint64>(lo);
-  if ((hi == 0) && (lo < 2)) {
-    result ^= GG_ULONGLONG(0x130f9bef94a0a928);
+  // Both halves are computed in one pass.
+  const uint32 seeds[] = {seed, kFingerPrintSeed1};
+  uint32 a[4], b[4], c[4];
+  InitLanes(seeds, 2, a, b, c);
+  const size_t num_blocks = str.size() / kBlockSize;
+  MixBlocks<2>(str.data(), num_blocks, a, b, c);
+  FinishLanes(str.data() + num_blocks * kBlockSize,
+              str.size() - num_blocks * kBlockSize, U32(str.size()), 2,
+              a, b, c);
+  return MakeFingerprint64(c[0], c[1]);
+}
+
+Hash::Fingerprinter::Fingerprinter() {
+  Init(kFingerPrintSeed0);
+}
+
+Hash::Fingerprinter::Fingerprinter(uint32 seed) {
+  Init(seed);
+}
+
+void Hash::Fingerprinter::Init(uint32 seed) {
+  uint32 seeds[4] = {0};
+  seeds[kUpperLane] = seed;
+  seeds[kLowerLane] = kFingerPrintSeed1;
+  seeds[kFingerprint32Lane] = kFingerPrint32Seed;
+  InitLanes(seeds, 4, a_, b_, c_);
+  buffer_size_ = 0;
+  length_ = 0;
+}
+
+void Hash::Fingerprinter::Append(StringPiece str) {
+  length_ += U32(str.size());
+  if (buffer_size_ > 0) {
+    const size_t size = std::min(kBlockSize - buffer_size_, str.size());
+    memcpy(buffer_ + buffer_size_, str.data(), size);
+    buffer_size_ += size;
+    str.remove_prefix(size);
+    if (buffer_size_ < kBlockSize) {
+      return;
+    }
+    MixBlocks<3>(buffer_, 1, a_, b_, c_);
+    buffer_size_ = 0;
   }
-  return result;
+  const size_t num_blocks = str.size() / kBlockSize;
+  MixBlocks<3>(str.data(), num_blocks, a_, b_, c_);
+  str.remove_prefix(num_blocks * kBlockSize);
+  memcpy(buffer_, str.data(), str.size());
+  buffer_size_ = str.size();
 }
 
+uint64 Hash::Fingerprinter::Fingerprint() const {
+  uint32 a[4], b[4], c[4];
+  memcpy(a, a_, sizeof(a));
+  memcpy(b, b_, sizeof(b));
+  memcpy(c, c_, sizeof(c));
+  FinishLanes(buffer_, buffer_size_, length_, 2, a, b, c);
+  return MakeFingerprint64(c[kUpperLane], c[kLowerLane]);
+}
+
+uint32 Hash::Fingerprinter::Fingerprint32() const {
+  uint32 a = a_[kFingerprint32Lane];
+  uint32 b = b_[kFingerprint32Lane];
+  uint32 c = c_[kFingerprint32Lane];
+  FinishLanes(buffer_, buffer_size_, length_, 1, &a, &b, &c);
+  return c;
+}
+
+uint32 Hash::ExtendCrc32c(uint32 crc, StringPiece str) {
+#ifdef MOZC_USE_SSE42_CRC32C
+  // The CPU feature is detected only once.
+  static const ExtendCrc32cFunc extend_crc32c = GetExtendCrc32cFunc();
+  return ~extend_crc32c(~crc, str.data(), str.size());
+#else  // MOZC_USE_SSE42_CRC32C
+  return ~ExtendCrc32cPortable(~crc, str.data(), str.size());
+#endif  // MOZC_USE_SSE42_CRC32C
+}
+
+#undef ToUint32
+#undef U32
+
 }  // namespace mozc
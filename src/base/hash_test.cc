@@ -57,6 +57,65 @@ TEST(HashTest, Basic) {
   EXPECT_EQ(0xe3fd29979d4f0b39, Hash::FingerprintWithSeed(s, 0xdeadbeef));
 }
 
+TEST(HashTest, StableOutput) {
+  // These values must not change as fingerprints are stored in user data.
+  string s = "\xe3\x82\x82\xe3\x81\x9a\xe3\x81\x8f\t"
+             "\xe3\x83\xa2\xe3\x82\xba\xe3\x82\xaf";
+  EXPECT_EQ(0x52fa0038, Hash::Fingerprint32(s));
+  EXPECT_EQ(0xf1ab9287af8b190b, Hash::Fingerprint(s));
+  EXPECT_EQ(0x2fdb9436af8b190b, Hash::FingerprintWithSeed(s, 0xdeadbeef));
+
+  s = "0123456789ab";
+  EXPECT_EQ(0xfa877a05, Hash::Fingerprint32(s));
+  EXPECT_EQ(0xfc645f41924adc88, Hash::Fingerprint(s));
+  EXPECT_EQ(0x29a100cc924adc88, Hash::FingerprintWithSeed(s, 0xdeadbeef));
+
+  s = "0123456789abcdefghijklmnopqrstuvw";
+  EXPECT_EQ(0xa9d94017, Hash::Fingerprint32(s));
+  EXPECT_EQ(0x278cbd6fda068a5d, Hash::Fingerprint(s));
+  EXPECT_EQ(0x6fb1b584da068a5d, Hash::FingerprintWithSeed(s, 0xdeadbeef));
+}
+
+TEST(HashTest, FingerprintIsMadeOfFingerprint32) {
+  // The halves of the 64-bit fingerprint are computed together; check that
+  // they are the same as the 32-bit fingerprints with the respective seeds.
+  string s;
+  for (int i = 0; i < 100; ++i) {
+    const uint64 fp = Hash::FingerprintWithSeed(s, 0xdeadbeef);
+    EXPECT_EQ(Hash::Fingerprint32WithSeed(s, 0xdeadbeef), fp >> 32) << i;
+    EXPECT_EQ(Hash::Fingerprint32WithSeed(s, 0x7a63), fp & 0xffffffff) << i;
+    s.push_back(static_cast<char>(i * 37 + 128));
+  }
+}
+
+TEST(HashTest, Fingerprinter) {
+  const string s =
+      "Hello, world!  Hello, Tokyo!  Good afternoon!  Ladies and gentlemen.";
+  for (size_t size = 0; size <= s.size(); ++size) {
+    const StringPiece str(s.data(), size);
+    // Split |str| into pieces of various sizes.
+    for (size_t step = 1; step <= 13; ++step) {
+      Hash::Fingerprinter fp;
+      Hash::Fingerprinter fp_with_seed(0xdeadbeef);
+      for (size_t pos = 0; pos < str.size(); pos += step) {
+        fp.Append(str.substr(pos, step));
+        fp_with_seed.Append(str.substr(pos, step));
+      }
+      EXPECT_EQ(Hash::Fingerprint(str), fp.Fingerprint());
+      EXPECT_EQ(Hash::Fingerprint32(str), fp.Fingerprint32());
+      EXPECT_EQ(Hash::FingerprintWithSeed(str, 0xdeadbeef),
+                fp_with_seed.Fingerprint());
+    }
+  }
+
+  Hash::Fingerprinter fp;
+  fp.Append("key");
+  fp.Append('\t');
+  fp.Append("value");
+  EXPECT_EQ(Hash::Fingerprint("key\tvalue"), fp.Fingerprint());
+  EXPECT_EQ(Hash::Fingerprint32("key\tvalue"), fp.Fingerprint32());
+}
+
 TEST(HashTest, Fingerprint32WithSeed_IntegralTypes) {
   const uint32 seed = 0xabcdef;
   {
@@ -97,5 +156,33 @@ TEST(HashTest, Fingerprint32WithSeed_IntegralTypes) {
   }
 }
 
+TEST(HashTest, Crc32c) {
+  // Test vectors from RFC 3720.
+  EXPECT_EQ(0, Hash::Crc32c(""));
+  EXPECT_EQ(0xe3069283, Hash::Crc32c("123456789"));
+  EXPECT_EQ(0x8a9136aa, Hash::Crc32c(string(32, '\0')));
+  EXPECT_EQ(0x62a8ab43, Hash::Crc32c(string(32, '\xff')));
+  string ascending;
+  for (int i = 0; i < 32; ++i) {
+    ascending.push_back(static_cast<char>(i));
+  }
+  EXPECT_EQ(0x46dd794e, Hash::Crc32c(ascending));
+}
+
+TEST(HashTest, ExtendCrc32c) {
+  // Cover both the words and the remaining bytes of every split.
+  string data;
+  for (int i = 0; i < 40; ++i) {
+    data.push_back(static_cast<char>(i * 37 + 11));
+  }
+  const uint32 expected = Hash::Crc32c(data);
+  for (size_t i = 0; i <= data.size(); ++i) {
+    const StringPiece piece(data);
+    EXPECT_EQ(expected, Hash::ExtendCrc32c(Hash::Crc32c(piece.substr(0, i)),
+                                           piece.substr(i)))
+        << i;
+  }
+}
+
 }  // namespace
 }  // namespace mozc
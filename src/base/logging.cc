@@ -47,11 +47,15 @@
 #endif  // OS_WIN
 
 #include <algorithm>
+#include <atomic>
 #include <cstdlib>
 #include <cstring>
+#include <deque>
 #include <fstream>
+#include <memory>
 #include <sstream>
 #include <string>
+#include <vector>
 
 #ifdef OS_ANDROID
 #include "base/const.h"
@@ -60,12 +64,23 @@
 #include "base/flags.h"
 #include "base/mutex.h"
 #include "base/singleton.h"
+#include "base/spsc_queue.h"
+#include "base/thread.h"
+#include "base/util.h"
 
 DEFINE_bool(colored_log, true, "Enables colored log messages on tty devices");
 DEFINE_bool(logtostderr,
             false,
             "log messages go to stderr instead of logfiles");
 DEFINE_int32(v, 0, "verbose level");
+DEFINE_bool(async_log, false,
+            "Writes log messages on a background thread so that logging "
+            "doesn't block the caller.  Fatal messages are still written "
+            "synchronously.");
+DEFINE_int32(async_log_max_lines_per_sec, 1000,
+             "Maximum number of the lines per second written to the log "
+             "stream with --async_log.  Errors are always written.  0 means "
+             "no limit.");
 
 namespace mozc {
 
@@ -155,6 +170,10 @@ void Logging::InitLogStream(const string &log_file_path) {
 void Logging::CloseLogStream() {
 }
 
+string Logging::GetRecentLogs() {
+  return "";
+}
+
 std::ostream &Logging::GetWorkingLogStream() {
   // Never called.
   return *(new std::ostringstream);
@@ -196,6 +215,96 @@ void Logging::SetConfigVerboseLevel(int verboselevel) {
 
 namespace {
 
+// Number of the lines each thread can queue with --async_log.  The lines
+// logged while the buffer is full are dropped.
+const size_t kAsyncLogBufferSize = 1024;
+// Interval of the background thread writing the queued lines.
+const uint32 kAsyncLogIntervalMsec = 50;
+// Number of the recent lines kept in memory with --async_log.
+const size_t kNumRecentLogLines = 256;
+
+class LogStreamImpl;
+
+struct LogLine {
+  LogSeverity severity = LOG_INFO;
+  string text;
+};
+
+// Writes the log lines queued by the logging threads to LogStreamImpl on a
+// low priority background thread.  Each logging thread has its own
+// lock-free buffer, so Push() takes no lock except for the first call on
+// the thread.
+class AsyncLogWriter {
+ public:
+  explicit AsyncLogWriter(LogStreamImpl *stream);
+  ~AsyncLogWriter();
+
+  // Queues |text| to the buffer of the calling thread.
+  void Push(LogSeverity severity, const string &text);
+
+  // Writes all the queued lines.  This method is thread-safe.
+  void Flush();
+
+  // Stops the background thread after writing all the queued lines.
+  void Stop();
+
+  // Returns the recent lines, including those not written because of
+  // --async_log_max_lines_per_sec.
+  string GetRecentLogs();
+
+ private:
+  typedef SpscQueue<LogLine> Buffer;
+  class WriterThread;
+
+  Buffer *GetThreadBuffer();
+  // Writes |line| unless it exceeds the rate limit.  Called under
+  // |flush_mutex_|.
+  void WriteLine(const LogLine &line);
+
+  LogStreamImpl *stream_;
+  std::atomic<bool> has_buffers_;
+  std::atomic<uint32> num_dropped_lines_;
+
+  // Guards |buffers_| and |writer_thread_|.
+  Mutex buffers_mutex_;
+  std::vector<std::shared_ptr<Buffer>> buffers_;
+  std::unique_ptr<WriterThread> writer_thread_;
+
+  // Serializes the consumers of |buffers_| and guards the members below.
+  Mutex flush_mutex_;
+  std::deque<string> recent_lines_;
+  uint64 rate_limit_second_;
+  int num_lines_in_second_;
+  uint32 num_suppressed_lines_;
+
+  DISALLOW_COPY_AND_ASSIGN(AsyncLogWriter);
+};
+
+class AsyncLogWriter::WriterThread : public Thread {
+ public:
+  explicit WriterThread(AsyncLogWriter *writer)
+      : writer_(writer), stopping_(false) {}
+
+  void Run() override {
+    Thread::LowerCurrentThreadPriority();
+    while (!stopping_.load(std::memory_order_acquire)) {
+      Util::Sleep(kAsyncLogIntervalMsec);
+      writer_->Flush();
+    }
+  }
+
+  void Stop() {
+    stopping_.store(true, std::memory_order_release);
+    Join();
+  }
+
+ private:
+  AsyncLogWriter *writer_;
+  std::atomic<bool> stopping_;
+
+  DISALLOW_COPY_AND_ASSIGN(WriterThread);
+};
+
 class LogStreamImpl {
  public:
   LogStreamImpl();
@@ -222,8 +331,17 @@ class LogStreamImpl {
     return support_color_;
   }
 
+  // Writes |log| to the real backing log stream, or queues it to
+  // |async_writer_| with --async_log.
   void Write(LogSeverity, const string &log);
 
+  // Writes |log| to the real backing log stream.
+  void WriteDirect(LogSeverity, const string &log);
+
+  AsyncLogWriter *async_writer() {
+    return &async_writer_;
+  }
+
  private:
   // Real backing log stream.
   // This is not thread-safe so must be guarded.
@@ -233,9 +351,21 @@ class LogStreamImpl {
   bool support_color_;
   bool use_cerr_;
   Mutex mutex_;
+  // Must be destroyed before the members above as it writes to them.
+  AsyncLogWriter async_writer_;
 };
 
 void LogStreamImpl::Write(LogSeverity severity, const string &log) {
+  if (FLAGS_async_log && severity < LOG_FATAL) {
+    async_writer_.Push(severity, log);
+    return;
+  }
+  // Keeps the order with the lines queued before.
+  async_writer_.Flush();
+  WriteDirect(severity, log);
+}
+
+void LogStreamImpl::WriteDirect(LogSeverity severity, const string &log) {
   scoped_lock l(&mutex_);
   if (use_cerr_) {
     std::cerr << log;
@@ -256,7 +386,8 @@ void LogStreamImpl::Write(LogSeverity severity, const string &log) {
   }
 }
 
-LogStreamImpl::LogStreamImpl() : real_log_stream_(nullptr) {
+LogStreamImpl::LogStreamImpl()
+    : real_log_stream_(nullptr), async_writer_(this) {
   Reset();
 }
 
@@ -322,11 +453,134 @@ void LogStreamImpl::Reset() {
 }
 
 LogStreamImpl::~LogStreamImpl() {
+  async_writer_.Stop();
   Reset();
 }
+
+AsyncLogWriter::AsyncLogWriter(LogStreamImpl *stream)
+    : stream_(stream),
+      has_buffers_(false),
+      num_dropped_lines_(0),
+      rate_limit_second_(0),
+      num_lines_in_second_(0),
+      num_suppressed_lines_(0) {}
+
+AsyncLogWriter::~AsyncLogWriter() {
+  Stop();
+}
+
+AsyncLogWriter::Buffer *AsyncLogWriter::GetThreadBuffer() {
+  // The buffer is kept in |buffers_| after the thread exits until all the
+  // lines in it are written.
+  thread_local std::shared_ptr<Buffer> buffer;
+  if (!buffer) {
+    buffer = std::make_shared<Buffer>(kAsyncLogBufferSize);
+    scoped_lock l(&buffers_mutex_);
+    buffers_.push_back(buffer);
+    has_buffers_.store(true, std::memory_order_release);
+    if (!writer_thread_) {
+      writer_thread_.reset(new WriterThread(this));
+      writer_thread_->SetJoinable(true);
+      writer_thread_->Start("AsyncLogWriter");
+    }
+  }
+  return buffer.get();
+}
+
+void AsyncLogWriter::Push(LogSeverity severity, const string &text) {
+  LogLine line;
+  line.severity = severity;
+  line.text = text;
+  if (!GetThreadBuffer()->Push(std::move(line))) {
+    num_dropped_lines_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void AsyncLogWriter::Flush() {
+  if (!has_buffers_.load(std::memory_order_acquire)) {
+    return;
+  }
+  scoped_lock flush_lock(&flush_mutex_);
+  std::vector<std::shared_ptr<Buffer>> buffers;
+  {
+    scoped_lock l(&buffers_mutex_);
+    // Forgets the buffers of the exited threads.
+    buffers_.erase(
+        std::remove_if(buffers_.begin(), buffers_.end(),
+                       [](const std::shared_ptr<Buffer> &buffer) {
+                         return buffer.use_count() == 1 && buffer->empty();
+                       }),
+        buffers_.end());
+    buffers = buffers_;
+  }
+  LogLine line;
+  for (size_t i = 0; i < buffers.size(); ++i) {
+    while (buffers[i]->Pop(&line)) {
+      WriteLine(line);
+    }
+  }
+  const uint32 num_dropped =
+      num_dropped_lines_.exchange(0, std::memory_order_relaxed);
+  if (num_dropped > 0) {
+    stream_->WriteDirect(LOG_WARNING,
+                         std::to_string(num_dropped) +
+                         " log lines were dropped as the buffer was full\n");
+  }
+}
+
+void AsyncLogWriter::WriteLine(const LogLine &line) {
+  recent_lines_.push_back(line.text);
+  if (recent_lines_.size() > kNumRecentLogLines) {
+    recent_lines_.pop_front();
+  }
+
+  if (FLAGS_async_log_max_lines_per_sec > 0 && line.severity < LOG_ERROR) {
+    const uint64 now = Clock::GetTime();
+    if (now != rate_limit_second_) {
+      if (num_suppressed_lines_ > 0) {
+        stream_->WriteDirect(
+            LOG_WARNING,
+            std::to_string(num_suppressed_lines_) +
+            " log lines were suppressed by --async_log_max_lines_per_sec\n");
+      }
+      rate_limit_second_ = now;
+      num_lines_in_second_ = 0;
+      num_suppressed_lines_ = 0;
+    }
+    if (num_lines_in_second_ >= FLAGS_async_log_max_lines_per_sec) {
+      ++num_suppressed_lines_;
+      return;
+    }
+    ++num_lines_in_second_;
+  }
+  stream_->WriteDirect(line.severity, line.text);
+}
+
+void AsyncLogWriter::Stop() {
+  std::unique_ptr<WriterThread> writer_thread;
+  {
+    scoped_lock l(&buffers_mutex_);
+    writer_thread = std::move(writer_thread_);
+  }
+  if (writer_thread) {
+    writer_thread->Stop();
+  }
+  Flush();
+}
+
+string AsyncLogWriter::GetRecentLogs() {
+  Flush();
+  scoped_lock l(&flush_mutex_);
+  string result;
+  for (size_t i = 0; i < recent_lines_.size(); ++i) {
+    result += recent_lines_[i];
+  }
+  return result;
+}
 }  // namespace
 
 void Logging::InitLogStream(const string &log_file_path) {
+  Singleton<LogStreamImpl>::get()->async_writer()->Flush();
   Singleton<LogStreamImpl>::get()->Init(log_file_path);
   std::ostream &stream = GetWorkingLogStream();
   stream << "Log file created at: " << Logging::GetLogMessageHeader();
@@ -334,9 +588,14 @@ void Logging::InitLogStream(const string &log_file_path) {
 }
 
 void Logging::CloseLogStream() {
+  Singleton<LogStreamImpl>::get()->async_writer()->Flush();
   Singleton<LogStreamImpl>::get()->Reset();
 }
 
+string Logging::GetRecentLogs() {
+  return Singleton<LogStreamImpl>::get()->async_writer()->GetRecentLogs();
+}
+
 std::ostream &Logging::GetWorkingLogStream() {
   return *(new std::ostringstream);
 }
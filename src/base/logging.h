@@ -82,6 +82,11 @@ class Logging {
   // Closes the logging stream
   static void CloseLogStream();
 
+  // Returns the last lines logged with --async_log, including those not
+  // written to the log stream because of the rate limit, so that they can be
+  // attached to a bug or crash report.
+  static string GetRecentLogs();
+
   // Gets working log stream. The log message can be written to the stream.
   // The stream must be finalized by FinalizeWorkingLogStream().
   static std::ostream &GetWorkingLogStream();
@@ -30,9 +30,12 @@
 #include "base/logging.h"
 
 #include <sstream>
+#include <string>
 
 #include "testing/base/public/gunit.h"
 
+DECLARE_bool(async_log);
+
 namespace mozc {
 namespace {
 
@@ -215,5 +218,27 @@ TEST(LoggingTest, RightHandSideEvaluation) {
   EXPECT_EQ(0, g_counter);
 }
 
+#ifndef NO_LOGGING
+TEST(LoggingTest, AsyncLog) {
+  const bool original_async_log = FLAGS_async_log;
+  FLAGS_async_log = true;
+  for (int i = 0; i < 10; ++i) {
+    LOG(INFO) << "async log test " << i;
+  }
+  FLAGS_async_log = original_async_log;
+
+  // The queued lines are written in order.
+  const string recent_logs = Logging::GetRecentLogs();
+  string::size_type last_pos = 0;
+  for (int i = 0; i < 10; ++i) {
+    const string::size_type pos =
+        recent_logs.find("async log test " + std::to_string(i) + "\n");
+    ASSERT_NE(string::npos, pos) << recent_logs;
+    EXPECT_LE(last_pos, pos);
+    last_pos = pos;
+  }
+}
+#endif  // NO_LOGGING
+
 }  // namespace
 }  // namespace mozc
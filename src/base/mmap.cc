@@ -40,6 +40,8 @@
 #include <unistd.h>
 #endif  // OS_WIN
 
+#include <cerrno>
+#include <cstdint>
 #include <cstring>
 
 #include "base/port.h"
@@ -298,4 +300,83 @@ int Mmap::MaybeMUnlock(const void *addr, size_t len) {
 
 #undef MOZC_HAVE_MLOCK
 
+namespace {
+
+size_t GetPageSize() {
+#if defined(OS_WIN)
+  SYSTEM_INFO info;
+  ::GetSystemInfo(&info);
+  return info.dwPageSize;
+#elif defined(MOZC_USE_PEPPER_FILE_IO)
+  return 4096;
+#else  // OS_WIN
+  const long page_size = ::sysconf(_SC_PAGESIZE);  // NOLINT
+  return page_size > 0 ? page_size : 4096;
+#endif  // OS_WIN
+}
+
+}  // namespace
+
+bool Mmap::Advise(const void *addr, size_t len, AccessPattern pattern) {
+  if (addr == nullptr || len == 0) {
+    return false;
+  }
+  static const size_t kPageSize = GetPageSize();
+  const uintptr_t begin =
+      reinterpret_cast<uintptr_t>(addr) & ~(kPageSize - 1);
+  const uintptr_t end = reinterpret_cast<uintptr_t>(addr) + len;
+#if defined(OS_WIN)
+  if (pattern != WILL_NEED) {
+    return false;
+  }
+  // PrefetchVirtualMemory() is available on Windows 8 and later.
+  struct MemoryRangeEntry {
+    PVOID virtual_address;
+    SIZE_T number_of_bytes;
+  };
+  typedef BOOL (WINAPI *PrefetchVirtualMemoryFunc)(
+      HANDLE, ULONG_PTR, MemoryRangeEntry *, ULONG);
+  static const PrefetchVirtualMemoryFunc prefetch =
+      reinterpret_cast<PrefetchVirtualMemoryFunc>(::GetProcAddress(
+          ::GetModuleHandleW(L"kernel32.dll"), "PrefetchVirtualMemory"));
+  if (prefetch == nullptr) {
+    return false;
+  }
+  MemoryRangeEntry entry = {reinterpret_cast<PVOID>(begin), end - begin};
+  return prefetch(::GetCurrentProcess(), 1, &entry, 0) != FALSE;
+#elif defined(MOZC_USE_PEPPER_FILE_IO) || defined(OS_NACL)
+  // The data is not mapped from a file.
+  return false;
+#else  // OS_WIN
+  int advice = MADV_NORMAL;
+  switch (pattern) {
+    case RANDOM:
+      advice = MADV_RANDOM;
+      break;
+    case SEQUENTIAL:
+      advice = MADV_SEQUENTIAL;
+      break;
+    case WILL_NEED:
+      advice = MADV_WILLNEED;
+      break;
+    default:
+      break;
+  }
+  if (::madvise(reinterpret_cast<void *>(begin), end - begin, advice) != 0) {
+    VLOG(1) << "madvise() failed: " << errno;
+    return false;
+  }
+  return true;
+#endif  // OS_WIN
+}
+
+void Mmap::Touch(const void *addr, size_t len) {
+  static const size_t kPageSize = GetPageSize();
+  // Volatile prevents the compiler from eliminating the reads.
+  const volatile char *ptr = reinterpret_cast<const volatile char *>(addr);
+  for (size_t offset = 0; offset < len; offset += kPageSize) {
+    ptr[offset];
+  }
+}
+
 }  // namespace mozc
@@ -63,6 +63,25 @@ class Mmap : public MmapSyncInterface {
   static int MaybeMLock(const void *addr, size_t len);
   static int MaybeMUnlock(const void *addr, size_t len);
 
+  // Access pattern hints for Advise().
+  enum AccessPattern {
+    NORMAL,
+    RANDOM,      // Pages are accessed in random order; disables read-ahead.
+    SEQUENTIAL,  // Pages are accessed in sequential order.
+    WILL_NEED,   // Pages will be accessed soon; starts paging them in.
+  };
+
+  // Gives the OS a hint on how the mapped range [addr, addr + len) will be
+  // accessed.  The range is extended to page boundaries.  This is madvise()
+  // on POSIX and PrefetchVirtualMemory() (WILL_NEED only) on Windows 8 or
+  // later.  Returns false if the hint is not supported or fails; callers can
+  // ignore the result since hints never change the contents.
+  static bool Advise(const void *addr, size_t len, AccessPattern pattern);
+
+  // Reads one byte of each page in [addr, addr + len) so that the following
+  // accesses don't cause major page faults.
+  static void Touch(const void *addr, size_t len);
+
 #ifndef MOZC_USE_PEPPER_FILE_IO
   char &operator[](size_t n) { return *(text_ + n); }
   char operator[](size_t n) const { return *(text_ + n); }
@@ -109,5 +109,32 @@ TEST(MmapTest, MaybeMLockTest) {
   }
 }
 
+TEST(MmapTest, AdviseAndTouch) {
+  const string filename = FileUtil::JoinPath(FLAGS_test_tmpdir, "advise.db");
+  const size_t kFileSize = 3 * 8192 + 100;
+  {
+    const string data(kFileSize, 'a');
+    OutputFileStream ofs(filename.c_str(), std::ios::out | std::ios::binary);
+    EXPECT_TRUE(ofs.good());
+    ofs.write(data.data(), data.size());
+  }
+
+  {
+    Mmap mmap;
+    ASSERT_TRUE(mmap.Open(filename.c_str(), "r"));
+    EXPECT_FALSE(Mmap::Advise(nullptr, 0, Mmap::RANDOM));
+#if !defined(OS_WIN) && !defined(OS_NACL)
+    EXPECT_TRUE(Mmap::Advise(mmap.begin(), mmap.size(), Mmap::RANDOM));
+    // Unaligned ranges are extended to page boundaries.
+    EXPECT_TRUE(Mmap::Advise(mmap.begin() + 100, 8192, Mmap::WILL_NEED));
+    EXPECT_TRUE(Mmap::Advise(mmap.begin(), mmap.size(), Mmap::NORMAL));
+#endif  // !OS_WIN && !OS_NACL
+    Mmap::Touch(mmap.begin(), mmap.size());
+    Mmap::Touch(mmap.begin() + 1, 0);
+    EXPECT_EQ('a', mmap[kFileSize - 1]);
+  }
+  FileUtil::Unlink(filename);
+}
+
 }  // namespace
 }  // namespace mozc
@@ -35,14 +35,27 @@
 #include <pthread.h>
 #endif
 
+#if defined(OS_LINUX) && !defined(OS_NACL)
+// Linux and Android.
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif  // OS_LINUX && !OS_NACL
+
 #include <atomic>
+#include <climits>
+#include <new>
 
 #include "base/port.h"
 
 #if defined(OS_WIN)
 // We do not use pthread on Windows
+#elif defined(OS_LINUX) && !defined(OS_NACL)
+// Spin-then-futex locks, which take no system call unless contended.
+#define MOZC_USE_FUTEX_MUTEX
 #elif defined(OS_NACL)
-// TODO(team): Consider to use glibc rwlock.
+// NaCl has no pthread_rwlock_t.  A writer-preferring lock is built on
+// pthread_cond_t instead.
 #else
 #define MOZC_PTHREAD_HAS_READER_WRITER_LOCK
 #endif
@@ -127,6 +140,255 @@ bool ReaderWriterMutex::MultipleReadersThreadsSupported() {
   return true;
 }
 
+#elif defined(MOZC_USE_FUTEX_MUTEX)  // Hereafter, futex-based implementation
+
+namespace {
+
+// The number of the attempts to take a lock before sleeping.  The locks are
+// usually held for a short time, so spinning saves the system calls.
+const int kSpinCount = 100;
+
+static_assert(sizeof(std::atomic<int32>) == sizeof(int32),
+              "The futex word must be a plain int32");
+
+inline void CpuRelax() {
+#if defined(__i386__) || defined(__x86_64__)
+  __builtin_ia32_pause();
+#endif  // __i386__ || __x86_64__
+}
+
+// Sleeps while |*word| == |expected|.  May return spuriously.
+inline void FutexWait(std::atomic<int32> *word, int32 expected) {
+  syscall(SYS_futex, reinterpret_cast<int32 *>(word), FUTEX_WAIT_PRIVATE,
+          expected, nullptr, nullptr, 0);
+}
+
+// Wakes up to |count| threads sleeping on |word|.
+inline void FutexWake(std::atomic<int32> *word, int count) {
+  syscall(SYS_futex, reinterpret_cast<int32 *>(word), FUTEX_WAKE_PRIVATE,
+          count, nullptr, nullptr, 0);
+}
+
+// Returns an identifier of the current thread, which is never 0.
+inline uintptr_t GetCurrentThreadKey() {
+  static thread_local char key;
+  return reinterpret_cast<uintptr_t>(&key);
+}
+
+struct FutexMutex {
+  enum State {
+    UNLOCKED = 0,
+    LOCKED = 1,
+    // Locked, and some threads may be sleeping.
+    CONTENDED = 2,
+  };
+
+  std::atomic<int32> state;
+  // GetCurrentThreadKey() of the owner, or 0.
+  std::atomic<uintptr_t> owner;
+  // The recursion depth, accessed only by the owner.
+  int32 depth;
+};
+
+template <typename T>
+FutexMutex *AsFutexMutex(T *opaque_buffer) {
+  static_assert(sizeof(T) >= sizeof(FutexMutex),
+                "The opaque buffer must have sufficient space to store a "
+                "FutexMutex structure");
+  return reinterpret_cast<FutexMutex *>(opaque_buffer);
+}
+
+void LockContended(FutexMutex *mutex) {
+  for (int i = 0; i < kSpinCount; ++i) {
+    int32 state = mutex->state.load(std::memory_order_relaxed);
+    if (state == FutexMutex::UNLOCKED &&
+        mutex->state.compare_exchange_weak(state, FutexMutex::LOCKED,
+                                           std::memory_order_acquire)) {
+      return;
+    }
+    CpuRelax();
+  }
+  // Marks the lock contended so that Unlock() wakes this thread up.  The lock
+  // stays contended after this thread takes it, as the other threads may
+  // still be sleeping.
+  while (mutex->state.exchange(FutexMutex::CONTENDED,
+                               std::memory_order_acquire) !=
+         FutexMutex::UNLOCKED) {
+    FutexWait(&mutex->state, FutexMutex::CONTENDED);
+  }
+}
+
+// A writer-preferring reader/writer lock.  New readers wait while a writer
+// is waiting, so that writers are never starved by the readers.
+struct FutexRWLock {
+  // The number of the readers, or -1 while a writer holds the lock.
+  std::atomic<int32> state;
+  // The number of the writers waiting for the lock.
+  std::atomic<int32> writers_waiting;
+  // Incremented on every release.  The waiters sleep on this.
+  std::atomic<int32> sequence;
+  // The number of the threads sleeping on |sequence|.
+  std::atomic<int32> sleepers;
+};
+
+template <typename T>
+FutexRWLock *AsFutexRWLock(T *opaque_buffer) {
+  static_assert(sizeof(T) >= sizeof(FutexRWLock),
+                "The opaque buffer must have sufficient space to store a "
+                "FutexRWLock structure");
+  return reinterpret_cast<FutexRWLock *>(opaque_buffer);
+}
+
+bool TryReaderLock(FutexRWLock *lock) {
+  int32 state = lock->state.load(std::memory_order_relaxed);
+  return state >= 0 &&
+         lock->writers_waiting.load(std::memory_order_relaxed) == 0 &&
+         lock->state.compare_exchange_weak(state, state + 1,
+                                           std::memory_order_acquire);
+}
+
+bool TryWriterLock(FutexRWLock *lock) {
+  int32 state = 0;
+  return lock->state.compare_exchange_weak(state, -1,
+                                           std::memory_order_acquire);
+}
+
+// Spins and then sleeps until |try_lock| succeeds.
+void WaitForRWLock(FutexRWLock *lock, bool (*try_lock)(FutexRWLock *)) {
+  for (int i = 0; i < kSpinCount; ++i) {
+    if (try_lock(lock)) {
+      return;
+    }
+    CpuRelax();
+  }
+  while (true) {
+    // |sequence| is read before the attempt, so that a release after the
+    // attempt makes FutexWait() return immediately.
+    const int32 sequence = lock->sequence.load();
+    if (try_lock(lock)) {
+      return;
+    }
+    ++lock->sleepers;
+    FutexWait(&lock->sequence, sequence);
+    --lock->sleepers;
+  }
+}
+
+void NotifyRWLockWaiters(FutexRWLock *lock) {
+  ++lock->sequence;
+  if (lock->sleepers.load() > 0) {
+    FutexWake(&lock->sequence, INT_MAX);
+  }
+}
+
+}  // namespace
+
+Mutex::Mutex() {
+  FutexMutex *mutex = new (&opaque_buffer_) FutexMutex;
+  mutex->state = FutexMutex::UNLOCKED;
+  mutex->owner = 0;
+  mutex->depth = 0;
+}
+
+Mutex::~Mutex() {
+  AsFutexMutex(&opaque_buffer_)->~FutexMutex();
+}
+
+void Mutex::Lock() {
+  FutexMutex *mutex = AsFutexMutex(&opaque_buffer_);
+  const uintptr_t self = GetCurrentThreadKey();
+  // Only this thread sets |owner| to |self|, so the relaxed load is enough
+  // to detect the recursion.
+  if (mutex->owner.load(std::memory_order_relaxed) == self) {
+    ++mutex->depth;
+    return;
+  }
+  int32 state = FutexMutex::UNLOCKED;
+  if (!mutex->state.compare_exchange_strong(state, FutexMutex::LOCKED,
+                                            std::memory_order_acquire)) {
+    LockContended(mutex);
+  }
+  mutex->owner.store(self, std::memory_order_relaxed);
+  mutex->depth = 1;
+}
+
+bool Mutex::TryLock() {
+  FutexMutex *mutex = AsFutexMutex(&opaque_buffer_);
+  const uintptr_t self = GetCurrentThreadKey();
+  if (mutex->owner.load(std::memory_order_relaxed) == self) {
+    ++mutex->depth;
+    return true;
+  }
+  int32 state = FutexMutex::UNLOCKED;
+  if (!mutex->state.compare_exchange_strong(state, FutexMutex::LOCKED,
+                                            std::memory_order_acquire)) {
+    return false;
+  }
+  mutex->owner.store(self, std::memory_order_relaxed);
+  mutex->depth = 1;
+  return true;
+}
+
+void Mutex::Unlock() {
+  FutexMutex *mutex = AsFutexMutex(&opaque_buffer_);
+  if (--mutex->depth > 0) {
+    return;
+  }
+  mutex->owner.store(0, std::memory_order_relaxed);
+  if (mutex->state.exchange(FutexMutex::UNLOCKED,
+                            std::memory_order_release) ==
+      FutexMutex::CONTENDED) {
+    FutexWake(&mutex->state, 1);
+  }
+}
+
+ReaderWriterMutex::ReaderWriterMutex() {
+  FutexRWLock *lock = new (&opaque_buffer_) FutexRWLock;
+  lock->state = 0;
+  lock->writers_waiting = 0;
+  lock->sequence = 0;
+  lock->sleepers = 0;
+}
+
+ReaderWriterMutex::~ReaderWriterMutex() {
+  AsFutexRWLock(&opaque_buffer_)->~FutexRWLock();
+}
+
+void ReaderWriterMutex::ReaderLock() {
+  FutexRWLock *lock = AsFutexRWLock(&opaque_buffer_);
+  if (!TryReaderLock(lock)) {
+    WaitForRWLock(lock, &TryReaderLock);
+  }
+}
+
+void ReaderWriterMutex::ReaderUnlock() {
+  FutexRWLock *lock = AsFutexRWLock(&opaque_buffer_);
+  if (lock->state.fetch_sub(1, std::memory_order_release) == 1) {
+    // The last reader lets a waiting writer in.
+    NotifyRWLockWaiters(lock);
+  }
+}
+
+void ReaderWriterMutex::WriterLock() {
+  FutexRWLock *lock = AsFutexRWLock(&opaque_buffer_);
+  if (TryWriterLock(lock)) {
+    return;
+  }
+  ++lock->writers_waiting;
+  WaitForRWLock(lock, &TryWriterLock);
+  --lock->writers_waiting;
+}
+
+void ReaderWriterMutex::WriterUnlock() {
+  FutexRWLock *lock = AsFutexRWLock(&opaque_buffer_);
+  lock->state.store(0, std::memory_order_release);
+  NotifyRWLockWaiters(lock);
+}
+
+bool ReaderWriterMutex::MultipleReadersThreadsSupported() {
+  return true;
+}
+
 #else  // Hereafter, we have pthread-based implementation
 
 namespace {
@@ -227,36 +489,86 @@ bool ReaderWriterMutex::MultipleReadersThreadsSupported() {
   return true;
 }
 
-#else
+#else  // MOZC_PTHREAD_HAS_READER_WRITER_LOCK
+
+namespace {
+
+// A writer-preferring reader/writer lock.  New readers wait while a writer
+// is waiting, so that writers are never starved by the readers.
+struct CondRWLock {
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  // The number of the readers, or -1 while a writer holds the lock.
+  int32 state;
+  // The number of the writers waiting for the lock.
+  int32 writers_waiting;
+};
+
+template <typename T>
+CondRWLock *AsCondRWLock(T *opaque_buffer) {
+  static_assert(sizeof(T) >= sizeof(CondRWLock),
+                "The opaque buffer must have sufficient space to store a "
+                "CondRWLock structure");
+  return reinterpret_cast<CondRWLock *>(opaque_buffer);
+}
+
+}  // namespace
 
-// Fallback implementations as ReaderWriterLock is not available.
 ReaderWriterMutex::ReaderWriterMutex() {
-  // Non-recursive lock is OK.
-  pthread_mutex_init(AsPthreadMutexT(&opaque_buffer_), NULL);
+  CondRWLock *lock = AsCondRWLock(&opaque_buffer_);
+  pthread_mutex_init(&lock->mutex, NULL);
+  pthread_cond_init(&lock->cond, NULL);
+  lock->state = 0;
+  lock->writers_waiting = 0;
 }
 
 ReaderWriterMutex::~ReaderWriterMutex() {
-  pthread_mutex_destroy(AsPthreadMutexT(&opaque_buffer_));
+  CondRWLock *lock = AsCondRWLock(&opaque_buffer_);
+  pthread_cond_destroy(&lock->cond);
+  pthread_mutex_destroy(&lock->mutex);
 }
 
 void ReaderWriterMutex::ReaderLock() {
-  pthread_mutex_lock(AsPthreadMutexT(&opaque_buffer_));
+  CondRWLock *lock = AsCondRWLock(&opaque_buffer_);
+  pthread_mutex_lock(&lock->mutex);
+  while (lock->state < 0 || lock->writers_waiting > 0) {
+    pthread_cond_wait(&lock->cond, &lock->mutex);
+  }
+  ++lock->state;
+  pthread_mutex_unlock(&lock->mutex);
 }
 
 void ReaderWriterMutex::WriterLock() {
-  pthread_mutex_lock(AsPthreadMutexT(&opaque_buffer_));
+  CondRWLock *lock = AsCondRWLock(&opaque_buffer_);
+  pthread_mutex_lock(&lock->mutex);
+  ++lock->writers_waiting;
+  while (lock->state != 0) {
+    pthread_cond_wait(&lock->cond, &lock->mutex);
+  }
+  --lock->writers_waiting;
+  lock->state = -1;
+  pthread_mutex_unlock(&lock->mutex);
 }
 
 void ReaderWriterMutex::ReaderUnlock() {
-  pthread_mutex_unlock(AsPthreadMutexT(&opaque_buffer_));
+  CondRWLock *lock = AsCondRWLock(&opaque_buffer_);
+  pthread_mutex_lock(&lock->mutex);
+  if (--lock->state == 0) {
+    pthread_cond_broadcast(&lock->cond);
+  }
+  pthread_mutex_unlock(&lock->mutex);
 }
 
 void ReaderWriterMutex::WriterUnlock() {
-  pthread_mutex_unlock(AsPthreadMutexT(&opaque_buffer_));
+  CondRWLock *lock = AsCondRWLock(&opaque_buffer_);
+  pthread_mutex_lock(&lock->mutex);
+  lock->state = 0;
+  pthread_cond_broadcast(&lock->cond);
+  pthread_mutex_unlock(&lock->mutex);
 }
 
 bool ReaderWriterMutex::MultipleReadersThreadsSupported() {
-  return false;
+  return true;
 }
 
 #endif  // MOZC_PTHREAD_HAS_READER_WRITER_LOCK
@@ -286,6 +286,115 @@ TEST(MutexTest, ReaderWriterMutexTest) {
   }
 }
 
+class LockThread : public Thread {
+ public:
+  LockThread(ReaderWriterMutex *mutex, bool writer)
+      : mutex_(mutex), writer_(writer), locked_(false) {}
+
+  ~LockThread() override = default;
+
+  void Run() override NO_THREAD_SAFETY_ANALYSIS {
+    if (writer_) {
+      mutex_->WriterLock();
+      locked_ = true;
+      mutex_->WriterUnlock();
+    } else {
+      mutex_->ReaderLock();
+      locked_ = true;
+      mutex_->ReaderUnlock();
+    }
+  }
+
+  bool locked() const { return locked_; }
+
+ private:
+  ReaderWriterMutex *mutex_;
+  const bool writer_;
+  std::atomic<bool> locked_;
+};
+
+// Marked as NO_THREAD_SAFETY_ANALYSIS as the lock is released in the middle.
+TEST(MutexTest, WaitingWriterBlocksNewReaders) NO_THREAD_SAFETY_ANALYSIS {
+  ReaderWriterMutex mutex;
+  mutex.ReaderLock();
+
+  LockThread writer(&mutex, true);
+  ThreadJoiner writer_joiner(&writer);
+  writer.Start("Writer");
+  Util::Sleep(50);
+  EXPECT_FALSE(writer.locked());
+
+  // The writer is waiting, so a new reader has to wait for it.
+  LockThread reader(&mutex, false);
+  ThreadJoiner reader_joiner(&reader);
+  reader.Start("Reader");
+  Util::Sleep(50);
+  EXPECT_FALSE(reader.locked());
+
+  mutex.ReaderUnlock();
+  while (!writer.locked() || !reader.locked()) {
+    Util::Sleep(10);
+  }
+}
+
+TEST(MutexTest, ReaderWriterMutexUnderContention) {
+  const int kThreadsSize = 8;
+  const int kLoopSize = 10000;
+
+  ReaderWriterMutex mutex;
+  // Kept equal by the writers.
+  int value1 = 0;
+  int value2 = 0;
+  std::atomic<int> num_mismatches(0);
+
+  class ContentionThread : public Thread {
+   public:
+    ContentionThread(ReaderWriterMutex *mutex, int *value1, int *value2,
+                     std::atomic<int> *num_mismatches, bool writer)
+        : mutex_(mutex), value1_(value1), value2_(value2),
+          num_mismatches_(num_mismatches), writer_(writer) {}
+
+    void Run() override {
+      for (int i = 0; i < kLoopSize; ++i) {
+        if (writer_ && i % 10 == 0) {
+          scoped_writer_lock l(mutex_);
+          ++*value1_;
+          ++*value2_;
+        } else {
+          scoped_reader_lock l(mutex_);
+          if (*value1_ != *value2_) {
+            ++*num_mismatches_;
+          }
+        }
+      }
+    }
+
+   private:
+    ReaderWriterMutex *mutex_;
+    int *value1_;
+    int *value2_;
+    std::atomic<int> *num_mismatches_;
+    const bool writer_;
+  };
+
+  {
+    std::vector<std::unique_ptr<ContentionThread>> threads;
+    std::vector<ThreadJoiner> joiners;
+    for (int i = 0; i < kThreadsSize; ++i) {
+      threads.emplace_back(new ContentionThread(
+          &mutex, &value1, &value2, &num_mismatches, i % 2 == 0));
+      joiners.emplace_back(threads.back().get());
+    }
+    for (auto &thread : threads) {
+      thread->Start("Contention");
+    }
+  }
+
+  EXPECT_EQ(0, num_mismatches.load());
+  EXPECT_EQ(kThreadsSize / 2 * kLoopSize / 10, value1);
+  EXPECT_EQ(value1, value2);
+}
+
 std::atomic<int> g_num_called;
 
 void IncrementGNumCalled() {
@@ -240,13 +240,13 @@ bool NumberUtil::ArabicToKanji(StringPiece input_num,
   string input(filled_zero_num, kAsciiZero);
   input.append(input_num.data(), input_num.size());
 
-  // Segment into kDigitsInBigRank-digits pieces
-  std::vector<string> ranked_numbers;
-  for (int i = static_cast<int>(input.size()) - kDigitsInBigRank; i >= 0;
-       i -= kDigitsInBigRank) {
-    ranked_numbers.push_back(input.substr(i, kDigitsInBigRank));
-  }
-  const size_t rank_size = ranked_numbers.size();
+  // The number of kDigitsInBigRank-digits pieces.  The rank-th piece from the
+  // lowest is referred in place.
+  const size_t rank_size = input.size() / kDigitsInBigRank;
+
+  // Reused for all the variations.  Each digit takes at most two kanjis.
+  string result;
+  result.reserve(input.size() * 6 + rank_size * 3);
 
   for (size_t variation_index = 0;
        variation_index < arraysize(kKanjiVariations); ++variation_index) {
@@ -270,13 +270,14 @@ bool NumberUtil::ArabicToKanji(StringPiece input_num,
       bigger_ranks = kNumKanjiBiggerRanks;
     }
 
-    // TODO(peria): Bring |result| out if it improves the performance.
-    string result;
+    result.clear();
 
     // Converts each segment, and merges them with rank Kanjis.
     for (int rank = rank_size - 1; rank >= 0; --rank) {
-      const string &segment = ranked_numbers[rank];
-      string segment_result;
+      const StringPiece segment(
+          input.data() + (rank_size - 1 - rank) * kDigitsInBigRank,
+          kDigitsInBigRank);
+      const size_t segment_begin = result.size();
       bool leading = true;
       for (size_t i = 0; i < segment.size(); ++i) {
         if (leading && segment[i] == kAsciiZero) {
@@ -286,7 +287,7 @@ bool NumberUtil::ArabicToKanji(StringPiece input_num,
         leading = false;
         if (style == NumberString::NUMBER_ARABIC_AND_KANJI_HALFWIDTH ||
             style == NumberString::NUMBER_ARABIC_AND_KANJI_FULLWIDTH) {
-          segment_result += digits[segment[i] - kAsciiZero];
+          result += digits[segment[i] - kAsciiZero];
         } else {
           if (segment[i] == kAsciiZero) {
             continue;
@@ -294,13 +295,13 @@ bool NumberUtil::ArabicToKanji(StringPiece input_num,
           // In "大字" style, "壱" is also required on every rank.
           if (style == NumberString::NUMBER_OLD_KANJI ||
               i == kDigitsInBigRank - 1 || segment[i] != kAsciiOne) {
-            segment_result += digits[segment[i] - kAsciiZero];
+            result += digits[segment[i] - kAsciiZero];
           }
-          segment_result += ranks[kDigitsInBigRank - i];
+          result += ranks[kDigitsInBigRank - i];
         }
       }
-      if (!segment_result.empty()) {
-        result += segment_result + bigger_ranks[rank];
+      if (result.size() != segment_begin) {
+        result += bigger_ranks[rank];
       }
     }
 
@@ -0,0 +1,92 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "base/parallel_initializer.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "base/logging.h"
+#include "base/stopwatch.h"
+#include "base/thread_pool.h"
+
+namespace mozc {
+
+ParallelInitializer::ParallelInitializer(int num_threads)
+    : num_threads_(num_threads) {}
+
+ParallelInitializer::~ParallelInitializer() {}
+
+void ParallelInitializer::Add(const string &name,
+                              std::function<void()> task) {
+  tasks_.push_back(std::make_pair(name, std::move(task)));
+}
+
+void ParallelInitializer::Run(const string &label) {
+  timings_.assign(tasks_.size(), Timing());
+  Stopwatch total = Stopwatch::StartNew();
+  const auto run_task = [this](size_t index) {
+    Stopwatch stopwatch = Stopwatch::StartNew();
+    tasks_[index].second();
+    timings_[index].name = tasks_[index].first;
+    timings_[index].elapsed_usec =
+        static_cast<uint64>(stopwatch.GetElapsedMicroseconds());
+  };
+
+  const int num_threads =
+      std::min(num_threads_, static_cast<int>(tasks_.size()));
+  if (num_threads <= 0) {
+    for (size_t i = 0; i < tasks_.size(); ++i) {
+      run_task(i);
+    }
+  } else {
+    // Destroying the pool joins the threads after all the tasks are done.
+    ThreadPool pool(num_threads);
+    BlockingCounter counter(static_cast<int>(tasks_.size()));
+    for (size_t i = 0; i < tasks_.size(); ++i) {
+      pool.Schedule([&run_task, &counter, i]() {
+        run_task(i);
+        counter.DecrementCount();
+      });
+    }
+    counter.Wait();
+  }
+  tasks_.clear();
+
+  for (size_t i = 0; i < timings_.size(); ++i) {
+    VLOG(1) << label << ": " << timings_[i].name << " took "
+            << timings_[i].elapsed_usec << " usec";
+  }
+  VLOG(1) << label << ": initialized in "
+          << static_cast<uint64>(total.GetElapsedMicroseconds())
+          << " usec with " << std::max(num_threads, 0) << " threads";
+}
+
+}  // namespace mozc
@@ -0,0 +1,86 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef MOZC_BASE_PARALLEL_INITIALIZER_H_
+#define MOZC_BASE_PARALLEL_INITIALIZER_H_
+
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/port.h"
+
+namespace mozc {
+
+// Runs independent initialization tasks and measures how long each of them
+// takes.  The tasks run concurrently on a pool of |num_threads| threads which
+// lives only during Run(), or one after another on the calling thread if
+// |num_threads| is not positive.
+//
+// Usage:
+//   ParallelInitializer initializer(4);
+//   initializer.Add("Connector", [&]() { connector.reset(...); });
+//   initializer.Add("Segmenter", [&]() { segmenter.reset(...); });
+//   initializer.Run("Engine");
+class ParallelInitializer {
+ public:
+  struct Timing {
+    string name;
+    uint64 elapsed_usec;
+  };
+
+  explicit ParallelInitializer(int num_threads);
+  ~ParallelInitializer();
+
+  // Adds a task.  The tasks must be safe to run concurrently.
+  void Add(const string &name, std::function<void()> task);
+
+  // Runs all the added tasks and waits for them.  The elapsed times are
+  // logged with |label|.  The tasks are cleared afterward.
+  void Run(const string &label);
+
+  // The elapsed times of the tasks run by the last Run(), in the order they
+  // were added.
+  const std::vector<Timing> &timings() const {
+    return timings_;
+  }
+
+ private:
+  const int num_threads_;
+  std::vector<std::pair<string, std::function<void()>>> tasks_;
+  std::vector<Timing> timings_;
+
+  DISALLOW_COPY_AND_ASSIGN(ParallelInitializer);
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_BASE_PARALLEL_INITIALIZER_H_
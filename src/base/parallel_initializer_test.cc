@@ -0,0 +1,82 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "base/parallel_initializer.h"
+
+#include <atomic>
+#include <vector>
+
+#include "base/util.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace {
+
+TEST(ParallelInitializerTest, RunSequentially) {
+  ParallelInitializer initializer(0);
+  std::vector<int> order;
+  initializer.Add("first", [&order]() { order.push_back(1); });
+  initializer.Add("second", [&order]() { order.push_back(2); });
+  initializer.Run("Test");
+
+  const std::vector<int> kExpected = {1, 2};
+  EXPECT_EQ(kExpected, order);
+  ASSERT_EQ(2, initializer.timings().size());
+  EXPECT_EQ("first", initializer.timings()[0].name);
+  EXPECT_EQ("second", initializer.timings()[1].name);
+}
+
+TEST(ParallelInitializerTest, RunInParallel) {
+  ParallelInitializer initializer(4);
+  std::vector<int> results(10, 0);
+  std::atomic<int> count(0);
+  for (int i = 0; i < 10; ++i) {
+    initializer.Add(Util::StringPrintf("task%d", i), [&results, &count, i]() {
+      results[i] = i * i;
+      ++count;
+    });
+  }
+  initializer.Run("Test");
+
+  EXPECT_EQ(10, count.load());
+  ASSERT_EQ(10, initializer.timings().size());
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(i * i, results[i]);
+    EXPECT_EQ(Util::StringPrintf("task%d", i), initializer.timings()[i].name);
+  }
+
+  // The tasks are cleared after Run().
+  initializer.Run("Test");
+  EXPECT_TRUE(initializer.timings().empty());
+  EXPECT_EQ(10, count.load());
+}
+
+}  // namespace
+}  // namespace mozc
@@ -291,9 +291,22 @@ class PasswordManagerImpl {
     return password_manager_->SetPassword(password);
   }
 
+  // The password is cached for the process lifetime, as getting it reads a
+  // file and might decrypt it with the OS, and the encrypted storages ask it
+  // on every load and save.  The password is never changed once created.
+  // The cache is keyed by the file name in case the user profile directory is
+  // changed.
   bool GetPassword(string *password) {
     scoped_lock l(&mutex_);
+    const string filename = GetFileName();
+    if (!cached_password_.empty() && cached_filename_ == filename) {
+      *password = cached_password_;
+      return true;
+    }
+
     if (password_manager_->GetPassword(password)) {
+      cached_password_ = *password;
+      cached_filename_ = filename;
       return true;
     }
 
@@ -309,21 +322,27 @@ class PasswordManagerImpl {
       return false;
     }
 
+    cached_password_ = *password;
+    cached_filename_ = filename;
     return true;
   }
 
   bool RemovePassword() {
     scoped_lock l(&mutex_);
+    cached_password_.clear();
     return password_manager_->RemovePassword();
   }
 
   void SetPasswordManagerHandler(PasswordManagerInterface *handler) {
     scoped_lock l(&mutex_);
+    cached_password_.clear();
     password_manager_ = handler;
   }
 
  public:
   PasswordManagerInterface *password_manager_;
+  string cached_password_;
+  string cached_filename_;
   Mutex mutex_;
 };
 }  // namespace
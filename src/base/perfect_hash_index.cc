@@ -0,0 +1,143 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "base/perfect_hash_index.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "base/logging.h"
+
+namespace mozc {
+namespace {
+
+// The average number of keys per bucket.  Larger values save the memory for
+// displacements at the cost of longer build time.
+const size_t kKeysPerBucket = 4;
+
+// Finalizer of SplitMix64, which spreads the displaced fingerprint to all the
+// bits.
+uint64 Mix(uint64 x) {
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+}  // namespace
+
+size_t PerfectHashIndex::GetSlotIndex(uint64 fingerprint,
+                                      uint32 displacement) const {
+  return Mix(fingerprint + displacement * 0x9e3779b97f4a7c15ULL) %
+         slots_.size();
+}
+
+void PerfectHashIndex::Clear() {
+  displacements_.clear();
+  slots_.clear();
+}
+
+bool PerfectHashIndex::BuildFromFingerprints(
+    const std::vector<uint64> &fingerprints,
+    const std::vector<Range> &ranges) {
+  DCHECK_EQ(fingerprints.size(), ranges.size());
+  Clear();
+  const size_t num_keys = fingerprints.size();
+  if (num_keys == 0) {
+    return true;
+  }
+  if (ranges.back().second > kuint32max) {
+    LOG(ERROR) << "Too many positions: " << ranges.back().second;
+    return false;
+  }
+
+  displacements_.assign((num_keys + kKeysPerBucket - 1) / kKeysPerBucket, 0);
+  slots_.resize(num_keys);
+  std::vector<std::vector<size_t>> buckets(displacements_.size());
+  for (size_t i = 0; i < num_keys; ++i) {
+    buckets[GetBucketIndex(fingerprints[i])].push_back(i);
+  }
+
+  // Larger buckets are placed first while there are many free slots.
+  std::vector<size_t> bucket_order(buckets.size());
+  for (size_t i = 0; i < bucket_order.size(); ++i) {
+    bucket_order[i] = i;
+  }
+  std::stable_sort(bucket_order.begin(), bucket_order.end(),
+                   [&buckets](size_t a, size_t b) {
+                     return buckets[a].size() > buckets[b].size();
+                   });
+
+  // A bucket with a single key finds a free slot after (#keys / #free slots)
+  // trials on average, so this limit is reached only when keys in a bucket
+  // share the same fingerprint.
+  const uint64 max_displacement = 16 * static_cast<uint64>(num_keys) + 1024;
+  std::vector<bool> used(num_keys, false);
+  std::vector<size_t> slot_indices;
+  for (const size_t bucket_index : bucket_order) {
+    const std::vector<size_t> &bucket = buckets[bucket_index];
+    if (bucket.empty()) {
+      break;
+    }
+    uint32 displacement = 0;
+    for (;; ++displacement) {
+      if (displacement >= max_displacement) {
+        LOG(ERROR) << "Failed to find a displacement for bucket "
+                   << bucket_index;
+        Clear();
+        return false;
+      }
+      slot_indices.clear();
+      bool found = true;
+      for (const size_t key : bucket) {
+        const size_t slot = GetSlotIndex(fingerprints[key], displacement);
+        if (used[slot] || std::find(slot_indices.begin(), slot_indices.end(),
+                                    slot) != slot_indices.end()) {
+          found = false;
+          break;
+        }
+        slot_indices.push_back(slot);
+      }
+      if (found) {
+        break;
+      }
+    }
+    displacements_[bucket_index] = displacement;
+    for (size_t i = 0; i < bucket.size(); ++i) {
+      const size_t key = bucket[i];
+      used[slot_indices[i]] = true;
+      Slot *slot = &slots_[slot_indices[i]];
+      slot->check = static_cast<uint32>(fingerprints[key] >> 32);
+      slot->begin = static_cast<uint32>(ranges[key].first);
+      slot->end = static_cast<uint32>(ranges[key].second);
+    }
+  }
+  return true;
+}
+
+}  // namespace mozc
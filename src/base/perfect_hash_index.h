@@ -0,0 +1,134 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MOZC_BASE_PERFECT_HASH_INDEX_H_
+#define MOZC_BASE_PERFECT_HASH_INDEX_H_
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "base/hash.h"
+#include "base/port.h"
+#include "base/string_piece.h"
+
+namespace mozc {
+
+// Constant time exact match index over a sorted sequence of string keys, such
+// as the keys of SerializedDictionary or the elements of SerializedStringArray.
+// The index maps each distinct key to the range [begin, end) of the positions
+// where it appears, replacing std::equal_range and its O(log n) string
+// comparisons by one fingerprint and a single string comparison.
+//
+// The index is a minimal perfect hash built by hash and displace: keys are
+// distributed to buckets by their fingerprint, and for each bucket, a
+// displacement is searched so that its keys fall into distinct free slots.  A
+// lookup computes the slot from the bucket's displacement and checks the
+// fingerprint and the key stored at the slot, so keys not in the sequence are
+// rejected as well.  The memory used is about 13 bytes per distinct key.
+//
+// Usage:
+//   PerfectHashIndex index;
+//   index.Build(array.size(), [&array](size_t i) { return array[i]; });
+//   const auto range = index.Find(key, [&array](size_t i) { return array[i]; });
+//   for (size_t i = range.first; i < range.second; ++i) { ... }
+class PerfectHashIndex {
+ public:
+  using Range = std::pair<size_t, size_t>;
+
+  PerfectHashIndex() = default;
+
+  // Builds the index over the keys |key_at(0)|, ..., |key_at(size - 1)|, where
+  // equal keys must be adjacent (e.g., sorted).  Returns false if the index
+  // cannot be built; then the index is empty and Find() returns empty ranges.
+  template <typename KeyAt>
+  bool Build(size_t size, KeyAt key_at) {
+    std::vector<uint64> fingerprints;
+    std::vector<Range> ranges;
+    for (size_t i = 0; i < size; ++i) {
+      if (i > 0 && key_at(i) == key_at(i - 1)) {
+        ranges.back().second = i + 1;
+        continue;
+      }
+      fingerprints.push_back(Hash::Fingerprint(key_at(i)));
+      ranges.emplace_back(i, i + 1);
+    }
+    return BuildFromFingerprints(fingerprints, ranges);
+  }
+
+  // Returns the range of positions whose key is |key|, or an empty range if
+  // |key| is not in the index.  |key_at| must be the same as the one passed to
+  // Build().
+  template <typename KeyAt>
+  Range Find(StringPiece key, KeyAt key_at) const {
+    if (slots_.empty()) {
+      return Range(0, 0);
+    }
+    const uint64 fingerprint = Hash::Fingerprint(key);
+    const Slot &slot = slots_[GetSlotIndex(fingerprint)];
+    if (slot.check != static_cast<uint32>(fingerprint >> 32) ||
+        key_at(slot.begin) != key) {
+      return Range(0, 0);
+    }
+    return Range(slot.begin, slot.end);
+  }
+
+  // Returns true if Build() has succeeded for a non-empty sequence.
+  bool IsBuilt() const { return !slots_.empty(); }
+
+  void Clear();
+
+ private:
+  struct Slot {
+    uint32 check;  // The upper 32 bits of the key's fingerprint.
+    uint32 begin;
+    uint32 end;
+  };
+
+  bool BuildFromFingerprints(const std::vector<uint64> &fingerprints,
+                             const std::vector<Range> &ranges);
+
+  size_t GetBucketIndex(uint64 fingerprint) const {
+    return static_cast<uint32>(fingerprint) % displacements_.size();
+  }
+
+  size_t GetSlotIndex(uint64 fingerprint) const {
+    return GetSlotIndex(fingerprint,
+                        displacements_[GetBucketIndex(fingerprint)]);
+  }
+
+  size_t GetSlotIndex(uint64 fingerprint, uint32 displacement) const;
+
+  std::vector<uint32> displacements_;
+  std::vector<Slot> slots_;
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_BASE_PERFECT_HASH_INDEX_H_
@@ -0,0 +1,107 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "base/perfect_hash_index.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "base/port.h"
+#include "base/string_piece.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace {
+
+class KeyAt {
+ public:
+  explicit KeyAt(const std::vector<string> &keys) : keys_(keys) {}
+  StringPiece operator()(size_t i) const { return keys_[i]; }
+
+ private:
+  const std::vector<string> &keys_;
+};
+
+TEST(PerfectHashIndexTest, Empty) {
+  const std::vector<string> keys;
+  PerfectHashIndex index;
+  EXPECT_TRUE(index.Build(keys.size(), KeyAt(keys)));
+  EXPECT_FALSE(index.IsBuilt());
+  const PerfectHashIndex::Range range = index.Find("a", KeyAt(keys));
+  EXPECT_EQ(range.first, range.second);
+}
+
+TEST(PerfectHashIndexTest, FindRangesOfDuplicateKeys) {
+  const std::vector<string> keys = {"", "a", "a", "ab", "b", "b", "b", "c"};
+  PerfectHashIndex index;
+  ASSERT_TRUE(index.Build(keys.size(), KeyAt(keys)));
+  EXPECT_TRUE(index.IsBuilt());
+
+  EXPECT_EQ(PerfectHashIndex::Range(0, 1), index.Find("", KeyAt(keys)));
+  EXPECT_EQ(PerfectHashIndex::Range(1, 3), index.Find("a", KeyAt(keys)));
+  EXPECT_EQ(PerfectHashIndex::Range(3, 4), index.Find("ab", KeyAt(keys)));
+  EXPECT_EQ(PerfectHashIndex::Range(4, 7), index.Find("b", KeyAt(keys)));
+  EXPECT_EQ(PerfectHashIndex::Range(7, 8), index.Find("c", KeyAt(keys)));
+
+  for (const char *key : {"aa", "abc", "d", "bb", "\xe3\x81\x82"}) {
+    const PerfectHashIndex::Range range = index.Find(key, KeyAt(keys));
+    EXPECT_EQ(range.first, range.second) << key;
+  }
+
+  index.Clear();
+  EXPECT_FALSE(index.IsBuilt());
+  const PerfectHashIndex::Range range = index.Find("a", KeyAt(keys));
+  EXPECT_EQ(range.first, range.second);
+}
+
+TEST(PerfectHashIndexTest, AgreesWithEqualRange) {
+  std::vector<string> keys;
+  for (int i = 0; i < 20000; ++i) {
+    keys.push_back(std::to_string(i * 7 % 5003));
+  }
+  std::sort(keys.begin(), keys.end());
+
+  PerfectHashIndex index;
+  ASSERT_TRUE(index.Build(keys.size(), KeyAt(keys)));
+  for (int i = 0; i < 6000; ++i) {
+    const string key = std::to_string(i);
+    const auto expected = std::equal_range(keys.begin(), keys.end(), key);
+    const PerfectHashIndex::Range actual = index.Find(key, KeyAt(keys));
+    if (expected.first == expected.second) {
+      EXPECT_EQ(actual.first, actual.second) << key;
+    } else {
+      EXPECT_EQ(expected.first - keys.begin(), actual.first) << key;
+      EXPECT_EQ(expected.second - keys.begin(), actual.second) << key;
+    }
+  }
+}
+
+}  // namespace
+}  // namespace mozc
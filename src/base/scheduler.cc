@@ -29,23 +29,39 @@
 
 #include "base/scheduler.h"
 
+#include <atomic>
 #include <cstdlib>
 #include <functional>
 #include <map>
 #include <utility>
 
 #include "base/clock.h"
+#include "base/flags.h"
 #include "base/logging.h"
 #include "base/mutex.h"
 #include "base/port.h"
 #include "base/singleton.h"
 #include "base/thread.h"
+#include "base/timer_wheel_scheduler.h"
 #include "base/unnamed_event.h"
 #include "base/util.h"
 
+DEFINE_bool(use_timer_wheel_scheduler, false,
+            "Runs all the scheduled jobs on a single thread with a timer "
+            "wheel instead of a thread per job.");
+
 namespace mozc {
 namespace {
 
+std::atomic<uint64> g_last_user_activity_time(0);
+
+uint64 GetTimeInMsec() {
+  uint64 sec = 0;
+  uint32 usec = 0;
+  Clock::GetTimeOfDay(&sec, &usec);
+  return sec * 1000 + usec / 1000;
+}
+
 class TimerThread final : public Thread {
  public:
   TimerThread(std::function<void()> callback,
@@ -267,6 +283,10 @@ class SchedulerImpl : public Scheduler::SchedulerInterface {
     if (job->running()) {
       return;
     }
+    if (Scheduler::ShouldWaitForIdle(job->setting(), GetTimeInMsec())) {
+      VLOG(3) << "Waiting for idle: " << job->setting().name();
+      return;
+    }
     if (job->skip_count()) {
       job->set_skip_count(job->skip_count() - 1);
       VLOG(3) << "Backoff = " << job->backoff_count()
@@ -310,6 +330,8 @@ Scheduler::SchedulerInterface *g_scheduler_handler = NULL;
 Scheduler::SchedulerInterface *GetSchedulerHandler() {
   if (g_scheduler_handler != NULL) {
     return g_scheduler_handler;
+  } else if (FLAGS_use_timer_wheel_scheduler) {
+    return Singleton<TimerWheelScheduler>::get();
   } else {
     return Singleton<SchedulerImpl>::get();
   }
@@ -332,6 +354,22 @@ bool Scheduler::HasJob(const string &name) {
   return GetSchedulerHandler()->HasJob(name);
 }
 
+void Scheduler::NotifyUserActivity() {
+  g_last_user_activity_time.store(GetTimeInMsec(), std::memory_order_relaxed);
+}
+
+uint64 Scheduler::GetLastUserActivityTime() {
+  return g_last_user_activity_time.load(std::memory_order_relaxed);
+}
+
+bool Scheduler::ShouldWaitForIdle(const JobSetting &job_setting, uint64 now) {
+  if (job_setting.idle_period() == 0) {
+    return false;
+  }
+  const uint64 last_activity = GetLastUserActivityTime();
+  return last_activity != 0 && now < last_activity + job_setting.idle_period();
+}
+
 void Scheduler::SetSchedulerHandler(SchedulerInterface *handler) {
   g_scheduler_handler = handler;
 }
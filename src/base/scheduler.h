@@ -34,6 +34,8 @@
 //    - Interval will be doubled as long as callback returns false, but
 //      will not exceed max_interval.
 //  2. Randomised delayed start to reduce server traffic peak.
+//  3. Idle-only jobs, which are postponed while the user is active.  See
+//     JobSetting::set_idle_period() and NotifyUserActivity().
 //
 // usage:
 // // start scheduled job
@@ -73,10 +75,16 @@ class Scheduler {
         delay_start_(delay_start),
         random_delay_(random_delay),
         callback_(callback),
-        data_(data) {}
+        data_(data),
+        idle_period_(0) {}
 
     ~JobSetting() {}
 
+    // Runs the job only when NotifyUserActivity() has not been called for
+    // |idle_period| msec.  0, the default, runs it regardless of the user
+    // activity.
+    void set_idle_period(uint32 idle_period) { idle_period_ = idle_period; }
+
     string name() const { return name_; }
     uint32 default_interval() const { return default_interval_; }
     uint32 max_interval() const { return max_interval_; }
@@ -84,6 +92,7 @@ class Scheduler {
     uint32 random_delay() const { return random_delay_; }
     CallbackFunc callback() const { return callback_; }
     void *data() const { return data_; }
+    uint32 idle_period() const { return idle_period_; }
 
    private:
     string name_;
@@ -93,6 +102,7 @@ class Scheduler {
     uint32 random_delay_;
     CallbackFunc callback_;
     void *data_;
+    uint32 idle_period_;
   };
 
   // start scheduled job
@@ -109,6 +119,19 @@ class Scheduler {
   // returns true is the job has been registered.
   static bool HasJob(const string &name);
 
+  // Records that the user is active now, e.g. typing, so that the idle-only
+  // jobs are postponed.  This method is cheap enough to call on every key
+  // event.
+  static void NotifyUserActivity();
+
+  // Returns the time of the last NotifyUserActivity() in msec since the
+  // epoch, or 0 if it has never been called.
+  static uint64 GetLastUserActivityTime();
+
+  // Returns true if |job_setting| should be postponed at |now| in msec
+  // since the epoch, as the user was active within its idle period.
+  static bool ShouldWaitForIdle(const JobSetting &job_setting, uint64 now);
+
   // This function is provided for test.
   // The behavior of scheduler can be customized by replacing an underlying
   // helper class inside this.
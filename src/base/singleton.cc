@@ -32,9 +32,13 @@
 #ifdef OS_WIN
 #include <Windows.h>
 #else
+#include <sys/time.h>
 #include <cstdlib>
 #endif  // OS_WIN
 
+#include <algorithm>
+#include <atomic>
+
 #include "base/mutex.h"
 
 namespace mozc {
@@ -45,6 +49,12 @@ size_t g_finalizers_size = 0;
 
 SingletonFinalizer::FinalizerFunc g_finalizers[kMaxFinalizersSize];
 
+// Singletons can be constructed concurrently, so a slot is reserved by
+// |g_stats_reserved| and published by |g_stats_size| once it is written.
+std::atomic<size_t> g_stats_reserved(0);
+std::atomic<size_t> g_stats_size(0);
+SingletonStats::Entry g_stats[SingletonStats::kMaxEntries];
+
 // We can't use CHECK logic for Singleton because CHECK (and LOG)
 // obtains the singleton LogStream by calling Singleton::get().  If
 // something goes wrong during Singleton::get of the LogStream, it
@@ -86,4 +96,44 @@ void SingletonFinalizer::Finalize() {
   }
   g_finalizers_size = 0;
 }
+
+const size_t SingletonStats::kMaxEntries;
+
+// Base libraries like Clock cannot be used since they depend on Singleton.
+uint64 SingletonStats::GetCurrentTimeUsec() {
+#ifdef OS_WIN
+  LARGE_INTEGER frequency, counter;
+  if (!::QueryPerformanceFrequency(&frequency) ||
+      !::QueryPerformanceCounter(&counter) || frequency.QuadPart == 0) {
+    return 0;
+  }
+  const uint64 ticks = static_cast<uint64>(counter.QuadPart);
+  const uint64 ticks_per_sec = static_cast<uint64>(frequency.QuadPart);
+  return ticks / ticks_per_sec * 1000000 +
+         ticks % ticks_per_sec * 1000000 / ticks_per_sec;
+#else  // OS_WIN
+  struct timeval tv;
+  gettimeofday(&tv, nullptr);
+  return static_cast<uint64>(tv.tv_sec) * 1000000 + tv.tv_usec;
+#endif  // OS_WIN
+}
+
+void SingletonStats::Record(const char *name, uint64 construction_usec) {
+  const size_t index = g_stats_reserved.fetch_add(1);
+  if (index >= kMaxEntries) {
+    return;
+  }
+  g_stats[index].name = name;
+  g_stats[index].construction_usec = construction_usec;
+  // Entries are published in order; wait for the preceding writers.
+  size_t expected = index;
+  while (!g_stats_size.compare_exchange_weak(expected, index + 1)) {
+    expected = index;
+  }
+}
+
+std::vector<SingletonStats::Entry> SingletonStats::GetEntries() {
+  const size_t size = std::min(g_stats_size.load(), kMaxEntries);
+  return std::vector<Entry>(g_stats, g_stats + size);
+}
 }  // namespace mozc
@@ -30,7 +30,10 @@
 #ifndef MOZC_BASE_SINGLETON_H_
 #define MOZC_BASE_SINGLETON_H_
 
+#include <vector>
+
 #include "base/mutex.h"
+#include "base/port.h"
 
 namespace mozc {
 
@@ -51,6 +54,38 @@ class SingletonFinalizer {
   static void Finalize();
 };
 
+// Times the construction of singletons so that the ones slowing down the
+// startup of a process can be listed.  Singleton<T> records every
+// construction, which costs two clock reads per type.
+class SingletonStats {
+ public:
+  struct Entry {
+    // The signature of Singleton<T>::Init() given by the compiler, which
+    // contains the name of T.
+    const char *name;
+    // The time the constructor took in microseconds, including the
+    // singletons constructed inside it.
+    uint64 construction_usec;
+  };
+
+  // Only the first kMaxEntries constructions are kept.
+  static const size_t kMaxEntries = 256;
+
+  // Do not call these methods directly.
+  // use Singleton<Typename> instead.
+  static uint64 GetCurrentTimeUsec();
+  static void Record(const char *name, uint64 construction_usec);
+
+  // Returns the recorded entries in the order the constructions finished.
+  static std::vector<Entry> GetEntries();
+};
+
+#ifdef _MSC_VER
+#define MOZC_SINGLETON_INIT_NAME __FUNCSIG__
+#else  // _MSC_VER
+#define MOZC_SINGLETON_INIT_NAME __PRETTY_FUNCTION__
+#endif  // _MSC_VER
+
 // Thread-safe Singleton class.
 // Usage:
 //
@@ -68,7 +103,10 @@ class Singleton {
  private:
   static void Init() {
     SingletonFinalizer::AddFinalizer(&Singleton<T>::Delete);
+    const uint64 begin_usec = SingletonStats::GetCurrentTimeUsec();
     instance_ = new T;
+    SingletonStats::Record(MOZC_SINGLETON_INIT_NAME,
+                           SingletonStats::GetCurrentTimeUsec() - begin_usec);
   }
 
   static void Delete() {
@@ -28,6 +28,10 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
 #include "base/singleton.h"
 #include "base/thread.h"
 #include "base/util.h"
@@ -55,6 +59,13 @@ class ThreadInstance {
   }
 };
 
+class SlowInstance {
+ public:
+  SlowInstance() {
+    Util::Sleep(10);
+  }
+};
+
 class ThreadTest : public Thread {
  public:
   void Run() {
@@ -84,6 +95,23 @@ TEST(SingletonTest, BasicTest) {
   EXPECT_EQ(1, g_counter);
 }
 
+TEST(SingletonTest, StatsTest) {
+  Singleton<SlowInstance>::get();
+  Singleton<SlowInstance>::get();
+
+  const std::vector<SingletonStats::Entry> entries =
+      SingletonStats::GetEntries();
+  int count = 0;
+  for (size_t i = 0; i < entries.size(); ++i) {
+    if (strstr(entries[i].name, "SlowInstance") != NULL) {
+      ++count;
+      EXPECT_LE(10000, entries[i].construction_usec);
+    }
+  }
+  // Constructed only once.
+  EXPECT_EQ(1, count);
+}
+
 TEST(SingletonTest, ThreadTest) {
   // call Singelton::get() at the same time from
   // different threds. Make sure that get() returns
@@ -0,0 +1,126 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MOZC_BASE_SPSC_QUEUE_H_
+#define MOZC_BASE_SPSC_QUEUE_H_
+
+#include <atomic>
+#include <memory>
+#include <utility>
+
+#include "base/logging.h"
+#include "base/port.h"
+
+namespace mozc {
+
+// Bounded lock-free queue for exactly one producer thread and one consumer
+// thread.  Push() never blocks nor allocates, so it is safe to call on a
+// latency sensitive thread; it fails instead when the queue is full.
+//
+// Usage:
+//   SpscQueue<int> queue(1024);
+//   // Producer thread.
+//   if (!queue.Push(1)) { /* dropped */ }
+//   // Consumer thread.
+//   int value;
+//   while (queue.Pop(&value)) { Process(value); }
+template <typename T>
+class SpscQueue {
+ public:
+  // |capacity| is rounded up to a power of two.
+  explicit SpscQueue(size_t capacity)
+      : mask_(RoundUpToPowerOfTwo(capacity) - 1),
+        slots_(new T[mask_ + 1]),
+        head_(0),
+        tail_(0) {
+    DCHECK_GT(capacity, 0);
+  }
+
+  // Moves |value| to the end of the queue.  Returns false without touching
+  // |value| if the queue is full.  Must be called only by the producer.
+  bool Push(T &&value) {
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) > mask_) {
+      return false;
+    }
+    slots_[tail & mask_] = std::move(value);
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Moves the first element to |value|.  Returns false if the queue is
+  // empty.  Must be called only by the consumer.
+  bool Pop(T *value) {
+    DCHECK(value);
+    const size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    *value = std::move(slots_[head & mask_]);
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Returns the number of the queued elements.  The result may be stale when
+  // the other side is running concurrently.
+  size_t size() const {
+    return tail_.load(std::memory_order_acquire) -
+           head_.load(std::memory_order_acquire);
+  }
+
+  bool empty() const {
+    return size() == 0;
+  }
+
+  size_t capacity() const {
+    return mask_ + 1;
+  }
+
+ private:
+  static size_t RoundUpToPowerOfTwo(size_t n) {
+    size_t result = 1;
+    while (result < n) {
+      result <<= 1;
+    }
+    return result;
+  }
+
+  const size_t mask_;
+  std::unique_ptr<T[]> slots_;
+  // Index of the next element to pop.  Written only by the consumer.
+  std::atomic<size_t> head_;
+  // Index of the next slot to push to.  Written only by the producer.
+  std::atomic<size_t> tail_;
+
+  DISALLOW_COPY_AND_ASSIGN(SpscQueue);
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_BASE_SPSC_QUEUE_H_
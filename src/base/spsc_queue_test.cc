@@ -0,0 +1,114 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "base/spsc_queue.h"
+
+#include <memory>
+
+#include "base/thread.h"
+#include "base/util.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace {
+
+TEST(SpscQueueTest, PushAndPop) {
+  SpscQueue<int> queue(3);
+  EXPECT_EQ(4, queue.capacity());
+  EXPECT_TRUE(queue.empty());
+
+  int value = 0;
+  EXPECT_FALSE(queue.Pop(&value));
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_TRUE(queue.Push(int(i)));
+  }
+  EXPECT_FALSE(queue.Push(4));
+  EXPECT_EQ(4, queue.size());
+
+  EXPECT_TRUE(queue.Pop(&value));
+  EXPECT_EQ(0, value);
+  EXPECT_TRUE(queue.Push(4));
+  for (int i = 1; i <= 4; ++i) {
+    EXPECT_TRUE(queue.Pop(&value));
+    EXPECT_EQ(i, value);
+  }
+  EXPECT_FALSE(queue.Pop(&value));
+  EXPECT_TRUE(queue.empty());
+}
+
+TEST(SpscQueueTest, MoveOnly) {
+  SpscQueue<std::unique_ptr<int>> queue(2);
+  std::unique_ptr<int> value(new int(1));
+  EXPECT_TRUE(queue.Push(std::move(value)));
+  EXPECT_TRUE(queue.Pop(&value));
+  ASSERT_NE(nullptr, value.get());
+  EXPECT_EQ(1, *value);
+}
+
+const int kNumValues = 10000;
+
+class ProducerThread : public Thread {
+ public:
+  explicit ProducerThread(SpscQueue<int> *queue) : queue_(queue) {}
+
+  void Run() override {
+    for (int i = 0; i < kNumValues;) {
+      if (queue_->Push(int(i))) {
+        ++i;
+      } else {
+        Util::Sleep(0);
+      }
+    }
+  }
+
+ private:
+  SpscQueue<int> *queue_;
+};
+
+TEST(SpscQueueTest, ProducerAndConsumer) {
+  SpscQueue<int> queue(16);
+  ProducerThread producer(&queue);
+  producer.Start("SpscQueueProducer");
+
+  int expected = 0;
+  while (expected < kNumValues) {
+    int value = -1;
+    if (queue.Pop(&value)) {
+      ASSERT_EQ(expected, value);
+      ++expected;
+    } else {
+      Util::Sleep(0);
+    }
+  }
+  producer.Join();
+  EXPECT_TRUE(queue.empty());
+}
+
+}  // namespace
+}  // namespace mozc
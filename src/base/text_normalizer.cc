@@ -68,6 +68,10 @@ inline char32 NormalizeCharForWindows(char32 c) {
 
 void TextNormalizer::NormalizeText(StringPiece input, string *output) {
 #ifdef OS_WIN
+  if (!IsNormalizationNeeded(input)) {
+    output->assign(input.data(), input.size());
+    return;
+  }
   output->clear();
   for (ConstChar32Iterator iter(input); !iter.Done(); iter.Next()) {
     Util::UCS4ToUTF8Append(NormalizeCharForWindows(iter.Get()), output);
@@ -77,4 +81,28 @@ void TextNormalizer::NormalizeText(StringPiece input, string *output) {
 #endif
 }
 
+bool TextNormalizer::IsNormalizationNeeded(StringPiece input) {
+#ifdef OS_WIN
+  // Both of the characters normalized by NormalizeCharForWindows() are
+  // encoded in three bytes: U+301C is E3 80 9C and U+2212 is E2 88 92.
+  // ASCII and most of kana and kanji are rejected by the first byte.
+  const unsigned char *data =
+      reinterpret_cast<const unsigned char *>(input.data());
+  for (size_t i = 0; i + 2 < input.size(); ++i) {
+    if (data[i] == 0xE3) {
+      if (data[i + 1] == 0x80 && data[i + 2] == 0x9C) {
+        return true;
+      }
+    } else if (data[i] == 0xE2) {
+      if (data[i + 1] == 0x88 && data[i + 2] == 0x92) {
+        return true;
+      }
+    }
+  }
+  return false;
+#else
+  return false;
+#endif
+}
+
 }  // namespace mozc
@@ -43,6 +43,11 @@ class TextNormalizer {
  public:
   static void NormalizeText(StringPiece input, string *output);
 
+  // Returns true if NormalizeText() would change |input|.  This only scans
+  // the bytes of |input|, so callers can skip building a normalized copy of
+  // text which is already normalized.
+  static bool IsNormalizationNeeded(StringPiece input);
+
  private:
   DISALLOW_IMPLICIT_CONSTRUCTORS(TextNormalizer);
 };
@@ -66,4 +66,26 @@ TEST(TextNormalizerTest, NormalizeText) {
   EXPECT_EQ("¥298", output);
 }
 
+TEST(TextNormalizerTest, IsNormalizationNeeded) {
+  const char *kInputs[] = {
+    "", "abc", "めかぶ", "ゔぁいおりん", "ぐ〜ぐる", "１−２−３", "¥298",
+    "〜", "−", "ぐ〜", "‐", "〝",
+  };
+  for (const char *input : kInputs) {
+    string output;
+    TextNormalizer::NormalizeText(input, &output);
+    EXPECT_EQ(output != input, TextNormalizer::IsNormalizationNeeded(input))
+        << input;
+  }
+
+#ifdef OS_WIN
+  EXPECT_TRUE(TextNormalizer::IsNormalizationNeeded("ぐ〜ぐる"));
+  EXPECT_TRUE(TextNormalizer::IsNormalizationNeeded("１−２−３"));
+#else
+  EXPECT_FALSE(TextNormalizer::IsNormalizationNeeded("ぐ〜ぐる"));
+  EXPECT_FALSE(TextNormalizer::IsNormalizationNeeded("１−２−３"));
+#endif
+  EXPECT_FALSE(TextNormalizer::IsNormalizationNeeded("めかぶ"));
+}
+
 }  // namespace mozc
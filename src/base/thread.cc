@@ -36,6 +36,16 @@
 #include <pthread.h>
 #endif  // OS_WIN
 
+#if defined(OS_LINUX) && !defined(OS_NACL)
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif  // OS_LINUX && !OS_NACL
+
+#ifdef OS_MACOSX
+#include <pthread/qos.h>
+#endif  // OS_MACOSX
+
 #include <atomic>
 #include <memory>
 
@@ -270,4 +280,22 @@ void Thread::SetJoinable(bool joinable) {
   state_->joinable = joinable;
 }
 
+// static
+bool Thread::LowerCurrentThreadPriority() {
+#if defined(OS_WIN)
+  // Lowers the I/O and memory priorities as well as the CPU priority.
+  return ::SetThreadPriority(::GetCurrentThread(),
+                             THREAD_MODE_BACKGROUND_BEGIN) != FALSE;
+#elif defined(OS_MACOSX)
+  return pthread_set_qos_class_self_np(QOS_CLASS_BACKGROUND, 0) == 0;
+#elif defined(OS_LINUX) && !defined(OS_NACL)
+  // On Linux, the nice value is per thread when the thread ID is given.
+  const int kBackgroundNiceValue = 19;
+  const id_t tid = static_cast<id_t>(::syscall(SYS_gettid));
+  return ::setpriority(PRIO_PROCESS, tid, kBackgroundNiceValue) == 0;
+#else
+  return false;
+#endif
+}
+
 }  // namespace mozc
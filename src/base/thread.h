@@ -53,6 +53,13 @@ class Thread {
   // This method is not encouraged especiialy in Windows.
   void Terminate();
 
+  // Lowers the scheduling priority of the calling thread to the background
+  // level so that it does not compete with interactive work. Other threads
+  // are not affected, but threads created by the calling thread may inherit
+  // the priority depending on the platform. This cannot be undone. Returns
+  // false if not supported or failed.
+  static bool LowerCurrentThreadPriority();
+
  private:
   void Detach();
 
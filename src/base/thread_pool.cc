@@ -0,0 +1,287 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "base/thread_pool.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "base/cpu_stats.h"
+#include "base/flags.h"
+#include "base/logging.h"
+#include "base/thread.h"
+
+DEFINE_int32(shared_thread_pool_size, 0,
+             "Number of the threads of ThreadPool::GetSharedPool(), or 0 "
+             "for the number of the processors.");
+
+namespace mozc {
+namespace {
+
+// The pool and the index of the worker running on the current thread.
+thread_local ThreadPool *g_current_pool = nullptr;
+thread_local size_t g_current_worker_index = 0;
+
+}  // namespace
+
+class ThreadPool::Worker : public Thread {
+ public:
+  Worker(ThreadPool *pool, size_t index) : pool_(pool), index_(index) {}
+
+  void Run() override {
+    g_current_pool = pool_;
+    g_current_worker_index = index_;
+    std::function<void()> task;
+    while (pool_->PopTask(this, &task)) {
+      task();
+      task = nullptr;
+    }
+  }
+
+  void PushLocalTask(std::function<void()> task) {
+    scoped_lock l(&mutex_);
+    local_tasks_.push_back(std::move(task));
+  }
+
+  // Pops the newest task.  Called only by this worker.
+  bool PopLocalTask(std::function<void()> *task) {
+    scoped_lock l(&mutex_);
+    if (local_tasks_.empty()) {
+      return false;
+    }
+    *task = std::move(local_tasks_.back());
+    local_tasks_.pop_back();
+    return true;
+  }
+
+  // Pops the oldest task.  Called by the other workers.
+  bool StealTask(std::function<void()> *task) {
+    scoped_lock l(&mutex_);
+    if (local_tasks_.empty()) {
+      return false;
+    }
+    *task = std::move(local_tasks_.front());
+    local_tasks_.pop_front();
+    return true;
+  }
+
+  size_t index() const {
+    return index_;
+  }
+
+  // Wakes up the worker waiting in PopTask().
+  void Notify() {
+    event_.Notify();
+  }
+
+  void Wait() {
+    event_.Wait(-1);
+  }
+
+ private:
+  ThreadPool *pool_;
+  const size_t index_;
+  Mutex mutex_;
+  std::deque<std::function<void()>> local_tasks_;
+  UnnamedEvent event_;
+
+  DISALLOW_COPY_AND_ASSIGN(Worker);
+};
+
+ThreadPool::ThreadPool(int num_threads)
+    : num_pending_tasks_(0), stopping_(false) {
+  CHECK_GT(num_threads, 0);
+  for (int i = 0; i < num_threads; ++i) {
+    workers_.emplace_back(new Worker(this, i));
+  }
+  for (size_t i = 0; i < workers_.size(); ++i) {
+    workers_[i]->SetJoinable(true);
+    workers_[i]->Start("ThreadPool");
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    scoped_lock l(&mutex_);
+    stopping_ = true;
+    for (size_t i = 0; i < idle_workers_.size(); ++i) {
+      idle_workers_[i]->Notify();
+    }
+    idle_workers_.clear();
+  }
+  for (size_t i = 0; i < workers_.size(); ++i) {
+    workers_[i]->Join();
+  }
+}
+
+// static
+ThreadPool *ThreadPool::GetSharedPool() {
+  static ThreadPool *pool = new ThreadPool(
+      FLAGS_shared_thread_pool_size > 0
+          ? FLAGS_shared_thread_pool_size
+          : std::max<int>(1, CPUStats().GetNumberOfProcessors()));
+  return pool;
+}
+
+void ThreadPool::Schedule(Priority priority, std::function<void()> task) {
+  DCHECK_GE(priority, 0);
+  DCHECK_LT(priority, NUM_PRIORITIES);
+  ++num_pending_tasks_;
+  if (priority == NORMAL && g_current_pool == this) {
+    workers_[g_current_worker_index]->PushLocalTask(std::move(task));
+    scoped_lock l(&mutex_);
+    NotifyIdleWorker();
+    return;
+  }
+  scoped_lock l(&mutex_);
+  DCHECK(!stopping_);
+  tasks_[priority].push_back(std::move(task));
+  NotifyIdleWorker();
+}
+
+void ThreadPool::Schedule(Priority priority,
+                          std::shared_ptr<const CancellationToken> token,
+                          std::function<void()> task) {
+  Schedule(priority, [token, task]() {
+    if (!token->IsCanceled()) {
+      task();
+    }
+  });
+}
+
+void ThreadPool::NotifyIdleWorker() {
+  if (!idle_workers_.empty()) {
+    idle_workers_.back()->Notify();
+    idle_workers_.pop_back();
+  }
+}
+
+bool ThreadPool::PopSharedTask(Priority priority,
+                               std::function<void()> *task) {
+  scoped_lock l(&mutex_);
+  std::deque<std::function<void()>> *tasks = &tasks_[priority];
+  if (tasks->empty()) {
+    return false;
+  }
+  *task = std::move(tasks->front());
+  tasks->pop_front();
+  return true;
+}
+
+bool ThreadPool::TryPopTask(Worker *worker, std::function<void()> *task) {
+  if (PopSharedTask(HIGH, task) || worker->PopLocalTask(task) ||
+      PopSharedTask(NORMAL, task)) {
+    return true;
+  }
+  // Starts from the next worker so that the victims are spread.
+  for (size_t i = 1; i < workers_.size(); ++i) {
+    const size_t victim = (worker->index() + i) % workers_.size();
+    if (workers_[victim]->StealTask(task)) {
+      return true;
+    }
+  }
+  return PopSharedTask(LOW, task);
+}
+
+bool ThreadPool::PopTask(Worker *worker, std::function<void()> *task) {
+  while (true) {
+    if (num_pending_tasks_.load() > 0 && TryPopTask(worker, task)) {
+      --num_pending_tasks_;
+      return true;
+    }
+    {
+      scoped_lock l(&mutex_);
+      // A task is being queued.  Retries rather than sleeping.
+      if (num_pending_tasks_.load() > 0) {
+        continue;
+      }
+      if (stopping_) {
+        return false;
+      }
+      // The worker is registered before the lock is released, and
+      // UnnamedEvent keeps the notification until Wait() is called, so a
+      // notification from Schedule() is never lost.
+      idle_workers_.push_back(worker);
+    }
+    worker->Wait();
+  }
+}
+
+BlockingCounter::BlockingCounter(int count) : count_(count) {}
+
+BlockingCounter::~BlockingCounter() {}
+
+void BlockingCounter::DecrementCount() {
+  scoped_lock l(&mutex_);
+  DCHECK_GT(count_, 0);
+  if (--count_ == 0) {
+    event_.Notify();
+  }
+}
+
+void BlockingCounter::Wait() {
+  {
+    scoped_lock l(&mutex_);
+    if (count_ == 0) {
+      return;
+    }
+  }
+  event_.Wait(-1);
+  // Wait for DecrementCount() to release the lock, so that the caller can
+  // destroy this object as soon as this method returns.
+  scoped_lock l(&mutex_);
+}
+
+void ParallelFor(ThreadPool *pool, size_t size,
+                 const std::function<void(size_t, size_t)> &func) {
+  if (size == 0) {
+    return;
+  }
+  if (pool == nullptr) {
+    func(0, size);
+    return;
+  }
+  // A few ranges per thread balance the load when the costs of the items
+  // are uneven.
+  const size_t num_ranges =
+      std::min(size, static_cast<size_t>(pool->num_threads()) * 4);
+  BlockingCounter counter(static_cast<int>(num_ranges));
+  for (size_t i = 0; i < num_ranges; ++i) {
+    const size_t begin = size * i / num_ranges;
+    const size_t end = size * (i + 1) / num_ranges;
+    pool->Schedule([&func, &counter, begin, end]() {
+      func(begin, end);
+      counter.DecrementCount();
+    });
+  }
+  counter.Wait();
+}
+
+}  // namespace mozc
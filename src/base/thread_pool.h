@@ -0,0 +1,250 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef MOZC_BASE_THREAD_POOL_H_
+#define MOZC_BASE_THREAD_POOL_H_
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "base/mutex.h"
+#include "base/port.h"
+#include "base/unnamed_event.h"
+
+namespace mozc {
+
+template <typename T> class TaskFuture;
+
+// Cooperative cancellation of the tasks.  A task scheduled with a canceled
+// token is dropped before it starts, and a running task is expected to poll
+// IsCanceled() at the points it can stop.
+class CancellationToken {
+ public:
+  CancellationToken() : canceled_(false) {}
+
+  void Cancel() {
+    canceled_.store(true, std::memory_order_release);
+  }
+
+  bool IsCanceled() const {
+    return canceled_.load(std::memory_order_acquire);
+  }
+
+ private:
+  std::atomic<bool> canceled_;
+
+  DISALLOW_COPY_AND_ASSIGN(CancellationToken);
+};
+
+// Fixed-size pool of worker threads running scheduled tasks.
+//
+// The tasks scheduled from outside of the pool are queued per priority.  The
+// NORMAL tasks scheduled by a task running on the pool are pushed to the
+// queue of its worker instead, which the worker runs newest first while idle
+// workers steal the oldest ones, so that the nested tasks run on warm caches
+// without contending on the shared queues.
+//
+// Usage:
+//   ThreadPool pool(4);
+//   BlockingCounter counter(2);
+//   pool.Schedule([&]() { DoSomething(); counter.DecrementCount(); });
+//   pool.Schedule([&]() { DoOther(); counter.DecrementCount(); });
+//   counter.Wait();
+//
+//   std::shared_ptr<TaskFuture<int>> future = ThreadPool::GetSharedPool()
+//       ->Async<int>(ThreadPool::LOW, []() { return Compute(); });
+//   ...
+//   const int result = future->Get();
+class ThreadPool {
+ public:
+  // A worker picks a HIGH task first, then a task of its own queue, a NORMAL
+  // task, a task stolen from the other workers and a LOW task in this order.
+  enum Priority {
+    HIGH,
+    NORMAL,
+    LOW,
+    NUM_PRIORITIES,
+  };
+
+  // Starts |num_threads| worker threads.  |num_threads| must be positive.
+  explicit ThreadPool(int num_threads);
+
+  // Runs all the pending tasks and joins the worker threads.
+  ~ThreadPool();
+
+  // Returns the pool shared by the background tasks of the process, which
+  // has --shared_thread_pool_size threads, or a thread per processor if 0.
+  // The pool is never destroyed.  Blocking tasks, e.g., waiting for an
+  // another task of the pool, may starve the other users.
+  static ThreadPool *GetSharedPool();
+
+  // Schedules |task| to run on one of the worker threads.  These methods are
+  // thread-safe.
+  void Schedule(std::function<void()> task) {
+    Schedule(NORMAL, std::move(task));
+  }
+  void Schedule(Priority priority, std::function<void()> task);
+
+  // Same as Schedule() but drops |task| if |token| is canceled before
+  // |task| starts.
+  void Schedule(Priority priority,
+                std::shared_ptr<const CancellationToken> token,
+                std::function<void()> task);
+
+  // Schedules |func| and returns the future of its result.  T must be
+  // default constructible.
+  template <typename T>
+  std::shared_ptr<TaskFuture<T>> Async(Priority priority,
+                                       std::function<T()> func);
+
+  int num_threads() const {
+    return static_cast<int>(workers_.size());
+  }
+
+ private:
+  class Worker;
+
+  // Returns the next task, blocking until one is available.  Returns false
+  // when the pool is being destroyed and no task is left.
+  bool PopTask(Worker *worker, std::function<void()> *task);
+  // Returns a task without blocking.
+  bool TryPopTask(Worker *worker, std::function<void()> *task);
+  // Pops the oldest task of |priority| from |tasks_|.
+  bool PopSharedTask(Priority priority, std::function<void()> *task);
+  // Wakes up one of the idle workers, if any.
+  void NotifyIdleWorker();
+
+  Mutex mutex_;
+  // Tasks scheduled from outside of the pool, indexed by Priority.
+  std::deque<std::function<void()>> tasks_[NUM_PRIORITIES];
+  // The number of the tasks in |tasks_| and the queues of the workers.
+  // Incremented before a task is queued, so that a worker never sleeps while
+  // it is positive.
+  std::atomic<int> num_pending_tasks_;
+  // Workers waiting for a task.
+  std::vector<Worker *> idle_workers_;
+  bool stopping_;
+  std::vector<std::unique_ptr<Worker>> workers_;
+
+  DISALLOW_COPY_AND_ASSIGN(ThreadPool);
+};
+
+// The result of a task scheduled by ThreadPool::Async().
+template <typename T>
+class TaskFuture {
+ public:
+  TaskFuture() : ready_(false) {}
+
+  // Returns true if the task has finished.
+  bool IsReady() {
+    scoped_lock l(&mutex_);
+    return ready_;
+  }
+
+  // Blocks until the task finishes.  Can be called from multiple threads.
+  void Wait() {
+    {
+      scoped_lock l(&mutex_);
+      if (ready_) {
+        return;
+      }
+    }
+    event_.Wait(-1);
+    // Passes the notification to the next waiter, as the event is reset by
+    // a wake-up.
+    event_.Notify();
+  }
+
+  // Waits for the task and returns its result.  The result can be moved
+  // out.
+  T &Get() {
+    Wait();
+    return value_;
+  }
+
+ private:
+  friend class ThreadPool;
+
+  void Set(T value) {
+    {
+      scoped_lock l(&mutex_);
+      value_ = std::move(value);
+      ready_ = true;
+    }
+    event_.Notify();
+  }
+
+  Mutex mutex_;
+  bool ready_;
+  T value_;
+  UnnamedEvent event_;
+
+  DISALLOW_COPY_AND_ASSIGN(TaskFuture);
+};
+
+template <typename T>
+std::shared_ptr<TaskFuture<T>> ThreadPool::Async(Priority priority,
+                                                 std::function<T()> func) {
+  std::shared_ptr<TaskFuture<T>> future(new TaskFuture<T>);
+  Schedule(priority, [future, func]() { future->Set(func()); });
+  return future;
+}
+
+// Blocks Wait() until DecrementCount() is called the given number of times.
+class BlockingCounter {
+ public:
+  explicit BlockingCounter(int count);
+  ~BlockingCounter();
+
+  void DecrementCount();
+  void Wait();
+
+ private:
+  Mutex mutex_;
+  int count_;
+  UnnamedEvent event_;
+
+  DISALLOW_COPY_AND_ASSIGN(BlockingCounter);
+};
+
+// Splits [0, |size|) into contiguous ranges, runs |func|(begin, end) for each
+// of them on |pool| and waits for all of them to finish.  If |pool| is
+// nullptr, runs |func|(0, |size|) on the calling thread.  |func| must be
+// safe to run concurrently on disjoint ranges.
+void ParallelFor(ThreadPool *pool, size_t size,
+                 const std::function<void(size_t, size_t)> &func);
+
+}  // namespace mozc
+
+#endif  // MOZC_BASE_THREAD_POOL_H_
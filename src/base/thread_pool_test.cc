@@ -0,0 +1,204 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "base/thread_pool.h"
+
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "base/unnamed_event.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace {
+
+TEST(ThreadPoolTest, RunsAllTasks) {
+  ThreadPool pool(4);
+  EXPECT_EQ(4, pool.num_threads());
+
+  const int kNumTasks = 1000;
+  std::vector<int> results(kNumTasks, 0);
+  BlockingCounter counter(kNumTasks);
+  for (int i = 0; i < kNumTasks; ++i) {
+    pool.Schedule([i, &results, &counter]() {
+      results[i] = i * 2;
+      counter.DecrementCount();
+    });
+  }
+  counter.Wait();
+  for (int i = 0; i < kNumTasks; ++i) {
+    EXPECT_EQ(i * 2, results[i]);
+  }
+}
+
+TEST(ThreadPoolTest, DestructorRunsPendingTasks) {
+  std::atomic<int> count(0);
+  {
+    ThreadPool pool(2);
+    for (int i = 0; i < 100; ++i) {
+      pool.Schedule([&count]() { ++count; });
+    }
+  }
+  EXPECT_EQ(100, count.load());
+}
+
+TEST(ThreadPoolTest, ScheduleFromTask) {
+  ThreadPool pool(1);
+  BlockingCounter counter(2);
+  pool.Schedule([&pool, &counter]() {
+    pool.Schedule([&counter]() { counter.DecrementCount(); });
+    counter.DecrementCount();
+  });
+  counter.Wait();
+}
+
+TEST(ThreadPoolTest, PrefersHigherPriority) {
+  ThreadPool pool(1);
+  // Blocks the worker until all the tasks are scheduled.
+  UnnamedEvent start;
+  pool.Schedule([&start]() { start.Wait(-1); });
+  std::vector<int> order;
+  BlockingCounter counter(3);
+  pool.Schedule(ThreadPool::LOW, [&order, &counter]() {
+    order.push_back(3);
+    counter.DecrementCount();
+  });
+  pool.Schedule(ThreadPool::NORMAL, [&order, &counter]() {
+    order.push_back(2);
+    counter.DecrementCount();
+  });
+  pool.Schedule(ThreadPool::HIGH, [&order, &counter]() {
+    order.push_back(1);
+    counter.DecrementCount();
+  });
+  start.Notify();
+  counter.Wait();
+  ASSERT_EQ(3, order.size());
+  EXPECT_EQ(1, order[0]);
+  EXPECT_EQ(2, order[1]);
+  EXPECT_EQ(3, order[2]);
+}
+
+TEST(ThreadPoolTest, StealsNestedTasks) {
+  ThreadPool pool(2);
+  // The nested tasks are queued to the worker running the outer task, which
+  // waits for them, so they finish only if the other worker steals them.
+  BlockingCounter done(1);
+  pool.Schedule([&pool, &done]() {
+    BlockingCounter counter(10);
+    for (int i = 0; i < 10; ++i) {
+      pool.Schedule([&counter]() { counter.DecrementCount(); });
+    }
+    counter.Wait();
+    done.DecrementCount();
+  });
+  done.Wait();
+}
+
+TEST(ThreadPoolTest, DropsCanceledTask) {
+  ThreadPool pool(1);
+  UnnamedEvent start;
+  pool.Schedule([&start]() { start.Wait(-1); });
+  std::shared_ptr<CancellationToken> token(new CancellationToken);
+  std::atomic<int> count(0);
+  pool.Schedule(ThreadPool::NORMAL, token, [&count]() { ++count; });
+  token->Cancel();
+  EXPECT_TRUE(token->IsCanceled());
+  std::shared_ptr<CancellationToken> other(new CancellationToken);
+  BlockingCounter counter(1);
+  pool.Schedule(ThreadPool::NORMAL, other, [&count, &counter]() {
+    count += 10;
+    counter.DecrementCount();
+  });
+  start.Notify();
+  counter.Wait();
+  EXPECT_EQ(10, count.load());
+}
+
+TEST(ThreadPoolTest, Async) {
+  ThreadPool pool(2);
+  std::vector<std::shared_ptr<TaskFuture<int>>> futures;
+  for (int i = 0; i < 10; ++i) {
+    futures.push_back(
+        pool.Async<int>(ThreadPool::NORMAL, [i]() { return i * i; }));
+  }
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(i * i, futures[i]->Get());
+    EXPECT_TRUE(futures[i]->IsReady());
+  }
+}
+
+TEST(ThreadPoolTest, SharedPool) {
+  ThreadPool *pool = ThreadPool::GetSharedPool();
+  ASSERT_NE(nullptr, pool);
+  EXPECT_EQ(pool, ThreadPool::GetSharedPool());
+  EXPECT_LE(1, pool->num_threads());
+  std::shared_ptr<TaskFuture<bool>> future =
+      pool->Async<bool>(ThreadPool::LOW, []() { return true; });
+  EXPECT_TRUE(future->Get());
+}
+
+TEST(ParallelForTest, CoversEachIndexOnce) {
+  ThreadPool pool(3);
+  for (size_t size : {0, 1, 5, 1000}) {
+    std::vector<std::atomic<int>> visits(size);
+    for (auto &visit : visits) {
+      visit = 0;
+    }
+    ParallelFor(&pool, size, [&visits](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        ++visits[i];
+      }
+    });
+    for (size_t i = 0; i < size; ++i) {
+      EXPECT_EQ(1, visits[i].load()) << size << " " << i;
+    }
+  }
+}
+
+TEST(ParallelForTest, RunsOnCallingThreadWithoutPool) {
+  std::vector<std::pair<size_t, size_t>> ranges;
+  ParallelFor(nullptr, 10, [&ranges](size_t begin, size_t end) {
+    ranges.push_back(std::make_pair(begin, end));
+  });
+  ASSERT_EQ(1, ranges.size());
+  EXPECT_EQ(0, ranges[0].first);
+  EXPECT_EQ(10, ranges[0].second);
+}
+
+TEST(BlockingCounterTest, ZeroCount) {
+  BlockingCounter counter(0);
+  counter.Wait();
+}
+
+}  // namespace
+}  // namespace mozc
@@ -29,6 +29,12 @@
 
 #include "base/thread.h"
 
+#if defined(OS_LINUX) && !defined(OS_NACL)
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif  // OS_LINUX && !OS_NACL
+
 #include "base/util.h"
 #include "testing/base/public/gunit.h"
 
@@ -114,4 +120,38 @@ TEST(ThreadTest, RestartTest) {
   }
 }
 
+#if defined(OS_LINUX) && !defined(OS_NACL)
+class LowPriorityThread : public Thread {
+ public:
+  LowPriorityThread() : lowered_(false), nice_value_(0) {}
+
+  void Run() override {
+    lowered_ = Thread::LowerCurrentThreadPriority();
+    nice_value_ = ::getpriority(PRIO_PROCESS,
+                                static_cast<id_t>(::syscall(SYS_gettid)));
+  }
+
+  bool lowered() const { return lowered_; }
+  int nice_value() const { return nice_value_; }
+
+ private:
+  bool lowered_;
+  int nice_value_;
+};
+
+TEST(ThreadTest, LowerCurrentThreadPriority) {
+  const id_t main_tid = static_cast<id_t>(::syscall(SYS_gettid));
+  const int main_nice_value = ::getpriority(PRIO_PROCESS, main_tid);
+
+  LowPriorityThread t;
+  t.Start("LowerCurrentThreadPriority");
+  t.Join();
+  EXPECT_TRUE(t.lowered());
+  EXPECT_EQ(19, t.nice_value());
+
+  // The calling thread is not affected.
+  EXPECT_EQ(main_nice_value, ::getpriority(PRIO_PROCESS, main_tid));
+}
+#endif  // OS_LINUX && !OS_NACL
+
 }  // namespace mozc
@@ -0,0 +1,376 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "base/timer_wheel_scheduler.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "base/clock.h"
+#include "base/logging.h"
+#include "base/thread.h"
+#include "base/util.h"
+
+namespace mozc {
+namespace {
+
+uint64 GetTimeInMsec() {
+  uint64 sec = 0;
+  uint32 usec = 0;
+  Clock::GetTimeOfDay(&sec, &usec);
+  return sec * 1000 + usec / 1000;
+}
+
+}  // namespace
+
+struct TimerWheelScheduler::Entry {
+  Entry(const Scheduler::JobSetting &job_setting, uint64 job_id)
+      : setting(job_setting),
+        id(job_id),
+        backoff_count(0),
+        expire_tick(0),
+        level(-1),
+        slot(0) {}
+
+  const Scheduler::JobSetting setting;
+  // Distinguishes the jobs added again with the same name.
+  const uint64 id;
+  uint32 backoff_count;
+  uint64 expire_tick;
+  // Position in |wheel_|.  |level| is -1 while not in the wheel.
+  int level;
+  int slot;
+  Slot::iterator position;
+};
+
+class TimerWheelScheduler::WheelThread : public Thread {
+ public:
+  explicit WheelThread(TimerWheelScheduler *scheduler)
+      : scheduler_(scheduler) {}
+
+  void Run() override {
+    Thread::LowerCurrentThreadPriority();
+    scheduler_->RunLoop();
+  }
+
+ private:
+  TimerWheelScheduler *scheduler_;
+
+  DISALLOW_COPY_AND_ASSIGN(WheelThread);
+};
+
+const uint32 TimerWheelScheduler::kDefaultTickMsec;
+
+TimerWheelScheduler::TimerWheelScheduler()
+    : TimerWheelScheduler(kDefaultTickMsec) {}
+
+TimerWheelScheduler::TimerWheelScheduler(uint32 tick_msec)
+    : tick_msec_(tick_msec),
+      start_time_(GetTimeInMsec()),
+      stopping_(false),
+      current_tick_(0),
+      next_id_(0) {
+  DCHECK_GT(tick_msec_, 0);
+  Util::SetRandomSeed(static_cast<uint32>(Clock::GetTime()));
+}
+
+TimerWheelScheduler::~TimerWheelScheduler() {
+  {
+    scoped_lock l(&mutex_);
+    stopping_ = true;
+  }
+  if (thread_) {
+    wake_up_.Notify();
+    thread_->Join();
+  }
+  RemoveAllJobs();
+}
+
+bool TimerWheelScheduler::AddJob(const Scheduler::JobSetting &job_setting) {
+  DCHECK_GT(job_setting.name().size(), 0);
+  DCHECK_NE(0, job_setting.default_interval());
+  DCHECK_NE(0, job_setting.max_interval());
+  DCHECK(job_setting.callback() != NULL);
+
+  scoped_lock l(&mutex_);
+  if (jobs_.find(job_setting.name()) != jobs_.end()) {
+    LOG(WARNING) << "Job " << job_setting.name() << " is already registered";
+    return false;
+  }
+  Entry *entry = new Entry(job_setting, ++next_id_);
+  jobs_[job_setting.name()].reset(entry);
+
+  uint64 delay = job_setting.delay_start();
+  if (job_setting.random_delay() != 0) {
+    delay += Util::Random(job_setting.random_delay());
+  }
+  Schedule(entry, delay);
+
+  if (!thread_) {
+    thread_.reset(new WheelThread(this));
+    thread_->SetJoinable(true);
+    thread_->Start("TimerWheelScheduler");
+  }
+  // Lets the thread recalculate the next wake-up time.
+  wake_up_.Notify();
+  return true;
+}
+
+bool TimerWheelScheduler::RemoveJob(const string &name) {
+  {
+    scoped_lock l(&mutex_);
+    std::map<string, std::unique_ptr<Entry>>::iterator it = jobs_.find(name);
+    if (it == jobs_.end()) {
+      LOG(WARNING) << "Job " << name << " is not registered";
+      return false;
+    }
+    Unlink(it->second.get());
+    jobs_.erase(it);
+  }
+  // Waits for the job if it's running.  This returns immediately when called
+  // from the job itself as the mutex is recursive.
+  scoped_lock run_lock(&run_mutex_);
+  return true;
+}
+
+void TimerWheelScheduler::RemoveAllJobs() {
+  {
+    scoped_lock l(&mutex_);
+    for (int level = 0; level < kNumLevels; ++level) {
+      for (int slot = 0; slot < kNumSlots; ++slot) {
+        wheel_[level][slot].clear();
+      }
+    }
+    jobs_.clear();
+  }
+  scoped_lock run_lock(&run_mutex_);
+}
+
+bool TimerWheelScheduler::HasJob(const string &name) const {
+  scoped_lock l(&mutex_);
+  return jobs_.find(name) != jobs_.end();
+}
+
+uint64 TimerWheelScheduler::GetCurrentTick() const {
+  const uint64 now = GetTimeInMsec();
+  if (now < start_time_) {
+    return 0;
+  }
+  return (now - start_time_) / tick_msec_;
+}
+
+void TimerWheelScheduler::Insert(Entry *entry) {
+  DCHECK_EQ(-1, entry->level);
+  DCHECK_GE(entry->expire_tick, current_tick_);
+  const uint64 kMaxDelta = (1ULL << (kSlotBits * kNumLevels)) - 1;
+  if (entry->expire_tick - current_tick_ > kMaxDelta) {
+    entry->expire_tick = current_tick_ + kMaxDelta;
+  }
+  const uint64 delta = entry->expire_tick - current_tick_;
+  int level = 0;
+  while (level + 1 < kNumLevels &&
+         delta >= (1ULL << (kSlotBits * (level + 1)))) {
+    ++level;
+  }
+  // A slot of the level n is cascaded when the lower kSlotBits * n bits of
+  // |current_tick_| get zero and the next kSlotBits bits equal to the slot.
+  entry->level = level;
+  entry->slot = static_cast<int>(
+      (entry->expire_tick >> (kSlotBits * level)) & (kNumSlots - 1));
+  Slot *slot = &wheel_[level][entry->slot];
+  entry->position = slot->insert(slot->end(), entry);
+}
+
+void TimerWheelScheduler::Unlink(Entry *entry) {
+  if (entry->level < 0) {
+    return;
+  }
+  wheel_[entry->level][entry->slot].erase(entry->position);
+  entry->level = -1;
+}
+
+void TimerWheelScheduler::Schedule(Entry *entry, uint64 delay_msec) {
+  Unlink(entry);
+  // Rounds up so that the job never runs earlier than requested.
+  const uint64 delay_ticks = (delay_msec + tick_msec_ - 1) / tick_msec_;
+  // |current_tick_| may be behind the clock while the thread is sleeping.
+  entry->expire_tick =
+      std::max(GetCurrentTick() + delay_ticks, current_tick_ + 1);
+  Insert(entry);
+}
+
+void TimerWheelScheduler::Cascade(int level) {
+  const int index = static_cast<int>(
+      (current_tick_ >> (kSlotBits * level)) & (kNumSlots - 1));
+  Slot entries;
+  entries.swap(wheel_[level][index]);
+  for (Slot::iterator it = entries.begin(); it != entries.end(); ++it) {
+    (*it)->level = -1;
+    Insert(*it);
+  }
+}
+
+void TimerWheelScheduler::Advance(uint64 tick, std::vector<uint64> *due_ids) {
+  if (jobs_.empty()) {
+    current_tick_ = std::max(current_tick_, tick);
+    return;
+  }
+  while (current_tick_ < tick) {
+    ++current_tick_;
+    for (int level = 1; level < kNumLevels; ++level) {
+      if ((current_tick_ & ((1ULL << (kSlotBits * level)) - 1)) != 0) {
+        break;
+      }
+      Cascade(level);
+    }
+    Slot *slot = &wheel_[0][current_tick_ & (kNumSlots - 1)];
+    for (Slot::iterator it = slot->begin(); it != slot->end(); ++it) {
+      DCHECK_EQ(current_tick_, (*it)->expire_tick);
+      (*it)->level = -1;
+      due_ids->push_back((*it)->id);
+    }
+    slot->clear();
+  }
+}
+
+uint64 TimerWheelScheduler::GetNextWakeUpTick() const {
+  // The first non-empty slot of each level has the earliest entries of the
+  // level, as the slots after |current_tick_| are in the order of the time.
+  uint64 result = 0;
+  for (int level = 0; level < kNumLevels; ++level) {
+    const uint64 block = current_tick_ >> (kSlotBits * level);
+    for (int i = 1; i <= kNumSlots; ++i) {
+      const Slot &slot = wheel_[level][(block + i) & (kNumSlots - 1)];
+      if (slot.empty()) {
+        continue;
+      }
+      for (Slot::const_iterator it = slot.begin(); it != slot.end(); ++it) {
+        if (result == 0 || (*it)->expire_tick < result) {
+          result = (*it)->expire_tick;
+        }
+      }
+      break;
+    }
+  }
+  return result;
+}
+
+void TimerWheelScheduler::RunJob(uint64 id) {
+  // Taken before |mutex_| so that RemoveJob() can wait for the job.
+  scoped_lock run_lock(&run_mutex_);
+  Scheduler::JobSetting::CallbackFunc callback = NULL;
+  void *data = NULL;
+  {
+    scoped_lock l(&mutex_);
+    Entry *entry = NULL;
+    for (std::map<string, std::unique_ptr<Entry>>::iterator it =
+             jobs_.begin(); it != jobs_.end(); ++it) {
+      if (it->second->id == id) {
+        entry = it->second.get();
+        break;
+      }
+    }
+    if (entry == NULL) {
+      return;
+    }
+    const uint64 now = GetTimeInMsec();
+    if (Scheduler::ShouldWaitForIdle(entry->setting, now)) {
+      VLOG(3) << "Waiting for idle: " << entry->setting.name();
+      Schedule(entry, Scheduler::GetLastUserActivityTime() +
+                      entry->setting.idle_period() - now);
+      return;
+    }
+    callback = entry->setting.callback();
+    data = entry->setting.data();
+  }
+
+  VLOG(2) << "call TimerCallback()";
+  const bool success = callback(data);
+
+  scoped_lock l(&mutex_);
+  for (std::map<string, std::unique_ptr<Entry>>::iterator it = jobs_.begin();
+       it != jobs_.end(); ++it) {
+    Entry *entry = it->second.get();
+    if (entry->id != id) {
+      continue;
+    }
+    // Same backoff as the default scheduler, which skips the runs instead.
+    const uint32 interval = entry->setting.default_interval();
+    if (success) {
+      entry->backoff_count = 0;
+    } else {
+      const uint32 new_backoff_count =
+          (entry->backoff_count == 0) ? 1 : entry->backoff_count * 2;
+      if (new_backoff_count * interval < entry->setting.max_interval()) {
+        entry->backoff_count = new_backoff_count;
+      }
+      VLOG(3) << "Backoff = " << entry->backoff_count;
+    }
+    Schedule(entry, static_cast<uint64>(interval) *
+                    (entry->backoff_count + 1));
+    return;
+  }
+}
+
+void TimerWheelScheduler::RunLoop() {
+  while (true) {
+    std::vector<uint64> due_ids;
+    {
+      scoped_lock l(&mutex_);
+      if (stopping_) {
+        return;
+      }
+      Advance(GetCurrentTick(), &due_ids);
+    }
+    for (size_t i = 0; i < due_ids.size(); ++i) {
+      RunJob(due_ids[i]);
+    }
+
+    int wait_msec = -1;  // Waits for AddJob() if no job is scheduled.
+    {
+      scoped_lock l(&mutex_);
+      if (stopping_) {
+        return;
+      }
+      const uint64 wake_up_tick = GetNextWakeUpTick();
+      if (wake_up_tick != 0) {
+        const uint64 wake_up_time = start_time_ + wake_up_tick * tick_msec_;
+        const uint64 now = GetTimeInMsec();
+        if (wake_up_time <= now) {
+          continue;
+        }
+        wait_msec = static_cast<int>(
+            std::min<uint64>(wake_up_time - now, kint32max));
+      }
+    }
+    wake_up_.Wait(wait_msec);
+  }
+}
+
+}  // namespace mozc
@@ -0,0 +1,123 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Scheduler::SchedulerInterface running all the jobs on a single thread.
+//
+// The jobs are kept in a hierarchical timer wheel of kNumLevels levels with
+// kNumSlots slots each, where a slot of level n covers kNumSlots^n ticks.
+// The thread sleeps until the earliest tick with a due job or a slot to
+// cascade, so it doesn't wake up periodically while the jobs are far away.
+// The due times are rounded up to the tick, which coalesces the wakeups for
+// the jobs due around the same time.
+//
+// As the jobs share the thread, a long running job delays the others.
+
+#ifndef MOZC_BASE_TIMER_WHEEL_SCHEDULER_H_
+#define MOZC_BASE_TIMER_WHEEL_SCHEDULER_H_
+
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/mutex.h"
+#include "base/port.h"
+#include "base/scheduler.h"
+#include "base/unnamed_event.h"
+
+namespace mozc {
+
+class TimerWheelScheduler : public Scheduler::SchedulerInterface {
+ public:
+  // Uses the tick of kDefaultTickMsec.
+  TimerWheelScheduler();
+  // |tick_msec| is the resolution of the due times, which must be positive.
+  explicit TimerWheelScheduler(uint32 tick_msec);
+  // Removes all the jobs and stops the thread.
+  ~TimerWheelScheduler() override;
+
+  bool AddJob(const Scheduler::JobSetting &job_setting) override;
+  // Waits for the job to finish if it's running on another thread.
+  bool RemoveJob(const string &name) override;
+  void RemoveAllJobs() override;
+  bool HasJob(const string &name) const override;
+
+  static const uint32 kDefaultTickMsec = 1000;
+
+ private:
+  class WheelThread;
+  struct Entry;
+  typedef std::list<Entry *> Slot;
+
+  static const int kNumLevels = 4;
+  static const int kSlotBits = 6;
+  static const int kNumSlots = 1 << kSlotBits;
+
+  uint64 GetCurrentTick() const;
+  // Puts |entry| to the slot for its |expire_tick|.
+  void Insert(Entry *entry);
+  void Unlink(Entry *entry);
+  void Schedule(Entry *entry, uint64 delay_msec);
+  // Moves the entries in the slot of |level| for |current_tick_| to the lower
+  // levels.
+  void Cascade(int level);
+  // Advances |current_tick_| to |tick|, and appends the ids of the due
+  // entries to |due_ids|.
+  void Advance(uint64 tick, std::vector<uint64> *due_ids);
+  // Returns the earliest tick when Advance() has something to do, or 0 if
+  // the wheel is empty.
+  uint64 GetNextWakeUpTick() const;
+  // Runs the entry of |id| if it still exists, then reschedules it.
+  void RunJob(uint64 id);
+  // Runs on |thread_| until the destruction.
+  void RunLoop();
+
+  const uint32 tick_msec_;
+  // The wheel starts at this time in msec since the epoch.
+  const uint64 start_time_;
+
+  // Guards the members below.
+  mutable Mutex mutex_;
+  // Held while a job is running.
+  Mutex run_mutex_;
+  UnnamedEvent wake_up_;
+  bool stopping_;
+  uint64 current_tick_;
+  uint64 next_id_;
+  std::map<string, std::unique_ptr<Entry>> jobs_;
+  Slot wheel_[kNumLevels][kNumSlots];
+  std::unique_ptr<WheelThread> thread_;
+
+  DISALLOW_COPY_AND_ASSIGN(TimerWheelScheduler);
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_BASE_TIMER_WHEEL_SCHEDULER_H_
@@ -0,0 +1,149 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "base/timer_wheel_scheduler.h"
+
+#include <atomic>
+
+#include "base/clock.h"
+#include "base/scheduler.h"
+#include "base/unnamed_event.h"
+#include "base/util.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace {
+
+const int32 kTimeout = 30 * 1000;  // 30 sec.
+const uint32 kTickMsec = 1;
+const uint32 kShortPeriod = 10;  // 10 millisec.
+
+uint64 GetTimeInMsec() {
+  uint64 sec = 0;
+  uint32 usec = 0;
+  Clock::GetTimeOfDay(&sec, &usec);
+  return sec * 1000 + usec / 1000;
+}
+
+struct SharedInfo {
+  SharedInfo() : count(0), first_run_time(0), result(true) {}
+  std::atomic<int> count;
+  std::atomic<uint64> first_run_time;
+  bool result;
+  UnnamedEvent event;
+};
+
+bool CountCallback(void *ptr) {
+  SharedInfo *info = static_cast<SharedInfo *>(ptr);
+  if (++info->count == 1) {
+    info->first_run_time = GetTimeInMsec();
+  }
+  info->event.Notify();
+  return info->result;
+}
+
+Scheduler::JobSetting MakeJobSetting(const string &name, uint32 interval,
+                                     uint32 delay, SharedInfo *info) {
+  return Scheduler::JobSetting(name, interval, interval * 8, delay, 0,
+                               &CountCallback, info);
+}
+
+TEST(TimerWheelSchedulerTest, RunsJobPeriodically) {
+  TimerWheelScheduler scheduler(kTickMsec);
+  SharedInfo info;
+  ASSERT_TRUE(scheduler.AddJob(MakeJobSetting("Test", kShortPeriod, 0, &info)));
+  EXPECT_TRUE(scheduler.HasJob("Test"));
+  EXPECT_FALSE(scheduler.AddJob(
+      MakeJobSetting("Test", kShortPeriod, 0, &info)));
+
+  while (info.count < 3) {
+    ASSERT_TRUE(info.event.Wait(kTimeout));
+  }
+  EXPECT_TRUE(scheduler.RemoveJob("Test"));
+  EXPECT_FALSE(scheduler.HasJob("Test"));
+  EXPECT_FALSE(scheduler.RemoveJob("Test"));
+
+  // The job never runs after RemoveJob().
+  const int count = info.count;
+  Util::Sleep(kShortPeriod * 5);
+  EXPECT_EQ(count, info.count);
+}
+
+TEST(TimerWheelSchedulerTest, RunsJobsOnTime) {
+  TimerWheelScheduler scheduler(kTickMsec);
+  // Each delay is in a different level of the wheel.
+  const uint32 kDelays[] = {5, 100, 4200};
+  SharedInfo infos[arraysize(kDelays)];
+  const uint64 start_time = GetTimeInMsec();
+  for (size_t i = 0; i < arraysize(kDelays); ++i) {
+    ASSERT_TRUE(scheduler.AddJob(MakeJobSetting(
+        "Test" + std::to_string(i), 60 * 1000, kDelays[i], &infos[i])));
+  }
+  for (size_t i = 0; i < arraysize(kDelays); ++i) {
+    ASSERT_TRUE(infos[i].event.Wait(kTimeout));
+    EXPECT_EQ(1, infos[i].count);
+    EXPECT_LE(start_time + kDelays[i], infos[i].first_run_time);
+  }
+  // The jobs ran in the order of the delays.
+  EXPECT_LE(infos[0].first_run_time, infos[1].first_run_time);
+  EXPECT_LE(infos[1].first_run_time, infos[2].first_run_time);
+}
+
+TEST(TimerWheelSchedulerTest, Backoff) {
+  TimerWheelScheduler scheduler(kTickMsec);
+  SharedInfo succeeding_info;
+  SharedInfo failing_info;
+  failing_info.result = false;
+  ASSERT_TRUE(scheduler.AddJob(
+      MakeJobSetting("Succeeding", kShortPeriod, 0, &succeeding_info)));
+  ASSERT_TRUE(scheduler.AddJob(
+      MakeJobSetting("Failing", kShortPeriod, 0, &failing_info)));
+  Util::Sleep(kShortPeriod * 30);
+  scheduler.RemoveAllJobs();
+  EXPECT_FALSE(scheduler.HasJob("Succeeding"));
+  EXPECT_FALSE(scheduler.HasJob("Failing"));
+  EXPECT_LT(failing_info.count, succeeding_info.count);
+}
+
+TEST(TimerWheelSchedulerTest, IdleOnlyJob) {
+  TimerWheelScheduler scheduler(kTickMsec);
+  SharedInfo info;
+  const uint32 kIdlePeriod = 100;
+  Scheduler::JobSetting setting = MakeJobSetting("Test", kShortPeriod, 0,
+                                                 &info);
+  setting.set_idle_period(kIdlePeriod);
+  Scheduler::NotifyUserActivity();
+  const uint64 activity_time = Scheduler::GetLastUserActivityTime();
+  ASSERT_TRUE(scheduler.AddJob(setting));
+  ASSERT_TRUE(info.event.Wait(kTimeout));
+  EXPECT_LE(activity_time + kIdlePeriod, info.first_run_time);
+}
+
+}  // namespace
+}  // namespace mozc
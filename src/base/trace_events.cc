@@ -0,0 +1,224 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "base/trace_events.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include "base/clock.h"
+#include "base/flags.h"
+#include "base/singleton.h"
+#include "base/util.h"
+
+DEFINE_bool(trace_events, false,
+            "Records the trace events of the hot paths.  They can be dumped "
+            "by the GET_TRACE_EVENTS command.");
+
+namespace mozc {
+namespace {
+
+const size_t kNameWords = TraceEvents::kMaxNameSize / sizeof(uint64);
+
+struct Event {
+  uint64 index;
+  uint64 begin_usec;
+  uint64 duration_usec;
+  uint32 thread_id;
+  char name[TraceEvents::kMaxNameSize + 1];
+};
+
+// Every field is atomic so that readers can copy a slot while a writer may
+// overwrite it.  |sequence| is odd while the slot is written, and 2 * (index
+// + 1) after the event of |index| is written.  0 means an empty slot.
+struct Slot {
+  std::atomic<uint64> sequence;
+  std::atomic<uint64> begin_usec;
+  std::atomic<uint64> duration_usec;
+  std::atomic<uint32> thread_id;
+  std::atomic<uint64> name[kNameWords];
+};
+
+class TraceBuffer {
+ public:
+  TraceBuffer() : next_index_(0), start_index_(0) {
+    for (size_t i = 0; i < TraceEvents::kCapacity; ++i) {
+      slots_[i].sequence.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  void Record(StringPiece name, uint64 begin_usec, uint64 end_usec,
+              uint32 thread_id) {
+    const uint64 index = next_index_.fetch_add(1, std::memory_order_relaxed);
+    Slot *slot = &slots_[index % TraceEvents::kCapacity];
+    slot->sequence.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    uint64 words[kNameWords] = {};
+    memcpy(words, name.data(), std::min(name.size(), sizeof(words)));
+    for (size_t i = 0; i < kNameWords; ++i) {
+      slot->name[i].store(words[i], std::memory_order_relaxed);
+    }
+    slot->begin_usec.store(begin_usec, std::memory_order_relaxed);
+    slot->duration_usec.store(
+        end_usec > begin_usec ? end_usec - begin_usec : 0,
+        std::memory_order_relaxed);
+    slot->thread_id.store(thread_id, std::memory_order_relaxed);
+    slot->sequence.store(2 * (index + 1), std::memory_order_release);
+  }
+
+  // Copies the consistent events recorded after the last Clear() to
+  // |events| in the order of recording.
+  void GetEvents(std::vector<Event> *events) const {
+    const uint64 start_index = start_index_.load(std::memory_order_relaxed);
+    events->clear();
+    for (size_t i = 0; i < TraceEvents::kCapacity; ++i) {
+      const Slot &slot = slots_[i];
+      const uint64 sequence = slot.sequence.load(std::memory_order_acquire);
+      if (sequence == 0 || sequence % 2 == 1 ||
+          sequence / 2 - 1 < start_index) {
+        continue;
+      }
+      Event event;
+      event.index = sequence / 2 - 1;
+      event.begin_usec = slot.begin_usec.load(std::memory_order_relaxed);
+      event.duration_usec = slot.duration_usec.load(std::memory_order_relaxed);
+      event.thread_id = slot.thread_id.load(std::memory_order_relaxed);
+      uint64 words[kNameWords];
+      for (size_t j = 0; j < kNameWords; ++j) {
+        words[j] = slot.name[j].load(std::memory_order_relaxed);
+      }
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (slot.sequence.load(std::memory_order_relaxed) != sequence) {
+        // Overwritten while being copied.
+        continue;
+      }
+      memcpy(event.name, words, sizeof(words));
+      event.name[TraceEvents::kMaxNameSize] = '\0';
+      events->push_back(event);
+    }
+    std::sort(events->begin(), events->end(),
+              [](const Event &lhs, const Event &rhs) {
+                return lhs.index < rhs.index;
+              });
+  }
+
+  void Clear() {
+    start_index_.store(next_index_.load(std::memory_order_relaxed),
+                       std::memory_order_relaxed);
+  }
+
+ private:
+  Slot slots_[TraceEvents::kCapacity];
+  std::atomic<uint64> next_index_;
+  // The events before this index are cleared.
+  std::atomic<uint64> start_index_;
+
+  DISALLOW_COPY_AND_ASSIGN(TraceBuffer);
+};
+
+// Returns a small number identifying the calling thread.
+uint32 GetThreadId() {
+  static std::atomic<uint32> next_thread_id(1);
+  thread_local const uint32 thread_id =
+      next_thread_id.fetch_add(1, std::memory_order_relaxed);
+  return thread_id;
+}
+
+void AppendJsonString(const char *str, string *output) {
+  output->append(1, '"');
+  for (const char *p = str; *p != '\0'; ++p) {
+    const unsigned char c = static_cast<unsigned char>(*p);
+    if (c == '"' || c == '\\') {
+      output->append(1, '\\');
+      output->append(1, *p);
+    } else if (c < 0x20) {
+      output->append(Util::StringPrintf("\\u%04x", c));
+    } else {
+      output->append(1, *p);
+    }
+  }
+  output->append(1, '"');
+}
+
+}  // namespace
+
+const size_t TraceEvents::kCapacity;
+const size_t TraceEvents::kMaxNameSize;
+
+// static
+bool TraceEvents::IsEnabled() {
+  return FLAGS_trace_events;
+}
+
+// static
+void TraceEvents::Record(StringPiece name, uint64 begin_usec,
+                         uint64 end_usec) {
+  Singleton<TraceBuffer>::get()->Record(name, begin_usec, end_usec,
+                                        GetThreadId());
+}
+
+// static
+uint64 TraceEvents::GetCurrentTimeUsec() {
+  uint64 sec = 0;
+  uint32 usec = 0;
+  Clock::GetTimeOfDay(&sec, &usec);
+  return sec * 1000000 + usec;
+}
+
+// static
+void TraceEvents::GetChromeTraceJson(string *json) {
+  std::vector<Event> events;
+  Singleton<TraceBuffer>::get()->GetEvents(&events);
+  json->assign("{\"traceEvents\":[");
+  for (size_t i = 0; i < events.size(); ++i) {
+    const Event &event = events[i];
+    if (i > 0) {
+      json->append(1, ',');
+    }
+    json->append("{\"name\":");
+    AppendJsonString(event.name, json);
+    json->append(Util::StringPrintf(
+        ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%llu,\"dur\":%llu}",
+        event.thread_id, static_cast<unsigned long long>(event.begin_usec),
+        static_cast<unsigned long long>(event.duration_usec)));
+  }
+  json->append("]}");
+}
+
+// static
+void TraceEvents::Clear() {
+  Singleton<TraceBuffer>::get()->Clear();
+}
+
+}  // namespace mozc
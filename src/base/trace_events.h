@@ -0,0 +1,119 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// Trace events of the hot paths, which can be dumped in the Chrome trace
+// event format (chrome://tracing) to see where the time goes inside one slow
+// key event.
+//
+// Usage:
+//   void Foo() {
+//     MOZC_TRACE_SCOPE("Foo");
+//     ...
+//   }
+//
+// The events are recorded only while --trace_events is true; otherwise a
+// scope costs a flag check.  Defining MOZC_DISABLE_TRACE_EVENTS removes the
+// scopes at compile time.  The events are kept in a fixed size ring buffer
+// shared by all the threads, so only the latest events remain.
+
+#ifndef MOZC_BASE_TRACE_EVENTS_H_
+#define MOZC_BASE_TRACE_EVENTS_H_
+
+#include <string>
+
+#include "base/port.h"
+#include "base/string_piece.h"
+
+namespace mozc {
+
+class TraceEvents {
+ public:
+  // The number of the events kept in the ring buffer.
+  static const size_t kCapacity = 8192;
+  // Names longer than this are truncated.
+  static const size_t kMaxNameSize = 32;
+
+  // Returns true if the events are recorded, i.e., --trace_events is true.
+  static bool IsEnabled();
+
+  // Records an event of |name| from |begin_usec| to |end_usec| on the
+  // calling thread.  This method is lock-free and thread-safe.
+  static void Record(StringPiece name, uint64 begin_usec, uint64 end_usec);
+
+  // Returns the current time in microseconds for Record().
+  static uint64 GetCurrentTimeUsec();
+
+  // Writes the recorded events, oldest first, to |json| as a Chrome trace
+  // JSON object.  Events being written concurrently are skipped.
+  static void GetChromeTraceJson(string *json);
+
+  // Discards the recorded events.
+  static void Clear();
+
+ private:
+  DISALLOW_IMPLICIT_CONSTRUCTORS(TraceEvents);
+};
+
+// Records an event for the lifetime of the object.  |name| must outlive
+// the object.
+class ScopedTraceEvent {
+ public:
+  explicit ScopedTraceEvent(StringPiece name)
+      : name_(name),
+        begin_usec_(TraceEvents::IsEnabled() ?
+                    TraceEvents::GetCurrentTimeUsec() : 0) {}
+
+  ~ScopedTraceEvent() {
+    if (begin_usec_ != 0) {
+      TraceEvents::Record(name_, begin_usec_,
+                          TraceEvents::GetCurrentTimeUsec());
+    }
+  }
+
+ private:
+  const StringPiece name_;
+  const uint64 begin_usec_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedTraceEvent);
+};
+
+}  // namespace mozc
+
+#define MOZC_TRACE_CONCAT_INTERNAL(a, b) a##b
+#define MOZC_TRACE_CONCAT(a, b) MOZC_TRACE_CONCAT_INTERNAL(a, b)
+
+#ifndef MOZC_DISABLE_TRACE_EVENTS
+#define MOZC_TRACE_SCOPE(name) \
+  ::mozc::ScopedTraceEvent MOZC_TRACE_CONCAT(trace_scope_, __LINE__)(name)
+#else  // MOZC_DISABLE_TRACE_EVENTS
+#define MOZC_TRACE_SCOPE(name) do {} while (false)
+#endif  // MOZC_DISABLE_TRACE_EVENTS
+
+#endif  // MOZC_BASE_TRACE_EVENTS_H_
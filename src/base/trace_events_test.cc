@@ -0,0 +1,163 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "base/trace_events.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/flags.h"
+#include "base/thread.h"
+#include "base/util.h"
+#include "testing/base/public/gunit.h"
+
+DECLARE_bool(trace_events);
+
+namespace mozc {
+namespace {
+
+// Returns the number of the events in |json|.
+size_t CountEvents(const string &json) {
+  size_t count = 0;
+  for (size_t pos = json.find("\"ph\":\"X\""); pos != string::npos;
+       pos = json.find("\"ph\":\"X\"", pos + 1)) {
+    ++count;
+  }
+  return count;
+}
+
+class TraceEventsTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    original_trace_events_ = FLAGS_trace_events;
+    TraceEvents::Clear();
+  }
+
+  void TearDown() override {
+    FLAGS_trace_events = original_trace_events_;
+    TraceEvents::Clear();
+  }
+
+ private:
+  bool original_trace_events_;
+};
+
+class RecordThread : public Thread {
+ public:
+  explicit RecordThread(int num_events) : num_events_(num_events) {}
+
+  void Run() override {
+    for (int i = 0; i < num_events_; ++i) {
+      MOZC_TRACE_SCOPE("RecordThread");
+    }
+  }
+
+ private:
+  const int num_events_;
+};
+
+TEST_F(TraceEventsTest, RecordOnlyWhenEnabled) {
+  FLAGS_trace_events = false;
+  {
+    MOZC_TRACE_SCOPE("Disabled");
+  }
+  string json;
+  TraceEvents::GetChromeTraceJson(&json);
+  EXPECT_EQ("{\"traceEvents\":[]}", json);
+
+  FLAGS_trace_events = true;
+  {
+    MOZC_TRACE_SCOPE("Outer");
+    MOZC_TRACE_SCOPE("Inner");
+  }
+  TraceEvents::GetChromeTraceJson(&json);
+  EXPECT_EQ(2, CountEvents(json));
+  // The inner scope ends first.
+  const size_t inner_pos = json.find("{\"name\":\"Inner\",\"ph\":\"X\"");
+  const size_t outer_pos = json.find("{\"name\":\"Outer\",\"ph\":\"X\"");
+  ASSERT_NE(string::npos, inner_pos);
+  ASSERT_NE(string::npos, outer_pos);
+  EXPECT_LT(inner_pos, outer_pos);
+  EXPECT_EQ(string::npos, json.find("Disabled"));
+
+  TraceEvents::Clear();
+  TraceEvents::GetChromeTraceJson(&json);
+  EXPECT_EQ(0, CountEvents(json));
+}
+
+TEST_F(TraceEventsTest, Record) {
+  TraceEvents::Record("Event", 100, 150);
+  // A long name is truncated and a quote is escaped.
+  TraceEvents::Record(string(TraceEvents::kMaxNameSize - 1, 'a') + "\"b",
+                      200, 200);
+  string json;
+  TraceEvents::GetChromeTraceJson(&json);
+  EXPECT_NE(string::npos,
+            json.find("{\"name\":\"Event\",\"ph\":\"X\",\"pid\":1,\"tid\":"));
+  EXPECT_NE(string::npos, json.find("\"ts\":100,\"dur\":50}"));
+  EXPECT_NE(string::npos,
+            json.find("\"" + string(TraceEvents::kMaxNameSize - 1, 'a') +
+                      "\\\"\""));
+  EXPECT_NE(string::npos, json.find("\"ts\":200,\"dur\":0}"));
+}
+
+TEST_F(TraceEventsTest, KeepsLatestEvents) {
+  for (size_t i = 0; i < TraceEvents::kCapacity + 10; ++i) {
+    TraceEvents::Record(Util::StringPrintf("Event%d", static_cast<int>(i)),
+                        i, i + 1);
+  }
+  string json;
+  TraceEvents::GetChromeTraceJson(&json);
+  EXPECT_EQ(TraceEvents::kCapacity, CountEvents(json));
+  EXPECT_EQ(string::npos, json.find("\"Event9\""));
+  EXPECT_EQ(0, json.find("{\"traceEvents\":[{\"name\":\"Event10\""));
+}
+
+TEST_F(TraceEventsTest, ConcurrentRecord) {
+  FLAGS_trace_events = true;
+  const int kNumThreads = 4;
+  const int kNumEvents = 1000;
+  std::vector<std::unique_ptr<RecordThread>> threads;
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.emplace_back(new RecordThread(kNumEvents));
+    threads.back()->SetJoinable(true);
+    threads.back()->Start("TraceEventsTest");
+  }
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads[i]->Join();
+  }
+  string json;
+  TraceEvents::GetChromeTraceJson(&json);
+  EXPECT_EQ(kNumThreads * kNumEvents, CountEvents(json));
+}
+
+}  // namespace
+}  // namespace mozc
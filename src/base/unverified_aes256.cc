@@ -34,6 +34,20 @@
 
 #include "base/logging.h"
 
+// AES-NI is used only on x86 where it can be detected at runtime.
+#if !defined(OS_NACL) && (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define MOZC_USE_AESNI
+#include <cpuid.h>
+#include <wmmintrin.h>
+#define MOZC_AESNI_TARGET __attribute__((target("aes,sse2")))
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define MOZC_USE_AESNI
+#include <intrin.h>
+#include <wmmintrin.h>
+#define MOZC_AESNI_TARGET
+#endif
+
 namespace mozc {
 namespace internal {
 namespace {
@@ -158,8 +172,117 @@ void InvMixColumnsImpl(uint8 column[4]) {
   column[3] = a11[0] ^ a13[1] ^  a9[2] ^ a14[3];
 }
 
+#ifdef MOZC_USE_AESNI
+bool HasAESNI() {
+  // CPUID.01H:ECX.AES[bit 25]
+  const unsigned int kAESBit = 1 << 25;
+#ifdef _MSC_VER
+  int info[4];
+  __cpuid(info, 1);
+  return (static_cast<unsigned int>(info[2]) & kAESBit) != 0;
+#else
+  unsigned int eax, ebx, ecx, edx;
+  if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+    return false;
+  }
+  return (ecx & kAESBit) != 0;
+#endif  // _MSC_VER
+}
+
+MOZC_AESNI_TARGET
+void TransformCBCWithAESNI(
+    const uint8 (&w)[UnverifiedAES256::kKeyScheduleBytes],
+    const uint8 (&iv)[UnverifiedAES256::kBlockBytes],
+    uint8 *block, size_t block_count) {
+  __m128i round_keys[kNr + 1];
+  for (size_t i = 0; i <= kNr; ++i) {
+    round_keys[i] = _mm_loadu_si128(
+        reinterpret_cast<const __m128i *>(&w[i * 16]));
+  }
+
+  __m128i vec = _mm_loadu_si128(reinterpret_cast<const __m128i *>(iv));
+  for (size_t i = 0; i < block_count; ++i) {
+    __m128i *src = reinterpret_cast<__m128i *>(block + i * 16);
+    vec = _mm_xor_si128(_mm_loadu_si128(src), vec);
+    vec = _mm_xor_si128(vec, round_keys[0]);
+    for (size_t round = 1; round < kNr; ++round) {
+      vec = _mm_aesenc_si128(vec, round_keys[round]);
+    }
+    vec = _mm_aesenclast_si128(vec, round_keys[kNr]);
+    _mm_storeu_si128(src, vec);
+  }
+}
+
+MOZC_AESNI_TARGET
+void InverseTransformCBCWithAESNI(
+    const uint8 (&w)[UnverifiedAES256::kKeyScheduleBytes],
+    const uint8 (&iv)[UnverifiedAES256::kBlockBytes],
+    uint8 *block, size_t block_count) {
+  // Round keys for the equivalent inverse cipher.
+  __m128i round_keys[kNr + 1];
+  round_keys[0] = _mm_loadu_si128(
+      reinterpret_cast<const __m128i *>(&w[kNr * 16]));
+  for (size_t i = 1; i < kNr; ++i) {
+    round_keys[i] = _mm_aesimc_si128(_mm_loadu_si128(
+        reinterpret_cast<const __m128i *>(&w[(kNr - i) * 16])));
+  }
+  round_keys[kNr] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&w[0]));
+
+  // Unlike encryption, the blocks of CBC can be decrypted independently, so
+  // four blocks are interleaved to hide the latency of the instructions.
+  __m128i prev = _mm_loadu_si128(reinterpret_cast<const __m128i *>(iv));
+  size_t i = 0;
+  for (; i + 4 <= block_count; i += 4) {
+    __m128i *src = reinterpret_cast<__m128i *>(block + i * 16);
+    const __m128i in0 = _mm_loadu_si128(src);
+    const __m128i in1 = _mm_loadu_si128(src + 1);
+    const __m128i in2 = _mm_loadu_si128(src + 2);
+    const __m128i in3 = _mm_loadu_si128(src + 3);
+    __m128i b0 = _mm_xor_si128(in0, round_keys[0]);
+    __m128i b1 = _mm_xor_si128(in1, round_keys[0]);
+    __m128i b2 = _mm_xor_si128(in2, round_keys[0]);
+    __m128i b3 = _mm_xor_si128(in3, round_keys[0]);
+    for (size_t round = 1; round < kNr; ++round) {
+      b0 = _mm_aesdec_si128(b0, round_keys[round]);
+      b1 = _mm_aesdec_si128(b1, round_keys[round]);
+      b2 = _mm_aesdec_si128(b2, round_keys[round]);
+      b3 = _mm_aesdec_si128(b3, round_keys[round]);
+    }
+    b0 = _mm_aesdeclast_si128(b0, round_keys[kNr]);
+    b1 = _mm_aesdeclast_si128(b1, round_keys[kNr]);
+    b2 = _mm_aesdeclast_si128(b2, round_keys[kNr]);
+    b3 = _mm_aesdeclast_si128(b3, round_keys[kNr]);
+    _mm_storeu_si128(src, _mm_xor_si128(b0, prev));
+    _mm_storeu_si128(src + 1, _mm_xor_si128(b1, in0));
+    _mm_storeu_si128(src + 2, _mm_xor_si128(b2, in1));
+    _mm_storeu_si128(src + 3, _mm_xor_si128(b3, in2));
+    prev = in3;
+  }
+  for (; i < block_count; ++i) {
+    __m128i *src = reinterpret_cast<__m128i *>(block + i * 16);
+    const __m128i in = _mm_loadu_si128(src);
+    __m128i b = _mm_xor_si128(in, round_keys[0]);
+    for (size_t round = 1; round < kNr; ++round) {
+      b = _mm_aesdec_si128(b, round_keys[round]);
+    }
+    b = _mm_aesdeclast_si128(b, round_keys[kNr]);
+    _mm_storeu_si128(src, _mm_xor_si128(b, prev));
+    prev = in;
+  }
+}
+#endif  // MOZC_USE_AESNI
+
 }  // namespace
 
+bool UnverifiedAES256::IsHardwareAccelerated() {
+#ifdef MOZC_USE_AESNI
+  static const bool kHasAESNI = HasAESNI();
+  return kHasAESNI;
+#else
+  return false;
+#endif  // MOZC_USE_AESNI
+}
+
 void UnverifiedAES256::TransformCBC(const uint8 (&key)[kKeyBytes],
                                     const uint8 (&iv)[kBlockBytes],
                                     uint8 *block,
@@ -167,6 +290,13 @@ void UnverifiedAES256::TransformCBC(const uint8 (&key)[kKeyBytes],
   uint8 w[kKeyScheduleBytes];
   MakeKeySchedule(key, w);
 
+#ifdef MOZC_USE_AESNI
+  if (IsHardwareAccelerated()) {
+    TransformCBCWithAESNI(w, iv, block, block_count);
+    return;
+  }
+#endif  // MOZC_USE_AESNI
+
   uint8 vec[kBlockBytes];
   memcpy(vec, iv, kBlockBytes);
   for (size_t i = 0; i < block_count; ++i) {
@@ -186,6 +316,13 @@ void UnverifiedAES256::InverseTransformCBC(const uint8 (&key)[kKeyBytes],
   uint8 w[kKeyScheduleBytes];
   MakeKeySchedule(key, w);
 
+#ifdef MOZC_USE_AESNI
+  if (IsHardwareAccelerated()) {
+    InverseTransformCBCWithAESNI(w, iv, block, block_count);
+    return;
+  }
+#endif  // MOZC_USE_AESNI
+
   uint8 prev_block[kBlockBytes];
   memcpy(prev_block, iv, kBlockBytes);
   for (size_t i = 0; i < block_count; ++i) {
@@ -38,7 +38,8 @@ namespace internal {
 // Note that this implemenation is kept just for the backward compatibility
 // so that we can read previously obfuscated data.
 // !!! Not FIPS-certified.
-// !!! Performance optimization is not well considered.
+// !!! Performance optimization is not well considered, except that the CBC
+//     transformations use the AES instructions of x86 CPUs if available.
 // !!! Side-channel attack is not well considered.
 // TODO(team): Consider to remove this class and stop doing obfuscation.
 class UnverifiedAES256 {
@@ -61,6 +62,10 @@ class UnverifiedAES256 {
                                   uint8 *buffer,
                                   size_t block_count);
 
+  // Returns true if TransformCBC and InverseTransformCBC run on the AES
+  // instructions of the CPU (AES-NI).
+  static bool IsHardwareAccelerated();
+
  protected:
   // Does AES256 ECB transformation.
   // CAVEATS: See the above comment.
@@ -28,6 +28,9 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "base/unverified_aes256.h"
+
+#include <cstring>
+
 #include "testing/base/public/googletest.h"
 #include "testing/base/public/gunit.h"
 
@@ -452,6 +455,47 @@ TEST(UnverifiedAES256Test, InverseTransformCBC_NonZero) {
   EXPECT_EQ_ARRAY(kExpected, block);
 }
 
+// Checks the CBC transformations, which may run on the AES instructions of
+// the CPU, against the chain of the ECB transformations.
+TEST(UnverifiedAES256Test, TransformCBC_MatchesECB) {
+  uint8 key[UnverifiedAES256::kKeyBytes];
+  for (size_t i = 0; i < arraysize(key); ++i) {
+    key[i] = static_cast<uint8>(i * 7 + 3);
+  }
+  uint8 iv[UnverifiedAES256::kBlockBytes];
+  for (size_t i = 0; i < arraysize(iv); ++i) {
+    iv[i] = static_cast<uint8>(0xff - i * 5);
+  }
+  // Not a multiple of 4 to cover the remainder of the interleaved blocks.
+  const size_t kNumBlocks = 11;
+  uint8 original[UnverifiedAES256::kBlockBytes * kNumBlocks];
+  for (size_t i = 0; i < arraysize(original); ++i) {
+    original[i] = static_cast<uint8>(i * 31 + 1);
+  }
+
+  uint8 w[UnverifiedAES256::kKeyScheduleBytes];
+  TestableUnverifiedAES256::MakeKeySchedule(key, w);
+  uint8 expected[UnverifiedAES256::kBlockBytes * kNumBlocks];
+  memcpy(expected, original, sizeof(original));
+  const uint8 *prev = iv;
+  for (size_t i = 0; i < kNumBlocks; ++i) {
+    uint8 *block = expected + i * UnverifiedAES256::kBlockBytes;
+    for (size_t j = 0; j < UnverifiedAES256::kBlockBytes; ++j) {
+      block[j] ^= prev[j];
+    }
+    TestableUnverifiedAES256::TransformECB(w, block);
+    prev = block;
+  }
+
+  uint8 block[UnverifiedAES256::kBlockBytes * kNumBlocks];
+  memcpy(block, original, sizeof(original));
+  TestableUnverifiedAES256::TransformCBC(key, iv, block, kNumBlocks);
+  EXPECT_EQ_ARRAY(expected, block);
+
+  TestableUnverifiedAES256::InverseTransformCBC(key, iv, block, kNumBlocks);
+  EXPECT_EQ_ARRAY(original, block);
+}
+
 // TODO(yukawa): Add more tests based on well-known test vectors.
 
 }  // namespace
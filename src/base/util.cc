@@ -65,8 +65,14 @@
 #include "base/japanese_util_rule.h"
 #include "base/logging.h"
 #include "base/port.h"
+#include "base/singleton.h"
 #include "base/string_piece.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MOZC_USE_SSE2_UTF8
+#include <emmintrin.h>
+#endif  // __SSE2__ || _M_X64 || _M_IX86_FP >= 2
 
 
 namespace mozc {
@@ -518,6 +524,160 @@ bool IsUTF8TrailingByte(uint8 c) {
   return (c & 0xc0) == 0x80;
 }
 
+
+#ifdef MOZC_USE_SSE2_UTF8
+
+// The strings shorter than this are scanned one character at a time.
+const size_t kUTF8BlockSize = 16;
+
+inline int PopCount16(uint32 x) {
+  x = x - ((x >> 1) & 0x5555);
+  x = (x & 0x3333) + ((x >> 2) & 0x3333);
+  x = (x + (x >> 4)) & 0x0f0f;
+  return (x + (x >> 8)) & 0x1f;
+}
+
+// Returns the bytes of |current| shifted by |N| bytes toward the end of the
+// string, filled with the last bytes of |previous|.
+template <int N>
+inline __m128i ShiftIn(__m128i previous, __m128i current) {
+  return _mm_or_si128(_mm_slli_si128(current, N),
+                      _mm_srli_si128(previous, 16 - N));
+}
+
+// Finds the first bytes of the characters in 16-byte blocks of a UTF-8
+// string.  The counts of such bytes agree with the character-by-character
+// scan of OneCharLen() only when every first byte is followed by the right
+// number of trailing bytes, so the scanner also records whether each trailing
+// byte is exactly where a preceding first byte expects one.
+class UTF8BlockScanner {
+ public:
+  UTF8BlockScanner()
+      : prev_len2_(_mm_setzero_si128()),
+        prev_len3_(_mm_setzero_si128()),
+        prev_len4_(_mm_setzero_si128()),
+        error_(_mm_setzero_si128()) {}
+
+  // Scans the 16 bytes at |block|, which follow the bytes scanned so far, and
+  // returns the mask of the first bytes of the characters.
+  uint32 Scan(const char *block) {
+    const __m128i bytes =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(block));
+    const __m128i trailing = _mm_cmpeq_epi8(
+        _mm_and_si128(bytes, _mm_set1_epi8(static_cast<char>(0xc0))),
+        _mm_set1_epi8(static_cast<char>(0x80)));
+    // The first bytes of the characters longer than 1, 2 and 3 bytes.
+    const __m128i len2 = AtLeast(bytes, 0xc0);
+    const __m128i len3 = AtLeast(bytes, 0xe0);
+    const __m128i len4 = AtLeast(bytes, 0xf0);
+    const __m128i expected = _mm_or_si128(
+        _mm_or_si128(ShiftIn<1>(prev_len2_, len2),
+                     ShiftIn<2>(prev_len3_, len3)),
+        ShiftIn<3>(prev_len4_, len4));
+    error_ = _mm_or_si128(error_, _mm_xor_si128(trailing, expected));
+    prev_len2_ = len2;
+    prev_len3_ = len3;
+    prev_len4_ = len4;
+    return ~static_cast<uint32>(_mm_movemask_epi8(trailing)) & 0xffff;
+  }
+
+  // Same as Scan() but reads only |size| (< 16) bytes.  A character cut off
+  // at |size| is reported as an error.
+  uint32 ScanLast(const char *block, size_t size) {
+    char buffer[kUTF8BlockSize] = {};
+    memcpy(buffer, block, size);
+    return Scan(buffer) & ((1u << size) - 1);
+  }
+
+  bool HasError() const { return _mm_movemask_epi8(error_) != 0; }
+
+ private:
+  static __m128i AtLeast(__m128i bytes, uint8 min) {
+    return _mm_cmpeq_epi8(
+        _mm_max_epu8(bytes, _mm_set1_epi8(static_cast<char>(min))), bytes);
+  }
+
+  __m128i prev_len2_;
+  __m128i prev_len3_;
+  __m128i prev_len4_;
+  __m128i error_;
+};
+
+// Counts the characters of |src| 16 bytes at a time.  Returns false if |src|
+// is malformed, in which case the result of the character-by-character scan
+// may differ.
+bool CharsLenSSE2(const char *src, size_t length, size_t *result) {
+  UTF8BlockScanner scanner;
+  size_t count = 0;
+  size_t i = 0;
+  for (; i + kUTF8BlockSize <= length; i += kUTF8BlockSize) {
+    count += PopCount16(scanner.Scan(src + i));
+  }
+  if (i < length) {
+    count += PopCount16(scanner.ScanLast(src + i, length - i));
+  }
+  if (scanner.HasError()) {
+    return false;
+  }
+  *result = count;
+  return true;
+}
+
+// Finds the byte offset of the |num_chars|-th character of |src| 16 bytes at
+// a time.  Returns false under the same condition as CharsLenSSE2().  Only
+// the blocks up to the offset are checked.
+bool CharsOffsetSSE2(const char *src, size_t length, size_t num_chars,
+                     size_t *offset) {
+  UTF8BlockScanner scanner;
+  for (size_t i = 0; i < length; i += kUTF8BlockSize) {
+    uint32 mask = (i + kUTF8BlockSize <= length) ?
+        scanner.Scan(src + i) : scanner.ScanLast(src + i, length - i);
+    const size_t count = PopCount16(mask);
+    if (count > num_chars) {
+      if (scanner.HasError()) {
+        return false;
+      }
+      for (; num_chars > 0; --num_chars) {
+        mask &= mask - 1;
+      }
+      size_t pos = i;
+      for (; (mask & 1) == 0; mask >>= 1) {
+        ++pos;
+      }
+      *offset = pos;
+      return true;
+    }
+    num_chars -= count;
+  }
+  if (scanner.HasError()) {
+    return false;
+  }
+  *offset = length;
+  return true;
+}
+
+#endif  // MOZC_USE_SSE2_UTF8
+
+// Returns the byte offset of the |num_chars|-th character of |src|, or the
+// size of |src| if it has fewer characters.
+size_t CharsOffset(StringPiece src, size_t num_chars) {
+  if (num_chars == 0) {
+    return 0;
+  }
+#ifdef MOZC_USE_SSE2_UTF8
+  size_t offset = 0;
+  if (src.size() >= kUTF8BlockSize &&
+      CharsOffsetSSE2(src.data(), src.size(), num_chars, &offset)) {
+    return offset;
+  }
+#endif  // MOZC_USE_SSE2_UTF8
+  size_t offset_scalar = 0;
+  for (size_t i = 0; i < num_chars && offset_scalar < src.size(); ++i) {
+    offset_scalar += kUTF8LenTbl[static_cast<uint8>(src[offset_scalar])];
+  }
+  return std::min(offset_scalar, src.size());
+}
+
 }  // namespace
 
 // Return length of a single UTF-8 source character
@@ -526,6 +686,12 @@ size_t Util::OneCharLen(const char *src) {
 }
 
 size_t Util::CharsLen(const char *src, size_t length) {
+#ifdef MOZC_USE_SSE2_UTF8
+  size_t count = 0;
+  if (length >= kUTF8BlockSize && CharsLenSSE2(src, length, &count)) {
+    return count;
+  }
+#endif  // MOZC_USE_SSE2_UTF8
   const char *begin = src;
   const char *end = src + length;
   int result = 0;
@@ -793,26 +959,13 @@ int Util::WideToUTF8(const std::wstring &input, string *output) {
 #endif  // OS_WIN
 
 StringPiece Util::SubStringPiece(StringPiece src, size_t start) {
-  const char *begin = src.data();
-  const char *end = begin + src.size();
-  for (size_t i = 0; i < start && begin < end; ++i) {
-    begin += OneCharLen(begin);
-  }
-  const size_t prefix_len = begin - src.data();
-  return StringPiece(begin, src.size() - prefix_len);
+  return src.substr(CharsOffset(src, start));
 }
 
 StringPiece Util::SubStringPiece(
     StringPiece src, size_t start, size_t length) {
   src = SubStringPiece(src, start);
-  size_t l = length;
-  const char *substr_end = src.data();
-  const char *const end = src.data() + src.size();
-  while (l > 0 && substr_end < end) {
-    substr_end += OneCharLen(substr_end);
-    --l;
-  }
-  return StringPiece(src.data(), substr_end - src.data());
+  return src.substr(0, CharsOffset(src, length));
 }
 
 void Util::SubString(StringPiece src, size_t start, size_t length,
@@ -1074,6 +1227,13 @@ bool UnescapeInternal(StringPiece input, StringPiece prefix, char *output) {
   return true;
 }
 
+// Returns true if all the 8 bytes from |ptr| are ASCII.
+inline bool IsAsciiWord(const char *ptr) {
+  uint64 word;
+  memcpy(&word, ptr, sizeof(word));
+  return (word & 0x8080808080808080ULL) == 0;
+}
+
 int LookupDoubleArray(const japanese_util_rule::DoubleArray *array,
                       const char *key, int len, int *result) {
   int seekto = 0;
@@ -1108,6 +1268,194 @@ int LookupDoubleArray(const japanese_util_rule::DoubleArray *array,
   return seekto;
 }
 
+// Returns true if |array| has a key which is longer than |key| and starts
+// with |key|.
+bool HasLongerKey(const japanese_util_rule::DoubleArray *array,
+                  const char *key, int len) {
+  int b = array[0].base;
+  for (int i = 0; i < len; ++i) {
+    const uint32 p = b + static_cast<uint8>(key[i]) + 1;
+    if (static_cast<uint32>(b) != array[p].check) {
+      return false;
+    }
+    b = array[p].base;
+  }
+  for (int c = 0; c < 256; ++c) {
+    if (static_cast<uint32>(b) == array[b + c + 1].check) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Memoizes the conversion of single characters whose result doesn't depend
+// on the following characters, so that ConvertUsingDoubleArray can skip the
+// double array traversal for them.  Only ASCII and the 3-byte blocks
+// U+3xxx (kana and CJK symbols) and U+Fxxx (full-width ASCII and half-width
+// katakana) are cached; they cover all the keys of the kana/width rules.
+class CharConversionCache {
+ public:
+  CharConversionCache(const japanese_util_rule::DoubleArray *da,
+                      const char *ctable)
+      : da_(da), ctable_(ctable), ascii_identity_(true) {
+    char buf[3];
+    ascii_.resize(kAsciiSize);
+    for (char32 c = 0; c < kAsciiSize; ++c) {
+      buf[0] = static_cast<char>(c);
+      ascii_[c] = ComputeEntry(buf, 1);
+      ascii_identity_ = ascii_identity_ && ascii_[c] == kIdentity;
+    }
+    BuildBlock(0xE3, &e3_block_);
+    BuildBlock(0xEF, &ef_block_);
+  }
+
+  const japanese_util_rule::DoubleArray *da() const { return da_; }
+
+  // Converts the characters at the beginning of [begin, end) as long as
+  // they are cached and returns the pointer to the first unconverted byte.
+  const char *Convert(const char *begin, const char *end,
+                      string *output) const {
+    while (begin < end) {
+      const uint8 c = static_cast<uint8>(*begin);
+      if (c < 0x80) {
+        if (ascii_identity_) {
+          const char *run = begin + 1;
+          while (end - run >= 8 && IsAsciiWord(run)) {
+            run += 8;
+          }
+          while (run < end && static_cast<uint8>(*run) < 0x80) {
+            ++run;
+          }
+          output->append(begin, run - begin);
+          begin = run;
+          continue;
+        }
+        if (!Append(ascii_[c], begin, 1, output)) {
+          return begin;
+        }
+        ++begin;
+        continue;
+      }
+      if ((c != 0xE3 && c != 0xEF) || end - begin < 3 ||
+          (static_cast<uint8>(begin[1]) & 0xC0) != 0x80 ||
+          (static_cast<uint8>(begin[2]) & 0xC0) != 0x80) {
+        return begin;
+      }
+      const std::vector<uint16> &block = (c == 0xE3) ? e3_block_ : ef_block_;
+      const uint16 entry = block.empty() ? kIdentity :
+          block[((static_cast<uint8>(begin[1]) & 0x3F) << 6) |
+                (static_cast<uint8>(begin[2]) & 0x3F)];
+      if (!Append(entry, begin, 3, output)) {
+        return begin;
+      }
+      begin += 3;
+    }
+    return begin;
+  }
+
+ private:
+  static const char32 kAsciiSize = 0x80;
+  static const char32 kBlockSize = 0x1000;
+  // The conversion depends on the following characters.
+  static const uint16 kFallback = 0xFFFF;
+  // The character is not a key; it is copied as is.
+  static const uint16 kIdentity = 0xFFFE;
+
+  uint16 ComputeEntry(const char *key, int len) const {
+    if (HasLongerKey(da_, key, len)) {
+      return kFallback;
+    }
+    int result = 0;
+    const int mblen = LookupDoubleArray(da_, key, len, &result);
+    if (mblen == 0) {
+      return kIdentity;
+    }
+    const char *p = &ctable_[result];
+    if (mblen != len || p[strlen(p) + 1] != 0 || result >= kIdentity) {
+      return kFallback;
+    }
+    return static_cast<uint16>(result);
+  }
+
+  // Fills |block| for the 3-byte characters starting with |lead|.  |block|
+  // is left empty when no character in the block is converted.
+  void BuildBlock(uint8 lead, std::vector<uint16> *block) const {
+    std::vector<uint16> entries(kBlockSize);
+    bool identity = true;
+    char buf[3];
+    buf[0] = static_cast<char>(lead);
+    for (char32 i = 0; i < kBlockSize; ++i) {
+      buf[1] = static_cast<char>(0x80 | (i >> 6));
+      buf[2] = static_cast<char>(0x80 | (i & 0x3F));
+      entries[i] = ComputeEntry(buf, 3);
+      identity = identity && entries[i] == kIdentity;
+    }
+    if (!identity) {
+      block->swap(entries);
+    }
+  }
+
+  bool Append(uint16 entry, const char *begin, size_t len,
+              string *output) const {
+    if (entry == kFallback) {
+      return false;
+    }
+    if (entry == kIdentity) {
+      output->append(begin, len);
+    } else {
+      output->append(&ctable_[entry]);
+    }
+    return true;
+  }
+
+  const japanese_util_rule::DoubleArray *da_;
+  const char *ctable_;
+  std::vector<uint16> ascii_;
+  std::vector<uint16> e3_block_;
+  std::vector<uint16> ef_block_;
+  bool ascii_identity_;
+
+  DISALLOW_COPY_AND_ASSIGN(CharConversionCache);
+};
+
+class CharConversionCacheSet {
+ public:
+  CharConversionCacheSet() {
+#define ADD_RULE(name)                                            \
+    caches_.push_back(new CharConversionCache(                    \
+        japanese_util_rule::name##_da, japanese_util_rule::name##_table))
+    ADD_RULE(hiragana_to_katakana);
+    ADD_RULE(katakana_to_hiragana);
+    ADD_RULE(fullwidthkatakana_to_halfwidthkatakana);
+    ADD_RULE(halfwidthkatakana_to_fullwidthkatakana);
+    ADD_RULE(halfwidthascii_to_fullwidthascii);
+    ADD_RULE(fullwidthascii_to_halfwidthascii);
+#undef ADD_RULE
+  }
+
+  ~CharConversionCacheSet() {
+    for (size_t i = 0; i < caches_.size(); ++i) {
+      delete caches_[i];
+    }
+  }
+
+  // Returns NULL if |da| is not cached.
+  const CharConversionCache *Get(
+      const japanese_util_rule::DoubleArray *da) const {
+    for (size_t i = 0; i < caches_.size(); ++i) {
+      if (caches_[i]->da() == da) {
+        return caches_[i];
+      }
+    }
+    return NULL;
+  }
+
+ private:
+  std::vector<CharConversionCache *> caches_;
+
+  DISALLOW_COPY_AND_ASSIGN(CharConversionCacheSet);
+};
+
 }  // namespace
 
 void Util::ConvertUsingDoubleArray(const japanese_util_rule::DoubleArray *da,
@@ -1115,9 +1463,17 @@ void Util::ConvertUsingDoubleArray(const japanese_util_rule::DoubleArray *da,
                                    StringPiece input,
                                    string *output) {
   output->clear();
+  const CharConversionCache *cache =
+      Singleton<CharConversionCacheSet>::get()->Get(da);
   const char *begin = input.data();
   const char *const end = input.data() + input.size();
   while (begin < end) {
+    if (cache != NULL) {
+      begin = cache->Convert(begin, end, output);
+      if (begin == end) {
+        break;
+      }
+    }
     int result = 0;
     int mblen = LookupDoubleArray(da, begin, static_cast<int>(end - begin),
                                   &result);
@@ -1381,7 +1737,7 @@ bool Util::IsKanaSymbolContained(const string &input) {
   return false;
 }
 
-bool Util::IsEnglishTransliteration(const string &value) {
+bool Util::IsEnglishTransliteration(StringPiece value) {
   for (size_t i = 0; i < value.size(); ++i) {
     if (value[i] == 0x20 || value[i] == 0x21 ||
         value[i] == 0x27 || value[i] == 0x2D ||
@@ -1527,19 +1883,22 @@ void Util::EscapeCss(const string &plain, string *escaped) {
 
 #define INRANGE(w, a, b) ((w) >= (a) && (w) <= (b))
 
-// script type
+namespace {
+
+// Computes the script type of |w| from the code point ranges.  Use
+// Util::GetScriptType(), which caches the result for BMP, instead.
 // TODO(yukawa, team): Make a mechanism to keep this classifier up-to-date
 //   based on the original data from Unicode.org.
-Util::ScriptType Util::GetScriptType(char32 w) {
+Util::ScriptType ComputeScriptType(char32 w) {
   if (INRANGE(w, 0x0030, 0x0039) ||    // ascii number
       INRANGE(w, 0xFF10, 0xFF19)) {    // full width number
-    return NUMBER;
+    return Util::NUMBER;
   } else if (
       INRANGE(w, 0x0041, 0x005A) ||    // ascii upper
       INRANGE(w, 0x0061, 0x007A) ||    // ascii lower
       INRANGE(w, 0xFF21, 0xFF3A) ||    // fullwidth ascii upper
       INRANGE(w, 0xFF41, 0xFF5A)) {    // fullwidth ascii lower
-    return ALPHABET;
+    return Util::ALPHABET;
   } else if (
       w == 0x3005 ||                   // IDEOGRAPHIC ITERATION MARK "々"
       INRANGE(w, 0x3400, 0x4DBF) ||    // CJK Unified Ideographs Extension A
@@ -1557,17 +1916,17 @@ Util::ScriptType Util::GetScriptType(char32 w) {
     // [U+2A700, U+2B734]: CJK Unified Ideographs Extension C
     // [U+2B740, U+2B81D]: CJK Unified Ideographs Extension D
     // [U+2F800, U+2FA1D]: CJK Compatibility Ideographs
-    return KANJI;
+    return Util::KANJI;
   } else if (
       INRANGE(w, 0x3041, 0x309F) ||    // hiragana
       w == 0x1B001) {                  // HIRAGANA LETTER ARCHAIC YE
-    return HIRAGANA;
+    return Util::HIRAGANA;
   } else if (
       INRANGE(w, 0x30A1, 0x30FF) ||    // full width katakana
       INRANGE(w, 0x31F0, 0x31FF) ||    // Katakana Phonetic Extensions for Ainu
       INRANGE(w, 0xFF65, 0xFF9F) ||    // half width katakana
       w == 0x1B000) {                  // KATAKANA LETTER ARCHAIC E
-    return KATAKANA;
+    return Util::KATAKANA;
   } else if (
       INRANGE(w, 0x02300, 0x023F3) ||  // Miscellaneous Technical
       INRANGE(w, 0x02700, 0x027BF) ||  // Dingbats
@@ -1582,13 +1941,14 @@ Util::ScriptType Util::GetScriptType(char32 w) {
       INRANGE(w, 0x1F700, 0x1F77F) ||  // Alchemical Symbols
       w == 0x26CE ||                   // Ophiuchus
       INRANGE(w, kUcs4MinGooglePuaEmoji, kUcs4MaxGooglePuaEmoji)) {
-    return EMOJI;
+    return Util::EMOJI;
   }
 
-  return UNKNOWN_SCRIPT;
+  return Util::UNKNOWN_SCRIPT;
 }
 
-Util::FormType Util::GetFormType(char32 w) {
+// Computes the form type of |w|.  Use Util::GetFormType() instead.
+Util::FormType ComputeFormType(char32 w) {
   // 'Unicode Standard Annex #11: EAST ASIAN WIDTH'
   // http://www.unicode.org/reports/tr11/
 
@@ -1597,7 +1957,7 @@ Util::FormType Util::GetFormType(char32 w) {
   if (INRANGE(w, 0x0020, 0x007F) ||  // ascii
       INRANGE(w, 0x27E6, 0x27ED) ||  // narrow mathematical symbols
       INRANGE(w, 0x2985, 0x2986)) {  // narrow white parentheses
-    return HALF_WIDTH;
+    return Util::HALF_WIDTH;
   }
 
   // Other characters marked as 'Na' in
@@ -1610,7 +1970,7 @@ Util::FormType Util::GetFormType(char32 w) {
       case 0x00A6:  // BROKEN BAR
       case 0x00AC:  // NOT SIGN
       case 0x00AF:  // MACRON
-        return HALF_WIDTH;
+        return Util::HALF_WIDTH;
     }
   }
 
@@ -1623,12 +1983,14 @@ Util::FormType Util::GetFormType(char32 w) {
       INRANGE(w, 0xFFD2, 0xFFD7) ||  // half-width hangul
       INRANGE(w, 0xFFDA, 0xFFDC) ||  // half-width hangul
       INRANGE(w, 0xFFE8, 0xFFEE)) {  // half-width symbols
-    return HALF_WIDTH;
+    return Util::HALF_WIDTH;
   }
 
-  return FULL_WIDTH;
+  return Util::FULL_WIDTH;
 }
 
+}  // namespace
+
 #undef INRANGE
 
 // return script type of first character in str
@@ -1640,48 +2002,75 @@ Util::ScriptType Util::GetScriptType(const char *begin,
 
 namespace {
 
-Util::ScriptType GetScriptTypeInternal(StringPiece str, bool ignore_symbols) {
-  Util::ScriptType result = Util::SCRIPT_TYPE_SIZE;
-
-  for (ConstChar32Iterator iter(str); !iter.Done(); iter.Next()) {
-    const char32 w = iter.Get();
-    Util::ScriptType type = Util::GetScriptType(w);
+// Computes the script type of a string from the script types of its
+// characters, which are given one by one by Add().
+class ScriptTypeAccumulator {
+ public:
+  explicit ScriptTypeAccumulator(bool ignore_symbols)
+      : ignore_symbols_(ignore_symbols),
+        result_(Util::SCRIPT_TYPE_SIZE),
+        mixed_(false) {}
+
+  void Add(char32 w, Util::ScriptType type) {
+    if (mixed_) {
+      return;
+    }
     if ((w == 0x30FC || w == 0x30FB || (w >= 0x3099 && w <= 0x309C)) &&
         // PROLONGEDSOUND MARK|MIDLE_DOT|VOICED_SOUND_MARKS
         // are HIRAGANA as well
-        (result == Util::SCRIPT_TYPE_SIZE ||
-         result == Util::HIRAGANA || result == Util::KATAKANA)) {
-      type = result;  // restore the previous state
+        (result_ == Util::SCRIPT_TYPE_SIZE ||
+         result_ == Util::HIRAGANA || result_ == Util::KATAKANA)) {
+      type = result_;  // restore the previous state
     }
 
     // Ignore symbols
     // Regard UNKNOWN_SCRIPT as symbols here
-    if (ignore_symbols &&
-        result != Util::UNKNOWN_SCRIPT &&
+    if (ignore_symbols_ &&
+        result_ != Util::UNKNOWN_SCRIPT &&
         type == Util::UNKNOWN_SCRIPT) {
-      continue;
+      return;
     }
 
     // Periods are NUMBER as well, if it is not the first character.
     // 0xFF0E == '．', 0x002E == '.' in UCS4 encoding.
-    if (result == Util::NUMBER && (w == 0xFF0E || w == 0x002E)) {
-      continue;
+    if (result_ == Util::NUMBER && (w == 0xFF0E || w == 0x002E)) {
+      return;
     }
 
     // Not first character.
     // Note: GetScriptType doesn't return SCRIPT_TYPE_SIZE, thus if result
     // is not SCRIPT_TYPE_SIZE, it is not the first character.
-    if (result != Util::SCRIPT_TYPE_SIZE && type != result) {
-      return Util::UNKNOWN_SCRIPT;
+    if (result_ != Util::SCRIPT_TYPE_SIZE && type != result_) {
+      mixed_ = true;
+      return;
     }
-    result = type;
+    result_ = type;
   }
 
-  if (result == Util::SCRIPT_TYPE_SIZE) {  // everything is "ー"
-    return Util::UNKNOWN_SCRIPT;
+  // Returns true if the result is already determined to be mixed.
+  bool mixed() const { return mixed_; }
+
+  Util::ScriptType result() const {
+    // SCRIPT_TYPE_SIZE means that everything is "ー".
+    if (mixed_ || result_ == Util::SCRIPT_TYPE_SIZE) {
+      return Util::UNKNOWN_SCRIPT;
+    }
+    return result_;
   }
 
-  return result;
+ private:
+  const bool ignore_symbols_;
+  Util::ScriptType result_;
+  bool mixed_;
+};
+
+Util::ScriptType GetScriptTypeInternal(StringPiece str, bool ignore_symbols) {
+  ScriptTypeAccumulator accumulator(ignore_symbols);
+  for (ConstChar32Iterator iter(str); !iter.Done() && !accumulator.mixed();
+       iter.Next()) {
+    accumulator.Add(iter.Get(), Util::GetScriptType(iter.Get()));
+  }
+  return accumulator.result();
 }
 
 }  // namespace
@@ -1701,12 +2090,93 @@ Util::ScriptType Util::GetScriptTypeWithoutSymbols(const string &str) {
   return GetScriptTypeInternal(str, true);
 }
 
+// Util::CharcterSet Util::GetCharacterSet(char32 ucs4);
+#include "base/character_set.inc"
+
+namespace {
+
+// The properties of a code point packed in a byte: the script type in bits
+// 0-2, the form type in bits 3-4 and the character set in bits 5-7.
+inline uint8 PackProperties(Util::ScriptType script, Util::FormType form,
+                            Util::CharacterSet character_set) {
+  return static_cast<uint8>(script | (form << 3) | (character_set << 5));
+}
+
+inline Util::ScriptType GetPackedScriptType(uint8 properties) {
+  return static_cast<Util::ScriptType>(properties & 0x07);
+}
+
+inline Util::FormType GetPackedFormType(uint8 properties) {
+  return static_cast<Util::FormType>((properties >> 3) & 0x03);
+}
+
+inline Util::CharacterSet GetPackedCharacterSet(uint8 properties) {
+  return static_cast<Util::CharacterSet>(properties >> 5);
+}
+
+uint8 ComputeProperties(char32 w) {
+  return PackProperties(ComputeScriptType(w), ComputeFormType(w),
+                        Util::GetCharacterSet(w));
+}
+
+// Two-level table of the packed properties of the code points in BMP.  The
+// code points are split into 256 blocks of 256 code points, and blocks with
+// the same contents share the storage, which amounts to a few tens of KB.
+// Code points outside BMP are rare and are computed on demand.
+class CharacterPropertyTable {
+ public:
+  CharacterPropertyTable() {
+    std::map<std::vector<uint8>, uint8> block_ids;
+    std::vector<uint8> block(kBlockSize);
+    for (char32 high = 0; high < kNumBlocks; ++high) {
+      for (char32 low = 0; low < kBlockSize; ++low) {
+        block[low] = ComputeProperties(high * kBlockSize + low);
+      }
+      const auto result = block_ids.insert(
+          std::make_pair(block, static_cast<uint8>(block_ids.size())));
+      if (result.second) {
+        blocks_.insert(blocks_.end(), block.begin(), block.end());
+      }
+      index_[high] = result.first->second;
+    }
+  }
+
+  uint8 Get(char32 w) const {
+    if (w >= kNumBlocks * kBlockSize) {
+      return ComputeProperties(w);
+    }
+    return blocks_[index_[w / kBlockSize] * kBlockSize + w % kBlockSize];
+  }
+
+ private:
+  static const char32 kBlockSize = 256;
+  static const char32 kNumBlocks = 256;
+
+  uint8 index_[kNumBlocks];
+  std::vector<uint8> blocks_;
+
+  DISALLOW_COPY_AND_ASSIGN(CharacterPropertyTable);
+};
+
+}  // namespace
+
+Util::ScriptType Util::GetScriptType(char32 w) {
+  return GetPackedScriptType(Singleton<CharacterPropertyTable>::get()->Get(w));
+}
+
+Util::FormType Util::GetFormType(char32 w) {
+  return GetPackedFormType(Singleton<CharacterPropertyTable>::get()->Get(w));
+}
+
 // return true if all script_type in str is "type"
 bool Util::IsScriptType(StringPiece str, Util::ScriptType type) {
+  const CharacterPropertyTable &table =
+      *Singleton<CharacterPropertyTable>::get();
   for (ConstChar32Iterator iter(str); !iter.Done(); iter.Next()) {
     const char32 w = iter.Get();
     // Exception: 30FC (PROLONGEDSOUND MARK is categorized as HIRAGANA as well)
-    if (type != GetScriptType(w) && (w != 0x30FC || type != HIRAGANA)) {
+    if (type != GetPackedScriptType(table.Get(w)) &&
+        (w != 0x30FC || type != HIRAGANA)) {
       return false;
     }
   }
@@ -1715,8 +2185,10 @@ bool Util::IsScriptType(StringPiece str, Util::ScriptType type) {
 
 // return true if the string contains script_type char
 bool Util::ContainsScriptType(StringPiece str, ScriptType type) {
+  const CharacterPropertyTable &table =
+      *Singleton<CharacterPropertyTable>::get();
   for (ConstChar32Iterator iter(str); !iter.Done(); iter.Next()) {
-    if (type == GetScriptType(iter.Get())) {
+    if (type == GetPackedScriptType(table.Get(iter.Get()))) {
       return true;
     }
   }
@@ -1725,11 +2197,13 @@ bool Util::ContainsScriptType(StringPiece str, ScriptType type) {
 
 // return the Form Type of string
 Util::FormType Util::GetFormType(const string &str) {
+  const CharacterPropertyTable &table =
+      *Singleton<CharacterPropertyTable>::get();
   // TODO(hidehiko): get rid of using FORM_TYPE_SIZE.
   FormType result = FORM_TYPE_SIZE;
 
   for (ConstChar32Iterator iter(str); !iter.Done(); iter.Next()) {
-    const FormType type = GetFormType(iter.Get());
+    const FormType type = GetPackedFormType(table.Get(iter.Get()));
     if (type == UNKNOWN_FORM ||
         (result != FORM_TYPE_SIZE && type != result)) {
       return UNKNOWN_FORM;
@@ -1740,17 +2214,71 @@ Util::FormType Util::GetFormType(const string &str) {
   return result;
 }
 
-// Util::CharcterSet Util::GetCharacterSet(char32 ucs4);
-#include "base/character_set.inc"
-
 Util::CharacterSet Util::GetCharacterSet(StringPiece str) {
+  const CharacterPropertyTable &table =
+      *Singleton<CharacterPropertyTable>::get();
   CharacterSet result = ASCII;
   for (ConstChar32Iterator iter(str); !iter.Done(); iter.Next()) {
-    result = std::max(result, GetCharacterSet(iter.Get()));
+    result = std::max(result, GetPackedCharacterSet(table.Get(iter.Get())));
   }
   return result;
 }
 
+void Util::ClassifyString(StringPiece str, StringClassification *result) {
+  DCHECK(result);
+  const CharacterPropertyTable &table =
+      *Singleton<CharacterPropertyTable>::get();
+  ScriptTypeAccumulator script_type(false);
+  ScriptTypeAccumulator script_type_without_symbols(true);
+  FormType form_type = FORM_TYPE_SIZE;
+  CharacterSet character_set = ASCII;
+  uint32 script_type_mask = 0;
+  size_t chars_len = 0;
+
+  const auto add = [&](char32 w) {
+    const uint8 properties = table.Get(w);
+    const ScriptType type = GetPackedScriptType(properties);
+    script_type.Add(w, type);
+    script_type_without_symbols.Add(w, type);
+    const FormType form = GetPackedFormType(properties);
+    if (form_type != UNKNOWN_FORM) {
+      form_type = (form_type == FORM_TYPE_SIZE || form_type == form)
+                      ? form : UNKNOWN_FORM;
+    }
+    character_set = std::max(character_set, GetPackedCharacterSet(properties));
+    script_type_mask |= 1 << type;
+    ++chars_len;
+  };
+
+  const char *ptr = str.data();
+  const char *const end = str.data() + str.size();
+  while (ptr < end) {
+    // Runs of ASCII, e.g., in romaji input and numbers, are checked 8 bytes at
+    // a time and don't need UTF-8 decoding.
+    if (end - ptr >= 8 && IsAsciiWord(ptr)) {
+      for (const char *word_end = ptr + 8; ptr < word_end; ++ptr) {
+        add(static_cast<uint8>(*ptr));
+      }
+      continue;
+    }
+    char32 w = 0;
+    StringPiece rest;
+    if (!SplitFirstChar32(StringPiece(ptr, end - ptr), &w, &rest)) {
+      // Stops at an invalid sequence like ConstChar32Iterator.
+      break;
+    }
+    add(w);
+    ptr = end - rest.size();
+  }
+
+  result->script_type = script_type.result();
+  result->script_type_without_symbols = script_type_without_symbols.result();
+  result->form_type = form_type;
+  result->character_set = character_set;
+  result->script_type_mask = script_type_mask;
+  result->chars_len = chars_len;
+}
+
 // CAUTION: Be careful to change the implementation of serialization.  Some
 // files use this format, so compatibility can be lost.  See, e.g.,
 // data_manager/dataset_writer.cc.
@@ -333,7 +333,7 @@ class Util {
   static bool IsKanaSymbolContained(const string &input);
 
   // Returns true if |input| looks like a pure English word.
-  static bool IsEnglishTransliteration(const string &input);
+  static bool IsEnglishTransliteration(StringPiece input);
 
   static void NormalizeVoicedSoundMark(StringPiece input, string *output);
 
@@ -451,6 +451,24 @@ class Util {
   // the maximum character set.
   static CharacterSet GetCharacterSet(StringPiece str);
 
+  // The properties of a string computed by ClassifyString().
+  struct StringClassification {
+    ScriptType script_type;  // The same as GetScriptType(str).
+    // The same as GetScriptTypeWithoutSymbols(str).
+    ScriptType script_type_without_symbols;
+    FormType form_type;  // The same as GetFormType(str).
+    CharacterSet character_set;  // The same as GetCharacterSet(str).
+    // The bit (1 << type) is set if ContainsScriptType(str, type).
+    uint32 script_type_mask;
+    // The number of characters, which is CharsLen(str) for valid UTF-8.
+    size_t chars_len;
+  };
+
+  // Computes all the properties above in a single pass over |str|.  Use this
+  // function instead of calling the functions above one by one when more than
+  // one property of the same string is needed.
+  static void ClassifyString(StringPiece str, StringClassification *result);
+
   // Serializes uint64 into a string of eight byte.
   static string SerializeUint64(uint64 x);
 
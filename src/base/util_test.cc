@@ -29,12 +29,14 @@
 
 #include "base/util.h"
 
+#include <algorithm>
 #include <climits>
 #include <cstdlib>
 #include <cstring>
 #include <map>
 #include <sstream>
 #include <string>
+#include <vector>
 
 #include "base/compiler_specific.h"
 #include "base/file_stream.h"
@@ -809,6 +811,63 @@ TEST(UtilTest, CharsLen) {
   EXPECT_EQ(Util::CharsLen(src.c_str(), src.size()), 9);
 }
 
+namespace {
+
+// Counts the characters one by one as OneCharLen() tells.
+size_t CharsLenOneByOne(StringPiece src) {
+  size_t result = 0;
+  for (size_t i = 0; i < src.size(); i += Util::OneCharLen(src.data() + i)) {
+    ++result;
+  }
+  return result;
+}
+
+}  // namespace
+
+TEST(UtilTest, CharsLenLongString) {
+  const string kChars[] = {"a", "\xC3\xA9", "\xE3\x81\x82", "\xF0\x9F\x98\x80"};
+  string src;
+  for (int i = 0; i < 100; ++i) {
+    src += kChars[(i * 7) % arraysize(kChars)];
+    EXPECT_EQ(i + 1, Util::CharsLen(src)) << src;
+  }
+
+  // Malformed strings are counted in the same way as the valid ones, i.e.,
+  // each byte not following the first byte of a character is a character.
+  const char *kMalformed[] = {
+    "\x80\x80\x80\x80\x80\x80\x80\x80\x80\x80\x80\x80\x80\x80\x80\x80\x80",
+    "\xE3\x81\xE3\x81\x82\xE3\x81\x82\xE3\x81\x82\xE3\x81\x82\xE3\x81",
+    "abcdefghijklmno\xE3\x81",
+    "abcdefghijklmnopqrstuvwxyz\xF0",
+  };
+  for (size_t i = 0; i < arraysize(kMalformed); ++i) {
+    EXPECT_EQ(CharsLenOneByOne(kMalformed[i]), Util::CharsLen(kMalformed[i]))
+        << kMalformed[i];
+  }
+}
+
+TEST(UtilTest, SubStringPieceLongString) {
+  string src;
+  std::vector<size_t> offsets;
+  for (int i = 0; i < 50; ++i) {
+    offsets.push_back(src.size());
+    src += (i % 3 == 0) ? "x" : "\xE3\x81\x82";
+  }
+  offsets.push_back(src.size());
+  for (size_t start = 0; start < offsets.size(); ++start) {
+    const StringPiece result = Util::SubStringPiece(src, start, 5);
+    const size_t end = offsets[std::min(start + 5, offsets.size() - 1)];
+    EXPECT_EQ(src.data() + offsets[start], result.data());
+    EXPECT_EQ(end - offsets[start], result.size());
+  }
+  EXPECT_TRUE(Util::SubStringPiece(src, 51).empty());
+
+  // A character cut off at the end is not returned beyond the end.
+  const string truncated = src + "\xE3";
+  EXPECT_EQ("\xE3", Util::SubStringPiece(truncated, 50));
+  EXPECT_TRUE(Util::SubStringPiece(truncated, 51).empty());
+}
+
 TEST(UtilTest, SubStringPiece) {
   const string src = "私の名前は中野です";
   StringPiece result;
@@ -1092,6 +1151,34 @@ TEST(UtilTest, KatakanaToHiragana) {
   }
 }
 
+TEST(UtilTest, KanaAndWidthConversionWithMixedScripts) {
+  string output;
+
+  // Multi-character rules take precedence over single characters.
+  Util::HiraganaToKatakana("う゛うあ", &output);
+  EXPECT_EQ("ヴウア", output);
+  Util::HalfWidthKatakanaToFullWidthKatakana("ｶﾞｷｶ", &output);
+  EXPECT_EQ("ガキカ", output);
+  Util::FullWidthKatakanaToHalfWidthKatakana("ガキ", &output);
+  EXPECT_EQ("ｶﾞｷ", output);
+
+  // Long ASCII runs around converted characters.
+  Util::HiraganaToKatakana("abcdefghijklmnopqrstuvwxyzあbcdefghい", &output);
+  EXPECT_EQ("abcdefghijklmnopqrstuvwxyzアbcdefghイ", output);
+  Util::FullWidthAsciiToHalfWidthAscii("0123456789ａ0123456789ｂ", &output);
+  EXPECT_EQ("0123456789a0123456789b", output);
+
+  // ASCII characters which are not mapped to U+FFxx.
+  Util::HalfWidthAsciiToFullWidthAscii("a-b~c\\d\"", &output);
+  EXPECT_EQ("ａ−ｂ〜ｃ￥ｄ”", output);
+  Util::FullWidthAsciiToHalfWidthAscii("ａ−ｂ〜ｃ￥ｄ”", &output);
+  EXPECT_EQ("a-b~c\\d\"", output);
+
+  // Characters outside the rules are kept as is.
+  Util::KatakanaToHiragana("漢字カナ㌔ｶﾅ", &output);
+  EXPECT_EQ("漢字かな㌔ｶﾅ", output);
+}
+
 TEST(UtilTest, RomanjiToHiragana) {
   struct {
     const char *input;
@@ -1635,6 +1722,38 @@ TEST(UtilTest, CharacterSet) {
   EXPECT_EQ(Util::UNICODE_ONLY, Util::GetCharacterSet("\xF0\xA0\xAE\xB7"));
 }
 
+TEST(UtilTest, ClassifyString) {
+  const char *kInputs[] = {
+      "", "abc", "012", "1.5", "Google Earth", "CD-ROMア", "くどう",
+      "ひらがなー", "ｶﾀｶﾅｰ", "ｶﾀｶﾅカタカナ", "京あ都", "０１２あ012",
+      "人☆名", "・--☆", "&-()", "&-（）", "abcdefghijklmnopqrstuvwxyz",
+      "abcdefgh012345678あいうえおabcdefgh",
+      "\xF0\xA0\xAE\x9F\xE5\x92\xA4", "\xf3\xbe\x80\x83", "Ⅰ①", "凬", "￦",
+  };
+  for (const char *input : kInputs) {
+    Util::StringClassification result;
+    Util::ClassifyString(input, &result);
+    EXPECT_EQ(Util::GetScriptType(input), result.script_type) << input;
+    EXPECT_EQ(Util::GetScriptTypeWithoutSymbols(input),
+              result.script_type_without_symbols) << input;
+    EXPECT_EQ(Util::GetFormType(input), result.form_type) << input;
+    EXPECT_EQ(Util::GetCharacterSet(input), result.character_set) << input;
+    EXPECT_EQ(Util::CharsLen(input), result.chars_len) << input;
+    for (int type = 0; type < Util::SCRIPT_TYPE_SIZE; ++type) {
+      EXPECT_EQ(Util::ContainsScriptType(input,
+                                         static_cast<Util::ScriptType>(type)),
+                (result.script_type_mask & (1 << type)) != 0)
+          << input << " " << type;
+    }
+  }
+
+  // Stops at an invalid UTF-8 sequence.
+  Util::StringClassification result;
+  Util::ClassifyString("ab\xff" "cd", &result);
+  EXPECT_EQ(2, result.chars_len);
+  EXPECT_EQ(Util::ALPHABET, result.script_type);
+}
+
 #ifdef OS_WIN
 TEST(UtilTest, WideCharsLen) {
   // "að ®b"
@@ -63,7 +63,8 @@ class DictionaryDownloader {
   // Downloading will be started after start_delay + [0 - random_delay] msec.
   // If failed, 1st retry is started after retry_interval + [0 - random_delay].
   // While the retry count is less than retry_backoff_count, retry_interval will
-  // be doubled.
+  // be doubled.  Each retry resumes the download from where the previous
+  // attempt stopped.
   void StartDownload();
   DownloadStatus GetStatus();
 
@@ -175,6 +175,7 @@
         '../../dictionary/dictionary_base.gyp:user_dictionary',
         '../../dictionary/dictionary_base.gyp:user_pos',
         '../../engine/engine.gyp:engine',
+        '../../engine/engine.gyp:engine_builder',
         '../../net/net.gyp:http_client',
         '../../net/net.gyp:json_util',
         '../../protocol/protocol.gyp:commands_proto',
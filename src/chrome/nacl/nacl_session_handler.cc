@@ -58,12 +58,14 @@
 #include "dictionary/user_dictionary_util.h"
 #include "dictionary/user_pos.h"
 #include "engine/engine.h"
+#include "engine/engine_builder.h"
 #include "net/http_client.h"
 #include "net/http_client_pepper.h"
 #include "net/json_util.h"
 #include "net/jsoncpp.h"
 #include "protocol/commands.pb.h"
 #include "protocol/config.pb.h"
+#include "protocol/engine_builder.pb.h"
 #include "session/session_handler.h"
 #include "session/session_usage_observer.h"
 #include "usage_stats/usage_stats.h"
@@ -77,6 +79,14 @@ namespace {
 // TODO(horo): Need to confirm that this 1024 is OK.
 const uint32 kFileIoFileSystemExpectedSize = 1024;
 
+#ifdef GOOGLE_JAPANESE_INPUT_BUILD
+// The big dictionary data in the user's HTML5 file system.
+const char kBigDictionaryPath[] = "/mozc.data";
+// The big dictionary data being downloaded.  It is renamed to
+// kBigDictionaryPath after it is verified.
+const char kBigDictionaryDownloadPath[] = "/mozc.data.download";
+#endif  // GOOGLE_JAPANESE_INPUT_BUILD
+
 // Wrapper class of pthread_cond.
 class Condition {
  public:
@@ -182,6 +192,7 @@ class MozcSessionHandlerThread : public Thread {
     std::unique_ptr<DataManager> data_manager;
 #ifdef GOOGLE_JAPANESE_INPUT_BUILD
     data_manager_status_ = DataManager::Status::UNKNOWN;
+    engine_reload_requested_ = false;
     const bool filesystem_available =
         PepperFileUtil::Initialize(instance_, kFileIoFileSystemExpectedSize);
     if (!filesystem_available) {
@@ -207,8 +218,16 @@ class MozcSessionHandlerThread : public Thread {
         << "Unexpected failure: Data manager shoulnd't be nullptr";
 
     user_pos_.reset(dictionary::UserPOS::CreateFromDataManager(*data_manager));
+#ifdef GOOGLE_JAPANESE_INPUT_BUILD
+    // The engine builder switches the engine to the big dictionary when its
+    // download completes.
+    handler_.reset(new SessionHandler(
+        mozc::Engine::CreateDesktopEngine(std::move(data_manager)),
+        std::unique_ptr<EngineBuilderInterface>(new EngineBuilder())));
+#else  // GOOGLE_JAPANESE_INPUT_BUILD
     handler_.reset(new SessionHandler(
         mozc::Engine::CreateDesktopEngine(std::move(data_manager))));
+#endif  // GOOGLE_JAPANESE_INPUT_BUILD
 
 #ifdef GOOGLE_JAPANESE_INPUT_BUILD
     usage_observer_.reset(new SessionUsageObserver());
@@ -258,12 +277,20 @@ class MozcSessionHandlerThread : public Thread {
         LOG(ERROR) << "request error";
         continue;
       }
+#ifdef GOOGLE_JAPANESE_INPUT_BUILD
+      MaybeRequestEngineReload();
+#endif  // GOOGLE_JAPANESE_INPUT_BUILD
       Json::Value response(Json::objectValue);
       response["id"] = (*message)["id"];
       if (message->isMember("cmd")) {
         commands::Command command;
         JsonUtil::JsonValueToProtobufMessage((*message)["cmd"], &command);
         handler_->EvalCommand(&command);
+#ifdef GOOGLE_JAPANESE_INPUT_BUILD
+        if (command.output().has_engine_reload_response()) {
+          OnEngineReloadResponse(command.output().engine_reload_response());
+        }
+#endif  // GOOGLE_JAPANESE_INPUT_BUILD
         JsonUtil::ProtobufMessageToJsonValue(command, &response["cmd"]);
       }
       if (message->isMember("event") && (*message)["event"].isMember("type")) {
@@ -308,15 +335,16 @@ class MozcSessionHandlerThread : public Thread {
       DataManager::Status *status) {
     std::unique_ptr<DataManager> data_manager(new DataManager());
     // The big dictionary data is in the user's HTML5 file system.
-    *status = data_manager->InitFromFile("/mozc.data");
+    *status = data_manager->InitFromFile(kBigDictionaryPath);
     return data_manager;
   }
 
-  // Starts downloading the big dictionary.
+  // Starts downloading the big dictionary.  The download is resumed if the
+  // previous session left a partially downloaded file.
   void StartDownloadDictionary() {
     downloader_.reset(new chrome::nacl::DictionaryDownloader(
         Version::GetMozcNaclDictionaryUrl(),
-        "/mozc.data"));
+        kBigDictionaryDownloadPath));
     downloader_->SetOption(10 * 60 * 1000,  // 10 minutes start delay
                            20 * 60 * 1000,  // + [0-20] minutes random delay
                            30 * 60 * 1000,  // retry_interval 30 min
@@ -324,6 +352,54 @@ class MozcSessionHandlerThread : public Thread {
                            10);  // 10 retries
     downloader_->StartDownload();
   }
+
+  // Once the big dictionary has been downloaded, requests the engine builder
+  // to verify it, install it to kBigDictionaryPath and build a new engine in
+  // the background.  The session handler switches to the new engine when no
+  // session is alive, so the small dictionary is used until then.
+  void MaybeRequestEngineReload() {
+    if (!downloader_ || engine_reload_requested_ ||
+        downloader_->GetStatus() !=
+            chrome::nacl::DictionaryDownloader::DOWNLOAD_FINISHED) {
+      return;
+    }
+    engine_reload_requested_ = true;
+    commands::Command command;
+    command.mutable_input()->set_type(
+        commands::Input::SEND_ENGINE_RELOAD_REQUEST);
+    EngineReloadRequest *request =
+        command.mutable_input()->mutable_engine_reload_request();
+    request->set_engine_type(EngineReloadRequest::DESKTOP);
+    request->set_file_path(kBigDictionaryDownloadPath);
+    request->set_install_location(kBigDictionaryPath);
+    handler_->EvalCommand(&command);
+    if (command.output().has_engine_reload_response()) {
+      OnEngineReloadResponse(command.output().engine_reload_response());
+    }
+  }
+
+  void OnEngineReloadResponse(const EngineReloadResponse &response) {
+    switch (response.status()) {
+      case EngineReloadResponse::ACCEPTED:
+      case EngineReloadResponse::RELOAD_READY:
+        return;
+      case EngineReloadResponse::ALREADY_RUNNING:
+        // Requests again later.
+        engine_reload_requested_ = false;
+        return;
+      case EngineReloadResponse::RELOADED:
+        LOG(INFO) << "Switched to the big dictionary";
+        data_manager_status_ = DataManager::Status::OK;
+        return;
+      default:
+        // The downloaded data is broken.  Removes it so that it is downloaded
+        // from the beginning next time.
+        LOG(ERROR) << "Failed to install the big dictionary: "
+                   << EngineReloadResponse::Status_Name(response.status());
+        PepperFileUtil::Delete(kBigDictionaryDownloadPath);
+        return;
+    }
+  }
 #endif  // GOOGLE_JAPANESE_INPUT_BUILD
 
   // Loads the dictionary.
@@ -436,6 +512,7 @@ class MozcSessionHandlerThread : public Thread {
   std::unique_ptr<SessionUsageObserver> usage_observer_;
   std::unique_ptr<chrome::nacl::DictionaryDownloader> downloader_;
   DataManager::Status data_manager_status_;
+  bool engine_reload_requested_;
 #endif  // GOOGLE_JAPANESE_INPUT_BUILD
   DISALLOW_COPY_AND_ASSIGN(MozcSessionHandlerThread);
 };
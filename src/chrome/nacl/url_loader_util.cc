@@ -31,8 +31,9 @@
 
 #include "chrome/nacl/url_loader_util.h"
 
-#include <algorithm>
+#include <cstdio>
 #include <memory>
+#include <vector>
 
 #include <ppapi/c/pp_file_info.h>
 #include <ppapi/c/ppb_file_io.h>
@@ -43,10 +44,12 @@
 #include <ppapi/cpp/url_loader.h>
 #include <ppapi/cpp/url_request_info.h>
 #include <ppapi/cpp/url_response_info.h>
+#include <ppapi/cpp/var.h>
 #include <ppapi/utility/completion_callback_factory.h>
 
 #include "base/logging.h"
 #include "base/port.h"
+#include "base/util.h"
 
 using std::unique_ptr;
 
@@ -56,27 +59,66 @@ namespace nacl {
 
 namespace {
 const int32_t kReadBufferSize = 32768;
+// The size of a range request.  Each chunk is flushed to the file system when
+// it is received, so at most one chunk is lost when the connection drops.
+const int64_t kChunkSize = 1024 * 1024;
+const int64_t kFileSystemExpectedSize = 100 * 1024 * 1024;
 
-class URLLoaderStreamToFileHandler {
+// Parses "Content-Range: bytes <first>-<last>/<total>" (or
+// "bytes */<total>") in |headers|.  |first| is set to -1 for the latter form.
+bool ParseContentRange(const string &headers, int64_t *first,
+                       int64_t *total) {
+  std::vector<string> lines;
+  Util::SplitStringUsing(headers, "\r\n", &lines);
+  const char kContentRange[] = "content-range:";
+  for (size_t i = 0; i < lines.size(); ++i) {
+    string line = lines[i];
+    Util::LowerString(&line);
+    if (!Util::StartsWith(line, kContentRange)) {
+      continue;
+    }
+    long long range_first = -1;  // NOLINT
+    long long range_last = -1;  // NOLINT
+    long long range_total = -1;  // NOLINT
+    const char *value = line.c_str() + arraysize(kContentRange) - 1;
+    if (sscanf(value, " bytes %lld-%lld/%lld",
+               &range_first, &range_last, &range_total) == 3 ||
+        sscanf(value, " bytes */%lld", &range_total) == 1) {
+      *first = range_first;
+      *total = range_total;
+      return true;
+    }
+    return false;
+  }
+  return false;
+}
+
+// Downloads the file with range requests and streams the response bodies
+// directly into the output file.  The existing content of the output file is
+// treated as the head of the data, so an interrupted download is resumed from
+// where it stopped.
+class URLLoaderRangeDownloadHandler {
  public:
-  URLLoaderStreamToFileHandler(pp::Instance *instance,
-                               const string &url,
-                               const string &file_name,
-                               pp::CompletionCallback callback);
+  URLLoaderRangeDownloadHandler(pp::Instance *instance,
+                                const string &url,
+                                const string &file_name,
+                                pp::CompletionCallback callback);
   void Start();
 
  private:
-  // "delete this" is called in URLLoaderStreamToFileHandler::Complete().
-  ~URLLoaderStreamToFileHandler();
+  // "delete this" is called in URLLoaderRangeDownloadHandler::Complete().
+  ~URLLoaderRangeDownloadHandler();
   void StartImpl(int32_t result);
-  void OnOpen(int32 result);
-  void OnStreamComplete(int32 result);
-  void OnInputFileOpen(int32_t result);
-  void OnInputFileQuery(int32_t result);
   void OnFileSystemOpen(int32_t result);
-  void OnDeleteOutputFile(int32_t result);
   void OnOutputFileOpen(int32_t result);
-  void OnInputFileRead(int32_t bytes_read);
+  void OnOutputFileQuery(int32_t result);
+  void RequestNextChunk();
+  void OnOpen(int32 result);
+  void OnOutputFileTruncate(int32_t result);
+  void OnOutputFileReset(int32_t result);
+  void ReadBody();
+  void OnRead(int32_t bytes_read);
+  void WriteBuffer();
   void OnOutputFileWrite(int32_t bytes_written);
   void OnOutputFileFlush(int32_t result);
   void Complete(bool result);
@@ -87,23 +129,24 @@ class URLLoaderStreamToFileHandler {
   pp::CompletionCallback callback_;
   unique_ptr<pp::URLRequestInfo> url_request_;
   unique_ptr<pp::URLLoader> url_loader_;
-  pp::URLResponseInfo url_response_;
-  pp::FileRef body_file_ref_;
-  pp::CompletionCallbackFactory<URLLoaderStreamToFileHandler> callback_factory_;
+  pp::CompletionCallbackFactory<URLLoaderRangeDownloadHandler>
+      callback_factory_;
   unique_ptr<pp::FileSystem> file_system_;
   unique_ptr<pp::FileRef> output_file_ref_;
   unique_ptr<pp::FileIO> output_file_io_;
-  unique_ptr<pp::FileIO> input_file_io_;
-  PP_FileInfo input_file_info_;
-  int64_t total_read_bytes_;
-  int64_t total_written_bytes_;
-  int64_t buffer_written_bytes_;
+  PP_FileInfo output_file_info_;
+  // The number of bytes stored in the output file.
+  int64_t offset_;
+  // The size of the whole data.  -1 if the server didn't tell it.
+  int64_t total_size_;
+  int32_t buffer_size_;
+  int32_t buffer_written_bytes_;
   unique_ptr<char[]> tmp_buffer_;
 
-  DISALLOW_COPY_AND_ASSIGN(URLLoaderStreamToFileHandler);
+  DISALLOW_COPY_AND_ASSIGN(URLLoaderRangeDownloadHandler);
 };
 
-URLLoaderStreamToFileHandler::URLLoaderStreamToFileHandler(
+URLLoaderRangeDownloadHandler::URLLoaderRangeDownloadHandler(
     pp::Instance *instance,
     const string &url,
     const string &file_name,
@@ -112,15 +155,16 @@ URLLoaderStreamToFileHandler::URLLoaderStreamToFileHandler(
       url_(url),
       file_name_(file_name),
       callback_(callback),
-      total_read_bytes_(0),
-      total_written_bytes_(0),
+      offset_(0),
+      total_size_(-1),
+      buffer_size_(0),
       buffer_written_bytes_(0) {
 }
 
-URLLoaderStreamToFileHandler::~URLLoaderStreamToFileHandler() {
+URLLoaderRangeDownloadHandler::~URLLoaderRangeDownloadHandler() {
 }
 
-void URLLoaderStreamToFileHandler::Start() {
+void URLLoaderRangeDownloadHandler::Start() {
   callback_factory_.Initialize(this);
   if (pp::Module::Get()->core()->IsMainThread()) {
     StartImpl(0);
@@ -128,231 +172,264 @@ void URLLoaderStreamToFileHandler::Start() {
   }
   pp::Module::Get()->core()->CallOnMainThread(
       0,
-      callback_factory_.NewCallback(&URLLoaderStreamToFileHandler::StartImpl));
+      callback_factory_.NewCallback(
+          &URLLoaderRangeDownloadHandler::StartImpl));
 }
 
-void URLLoaderStreamToFileHandler::StartImpl(int32_t result) {
+void URLLoaderRangeDownloadHandler::StartImpl(int32_t result) {
   CHECK(pp::Module::Get()->core()->IsMainThread());
-  CHECK(!url_request_.get());
-  CHECK(!url_loader_.get());
-  url_request_.reset(new pp::URLRequestInfo(instance_));
-  url_loader_.reset(new pp::URLLoader(instance_));
-  url_request_->SetAllowCrossOriginRequests(true);
-  url_request_->SetURL(url_);
-  url_request_->SetMethod("GET");
-  url_request_->SetStreamToFile(true);
-  url_loader_->Open(*url_request_,
-                    callback_factory_.NewCallback(
-                        &URLLoaderStreamToFileHandler::OnOpen));
-}
-
-void URLLoaderStreamToFileHandler::OnOpen(int32 result) {
-  if (result != PP_OK) {
-    DLOG(ERROR) << "URLLoaderStreamToFileHandler::OnOpen error";
-    Complete(false);
-    return;
-  }
-  const pp::URLResponseInfo response = url_loader_->GetResponseInfo();
-  if (response.GetStatusCode() != 200) {
-    DLOG(ERROR) << "pp::URLLoader::Open() failed: " << url_
-                << " Status code: " << response.GetStatusCode();
+  CHECK(!file_system_.get());
+  file_system_.reset(
+      new pp::FileSystem(instance_, PP_FILESYSTEMTYPE_LOCALPERSISTENT));
+  const int32_t ret = file_system_->Open(
+      kFileSystemExpectedSize,
+      callback_factory_.NewCallback(
+          &URLLoaderRangeDownloadHandler::OnFileSystemOpen));
+  if ((ret != PP_OK_COMPLETIONPENDING) && (ret != PP_OK)) {
+    DLOG(ERROR) << "file_system_->Open error";
     Complete(false);
     return;
   }
-  url_loader_->FinishStreamingToFile(
-      callback_factory_.NewCallback(
-          &URLLoaderStreamToFileHandler::OnStreamComplete));
-  url_response_ = url_loader_->GetResponseInfo();
-  body_file_ref_ = url_response_.GetBodyAsFileRef();
 }
 
-void URLLoaderStreamToFileHandler::OnStreamComplete(int32 result) {
+void URLLoaderRangeDownloadHandler::OnFileSystemOpen(int32_t result) {
   if (result != PP_OK) {
-    DLOG(ERROR) << "URLLoaderStreamToFileHandler::OnStreamComplete error";
+    DLOG(ERROR) << "URLLoaderRangeDownloadHandler::OnFileSystemOpen error";
     Complete(false);
     return;
   }
-  input_file_io_.reset(new pp::FileIO(instance_));
-  const int32_t ret = input_file_io_->Open(
-      body_file_ref_, PP_FILEOPENFLAG_READ,
+  output_file_ref_.reset(new pp::FileRef(*file_system_, file_name_.c_str()));
+  output_file_io_.reset(new pp::FileIO(instance_));
+  const int32_t ret = output_file_io_->Open(
+      *output_file_ref_, PP_FILEOPENFLAG_WRITE | PP_FILEOPENFLAG_CREATE,
       callback_factory_.NewCallback(
-          &URLLoaderStreamToFileHandler::OnInputFileOpen));
+          &URLLoaderRangeDownloadHandler::OnOutputFileOpen));
   if ((ret != PP_OK_COMPLETIONPENDING) && (ret != PP_OK)) {
-    DLOG(ERROR) << "input_file_io_->Open error";
+    DLOG(ERROR) << "output_file_io_->Open error";
     Complete(false);
     return;
   }
 }
 
-void URLLoaderStreamToFileHandler::OnInputFileOpen(int32_t result) {
+void URLLoaderRangeDownloadHandler::OnOutputFileOpen(int32_t result) {
   if (result != PP_OK) {
-    DLOG(ERROR) << "URLLoaderStreamToFileHandler::OnInputFileOpen error";
+    DLOG(ERROR) << "URLLoaderRangeDownloadHandler::OnOutputFileOpen error";
     Complete(false);
     return;
   }
-  const int32_t ret = input_file_io_->Query(
-      &input_file_info_,
+  const int32_t ret = output_file_io_->Query(
+      &output_file_info_,
       callback_factory_.NewCallback(
-          &URLLoaderStreamToFileHandler::OnInputFileQuery));
+          &URLLoaderRangeDownloadHandler::OnOutputFileQuery));
   if ((ret != PP_OK_COMPLETIONPENDING) && (ret != PP_OK)) {
-    DLOG(ERROR) << "input_file_io_->Query error";
+    DLOG(ERROR) << "output_file_io_->Query error";
     Complete(false);
     return;
   }
 }
-void URLLoaderStreamToFileHandler::OnInputFileQuery(int32_t result) {
+
+void URLLoaderRangeDownloadHandler::OnOutputFileQuery(int32_t result) {
   if (result != PP_OK) {
-    DLOG(ERROR) << "URLLoaderStreamToFileHandler::OnInputFileQuery error";
+    DLOG(ERROR) << "URLLoaderRangeDownloadHandler::OnOutputFileQuery error";
     Complete(false);
     return;
   }
-  file_system_.reset(
-      new pp::FileSystem(instance_, PP_FILESYSTEMTYPE_LOCALPERSISTENT));
-  const int32_t ret = file_system_->Open(
-      input_file_info_.size,
-      callback_factory_.NewCallback(
-          &URLLoaderStreamToFileHandler::OnFileSystemOpen));
+  // Resumes the download after the data which is already in the file.
+  offset_ = output_file_info_.size;
+  VLOG(1) << "Start downloading " << url_ << " from " << offset_;
+  tmp_buffer_.reset(new char[kReadBufferSize]);
+  RequestNextChunk();
+}
+
+void URLLoaderRangeDownloadHandler::RequestNextChunk() {
+  url_request_.reset(new pp::URLRequestInfo(instance_));
+  url_loader_.reset(new pp::URLLoader(instance_));
+  url_request_->SetAllowCrossOriginRequests(true);
+  url_request_->SetURL(url_);
+  url_request_->SetMethod("GET");
+  url_request_->SetHeaders(
+      Util::StringPrintf("Range: bytes=%lld-%lld",
+                         static_cast<long long>(offset_),  // NOLINT
+                         static_cast<long long>(  // NOLINT
+                             offset_ + kChunkSize - 1)));
+  const int32_t ret = url_loader_->Open(
+      *url_request_,
+      callback_factory_.NewCallback(&URLLoaderRangeDownloadHandler::OnOpen));
   if ((ret != PP_OK_COMPLETIONPENDING) && (ret != PP_OK)) {
-    DLOG(ERROR) << "file_system_->Open error";
+    DLOG(ERROR) << "url_loader_->Open error";
     Complete(false);
     return;
   }
 }
 
-void URLLoaderStreamToFileHandler::OnFileSystemOpen(int32_t result) {
+void URLLoaderRangeDownloadHandler::OnOpen(int32 result) {
   if (result != PP_OK) {
-    DLOG(ERROR) << "URLLoaderStreamToFileHandler::OnFileSystemOpen error";
+    DLOG(ERROR) << "URLLoaderRangeDownloadHandler::OnOpen error";
     Complete(false);
     return;
   }
-  output_file_ref_.reset(new pp::FileRef(*file_system_, file_name_.c_str()));
-  const int32_t ret = output_file_ref_->Delete(
-      callback_factory_.NewCallback(
-          &URLLoaderStreamToFileHandler::OnDeleteOutputFile));
-  if ((ret != PP_OK_COMPLETIONPENDING) && (ret != PP_OK)) {
-    DLOG(ERROR) << "output_file_ref_->Delete error";
+  const pp::URLResponseInfo response = url_loader_->GetResponseInfo();
+  const pp::Var headers_var = response.GetHeaders();
+  const string headers =
+      headers_var.is_string() ? headers_var.AsString() : string();
+  int64_t first = -1;
+  int64_t total = -1;
+  switch (response.GetStatusCode()) {
+    case 206:  // Partial Content
+      if (!ParseContentRange(headers, &first, &total) || first != offset_) {
+        DLOG(ERROR) << "Unexpected Content-Range: " << headers;
+        Complete(false);
+        return;
+      }
+      total_size_ = total;
+      ReadBody();
+      return;
+    case 200:  // OK
+      // The server ignored the range request and sends the whole data.
+      total_size_ = -1;
+      if (offset_ == 0) {
+        ReadBody();
+        return;
+      }
+      offset_ = 0;
+      {
+        const int32_t ret = output_file_io_->SetLength(
+            0,
+            callback_factory_.NewCallback(
+                &URLLoaderRangeDownloadHandler::OnOutputFileTruncate));
+        if ((ret != PP_OK_COMPLETIONPENDING) && (ret != PP_OK)) {
+          DLOG(ERROR) << "output_file_io_->SetLength error";
+          Complete(false);
+        }
+      }
+      return;
+    case 416:  // Range Not Satisfiable
+      // The output file already has the whole data.
+      if (ParseContentRange(headers, &first, &total) && total == offset_) {
+        total_size_ = total;
+        OnOutputFileFlush(PP_OK);
+        return;
+      }
+      // The file is longer than the data on the server.  Discards it and
+      // downloads the data from the beginning.
+      DLOG(ERROR) << "The downloaded file is broken: " << file_name_;
+      offset_ = 0;
+      {
+        const int32_t ret = output_file_io_->SetLength(
+            0,
+            callback_factory_.NewCallback(
+                &URLLoaderRangeDownloadHandler::OnOutputFileReset));
+        if ((ret != PP_OK_COMPLETIONPENDING) && (ret != PP_OK)) {
+          DLOG(ERROR) << "output_file_io_->SetLength error";
+          Complete(false);
+        }
+      }
+      return;
+    default:
+      DLOG(ERROR) << "pp::URLLoader::Open() failed: " << url_
+                  << " Status code: " << response.GetStatusCode();
+      Complete(false);
+      return;
+  }
+}
+
+void URLLoaderRangeDownloadHandler::OnOutputFileTruncate(int32_t result) {
+  if (result != PP_OK) {
+    DLOG(ERROR) << "URLLoaderRangeDownloadHandler::OnOutputFileTruncate error";
     Complete(false);
     return;
   }
+  ReadBody();
 }
 
-void URLLoaderStreamToFileHandler::OnDeleteOutputFile(int32_t result) {
-  output_file_io_.reset(new pp::FileIO(instance_));
-  const int32_t ret = output_file_io_->Open(
-      *output_file_ref_, PP_FILEOPENFLAG_WRITE | PP_FILEOPENFLAG_CREATE,
-      callback_factory_.NewCallback(
-          &URLLoaderStreamToFileHandler::OnOutputFileOpen));
-  if ((ret != PP_OK_COMPLETIONPENDING) && (ret != PP_OK)) {
-    DLOG(ERROR) << "output_file_io_->Open error";
+void URLLoaderRangeDownloadHandler::OnOutputFileReset(int32_t result) {
+  if (result != PP_OK) {
+    DLOG(ERROR) << "URLLoaderRangeDownloadHandler::OnOutputFileReset error";
     Complete(false);
     return;
   }
+  RequestNextChunk();
 }
 
-void URLLoaderStreamToFileHandler::OnOutputFileOpen(int32_t result) {
-  if (result != PP_OK) {
-    DLOG(ERROR) << "URLLoaderStreamToFileHandler::OnOutputFileOpen error";
+void URLLoaderRangeDownloadHandler::ReadBody() {
+  const int32_t ret = url_loader_->ReadResponseBody(
+      tmp_buffer_.get(), kReadBufferSize,
+      callback_factory_.NewCallback(&URLLoaderRangeDownloadHandler::OnRead));
+  if ((ret != PP_OK_COMPLETIONPENDING) && (ret < 0)) {
+    DLOG(ERROR) << "url_loader_->ReadResponseBody error";
     Complete(false);
     return;
   }
-  tmp_buffer_.reset(new char[kReadBufferSize]);
-  OnInputFileRead(0);
 }
 
-void URLLoaderStreamToFileHandler::OnInputFileRead(int32_t bytes_read) {
+void URLLoaderRangeDownloadHandler::OnRead(int32_t bytes_read) {
   if (bytes_read < 0) {
-    DLOG(ERROR) << "URLLoaderStreamToFileHandler::OnInputFileRead error";
+    DLOG(ERROR) << "URLLoaderRangeDownloadHandler::OnRead error";
     Complete(false);
     return;
   }
-  total_read_bytes_ += bytes_read;
   if (bytes_read == 0) {
-    const int32_t ret = input_file_io_->Read(
-        total_read_bytes_, tmp_buffer_.get(),
-        std::min(
-            kReadBufferSize,
-            static_cast<int32_t>(input_file_info_.size - total_read_bytes_)),
-        callback_factory_.NewCallback(
-            &URLLoaderStreamToFileHandler::OnInputFileRead));
-    if ((ret != PP_OK_COMPLETIONPENDING) && (ret != PP_OK)) {
-      DLOG(ERROR) << "input_file_io_->Read error";
-      Complete(false);
-      return;
-    }
-  } else {
-    buffer_written_bytes_ = 0;
-    const int32_t ret = output_file_io_->Write(
-        total_written_bytes_, tmp_buffer_.get(), bytes_read,
+    // The response body of this chunk has been read.  Flushes the file so
+    // that the received data survives the interruption of the download.
+    const int32_t ret = output_file_io_->Flush(
         callback_factory_.NewCallback(
-            &URLLoaderStreamToFileHandler::OnOutputFileWrite));
+            &URLLoaderRangeDownloadHandler::OnOutputFileFlush));
     if ((ret != PP_OK_COMPLETIONPENDING) && (ret != PP_OK)) {
-      DLOG(ERROR) << "output_file_io_->Write error";
+      DLOG(ERROR) << "output_file_io_->Flush error";
       Complete(false);
       return;
     }
+    return;
   }
+  buffer_size_ = bytes_read;
+  buffer_written_bytes_ = 0;
+  WriteBuffer();
 }
 
-void URLLoaderStreamToFileHandler::OnOutputFileWrite(int32_t bytes_written) {
+void URLLoaderRangeDownloadHandler::WriteBuffer() {
+  const int32_t ret = output_file_io_->Write(
+      offset_,
+      &tmp_buffer_[buffer_written_bytes_],
+      buffer_size_ - buffer_written_bytes_,
+      callback_factory_.NewCallback(
+          &URLLoaderRangeDownloadHandler::OnOutputFileWrite));
+  if ((ret != PP_OK_COMPLETIONPENDING) && (ret < 0)) {
+    DLOG(ERROR) << "output_file_io_->Write error";
+    Complete(false);
+    return;
+  }
+}
+
+void URLLoaderRangeDownloadHandler::OnOutputFileWrite(int32_t bytes_written) {
   if (bytes_written < 0) {
-    DLOG(ERROR) << "URLLoaderStreamToFileHandler::OnOutputFileWrite error";
+    DLOG(ERROR) << "URLLoaderRangeDownloadHandler::OnOutputFileWrite error";
     Complete(false);
     return;
   }
-  total_written_bytes_ += bytes_written;
+  offset_ += bytes_written;
   buffer_written_bytes_ += bytes_written;
-  if (total_read_bytes_ == total_written_bytes_) {
-    if (total_read_bytes_ == input_file_info_.size) {
-      // Finish writing
-      const int32_t ret = output_file_io_->Flush(
-          callback_factory_.NewCallback(
-              &URLLoaderStreamToFileHandler::OnOutputFileFlush));
-      if ((ret != PP_OK_COMPLETIONPENDING) && (ret != PP_OK)) {
-        DLOG(ERROR) << "output_file_io_->Flush error";
-        Complete(false);
-        return;
-      }
-    } else {
-      // Read more
-      const int32_t ret = input_file_io_->Read(
-          total_read_bytes_, tmp_buffer_.get(),
-          std::min(
-              kReadBufferSize,
-              static_cast<int32_t>(input_file_info_.size - total_read_bytes_)),
-          callback_factory_.NewCallback(
-              &URLLoaderStreamToFileHandler::OnInputFileRead));
-      if ((ret != PP_OK_COMPLETIONPENDING) && (ret != PP_OK)) {
-        DLOG(ERROR) << "input_file_io_->Read error";
-        Complete(false);
-        return;
-      }
-    }
-  } else {
-    // Writes more
-    const int32_t ret = output_file_io_->Write(
-        total_written_bytes_,
-        &tmp_buffer_[buffer_written_bytes_],
-        total_read_bytes_ - total_written_bytes_,
-        callback_factory_.NewCallback(
-            &URLLoaderStreamToFileHandler::OnOutputFileWrite));
-    if ((ret != PP_OK_COMPLETIONPENDING) && (ret != PP_OK)) {
-      DLOG(ERROR) << "output_file_io_->Write error";
-      Complete(false);
-      return;
-    }
+  if (buffer_written_bytes_ < buffer_size_) {
+    WriteBuffer();
+    return;
   }
+  ReadBody();
 }
 
-void URLLoaderStreamToFileHandler::OnOutputFileFlush(int32_t result) {
+void URLLoaderRangeDownloadHandler::OnOutputFileFlush(int32_t result) {
   if (result != PP_OK) {
-    DLOG(ERROR) << "URLLoaderStreamToFileHandler::OnOutputFileFlush error";
+    DLOG(ERROR) << "URLLoaderRangeDownloadHandler::OnOutputFileFlush error";
     Complete(false);
     return;
   }
+  if (total_size_ >= 0 && offset_ < total_size_) {
+    VLOG(2) << "Downloaded " << offset_ << " / " << total_size_;
+    RequestNextChunk();
+    return;
+  }
   Complete(true);
 }
 
-void URLLoaderStreamToFileHandler::Complete(bool result) {
+void URLLoaderRangeDownloadHandler::Complete(bool result) {
   callback_.Run(result ? PP_OK : PP_ERROR_FAILED);
   delete this;
 }
@@ -363,11 +440,11 @@ void URLLoaderUtil::StartDownloadToFile(pp::Instance *instance,
                                         const string &url,
                                         const string &file_name,
                                         pp::CompletionCallback callback) {
-  URLLoaderStreamToFileHandler *handler =
-      new URLLoaderStreamToFileHandler(instance,
-                                       url,
-                                       file_name,
-                                       callback);
+  URLLoaderRangeDownloadHandler *handler =
+      new URLLoaderRangeDownloadHandler(instance,
+                                        url,
+                                        file_name,
+                                        callback);
   DCHECK(handler);
   handler->Start();
 }
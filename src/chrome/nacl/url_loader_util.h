@@ -49,7 +49,11 @@ namespace nacl {
 // Utility class to handle pp::URLLoader.
 class URLLoaderUtil {
  public:
-  // Downloads the file from url to file_name on HTML5 filesystem.
+  // Downloads the file from url to file_name on HTML5 filesystem.  The data
+  // is requested in chunks with HTTP range requests and written to the file
+  // as it arrives.  If file_name already exists, its content is regarded as
+  // the data downloaded by the previous attempt and the download is resumed
+  // after it.  The caller is responsible for verifying the downloaded data.
   static void StartDownloadToFile(pp::Instance *instance,
                                   const string &url,
                                   const string &file_name,
@@ -0,0 +1,189 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "client/async_client.h"
+
+#include <utility>
+
+#include "base/logging.h"
+#include "client/client_interface.h"
+
+namespace mozc {
+namespace client {
+
+struct AsyncClient::Request {
+  enum Type {
+    SEND_KEY,
+    TEST_SEND_KEY,
+    SEND_COMMAND,
+  };
+
+  Request(Type type, const commands::Context &context, Callback callback)
+      : type(type),
+        sequence(0),
+        // ClientInterface copies the context only if it isn't the default
+        // instance, which is kept here.
+        has_context(&context != &commands::Context::default_instance()),
+        callback(std::move(callback)) {
+    if (has_context) {
+      this->context.CopyFrom(context);
+    }
+  }
+
+  const commands::Context &GetContext() const {
+    return has_context ? context : commands::Context::default_instance();
+  }
+
+  // Returns true if this TEST_SEND_KEY and the following |next| can be sent
+  // as one SEND_KEY.
+  bool CanCoalesceWith(const Request &next) const {
+    return type == TEST_SEND_KEY && next.type == SEND_KEY &&
+           has_context == next.has_context &&
+           key.SerializeAsString() == next.key.SerializeAsString() &&
+           context.SerializeAsString() == next.context.SerializeAsString();
+  }
+
+  Type type;
+  uint64 sequence;
+  commands::KeyEvent key;
+  commands::SessionCommand command;
+  bool has_context;
+  commands::Context context;
+  Callback callback;
+};
+
+AsyncClient::AsyncClient(ClientInterface *client)
+    : AsyncClient(client, true) {}
+
+AsyncClient::AsyncClient(ClientInterface *client, bool take_ownership)
+    : owned_client_(take_ownership ? client : nullptr),
+      client_(client),
+      last_sequence_(0),
+      coalesce_test_send_key_(false),
+      worker_(1) {
+  DCHECK(client_);
+}
+
+AsyncClient::~AsyncClient() {
+  Flush();
+}
+
+uint64 AsyncClient::SendKeyAsync(const commands::KeyEvent &key,
+                                 const commands::Context &context,
+                                 Callback callback) {
+  std::unique_ptr<Request> request(
+      new Request(Request::SEND_KEY, context, std::move(callback)));
+  request->key.CopyFrom(key);
+  return Enqueue(std::move(request));
+}
+
+uint64 AsyncClient::TestSendKeyAsync(const commands::KeyEvent &key,
+                                     const commands::Context &context,
+                                     Callback callback) {
+  std::unique_ptr<Request> request(
+      new Request(Request::TEST_SEND_KEY, context, std::move(callback)));
+  request->key.CopyFrom(key);
+  return Enqueue(std::move(request));
+}
+
+uint64 AsyncClient::SendCommandAsync(const commands::SessionCommand &command,
+                                     const commands::Context &context,
+                                     Callback callback) {
+  std::unique_ptr<Request> request(
+      new Request(Request::SEND_COMMAND, context, std::move(callback)));
+  request->command.CopyFrom(command);
+  return Enqueue(std::move(request));
+}
+
+void AsyncClient::Flush() {
+  BlockingCounter counter(1);
+  worker_.Schedule([&counter]() { counter.DecrementCount(); });
+  counter.Wait();
+}
+
+void AsyncClient::set_coalesce_test_send_key(bool coalesce) {
+  scoped_lock l(&mutex_);
+  coalesce_test_send_key_ = coalesce;
+}
+
+uint64 AsyncClient::Enqueue(std::unique_ptr<Request> request) {
+  uint64 sequence = 0;
+  {
+    scoped_lock l(&mutex_);
+    sequence = ++last_sequence_;
+    request->sequence = sequence;
+    requests_.push_back(std::move(request));
+  }
+  // One task per request.  A task finds the queue empty if the previous one
+  // has coalesced its request.
+  worker_.Schedule([this]() { ProcessNext(); });
+  return sequence;
+}
+
+void AsyncClient::ProcessNext() {
+  std::unique_ptr<Request> request;
+  std::unique_ptr<Request> coalesced;
+  {
+    scoped_lock l(&mutex_);
+    if (requests_.empty()) {
+      return;
+    }
+    request = std::move(requests_.front());
+    requests_.pop_front();
+    if (coalesce_test_send_key_ && !requests_.empty() &&
+        request->CanCoalesceWith(*requests_.front())) {
+      coalesced = std::move(requests_.front());
+      requests_.pop_front();
+    }
+  }
+
+  commands::Output output;
+  bool succeeded = false;
+  if (coalesced || request->type == Request::SEND_KEY) {
+    succeeded = client_->SendKeyWithContext(request->key,
+                                            request->GetContext(), &output);
+  } else if (request->type == Request::TEST_SEND_KEY) {
+    succeeded = client_->TestSendKeyWithContext(
+        request->key, request->GetContext(), &output);
+  } else {
+    succeeded = client_->SendCommandWithContext(
+        request->command, request->GetContext(), &output);
+  }
+
+  if (request->callback) {
+    request->callback(request->sequence, succeeded, output);
+  }
+  if (coalesced && coalesced->callback) {
+    coalesced->callback(coalesced->sequence, succeeded, output);
+  }
+}
+
+}  // namespace client
+}  // namespace mozc
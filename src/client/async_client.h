@@ -0,0 +1,125 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// Queues the key events and the commands for a client on a worker thread.
+
+#ifndef MOZC_CLIENT_ASYNC_CLIENT_H_
+#define MOZC_CLIENT_ASYNC_CLIENT_H_
+
+#include <deque>
+#include <functional>
+#include <memory>
+
+#include "base/mutex.h"
+#include "base/port.h"
+#include "base/thread_pool.h"
+#include "protocol/commands.pb.h"
+
+namespace mozc {
+namespace client {
+
+class ClientInterface;
+
+// Sends the key events and the commands through a client on a worker thread,
+// in the order they are queued, so that the caller doesn't wait for the IPC
+// round trips.  The results are passed to the callbacks on the worker thread
+// together with the sequence numbers returned when they were queued.
+//
+// Usage:
+//   AsyncClient async_client(new Client);
+//   async_client.SendKeyAsync(key, context,
+//       [](uint64 sequence, bool succeeded, const commands::Output &output) {
+//         ...
+//       });
+//   async_client.Flush();  // Waits for all the callbacks.
+class AsyncClient {
+ public:
+  typedef std::function<void(uint64 sequence, bool succeeded,
+                             const commands::Output &output)> Callback;
+
+  // Takes the ownership of |client|, which must not be used by others
+  // afterward.
+  explicit AsyncClient(ClientInterface *client);
+
+  // Same as above, but takes the ownership of |client| only if
+  // |take_ownership| is true.  Otherwise |client| must outlive this object,
+  // and the owner must call Flush() before using |client| directly.
+  AsyncClient(ClientInterface *client, bool take_ownership);
+
+  // Processes all the queued requests before returning.
+  ~AsyncClient();
+
+  // Queue the requests and return their sequence numbers, which start from 1.
+  // These methods are thread-safe.  |callback| can be empty.
+  uint64 SendKeyAsync(const commands::KeyEvent &key,
+                      const commands::Context &context,
+                      Callback callback);
+  uint64 TestSendKeyAsync(const commands::KeyEvent &key,
+                          const commands::Context &context,
+                          Callback callback);
+  uint64 SendCommandAsync(const commands::SessionCommand &command,
+                          const commands::Context &context,
+                          Callback callback);
+
+  // Waits until all the queued requests are processed.  Must not be called
+  // from the callbacks.
+  void Flush();
+
+  // If true, TestSendKeyAsync() immediately followed by SendKeyAsync() with
+  // the same key and context is sent as one SEND_KEY if both are still in the
+  // queue.  Both callbacks get its output, since SEND_KEY also tells whether
+  // the key is consumed.  Default is false.
+  void set_coalesce_test_send_key(bool coalesce);
+
+ private:
+  struct Request;
+
+  uint64 Enqueue(std::unique_ptr<Request> request);
+
+  // Processes the request at the front of the queue, if any.  Runs on the
+  // worker thread.
+  void ProcessNext();
+
+  std::unique_ptr<ClientInterface> owned_client_;
+  ClientInterface *client_;
+  Mutex mutex_;
+  std::deque<std::unique_ptr<Request>> requests_;
+  uint64 last_sequence_;
+  bool coalesce_test_send_key_;
+  // Declared last to stop the worker before the members above are destroyed.
+  ThreadPool worker_;
+
+  DISALLOW_COPY_AND_ASSIGN(AsyncClient);
+};
+
+}  // namespace client
+}  // namespace mozc
+
+#endif  // MOZC_CLIENT_ASYNC_CLIENT_H_
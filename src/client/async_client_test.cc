@@ -0,0 +1,157 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "client/async_client.h"
+
+#include <vector>
+
+#include "client/client_mock.h"
+#include "protocol/commands.pb.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace client {
+namespace {
+
+class AsyncClientTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    mock_ = new ClientMock;
+    mock_->SetBoolFunctionReturn("SendKeyWithContext", true);
+    mock_->SetBoolFunctionReturn("TestSendKeyWithContext", true);
+    mock_->SetBoolFunctionReturn("SendCommandWithContext", true);
+    async_client_.reset(new AsyncClient(mock_));
+  }
+
+  // Returns a callback appending the sequence numbers to |sequences_|.
+  AsyncClient::Callback Record() {
+    return [this](uint64 sequence, bool succeeded,
+                  const commands::Output &output) {
+      EXPECT_TRUE(succeeded);
+      sequences_.push_back(sequence);
+    };
+  }
+
+  ClientMock *mock_;
+  std::unique_ptr<AsyncClient> async_client_;
+  std::vector<uint64> sequences_;
+};
+
+TEST_F(AsyncClientTest, ProcessInOrder) {
+  commands::KeyEvent key;
+  key.set_key_code('a');
+  commands::SessionCommand command;
+  command.set_type(commands::SessionCommand::SUBMIT);
+
+  const commands::Context &context = commands::Context::default_instance();
+  EXPECT_EQ(1, async_client_->TestSendKeyAsync(key, context, Record()));
+  EXPECT_EQ(2, async_client_->SendKeyAsync(key, context, Record()));
+  EXPECT_EQ(3, async_client_->SendCommandAsync(command, context, Record()));
+  EXPECT_EQ(4, async_client_->SendKeyAsync(key, context, nullptr));
+  async_client_->Flush();
+
+  EXPECT_EQ(1, mock_->GetFunctionCallCount("TestSendKeyWithContext"));
+  EXPECT_EQ(2, mock_->GetFunctionCallCount("SendKeyWithContext"));
+  EXPECT_EQ(1, mock_->GetFunctionCallCount("SendCommandWithContext"));
+  EXPECT_EQ(commands::SessionCommand::SUBMIT,
+            mock_->called_SendCommandWithContext().type());
+  const std::vector<uint64> kExpected = {1, 2, 3};
+  EXPECT_EQ(kExpected, sequences_);
+}
+
+TEST_F(AsyncClientTest, PassOutput) {
+  commands::Output expected;
+  expected.set_consumed(true);
+  mock_->set_output_SendKeyWithContext(expected);
+
+  commands::KeyEvent key;
+  key.set_key_code('a');
+  bool consumed = false;
+  async_client_->SendKeyAsync(
+      key, commands::Context::default_instance(),
+      [&consumed](uint64 sequence, bool succeeded,
+                  const commands::Output &output) {
+        consumed = output.consumed();
+      });
+  async_client_->Flush();
+  EXPECT_TRUE(consumed);
+  EXPECT_EQ('a', mock_->called_SendKeyWithContext().key_code());
+}
+
+TEST_F(AsyncClientTest, CoalesceTestSendKey) {
+  commands::KeyEvent key;
+  key.set_key_code('a');
+  commands::KeyEvent other_key;
+  other_key.set_key_code('b');
+  const commands::Context &context = commands::Context::default_instance();
+
+  // Blocks the worker so that the requests below stay in the queue.
+  BlockingCounter started(1);
+  BlockingCounter blocked(1);
+  async_client_->SendCommandAsync(
+      commands::SessionCommand(), context,
+      [&started, &blocked](uint64 sequence, bool succeeded,
+                           const commands::Output &output) {
+        started.DecrementCount();
+        blocked.Wait();
+      });
+  started.Wait();
+  async_client_->set_coalesce_test_send_key(true);
+  async_client_->TestSendKeyAsync(key, context, Record());
+  async_client_->SendKeyAsync(key, context, Record());
+  // Not coalesced as the keys differ.
+  async_client_->TestSendKeyAsync(key, context, Record());
+  async_client_->SendKeyAsync(other_key, context, Record());
+  blocked.DecrementCount();
+  async_client_->Flush();
+
+  EXPECT_EQ(1, mock_->GetFunctionCallCount("TestSendKeyWithContext"));
+  EXPECT_EQ(2, mock_->GetFunctionCallCount("SendKeyWithContext"));
+  const std::vector<uint64> kExpected = {2, 3, 4, 5};
+  EXPECT_EQ(kExpected, sequences_);
+}
+
+TEST(AsyncClientOwnershipTest, DoNotTakeOwnership) {
+  ClientMock mock;
+  mock.SetBoolFunctionReturn("SendKeyWithContext", true);
+  {
+    AsyncClient async_client(&mock, false);
+    commands::KeyEvent key;
+    key.set_key_code('a');
+    async_client.SendKeyAsync(key, commands::Context::default_instance(),
+                              nullptr);
+  }
+  // |mock| is still alive and has received the queued key.
+  EXPECT_EQ(1, mock.GetFunctionCallCount("SendKeyWithContext"));
+}
+
+}  // namespace
+}  // namespace client
+}  // namespace mozc
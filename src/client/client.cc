@@ -39,10 +39,12 @@
 
 #include <cstddef>
 #include <memory>
+#include <utility>
 
 #include "base/const.h"
 #include "base/file_stream.h"
 #include "base/file_util.h"
+#include "base/flags.h"
 #include "base/logging.h"
 #include "base/process.h"
 #include "base/run_level.h"
@@ -62,6 +64,14 @@
 #include "base/mac_process.h"
 #endif  // OS_MACOSX
 
+DEFINE_bool(use_persistent_ipc_connection, false,
+            "Keep the IPC connection to the server across the calls "
+            "where the platform supports it.");
+DEFINE_bool(use_shared_memory_ipc, false,
+            "Pass the IPC messages to the server through shared memory "
+            "where the platform supports it.  Implies "
+            "--use_persistent_ipc_connection.");
+
 namespace mozc {
 namespace client {
 
@@ -94,7 +104,11 @@ Client::Client()
       server_protocol_version_(0),
       server_process_id_(0),
       last_mode_(commands::DIRECT) {
-  client_factory_ = IPCClientFactory::GetIPCClientFactory();
+  if (FLAGS_use_shared_memory_ipc) {
+    client_factory_ = SharedMemoryIPCClientFactory::GetIPCClientFactory();
+  } else {
+    client_factory_ = IPCClientFactory::GetIPCClientFactory();
+  }
 }
 
 Client::~Client() {
@@ -104,11 +118,13 @@ Client::~Client() {
 
 void Client::SetIPCClientFactory(IPCClientFactoryInterface *client_factory) {
   client_factory_ = client_factory;
+  persistent_client_.reset();
 }
 
 void Client::SetServerLauncher(
     ServerLauncherInterface *server_launcher) {
   server_launcher_.reset(server_launcher);
+  persistent_client_.reset();
 }
 
 bool Client::IsValidRunLevel() const {
@@ -629,9 +645,13 @@ bool Client::Call(const commands::Input &input,
   input.SerializeToString(&request);
 
   // Call IPC
-  std::unique_ptr<IPCClientInterface> client(
-      client_factory_->NewClient(kServerAddress,
-                                 server_launcher_->server_program()));
+  // Reuse the persistent connection if any.  It is kept again only when the
+  // call succeeds.
+  std::unique_ptr<IPCClientInterface> client(std::move(persistent_client_));
+  if (!client) {
+    client.reset(client_factory_->NewClient(
+        kServerAddress, server_launcher_->server_program()));
+  }
 
   // set client protocol version.
   // When an error occurs inside Connected() function,
@@ -672,6 +692,9 @@ bool Client::Call(const commands::Input &input,
   // Drop DebugString() as it raises segmentation fault.
   // http://b/2126375
   // TODO(taku): Investigate the error in detail.
+  const bool persistent = (FLAGS_use_persistent_ipc_connection ||
+                           FLAGS_use_shared_memory_ipc) &&
+                          client->EnablePersistentConnection();
   size_t size = kResultBufferSize;
   if (!client->Call(request.data(), request.size(),
                     result_.get(), &size, timeout_)) {
@@ -693,6 +716,10 @@ bool Client::Call(const commands::Input &input,
     return false;
   }
 
+  if (persistent) {
+    persistent_client_ = std::move(client);
+  }
+
   DCHECK(server_status_ == SERVER_OK ||
          server_status_ == SERVER_INVALID_SESSION ||
          server_status_ == SERVER_SHUTDOWN ||
@@ -37,6 +37,7 @@
       'target_name': 'client',
       'type': 'static_library',
       'sources': [
+        'async_client.cc',
         'client.cc',
         'server_launcher.cc',
       ],
@@ -62,5 +63,20 @@
         '../protocol/protocol.gyp:config_proto',
       ],
     },
+    {
+      'target_name': 'client_load_generator',
+      'type': 'executable',
+      'sources': [
+        'client_load_generator_main.cc',
+      ],
+      'dependencies': [
+        '../base/base.gyp:base',
+        '../composer/composer.gyp:key_parser',
+        '../ipc/ipc.gyp:ipc',
+        '../protocol/protocol.gyp:commands_proto',
+        '../session/session.gyp:random_keyevents_generator',
+        'client',
+      ],
+    },
   ],
 }
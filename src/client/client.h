@@ -44,6 +44,7 @@
 
 namespace mozc {
 class IPCClientFactoryInterface;
+class IPCClientInterface;
 
 namespace config {
 class Config;
@@ -84,6 +85,14 @@ class ServerLauncher : public ServerLauncherInterface {
     suppress_error_dialog_ = suppress;
   }
 
+  // If true, StartServer() launches the server in pre-spawn mode, in which it
+  // initializes itself at background priority, and returns without waiting
+  // for the server to become ready. Used to start the server ahead of the
+  // first client, e.g. at login.
+  void set_prespawn(bool prespawn) {
+    prespawn_ = prespawn;
+  }
+
   ServerLauncher();
   virtual ~ServerLauncher();
 
@@ -91,6 +100,7 @@ class ServerLauncher : public ServerLauncherInterface {
   string server_program_;
   bool restricted_;
   bool suppress_error_dialog_;
+  bool prespawn_;
 };
 
 class Client : public ClientInterface {
@@ -243,6 +253,9 @@ class Client : public ClientInterface {
 
   uint64 id_;
   IPCClientFactoryInterface *client_factory_;
+  // Kept across the calls if --use_persistent_ipc_connection or
+  // --use_shared_memory_ipc.
+  std::unique_ptr<IPCClientInterface> persistent_client_;
   std::unique_ptr<ServerLauncherInterface> server_launcher_;
   std::unique_ptr<char[]> result_;
   std::unique_ptr<config::Config> preferences_;
@@ -0,0 +1,524 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Load generator measuring how mozc_server scales with concurrent clients.
+//
+// Spawns simulated clients, each of which has its own session of a running
+// mozc_server and sends key events over IPC.  The number of clients is ramped
+// up through the steps of --clients.  Every step runs for
+// --step_duration_sec, samples the CPU time and the RSS of the server every
+// --sample_interval_sec, and reports the throughput, the latency percentiles
+// of the IPC round trips and the server CPU time per request.  The clients
+// type the sentences of RandomKeyEventsGenerator, or replay --scenario_files
+// in the format of session_handler_scenario_test.cc, whose EXPECT_* lines are
+// ignored.  Without --key_interval_msec the clients send the next key as soon
+// as the server answers, i.e., the server is saturated.
+//
+// Usage:
+//   client_load_generator --server_path=/path/to/mozc_server
+//       --clients=1,2,4,8,16,32 --step_duration_sec=30
+//       --scenario_files=data/test/session/scenario/conversion.txt,...
+//       --json_output=/tmp/load.json
+//
+// The server keeps at most --max_session_size sessions (64 by default) and
+// evicts the oldest ones beyond it, so start the server with a larger
+// --max_session_size for more clients.  The CPU time and the RSS of the
+// server are available only on Linux and Windows.
+
+#ifdef OS_WIN
+#include <windows.h>
+#include <psapi.h>
+#endif  // OS_WIN
+
+#ifdef OS_LINUX
+#include <unistd.h>
+#endif  // OS_LINUX
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>  // NOLINT
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "base/file_stream.h"
+#include "base/flags.h"
+#include "base/init_mozc.h"
+#include "base/logging.h"
+#include "base/mutex.h"
+#include "base/number_util.h"
+#include "base/port.h"
+#include "base/stopwatch.h"
+#include "base/thread.h"
+#include "base/util.h"
+#include "client/client.h"
+#include "composer/key_parser.h"
+#include "ipc/ipc.h"
+#include "protocol/commands.pb.h"
+#include "session/random_keyevents_generator.h"
+
+DEFINE_string(server_path, "", "specify server path");
+DEFINE_string(clients, "1,2,4,8,16",
+              "Comma separated numbers of concurrent clients of the steps");
+DEFINE_int32(step_duration_sec, 30, "Duration of each step");
+DEFINE_int32(sample_interval_sec, 5,
+             "Interval of sampling the CPU time and the RSS of the server");
+DEFINE_int32(key_interval_msec, 0,
+             "Think time of a client between keys.  0 sends the next key as "
+             "soon as the server answers.");
+DEFINE_string(scenario_files, "",
+              "Comma separated list of scenario files to replay.  Random key "
+              "events are sent if empty.");
+DEFINE_string(json_output, "", "File to write the results as JSON");
+
+namespace mozc {
+namespace {
+
+const char kServerAddress[] = "session";
+
+// A request sent by a client.
+struct Action {
+  enum Type {
+    SEND_KEY,
+    TEST_SEND_KEY,
+    SEND_COMMAND,
+  };
+  Type type;
+  commands::KeyEvent key;
+  commands::SessionCommand command;
+};
+
+void AddKey(Action::Type type, const commands::KeyEvent &key,
+            std::vector<Action> *actions) {
+  actions->push_back(Action());
+  actions->back().type = type;
+  actions->back().key = key;
+}
+
+void AddCommand(commands::SessionCommand::CommandType type, int id,
+                std::vector<Action> *actions) {
+  actions->push_back(Action());
+  actions->back().type = Action::SEND_COMMAND;
+  actions->back().command.set_type(type);
+  if (id >= 0) {
+    actions->back().command.set_id(id);
+  }
+}
+
+// Converts the lines of a scenario file to actions.  The lines which need
+// the outputs of the previous commands, e.g., SUBMIT_CANDIDATE_BY_VALUE, and
+// the requests changing the settings shared by the clients are skipped.
+void LoadScenario(const string &filename, std::vector<Action> *actions) {
+  InputFileStream ifs(filename.c_str());
+  CHECK(ifs) << "Cannot open " << filename;
+  string line;
+  int num_skipped_lines = 0;
+  while (!std::getline(ifs, line).fail()) {
+    Util::ChopReturns(&line);
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    std::vector<string> columns;
+    Util::SplitStringUsing(line, "\t", &columns);
+    if (columns.empty() || Util::StartsWith(columns[0], "EXPECT_")) {
+      continue;
+    }
+    const string &command = columns[0];
+    commands::KeyEvent key;
+    if (command == "SEND_KEYS" && columns.size() >= 2) {
+      for (size_t i = 0; i < columns[1].size(); ++i) {
+        key.Clear();
+        key.set_key_code(columns[1][i]);
+        AddKey(Action::SEND_KEY, key, actions);
+      }
+    } else if (command == "SEND_KANA_KEYS" && columns.size() >= 3 &&
+               columns[1].size() == Util::CharsLen(columns[2])) {
+      for (size_t i = 0; i < columns[1].size(); ++i) {
+        key.Clear();
+        key.set_key_code(columns[1][i]);
+        key.set_key_string(Util::SubString(columns[2], i, 1));
+        AddKey(Action::SEND_KEY, key, actions);
+      }
+    } else if ((command == "SEND_KEY" || command == "TEST_SEND_KEY") &&
+               columns.size() >= 2 && KeyParser::ParseKey(columns[1], &key)) {
+      AddKey(command == "SEND_KEY" ? Action::SEND_KEY : Action::TEST_SEND_KEY,
+             key, actions);
+    } else if (command == "RESET_CONTEXT") {
+      AddCommand(commands::SessionCommand::RESET_CONTEXT, -1, actions);
+    } else if ((command == "SELECT_CANDIDATE" ||
+                command == "SUBMIT_CANDIDATE") && columns.size() >= 2) {
+      AddCommand(command == "SELECT_CANDIDATE"
+                     ? commands::SessionCommand::SELECT_CANDIDATE
+                     : commands::SessionCommand::SUBMIT_CANDIDATE,
+                 NumberUtil::SimpleAtoi(columns[1]), actions);
+    } else {
+      ++num_skipped_lines;
+    }
+  }
+  LOG_IF(WARNING, num_skipped_lines > 0)
+      << num_skipped_lines << " lines of " << filename << " are skipped";
+  CHECK(!actions->empty()) << "No actions in " << filename;
+}
+
+// CPU time and resident set size of a process.
+struct ProcessStats {
+  uint64 cpu_usec = 0;
+  uint64 rss_bytes = 0;
+};
+
+// Returns false if the stats of |pid| are not available.
+bool GetProcessStats(uint32 pid, ProcessStats *stats) {
+#if defined(OS_WIN)
+  HANDLE process = ::OpenProcess(
+      PROCESS_QUERY_LIMITED_INFORMATION | PROCESS_VM_READ, FALSE, pid);
+  if (process == nullptr) {
+    return false;
+  }
+  FILETIME creation_time, exit_time, kernel_time, user_time;
+  PROCESS_MEMORY_COUNTERS counters = {};
+  const bool succeeded =
+      ::GetProcessTimes(process, &creation_time, &exit_time, &kernel_time,
+                        &user_time) &&
+      ::GetProcessMemoryInfo(process, &counters, sizeof(counters));
+  ::CloseHandle(process);
+  if (!succeeded) {
+    return false;
+  }
+  // FILETIME is in 100 nanoseconds.
+  const uint64 cpu_100nsec =
+      ((static_cast<uint64>(kernel_time.dwHighDateTime) << 32) |
+       kernel_time.dwLowDateTime) +
+      ((static_cast<uint64>(user_time.dwHighDateTime) << 32) |
+       user_time.dwLowDateTime);
+  stats->cpu_usec = cpu_100nsec / 10;
+  stats->rss_bytes = counters.WorkingSetSize;
+  return true;
+#elif defined(OS_LINUX)
+  // utime and stime are the 14th and 15th fields of /proc/<pid>/stat.  The
+  // 2nd field, the command name, may contain spaces, so the fields are
+  // counted from the 3rd one after the closing parenthesis.
+  InputFileStream stat_stream(
+      Util::StringPrintf("/proc/%u/stat", pid).c_str());
+  string stat;
+  if (std::getline(stat_stream, stat).fail()) {
+    return false;
+  }
+  const string::size_type pos = stat.rfind(')');
+  if (pos == string::npos) {
+    return false;
+  }
+  std::istringstream fields(stat.substr(pos + 1));
+  string field;
+  uint64 ticks = 0;
+  for (int i = 3; i <= 15 && fields >> field; ++i) {
+    if (i >= 14) {
+      ticks += NumberUtil::SimpleAtoi(field);
+    }
+  }
+  const long ticks_per_sec = ::sysconf(_SC_CLK_TCK);  // NOLINT
+  if (ticks_per_sec <= 0) {
+    return false;
+  }
+  stats->cpu_usec = ticks * 1000000 / ticks_per_sec;
+
+  InputFileStream status_stream(
+      Util::StringPrintf("/proc/%u/status", pid).c_str());
+  string line;
+  while (!std::getline(status_stream, line).fail()) {
+    if (Util::StartsWith(line, "VmRSS:")) {
+      std::istringstream value(line.substr(6));
+      uint64 kilobytes = 0;
+      value >> kilobytes;
+      stats->rss_bytes = kilobytes * 1024;
+      return true;
+    }
+  }
+  return false;
+#else  // OS_WIN, OS_LINUX
+  return false;
+#endif  // OS_WIN, OS_LINUX
+}
+
+// A simulated client in its own thread.  The latencies are collected per
+// step by TakeLatencies().
+class ClientThread : public Thread {
+ public:
+  ClientThread(const std::vector<std::vector<Action>> *scenarios,
+               size_t index)
+      : scenarios_(scenarios), index_(index), stopping_(false), errors_(0) {}
+
+  void Run() override {
+    client::Client client;
+    if (!FLAGS_server_path.empty()) {
+      client.set_server_program(FLAGS_server_path);
+    }
+    std::vector<Action> actions;
+    commands::Output output;
+    for (size_t iteration = 0; !stopping_; ++iteration) {
+      if (!client.EnsureSession()) {
+        ++errors_;
+        Util::Sleep(100);
+        continue;
+      }
+      GetActions(iteration, &actions);
+      for (size_t i = 0; i < actions.size() && !stopping_; ++i) {
+        Stopwatch stopwatch = Stopwatch::StartNew();
+        const bool succeeded = Send(actions[i], &client, &output);
+        stopwatch.Stop();
+        if (succeeded) {
+          scoped_lock l(&mutex_);
+          latencies_usec_.push_back(stopwatch.GetElapsedMicroseconds());
+        } else {
+          ++errors_;
+        }
+        if (FLAGS_key_interval_msec > 0) {
+          Util::Sleep(FLAGS_key_interval_msec);
+        }
+      }
+      // Starts the next scenario from an empty composition.
+      commands::SessionCommand reset;
+      reset.set_type(commands::SessionCommand::RESET_CONTEXT);
+      client.SendCommand(reset, &output);
+    }
+    client.DeleteSession();
+  }
+
+  void Stop() {
+    stopping_ = true;
+  }
+
+  // Moves the latencies recorded since the last call to |latencies_usec|,
+  // and returns the number of the failed requests.
+  uint64 TakeLatencies(std::vector<double> *latencies_usec) {
+    scoped_lock l(&mutex_);
+    latencies_usec->insert(latencies_usec->end(), latencies_usec_.begin(),
+                           latencies_usec_.end());
+    latencies_usec_.clear();
+    return errors_.exchange(0);
+  }
+
+ private:
+  void GetActions(size_t iteration, std::vector<Action> *actions) {
+    if (!scenarios_->empty()) {
+      *actions = (*scenarios_)[(index_ + iteration) % scenarios_->size()];
+      return;
+    }
+    std::vector<commands::KeyEvent> keys;
+    {
+      // RandomKeyEventsGenerator shares the random number generator.
+      static Mutex *generator_mutex = new Mutex;
+      scoped_lock l(generator_mutex);
+      session::RandomKeyEventsGenerator::GenerateSequence(&keys);
+    }
+    actions->clear();
+    for (const commands::KeyEvent &key : keys) {
+      AddKey(Action::SEND_KEY, key, actions);
+    }
+  }
+
+  static bool Send(const Action &action, client::Client *client,
+                   commands::Output *output) {
+    switch (action.type) {
+      case Action::SEND_KEY:
+        return client->SendKey(action.key, output);
+      case Action::TEST_SEND_KEY:
+        return client->TestSendKey(action.key, output);
+      case Action::SEND_COMMAND:
+        return client->SendCommand(action.command, output);
+    }
+    return false;
+  }
+
+  const std::vector<std::vector<Action>> *scenarios_;
+  const size_t index_;
+  std::atomic<bool> stopping_;
+  std::atomic<uint64> errors_;
+  Mutex mutex_;
+  std::vector<double> latencies_usec_;
+
+  DISALLOW_COPY_AND_ASSIGN(ClientThread);
+};
+
+double Percentile(const std::vector<double> &sorted, double p) {
+  if (sorted.empty()) {
+    return 0.0;
+  }
+  const size_t index = std::min(
+      sorted.size() - 1, static_cast<size_t>(p * (sorted.size() - 1) + 0.5));
+  return sorted[index];
+}
+
+// Runs a step of |threads| for --step_duration_sec and prints the result to
+// |os|, and to |json| as a JSON object.
+void RunStep(uint32 server_pid,
+             const std::vector<std::unique_ptr<ClientThread>> &threads,
+             std::ostream *os, string *json) {
+  // Discards the requests sent while the clients were being started.
+  std::vector<double> latencies_usec;
+  for (const auto &thread : threads) {
+    thread->TakeLatencies(&latencies_usec);
+  }
+  latencies_usec.clear();
+
+  ProcessStats start_stats;
+  const bool has_stats = GetProcessStats(server_pid, &start_stats);
+  string rss_json;
+  Stopwatch stopwatch = Stopwatch::StartNew();
+  const int interval_sec = std::max(1, FLAGS_sample_interval_sec);
+  for (int elapsed_sec = 0; elapsed_sec < FLAGS_step_duration_sec;) {
+    const int sleep_sec =
+        std::min(interval_sec, FLAGS_step_duration_sec - elapsed_sec);
+    Util::Sleep(sleep_sec * 1000);
+    elapsed_sec += sleep_sec;
+    ProcessStats stats;
+    if (has_stats && GetProcessStats(server_pid, &stats)) {
+      *os << Util::StringPrintf(
+                 "  clients=%d t=%ds rss=%lluKB",
+                 static_cast<int>(threads.size()), elapsed_sec,
+                 static_cast<unsigned long long>(stats.rss_bytes / 1024))  // NOLINT
+          << std::endl;
+      rss_json.append(Util::StringPrintf(
+          "%s{\"sec\": %d, \"rss_bytes\": %llu}",
+          rss_json.empty() ? "" : ", ", elapsed_sec,
+          static_cast<unsigned long long>(stats.rss_bytes)));  // NOLINT
+    }
+  }
+  stopwatch.Stop();
+  ProcessStats end_stats;
+  const bool has_end_stats =
+      has_stats && GetProcessStats(server_pid, &end_stats);
+
+  uint64 errors = 0;
+  for (const auto &thread : threads) {
+    errors += thread->TakeLatencies(&latencies_usec);
+  }
+  std::sort(latencies_usec.begin(), latencies_usec.end());
+  const double elapsed_sec = stopwatch.GetElapsedMicroseconds() / 1e6;
+  const double requests_per_sec =
+      elapsed_sec > 0.0 ? latencies_usec.size() / elapsed_sec : 0.0;
+  const double cpu_usec_per_request =
+      has_end_stats && !latencies_usec.empty()
+          ? static_cast<double>(end_stats.cpu_usec - start_stats.cpu_usec) /
+                latencies_usec.size()
+          : 0.0;
+
+  *os << Util::StringPrintf(
+             "clients=%-4d requests=%-8d errors=%-6llu requests/sec=%.0f "
+             "p50=%.2fms p90=%.2fms p99=%.2fms max=%.2fms "
+             "server_cpu/request=%.1fus server_rss=%lluKB",
+             static_cast<int>(threads.size()),
+             static_cast<int>(latencies_usec.size()),
+             static_cast<unsigned long long>(errors),  // NOLINT
+             requests_per_sec, Percentile(latencies_usec, 0.5) / 1000,
+             Percentile(latencies_usec, 0.9) / 1000,
+             Percentile(latencies_usec, 0.99) / 1000,
+             latencies_usec.empty() ? 0.0 : latencies_usec.back() / 1000,
+             cpu_usec_per_request,
+             static_cast<unsigned long long>(end_stats.rss_bytes / 1024))  // NOLINT
+      << std::endl;
+  json->append(Util::StringPrintf(
+      "{\"clients\": %d, \"requests\": %d, \"errors\": %llu, "
+      "\"requests_per_sec\": %.2f, \"p50_usec\": %.2f, \"p90_usec\": %.2f, "
+      "\"p99_usec\": %.2f, \"max_usec\": %.2f, "
+      "\"server_cpu_usec_per_request\": %.2f, \"rss\": [%s]}",
+      static_cast<int>(threads.size()),
+      static_cast<int>(latencies_usec.size()),
+      static_cast<unsigned long long>(errors),  // NOLINT
+      requests_per_sec, Percentile(latencies_usec, 0.5),
+      Percentile(latencies_usec, 0.9), Percentile(latencies_usec, 0.99),
+      latencies_usec.empty() ? 0.0 : latencies_usec.back(),
+      cpu_usec_per_request, rss_json.c_str()));
+}
+
+}  // namespace
+}  // namespace mozc
+
+int main(int argc, char **argv) {
+  mozc::InitMozc(argv[0], &argc, &argv, false);
+  mozc::SetFlag(&FLAGS_logtostderr, true);
+
+  std::vector<std::vector<mozc::Action>> scenarios;
+  std::vector<string> files;
+  mozc::Util::SplitStringUsing(FLAGS_scenario_files, ",", &files);
+  for (const string &file : files) {
+    scenarios.push_back(std::vector<mozc::Action>());
+    mozc::LoadScenario(file, &scenarios.back());
+  }
+
+  std::vector<string> steps;
+  mozc::Util::SplitStringUsing(FLAGS_clients, ",", &steps);
+  CHECK(!steps.empty()) << "--clients is required";
+
+  // Launches the server if it is not running yet.
+  {
+    mozc::client::Client client;
+    if (!FLAGS_server_path.empty()) {
+      client.set_server_program(FLAGS_server_path);
+    }
+    CHECK(client.IsValidRunLevel()) << "IsValidRunLevel failed";
+    CHECK(client.EnsureSession()) << "EnsureSession failed";
+    CHECK(client.NoOperation()) << "Server is not responding";
+  }
+  const uint32 server_pid =
+      mozc::IPCClient(mozc::kServerAddress, FLAGS_server_path)
+          .GetServerProcessId();
+  LOG_IF(WARNING, server_pid == 0) << "Cannot get the server process id";
+
+  std::vector<std::unique_ptr<mozc::ClientThread>> threads;
+  string json = "{\"steps\": [";
+  for (size_t i = 0; i < steps.size(); ++i) {
+    const size_t num_clients = mozc::NumberUtil::SimpleAtoi(steps[i]);
+    CHECK_GE(num_clients, threads.size()) << "--clients must be ascending";
+    while (threads.size() < num_clients) {
+      threads.emplace_back(new mozc::ClientThread(&scenarios, threads.size()));
+      threads.back()->SetJoinable(true);
+      threads.back()->Start("LoadGeneratorClient");
+    }
+    if (i > 0) {
+      json.append(", ");
+    }
+    mozc::RunStep(server_pid, threads, &std::cout, &json);
+  }
+  json.append("]}\n");
+
+  for (const auto &thread : threads) {
+    thread->Stop();
+  }
+  for (const auto &thread : threads) {
+    thread->Join();
+  }
+
+  if (!FLAGS_json_output.empty()) {
+    mozc::OutputFileStream ofs(FLAGS_json_output.c_str());
+    CHECK(ofs) << "Cannot open " << FLAGS_json_output;
+    ofs << json;
+  }
+  return 0;
+}
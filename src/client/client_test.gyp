@@ -47,16 +47,33 @@
         'test_size': 'small',
       },
     },
+    {
+      'target_name': 'async_client_test',
+      'type': 'executable',
+      'sources': [
+        'async_client_test.cc',
+      ],
+      'dependencies': [
+        'client.gyp:client',
+        'client.gyp:client_mock',
+        '../testing/testing.gyp:gtest_main',
+      ],
+      'variables': {
+        'test_size': 'small',
+      },
+    },
     # Test cases meta target: this target is referred from gyp/tests.gyp
     {
       'target_name': 'client_all_test',
       'type': 'none',
       'dependencies': [
+        'async_client_test',
         'client_test',
       ],
       'conditions': [
         ['target_platform=="Android"', {
           'dependencies!': [
+            'async_client_test',
             'client_test',
           ],
         }],
@@ -94,7 +94,8 @@ const string LoadServerFlags() {
 ServerLauncher::ServerLauncher()
     : server_program_(SystemUtil::GetServerPath()),
       restricted_(false),
-      suppress_error_dialog_(false) {}
+      suppress_error_dialog_(false),
+      prespawn_(false) {}
 
 ServerLauncher::~ServerLauncher() {}
 
@@ -130,6 +131,13 @@ bool ServerLauncher::StartServer(ClientInterface *client) {
   }
 #endif
 
+  if (prespawn_) {
+    if (!arg.empty()) {
+      arg += " ";
+    }
+    arg += "--prespawn";
+  }
+
 #ifdef DEBUG
   // In oreder to test the Session treatment (timeout/size constratins),
   // Server flags can be configurable on DEBUG build
@@ -185,6 +193,13 @@ bool ServerLauncher::StartServer(ClientInterface *client) {
   }
 #endif  // OS_WIN
 
+  if (prespawn_) {
+    // Nobody is waiting for the pre-spawned server. The clients wait for it
+    // when they connect for the first time.
+    VLOG(1) << "Pre-spawned " << kProductNameInEnglish;
+    return true;
+  }
+
   // maybe another process will launch mozc_server at the same time.
   if (client->PingServer()) {
     VLOG(1) << "Another process has launched the server";
@@ -36,6 +36,9 @@
 
 DEFINE_bool(shutdown, false,
             "shutdown server if mozc_server is running");
+DEFINE_bool(prespawn, false,
+            "launch mozc_server at background priority without waiting for "
+            "it, e.g. at login");
 
 // simple command line tool to launch mozc server
 int main(int argc, char **argv) {
@@ -46,6 +49,17 @@ int main(int argc, char **argv) {
     client.Shutdown();
   }
 
+  if (FLAGS_prespawn) {
+    mozc::client::ServerLauncher launcher;
+    launcher.set_prespawn(true);
+    if (launcher.StartServer(&client)) {
+      LOG(INFO) << "mozc_server is pre-spawned";
+    } else {
+      LOG(ERROR) << "failed to pre-spawn mozc_server";
+    }
+    return 0;
+  }
+
   if (client.EnsureConnection()) {
     LOG(INFO) << "mozc_server starts successfully";
   } else {
@@ -31,6 +31,7 @@
 
 #include "composer/composer.h"
 
+#include "base/allocation_stats.h"
 #include "base/flags.h"
 #include "base/logging.h"
 #include "base/util.h"
@@ -489,6 +490,7 @@ void Composer::InsertCharacterKeyAndPreeditForProbableKeyEvents(
 }
 
 bool Composer::InsertCharacterKeyEvent(const commands::KeyEvent &key) {
+  ScopedAllocationStage allocation_stage(AllocationStats::COMPOSER);
   if (!EnableInsert()) {
     return false;
   }
@@ -606,6 +608,7 @@ void Composer::EditErase() {
 }
 
 void Composer::Backspace() {
+  ScopedAllocationStage allocation_stage(AllocationStats::COMPOSER);
   if (position_ == 0) {
     return;
   }
@@ -903,12 +906,24 @@ void Composer::GetSubTransliterations(
     const size_t position,
     const size_t size,
     transliteration::Transliterations *transliterations) const {
-  string t13n;
+  // The composition is traversed once per transliterator.  The upper, lower
+  // and capitalized variants of ASCII only differ in post-processing, so they
+  // are derived from HALF_ASCII and FULL_ASCII.
+  transliteration::Transliterations t13ns(transliteration::NUM_T13N_TYPES);
+  static const transliteration::TransliterationType kBaseTypes[] = {
+    transliteration::HIRAGANA,
+    transliteration::FULL_KATAKANA,
+    transliteration::HALF_ASCII,
+    transliteration::FULL_ASCII,
+    transliteration::HALF_KATAKANA,
+  };
+  for (size_t i = 0; i < arraysize(kBaseTypes); ++i) {
+    GetSubTransliteration(kBaseTypes[i], position, size, &t13ns[kBaseTypes[i]]);
+  }
+  transliteration::T13n::FillAsciiCaseVariants(&t13ns);
   for (size_t i = 0; i < transliteration::NUM_T13N_TYPES; ++i) {
-    const transliteration::TransliterationType t13n_type =
-      transliteration::TransliterationTypeArray[i];
-    GetSubTransliteration(t13n_type, position, size, &t13n);
-    transliterations->push_back(t13n);
+    transliterations->push_back(
+        t13ns[transliteration::TransliterationTypeArray[i]]);
   }
 }
 
@@ -29,6 +29,7 @@
 
 #include "composer/composer.h"
 
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <utility>
@@ -2810,6 +2811,10 @@ class MockTypingModel : public TypingModel {
   int GetCost(StringPiece key) const override {
     return 10;
   }
+  void GetCosts(StringPiece context, StringPiece keys,
+                int *costs) const override {
+    std::fill(costs, costs + keys.size(), 10);
+  }
 };
 
 // Test fixture for setting up mobile qwerty romaji table to test typing
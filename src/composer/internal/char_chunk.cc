@@ -117,6 +117,7 @@ CharChunk::CharChunk(Transliterators::Transliterator transliterator,
 }
 
 void CharChunk::Clear() {
+  ClearResultCache();
   raw_.clear();
   conversion_.clear();
   pending_.clear();
@@ -124,20 +125,27 @@ void CharChunk::Clear() {
 }
 
 size_t CharChunk::GetLength(Transliterators::Transliterator t12r) const {
-  const string t13n = Transliterate(
-      t12r,
-      Table::DeleteSpecialKey(raw_),
-      Table::DeleteSpecialKey(conversion_ + pending_));
-  return Util::CharsLen(t13n);
+  return Util::CharsLen(GetResult(t12r));
 }
 
 void CharChunk::AppendResult(Transliterators::Transliterator t12r,
                              string *result) const {
-  const string t13n = Transliterate(
+  result->append(GetResult(t12r));
+}
+
+const string &CharChunk::GetResult(
+    Transliterators::Transliterator t12r) const {
+  for (size_t i = 0; i < result_cache_.size(); ++i) {
+    if (result_cache_[i].first == t12r) {
+      return result_cache_[i].second;
+    }
+  }
+  result_cache_.emplace_back(
       t12r,
-      Table::DeleteSpecialKey(raw_),
-      Table::DeleteSpecialKey(conversion_ + pending_));
-  result->append(t13n);
+      Transliterate(t12r,
+                    Table::DeleteSpecialKey(raw_),
+                    Table::DeleteSpecialKey(conversion_ + pending_)));
+  return result_cache_.back().second;
 }
 
 void CharChunk::AppendTrimedResult(Transliterators::Transliterator t12r,
@@ -277,6 +285,7 @@ bool CharChunk::IsConvertible(
 }
 
 void CharChunk::Combine(const CharChunk &left_chunk) {
+  ClearResultCache();
   conversion_ = left_chunk.conversion_ + conversion_;
   raw_ = left_chunk.raw_ + raw_;
   // TODO(komatsu): This is a hacky way.  We should look up the
@@ -294,6 +303,7 @@ void CharChunk::Combine(const CharChunk &left_chunk) {
 }
 
 bool CharChunk::AddInputInternal(string *input) {
+  ClearResultCache();
   const bool kNoLoop = false;
 
   size_t key_length = 0;
@@ -391,6 +401,7 @@ void CharChunk::AddInput(string *input) {
 }
 
 void CharChunk::AddConvertedChar(string *input) {
+  ClearResultCache();
   // TODO(komatsu) Nice to make "string Util::PopOneChar(string *str);".
   string first_char = Util::SubString(*input, 0, 1);
   conversion_.append(first_char);
@@ -400,6 +411,7 @@ void CharChunk::AddConvertedChar(string *input) {
 
 void CharChunk::AddInputAndConvertedChar(string *key,
                                          string *converted_char) {
+  ClearResultCache();
   // If this chunk is empty, the key and converted_char are simply
   // copied.
   if (raw_.empty() && pending_.empty() && conversion_.empty()) {
@@ -511,6 +523,7 @@ void CharChunk::SetTransliterator(
     // Just ignore.
     return;
   }
+  ClearResultCache();
   transliterator_ = transliterator;
 }
 
@@ -519,6 +532,7 @@ const string &CharChunk::raw() const {
 }
 
 void CharChunk::set_raw(const string &raw) {
+  ClearResultCache();
   raw_ = raw;
 }
 
@@ -527,6 +541,7 @@ const string &CharChunk::conversion() const {
 }
 
 void CharChunk::set_conversion(const string &conversion) {
+  ClearResultCache();
   conversion_ = conversion;
 }
 
@@ -535,6 +550,7 @@ const string &CharChunk::pending() const {
 }
 
 void CharChunk::set_pending(const string &pending) {
+  ClearResultCache();
   pending_ = pending;
 }
 
@@ -543,6 +559,7 @@ const string &CharChunk::ambiguous() const {
 }
 
 void CharChunk::set_ambiguous(const string &ambiguous) {
+  ClearResultCache();
   ambiguous_ = ambiguous;
 }
 
@@ -554,6 +571,7 @@ bool CharChunk::SplitChunk(Transliterators::Transliterator t12r,
     return false;
   }
 
+  ClearResultCache();
   string raw_lhs, raw_rhs, converted_lhs, converted_rhs;
   Transliterators::GetTransliterator(GetTransliterator(t12r))->Split(
       position,
@@ -32,6 +32,8 @@
 
 #include <set>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "base/port.h"
 #include "composer/internal/transliterators.h"
@@ -134,6 +136,10 @@ class CharChunk {
   string Transliterate(Transliterators::Transliterator transliterator,
                        const string &raw, const string &converted) const;
 
+  // Returns the string appended by AppendResult().  It is cached for each
+  // transliterator until this chunk is modified.
+  const string &GetResult(Transliterators::Transliterator transliterator) const;
+
   // Test only
   const string &raw() const;
   // Test only
@@ -163,6 +169,9 @@ class CharChunk {
   FRIEND_TEST(CharChunkTest, Clone);
   FRIEND_TEST(CharChunkTest, GetTransliterator);
 
+  // Must be called by every method modifying the members below.
+  void ClearResultCache() { result_cache_.clear(); }
+
   Transliterators::Transliterator transliterator_;
   const Table *table_;
 
@@ -171,6 +180,10 @@ class CharChunk {
   string pending_;
   string ambiguous_;
   TableAttributes attributes_;
+
+  // Pairs of a transliterator and its GetResult().
+  mutable std::vector<std::pair<Transliterators::Transliterator, string>>
+      result_cache_;
 };
 
 }  // namespace composer
@@ -1791,5 +1791,45 @@ TEST(CharChunkTest, GetTransliterator) {
   }
 }
 
+TEST(CharChunkTest, ResultsAreUpdatedByModifications) {
+  Table table;
+  table.AddRule("ka", "か", "");
+  table.AddRule("n", "ん", "");
+  table.AddRule("na", "な", "");
+
+  CharChunk chunk(Transliterators::CONVERSION_STRING, &table);
+  string input = "n";
+  chunk.AddInput(&input);
+  string result;
+  chunk.AppendResult(Transliterators::LOCAL, &result);
+  EXPECT_EQ("n", result);
+  EXPECT_EQ(1, chunk.GetLength(Transliterators::RAW_STRING));
+
+  input = "a";
+  chunk.AddInput(&input);
+  result.clear();
+  chunk.AppendResult(Transliterators::LOCAL, &result);
+  EXPECT_EQ("な", result);
+  EXPECT_EQ(2, chunk.GetLength(Transliterators::RAW_STRING));
+
+  chunk.SetTransliterator(Transliterators::FULL_KATAKANA);
+  result.clear();
+  chunk.AppendResult(Transliterators::LOCAL, &result);
+  EXPECT_EQ("ナ", result);
+
+  CharChunk *left_chunk = NULL;
+  ASSERT_TRUE(chunk.SplitChunk(Transliterators::RAW_STRING, 1, &left_chunk));
+  std::unique_ptr<CharChunk> left_chunk_deleter(left_chunk);
+  result.clear();
+  chunk.AppendResult(Transliterators::RAW_STRING, &result);
+  EXPECT_EQ("a", result);
+  EXPECT_EQ(1, chunk.GetLength(Transliterators::RAW_STRING));
+
+  chunk.Clear();
+  result.clear();
+  chunk.AppendResult(Transliterators::RAW_STRING, &result);
+  EXPECT_EQ("", result);
+}
+
 }  // namespace composer
 }  // namespace mozc
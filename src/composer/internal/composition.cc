@@ -49,11 +49,8 @@ Composition::~Composition() {
 }
 
 void Composition::Erase() {
-  CharChunkList::iterator it;
-  for (it = chunks_.begin(); it != chunks_.end(); ++it) {
-    delete *it;
-  }
   chunks_.clear();
+  InvalidateCache();
 }
 
 size_t Composition::InsertAt(size_t pos, const string &input) {
@@ -85,7 +82,7 @@ size_t Composition::InsertInput(size_t pos, const CompositionInput &input) {
   CompositionInput mutable_input;
   mutable_input.CopyFrom(input);
   while (true) {
-    (*left_chunk)->AddCompositionInput(&mutable_input);
+    MutableChunk(left_chunk)->AddCompositionInput(&mutable_input);
     if (mutable_input.Empty()) {
       break;
     }
@@ -118,13 +115,14 @@ size_t Composition::DeleteAt(const size_t position) {
     // If a chunk contains only invisible characters,
     // the result of GetLength is 0.
     if ((*chunk_it)->GetLength(Transliterators::LOCAL) <= 1) {
-      delete *chunk_it;
       chunks_.erase(chunk_it);
+      InvalidateCache();
       continue;
     }
 
     CharChunk *left_deleted_chunk_ptr = NULL;
-    (*chunk_it)->SplitChunk(Transliterators::LOCAL, 1, &left_deleted_chunk_ptr);
+    MutableChunk(chunk_it)->SplitChunk(Transliterators::LOCAL, 1,
+                                       &left_deleted_chunk_ptr);
     std::unique_ptr<CharChunk> left_deleted_chunk(left_deleted_chunk_ptr);
   }
   return new_position;
@@ -216,10 +214,10 @@ void Composition::SetTransliterator(
 
   // chunk_it and end_it can be the same iterator from the beginning.
   while (chunk_it != end_it) {
-    (*chunk_it)->SetTransliterator(transliterator);
+    MutableChunk(chunk_it)->SetTransliterator(transliterator);
     ++chunk_it;
   }
-  (*end_it)->SetTransliterator(transliterator);
+  MutableChunk(end_it)->SetTransliterator(transliterator);
 }
 
 Transliterators::Transliterator
@@ -233,7 +231,11 @@ Composition::GetTransliterator(size_t position) {
 }
 
 size_t Composition::GetLength() const {
-  return GetPosition(Transliterators::LOCAL, chunks_.end());
+  if (!length_cached_) {
+    cached_length_ = GetPosition(Transliterators::LOCAL, chunks_.end());
+    length_cached_ = true;
+  }
+  return cached_length_;
 }
 
 void Composition::GetStringWithModes(
@@ -248,6 +250,13 @@ void Composition::GetStringWithModes(
     return;
   }
 
+  const StringCache::key_type cache_key(transliterator, trim_mode);
+  const StringCache::const_iterator cached = string_cache_.find(cache_key);
+  if (cached != string_cache_.end()) {
+    *composition = cached->second;
+    return;
+  }
+
   CharChunkList::const_iterator it;
   for (it = chunks_.begin(); *it != chunks_.back(); ++it) {
     (*it)->AppendResult(transliterator, composition);
@@ -265,8 +274,9 @@ void Composition::GetStringWithModes(
       break;
     default:
       LOG(WARNING) << "Unexpected trim mode: " << trim_mode;
-      break;
+      return;
   }
+  string_cache_[cache_key] = *composition;
 }
 
 void Composition::GetExpandedStrings(string *base,
@@ -298,17 +308,14 @@ void Composition::GetExpandedStringsWithTransliterator(
 }
 
 void Composition::GetString(string *composition) const {
-  composition->clear();
   if (chunks_.empty()) {
+    composition->clear();
     VLOG(1) << "The composition size is zero.";
     return;
   }
 
-  for (CharChunkList::const_iterator it = chunks_.begin();
-       it != chunks_.end();
-       ++it) {
-    (*it)->AppendResult(Transliterators::LOCAL, composition);
-  }
+  // Appending the results of all the chunks as is.
+  GetStringWithModes(Transliterators::LOCAL, ASIS, composition);
 }
 
 void Composition::GetStringWithTransliterator(
@@ -382,15 +389,17 @@ CharChunk *Composition::MaybeSplitChunkAt(const size_t pos,
   size_t inner_position;
   GetChunkAt(pos, Transliterators::LOCAL, it, &inner_position);
 
-  CharChunk *chunk = **it;
+  CharChunk *chunk = (*it)->get();
   if (inner_position == chunk->GetLength(Transliterators::LOCAL)) {
     ++(*it);
     return chunk;
   }
 
   CharChunk *left_chunk = NULL;
-  chunk->SplitChunk(Transliterators::LOCAL, inner_position, &left_chunk);
-  chunks_.insert(*it, left_chunk);
+  MutableChunk(*it)->SplitChunk(Transliterators::LOCAL, inner_position,
+                                &left_chunk);
+  chunks_.insert(*it, std::shared_ptr<CharChunk>(left_chunk));
+  InvalidateCache();
   return left_chunk;
 }
 
@@ -408,16 +417,16 @@ void Composition::CombinePendingChunks(
       return;
     }
 
-    (*it)->Combine(**left_it);
-    delete *left_it;
+    MutableChunk(it)->Combine(**left_it);
     chunks_.erase(left_it);
+    InvalidateCache();
   }
 }
 
 // Insert a chunk to the prev of it.
 CharChunkList::iterator Composition::InsertChunk(CharChunkList::iterator *it) {
-  CharChunk *new_chunk = new CharChunk(input_t12r_, table_);
-  return chunks_.insert(*it, new_chunk);
+  InvalidateCache();
+  return chunks_.insert(*it, std::make_shared<CharChunk>(input_t12r_, table_));
 }
 
 const CharChunkList &Composition::GetCharChunkList() const {
@@ -447,14 +456,28 @@ Composition *Composition::CloneImpl() const {
   object->input_t12r_ = input_t12r_;
   object->table_ = table_;
 
-  for (CharChunkList::const_iterator it = chunks_.begin();
-       it != chunks_.end(); ++it) {
-    object->chunks_.push_back((*it)->Clone());
-  }
+  // Share the chunks.  They are copied by MutableChunk() on modification.
+  object->chunks_ = chunks_;
+  object->length_cached_ = length_cached_;
+  object->cached_length_ = cached_length_;
+  object->string_cache_ = string_cache_;
 
   return object;
 }
 
+CharChunk *Composition::MutableChunk(CharChunkList::iterator it) {
+  if (it->use_count() > 1) {
+    it->reset((*it)->Clone());
+  }
+  InvalidateCache();
+  return it->get();
+}
+
+void Composition::InvalidateCache() {
+  length_cached_ = false;
+  string_cache_.clear();
+}
+
 // Return charchunk to be inserted and iterator of the *next* char chunk.
 CharChunkList::iterator Composition::GetInsertionChunk(
     CharChunkList::iterator *it) {
@@ -465,6 +488,8 @@ CharChunkList::iterator Composition::GetInsertionChunk(
   CharChunkList::iterator left_it = *it;
   --left_it;
   if ((*left_it)->IsAppendable(input_t12r_, table_)) {
+    // The caller is going to modify the chunk.
+    InvalidateCache();
     return left_it;
   }
   return InsertChunk(it);
@@ -33,8 +33,11 @@
 #include "composer/composition_interface.h"
 
 #include <list>
+#include <map>
+#include <memory>
 #include <set>
 #include <string>
+#include <utility>
 
 #include "base/port.h"
 
@@ -42,7 +45,8 @@ namespace mozc {
 namespace composer {
 
 class CharChunk;
-typedef std::list<CharChunk*> CharChunkList;
+// Chunks are shared between clones and copied when they are modified.
+typedef std::list<std::shared_ptr<CharChunk>> CharChunkList;
 
 class CompositionInput;
 class Table;
@@ -101,7 +105,8 @@ class Composition : public CompositionInterface {
   // Return true if the composition is adviced to be committed immediately.
   virtual bool ShouldCommit() const;
 
-  // Get a clone.
+  // Get a clone.  This is cheap since the clone shares the chunks with
+  // this object until either of them modifies them.
   // Clone is a thin wrapper of CloneImpl.
   // CloneImpl is created to write test codes without dynamic_cast.
   virtual CompositionInterface *Clone() const;
@@ -142,6 +147,14 @@ class Composition : public CompositionInterface {
   }
 
  private:
+  // Return the chunk at |it| to be modified.  The chunk is copied first if
+  // it is shared with other compositions.
+  CharChunk *MutableChunk(CharChunkList::iterator it);
+
+  // Drop the cached length and strings.  Must be called whenever the
+  // chunks are modified.
+  void InvalidateCache();
+
   void GetStringWithModes(Transliterators::Transliterator transliterator,
                           TrimMode trim_mode,
                           string *output) const;
@@ -150,6 +163,14 @@ class Composition : public CompositionInterface {
   CharChunkList chunks_;
   Transliterators::Transliterator input_t12r_;
 
+  // Caches of GetLength() and GetStringWithModes() so that repeated
+  // queries between edits do not traverse all the chunks.
+  mutable bool length_cached_ = false;
+  mutable size_t cached_length_ = 0;
+  typedef std::map<std::pair<Transliterators::Transliterator, TrimMode>,
+                   string> StringCache;
+  mutable StringCache string_cache_;
+
   DISALLOW_COPY_AND_ASSIGN(Composition);
 };
 
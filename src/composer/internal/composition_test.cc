@@ -110,7 +110,7 @@ static int InitComposition(Composition* comp) {
   comp->MaybeSplitChunkAt(0, &it);
   for (int i = 0; i < test_chunks_size; ++i) {
     const TestCharChunk& data = test_chunks[i];
-    CharChunk* chunk = *comp->InsertChunk(&it);
+    CharChunk* chunk = comp->InsertChunk(&it)->get();
     chunk->set_conversion(data.conversion);
     chunk->set_pending(data.pending);
     chunk->set_raw(data.raw);
@@ -125,7 +125,7 @@ static CharChunk *AppendChunk(const char *conversion,
   CharChunkList::iterator it;
   comp->MaybeSplitChunkAt(comp->GetLength(), &it);
 
-  CharChunk* chunk = *comp->InsertChunk(&it);
+  CharChunk* chunk = comp->InsertChunk(&it)->get();
   chunk->set_conversion(conversion);
   chunk->set_pending(pending);
   chunk->set_raw(raw);
@@ -490,15 +490,15 @@ TEST_F(CompositionTest, DeleteAt_InvisibleCharacter) {
 
   composition_->MaybeSplitChunkAt(0, &it);
 
-  chunk = *composition_->InsertChunk(&it);
+  chunk = composition_->InsertChunk(&it)->get();
   chunk->set_raw("1");
   chunk->set_pending(Table::ParseSpecialKey("{1}"));
 
-  chunk = *composition_->InsertChunk(&it);
+  chunk = composition_->InsertChunk(&it)->get();
   chunk->set_raw("2");
   chunk->set_pending(Table::ParseSpecialKey("{2}2"));
 
-  chunk = *composition_->InsertChunk(&it);
+  chunk = composition_->InsertChunk(&it)->get();
   chunk->set_raw("3");
   chunk->set_pending("3");
 
@@ -1792,5 +1792,76 @@ TEST_F(CompositionTest, Clone) {
   }
 }
 
+TEST_F(CompositionTest, CachedStringsAreUpdatedByEdits) {
+  table_->AddRule("ka", "か", "");
+  table_->AddRule("ki", "き", "");
+
+  string result;
+  composition_->InsertAt(0, "k");
+  composition_->GetString(&result);
+  EXPECT_EQ("k", result);
+  EXPECT_EQ(1, composition_->GetLength());
+
+  composition_->InsertAt(1, "a");
+  composition_->GetString(&result);
+  EXPECT_EQ("か", result);
+  EXPECT_EQ(1, composition_->GetLength());
+  composition_->GetStringWithTransliterator(Transliterators::RAW_STRING,
+                                           &result);
+  EXPECT_EQ("ka", result);
+
+  composition_->InsertAt(1, "ki");
+  composition_->GetString(&result);
+  EXPECT_EQ("かき", result);
+  EXPECT_EQ(2, composition_->GetLength());
+  composition_->GetStringWithTransliterator(Transliterators::RAW_STRING,
+                                           &result);
+  EXPECT_EQ("kaki", result);
+
+  composition_->SetTransliterator(0, 2, Transliterators::FULL_KATAKANA);
+  composition_->GetString(&result);
+  EXPECT_EQ("カキ", result);
+
+  composition_->DeleteAt(0);
+  composition_->GetString(&result);
+  EXPECT_EQ("キ", result);
+  EXPECT_EQ(1, composition_->GetLength());
+
+  composition_->Erase();
+  composition_->GetString(&result);
+  EXPECT_EQ("", result);
+  EXPECT_EQ(0, composition_->GetLength());
+}
+
+TEST_F(CompositionTest, CloneSharesChunksUntilModified) {
+  table_->AddRule("ka", "か", "");
+  table_->AddRule("ki", "き", "");
+
+  Composition src(table_.get());
+  src.InsertAt(0, "ka");
+  src.InsertAt(1, "k");
+
+  std::unique_ptr<Composition> dest(src.CloneImpl());
+  EXPECT_EQ(src.chunks().front().get(), dest->chunks().front().get());
+  EXPECT_EQ(src.chunks().back().get(), dest->chunks().back().get());
+
+  dest->InsertAt(2, "i");
+  string src_string, dest_string;
+  src.GetString(&src_string);
+  dest->GetString(&dest_string);
+  EXPECT_EQ("かk", src_string);
+  EXPECT_EQ("かき", dest_string);
+
+  // The unchanged chunk is still shared.
+  EXPECT_EQ(src.chunks().front().get(), dest->chunks().front().get());
+  EXPECT_NE(src.chunks().back().get(), dest->chunks().back().get());
+
+  src.DeleteAt(0);
+  src.GetString(&src_string);
+  dest->GetString(&dest_string);
+  EXPECT_EQ("k", src_string);
+  EXPECT_EQ("かき", dest_string);
+}
+
 }  // namespace composer
 }  // namespace mozc
@@ -0,0 +1,111 @@
+# -*- coding: utf-8 -*-
+# Copyright 2010-2018, Google Inc.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are
+# met:
+#
+#     * Redistributions of source code must retain the above copyright
+# notice, this list of conditions and the following disclaimer.
+#     * Redistributions in binary form must reproduce the above
+# copyright notice, this list of conditions and the following disclaimer
+# in the documentation and/or other materials provided with the
+# distribution.
+#     * Neither the name of Google Inc. nor the names of its
+# contributors may be used to endorse or promote products derived from
+# this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+# "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+# A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+# OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+# LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+# DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+# THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+"""Converts preedit tables to binary images embedded in the data set.
+
+Usage:
+  $ gen_preedit_table.py --output_dir=out_dir table1.tsv table2.tsv ...
+
+Each table.tsv is written to out_dir/preedit_table.tsv.data, which is a
+SerializedStringArray (see base/serialized_string_array.h) of four strings per
+rule: input, output, pending, and one byte of the TableAttributes defined in
+composer/table.h.  The rules keep the order of the file, since later rules
+override earlier ones, and lines are handled the same way as
+composer::Table::LoadFromStream().
+"""
+
+import logging
+import optparse
+import os
+import struct
+import sys
+
+from build_tools import serialized_string_array_builder
+
+# See composer::TableAttribute.
+_ATTRIBUTES = {
+    'NewChunk': 1,
+    'NoTransliteration': 2,
+    'DirectInput': 4,
+    'EndChunk': 8,
+}
+
+
+def ParseArgs():
+  """Parses command line options and returns them."""
+  parser = optparse.OptionParser()
+  parser.add_option('--output_dir', dest='output_dir',
+                    help='Output directory.')
+  return parser.parse_args()
+
+
+def ParseAttributes(field):
+  attributes = 0
+  for attribute in field.split(' '):
+    attributes |= _ATTRIBUTES.get(attribute, 0)
+  return attributes
+
+
+def ReadRules(path):
+  """Reads the rules of a preedit table as a flat list of strings."""
+  strings = []
+  with open(path, 'rb') as f:
+    for line in f:
+      line = line.rstrip('\r\n')
+      if not line:
+        continue
+      fields = line.split('\t')
+      if len(fields) == 4:
+        attributes = ParseAttributes(fields[3])
+      elif len(fields) in (2, 3):
+        attributes = 0
+      else:
+        if not line.startswith('#'):
+          logging.error('Format error: %s', line)
+        continue
+      pending = fields[2] if len(fields) >= 3 else ''
+      strings.extend([fields[0], fields[1], pending,
+                      struct.pack('<B', attributes)])
+  return strings
+
+
+def main():
+  options, args = ParseArgs()
+  if not options.output_dir:
+    logging.error('--output_dir is required.')
+    sys.exit(1)
+  for path in args:
+    output = os.path.join(options.output_dir,
+                          'preedit_%s.data' % os.path.basename(path))
+    serialized_string_array_builder.SerializeToFile(ReadRules(path), output)
+
+
+if __name__ == '__main__':
+  main()
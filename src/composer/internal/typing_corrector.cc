@@ -36,6 +36,7 @@
 #include <vector>
 
 #include "base/flags.h"
+#include "base/logging.h"
 #include "base/port.h"
 #include "base/string_piece.h"
 #include "composer/internal/composition.h"
@@ -55,24 +56,41 @@ namespace composer {
 
 namespace {
 
-// Looks up model cost for current key given previous keys.
-int LookupModelCost(const string &prev, const string &current,
-                    const TypingModel &typing_model) {
-  if (current.size() != 1) {
-    return TypingModel::kInfinity;
-  }
-  char trigram[4] = { '^', '^', current[0], '\0' };
+// Gets the context of the typing model for the key following |prev|, i.e.,
+// the last two keys of |prev| padded with '^'.
+void GetModelContext(const string &prev, char context[2]) {
+  context[0] = '^';
+  context[1] = '^';
   if (prev.size() == 1) {
-    trigram[1] = prev[0];
+    context[1] = prev[0];
   } else if (prev.size() >= 2) {
-    trigram[0] = prev[prev.size() - 2];
-    trigram[1] = prev[prev.size() - 1];
+    context[0] = prev[prev.size() - 2];
+    context[1] = prev[prev.size() - 1];
   }
+}
 
-  const int cost = typing_model.GetCost(trigram);
-  return cost == TypingModel::kNoData ? TypingModel::kInfinity : cost;
+// Appends |key| to the tail of |composition|.
+void AppendKey(StringPiece key, bool is_new_input, Composition *composition) {
+  CompositionInput input;
+  input.set_raw(key.as_string());
+  input.set_is_new_input(is_new_input);
+  composition->InsertInput(composition->GetLength(), input);
 }
 
+// A candidate of the new correction: |top_n_[prev]| followed by the |event|th
+// probable key.
+struct Expansion {
+  size_t prev;
+  size_t event;
+  int cost;
+};
+
+struct ExpansionLess {
+  bool operator()(const Expansion &l, const Expansion &r) const {
+    return l.cost < r.cost;
+  }
+};
+
 inline int Cost(double prob) {
   return static_cast<int>(-500.0 * log(prob));
 }
@@ -80,12 +98,6 @@ inline int Cost(double prob) {
 }  // namespace
 
 
-struct TypingCorrector::KeyAndPenaltyLess {
-  bool operator()(const KeyAndPenalty &l, const KeyAndPenalty &r) const {
-    return l.second < r.second;
-  }
-};
-
 TypingCorrector::TypingCorrector(const Table *table,
                                  size_t max_correction_query_candidates,
                                  size_t max_correction_query_results)
@@ -108,33 +120,97 @@ void TypingCorrector::InsertCharacter(
     for (size_t i = 0; i < top_n_.size(); ++i) {
       top_n_[i].first.append(key.data(), key.size());
     }
+    ClearCompositions();
     return;
   }
 
+  const bool update_compositions = MaybeStartCompositions(key);
+
   // Approximation of dynamic programming to find N least cost key sequences.
   // At each insertion, generate all the possible paths from previous N least
   // key sequences, and keep only new N least key sequences.
-  std::vector<KeyAndPenalty> tmp;
-  tmp.reserve(top_n_.size() * probable_key_events.size());
+  // The costs of the probable keys are calculated once, and the model costs
+  // of all the keys following each correction are looked up at once.  Only
+  // the surviving paths are materialized into strings.
+  const size_t events_size = probable_key_events.size();
+  string keys(events_size, '\0');
+  std::vector<int> event_costs(events_size);
+  for (size_t j = 0; j < events_size; ++j) {
+    const ProbableKeyEvent &event = probable_key_events.Get(j);
+    keys[j] = static_cast<char>(event.key_code());
+    event_costs[j] = Cost(event.probability());
+  }
+
+  const TypingModel &typing_model = *table_->typing_model();
+  std::vector<int> model_costs(events_size);
+  std::vector<Expansion> expansions;
+  expansions.reserve(top_n_.size() * events_size);
   for (size_t i = 0; i < top_n_.size(); ++i) {
-    for (size_t j = 0; j < probable_key_events.size(); ++j) {
-      const ProbableKeyEvent& event = probable_key_events.Get(j);
-      const string key_as_string(1, event.key_code());
-      const int new_cost = top_n_[i].second + Cost(event.probability())
-          + LookupModelCost(top_n_[i].first, key_as_string,
-                            *table_->typing_model());
+    char context[2];
+    GetModelContext(top_n_[i].first, context);
+    typing_model.GetCosts(StringPiece(context, 2), keys, model_costs.data());
+    for (size_t j = 0; j < events_size; ++j) {
+      const int model_cost = model_costs[j] == TypingModel::kNoData ?
+          TypingModel::kInfinity : model_costs[j];
+      const int new_cost = top_n_[i].second + event_costs[j] + model_cost;
       if (new_cost < TypingModel::kInfinity) {
-        tmp.push_back(
-            std::make_pair(top_n_[i].first + key_as_string, new_cost));
+        const Expansion expansion = { i, j, new_cost };
+        expansions.push_back(expansion);
       }
     }
   }
   const size_t cutoff_size =
-      std::min(max_correction_query_candidates_, tmp.size());
-  std::partial_sort(tmp.begin(), tmp.begin() + cutoff_size, tmp.end(),
-                    KeyAndPenaltyLess());
-  tmp.resize(cutoff_size);
-  top_n_.swap(tmp);
+      std::min(max_correction_query_candidates_, expansions.size());
+  std::partial_sort(expansions.begin(), expansions.begin() + cutoff_size,
+                    expansions.end(), ExpansionLess());
+
+  std::vector<KeyAndPenalty> new_top_n(cutoff_size);
+  std::vector<std::shared_ptr<const Composition>> new_compositions;
+  if (update_compositions) {
+    new_compositions.reserve(cutoff_size);
+  }
+  for (size_t k = 0; k < cutoff_size; ++k) {
+    const Expansion &expansion = expansions[k];
+    const StringPiece new_key(keys.data() + expansion.event, 1);
+    new_top_n[k].first.reserve(top_n_[expansion.prev].first.size() + 1);
+    new_top_n[k].first = top_n_[expansion.prev].first;
+    new_top_n[k].first.append(new_key.data(), new_key.size());
+    new_top_n[k].second = expansion.cost;
+    if (update_compositions) {
+      Composition *composition =
+          compositions_[expansion.prev]->CloneImpl();
+      AppendKey(new_key, top_n_[expansion.prev].first.empty(), composition);
+      new_compositions.emplace_back(composition);
+    }
+  }
+  top_n_.swap(new_top_n);
+  compositions_.swap(new_compositions);
+}
+
+bool TypingCorrector::MaybeStartCompositions(StringPiece key) {
+  // |raw_key_| already contains |key|.
+  const bool is_first_key = raw_key_.size() == key.size() &&
+                            top_n_.size() == 1 && top_n_[0].first.empty();
+  if (is_first_key) {
+    raw_composition_.reset(new Composition(table_));
+    compositions_.assign(top_n_.size(), std::shared_ptr<const Composition>(
+        new Composition(table_)));
+  }
+  if (!HasCompositions()) {
+    return false;
+  }
+  AppendKey(key, is_first_key, raw_composition_.get());
+  return true;
+}
+
+bool TypingCorrector::HasCompositions() const {
+  return raw_composition_ != nullptr &&
+         compositions_.size() == top_n_.size();
+}
+
+void TypingCorrector::ClearCompositions() {
+  raw_composition_.reset();
+  compositions_.clear();
 }
 
 void TypingCorrector::Reset() {
@@ -142,6 +218,7 @@ void TypingCorrector::Reset() {
   top_n_.clear();
   top_n_.push_back(KeyAndPenalty("", 0));
   available_ = true;
+  ClearCompositions();
 }
 
 void TypingCorrector::Invalidate() {
@@ -161,9 +238,14 @@ void TypingCorrector::CopyFrom(const TypingCorrector &src) {
   max_correction_query_candidates_ = src.max_correction_query_candidates_;
   max_correction_query_results_ = src.max_correction_query_results_;
   top_n_ = src.top_n_;
+  // |raw_key_| is not copied, so the compositions are not either.
+  ClearCompositions();
 }
 
 void TypingCorrector::SetTable(const Table *table) {
+  if (table != table_) {
+    ClearCompositions();
+  }
   table_ = table;
 
   if (!raw_key_.empty()) {
@@ -183,7 +265,9 @@ void TypingCorrector::GetQueriesForPrediction(
   if (!IsAvailable() || table_ == NULL || raw_key_.empty()) {
     return;
   }
-  // These objects are for cache. Used and reset repeatedly.
+  // The compositions kept by InsertCharacter are used if available.
+  // Otherwise these objects are for cache. Used and reset repeatedly.
+  const bool has_compositions = HasCompositions();
   Composition c(table_);
   CompositionInput input;
   // We shouldn't return such queries which can be created from
@@ -209,12 +293,16 @@ void TypingCorrector::GetQueriesForPrediction(
   // e.g. "kaish" -> "かいしゃ", "かいしゅ" and "かいしょ".
   std::set<string> raw_queries;
   {
-    input.set_raw(raw_key_);
-    input.set_is_new_input(true);
-    c.InsertInput(0, input);
     string raw_base;
     std::set<string> raw_expanded;
-    c.GetExpandedStrings(&raw_base, &raw_expanded);
+    if (has_compositions) {
+      raw_composition_->GetExpandedStrings(&raw_base, &raw_expanded);
+    } else {
+      input.set_raw(raw_key_);
+      input.set_is_new_input(true);
+      c.InsertInput(0, input);
+      c.GetExpandedStrings(&raw_base, &raw_expanded);
+    }
     if (raw_expanded.empty()) {
       raw_queries.insert(raw_base);
     } else {
@@ -245,12 +333,16 @@ void TypingCorrector::GetQueriesForPrediction(
     TypeCorrectedQuery *query = &queries->at(result_count);
     // Fill TypeCorrectedQuery's base and expanded field
     // by using cached objects.
-    input.Clear();
-    input.set_raw(correction.first);
-    input.set_is_new_input(true);
-    c.Erase();
-    c.InsertInput(0, input);
-    c.GetExpandedStrings(&query->base, &query->expanded);
+    if (has_compositions) {
+      compositions_[i]->GetExpandedStrings(&query->base, &query->expanded);
+    } else {
+      input.Clear();
+      input.set_raw(correction.first);
+      input.set_is_new_input(true);
+      c.Erase();
+      c.InsertInput(0, input);
+      c.GetExpandedStrings(&query->base, &query->expanded);
+    }
     if (query->expanded.empty()) {
       // This typing correction input has no ambiguity.
       // e.g. "syamoji" -> "しゃもじ".
@@ -30,6 +30,7 @@
 #ifndef MOZC_COMPOSER_INTERNAL_TYPING_CORRECTOR_H_
 #define MOZC_COMPOSER_INTERNAL_TYPING_CORRECTOR_H_
 
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
@@ -48,6 +49,7 @@ class KeyEvent_ProbableKeyEvent;
 
 namespace composer {
 
+class Composition;
 class Table;
 struct TypeCorrectedQuery;
 
@@ -99,9 +101,18 @@ class TypingCorrector {
   // Represents one type-correction: key sequence and its penalty (cost).
   typedef std::pair<string, int> KeyAndPenalty;
 
-  // Less-than comparator for KeyAndPenalty. Since this functor accesses
-  // KeyAndPenalty, we need to define it in private member.
-  struct KeyAndPenaltyLess;
+  // Starts |raw_composition_| and |compositions_| on the first key, and
+  // appends |key| to |raw_composition_|.  Returns true if |compositions_|
+  // should be extended by the new corrections.
+  bool MaybeStartCompositions(StringPiece key);
+
+  // Returns true if |raw_composition_| and |compositions_| are maintained for
+  // |raw_key_| and |top_n_|.
+  bool HasCompositions() const;
+
+  // Drops |raw_composition_| and |compositions_|.  GetQueriesForPrediction
+  // composes the queries from scratch afterwards.
+  void ClearCompositions();
 
   bool available_;
   const Table *table_;
@@ -110,6 +121,12 @@ class TypingCorrector {
   const config::Config *config_;
   string raw_key_;
   std::vector<KeyAndPenalty> top_n_;
+  // The compositions of |raw_key_| and of each key of |top_n_|, extended by
+  // one key on each insertion so that the table is not re-walked from the
+  // beginning of every correction.  The compositions of |top_n_| are shared
+  // by the corrections derived from the same key sequence.
+  std::unique_ptr<Composition> raw_composition_;
+  std::vector<std::shared_ptr<const Composition>> compositions_;
 
   DISALLOW_COPY_AND_ASSIGN(TypingCorrector);
 };
@@ -339,6 +339,10 @@ class TypingCorrectorTest : public ::testing::Test {
     }
   }
 
+  void ClearCompositions(TypingCorrector *corrector) {
+    corrector->ClearCompositions();
+  }
+
   const testing::MockDataManager mock_data_manager_;
   Config config_;
   Table qwerty_table_;
@@ -413,6 +417,32 @@ TEST_F(TypingCorrectorTest, TypingCorrection) {
   }
 }
 
+TEST_F(TypingCorrectorTest, IncrementalComposition) {
+  const char *kKeys[] = {
+    "phayou", "orukaresama", "kaish", "syamozi",
+  };
+  for (size_t i = 0; i < arraysize(kKeys); ++i) {
+    SCOPED_TRACE(string("key: ") + kKeys[i]);
+    TypingCorrector corrector(&qwerty_table_, 30, 30);
+    corrector.SetConfig(&config_);
+    InsertOneByOne(kKeys[i], &corrector);
+    std::vector<TypeCorrectedQuery> incremental_queries;
+    corrector.GetQueriesForPrediction(&incremental_queries);
+
+    // The queries composed from scratch should be the same.
+    ClearCompositions(&corrector);
+    std::vector<TypeCorrectedQuery> queries;
+    corrector.GetQueriesForPrediction(&queries);
+
+    ASSERT_EQ(queries.size(), incremental_queries.size());
+    for (size_t j = 0; j < queries.size(); ++j) {
+      EXPECT_EQ(queries[j].base, incremental_queries[j].base);
+      EXPECT_EQ(queries[j].expanded, incremental_queries[j].expanded);
+      EXPECT_EQ(queries[j].cost, incremental_queries[j].cost);
+    }
+  }
+}
+
 TEST_F(TypingCorrectorTest, Invalidate) {
   const CostTableForTest *table = Singleton<CostTableForTest>::get();
 
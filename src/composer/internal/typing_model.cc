@@ -60,12 +60,16 @@ TypingModel::TypingModel(const char *characters,
 TypingModel::~TypingModel() = default;
 
 int TypingModel::GetCost(StringPiece key) const {
-  size_t index = GetIndex(key);
-  if (index >= cost_table_size_) {
-    return kInfinity;
+  return GetCostAt(GetIndex(key));
+}
+
+void TypingModel::GetCosts(StringPiece context, StringPiece keys,
+                           int *costs) const {
+  const unsigned int radix = characters_size_ + 1;
+  const size_t base_index = GetIndex(context) * radix;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    costs[i] = GetCostAt(base_index + character_to_radix_table_[keys[i]]);
   }
-  uint8 cost_index = cost_table_[index];
-  return cost_index == kNoData ? kInfinity : mapping_table_[cost_index];
 }
 
 size_t TypingModel::GetIndex(StringPiece key) const {
@@ -60,6 +60,14 @@ class TypingModel {
   // virtual for mocking.
   virtual int GetCost(StringPiece key) const;
 
+  // Gets the costs of |keys| following |context| at once, i.e., sets
+  // GetCost(context + keys[i]) to costs[i] for each character of |keys|.
+  // The index of |context| is calculated only once, so this is faster than
+  // calling GetCost for each key.  |costs| must have |keys.size()| elements.
+  // virtual for mocking.
+  virtual void GetCosts(StringPiece context, StringPiece keys,
+                        int *costs) const;
+
   // Creates a TypingModel based on SpecialRomanjiTable.
   // nullptr if no corresponding model is available.
   static std::unique_ptr<const TypingModel> CreateTypingModel(
@@ -75,6 +83,7 @@ class TypingModel {
  private:
   FRIEND_TEST(TypingModelTest, Constructor);
   FRIEND_TEST(TypingModelTest, GetIndex);
+  FRIEND_TEST(TypingModelTest, GetCosts);
 
   // Gets index from key.
   // Given cost table via the constructor is simple array
@@ -83,6 +92,15 @@ class TypingModel {
   // c.f. gen_typing_model.py's GetIndexFromKey.
   size_t GetIndex(StringPiece key) const;
 
+  // Gets cost value from the index given by GetIndex.
+  int GetCostAt(size_t index) const {
+    if (index >= cost_table_size_) {
+      return kInfinity;
+    }
+    const uint8 cost_index = cost_table_[index];
+    return cost_index == kNoData ? kInfinity : mapping_table_[cost_index];
+  }
+
   // Radix table, needed by GetIndex.
   std::unique_ptr<unsigned char[]> character_to_radix_table_;
   const size_t characters_size_;
@@ -64,5 +64,35 @@ TEST_F(TypingModelTest, GetIndex) {
   ASSERT_EQ(31, model.GetIndex("aaa"));
 }
 
+TEST_F(TypingModelTest, GetCosts) {
+  const char* characters = "ab";
+  // Indices: "" = 0, "a" = 1, "b" = 2, "aa" = 4, "ab" = 5, "ba" = 7,
+  // "bb" = 8.
+  const uint8 costs[] = {
+    0, 1, 2, 3, 4, TypingModel::kNoData, 0, 1,
+  };
+  const int32 mapping[] = {
+    10, 20, 30, 40, 50,
+  };
+  TypingModel model(characters, strlen(characters), costs, arraysize(costs),
+                    mapping);
+  int result[3] = {};
+  model.GetCosts("a", "aab", result);
+  EXPECT_EQ(model.GetCost("aa"), result[0]);
+  EXPECT_EQ(model.GetCost("aa"), result[1]);
+  EXPECT_EQ(model.GetCost("ab"), result[2]);
+  EXPECT_EQ(50, result[0]);
+  EXPECT_EQ(TypingModel::kInfinity, result[2]);
+
+  model.GetCosts("b", "ab", result);
+  EXPECT_EQ(20, result[0]);
+  // Out of the cost table.
+  EXPECT_EQ(TypingModel::kInfinity, result[1]);
+
+  model.GetCosts("", "ab", result);
+  EXPECT_EQ(20, result[0]);
+  EXPECT_EQ(30, result[1]);
+}
+
 }  // namespace composer
 }  // namespace mozc
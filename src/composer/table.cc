@@ -32,6 +32,7 @@
 #include "composer/table.h"
 
 #include <istream>  // NOLINT
+#include <algorithm>
 #include <map>
 #include <memory>
 #include <sstream>
@@ -43,7 +44,8 @@
 #include "base/hash.h"
 #include "base/logging.h"
 #include "base/port.h"
-#include "base/trie.h"
+#include "base/serialized_string_array.h"
+#include "base/string_piece.h"
 #include "base/util.h"
 #include "composer/internal/typing_model.h"
 #include "config/config_handler.h"
@@ -81,9 +83,27 @@ const char kNotouchHiraganaTableFile[] = "system://notouch-hiragana.tsv";
 const char kNotouchHalfwidthasciiTableFile[]
     = "system://qwerty_mobile-halfwidthascii.tsv";
 
+const char kSystemPrefix[] = "system://";
 const char kNewChunkPrefix[] = "\t";
 const char kSpecialKeyOpen[] = "\x0F";  // Shift-In of ASCII
 const char kSpecialKeyClose[] = "\x0E";  // Shift-Out of ASCII
+
+// Orders entries by their inputs in byte order.
+struct InputLess {
+  bool operator()(const Entry *entry, StringPiece input) const {
+    return entry->input().compare(0, string::npos,
+                                  input.data(), input.size()) < 0;
+  }
+};
+
+size_t GetCommonPrefixLength(const string &lhs, const string &rhs) {
+  const size_t size = std::min(lhs.size(), rhs.size());
+  size_t i = 0;
+  while (i < size && lhs[i] == rhs[i]) {
+    ++i;
+  }
+  return i;
+}
 }  // namespace
 
 // ========================================
@@ -102,8 +122,7 @@ Entry::Entry(const string &input,
 // Table
 // ========================================
 Table::Table()
-    : entries_(new EntryTrie),
-      case_sensitive_(false) {}
+    : case_sensitive_(false) {}
 
 Table::~Table() {
   ResetEntrySet();
@@ -174,7 +193,7 @@ bool Table::InitializeWithRequestAndConfig(
       default:
         table_file_name = NULL;
     }
-    if (table_file_name && LoadFromFile(table_file_name)) {
+    if (table_file_name && LoadSystemTable(table_file_name, data_manager)) {
       return true;
     }
   }
@@ -183,10 +202,10 @@ bool Table::InitializeWithRequestAndConfig(
       result = (config.has_custom_roman_table() &&
                 !config.custom_roman_table().empty()) ?
           LoadFromString(config.custom_roman_table()) :
-          LoadFromFile(kRomajiPreeditTableFile);
+          LoadSystemTable(kRomajiPreeditTableFile, data_manager);
       break;
     case config::Config::KANA:
-      result = LoadFromFile(kRomajiPreeditTableFile);
+      result = LoadSystemTable(kRomajiPreeditTableFile, data_manager);
       break;
     default:
       LOG(ERROR) << "Unkonwn preedit method: " << config.preedit_method();
@@ -194,7 +213,7 @@ bool Table::InitializeWithRequestAndConfig(
   }
 
   if (!result) {
-    result = LoadFromFile(kDefaultPreeditTableFile);
+    result = LoadSystemTable(kDefaultPreeditTableFile, data_manager);
     if (!result) {
       return false;
     }
@@ -272,7 +291,7 @@ bool Table::InitializeWithRequestAndConfig(
   CHECK(result);
 
   // Load Kana combination rules.
-  result = LoadFromFile(kKanaCombinationTableFile);
+  result = LoadSystemTable(kKanaCombinationTableFile, data_manager);
   return result;
 }
 
@@ -338,14 +357,15 @@ const Entry *Table::AddRuleWithAttributes(const string &escaped_input,
     return NULL;
   }
 
-  const Entry *old_entry = NULL;
-  if (entries_->LookUp(input, &old_entry)) {
-    DeleteEntry(old_entry);
-  }
-
   Entry *entry = new Entry(input, output, pending, attributes);
-  entries_->AddEntry(input, entry);
-  entry_set_.insert(entry);
+  EntryArray::iterator it = std::lower_bound(
+      entries_.begin(), entries_.end(), input, InputLess());
+  if (it != entries_.end() && (*it)->input() == input) {
+    delete *it;
+    *it = entry;
+  } else {
+    entries_.insert(it, entry);
+  }
 
   // Check if the input has a large captal character.
   // Invisible character is exception.
@@ -371,11 +391,12 @@ void Table::DeleteRule(const string &input) {
   //     - This method is not used.
   //     - This method has no tests.
   //     - This method is private scope.
-  const Entry *old_entry;
-  if (entries_->LookUp(input, &old_entry)) {
-    DeleteEntry(old_entry);
+  EntryArray::iterator it = std::lower_bound(
+      entries_.begin(), entries_.end(), input, InputLess());
+  if (it != entries_.end() && (*it)->input() == input) {
+    delete *it;
+    entries_.erase(it);
   }
-  entries_->DeleteEntry(input);
 }
 
 bool Table::LoadFromString(const string &str) {
@@ -391,6 +412,37 @@ bool Table::LoadFromFile(const char *filepath) {
   return LoadFromStream(ifs.get());
 }
 
+bool Table::LoadFromData(StringPiece data) {
+  SerializedStringArray rules;
+  if (!rules.Init(data) || rules.size() % 4 != 0) {
+    LOG(ERROR) << "Broken preedit table data";
+    return false;
+  }
+  for (size_t i = 0; i < rules.size(); i += 4) {
+    const StringPiece attributes = rules[i + 3];
+    AddRuleWithAttributes(
+        rules[i].as_string(), rules[i + 1].as_string(),
+        rules[i + 2].as_string(),
+        attributes.empty() ? NO_TABLE_ATTRIBUTE
+                           : static_cast<uint8>(attributes[0]));
+  }
+  return true;
+}
+
+bool Table::LoadSystemTable(const char *filepath,
+                            const DataManagerInterface &data_manager) {
+  StringPiece name(filepath);
+  if (Util::StartsWith(name, kSystemPrefix)) {
+    name.remove_prefix(arraysize(kSystemPrefix) - 1);
+    const StringPiece data =
+        data_manager.GetPreeditTable("preedit_" + name.as_string());
+    if (!data.empty()) {
+      return LoadFromData(data);
+    }
+  }
+  return LoadFromFile(filepath);
+}
+
 const TypingModel* Table::typing_model() const {
   return typing_model_.get();
 }
@@ -453,11 +505,11 @@ bool Table::LoadFromStream(std::istream *is) {
 const Entry *Table::LookUp(const string &input) const {
   const Entry *entry = NULL;
   if (case_sensitive_) {
-    entries_->LookUp(input, &entry);
+    entry = FindEntry(input);
   } else {
     string normalized_input = input;
     Util::LowerString(&normalized_input);
-    entries_->LookUp(normalized_input, &entry);
+    entry = FindEntry(normalized_input);
   }
   return entry;
 }
@@ -467,11 +519,11 @@ const Entry *Table::LookUpPrefix(const string &input,
                                  bool *fixed) const {
   const Entry *entry = NULL;
   if (case_sensitive_) {
-    entries_->LookUpPrefix(input, &entry, key_length, fixed);
+    entry = FindPrefixEntry(input, key_length, fixed);
   } else {
     string normalized_input = input;
     Util::LowerString(&normalized_input);
-    entries_->LookUpPrefix(normalized_input, &entry, key_length, fixed);
+    entry = FindPrefixEntry(normalized_input, key_length, fixed);
   }
   return entry;
 }
@@ -479,11 +531,11 @@ const Entry *Table::LookUpPrefix(const string &input,
 void Table::LookUpPredictiveAll(const string &input,
                                 std::vector<const Entry *> *results) const {
   if (case_sensitive_) {
-    entries_->LookUpPredictiveAll(input, results);
+    FindPredictiveEntries(input, results);
   } else {
     string normalized_input = input;
     Util::LowerString(&normalized_input);
-    entries_->LookUpPredictiveAll(normalized_input, results);
+    FindPredictiveEntries(normalized_input, results);
   }
 }
 
@@ -505,25 +557,93 @@ bool Table::HasNewChunkEntry(const string &input) const {
 
 bool Table::HasSubRules(const string &input) const {
   if (case_sensitive_) {
-    return entries_->HasSubTrie(input);
+    return HasEntryStartingWith(input);
   } else {
     string normalized_input = input;
     Util::LowerString(&normalized_input);
-    return entries_->HasSubTrie(normalized_input);
+    return HasEntryStartingWith(normalized_input);
   }
 }
 
-void Table::DeleteEntry(const Entry *entry) {
-  entry_set_.erase(entry);
-  delete entry;
+void Table::ResetEntrySet() {
+  for (size_t i = 0; i < entries_.size(); ++i) {
+    delete entries_[i];
+  }
+  entries_.clear();
 }
 
-void Table::ResetEntrySet() {
-  for (EntrySet::iterator it = entry_set_.begin(); it != entry_set_.end();
+const Entry *Table::FindEntry(const string &input) const {
+  const EntryArray::const_iterator it = std::lower_bound(
+      entries_.begin(), entries_.end(), input, InputLess());
+  if (it == entries_.end() || (*it)->input() != input) {
+    return NULL;
+  }
+  return *it;
+}
+
+// Emulates the prefix lookup of a character-wise trie: walks |input| as
+// deep as any entry shares it, and returns the entry at that depth if any.
+// Entries at shallower depths are intentionally not returned.
+const Entry *Table::FindPrefixEntry(const string &input,
+                                    size_t *key_length, bool *fixed) const {
+  // The longest common prefix with any entry is shared with one of the
+  // neighbors of the position where |input| would be inserted.
+  const EntryArray::const_iterator it = std::lower_bound(
+      entries_.begin(), entries_.end(), input, InputLess());
+  size_t common_length = 0;
+  if (it != entries_.end()) {
+    common_length = GetCommonPrefixLength((*it)->input(), input);
+  }
+  if (it != entries_.begin()) {
+    common_length = std::max(
+        common_length, GetCommonPrefixLength((*(it - 1))->input(), input));
+  }
+
+  // Align the length to the character boundary.
+  size_t length = 0;
+  while (length < input.size()) {
+    const size_t char_length = std::min(
+        static_cast<size_t>(Util::OneCharLen(input.data() + length)),
+        input.size() - length);
+    if (length + char_length > common_length) {
+      break;
+    }
+    length += char_length;
+  }
+  *key_length = length;
+
+  const StringPiece prefix(input.data(), length);
+  EntryArray::const_iterator pos = std::lower_bound(
+      entries_.begin(), entries_.end(), prefix, InputLess());
+  if (pos == entries_.end() || StringPiece((*pos)->input()) != prefix) {
+    *fixed = true;
+    return NULL;
+  }
+  const Entry *entry = *pos;
+  ++pos;
+  *fixed = (pos == entries_.end() ||
+            !Util::StartsWith((*pos)->input(), prefix));
+  return entry;
+}
+
+void Table::FindPredictiveEntries(const string &input,
+                                  std::vector<const Entry *> *results) const {
+  DCHECK(results);
+  for (EntryArray::const_iterator it = std::lower_bound(
+           entries_.begin(), entries_.end(), input, InputLess());
+       it != entries_.end() && Util::StartsWith((*it)->input(), input);
        ++it) {
-    delete *it;
+    results->push_back(*it);
   }
-  entry_set_.clear();
+}
+
+bool Table::HasEntryStartingWith(const string &input) const {
+  if (input.empty()) {
+    return false;
+  }
+  const EntryArray::const_iterator it = std::lower_bound(
+      entries_.begin(), entries_.end(), input, InputLess());
+  return it != entries_.end() && Util::StartsWith((*it)->input(), input);
 }
 
 bool Table::case_sensitive() const {
@@ -606,9 +726,7 @@ string Table::DeleteSpecialKey(const string &input) {
 // ========================================
 // TableContainer
 // ========================================
-TableManager::TableManager()
-    : custom_roman_table_fingerprint_(Hash::Fingerprint32("")) {
-}
+TableManager::TableManager() = default;
 
 TableManager::~TableManager() = default;
 
@@ -616,6 +734,13 @@ const Table *TableManager::GetTable(
     const mozc::commands::Request &request,
     const mozc::config::Config &config,
     const mozc::DataManagerInterface &data_manager) {
+  return GetSharedTable(request, config, data_manager).get();
+}
+
+std::shared_ptr<const Table> TableManager::GetSharedTable(
+    const mozc::commands::Request &request,
+    const mozc::config::Config &config,
+    const mozc::DataManagerInterface &data_manager) {
   // calculate the hash depending on the request and the config
   uint32 hash = request.special_romanji_table();
   hash = hash * (mozc::config::Config_PreeditMethod_PreeditMethod_MAX + 1)
@@ -626,41 +751,44 @@ const Table *TableManager::GetTable(
   hash = hash * (mozc::config::Config_SymbolMethod_SymbolMethod_MAX + 1)
       + config.symbol_method();
 
-  // When custom_roman_table is set, force to create new table.
-  bool update_custom_roman_table = false;
-  if ((config.preedit_method() == config::Config::ROMAN) &&
+  // Tables with custom_roman_table are cached per its contents so that
+  // switching between them does not rebuild the tables.
+  uint64 key = hash;
+  const bool use_custom_roman_table =
+      (config.preedit_method() == config::Config::ROMAN) &&
       config.has_custom_roman_table() &&
-      !config.custom_roman_table().empty()) {
-    const uint32 custom_roman_table_fingerprint =
-        Hash::Fingerprint32(config.custom_roman_table());
-    if (custom_roman_table_fingerprint != custom_roman_table_fingerprint_) {
-      update_custom_roman_table = true;
-      custom_roman_table_fingerprint_ = custom_roman_table_fingerprint;
-    }
+      !config.custom_roman_table().empty();
+  if (use_custom_roman_table) {
+    key |= static_cast<uint64>(
+        Hash::Fingerprint32(config.custom_roman_table())) << 32;
   }
 
-  const auto iterator = table_map_.find(hash);
+  const auto iterator = table_map_.find(key);
   if (iterator != table_map_.end()) {
-    if (update_custom_roman_table) {
-      // Delete the previous table to update the table.
-      table_map_.erase(iterator);
-    } else {
-      return iterator->second.get();
-    }
+    return iterator->second;
   }
 
-  std::unique_ptr<Table> table(new Table());
+  std::shared_ptr<Table> table(new Table());
   if (!table->InitializeWithRequestAndConfig(request, config, data_manager)) {
     return nullptr;
   }
 
-  const Table* ret = table.get();
-  table_map_[hash] = std::move(table);
-  return ret;
+  if (use_custom_roman_table) {
+    // The evicted table is deleted when the last user releases it.
+    const size_t kMaxCustomTables = 4;
+    if (custom_table_keys_.size() >= kMaxCustomTables) {
+      table_map_.erase(custom_table_keys_.front());
+      custom_table_keys_.erase(custom_table_keys_.begin());
+    }
+    custom_table_keys_.push_back(key);
+  }
+  table_map_[key] = table;
+  return table;
 }
 
 void TableManager::ClearCaches() {
   table_map_.clear();
+  custom_table_keys_.clear();
 }
 
 }  // namespace composer
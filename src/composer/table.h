@@ -27,7 +27,7 @@
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
-// Trie table for Romaji (or Kana) conversion
+// Table for Romaji (or Kana) conversion
 
 #ifndef MOZC_COMPOSER_TABLE_H_
 #define MOZC_COMPOSER_TABLE_H_
@@ -39,7 +39,7 @@
 #include <vector>
 
 #include "base/port.h"
-#include "base/trie.h"
+#include "base/string_piece.h"
 #include "data_manager/data_manager_interface.h"
 
 namespace mozc {
@@ -121,6 +121,9 @@ class Table {
 
   bool LoadFromString(const string &str);
   bool LoadFromFile(const char *filepath);
+  // Loads the rules of a preedit table pre-parsed by
+  // composer/internal/gen_preedit_table.py.
+  bool LoadFromData(StringPiece data);
 
   const Entry *LookUp(const string &input) const;
   const Entry *LookUpPrefix(const string &input,
@@ -152,13 +155,26 @@ class Table {
   friend class TypingCorrectionTest;
 
   bool LoadFromStream(std::istream *is);
-  void DeleteEntry(const Entry *entry);
+  // Loads a system table from the data set if it is embedded there, or
+  // parses the file otherwise.
+  bool LoadSystemTable(const char *filepath,
+                       const DataManagerInterface &data_manager);
   void ResetEntrySet();
 
-  typedef Trie<const Entry*> EntryTrie;
-  std::unique_ptr<EntryTrie> entries_;
-  typedef std::set<const Entry*> EntrySet;
-  EntrySet entry_set_;
+  // Lookup functions for normalized inputs.
+  const Entry *FindEntry(const string &input) const;
+  const Entry *FindPrefixEntry(const string &input,
+                               size_t *key_length, bool *fixed) const;
+  void FindPredictiveEntries(const string &input,
+                             std::vector<const Entry *> *results) const;
+  bool HasEntryStartingWith(const string &input) const;
+
+  // Owned entries sorted by their inputs in byte order.  Binary search on
+  // this flat array touches far fewer cache lines than a node-per-character
+  // trie, and the byte order of UTF-8 strings equals the depth-first order
+  // of the trie, so predictive lookups keep returning the same order.
+  typedef std::vector<const Entry *> EntryArray;
+  EntryArray entries_;
 
   // If false, input alphabet characters are normalized to lower
   // characters.  The default value is false.
@@ -180,18 +196,27 @@ class TableManager {
                         const config::Config &config,
                         const DataManagerInterface &data_manager);
 
+  // Same as GetTable, but the caller shares the ownership.  The returned
+  // table stays valid even after it is evicted from the caches.
+  std::shared_ptr<const Table> GetSharedTable(
+      const commands::Request &request,
+      const config::Config &config,
+      const DataManagerInterface &data_manager);
+
   void ClearCaches();
 
  private:
   // Table caches.
-  // Key uint32 is calculated hash and unique for
+  // Key uint64 is calculated hash and unique for
   //  commands::Request::SpecialRomanjiTable
   //  config::Config::PreeditMethod
   //  config::Config::PunctuationMethod
   //  config::Config::SymbolMethod
-  std::map<uint32, std::unique_ptr<const Table>> table_map_;
-  // Fingerprint for Config::custom_roman_table;
-  uint32 custom_roman_table_fingerprint_;
+  //  Fingerprint for Config::custom_roman_table
+  std::map<uint64, std::shared_ptr<const Table>> table_map_;
+  // Keys of the tables built from custom_roman_table, from the oldest.
+  // The number of them is bounded since the contents are user defined.
+  std::vector<uint64> custom_table_keys_;
 };
 
 }  // namespace composer
@@ -29,8 +29,14 @@
 
 #include "composer/table.h"
 
+#include <memory>
+#include <string>
+#include <vector>
+
 #include "base/file_util.h"
 #include "base/port.h"
+#include "base/serialized_string_array.h"
+#include "base/string_piece.h"
 #include "base/system_util.h"
 #include "composer/internal/composition_input.h"
 #include "config/config_handler.h"
@@ -143,6 +149,66 @@ TEST_F(TableTest, LookUpPredictiveAll) {
   EXPECT_EQ(6, results.size());
 }
 
+TEST_F(TableTest, LookUpPrefix) {
+  Table table;
+  table.AddRule("abc", "ABC", "");
+  table.AddRule("abd", "ABD", "");
+  table.AddRule("a", "A", "");
+  table.AddRule("あい", "AI", "");
+
+  size_t key_length = 0;
+  bool fixed = false;
+  const Entry *entry = table.LookUpPrefix("abc", &key_length, &fixed);
+  ASSERT_TRUE(entry != NULL);
+  EXPECT_EQ("ABC", entry->result());
+  EXPECT_EQ(3, key_length);
+  EXPECT_TRUE(fixed);
+
+  entry = table.LookUpPrefix("abcd", &key_length, &fixed);
+  ASSERT_TRUE(entry != NULL);
+  EXPECT_EQ("ABC", entry->result());
+  EXPECT_EQ(3, key_length);
+  EXPECT_TRUE(fixed);
+
+  // "ab" has no entry, and "a" is not referred.
+  EXPECT_TRUE(NULL == table.LookUpPrefix("abe", &key_length, &fixed));
+  EXPECT_EQ(2, key_length);
+  EXPECT_TRUE(fixed);
+
+  entry = table.LookUpPrefix("ac", &key_length, &fixed);
+  ASSERT_TRUE(entry != NULL);
+  EXPECT_EQ("A", entry->result());
+  EXPECT_EQ(1, key_length);
+  EXPECT_FALSE(fixed);
+
+  EXPECT_TRUE(NULL == table.LookUpPrefix("b", &key_length, &fixed));
+  EXPECT_EQ(0, key_length);
+  EXPECT_TRUE(fixed);
+
+  // The key length is measured by characters.
+  EXPECT_TRUE(NULL == table.LookUpPrefix("あう", &key_length, &fixed));
+  EXPECT_EQ(strlen("あ"), key_length);
+
+  std::vector<const Entry *> results;
+  table.LookUpPredictiveAll("a", &results);
+  ASSERT_EQ(3, results.size());
+  EXPECT_EQ("A", results[0]->result());
+  EXPECT_EQ("ABC", results[1]->result());
+  EXPECT_EQ("ABD", results[2]->result());
+
+  EXPECT_TRUE(table.HasSubRules("ab"));
+  EXPECT_FALSE(table.HasSubRules("ae"));
+
+  // Overwriting and deleting rules keep the table consistent.
+  table.AddRule("abc", "XYZ", "");
+  EXPECT_EQ("XYZ", table.LookUp("abc")->result());
+  table.DeleteRule("abc");
+  EXPECT_TRUE(NULL == table.LookUp("abc"));
+  entry = table.LookUpPrefix("abd", &key_length, &fixed);
+  ASSERT_TRUE(entry != NULL);
+  EXPECT_EQ("ABD", entry->result());
+}
+
 TEST_F(TableTest, Punctuations) {
   static const struct TestCase {
     config::Config::PunctuationMethod method;
@@ -918,6 +984,77 @@ TEST_F(TableTest, LoadFromString) {
   EXPECT_EQ("", entry->pending());
 }
 
+TEST_F(TableTest, LoadFromData) {
+  const char kNewChunk[] = "\x01";
+  const char kNoAttribute[] = "\x00";
+  const std::vector<StringPiece> rules = {
+      "a", "[A]", "", StringPiece(kNoAttribute, 1),
+      "kk", "[X]", "k", StringPiece(kNoAttribute, 1),
+      "ww", "[W]", "w", kNewChunk,
+  };
+  std::unique_ptr<uint32[]> buffer;
+  Table table;
+  EXPECT_TRUE(table.LoadFromData(
+      SerializedStringArray::SerializeToBuffer(rules, &buffer)));
+
+  const Entry *entry = table.LookUp("a");
+  ASSERT_TRUE(NULL != entry);
+  EXPECT_EQ("[A]", entry->result());
+  EXPECT_EQ("", entry->pending());
+  EXPECT_EQ(NO_TABLE_ATTRIBUTE, entry->attributes());
+
+  entry = table.LookUp("kk");
+  ASSERT_TRUE(NULL != entry);
+  EXPECT_EQ("[X]", entry->result());
+  EXPECT_EQ("k", entry->pending());
+
+  EXPECT_TRUE(table.HasNewChunkEntry("ww"));
+  entry = table.LookUp("ww");
+  ASSERT_TRUE(NULL != entry);
+  EXPECT_EQ(NEW_CHUNK, entry->attributes());
+
+  // The number of strings must be a multiple of four.
+  const std::vector<StringPiece> broken_rules = {"a", "[A]", ""};
+  Table broken_table;
+  EXPECT_FALSE(broken_table.LoadFromData(
+      SerializedStringArray::SerializeToBuffer(broken_rules, &buffer)));
+}
+
+TEST_F(TableTest, PreeditTablesInDataSet) {
+  // The tables embedded in the data set have the same rules as the files.
+  const char *kTables[] = {
+      "romanji-hiragana.tsv", "kana.tsv", "12keys-hiragana.tsv",
+      "flick-hiragana.tsv", "toggle_flick-hiragana.tsv",
+      "qwerty_mobile-hiragana.tsv", "godan-hiragana.tsv",
+  };
+  const char *kInputs[] = {
+      "a", "ka", "kya", "nn", "n", "xtu", "-", "1", "11", "*", "\t",
+  };
+  for (const char *name : kTables) {
+    SCOPED_TRACE(name);
+    const StringPiece data =
+        mock_data_manager_.GetPreeditTable(string("preedit_") + name);
+    ASSERT_FALSE(data.empty());
+    Table from_data;
+    ASSERT_TRUE(from_data.LoadFromData(data));
+    Table from_file;
+    ASSERT_TRUE(from_file.LoadFromFile((string("system://") + name).c_str()));
+    EXPECT_EQ(from_file.case_sensitive(), from_data.case_sensitive());
+    for (const char *input : kInputs) {
+      const Entry *expected = from_file.LookUp(input);
+      const Entry *actual = from_data.LookUp(input);
+      if (expected == NULL) {
+        EXPECT_TRUE(actual == NULL) << input;
+        continue;
+      }
+      ASSERT_TRUE(actual != NULL) << input;
+      EXPECT_EQ(expected->result(), actual->result());
+      EXPECT_EQ(expected->pending(), actual->pending());
+      EXPECT_EQ(expected->attributes(), actual->attributes());
+    }
+  }
+}
+
 TEST_F(TableTest, SpecialKeys) {
   {
     Table table;
@@ -1067,7 +1204,45 @@ TEST_F(TableTest, TableManager) {
                                        mock_data_manager_) == table2);
     EXPECT_TRUE(NULL != table2->LookUp("a"));
     EXPECT_TRUE(NULL != table2->LookUp("kk"));
+
+    // Switching back to the previous rules reuses the cached table.
+    config.set_custom_roman_table(kRule);
+    EXPECT_TRUE(table_manager.GetTable(request, config,
+                                       mock_data_manager_) == table);
+  }
+}
+
+TEST_F(TableTest, TableManagerSharedTable) {
+  TableManager table_manager;
+  commands::Request request;
+  config::Config config;
+  config.set_preedit_method(Config::ROMAN);
+  config.set_custom_roman_table("a\t[A]\n");
+
+  std::shared_ptr<const Table> table =
+      table_manager.GetSharedTable(request, config, mock_data_manager_);
+  ASSERT_TRUE(table != nullptr);
+  EXPECT_TRUE(table_manager.GetSharedTable(request, config,
+                                           mock_data_manager_) == table);
+
+  // Evict the table by adding other custom tables.
+  for (int i = 0; i < 10; ++i) {
+    config::Config other_config(config);
+    other_config.set_custom_roman_table(
+        "a\t[A]\n" + std::to_string(i) + "\t[X]\n");
+    EXPECT_TRUE(table_manager.GetSharedTable(
+        request, other_config, mock_data_manager_) != nullptr);
   }
+
+  // The evicted table is still available for the holder.
+  const Entry *entry = table->LookUp("a");
+  ASSERT_TRUE(entry != NULL);
+  EXPECT_EQ("[A]", entry->result());
+  EXPECT_TRUE(table_manager.GetSharedTable(request, config,
+                                           mock_data_manager_) != table);
+
+  table_manager.ClearCaches();
+  EXPECT_TRUE(NULL != table->LookUp("a"));
 }
 
 }  // namespace composer
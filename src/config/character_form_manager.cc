@@ -227,6 +227,26 @@ uint16 GetNormalizedCharacter(const string &str) {
   return ucs2;
 }
 
+// Returns true if |str| consists only of kanji and hiragana.  They have no
+// width variants, so such |str| is never changed by the conversions below.
+bool IsKanjiOrHiraganaOnly(const string &str) {
+  const char *begin = str.data();
+  const char *const end = str.data() + str.size();
+  while (begin < end) {
+    size_t mblen = 0;
+    const char32 ucs4 = Util::UTF8ToUCS4(begin, end, &mblen);
+    if (mblen == 0) {
+      return false;
+    }
+    const Util::ScriptType type = Util::GetScriptType(ucs4);
+    if (type != Util::KANJI && type != Util::HIRAGANA) {
+      return false;
+    }
+    begin += mblen;
+  }
+  return true;
+}
+
 void ConvertToAlternative(const string &input, string *output,
                           Util::FormType form, Util::ScriptType type) {
   switch (form) {
@@ -472,6 +492,16 @@ bool CharacterFormManagerImpl::ConvertStringWithAlternative(
   // If require_consistent_conversion_ is true,
   // do not convert to inconsistent form string.
   DCHECK(output);
+  // Most of the conversion candidates are kanji and hiragana only.  Returns
+  // early for them without walking the string per form.
+  if (IsKanjiOrHiraganaOnly(str)) {
+    *output = str;
+    if (alternative_output != NULL) {
+      *alternative_output = str;
+    }
+    return false;
+  }
+
   output->clear();
   if (!TryConvertStringWithPreference(str, output) &&
       require_consistent_conversion_) {
@@ -461,6 +461,28 @@ TEST_F(CharacterFormManagerTest, MixedFormTest) {
   EXPECT_EQ("１.２３", output);
 }
 
+TEST_F(CharacterFormManagerTest, KanjiAndHiraganaOnly) {
+  CharacterFormManager *manager =
+      CharacterFormManager::GetCharacterFormManager();
+
+  string output, alternative_output;
+  EXPECT_FALSE(manager->ConvertConversionStringWithAlternative(
+      "漢字とひらがな", &output, &alternative_output));
+  EXPECT_EQ("漢字とひらがな", output);
+  EXPECT_EQ("漢字とひらがな", alternative_output);
+
+  EXPECT_FALSE(manager->ConvertConversionStringWithAlternative(
+      "", &output, &alternative_output));
+  EXPECT_EQ("", output);
+  EXPECT_EQ("", alternative_output);
+
+  // An alphabet makes the whole string convertible.
+  EXPECT_TRUE(manager->ConvertConversionStringWithAlternative(
+      "漢字とA", &output, &alternative_output));
+  EXPECT_EQ("漢字とＡ", output);
+  EXPECT_EQ("漢字とA", alternative_output);
+}
+
 TEST_F(CharacterFormManagerTest, GroupTest) {
   CharacterFormManager *manager =
       CharacterFormManager::GetCharacterFormManager();
@@ -32,8 +32,10 @@
 #include "config/config_handler.h"
 
 #include <algorithm>
+#include <atomic>
 #include <memory>
 #include <string>
+#include <utility>
 
 #include "base/clock.h"
 #include "base/config_file_stream.h"
@@ -77,7 +79,7 @@ bool GetPlatformSpecificDefaultEmojiSetting() {
 
 class ConfigHandlerImpl {
  public:
-  ConfigHandlerImpl() {
+  ConfigHandlerImpl() : generation_(0) {
     // <user_profile>/config1.db
     filename_ = kFileNamePrefix;
     filename_ += std::to_string(CONFIG_VERSION);
@@ -87,6 +89,8 @@ class ConfigHandlerImpl {
   }
   virtual ~ConfigHandlerImpl() {}
   bool GetConfig(Config *config) const;
+  std::shared_ptr<const Config> GetSharedConfig() const;
+  uint64 GetConfigGeneration() const;
   const Config &DefaultConfig() const;
   bool GetStoredConfig(Config *config) const;
   bool SetConfig(const Config &config);
@@ -104,8 +108,11 @@ class ConfigHandlerImpl {
   string filename_;
   Config stored_config_;
   Config imposed_config_;
-  // equals to config_.MergeFrom(imposed_config_)
-  Config merged_config_;
+  // equals to stored_config_.MergeFrom(imposed_config_).  Accessed with
+  // std::atomic_load() and std::atomic_store() so that readers don't need
+  // |mutex_|.
+  std::shared_ptr<const Config> merged_config_;
+  std::atomic<uint64> generation_;
   Config default_config_;
   mutable Mutex mutex_;
 };
@@ -116,11 +123,18 @@ ConfigHandlerImpl *GetConfigHandlerImpl() {
 
 // return current Config
 bool ConfigHandlerImpl::GetConfig(Config *config) const {
-  scoped_lock lock(&mutex_);
-  config->CopyFrom(merged_config_);
+  config->CopyFrom(*GetSharedConfig());
   return true;
 }
 
+std::shared_ptr<const Config> ConfigHandlerImpl::GetSharedConfig() const {
+  return std::atomic_load(&merged_config_);
+}
+
+uint64 ConfigHandlerImpl::GetConfigGeneration() const {
+  return generation_.load(std::memory_order_acquire);
+}
+
 const Config &ConfigHandlerImpl::DefaultConfig() const {
   return default_config_;
 }
@@ -167,8 +181,13 @@ bool ConfigHandlerImpl::SetConfigInternal(const Config &config) {
 }
 
 void ConfigHandlerImpl::UpdateMergedConfig() {
-  merged_config_.CopyFrom(stored_config_);
-  merged_config_.MergeFrom(imposed_config_);
+  std::shared_ptr<Config> merged_config(new Config(stored_config_));
+  merged_config->MergeFrom(imposed_config_);
+  std::atomic_store(&merged_config_,
+                    std::shared_ptr<const Config>(std::move(merged_config)));
+  // Incremented after the store so that the generation never gets ahead of
+  // the published snapshot.
+  generation_.fetch_add(1, std::memory_order_release);
 }
 
 bool ConfigHandlerImpl::SetConfig(const Config &config) {
@@ -248,6 +267,14 @@ bool ConfigHandler::GetConfig(Config *config) {
   return GetConfigHandlerImpl()->GetConfig(config);
 }
 
+std::shared_ptr<const Config> ConfigHandler::GetSharedConfig() {
+  return GetConfigHandlerImpl()->GetSharedConfig();
+}
+
+uint64 ConfigHandler::GetConfigGeneration() {
+  return GetConfigHandlerImpl()->GetConfigGeneration();
+}
+
 // Returns Stored Config
 bool ConfigHandler::GetStoredConfig(Config *config) {
   return GetConfigHandlerImpl()->GetStoredConfig(config);
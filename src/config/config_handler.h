@@ -32,6 +32,7 @@
 #ifndef MOZC_CONFIG_CONFIG_HANDLER_H_
 #define MOZC_CONFIG_CONFIG_HANDLER_H_
 
+#include <memory>
 #include <string>
 
 #include "base/port.h"
@@ -50,6 +51,17 @@ class ConfigHandler {
   // Returns current config.
   static bool GetConfig(Config *config);
 
+  // Returns an immutable snapshot of the current config without locking nor
+  // copying it.  The snapshot is never modified; SetConfig(),
+  // SetImposedConfig() and Reload() publish a new one instead.
+  static std::shared_ptr<const Config> GetSharedConfig();
+
+  // Returns the generation of the current config, which is incremented every
+  // time a new snapshot is published.  A snapshot obtained after this call is
+  // at least as new as the returned generation, so callers can skip
+  // reloading while the generation stays the same.
+  static uint64 GetConfigGeneration();
+
   // Returns stored config.
   // If imposed config is not set, the result is the same as GetConfig().
   static bool GetStoredConfig(Config *config);
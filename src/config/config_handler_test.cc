@@ -34,6 +34,7 @@
 #endif  // OS_WIN
 
 #include <atomic>
+#include <memory>
 #include <string>
 
 #include "base/file_util.h"
@@ -224,6 +225,48 @@ TEST_F(ConfigHandlerTest, SetImposedConfig) {
   }
 }
 
+TEST_F(ConfigHandlerTest, SharedConfig) {
+  const string config_file = FileUtil::JoinPath(FLAGS_test_tmpdir,
+                                                "mozc_config_test_tmp");
+  FileUtil::Unlink(config_file);
+  ScopedSetConfigFileName scoped_config_file_name(config_file);
+
+  Config input;
+  ConfigHandler::GetDefaultConfig(&input);
+  input.set_incognito_mode(false);
+  EXPECT_TRUE(ConfigHandler::SetConfig(input));
+
+  const uint64 generation = ConfigHandler::GetConfigGeneration();
+  const std::shared_ptr<const Config> snapshot =
+      ConfigHandler::GetSharedConfig();
+  ASSERT_NE(nullptr, snapshot.get());
+  EXPECT_FALSE(snapshot->incognito_mode());
+  // No new snapshot without updates.
+  EXPECT_EQ(generation, ConfigHandler::GetConfigGeneration());
+  EXPECT_EQ(snapshot.get(), ConfigHandler::GetSharedConfig().get());
+
+  input.set_incognito_mode(true);
+  EXPECT_TRUE(ConfigHandler::SetConfig(input));
+  EXPECT_LT(generation, ConfigHandler::GetConfigGeneration());
+  EXPECT_TRUE(ConfigHandler::GetSharedConfig()->incognito_mode());
+  // The old snapshot is not modified.
+  EXPECT_FALSE(snapshot->incognito_mode());
+
+  const uint64 generation_after_set = ConfigHandler::GetConfigGeneration();
+  Config imposed;
+  imposed.set_incognito_mode(false);
+  ConfigHandler::SetImposedConfig(imposed);
+  EXPECT_LT(generation_after_set, ConfigHandler::GetConfigGeneration());
+  EXPECT_FALSE(ConfigHandler::GetSharedConfig()->incognito_mode());
+
+  const uint64 generation_after_impose = ConfigHandler::GetConfigGeneration();
+  ASSERT_TRUE(ConfigHandler::Reload());
+  EXPECT_LT(generation_after_impose, ConfigHandler::GetConfigGeneration());
+
+  imposed.Clear();
+  ConfigHandler::SetImposedConfig(imposed);
+}
+
 TEST_F(ConfigHandlerTest, ConfigFileNameConfig) {
   const string config_file =
       string("config") + std::to_string(config::CONFIG_VERSION);
@@ -37,6 +37,7 @@
 #include <string>
 #include <vector>
 
+#include "base/hash.h"
 #include "base/logging.h"
 #include "base/port.h"
 #include "base/util.h"
@@ -82,6 +83,10 @@ const int   kStructureCostOffset     = 3453;
 const int   kMinStructureCostOffset  = 1151;
 const int32 kStopEnmerationCacheSize = 15;
 
+// Initial number of the slots of FingerprintSet, enough for
+// kMaxCandidatesSize values.
+const size_t kInitialFingerprintSlots = 512;
+
 // Returns true if the given node sequence is noisy weak compound.
 // Please refer to the comment in FilterCandidateInternal for the idea.
 inline bool IsNoisyWeakCompound(const std::vector<const Node *> &nodes,
@@ -163,6 +168,95 @@ bool IsNormalOrConstrainedNode(const Node *node) {
 
 }  // namespace
 
+struct CandidateFilter::ValueSummary {
+  explicit ValueSummary(const string &value)
+      : fingerprint(Hash::Fingerprint(value)),
+        chars_len(0),
+        has_upper_case(false) {
+    // Counts the characters and looks for the letters which
+    // Util::LowerString() converts in one pass.
+    const char *data = value.data();
+    const size_t size = value.size();
+    for (size_t i = 0; i < size; ++i) {
+      const uint8 c = static_cast<uint8>(data[i]);
+      if ((c & 0xc0) != 0x80) {
+        ++chars_len;
+      }
+      if ('A' <= c && c <= 'Z') {
+        has_upper_case = true;
+      } else if (c == 0xef && i + 2 < size &&
+                 static_cast<uint8>(data[i + 1]) == 0xbc &&
+                 static_cast<uint8>(data[i + 2]) >= 0xa1 &&
+                 static_cast<uint8>(data[i + 2]) <= 0xba) {
+        // "Ａ" (U+FF21) to "Ｚ" (U+FF3A)
+        has_upper_case = true;
+      }
+    }
+  }
+
+  // Hash::Fingerprint() of the value.
+  uint64 fingerprint;
+  // Number of the characters in the value.
+  size_t chars_len;
+  // True if Util::LowerString() changes the value.
+  bool has_upper_case;
+};
+
+CandidateFilter::FingerprintSet::FingerprintSet()
+    : slots_(kInitialFingerprintSlots, 0), size_(0) {}
+
+CandidateFilter::FingerprintSet::~FingerprintSet() {}
+
+// Returns the slot of |key| or the empty slot where it should be.
+size_t CandidateFilter::FingerprintSet::FindSlot(uint64 key) const {
+  const size_t mask = slots_.size() - 1;
+  // The fingerprint is already uniformly distributed.
+  size_t i = static_cast<size_t>(key) & mask;
+  while (slots_[i] != 0 && slots_[i] != key) {
+    i = (i + 1) & mask;
+  }
+  return i;
+}
+
+bool CandidateFilter::FingerprintSet::Insert(uint64 fingerprint) {
+  // 0 is reserved for the empty slots.
+  const uint64 key = (fingerprint == 0) ? 1 : fingerprint;
+  size_t i = FindSlot(key);
+  if (slots_[i] == key) {
+    return false;
+  }
+  // Keeps the load factor at most 1/2.
+  if ((size_ + 1) * 2 > slots_.size()) {
+    Grow();
+    i = FindSlot(key);
+  }
+  slots_[i] = key;
+  ++size_;
+  return true;
+}
+
+bool CandidateFilter::FingerprintSet::Contains(uint64 fingerprint) const {
+  const uint64 key = (fingerprint == 0) ? 1 : fingerprint;
+  return slots_[FindSlot(key)] == key;
+}
+
+void CandidateFilter::FingerprintSet::Clear() {
+  if (size_ > 0) {
+    std::fill(slots_.begin(), slots_.end(), 0);
+    size_ = 0;
+  }
+}
+
+void CandidateFilter::FingerprintSet::Grow() {
+  std::vector<uint64> old_slots(slots_.size() * 2, 0);
+  old_slots.swap(slots_);
+  for (const uint64 key : old_slots) {
+    if (key != 0) {
+      slots_[FindSlot(key)] = key;
+    }
+  }
+}
+
 CandidateFilter::CandidateFilter(
     const SuppressionDictionary *suppression_dictionary,
     const POSMatcher *pos_matcher,
@@ -182,13 +276,14 @@ CandidateFilter::CandidateFilter(
 CandidateFilter::~CandidateFilter() {}
 
 void CandidateFilter::Reset() {
-  seen_.clear();
+  seen_.Clear();
   top_candidate_ = nullptr;
 }
 
 CandidateFilter::ResultType CandidateFilter::FilterCandidateInternal(
     const string &original_key,
     const Segment::Candidate *candidate,
+    const ValueSummary &summary,
     const std::vector<const Node *> &nodes,
     Segments::RequestType request_type) {
   DCHECK(candidate);
@@ -224,7 +319,12 @@ CandidateFilter::ResultType CandidateFilter::FilterCandidateInternal(
       // displayed to users.  Therefore, it's better to filter unfavorable words
       // in this mode.
       CHECK(suggestion_filter_);
-      if (suggestion_filter_->IsBadSuggestion(candidate->value)) {
+      // The fingerprint of the value can be reused unless the filter
+      // lower-cases it.
+      if (summary.has_upper_case
+              ? suggestion_filter_->IsBadSuggestion(candidate->value)
+              : suggestion_filter_->IsBadSuggestionFingerprint(
+                    summary.fingerprint)) {
         return BAD_CANDIDATE;
       }
       // TODO(noriyukit): In the implementation below, the possibility remains
@@ -290,7 +390,7 @@ CandidateFilter::ResultType CandidateFilter::FilterCandidateInternal(
   }
 
   // The candidate is already seen.
-  if (seen_.find(candidate->value) != seen_.end()) {
+  if (seen_.Contains(summary.fingerprint)) {
     return CandidateFilter::BAD_CANDIDATE;
   }
 
@@ -342,7 +442,7 @@ CandidateFilter::ResultType CandidateFilter::FilterCandidateInternal(
   }
 
   // don't drop single character
-  if (Util::CharsLen(candidate->value) == 1) {
+  if (summary.chars_len == 1) {
     VLOG(1) << "don't filter single character";
     return CandidateFilter::GOOD_CANDIDATE;
   }
@@ -501,15 +601,17 @@ CandidateFilter::ResultType CandidateFilter::FilterCandidate(
     // In reverse conversion, only remove duplicates because the filtering
     // criteria of FilterCandidateInternal() are completely designed for
     // (forward) conversion.
-    const bool inserted = seen_.insert(candidate->value).second;
+    const bool inserted =
+        seen_.Insert(Hash::Fingerprint(candidate->value));
     return inserted ? GOOD_CANDIDATE : BAD_CANDIDATE;
   } else {
-    const ResultType result = FilterCandidateInternal(original_key, candidate,
-                                                      nodes, request_type);
+    const ValueSummary summary(candidate->value);
+    const ResultType result = FilterCandidateInternal(
+        original_key, candidate, summary, nodes, request_type);
     if (result != GOOD_CANDIDATE) {
       return result;
     }
-    seen_.insert(candidate->value);
+    seen_.Insert(summary.fingerprint);
     return result;
   }
 }
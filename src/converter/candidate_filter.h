@@ -30,7 +30,6 @@
 #ifndef MOZC_CONVERTER_CANDIDATE_FILTER_H_
 #define MOZC_CONVERTER_CANDIDATE_FILTER_H_
 
-#include <set>
 #include <string>
 #include <vector>
 
@@ -71,8 +70,36 @@ class CandidateFilter {
   void Reset();
 
  private:
+  // Properties of a candidate value computed once and shared by the checks.
+  struct ValueSummary;
+
+  // Open-addressed set of the fingerprints of the values.  Clear() keeps the
+  // table, so it is not reallocated for each request.
+  class FingerprintSet {
+   public:
+    FingerprintSet();
+    ~FingerprintSet();
+
+    // Returns false if |fingerprint| is already in the set.
+    bool Insert(uint64 fingerprint);
+    bool Contains(uint64 fingerprint) const;
+    void Clear();
+    size_t size() const { return size_; }
+
+   private:
+    size_t FindSlot(uint64 key) const;
+    void Grow();
+
+    // 0 means an empty slot.  The size is a power of two.
+    std::vector<uint64> slots_;
+    size_t size_;
+
+    DISALLOW_COPY_AND_ASSIGN(FingerprintSet);
+  };
+
   ResultType FilterCandidateInternal(const string &original_key,
                                      const Segment::Candidate *candidate,
+                                     const ValueSummary &summary,
                                      const std::vector<const Node *> &nodes,
                                      Segments::RequestType request_type);
 
@@ -80,7 +107,8 @@ class CandidateFilter {
   const dictionary::POSMatcher *pos_matcher_;
   const SuggestionFilter *suggestion_filter_;
 
-  std::set<string> seen_;
+  // Fingerprints of the values of the accepted candidates.
+  FingerprintSet seen_;
   const Segment::Candidate *top_candidate_;
   bool apply_suggestion_filter_for_exact_match_;
 
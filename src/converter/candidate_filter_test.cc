@@ -956,6 +956,38 @@ TEST_F(CandidateFilterTest, ReverseConversion) {
   }
 }
 
+TEST_F(CandidateFilterTest, ManyCandidatesInReverseConversion) {
+  std::unique_ptr<CandidateFilter> filter(CreateCandidateFilter(true));
+  std::vector<const Node *> nodes;
+  GetDefaultNodes(&nodes);
+
+  // Reverse conversion doesn't limit the number of the candidates, so the
+  // set of the seen values grows.
+  const int kNumValues = 1000;
+  for (int round = 0; round < 2; ++round) {
+    for (int i = 0; i < kNumValues; ++i) {
+      Segment::Candidate *c = NewCandidate();
+      c->key = "ほん";
+      c->value = "value" + std::to_string(i);
+      c->content_key = c->key;
+      c->content_value = c->value;
+      EXPECT_EQ(round == 0 ? CandidateFilter::GOOD_CANDIDATE
+                           : CandidateFilter::BAD_CANDIDATE,
+                filter->FilterCandidate(c->key, c, nodes,
+                                        Segments::REVERSE_CONVERSION));
+    }
+  }
+
+  // Reset() forgets the values.
+  filter->Reset();
+  Segment::Candidate *c = NewCandidate();
+  c->key = "ほん";
+  c->value = "value0";
+  EXPECT_EQ(CandidateFilter::GOOD_CANDIDATE,
+            filter->FilterCandidate(c->key, c, nodes,
+                                    Segments::REVERSE_CONVERSION));
+}
+
 }  // namespace
 }  // namespace converter
 }  // namespace mozc
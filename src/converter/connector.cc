@@ -31,19 +31,27 @@
 
 #include <algorithm>
 
+#include "base/flags.h"
 #include "base/logging.h"
 #include "base/port.h"
 #include "base/stl_util.h"
 #include "data_manager/data_manager_interface.h"
 #include "storage/louds/simple_succinct_bit_vector_index.h"
+#include "storage/lru_cache.h"
 
+using mozc::storage::LRUCache;
 using mozc::storage::louds::SimpleSuccinctBitVectorIndex;
 
+DEFINE_bool(use_lean_connector, false,
+            "Decode the connection rows on demand and keep only a few of them "
+            "in memory.  Intended for low-memory devices.");
+
 namespace mozc {
 namespace {
 
-const uint32 kInvalidCacheKey = 0xFFFFFFFF;
+const uint64 kInvalidCacheEntry = 0xFFFFFFFFFFFFFFFFULL;
 const uint16 kConnectorMagicNumber = 0xCDAB;
+const uint16 kDenseConnectorMagicNumber = 0xCDAC;
 const uint8 kInvalid1ByteCostValue = 255;
 
 inline uint32 GetHashValue(uint16 rid, uint16 lid, uint32 hash_mask) {
@@ -59,6 +67,28 @@ inline uint32 EncodeKey(uint16 rid, uint16 lid) {
   return (static_cast<uint32>(rid) << 16) | lid;
 }
 
+inline uint64 EncodeCacheEntry(uint32 key, int value) {
+  return (static_cast<uint64>(key) << 32) | static_cast<uint32>(value);
+}
+
+// Returns the size of the chunk bits of a row in bytes.  Each chunk bit is
+// bitwise-or of consecutive 8-bits, and the chunk is aligned to 32-bits
+// boundary.
+inline size_t GetChunkBitsSize(uint16 lsize) {
+  const size_t num_chunk_bits = (lsize + 7) / 8;
+  return (num_chunk_bits + 31) / 32 * 4;
+}
+
+// Returns the size of the row starting at |row_data| in bytes.
+size_t GetRowSize(const char *row_data, size_t chunk_bits_size) {
+  const uint16 *size_data = reinterpret_cast<const uint16 *>(row_data);
+  const uint16 compact_bits_size = size_data[0];
+  CHECK_EQ(compact_bits_size % 4, 0) << compact_bits_size;
+  const uint16 values_size = size_data[1];
+  CHECK_EQ(values_size % 4, 0) << values_size;
+  return 4 + chunk_bits_size + compact_bits_size + values_size;
+}
+
 }  // namespace
 
 class Connector::Row {
@@ -66,6 +96,11 @@ class Connector::Row {
   Row() : chunk_bits_index_(sizeof(uint32)),
           compact_bits_index_(sizeof(uint32)) {}
 
+  size_t GetHeapMemoryUsage() const {
+    return sizeof(*this) + chunk_bits_index_.GetHeapMemoryUsage() +
+           compact_bits_index_.GetHeapMemoryUsage();
+  }
+
   void Init(const uint8 *chunk_bits, size_t chunk_bits_size,
             const uint8 *compact_bits, size_t compact_bits_size,
             const uint8 *values, bool use_1byte_value) {
@@ -119,17 +154,62 @@ Connector *Connector::CreateFromDataManager(
   const char *connection_data = nullptr;
   size_t connection_data_size = 0;
   data_manager.GetConnectorData(&connection_data, &connection_data_size);
-  return new Connector(connection_data, connection_data_size, kCacheSize);
+  if (FLAGS_use_lean_connector) {
+    // A decoded row serves every lid of its rid, and a conversion touches
+    // the rids of its lattice nodes only, so a few hundred rows suffice.
+    const int kRowCacheSize = 256;
+    return new Connector(connection_data, connection_data_size, kCacheSize,
+                         kRowCacheSize);
+  }
+  const char *dense_data = nullptr;
+  size_t dense_data_size = 0;
+#ifndef OS_ANDROID
+  // The dense matrix takes several MB, so use it only on desktop.
+  data_manager.GetDenseConnectorData(&dense_data, &dense_data_size);
+#endif  // OS_ANDROID
+  return new Connector(connection_data, connection_data_size,
+                       dense_data, dense_data_size, kCacheSize);
 }
 
 Connector::Connector(const char *connection_data,
                      size_t connection_size,
                      int cache_size)
+    : Connector(connection_data, connection_size, nullptr, 0, cache_size) {}
+
+Connector::Connector(const char *connection_data,
+                     size_t connection_size,
+                     const char *dense_data,
+                     size_t dense_size,
+                     int cache_size)
     : default_cost_(nullptr),
+      connection_data_(connection_data),
+      dense_cost_(nullptr),
+      dense_lsize_(0),
       cache_size_(cache_size),
-      cache_hash_mask_(cache_size - 1),
-      cache_key_(new uint32[cache_size]),
-      cache_value_(new int[cache_size]) {
+      cache_hash_mask_(cache_size - 1) {
+  Init(connection_data, dense_data, dense_size, 0);
+}
+
+Connector::Connector(const char *connection_data,
+                     size_t connection_size,
+                     int cache_size,
+                     int row_cache_size)
+    : default_cost_(nullptr),
+      connection_data_(connection_data),
+      dense_cost_(nullptr),
+      dense_lsize_(0),
+      cache_size_(cache_size),
+      cache_hash_mask_(cache_size - 1) {
+  DCHECK_GT(row_cache_size, 0);
+  Init(connection_data, nullptr, 0, row_cache_size);
+}
+
+Connector::~Connector() {
+  STLDeleteElements(&rows_);
+}
+
+void Connector::Init(const char *connection_data, const char *dense_data,
+                     size_t dense_size, int row_cache_size) {
   const uint16 *ptr = reinterpret_cast<const uint16 *>(connection_data);
   CHECK_EQ(kConnectorMagicNumber, ptr[0]);
   resolution_ = ptr[1];
@@ -138,60 +218,99 @@ Connector::Connector(const char *connection_data,
   CHECK_EQ(rsize, lsize) << "The connector matrix should be square.";
   default_cost_ = ptr + 4;
 
-  // Calculate the row's beginning position. Note that it should be aligned to
-  // 32-bits boundary.
-  size_t offset = 8 + (rsize + (rsize & 1)) * 2;
+  if (dense_data != nullptr &&
+      InitDenseMatrix(dense_data, dense_size, rsize)) {
+    // Neither the compressed rows nor the cache is needed, so the connector
+    // only refers to the (shared) mapped data.
+    return;
+  }
 
-  // The number of valid bits in a chunk. Each bit is bitwise-or of consecutive
-  // 8-bits.
-  const size_t num_chunk_bits = (lsize + 7) / 8;
+  // Check if the cache_size is the power of 2 and clear cache.
+  DCHECK_EQ(0, cache_size_ & (cache_size_ - 1));
+  cache_.reset(new std::atomic<uint64>[cache_size_]);
+  ClearCache();
 
-  // Then calculate the actual size of chunk in bytes, which is aligned to
+  // Calculate the row's beginning position. Note that it should be aligned to
   // 32-bits boundary.
-  const size_t chunk_bits_size = (num_chunk_bits + 31) / 32 * 4;
-
-  const bool use_1byte_value = resolution_ != 1;
+  size_t offset = 8 + (rsize + (rsize & 1)) * 2;
+  const size_t chunk_bits_size = GetChunkBitsSize(lsize);
+
+  if (row_cache_size > 0) {
+    // Only the row positions are recorded here; InitRow() decodes a row when
+    // it is looked up for the first time (or again after eviction).
+    row_offsets_.reserve(rsize);
+    for (size_t i = 0; i < rsize; ++i) {
+      row_offsets_.push_back(offset);
+      offset += GetRowSize(connection_data + offset, chunk_bits_size);
+    }
+    row_cache_.reset(new LRUCache<uint16, Row>(row_cache_size));
+    return;
+  }
 
   rows_.reserve(rsize);
   for (size_t i = 0; i < rsize; ++i) {
-    const uint16 *size_data =
-        reinterpret_cast<const uint16 *>(connection_data + offset);
+    row_offsets_.push_back(offset);
     Row *row = new Row;
-    const uint16 compact_bits_size = size_data[0];
-    CHECK_EQ(compact_bits_size % 4, 0) << compact_bits_size;
-    const uint16 values_size = size_data[1];
-    CHECK_EQ(values_size % 4, 0) << values_size;
-
-    const uint8 *chunk_bits =
-        reinterpret_cast<const uint8 *>(connection_data + offset + 4);
-    const uint8 *compact_bits = chunk_bits + chunk_bits_size;
-    const uint8 *values = compact_bits + compact_bits_size;
-    row->Init(chunk_bits, chunk_bits_size, compact_bits, compact_bits_size,
-              values, use_1byte_value);
+    InitRow(i, row);
     rows_.push_back(row);
-
-    offset += 4 + chunk_bits_size + compact_bits_size + values_size;
+    offset += GetRowSize(connection_data + offset, chunk_bits_size);
   }
-
-  // Check if the cache_size is the power of 2 and clear cache.
-  DCHECK_EQ(0, cache_size & (cache_size - 1));
-  ClearCache();
+  // |row_offsets_| is needed only to initialize the rows.
+  std::vector<uint32>().swap(row_offsets_);
 }
 
-Connector::~Connector() {
-  STLDeleteElements(&rows_);
+void Connector::InitRow(uint16 rid, Row *row) const {
+  const uint16 *header = reinterpret_cast<const uint16 *>(connection_data_);
+  const size_t chunk_bits_size = GetChunkBitsSize(header[3]);
+  const char *row_data = connection_data_ + row_offsets_[rid];
+  const uint16 *size_data = reinterpret_cast<const uint16 *>(row_data);
+  const uint16 compact_bits_size = size_data[0];
+  const uint8 *chunk_bits = reinterpret_cast<const uint8 *>(row_data + 4);
+  const uint8 *compact_bits = chunk_bits + chunk_bits_size;
+  const uint8 *values = compact_bits + compact_bits_size;
+  row->Init(chunk_bits, chunk_bits_size, compact_bits, compact_bits_size,
+            values, resolution_ != 1);
 }
 
+bool Connector::InitDenseMatrix(const char *dense_data, size_t dense_size,
+                                uint16 rsize) {
+  const size_t kHeaderSize = 8;
+  if (dense_size < kHeaderSize) {
+    LOG(ERROR) << "Dense connection data is too short: " << dense_size;
+    return false;
+  }
+  const uint16 *ptr = reinterpret_cast<const uint16 *>(dense_data);
+  if (ptr[0] != kDenseConnectorMagicNumber || ptr[1] != 1 ||
+      ptr[2] != rsize || ptr[3] != rsize ||
+      dense_size != kHeaderSize + sizeof(uint16) * rsize * rsize) {
+    LOG(ERROR) << "Dense connection data is broken";
+    return false;
+  }
+  if (resolution_ != 1) {
+    LOG(ERROR) << "Dense connection data requires the resolution 1: "
+               << resolution_;
+    return false;
+  }
+  dense_cost_ = ptr + 4;
+  dense_lsize_ = rsize;
+  return true;
+}
 
 int Connector::GetTransitionCost(uint16 rid, uint16 lid) const {
+  if (dense_cost_ != nullptr) {
+    return dense_cost_[rid * dense_lsize_ + lid];
+  }
   const uint32 index = EncodeKey(rid, lid);
   const uint32 bucket = GetHashValue(rid, lid, cache_hash_mask_);
-  if (cache_key_[bucket] == index) {
-    return cache_value_[bucket];
+  // Relaxed ordering is enough because an entry is self-contained; a racing
+  // writer can only replace it with another valid entry.
+  const uint64 entry = cache_[bucket].load(std::memory_order_relaxed);
+  if (static_cast<uint32>(entry >> 32) == index) {
+    return static_cast<int>(static_cast<uint32>(entry));
   }
   const int value = LookupCost(rid, lid);
-  cache_key_[bucket] = index;
-  cache_value_[bucket] = value;
+  cache_[bucket].store(EncodeCacheEntry(index, value),
+                       std::memory_order_relaxed);
   return value;
 }
 
@@ -199,13 +318,52 @@ int Connector::GetResolution() const {
   return resolution_;
 }
 
+size_t Connector::GetHeapMemoryUsage() const {
+  size_t size = rows_.capacity() * sizeof(Row *);
+  for (const Row *row : rows_) {
+    size += row->GetHeapMemoryUsage();
+  }
+  if (row_cache_) {
+    size += row_offsets_.capacity() * sizeof(uint32);
+    scoped_lock lock(&row_cache_mutex_);
+    size += row_cache_->GetHeapMemoryUsage();
+    for (const LRUCache<uint16, Row>::Element *elem = row_cache_->Head();
+         elem != nullptr; elem = elem->next) {
+      size += elem->value.GetHeapMemoryUsage() - sizeof(Row);
+    }
+  }
+  if (cache_) {
+    size += cache_size_ * sizeof(std::atomic<uint64>);
+  }
+  return size;
+}
+
 void Connector::ClearCache() {
-  std::fill(cache_key_.get(), cache_key_.get() + cache_size_, kInvalidCacheKey);
+  if (!cache_) {
+    return;
+  }
+  for (int i = 0; i < cache_size_; ++i) {
+    cache_[i].store(kInvalidCacheEntry, std::memory_order_relaxed);
+  }
 }
 
 int Connector::LookupCost(uint16 rid, uint16 lid) const {
   uint16 value;
-  if (!rows_[rid]->GetValue(lid, &value)) {
+  bool found = false;
+  if (row_cache_) {
+    scoped_lock lock(&row_cache_mutex_);
+    const Row *row = row_cache_->Lookup(rid);
+    if (row == nullptr) {
+      // Reuses the least recently used row if the cache is full.
+      LRUCache<uint16, Row>::Element *elem = row_cache_->Insert(rid);
+      InitRow(rid, &elem->value);
+      row = &elem->value;
+    }
+    found = row->GetValue(lid, &value);
+  } else {
+    found = rows_[rid]->GetValue(lid, &value);
+  }
+  if (!found) {
     return default_cost_[rid];
   }
   return value * resolution_;
@@ -30,15 +30,22 @@
 #ifndef MOZC_CONVERTER_CONNECTOR_H_
 #define MOZC_CONVERTER_CONNECTOR_H_
 
+#include <atomic>
 #include <memory>
 #include <vector>
 
+#include "base/mutex.h"
 #include "base/port.h"
 
 namespace mozc {
+namespace storage {
+template <typename Key, typename Value> class LRUCache;
+}  // namespace storage
 
 class DataManagerInterface;
 
+// Connector is thread-safe; one instance can be shared by converters running
+// on multiple threads.  The cost cache is updated without locks.
 class Connector {
  public:
   static const int16 kInvalidCost = 30000;
@@ -48,6 +55,20 @@ class Connector {
 
   Connector(const char *connection_data, size_t connection_size,
             int cache_size);
+
+  // Uses the uncompressed matrix |dense_data| (generated by
+  // gen_connection_data.py with --dense_binary_output_file) for lookups.
+  // Every lookup becomes a single load, so the cost cache is bypassed.  Falls
+  // back to |connection_data| if |dense_data| is nullptr or broken.
+  Connector(const char *connection_data, size_t connection_size,
+            const char *dense_data, size_t dense_size, int cache_size);
+
+  // Memory-lean mode for low-memory devices.  Instead of building the rank
+  // index of every row up front, rows are decoded from |connection_data| on
+  // demand and at most |row_cache_size| decoded rows are kept in LRU order.
+  // Lookups still go through the cost cache first.
+  Connector(const char *connection_data, size_t connection_size,
+            int cache_size, int row_cache_size);
   ~Connector();
 
   int GetTransitionCost(uint16 rid, uint16 lid) const;
@@ -55,19 +76,43 @@ class Connector {
 
   void ClearCache();
 
+  // Returns the estimated size of the memory allocated in heap, in bytes.
+  // The connection data mapped from the data set is not included.
+  size_t GetHeapMemoryUsage() const;
+
  private:
   class Row;
 
+  void Init(const char *connection_data, const char *dense_data,
+            size_t dense_size, int row_cache_size);
   int LookupCost(uint16 rid, uint16 lid) const;
+  void InitRow(uint16 rid, Row *row) const;
+  bool InitDenseMatrix(const char *dense_data, size_t dense_size,
+                       uint16 rsize);
 
   std::vector<Row *> rows_;
+
+  // Used in the memory-lean mode instead of |rows_|.  |row_offsets_[rid]| is
+  // the position of the row in |connection_data_|.
+  const char *connection_data_;
+  std::vector<uint32> row_offsets_;
+  mutable std::unique_ptr<storage::LRUCache<uint16, Row>> row_cache_;
+  mutable Mutex row_cache_mutex_;
+
   const uint16 *default_cost_;
   int resolution_;
 
+  // Uncompressed (rid, lid) matrix of |dense_lsize_| columns, or nullptr.
+  const uint16 *dense_cost_;
+  size_t dense_lsize_;
+
+  // Each cache entry packs the key (rid << 16 | lid) into the upper 32 bits
+  // and the cost into the lower 32 bits, so that an entry is read and
+  // written by a single relaxed atomic operation.  Not allocated when the
+  // dense matrix is used.
   const int cache_size_;
   const uint32 cache_hash_mask_;
-  mutable std::unique_ptr<uint32[]> cache_key_;
-  mutable std::unique_ptr<int[]> cache_value_;
+  mutable std::unique_ptr<std::atomic<uint64>[]> cache_;
 
   DISALLOW_COPY_AND_ASSIGN(Connector);
 };
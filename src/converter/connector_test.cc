@@ -36,6 +36,7 @@
 #include <vector>
 
 #include "base/mmap.h"
+#include "base/thread.h"
 #include "data_manager/connection_file_reader.h"
 #include "testing/base/public/gunit.h"
 #include "testing/base/public/mozctest.h"
@@ -51,15 +52,7 @@ struct ConnectionDataEntry {
 
 #ifndef OS_NACL
 // Disabled on NaCl since it uses a mock file system.
-TEST(ConnectorTest, CompareWithRawData) {
-  const string path = testing::GetSourceFileOrDie({
-      "data_manager", "testing", "connection.data"});
-  Mmap cmmap;
-  ASSERT_TRUE(cmmap.Open(path.c_str())) << "Failed to open image: " << path;
-  std::unique_ptr<Connector> connector(
-      new Connector(cmmap.begin(), cmmap.size(), 256));
-  ASSERT_EQ(1, connector->GetResolution());
-
+std::vector<ConnectionDataEntry> ReadRawData() {
   const string connection_text_path = testing::GetSourceFileOrDie({
       "data_manager", "testing", "connection_single_column.txt"});
   std::vector<ConnectionDataEntry> data;
@@ -71,21 +64,153 @@ TEST(ConnectorTest, CompareWithRawData) {
     entry.cost = reader.cost();
     data.push_back(entry);
   }
+  return data;
+}
 
+void ExpectSameAsRawData(const Connector &connector,
+                         std::vector<ConnectionDataEntry> *data) {
   for (int trial = 0; trial < 3; ++trial) {
     // Lookup in random order for a few times.
     std::random_device rd;
     std::mt19937 urbg(rd());
-    std::shuffle(data.begin(), data.end(), urbg);
-    for (size_t i = 0; i < data.size(); ++i) {
-      int actual = connector->GetTransitionCost(data[i].rid, data[i].lid);
-      EXPECT_EQ(data[i].cost, actual);
+    std::shuffle(data->begin(), data->end(), urbg);
+    for (size_t i = 0; i < data->size(); ++i) {
+      const ConnectionDataEntry &entry = (*data)[i];
+      int actual = connector.GetTransitionCost(entry.rid, entry.lid);
+      EXPECT_EQ(entry.cost, actual);
 
       // Cache hit case.
-      actual = connector->GetTransitionCost(data[i].rid, data[i].lid);
-      EXPECT_EQ(data[i].cost, actual);
+      actual = connector.GetTransitionCost(entry.rid, entry.lid);
+      EXPECT_EQ(entry.cost, actual);
+    }
+  }
+}
+
+TEST(ConnectorTest, CompareWithRawData) {
+  const string path = testing::GetSourceFileOrDie({
+      "data_manager", "testing", "connection.data"});
+  Mmap cmmap;
+  ASSERT_TRUE(cmmap.Open(path.c_str())) << "Failed to open image: " << path;
+  std::unique_ptr<Connector> connector(
+      new Connector(cmmap.begin(), cmmap.size(), 256));
+  ASSERT_EQ(1, connector->GetResolution());
+
+  std::vector<ConnectionDataEntry> data = ReadRawData();
+  ExpectSameAsRawData(*connector, &data);
+}
+
+TEST(ConnectorTest, CompareDenseMatrixWithRawData) {
+  const string path = testing::GetSourceFileOrDie({
+      "data_manager", "testing", "connection.data"});
+  Mmap cmmap;
+  ASSERT_TRUE(cmmap.Open(path.c_str())) << "Failed to open image: " << path;
+  const string dense_path = testing::GetSourceFileOrDie({
+      "data_manager", "testing", "connection_dense.data"});
+  Mmap dmmap;
+  ASSERT_TRUE(dmmap.Open(dense_path.c_str()))
+      << "Failed to open image: " << dense_path;
+  std::unique_ptr<Connector> connector(
+      new Connector(cmmap.begin(), cmmap.size(),
+                    dmmap.begin(), dmmap.size(), 256));
+  ASSERT_EQ(1, connector->GetResolution());
+
+  std::vector<ConnectionDataEntry> data = ReadRawData();
+  ExpectSameAsRawData(*connector, &data);
+}
+
+TEST(ConnectorTest, CompareLeanModeWithRawData) {
+  const string path = testing::GetSourceFileOrDie({
+      "data_manager", "testing", "connection.data"});
+  Mmap cmmap;
+  ASSERT_TRUE(cmmap.Open(path.c_str())) << "Failed to open image: " << path;
+  // Keep only a few rows so that the rows are evicted and decoded again.
+  std::unique_ptr<Connector> connector(
+      new Connector(cmmap.begin(), cmmap.size(), 256, 4));
+  ASSERT_EQ(1, connector->GetResolution());
+
+  std::vector<ConnectionDataEntry> data = ReadRawData();
+  ExpectSameAsRawData(*connector, &data);
+
+  const Connector eager_connector(cmmap.begin(), cmmap.size(), 256);
+  EXPECT_LT(connector->GetHeapMemoryUsage(),
+            eager_connector.GetHeapMemoryUsage());
+}
+
+class LookupThread : public Thread {
+ public:
+  LookupThread(const Connector *connector,
+               const std::vector<ConnectionDataEntry> *data)
+      : connector_(connector), data_(data), num_errors_(0) {}
+
+  void Run() override {
+    for (int trial = 0; trial < 3; ++trial) {
+      for (size_t i = 0; i < data_->size(); ++i) {
+        const ConnectionDataEntry &entry = (*data_)[i];
+        if (connector_->GetTransitionCost(entry.rid, entry.lid) !=
+            entry.cost) {
+          ++num_errors_;
+        }
+      }
     }
   }
+
+  int num_errors() const { return num_errors_; }
+
+ private:
+  const Connector *connector_;
+  const std::vector<ConnectionDataEntry> *data_;
+  int num_errors_;
+
+  DISALLOW_COPY_AND_ASSIGN(LookupThread);
+};
+
+TEST(ConnectorTest, ConcurrentLookup) {
+  const string path = testing::GetSourceFileOrDie({
+      "data_manager", "testing", "connection.data"});
+  Mmap cmmap;
+  ASSERT_TRUE(cmmap.Open(path.c_str())) << "Failed to open image: " << path;
+  // Use a small cache so that the threads fight over the same entries.
+  const Connector connector(cmmap.begin(), cmmap.size(), 256);
+  const Connector lean_connector(cmmap.begin(), cmmap.size(), 256, 8);
+
+  std::vector<ConnectionDataEntry> data = ReadRawData();
+  data.resize(std::min<size_t>(data.size(), 100000));
+  const int kNumThreads = 4;
+  // Each thread looks up in a different order.  The even threads share the
+  // regular connector and the odd ones share the lean one.
+  std::vector<std::vector<ConnectionDataEntry>> orders(kNumThreads, data);
+  std::vector<std::unique_ptr<LookupThread>> threads;
+  for (int i = 0; i < kNumThreads; ++i) {
+    std::mt19937 urbg(i);
+    std::shuffle(orders[i].begin(), orders[i].end(), urbg);
+    threads.emplace_back(new LookupThread(
+        i % 2 == 0 ? &connector : &lean_connector, &orders[i]));
+  }
+  for (size_t i = 0; i < threads.size(); ++i) {
+    threads[i]->SetJoinable(true);
+    threads[i]->Start("ConcurrentLookup");
+  }
+  for (size_t i = 0; i < threads.size(); ++i) {
+    threads[i]->Join();
+    EXPECT_EQ(0, threads[i]->num_errors());
+  }
+}
+
+TEST(ConnectorTest, BrokenDenseMatrixFallsBackToCompressedData) {
+  const string path = testing::GetSourceFileOrDie({
+      "data_manager", "testing", "connection.data"});
+  Mmap cmmap;
+  ASSERT_TRUE(cmmap.Open(path.c_str())) << "Failed to open image: " << path;
+  // Only the header; the matrix body is missing.
+  const uint16 kBrokenDenseData[] = {0xCDAC, 1, 0, 0};
+  std::unique_ptr<Connector> connector(
+      new Connector(cmmap.begin(), cmmap.size(),
+                    reinterpret_cast<const char *>(kBrokenDenseData),
+                    sizeof(kBrokenDenseData), 256));
+
+  std::vector<ConnectionDataEntry> data = ReadRawData();
+  data.resize(std::min<size_t>(data.size(), 10000));
+  ExpectSameAsRawData(*connector, &data);
 }
 #endif  // !OS_NACL
 
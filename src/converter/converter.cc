@@ -30,13 +30,18 @@
 #include "converter/converter.h"
 
 #include <algorithm>
+#include <atomic>
 #include <climits>
+#include <map>
 #include <string>
 #include <vector>
 
+#include "base/flags.h"
 #include "base/logging.h"
+#include "base/mutex.h"
 #include "base/number_util.h"
 #include "base/port.h"
+#include "base/thread_pool.h"
 #include "base/util.h"
 #include "composer/composer.h"
 #include "converter/immutable_converter_interface.h"
@@ -45,16 +50,135 @@
 #include "dictionary/pos_matcher.h"
 #include "dictionary/suppression_dictionary.h"
 #include "prediction/predictor_interface.h"
+#include "protocol/commands.pb.h"
+#include "protocol/config.pb.h"
 #include "request/conversion_request.h"
 #include "rewriter/rewriter_interface.h"
 #include "transliteration/transliteration.h"
 #include "usage_stats/usage_stats.h"
 
+DEFINE_bool(async_learning, false,
+            "If true, FinishConversion() returns without learning the "
+            "committed segments, and the rewriters and the predictors learn "
+            "them on a background thread.  The next call using them waits "
+            "for the learning.");
+
 using mozc::dictionary::POSMatcher;
 using mozc::dictionary::SuppressionDictionary;
 using mozc::usage_stats::UsageStats;
 
 namespace mozc {
+
+// Runs RewriterInterface::Finish() and PredictorInterface::Finish() for the
+// committed segments in order on a single background thread.  Each record
+// owns copies of the segments and of everything the request refers to, as
+// the caller may change them as soon as FinishConversion() returns.
+class ConverterImpl::AsyncLearner {
+ public:
+  AsyncLearner(RewriterInterface *rewriter, PredictorInterface *predictor)
+      : rewriter_(rewriter), predictor_(predictor), pool_(1),
+        num_pending_(0) {}
+
+  // Runs the remaining learning.
+  ~AsyncLearner() {
+    Wait();
+  }
+
+  void Push(const ConversionRequest &request, const Segments &segments,
+            const Segments *target) {
+    Record *record = new Record;
+    record->target = target;
+    record->request.CopyFrom(request.request());
+    record->config.CopyFrom(request.config());
+    record->conversion_request.CopyFrom(request);
+    record->conversion_request.set_request(&record->request);
+    record->conversion_request.set_config(&record->config);
+    record->conversion_request.set_workspace(NULL);
+    record->conversion_request.set_lattice(NULL);
+    record->conversion_request.set_cancel_flag(NULL);
+    record->conversion_request.SetTimeout(0);
+    if (request.has_composer()) {
+      record->composer.reset(new composer::Composer(
+          NULL, &record->request, &record->config));
+      record->composer->CopyFrom(request.composer());
+      record->composer->SetRequest(&record->request);
+      record->composer->SetConfig(&record->config);
+      record->conversion_request.set_composer(record->composer.get());
+    } else {
+      record->conversion_request.set_composer(NULL);
+    }
+    record->segments.CopyFrom(segments);
+
+    ++num_pending_;
+    pool_.Schedule([this, record]() { Learn(record); });
+  }
+
+  // Blocks until all the pushed records are learned.
+  void Wait() {
+    if (num_pending_ == 0) {
+      return;
+    }
+    BlockingCounter counter(1);
+    pool_.Schedule([&counter]() { counter.DecrementCount(); });
+    counter.Wait();
+  }
+
+  // Moves the revert entries of the last learning of |target| into it.
+  void TakeRevertEntries(Segments *target) {
+    scoped_lock l(&mutex_);
+    auto it = revert_entries_.find(target);
+    if (it == revert_entries_.end()) {
+      return;
+    }
+    for (size_t i = 0; i < it->second.revert_entries_size(); ++i) {
+      target->push_back_revert_entry()->CopyFrom(it->second.revert_entry(i));
+    }
+    revert_entries_.erase(it);
+  }
+
+ private:
+  struct Record {
+    // The segments of the caller, only used as the key of the revert
+    // entries.
+    const Segments *target;
+    commands::Request request;
+    config::Config config;
+    std::unique_ptr<composer::Composer> composer;
+    ConversionRequest conversion_request;
+    Segments segments;
+  };
+
+  void Learn(Record *record_ptr) {
+    std::unique_ptr<Record> record(record_ptr);
+    rewriter_->Finish(record->conversion_request, &record->segments);
+    predictor_->Finish(record->conversion_request, &record->segments);
+    {
+      scoped_lock l(&mutex_);
+      // Replaces the entries of an older learning, which are cleared by
+      // FinishConversion() when it's learned synchronously.
+      revert_entries_.erase(record->target);
+      if (record->segments.revert_entries_size() > 0) {
+        Segments *entries = &revert_entries_[record->target];
+        for (size_t i = 0; i < record->segments.revert_entries_size(); ++i) {
+          entries->push_back_revert_entry()->CopyFrom(
+              record->segments.revert_entry(i));
+        }
+      }
+    }
+    --num_pending_;
+  }
+
+  RewriterInterface *rewriter_;
+  PredictorInterface *predictor_;
+  ThreadPool pool_;
+  std::atomic<int> num_pending_;
+  Mutex mutex_;
+  // Only the revert entries are used.
+  std::map<const Segments *, Segments> revert_entries_;
+
+  DISALLOW_COPY_AND_ASSIGN(AsyncLearner);
+};
+
 namespace {
 
 const size_t kErrorIndex = static_cast<size_t>(-1);
@@ -227,6 +351,24 @@ void ConverterImpl::Init(const POSMatcher *pos_matcher,
   rewriter_.reset(rewriter);
   immutable_converter_ = immutable_converter;
   general_noun_id_ = pos_matcher_->GetGeneralNounId();
+  if (FLAGS_async_learning) {
+    learner_.reset(new AsyncLearner(rewriter_.get(), predictor_.get()));
+  } else {
+    learner_.reset();
+  }
+}
+
+void ConverterImpl::WaitForLearning() const {
+  if (learner_) {
+    learner_->Wait();
+  }
+}
+
+void ConverterImpl::WaitForLearning(Segments *segments) const {
+  if (learner_) {
+    learner_->Wait();
+    learner_->TakeRevertEntries(segments);
+  }
 }
 
 bool ConverterImpl::StartConversionForRequest(const ConversionRequest &request,
@@ -376,6 +518,7 @@ bool ConverterImpl::Predict(const ConversionRequest &request,
   DCHECK_EQ(key, segments->conversion_segment(0).key());
 
   segments->set_request_type(request_type);
+  WaitForLearning(segments);
   predictor_->PredictForRequest(request, segments);
   RewriteAndSuppressCandidates(request, segments);
   TrimCandidates(request, segments);
@@ -494,8 +637,15 @@ bool ConverterImpl::FinishConversion(const ConversionRequest &request,
   }
 
   segments->clear_revert_entries();
-  rewriter_->Finish(request, segments);
-  predictor_->Finish(request, segments);
+  if (learner_) {
+    // Revert entries of a learning not taken yet are obsolete as well.
+    learner_->TakeRevertEntries(segments);
+    segments->clear_revert_entries();
+    learner_->Push(request, *segments, segments);
+  } else {
+    rewriter_->Finish(request, segments);
+    predictor_->Finish(request, segments);
+  }
 
   // Remove the front segments except for some segments which will be
   // used as history segments.
@@ -527,6 +677,7 @@ bool ConverterImpl::ResetConversion(Segments *segments) const {
 }
 
 bool ConverterImpl::RevertConversion(Segments *segments) const {
+  WaitForLearning(segments);
   if (segments->revert_entries_size() == 0) {
     return true;
   }
@@ -631,6 +782,7 @@ bool ConverterImpl::FocusSegmentValue(Segments *segments,
     return false;
   }
 
+  WaitForLearning(segments);
   return rewriter_->Focus(segments, segment_index, candidate_index);
 }
 
@@ -789,6 +941,50 @@ bool ConverterImpl::ResizeSegment(Segments *segments,
     return false;
   }
 
+  if (!ResegmentKeys(segments, start_segment_index, segments_size,
+                     new_size_array, array_size)) {
+    return false;
+  }
+
+  immutable_converter_->ConvertForRequest(request, segments);
+  RewriteAndSuppressCandidates(request, segments);
+  TrimCandidates(request, segments);
+  return true;
+}
+
+bool ConverterImpl::ResizeSegments(
+    Segments *segments, const ConversionRequest &request,
+    const std::vector<ResizeSegmentRequest> &requests) const {
+  if (segments->request_type() != Segments::CONVERSION) {
+    return false;
+  }
+
+  // Only the keys of the segments are needed to resize the following ones,
+  // so the segments are converted once after all the resizes.
+  bool resized = false;
+  for (size_t i = 0; i < requests.size(); ++i) {
+    const ResizeSegmentRequest &resize = requests[i];
+    if (ResegmentKeys(segments, resize.start_segment_index,
+                      resize.segments_size, resize.new_size_array.data(),
+                      resize.new_size_array.size())) {
+      resized = true;
+    }
+  }
+  if (!resized) {
+    return false;
+  }
+
+  immutable_converter_->ConvertForRequest(request, segments);
+  RewriteAndSuppressCandidates(request, segments);
+  TrimCandidates(request, segments);
+  return true;
+}
+
+bool ConverterImpl::ResegmentKeys(Segments *segments,
+                                  size_t start_segment_index,
+                                  size_t segments_size,
+                                  const uint8 *new_size_array,
+                                  size_t array_size) const {
   const size_t kMaxArraySize = 256;
   start_segment_index = GetSegmentIndex(segments, start_segment_index);
   const size_t end_segment_index = start_segment_index + segments_size;
@@ -832,10 +1028,6 @@ bool ConverterImpl::ResizeSegment(Segments *segments,
   }
 
   segments->set_resized(true);
-
-  immutable_converter_->ConvertForRequest(request, segments);
-  RewriteAndSuppressCandidates(request, segments);
-  TrimCandidates(request, segments);
   return true;
 }
 
@@ -900,6 +1092,7 @@ void ConverterImpl::CompletePOSIds(Segment::Candidate *candidate) const {
 
 void ConverterImpl::RewriteAndSuppressCandidates(
     const ConversionRequest &request, Segments *segments) const {
+  WaitForLearning(segments);
   if (!rewriter_->Rewrite(request, segments)) {
     return;
   }
@@ -121,13 +121,27 @@ class ConverterImpl : public ConverterInterface {
                              size_t segments_size,
                              const uint8 *new_size_array,
                              size_t array_size) const;
+  virtual bool ResizeSegments(
+      Segments *segments, const ConversionRequest &request,
+      const std::vector<ResizeSegmentRequest> &requests) const;
+
+  // Blocks until the learning queued by FinishConversion() is applied.  Call
+  // this before using the predictor or the rewriter outside of this class.
+  // Returns immediately unless --async_learning is enabled.
+  void WaitForLearning() const;
 
  private:
+  class AsyncLearner;
+
   FRIEND_TEST(ConverterTest, CompletePOSIds);
   FRIEND_TEST(ConverterTest, DefaultPredictor);
   FRIEND_TEST(ConverterTest, MaybeSetConsumedKeySizeToSegment);
   FRIEND_TEST(ConverterTest, GetLastConnectivePart);
 
+  // Waits for the learning and moves the revert entries recorded by the
+  // learning of |segments| into it, so that RevertConversion() can undo it.
+  void WaitForLearning(Segments *segments) const;
+
   // Complete Left id/Right id if they are not defined.
   // Some users don't push conversion button but directly
   // input hiragana sequence only with composition mode. Converter
@@ -150,6 +164,15 @@ class ConverterImpl : public ConverterInterface {
   static void MaybeSetConsumedKeySizeToSegment(size_t consumed_key_size,
                                                Segment* segment);
 
+  // Replaces the segments in [start_segment_index, start_segment_index +
+  // segments_size) with the segments of the new sizes, without converting
+  // them.  Returns false if the parameters are invalid.
+  bool ResegmentKeys(Segments *segments,
+                     size_t start_segment_index,
+                     size_t segments_size,
+                     const uint8 *new_size_array,
+                     size_t array_size) const;
+
   // Rewrites and applies the suppression dictionary.
   void RewriteAndSuppressCandidates(const ConversionRequest &request,
                                     Segments *segments) const;
@@ -179,6 +202,10 @@ class ConverterImpl : public ConverterInterface {
   std::unique_ptr<RewriterInterface> rewriter_;
   const ImmutableConverterInterface *immutable_converter_;
   uint16 general_noun_id_;
+  // Applies the learning on a background thread with --async_learning.
+  // Declared after |predictor_| and |rewriter_| so that it is destroyed
+  // first.
+  std::unique_ptr<AsyncLearner> learner_;
 };
 
 }  // namespace mozc
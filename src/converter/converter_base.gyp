@@ -76,6 +76,8 @@
       'sources': [
         '<(gen_out_mozc_dir)/dictionary/pos_matcher.h',
         'candidate_filter.cc',
+        'converter_workspace.cc',
+        'key_corrector.cc',
         'nbest_generator.cc',
         'segments.cc',
       ],
@@ -83,6 +85,7 @@
         '../base/base.gyp:base',
         '../dictionary/dictionary_base.gyp:pos_matcher',
         '../prediction/prediction_base.gyp:suggestion_filter',
+        '../request/request.gyp:conversion_request',
         '../transliteration/transliteration.gyp:transliteration',
         'connector',
         'lattice',
@@ -114,7 +117,6 @@
       'type': 'static_library',
       'sources': [
         'immutable_converter.cc',
-        'key_corrector.cc',
       ],
       'dependencies': [
         '../base/base.gyp:base',
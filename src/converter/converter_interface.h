@@ -31,6 +31,7 @@
 #define MOZC_CONVERTER_CONVERTER_INTERFACE_H_
 
 #include <string>
+#include <vector>
 
 #include "base/port.h"
 #include "converter/segments.h"
@@ -179,6 +180,31 @@ class ConverterInterface {
                              const uint8 *new_size_array,
                              size_t array_size) const = 0;
 
+  // Parameters of the latter ResizeSegment().
+  struct ResizeSegmentRequest {
+    size_t start_segment_index;
+    size_t segments_size;
+    std::vector<uint8> new_size_array;
+  };
+
+  // Resizes the segments as the latter ResizeSegment() does for each of
+  // |requests| in order.  Implementations may convert the segments only once
+  // after all the resizes.  Returns false if none of them is applied.
+  virtual bool ResizeSegments(
+      Segments *segments, const ConversionRequest &request,
+      const std::vector<ResizeSegmentRequest> &requests) const {
+    bool result = false;
+    for (size_t i = 0; i < requests.size(); ++i) {
+      const ResizeSegmentRequest &resize = requests[i];
+      if (ResizeSegment(segments, request, resize.start_segment_index,
+                        resize.segments_size, resize.new_size_array.data(),
+                        resize.new_size_array.size())) {
+        result = true;
+      }
+    }
+    return result;
+  }
+
  protected:
   ConverterInterface() {}
 
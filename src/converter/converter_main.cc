@@ -27,6 +27,8 @@
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include <algorithm>
+#include <atomic>
 #include <iostream>
 #include <map>
 #include <memory>
@@ -42,7 +44,9 @@
 #include "base/number_util.h"
 #include "base/port.h"
 #include "base/singleton.h"
+#include "base/stopwatch.h"
 #include "base/system_util.h"
+#include "base/thread.h"
 #include "base/util.h"
 #include "composer/composer.h"
 #include "composer/table.h"
@@ -52,6 +56,7 @@
 #include "converter/segments.h"
 #include "data_manager/data_manager.h"
 #include "engine/engine.h"
+#include "engine/engine_interface.h"
 #include "protocol/commands.pb.h"
 #include "protocol/config.pb.h"
 #include "request/conversion_request.h"
@@ -65,6 +70,21 @@ DEFINE_string(engine_type, "desktop", "Engine type: (desktop|mobile)");
 DEFINE_bool(output_debug_string, true, "output debug string for each input");
 DEFINE_bool(show_meta_candidates, false, "if true, show meta candidates");
 
+// Options for the batch mode.  When --batch_input is given, each line of the
+// file is converted as a reading and the results are written in the order of
+// the input, one line per input line:
+//   reading<TAB>top-1 sentence
+// With --batch_nbest > 1, one field per segment follows:
+//   <TAB>segment key<TAB>candidate 1|candidate 2|...
+DEFINE_string(batch_input, "", "UTF-8 file of readings to convert in batch");
+DEFINE_string(batch_output, "",
+              "output file for the batch mode.  stdout if empty");
+DEFINE_int32(batch_num_threads, 1,
+             "number of threads for the batch mode.  Each thread owns its own "
+             "engine");
+DEFINE_int32(batch_nbest, 1,
+             "number of candidates per segment to output in the batch mode");
+
 // Advanced options for data files.  These are automatically set when --engine
 // is used but they can be overridden by specifying these flags.
 DEFINE_string(engine_data, "", "Path to engine data file");
@@ -420,6 +440,200 @@ string SelectIdDefFromName(const string &mozc_runfiles_dir,
   return "";
 }
 
+std::unique_ptr<EngineInterface> CreateEngine(commands::Request *request) {
+  std::unique_ptr<DataManager> data_manager(new DataManager);
+  const auto status = data_manager->InitFromFile(FLAGS_engine_data,
+                                                 FLAGS_magic);
+  CHECK_EQ(status, DataManager::Status::OK);
+
+  if (FLAGS_engine_type == "desktop") {
+    return Engine::CreateDesktopEngine(std::move(data_manager));
+  } else if (FLAGS_engine_type == "mobile") {
+    commands::RequestForUnitTest::FillMobileRequest(request);
+    return Engine::CreateMobileEngine(std::move(data_manager));
+  }
+  LOG(FATAL) << "Invalid type: --engine_type=" << FLAGS_engine_type;
+  return nullptr;
+}
+
+// Formats the result of a batch conversion in the format described at
+// --batch_input.
+string FormatBatchResult(const string &reading, const Segments &segments) {
+  string result = reading;
+  result.append("\t");
+  for (size_t i = 0; i < segments.conversion_segments_size(); ++i) {
+    const Segment &segment = segments.conversion_segment(i);
+    if (segment.candidates_size() > 0) {
+      result.append(segment.candidate(0).value);
+    } else {
+      result.append(segment.key());
+    }
+  }
+  if (FLAGS_batch_nbest <= 1) {
+    return result;
+  }
+  for (size_t i = 0; i < segments.conversion_segments_size(); ++i) {
+    const Segment &segment = segments.conversion_segment(i);
+    result.append("\t");
+    result.append(segment.key());
+    result.append("\t");
+    const size_t size = std::min(segment.candidates_size(),
+                                 static_cast<size_t>(FLAGS_batch_nbest));
+    for (size_t j = 0; j < size; ++j) {
+      if (j > 0) {
+        result.append("|");
+      }
+      result.append(segment.candidate(j).value);
+    }
+  }
+  return result;
+}
+
+// Converts the readings with one engine.  The readings are handed out one by
+// one through |next_index| shared by all the converters, and the result of
+// the i-th reading is stored in (*results)[i].
+class BatchConverter : public Thread {
+ public:
+  BatchConverter(const std::vector<string> &readings,
+                 std::atomic<size_t> *next_index,
+                 std::vector<string> *results)
+      : readings_(readings),
+        next_index_(next_index),
+        results_(results),
+        num_converted_(0),
+        conversion_msec_(0) {
+    engine_ = CreateEngine(&request_);
+  }
+
+  void Run() override {
+    const ConverterInterface *converter = engine_->GetConverter();
+    CHECK(converter);
+    const Config config;
+    Table table;
+    Segments segments;
+    Stopwatch stopwatch;
+    for (size_t i = next_index_->fetch_add(1); i < readings_.size();
+         i = next_index_->fetch_add(1)) {
+      stopwatch.Start();
+      segments.Clear();
+      segments.set_max_conversion_candidates_size(
+          std::max(FLAGS_batch_nbest, 1));
+      Composer composer(&table, &request_, &config);
+      composer.SetPreeditTextForTestOnly(readings_[i]);
+      const ConversionRequest conversion_request(&composer, &request_,
+                                                 &config);
+      if (converter->StartConversionForRequest(conversion_request,
+                                               &segments)) {
+        (*results_)[i] = FormatBatchResult(readings_[i], segments);
+      } else {
+        (*results_)[i] = readings_[i] + "\t";
+      }
+      stopwatch.Stop();
+      ++num_converted_;
+    }
+    conversion_msec_ = stopwatch.GetElapsedMilliseconds();
+  }
+
+  size_t num_converted() const { return num_converted_; }
+  int64 conversion_msec() const { return conversion_msec_; }
+
+ private:
+  const std::vector<string> &readings_;
+  std::atomic<size_t> *next_index_;
+  std::vector<string> *results_;
+  commands::Request request_;
+  std::unique_ptr<EngineInterface> engine_;
+  size_t num_converted_;
+  int64 conversion_msec_;
+
+  DISALLOW_COPY_AND_ASSIGN(BatchConverter);
+};
+
+// Runs the batch mode.  The timing of each stage is reported to stderr.
+int RunBatch() {
+  Stopwatch load_stopwatch = Stopwatch::StartNew();
+  std::vector<string> readings;
+  {
+    InputFileStream ifs(FLAGS_batch_input.c_str());
+    if (!ifs) {
+      LOG(ERROR) << "Cannot open " << FLAGS_batch_input;
+      return 1;
+    }
+    string line;
+    while (!getline(ifs, line).fail()) {
+      Util::ChopReturns(&line);
+      readings.push_back(line);
+    }
+  }
+  load_stopwatch.Stop();
+
+  const int num_threads = std::max(FLAGS_batch_num_threads, 1);
+  std::vector<string> results(readings.size());
+  std::atomic<size_t> next_index(0);
+
+  Stopwatch init_stopwatch = Stopwatch::StartNew();
+  std::vector<std::unique_ptr<BatchConverter>> converters;
+  for (int i = 0; i < num_threads; ++i) {
+    converters.emplace_back(
+        new BatchConverter(readings, &next_index, &results));
+  }
+  init_stopwatch.Stop();
+
+  Stopwatch convert_stopwatch = Stopwatch::StartNew();
+  if (num_threads == 1) {
+    converters[0]->Run();
+  } else {
+    for (size_t i = 0; i < converters.size(); ++i) {
+      converters[i]->SetJoinable(true);
+      converters[i]->Start("BatchConverter");
+    }
+    for (size_t i = 0; i < converters.size(); ++i) {
+      converters[i]->Join();
+    }
+  }
+  convert_stopwatch.Stop();
+
+  Stopwatch write_stopwatch = Stopwatch::StartNew();
+  {
+    std::unique_ptr<OutputFileStream> ofs;
+    std::ostream *os = &std::cout;
+    if (!FLAGS_batch_output.empty()) {
+      ofs.reset(new OutputFileStream(FLAGS_batch_output.c_str()));
+      if (!*ofs) {
+        LOG(ERROR) << "Cannot open " << FLAGS_batch_output;
+        return 1;
+      }
+      os = ofs.get();
+    }
+    for (size_t i = 0; i < results.size(); ++i) {
+      (*os) << results[i] << '\n';
+    }
+    os->flush();
+  }
+  write_stopwatch.Stop();
+
+  const int64 convert_msec = convert_stopwatch.GetElapsedMilliseconds();
+  std::cerr << "Lines: " << readings.size()
+            << "\nThreads: " << num_threads
+            << "\nLoad input: " << load_stopwatch.GetElapsedMilliseconds()
+            << " msec"
+            << "\nEngine init: " << init_stopwatch.GetElapsedMilliseconds()
+            << " msec"
+            << "\nConversion: " << convert_msec << " msec";
+  if (convert_msec > 0) {
+    std::cerr << " (" << (readings.size() * 1000.0 / convert_msec)
+              << " lines/sec)";
+  }
+  std::cerr << "\nWrite output: " << write_stopwatch.GetElapsedMilliseconds()
+            << " msec" << std::endl;
+  for (size_t i = 0; i < converters.size(); ++i) {
+    std::cerr << "  thread " << i << ": "
+              << converters[i]->num_converted() << " lines in "
+              << converters[i]->conversion_msec() << " msec" << std::endl;
+  }
+  return 0;
+}
+
 }  // namespace
 }  // namespace mozc
 
@@ -446,26 +660,17 @@ int main(int argc, char **argv) {
     FLAGS_id_def = mozc::SelectIdDefFromName(mozc_runfiles_dir, FLAGS_engine);
   }
 
+  if (!FLAGS_batch_input.empty()) {
+    return mozc::RunBatch();
+  }
+
   std::cout << "Engine type: " << FLAGS_engine_type
             << "\nData file: " << FLAGS_engine_data
             << "\nid.def: " << FLAGS_id_def << std::endl;
 
-  std::unique_ptr<mozc::DataManager> data_manager(new mozc::DataManager);
-  const auto status = data_manager->InitFromFile(FLAGS_engine_data,
-                                                 FLAGS_magic);
-  CHECK_EQ(status, mozc::DataManager::Status::OK);
-
   mozc::commands::Request request;
-  std::unique_ptr<mozc::EngineInterface> engine;
-  if (FLAGS_engine_type == "desktop") {
-    engine = mozc::Engine::CreateDesktopEngine(std::move(data_manager));
-  } else if (FLAGS_engine_type == "mobile") {
-    engine = mozc::Engine::CreateMobileEngine(std::move(data_manager));
-    mozc::commands::RequestForUnitTest::FillMobileRequest(&request);
-  } else {
-    LOG(FATAL) << "Invalid type: --engine_type=" << FLAGS_engine_type;
-    return 0;
-  }
+  std::unique_ptr<mozc::EngineInterface> engine =
+      mozc::CreateEngine(&request);
 
   mozc::ConverterInterface *converter = engine->GetConverter();
   CHECK(converter);
@@ -33,6 +33,7 @@
 #include <string>
 #include <vector>
 
+#include "base/flags.h"
 #include "base/logging.h"
 #include "base/port.h"
 #include "base/system_util.h"
@@ -79,6 +80,8 @@
 #include "testing/base/public/mozctest.h"
 #include "transliteration/transliteration.h"
 #include "usage_stats/usage_stats.h"
+
+DECLARE_bool(async_learning);
 #include "usage_stats/usage_stats_testing_util.h"
 
 namespace mozc {
@@ -154,6 +157,37 @@ class InsertDummyWordsRewriter : public RewriterInterface {
   }
 };
 
+// Records the values learned by Finish() and how many of them Rewrite() can
+// see.
+class LearningRewriter : public RewriterInterface {
+ public:
+  LearningRewriter() : num_learned_at_rewrite_(0) {}
+
+  bool Rewrite(const ConversionRequest &request,
+               Segments *segments) const override {
+    num_learned_at_rewrite_ = learned_values_.size();
+    return true;
+  }
+
+  void Finish(const ConversionRequest &request, Segments *segments) override {
+    for (size_t i = 0; i < segments->conversion_segments_size(); ++i) {
+      const Segment &segment = segments->conversion_segment(i);
+      if (segment.candidates_size() > 0) {
+        learned_values_.push_back(segment.candidate(0).value);
+      }
+    }
+  }
+
+  const std::vector<string> &learned_values() const {
+    return learned_values_;
+  }
+  size_t num_learned_at_rewrite() const { return num_learned_at_rewrite_; }
+
+ private:
+  std::vector<string> learned_values_;
+  mutable size_t num_learned_at_rewrite_;
+};
+
 }  // namespace
 
 class ConverterTest : public ::testing::Test {
@@ -893,6 +927,55 @@ TEST_F(ConverterTest, Regression3437022) {
   dic->UnLock();
 }
 
+TEST_F(ConverterTest, ResizeSegments) {
+  std::unique_ptr<EngineInterface> engine(MockDataEngineFactory::Create());
+  ConverterInterface *converter = engine->GetConverter();
+  const ConversionRequest default_request;
+  const string kKey = "わたしのなまえはなかのです";
+
+  // Two resizes in a batch give the same segments as one by one.
+  const uint8 kSizes1[] = {3, 1, 0, 0};
+  const uint8 kSizes2[] = {4, 0, 0, 0};
+  Segments expected;
+  ASSERT_TRUE(converter->StartConversion(&expected, kKey));
+  ASSERT_LE(2, expected.conversion_segments_size());
+  EXPECT_TRUE(converter->ResizeSegment(&expected, default_request, 0, 2,
+                                       kSizes1, arraysize(kSizes1)));
+  EXPECT_TRUE(converter->ResizeSegment(&expected, default_request, 2, 1,
+                                       kSizes2, arraysize(kSizes2)));
+
+  Segments segments;
+  ASSERT_TRUE(converter->StartConversion(&segments, kKey));
+  std::vector<ConverterInterface::ResizeSegmentRequest> requests(2);
+  requests[0].start_segment_index = 0;
+  requests[0].segments_size = 2;
+  requests[0].new_size_array.assign(kSizes1,
+                                    kSizes1 + arraysize(kSizes1));
+  requests[1].start_segment_index = 2;
+  requests[1].segments_size = 1;
+  requests[1].new_size_array.assign(kSizes2,
+                                    kSizes2 + arraysize(kSizes2));
+  EXPECT_TRUE(converter->ResizeSegments(&segments, default_request,
+                                        requests));
+  EXPECT_TRUE(segments.resized());
+  ASSERT_EQ(expected.conversion_segments_size(),
+            segments.conversion_segments_size());
+  for (size_t i = 0; i < segments.conversion_segments_size(); ++i) {
+    EXPECT_EQ(expected.conversion_segment(i).key(),
+              segments.conversion_segment(i).key());
+    EXPECT_EQ(expected.conversion_segment(i).candidate(0).value,
+              segments.conversion_segment(i).candidate(0).value);
+  }
+  EXPECT_EQ("わたし", segments.conversion_segment(0).key());
+  EXPECT_EQ("の", segments.conversion_segment(1).key());
+
+  // Invalid requests are ignored.
+  requests[0].start_segment_index = 100;
+  requests.resize(1);
+  EXPECT_FALSE(converter->ResizeSegments(&segments, default_request,
+                                         requests));
+}
+
 TEST_F(ConverterTest, CompletePOSIds) {
   const char *kTestKeys[] = {
       "きょうと",
@@ -1821,4 +1904,33 @@ TEST_F(ConverterTest, SuggestionOnlyShouldBeIndependent_Prediction) {
   }
 }
 
+TEST_F(ConverterTest, AsyncLearning) {
+  const bool original_async_learning = FLAGS_async_learning;
+  FLAGS_async_learning = true;
+  LearningRewriter *rewriter = new LearningRewriter;
+  std::unique_ptr<ConverterAndData> ret(
+      CreateConverterAndData(rewriter, STUB_PREDICTOR));
+  ConverterImpl *converter = ret->converter.get();
+
+  Segments segments;
+  ASSERT_TRUE(converter->StartConversion(&segments, "わたしは"));
+  ASSERT_LE(1, segments.conversion_segments_size());
+  ASSERT_LT(0, segments.conversion_segment(0).candidates_size());
+  const string committed = segments.conversion_segment(0).candidate(0).value;
+  ASSERT_TRUE(converter->CommitSegmentValue(&segments, 0, 0));
+  const ConversionRequest default_request;
+  ASSERT_TRUE(converter->FinishConversion(default_request, &segments));
+
+  // The next conversion sees the learning of the previous commit.
+  ASSERT_TRUE(converter->StartConversion(&segments, "わたしは"));
+  converter->WaitForLearning();
+  ASSERT_LE(1, rewriter->learned_values().size());
+  EXPECT_EQ(committed, rewriter->learned_values()[0]);
+  EXPECT_EQ(rewriter->learned_values().size(),
+            rewriter->num_learned_at_rewrite());
+
+  ret.reset();
+  FLAGS_async_learning = original_async_learning;
+}
+
 }  // namespace mozc
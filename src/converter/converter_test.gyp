@@ -44,6 +44,7 @@
         'key_corrector_test.cc',
         'lattice_test.cc',
         'nbest_generator_test.cc',
+        'node_allocator_test.cc',
         'segments_test.cc',
       ],
       'dependencies': [
@@ -101,6 +102,7 @@
         'connector_test.cc',
       ],
       'dependencies': [
+        '../base/base.gyp:base',
         '../data_manager/data_manager.gyp:connection_file_reader',
         '../data_manager/testing/mock_data_manager.gyp:gen_separate_connection_data_for_mock#host',
         '../data_manager/testing/mock_data_manager.gyp:mock_data_manager',
@@ -0,0 +1,86 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MOZC_CONVERTER_CONVERTER_WORKSPACE_H_
+#define MOZC_CONVERTER_CONVERTER_WORKSPACE_H_
+
+#include <memory>
+#include <vector>
+
+#include "base/port.h"
+
+namespace mozc {
+
+class KeyCorrector;
+class Lattice;
+class NBestGenerator;
+
+// Scratch state of the immutable converter reused across the conversions of
+// one session, e.g., the conversions run on every keystroke.  It keeps the
+// N-best generator (the agenda, the element pool of the search and the
+// tables of the candidate filter) and the segment group table allocated,
+// instead of allocating them on every conversion.  The key corrector keeps the
+// correction of the previous key, which is extended on the next keystroke.
+// The lattice of prediction is cached by Segments.  The lattice of the last
+// conversion is kept here, so that resizing its segments reuses the nodes
+// instead of looking up the dictionaries for the whole key again.
+//
+// The workspace is passed to the converter via ConversionRequest.  It is not
+// thread-safe, so it must not be shared by conversions running concurrently.
+class ConverterWorkspace {
+ public:
+  ConverterWorkspace();
+  ~ConverterWorkspace();
+
+  // Releases all the cached buffers.
+  void Clear();
+
+ private:
+  friend class ImmutableConverterImpl;
+
+  // Identifies the converter and the filter type |nbest_generator_| was
+  // created for.  0 means none.
+  uint64 nbest_generator_owner_;
+  bool apply_suggestion_filter_;
+  std::unique_ptr<NBestGenerator> nbest_generator_;
+
+  std::vector<uint16> group_;
+
+  std::unique_ptr<KeyCorrector> key_corrector_;
+
+  // Identifies the converter |lattice_| was built by.  0 means none.
+  uint64 lattice_owner_;
+  std::unique_ptr<Lattice> lattice_;
+
+  DISALLOW_COPY_AND_ASSIGN(ConverterWorkspace);
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_CONVERTER_CONVERTER_WORKSPACE_H_
@@ -31,6 +31,7 @@
 // |kCompressedLSize|, |kCompressedRSize|,
 // |kCompressedLIDTable|, |kCompressedRIDTable|,
 // |kSegmenterBitArrayData_size|, |kSegmenterBitArrayData_data|
+// and optionally the uncompressed bit-array.
 
 #include "converter/gen_segmenter_bitarray.h"
 
@@ -86,6 +87,8 @@ class StateTable {
     CHECK_LT(compressed_size_, idarray_.size());
   }
 
+  size_t size() const { return idarray_.size(); }
+
   uint16 id(uint16 id) const {
     CHECK_LT(id, idarray_.size());
     return compressed_table_[id];
@@ -106,12 +109,55 @@ class StateTable {
 
   DISALLOW_COPY_AND_ASSIGN(StateTable);
 };
+
+// Writes the bit-array of |ltable| x |rtable| without the compression.  The
+// format is as follows:
+// Magic number (\xAE\xCD): 2bytes
+// Num rids: 2bytes
+// Num lids: 2bytes
+// Bytes per row: 2bytes (a multiple of 64)
+// Padding to 64 bytes
+// Rows: bytes per row * num lids; rid-th bit of lid-th row is the boundary
+//       flag of (rid, lid).
+//
+// Every row is aligned to 64 bytes so that it covers the fewest cache lines.
+void OutputDenseBitarray(const StateTable &ltable, const StateTable &rtable,
+                         size_t compressed_lsize, const BitArray &barray,
+                         std::ostream *os) {
+  const size_t kHeaderSize = 64;
+  const size_t num_rids = ltable.size();
+  const size_t num_lids = rtable.size();
+  const size_t row_bytes = (num_rids + 511) / 512 * 64;
+  CHECK_LE(num_rids, 65535);
+  CHECK_LE(num_lids, 65535);
+  CHECK_LE(row_bytes, 65535);
+
+  BitArray dense(row_bytes * 8 * num_lids);
+  for (size_t lid = 0; lid < num_lids; ++lid) {
+    for (size_t rid = 0; rid < num_rids; ++rid) {
+      const uint32 cindex = ltable.id(rid) + compressed_lsize * rtable.id(lid);
+      if (barray.get(cindex)) {
+        dense.set(row_bytes * 8 * lid + rid);
+      }
+    }
+  }
+
+  string header(kHeaderSize, '\0');
+  uint16 *fields = reinterpret_cast<uint16 *>(&header[0]);
+  fields[0] = 0xCDAE;
+  fields[1] = num_rids;
+  fields[2] = num_lids;
+  fields[3] = row_bytes;
+  os->write(header.data(), header.size());
+  os->write(dense.array(), row_bytes * num_lids);
+}
+
 }  // namespace
 
 void SegmenterBitarrayGenerator::GenerateBitarray(
     int lsize, int rsize, IsBoundaryFunc func, const string &output_size_info,
     const string &output_ltable, const string &output_rtable,
-    const string &output_bitarray) {
+    const string &output_bitarray, const string &output_dense_bitarray) {
   // Load the original matrix into an array
   std::vector<uint8> array((lsize + 1) * (rsize + 1));
 
@@ -222,6 +268,13 @@ void SegmenterBitarrayGenerator::GenerateBitarray(
     ofs.write(barray.array(), barray.array_size());
     ofs.close();
   }
+  if (!output_dense_bitarray.empty()) {
+    mozc::OutputFileStream ofs(output_dense_bitarray.c_str(),
+                               std::ios_base::out | std::ios_base::binary);
+    CHECK(ofs);
+    OutputDenseBitarray(ltable, rtable, kCompressedLSize, barray, &ofs);
+    ofs.close();
+  }
 }
 
 }  // namespace mozc
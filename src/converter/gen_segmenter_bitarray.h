@@ -39,11 +39,15 @@ namespace mozc {
 class SegmenterBitarrayGenerator {
  public:
   typedef bool (*IsBoundaryFunc)(uint16 rid, uint16 lid);
+
+  // The uncompressed bit-array is written to |output_dense_bitarray| unless
+  // it's empty.
   static void GenerateBitarray(int lsize, int rsize, IsBoundaryFunc func,
                                const string &output_size_info,
                                const string &output_ltable,
                                const string &output_rtable,
-                               const string &output_bitarray);
+                               const string &output_bitarray,
+                               const string &output_dense_bitarray);
 
  private:
   DISALLOW_COPY_AND_ASSIGN(SegmenterBitarrayGenerator);
@@ -30,20 +30,27 @@
 #include "converter/immutable_converter.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cctype>
 #include <climits>
+#include <iterator>
 #include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "base/allocation_stats.h"
+#include "base/flags.h"
 #include "base/logging.h"
 #include "base/port.h"
 #include "base/stl_util.h"
 #include "base/string_piece.h"
+#include "base/thread_pool.h"
+#include "base/trace_events.h"
 #include "base/util.h"
 #include "config/config_handler.h"
 #include "converter/connector.h"
+#include "converter/converter_workspace.h"
 #include "converter/key_corrector.h"
 #include "converter/lattice.h"
 #include "converter/nbest_generator.h"
@@ -61,11 +68,20 @@
 #include "protocol/config.pb.h"
 #include "request/conversion_request.h"
 
+DEFINE_int32(nbest_max_agenda_size, 0,
+             "Caps the number of partial paths NBestGenerator keeps per "
+             "segment (beam search).  0 means unbounded (exact A* search).");
+DEFINE_int32(immutable_converter_expansion_threads, 0,
+             "The number of threads expanding the candidates of the "
+             "segments in parallel.  0 means the segments are expanded "
+             "sequentially on the calling thread.");
+
 using mozc::dictionary::DictionaryInterface;
 using mozc::dictionary::POSMatcher;
 using mozc::dictionary::PosGroup;
 using mozc::dictionary::SuppressionDictionary;
 using mozc::dictionary::Token;
+using mozc::dictionary::TokenView;
 
 namespace mozc {
 namespace {
@@ -77,6 +93,27 @@ const int    kMaxCost                           = 32767;
 const int    kMinCost                           = -32767;
 const int    kDefaultNumberCost                 = 3000;
 
+// Returns the pool expanding the segments in parallel, or nullptr if the
+// parallel expansion is disabled.
+ThreadPool *GetExpansionThreadPool() {
+  if (FLAGS_immutable_converter_expansion_threads <= 0) {
+    return nullptr;
+  }
+  // Intentionally leaked so that the workers outlive all the converters.
+  static ThreadPool *pool =
+      new ThreadPool(FLAGS_immutable_converter_expansion_threads);
+  return pool;
+}
+
+// Returns an ID which is never reused in the process, identifying the
+// converter which created the N-best generator cached in a
+// ConverterWorkspace.  Unlike the address of the converter, it doesn't match a
+// new converter created after the old one is deleted.
+uint64 NewWorkspaceOwnerId() {
+  static std::atomic<uint64> next_id(1);
+  return next_id++;
+}
+
 class KeyCorrectedNodeListBuilder : public BaseNodeListBuilder {
  public:
   KeyCorrectedNodeListBuilder(size_t pos,
@@ -89,8 +126,8 @@ class KeyCorrectedNodeListBuilder : public BaseNodeListBuilder {
         key_corrector_(key_corrector),
         tail_(NULL) {}
 
-  virtual ResultType OnToken(StringPiece key, StringPiece actual_key,
-                             const Token &token) {
+  virtual ResultType OnTokenView(StringPiece key, StringPiece actual_key,
+                                 const TokenView &token) {
     const size_t offset =
         key_corrector_->GetOriginalOffset(pos_, token.key.size());
     if (!KeyCorrector::IsValidPosition(offset) || offset == 0) {
@@ -120,29 +157,44 @@ class KeyCorrectedNodeListBuilder : public BaseNodeListBuilder {
   Node *tail_;
 };
 
-void InsertCorrectedNodes(size_t pos, const string &key,
-                          const ConversionRequest &request,
-                          const KeyCorrector *key_corrector,
-                          const DictionaryInterface *dictionary,
-                          Lattice *lattice) {
-  if (key_corrector == NULL) {
-    return;
-  }
-  size_t length = 0;
-  const char *str = key_corrector->GetCorrectedPrefix(pos, &length);
-  if (str == NULL || length == 0) {
-    return;
-  }
-  KeyCorrectedNodeListBuilder builder(pos, key, key_corrector,
-                                      lattice->node_allocator());
-  dictionary->LookupPrefix(StringPiece(str, length), request, &builder);
-  if (builder.tail() != NULL) {
-    builder.tail()->bnext = NULL;
+// Looks up the corrected keys of the positions in one batch over the corrected
+// key, and inserts the found nodes at the corresponding original positions.
+// The begin positions are the positions in the corrected key.
+class KeyCorrectedLookupCallback : public DictionaryInterface::BatchCallback {
+ public:
+  KeyCorrectedLookupCallback(const KeyCorrector *key_corrector,
+                             Lattice *lattice)
+      : key_corrector_(key_corrector),
+        lattice_(lattice),
+        pos_(0) {}
+
+  virtual DictionaryInterface::Callback *OnBeginPosition(
+      size_t corrected_pos) {
+    pos_ = key_corrector_->GetOriginalPosition(corrected_pos);
+    DCHECK(KeyCorrector::IsValidPosition(pos_));
+    builder_.reset(new KeyCorrectedNodeListBuilder(
+        pos_, lattice_->key(), key_corrector_, lattice_->node_allocator()));
+    return builder_.get();
   }
-  if (builder.result() != NULL) {
-    lattice->Insert(pos, builder.result());
+
+  virtual void OnEndPosition(size_t corrected_pos) {
+    if (builder_->tail() != NULL) {
+      builder_->tail()->bnext = NULL;
+    }
+    if (builder_->result() != NULL) {
+      // The corrected key often finds the same words as the original key.
+      lattice_->InsertWithoutDuplicates(pos_, builder_->result());
+    }
   }
-}
+
+ private:
+  const KeyCorrector *key_corrector_;
+  Lattice *lattice_;
+  size_t pos_;
+  std::unique_ptr<KeyCorrectedNodeListBuilder> builder_;
+
+  DISALLOW_COPY_AND_ASSIGN(KeyCorrectedLookupCallback);
+};
 
 bool IsNumber(const char c) {
   return c >= '0' && c <= '9';
@@ -235,26 +287,52 @@ void NormalizeHistorySegments(Segments *segments) {
   }
 }
 
-Lattice *GetLattice(Segments *segments, bool is_prediction) {
-  Lattice *lattice = segments->mutable_cached_lattice();
-  if (lattice == NULL) {
-    return NULL;
-  }
+// Returns true if the dictionary nodes of the lattice are kept for the next
+// conversion.  The lattice shared through ConversionRequest is always cached
+// so that conversions of the same key with different request types can reuse
+// its nodes.
+bool UseLatticeCache(const ConversionRequest &request, bool is_prediction) {
+  return is_prediction || request.lattice() != NULL;
+}
 
-  const size_t history_segments_size = segments->history_segments_size();
+// Returns true if the conversion of |segments| uses the lattice kept in the
+// workspace of |request|.  The nodes of the lattice are cached, so that the
+// resize of the segments reuses them.
+bool UseWorkspaceLattice(const ConversionRequest &request,
+                         const Segments &segments) {
+  return segments.request_type() == Segments::CONVERSION &&
+         request.lattice() == NULL && request.workspace() != NULL;
+}
 
-  string history_key = "";
+// Returns the concatenated keys of the history segments and the conversion
+// segments of |segments|, respectively.
+void GetHistoryAndConversionKeys(const Segments &segments,
+                                 string *history_key,
+                                 string *conversion_key) {
+  const size_t history_segments_size = segments.history_segments_size();
   for (size_t i = 0; i < history_segments_size; ++i) {
-    history_key.append(segments->segment(i).key());
+    history_key->append(segments.segment(i).key());
   }
-  string conversion_key = "";
-  for (size_t i = history_segments_size; i < segments->segments_size(); ++i) {
-    conversion_key.append(segments->segment(i).key());
+  for (size_t i = history_segments_size; i < segments.segments_size(); ++i) {
+    conversion_key->append(segments.segment(i).key());
   }
+}
+
+Lattice *GetLattice(const ConversionRequest &request, Segments *segments,
+                    bool is_prediction) {
+  Lattice *lattice = (request.lattice() != NULL) ?
+      request.lattice() : segments->mutable_cached_lattice();
+  if (lattice == NULL) {
+    return NULL;
+  }
+
+  string history_key;
+  string conversion_key;
+  GetHistoryAndConversionKeys(*segments, &history_key, &conversion_key);
 
   const size_t lattice_history_end_pos = lattice->history_end_pos();
 
-  if (!is_prediction ||
+  if (!UseLatticeCache(request, is_prediction) ||
       Util::CharsLen(conversion_key) <= 1 ||
       lattice_history_end_pos != history_key.size()) {
     // Do not cache if conversion is not prediction.  In addition, if a user
@@ -269,6 +347,22 @@ Lattice *GetLattice(Segments *segments, bool is_prediction) {
   return lattice;
 }
 
+// Returns true if |best| holds the same (id, cost) pairs as |cached|.
+template <typename BestMap>
+bool IsSameBest(const BestMap &best,
+                const std::vector<std::pair<int, int>> &cached) {
+  if (best.size() != cached.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < best.size(); ++i) {
+    if (best[i].first != cached[i].first ||
+        best[i].second.first != cached[i].second) {
+      return false;
+    }
+  }
+  return true;
+}
+
 }  // namespace
 
 ImmutableConverterImpl::ImmutableConverterImpl(
@@ -293,7 +387,8 @@ ImmutableConverterImpl::ImmutableConverterImpl(
       number_id_(pos_matcher_->GetNumberId()),
       unknown_id_(pos_matcher_->GetUnknownId()),
       last_to_first_name_transition_cost_(
-          connector_->GetTransitionCost(last_name_id_, first_name_id_)) {
+          connector_->GetTransitionCost(last_name_id_, first_name_id_)),
+      workspace_owner_id_(NewWorkspaceOwnerId()) {
   DCHECK(dictionary_);
   DCHECK(suffix_dictionary_);
   DCHECK(suppression_dictionary_);
@@ -325,6 +420,15 @@ void ImmutableConverterImpl::ExpandCandidates(
   }
 }
 
+struct ImmutableConverterImpl::SegmentExpansion {
+  Segment *segment;
+  const Node *begin_node;
+  const Node *end_node;
+  NBestGenerator::BoundaryCheckMode mode;
+  // True if the segment ends with a CON_NODE.
+  bool is_fixed_value;
+};
+
 void ImmutableConverterImpl::InsertDummyCandidates(Segment *segment,
                                                    size_t expand_size) const {
   const Segment::Candidate *top_candidate =
@@ -744,8 +848,8 @@ class NodeListBuilderWithCacheEnabled : public NodeListBuilderForLookupPrefix {
     DCHECK(allocator);
   }
 
-  virtual ResultType OnToken(StringPiece key, StringPiece actual_key,
-                             const Token &token) {
+  virtual ResultType OnTokenView(StringPiece key, StringPiece actual_key,
+                                 const TokenView &token) {
     Node *node = NewNodeFromToken(token);
     node->attributes |= Node::ENABLE_CACHE;
     node->raw_wcost = node->wcost;
@@ -756,6 +860,79 @@ class NodeListBuilderWithCacheEnabled : public NodeListBuilderForLookupPrefix {
 
 }  // namespace
 
+// Looks up each position reachable from the preceding ones, i.e., where some
+// node ends, and inserts the found nodes at the end of the position.
+class ImmutableConverterImpl::ConversionSegmentsLookupCallback
+    : public DictionaryInterface::BatchCallback {
+ public:
+  ConversionSegmentsLookupCallback(const ImmutableConverterImpl *converter,
+                                   const string &history_key,
+                                   const ConversionRequest &request,
+                                   bool use_cache,
+                                   Lattice *lattice,
+                                   std::vector<size_t> *looked_up_positions)
+      : converter_(converter),
+        history_key_(history_key),
+        request_(request),
+        use_cache_(use_cache),
+        lattice_(lattice),
+        looked_up_positions_(looked_up_positions) {}
+
+  virtual DictionaryInterface::Callback *OnBeginPosition(size_t begin_pos) {
+    // The positions skipped after the cancellation are not marked as cached,
+    // so the next conversion of a cached lattice looks them up.
+    if (lattice_->end_nodes(begin_pos) == NULL || request_.IsCanceled()) {
+      return NULL;
+    }
+    if (use_cache_ &&
+        lattice_->cache_info(begin_pos) >= lattice_->key().size() - begin_pos) {
+      // All the prefixes have been looked up, e.g., by the conversion before
+      // the segments are resized, and the found nodes are in the lattice.
+      InsertNodes(begin_pos, NULL);
+      return NULL;
+    }
+    NodeAllocator *allocator = lattice_->node_allocator();
+    allocator->set_max_nodes_size(8192);
+    if (use_cache_) {
+      builder_.reset(new NodeListBuilderWithCacheEnabled(
+          allocator, lattice_->cache_info(begin_pos) + 1));
+    } else {
+      builder_.reset(
+          new BaseNodeListBuilder(allocator, allocator->max_nodes_size()));
+    }
+    return builder_.get();
+  }
+
+  virtual void OnEndPosition(size_t begin_pos) {
+    InsertNodes(begin_pos, builder_->result());
+  }
+
+ private:
+  // Inserts |nodes| found at |begin_pos| into the lattice together with the
+  // character type based nodes, which are not cached.
+  void InsertNodes(size_t begin_pos, Node *nodes) {
+    const string &key = lattice_->key();
+    if (use_cache_) {
+      lattice_->SetCacheInfo(begin_pos, key.size() - begin_pos);
+    }
+    Node *rnode = converter_->AddCharacterTypeBasedNodes(
+        key.data() + begin_pos, key.data() + key.size(), lattice_, nodes);
+    converter_->InsertConversionSegmentsNodes(begin_pos, history_key_,
+                                              rnode, lattice_);
+    looked_up_positions_->push_back(begin_pos);
+  }
+
+  const ImmutableConverterImpl *converter_;
+  const string &history_key_;
+  const ConversionRequest &request_;
+  const bool use_cache_;
+  Lattice *lattice_;
+  std::vector<size_t> *looked_up_positions_;
+  std::unique_ptr<BaseNodeListBuilder> builder_;
+
+  DISALLOW_COPY_AND_ASSIGN(ConversionSegmentsLookupCallback);
+};
+
 Node *ImmutableConverterImpl::Lookup(const int begin_pos,
                                      const int end_pos,
                                      const ConversionRequest &request,
@@ -879,9 +1056,11 @@ const int kVeryBigCost = (INT_MAX >> 2);
 // are the next boundary looked from pos. (If pos is on the boundary,
 // left_boundary should be the previous one, and right_boundary should be
 // the next).
+// |lnodes| is a buffer for the nodes ending at |pos|.
 inline void ViterbiInternal(
     const Connector &connector, size_t pos, size_t right_boundary,
-    Lattice *lattice) {
+    Lattice *lattice, Lattice::EndNodeTable *lnodes) {
+  bool lnodes_filled = false;
   for (Node *rnode = lattice->begin_nodes(pos);
        rnode != NULL; rnode = rnode->bnext) {
     if (rnode->end_pos > right_boundary) {
@@ -904,21 +1083,23 @@ inline void ViterbiInternal(
       continue;
     }
 
+    if (!lnodes_filled) {
+      // Invalid lnodes (prev == NULL) are excluded.
+      lattice->GetReachableEndNodes(pos, lnodes);
+      lnodes_filled = true;
+    }
+
     // Find a valid node which connects to the rnode with minimum cost.
     int best_cost = kVeryBigCost;
     Node *best_node = NULL;
-    for (Node *lnode = lattice->end_nodes(pos);
-         lnode != NULL; lnode = lnode->enext) {
-      if (lnode->prev == NULL) {
-        // Invalid lnode.
-        continue;
-      }
-
-      int cost =
-          lnode->cost + connector.GetTransitionCost(lnode->rid, rnode->lid);
+    const uint16 lid = rnode->lid;
+    const size_t lnodes_size = lnodes->size();
+    for (size_t i = 0; i < lnodes_size; ++i) {
+      const int cost =
+          lnodes->cost[i] + connector.GetTransitionCost(lnodes->rid[i], lid);
       if (cost < best_cost) {
         best_cost = cost;
-        best_node = lnode;
+        best_node = lnodes->node[i];
       }
     }
 
@@ -930,6 +1111,7 @@ inline void ViterbiInternal(
 
 bool ImmutableConverterImpl::Viterbi(
     const Segments &segments, Lattice *lattice) const {
+  MOZC_TRACE_SCOPE("ImmutableConverter::Viterbi");
   const string &key = lattice->key();
 
   // Process BOS.
@@ -960,6 +1142,7 @@ bool ImmutableConverterImpl::Viterbi(
 
   size_t left_boundary = 0;
   const size_t segments_size = segments.segments_size();
+  Lattice::EndNodeTable lnodes;
 
   // Specialization for the first segment.
   // Don't run on the left boundary (the connection with BOS node),
@@ -968,7 +1151,7 @@ bool ImmutableConverterImpl::Viterbi(
     const size_t right_boundary =
         left_boundary + segments.segment(0).key().size();
     for (size_t pos = left_boundary + 1; pos < right_boundary; ++pos) {
-      ViterbiInternal(*connector_, pos, right_boundary, lattice);
+      ViterbiInternal(*connector_, pos, right_boundary, lattice, &lnodes);
     }
     left_boundary = right_boundary;
   }
@@ -979,7 +1162,7 @@ bool ImmutableConverterImpl::Viterbi(
     const size_t right_boundary =
         left_boundary + segments.segment(i).key().size();
     for (size_t pos = left_boundary; pos < right_boundary; ++pos) {
-      ViterbiInternal(*connector_, pos, right_boundary, lattice);
+      ViterbiInternal(*connector_, pos, right_boundary, lattice, &lnodes);
     }
     left_boundary = right_boundary;
   }
@@ -1000,19 +1183,13 @@ bool ImmutableConverterImpl::Viterbi(
     // Find a valid node which connects to the rnode with minimum cost.
     int best_cost = kVeryBigCost;
     Node *best_node = NULL;
-    for (Node *lnode = lattice->end_nodes(key.size());
-         lnode != NULL; lnode = lnode->enext) {
-      if (lnode->prev == NULL) {
-        // Invalid lnode.
-        continue;
-      }
-
-      int cost =
-          lnode->cost +
-          connector_->GetTransitionCost(lnode->rid, eos_node->lid);
+    lattice->GetReachableEndNodes(key.size(), &lnodes);
+    for (size_t i = 0; i < lnodes.size(); ++i) {
+      const int cost = lnodes.cost[i] +
+          connector_->GetTransitionCost(lnodes.rid[i], eos_node->lid);
       if (cost < best_cost) {
         best_cost = cost;
-        best_node = lnode;
+        best_node = lnodes.node[i];
       }
     }
 
@@ -1096,12 +1273,13 @@ void ImmutableConverterImpl::PredictionViterbiInternal(
   // most cases. So, in order to avoid too many allocations for internal
   // nodes of std::map, we use vector of key-value pairs.
   typedef std::vector<std::pair<int, std::pair<int, Node*>>> BestMap;
+  typedef std::vector<std::pair<int, std::pair<int, int>>> CacheMap;
   typedef OrderBy<FirstKey, Less> OrderByFirst;
-  BestMap lbest, rbest;
+  BestMap lbest;
   lbest.reserve(128);
-  rbest.reserve(128);
 
   const std::pair<int, Node*> kInvalidValue(INT_MAX, static_cast<Node*>(NULL));
+  const std::pair<int, int> kInvalidCache(INT_MAX, -1);
 
   for (size_t pos = calc_begin_pos; pos <= calc_end_pos; ++pos) {
     lbest.clear();
@@ -1124,51 +1302,52 @@ void ImmutableConverterImpl::PredictionViterbiInternal(
       continue;
     }
 
-    rbest.clear();
-    Node *rnode_begin = lattice->begin_nodes(pos);
-    for (Node *rnode = rnode_begin; rnode != NULL; rnode = rnode->bnext) {
-      if (rnode->end_pos > calc_end_pos) {
-        continue;
-      }
-      BestMap::value_type key(rnode->lid, kInvalidValue);
-      BestMap::iterator iter =
-          std::lower_bound(rbest.begin(), rbest.end(), key, OrderByFirst());
-      if (iter == rbest.end() || iter->first != rnode->lid) {
-        rbest.insert(iter, key);
+    // The best transitions from the nodes ending at |pos| only depend on
+    // lbest.  When the user types one more character, lbest is unchanged for
+    // most of the positions, so we reuse the transitions computed by the
+    // previous call instead of looking up the connector again.
+    Lattice::ViterbiCache *cache = lattice->mutable_viterbi_cache(pos);
+    if (!IsSameBest(lbest, cache->lbest)) {
+      cache->lbest.clear();
+      for (BestMap::const_iterator liter = lbest.begin();
+           liter != lbest.end(); ++liter) {
+        cache->lbest.push_back(
+            std::make_pair(liter->first, liter->second.first));
       }
+      cache->rbest.clear();
     }
 
-    if (rbest.empty()) {
-      continue;
-    }
-
-    for (BestMap::iterator liter = lbest.begin();
-         liter != lbest.end(); ++liter) {
-      for (BestMap::iterator riter = rbest.begin();
-           riter != rbest.end(); ++riter) {
-        const int cost = liter->second.first +
-            connector_->GetTransitionCost(liter->first, riter->first);
-        if (cost < riter->second.first) {
-          riter->second.first = cost;
-          riter->second.second = liter->second.second;
-        }
-      }
-    }
-
-    for (Node *rnode = rnode_begin; rnode != NULL; rnode = rnode->bnext) {
+    for (Node *rnode = lattice->begin_nodes(pos);
+         rnode != NULL; rnode = rnode->bnext) {
       if (rnode->end_pos > calc_end_pos) {
         continue;
       }
-      BestMap::value_type key(rnode->lid, kInvalidValue);
-      BestMap::iterator iter =
-          std::lower_bound(rbest.begin(), rbest.end(), key, OrderByFirst());
-      if (iter == rbest.end() || iter->first != rnode->lid ||
-          iter->second.second == NULL) {
+      const int lid = rnode->lid;
+      CacheMap::value_type key(lid, kInvalidCache);
+      CacheMap::iterator riter = std::lower_bound(
+          cache->rbest.begin(), cache->rbest.end(), key, OrderByFirst());
+      if (riter == cache->rbest.end() || riter->first != lid) {
+        for (BestMap::const_iterator liter = lbest.begin();
+             liter != lbest.end(); ++liter) {
+          const int cost = liter->second.first +
+              connector_->GetTransitionCost(liter->first, lid);
+          if (cost < key.second.first) {
+            key.second.first = cost;
+            key.second.second = liter->first;
+          }
+        }
+        riter = cache->rbest.insert(riter, key);
+      }
+      if (riter->second.second < 0) {
         continue;
       }
 
-      rnode->cost = iter->second.first + rnode->wcost;
-      rnode->prev = iter->second.second;
+      BestMap::value_type lkey(riter->second.second, kInvalidValue);
+      BestMap::const_iterator liter =
+          std::lower_bound(lbest.begin(), lbest.end(), lkey, OrderByFirst());
+      DCHECK(liter != lbest.end() && liter->first == lkey.first);
+      rnode->cost = riter->second.first + rnode->wcost;
+      rnode->prev = liter->second.second;
     }
   }
 }
@@ -1184,8 +1363,8 @@ class NodeListBuilderForPredictiveNodes : public BaseNodeListBuilder {
 
   virtual ~NodeListBuilderForPredictiveNodes() {}
 
-  virtual ResultType OnToken(StringPiece key, StringPiece actual_key,
-                             const Token &token) {
+  virtual ResultType OnTokenView(StringPiece key, StringPiece actual_key,
+                                 const TokenView &token) {
     Node *node = NewNodeFromToken(token);
     const int kPredictiveNodeDefaultPenalty = 900;  // ~= -500 * log(1/6)
     int additional_cost = kPredictiveNodeDefaultPenalty;
@@ -1231,13 +1410,14 @@ void ImmutableConverterImpl::MakeLatticeNodesForPredictiveNodes(
   for (size_t i = 0; i < segments.conversion_segments_size(); ++i) {
     conversion_key += segments.conversion_segment(i).key();
   }
-  DCHECK_NE(string::npos, key.find(conversion_key));
-  std::vector<string> conversion_key_chars;
-  Util::SplitStringToUtf8Chars(conversion_key, &conversion_key_chars);
+  DCHECK(Util::EndsWith(key, conversion_key));
+  const size_t key_chars_len = lattice->key_chars_len();
+  const size_t conversion_key_chars_len =
+      key_chars_len - lattice->ByteToCharPos(key.size() - conversion_key.size());
 
   // do nothing if the conversion key is short
   const size_t kKeyMinLength = 7;
-  if (conversion_key_chars.size() < kKeyMinLength) {
+  if (conversion_key_chars_len < kKeyMinLength) {
     return;
   }
 
@@ -1246,13 +1426,10 @@ void ImmutableConverterImpl::MakeLatticeNodesForPredictiveNodes(
   {
     const size_t kMaxSuffixLookupKey = 6;
     const size_t max_sufffix_len =
-        std::min(kMaxSuffixLookupKey, conversion_key_chars.size());
-    size_t pos = key.size();
+        std::min(kMaxSuffixLookupKey, conversion_key_chars_len);
 
     for (size_t suffix_len = 1; suffix_len <= max_sufffix_len; ++suffix_len) {
-      pos -= conversion_key_chars[
-          conversion_key_chars.size() - suffix_len].size();
-      DCHECK_GE(key.size(), pos);
+      const size_t pos = lattice->CharToBytePos(key_chars_len - suffix_len);
       NodeListBuilderForPredictiveNodes builder(
           lattice->node_allocator(),
           lattice->node_allocator()->max_nodes_size(),
@@ -1260,7 +1437,7 @@ void ImmutableConverterImpl::MakeLatticeNodesForPredictiveNodes(
       suffix_dictionary_->LookupPredictive(
           StringPiece(key.data() + pos, key.size() - pos), request, &builder);
       if (builder.result() != NULL) {
-        lattice->Insert(pos, builder.result());
+        lattice->InsertWithoutDuplicates(pos, builder.result());
       }
     }
   }
@@ -1271,18 +1448,10 @@ void ImmutableConverterImpl::MakeLatticeNodesForPredictiveNodes(
     const size_t kMinSystemLookupKey = 5;
     const size_t kMaxSystemLookupKey = 8;
     const size_t max_suffix_len =
-        std::min(kMaxSystemLookupKey, conversion_key_chars.size());
-    size_t pos = key.size();
-    for (size_t suffix_len = 1; suffix_len <= max_suffix_len; ++suffix_len) {
-      pos -= conversion_key_chars[
-          conversion_key_chars.size() - suffix_len].size();
-      DCHECK_GE(key.size(), pos);
-
-      if (suffix_len < kMinSystemLookupKey) {
-        // Just update |pos|.
-        continue;
-      }
-
+        std::min(kMaxSystemLookupKey, conversion_key_chars_len);
+    for (size_t suffix_len = kMinSystemLookupKey;
+         suffix_len <= max_suffix_len; ++suffix_len) {
+      const size_t pos = lattice->CharToBytePos(key_chars_len - suffix_len);
       NodeListBuilderForPredictiveNodes builder(
           lattice->node_allocator(),
           lattice->node_allocator()->max_nodes_size(),
@@ -1290,7 +1459,7 @@ void ImmutableConverterImpl::MakeLatticeNodesForPredictiveNodes(
       dictionary_->LookupPredictive(
           StringPiece(key.data() + pos, key.size() - pos), request, &builder);
       if (builder.result() != NULL) {
-        lattice->Insert(pos, builder.result());
+        lattice->InsertWithoutDuplicates(pos, builder.result());
       }
     }
   }
@@ -1299,6 +1468,7 @@ void ImmutableConverterImpl::MakeLatticeNodesForPredictiveNodes(
 bool ImmutableConverterImpl::MakeLattice(
     const ConversionRequest &request,
     Segments *segments, Lattice *lattice) const {
+  MOZC_TRACE_SCOPE("ImmutableConverter::MakeLattice");
   if (segments == NULL) {
     LOG(ERROR) << "Segments is NULL";
     return false;
@@ -1570,13 +1740,28 @@ void ImmutableConverterImpl::MakeLatticeNodesForConversionSegments(
       (segments.request_type() == Segments::CONVERSION);
   // Do not use KeyCorrector if user changes the boundary.
   // http://b/issue?id=2804996
-  std::unique_ptr<KeyCorrector> key_corrector;
+  // The corrector in the workspace keeps the correction of the previous
+  // keystroke, so only the changed tail of |key| is corrected again.
+  std::unique_ptr<KeyCorrector> local_key_corrector;
+  KeyCorrector *key_corrector = NULL;
   if (is_conversion && !segments.resized()) {
     KeyCorrector::InputMode mode = KeyCorrector::ROMAN;
     if (request.config().preedit_method() != config::Config::ROMAN) {
       mode = KeyCorrector::KANA;
     }
-    key_corrector.reset(new KeyCorrector(key, mode, history_key.size()));
+    ConverterWorkspace *workspace = request.workspace();
+    if (workspace != NULL) {
+      if (!workspace->key_corrector_) {
+        workspace->key_corrector_.reset(new KeyCorrector);
+      }
+      key_corrector = workspace->key_corrector_.get();
+    } else {
+      local_key_corrector.reset(new KeyCorrector);
+      key_corrector = local_key_corrector.get();
+    }
+    if (!key_corrector->CorrectKey(key, mode, history_key.size())) {
+      key_corrector = NULL;
+    }
   }
 
   const bool is_reverse =
@@ -1584,28 +1769,94 @@ void ImmutableConverterImpl::MakeLatticeNodesForConversionSegments(
   const bool is_prediction =
       (segments.request_type() == Segments::SUGGESTION ||
        segments.request_type() == Segments::PREDICTION);
-  for (size_t pos = history_key.size(); pos < key.size(); ++pos) {
-    if (lattice->end_nodes(pos) != NULL) {
-      Node *rnode =
-          Lookup(pos, key.size(), request, is_reverse, is_prediction, lattice);
-      // If history key is NOT empty and user input seems to starts with
-      // a particle ("はにで..."), mark the node as STARTS_WITH_PARTICLE.
-      // We change the segment boundary if STARTS_WITH_PARTICLE attribute
-      // is assigned.
-      if (!history_key.empty() && pos == history_key.size()) {
-        for (Node *node = rnode; node != NULL; node = node->bnext) {
-          if (pos_matcher_->IsAcceptableParticleAtBeginOfSegment(node->lid) &&
-              node->lid == node->rid) {  // not a compound.
-            node->attributes |= Node::STARTS_WITH_PARTICLE;
-          }
-        }
+  std::vector<size_t> begin_positions;
+  for (size_t i = lattice->ByteToCharPos(history_key.size());
+       i < lattice->key_chars_len(); ++i) {
+    begin_positions.push_back(lattice->CharToBytePos(i));
+  }
+  if (is_reverse) {
+    // The dictionaries convert |key| once for all the suffixes.
+    std::vector<size_t> looked_up_positions;
+    ConversionSegmentsLookupCallback callback(
+        this, history_key, request, false, lattice, &looked_up_positions);
+    dictionary_->LookupReverseBatch(key, begin_positions, request, &callback);
+    return;
+  }
+
+  // Look up all the suffixes in one batch so that the dictionaries can share
+  // the work for |key| among them.  Then the corrected keys of the looked up
+  // positions are looked up in one batch over the corrected key, instead of
+  // one lookup per position.  As the corrected nodes may make the positions
+  // skipped so far reachable, repeat for them until no position gets
+  // reachable.
+  const bool use_cache = UseLatticeCache(request, is_prediction) ||
+                         UseWorkspaceLattice(request, segments);
+  std::vector<size_t> looked_up_positions;
+  std::vector<size_t> corrected_positions;
+  while (!begin_positions.empty()) {
+    looked_up_positions.clear();
+    ConversionSegmentsLookupCallback callback(
+        this, history_key, request, use_cache, lattice, &looked_up_positions);
+    dictionary_->LookupPrefixBatch(key, begin_positions, request, &callback);
+    if (key_corrector == NULL || request.IsCanceled()) {
+      return;
+    }
+
+    corrected_positions.clear();
+    for (size_t i = 0; i < looked_up_positions.size(); ++i) {
+      size_t length = 0;
+      if (key_corrector->GetCorrectedPrefix(looked_up_positions[i],
+                                            &length) != NULL &&
+          length > 0) {
+        corrected_positions.push_back(
+            key_corrector->GetCorrectedPosition(looked_up_positions[i]));
+      }
+    }
+    if (corrected_positions.empty()) {
+      return;
+    }
+    KeyCorrectedLookupCallback corrected_callback(key_corrector, lattice);
+    dictionary_->LookupPrefixBatch(key_corrector->corrected_key(),
+                                   corrected_positions, request,
+                                   &corrected_callback);
+
+    // Both |begin_positions| and |looked_up_positions| are sorted.
+    std::vector<size_t> skipped_positions;
+    std::set_difference(begin_positions.begin(), begin_positions.end(),
+                        looked_up_positions.begin(),
+                        looked_up_positions.end(),
+                        std::back_inserter(skipped_positions));
+    bool has_reachable_position = false;
+    for (size_t i = 0; i < skipped_positions.size(); ++i) {
+      if (lattice->end_nodes(skipped_positions[i]) != NULL) {
+        has_reachable_position = true;
+        break;
+      }
+    }
+    if (!has_reachable_position) {
+      return;
+    }
+    begin_positions.swap(skipped_positions);
+  }
+}
+
+void ImmutableConverterImpl::InsertConversionSegmentsNodes(
+    size_t pos, const string &history_key, Node *rnode,
+    Lattice *lattice) const {
+  // If history key is NOT empty and user input seems to starts with
+  // a particle ("はにで..."), mark the node as STARTS_WITH_PARTICLE.
+  // We change the segment boundary if STARTS_WITH_PARTICLE attribute
+  // is assigned.
+  if (!history_key.empty() && pos == history_key.size()) {
+    for (Node *node = rnode; node != NULL; node = node->bnext) {
+      if (pos_matcher_->IsAcceptableParticleAtBeginOfSegment(node->lid) &&
+          node->lid == node->rid) {  // not a compound.
+        node->attributes |= Node::STARTS_WITH_PARTICLE;
       }
-      CHECK(rnode != NULL);
-      lattice->Insert(pos, rnode);
-      InsertCorrectedNodes(
-          pos, key, request, key_corrector.get(), dictionary_, lattice);
     }
   }
+  CHECK(rnode != NULL);
+  lattice->InsertWithoutDuplicates(pos, rnode);
 }
 
 void ImmutableConverterImpl::ApplyPrefixSuffixPenalty(
@@ -1667,13 +1918,15 @@ void ImmutableConverterImpl::InsertFirstSegmentToCandidates(
     const Lattice &lattice,
     const std::vector<uint16> &group,
     size_t max_candidates_size,
-    FilterType filter_type) const {
+    FilterType filter_type,
+    const ConversionRequest &request) const {
   const size_t only_first_segment_candidate_pos =
       segments->conversion_segment(0).candidates_size();
   InsertCandidates(segments, lattice, group,
                    max_candidates_size,
                    ONLY_FIRST_SEGMENT,
-                   filter_type);
+                   filter_type,
+                   request);
   // Note that inserted candidates might consume the entire key.
   // e.g. key: "なのは", value: "ナノは"
   // Erase them later.
@@ -1797,7 +2050,8 @@ void ImmutableConverterImpl::InsertCandidates(
     const std::vector<uint16> &group,
     size_t max_candidates_size,
     InsertCandidatesType type,
-    FilterType filter_type) const {
+    FilterType filter_type,
+    const ConversionRequest &request) const {
   // skip HIS_NODE(s)
   Node *prev = lattice.bos_nodes();
   for (Node *node = lattice.bos_nodes()->next;
@@ -1811,15 +2065,28 @@ void ImmutableConverterImpl::InsertCandidates(
                std::min(static_cast<size_t>(512), max_candidates_size));
 
   const bool is_single_segment = (type == SINGLE_SEGMENT);
-  NBestGenerator nbest_generator(
-      suppression_dictionary_, segmenter_, connector_, pos_matcher_,
-      &lattice, suggestion_filter_, (filter_type == DESKTOP));
 
   string original_key;
   for (size_t i = 0; i < segments->conversion_segments_size(); ++i) {
     original_key.append(segments->conversion_segment(i).key());
   }
 
+  // The expansion only reads |lattice| and writes to its own segment, so the
+  // segments can be expanded in parallel if each of them is a new segment,
+  // i.e., for MULTI_SEGMENTS.  Otherwise the expansions may share the last
+  // segment.
+  ThreadPool *pool =
+      (type == MULTI_SEGMENTS) ? GetExpansionThreadPool() : nullptr;
+  std::unique_ptr<NBestGenerator> owned_nbest_generator;
+  NBestGenerator *nbest_generator = nullptr;
+  if (pool == nullptr) {
+    nbest_generator = GetNBestGenerator(lattice, filter_type,
+                                        request.workspace(),
+                                        &owned_nbest_generator);
+  }
+  const Segments::RequestType request_type = segments->request_type();
+
+  std::vector<SegmentExpansion> expansions;
   size_t begin_pos = string::npos;
   for (Node *node = prev->next; node->next != NULL; node = node->next) {
     if (begin_pos == string::npos) {
@@ -1842,17 +2109,14 @@ void ImmutableConverterImpl::InsertCandidates(
       // Boundary is specified. Skip boundary check in nbest generator.
       mode = NBestGenerator::ONLY_MID;
     }
-    nbest_generator.Reset(prev, node->next, mode);
-
-    ExpandCandidates(original_key, &nbest_generator, segment,
-                     segments->request_type(), expand_size);
-
-    if (type == MULTI_SEGMENTS || type == SINGLE_SEGMENT) {
-      InsertDummyCandidates(segment, expand_size);
-    }
-
-    if (node->node_type == Node::CON_NODE) {
-      segment->set_segment_type(Segment::FIXED_VALUE);
+    const SegmentExpansion expansion = {
+      segment, prev, node->next, mode, node->node_type == Node::CON_NODE,
+    };
+    if (nbest_generator != nullptr) {
+      ExpandSegment(expansion, request, original_key, request_type,
+                    expand_size, type, nbest_generator);
+    } else {
+      expansions.push_back(expansion);
     }
 
     if (type == ONLY_FIRST_SEGMENT) {
@@ -1861,6 +2125,82 @@ void ImmutableConverterImpl::InsertCandidates(
     begin_pos = string::npos;
     prev = node;
   }
+
+  if (expansions.empty()) {
+    return;
+  }
+  // Each segment is expanded by its own NBestGenerator, so the result doesn't
+  // depend on the order in which the workers run.  The calling thread expands
+  // the first segment by itself.
+  BlockingCounter done(expansions.size() - 1);
+  for (size_t i = 1; i < expansions.size(); ++i) {
+    const SegmentExpansion *expansion = &expansions[i];
+    pool->Schedule([this, &lattice, &request, &original_key, expansion,
+                    request_type, expand_size, type, filter_type, &done]() {
+      NBestGenerator nbest_generator(
+          suppression_dictionary_, segmenter_, connector_, pos_matcher_,
+          &lattice, suggestion_filter_, (filter_type == DESKTOP));
+      ExpandSegment(*expansion, request, original_key, request_type,
+                    expand_size, type, &nbest_generator);
+      done.DecrementCount();
+    });
+  }
+  {
+    NBestGenerator nbest_generator(
+        suppression_dictionary_, segmenter_, connector_, pos_matcher_,
+        &lattice, suggestion_filter_, (filter_type == DESKTOP));
+    ExpandSegment(expansions[0], request, original_key, request_type,
+                  expand_size, type, &nbest_generator);
+  }
+  done.Wait();
+}
+
+NBestGenerator *ImmutableConverterImpl::GetNBestGenerator(
+    const Lattice &lattice, FilterType filter_type,
+    ConverterWorkspace *workspace,
+    std::unique_ptr<NBestGenerator> *owned_nbest_generator) const {
+  const bool apply_suggestion_filter = (filter_type == DESKTOP);
+  std::unique_ptr<NBestGenerator> *nbest_generator = owned_nbest_generator;
+  if (workspace != NULL) {
+    if (workspace->nbest_generator_ &&
+        workspace->nbest_generator_owner_ == workspace_owner_id_ &&
+        workspace->apply_suggestion_filter_ == apply_suggestion_filter) {
+      workspace->nbest_generator_->set_lattice(&lattice);
+      return workspace->nbest_generator_.get();
+    }
+    workspace->nbest_generator_owner_ = workspace_owner_id_;
+    workspace->apply_suggestion_filter_ = apply_suggestion_filter;
+    nbest_generator = &workspace->nbest_generator_;
+  }
+  nbest_generator->reset(new NBestGenerator(
+      suppression_dictionary_, segmenter_, connector_, pos_matcher_,
+      &lattice, suggestion_filter_, apply_suggestion_filter));
+  return nbest_generator->get();
+}
+
+void ImmutableConverterImpl::ExpandSegment(
+    const SegmentExpansion &expansion, const ConversionRequest &request,
+    const string &original_key,
+    Segments::RequestType request_type, size_t expand_size,
+    InsertCandidatesType type, NBestGenerator *nbest_generator) const {
+  // Always set, as the generator may be reused from a ConverterWorkspace.
+  nbest_generator->set_max_agenda_size(
+      static_cast<size_t>(std::max(0, FLAGS_nbest_max_agenda_size)));
+  nbest_generator->set_conversion_request(&request);
+  nbest_generator->Reset(expansion.begin_node, expansion.end_node,
+                         expansion.mode);
+
+  ExpandCandidates(original_key, nbest_generator, expansion.segment,
+                   request_type, expand_size);
+  nbest_generator->set_conversion_request(nullptr);
+
+  if (type == MULTI_SEGMENTS || type == SINGLE_SEGMENT) {
+    InsertDummyCandidates(expansion.segment, expand_size);
+  }
+
+  if (expansion.is_fixed_value) {
+    expansion.segment->set_segment_type(Segment::FIXED_VALUE);
+  }
 }
 
 bool ImmutableConverterImpl::MakeSegments(const ConversionRequest &request,
@@ -1894,7 +2234,7 @@ bool ImmutableConverterImpl::MakeSegments(const ConversionRequest &request,
            max_candidates_size - kOnlyFirstSegmentCandidateSize : 1);
       InsertCandidates(segments, lattice, group,
                        single_segment_candidates_size, SINGLE_SEGMENT,
-                       filter_type);
+                       filter_type, request);
 
       // Even if single_segment_candidates_size + kOnlyFirstSegmentCandidateSize
       // is greater than max_candidates_size, we cannot skip
@@ -1911,11 +2251,11 @@ bool ImmutableConverterImpl::MakeSegments(const ConversionRequest &request,
                                             kOnlyFirstSegmentCandidateSize);
       InsertFirstSegmentToCandidates(
           segments, lattice, group, only_first_segment_candidates_size,
-          filter_type);
+          filter_type, request);
     } else {
       InsertCandidates(
           segments, lattice, group, max_candidates_size, SINGLE_SEGMENT,
-          filter_type);
+          filter_type, request);
     }
   } else {
     DCHECK(!request.create_partial_candidates());
@@ -1935,7 +2275,7 @@ bool ImmutableConverterImpl::MakeSegments(const ConversionRequest &request,
         segments->conversion_segments_size();
     InsertCandidates(
         segments, lattice, group, max_candidates_size, MULTI_SEGMENTS,
-        filter_type);
+        filter_type, request);
     if (old_conversion_segments_size > 0) {
       segments->erase_segments(segments->history_segments_size(),
                                old_conversion_segments_size);
@@ -1955,21 +2295,56 @@ void ImmutableConverterImpl::MakeGroup(
   group->push_back(static_cast<uint16>(segments.segments_size()));
 }
 
+Lattice *ImmutableConverterImpl::GetWorkspaceLattice(
+    const Segments &segments, ConverterWorkspace *workspace) const {
+  if (!workspace->lattice_) {
+    workspace->lattice_.reset(new Lattice);
+  }
+  Lattice *lattice = workspace->lattice_.get();
+
+  string history_key;
+  string conversion_key;
+  GetHistoryAndConversionKeys(segments, &history_key, &conversion_key);
+  // Only the resize of the segments keeps the lattice, as it doesn't change
+  // the key.  The other conversions, e.g., the one after the user edits the
+  // key, start from an empty lattice.
+  if (!segments.resized() ||
+      workspace->lattice_owner_ != workspace_owner_id_ ||
+      lattice->history_end_pos() != history_key.size() ||
+      lattice->key() != history_key + conversion_key) {
+    lattice->Clear();
+  }
+  workspace->lattice_owner_ = workspace_owner_id_;
+  return lattice;
+}
+
 bool ImmutableConverterImpl::ConvertForRequest(
     const ConversionRequest &request, Segments *segments) const {
+  ScopedAllocationStage allocation_stage(AllocationStats::CONVERTER);
   const bool is_prediction =
       (segments->request_type() == Segments::PREDICTION ||
        segments->request_type() == Segments::SUGGESTION);
 
-  Lattice *lattice = GetLattice(segments, is_prediction);
+  Lattice *lattice = UseWorkspaceLattice(request, *segments)
+                         ? GetWorkspaceLattice(*segments, request.workspace())
+                         : GetLattice(request, segments, is_prediction);
 
   if (!MakeLattice(request, segments, lattice)) {
     LOG(WARNING) << "could not make lattice";
     return false;
   }
+  if (request.IsCanceled()) {
+    // The lattice may lack the nodes of the positions skipped by the
+    // cancellation.
+    VLOG(1) << "conversion is canceled";
+    return false;
+  }
 
-  std::vector<uint16> group;
-  MakeGroup(*segments, &group);
+  std::vector<uint16> local_group;
+  std::vector<uint16> *group = (request.workspace() != NULL)
+                                   ? &request.workspace()->group_
+                                   : &local_group;
+  MakeGroup(*segments, group);
 
   if (is_prediction) {
     if (!PredictionViterbi(*segments, lattice)) {
@@ -1984,7 +2359,7 @@ bool ImmutableConverterImpl::ConvertForRequest(
   }
 
   VLOG(2) << lattice->DebugString();
-  if (!MakeSegments(request, *lattice, group, segments)) {
+  if (!MakeSegments(request, *lattice, *group, segments)) {
     LOG(WARNING) << "make segments failed";
     return false;
   }
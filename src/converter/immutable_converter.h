@@ -30,6 +30,7 @@
 #ifndef MOZC_CONVERTER_IMMUTABLE_CONVERTER_H_
 #define MOZC_CONVERTER_IMMUTABLE_CONVERTER_H_
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -48,6 +49,7 @@
 namespace mozc {
 
 struct Node;
+class ConverterWorkspace;
 class ImmutableConverterInterface;
 class Lattice;
 class NBestGenerator;
@@ -76,6 +78,7 @@ class ImmutableConverterImpl : public ImmutableConverterInterface {
   FRIEND_TEST(ImmutableConverterTest, DummyCandidatesInnerSegmentBoundary);
   FRIEND_TEST(ImmutableConverterTest, NotConnectedTest);
   FRIEND_TEST(ImmutableConverterTest, PredictiveNodesOnlyForConversionKey);
+  FRIEND_TEST(NBestGeneratorTest, BoundedAgenda);
   FRIEND_TEST(NBestGeneratorTest, InnerSegmentBoundary);
   FRIEND_TEST(NBestGeneratorTest, MultiSegmentConnectionTest);
   FRIEND_TEST(NBestGeneratorTest, SingleSegmentConnectionTest);
@@ -108,6 +111,10 @@ class ImmutableConverterImpl : public ImmutableConverterInterface {
                Lattice *lattice) const;
   Node *AddCharacterTypeBasedNodes(const char *begin, const char *end,
                                    Lattice *lattice, Node *nodes) const;
+  // Inserts |rnode|, the nodes looked up at |pos|, to |lattice| for
+  // MakeLatticeNodesForConversionSegments().
+  void InsertConversionSegmentsNodes(size_t pos, const string &history_key,
+                                     Node *rnode, Lattice *lattice) const;
 
   void Resegment(const Segments &segments,
                  const string &history_key, const string &conversion_key,
@@ -124,6 +131,10 @@ class ImmutableConverterImpl : public ImmutableConverterInterface {
   bool MakeLatticeNodesForHistorySegments(
       const Segments &segments, const ConversionRequest &request,
       Lattice *lattice) const;
+  // Drives MakeLatticeNodesForConversionSegments() from
+  // DictionaryInterface::LookupPrefixBatch() and LookupReverseBatch().
+  class ConversionSegmentsLookupCallback;
+
   void MakeLatticeNodesForConversionSegments(
       const Segments &segments, const ConversionRequest &request,
       const string &history_key, Lattice *lattice) const;
@@ -151,14 +162,31 @@ class ImmutableConverterImpl : public ImmutableConverterInterface {
                                       const Lattice &lattice,
                                       const std::vector<uint16> &group,
                                       size_t max_candidates_size,
-                                      FilterType filter_type) const;
+                                      FilterType filter_type,
+                                      const ConversionRequest &request) const;
 
   void InsertCandidates(Segments *segments,
                         const Lattice &lattice,
                         const std::vector<uint16> &group,
                         size_t max_candidates_size,
                         InsertCandidatesType type,
-                        FilterType filter_type) const;
+                        FilterType filter_type,
+                        const ConversionRequest &request) const;
+
+  // Returns the lattice kept in |workspace| for the conversion of |segments|.
+  // The lattice keeps the nodes of the previous conversion if |segments| are
+  // resized from its result.  Otherwise it is cleared.
+  Lattice *GetWorkspaceLattice(const Segments &segments,
+                               ConverterWorkspace *workspace) const;
+
+  // Helper function for InsertCandidates().
+  // Returns the N-best generator cached in |workspace| for |lattice| if any.
+  // Otherwise creates a new one, which is cached in |workspace| or, if
+  // |workspace| is NULL, owned by |owned_nbest_generator|.
+  NBestGenerator *GetNBestGenerator(
+      const Lattice &lattice, FilterType filter_type,
+      ConverterWorkspace *workspace,
+      std::unique_ptr<NBestGenerator> *owned_nbest_generator) const;
 
   // Helper function for InsertCandidates().
   // Returns true if |node| is valid node for segment end.
@@ -176,6 +204,18 @@ class ImmutableConverterImpl : public ImmutableConverterInterface {
                                   const Node *node,
                                   Segments *segments) const;
 
+  // Helper function for InsertCandidates().
+  // Expands the N-best candidates of one segment with |nbest_generator|.
+  // Only reads |this| and the lattice, so it can run on worker threads.
+  // Stops expanding once |request| is canceled.
+  struct SegmentExpansion;
+  void ExpandSegment(const SegmentExpansion &expansion,
+                     const ConversionRequest &request,
+                     const string &original_key,
+                     Segments::RequestType request_type, size_t expand_size,
+                     InsertCandidatesType type,
+                     NBestGenerator *nbest_generator) const;
+
   bool MakeSegments(const ConversionRequest &request,
                     const Lattice &lattice,
                     const std::vector<uint16> &group,
@@ -209,6 +249,9 @@ class ImmutableConverterImpl : public ImmutableConverterInterface {
   // Cache for transition cost.
   const int32 last_to_first_name_transition_cost_;
 
+  // Identifies this converter in ConverterWorkspace.
+  const uint64 workspace_owner_id_;
+
   DISALLOW_COPY_AND_ASSIGN(ImmutableConverterImpl);
 };
 
@@ -34,6 +34,7 @@
 #include <utility>
 #include <vector>
 
+#include "base/flags.h"
 #include "base/logging.h"
 #include "base/port.h"
 #include "base/string_piece.h"
@@ -41,6 +42,7 @@
 #include "base/util.h"
 #include "config/config_handler.h"
 #include "converter/connector.h"
+#include "converter/converter_workspace.h"
 #include "converter/lattice.h"
 #include "converter/segmenter.h"
 #include "converter/segments.h"
@@ -60,6 +62,8 @@
 #include "testing/base/public/googletest.h"
 #include "testing/base/public/gunit.h"
 
+DECLARE_int32(immutable_converter_expansion_threads);
+
 namespace mozc {
 namespace {
 
@@ -193,6 +197,247 @@ TEST(ImmutableConverterTest, KeepKeyForPrediction) {
   EXPECT_EQ(kRequestKey, segments.segment(0).key());
 }
 
+TEST(ImmutableConverterTest, IncrementalPredictionViterbi) {
+  // Typing the key character by character reuses the cached lattice and the
+  // Viterbi memo.  The result should be the same as the one from scratch.
+  std::unique_ptr<MockDataAndImmutableConverter> data_and_converter(
+      new MockDataAndImmutableConverter);
+  const string kRequestKey = "わたしのなまえはなかのです";
+  const size_t key_len = Util::CharsLen(kRequestKey);
+
+  Segments incremental;
+  incremental.set_request_type(Segments::PREDICTION);
+  incremental.set_max_prediction_candidates_size(10);
+  Segment *segment = incremental.add_segment();
+  for (size_t len = 1; len <= key_len; ++len) {
+    segment->clear_candidates();
+    segment->set_key(Util::SubString(kRequestKey, 0, len));
+    EXPECT_TRUE(data_and_converter->GetConverter()->Convert(&incremental));
+  }
+
+  Segments scratch;
+  scratch.set_request_type(Segments::PREDICTION);
+  scratch.set_max_prediction_candidates_size(10);
+  scratch.add_segment()->set_key(kRequestKey);
+  EXPECT_TRUE(data_and_converter->GetConverter()->Convert(&scratch));
+
+  ASSERT_EQ(1, incremental.conversion_segments_size());
+  ASSERT_EQ(1, scratch.conversion_segments_size());
+  const Segment &actual = incremental.conversion_segment(0);
+  const Segment &expected = scratch.conversion_segment(0);
+  ASSERT_EQ(expected.candidates_size(), actual.candidates_size());
+  for (size_t i = 0; i < expected.candidates_size(); ++i) {
+    EXPECT_EQ(expected.candidate(i).value, actual.candidate(i).value);
+    EXPECT_EQ(expected.candidate(i).cost, actual.candidate(i).cost);
+  }
+}
+
+TEST(ImmutableConverterTest, ParallelSegmentExpansion) {
+  // Expanding the segments on worker threads should give the same result as
+  // the sequential expansion.
+  std::unique_ptr<MockDataAndImmutableConverter> data_and_converter(
+      new MockDataAndImmutableConverter);
+  const string kRequestKey = "わたしのなまえはなかのです";
+
+  Segments sequential;
+  sequential.set_request_type(Segments::CONVERSION);
+  sequential.add_segment()->set_key(kRequestKey);
+  EXPECT_TRUE(data_and_converter->GetConverter()->Convert(&sequential));
+
+  FLAGS_immutable_converter_expansion_threads = 2;
+  Segments parallel;
+  parallel.set_request_type(Segments::CONVERSION);
+  parallel.add_segment()->set_key(kRequestKey);
+  EXPECT_TRUE(data_and_converter->GetConverter()->Convert(&parallel));
+  FLAGS_immutable_converter_expansion_threads = 0;
+
+  ASSERT_LT(1, sequential.conversion_segments_size());
+  ASSERT_EQ(sequential.conversion_segments_size(),
+            parallel.conversion_segments_size());
+  for (size_t i = 0; i < sequential.conversion_segments_size(); ++i) {
+    const Segment &expected = sequential.conversion_segment(i);
+    const Segment &actual = parallel.conversion_segment(i);
+    EXPECT_EQ(expected.key(), actual.key());
+    EXPECT_EQ(expected.segment_type(), actual.segment_type());
+    ASSERT_EQ(expected.candidates_size(), actual.candidates_size());
+    for (size_t j = 0; j < expected.candidates_size(); ++j) {
+      EXPECT_EQ(expected.candidate(j).value, actual.candidate(j).value);
+      EXPECT_EQ(expected.candidate(j).cost, actual.candidate(j).cost);
+    }
+  }
+}
+
+TEST(ImmutableConverterTest, ReuseWorkspace) {
+  // Conversions sharing a workspace should give the same results as the ones
+  // allocating their buffers every time.
+  std::unique_ptr<MockDataAndImmutableConverter> data_and_converter(
+      new MockDataAndImmutableConverter);
+  ImmutableConverterImpl *converter = data_and_converter->GetConverter();
+  const char *kRequestKeys[] = {
+    "わたしのなまえはなかのです",
+    "わたしの",
+    "なかのです",
+  };
+  const Segments::RequestType kRequestTypes[] = {
+    Segments::CONVERSION,
+    Segments::PREDICTION,
+  };
+
+  ConverterWorkspace workspace;
+  ConversionRequest request_with_workspace;
+  request_with_workspace.set_workspace(&workspace);
+  const ConversionRequest request;
+  for (size_t i = 0; i < arraysize(kRequestTypes); ++i) {
+    for (size_t j = 0; j < arraysize(kRequestKeys); ++j) {
+      Segments expected;
+      expected.set_request_type(kRequestTypes[i]);
+      expected.add_segment()->set_key(kRequestKeys[j]);
+      EXPECT_TRUE(converter->ConvertForRequest(request, &expected));
+
+      Segments actual;
+      actual.set_request_type(kRequestTypes[i]);
+      actual.add_segment()->set_key(kRequestKeys[j]);
+      EXPECT_TRUE(converter->ConvertForRequest(request_with_workspace,
+                                               &actual));
+
+      ASSERT_EQ(expected.conversion_segments_size(),
+                actual.conversion_segments_size());
+      for (size_t k = 0; k < expected.conversion_segments_size(); ++k) {
+        const Segment &expected_segment = expected.conversion_segment(k);
+        const Segment &actual_segment = actual.conversion_segment(k);
+        EXPECT_EQ(expected_segment.key(), actual_segment.key());
+        ASSERT_EQ(expected_segment.candidates_size(),
+                  actual_segment.candidates_size());
+        for (size_t l = 0; l < expected_segment.candidates_size(); ++l) {
+          EXPECT_EQ(expected_segment.candidate(l).value,
+                    actual_segment.candidate(l).value);
+          EXPECT_EQ(expected_segment.candidate(l).cost,
+                    actual_segment.candidate(l).cost);
+        }
+      }
+    }
+  }
+
+  // Clear() releases the buffers, and the workspace is usable after that.
+  workspace.Clear();
+  Segments segments;
+  segments.set_request_type(Segments::CONVERSION);
+  segments.add_segment()->set_key(kRequestKeys[0]);
+  EXPECT_TRUE(converter->ConvertForRequest(request_with_workspace,
+                                           &segments));
+  EXPECT_LT(0, segments.conversion_segments_size());
+}
+
+TEST(ImmutableConverterTest, ResizeWithWorkspace) {
+  // Resizing the segments reuses the lattice kept in the workspace, which
+  // should give the same results as building the lattice again.
+  std::unique_ptr<MockDataAndImmutableConverter> data_and_converter(
+      new MockDataAndImmutableConverter);
+  ImmutableConverterImpl *converter = data_and_converter->GetConverter();
+  ConverterWorkspace workspace;
+  ConversionRequest request_with_workspace;
+  request_with_workspace.set_workspace(&workspace);
+  const ConversionRequest request;
+
+  Segments segments;
+  segments.set_request_type(Segments::CONVERSION);
+  segments.add_segment()->set_key("わたしのなまえはなかのです");
+  EXPECT_TRUE(converter->ConvertForRequest(request_with_workspace,
+                                           &segments));
+
+  const char *kResizedKeys[][2] = {
+    {"わたしの", "なまえはなかのです"},
+    {"わたしのな", "まえはなかのです"},
+    {"わた", "しのなまえはなかのです"},
+  };
+  for (size_t i = 0; i < arraysize(kResizedKeys); ++i) {
+    // Resized in the same way as ConverterImpl::ResizeSegment().
+    Segments expected;
+    Segments actual;
+    for (Segments *resized : {&expected, &actual}) {
+      resized->set_request_type(Segments::CONVERSION);
+      resized->set_resized(true);
+      Segment *segment = resized->add_segment();
+      segment->set_segment_type(Segment::FIXED_BOUNDARY);
+      segment->set_key(kResizedKeys[i][0]);
+      segment = resized->add_segment();
+      segment->set_segment_type(Segment::FREE);
+      segment->set_key(kResizedKeys[i][1]);
+    }
+    EXPECT_TRUE(converter->ConvertForRequest(request, &expected));
+    EXPECT_TRUE(converter->ConvertForRequest(request_with_workspace, &actual));
+
+    ASSERT_EQ(expected.conversion_segments_size(),
+              actual.conversion_segments_size());
+    for (size_t j = 0; j < expected.conversion_segments_size(); ++j) {
+      const Segment &expected_segment = expected.conversion_segment(j);
+      const Segment &actual_segment = actual.conversion_segment(j);
+      EXPECT_EQ(expected_segment.key(), actual_segment.key());
+      ASSERT_EQ(expected_segment.candidates_size(),
+                actual_segment.candidates_size());
+      for (size_t k = 0; k < expected_segment.candidates_size(); ++k) {
+        EXPECT_EQ(expected_segment.candidate(k).value,
+                  actual_segment.candidate(k).value);
+        EXPECT_EQ(expected_segment.candidate(k).cost,
+                  actual_segment.candidate(k).cost);
+      }
+    }
+  }
+}
+
+TEST(ImmutableConverterTest, ShareLatticeBetweenConversionAndPrediction) {
+  // A conversion and a prediction of the same key sharing a lattice should
+  // give the same results as the ones building their own lattices.
+  std::unique_ptr<MockDataAndImmutableConverter> data_and_converter(
+      new MockDataAndImmutableConverter);
+  ImmutableConverterImpl *converter = data_and_converter->GetConverter();
+  const string kRequestKey = "わたしのなまえはなかのです";
+
+  Segments expected_conversion;
+  expected_conversion.set_request_type(Segments::CONVERSION);
+  expected_conversion.add_segment()->set_key(kRequestKey);
+  EXPECT_TRUE(converter->Convert(&expected_conversion));
+  Segments expected_prediction;
+  expected_prediction.set_request_type(Segments::PREDICTION);
+  expected_prediction.set_max_prediction_candidates_size(10);
+  expected_prediction.add_segment()->set_key(kRequestKey);
+  EXPECT_TRUE(converter->Convert(&expected_prediction));
+
+  Lattice lattice;
+  ConversionRequest request;
+  request.set_lattice(&lattice);
+  Segments actual_conversion;
+  actual_conversion.set_request_type(Segments::CONVERSION);
+  actual_conversion.add_segment()->set_key(kRequestKey);
+  EXPECT_TRUE(converter->ConvertForRequest(request, &actual_conversion));
+  Segments actual_prediction;
+  actual_prediction.set_request_type(Segments::PREDICTION);
+  actual_prediction.set_max_prediction_candidates_size(10);
+  actual_prediction.add_segment()->set_key(kRequestKey);
+  EXPECT_TRUE(converter->ConvertForRequest(request, &actual_prediction));
+  EXPECT_EQ(kRequestKey, lattice.key());
+
+  const Segments *expected[] = {&expected_conversion, &expected_prediction};
+  const Segments *actual[] = {&actual_conversion, &actual_prediction};
+  for (size_t i = 0; i < arraysize(expected); ++i) {
+    ASSERT_EQ(expected[i]->conversion_segments_size(),
+              actual[i]->conversion_segments_size());
+    for (size_t j = 0; j < expected[i]->conversion_segments_size(); ++j) {
+      const Segment &expected_segment = expected[i]->conversion_segment(j);
+      const Segment &actual_segment = actual[i]->conversion_segment(j);
+      EXPECT_EQ(expected_segment.key(), actual_segment.key());
+      ASSERT_EQ(expected_segment.candidates_size(),
+                actual_segment.candidates_size());
+      for (size_t k = 0; k < expected_segment.candidates_size(); ++k) {
+        EXPECT_EQ(expected_segment.candidate(k).value,
+                  actual_segment.candidate(k).value);
+        EXPECT_EQ(expected_segment.candidate(k).cost,
+                  actual_segment.candidate(k).cost);
+      }
+    }
+  }
+}
+
 TEST(ImmutableConverterTest, DummyCandidatesCost) {
   std::unique_ptr<MockDataAndImmutableConverter> data_and_converter(
       new MockDataAndImmutableConverter);
@@ -29,6 +29,7 @@
 
 #include "converter/key_corrector.h"
 
+#include <algorithm>
 #include <cstring>
 
 #include "base/logging.h"
@@ -45,6 +46,10 @@ const size_t kMaxSize = 128;
 // invalid alignment marker
 const size_t kInvalidPos = static_cast<size_t>(-1);
 
+// The maximum number of characters the rewrite rules below look at from the
+// beginning of a rewrite step ("([^ん])んん." and "([^っ])っっ([^っ])").
+const size_t kMaxLookaheadChars = 4;
+
 // "ん" (few "n" pettern)
 // "んあ" -> "んな"
 // "んい" -> "んに"
@@ -368,12 +373,12 @@ bool RewriteYu(size_t key_pos,
 
 KeyCorrector::KeyCorrector(const string &key, InputMode mode,
                            size_t history_size)
-    : available_(false), mode_(mode) {
+    : available_(false), mode_(mode), history_size_(0) {
   CorrectKey(key, mode, history_size);
 }
 
 KeyCorrector::KeyCorrector()
-    : available_(false), mode_(ROMAN) {}
+    : available_(false), mode_(ROMAN), history_size_(0) {}
 
 KeyCorrector::~KeyCorrector() {}
 
@@ -414,11 +419,61 @@ void KeyCorrector::Clear() {
   corrected_key_.clear();
   alignment_.clear();
   rev_alignment_.clear();
+  step_begins_.clear();
+}
+
+size_t KeyCorrector::GetReusableStepsSize(const string &key, InputMode mode,
+                                          size_t history_size) const {
+  if (!available_ || mode != mode_ || history_size != history_size_) {
+    return 0;
+  }
+  const size_t max_common_size = std::min(original_key_.size(), key.size());
+  size_t common_size = 0;
+  while (common_size < max_common_size &&
+         original_key_[common_size] == key[common_size]) {
+    ++common_size;
+  }
+
+  // A step is reusable if all the characters it may look at are in the common
+  // prefix.  The steps before a reusable step are reusable too.
+  const char *end = original_key_.data() + original_key_.size();
+  for (size_t i = step_begins_.size(); i > 0; --i) {
+    const char *window_end = original_key_.data() + step_begins_[i - 1];
+    size_t chars = 0;
+    while (chars < kMaxLookaheadChars && window_end < end) {
+      window_end += Util::OneCharLen(window_end);
+      ++chars;
+    }
+    if (chars == kMaxLookaheadChars &&
+        window_end - original_key_.data() <= common_size) {
+      return i;
+    }
+  }
+  return 0;
 }
 
 bool KeyCorrector::CorrectKey(const string &key, InputMode mode,
                               size_t history_size) {
-  Clear();
+  const size_t reusable_steps_size =
+      GetReusableStepsSize(key, mode, history_size);
+  if (reusable_steps_size == 0) {
+    Clear();
+  } else {
+    // Resume from the first step which can be affected by the change.
+    const bool all_steps_reusable =
+        reusable_steps_size == step_begins_.size();
+    const size_t begin_pos = all_steps_reusable ?
+        alignment_.size() : step_begins_[reusable_steps_size];
+    const size_t corrected_begin_pos = all_steps_reusable ?
+        corrected_key_.size() : alignment_[begin_pos];
+    available_ = false;
+    corrected_key_.resize(corrected_begin_pos);
+    alignment_.resize(begin_pos);
+    rev_alignment_.resize(corrected_begin_pos);
+    step_begins_.resize(reusable_steps_size);
+  }
+  mode_ = mode;
+  history_size_ = history_size;
 
   // TOOD(taku)  support KANA
   if (mode == KANA) {
@@ -427,19 +482,21 @@ bool KeyCorrector::CorrectKey(const string &key, InputMode mode,
 
   if (key.size() == 0 || key.size() >= kMaxSize) {
     VLOG(1) << "invalid key length";
+    Clear();
     return false;
   }
 
   original_key_ = key;
 
-  const char *begin = key.data();
+  const char *begin = key.data() + alignment_.size();
   const char *end = key.data() + key.size();
   const char *input_begin = key.data() + history_size;
-  size_t key_pos = 0;
+  size_t key_pos = step_begins_.size();
 
   while (begin < end) {
     size_t mblen = 0;
     const size_t org_len = corrected_key_.size();
+    step_begins_.push_back(static_cast<size_t>(begin - key.data()));
     if (begin < input_begin ||
         (!RewriteDoubleNN(key_pos, begin, end, &mblen, &corrected_key_) &&
          !RewriteNN(key_pos, begin, end, &mblen, &corrected_key_) &&
@@ -50,6 +50,9 @@ class KeyCorrector {
 
   InputMode mode() const;
 
+  // Corrects |key|.  When |key| extends the key of the preceding call, e.g.,
+  // on the next keystroke, the correction of the common prefix is reused and
+  // only the rest is corrected again.  The buffers are reused as well.
   bool CorrectKey(const string &key, InputMode mode, size_t history_size);
 
   // return corrected key;
@@ -152,12 +155,20 @@ class KeyCorrector {
   void Clear();
 
  private:
+  // Returns the number of the leading rewrite steps of the preceding
+  // correction which are not affected by the change to |key|.
+  size_t GetReusableStepsSize(const string &key, InputMode mode,
+                              size_t history_size) const;
+
   bool available_;
   InputMode mode_;
+  size_t history_size_;
   string corrected_key_;
   string original_key_;
   std::vector<size_t> alignment_;
   std::vector<size_t> rev_alignment_;
+  // The positions in |original_key_| where each rewrite step begins.
+  std::vector<size_t> step_begins_;
 
   DISALLOW_COPY_AND_ASSIGN(KeyCorrector);
 };
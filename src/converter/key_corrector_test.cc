@@ -32,6 +32,7 @@
 #include <string>
 
 #include "base/port.h"
+#include "base/util.h"
 #include "testing/base/public/gunit.h"
 
 namespace mozc {
@@ -538,5 +539,53 @@ TEST(KeyCorrectorTest, Bug3046266Test) {
   }
 }
 
+void ExpectKeyCorrectorEqual(const KeyCorrector &expected,
+                             const KeyCorrector &actual) {
+  ASSERT_EQ(expected.IsAvailable(), actual.IsAvailable());
+  EXPECT_EQ(expected.original_key(), actual.original_key());
+  EXPECT_EQ(expected.corrected_key(), actual.corrected_key());
+  for (size_t i = 0; i <= expected.original_key().size(); ++i) {
+    EXPECT_EQ(expected.GetCorrectedPosition(i),
+              actual.GetCorrectedPosition(i)) << i;
+  }
+  for (size_t i = 0; i <= expected.corrected_key().size(); ++i) {
+    EXPECT_EQ(expected.GetOriginalPosition(i),
+              actual.GetOriginalPosition(i)) << i;
+  }
+}
+
+TEST(KeyCorrectorTest, IncrementalCorrection) {
+  const char *kKeys[] = {
+    "みんあであそぼう",
+    "せかいじゅのはっぱ",
+    "きっってかんんあいしゅみ",
+    "かんんしゃにゃんんこ",
+    "しんぶmばっっかり",
+  };
+  for (size_t history_size = 0; history_size <= 6; history_size += 6) {
+    for (size_t i = 0; i < arraysize(kKeys); ++i) {
+      const string key = kKeys[i];
+      KeyCorrector incremental;
+      // Type the key character by character.
+      for (size_t len = Util::OneCharLen(key.data()); len <= key.size();
+           len += len < key.size() ? Util::OneCharLen(key.data() + len) : 1) {
+        const string prefix = key.substr(0, len);
+        SCOPED_TRACE(prefix);
+        incremental.CorrectKey(prefix, KeyCorrector::ROMAN, history_size);
+        const KeyCorrector expected(prefix, KeyCorrector::ROMAN,
+                                    history_size);
+        ExpectKeyCorrectorEqual(expected, incremental);
+      }
+      // Replace the tail.
+      const string replaced = key.substr(0, 9) + "んあ";
+      SCOPED_TRACE(replaced);
+      incremental.CorrectKey(replaced, KeyCorrector::ROMAN, history_size);
+      const KeyCorrector expected(replaced, KeyCorrector::ROMAN,
+                                  history_size);
+      ExpectKeyCorrectorEqual(expected, incremental);
+    }
+  }
+}
+
 }  // namespace
 }  // namespace mozc
@@ -34,6 +34,7 @@
 #include <string>
 #include <vector>
 
+#include "base/hash.h"
 #include "base/logging.h"
 #include "base/port.h"
 #include "base/singleton.h"
@@ -119,19 +120,29 @@ string GetDebugStringForPath(const Node *end_node) {
   return os.str();
 }
 
-string GetCommonPrefix(const string &str1, const string &str2) {
-  std::vector<string> split1, split2;
-  Util::SplitStringToUtf8Chars(str1, &split1);
-  Util::SplitStringToUtf8Chars(str2, &split2);
-  string common_prefix = "";
-  for (int i = 0; i < std::min(split1.size(), split2.size()); ++i) {
-    if (split1[i] == split2[i]) {
-      common_prefix += split1[i];
-    } else {
-      break;
-    }
-  }
-  return common_prefix;
+// Attributes telling which dictionaries have the word, which are merged into
+// the node kept by InsertWithoutDuplicates().  The other attributes have to
+// be the same for the nodes to be duplicates.
+const uint32 kDictionaryAttributes = Node::SYSTEM_DICTIONARY |
+                                     Node::USER_DICTIONARY |
+                                     Node::NO_VARIANTS_EXPANSION;
+
+bool CanBeDuplicate(const Node &node) {
+  return node.node_type == Node::NOR_NODE && node.constrained_prev == NULL;
+}
+
+uint64 GetNodeFingerprint(const Node &node) {
+  const uint32 seed = (static_cast<uint32>(node.lid) << 16) | node.rid;
+  return Hash::FingerprintWithSeed(
+      node.value, Hash::Fingerprint32WithSeed(node.key, seed));
+}
+
+bool IsDuplicate(const Node &lhs, const Node &rhs) {
+  return lhs.lid == rhs.lid && lhs.rid == rhs.rid &&
+         (lhs.attributes & ~kDictionaryAttributes) ==
+             (rhs.attributes & ~kDictionaryAttributes) &&
+         lhs.key == rhs.key && lhs.value == rhs.value &&
+         lhs.actual_key == rhs.actual_key;
 }
 
 }  // namespace
@@ -142,7 +153,9 @@ struct LatticeDisplayNodeInfo {
   string display_node_str_;
 };
 
-Lattice::Lattice() : history_end_pos_(0), node_allocator_(new NodeAllocator) {}
+Lattice::Lattice() : history_end_pos_(0), node_allocator_(new NodeAllocator) {
+  BuildCharIndex();
+}
 
 Lattice::~Lattice() {}
 
@@ -169,6 +182,7 @@ void Lattice::SetKey(StringPiece key) {
   begin_nodes_.resize(size + 4);
   end_nodes_.resize(size + 4);
   cache_info_.resize(size + 4);
+  viterbi_cache_.resize(size + 4);
 
   std::fill(begin_nodes_.begin(), begin_nodes_.end(),
             static_cast<Node *>(NULL));
@@ -179,6 +193,37 @@ void Lattice::SetKey(StringPiece key) {
                               static_cast<uint16>(0));
   begin_nodes_[key_.size()] =
       InitEOSNode(this, static_cast<uint16>(key_.size()));
+  BuildCharIndex();
+}
+
+void Lattice::BuildCharIndex() {
+  char_offsets_.clear();
+  byte_to_char_.resize(key_.size() + 1);
+  size_t pos = 0;
+  while (pos < key_.size()) {
+    const size_t next =
+        std::min(pos + Util::OneCharLen(key_.data() + pos), key_.size());
+    std::fill(byte_to_char_.begin() + pos, byte_to_char_.begin() + next,
+              char_offsets_.size());
+    char_offsets_.push_back(pos);
+    pos = next;
+  }
+  byte_to_char_[key_.size()] = char_offsets_.size();
+  char_offsets_.push_back(key_.size());
+}
+
+size_t Lattice::key_chars_len() const {
+  return char_offsets_.size() - 1;
+}
+
+size_t Lattice::CharToBytePos(size_t char_pos) const {
+  DCHECK_LT(char_pos, char_offsets_.size());
+  return char_offsets_[char_pos];
+}
+
+size_t Lattice::ByteToCharPos(size_t byte_pos) const {
+  DCHECK_LT(byte_pos, byte_to_char_.size());
+  return byte_to_char_[byte_pos];
 }
 
 Node *Lattice::bos_nodes() const {
@@ -189,6 +234,18 @@ Node *Lattice::eos_nodes() const {
   return begin_nodes_[key_.size()];
 }
 
+void Lattice::GetReachableEndNodes(size_t pos, EndNodeTable *table) const {
+  table->clear();
+  for (Node *lnode = end_nodes_[pos]; lnode != NULL; lnode = lnode->enext) {
+    if (lnode->prev == NULL) {
+      continue;
+    }
+    table->rid.push_back(lnode->rid);
+    table->cost.push_back(lnode->cost);
+    table->node.push_back(lnode);
+  }
+}
+
 void Lattice::Insert(size_t pos, Node *node) {
   for (Node *rnode = node; rnode != NULL; rnode = rnode->bnext) {
     const size_t end_pos = std::min(rnode->key.size() + pos, key_.size());
@@ -214,6 +271,45 @@ void Lattice::Insert(size_t pos, Node *node) {
   }
 }
 
+void Lattice::InsertWithoutDuplicates(size_t pos, Node *node) {
+  unique_nodes_.clear();
+  for (Node *rnode = begin_nodes_[pos]; rnode != NULL; rnode = rnode->bnext) {
+    if (CanBeDuplicate(*rnode)) {
+      unique_nodes_.emplace(GetNodeFingerprint(*rnode), rnode);
+    }
+  }
+
+  Node *head = NULL;
+  Node **tail = &head;
+  for (Node *rnode = node; rnode != NULL;) {
+    Node *next = rnode->bnext;
+    Node *kept = NULL;
+    if (CanBeDuplicate(*rnode)) {
+      const auto result =
+          unique_nodes_.emplace(GetNodeFingerprint(*rnode), rnode);
+      if (!result.second && IsDuplicate(*result.first->second, *rnode)) {
+        kept = result.first->second;
+      }
+    }
+    if (kept == NULL) {
+      *tail = rnode;
+      tail = &rnode->bnext;
+    } else {
+      kept->attributes |= rnode->attributes & kDictionaryAttributes;
+      if (rnode->wcost < kept->wcost) {
+        kept->wcost = rnode->wcost;
+        kept->raw_wcost = rnode->raw_wcost;
+      }
+    }
+    rnode = next;
+  }
+  *tail = NULL;
+
+  if (head != NULL) {
+    Insert(pos, head);
+  }
+}
+
 const string &Lattice::key() const {
   return key_;
 }
@@ -228,7 +324,9 @@ void Lattice::Clear() {
   end_nodes_.clear();
   node_allocator_->Free();
   cache_info_.clear();
+  viterbi_cache_.clear();
   history_end_pos_ = 0;
+  BuildCharIndex();
 }
 
 void Lattice::SetDebugDisplayNode(size_t begin_pos, size_t end_pos,
@@ -253,11 +351,18 @@ size_t Lattice::history_end_pos() const {
 }
 
 void Lattice::UpdateKey(const string &new_key) {
-  const string old_key = key_;
-  const string common_prefix = GetCommonPrefix(new_key, old_key);
+  // The common prefix of the bytes, cut at the last character boundary of
+  // the current key.
+  const size_t max_prefix_size = std::min(new_key.size(), key_.size());
+  size_t common_prefix_size = 0;
+  while (common_prefix_size < max_prefix_size &&
+         new_key[common_prefix_size] == key_[common_prefix_size]) {
+    ++common_prefix_size;
+  }
+  common_prefix_size = CharToBytePos(ByteToCharPos(common_prefix_size));
 
   // if the length of common prefix is too short, call SetKey
-  if (common_prefix.size() <= old_key.size() / 2) {
+  if (common_prefix_size <= key_.size() / 2) {
     SetKey(new_key);
     return;
   }
@@ -270,9 +375,9 @@ void Lattice::UpdateKey(const string &new_key) {
   }
 
   // erase the suffix of old_key so that the key becomes common_prefix
-  ShrinkKey(common_prefix.size());
+  ShrinkKey(common_prefix_size);
   // add a suffix so that the key becomes new_key
-  AddSuffix(new_key.substr(common_prefix.size()));
+  AddSuffix(new_key.substr(common_prefix_size));
 }
 
 void Lattice::AddSuffix(const string &suffix_key) {
@@ -298,9 +403,11 @@ void Lattice::AddSuffix(const string &suffix_key) {
 
   // update cache_info
   cache_info_.resize(new_size + 4, 0);
+  viterbi_cache_.resize(new_size + 4);
 
   // update key
   key_ += suffix_key;
+  BuildCharIndex();
 }
 
 void Lattice::ShrinkKey(const size_t new_len) {
@@ -347,9 +454,14 @@ void Lattice::ShrinkKey(const size_t new_len) {
     cache_info_[i] = std::min(cache_info_[i], new_len - i);
   }
   std::fill(cache_info_.begin() + new_len, cache_info_.end(), 0);
+  for (size_t i = new_len; i < viterbi_cache_.size(); ++i) {
+    viterbi_cache_[i].lbest.clear();
+    viterbi_cache_[i].rbest.clear();
+  }
 
   // update key
   key_.erase(new_len);
+  BuildCharIndex();
 }
 
 size_t Lattice::cache_info(const size_t pos) const {
@@ -362,61 +474,35 @@ void Lattice::SetCacheInfo(const size_t pos, const size_t len) {
   cache_info_[pos] = len;
 }
 
+Lattice::ViterbiCache *Lattice::mutable_viterbi_cache(size_t pos) {
+  CHECK_LE(pos, key_.size());
+  return &viterbi_cache_[pos];
+}
+
 void Lattice::ResetNodeCost() {
+  // If the node has ENABLE_CACHE attribute, then revert its wcost.
+  // Otherwise, erase the node from the lattice, so that the nodes added only
+  // for a particular request, e.g., key corrected nodes of conversion, don't
+  // remain for the next one.  BOS / EOS nodes are kept as is.
   for (size_t i = 0; i <= key_.size(); ++i) {
-    if (begin_nodes_[i] != NULL) {
-      Node *prev = NULL;
-      for (Node *node = begin_nodes_[i]; node != NULL; node = node->bnext) {
-        // do not process BOS / EOS nodes
-        if (node->node_type == Node::BOS_NODE ||
-            node->node_type == Node::EOS_NODE) {
-          continue;
-        }
-        // if the node has ENABLE_CACHE attribute, then revert its wcost.
-        // Otherwise, erase the node from the lattice.
-        if (node->attributes & Node::ENABLE_CACHE) {
-          node->wcost = node->raw_wcost;
-        } else {
-          if (node == begin_nodes_[i]) {
-            if (node->bnext == NULL) {
-              begin_nodes_[i] = NULL;
-            } else {
-              begin_nodes_[i] = node->bnext;
-            }
-          } else {
-            CHECK(prev);
-            CHECK_EQ(prev->bnext, node);
-            prev->next = node->bnext;
-          }
-        }
-        // traverse a next node
-        prev = node;
+    for (Node **node = &begin_nodes_[i]; *node != NULL; ) {
+      if ((*node)->node_type == Node::BOS_NODE ||
+          (*node)->node_type == Node::EOS_NODE) {
+        node = &(*node)->bnext;
+      } else if ((*node)->attributes & Node::ENABLE_CACHE) {
+        (*node)->wcost = (*node)->raw_wcost;
+        node = &(*node)->bnext;
+      } else {
+        *node = (*node)->bnext;
       }
     }
-
-    if (end_nodes_[i] != NULL) {
-      Node *prev = NULL;
-      for (Node *node = end_nodes_[i]; node != NULL; node = node->enext) {
-        if (node->node_type == Node::BOS_NODE ||
-            node->node_type == Node::EOS_NODE) {
-          continue;
-        }
-        if (node->attributes & Node::ENABLE_CACHE) {
-          node->wcost = node->raw_wcost;
-        } else {
-          if (node == end_nodes_[i]) {
-            if (node->enext == NULL) {
-              end_nodes_[i] = NULL;
-            } else {
-              end_nodes_[i] = node->enext;
-            }
-          } else {
-            CHECK(prev);
-            CHECK_EQ(prev->enext, node);
-            prev->next = node->enext;
-          }
-        }
-        prev = node;
+    for (Node **node = &end_nodes_[i]; *node != NULL; ) {
+      if ((*node)->node_type == Node::BOS_NODE ||
+          (*node)->node_type == Node::EOS_NODE ||
+          ((*node)->attributes & Node::ENABLE_CACHE)) {
+        node = &(*node)->enext;
+      } else {
+        *node = (*node)->enext;
       }
     }
   }
@@ -32,6 +32,8 @@
 
 #include <memory>
 #include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "base/port.h"
@@ -43,6 +45,34 @@ namespace mozc {
 
 class Lattice {
  public:
+  // Memo of the prediction Viterbi at one position.  |lbest| holds the best
+  // (rid, cost) of the nodes ending at the position, sorted by rid.  |rbest|
+  // maps lid to (cost, rid of the best left node) and is computed only from
+  // |lbest|, so it stays valid as long as |lbest| is unchanged.  This lets the
+  // prediction Viterbi skip the connector lookups for the unchanged prefix of
+  // the key while the user is typing.
+  struct ViterbiCache {
+    std::vector<std::pair<int, int>> lbest;
+    std::vector<std::pair<int, std::pair<int, int>>> rbest;
+  };
+
+  // Hot fields of the reachable nodes ending at a position, stored as
+  // parallel arrays.  The Viterbi inner loop scans them for every node
+  // beginning at the position, so it is faster to read contiguous rid/cost
+  // than to follow Node::enext through the fat nodes each time.
+  struct EndNodeTable {
+    std::vector<uint16> rid;
+    std::vector<int32> cost;
+    std::vector<Node *> node;
+
+    size_t size() const { return node.size(); }
+    void clear() {
+      rid.clear();
+      cost.clear();
+      node.clear();
+    }
+  };
+
   Lattice();
   ~Lattice();
 
@@ -54,6 +84,17 @@ class Lattice {
   // return key.
   const string& key() const;
 
+  // Returns the number of the characters of the key.
+  size_t key_chars_len() const;
+
+  // Converts between the character positions and the byte offsets of the key
+  // with the index built when the key is set, instead of scanning the key.
+  // CharToBytePos(key_chars_len()) is key().size().  ByteToCharPos() returns
+  // the character containing the byte at |byte_pos|, or key_chars_len() for
+  // key().size().
+  size_t CharToBytePos(size_t char_pos) const;
+  size_t ByteToCharPos(size_t byte_pos) const;
+
   // Set history end position.
   // For cache, we have to reset lattice when the history size is changed.
   void set_history_end_pos(size_t pos);
@@ -79,9 +120,20 @@ class Lattice {
   // alias of begin_nodes(key.size()).
   Node *eos_nodes() const;
 
+  // Fills |table| with the nodes ending at |pos| whose prev is not NULL,
+  // i.e., the nodes the Viterbi has reached, in the order of end_nodes(pos).
+  void GetReachableEndNodes(size_t pos, EndNodeTable *table) const;
+
   // inset nodes (linked list) to the position |pos|.
   void Insert(size_t pos, Node *node);
 
+  // Same as Insert() but drops the normal nodes with the same key, value,
+  // lid and rid as another node at |pos|, which are usually found by several
+  // dictionaries.  The remaining one gets the lower wcost and the dictionary
+  // attributes of both.  Use this only for the nodes found by the lookups,
+  // as the dropped ones are not in the lattice.
+  void InsertWithoutDuplicates(size_t pos, Node *node);
+
   // clear all lattice and nodes allocated with NewNode method.
   void Clear();
 
@@ -103,6 +155,9 @@ class Lattice {
   // setter
   void SetCacheInfo(const size_t pos, const size_t len);
 
+  // return the Viterbi memo for |pos|.
+  ViterbiCache *mutable_viterbi_cache(size_t pos);
+
   // revert the wcost of nodes if it has ENABLE_CACHE attribute.
   // This function is needed for wcost may be changed during conversion
   // process for some heuristic methods.
@@ -130,6 +185,22 @@ class Lattice {
   // If cache_info_[pos] equals to len, it means key.substr(pos, k)
   // (1 <= k <= len) is already looked up.
   std::vector<size_t> cache_info_;
+
+  // viterbi_cache_[pos] holds the Viterbi memo for the nodes beginning at pos.
+  std::vector<ViterbiCache> viterbi_cache_;
+
+  // Rebuilds the character index below from |key_|.
+  void BuildCharIndex();
+
+  // char_offsets_[i] is the byte offset of the i-th character of |key_|,
+  // followed by key_.size().  byte_to_char_[pos] is the character containing
+  // the byte at |pos|, followed by the number of the characters.
+  std::vector<size_t> char_offsets_;
+  std::vector<size_t> byte_to_char_;
+
+  // Buffer of InsertWithoutDuplicates() to keep its allocations across the
+  // calls.  Maps the fingerprints of the nodes at a position to the nodes.
+  std::unordered_map<uint64, Node *> unique_nodes_;
 };
 
 }  // namespace mozc
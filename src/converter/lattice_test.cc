@@ -31,6 +31,8 @@
 
 #include <set>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "base/port.h"
 #include "converter/node.h"
@@ -103,6 +105,97 @@ TEST(LatticeTest, InsertTest) {
   }
 }
 
+TEST(LatticeTest, InsertWithoutDuplicatesTest) {
+  Lattice lattice;
+  lattice.SetKey("test");
+
+  auto new_node = [&lattice](const string &key, const string &value,
+                             int32 wcost, uint32 attributes) {
+    Node *node = lattice.NewNode();
+    node->key = key;
+    node->value = value;
+    node->lid = 10;
+    node->rid = 20;
+    node->wcost = wcost;
+    node->attributes = attributes;
+    return node;
+  };
+
+  Node *existing = new_node("es", "ES", 500, Node::DEFAULT_ATTRIBUTE);
+  lattice.Insert(1, existing);
+
+  // A duplicate of |existing| from the user dictionary with a lower cost,
+  // another word and a duplicate within the list.
+  Node *user = new_node("es", "ES", 300,
+                        Node::USER_DICTIONARY | Node::NO_VARIANTS_EXPANSION);
+  Node *other = new_node("es", "Es", 400, Node::DEFAULT_ATTRIBUTE);
+  Node *other_dup = new_node("es", "Es", 450, Node::DEFAULT_ATTRIBUTE);
+  // Not a duplicate as the attribute differs.
+  Node *corrected = new_node("es", "ES", 200, Node::SPELLING_CORRECTION);
+  user->bnext = other;
+  other->bnext = other_dup;
+  other_dup->bnext = corrected;
+  lattice.InsertWithoutDuplicates(1, user);
+
+  std::vector<Node *> nodes;
+  for (Node *node = lattice.begin_nodes(1); node != NULL;
+       node = node->bnext) {
+    nodes.push_back(node);
+  }
+  ASSERT_EQ(3, nodes.size());
+  EXPECT_EQ(other, nodes[0]);
+  EXPECT_EQ(corrected, nodes[1]);
+  EXPECT_EQ(existing, nodes[2]);
+  EXPECT_EQ(300, existing->wcost);
+  EXPECT_EQ(Node::USER_DICTIONARY | Node::NO_VARIANTS_EXPANSION,
+            existing->attributes);
+  EXPECT_EQ(400, other->wcost);
+
+  int end_size = 0;
+  for (Node *node = lattice.end_nodes(3); node != NULL; node = node->enext) {
+    ++end_size;
+  }
+  EXPECT_EQ(3, end_size);
+}
+
+TEST(LatticeTest, GetReachableEndNodesTest) {
+  Lattice lattice;
+  lattice.SetKey("test");
+
+  Node *node1 = lattice.NewNode();
+  node1->key = "te";
+  node1->rid = 10;
+  lattice.Insert(0, node1);
+  Node *node2 = lattice.NewNode();
+  node2->key = "e";
+  node2->rid = 20;
+  lattice.Insert(1, node2);
+  Node *node3 = lattice.NewNode();
+  node3->key = "e";
+  node3->rid = 30;
+  lattice.Insert(1, node3);
+
+  // node2 is not reached yet by the Viterbi.
+  node1->prev = lattice.bos_nodes();
+  node1->cost = 100;
+  node3->prev = lattice.bos_nodes();
+  node3->cost = 300;
+
+  Lattice::EndNodeTable table;
+  lattice.GetReachableEndNodes(2, &table);
+  ASSERT_EQ(2, table.size());
+  // The order follows end_nodes(2), i.e., node3 and then node1.
+  EXPECT_EQ(node3, table.node[0]);
+  EXPECT_EQ(30, table.rid[0]);
+  EXPECT_EQ(300, table.cost[0]);
+  EXPECT_EQ(node1, table.node[1]);
+  EXPECT_EQ(10, table.rid[1]);
+  EXPECT_EQ(100, table.cost[1]);
+
+  lattice.GetReachableEndNodes(3, &table);
+  EXPECT_EQ(0, table.size());
+}
+
 namespace {
 
 // set cache_info[i] to (key.size() - i)
@@ -225,4 +318,112 @@ TEST(LatticeTest, ShrinkKeyTest) {
     }
   }
 }
+
+TEST(LatticeTest, ViterbiCacheTest) {
+  Lattice lattice;
+  lattice.SetKey("test");
+  for (size_t i = 0; i <= lattice.key().size(); ++i) {
+    EXPECT_TRUE(lattice.mutable_viterbi_cache(i)->lbest.empty());
+    EXPECT_TRUE(lattice.mutable_viterbi_cache(i)->rbest.empty());
+  }
+
+  for (size_t i = 0; i <= lattice.key().size(); ++i) {
+    Lattice::ViterbiCache *cache = lattice.mutable_viterbi_cache(i);
+    cache->lbest.push_back(std::make_pair(1, 100));
+    cache->rbest.push_back(std::make_pair(2, std::make_pair(200, 1)));
+  }
+
+  // The memo for the remaining prefix is kept.
+  lattice.ShrinkKey(2);
+  EXPECT_EQ(1, lattice.mutable_viterbi_cache(0)->lbest.size());
+  EXPECT_EQ(1, lattice.mutable_viterbi_cache(1)->rbest.size());
+  EXPECT_TRUE(lattice.mutable_viterbi_cache(2)->lbest.empty());
+  EXPECT_TRUE(lattice.mutable_viterbi_cache(2)->rbest.empty());
+
+  lattice.AddSuffix("st");
+  EXPECT_EQ(1, lattice.mutable_viterbi_cache(1)->lbest.size());
+  EXPECT_TRUE(lattice.mutable_viterbi_cache(3)->lbest.empty());
+
+  lattice.SetKey("test");
+  EXPECT_TRUE(lattice.mutable_viterbi_cache(0)->lbest.empty());
+  EXPECT_TRUE(lattice.mutable_viterbi_cache(1)->rbest.empty());
+}
+
+TEST(LatticeTest, CharIndexTest) {
+  Lattice lattice;
+  EXPECT_EQ(0, lattice.key_chars_len());
+  EXPECT_EQ(0, lattice.CharToBytePos(0));
+  EXPECT_EQ(0, lattice.ByteToCharPos(0));
+
+  // "aあb"
+  lattice.SetKey("a\xE3\x81\x82" "b");
+  EXPECT_EQ(3, lattice.key_chars_len());
+  EXPECT_EQ(0, lattice.CharToBytePos(0));
+  EXPECT_EQ(1, lattice.CharToBytePos(1));
+  EXPECT_EQ(4, lattice.CharToBytePos(2));
+  EXPECT_EQ(5, lattice.CharToBytePos(3));
+  EXPECT_EQ(0, lattice.ByteToCharPos(0));
+  EXPECT_EQ(1, lattice.ByteToCharPos(1));
+  EXPECT_EQ(1, lattice.ByteToCharPos(2));
+  EXPECT_EQ(1, lattice.ByteToCharPos(3));
+  EXPECT_EQ(2, lattice.ByteToCharPos(4));
+  EXPECT_EQ(3, lattice.ByteToCharPos(5));
+
+  // The index follows the key kept by UpdateKey().  "aあいう"
+  lattice.UpdateKey("a\xE3\x81\x82\xE3\x81\x84\xE3\x81\x86");
+  EXPECT_EQ(4, lattice.key_chars_len());
+  EXPECT_EQ(7, lattice.CharToBytePos(3));
+  EXPECT_EQ(10, lattice.CharToBytePos(4));
+  EXPECT_EQ(3, lattice.ByteToCharPos(8));
+
+  lattice.ShrinkKey(4);
+  EXPECT_EQ(2, lattice.key_chars_len());
+  EXPECT_EQ(4, lattice.CharToBytePos(2));
+
+  lattice.Clear();
+  EXPECT_EQ(0, lattice.key_chars_len());
+}
+
+TEST(LatticeTest, ResetNodeCostTest) {
+  Lattice lattice;
+  lattice.SetKey("test");
+
+  Node *cached_node = lattice.NewNode();
+  cached_node->key = "es";
+  cached_node->value = "es";
+  cached_node->attributes |= Node::ENABLE_CACHE;
+  cached_node->raw_wcost = 100;
+  cached_node->wcost = 1000;
+  lattice.Insert(1, cached_node);
+
+  // Both the head and the middle of the lists have uncached nodes.
+  Node *uncached_node1 = lattice.NewNode();
+  uncached_node1->key = "e";
+  uncached_node1->value = "e";
+  lattice.Insert(1, uncached_node1);
+  Node *uncached_node2 = lattice.NewNode();
+  uncached_node2->key = "est";
+  uncached_node2->value = "est";
+  lattice.Insert(1, uncached_node2);
+  Node *uncached_node3 = lattice.NewNode();
+  uncached_node3->key = "s";
+  uncached_node3->value = "s";
+  lattice.Insert(2, uncached_node3);
+
+  lattice.ResetNodeCost();
+
+  EXPECT_EQ(cached_node, lattice.begin_nodes(1));
+  EXPECT_EQ(NULL, cached_node->bnext);
+  EXPECT_EQ(100, cached_node->wcost);
+  EXPECT_EQ(NULL, lattice.begin_nodes(2));
+  EXPECT_EQ(cached_node, lattice.end_nodes(3));
+  EXPECT_EQ(NULL, cached_node->enext);
+  EXPECT_EQ(NULL, lattice.end_nodes(2));
+  EXPECT_EQ(NULL, lattice.end_nodes(4));
+
+  // BOS and EOS nodes are kept.
+  EXPECT_EQ(Node::BOS_NODE, lattice.end_nodes(0)->node_type);
+  EXPECT_EQ(Node::EOS_NODE, lattice.begin_nodes(4)->node_type);
+}
+
 }  // namespace mozc
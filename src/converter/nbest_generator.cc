@@ -34,6 +34,7 @@
 #include <vector>
 
 #include "base/logging.h"
+#include "base/trace_events.h"
 #include "base/util.h"
 #include "converter/candidate_filter.h"
 #include "converter/connector.h"
@@ -42,6 +43,7 @@
 #include "converter/segmenter.h"
 #include "converter/segments.h"
 #include "dictionary/pos_matcher.h"
+#include "request/conversion_request.h"
 
 using mozc::dictionary::POSMatcher;
 using mozc::dictionary::SuppressionDictionary;
@@ -49,61 +51,94 @@ using mozc::dictionary::SuppressionDictionary;
 namespace mozc {
 namespace {
 
-const int kFreeListSize = 512;
+const int kInitialElementsSize = 512;
+// Reset() releases the elements beyond this size, which only very long
+// inputs need, instead of keeping them for the next conversion.
+const size_t kMaxRetainedElementsSize = 65536;
 const int kCostDiff = 3453;   // log prob of 1/1000
 
 }  // namespace
 
 using converter::CandidateFilter;
 
-struct NBestGenerator::QueueElement {
-  const Node *node;
-  const QueueElement *next;
-  int32 fx;  // f(x) = h(x) + g(x): cost function for A* search
-  int32 gx;  // g(x)
-  // transition cost part of g(x).
-  // Do not take the transition costs to edge nodes.
-  int32 structure_gx;
-  int32 w_gx;
-};
-
-const NBestGenerator::QueueElement *NBestGenerator::CreateNewElement(
-    const Node *node,
-    const QueueElement *next,
-    int32 fx,
-    int32 gx,
-    int32 structure_gx,
-    int32 w_gx) {
-  QueueElement *elm = freelist_.Alloc();
-  DCHECK(elm);
-  elm->node = node;
-  elm->next = next;
-  elm->fx = fx;
-  elm->gx = gx;
-  elm->structure_gx = structure_gx;
-  elm->w_gx = w_gx;
-  return elm;
+const uint32 NBestGenerator::kNoElement;
+const size_t NBestGenerator::Agenda::kArity;
+
+uint32 NBestGenerator::CreateNewElement(const Node *node,
+                                        uint32 next,
+                                        int32 fx,
+                                        int32 gx,
+                                        int32 structure_gx,
+                                        int32 w_gx) {
+  const QueueElement element = {node, next, fx, gx, structure_gx, w_gx};
+  elements_.push_back(element);
+  return static_cast<uint32>(elements_.size() - 1);
 }
 
-struct NBestGenerator::QueueElementComparator {
-  bool operator()(const NBestGenerator::QueueElement *q1,
-                  const NBestGenerator::QueueElement *q2) const {
-    return (q1->fx > q2->fx);
+void NBestGenerator::Agenda::Push(int32 fx, uint32 index) {
+  const Entry entry = {fx, index};
+  heap_.push_back(entry);
+  SiftUp(heap_.size() - 1);
+}
+
+void NBestGenerator::Agenda::Pop() {
+  DCHECK(!heap_.empty());
+  heap_.front() = heap_.back();
+  heap_.pop_back();
+  if (!heap_.empty()) {
+    SiftDown(0);
   }
-};
+}
 
-inline void NBestGenerator::Agenda::Push(
-    const NBestGenerator::QueueElement *element) {
-  priority_queue_.push_back(element);
-  std::push_heap(priority_queue_.begin(), priority_queue_.end(),
-                 QueueElementComparator());
+void NBestGenerator::Agenda::Shrink(size_t size) {
+  if (heap_.size() <= size) {
+    return;
+  }
+  std::nth_element(heap_.begin(), heap_.begin() + size, heap_.end());
+  heap_.resize(size);
+  if (size < 2) {
+    return;
+  }
+  for (size_t pos = (size - 2) / kArity + 1; pos > 0; --pos) {
+    SiftDown(pos - 1);
+  }
 }
 
-inline void NBestGenerator::Agenda::Pop() {
-  DCHECK(!priority_queue_.empty());
-  std::pop_heap(priority_queue_.begin(), priority_queue_.end(),
-                QueueElementComparator());
-  priority_queue_.pop_back();
+inline void NBestGenerator::Agenda::SiftUp(size_t pos) {
+  const Entry entry = heap_[pos];
+  while (pos > 0) {
+    const size_t parent = (pos - 1) / kArity;
+    if (!(entry < heap_[parent])) {
+      break;
+    }
+    heap_[pos] = heap_[parent];
+    pos = parent;
+  }
+  heap_[pos] = entry;
+}
+
+inline void NBestGenerator::Agenda::SiftDown(size_t pos) {
+  const size_t size = heap_.size();
+  const Entry entry = heap_[pos];
+  while (true) {
+    const size_t first_child = pos * kArity + 1;
+    if (first_child >= size) {
+      break;
+    }
+    const size_t last_child = std::min(first_child + kArity, size);
+    size_t best = first_child;
+    for (size_t child = first_child + 1; child < last_child; ++child) {
+      if (heap_[child] < heap_[best]) {
+        best = child;
+      }
+    }
+    if (!(heap_[best] < entry)) {
+      break;
+    }
+    heap_[pos] = heap_[best];
+    pos = best;
+  }
+  heap_[pos] = entry;
 }
 
 NBestGenerator::NBestGenerator(const SuppressionDictionary *suppression_dic,
@@ -117,12 +152,13 @@ NBestGenerator::NBestGenerator(const SuppressionDictionary *suppression_dic,
       segmenter_(segmenter), connector_(connector), pos_matcher_(pos_matcher),
       lattice_(lattice),
       begin_node_(NULL), end_node_(NULL),
-      freelist_(kFreeListSize),
       filter_(new CandidateFilter(
           suppression_dic, pos_matcher, suggestion_filter,
           apply_suggestion_filter_for_exact_match)),
       viterbi_result_checked_(false),
       check_mode_(STRICT),
+      max_agenda_size_(0),
+      request_(NULL),
       boundary_checker_(NULL) {
   DCHECK(suppression_dictionary_);
   DCHECK(segmenter);
@@ -132,7 +168,8 @@ NBestGenerator::NBestGenerator(const SuppressionDictionary *suppression_dic,
     return;
   }
 
-  agenda_.Reserve(kFreeListSize);
+  agenda_.Reserve(kInitialElementsSize);
+  elements_.reserve(kInitialElementsSize);
 }
 
 NBestGenerator::~NBestGenerator() {
@@ -141,7 +178,11 @@ NBestGenerator::~NBestGenerator() {
 void NBestGenerator::Reset(const Node *begin_node, const Node *end_node,
                            const BoundaryCheckMode mode) {
   agenda_.Clear();
-  freelist_.Free();
+  if (elements_.capacity() > kMaxRetainedElementsSize) {
+    std::vector<QueueElement>().swap(elements_);
+    elements_.reserve(kInitialElementsSize);
+  }
+  elements_.clear();
   filter_->Reset();
   viterbi_result_checked_ = false;
   check_mode_ = mode;
@@ -156,7 +197,8 @@ void NBestGenerator::Reset(const Node *begin_node, const Node *end_node,
          node->cost - end_node_->cost <= kCostDiff &&
          node->prev != end_node_->prev)) {
       // Push "EOS" nodes.
-      agenda_.Push(CreateNewElement(node, NULL, node->cost, 0, 0, 0));
+      agenda_.Push(node->cost,
+                   CreateNewElement(node, kNoElement, node->cost, 0, 0, 0));
     }
   }
 
@@ -276,6 +318,7 @@ void NBestGenerator::MakeCandidate(
 bool NBestGenerator::Next(const string &original_key,
                           Segment::Candidate *candidate,
                           Segments::RequestType request_type) {
+  MOZC_TRACE_SCOPE("NBestGenerator::Next");
   DCHECK(begin_node_);
   DCHECK(end_node_);
 
@@ -329,13 +372,22 @@ bool NBestGenerator::Next(const string &original_key,
   }
 
   const int KMaxTrial = 500;
+  // Checking the cancellation costs a clock read, so do it only every
+  // kCancelCheckInterval trials.
+  const int kCancelCheckInterval = 64;
   int num_trials = 0;
 
   while (!agenda_.IsEmpty()) {
-    const QueueElement *top = agenda_.Top();
-    DCHECK(top);
+    if (request_ != NULL && num_trials % kCancelCheckInterval == 0 &&
+        request_->IsCanceled()) {
+      VLOG(2) << "canceled";
+      return false;
+    }
+    const uint32 top_index = agenda_.Top();
     agenda_.Pop();
-    const Node *rnode = top->node;
+    // Copied since |elements_| may grow while |top| is expanded.
+    const QueueElement top = elements_[top_index];
+    const Node *rnode = top.node;
     CHECK(rnode);
 
     if (num_trials++ > KMaxTrial) {   // too many trials
@@ -346,13 +398,13 @@ bool NBestGenerator::Next(const string &original_key,
     // reached to the goal.
     if (rnode->end_pos == begin_node_->end_pos) {
       nodes_.clear();
-      for (const QueueElement *elm = top->next;
-           elm->next != NULL; elm = elm->next) {
+      for (const QueueElement *elm = &elements_[top.next];
+           elm->next != kNoElement; elm = &elements_[elm->next]) {
         nodes_.push_back(elm->node);
       }
       CHECK(!nodes_.empty());
 
-      MakeCandidate(candidate, top->gx, top->structure_gx, top->w_gx, nodes_);
+      MakeCandidate(candidate, top.gx, top.structure_gx, top.w_gx, nodes_);
       const int filter_result = filter_->FilterCandidate(original_key,
                                                          candidate,
                                                          nodes_,
@@ -370,7 +422,7 @@ bool NBestGenerator::Next(const string &original_key,
           // do nothing
       }
     } else {
-      const QueueElement *best_left_elm = NULL;
+      uint32 best_left_elm = kNoElement;
       const bool is_right_edge = rnode->begin_pos == end_node_->begin_pos;
       const bool is_left_edge = rnode->begin_pos == begin_node_->end_pos;
       DCHECK(!(is_right_edge && is_left_edge));
@@ -459,29 +511,36 @@ bool NBestGenerator::Next(const string &original_key,
           wcost_diff += kWeakConnectedPenalty / 2;
         }
 
-        const int32 gx = cost_diff + top->gx;
+        const int32 gx = cost_diff + top.gx;
         // |lnode->cost| is heuristics function of A* search, h(x).
         // After Viterbi search, we already know an exact value of h(x).
         const int32 fx = lnode->cost + gx;
-        const int32 structure_gx = structure_cost_diff + top->structure_gx;
-        const int32 w_gx = wcost_diff + top->w_gx;
+        const int32 structure_gx = structure_cost_diff + top.structure_gx;
+        const int32 w_gx = wcost_diff + top.w_gx;
         if (is_left_edge) {
           // We only need to only 1 left node here.
           // Even if expand all left nodes, all the |value| part should
           // be identical. Here, we simply use the best left edge node.
           // This hack reduces the number of redundant calls of pop().
-          if (best_left_elm == NULL || best_left_elm->fx > fx) {
+          if (best_left_elm == kNoElement ||
+              elements_[best_left_elm].fx > fx) {
             best_left_elm = CreateNewElement(
-                lnode, top, fx, gx, structure_gx, w_gx);
+                lnode, top_index, fx, gx, structure_gx, w_gx);
           }
         } else {
-          agenda_.Push(CreateNewElement(
-              lnode, top, fx, gx, structure_gx, w_gx));
+          agenda_.Push(fx, CreateNewElement(
+              lnode, top_index, fx, gx, structure_gx, w_gx));
         }
       }
 
-      if (best_left_elm != NULL) {
-        agenda_.Push(best_left_elm);
+      if (best_left_elm != kNoElement) {
+        agenda_.Push(elements_[best_left_elm].fx, best_left_elm);
+      }
+
+      // Trim the agenda only when it doubles so that the cost of Shrink() is
+      // amortized over the pushes.
+      if (max_agenda_size_ > 0 && agenda_.size() > 2 * max_agenda_size_) {
+        agenda_.Shrink(max_agenda_size_);
       }
     }
   }
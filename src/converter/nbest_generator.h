@@ -34,7 +34,6 @@
 #include <string>
 #include <vector>
 
-#include "base/freelist.h"
 #include "base/port.h"
 #include "converter/candidate_filter.h"
 #include "converter/segments.h"
@@ -44,6 +43,7 @@
 namespace mozc {
 
 class Connector;
+class ConversionRequest;
 class Lattice;
 class Segmenter;
 class SuggestionFilter;
@@ -90,6 +90,12 @@ class NBestGenerator {
       bool apply_suggestion_filter_for_exact_match);
   ~NBestGenerator();
 
+  // Changes the lattice to enumerate, so that the generator (and its
+  // buffers) can be reused for another lattice.  Call Reset() after this.
+  void set_lattice(const Lattice *lattice) {
+    lattice_ = lattice;
+  }
+
   // Reset the iterator status.
   void Reset(const Node *begin_node, const Node *end_node,
              const BoundaryCheckMode mode);
@@ -100,6 +106,21 @@ class NBestGenerator {
             Segment::Candidate *candidate,
             Segments::RequestType request_type);
 
+  // Caps the number of partial paths kept for the search (beam search).  The
+  // agenda is trimmed to the |size| best paths whenever it gets twice as
+  // large, which bounds the work per Next() for very long inputs at the cost
+  // of possibly missing lower-ranked candidates.  0 (default) keeps all the
+  // paths, i.e., the exact A* search.
+  void set_max_agenda_size(size_t size) {
+    max_agenda_size_ = size;
+  }
+
+  // Makes Next() return false once |request| is canceled.  |request| is not
+  // owned and must outlive the enumeration.  NULL (default) never stops it.
+  void set_conversion_request(const ConversionRequest *request) {
+    request_ = request;
+  }
+
  private:
   enum BoundaryCheckResult {
     VALID = 0,
@@ -110,11 +131,25 @@ class NBestGenerator {
   typedef BoundaryCheckResult (NBestGenerator::*BoundaryChecker)(
       const Node *, const Node *, bool) const;
 
-  struct QueueElement;
-  struct QueueElementComparator;
+  // A partial path of the search.  Elements live in |elements_| and refer to
+  // each other by index, so that the pool never moves a live pointer and is
+  // reused by the next Reset() without any allocation.
+  struct QueueElement {
+    const Node *node;
+    // Index of the element on the right of |node|, or kNoElement.
+    uint32 next;
+    int32 fx;  // f(x) = h(x) + g(x): cost function for A* search
+    int32 gx;  // g(x)
+    // transition cost part of g(x).
+    // Do not take the transition costs to edge nodes.
+    int32 structure_gx;
+    int32 w_gx;
+  };
+  static const uint32 kNoElement = 0xFFFFFFFF;
 
-  // This is just a priority_queue of const QueueElement*, but supports
-  // more operations in addition to std::priority_queue.
+  // A 4-ary min-heap of element indices ordered by f(x).  The key is copied
+  // into the heap so that sifting doesn't touch the elements.  Ties are
+  // broken by the index, i.e., the older element comes first.
   class Agenda {
    public:
     Agenda() {
@@ -122,24 +157,43 @@ class NBestGenerator {
     ~Agenda() {
     }
 
-    const QueueElement *Top() const {
-      return priority_queue_.front();
+    uint32 Top() const {
+      return heap_.front().index;
     }
     bool IsEmpty() const {
-      return priority_queue_.empty();
+      return heap_.empty();
+    }
+    size_t size() const {
+      return heap_.size();
     }
     void Clear() {
-      priority_queue_.clear();
+      heap_.clear();
     }
     void Reserve(int size) {
-      priority_queue_.reserve(size);
+      heap_.reserve(size);
     }
 
-    void Push(const QueueElement *element);
+    void Push(int32 fx, uint32 index);
     void Pop();
 
+    // Keeps only the |size| elements of the smallest cost.
+    void Shrink(size_t size);
+
    private:
-    std::vector<const QueueElement*> priority_queue_;
+    struct Entry {
+      int32 fx;
+      uint32 index;
+      bool operator<(const Entry &other) const {
+        return fx != other.fx ? fx < other.fx : index < other.index;
+      }
+    };
+
+    static const size_t kArity = 4;
+
+    void SiftUp(size_t pos);
+    void SiftDown(size_t pos);
+
+    std::vector<Entry> heap_;
 
     DISALLOW_COPY_AND_ASSIGN(Agenda);
   };
@@ -162,13 +216,13 @@ class NBestGenerator {
 
   int GetTransitionCost(const Node *lnode, const Node *rnode) const;
 
-  // Create queue element from freelist
-  const QueueElement *CreateNewElement(const Node *node,
-                                       const QueueElement *next,
-                                       int32 fx,
-                                       int32 gx,
-                                       int32 structure_gx,
-                                       int32 w_gx);
+  // Creates a queue element in |elements_| and returns its index.
+  uint32 CreateNewElement(const Node *node,
+                          uint32 next,
+                          int32 fx,
+                          int32 gx,
+                          int32 structure_gx,
+                          int32 w_gx);
 
   // References to relevant modules.
   const dictionary::SuppressionDictionary *suppression_dictionary_;
@@ -181,11 +235,15 @@ class NBestGenerator {
   const Node *end_node_;
 
   Agenda agenda_;
-  FreeList<QueueElement> freelist_;
+  // Cleared by Reset() but keeps its capacity, so a generator reused from a
+  // ConverterWorkspace doesn't allocate once it has grown.
+  std::vector<QueueElement> elements_;
   std::vector<const Node *> nodes_;
   std::unique_ptr<converter::CandidateFilter> filter_;
   bool viterbi_result_checked_;
   BoundaryCheckMode check_mode_;
+  size_t max_agenda_size_;
+  const ConversionRequest *request_;
 
   BoundaryChecker boundary_checker_;
 
@@ -384,4 +384,72 @@ TEST_F(NBestGeneratorTest, InnerSegmentBoundary) {
   EXPECT_EQ("行きたい", content_values[2]);
 }
 
+TEST_F(NBestGeneratorTest, BoundedAgenda) {
+  std::unique_ptr<MockDataAndImmutableConverter> data_and_converter(
+      new MockDataAndImmutableConverter);
+  ImmutableConverterImpl *converter = data_and_converter->GetConverter();
+
+  Segments segments;
+  segments.set_request_type(Segments::CONVERSION);
+  const string kText = "わたしのなまえはなかのです";
+  {
+    Segment *segment = segments.add_segment();
+    segment->set_segment_type(Segment::FREE);
+    segment->set_key(kText);
+  }
+
+  Lattice lattice;
+  lattice.SetKey(kText);
+  const ConversionRequest request;
+  converter->MakeLattice(request, &segments, &lattice);
+
+  std::vector<uint16> group;
+  converter->MakeGroup(segments, &group);
+  converter->Viterbi(segments, &lattice);
+
+  const bool kSingleSegment = true;  // For realtime conversion
+  const Node *begin_node = lattice.bos_nodes();
+  const Node *end_node = GetEndNode(
+      *converter, segments, *begin_node, group, kSingleSegment);
+
+  Segment expected;
+  {
+    std::unique_ptr<NBestGenerator> nbest_generator(
+        data_and_converter->CreateNBestGenerator(&lattice));
+    nbest_generator->Reset(begin_node, end_node, NBestGenerator::ONLY_EDGE);
+    GatherCandidates(
+        10, Segments::CONVERSION, nbest_generator.get(), &expected);
+    ASSERT_LT(1, expected.candidates_size());
+  }
+
+  // A cap much larger than the lattice doesn't change the result.
+  {
+    std::unique_ptr<NBestGenerator> nbest_generator(
+        data_and_converter->CreateNBestGenerator(&lattice));
+    nbest_generator->set_max_agenda_size(100000);
+    nbest_generator->Reset(begin_node, end_node, NBestGenerator::ONLY_EDGE);
+    Segment result_segment;
+    GatherCandidates(
+        10, Segments::CONVERSION, nbest_generator.get(), &result_segment);
+    ASSERT_EQ(expected.candidates_size(), result_segment.candidates_size());
+    for (size_t i = 0; i < expected.candidates_size(); ++i) {
+      EXPECT_EQ(expected.candidate(i).value,
+                result_segment.candidate(i).value);
+    }
+  }
+
+  // Even with the smallest cap, the Viterbi-best result comes first.
+  {
+    std::unique_ptr<NBestGenerator> nbest_generator(
+        data_and_converter->CreateNBestGenerator(&lattice));
+    nbest_generator->set_max_agenda_size(1);
+    nbest_generator->Reset(begin_node, end_node, NBestGenerator::ONLY_EDGE);
+    Segment result_segment;
+    GatherCandidates(
+        10, Segments::CONVERSION, nbest_generator.get(), &result_segment);
+    ASSERT_LE(1, result_segment.candidates_size());
+    EXPECT_EQ(expected.candidate(0).value, result_segment.candidate(0).value);
+  }
+}
+
 }  // namespace mozc
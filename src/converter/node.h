@@ -203,7 +203,7 @@ struct Node {
     value.clear();
   }
 
-  inline void InitFromToken(const dictionary::Token &token) {
+  inline void InitFromToken(const dictionary::TokenView &token) {
     prev = nullptr;
     next = nullptr;
     bnext = nullptr;
@@ -225,9 +225,9 @@ struct Node {
       attributes |= USER_DICTIONARY;
       attributes |= NO_VARIANTS_EXPANSION;
     }
-    key = token.key;
+    token.key.CopyToString(&key);
     actual_key.clear();
-    value = token.value;
+    token.value.CopyToString(&value);
   }
 };
 
@@ -30,30 +30,66 @@
 #ifndef MOZC_CONVERTER_NODE_ALLOCATOR_H_
 #define MOZC_CONVERTER_NODE_ALLOCATOR_H_
 
-#include "base/freelist.h"
+#include <algorithm>
+#include <new>
+#include <vector>
+
 #include "base/logging.h"
 #include "base/port.h"
 #include "converter/node.h"
 
 namespace mozc {
 
+// Bump-pointer arena for lattice nodes.  Memory is allocated in chunks of
+// kChunkSize nodes and a node is constructed only when its slot is handed out
+// for the first time.  Free() resets the arena; the constructed nodes are
+// kept and re-initialized on reuse, so that the string buffers in Node are
+// recycled across conversions.
 class NodeAllocator {
  public:
-  NodeAllocator() : node_freelist_(1024), max_nodes_size_(8192),
-                    node_count_(0) {}
-  ~NodeAllocator() {}
+  static const size_t kChunkSize = 1024;
+
+  NodeAllocator() : max_nodes_size_(8192), node_count_(0),
+                    constructed_count_(0), peak_node_count_(0),
+                    total_node_count_(0), shrink_to_high_water_mark_(true) {}
+  ~NodeAllocator() {
+    ReleaseChunks(0);
+  }
 
   Node *NewNode() {
-    Node *node = node_freelist_.Alloc();
-    DCHECK(node);
-    node->Init();
+    const size_t chunk_index = node_count_ / kChunkSize;
+    if (chunk_index == chunks_.size()) {
+      chunks_.push_back(
+          static_cast<Node *>(::operator new(sizeof(Node) * kChunkSize)));
+    }
+    Node *node = chunks_[chunk_index] + node_count_ % kChunkSize;
+    if (node_count_ < constructed_count_) {
+      node->Init();
+    } else {
+      DCHECK_EQ(node_count_, constructed_count_);
+      new (node) Node();
+      ++constructed_count_;
+    }
     ++node_count_;
+    ++total_node_count_;
+    peak_node_count_ = std::max(peak_node_count_, node_count_);
     return node;
   }
 
-  // Frees all nodes allocateed by NewNode().
+  // Frees all nodes allocateed by NewNode().  When shrink_to_high_water_mark
+  // is enabled (default), the chunks which were not used since the last call
+  // are released except for the first one.
   void Free() {
-    node_freelist_.Free();
+    if (shrink_to_high_water_mark_) {
+      const size_t used_chunks = (node_count_ + kChunkSize - 1) / kChunkSize;
+      ReleaseChunks(std::max<size_t>(used_chunks, 1));
+    }
+    node_count_ = 0;
+  }
+
+  // Frees all nodes and releases all the chunks.
+  void Release() {
+    ReleaseChunks(0);
     node_count_ = 0;
   }
 
@@ -65,14 +101,66 @@ class NodeAllocator {
     max_nodes_size_ = max_nodes_size;
   }
 
+  bool shrink_to_high_water_mark() const {
+    return shrink_to_high_water_mark_;
+  }
+
+  void set_shrink_to_high_water_mark(bool shrink) {
+    shrink_to_high_water_mark_ = shrink;
+  }
+
+  // Returns the number of nodes allocated since the last Free().
   size_t node_count() const {
     return node_count_;
   }
 
+  // Returns the maximum of node_count() since the construction.
+  size_t peak_node_count() const {
+    return peak_node_count_;
+  }
+
+  // Returns the number of NewNode() calls since the construction.
+  uint64 total_node_count() const {
+    return total_node_count_;
+  }
+
+  // Returns the number of chunks currently retained.
+  size_t chunk_count() const {
+    return chunks_.size();
+  }
+
+  // Returns the size of the memory retained for nodes, excluding the buffers
+  // owned by the nodes.
+  size_t allocated_bytes() const {
+    return chunks_.size() * kChunkSize * sizeof(Node);
+  }
+
  private:
-  FreeList<Node> node_freelist_;
+  // Destroys the nodes in chunks_[num_chunks...] and releases the chunks.
+  void ReleaseChunks(size_t num_chunks) {
+    for (size_t i = num_chunks; i < chunks_.size(); ++i) {
+      const size_t begin = i * kChunkSize;
+      const size_t end = std::min(constructed_count_, begin + kChunkSize);
+      for (size_t j = begin; j < end; ++j) {
+        chunks_[i][j - begin].~Node();
+      }
+      ::operator delete(chunks_[i]);
+    }
+    if (num_chunks < chunks_.size()) {
+      chunks_.resize(num_chunks);
+      constructed_count_ =
+          std::min(constructed_count_, num_chunks * kChunkSize);
+    }
+  }
+
+  std::vector<Node *> chunks_;
   size_t max_nodes_size_;
   size_t node_count_;
+  // Nodes [0, constructed_count_) are constructed.
+  size_t constructed_count_;
+  size_t peak_node_count_;
+  uint64 total_node_count_;
+  bool shrink_to_high_water_mark_;
 
   DISALLOW_COPY_AND_ASSIGN(NodeAllocator);
 };
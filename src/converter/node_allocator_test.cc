@@ -0,0 +1,137 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "converter/node_allocator.h"
+
+#include "converter/node.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace {
+
+TEST(NodeAllocatorTest, NewNode) {
+  NodeAllocator allocator;
+  EXPECT_EQ(0, allocator.node_count());
+  EXPECT_EQ(0, allocator.chunk_count());
+
+  Node *node = allocator.NewNode();
+  ASSERT_NE(nullptr, node);
+  EXPECT_EQ(1, allocator.node_count());
+  EXPECT_EQ(1, allocator.chunk_count());
+  EXPECT_EQ(nullptr, node->bnext);
+  EXPECT_TRUE(node->key.empty());
+
+  Node *node2 = allocator.NewNode();
+  EXPECT_NE(node, node2);
+  EXPECT_EQ(2, allocator.node_count());
+}
+
+TEST(NodeAllocatorTest, ReusedNodesAreInitialized) {
+  NodeAllocator allocator;
+  Node *node = allocator.NewNode();
+  node->key = "key";
+  node->value = "value";
+  node->wcost = 100;
+  allocator.Free();
+  EXPECT_EQ(0, allocator.node_count());
+
+  Node *reused = allocator.NewNode();
+  EXPECT_EQ(node, reused);
+  EXPECT_TRUE(reused->key.empty());
+  EXPECT_TRUE(reused->value.empty());
+  EXPECT_EQ(0, reused->wcost);
+}
+
+TEST(NodeAllocatorTest, Counters) {
+  NodeAllocator allocator;
+  const size_t kNumNodes = NodeAllocator::kChunkSize * 3 + 1;
+  for (size_t i = 0; i < kNumNodes; ++i) {
+    allocator.NewNode();
+  }
+  EXPECT_EQ(kNumNodes, allocator.node_count());
+  EXPECT_EQ(kNumNodes, allocator.peak_node_count());
+  EXPECT_EQ(kNumNodes, allocator.total_node_count());
+  EXPECT_EQ(4, allocator.chunk_count());
+  EXPECT_EQ(4 * NodeAllocator::kChunkSize * sizeof(Node),
+            allocator.allocated_bytes());
+
+  allocator.Free();
+  allocator.NewNode();
+  EXPECT_EQ(1, allocator.node_count());
+  EXPECT_EQ(kNumNodes, allocator.peak_node_count());
+  EXPECT_EQ(kNumNodes + 1, allocator.total_node_count());
+}
+
+TEST(NodeAllocatorTest, ShrinkToHighWaterMark) {
+  NodeAllocator allocator;
+  ASSERT_TRUE(allocator.shrink_to_high_water_mark());
+  for (size_t i = 0; i < NodeAllocator::kChunkSize * 3; ++i) {
+    allocator.NewNode();
+  }
+  EXPECT_EQ(3, allocator.chunk_count());
+
+  // The chunks used by the last conversion are kept.
+  allocator.Free();
+  EXPECT_EQ(3, allocator.chunk_count());
+
+  // The chunks unused by the last conversion are released.
+  allocator.NewNode();
+  allocator.Free();
+  EXPECT_EQ(1, allocator.chunk_count());
+
+  // The first chunk is always kept.
+  allocator.Free();
+  EXPECT_EQ(1, allocator.chunk_count());
+
+  allocator.Release();
+  EXPECT_EQ(0, allocator.chunk_count());
+  EXPECT_NE(nullptr, allocator.NewNode());
+}
+
+TEST(NodeAllocatorTest, NoShrink) {
+  NodeAllocator allocator;
+  allocator.set_shrink_to_high_water_mark(false);
+  for (size_t i = 0; i < NodeAllocator::kChunkSize * 3; ++i) {
+    allocator.NewNode();
+  }
+  allocator.Free();
+  allocator.NewNode();
+  allocator.Free();
+  EXPECT_EQ(3, allocator.chunk_count());
+
+  // Reallocating within the retained chunks doesn't allocate new ones.
+  for (size_t i = 0; i < NodeAllocator::kChunkSize * 3; ++i) {
+    allocator.NewNode();
+  }
+  EXPECT_EQ(3, allocator.chunk_count());
+}
+
+}  // namespace
+}  // namespace mozc
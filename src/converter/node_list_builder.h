@@ -60,9 +60,15 @@ class BaseNodeListBuilder : public dictionary::DictionaryInterface::Callback {
     return TRAVERSE_CONTINUE;
   }
 
-  // Creates a new node and prepends it to the current list.
   virtual ResultType OnToken(StringPiece key, StringPiece actual_key,
                              const dictionary::Token &token) {
+    return OnTokenView(key, actual_key, token);
+  }
+
+  // Creates a new node and prepends it to the current list.  Subclasses
+  // override this method to handle tokens from any dictionary.
+  virtual ResultType OnTokenView(StringPiece key, StringPiece actual_key,
+                                 const dictionary::TokenView &token) {
     Node *new_node = NewNodeFromToken(token);
     PrependNode(new_node);
     return (limit_ <= 0) ? TRAVERSE_DONE : TRAVERSE_CONTINUE;
@@ -73,7 +79,7 @@ class BaseNodeListBuilder : public dictionary::DictionaryInterface::Callback {
   Node *result() const { return result_; }
   NodeAllocator *allocator() { return allocator_; }
 
-  Node *NewNodeFromToken(const dictionary::Token &token) {
+  Node *NewNodeFromToken(const dictionary::TokenView &token) {
     Node *new_node = allocator_->NewNode();
     new_node->InitFromToken(token);
     new_node->wcost += penalty_;
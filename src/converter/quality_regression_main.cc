@@ -27,6 +27,8 @@
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include <algorithm>
+#include <atomic>
 #include <iostream>  // NOLINT
 #include <memory>
 #include <string>
@@ -34,36 +36,117 @@
 
 #include "base/flags.h"
 #include "base/init_mozc.h"
+#include "base/logging.h"
+#include "base/stopwatch.h"
+#include "base/thread.h"
 #include "base/util.h"
 #include "converter/quality_regression_util.h"
 #include "engine/engine_factory.h"
 #include "engine/engine_interface.h"
 
 DEFINE_string(test_file, "", "regression test file");
+DEFINE_int32(num_threads, 1,
+             "number of threads to run the test cases with.  Each thread "
+             "owns its own engine instance.");
 
 using mozc::EngineFactory;
 using mozc::EngineInterface;
 using mozc::quality_regression::QualityRegressionUtil;
 
+namespace {
+
+struct TestResult {
+  bool passed;
+  string actual_value;
+};
+
+// Converts the test items with one engine.  The items are handed out one by
+// one through |next_index| shared by all the runners, and the result of the
+// i-th item is stored in (*results)[i] so that the output order doesn't
+// depend on the scheduling.
+class RegressionRunner : public mozc::Thread {
+ public:
+  RegressionRunner(const std::vector<QualityRegressionUtil::TestItem> &items,
+                   std::atomic<size_t> *next_index,
+                   std::vector<TestResult> *results)
+      : engine_(EngineFactory::Create()),
+        util_(engine_->GetConverter()),
+        items_(items),
+        next_index_(next_index),
+        results_(results) {}
+
+  void Run() override {
+    for (size_t i = next_index_->fetch_add(1); i < items_.size();
+         i = next_index_->fetch_add(1)) {
+      TestResult *result = &(*results_)[i];
+      result->passed = util_.ConvertAndTest(items_[i], &result->actual_value);
+    }
+  }
+
+ private:
+  std::unique_ptr<EngineInterface> engine_;
+  QualityRegressionUtil util_;
+  const std::vector<QualityRegressionUtil::TestItem> &items_;
+  std::atomic<size_t> *next_index_;
+  std::vector<TestResult> *results_;
+
+  DISALLOW_COPY_AND_ASSIGN(RegressionRunner);
+};
+
+}  // namespace
+
 int main(int argc, char **argv) {
   mozc::InitMozc(argv[0], &argc, &argv, false);
 
-  std::unique_ptr<EngineInterface> engine(EngineFactory::Create());
-  QualityRegressionUtil util(engine->GetConverter());
-
   std::vector<QualityRegressionUtil::TestItem> items;
   QualityRegressionUtil::ParseFile(FLAGS_test_file, &items);
 
+  const int num_threads = std::max(FLAGS_num_threads, 1);
+  std::vector<TestResult> results(items.size());
+  std::atomic<size_t> next_index(0);
+
+  // Engines are created before any conversion starts so that the
+  // initialization cost is not counted in the throughput.  All the engines
+  // read the same embedded data set.
+  std::vector<std::unique_ptr<RegressionRunner>> runners;
+  for (int i = 0; i < num_threads; ++i) {
+    runners.emplace_back(new RegressionRunner(items, &next_index, &results));
+  }
+
+  mozc::Stopwatch stopwatch = mozc::Stopwatch::StartNew();
+  if (num_threads == 1) {
+    runners[0]->Run();
+  } else {
+    for (size_t i = 0; i < runners.size(); ++i) {
+      runners[i]->SetJoinable(true);
+      runners[i]->Start("QualityRegression");
+    }
+    for (size_t i = 0; i < runners.size(); ++i) {
+      runners[i]->Join();
+    }
+  }
+  stopwatch.Stop();
+
+  size_t num_failed = 0;
   for (size_t i = 0; i < items.size(); ++i) {
-    string actual_value;
-    const  bool result = util.ConvertAndTest(items[i], &actual_value);
-    if (result) {
+    if (results[i].passed) {
       std::cout << "OK:\t" << items[i].OutputAsTSV() << std::endl;
     } else {
-      std::cout << "FAILED:\t" << items[i].OutputAsTSV() << "\t" << actual_value
-                << std::endl;
+      ++num_failed;
+      std::cout << "FAILED:\t" << items[i].OutputAsTSV() << "\t"
+                << results[i].actual_value << std::endl;
     }
   }
 
+  const int64 elapsed_msec = stopwatch.GetElapsedMilliseconds();
+  std::cerr << "Tested " << items.size() << " items (" << num_failed
+            << " failed) with " << num_threads << " thread(s) in "
+            << elapsed_msec << " msec";
+  if (elapsed_msec > 0) {
+    std::cerr << ", " << (items.size() * 1000.0 / elapsed_msec)
+              << " items/sec";
+  }
+  std::cerr << std::endl;
+
   return 0;
 }
@@ -36,6 +36,15 @@
 #include "data_manager/data_manager_interface.h"
 
 namespace mozc {
+namespace {
+
+const uint16 kDenseSegmenterMagicNumber = 0xCDAE;
+
+// The header is as large as a cache line so that the rows following it keep
+// the alignment of the data.
+const size_t kDenseHeaderSize = 64;
+
+}  // namespace
 
 Segmenter *Segmenter::CreateFromDataManager(
     const DataManagerInterface &data_manager) {
@@ -50,9 +59,16 @@ Segmenter *Segmenter::CreateFromDataManager(
                                 &l_table, &r_table,
                                 &bitarray_num_bytes, &bitarray_data,
                                 &boundary_data);
+  const char *dense_data = nullptr;
+  size_t dense_size = 0;
+#ifndef OS_ANDROID
+  // The dense bit-array takes about 1MB, so use it only on desktop.
+  data_manager.GetDenseSegmenterData(&dense_data, &dense_size);
+#endif  // OS_ANDROID
   return new Segmenter(l_num_elements, r_num_elements,
                        l_table, r_table,
                        bitarray_num_bytes, bitarray_data,
+                       dense_data, dense_size,
                        boundary_data);
 }
 
@@ -60,19 +76,55 @@ Segmenter::Segmenter(
     size_t l_num_elements, size_t r_num_elements, const uint16 *l_table,
     const uint16 *r_table, size_t bitarray_num_bytes,
     const char *bitarray_data, const uint16 *boundary_data)
+    : Segmenter(l_num_elements, r_num_elements, l_table, r_table,
+                bitarray_num_bytes, bitarray_data, nullptr, 0,
+                boundary_data) {}
+
+Segmenter::Segmenter(
+    size_t l_num_elements, size_t r_num_elements, const uint16 *l_table,
+    const uint16 *r_table, size_t bitarray_num_bytes,
+    const char *bitarray_data, const char *dense_data, size_t dense_size,
+    const uint16 *boundary_data)
     : l_num_elements_(l_num_elements), r_num_elements_(r_num_elements),
       l_table_(l_table), r_table_(r_table),
       bitarray_num_bytes_(bitarray_num_bytes),
-      bitarray_data_(bitarray_data), boundary_data_(boundary_data) {
+      bitarray_data_(bitarray_data), boundary_data_(boundary_data),
+      dense_data_(nullptr), dense_row_bits_(0), dense_num_rids_(0),
+      dense_num_lids_(0) {
   DCHECK(l_table_);
   DCHECK(r_table_);
   DCHECK(bitarray_data_);
   DCHECK(boundary_data_);
   CHECK_LE(l_num_elements_ * r_num_elements_, bitarray_num_bytes_ * 8);
+  if (dense_data != nullptr) {
+    InitDenseBitarray(dense_data, dense_size);
+  }
 }
 
 Segmenter::~Segmenter() {}
 
+bool Segmenter::InitDenseBitarray(const char *dense_data, size_t dense_size) {
+  if (dense_size < kDenseHeaderSize) {
+    LOG(ERROR) << "Dense segmenter data is too short: " << dense_size;
+    return false;
+  }
+  const uint16 *header = reinterpret_cast<const uint16 *>(dense_data);
+  const size_t num_rids = header[1];
+  const size_t num_lids = header[2];
+  const size_t row_bytes = header[3];
+  if (header[0] != kDenseSegmenterMagicNumber ||
+      row_bytes % kDenseHeaderSize != 0 || row_bytes * 8 < num_rids ||
+      dense_size != kDenseHeaderSize + row_bytes * num_lids) {
+    LOG(ERROR) << "Dense segmenter data is broken";
+    return false;
+  }
+  dense_data_ = dense_data + kDenseHeaderSize;
+  dense_row_bits_ = row_bytes * 8;
+  dense_num_rids_ = num_rids;
+  dense_num_lids_ = num_lids;
+  return true;
+}
+
 bool Segmenter::IsBoundary(const Node &lnode, const Node &rnode,
                            bool is_single_segment) const {
   if (lnode.node_type == Node::BOS_NODE ||
@@ -102,11 +154,34 @@ bool Segmenter::IsBoundary(const Node &lnode, const Node &rnode,
 }
 
 bool Segmenter::IsBoundary(uint16 rid, uint16 lid) const {
+  if (dense_data_ != nullptr) {
+    DCHECK_LT(rid, dense_num_rids_);
+    DCHECK_LT(lid, dense_num_lids_);
+    return BitArray::GetValue(dense_data_, dense_row_bits_ * lid + rid);
+  }
   const uint32 bitarray_index = l_table_[rid] + l_num_elements_ * r_table_[lid];
   return BitArray::GetValue(reinterpret_cast<const char*>(bitarray_data_),
                             bitarray_index);
 }
 
+void Segmenter::IsBoundary(const uint16 *rids, size_t size, uint16 lid,
+                           bool *boundaries) const {
+  if (dense_data_ != nullptr) {
+    DCHECK_LT(lid, dense_num_lids_);
+    const char *row = dense_data_ + dense_row_bits_ / 8 * lid;
+    for (size_t i = 0; i < size; ++i) {
+      DCHECK_LT(rids[i], dense_num_rids_);
+      boundaries[i] = BitArray::GetValue(row, rids[i]);
+    }
+    return;
+  }
+  const uint32 column_offset = l_num_elements_ * r_table_[lid];
+  for (size_t i = 0; i < size; ++i) {
+    boundaries[i] =
+        BitArray::GetValue(bitarray_data_, l_table_[rids[i]] + column_offset);
+  }
+}
+
 int32 Segmenter::GetPrefixPenalty(uint16 lid) const {
   return boundary_data_[2 * lid];
 }
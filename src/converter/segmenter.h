@@ -47,15 +47,33 @@ class Segmenter {
             const uint16 *l_table, const uint16 *r_table,
             size_t bitarray_num_bytes, const char *bitarray_data,
             const uint16 *boundary_data);
+
+  // Answers IsBoundary() from the uncompressed bit-array |dense_data|
+  // (generated by gen_segmenter_bitarray.cc with --output_dense_bitarray),
+  // which is indexed by (lid, rid) directly.  Falls back to the compressed
+  // bit-array if |dense_data| is nullptr or broken.
+  Segmenter(size_t l_num_elements, size_t r_num_elements,
+            const uint16 *l_table, const uint16 *r_table,
+            size_t bitarray_num_bytes, const char *bitarray_data,
+            const char *dense_data, size_t dense_size,
+            const uint16 *boundary_data);
   ~Segmenter();
 
   bool IsBoundary(const Node &lnode, const Node &rnode,
                   bool is_single_segment) const;
   bool IsBoundary(uint16 rid, uint16 lid) const;
+
+  // Batched version of IsBoundary(rid, lid) for one |lid|: sets
+  // |boundaries[i]| to IsBoundary(rids[i], lid) for i in [0, size).
+  void IsBoundary(const uint16 *rids, size_t size, uint16 lid,
+                  bool *boundaries) const;
+
   int32 GetPrefixPenalty(uint16 lid) const;
   int32 GetSuffixPenalty(uint16 rid) const;
 
  private:
+  bool InitDenseBitarray(const char *dense_data, size_t dense_size);
+
   const size_t l_num_elements_;
   const size_t r_num_elements_;
   const uint16 *l_table_;
@@ -64,6 +82,13 @@ class Segmenter {
   const char *bitarray_data_;
   const uint16 *boundary_data_;
 
+  // Uncompressed bit-array of |dense_num_lids_| rows, each of which holds
+  // |dense_num_rids_| bits and is padded to |dense_row_bits_|, or nullptr.
+  const char *dense_data_;
+  size_t dense_row_bits_;
+  size_t dense_num_rids_;
+  size_t dense_num_lids_;
+
   DISALLOW_COPY_AND_ASSIGN(Segmenter);
 };
 
@@ -32,6 +32,7 @@
 #include <algorithm>
 #include <sstream>  // For DebugString()
 #include <string>
+#include <utility>
 
 #include "base/logging.h"
 #include "base/util.h"
@@ -270,7 +271,7 @@ size_t Segment::candidates_size() const {
 }
 
 void Segment::clear_candidates() {
-  pool_->Free();
+  pool_->Reset();
   candidates_.clear();
 }
 
@@ -419,6 +420,98 @@ void Segment::move_candidate(int old_idx, int new_idx) {
   }
 }
 
+Segment::CandidateEditor::CandidateEditor(Segment *segment)
+    : segment_(segment),
+      states_(segment->candidates_size(), KEEP) {
+  DCHECK(segment_);
+}
+
+Segment::CandidateEditor::~CandidateEditor() {
+  Apply();
+}
+
+Segment::Candidate *Segment::CandidateEditor::Insert(int pos) {
+  const int size = static_cast<int>(states_.size());
+  if (pos < 0 || pos > size) {
+    LOG(DFATAL) << "Invalid insert position: " << pos << " / " << size;
+    pos = std::min(std::max(pos, 0), size);
+  }
+  Candidate *candidate = segment_->pool_->Alloc();
+  candidate->Init();
+  const Placement placement = {pos, candidate};
+  placements_.push_back(placement);
+  return candidate;
+}
+
+void Segment::CandidateEditor::Move(int from, int pos) {
+  const int size = static_cast<int>(states_.size());
+  if (from < 0 || from >= size || pos < 0 || pos > size) {
+    LOG(DFATAL) << "Invalid move: " << from << " -> " << pos
+                << " / " << size;
+    return;
+  }
+  if (states_[from] != KEEP) {
+    LOG(DFATAL) << "Candidate " << from << " is already moved or erased";
+    return;
+  }
+  states_[from] = MOVED;
+  const Placement placement = {pos, segment_->candidates_[from]};
+  placements_.push_back(placement);
+}
+
+void Segment::CandidateEditor::Erase(int i) {
+  if (i < 0 || i >= static_cast<int>(states_.size())) {
+    LOG(DFATAL) << "Invalid erase position: " << i << " / " << states_.size();
+    return;
+  }
+  if (states_[i] != KEEP) {
+    LOG(DFATAL) << "Candidate " << i << " is already moved or erased";
+    return;
+  }
+  states_[i] = ERASED;
+}
+
+void Segment::CandidateEditor::Apply() {
+  const bool has_erasure =
+      std::find(states_.begin(), states_.end(), ERASED) != states_.end();
+  if (placements_.empty() && !has_erasure) {
+    return;
+  }
+
+  std::stable_sort(placements_.begin(), placements_.end(),
+                   [](const Placement &lhs, const Placement &rhs) {
+                     return lhs.pos < rhs.pos;
+                   });
+
+  std::deque<Candidate *> &candidates = segment_->candidates_;
+  DCHECK_EQ(states_.size(), candidates.size())
+      << "Candidates are modified while an editor is in use";
+  std::deque<Candidate *> result;
+  std::vector<Placement>::const_iterator it = placements_.begin();
+  for (size_t i = 0; i < candidates.size(); ++i) {
+    for (; it != placements_.end() && it->pos == static_cast<int>(i); ++it) {
+      result.push_back(it->candidate);
+    }
+    switch (states_[i]) {
+      case KEEP:
+        result.push_back(candidates[i]);
+        break;
+      case ERASED:
+        segment_->pool_->Release(candidates[i]);
+        break;
+      case MOVED:
+        break;
+    }
+  }
+  for (; it != placements_.end(); ++it) {
+    result.push_back(it->candidate);
+  }
+  candidates.swap(result);
+
+  placements_.clear();
+  states_.assign(candidates.size(), KEEP);
+}
+
 void Segment::Clear() {
   clear_candidates();
   key_.clear();
@@ -607,6 +700,32 @@ void Segments::Clear() {
 }
 
 void Segments::CopyFrom(const Segments &src) {
+  CopyFromInternal(src, true);
+}
+
+void Segments::CopyFromWithoutConversionCandidates(const Segments &src) {
+  CopyFromInternal(src, false);
+}
+
+void Segments::Swap(Segments *other) {
+  DCHECK(other);
+  using std::swap;
+  swap(max_history_segments_size_, other->max_history_segments_size_);
+  swap(max_prediction_candidates_size_,
+       other->max_prediction_candidates_size_);
+  swap(max_conversion_candidates_size_,
+       other->max_conversion_candidates_size_);
+  swap(resized_, other->resized_);
+  swap(user_history_enabled_, other->user_history_enabled_);
+  swap(request_type_, other->request_type_);
+  pool_.swap(other->pool_);
+  segments_.swap(other->segments_);
+  revert_entries_.swap(other->revert_entries_);
+  cached_lattice_.swap(other->cached_lattice_);
+}
+
+void Segments::CopyFromInternal(const Segments &src,
+                                bool copy_conversion_candidates) {
   Clear();
   max_history_segments_size_ = src.max_history_segments_size();
   max_prediction_candidates_size_ = src.max_prediction_candidates_size();
@@ -616,9 +735,15 @@ void Segments::CopyFrom(const Segments &src) {
 
   request_type_ = src.request_type();
 
+  const size_t history_segments_size = src.history_segments_size();
   for (size_t i = 0; i < src.segments_size(); ++i) {
     Segment *segment = add_segment();
-    segment->CopyFrom(src.segment(i));
+    if (copy_conversion_candidates || i < history_segments_size) {
+      segment->CopyFrom(src.segment(i));
+    } else {
+      segment->set_key(src.segment(i).key());
+      segment->set_segment_type(src.segment(i).segment_type());
+    }
   }
 
   for (size_t i = 0; i < src.revert_entries_size(); ++i) {
@@ -628,7 +753,7 @@ void Segments::CopyFrom(const Segments &src) {
 }
 
 void Segments::clear_segments() {
-  pool_->Free();
+  pool_->Reset();
   resized_ = false;
   segments_.clear();
 }
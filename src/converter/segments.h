@@ -322,6 +322,7 @@ class Segment {
 
   // erase all candidates
   // do not erase meta candidates
+  // The candidate objects and their string buffers are kept for reuse.
   void clear_candidates();
 
   // meta candidates
@@ -337,6 +338,60 @@ class Segment {
   // move old_idx-th-candidate to new_index
   void move_candidate(int old_idx, int new_idx);
 
+  // Stages insertions, moves and erasures of candidates and applies them in
+  // a single pass, instead of shifting the deque on every
+  // insert_candidate(), move_candidate() or erase_candidate() call.
+  // Positions are always the indices before any staged edit, so
+  // candidate(i) keeps pointing to the same candidate until Apply() is
+  // called.  The destructor calls Apply() if it has not been called yet.
+  //
+  //   Segment::CandidateEditor editor(segment);
+  //   for (size_t i = 0; i < segment->candidates_size(); ++i) {
+  //     if (...) {
+  //       Segment::Candidate *c = editor.Insert(i + 1);  // after i-th
+  //       ...
+  //     }
+  //   }
+  //   editor.Apply();
+  class CandidateEditor {
+   public:
+    explicit CandidateEditor(Segment *segment);
+    ~CandidateEditor();
+
+    // Returns a new candidate which is placed before the |pos|-th
+    // candidate, or at the end if |pos| == candidates_size().  Candidates
+    // staged at the same position keep the order of the calls.
+    Candidate *Insert(int pos);
+
+    // Places the |from|-th candidate before the |pos|-th candidate.  Note
+    // that unlike move_candidate(), |pos| is an index before the move;
+    // move_candidate(i, j) with i < j corresponds to Move(i, j + 1).
+    void Move(int from, int pos);
+
+    // Erases the |i|-th candidate.
+    void Erase(int i);
+
+    // Applies the staged edits.  The editor can be reused afterwards; the
+    // positions then refer to the updated candidates.
+    void Apply();
+
+   private:
+    enum State {
+      KEEP,
+      MOVED,
+      ERASED,
+    };
+    struct Placement {
+      int pos;
+      Candidate *candidate;
+    };
+
+    Segment *segment_;
+    std::vector<Placement> placements_;
+    std::vector<State> states_;  // Indexed by the original position.
+    DISALLOW_COPY_AND_ASSIGN(CandidateEditor);
+  };
+
   void Clear();
   void CopyFrom(const Segment &src);
 
@@ -474,6 +529,15 @@ class Segments {
   // Copy segments from src
   void CopyFrom(const Segments &src);
 
+  // Same as CopyFrom(), but copies the conversion segments without their
+  // candidates.  Use this for a working copy which only reads the history
+  // and the keys, or which is converted again, so that the candidates and
+  // their strings are not copied.
+  void CopyFromWithoutConversionCandidates(const Segments &src);
+
+  // Exchanges the contents with |other| without copying them.
+  void Swap(Segments *other);
+
   // Dump Segments structure
   string DebugString() const;
 
@@ -491,6 +555,8 @@ class Segments {
   virtual ~Segments();
 
  private:
+  void CopyFromInternal(const Segments &src, bool copy_conversion_candidates);
+
   size_t max_history_segments_size_;
   size_t max_prediction_candidates_size_;
   size_t max_conversion_candidates_size_;
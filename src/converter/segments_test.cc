@@ -410,6 +410,63 @@ TEST(SegmentsTest, CopyFromTest) {
   }
 }
 
+TEST(SegmentsTest, CopyFromWithoutConversionCandidates) {
+  Segments src;
+  src.set_max_conversion_candidates_size(2);
+  src.set_request_type(Segments::PREDICTION);
+
+  Segment *history = src.add_segment();
+  history->set_key("history");
+  history->set_segment_type(Segment::HISTORY);
+  history->add_candidate()->value = "history_value";
+
+  Segment *conversion = src.add_segment();
+  conversion->set_key("conversion");
+  conversion->add_candidate()->value = "conversion_value";
+  conversion->add_meta_candidate()->value = "meta_value";
+
+  Segments dest;
+  dest.CopyFromWithoutConversionCandidates(src);
+  EXPECT_EQ(src.max_conversion_candidates_size(),
+            dest.max_conversion_candidates_size());
+  EXPECT_EQ(src.request_type(), dest.request_type());
+  ASSERT_EQ(1, dest.history_segments_size());
+  ASSERT_EQ(1, dest.conversion_segments_size());
+  EXPECT_EQ("history", dest.history_segment(0).key());
+  ASSERT_EQ(1, dest.history_segment(0).candidates_size());
+  EXPECT_EQ("history_value", dest.history_segment(0).candidate(0).value);
+  EXPECT_EQ("conversion", dest.conversion_segment(0).key());
+  EXPECT_EQ(Segment::FREE, dest.conversion_segment(0).segment_type());
+  EXPECT_EQ(0, dest.conversion_segment(0).candidates_size());
+  EXPECT_EQ(0, dest.conversion_segment(0).meta_candidates_size());
+}
+
+TEST(SegmentsTest, Swap) {
+  Segments lhs;
+  lhs.set_request_type(Segments::PREDICTION);
+  lhs.add_segment()->set_key("lhs");
+  lhs.mutable_segment(0)->add_candidate()->value = "lhs_value";
+
+  Segments rhs;
+  rhs.set_request_type(Segments::CONVERSION);
+  rhs.add_segment()->set_key("rhs0");
+  rhs.add_segment()->set_key("rhs1");
+  const Segment *rhs_segment = &rhs.segment(0);
+
+  lhs.Swap(&rhs);
+  EXPECT_EQ(Segments::CONVERSION, lhs.request_type());
+  ASSERT_EQ(2, lhs.segments_size());
+  EXPECT_EQ("rhs0", lhs.segment(0).key());
+  EXPECT_EQ("rhs1", lhs.segment(1).key());
+  // The segments are moved, not copied.
+  EXPECT_EQ(rhs_segment, &lhs.segment(0));
+
+  EXPECT_EQ(Segments::PREDICTION, rhs.request_type());
+  ASSERT_EQ(1, rhs.segments_size());
+  EXPECT_EQ("lhs", rhs.segment(0).key());
+  EXPECT_EQ("lhs_value", rhs.segment(0).candidate(0).value);
+}
+
 TEST(CandidateTest, functional_key) {
   Segment::Candidate candidate;
   candidate.Init();
@@ -520,6 +577,27 @@ TEST(CandidateTest, InnerSegmentIterator) {
   }
 }
 
+TEST(SegmentTest, ClearCandidatesKeepsCandidatesForReuse) {
+  Segment segment;
+  std::vector<const Segment::Candidate *> candidates;
+  for (int i = 0; i < 100; ++i) {
+    Segment::Candidate *candidate = segment.add_candidate();
+    candidate->value = "a long value which doesn't fit in the inline buffer";
+    candidates.push_back(candidate);
+  }
+
+  segment.clear_candidates();
+  EXPECT_EQ(0, segment.candidates_size());
+
+  // The same objects are initialized and handed out again.
+  for (int i = 0; i < 100; ++i) {
+    const Segment::Candidate *candidate = segment.add_candidate();
+    EXPECT_EQ(candidates[i], candidate);
+    EXPECT_TRUE(candidate->value.empty());
+    EXPECT_EQ(0, candidate->cost);
+  }
+}
+
 TEST(SegmentTest, CopyFrom) {
   Segment src, dest;
 
@@ -541,6 +619,80 @@ TEST(SegmentTest, CopyFrom) {
   EXPECT_EQ(src.meta_candidate(0).key, dest.meta_candidate(0).key);
 }
 
+namespace {
+string CandidateValues(const Segment &segment) {
+  string result;
+  for (size_t i = 0; i < segment.candidates_size(); ++i) {
+    result += segment.candidate(i).value;
+  }
+  return result;
+}
+}  // namespace
+
+TEST(SegmentTest, CandidateEditor) {
+  Segment segment;
+  for (char c = 'a'; c <= 'e'; ++c) {
+    segment.add_candidate()->value = string(1, c);
+  }
+
+  {
+    Segment::CandidateEditor editor(&segment);
+    // Positions refer to the candidates before editing.
+    editor.Insert(1)->value = "1";
+    editor.Insert(1)->value = "2";
+    editor.Insert(5)->value = "3";
+    editor.Erase(2);
+    editor.Move(4, 0);
+    // Nothing is changed until Apply().
+    EXPECT_EQ("abcde", CandidateValues(segment));
+    editor.Apply();
+    EXPECT_EQ("ea12bd3", CandidateValues(segment));
+
+    // The editor can be reused with the updated positions.
+    editor.Move(0, 7);
+    editor.Insert(0)->value = "4";
+    // Applied by the destructor.
+  }
+  EXPECT_EQ("4a12bd3e", CandidateValues(segment));
+}
+
+TEST(SegmentTest, CandidateEditorMatchesMoveCandidate) {
+  const int kSize = 6;
+  for (int from = 0; from < kSize; ++from) {
+    for (int to = 0; to < kSize; ++to) {
+      Segment expected, actual;
+      for (int i = 0; i < kSize; ++i) {
+        expected.add_candidate()->value = string(1, 'a' + i);
+        actual.add_candidate()->value = string(1, 'a' + i);
+      }
+      expected.move_candidate(from, to);
+      Segment::CandidateEditor editor(&actual);
+      editor.Move(from, to > from ? to + 1 : to);
+      editor.Apply();
+      EXPECT_EQ(CandidateValues(expected), CandidateValues(actual))
+          << from << " -> " << to;
+    }
+  }
+}
+
+TEST(SegmentTest, CandidateEditorManyInsertions) {
+  Segment segment;
+  const int kSize = 1000;
+  for (int i = 0; i < kSize; ++i) {
+    segment.add_candidate()->cost = 2 * i;
+  }
+  {
+    Segment::CandidateEditor editor(&segment);
+    for (int i = 0; i < kSize; ++i) {
+      editor.Insert(i + 1)->cost = 2 * i + 1;
+    }
+  }
+  ASSERT_EQ(2 * kSize, segment.candidates_size());
+  for (int i = 0; i < 2 * kSize; ++i) {
+    EXPECT_EQ(i, segment.candidate(i).cost);
+  }
+}
+
 TEST(SegmentTest, MetaCandidateTest) {
   Segment segment;
 
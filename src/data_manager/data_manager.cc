@@ -30,22 +30,57 @@
 #include "data_manager/data_manager.h"
 
 #include <algorithm>
+#include <atomic>
 #include <ostream>
 
+#include "base/flags.h"
+#include "base/hash.h"
 #include "base/logging.h"
 #include "base/serialized_string_array.h"
 #include "base/stl_util.h"
+#include "base/thread.h"
 #include "base/util.h"
 #include "base/version.h"
 #include "data_manager/dataset_reader.h"
 #include "data_manager/serialized_dictionary.h"
 #include "protocol/segmenter_data.pb.h"
 
+DEFINE_bool(warm_up_data_set, false,
+            "Touch the hot sections of a data set file in background after "
+            "it is loaded.");
+DEFINE_bool(verify_data_set_sections, false,
+            "Verify the checksums of the hot sections of a data set file while "
+            "touching them in background.");
+
 namespace mozc {
 namespace {
 
 const char * const kDataSetMagicNumber = "\xEFMOZC\r\n";
 
+// Flags of the sections in DataManager::InitFromReader.
+enum SectionFlags {
+  // The data set is broken without it.
+  REQUIRED = 1,
+  // Accessed by every conversion.  Other sections (e.g., emoji or usage data)
+  // are accessed only by specific rewriters.
+  HOT = 2,
+  // Required only if the usage dictionary is provided.
+  USAGE = 4,
+};
+
+DataManager::Status VerifyUserPosManagerData(
+    StringPiece user_pos_token_array_data,
+    StringPiece user_pos_string_array_data) {
+  if (user_pos_token_array_data.size() % 8 != 0 ||
+      !SerializedStringArray::VerifyData(user_pos_string_array_data)) {
+    LOG(ERROR) << "User POS data is broken: token array data size = "
+               << user_pos_token_array_data.size() << ", string array size = "
+               << user_pos_string_array_data.size();
+    return DataManager::Status::DATA_BROKEN;
+  }
+  return DataManager::Status::OK;
+}
+
 DataManager::Status InitUserPosManagerDataFromReader(
     const DataSetReader &reader,
     StringPiece *pos_matcher_data,
@@ -63,14 +98,23 @@ DataManager::Status InitUserPosManagerDataFromReader(
     LOG(ERROR) << "Cannot find a user POS string array";
     return DataManager::Status::DATA_MISSING;
   }
-  if (user_pos_token_array_data->size() % 8 != 0 ||
-      !SerializedStringArray::VerifyData(*user_pos_string_array_data)) {
-    LOG(ERROR) << "User POS data is broken: token array data size = "
-               << user_pos_token_array_data->size() << ", string array size = "
-               << user_pos_string_array_data->size();
-    return DataManager::Status::DATA_BROKEN;
+  return VerifyUserPosManagerData(*user_pos_token_array_data,
+                                  *user_pos_string_array_data);
+}
+
+// Finds the section of |name| in |sections| sorted by their names.
+StringPiece FindNamedSection(
+    const std::vector<std::pair<string, StringPiece>> &sections,
+    const string &name) {
+  const auto iter = std::lower_bound(
+      sections.begin(), sections.end(), name,
+      [](const std::pair<string, StringPiece> &elem, const string &key) {
+        return elem.first < key;
+      });
+  if (iter == sections.end() || iter->first != name) {
+    return StringPiece();
   }
-  return DataManager::Status::OK;
+  return iter->second;
 }
 
 }  // namespace
@@ -101,8 +145,53 @@ string DataManager::StatusCodeToString(Status code) {
   return s;
 }
 
+class DataManager::WarmUpThread : public Thread {
+ public:
+  WarmUpThread(const std::vector<SectionData> &sections, bool verify)
+      : sections_(sections), verify_(verify), canceled_(false) {}
+  ~WarmUpThread() override = default;
+
+  void Run() override {
+    // Paging in ahead is never urgent.
+    Thread::LowerCurrentThreadPriority();
+    // Touch in small chunks so that Cancel() doesn't wait for long.
+    const size_t kChunkSize = 1 << 20;
+    for (const SectionData &section : sections_) {
+      // Reading the data for the checksum pages it in as touching does.
+      const bool verify = verify_ && section.has_crc32c;
+      uint32 crc32c = 0;
+      const StringPiece data = section.data;
+      for (size_t offset = 0; offset < data.size(); offset += kChunkSize) {
+        if (canceled_.load(std::memory_order_relaxed)) {
+          return;
+        }
+        const StringPiece chunk = data.substr(offset, kChunkSize);
+        if (verify) {
+          crc32c = Hash::ExtendCrc32c(crc32c, chunk);
+        } else {
+          Mmap::Touch(chunk.data(), chunk.size());
+        }
+      }
+      LOG_IF(ERROR, verify && crc32c != section.crc32c)
+          << "Broken: CRC-32C mismatch for " << section.name;
+    }
+  }
+
+  void Cancel() { canceled_.store(true, std::memory_order_relaxed); }
+
+ private:
+  const std::vector<SectionData> sections_;
+  const bool verify_;
+  std::atomic<bool> canceled_;
+
+  DISALLOW_COPY_AND_ASSIGN(WarmUpThread);
+};
+
 DataManager::DataManager() = default;
-DataManager::~DataManager() = default;
+
+DataManager::~DataManager() {
+  StopWarmUp();
+}
 
 DataManager::Status DataManager::InitFromArray(StringPiece array) {
   return InitFromArray(array, kDataSetMagicNumber);
@@ -115,45 +204,128 @@ DataManager::Status DataManager::InitFromArray(StringPiece array,
     LOG(ERROR) << "Binary data of size " << array.size() << " is broken";
     return DataManager::Status::DATA_BROKEN;
   }
-  return InitFromReader(reader);
+  const Status status = InitFromReader(reader);
+  if (status == Status::OK) {
+    image_ = array;
+    AdviseAccessPattern();
+  }
+  return status;
 }
 
 DataManager::Status DataManager::InitFromReader(const DataSetReader &reader) {
-  const Status status = InitUserPosManagerDataFromReader(
-      reader, &pos_matcher_data_, &user_pos_token_array_data_,
-      &user_pos_string_array_data_);
+  // The schema of the data set.  Every section is looked up only here; the
+  // getters just return the resolved pieces, and consumers rely on the
+  // verification below instead of verifying the data again.
+  struct Section {
+    const char *name;
+    StringPiece DataManager::*data;
+    int flags;
+  };
+  static const Section kSections[] = {
+    // Hot sections first, in the order they are warmed up.
+    {"conn_dense", &DataManager::dense_connection_data_, HOT},
+    {"conn", &DataManager::connection_data_, REQUIRED | HOT},
+    {"dict", &DataManager::dictionary_data_, REQUIRED | HOT},
+    {"segmenter_ltable", &DataManager::segmenter_ltable_, REQUIRED | HOT},
+    {"segmenter_rtable", &DataManager::segmenter_rtable_, REQUIRED | HOT},
+    {"segmenter_bitarray", &DataManager::segmenter_bitarray_, REQUIRED | HOT},
+    {"segmenter_dense", &DataManager::segmenter_dense_bitarray_, HOT},
+    {"bdry", &DataManager::boundary_data_, REQUIRED | HOT},
+    {"pos_matcher", &DataManager::pos_matcher_data_, REQUIRED | HOT},
+    {"posg", &DataManager::pos_group_data_, REQUIRED | HOT},
+    {"sugg", &DataManager::suggestion_filter_data_, REQUIRED | HOT},
+    {"suffix_key", &DataManager::suffix_key_array_data_, REQUIRED | HOT},
+    {"suffix_value", &DataManager::suffix_value_array_data_, REQUIRED | HOT},
+    {"suffix_token", &DataManager::suffix_token_array_data_, REQUIRED | HOT},
+    {"user_pos_token", &DataManager::user_pos_token_array_data_, REQUIRED},
+    {"user_pos_string", &DataManager::user_pos_string_array_data_, REQUIRED},
+    {"coll", &DataManager::collocation_data_, REQUIRED},
+    {"cols", &DataManager::collocation_suppression_data_, REQUIRED},
+    {"counter_suffix", &DataManager::counter_suffix_data_, REQUIRED},
+    {"reading_correction_value",
+     &DataManager::reading_correction_value_array_data_, REQUIRED},
+    {"reading_correction_error",
+     &DataManager::reading_correction_error_array_data_, REQUIRED},
+    {"reading_correction_correction",
+     &DataManager::reading_correction_correction_array_data_, REQUIRED},
+    {"symbol_token", &DataManager::symbol_token_array_data_, REQUIRED},
+    {"symbol_string", &DataManager::symbol_string_array_data_, REQUIRED},
+    {"emoticon_token", &DataManager::emoticon_token_array_data_, REQUIRED},
+    {"emoticon_string", &DataManager::emoticon_string_array_data_, REQUIRED},
+    {"emoji_token", &DataManager::emoji_token_array_data_, REQUIRED},
+    {"emoji_string", &DataManager::emoji_string_array_data_, REQUIRED},
+    {"single_kanji_token", &DataManager::single_kanji_token_array_data_,
+     REQUIRED},
+    {"single_kanji_string", &DataManager::single_kanji_string_array_data_,
+     REQUIRED},
+    {"single_kanji_variant_type",
+     &DataManager::single_kanji_variant_type_data_, REQUIRED},
+    {"single_kanji_variant_token",
+     &DataManager::single_kanji_variant_token_array_data_, REQUIRED},
+    {"single_kanji_variant_string",
+     &DataManager::single_kanji_variant_string_array_data_, REQUIRED},
+    {"single_kanji_noun_prefix_token",
+     &DataManager::single_kanji_noun_prefix_token_array_data_, REQUIRED},
+    {"single_kanji_noun_prefix_string",
+     &DataManager::single_kanji_noun_prefix_string_array_data_, REQUIRED},
+    {"zero_query_token_array", &DataManager::zero_query_token_array_data_,
+     REQUIRED},
+    {"zero_query_string_array", &DataManager::zero_query_string_array_data_,
+     REQUIRED},
+    {"zero_query_number_token_array",
+     &DataManager::zero_query_number_token_array_data_, REQUIRED},
+    {"zero_query_number_string_array",
+     &DataManager::zero_query_number_string_array_data_, REQUIRED},
+    {"usage_item_array", &DataManager::usage_items_data_, 0},
+    {"usage_base_conjugation_suffix",
+     &DataManager::usage_base_conjugation_suffix_data_, USAGE},
+    {"usage_conjugation_suffix", &DataManager::usage_conjugation_suffix_data_,
+     USAGE},
+    {"usage_conjugation_index", &DataManager::usage_conjugation_index_data_,
+     USAGE},
+    {"usage_string_array", &DataManager::usage_string_array_data_, USAGE},
+    // The sorted indices are optional; UsageRewriter builds them in heap for
+    // data sets without them.
+    {"usage_key_value_index", &DataManager::usage_key_value_index_data_, 0},
+    {"usage_value_index", &DataManager::usage_value_index_data_, 0},
+    {"version", &DataManager::data_version_, REQUIRED},
+  };
+
+  sections_.clear();
+  hot_sections_.clear();
+  for (const auto &kv : reader.name_to_data_map()) {
+    sections_.push_back(GetSectionData(reader, kv.first, kv.second));
+  }
+  bool has_usage_dictionary = false;
+  const char *missing_usage_section = nullptr;
+  for (const Section &section : kSections) {
+    StringPiece *data = &(this->*section.data);
+    data->clear();
+    if (!reader.Get(section.name, data)) {
+      if (section.flags & REQUIRED) {
+        LOG(ERROR) << "Cannot find " << section.name << " in the data set";
+        return Status::DATA_MISSING;
+      }
+      if (section.flags & USAGE) {
+        missing_usage_section = section.name;
+      }
+      VLOG(2) << section.name << " is not provided";
+      continue;
+    }
+    if (section.flags & HOT) {
+      hot_sections_.push_back(GetSectionData(reader, section.name, *data));
+    }
+    if (section.data == &DataManager::usage_items_data_) {
+      has_usage_dictionary = true;
+    }
+  }
+
+  const Status status = VerifyUserPosManagerData(user_pos_token_array_data_,
+                                                 user_pos_string_array_data_);
   if (status != Status::OK) {
     LOG(ERROR) << "User POS manager data is broken";
     return status;
   }
-  if (!reader.Get("conn", &connection_data_)) {
-    LOG(ERROR) << "Cannot find a connection data";
-    return Status::DATA_MISSING;
-  }
-  if (!reader.Get("dict", &dictionary_data_)) {
-    LOG(ERROR) << "Cannot find a dictionary data";
-    return Status::DATA_MISSING;
-  }
-  if (!reader.Get("sugg", &suggestion_filter_data_)) {
-    LOG(ERROR) << "Cannot find a suggestion filter data";
-    return Status::DATA_MISSING;
-  }
-  if (!reader.Get("coll", &collocation_data_)) {
-    LOG(ERROR) << "Cannot find a collocation data";
-    return Status::DATA_MISSING;
-  }
-  if (!reader.Get("cols", &collocation_suppression_data_)) {
-    LOG(ERROR) << "Cannot find a collocation suprression data";
-    return Status::DATA_MISSING;
-  }
-  if (!reader.Get("posg", &pos_group_data_)) {
-    LOG(ERROR) << "Cannot find a POS group data";
-    return Status::DATA_MISSING;
-  }
-  if (!reader.Get("bdry", &boundary_data_)) {
-    LOG(ERROR) << "Cannot find a boundary data";
-    return Status::DATA_MISSING;
-  }
   {
     StringPiece memblock;
     if (!reader.Get("segmenter_sizeinfo", &memblock)) {
@@ -168,38 +340,10 @@ DataManager::Status DataManager::InitFromReader(const DataSetReader &reader) {
     segmenter_compressed_lsize_ = sizeinfo.compressed_lsize();
     segmenter_compressed_rsize_ = sizeinfo.compressed_rsize();
   }
-  if (!reader.Get("segmenter_ltable", &segmenter_ltable_)) {
-    LOG(ERROR) << "Cannot find a segmenter ltable";
-    return Status::DATA_MISSING;
-  }
-  if (!reader.Get("segmenter_rtable", &segmenter_rtable_)) {
-    LOG(ERROR) << "Cannot find a segmenter rtable";
-    return Status::DATA_MISSING;
-  }
-  if (!reader.Get("segmenter_bitarray", &segmenter_bitarray_)) {
-    LOG(ERROR) << "Cannot find a segmenter bit-array";
-    return Status::DATA_MISSING;
-  }
-  if (!reader.Get("counter_suffix", &counter_suffix_data_)) {
-    LOG(ERROR) << "Cannot find a counter suffix data";
-    return Status::DATA_MISSING;
-  }
   if (!SerializedStringArray::VerifyData(counter_suffix_data_)) {
     LOG(ERROR) << "Counter suffix string array is broken";
     return Status::DATA_MISSING;
   }
-  if (!reader.Get("suffix_key", &suffix_key_array_data_)) {
-    LOG(ERROR) << "Cannot find a suffix key array";
-    return Status::DATA_MISSING;
-  }
-  if (!reader.Get("suffix_value", &suffix_value_array_data_)) {
-    LOG(ERROR) << "Cannot find a suffix value array";
-    return Status::DATA_MISSING;
-  }
-  if (!reader.Get("suffix_token", &suffix_token_array_data_)) {
-    LOG(ERROR) << "Cannot find a suffix token array";
-    return Status::DATA_MISSING;
-  }
   {
     SerializedStringArray suffix_keys, suffix_values;
     if (!suffix_keys.Init(suffix_key_array_data_) ||
@@ -213,21 +357,6 @@ DataManager::Status DataManager::InitFromReader(const DataSetReader &reader) {
       return Status::DATA_BROKEN;
     }
   }
-  if (!reader.Get("reading_correction_value",
-                  &reading_correction_value_array_data_)) {
-    LOG(ERROR) << "Cannot find reading correction value array";
-    return Status::DATA_MISSING;
-  }
-  if (!reader.Get("reading_correction_error",
-                  &reading_correction_error_array_data_)) {
-    LOG(ERROR) << "Cannot find reading correction error array";
-    return Status::DATA_MISSING;
-  }
-  if (!reader.Get("reading_correction_correction",
-                  &reading_correction_correction_array_data_)) {
-    LOG(ERROR) << "Cannot find reading correction correction array";
-    return Status::DATA_MISSING;
-  }
   {
     SerializedStringArray value_array, error_array, correction_array;
     if (!value_array.Init(reading_correction_value_array_data_) ||
@@ -239,61 +368,20 @@ DataManager::Status DataManager::InitFromReader(const DataSetReader &reader) {
       return Status::DATA_BROKEN;
     }
   }
-  if (!reader.Get("symbol_token", &symbol_token_array_data_)) {
-    LOG(ERROR) << "Cannot find a symbol token array";
-    return Status::DATA_MISSING;
-  }
-  if (!reader.Get("symbol_string", &symbol_string_array_data_)) {
-    LOG(ERROR) << "Cannot find a symbol string array or data is broken";
-    return Status::DATA_MISSING;
-  }
   if (!SerializedDictionary::VerifyData(symbol_token_array_data_,
                                         symbol_string_array_data_)) {
     LOG(ERROR) << "Symbol dictionary data is broken";
     return Status::DATA_BROKEN;
   }
-  if (!reader.Get("emoticon_token", &emoticon_token_array_data_)) {
-    LOG(ERROR) << "Cannot find an emoticon token array";
-    return Status::DATA_MISSING;
-  }
-  if (!reader.Get("emoticon_string", &emoticon_string_array_data_)) {
-    LOG(ERROR) << "Cannot find an emoticon string array or data is broken";
-    return Status::DATA_MISSING;
-  }
   if (!SerializedDictionary::VerifyData(emoticon_token_array_data_,
                                         emoticon_string_array_data_)) {
     LOG(ERROR) << "Emoticon dictionary data is broken";
     return Status::DATA_BROKEN;
   }
-  if (!reader.Get("emoji_token", &emoji_token_array_data_)) {
-    LOG(ERROR) << "Cannot find an emoji token array";
-    return Status::DATA_MISSING;
-  }
-  if (!reader.Get("emoji_string", &emoji_string_array_data_)) {
-    LOG(ERROR) << "Cannot find an emoji string array or data is broken";
-    return Status::DATA_MISSING;
-  }
   if (!SerializedStringArray::VerifyData(emoji_string_array_data_)) {
     LOG(ERROR) << "Emoji rewriter string array data is broken";
     return Status::DATA_BROKEN;
   }
-  if (!reader.Get("single_kanji_token",
-                  &single_kanji_token_array_data_) ||
-      !reader.Get("single_kanji_string",
-                  &single_kanji_string_array_data_) ||
-      !reader.Get("single_kanji_variant_type",
-                  &single_kanji_variant_type_data_) ||
-      !reader.Get("single_kanji_variant_token",
-                  &single_kanji_variant_token_array_data_) ||
-      !reader.Get("single_kanji_variant_string",
-                  &single_kanji_variant_string_array_data_) ||
-      !reader.Get("single_kanji_noun_prefix_token",
-                  &single_kanji_noun_prefix_token_array_data_) ||
-      !reader.Get("single_kanji_noun_prefix_string",
-                  &single_kanji_noun_prefix_string_array_data_)) {
-    LOG(ERROR) << "Cannot find single Kanji rewriter data";
-    return Status::DATA_MISSING;
-  }
   if (!SerializedStringArray::VerifyData(single_kanji_string_array_data_) ||
       !SerializedStringArray::VerifyData(single_kanji_variant_type_data_) ||
       !SerializedStringArray::VerifyData(
@@ -304,58 +392,62 @@ DataManager::Status DataManager::InitFromReader(const DataSetReader &reader) {
     LOG(ERROR) << "Single Kanji data is broken";
     return Status::DATA_BROKEN;
   }
-  if (!reader.Get("zero_query_token_array",
-                  &zero_query_token_array_data_) ||
-      !reader.Get("zero_query_string_array",
-                  &zero_query_string_array_data_) ||
-      !reader.Get("zero_query_number_token_array",
-                  &zero_query_number_token_array_data_) ||
-      !reader.Get("zero_query_number_string_array",
-                  &zero_query_number_string_array_data_)) {
-    LOG(ERROR) << "Cannot find zero query data";
-    return Status::DATA_MISSING;
-  }
   if (!SerializedStringArray::VerifyData(zero_query_string_array_data_) ||
       !SerializedStringArray::VerifyData(
           zero_query_number_string_array_data_)) {
     LOG(ERROR) << "Zero query data is broken";
     return Status::DATA_BROKEN;
   }
-
-  if (!reader.Get("usage_item_array", &usage_items_data_)) {
+  if (!has_usage_dictionary) {
     VLOG(2) << "Usage dictionary is not provided";
     // Usage dictionary is optional, so don't return false here.
+    for (const Section &section : kSections) {
+      if (Util::StartsWith(section.name, "usage_")) {
+        (this->*section.data).clear();
+      }
+    }
   } else {
-    if (!reader.Get("usage_base_conjugation_suffix",
-                    &usage_base_conjugation_suffix_data_) ||
-        !reader.Get("usage_conjugation_suffix",
-                    &usage_conjugation_suffix_data_) ||
-        !reader.Get("usage_conjugation_index",
-                    &usage_conjugation_index_data_) ||
-        !reader.Get("usage_string_array",
-                    &usage_string_array_data_)) {
-      LOG(ERROR) << "Cannot find some usage dictionary data components";
+    if (missing_usage_section != nullptr) {
+      LOG(ERROR) << "Cannot find usage dictionary data component "
+                 << missing_usage_section;
       return Status::DATA_MISSING;
     }
     if (!SerializedStringArray::VerifyData(usage_string_array_data_)) {
       LOG(ERROR) << "Usage dictionary's string array is broken";
       return Status::DATA_BROKEN;
     }
+    if (!usage_key_value_index_data_.empty() &&
+        !usage_value_index_data_.empty()) {
+      if (usage_key_value_index_data_.size() % 8 != 0 ||
+          usage_value_index_data_.size() % 8 != 0) {
+        LOG(ERROR) << "Usage dictionary's index is broken";
+        return Status::DATA_BROKEN;
+      }
+    } else {
+      usage_key_value_index_data_.clear();
+      usage_value_index_data_.clear();
+    }
   }
-
+  typing_model_data_.clear();
+  preedit_table_data_.clear();
   for (const auto &kv : reader.name_to_data_map()) {
-    if (!Util::StartsWith(kv.first, "typing_model")) {
-      continue;
+    if (Util::StartsWith(kv.first, "typing_model")) {
+      typing_model_data_.push_back(kv);
+    } else if (Util::StartsWith(kv.first, "preedit_")) {
+      // Four strings per rule; see composer/internal/gen_preedit_table.py.
+      SerializedStringArray rules;
+      if (!rules.Init(kv.second) || rules.size() % 4 != 0) {
+        LOG(ERROR) << "Preedit table " << kv.first << " is broken";
+        return Status::DATA_BROKEN;
+      }
+      preedit_table_data_.push_back(kv);
     }
-    typing_model_data_.push_back(kv);
   }
   std::sort(typing_model_data_.begin(), typing_model_data_.end(),
             OrderBy<FirstKey, Less>());
+  std::sort(preedit_table_data_.begin(), preedit_table_data_.end(),
+            OrderBy<FirstKey, Less>());
 
-  if (!reader.Get("version", &data_version_)) {
-    LOG(ERROR) << "Cannot find data version";
-    return Status::DATA_MISSING;
-  }
   {
     std::vector<StringPiece> components;
     Util::SplitStringUsing(data_version_, ".", &components);
@@ -380,12 +472,88 @@ DataManager::Status DataManager::InitFromFile(const string &path) {
 
 DataManager::Status DataManager::InitFromFile(const string &path,
                                               StringPiece magic) {
+  // The thread may be touching the current mapping.
+  StopWarmUp();
   if (!mmap_.Open(path.c_str(), "r")) {
     LOG(ERROR) << "Failed to mmap " << path;
     return Status::MMAP_FAILURE;
   }
   const StringPiece data(mmap_.begin(), mmap_.size());
-  return InitFromArray(data, magic);
+  const Status status = InitFromArray(data, magic);
+  if (status == Status::OK && FLAGS_warm_up_data_set) {
+    StartWarmUp();
+  }
+  return status;
+}
+
+void DataManager::AdviseAccessPattern() const {
+  // Tries and tables are looked up at random positions, so read-ahead of the
+  // whole image only pollutes the page cache.
+  Mmap::Advise(image_.data(), image_.size(), Mmap::RANDOM);
+  for (const SectionData &section : hot_sections_) {
+    Mmap::Advise(section.data.data(), section.data.size(), Mmap::WILL_NEED);
+  }
+}
+
+void DataManager::StartWarmUp() {
+  if (warm_up_thread_ || hot_sections_.empty()) {
+    return;
+  }
+  warm_up_thread_.reset(
+      new WarmUpThread(hot_sections_, FLAGS_verify_data_set_sections));
+  warm_up_thread_->SetJoinable(true);
+  warm_up_thread_->Start("DataManager::WarmUpThread");
+}
+
+size_t DataManager::TouchHotData(size_t max_bytes) const {
+  // |hot_sections_| are in the order of the section schema, which lists the
+  // ones of the conversion core first.
+  size_t touched = 0;
+  for (const SectionData &section : hot_sections_) {
+    if (touched >= max_bytes) {
+      break;
+    }
+    const StringPiece data = section.data.substr(0, max_bytes - touched);
+    Mmap::Touch(data.data(), data.size());
+    touched += data.size();
+  }
+  return touched;
+}
+
+bool DataManager::VerifySections() const {
+  for (const SectionData &section : sections_) {
+    if (!VerifySection(section)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+DataManager::SectionData DataManager::GetSectionData(
+    const DataSetReader &reader, const string &name, StringPiece data) {
+  SectionData section;
+  section.name = name;
+  section.data = data;
+  section.crc32c = 0;
+  section.has_crc32c = reader.GetCrc32c(name, &section.crc32c);
+  return section;
+}
+
+bool DataManager::VerifySection(const SectionData &section) {
+  if (section.has_crc32c && Hash::Crc32c(section.data) != section.crc32c) {
+    LOG(ERROR) << "Broken: CRC-32C mismatch for " << section.name;
+    return false;
+  }
+  return true;
+}
+
+void DataManager::StopWarmUp() {
+  if (!warm_up_thread_) {
+    return;
+  }
+  warm_up_thread_->Cancel();
+  warm_up_thread_->Join();
+  warm_up_thread_.reset();
 }
 
 DataManager::Status DataManager::InitUserPosManagerDataFromArray(
@@ -404,6 +572,7 @@ DataManager::Status DataManager::InitUserPosManagerDataFromArray(
 
 DataManager::Status DataManager::InitUserPosManagerDataFromFile(
     const string &path, StringPiece magic) {
+  StopWarmUp();
   if (!mmap_.Open(path.c_str(), "r")) {
     LOG(ERROR) << "Failed to mmap " << path;
     return Status::MMAP_FAILURE;
@@ -417,6 +586,13 @@ void DataManager::GetConnectorData(const char **data, size_t *size) const {
   *size = connection_data_.size();
 }
 
+void DataManager::GetDenseConnectorData(const char **data,
+                                        size_t *size) const {
+  *data = dense_connection_data_.empty() ? nullptr
+                                         : dense_connection_data_.data();
+  *size = dense_connection_data_.size();
+}
+
 void DataManager::GetSystemDictionaryData(const char **data, int *size) const {
   *data = dictionary_data_.data();
   *size = dictionary_data_.size();
@@ -466,6 +642,14 @@ void DataManager::GetSegmenterData(
   *boundary_data = reinterpret_cast<const uint16 *>(boundary_data_.data());
 }
 
+void DataManager::GetDenseSegmenterData(const char **data,
+                                        size_t *size) const {
+  *data = segmenter_dense_bitarray_.empty()
+              ? nullptr
+              : segmenter_dense_bitarray_.data();
+  *size = segmenter_dense_bitarray_.size();
+}
+
 void DataManager::GetSuffixDictionaryData(StringPiece *key_array_data,
                                           StringPiece *value_array_data,
                                           const uint32 **token_array) const {
@@ -548,18 +732,21 @@ void DataManager::GetUsageRewriterData(
   *usage_items_data = usage_items_data_;
   *string_array_data = usage_string_array_data_;
 }
+
+void DataManager::GetUsageRewriterIndexData(
+    StringPiece *key_value_index_data,
+    StringPiece *value_index_data) const {
+  *key_value_index_data = usage_key_value_index_data_;
+  *value_index_data = usage_value_index_data_;
+}
 #endif  // NO_USAGE_REWRITER
 
 StringPiece DataManager::GetTypingModel(const string &name) const {
-  const auto iter = std::lower_bound(
-      typing_model_data_.begin(), typing_model_data_.end(), name,
-      [](const std::pair<string, StringPiece> &elem, const string &key) {
-        return elem.first < key;
-      });
-  if (iter == typing_model_data_.end() || iter->first != name) {
-    return StringPiece();
-  }
-  return iter->second;
+  return FindNamedSection(typing_model_data_, name);
+}
+
+StringPiece DataManager::GetPreeditTable(const string &name) const {
+  return FindNamedSection(preedit_table_data_, name);
 }
 
 StringPiece DataManager::GetDataVersion() const {
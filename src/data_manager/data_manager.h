@@ -31,6 +31,7 @@
 #define MOZC_DATA_MANAGER_DATA_MANAGER_H_
 
 #include <iosfwd>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
@@ -84,11 +85,31 @@ class DataManager : public DataManagerInterface {
   Status InitUserPosManagerDataFromArray(StringPiece array, StringPiece magic);
   Status InitUserPosManagerDataFromFile(const string &path, StringPiece magic);
 
+  // Gives the OS access pattern hints for the data set: the whole image is
+  // accessed randomly, and the hot sections used by every conversion (see
+  // the section schema in InitFromReader()) start to be paged in.  Called by
+  // InitFromArray() and InitFromFile().
+  void AdviseAccessPattern() const;
+
+  // Starts a background thread that touches every page of the hot sections,
+  // so that the first conversion doesn't wait for page faults.  The thread is
+  // stopped and joined on destruction.  InitFromFile() calls this when
+  // --warm_up_data_set is true.  With --verify_data_set_sections, the thread
+  // also verifies the CRC-32C checksums of the hot sections as it reads them.
+  void StartWarmUp();
+
+  // Verifies the CRC-32C checksums of all the sections, which reads the whole
+  // data set.  Sections without checksums, i.e., those of data sets created
+  // before checksums were introduced, are regarded as valid.  Use
+  // DataSetReader::VerifyChecksum() to check downloaded data sets instead.
+  bool VerifySections() const;
+
   // Implementation of DataManagerInterface.
   const uint16 *GetPOSMatcherData() const override;
   void GetUserPOSData(StringPiece *token_array_data,
                       StringPiece *string_array_data) const override;
   void GetConnectorData(const char **data, size_t *size) const override;
+  void GetDenseConnectorData(const char **data, size_t *size) const override;
   void GetSystemDictionaryData(const char **data, int *size) const override;
   void GetCollocationData(const char **array, size_t *size) const override;
   void GetCollocationSuppressionData(const char **array,
@@ -99,6 +120,7 @@ class DataManager : public DataManagerInterface {
                         const uint16 **l_table, const uint16 **r_table,
                         size_t *bitarray_num_bytes, const char **bitarray_data,
                         const uint16 **boundary_data) const override;
+  void GetDenseSegmenterData(const char **data, size_t *size) const override;
   void GetCounterSuffixSortedArray(const char **array,
                                    size_t *size) const override;
   void GetSuffixDictionaryData(StringPiece *key_array_data,
@@ -134,19 +156,45 @@ class DataManager : public DataManagerInterface {
       StringPiece *conjugation_index_data,
       StringPiece *usage_items_data,
       StringPiece *string_array_data) const override;
+  void GetUsageRewriterIndexData(
+      StringPiece *key_value_index_data,
+      StringPiece *value_index_data) const override;
 #endif  // NO_USAGE_REWRITER
 
   StringPiece GetTypingModel(const string &name) const override;
+  StringPiece GetPreeditTable(const string &name) const override;
   StringPiece GetDataVersion() const override;
+  size_t TouchHotData(size_t max_bytes) const override;
 
  private:
+  class WarmUpThread;
+
+  // A section of the data set with its CRC-32C checksum, which is valid only
+  // if |has_crc32c| is true.
+  struct SectionData {
+    string name;
+    StringPiece data;
+    bool has_crc32c;
+    uint32 crc32c;
+  };
+
+  static SectionData GetSectionData(const DataSetReader &reader,
+                                    const string &name, StringPiece data);
+  static bool VerifySection(const SectionData &section);
+
   Status InitFromReader(const DataSetReader &reader);
+  void StopWarmUp();
 
   Mmap mmap_;
+  StringPiece image_;
+  std::vector<SectionData> sections_;
+  std::vector<SectionData> hot_sections_;
+  std::unique_ptr<WarmUpThread> warm_up_thread_;
   StringPiece pos_matcher_data_;
   StringPiece user_pos_token_array_data_;
   StringPiece user_pos_string_array_data_;
   StringPiece connection_data_;
+  StringPiece dense_connection_data_;
   StringPiece dictionary_data_;
   StringPiece suggestion_filter_data_;
   StringPiece collocation_data_;
@@ -158,6 +206,7 @@ class DataManager : public DataManagerInterface {
   StringPiece segmenter_ltable_;
   StringPiece segmenter_rtable_;
   StringPiece segmenter_bitarray_;
+  StringPiece segmenter_dense_bitarray_;
   StringPiece counter_suffix_data_;
   StringPiece suffix_key_array_data_;
   StringPiece suffix_value_array_data_;
@@ -187,7 +236,10 @@ class DataManager : public DataManagerInterface {
   StringPiece usage_conjugation_index_data_;
   StringPiece usage_items_data_;
   StringPiece usage_string_array_data_;
+  StringPiece usage_key_value_index_data_;
+  StringPiece usage_value_index_data_;
   std::vector<std::pair<string, StringPiece>> typing_model_data_;
+  std::vector<std::pair<string, StringPiece>> preedit_table_data_;
   StringPiece data_version_;
 
   DISALLOW_COPY_AND_ASSIGN(DataManager);
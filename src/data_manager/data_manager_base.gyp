@@ -124,6 +124,7 @@
       ],
       'dependencies': [
         '../base/base.gyp:base',
+        '../base/base.gyp:perfect_hash_index',
         '../base/base.gyp:serialized_string_array',
       ],
     },
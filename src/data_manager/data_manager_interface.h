@@ -57,6 +57,12 @@ class DataManagerInterface {
   // Returns the address of connection data and its size.
   virtual void GetConnectorData(const char **data, size_t *size) const = 0;
 
+  // Returns the address of the uncompressed connection matrix and its size.
+  // The matrix is optional; |*data| is set to nullptr if the data set doesn't
+  // contain it (e.g., on mobile platforms).
+  virtual void GetDenseConnectorData(const char **data,
+                                     size_t *size) const = 0;
+
   // Returns the addresses and their sizes necessary to create a segmenter.
   virtual void GetSegmenterData(
       size_t *l_num_elements, size_t *r_num_elements,
@@ -64,6 +70,12 @@ class DataManagerInterface {
       size_t *bitarray_num_bytes, const char **bitarray_data,
       const uint16 **boundary_data) const = 0;
 
+  // Returns the address of the uncompressed segmenter bit-array and its size.
+  // The bit-array is optional; |*data| is set to nullptr if the data set
+  // doesn't contain it (e.g., on mobile platforms).
+  virtual void GetDenseSegmenterData(const char **data,
+                                     size_t *size) const = 0;
+
   // Returns the address of system dictionary data and its size.
   virtual void GetSystemDictionaryData(const char **data, int *size) const = 0;
 
@@ -118,6 +130,12 @@ class DataManagerInterface {
       StringPiece *conjugation_suffix_index_data,
       StringPiece *usage_items_data,
       StringPiece *string_array_data) const = 0;
+
+  // Gets the precomputed sorted indices of conjugated usage entries.  Both are
+  // empty if the data set was built without them.
+  virtual void GetUsageRewriterIndexData(
+      StringPiece *key_value_index_data,
+      StringPiece *value_index_data) const = 0;
 #endif  // NO_USAGE_REWRITER
 
   // Gets the address and size of a sorted array of counter suffix values.
@@ -134,9 +152,20 @@ class DataManagerInterface {
   // Gets the typing model binary data for the specified name.
   virtual StringPiece GetTypingModel(const string &name) const = 0;
 
+  // Gets the preedit table of the specified name, e.g.,
+  // "preedit_romanji-hiragana.tsv", in the format of
+  // composer/internal/gen_preedit_table.py.  Returns an empty piece if the
+  // data set doesn't have it.
+  virtual StringPiece GetPreeditTable(const string &name) const = 0;
+
   // Gets the data version string.
   virtual StringPiece GetDataVersion() const = 0;
 
+  // Reads the hot sections of the data set, i.e., those used by every
+  // conversion, in the order of their priority until |max_bytes| are read,
+  // so that they are paged in.  Returns the number of bytes read.
+  virtual size_t TouchHotData(size_t max_bytes) const = 0;
+
  protected:
   DataManagerInterface() = default;
 
@@ -87,6 +87,19 @@ void DataManagerTestBase::SegmenterTest_SameAsInternal() {
                 segmenter->IsBoundary(rid, lid)) << rid << " " << lid;
     }
   }
+
+  // The batched query should give the same result.
+  std::vector<uint16> rids(lsize_);
+  for (size_t rid = 0; rid < lsize_; ++rid) {
+    rids[rid] = rid;
+  }
+  std::unique_ptr<bool[]> boundaries(new bool[lsize_]);
+  for (size_t lid = 0; lid < rsize_; ++lid) {
+    segmenter->IsBoundary(rids.data(), rids.size(), lid, boundaries.get());
+    for (size_t rid = 0; rid < lsize_; ++rid) {
+      EXPECT_EQ(is_boundary_(rid, lid), boundaries[rid]) << rid << " " << lid;
+    }
+  }
 }
 
 void DataManagerTestBase::SegmenterTest_LNodeTest() {
@@ -286,6 +299,19 @@ void DataManagerTestBase::TypingModelTest() {
   }
 }
 
+void DataManagerTestBase::TouchHotDataTest() {
+  EXPECT_EQ(0, data_manager_->TouchHotData(0));
+  EXPECT_EQ(1, data_manager_->TouchHotData(1));
+
+  // The connection data is one of the hot sections.
+  const char *data = nullptr;
+  size_t size = 0;
+  data_manager_->GetConnectorData(&data, &size);
+  const size_t total = data_manager_->TouchHotData(static_cast<size_t>(-1));
+  EXPECT_LE(size, total);
+  EXPECT_EQ(total, data_manager_->TouchHotData(total + 1));
+}
+
 void DataManagerTestBase::RunAllTests() {
   ConnectorTest_RandomValueCheck();
   SegmenterTest_LNodeTest();
@@ -296,6 +322,7 @@ void DataManagerTestBase::RunAllTests() {
   SuggestionFilterTest_IsBadSuggestion();
   CounterSuffixTest_ValidateTest();
   TypingModelTest();
+  TouchHotDataTest();
 }
 
 }  // namespace mozc
@@ -72,6 +72,7 @@ class DataManagerTestBase : public ::testing::Test {
   void SuggestionFilterTest_IsBadSuggestion();
   void CounterSuffixTest_ValidateTest();
   void TypingModelTest();
+  void TouchHotDataTest();
 
   std::unique_ptr<DataManagerInterface> data_manager_;
   const uint16 lsize_;
@@ -29,6 +29,7 @@
 
 #include "data_manager/dataset_reader.h"
 
+#include "base/hash.h"
 #include "base/logging.h"
 #include "base/port.h"
 #include "base/unverified_sha1.h"
@@ -48,6 +49,7 @@ DataSetReader::~DataSetReader() = default;
 
 bool DataSetReader::Init(StringPiece memblock, StringPiece magic) {
   name_to_data_map_.clear();
+  name_to_crc32c_map_.clear();
 
   // Initializes |name_to_data_map_| from |memblock|.  For binary data format,
   // see dataset.proto.
@@ -129,6 +131,9 @@ bool DataSetReader::Init(StringPiece memblock, StringPiece magic) {
       return false;
     }
     name_to_data_map_[e.name()] = ClippedSubstr(memblock, e.offset(), e.size());
+    if (e.has_crc32c()) {
+      name_to_crc32c_map_[e.name()] = e.crc32c();
+    }
     prev_chunk_end = e.offset() + e.size();
   }
 
@@ -144,6 +149,42 @@ bool DataSetReader::Get(const string& name, StringPiece* data) const {
   return true;
 }
 
+bool DataSetReader::GetCrc32c(const string &name, uint32 *crc32c) const {
+  auto iter = name_to_crc32c_map_.find(name);
+  if (iter == name_to_crc32c_map_.end()) {
+    return false;
+  }
+  *crc32c = iter->second;
+  return true;
+}
+
+bool DataSetReader::VerifySection(const string &name) const {
+  StringPiece data;
+  if (!Get(name, &data)) {
+    return false;
+  }
+  uint32 expected = 0;
+  if (!GetCrc32c(name, &expected)) {
+    return true;
+  }
+  const uint32 actual = Hash::Crc32c(data);
+  if (actual != expected) {
+    LOG(ERROR) << "Broken: CRC-32C mismatch for " << name << ": " << actual
+               << " vs " << expected;
+    return false;
+  }
+  return true;
+}
+
+bool DataSetReader::VerifyAllSections() const {
+  for (const auto &kv : name_to_data_map_) {
+    if (!VerifySection(kv.first)) {
+      return false;
+    }
+  }
+  return true;
+}
+
 bool DataSetReader::VerifyChecksum(StringPiece memblock) {
   if (memblock.size() < kFooterSize) {
     return false;
@@ -33,6 +33,7 @@
 #include <map>
 #include <string>
 
+#include "base/port.h"
 #include "base/string_piece.h"
 
 namespace mozc {
@@ -46,14 +47,27 @@ class DataSetReader {
   // magic number.  The caller is responsible to load the content of a dataset
   // file into memory, and |memblock| must outlive this instance.  Note: this
   // method doesn't verify checksum for performance.  One can separately call
-  // VerifyChecksum().
+  // VerifySection() for the data to use or VerifyChecksum().
   bool Init(StringPiece memblock, StringPiece magic);
 
   // Gets the byte data corresponding to |name|.  If the data for |name| doesn't
   // exist, returns false.
   bool Get(const string &name, StringPiece *data) const;
 
-  // Verifies the checksum of binary image.
+  // Gets the CRC-32C checksum of the data for |name|.  Returns false if the
+  // data doesn't exist or the data set is created without checksums.
+  bool GetCrc32c(const string &name, uint32 *crc32c) const;
+
+  // Verifies the CRC-32C checksum of the data for |name|, reading only the
+  // data.  The data without a checksum is regarded as valid.  Returns false if
+  // the data for |name| doesn't exist.
+  bool VerifySection(const string &name) const;
+
+  // Verifies the CRC-32C checksums of all the data.
+  bool VerifyAllSections() const;
+
+  // Verifies the SHA1 checksum of the whole binary image.  Unlike the CRC-32C
+  // checksums, it is hard to forge, so use this for downloaded data.
   static bool VerifyChecksum(StringPiece memblock);
 
   const std::map<string, StringPiece> &name_to_data_map() const {
@@ -63,6 +77,7 @@ class DataSetReader {
  private:
   // The value points to a block of the specified |memblock|.
   std::map<string, StringPiece> name_to_data_map_;
+  std::map<string, uint32> name_to_crc32c_map_;
 };
 
 }  // namespace mozc
@@ -32,8 +32,10 @@
 #include <sstream>
 #include <string>
 
+#include "base/hash.h"
 #include "base/port.h"
 #include "base/util.h"
+#include "data_manager/dataset.pb.h"
 #include "data_manager/dataset_writer.h"
 #include "testing/base/public/gunit.h"
 
@@ -79,6 +81,63 @@ TEST(DataSetReaderTest, ValidData) {
   EXPECT_FALSE(r.Get("foo", &data));
 }
 
+TEST(DataSetReaderTest, VerifySection) {
+  const StringPiece kGoogle("GOOGLE"), kMozc("m\0zc\xEF", 5);
+  string image;
+  size_t mozc_offset = 0;
+  {
+    DataSetWriter w(GetTestMagicNumber());
+    w.Add("google", 16, kGoogle);
+    w.Add("mozc", 64, kMozc);
+    mozc_offset = w.metadata().entries(1).offset();
+    std::stringstream out;
+    w.Finish(&out);
+    image = out.str();
+  }
+
+  DataSetReader r;
+  ASSERT_TRUE(r.Init(image, GetTestMagicNumber()));
+  uint32 crc32c = 0;
+  EXPECT_TRUE(r.GetCrc32c("mozc", &crc32c));
+  EXPECT_EQ(Hash::Crc32c(kMozc), crc32c);
+  EXPECT_FALSE(r.GetCrc32c("foo", &crc32c));
+  EXPECT_TRUE(r.VerifySection("google"));
+  EXPECT_TRUE(r.VerifySection("mozc"));
+  EXPECT_FALSE(r.VerifySection("foo"));
+  EXPECT_TRUE(r.VerifyAllSections());
+
+  // Only the broken data fails.
+  image[mozc_offset] ^= 1;
+  ASSERT_TRUE(r.Init(image, GetTestMagicNumber()));
+  EXPECT_TRUE(r.VerifySection("google"));
+  EXPECT_FALSE(r.VerifySection("mozc"));
+  EXPECT_FALSE(r.VerifyAllSections());
+}
+
+TEST(DataSetReaderTest, VerifySectionWithoutCrc32c) {
+  const string &magic = GetTestMagicNumber();
+  const StringPiece kGoogle("GOOGLE");
+  string image = magic;
+  DataSetMetadata md;
+  auto e = md.add_entries();
+  e->set_name("google");
+  e->set_offset(image.size());
+  e->set_size(kGoogle.size());
+  image.append(kGoogle.data(), kGoogle.size());
+  const string &md_str = md.SerializeAsString();
+  image.append(md_str);
+  image.append(Util::SerializeUint64(md_str.size()));
+  image.append(20, '\0');  // Dummy SHA1
+  image.append(Util::SerializeUint64(image.size() + 8));
+
+  DataSetReader r;
+  ASSERT_TRUE(r.Init(image, magic));
+  uint32 crc32c = 0;
+  EXPECT_FALSE(r.GetCrc32c("google", &crc32c));
+  EXPECT_TRUE(r.VerifySection("google"));
+  EXPECT_TRUE(r.VerifyAllSections());
+}
+
 TEST(DataSetReaderTest, InvalidMagicString) {
   const string &magic = GetTestMagicNumber();
   DataSetReader r;
@@ -32,6 +32,7 @@
 #include <string>
 
 #include "base/file_stream.h"
+#include "base/hash.h"
 #include "base/logging.h"
 #include "base/port.h"
 #include "base/unverified_sha1.h"
@@ -58,6 +59,7 @@ void DataSetWriter::Add(const string &name, int alignment, StringPiece data) {
   entry->set_name(name);
   entry->set_offset(image_.size());
   entry->set_size(data.size());
+  entry->set_crc32c(Hash::Crc32c(data));
   image_.append(data.data(), data.size());
 }
 
@@ -34,6 +34,7 @@
 
 #include "base/file_stream.h"
 #include "base/file_util.h"
+#include "base/hash.h"
 #include "base/unverified_sha1.h"
 #include "base/util.h"
 #include "data_manager/dataset.pb.h"
@@ -43,11 +44,13 @@
 namespace mozc {
 namespace {
 
+// Sets the entry of the data at |offset| in |image|.
 void SetEntry(const string &name, uint64 offset, uint64 size,
-              DataSetMetadata::Entry *entry) {
+              StringPiece image, DataSetMetadata::Entry *entry) {
   entry->set_name(name);
   entry->set_offset(offset);
   entry->set_size(size);
+  entry->set_crc32c(Hash::Crc32c(image.substr(offset, size)));
 }
 
 TEST(DatasetWriterTest, Write) {
@@ -94,19 +97,20 @@ TEST(DatasetWriterTest, Write) {
       "m\0zc\xEF"              // offset 64, size 5
       "\0\0\0"                 // offset 69, size 3 (padding)
       "m\0zc\xEF";             // offset 72, size 5
+  // Exclude the last '\0'.
+  const StringPiece data(data_chunk, sizeof(data_chunk) - 1);
   DataSetMetadata metadata;
-  SetEntry("data8", 5, 8, metadata.add_entries());
-  SetEntry("data16", 14, 10, metadata.add_entries());
-  SetEntry("data32", 24, 12, metadata.add_entries());
-  SetEntry("data64", 40, 11, metadata.add_entries());
-  SetEntry("file8", 51, 5, metadata.add_entries());
-  SetEntry("file16", 56, 5, metadata.add_entries());
-  SetEntry("file32", 64, 5, metadata.add_entries());
-  SetEntry("file64", 72, 5, metadata.add_entries());
+  SetEntry("data8", 5, 8, data, metadata.add_entries());
+  SetEntry("data16", 14, 10, data, metadata.add_entries());
+  SetEntry("data32", 24, 12, data, metadata.add_entries());
+  SetEntry("data64", 40, 11, data, metadata.add_entries());
+  SetEntry("file8", 51, 5, data, metadata.add_entries());
+  SetEntry("file16", 56, 5, data, metadata.add_entries());
+  SetEntry("file32", 64, 5, data, metadata.add_entries());
+  SetEntry("file64", 72, 5, data, metadata.add_entries());
   const string &metadata_chunk = metadata.SerializeAsString();
   const string &metadata_size = Util::SerializeUint64(metadata_chunk.size());
-  // Append data_chunk except for the last '\0'.
-  string expected(data_chunk, sizeof(data_chunk) - 1);
+  string expected = data.as_string();
   expected.append(metadata_chunk.data(), metadata_chunk.size());
   expected.append(metadata_size.data(), metadata_size.size());
   expected.append(internal::UnverifiedSHA1::MakeDigest(expected));
@@ -46,6 +46,7 @@ INVALID_COST = 30000
 INVALID_1BYTE_COST = 255
 RESOLUTION_FOR_1BYTE = 64
 FILE_MAGIC = '\xAB\xCD'
+DENSE_FILE_MAGIC = '\xAC\xCD'
 
 FALSE_VALUES = ['f', 'false', '0']
 TRUE_VALUES = ['t', 'true', '1']
@@ -252,6 +253,29 @@ def BuildBinaryData(matrix, mode_value_list, use_1byte_cost):
   return stream.getvalue()
 
 
+def BuildDenseBinaryData(matrix):
+  # Builds the uncompressed connection matrix, which can be mmapped and
+  # accessed by a single load of matrix[rid][lid].  The matrix must not be
+  # compressed by CompressMatrixByModeValue.
+  #
+  # The file format is as follows:
+  # DENSE_FILE_MAGIC (\xAC\xCD): 2bytes
+  # Resolution (always 1): 2bytes
+  # Num rids: 2bytes
+  # Num lids: 2bytes
+  # Costs: 2bytes * rids * lids (row major)
+  stream = StringIO.StringIO()
+  stream.write(DENSE_FILE_MAGIC)
+  matrix_size = len(matrix)
+  assert 0 <= matrix_size <= 65535
+  stream.write(struct.pack('<HHH', 1, matrix_size, matrix_size))
+  for row in matrix:
+    assert len(row) == matrix_size
+    assert all(0 <= cost <= 65535 for cost in row)
+    stream.write(struct.pack('<%dH' % matrix_size, *row))
+  return stream.getvalue()
+
+
 def ParseOptions():
   parser = optparse.OptionParser()
   parser.add_option('--text_connection_file', dest='text_connection_file')
@@ -260,6 +284,8 @@ def ParseOptions():
   parser.add_option('--target_compiler', dest='target_compiler')
   parser.add_option('--use_1byte_cost', dest='use_1byte_cost')
   parser.add_option('--binary_output_file', dest='binary_output_file')
+  parser.add_option('--dense_binary_output_file',
+                    dest='dense_binary_output_file')
   parser.add_option('--header_output_file', dest='header_output_file')
   return parser.parse_args()[0]
 
@@ -271,6 +297,19 @@ def main():
   special_pos_size = GetPosSize(options.special_pos_file)
   matrix = ParseConnectionFile(
       options.text_connection_file, pos_size, special_pos_size)
+
+  if options.dense_binary_output_file:
+    # The dense matrix holds the exact costs, so it is not available with
+    # 1-byte costs, which quantize them.
+    if ParseBoolFlag(options.use_1byte_cost):
+      logging.critical('Dense connection data requires 2-byte costs.')
+      sys.exit(1)
+    dirpath = os.path.dirname(options.dense_binary_output_file)
+    if not os.path.exists(dirpath):
+      os.makedirs(dirpath)
+    with open(options.dense_binary_output_file, 'wb') as stream:
+      stream.write(BuildDenseBinaryData(matrix))
+
   mode_value_list = CreateModeValueList(matrix)
   CompressMatrixByModeValue(matrix, mode_value_list)
   binary = BuildBinaryData(
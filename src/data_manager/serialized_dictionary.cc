@@ -89,15 +89,22 @@ SerializedDictionary::SerializedDictionary(StringPiece token_array,
     : token_array_(token_array) {
   DCHECK(VerifyData(token_array, string_array_data));
   string_array_.Set(string_array_data);
+  const iterator first = begin();
+  key_index_.Build(size(),
+                   [first](size_t i) { return (first + i).key(); });
 }
 
 SerializedDictionary::~SerializedDictionary() {}
 
 SerializedDictionary::IterRange SerializedDictionary::equal_range(
     StringPiece key) const {
-  // TODO(noriyukit): Instead of comparing key as string, we can do binary
-  // search using key index to minimize string comparison cost.
-  return std::equal_range(begin(), end(), key);
+  if (!key_index_.IsBuilt()) {
+    return std::equal_range(begin(), end(), key);
+  }
+  const iterator first = begin();
+  const PerfectHashIndex::Range range =
+      key_index_.Find(key, [first](size_t i) { return (first + i).key(); });
+  return IterRange(first + range.first, first + range.second);
 }
 
 std::pair<StringPiece, StringPiece> SerializedDictionary::Compile(
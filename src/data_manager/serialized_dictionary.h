@@ -36,6 +36,7 @@
 #include <string>
 #include <utility>
 
+#include "base/perfect_hash_index.h"
 #include "base/port.h"
 #include "base/serialized_string_array.h"
 #include "base/string_piece.h"
@@ -68,7 +69,9 @@ namespace mozc {
 // token array and string array, e.g., from files, onto memory blocks.  But
 // these two memory blocks must be aligned at 4 byte boundary.  Accessors are
 // designed to have similar interfaces to std::multimap<string, Value>, so
-// values can be looked up by equal_range(), etc.
+// values can be looked up by equal_range(), etc.  On construction, an in-memory
+// PerfectHashIndex is built over the keys so that equal_range() runs in
+// constant time.
 //
 // * Binary format
 //
@@ -338,6 +341,7 @@ class SerializedDictionary {
  private:
   StringPiece token_array_;
   SerializedStringArray string_array_;
+  PerfectHashIndex key_index_;
 };
 
 }  // namespace mozc
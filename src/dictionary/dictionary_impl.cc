@@ -30,6 +30,7 @@
 #include "dictionary/dictionary_impl.h"
 
 #include <string>
+#include <vector>
 
 #include "base/logging.h"
 #include "base/string_piece.h"
@@ -103,6 +104,10 @@ class CallbackWithFilter : public DictionaryInterface::Callback {
         suppression_dictionary_(suppression_dictionary),
         callback_(callback) {}
 
+  void set_callback(DictionaryInterface::Callback *callback) {
+    callback_ = callback;
+  }
+
   virtual ResultType OnKey(StringPiece key) {
     return callback_->OnKey(key);
   }
@@ -114,26 +119,38 @@ class CallbackWithFilter : public DictionaryInterface::Callback {
 
   virtual ResultType OnToken(StringPiece key, StringPiece actual_key,
                              const Token &token) {
+    if (ShouldFilter(token)) {
+      return TRAVERSE_CONTINUE;
+    }
+    return callback_->OnToken(key, actual_key, token);
+  }
+
+  virtual ResultType OnTokenView(StringPiece key, StringPiece actual_key,
+                                 const TokenView &token) {
+    if (ShouldFilter(token)) {
+      return TRAVERSE_CONTINUE;
+    }
+    return callback_->OnTokenView(key, actual_key, token);
+  }
+
+ private:
+  bool ShouldFilter(const TokenView &token) const {
     if (!(token.attributes & Token::USER_DICTIONARY)) {
       if (!use_spelling_correction_ &&
           (token.attributes & Token::SPELLING_CORRECTION)) {
-        return TRAVERSE_CONTINUE;
+        return true;
       }
       if (!use_zip_code_conversion_ && pos_matcher_->IsZipcode(token.lid)) {
-        return TRAVERSE_CONTINUE;
+        return true;
       }
       if (!use_t13n_conversion_ &&
           Util::IsEnglishTransliteration(token.value)) {
-        return TRAVERSE_CONTINUE;
+        return true;
       }
     }
-    if (suppression_dictionary_->SuppressEntry(token.key, token.value)) {
-      return TRAVERSE_CONTINUE;
-    }
-    return callback_->OnToken(key, actual_key, token);
+    return suppression_dictionary_->SuppressEntry(token.key, token.value);
   }
 
- private:
   const bool use_spelling_correction_;
   const bool use_zip_code_conversion_;
   const bool use_t13n_conversion_;
@@ -163,6 +180,26 @@ void DictionaryImpl::LookupPredictive(
   }
 }
 
+void DictionaryImpl::LookupPredictiveWithValuePrefix(
+    StringPiece key, StringPiece value_prefix,
+    const ConversionRequest &conversion_request,
+    Callback *callback) const {
+  CallbackWithFilter callback_with_filter(
+      conversion_request.config().use_spelling_correction(),
+      conversion_request.config().use_zip_code_conversion(),
+      conversion_request.config().use_t13n_conversion(),
+      pos_matcher_,
+      suppression_dictionary_,
+      callback);
+  for (size_t i = 0; i < dics_.size(); ++i) {
+    dics_[i]->LookupPredictiveWithValuePrefix(
+        key,
+        value_prefix,
+        conversion_request,
+        &callback_with_filter);
+  }
+}
+
 void DictionaryImpl::LookupPrefix(
     StringPiece key,
     const ConversionRequest &conversion_request,
@@ -182,6 +219,81 @@ void DictionaryImpl::LookupPrefix(
   }
 }
 
+namespace {
+
+// Fans out LookupPrefixBatch() or LookupReverseBatch() of the first
+// dictionary to the others.  As the lookup for a position has to finish in all
+// the dictionaries before the next position begins, the others are looked up
+// when the first one finishes each position.
+class FanOutBatchCallback : public DictionaryInterface::BatchCallback {
+ public:
+  FanOutBatchCallback(StringPiece key,
+                      bool is_reverse,
+                      const ConversionRequest &conversion_request,
+                      const std::vector<const DictionaryInterface *> &dics,
+                      CallbackWithFilter *callback_with_filter,
+                      DictionaryInterface::BatchCallback *batch_callback)
+      : key_(key),
+        is_reverse_(is_reverse),
+        conversion_request_(conversion_request),
+        dics_(dics),
+        callback_with_filter_(callback_with_filter),
+        batch_callback_(batch_callback) {}
+
+  virtual DictionaryInterface::Callback *OnBeginPosition(size_t begin_pos) {
+    DictionaryInterface::Callback *callback =
+        batch_callback_->OnBeginPosition(begin_pos);
+    if (callback == nullptr) {
+      return nullptr;
+    }
+    callback_with_filter_->set_callback(callback);
+    return callback_with_filter_;
+  }
+
+  virtual void OnEndPosition(size_t begin_pos) {
+    for (size_t i = 1; i < dics_.size(); ++i) {
+      if (is_reverse_) {
+        dics_[i]->LookupReverse(key_.substr(begin_pos), conversion_request_,
+                                callback_with_filter_);
+      } else {
+        dics_[i]->LookupPrefix(key_.substr(begin_pos), conversion_request_,
+                               callback_with_filter_);
+      }
+    }
+    batch_callback_->OnEndPosition(begin_pos);
+  }
+
+ private:
+  const StringPiece key_;
+  const bool is_reverse_;
+  const ConversionRequest &conversion_request_;
+  const std::vector<const DictionaryInterface *> &dics_;
+  CallbackWithFilter *callback_with_filter_;
+  DictionaryInterface::BatchCallback *batch_callback_;
+
+  DISALLOW_COPY_AND_ASSIGN(FanOutBatchCallback);
+};
+
+}  // namespace
+
+void DictionaryImpl::LookupPrefixBatch(
+    StringPiece key,
+    const std::vector<size_t> &begin_positions,
+    const ConversionRequest &conversion_request,
+    BatchCallback *batch_callback) const {
+  CallbackWithFilter callback_with_filter(
+      conversion_request.config().use_spelling_correction(),
+      conversion_request.config().use_zip_code_conversion(),
+      conversion_request.config().use_t13n_conversion(),
+      pos_matcher_,
+      suppression_dictionary_,
+      nullptr);
+  FanOutBatchCallback fan_out_callback(key, false, conversion_request, dics_,
+                                       &callback_with_filter, batch_callback);
+  dics_[0]->LookupPrefixBatch(key, begin_positions, conversion_request,
+                              &fan_out_callback);
+}
+
 void DictionaryImpl::LookupExact(
     StringPiece key,
     const ConversionRequest &conversion_request,
@@ -214,6 +326,24 @@ void DictionaryImpl::LookupReverse(
   }
 }
 
+void DictionaryImpl::LookupReverseBatch(
+    StringPiece str,
+    const std::vector<size_t> &begin_positions,
+    const ConversionRequest &conversion_request,
+    BatchCallback *batch_callback) const {
+  CallbackWithFilter callback_with_filter(
+      conversion_request.config().use_spelling_correction(),
+      conversion_request.config().use_zip_code_conversion(),
+      conversion_request.config().use_t13n_conversion(),
+      pos_matcher_,
+      suppression_dictionary_,
+      nullptr);
+  FanOutBatchCallback fan_out_callback(str, true, conversion_request, dics_,
+                                       &callback_with_filter, batch_callback);
+  dics_[0]->LookupReverseBatch(str, begin_positions, conversion_request,
+                               &fan_out_callback);
+}
+
 bool DictionaryImpl::LookupComment(StringPiece key, StringPiece value,
                                    const ConversionRequest &conversion_request,
                                    string *comment) const {
@@ -228,6 +358,19 @@ bool DictionaryImpl::LookupComment(StringPiece key, StringPiece value,
   return false;
 }
 
+size_t DictionaryImpl::LookupComments(
+    const std::vector<std::pair<StringPiece, StringPiece>> &key_values,
+    const ConversionRequest &conversion_request,
+    std::vector<string> *comments) const {
+  comments->resize(key_values.size());
+  size_t num_found = 0;
+  for (size_t i = 0; i < dics_.size() && num_found < key_values.size(); ++i) {
+    num_found +=
+        dics_[i]->LookupComments(key_values, conversion_request, comments);
+  }
+  return num_found;
+}
+
 bool DictionaryImpl::Reload() {
   return user_dictionary_->Reload();
 }
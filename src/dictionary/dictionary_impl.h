@@ -66,6 +66,10 @@ class DictionaryImpl : public DictionaryInterface {
   virtual void LookupPredictive(StringPiece key,
                                 const ConversionRequest &conversion_request,
                                 Callback *callback) const;
+  virtual void LookupPredictiveWithValuePrefix(
+      StringPiece key, StringPiece value_prefix,
+      const ConversionRequest &conversion_request,
+      Callback *callback) const;
   virtual void LookupPrefix(StringPiece key,
                             const ConversionRequest &conversion_request,
                             Callback *callback) const;
@@ -74,13 +78,30 @@ class DictionaryImpl : public DictionaryInterface {
                            const ConversionRequest &conversion_request,
                            Callback *callback) const;
 
+  // Runs LookupPrefixBatch() of the system dictionary and looks up the other
+  // dictionaries at the end of each position.
+  virtual void LookupPrefixBatch(StringPiece key,
+                                 const std::vector<size_t> &begin_positions,
+                                 const ConversionRequest &conversion_request,
+                                 BatchCallback *batch_callback) const;
+
   virtual void LookupReverse(StringPiece str,
                              const ConversionRequest &conversion_request,
                              Callback *callback) const;
 
+  // Same as LookupPrefixBatch() for LookupReverse().
+  virtual void LookupReverseBatch(StringPiece str,
+                                  const std::vector<size_t> &begin_positions,
+                                  const ConversionRequest &conversion_request,
+                                  BatchCallback *batch_callback) const;
+
   virtual bool LookupComment(StringPiece key, StringPiece value,
                              const ConversionRequest &conversion_request,
                              string *comment) const;
+  virtual size_t LookupComments(
+      const std::vector<std::pair<StringPiece, StringPiece>> &key_values,
+      const ConversionRequest &conversion_request,
+      std::vector<string> *comments) const;
   virtual bool Reload();
   virtual void PopulateReverseLookupCache(StringPiece str) const;
   virtual void ClearReverseLookupCache() const;
@@ -31,6 +31,7 @@
 #define MOZC_DICTIONARY_DICTIONARY_INTERFACE_H_
 
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "base/port.h"
@@ -50,7 +51,7 @@ class DictionaryInterface {
   //   OnKey(key);
   //   OnActualKey(key, actual_key, key != actual_key);
   //   for (each token in the token array for the key) {
-  //     OnToken(key, actual_key, token);
+  //     OnToken(key, actual_key, token);  // Or OnTokenView(); see below.
   //   }
   // }
   //
@@ -104,8 +105,45 @@ class DictionaryInterface {
       return TRAVERSE_CONTINUE;
     }
 
+    // Called back instead of OnToken() by dictionaries that can deliver a
+    // token without copying its key and value, e.g., SystemDictionary and
+    // UserDictionary.  The default implementation copies |token| to a buffer
+    // reused across calls and passes it to OnToken().  Callbacks that override
+    // this method should also override OnToken() as the other dictionaries
+    // still call it.
+    virtual ResultType OnTokenView(StringPiece key,
+                                   StringPiece expanded_key,
+                                   const TokenView &token) {
+      token.CopyTo(&token_buffer_);
+      return OnToken(key, expanded_key, token_buffer_);
+    }
+
    protected:
     Callback() {}
+
+   private:
+    Token token_buffer_;
+  };
+
+  // Callback interface for LookupPrefixBatch().  OnBeginPosition() is called
+  // for each begin position in the given order, and the lookup for a position
+  // finishes, followed by OnEndPosition(), before the next position begins.
+  // Thus the caller can decide whether to look up a position from the results
+  // of the preceding ones.
+  class BatchCallback {
+   public:
+    virtual ~BatchCallback() {}
+
+    // Returns the callback to look up the prefixes of the suffix of the key
+    // beginning at |begin_pos|, or nullptr to skip |begin_pos|.
+    virtual Callback *OnBeginPosition(size_t begin_pos) = 0;
+
+    // Called back when the lookup for |begin_pos| is finished.  Not called for
+    // skipped positions.
+    virtual void OnEndPosition(size_t begin_pos) {}
+
+   protected:
+    BatchCallback() {}
   };
 
   virtual ~DictionaryInterface() {}
@@ -120,6 +158,16 @@ class DictionaryInterface {
                                 const ConversionRequest &conversion_request,
                                 Callback *callback) const = 0;
 
+  // Same as LookupPredictive() but the dictionary may skip the entries whose
+  // values don't start with |value_prefix|, e.g., by using an index.  The
+  // callback still needs to check the values.
+  virtual void LookupPredictiveWithValuePrefix(
+      StringPiece key, StringPiece value_prefix,
+      const ConversionRequest &conversion_request,
+      Callback *callback) const {
+    LookupPredictive(key, conversion_request, callback);
+  }
+
   virtual void LookupPrefix(StringPiece key,
                             const ConversionRequest &conversion_request,
                             Callback *callback) const = 0;
@@ -128,12 +176,49 @@ class DictionaryInterface {
                            const ConversionRequest &conversion_request,
                            Callback *callback) const = 0;
 
+  // Looks up the prefixes of the suffixes of |key| beginning at
+  // |begin_positions|, which must be in increasing order and at character
+  // boundaries of |key|.  This is equivalent to calling LookupPrefix() for
+  // each suffix but lets dictionaries share the work that depends only on
+  // |key|, e.g., key encoding, among the suffixes.
+  virtual void LookupPrefixBatch(StringPiece key,
+                                 const std::vector<size_t> &begin_positions,
+                                 const ConversionRequest &conversion_request,
+                                 BatchCallback *batch_callback) const {
+    for (size_t i = 0; i < begin_positions.size(); ++i) {
+      Callback *callback = batch_callback->OnBeginPosition(begin_positions[i]);
+      if (callback == nullptr) {
+        continue;
+      }
+      LookupPrefix(key.substr(begin_positions[i]), conversion_request,
+                   callback);
+      batch_callback->OnEndPosition(begin_positions[i]);
+    }
+  }
+
   // For reverse lookup, the reading is stored in Token::value and the word
   // is stored in Token::key.
   virtual void LookupReverse(StringPiece str,
                              const ConversionRequest &conversion_request,
                              Callback *callback) const = 0;
 
+  // Same as LookupPrefixBatch() for LookupReverse(), i.e., looks up the
+  // suffixes of |str| beginning at |begin_positions| in the ascending order.
+  virtual void LookupReverseBatch(StringPiece str,
+                                  const std::vector<size_t> &begin_positions,
+                                  const ConversionRequest &conversion_request,
+                                  BatchCallback *batch_callback) const {
+    for (size_t i = 0; i < begin_positions.size(); ++i) {
+      Callback *callback = batch_callback->OnBeginPosition(begin_positions[i]);
+      if (callback == nullptr) {
+        continue;
+      }
+      LookupReverse(str.substr(begin_positions[i]), conversion_request,
+                    callback);
+      batch_callback->OnEndPosition(begin_positions[i]);
+    }
+  }
+
   // Looks up a user comment from a pair of key and value.  When (key, value)
   // doesn't exist in this dictionary or user comment is empty, bool is
   // returned and string is kept as-is.
@@ -141,6 +226,27 @@ class DictionaryInterface {
                              const ConversionRequest &conversion_request,
                              string *comment) const { return false; }
 
+  // Same as LookupComment() for each pair in |key_values| at once, e.g., for
+  // all the candidates of a segment.  |comments| is resized to the number of
+  // the pairs, and only its empty elements are filled, so that the results of
+  // several dictionaries can be merged.  Returns the number of the comments
+  // filled.
+  virtual size_t LookupComments(
+      const std::vector<std::pair<StringPiece, StringPiece>> &key_values,
+      const ConversionRequest &conversion_request,
+      std::vector<string> *comments) const {
+    comments->resize(key_values.size());
+    size_t num_found = 0;
+    for (size_t i = 0; i < key_values.size(); ++i) {
+      if ((*comments)[i].empty() &&
+          LookupComment(key_values[i].first, key_values[i].second,
+                        conversion_request, &(*comments)[i])) {
+        ++num_found;
+      }
+    }
+    return num_found;
+  }
+
   // Populates cache for LookupReverse().
   // TODO(noriyukit): These cache initialize/finalize mechanism shouldn't be a
   // part of the interface.
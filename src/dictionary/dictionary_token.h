@@ -33,6 +33,7 @@
 #include <string>
 
 #include "base/port.h"
+#include "base/string_piece.h"
 
 namespace mozc {
 namespace dictionary {
@@ -67,6 +68,34 @@ struct Token {
   AttributesBitfield attributes;
 };
 
+// Token whose key and value refer to strings owned by someone else, usually
+// the dictionary delivering it through DictionaryInterface::Callback.  Since
+// the strings may be reused for the next token, a view is valid only until
+// the callback returns.
+struct TokenView {
+  TokenView() : cost(0), lid(0), rid(0), attributes(Token::NONE) {}
+  // Implicit so that a Token can be passed where a TokenView is expected.
+  TokenView(const Token &token)  // NOLINT
+      : key(token.key), value(token.value), cost(token.cost), lid(token.lid),
+        rid(token.rid), attributes(token.attributes) {}
+
+  void CopyTo(Token *token) const {
+    key.CopyToString(&token->key);
+    value.CopyToString(&token->value);
+    token->cost = cost;
+    token->lid = lid;
+    token->rid = rid;
+    token->attributes = attributes;
+  }
+
+  StringPiece key;
+  StringPiece value;
+  int    cost;
+  int    lid;
+  int    rid;
+  Token::AttributesBitfield attributes;
+};
+
 }  // namespace dictionary
 }  // namespace mozc
 
@@ -51,6 +51,8 @@ DictionaryFile::~DictionaryFile() {}
 bool DictionaryFile::OpenFromFile(const string &file) {
   mapping_.reset(new Mmap());
   CHECK(mapping_->Open(file.c_str()));
+  // Sections are tries and arrays accessed at random positions.
+  Mmap::Advise(mapping_->begin(), mapping_->size(), Mmap::RANDOM);
   return OpenFromImage(mapping_->begin(), mapping_->size());
 }
 
@@ -73,5 +75,15 @@ const char *DictionaryFile::GetSection(const string &section_name,
   return nullptr;
 }
 
+bool DictionaryFile::AdviseSection(const string &section_name,
+                                   Mmap::AccessPattern pattern) const {
+  int len = 0;
+  const char *ptr = GetSection(section_name, &len);
+  if (ptr == nullptr) {
+    return false;
+  }
+  return Mmap::Advise(ptr, len, pattern);
+}
+
 }  // namespace dictionary
 }  // namespace mozc
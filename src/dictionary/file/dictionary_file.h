@@ -62,6 +62,11 @@ class DictionaryFile {
   // Return NULL when not found
   const char *GetSection(const string &section_name, int *len) const;
 
+  // Gives the OS a hint on how the section is accessed; see Mmap::Advise().
+  // Returns false if the section is not found or the hint is not applied.
+  bool AdviseSection(const string &section_name,
+                     Mmap::AccessPattern pattern) const;
+
  private:
   // DictionaryFile does not take the ownership of |file_codec_|.
   const DictionaryFileCodecInterface *file_codec_;
@@ -47,8 +47,11 @@ The binary format is as follows.
 
 Support there are N matching rules.  Then, the first 2*N bytes is the array of
 uint16 that contains the results for GetXXXId() methods.  The latter part
-contains the ranges of POS IDs for each IsXXX(uint16 id) methods (IsXXX should
-return true if id is in one of the ranges).  See the following figure:
+contains the bitsets of POS IDs for each IsXXX(uint16 id) methods, so that
+IsXXX(id) tests one bit without scanning the ranges of the rule (IsXXX should
+return true if the bit is set).  All the bitsets have the same size of W
+uint16 words, and the bit (id % 16) of the word (id / 16) stands for the id.
+See the following figure:
 
 +===========================================+=============================
 | POS ID for rule 0 (2 bytes)               |   For GetXXXID() methods
@@ -59,32 +62,22 @@ return true if id is in one of the ranges).  See the following figure:
 +-------------------------------------------+
 | POS ID for rule N - 1 (2 bytes)           |
 +===========================================+=============================
-| POS range for rule 0: start 0 (2 bytes)   |   For IsXXX() for rule 0
-+ - - - - - - - - - - - - - - - - - - - - - +
-| POS range for rule 0: end 0 (2 bytes)     |
+| W (2 bytes)                               |   For IsXXX() methods
 +-------------------------------------------+
-| POS range for rule 0: start 1 (2 bytes)   |
-+ - - - - - - - - - - - - - - - - - - - - - +
-| POS range for rule 0: end 1 (2 bytes)     |
-|-------------------------------------------+
+| Offset of the bitset for rule 0 (2 bytes) |   Offsets in uint16 from the
++-------------------------------------------+   beginning of the data
 | ....                                      |
-|-------------------------------------------+
-| POS range for rule 0: start M (2 bytes)   |
-+ - - - - - - - - - - - - - - - - - - - - - +
-| POS range for rule 0: end M (2 bytes)     |
-|-------------------------------------------+
-| Sentinel element 0xFFFF (2 bytes)         |
++-------------------------------------------+
+| Offset of the bitset for rule N - 1       |
 +===========================================+=============================
-| POS range for rule 1: start 0 (2 bytes)   |   For IsXXX() for rule 1
-+ - - - - - - - - - - - - - - - - - - - - - +
-| POS range for rule 1: end 0 (2 bytes)     |
+| Bitset for rule 0 (2 * W bytes)           |
++-------------------------------------------+
+| Bitset for rule 1 (2 * W bytes)           |
 +-------------------------------------------+
 | ....                                      |
 +-------------------------------------------+
-| Sentinel element 0xFFFF (2 bytes)         |
+| Bitset for rule N - 1 (2 * W bytes)       |
 +===========================================+
-| ....                                      |
-|                                           |
 """
 
 __author__ = "taku"
@@ -98,20 +91,32 @@ from dictionary import pos_util
 
 
 def OutputPosMatcherData(pos_matcher, output):
+  rule_names = pos_matcher.GetRuleNameList()
   data = []
-  for rule_name in pos_matcher.GetRuleNameList():
+  for rule_name in rule_names:
     data.append(pos_matcher.GetId(rule_name))
 
-  offset = 2 * len(pos_matcher.GetRuleNameList())
-  for rule_name in pos_matcher.GetRuleNameList():
+  # The bitsets cover the POS IDs up to the largest one in the rules.  IsXXX()
+  # returns false for the larger IDs without testing a bit.
+  max_id = max(id_range[1]
+               for rule_name in rule_names
+               for id_range in pos_matcher.GetRange(rule_name))
+  num_words = max_id // 16 + 1
+  data.append(num_words)
+
+  offset = 2 * len(rule_names) + 1
+  for rule_name in rule_names:
     data.append(offset)
-    offset += 2 * len(pos_matcher.GetRange(rule_name)) + 1
+    offset += num_words
+  if offset > 0x10000:
+    raise ValueError('POS matcher data is too large: %d' % offset)
 
-  for rule_name in pos_matcher.GetRuleNameList():
+  for rule_name in rule_names:
+    bitset = [0] * num_words
     for id_range in pos_matcher.GetRange(rule_name):
-      data.append(id_range[0])
-      data.append(id_range[1])
-    data.append(0xFFFF)
+      for pos_id in range(id_range[0], id_range[1] + 1):
+        bitset[pos_id // 16] |= 1 << (pos_id % 16)
+    data.extend(bitset)
 
   for u16 in data:
     output.write(struct.pack('<H', u16))
@@ -147,22 +152,14 @@ def OutputPosMatcherHeader(pos_matcher, output):
             })
 
   # Helper function to generate Is<RuleName>(uint16 id) method from rule name
-  # and its corresponding index. The generated function checks if the given id
-  # belongs to some range in kRangeTable[index] = kRangeTable_RuleName[].
+  # and its corresponding index. The generated function tests the bit of the
+  # given id in the bitset of the rule.
   def _GenerateIsMethod(rule_name, index):
     return ('  inline bool Is%(rule_name)s(uint16 id) const {\n'
-            '    const uint16 offset = data_[%(lid_table_size)d + %(index)d];\n'
-            '    for (const uint16 *ptr = data_ + offset;\n'
-            '         *ptr != static_cast<uint16>(0xFFFF); ptr += 2) {\n'
-            '      if (id >= *ptr && id <= *(ptr + 1)) {\n'
-            '        return true;\n'
-            '      }\n'
-            '    }\n'
-            '    return false;\n'
+            '    return TestBit(%(index)d, id);\n'
             '  }' % {
                 'rule_name': rule_name,
                 'index': index,
-                'lid_table_size': lid_table_size,
             })
 
   # Generate Get<RuleName>Id() and Is<RuleName>(uint16 id) for each rule.
@@ -184,11 +181,22 @@ def OutputPosMatcherHeader(pos_matcher, output):
       '  explicit POSMatcher(const uint16 *data) : data_(data) {}\n'
       '  void Set(const uint16 *data) { data_ = data; }\n'
       ' private:\n'
+      '  inline bool TestBit(int index, uint16 id) const {\n'
+      '    const uint16 word = id >> 4;\n'
+      '    if (word >= data_[%(num_words)d]) {\n'
+      '      return false;\n'
+      '    }\n'
+      '    const uint16 *bitset = data_ + data_[%(bitset_table)d + index];\n'
+      '    return (bitset[word] >> (id & 15)) & 1;\n'
+      '  }\n'
       '  const uint16 *data_;\n'
       '};\n'
       '}  // namespace dictionary\n'
       '}  // namespace mozc\n'
-      '#endif  // MOZC_DICTIONARY_POS_MATCHER_H_\n')
+      '#endif  // MOZC_DICTIONARY_POS_MATCHER_H_\n' % {
+          'num_words': lid_table_size,
+          'bitset_table': lid_table_size + 1,
+      })
 
 
 def ParseOptions():
@@ -34,14 +34,18 @@
 //  --output="output.h"
 //  --make_header
 
+#include <algorithm>
+#include <functional>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "base/file_stream.h"
 #include "base/flags.h"
 #include "base/init_mozc.h"
 #include "base/logging.h"
+#include "base/number_util.h"
 #include "base/util.h"
 #include "data_manager/data_manager.h"
 #include "dictionary/dictionary_token.h"
@@ -52,6 +56,16 @@
 DEFINE_string(input, "", "space separated input text files");
 DEFINE_string(user_pos_manager_data, "", "user pos manager data");
 DEFINE_string(output, "", "output binary file");
+DEFINE_int32(num_threads, 1,
+             "number of threads to parse the input and build the dictionary. "
+             "The output doesn't depend on it.");
+DEFINE_string(reading_profile, "",
+              "TSV file of readings and their lookup counts.  If set, logs "
+              "how the token groups of the hottest readings are spread over "
+              "the pages of the token array.");
+DEFINE_double(reading_profile_coverage, 0.9,
+              "fraction of the lookups in --reading_profile covered by the "
+              "hottest readings used for the layout report.");
 
 namespace mozc {
 namespace {
@@ -87,6 +101,38 @@ void GetInputFileName(const string &input_file,
   }
 }
 
+// Reads |profile_file| of "reading<tab>count" lines and returns the hottest
+// readings which cover |coverage| of the total count.
+std::vector<string> LoadHotReadings(const string &profile_file,
+                                    double coverage) {
+  InputFileStream ifs(profile_file.c_str());
+  CHECK(ifs.good()) << "Cannot open " << profile_file;
+  std::vector<std::pair<uint64, string>> entries;
+  uint64 total = 0;
+  string line;
+  std::vector<StringPiece> fields;
+  while (!getline(ifs, line).fail()) {
+    fields.clear();
+    Util::SplitStringUsing(line, "\t", &fields);
+    uint64 count = 0;
+    if (fields.size() < 2 || !NumberUtil::SafeStrToUInt64(fields[1], &count)) {
+      continue;
+    }
+    entries.push_back(std::make_pair(count, fields[0].as_string()));
+    total += count;
+  }
+  std::sort(entries.begin(), entries.end(),
+            std::greater<std::pair<uint64, string>>());
+
+  std::vector<string> readings;
+  uint64 covered = 0;
+  for (size_t i = 0; i < entries.size() && covered < coverage * total; ++i) {
+    readings.push_back(entries[i].second);
+    covered += entries[i].first;
+  }
+  return readings;
+}
+
 }  // namespace
 }  // namespace mozc
 
@@ -111,11 +157,25 @@ int main(int argc, char **argv) {
       data_manager.GetPOSMatcherData());
 
   mozc::dictionary::TextDictionaryLoader loader(pos_matcher);
+  loader.set_num_threads(FLAGS_num_threads);
   loader.Load(system_dictionary_input, reading_correction_input);
 
   mozc::dictionary::SystemDictionaryBuilder builder;
+  builder.set_num_threads(FLAGS_num_threads);
   builder.BuildFromTokens(loader.tokens());
 
+  if (!FLAGS_reading_profile.empty()) {
+    const std::vector<string> hot_readings = mozc::LoadHotReadings(
+        FLAGS_reading_profile, FLAGS_reading_profile_coverage);
+    const size_t kPageSize = 4096;
+    const mozc::dictionary::SystemDictionaryBuilder::TokenArrayLayoutStats
+        stats = builder.GetTokenArrayLayoutStats(hot_readings, kPageSize);
+    LOG(INFO) << "Hot readings: " << stats.num_keys << " / "
+              << hot_readings.size() << " found, " << stats.token_bytes
+              << " bytes of tokens on " << stats.touched_pages
+              << " pages (" << stats.min_pages << " pages if contiguous)";
+  }
+
   std::unique_ptr<std::ostream> output_stream(new mozc::OutputFileStream(
       FLAGS_output.c_str(), std::ios::out | std::ios::binary));
   builder.WriteToStream(FLAGS_output, output_stream.get());
@@ -41,20 +41,11 @@ namespace mozc {
 namespace dictionary {
 namespace {
 
-class ComparePrefix {
- public:
-  explicit ComparePrefix(size_t max_len) : max_len_(max_len) {}
-
-  bool operator()(StringPiece x, StringPiece y) const {
-    return x.substr(0, max_len_) < y.substr(0, max_len_);
-  }
-
- private:
-  const size_t max_len_;
-};
+// Greater than any code point, for the sentinel of the first character
+// ranges.
+const char32 kEndOfRanges = 0xFFFFFFFF;
 
 }  // namespace
-
 SuffixDictionary::SuffixDictionary(StringPiece key_array_data,
                                    StringPiece value_array_data,
                                    const uint32 *token_array)
@@ -64,6 +55,18 @@ SuffixDictionary::SuffixDictionary(StringPiece key_array_data,
   DCHECK(token_array_);
   key_array_.Set(key_array_data);
   value_array_.Set(value_array_data);
+
+  // The keys are sorted in the byte order, which is the order of the code
+  // points in UTF-8.  So the keys beginning with the same character are
+  // contiguous.
+  for (size_t i = 0; i < key_array_.size(); ++i) {
+    const char32 first_char = GetFirstChar(key_array_[i]);
+    if (first_char_ranges_.empty() ||
+        first_char_ranges_.back().first != first_char) {
+      first_char_ranges_.emplace_back(first_char, i);
+    }
+  }
+  first_char_ranges_.emplace_back(kEndOfRanges, key_array_.size());
 }
 
 SuffixDictionary::~SuffixDictionary() {}
@@ -90,14 +93,33 @@ void SuffixDictionary::LookupPredictive(
     StringPiece key,
     const ConversionRequest &conversion_request,
     Callback *callback) const {
-  using Iter = SerializedStringArray::const_iterator;
-  std::pair<Iter, Iter> range = std::equal_range(key_array_.begin(),
-                                            key_array_.end(),
-                                            key, ComparePrefix(key.size()));
-  Token token;
+  size_t begin = 0;
+  size_t end = key_array_.size();
+  if (!key.empty()) {
+    // Narrows the range to the keys beginning with the first character of
+    // |key|, then finds the first key not less than |key|.  The keys having
+    // |key| as a prefix follow it.
+    const auto range = std::lower_bound(
+        first_char_ranges_.begin(), first_char_ranges_.end(),
+        std::make_pair(GetFirstChar(key), static_cast<size_t>(0)));
+    if (range == first_char_ranges_.end() ||
+        range->first != GetFirstChar(key)) {
+      return;
+    }
+    end = (range + 1)->second;
+    begin = std::lower_bound(key_array_.begin() + range->second,
+                             key_array_.begin() + end, key) -
+            key_array_.begin();
+  }
+
+  // The key and value refer to the serialized arrays.
+  TokenView token;
   token.attributes = Token::NONE;  // Common for all suffix tokens.
-  for (; range.first != range.second; ++range.first) {
-    token.key.assign((*range.first).data(), (*range.first).size());
+  for (size_t index = begin; index < end; ++index) {
+    token.key = key_array_[index];
+    if (!Util::StartsWith(token.key, key)) {
+      break;
+    }
     switch (callback->OnKey(token.key)) {
       case Callback::TRAVERSE_DONE:
         return;
@@ -109,17 +131,12 @@ void SuffixDictionary::LookupPredictive(
       default:
         break;
     }
-    const size_t index = range.first - key_array_.begin();
-    if (value_array_[index].empty()) {
-      token.value = token.key;
-    } else {
-      token.value.assign(value_array_[index].data(),
-                         value_array_[index].size());
-    }
+    token.value =
+        value_array_[index].empty() ? token.key : value_array_[index];
     token.lid = token_array_[3 * index];
     token.rid = token_array_[3 * index + 1];
     token.cost = token_array_[3 * index + 2];
-    if (callback->OnToken(token.key, token.key, token) !=
+    if (callback->OnTokenView(token.key, token.key, token) !=
         Callback::TRAVERSE_CONTINUE) {
       break;
     }
@@ -138,6 +155,24 @@ void SuffixDictionary::LookupExact(
     Callback *callback) const {
 }
 
+void SuffixDictionary::LookupPrefixBatch(
+    StringPiece key,
+    const std::vector<size_t> &begin_positions,
+    const ConversionRequest &conversion_request,
+    BatchCallback *batch_callback) const {
+  for (size_t i = 0; i < begin_positions.size(); ++i) {
+    if (batch_callback->OnBeginPosition(begin_positions[i]) != nullptr) {
+      batch_callback->OnEndPosition(begin_positions[i]);
+    }
+  }
+}
+
+// static
+char32 SuffixDictionary::GetFirstChar(StringPiece key) {
+  size_t mblen = 0;
+  return Util::UTF8ToUCS4(key.data(), key.data() + key.size(), &mblen);
+}
+
 void SuffixDictionary::LookupReverse(
     StringPiece key,
     const ConversionRequest &conversion_request,
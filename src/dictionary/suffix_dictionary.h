@@ -30,6 +30,9 @@
 #ifndef MOZC_DICTIONARY_SUFFIX_DICTIONARY_H_
 #define MOZC_DICTIONARY_SUFFIX_DICTIONARY_H_
 
+#include <utility>
+#include <vector>
+
 #include "base/port.h"
 #include "base/serialized_string_array.h"
 #include "base/string_piece.h"
@@ -71,15 +74,31 @@ class SuffixDictionary : public DictionaryInterface {
   void LookupExact(StringPiece key, const ConversionRequest &conversion_request,
                    Callback *callback) const override;
 
+  // Only iterates |begin_positions| as LookupPrefix() finds nothing.
+  void LookupPrefixBatch(StringPiece key,
+                         const std::vector<size_t> &begin_positions,
+                         const ConversionRequest &conversion_request,
+                         BatchCallback *batch_callback) const override;
+
   void LookupReverse(StringPiece str,
                      const ConversionRequest &conversion_request,
                      Callback *callback) const override;
 
  private:
+  // Returns the code point of the first character of non-empty |key|.
+  static char32 GetFirstChar(StringPiece key);
+
   SerializedStringArray key_array_;
   SerializedStringArray value_array_;
   const uint32 *token_array_;
 
+  // Pairs of a first character of the keys and the index of the first key
+  // beginning with it, sorted by the character, followed by a sentinel
+  // holding the number of the keys.  This narrows the binary search
+  // of LookupPredictive(), which is called for several suffixes of the key
+  // on every conversion of a long key.
+  std::vector<std::pair<char32, size_t>> first_char_ranges_;
+
   DISALLOW_COPY_AND_ASSIGN(SuffixDictionary);
 };
 
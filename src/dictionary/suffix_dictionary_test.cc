@@ -30,7 +30,9 @@
 #include "dictionary/suffix_dictionary.h"
 
 #include <memory>
+#include <vector>
 
+#include "base/serialized_string_array.h"
 #include "base/util.h"
 #include "data_manager/testing/mock_data_manager.h"
 #include "dictionary/dictionary_interface.h"
@@ -89,6 +91,62 @@ TEST(SuffixDictionaryTest, LookupPredictive) {
   }
 }
 
+TEST(SuffixDictionaryTest, LookupPredictiveRanges) {
+  // The keys sorted in the byte order, including the ones sharing the first
+  // byte but not the first character.
+  const std::vector<StringPiece> keys = {
+    "a", "ab", "abc", "b", "が", "がら", "ぎ", "た", "たい", "たら", "だ",
+  };
+  const std::vector<StringPiece> values(keys.size(), "");
+  std::unique_ptr<uint32[]> key_buffer, value_buffer;
+  const StringPiece key_array_data =
+      SerializedStringArray::SerializeToBuffer(keys, &key_buffer);
+  const StringPiece value_array_data =
+      SerializedStringArray::SerializeToBuffer(values, &value_buffer);
+  std::vector<uint32> token_array;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    token_array.push_back(1);  // lid
+    token_array.push_back(1);  // rid
+    token_array.push_back(static_cast<uint32>(i));  // cost
+  }
+  const SuffixDictionary dic(key_array_data, value_array_data,
+                             token_array.data());
+  ConversionRequest convreq;
+
+  const struct {
+    const char *prefix;
+    std::vector<string> expected;
+  } kTestCases[] = {
+    {"a", {"a", "ab", "abc"}},
+    {"ab", {"ab", "abc"}},
+    {"abcd", {}},
+    {"b", {"b"}},
+    {"c", {}},
+    {"が", {"が", "がら"}},
+    {"がら", {"がら"}},
+    {"ぎ", {"ぎ"}},
+    {"ぐ", {}},
+    {"た", {"た", "たい", "たら"}},
+    {"たら", {"たら"}},
+    {"だ", {"だ"}},
+    {"ち", {}},
+  };
+  for (const auto &test_case : kTestCases) {
+    CollectTokenCallback callback;
+    dic.LookupPredictive(test_case.prefix, convreq, &callback);
+    std::vector<string> actual;
+    for (const Token &token : callback.tokens()) {
+      actual.push_back(token.key);
+      EXPECT_EQ(token.key, token.value);
+    }
+    EXPECT_EQ(test_case.expected, actual) << test_case.prefix;
+  }
+
+  CollectTokenCallback callback;
+  dic.LookupPredictive("", convreq, &callback);
+  EXPECT_EQ(keys.size(), callback.tokens().size());
+}
+
 }  // namespace
 }  // namespace dictionary
 }  // namespace mozc
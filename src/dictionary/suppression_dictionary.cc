@@ -29,22 +29,140 @@
 
 #include "dictionary/suppression_dictionary.h"
 
+#include "base/hash.h"
 #include "base/logging.h"
 #include "base/mutex.h"
+#include "base/util.h"
 
 namespace mozc {
 namespace dictionary {
 namespace {
-const char kDelimiter = '\t';
+
+// Marks an empty slot of the table.
+const uint64 kEmptySlot = 0;
+
+uint64 GetEntryFingerprint(StringPiece key, StringPiece value) {
+  const uint64 fp =
+      Hash::FingerprintWithSeed(value, Hash::Fingerprint32(key));
+  return fp == kEmptySlot ? 1 : fp;
+}
+
 }  // namespace
 
+// Immutable open-addressing set of entry fingerprints with linear probing.
+// The load factor is kept at 1/2 or below.
+class SuppressionDictionary::Table {
+ public:
+  Table(const std::vector<uint64> &fingerprints,
+        bool has_key_empty, bool has_value_empty)
+      : mask_(0), size_(0),
+        has_key_empty_(has_key_empty), has_value_empty_(has_value_empty) {
+    if (fingerprints.empty()) {
+      return;
+    }
+    size_t capacity = 8;
+    while (capacity < fingerprints.size() * 2) {
+      capacity *= 2;
+    }
+    slots_.resize(capacity, kEmptySlot);
+    mask_ = capacity - 1;
+    for (size_t i = 0; i < fingerprints.size(); ++i) {
+      Insert(fingerprints[i]);
+    }
+  }
+
+  bool Contains(uint64 fp) const {
+    if (size_ == 0) {
+      return false;
+    }
+    for (size_t i = fp & mask_; ; i = (i + 1) & mask_) {
+      if (slots_[i] == fp) {
+        return true;
+      }
+      if (slots_[i] == kEmptySlot) {
+        return false;
+      }
+    }
+  }
+
+  void GetFingerprints(std::vector<uint64> *fingerprints) const {
+    for (size_t i = 0; i < slots_.size(); ++i) {
+      if (slots_[i] != kEmptySlot) {
+        fingerprints->push_back(slots_[i]);
+      }
+    }
+  }
+
+  size_t size() const { return size_; }
+  bool has_key_empty() const { return has_key_empty_; }
+  bool has_value_empty() const { return has_value_empty_; }
+
+ private:
+  void Insert(uint64 fp) {
+    size_t i = fp & mask_;
+    for (; slots_[i] != kEmptySlot; i = (i + 1) & mask_) {
+      if (slots_[i] == fp) {
+        return;
+      }
+    }
+    slots_[i] = fp;
+    ++size_;
+  }
+
+  std::vector<uint64> slots_;
+  size_t mask_;
+  size_t size_;
+  const bool has_key_empty_;
+  const bool has_value_empty_;
+
+  DISALLOW_COPY_AND_ASSIGN(Table);
+};
+
+// Pins the table during a lookup.  See UserDictionary::ScopedTokensReader.
+class SuppressionDictionary::ScopedTableReader {
+ public:
+  explicit ScopedTableReader(const SuppressionDictionary *dic) : dic_(dic) {
+    while (true) {
+      epoch_ = dic_->epoch_.load() & 1;
+      dic_->readers_[epoch_].fetch_add(1);
+      if ((dic_->epoch_.load() & 1) == epoch_) {
+        break;
+      }
+      dic_->readers_[epoch_].fetch_sub(1);
+    }
+    table_ = dic_->table_.load();
+  }
+
+  ~ScopedTableReader() {
+    dic_->readers_[epoch_].fetch_sub(1);
+  }
+
+  const Table *table() const { return table_; }
+
+ private:
+  const SuppressionDictionary *dic_;
+  uint32 epoch_;
+  const Table *table_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedTableReader);
+};
+
 SuppressionDictionary::SuppressionDictionary()
-    : locked_(false), has_key_empty_(false), has_value_empty_(false) {}
+    : pending_has_key_empty_(false), pending_has_value_empty_(false),
+      locked_(false),
+      table_(new Table(std::vector<uint64>(), false, false)),
+      empty_(true), epoch_(0) {
+  readers_[0] = 0;
+  readers_[1] = 0;
+}
 
-SuppressionDictionary::~SuppressionDictionary() {}
+SuppressionDictionary::~SuppressionDictionary() {
+  delete table_.load();
+}
 
 bool SuppressionDictionary::AddEntry(
     const string &key, const string &value) {
+  scoped_lock l(&mutex_);
   if (!locked_) {
     LOG(ERROR) << "Dictionary is not locked";
     return false;
@@ -56,76 +174,93 @@ bool SuppressionDictionary::AddEntry(
   }
 
   if (key.empty()) {
-    has_key_empty_ = true;
+    pending_has_key_empty_ = true;
   }
 
   if (value.empty()) {
-    has_value_empty_ = true;
+    pending_has_value_empty_ = true;
   }
 
-  dic_.insert(key + kDelimiter + value);
+  pending_.push_back(GetEntryFingerprint(key, value));
 
   return true;
 }
 
 void SuppressionDictionary::Clear() {
+  scoped_lock l(&mutex_);
   if (!locked_) {
     LOG(ERROR) << "Dictionary is not locked";
     return;
   }
-  has_key_empty_ = false;
-  has_value_empty_ = false;
-  dic_.clear();
+  pending_has_key_empty_ = false;
+  pending_has_value_empty_ = false;
+  pending_.clear();
 }
 
 void SuppressionDictionary::Lock() {
   scoped_lock l(&mutex_);
+  if (locked_) {
+    return;
+  }
+  // |table_| is replaced only under |mutex_|, so it can be read directly.
+  const Table *table = table_.load();
+  pending_.clear();
+  table->GetFingerprints(&pending_);
+  pending_has_key_empty_ = table->has_key_empty();
+  pending_has_value_empty_ = table->has_value_empty();
   locked_ = true;
 }
 
 void SuppressionDictionary::UnLock() {
   scoped_lock l(&mutex_);
+  if (!locked_) {
+    return;
+  }
+  const Table *new_table = new Table(pending_, pending_has_key_empty_,
+                                     pending_has_value_empty_);
+  std::vector<uint64>().swap(pending_);
+  const Table *old_table = table_.exchange(new_table);
+  empty_ = (new_table->size() == 0);
   locked_ = false;
+  Retire(old_table);
 }
 
-bool SuppressionDictionary::IsEmpty() const {
-  if (locked_) {
-    return true;
+void SuppressionDictionary::Retire(const Table *old_table) {
+  // Readers registered in the new epoch load the new table, so only those in
+  // the previous epoch can still see |old_table|.
+  const uint32 old_epoch = epoch_.fetch_add(1) & 1;
+  while (readers_[old_epoch].load() != 0) {
+    Util::Sleep(0);
   }
-  return dic_.empty();
+  delete old_table;
+}
+
+bool SuppressionDictionary::IsEmpty() const {
+  return empty_;
 }
 
 bool SuppressionDictionary::SuppressEntry(
-    const string &key, const string &value) const {
-  if (dic_.empty()) {
+    StringPiece key, StringPiece value) const {
+  if (empty_) {
     // Almost all users don't use word supresssion function.
     // We can return false as early as possible
     return false;
   }
 
-  if (locked_) {
-    VLOG(2) << "Dictionary is locked now";
-    return false;
-  }
-
-  string lookup_key = key;
-  lookup_key.append(1, kDelimiter).append(value);
-  if (dic_.find(lookup_key) != dic_.end()) {
+  ScopedTableReader reader(this);
+  const Table *table = reader.table();
+  if (table->Contains(GetEntryFingerprint(key, value))) {
     return true;
   }
 
-  if (has_key_empty_) {
-    lookup_key.assign(1, kDelimiter).append(value);
-    if (dic_.find(lookup_key) != dic_.end()) {
-      return true;
-    }
+  if (table->has_key_empty() &&
+      table->Contains(GetEntryFingerprint(StringPiece(), value))) {
+    return true;
   }
 
-  if (has_value_empty_) {
-    lookup_key.assign(key).append(1, kDelimiter);
-    if (dic_.find(lookup_key) != dic_.end()) {
-      return true;
-    }
+  if (table->has_value_empty() &&
+      table->Contains(GetEntryFingerprint(key, StringPiece()))) {
+    return true;
   }
 
   return false;
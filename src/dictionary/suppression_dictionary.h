@@ -30,29 +30,34 @@
 #ifndef MOZC_DICTIONARY_SUPPRESSION_DICTIONARY_H_
 #define MOZC_DICTIONARY_SUPPRESSION_DICTIONARY_H_
 
-#include <set>
+#include <atomic>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "base/mutex.h"
 #include "base/port.h"
+#include "base/string_piece.h"
 
 namespace mozc {
 namespace dictionary {
 
+// Keeps the pairs of key and value to be suppressed.  The entries are hashed
+// into an open-addressing table of fingerprints, which is rebuilt at UnLock()
+// and handed over to readers by a pointer swap.  SuppressEntry() and IsEmpty()
+// never take a lock and keep seeing the previous table while the dictionary
+// is being updated.
 class SuppressionDictionary {
  public:
   SuppressionDictionary();
   virtual ~SuppressionDictionary();
 
   // Locks dictionary.
-  // Need to lock before calling AddEntry() or Clear().
-  // When the dictionary is locked, Supress() return false.
-  //
-  // NOTE:
-  // Lock() and SupressWord() must be called synchronously.
+  // Need to lock before calling AddEntry() or Clear().  The entries added
+  // while locked are not visible until UnLock().
   void Lock();
 
-  // Unlocks dictionary.
+  // Unlocks dictionary and publishes the entries.
   void UnLock();
 
   // Returns true if the dictionary is locked.
@@ -60,27 +65,42 @@ class SuppressionDictionary {
     return locked_;
   }
 
-  // Note: this method is thread unsafe.
+  // Note: only one thread can update the dictionary at the same time.
   bool AddEntry(const string &key, const string &value);
 
-  // Note: this method is thread unsafe.
+  // Note: only one thread can update the dictionary at the same time.
   void Clear();
 
   // Returns true if SuppressionDictionary doesn't have any entries.
   bool IsEmpty() const;
 
-  // Returns true if |word| should be suppressed.  If the current dictionay is
-  // "locked" via Lock() method, this function always return false.  Lock() and
-  // SuppressWord() must be called synchronously.
-  bool SuppressEntry(const string &key, const string &value) const;
+  // Returns true if |word| should be suppressed.  While the dictionary is
+  // locked, the entries published at the last UnLock() are used.
+  bool SuppressEntry(StringPiece key, StringPiece value) const;
 
  private:
-  std::set<string> dic_;
-  bool locked_;
-  bool has_key_empty_;
-  bool has_value_empty_;
+  class Table;
+  class ScopedTableReader;
+
+  // Frees |old_table| once no reader can see it.
+  void Retire(const Table *old_table);
+
+  // Fingerprints of the entries being built between Lock() and UnLock().
+  std::vector<uint64> pending_;
+  bool pending_has_key_empty_;
+  bool pending_has_value_empty_;
+  std::atomic<bool> locked_;
   Mutex mutex_;
 
+  // |table_| is handed over to readers without a lock, in the same manner as
+  // the tokens of UserDictionary: a reader registers itself in |readers_| of
+  // the current |epoch_| before loading |table_|, and Retire() flips the
+  // epoch and waits for the readers registered in the previous one.
+  std::atomic<const Table *> table_;
+  std::atomic<bool> empty_;
+  mutable std::atomic<uint32> epoch_;
+  mutable std::atomic<int32> readers_[2];
+
   DISALLOW_COPY_AND_ASSIGN(SuppressionDictionary);
 };
 
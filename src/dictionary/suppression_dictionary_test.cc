@@ -70,10 +70,13 @@ TEST(SupressionDictionary, BasicTest) {
     // Not locked
     EXPECT_FALSE(dic->AddEntry("test", "test"));
 
-    // locked now => SuppressEntry always returns false
+    // While locked, SuppressEntry uses the entries published last time.
     dic->Lock();
-    EXPECT_FALSE(dic->SuppressEntry("key1", "value1"));
+    EXPECT_TRUE(dic->SuppressEntry("key1", "value1"));
+    EXPECT_TRUE(dic->AddEntry("key6", "value6"));
+    EXPECT_FALSE(dic->SuppressEntry("key6", "value6"));
     dic->UnLock();
+    EXPECT_TRUE(dic->SuppressEntry("key6", "value6"));
 
     EXPECT_TRUE(dic->SuppressEntry("key1", "value1"));
     EXPECT_TRUE(dic->SuppressEntry("key2", "value2"));
@@ -102,6 +105,52 @@ TEST(SupressionDictionary, BasicTest) {
   }
 }
 
+TEST(SupressionDictionary, ReloadTest) {
+  SuppressionDictionary dic;
+  EXPECT_TRUE(dic.IsEmpty());
+
+  const int kNumEntries = 10000;
+  dic.Lock();
+  for (int i = 0; i < kNumEntries; ++i) {
+    EXPECT_TRUE(dic.AddEntry("key" + std::to_string(i),
+                             "value" + std::to_string(i)));
+  }
+  // Duplicates are ignored.
+  EXPECT_TRUE(dic.AddEntry("key0", "value0"));
+  dic.UnLock();
+  EXPECT_FALSE(dic.IsEmpty());
+  for (int i = 0; i < kNumEntries; ++i) {
+    EXPECT_TRUE(dic.SuppressEntry("key" + std::to_string(i),
+                                  "value" + std::to_string(i)));
+    EXPECT_FALSE(dic.SuppressEntry("key" + std::to_string(i),
+                                   "value" + std::to_string(i + 1)));
+  }
+
+  // The old entries stay visible until the new ones are published.
+  dic.Lock();
+  dic.Clear();
+  EXPECT_TRUE(dic.AddEntry("new_key", "new_value"));
+  EXPECT_FALSE(dic.IsEmpty());
+  EXPECT_TRUE(dic.SuppressEntry("key1", "value1"));
+  EXPECT_FALSE(dic.SuppressEntry("new_key", "new_value"));
+  dic.UnLock();
+  EXPECT_FALSE(dic.SuppressEntry("key1", "value1"));
+  EXPECT_TRUE(dic.SuppressEntry("new_key", "new_value"));
+
+  // Entries are kept when the dictionary is locked without Clear().
+  dic.Lock();
+  EXPECT_TRUE(dic.AddEntry("", "value"));
+  dic.UnLock();
+  EXPECT_TRUE(dic.SuppressEntry("new_key", "new_value"));
+  EXPECT_TRUE(dic.SuppressEntry("any_key", "value"));
+
+  dic.Lock();
+  dic.Clear();
+  dic.UnLock();
+  EXPECT_TRUE(dic.IsEmpty());
+  EXPECT_FALSE(dic.SuppressEntry("new_key", "new_value"));
+}
+
 class DictionaryLoaderThread : public Thread {
  public:
   virtual void Run() {
@@ -76,6 +76,9 @@ const char kKeySectionName[] = "k";
 const char kValueSectionName[] = "v";
 const char kTokensSectionName[] = "t";
 const char kPosSectionName[] = "p";
+const char kPredictiveCostBoundsSectionName[] = "c";
+const char kReverseLookupIndexSectionName[] = "r";
+const char kBigramIndexSectionName[] = "b";
 
 //// Constants for validation ////
 // 12 bits
@@ -213,6 +216,20 @@ const string SystemDictionaryCodec::GetSectionNameForPos() const {
   return kPosSectionName;
 }
 
+const string
+SystemDictionaryCodec::GetSectionNameForPredictiveCostBounds() const {
+  return kPredictiveCostBoundsSectionName;
+}
+
+const string
+SystemDictionaryCodec::GetSectionNameForReverseLookupIndex() const {
+  return kReverseLookupIndexSectionName;
+}
+
+const string SystemDictionaryCodec::GetSectionNameForBigramIndex() const {
+  return kBigramIndexSectionName;
+}
+
 void SystemDictionaryCodec::EncodeKey(
     const StringPiece src, string *dst) const {
   EncodeDecodeKeyImpl(src, dst);
@@ -58,6 +58,15 @@ class SystemDictionaryCodec : public SystemDictionaryCodecInterface {
   // Return section name for frequent pos map
   virtual const string GetSectionNameForPos() const;
 
+  // Return section name for cost bounds of predictive lookup
+  virtual const string GetSectionNameForPredictiveCostBounds() const;
+
+  // Return section name for reverse lookup index
+  virtual const string GetSectionNameForReverseLookupIndex() const;
+
+  // Return section name for bigram index
+  virtual const string GetSectionNameForBigramIndex() const;
+
   // Compresses key string into small bytes.
   virtual void EncodeKey(const StringPiece src, string *dst) const;
 
@@ -60,6 +60,15 @@ class SystemDictionaryCodecInterface {
   // Return section name for frequent pos map
   virtual const string GetSectionNameForPos() const = 0;
 
+  // Return section name for cost bounds of predictive lookup
+  virtual const string GetSectionNameForPredictiveCostBounds() const = 0;
+
+  // Return section name for reverse lookup index
+  virtual const string GetSectionNameForReverseLookupIndex() const = 0;
+
+  // Return section name for bigram index
+  virtual const string GetSectionNameForBigramIndex() const = 0;
+
   // Encode value(word) string
   virtual void EncodeValue(const StringPiece src, string *dst) const = 0;
 
@@ -0,0 +1,92 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "dictionary/system/decoded_value_cache.h"
+
+#include "base/logging.h"
+
+namespace mozc {
+namespace dictionary {
+
+DecodedValueCache::DecodedValueCache(size_t size)
+    : hit_count_(0), miss_count_(0) {
+  DCHECK_GT(size, 0);
+  size_t capacity = 1;
+  while (capacity < size) {
+    capacity <<= 1;
+  }
+  entries_.reset(new Entry[capacity]);
+  mask_ = capacity - 1;
+}
+
+DecodedValueCache::~DecodedValueCache() {}
+
+bool DecodedValueCache::Lookup(int id, string *value) const {
+  if (id >= 0) {
+    const size_t slot = static_cast<size_t>(id) & mask_;
+    scoped_lock l(GetLock(slot));
+    const Entry &entry = entries_[slot];
+    if (entry.id == id) {
+      value->assign(entry.value);
+      hit_count_.fetch_add(1, std::memory_order_relaxed);
+      return true;
+    }
+  }
+  miss_count_.fetch_add(1, std::memory_order_relaxed);
+  return false;
+}
+
+void DecodedValueCache::Insert(int id, StringPiece value) {
+  if (id < 0) {
+    return;
+  }
+  const size_t slot = static_cast<size_t>(id) & mask_;
+  scoped_lock l(GetLock(slot));
+  Entry *entry = &entries_[slot];
+  entry->id = id;
+  value.CopyToString(&entry->value);
+}
+
+size_t DecodedValueCache::GetHeapMemoryUsage() const {
+  // Values that fit in the inline buffer of string don't allocate.
+  const size_t inline_capacity = string().capacity();
+  size_t size = (mask_ + 1) * sizeof(Entry);
+  for (size_t slot = 0; slot <= mask_; ++slot) {
+    scoped_lock l(GetLock(slot));
+    const size_t capacity = entries_[slot].value.capacity();
+    if (capacity > inline_capacity) {
+      size += capacity + 1;
+    }
+  }
+  return size;
+}
+
+}  // namespace dictionary
+}  // namespace mozc
@@ -0,0 +1,96 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef MOZC_DICTIONARY_SYSTEM_DECODED_VALUE_CACHE_H_
+#define MOZC_DICTIONARY_SYSTEM_DECODED_VALUE_CACHE_H_
+
+#include <atomic>
+#include <memory>
+#include <string>
+
+#include "base/mutex.h"
+#include "base/port.h"
+#include "base/string_piece.h"
+
+namespace mozc {
+namespace dictionary {
+
+// Bounded cache of values decoded from the value trie of SystemDictionary,
+// keyed by value id.  The cache is direct-mapped, so a value evicts the older
+// one sharing the same slot.  Slots are guarded by a fixed number of striped
+// locks, and thus the cache can be shared by lookups from multiple threads.
+class DecodedValueCache {
+ public:
+  // |size| is the number of entries, rounded up to a power of two.
+  explicit DecodedValueCache(size_t size);
+  ~DecodedValueCache();
+
+  // Copies the value of |id| to |value| and returns true if it is cached.
+  bool Lookup(int id, string *value) const;
+
+  // Caches |value| for |id|.  Negative ids are ignored.
+  void Insert(int id, StringPiece value);
+
+  size_t size() const { return mask_ + 1; }
+  uint64 hit_count() const {
+    return hit_count_.load(std::memory_order_relaxed);
+  }
+  uint64 miss_count() const {
+    return miss_count_.load(std::memory_order_relaxed);
+  }
+
+  // Returns the size of the entries and the values allocated in heap, in
+  // bytes.
+  size_t GetHeapMemoryUsage() const;
+
+ private:
+  struct Entry {
+    Entry() : id(-1) {}
+    int id;
+    string value;
+  };
+
+  static const size_t kNumLocks = 64;
+
+  Mutex *GetLock(size_t slot) const { return &locks_[slot % kNumLocks]; }
+
+  std::unique_ptr<Entry[]> entries_;
+  size_t mask_;
+  mutable Mutex locks_[kNumLocks];
+  mutable std::atomic<uint64> hit_count_;
+  mutable std::atomic<uint64> miss_count_;
+
+  DISALLOW_COPY_AND_ASSIGN(DecodedValueCache);
+};
+
+}  // namespace dictionary
+}  // namespace mozc
+
+#endif  // MOZC_DICTIONARY_SYSTEM_DECODED_VALUE_CACHE_H_
@@ -0,0 +1,71 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "dictionary/system/decoded_value_cache.h"
+
+#include <string>
+
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace dictionary {
+namespace {
+
+TEST(DecodedValueCacheTest, RoundsUpSize) {
+  EXPECT_EQ(1, DecodedValueCache(1).size());
+  EXPECT_EQ(8, DecodedValueCache(5).size());
+  EXPECT_EQ(16, DecodedValueCache(16).size());
+}
+
+TEST(DecodedValueCacheTest, LookupAndInsert) {
+  DecodedValueCache cache(4);
+  string value;
+  EXPECT_FALSE(cache.Lookup(1, &value));
+  cache.Insert(1, "value1");
+  EXPECT_TRUE(cache.Lookup(1, &value));
+  EXPECT_EQ("value1", value);
+
+  // Ids 1 and 5 share the same slot, so 5 evicts 1.
+  cache.Insert(5, "value5");
+  EXPECT_FALSE(cache.Lookup(1, &value));
+  EXPECT_TRUE(cache.Lookup(5, &value));
+  EXPECT_EQ("value5", value);
+
+  // Negative ids are never cached.
+  cache.Insert(-1, "invalid");
+  EXPECT_FALSE(cache.Lookup(-1, &value));
+
+  EXPECT_EQ(2, cache.hit_count());
+  EXPECT_EQ(3, cache.miss_count());
+}
+
+}  // namespace
+}  // namespace dictionary
+}  // namespace mozc
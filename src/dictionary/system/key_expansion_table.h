@@ -67,6 +67,7 @@ class KeyExpansionTable {
   KeyExpansionTable() {
     // Initialize with identity matrix.
     memset(table_, 0, sizeof(table_));
+    memset(is_expanded_, 0, sizeof(is_expanded_));
     for (size_t i = 0; i < 256; ++i) {
       SetBit(i, i);
     }
@@ -76,6 +77,9 @@ class KeyExpansionTable {
   void Add(char key, const string &data) {
     for (size_t i = 0; i < data.length(); ++i) {
       SetBit(key, data[i]);
+      if (data[i] != key) {
+        is_expanded_[static_cast<uint8>(key)] = true;
+      }
     }
   }
 
@@ -83,6 +87,12 @@ class KeyExpansionTable {
     return ExpandedKey(table_[key]);
   }
 
+  // Returns true if |key| is expanded to any character other than itself.
+  // Otherwise, the traversal can simply follow the edge labeled |key|.
+  bool IsExpanded(char key) const {
+    return is_expanded_[static_cast<uint8>(key)];
+  }
+
   // Returns the default (no-effective) KeyExpansionTable instance.
   // (in other words, the result holds identity-bitmap matrix).
   static const KeyExpansionTable &GetDefaultInstance() {
@@ -99,6 +109,9 @@ class KeyExpansionTable {
   // 256x256 (key -> value) bit map matrix.
   uint32 table_[256][256 / 32];
 
+  // True if the row of the key has a bit other than the diagonal one.
+  bool is_expanded_[256];
+
   DISALLOW_COPY_AND_ASSIGN(KeyExpansionTable);
 };
 
@@ -60,6 +60,21 @@ TEST(KeyExpansionTableTest, Test) {
   EXPECT_TRUE(table.ExpandKey('d').IsHit('d'));
 }
 
+TEST(KeyExpansionTableTest, IsExpanded) {
+  KeyExpansionTable table;
+  table.Add('b', "d");
+  table.Add('c', "c");
+
+  EXPECT_FALSE(table.IsExpanded('a'));
+  EXPECT_TRUE(table.IsExpanded('b'));
+  // Expanding to itself is not an expansion.
+  EXPECT_FALSE(table.IsExpanded('c'));
+  // The expansion is one-way.
+  EXPECT_FALSE(table.IsExpanded('d'));
+
+  EXPECT_FALSE(KeyExpansionTable::GetDefaultInstance().IsExpanded('b'));
+}
+
 }  // namespace
 }  // namespace dictionary
 }  // namespace mozc
@@ -178,6 +178,40 @@ inline const uint8 *GetTokenArrayPtr(const BitVectorBasedArray &token_array,
   return reinterpret_cast<const uint8*>(token_array.Get(key_id, &length));
 }
 
+// Same as GetTokenArrayPtr() for each of |key_ids|, but reads the token
+// arrays of nearby key ids in one pass of BitVectorBasedArray::GetRange().
+// The keys found by a predictive lookup often have consecutive ids.
+void GetTokenArrayPtrs(const BitVectorBasedArray &token_array,
+                       const std::vector<int> &key_ids,
+                       std::vector<const uint8 *> *ptrs) {
+  // Gaps up to this size are read through rather than located again.
+  const int kMaxGap = 8;
+  std::vector<size_t> order(key_ids.size());
+  for (size_t i = 0; i < order.size(); ++i) {
+    order[i] = i;
+  }
+  std::sort(order.begin(), order.end(), [&key_ids](size_t a, size_t b) {
+    return key_ids[a] < key_ids[b];
+  });
+
+  ptrs->resize(key_ids.size());
+  std::vector<const char *> elements;
+  for (size_t i = 0; i < order.size();) {
+    const int first = key_ids[order[i]];
+    size_t j = i + 1;
+    while (j < order.size() &&
+           key_ids[order[j]] - key_ids[order[j - 1]] <= kMaxGap) {
+      ++j;
+    }
+    elements.resize(key_ids[order[j - 1]] - first + 1);
+    token_array.GetRange(first, elements.size(), elements.data(), nullptr);
+    for (; i < j; ++i) {
+      (*ptrs)[order[i]] =
+          reinterpret_cast<const uint8 *>(elements[key_ids[order[i]] - first]);
+    }
+  }
+}
+
 // Iterator for scanning token array.
 // This iterator does not return actual token info but returns
 // id data and the position only.
@@ -299,14 +333,26 @@ class SystemDictionary::ReverseLookupCache {
     return true;
   }
 
+  size_t GetHeapMemoryUsage() const {
+    // Each node of std::multimap holds the value, three links and a color.
+    const size_t kNodeSize =
+        sizeof(std::multimap<int, ReverseLookupResult>::value_type) +
+        4 * sizeof(void *);
+    return sizeof(*this) + results.size() * kNodeSize;
+  }
+
   std::multimap<int, ReverseLookupResult> results;
 
  private:
   DISALLOW_COPY_AND_ASSIGN(ReverseLookupCache);
 };
 
+// Index from ids in value trie to ids in key trie, stored in the layout of the
+// reverse lookup index section described in words_info.h.  The image is either
+// mapped from the dictionary file or built in heap by scanning the tokens.
 class SystemDictionary::ReverseLookupIndex {
  public:
+  // Builds the index by scanning |token_array|.
   ReverseLookupIndex(
       const SystemDictionaryCodecInterface *codec,
       const BitVectorBasedArray &token_array) {
@@ -317,86 +363,134 @@ class SystemDictionary::ReverseLookupIndex {
       const TokenScanIterator::Result &result = iter.Get();
       value_id_max = std::max(value_id_max, result.value_id);
     }
-
     CHECK_GE(value_id_max, 0);
-    index_size_ = value_id_max + 1;
-    index_.reset(new ReverseLookupResultArray[index_size_]);
+    const uint32 num_value_ids = value_id_max + 1;
 
-    // Gets result size for each ids.
+    // Gets result size for each ids, and then the offsets.
+    std::vector<uint32> offsets(num_value_ids + 1, 0);
     for (TokenScanIterator iter(codec, token_array);
          !iter.Done(); iter.Next()) {
       const TokenScanIterator::Result &result = iter.Get();
       if (result.value_id != -1) {
-        DCHECK_LT(result.value_id, index_size_);
-        ++(index_[result.value_id].size);
+        ++offsets[result.value_id + 1];
       }
     }
-
-    for (size_t i = 0; i < index_size_; ++i) {
-      index_[i].results.reset(new ReverseLookupResult[index_[i].size]);
+    for (size_t i = 1; i < offsets.size(); ++i) {
+      offsets[i] += offsets[i - 1];
     }
 
     // Builds index.
+    owned_image_.resize(num_value_ids + 2 + offsets.back());
+    owned_image_[0] = num_value_ids;
+    std::copy(offsets.begin(), offsets.end(), owned_image_.begin() + 1);
+    uint32 *key_ids = &owned_image_[num_value_ids + 2];
     for (TokenScanIterator iter(codec, token_array);
          !iter.Done(); iter.Next()) {
       const TokenScanIterator::Result &result = iter.Get();
-      if (result.value_id == -1) {
-        continue;
-      }
-
-      DCHECK_LT(result.value_id, index_size_);
-      ReverseLookupResultArray *result_array = &index_[result.value_id];
-
-      // Finds uninitialized result.
-      size_t result_index = 0;
-      for (result_index = 0;
-           result_index < result_array->size;
-           ++result_index) {
-        const ReverseLookupResult &lookup_result =
-            result_array->results[result_index];
-        if (lookup_result.tokens_offset == -1 &&
-            lookup_result.id_in_key_trie == -1) {
-          result_array->results[result_index].tokens_offset =
-              result.tokens_offset;
-          result_array->results[result_index].id_in_key_trie = result.index;
-          break;
-        }
+      if (result.value_id != -1) {
+        key_ids[offsets[result.value_id]++] = result.index;
       }
     }
+    Init(owned_image_.data());
+  }
 
-    CHECK(index_ != nullptr);
+  // Uses |image| mapped from the dictionary file, which must outlive this
+  // instance.  Returns nullptr if |image| is broken.
+  static ReverseLookupIndex *CreateFromImage(const uint32 *image,
+                                             size_t size) {
+    if (image == nullptr || size < 2 || size - 2 < image[0] ||
+        size - 2 - image[0] < image[image[0] + 1]) {
+      return nullptr;
+    }
+    return new ReverseLookupIndex(image);
   }
 
   ~ReverseLookupIndex() {}
 
+  size_t GetHeapMemoryUsage() const {
+    return sizeof(*this) + owned_image_.capacity() * sizeof(uint32);
+  }
+
   void FillResultMap(const std::set<int> &id_set,
+                     const BitVectorBasedArray &token_array,
                      std::multimap<int, ReverseLookupResult> *result_map) {
+    const uint8 *encoded_tokens_ptr = GetTokenArrayPtr(token_array, 0);
     for (std::set<int>::const_iterator id_itr  = id_set.begin();
          id_itr != id_set.end(); ++id_itr) {
-      const ReverseLookupResultArray &result_array = index_[*id_itr];
-      for (size_t i = 0; i < result_array.size; ++i) {
-        result_map->insert(std::make_pair(*id_itr, result_array.results[i]));
+      if (*id_itr < 0 || *id_itr >= num_value_ids_) {
+        continue;
+      }
+      for (uint32 i = offsets_[*id_itr]; i < offsets_[*id_itr + 1]; ++i) {
+        ReverseLookupResult result;
+        result.id_in_key_trie = key_ids_[i];
+        result.tokens_offset =
+            GetTokenArrayPtr(token_array, key_ids_[i]) - encoded_tokens_ptr;
+        result_map->insert(std::make_pair(*id_itr, result));
       }
     }
   }
 
  private:
-  struct ReverseLookupResultArray {
-    ReverseLookupResultArray() : size(0) {}
-    // Use std::unique_ptr for reducing memory consumption as possible.
-    // Using vector requires 90 MB even when we call resize explicitly.
-    // On the other hand, std::unique_ptr requires 57 MB.
-    std::unique_ptr<ReverseLookupResult[]> results;
-    size_t size;
-  };
+  explicit ReverseLookupIndex(const uint32 *image) {
+    Init(image);
+  }
+
+  void Init(const uint32 *image) {
+    num_value_ids_ = image[0];
+    offsets_ = image + 1;
+    key_ids_ = image + num_value_ids_ + 2;
+  }
 
-  // Use scoped array for reducing memory consumption as possible.
-  std::unique_ptr<ReverseLookupResultArray[]> index_;
-  size_t index_size_;
+  // Empty if the image is mapped from the dictionary file.
+  std::vector<uint32> owned_image_;
+  int num_value_ids_;
+  const uint32 *offsets_;
+  const uint32 *key_ids_;
 
   DISALLOW_COPY_AND_ASSIGN(ReverseLookupIndex);
 };
 
+// Index from ids in value trie to the ids in key trie of the keys whose
+// tokens continue the value, stored in the layout of the bigram index section
+// described in words_info.h.  Always mapped from the dictionary file.
+class SystemDictionary::BigramIndex {
+ public:
+  // |image| must outlive this instance.  Returns nullptr if |image| is
+  // broken.
+  static BigramIndex *CreateFromImage(const uint32 *image, size_t size) {
+    if (image == nullptr || size < 2 || size - 2 < image[0] ||
+        size - 2 - image[0] < image[image[0] + 1]) {
+      return nullptr;
+    }
+    return new BigramIndex(image);
+  }
+
+  ~BigramIndex() {}
+
+  // Sets the range of the key ids for |value_id| to [|begin|, |end|).
+  void GetKeyIds(int value_id, const uint32 **begin,
+                 const uint32 **end) const {
+    if (value_id < 0 || value_id >= num_value_ids_) {
+      *begin = *end = key_ids_;
+      return;
+    }
+    *begin = key_ids_ + offsets_[value_id];
+    *end = key_ids_ + offsets_[value_id + 1];
+  }
+
+ private:
+  explicit BigramIndex(const uint32 *image)
+      : num_value_ids_(image[0]),
+        offsets_(image + 1),
+        key_ids_(image + image[0] + 2) {}
+
+  const int num_value_ids_;
+  const uint32 *offsets_;
+  const uint32 *key_ids_;
+
+  DISALLOW_COPY_AND_ASSIGN(BigramIndex);
+};
+
 struct SystemDictionary::PredictiveLookupSearchState {
   PredictiveLookupSearchState() : key_pos(0), is_expanded(false) {}
   PredictiveLookupSearchState(const storage::louds::LoudsTrie::Node &n,
@@ -418,7 +512,8 @@ struct SystemDictionary::Builder::Specification {
                 const SystemDictionaryCodecInterface *codec,
                 const DictionaryFileCodecInterface *file_codec)
       : type(t), filename(fn), ptr(p), len(l), options(o), codec(codec),
-        file_codec(file_codec) {}
+        file_codec(file_codec), key_trie_child_cache_size(0),
+        value_cache_size(0) {}
 
   InputType type;
 
@@ -432,6 +527,8 @@ struct SystemDictionary::Builder::Specification {
   Options options;
   const SystemDictionaryCodecInterface *codec;
   const DictionaryFileCodecInterface *file_codec;
+  size_t key_trie_child_cache_size;
+  size_t value_cache_size;
 };
 
 SystemDictionary::Builder::Builder(const string &filename)
@@ -456,6 +553,18 @@ SystemDictionary::Builder &SystemDictionary::Builder::SetCodec(
   return *this;
 }
 
+SystemDictionary::Builder &SystemDictionary::Builder::SetKeyTrieChildCacheSize(
+    size_t size) {
+  spec_->key_trie_child_cache_size = size;
+  return *this;
+}
+
+SystemDictionary::Builder &SystemDictionary::Builder::SetValueCacheSize(
+    size_t size) {
+  spec_->value_cache_size = size;
+  return *this;
+}
+
 SystemDictionary *SystemDictionary::Builder::Build() {
   if (spec_->codec == nullptr) {
     spec_->codec = SystemDictionaryCodecFactory::GetCodec();
@@ -493,11 +602,21 @@ SystemDictionary *SystemDictionary::Builder::Build() {
   }
 
   if (!instance->OpenDictionaryFile(
-          (spec_->options & ENABLE_REVERSE_LOOKUP_INDEX) != 0)) {
+          (spec_->options & ENABLE_REVERSE_LOOKUP_INDEX) != 0,
+          spec_->key_trie_child_cache_size)) {
     LOG(ERROR) << "Failed to create system dictionary";
     return nullptr;
   }
 
+  instance->enable_cost_ordered_prediction_ =
+      (spec_->options & ENABLE_COST_ORDERED_PREDICTION) != 0 &&
+      instance->num_predictive_cost_bounds_ > 0;
+
+  if (spec_->value_cache_size > 0) {
+    instance->value_cache_.reset(
+        new DecodedValueCache(spec_->value_cache_size));
+  }
+
   return instance.release();
 }
 
@@ -505,14 +624,25 @@ SystemDictionary::SystemDictionary(
     const SystemDictionaryCodecInterface *codec,
     const DictionaryFileCodecInterface *file_codec)
     : frequent_pos_(nullptr),
+      predictive_cost_bounds_(nullptr),
+      num_predictive_cost_bounds_(0),
+      enable_cost_ordered_prediction_(false),
       codec_(codec),
       dictionary_file_(new DictionaryFile(file_codec)) {}
 
 SystemDictionary::~SystemDictionary() {}
 
-bool SystemDictionary::OpenDictionaryFile(bool enable_reverse_lookup_index) {
+bool SystemDictionary::OpenDictionaryFile(bool enable_reverse_lookup_index,
+                                          size_t key_trie_child_cache_size) {
   int len;
 
+  // The key trie and the token array are read by every lookup; start to page
+  // them in while the other sections are set up.
+  dictionary_file_->AdviseSection(codec_->GetSectionNameForKey(),
+                                  Mmap::WILL_NEED);
+  dictionary_file_->AdviseSection(codec_->GetSectionNameForTokens(),
+                                  Mmap::WILL_NEED);
+
   const uint8 *key_image = reinterpret_cast<const uint8 *>(
       dictionary_file_->GetSection(codec_->GetSectionNameForKey(), &len));
   if (!key_trie_.Open(key_image,
@@ -524,6 +654,7 @@ bool SystemDictionary::OpenDictionaryFile(bool enable_reverse_lookup_index) {
     LOG(ERROR) << "cannot open key trie";
     return false;
   }
+  key_trie_.EnableChildCache(key_trie_child_cache_size);
 
   BuildHiraganaExpansionTable(*codec_, &hiragana_expansion_table_);
 
@@ -550,10 +681,38 @@ bool SystemDictionary::OpenDictionaryFile(bool enable_reverse_lookup_index) {
     return false;
   }
 
+  // Cost bounds are optional as older dictionaries don't have them.
+  predictive_cost_bounds_ = reinterpret_cast<const uint16 *>(
+      dictionary_file_->GetSection(
+          codec_->GetSectionNameForPredictiveCostBounds(), &len));
+  num_predictive_cost_bounds_ =
+      predictive_cost_bounds_ == nullptr ? 0 : len / sizeof(uint16);
+
+  // Prefers the index in the dictionary file, which is shared between
+  // processes and costs nothing at startup.
+  const uint32 *reverse_lookup_index_image = reinterpret_cast<const uint32 *>(
+      dictionary_file_->GetSection(
+          codec_->GetSectionNameForReverseLookupIndex(), &len));
+  if (reverse_lookup_index_image != nullptr) {
+    reverse_lookup_index_.reset(ReverseLookupIndex::CreateFromImage(
+        reverse_lookup_index_image, len / sizeof(uint32)));
+    LOG_IF(ERROR, reverse_lookup_index_ == nullptr)
+        << "Broken reverse lookup index section";
+  }
   if (enable_reverse_lookup_index) {
     InitReverseLookupIndex();
   }
 
+  // The bigram index is optional as it's built only on request.
+  const uint32 *bigram_index_image = reinterpret_cast<const uint32 *>(
+      dictionary_file_->GetSection(codec_->GetSectionNameForBigramIndex(),
+                                   &len));
+  if (bigram_index_image != nullptr) {
+    bigram_index_.reset(BigramIndex::CreateFromImage(
+        bigram_index_image, len / sizeof(uint32)));
+    LOG_IF(ERROR, bigram_index_ == nullptr) << "Broken bigram index section";
+  }
+
   return true;
 }
 
@@ -611,10 +770,9 @@ bool SystemDictionary::HasValue(StringPiece value) const {
 
   // Check tokens.
   for (TokenDecodeIterator iter(codec_, value_trie_, frequent_pos_, key,
-                                encoded_tokens_ptr);
+                                encoded_tokens_ptr, value_cache_.get());
        !iter.Done(); iter.Next()) {
-    const Token *token = iter.Get().token;
-    if (value == token->value) {
+    if (value == iter.GetView().value) {
       return true;
     }
   }
@@ -635,6 +793,14 @@ void SystemDictionary::CollectPredictiveNodesInBfsOrder(
     // Update traversal state for |encoded_key| and its expanded keys.
     if (state.key_pos < encoded_key.size()) {
       const char target_char = encoded_key[state.key_pos];
+      if (!table.IsExpanded(target_char)) {
+        if (key_trie_.MoveToChildByLabel(target_char, &state.node)) {
+          queue.push(PredictiveLookupSearchState(state.node,
+                                                 state.key_pos + 1,
+                                                 state.is_expanded));
+        }
+        continue;
+      }
       const ExpandedKey &chars = table.ExpandKey(target_char);
 
       for (key_trie_.MoveToFirstChild(&state.node);
@@ -689,6 +855,107 @@ void SystemDictionary::CollectPredictiveNodesInBfsOrder(
   } while (!queue.empty());
 }
 
+uint16 SystemDictionary::GetPredictiveCostBound(const LoudsTrie::Node &node,
+                                               bool key_only,
+                                               uint16 default_bound) const {
+  const size_t index = 2 * (node.node_id() - 1) + (key_only ? 1 : 0);
+  return index < num_predictive_cost_bounds_ ? predictive_cost_bounds_[index]
+                                             : default_bound;
+}
+
+void SystemDictionary::CollectPredictiveNodesInCostOrder(
+    StringPiece encoded_key,
+    const KeyExpansionTable &table,
+    size_t limit,
+    std::vector<PredictiveLookupSearchState> *result) const {
+  // An entry is either a subtree to be expanded or a key to be collected,
+  // prioritized by the lower bound of its costs.  Nodes deeper than the
+  // annotated ones inherit the bound of their parents, which is still valid.
+  struct Entry {
+    Entry(uint16 c, bool k, const PredictiveLookupSearchState &s)
+        : cost(c), is_key(k), state(s) {}
+
+    // Returns true if |this| has lower priority than |other|.  Ties are
+    // broken by preferring keys to subtrees, and then shorter keys.
+    bool operator<(const Entry &other) const {
+      if (cost != other.cost) {
+        return cost > other.cost;
+      }
+      if (is_key != other.is_key) {
+        return other.is_key;
+      }
+      if (state.key_pos != other.state.key_pos) {
+        return state.key_pos > other.state.key_pos;
+      }
+      return state.node.node_id() > other.state.node.node_id();
+    }
+
+    uint16 cost;
+    bool is_key;
+    PredictiveLookupSearchState state;
+  };
+  std::priority_queue<Entry> queue;
+
+  // Find the nodes for |encoded_key| and its expanded keys.
+  std::vector<PredictiveLookupSearchState> stack;
+  stack.push_back(PredictiveLookupSearchState(LoudsTrie::Node(), 0, false));
+  while (!stack.empty()) {
+    PredictiveLookupSearchState state = stack.back();
+    stack.pop_back();
+    if (state.key_pos == encoded_key.size()) {
+      queue.push(Entry(GetPredictiveCostBound(state.node, false, 0), false,
+                       state));
+      continue;
+    }
+    const char target_char = encoded_key[state.key_pos];
+    if (!table.IsExpanded(target_char)) {
+      if (key_trie_.MoveToChildByLabel(target_char, &state.node)) {
+        stack.push_back(PredictiveLookupSearchState(state.node,
+                                                    state.key_pos + 1,
+                                                    state.is_expanded));
+      }
+      continue;
+    }
+    const ExpandedKey &chars = table.ExpandKey(target_char);
+    for (key_trie_.MoveToFirstChild(&state.node);
+         key_trie_.IsValidNode(state.node);
+         key_trie_.MoveToNextSibling(&state.node)) {
+      const char c = key_trie_.GetEdgeLabelToParentNode(state.node);
+      if (!chars.IsHit(c)) {
+        continue;
+      }
+      const bool is_expanded = state.is_expanded || c != target_char;
+      stack.push_back(PredictiveLookupSearchState(state.node,
+                                                  state.key_pos + 1,
+                                                  is_expanded));
+    }
+  }
+
+  // Collect prediction keys in best-first order.
+  while (!queue.empty() && result->size() < limit) {
+    const Entry entry = queue.top();
+    queue.pop();
+    if (entry.is_key) {
+      result->push_back(entry.state);
+      continue;
+    }
+    if (key_trie_.IsTerminalNode(entry.state.node)) {
+      queue.push(Entry(GetPredictiveCostBound(entry.state.node, true,
+                                              entry.cost),
+                       true, entry.state));
+    }
+    PredictiveLookupSearchState child(entry.state.node,
+                                      entry.state.key_pos + 1,
+                                      entry.state.is_expanded);
+    for (key_trie_.MoveToFirstChild(&child.node);
+         key_trie_.IsValidNode(child.node);
+         key_trie_.MoveToNextSibling(&child.node)) {
+      queue.push(Entry(GetPredictiveCostBound(child.node, false, entry.cost),
+                       false, child));
+    }
+  }
+}
+
 void SystemDictionary::LookupPredictive(
     StringPiece key,
     const ConversionRequest &conversion_request,
@@ -716,7 +983,20 @@ void SystemDictionary::LookupPredictive(
   const size_t kLookupLimit = 64;
   std::vector<PredictiveLookupSearchState> result;
   result.reserve(kLookupLimit);
-  CollectPredictiveNodesInBfsOrder(encoded_key, table, kLookupLimit, &result);
+  if (enable_cost_ordered_prediction_) {
+    CollectPredictiveNodesInCostOrder(encoded_key, table, kLookupLimit,
+                                      &result);
+  } else {
+    CollectPredictiveNodesInBfsOrder(encoded_key, table, kLookupLimit,
+                                     &result);
+  }
+
+  std::vector<int> key_ids(result.size());
+  for (size_t i = 0; i < result.size(); ++i) {
+    key_ids[i] = key_trie_.GetKeyIdOfTerminalNode(result[i].node);
+  }
+  std::vector<const uint8 *> encoded_tokens;
+  GetTokenArrayPtrs(token_array_, key_ids, &encoded_tokens);
 
   // Reused buffer and instances inside the following loop.
   char encoded_actual_key_buffer[LoudsTrie::kMaxDepth + 1];
@@ -772,14 +1052,102 @@ void SystemDictionary::LookupPredictive(
         break;
     }
 
-    const int key_id = key_trie_.GetKeyIdOfTerminalNode(state.node);
     for (TokenDecodeIterator iter(codec_, value_trie_,
                                   frequent_pos_, actual_key,
-                                  GetTokenArrayPtr(token_array_, key_id));
+                                  encoded_tokens[i],
+                                  value_cache_.get());
          !iter.Done(); iter.Next()) {
-      const TokenInfo &token_info = iter.Get();
       const Callback::ResultType result =
-          callback->OnToken(decoded_key, actual_key, *token_info.token);
+          callback->OnTokenView(decoded_key, actual_key, iter.GetView());
+      if (result == Callback::TRAVERSE_DONE) {
+        return;
+      }
+      if (result == Callback::TRAVERSE_NEXT_KEY) {
+        break;
+      }
+      DCHECK_NE(Callback::TRAVERSE_CULL, result) << "Not implemented";
+    }
+  }
+}
+
+void SystemDictionary::LookupPredictiveWithValuePrefix(
+    StringPiece key, StringPiece value_prefix,
+    const ConversionRequest &conversion_request,
+    Callback *callback) const {
+  // The index doesn't cover the expanded keys.
+  if (bigram_index_ == nullptr || key.empty() ||
+      conversion_request.IsKanaModifierInsensitiveConversion()) {
+    LookupPredictive(key, conversion_request, callback);
+    return;
+  }
+  string encoded_value;
+  codec_->EncodeValue(value_prefix, &encoded_value);
+  const int value_id = value_trie_.ExactSearch(encoded_value);
+  if (value_id == -1) {
+    // The values same as their keys in hiragana or katakana aren't in the
+    // value trie and thus not in the index.
+    LookupPredictive(key, conversion_request, callback);
+    return;
+  }
+
+  string encoded_key;
+  codec_->EncodeKey(key, &encoded_key);
+  if (encoded_key.size() > LoudsTrie::kMaxDepth) {
+    return;
+  }
+
+  // Same limit as LookupPredictive(), but only the keys having the
+  // continuations count.
+  const size_t kLookupLimit = 64;
+  size_t num_keys = 0;
+  char encoded_actual_key_buffer[LoudsTrie::kMaxDepth + 1];
+  string decoded_key;
+  const uint32 *begin = nullptr, *end = nullptr;
+  bigram_index_->GetKeyIds(value_id, &begin, &end);
+  for (const uint32 *iter = begin; iter != end && num_keys < kLookupLimit;
+       ++iter) {
+    const int key_id = static_cast<int>(*iter);
+    const StringPiece encoded_actual_key =
+        key_trie_.RestoreKeyString(key_id, encoded_actual_key_buffer);
+    if (!Util::StartsWith(encoded_actual_key, encoded_key)) {
+      continue;
+    }
+    ++num_keys;
+    decoded_key.clear();
+    codec_->DecodeKey(encoded_actual_key, &decoded_key);
+    switch (callback->OnKey(decoded_key)) {
+      case Callback::TRAVERSE_DONE:
+        return;
+      case Callback::TRAVERSE_NEXT_KEY:
+        continue;
+      case Callback::TRAVERSE_CULL:
+        LOG(FATAL) << "Culling is not implemented.";
+        continue;
+      default:
+        break;
+    }
+    switch (callback->OnActualKey(decoded_key, decoded_key, false)) {
+      case Callback::TRAVERSE_DONE:
+        return;
+      case Callback::TRAVERSE_NEXT_KEY:
+        continue;
+      case Callback::TRAVERSE_CULL:
+        LOG(FATAL) << "Culling is not implemented.";
+        continue;
+      default:
+        break;
+    }
+    for (TokenDecodeIterator token_iter(codec_, value_trie_, frequent_pos_,
+                                        decoded_key,
+                                        GetTokenArrayPtr(token_array_, key_id),
+                                        value_cache_.get());
+         !token_iter.Done(); token_iter.Next()) {
+      const TokenView &token = token_iter.GetView();
+      if (!Util::StartsWith(token.value, value_prefix)) {
+        continue;
+      }
+      const Callback::ResultType result =
+          callback->OnTokenView(decoded_key, decoded_key, token);
       if (result == Callback::TRAVERSE_DONE) {
         return;
       }
@@ -805,14 +1173,17 @@ namespace {
 //   callback:
 //     A callback function to be called.
 //   token_filter:
-//     A functor of signature bool(const TokenInfo &).  Only tokens for which
-//     this functor returns true are passed to callback function.
+//     A functor of signature bool(const TokenInfo &, const TokenView &).  The
+//     key and value of the TokenInfo's token are not set; see the TokenView.
+//     Only tokens for which this functor returns true are passed to callback
+//     function.
 template <typename Func>
 void RunCallbackOnEachPrefix(const LoudsTrie &key_trie,
                              const LoudsTrie &value_trie,
                              const BitVectorBasedArray &token_array,
                              const SystemDictionaryCodecInterface *codec,
                              const uint32 *frequent_pos,
+                             DecodedValueCache *value_cache,
                              const char *key,
                              StringPiece encoded_key,
                              DictionaryInterface::Callback *callback,
@@ -852,14 +1223,15 @@ void RunCallbackOnEachPrefix(const LoudsTrie &key_trie,
 
     const int key_id = key_trie.GetKeyIdOfTerminalNode(node);
     for (TokenDecodeIterator iter(codec, value_trie, frequent_pos, prefix,
-                                  GetTokenArrayPtr(token_array, key_id));
+                                  GetTokenArrayPtr(token_array, key_id),
+                                  value_cache);
          !iter.Done(); iter.Next()) {
-      const TokenInfo &token_info = iter.Get();
-      if (!token_filter(token_info)) {
+      const TokenView &token = iter.GetView();
+      if (!token_filter(iter.GetInfoWithoutKeyValue(), token)) {
         continue;
       }
       const Callback::ResultType res =
-          callback->OnToken(prefix, prefix, *token_info.token);
+          callback->OnTokenView(prefix, prefix, token);
       if (res == Callback::TRAVERSE_DONE || res == Callback::TRAVERSE_CULL) {
         return;
       }
@@ -871,7 +1243,9 @@ void RunCallbackOnEachPrefix(const LoudsTrie &key_trie,
 }
 
 struct SelectAllTokens {
-  bool operator()(const TokenInfo &token_info) const { return true; }
+  bool operator()(const TokenInfo &token_info, const TokenView &token) const {
+    return true;
+  }
 };
 
 class ReverseLookupCallbackWrapper : public DictionaryInterface::Callback {
@@ -885,6 +1259,12 @@ class ReverseLookupCallbackWrapper : public DictionaryInterface::Callback {
     modified_token.key.swap(modified_token.value);
     return callback_->OnToken(key, actual_key, modified_token);
   }
+  virtual SystemDictionary::Callback::ResultType OnTokenView(
+      StringPiece key, StringPiece actual_key, const TokenView &token) {
+    TokenView modified_token = token;
+    std::swap(modified_token.key, modified_token.value);
+    return callback_->OnTokenView(key, actual_key, modified_token);
+  }
 
   DictionaryInterface::Callback *callback_;
 };
@@ -960,10 +1340,10 @@ SystemDictionary::LookupPrefixWithKeyExpansionImpl(
     const int key_id = key_trie_.GetKeyIdOfTerminalNode(node);
     for (TokenDecodeIterator iter(codec_, value_trie_, frequent_pos_,
                                   *actual_prefix,
-                                  GetTokenArrayPtr(token_array_, key_id));
+                                  GetTokenArrayPtr(token_array_, key_id),
+                                  value_cache_.get());
          !iter.Done(); iter.Next()) {
-      const TokenInfo &token_info = iter.Get();
-      result = callback->OnToken(prefix, *actual_prefix, *token_info.token);
+      result = callback->OnTokenView(prefix, *actual_prefix, iter.GetView());
       if (result == Callback::TRAVERSE_DONE ||
           result == Callback::TRAVERSE_CULL) {
         return result;
@@ -979,6 +1359,20 @@ SystemDictionary::LookupPrefixWithKeyExpansionImpl(
     return Callback::TRAVERSE_CONTINUE;
   }
   const char current_char = encoded_key[key_pos];
+  if (!table.IsExpanded(current_char)) {
+    // Most characters have no expansion, for which the lookup is a plain
+    // trie traversal; the child is found directly (and via the child cache
+    // if enabled) rather than by testing every sibling against the table.
+    if (!key_trie_.MoveToChildByLabel(current_char, &node)) {
+      return Callback::TRAVERSE_CONTINUE;
+    }
+    actual_key_buffer[key_pos] = current_char;
+    const Callback::ResultType result = LookupPrefixWithKeyExpansionImpl(
+        key, encoded_key, table, callback, node, key_pos + 1, is_expanded,
+        actual_key_buffer, actual_prefix);
+    return result == Callback::TRAVERSE_DONE ? Callback::TRAVERSE_DONE
+                                             : Callback::TRAVERSE_CONTINUE;
+  }
   const ExpandedKey &chars = table.ExpandKey(current_char);
   for (key_trie_.MoveToFirstChild(&node); key_trie_.IsValidNode(node);
        key_trie_.MoveToNextSibling(&node)) {
@@ -1008,7 +1402,8 @@ void SystemDictionary::LookupPrefix(
 
   if (!conversion_request.IsKanaModifierInsensitiveConversion()) {
     RunCallbackOnEachPrefix(key_trie_, value_trie_, token_array_, codec_,
-                            frequent_pos_, key.data(), encoded_key, callback,
+                            frequent_pos_, value_cache_.get(), key.data(),
+                            encoded_key, callback,
                             SelectAllTokens());
     return;
   }
@@ -1022,6 +1417,53 @@ void SystemDictionary::LookupPrefix(
                                    actual_key_buffer, &actual_prefix);
 }
 
+void SystemDictionary::LookupPrefixBatch(
+    StringPiece key,
+    const std::vector<size_t> &begin_positions,
+    const ConversionRequest &conversion_request,
+    BatchCallback *batch_callback) const {
+  // Since the key codec encodes characters one by one, the encoded suffix is
+  // the suffix of |encoded_key| after the encoded length of the preceding
+  // characters.
+  string encoded_key;
+  codec_->EncodeKey(key, &encoded_key);
+  const bool use_kana_modifier_insensitive_lookup =
+      conversion_request.IsKanaModifierInsensitiveConversion();
+
+  char actual_key_buffer[LoudsTrie::kMaxDepth + 1];
+  string actual_prefix;
+  actual_prefix.reserve(key.size() * 3);
+  size_t pos = 0;
+  size_t encoded_pos = 0;
+  for (size_t i = 0; i < begin_positions.size(); ++i) {
+    const size_t begin_pos = begin_positions[i];
+    DCHECK_LE(pos, begin_pos);
+    DCHECK_LE(begin_pos, key.size());
+    encoded_pos += codec_->GetEncodedKeyLength(key.substr(pos,
+                                                          begin_pos - pos));
+    pos = begin_pos;
+
+    Callback *callback = batch_callback->OnBeginPosition(begin_pos);
+    if (callback == nullptr) {
+      continue;
+    }
+    const StringPiece encoded_suffix =
+        StringPiece(encoded_key).substr(encoded_pos);
+    if (!use_kana_modifier_insensitive_lookup) {
+      RunCallbackOnEachPrefix(key_trie_, value_trie_, token_array_, codec_,
+                              frequent_pos_, value_cache_.get(),
+                              key.data() + begin_pos, encoded_suffix, callback,
+                              SelectAllTokens());
+    } else {
+      LookupPrefixWithKeyExpansionImpl(key.data() + begin_pos, encoded_suffix,
+                                       hiragana_expansion_table_, callback,
+                                       LoudsTrie::Node(), 0, false,
+                                       actual_key_buffer, &actual_prefix);
+    }
+    batch_callback->OnEndPosition(begin_pos);
+  }
+}
+
 void SystemDictionary::LookupExact(
     StringPiece key,
     const ConversionRequest &conversion_request,
@@ -1039,9 +1481,10 @@ void SystemDictionary::LookupExact(
 
   // Callback on each token.
   for (TokenDecodeIterator iter(codec_, value_trie_, frequent_pos_, key,
-                                GetTokenArrayPtr(token_array_, key_id));
+                                GetTokenArrayPtr(token_array_, key_id),
+                                value_cache_.get());
        !iter.Done(); iter.Next()) {
-    if (callback->OnToken(key, key, *iter.Get().token) !=
+    if (callback->OnTokenView(key, key, iter.GetView()) !=
         Callback::TRAVERSE_CONTINUE) {
       break;
     }
@@ -1059,6 +1502,55 @@ void SystemDictionary::LookupReverse(
   RegisterReverseLookupTokensForValue(str, &callback_wrapper);
 }
 
+void SystemDictionary::LookupReverseBatch(
+    StringPiece str,
+    const std::vector<size_t> &begin_positions,
+    const ConversionRequest &conversion_request,
+    BatchCallback *batch_callback) const {
+  // Katakana are converted to hiragana, and both the codecs encode, one
+  // character at a time.  So the results for a suffix are the suffixes of
+  // those for |str| after the lengths of the results for the preceding
+  // characters.
+  string hiragana_value, encoded_key, encoded_value;
+  Util::KatakanaToHiragana(str, &hiragana_value);
+  codec_->EncodeKey(hiragana_value, &encoded_key);
+  codec_->EncodeValue(str, &encoded_value);
+
+  size_t pos = 0;
+  size_t hiragana_pos = 0;
+  size_t encoded_key_pos = 0;
+  size_t encoded_value_pos = 0;
+  string skipped;
+  for (size_t i = 0; i < begin_positions.size(); ++i) {
+    const size_t begin_pos = begin_positions[i];
+    DCHECK_LE(pos, begin_pos);
+    DCHECK_LE(begin_pos, str.size());
+    const StringPiece skipped_str = str.substr(pos, begin_pos - pos);
+    skipped.clear();
+    codec_->EncodeValue(skipped_str, &skipped);
+    encoded_value_pos += skipped.size();
+    skipped.clear();
+    Util::KatakanaToHiragana(skipped_str, &skipped);
+    hiragana_pos += skipped.size();
+    encoded_key_pos += codec_->GetEncodedKeyLength(skipped);
+    pos = begin_pos;
+
+    Callback *callback = batch_callback->OnBeginPosition(begin_pos);
+    if (callback == nullptr) {
+      continue;
+    }
+    ReverseLookupCallbackWrapper callback_wrapper(callback);
+    RegisterReverseLookupTokensForT13N(
+        hiragana_value.data() + hiragana_pos,
+        StringPiece(encoded_key).substr(encoded_key_pos),
+        &callback_wrapper);
+    RegisterReverseLookupTokensForEncodedValue(
+        StringPiece(encoded_value).substr(encoded_value_pos),
+        &callback_wrapper);
+    batch_callback->OnEndPosition(begin_pos);
+  }
+}
+
 namespace {
 
 class AddKeyIdsToSet {
@@ -1110,6 +1602,22 @@ void SystemDictionary::ClearReverseLookupCache() const {
   reverse_lookup_cache_.reset();
 }
 
+size_t SystemDictionary::GetHeapMemoryUsage() const {
+  size_t size = key_trie_.GetHeapMemoryUsage() +
+                value_trie_.GetHeapMemoryUsage() +
+                token_array_.GetHeapMemoryUsage();
+  if (reverse_lookup_cache_) {
+    size += reverse_lookup_cache_->GetHeapMemoryUsage();
+  }
+  if (reverse_lookup_index_) {
+    size += reverse_lookup_index_->GetHeapMemoryUsage();
+  }
+  if (value_cache_) {
+    size += value_cache_->GetHeapMemoryUsage();
+  }
+  return size;
+}
+
 namespace {
 
 class FilterTokenForRegisterReverseLookupTokensForT13N {
@@ -1118,17 +1626,17 @@ class FilterTokenForRegisterReverseLookupTokensForT13N {
     tmp_str_.reserve(LoudsTrie::kMaxDepth * 3);
   }
 
-  bool operator()(const TokenInfo &token_info) {
+  bool operator()(const TokenInfo &token_info, const TokenView &token) {
     // Skip spelling corrections.
-    if (token_info.token->attributes & Token::SPELLING_CORRECTION) {
+    if (token.attributes & Token::SPELLING_CORRECTION) {
       return false;
     }
     if (token_info.value_type != TokenInfo::AS_IS_HIRAGANA &&
         token_info.value_type != TokenInfo::AS_IS_KATAKANA) {
       // SAME_AS_PREV_VALUE may be t13n token.
       tmp_str_.clear();
-      Util::KatakanaToHiragana(token_info.token->value, &tmp_str_);
-      if (token_info.token->key != tmp_str_) {
+      Util::KatakanaToHiragana(token.value, &tmp_str_);
+      if (token.key != tmp_str_) {
         return false;
       }
     }
@@ -1146,8 +1654,16 @@ void SystemDictionary::RegisterReverseLookupTokensForT13N(
   string hiragana_value, encoded_key;
   Util::KatakanaToHiragana(value, &hiragana_value);
   codec_->EncodeKey(hiragana_value, &encoded_key);
+  RegisterReverseLookupTokensForT13N(hiragana_value.data(), encoded_key,
+                                     callback);
+}
+
+void SystemDictionary::RegisterReverseLookupTokensForT13N(
+    const char *hiragana_value, StringPiece encoded_key,
+    Callback *callback) const {
   RunCallbackOnEachPrefix(key_trie_, value_trie_, token_array_, codec_,
-                          frequent_pos_, hiragana_value.data(),
+                          frequent_pos_, value_cache_.get(),
+                          hiragana_value,
                           encoded_key, callback,
                           FilterTokenForRegisterReverseLookupTokensForT13N());
 }
@@ -1156,14 +1672,19 @@ void SystemDictionary::RegisterReverseLookupTokensForValue(
     StringPiece value, Callback *callback) const {
   string lookup_key;
   codec_->EncodeValue(value, &lookup_key);
+  RegisterReverseLookupTokensForEncodedValue(lookup_key, callback);
+}
 
+void SystemDictionary::RegisterReverseLookupTokensForEncodedValue(
+    StringPiece lookup_key, Callback *callback) const {
   std::set<int> id_set;
   AddKeyIdsOfAllPrefixes(value_trie_, lookup_key, &id_set);
 
   ReverseLookupCache *results = nullptr;
   ReverseLookupCache non_cached_results;
   if (reverse_lookup_index_ != nullptr) {
-    reverse_lookup_index_->FillResultMap(id_set, &non_cached_results.results);
+    reverse_lookup_index_->FillResultMap(id_set, token_array_,
+                                         &non_cached_results.results);
     results = &non_cached_results;
   } else if (reverse_lookup_cache_ != nullptr &&
              reverse_lookup_cache_->IsAvailable(id_set)) {
@@ -1219,14 +1740,15 @@ void SystemDictionary::RegisterReverseLookupResults(
       }
       for (TokenDecodeIterator iter(
                codec_, value_trie_, frequent_pos_, tokens_key,
-               encoded_tokens_ptr  + reverse_result.tokens_offset);
+               encoded_tokens_ptr  + reverse_result.tokens_offset,
+               value_cache_.get());
            !iter.Done(); iter.Next()) {
-        const TokenInfo &token_info = iter.Get();
+        const TokenInfo &token_info = iter.GetInfoWithoutKeyValue();
         if (token_info.token->attributes & Token::SPELLING_CORRECTION ||
             token_info.id_in_value_trie != value_id) {
           continue;
         }
-        callback->OnToken(tokens_key, tokens_key, *token_info.token);
+        callback->OnTokenView(tokens_key, tokens_key, iter.GetView());
       }
     }
   }
@@ -40,6 +40,16 @@
         '../../base/base.gyp:base_core',
       ],
     },
+    {
+      'target_name': 'decoded_value_cache',
+      'type': 'static_library',
+      'sources': [
+        'decoded_value_cache.cc',
+      ],
+      'dependencies': [
+        '../../base/base.gyp:base_core',
+      ],
+    },
     {
       'target_name': 'key_expansion_table',
       'type': 'none',
@@ -62,6 +72,7 @@
         '../dictionary_base.gyp:text_dictionary_loader',
         '../file/dictionary_file.gyp:codec_factory',
         '../file/dictionary_file.gyp:dictionary_file',
+        'decoded_value_cache',
         'key_expansion_table',
         'system_dictionary_codec',
       ],
@@ -89,7 +100,9 @@
       ],
       'dependencies': [
         '../../base/base.gyp:base_core',
+        '../../storage/louds/louds.gyp:bit_vector_based_array',
         '../../storage/louds/louds.gyp:bit_vector_based_array_builder',
+        '../../storage/louds/louds.gyp:louds_trie',
         '../../storage/louds/louds.gyp:louds_trie_builder',
         '../dictionary_base.gyp:pos_matcher',
         '../dictionary_base.gyp:text_dictionary_loader',
@@ -98,5 +111,21 @@
         'system_dictionary_codec',
       ],
     },
+    {
+      'target_name': 'system_dictionary_benchmark',
+      'type': 'executable',
+      'sources': [
+        'system_dictionary_benchmark.cc',
+      ],
+      'dependencies': [
+        '../../base/base.gyp:base',
+        '../../config/config.gyp:config_handler',
+        '../../data_manager/data_manager_base.gyp:data_manager',
+        '../../protocol/protocol.gyp:commands_proto',
+        '../../protocol/protocol.gyp:config_proto',
+        '../../request/request.gyp:conversion_request',
+        'system_dictionary',
+      ],
+    },
   ],
 }
@@ -40,6 +40,7 @@
 #include "dictionary/dictionary_interface.h"
 #include "dictionary/file/codec_interface.h"
 #include "dictionary/system/codec_interface.h"
+#include "dictionary/system/decoded_value_cache.h"
 #include "dictionary/system/key_expansion_table.h"
 #include "dictionary/system/words_info.h"
 #include "storage/louds/bit_vector_based_array.h"
@@ -60,7 +61,15 @@ class SystemDictionary : public DictionaryInterface {
     // If ENABLE_REVERSE_LOOKUP_INDEX is set, we will have the index in heap
     // from the id in value trie to the id in key trie.
     // That consumes more memory but we can perform reverse lookup more quickly.
+    // This is unnecessary for dictionaries built with the reverse lookup
+    // index section, whose index is always used.
     ENABLE_REVERSE_LOOKUP_INDEX = 1,
+    // If ENABLE_COST_ORDERED_PREDICTION is set, LookupPredictive() visits
+    // the keys in ascending order of the minimum costs of their subtrees,
+    // instead of in BFS order, so that cheaper candidates come first and the
+    // lookup limit cuts off expensive ones.  Requires the cost bounds written
+    // by SystemDictionaryBuilder; ignored for dictionaries without them.
+    ENABLE_COST_ORDERED_PREDICTION = 2,
   };
 
   // Builder class for system dictionary
@@ -87,6 +96,15 @@ class SystemDictionary : public DictionaryInterface {
     // Doesn't take the ownership of |codec|.
     Builder &SetCodec(const SystemDictionaryCodecInterface *codec);
 
+    // Sets the number of entries of the key trie cache for child node
+    // transitions (default: 0, i.e., disabled).  See
+    // LoudsTrie::EnableChildCache().
+    Builder &SetKeyTrieChildCacheSize(size_t size);
+
+    // Sets the number of entries of the cache for values decoded from the
+    // value trie (default: 0, i.e., disabled).  See DecodedValueCache.
+    Builder &SetValueCacheSize(size_t size);
+
     // Builds and returns system dictionary.
     SystemDictionary *Build();
 
@@ -100,6 +118,14 @@ class SystemDictionary : public DictionaryInterface {
 
   const storage::louds::LoudsTrie &value_trie() const { return value_trie_; }
 
+  // Returns the decoded value cache, or nullptr if it's disabled.
+  const DecodedValueCache *value_cache() const { return value_cache_.get(); }
+
+  // Returns the estimated size of the memory allocated in heap, such as the
+  // trie indices, the reverse lookup structures and the value cache, in
+  // bytes.  The dictionary image itself is not included.
+  size_t GetHeapMemoryUsage() const;
+
   // Implementation of DictionaryInterface.
   virtual bool HasKey(StringPiece key) const;
   virtual bool HasValue(StringPiece value) const;
@@ -108,10 +134,24 @@ class SystemDictionary : public DictionaryInterface {
                                 const ConversionRequest &converter_request,
                                 Callback *callback) const;
 
+  // Visits only the keys in the bigram index of |value_prefix| if the
+  // dictionary has the index.  Otherwise the same as LookupPredictive().
+  virtual void LookupPredictiveWithValuePrefix(
+      StringPiece key, StringPiece value_prefix,
+      const ConversionRequest &converter_request,
+      Callback *callback) const;
+
   virtual void LookupPrefix(StringPiece key,
                             const ConversionRequest &converter_request,
                             Callback *callback) const;
 
+  // Encodes |key| once and looks up each suffix with the corresponding part
+  // of the encoded key.
+  virtual void LookupPrefixBatch(StringPiece key,
+                                 const std::vector<size_t> &begin_positions,
+                                 const ConversionRequest &converter_request,
+                                 BatchCallback *batch_callback) const;
+
   virtual void LookupExact(StringPiece key,
                            const ConversionRequest &converter_request,
                            Callback *callback) const;
@@ -120,22 +160,38 @@ class SystemDictionary : public DictionaryInterface {
                              const ConversionRequest &converter_request,
                              Callback *callback) const;
 
+  // Converts and encodes |str| once and looks up each suffix with the
+  // corresponding parts, as LookupPrefixBatch() does.
+  virtual void LookupReverseBatch(StringPiece str,
+                                  const std::vector<size_t> &begin_positions,
+                                  const ConversionRequest &converter_request,
+                                  BatchCallback *batch_callback) const;
+
   virtual void PopulateReverseLookupCache(StringPiece str) const;
   virtual void ClearReverseLookupCache() const;
 
  private:
   class ReverseLookupCache;
   class ReverseLookupIndex;
+  class BigramIndex;
   struct PredictiveLookupSearchState;
 
   explicit SystemDictionary(const SystemDictionaryCodecInterface *codec,
                             const DictionaryFileCodecInterface *file_codec);
-  bool OpenDictionaryFile(bool enable_reverse_lookup_index);
+  bool OpenDictionaryFile(bool enable_reverse_lookup_index,
+                          size_t key_trie_child_cache_size);
 
   void RegisterReverseLookupTokensForT13N(StringPiece value,
                                           Callback *callback) const;
+  // |hiragana_value| is the head of the hiragana of the value, and
+  // |encoded_key| is the encoded hiragana.
+  void RegisterReverseLookupTokensForT13N(const char *hiragana_value,
+                                          StringPiece encoded_key,
+                                          Callback *callback) const;
   void RegisterReverseLookupTokensForValue(StringPiece value,
                                            Callback *callback) const;
+  void RegisterReverseLookupTokensForEncodedValue(StringPiece encoded_value,
+                                                  Callback *callback) const;
   void ScanTokens(const std::set<int> &id_set, ReverseLookupCache *cache) const;
   void RegisterReverseLookupResults(const std::set<int> &id_set,
                                     const ReverseLookupCache &cache,
@@ -159,15 +215,32 @@ class SystemDictionary : public DictionaryInterface {
       size_t limit,
       std::vector<PredictiveLookupSearchState> *result) const;
 
+  void CollectPredictiveNodesInCostOrder(
+      StringPiece encoded_key,
+      const KeyExpansionTable &table,
+      size_t limit,
+      std::vector<PredictiveLookupSearchState> *result) const;
+
+  // Returns the lower bound of the costs in the subtree of |node| (or of its
+  // own key if |key_only| is true), or |default_bound| if |node| isn't
+  // annotated.
+  uint16 GetPredictiveCostBound(const storage::louds::LoudsTrie::Node &node,
+                                bool key_only, uint16 default_bound) const;
+
   storage::louds::LoudsTrie key_trie_;
   storage::louds::LoudsTrie value_trie_;
   storage::louds::BitVectorBasedArray token_array_;
   const uint32 *frequent_pos_;
+  const uint16 *predictive_cost_bounds_;
+  size_t num_predictive_cost_bounds_;
+  bool enable_cost_ordered_prediction_;
   const SystemDictionaryCodecInterface *codec_;
   KeyExpansionTable hiragana_expansion_table_;
   std::unique_ptr<DictionaryFile> dictionary_file_;
   mutable std::unique_ptr<ReverseLookupCache> reverse_lookup_cache_;
   std::unique_ptr<ReverseLookupIndex> reverse_lookup_index_;
+  std::unique_ptr<BigramIndex> bigram_index_;
+  std::unique_ptr<DecodedValueCache> value_cache_;
 
   DISALLOW_COPY_AND_ASSIGN(SystemDictionary);
 };
@@ -27,3 +27,352 @@
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+
+// Benchmark for the DictionaryInterface entry points of SystemDictionary.
+//
+// Loads the system dictionary from a data set file, replays a corpus of
+// readings and reports per-call latency percentiles and tokens/sec for
+// LookupPrefix, LookupPredictive, LookupExact and LookupReverse, with and
+// without kana modifier insensitive key expansion.
+//
+// Usage:
+//   system_dictionary_benchmark --engine_data=/path/to/mozc.data
+//       --reading_file=data/test/stress_test/sentences.txt
+
+#include <algorithm>
+#include <iostream>  // NOLINT
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/file_stream.h"
+#include "base/flags.h"
+#include "base/init_mozc.h"
+#include "base/logging.h"
+#include "base/port.h"
+#include "base/stopwatch.h"
+#include "base/string_piece.h"
+#include "base/util.h"
+#include "config/config_handler.h"
+#include "data_manager/data_manager.h"
+#include "dictionary/dictionary_interface.h"
+#include "dictionary/dictionary_token.h"
+#include "dictionary/system/system_dictionary.h"
+#include "protocol/commands.pb.h"
+#include "protocol/config.pb.h"
+#include "request/conversion_request.h"
+
+DEFINE_string(engine_data, "", "Path to the data set file (mozc.data)");
+DEFINE_string(magic, "", "Expected magic number of the data set file");
+DEFINE_string(reading_file, "data/test/stress_test/sentences.txt",
+              "Corpus of readings in hiragana; one reading per line.  Lines "
+              "starting with '#' are skipped and only the first tab "
+              "separated column is used.");
+DEFINE_int32(max_readings, 1000, "Maximum number of readings to replay");
+DEFINE_int32(max_predictive_key_chars, 3,
+             "Predictive lookup is issued for every prefix of a reading up to "
+             "this number of characters");
+DEFINE_int32(max_exact_key_chars, 4,
+             "Exact lookup is issued for every substring of a reading up to "
+             "this number of characters");
+DEFINE_int32(max_reverse_values, 2000,
+             "Maximum number of values, collected from prefix lookup results, "
+             "used for reverse lookup");
+DEFINE_int32(iterations, 1, "Number of times the whole corpus is replayed");
+DEFINE_bool(enable_reverse_lookup_index, false,
+            "Build SystemDictionary with ENABLE_REVERSE_LOOKUP_INDEX");
+DEFINE_bool(enable_cost_ordered_prediction, false,
+            "Build SystemDictionary with ENABLE_COST_ORDERED_PREDICTION");
+DEFINE_int32(key_trie_child_cache_size, 0,
+             "Number of entries of the key trie child node cache");
+DEFINE_int32(value_cache_size, 0,
+             "Number of entries of the decoded value cache");
+
+namespace mozc {
+namespace dictionary {
+namespace {
+
+// Counts tokens delivered by the dictionary and optionally collects values.
+class CountingCallback : public DictionaryInterface::Callback {
+ public:
+  explicit CountingCallback(std::vector<string> *values)
+      : num_tokens_(0), values_(values) {}
+
+  ResultType OnToken(StringPiece key, StringPiece actual_key,
+                     const Token &token) override {
+    ++num_tokens_;
+    if (values_ != nullptr &&
+        values_->size() < static_cast<size_t>(FLAGS_max_reverse_values)) {
+      values_->push_back(token.value);
+    }
+    return TRAVERSE_CONTINUE;
+  }
+
+  void Reset() { num_tokens_ = 0; }
+  void StopCollectingValues() { values_ = nullptr; }
+  size_t num_tokens() const { return num_tokens_; }
+
+ private:
+  size_t num_tokens_;
+  std::vector<string> *values_;
+
+  DISALLOW_COPY_AND_ASSIGN(CountingCallback);
+};
+
+// Latency samples and token counts of one benchmark case.
+struct BenchmarkResult {
+  string name;
+  std::vector<double> latencies_usec;
+  uint64 num_tokens = 0;
+};
+
+double Percentile(const std::vector<double> &sorted, double p) {
+  if (sorted.empty()) {
+    return 0.0;
+  }
+  const size_t index = std::min(
+      sorted.size() - 1, static_cast<size_t>(p * (sorted.size() - 1) + 0.5));
+  return sorted[index];
+}
+
+void PrintResult(const BenchmarkResult &result, std::ostream *os) {
+  std::vector<double> sorted(result.latencies_usec);
+  std::sort(sorted.begin(), sorted.end());
+  double total_usec = 0.0;
+  for (const double usec : sorted) {
+    total_usec += usec;
+  }
+  const double tokens_per_sec =
+      total_usec > 0.0 ? result.num_tokens * 1e6 / total_usec : 0.0;
+  *os << Util::StringPrintf(
+      "%-28s calls=%-8d tokens=%-10llu avg=%.2fus p50=%.2fus p90=%.2fus "
+      "p99=%.2fus max=%.2fus tokens/sec=%.0f",
+      result.name.c_str(), static_cast<int>(sorted.size()),
+      static_cast<unsigned long long>(result.num_tokens),  // NOLINT
+      sorted.empty() ? 0.0 : total_usec / sorted.size(),
+      Percentile(sorted, 0.5), Percentile(sorted, 0.9),
+      Percentile(sorted, 0.99), sorted.empty() ? 0.0 : sorted.back(),
+      tokens_per_sec) << std::endl;
+}
+
+void LoadReadings(const string &filename, std::vector<string> *readings) {
+  InputFileStream ifs(filename.c_str());
+  CHECK(ifs) << "Cannot open " << filename;
+  string line;
+  while (readings->size() < static_cast<size_t>(FLAGS_max_readings) &&
+         !std::getline(ifs, line).fail()) {
+    Util::ChopReturns(&line);
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    const string::size_type tab_pos = line.find('\t');
+    if (tab_pos != string::npos) {
+      line.erase(tab_pos);
+    }
+    if (!line.empty()) {
+      readings->push_back(line);
+    }
+  }
+  CHECK(!readings->empty()) << "No reading in " << filename;
+}
+
+enum LookupType {
+  PREFIX,
+  PREDICTIVE,
+  EXACT,
+  REVERSE,
+};
+
+// Builds the list of keys queried for |type| from the reading corpus.
+void BuildQueries(LookupType type, const std::vector<string> &readings,
+                  const std::vector<string> &values,
+                  std::vector<string> *queries) {
+  queries->clear();
+  switch (type) {
+    case PREFIX:
+      // Simulates ImmutableConverterImpl::Lookup, which issues one prefix
+      // lookup per begin position.
+      for (const string &reading : readings) {
+        const size_t len = Util::CharsLen(reading);
+        for (size_t pos = 0; pos < len; ++pos) {
+          queries->push_back(Util::SubStringPiece(reading, pos).as_string());
+        }
+      }
+      break;
+    case PREDICTIVE:
+      // Simulates incremental typing of the head of each reading.
+      for (const string &reading : readings) {
+        const size_t len = std::min<size_t>(Util::CharsLen(reading),
+                                            FLAGS_max_predictive_key_chars);
+        for (size_t n = 1; n <= len; ++n) {
+          queries->push_back(Util::SubString(reading, 0, n));
+        }
+      }
+      break;
+    case EXACT:
+      for (const string &reading : readings) {
+        const size_t len = Util::CharsLen(reading);
+        for (size_t pos = 0; pos < len; ++pos) {
+          for (size_t n = 1; n <= FLAGS_max_exact_key_chars && pos + n <= len;
+               ++n) {
+            queries->push_back(Util::SubString(reading, pos, n));
+          }
+        }
+      }
+      break;
+    case REVERSE:
+      *queries = values;
+      break;
+  }
+}
+
+void RunLookup(const SystemDictionary &dictionary, LookupType type,
+               const string &name, const std::vector<string> &queries,
+               const ConversionRequest &conversion_request,
+               std::vector<string> *collected_values,
+               BenchmarkResult *result) {
+  result->name = name;
+  result->latencies_usec.reserve(queries.size() * FLAGS_iterations);
+  CountingCallback callback(collected_values);
+  for (int iter = 0; iter < FLAGS_iterations; ++iter) {
+    for (const string &query : queries) {
+      callback.Reset();
+      Stopwatch stopwatch = Stopwatch::StartNew();
+      switch (type) {
+        case PREFIX:
+          dictionary.LookupPrefix(query, conversion_request, &callback);
+          break;
+        case PREDICTIVE:
+          dictionary.LookupPredictive(query, conversion_request, &callback);
+          break;
+        case EXACT:
+          dictionary.LookupExact(query, conversion_request, &callback);
+          break;
+        case REVERSE:
+          dictionary.LookupReverse(query, conversion_request, &callback);
+          break;
+      }
+      stopwatch.Stop();
+      result->latencies_usec.push_back(stopwatch.GetElapsedMicroseconds());
+      result->num_tokens += callback.num_tokens();
+    }
+    // Values are collected only on the first pass.
+    callback.StopCollectingValues();
+  }
+}
+
+}  // namespace
+}  // namespace dictionary
+}  // namespace mozc
+
+int main(int argc, char **argv) {
+  mozc::InitMozc(argv[0], &argc, &argv, false);
+  CHECK(!FLAGS_engine_data.empty()) << "--engine_data is required";
+
+  mozc::DataManager data_manager;
+  const mozc::DataManager::Status status =
+      FLAGS_magic.empty()
+          ? data_manager.InitFromFile(FLAGS_engine_data)
+          : data_manager.InitFromFile(FLAGS_engine_data, FLAGS_magic);
+  CHECK_EQ(status, mozc::DataManager::Status::OK);
+
+  const char *dictionary_data = nullptr;
+  int dictionary_size = 0;
+  data_manager.GetSystemDictionaryData(&dictionary_data, &dictionary_size);
+
+  int options = mozc::dictionary::SystemDictionary::NONE;
+  if (FLAGS_enable_reverse_lookup_index) {
+    options |= mozc::dictionary::SystemDictionary::ENABLE_REVERSE_LOOKUP_INDEX;
+  }
+  if (FLAGS_enable_cost_ordered_prediction) {
+    options |=
+        mozc::dictionary::SystemDictionary::ENABLE_COST_ORDERED_PREDICTION;
+  }
+
+  mozc::Stopwatch build_stopwatch = mozc::Stopwatch::StartNew();
+  std::unique_ptr<mozc::dictionary::SystemDictionary> dictionary(
+      mozc::dictionary::SystemDictionary::Builder(dictionary_data,
+                                                  dictionary_size)
+          .SetOptions(
+              static_cast<mozc::dictionary::SystemDictionary::Options>(
+                  options))
+          .SetKeyTrieChildCacheSize(FLAGS_key_trie_child_cache_size)
+          .SetValueCacheSize(FLAGS_value_cache_size)
+          .Build());
+  build_stopwatch.Stop();
+  CHECK(dictionary.get());
+  std::cout << "Build: " << build_stopwatch.GetElapsedMicroseconds() << "us"
+            << std::endl;
+
+  std::vector<string> readings;
+  mozc::dictionary::LoadReadings(FLAGS_reading_file, &readings);
+  std::cout << "Readings: " << readings.size() << std::endl;
+
+  mozc::config::Config config;
+  mozc::config::ConfigHandler::GetDefaultConfig(&config);
+  mozc::commands::Request default_request;
+  mozc::commands::Request expansion_request;
+  expansion_request.set_kana_modifier_insensitive_conversion(true);
+  config.set_use_kana_modifier_insensitive_conversion(true);
+
+  struct {
+    const char *name;
+    mozc::dictionary::LookupType type;
+    const mozc::commands::Request *request;
+  } kCases[] = {
+      {"LookupPrefix", mozc::dictionary::PREFIX, &default_request},
+      {"LookupPrefix(expansion)", mozc::dictionary::PREFIX,
+       &expansion_request},
+      {"LookupPredictive", mozc::dictionary::PREDICTIVE, &default_request},
+      {"LookupPredictive(expansion)", mozc::dictionary::PREDICTIVE,
+       &expansion_request},
+      {"LookupExact", mozc::dictionary::EXACT, &default_request},
+      {"LookupReverse", mozc::dictionary::REVERSE, &default_request},
+  };
+
+  // Values found by the first prefix lookup pass feed the reverse lookup.
+  std::vector<string> values;
+  std::vector<string> queries;
+  for (const auto &c : kCases) {
+    mozc::ConversionRequest conversion_request;
+    conversion_request.set_request(c.request);
+    conversion_request.set_config(&config);
+    mozc::dictionary::BuildQueries(c.type, readings, values, &queries);
+    if (c.type == mozc::dictionary::REVERSE) {
+      // The converter populates the cache once for the whole input before
+      // reverse lookups, so it is measured separately.
+      string joined_values;
+      mozc::Util::JoinStrings(values, "", &joined_values);
+      mozc::Stopwatch stopwatch = mozc::Stopwatch::StartNew();
+      dictionary->PopulateReverseLookupCache(joined_values);
+      stopwatch.Stop();
+      std::cout << "PopulateReverseLookupCache: "
+                << stopwatch.GetElapsedMicroseconds() << "us" << std::endl;
+    }
+    const mozc::dictionary::DecodedValueCache *value_cache =
+        dictionary->value_cache();
+    const uint64 hits_before = value_cache ? value_cache->hit_count() : 0;
+    const uint64 misses_before = value_cache ? value_cache->miss_count() : 0;
+    mozc::dictionary::BenchmarkResult result;
+    mozc::dictionary::RunLookup(
+        *dictionary, c.type, c.name, queries, conversion_request,
+        values.empty() && c.type == mozc::dictionary::PREFIX ? &values
+                                                              : nullptr,
+        &result);
+    if (c.type == mozc::dictionary::REVERSE) {
+      dictionary->ClearReverseLookupCache();
+    }
+    mozc::dictionary::PrintResult(result, &std::cout);
+    if (value_cache != nullptr) {
+      const uint64 hits = value_cache->hit_count() - hits_before;
+      const uint64 misses = value_cache->miss_count() - misses_before;
+      const uint64 total = hits + misses;
+      std::cout << "  value cache: " << hits << "/" << total << " hits";
+      if (total > 0) {
+        std::cout << " (" << (100.0 * hits / total) << "%)";
+      }
+      std::cout << std::endl;
+    }
+  }
+  return 0;
+}
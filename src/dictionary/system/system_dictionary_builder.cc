@@ -32,12 +32,14 @@
 #include <algorithm>
 #include <climits>
 #include <cstring>
+#include <set>
 #include <sstream>
 
 #include "base/file_stream.h"
 #include "base/flags.h"
 #include "base/logging.h"
 #include "base/mozc_hash_set.h"
+#include "base/thread_pool.h"
 #include "base/util.h"
 #include "dictionary/dictionary_token.h"
 #include "dictionary/file/codec_factory.h"
@@ -47,18 +49,31 @@
 #include "dictionary/system/codec_interface.h"
 #include "dictionary/system/words_info.h"
 #include "dictionary/text_dictionary_loader.h"
+#include "storage/louds/bit_vector_based_array.h"
 #include "storage/louds/bit_vector_based_array_builder.h"
+#include "storage/louds/louds_trie.h"
 #include "storage/louds/louds_trie_builder.h"
 
 DEFINE_bool(preserve_intermediate_dictionary, false,
             "preserve inetemediate dictionary file.");
 DEFINE_int32(min_key_length_to_use_small_cost_encoding, 6,
              "minimum key length to use 1 byte cost encoding.");
+DEFINE_int32(max_depth_of_predictive_cost_bounds, 4,
+             "maximum depth of key trie nodes annotated with cost bounds for "
+             "cost ordered prediction.  Negative value disables them.");
+DEFINE_bool(build_reverse_lookup_index, true,
+            "write the reverse lookup index to the dictionary so that it "
+            "doesn't need to be built at runtime.");
+DEFINE_bool(build_bigram_index, false,
+            "write the index from values to the keys of their continuations "
+            "so that bigram prediction visits only the relevant keys.");
 
 namespace mozc {
 namespace dictionary {
 
+using mozc::storage::louds::LoudsTrie;
 using mozc::storage::louds::LoudsTrieBuilder;
+using mozc::storage::louds::BitVectorBasedArray;
 using mozc::storage::louds::BitVectorBasedArrayBuilder;
 
 namespace {
@@ -85,6 +100,31 @@ void WriteSectionToFile(const DictionaryFileSection &section,
   ofs.write(section.ptr, section.len);
 }
 
+// Builds the image of the index sections described in words_info.h from the
+// pairs of (id in value trie, id in key trie).
+void BuildIdIndexImage(std::vector<std::pair<uint32, uint32>> *value_key_ids,
+                       std::vector<uint32> *image) {
+  image->clear();
+  if (value_key_ids->empty()) {
+    return;
+  }
+  std::sort(value_key_ids->begin(), value_key_ids->end());
+  const uint32 num_value_ids = value_key_ids->back().first + 1;
+  image->reserve(num_value_ids + 2 + value_key_ids->size());
+  image->push_back(num_value_ids);
+  size_t pos = 0;
+  for (uint32 value_id = 0; value_id <= num_value_ids; ++value_id) {
+    while (pos < value_key_ids->size() &&
+           (*value_key_ids)[pos].first < value_id) {
+      ++pos;
+    }
+    image->push_back(pos);
+  }
+  for (size_t i = 0; i < value_key_ids->size(); ++i) {
+    image->push_back((*value_key_ids)[i].second);
+  }
+}
+
 }  // namespace
 
 SystemDictionaryBuilder::SystemDictionaryBuilder()
@@ -92,7 +132,8 @@ SystemDictionaryBuilder::SystemDictionaryBuilder()
       key_trie_builder_(new LoudsTrieBuilder),
       token_array_builder_(new BitVectorBasedArrayBuilder),
       codec_(SystemDictionaryCodecFactory::GetCodec()),
-      file_codec_(DictionaryFileCodecFactory::GetCodec()) {}
+      file_codec_(DictionaryFileCodecFactory::GetCodec()),
+      num_threads_(1) {}
 
 // This class does not have the ownership of |codec|.
 SystemDictionaryBuilder::SystemDictionaryBuilder(
@@ -102,18 +143,32 @@ SystemDictionaryBuilder::SystemDictionaryBuilder(
       key_trie_builder_(new LoudsTrieBuilder),
       token_array_builder_(new BitVectorBasedArrayBuilder),
       codec_(codec),
-      file_codec_(file_codec) {}
+      file_codec_(file_codec),
+      num_threads_(1) {}
 
 SystemDictionaryBuilder::~SystemDictionaryBuilder() {}
 
 void SystemDictionaryBuilder::BuildFromTokens(
     const std::vector<Token *> &tokens) {
+  if (num_threads_ > 1) {
+    pool_.reset(new ThreadPool(num_threads_));
+  }
+
   KeyInfoList key_info_list;
   ReadTokens(tokens, &key_info_list);
 
   BuildFrequentPos(key_info_list);
-  BuildValueTrie(key_info_list);
-  BuildKeyTrie(key_info_list);
+  // The two tries have their own builders, so they can be built at once.
+  ParallelFor(pool_.get(), 2, [this, &key_info_list](size_t begin,
+                                                     size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      if (i == 0) {
+        BuildValueTrie(key_info_list);
+      } else {
+        BuildKeyTrie(key_info_list);
+      }
+    }
+  });
 
   SetIdForValue(&key_info_list);
   SetIdForKey(&key_info_list);
@@ -123,6 +178,47 @@ void SystemDictionaryBuilder::BuildFromTokens(
   SetValueType(&key_info_list);
 
   BuildTokenArray(key_info_list);
+  BuildPredictiveCostBounds(key_info_list);
+  BuildBigramIndex(key_info_list);
+
+  pool_.reset();
+}
+
+SystemDictionaryBuilder::TokenArrayLayoutStats
+SystemDictionaryBuilder::GetTokenArrayLayoutStats(
+    const std::vector<string> &keys, size_t page_size) const {
+  DCHECK_GT(page_size, 0);
+  LoudsTrie key_trie;
+  CHECK(key_trie.Open(
+      reinterpret_cast<const uint8 *>(key_trie_builder_->image().data())));
+  const string &token_image = token_array_builder_->image();
+  BitVectorBasedArray token_array;
+  token_array.Open(reinterpret_cast<const uint8 *>(token_image.data()));
+
+  TokenArrayLayoutStats stats;
+  std::set<size_t> pages;
+  string encoded_key;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    encoded_key.clear();
+    codec_->EncodeKey(keys[i], &encoded_key);
+    const int key_id = key_trie.ExactSearch(encoded_key);
+    if (key_id < 0) {
+      continue;
+    }
+    size_t length = 0;
+    const char *element = token_array.Get(key_id, &length);
+    const size_t begin = element - token_image.data();
+    ++stats.num_keys;
+    stats.token_bytes += length;
+    for (size_t page = begin / page_size;
+         page <= (begin + std::max<size_t>(length, 1) - 1) / page_size;
+         ++page) {
+      pages.insert(page);
+    }
+  }
+  stats.touched_pages = pages.size();
+  stats.min_pages = (stats.token_bytes + page_size - 1) / page_size;
+  return stats;
 }
 
 void SystemDictionaryBuilder::WriteToFile(const string &output_file) const {
@@ -164,6 +260,32 @@ void SystemDictionaryBuilder::WriteToStream(
     file_codec_->GetSectionName(codec_->GetSectionNameForPos()));
   sections.push_back(frequent_pos_section);
 
+  DictionaryFileSection predictive_cost_bounds_section(
+    reinterpret_cast<const char *>(predictive_cost_bounds_.data()),
+    predictive_cost_bounds_.size() * sizeof(uint16),
+    file_codec_->GetSectionName(
+        codec_->GetSectionNameForPredictiveCostBounds()));
+  if (!predictive_cost_bounds_.empty()) {
+    sections.push_back(predictive_cost_bounds_section);
+  }
+
+  DictionaryFileSection reverse_lookup_index_section(
+    reinterpret_cast<const char *>(reverse_lookup_index_.data()),
+    reverse_lookup_index_.size() * sizeof(uint32),
+    file_codec_->GetSectionName(
+        codec_->GetSectionNameForReverseLookupIndex()));
+  if (!reverse_lookup_index_.empty()) {
+    sections.push_back(reverse_lookup_index_section);
+  }
+
+  DictionaryFileSection bigram_index_section(
+    reinterpret_cast<const char *>(bigram_index_.data()),
+    bigram_index_.size() * sizeof(uint32),
+    file_codec_->GetSectionName(codec_->GetSectionNameForBigramIndex()));
+  if (!bigram_index_.empty()) {
+    sections.push_back(bigram_index_section);
+  }
+
   if (FLAGS_preserve_intermediate_dictionary &&
       !intermediate_output_file_base_path.empty()) {
     // Write out intermediate results to files.
@@ -173,6 +295,17 @@ void SystemDictionaryBuilder::WriteToStream(
     WriteSectionToFile(key_trie_section, basepath + ".key");
     WriteSectionToFile(token_array_section, basepath + ".tokens");
     WriteSectionToFile(frequent_pos_section, basepath + ".freq_pos");
+    if (!predictive_cost_bounds_.empty()) {
+      WriteSectionToFile(predictive_cost_bounds_section,
+                         basepath + ".cost_bounds");
+    }
+    if (!reverse_lookup_index_.empty()) {
+      WriteSectionToFile(reverse_lookup_index_section,
+                         basepath + ".reverse_index");
+    }
+    if (!bigram_index_.empty()) {
+      WriteSectionToFile(bigram_index_section, basepath + ".bigram_index");
+    }
   }
 
   LOG(INFO) << "Start writing dictionary file.";
@@ -216,6 +349,46 @@ bool HasHomonymsInSamePos(
   return false;
 }
 
+// The cost of a token as decoded from the token array, which can be smaller
+// than the original cost when the small cost encoding is used.
+uint16 GetDecodedCost(const TokenInfo &token_info) {
+  const uint16 cost = token_info.token->cost;
+  if (token_info.cost_type == TokenInfo::CAN_USE_SMALL_ENCODING) {
+    return cost & 0xff00;
+  }
+  return cost;
+}
+
+// Returns the minimum cost in the subtree of |node| and stores the bounds of
+// the nodes not deeper than |max_depth| into |bounds|.
+uint16 ComputePredictiveCostBounds(const LoudsTrie &key_trie,
+                                   const LoudsTrie::Node &node,
+                                   int depth, int max_depth,
+                                   const std::vector<uint16> &key_costs,
+                                   std::vector<uint16> *bounds) {
+  uint16 key_cost = kPredictiveCostBoundNone;
+  if (key_trie.IsTerminalNode(node)) {
+    key_cost = key_costs[key_trie.GetKeyIdOfTerminalNode(node)];
+  }
+  uint16 subtree_cost = key_cost;
+  for (LoudsTrie::Node child = key_trie.MoveToFirstChild(node);
+       key_trie.IsValidNode(child); LoudsTrie::MoveToNextSibling(&child)) {
+    subtree_cost = std::min(
+        subtree_cost,
+        ComputePredictiveCostBounds(key_trie, child, depth + 1, max_depth,
+                                    key_costs, bounds));
+  }
+  if (depth <= max_depth) {
+    const size_t index = 2 * (node.node_id() - 1);
+    if (bounds->size() < index + 2) {
+      bounds->resize(index + 2, kPredictiveCostBoundNone);
+    }
+    (*bounds)[index] = subtree_cost;
+    (*bounds)[index + 1] = key_cost;
+  }
+  return subtree_cost;
+}
+
 struct TokenPtrLessThan {
   inline bool operator()(const Token* lhs, const Token* rhs) const {
     return lhs->key < rhs->key;
@@ -340,16 +513,20 @@ void SystemDictionaryBuilder::BuildValueTrie(const KeyInfoList &key_info_list) {
 }
 
 void SystemDictionaryBuilder::SetIdForValue(KeyInfoList *key_info_list) const {
-  for (KeyInfoList::iterator itr = key_info_list->begin();
-       itr != key_info_list->end(); ++itr) {
-    for (size_t i = 0; i < itr->tokens.size(); ++i) {
-      TokenInfo *token_info = &(itr->tokens[i]);
-      string value_str;
-      codec_->EncodeValue(token_info->token->value, &value_str);
-      token_info->id_in_value_trie =
-          value_trie_builder_->GetId(value_str);
+  ParallelFor(pool_.get(), key_info_list->size(),
+              [this, key_info_list](size_t begin, size_t end) {
+    string value_str;
+    for (size_t k = begin; k < end; ++k) {
+      KeyInfo *key_info = &(*key_info_list)[k];
+      for (size_t i = 0; i < key_info->tokens.size(); ++i) {
+        TokenInfo *token_info = &(key_info->tokens[i]);
+        value_str.clear();
+        codec_->EncodeValue(token_info->token->value, &value_str);
+        token_info->id_in_value_trie =
+            value_trie_builder_->GetId(value_str);
+      }
     }
-  }
+  });
 }
 
 void SystemDictionaryBuilder::SortTokenInfo(KeyInfoList *key_info_list) const {
@@ -431,14 +608,17 @@ void SystemDictionaryBuilder::BuildKeyTrie(const KeyInfoList &key_info_list) {
 }
 
 void SystemDictionaryBuilder::SetIdForKey(KeyInfoList *key_info_list) const {
-  for (KeyInfoList::iterator itr = key_info_list->begin();
-       itr != key_info_list->end(); ++itr) {
-    KeyInfo *key_info = &(*itr);
+  ParallelFor(pool_.get(), key_info_list->size(),
+              [this, key_info_list](size_t begin, size_t end) {
     string key_str;
-    codec_->EncodeKey(key_info->key, &key_str);
-    key_info->id_in_key_trie =
-        key_trie_builder_->GetId(key_str);
-  }
+    for (size_t k = begin; k < end; ++k) {
+      KeyInfo *key_info = &(*key_info_list)[k];
+      key_str.clear();
+      codec_->EncodeKey(key_info->key, &key_str);
+      key_info->id_in_key_trie =
+          key_trie_builder_->GetId(key_str);
+    }
+  });
 }
 
 void SystemDictionaryBuilder::BuildTokenArray(
@@ -456,17 +636,133 @@ void SystemDictionaryBuilder::BuildTokenArray(
       id_to_keyinfo_table[id] = &key_info;
     }
 
-    for (size_t i = 0; i < id_to_keyinfo_table.size(); ++i) {
-      const KeyInfo &key_info = *id_to_keyinfo_table[i];
-      string tokens_str;
-      codec_->EncodeTokens(key_info.tokens, &tokens_str);
-      token_array_builder_->Add(tokens_str);
+    // The tokens are encoded in parallel and then added in the order of the
+    // ids, so the image doesn't depend on the number of threads.
+    std::vector<string> tokens_strs(id_to_keyinfo_table.size());
+    ParallelFor(pool_.get(), id_to_keyinfo_table.size(),
+                [this, &id_to_keyinfo_table, &tokens_strs](size_t begin,
+                                                           size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        codec_->EncodeTokens(id_to_keyinfo_table[i]->tokens, &tokens_strs[i]);
+      }
+    });
+
+    // Pairs of (id in value trie, id in key trie), read back from the
+    // encoded tokens in the same way as the reverse lookup does.
+    std::vector<std::pair<uint32, uint32>> value_key_ids;
+    for (size_t i = 0; i < tokens_strs.size(); ++i) {
+      token_array_builder_->Add(tokens_strs[i]);
+
+      if (!FLAGS_build_reverse_lookup_index) {
+        continue;
+      }
+      const uint8 *ptr =
+          reinterpret_cast<const uint8 *>(tokens_strs[i].data());
+      for (int offset = 0; ; ) {
+        int value_id = -1, read_bytes = 0;
+        const bool has_next = codec_->ReadTokenForReverseLookup(
+            ptr + offset, &value_id, &read_bytes);
+        if (value_id != -1) {
+          value_key_ids.push_back(std::make_pair(value_id, i));
+        }
+        if (!has_next) {
+          break;
+        }
+        offset += read_bytes;
+      }
     }
+    BuildReverseLookupIndex(&value_key_ids);
   }
 
   token_array_builder_->Add(string(1, codec_->GetTokensTerminationFlag()));
   token_array_builder_->Build();
 }
 
+void SystemDictionaryBuilder::BuildReverseLookupIndex(
+    std::vector<std::pair<uint32, uint32>> *value_key_ids) {
+  BuildIdIndexImage(value_key_ids, &reverse_lookup_index_);
+}
+
+void SystemDictionaryBuilder::BuildBigramIndex(
+    const KeyInfoList &key_info_list) {
+  bigram_index_.clear();
+  if (!FLAGS_build_bigram_index) {
+    return;
+  }
+
+  LoudsTrie value_trie;
+  CHECK(value_trie.Open(
+      reinterpret_cast<const uint8 *>(value_trie_builder_->image().data())));
+
+  // Pairs of (id of a value in value trie, id of a key whose token's value
+  // starts with the value), collected per key to run in parallel.
+  std::vector<std::vector<std::pair<uint32, uint32>>> pairs_per_key(
+      key_info_list.size());
+  ParallelFor(pool_.get(), key_info_list.size(),
+              [this, &key_info_list, &value_trie, &pairs_per_key](
+                  size_t begin, size_t end) {
+    string value_str;
+    for (size_t k = begin; k < end; ++k) {
+      const KeyInfo &key_info = key_info_list[k];
+      const uint32 key_id = key_info.id_in_key_trie;
+      std::vector<std::pair<uint32, uint32>> *pairs = &pairs_per_key[k];
+      for (size_t i = 0; i < key_info.tokens.size(); ++i) {
+        value_str.clear();
+        codec_->EncodeValue(key_info.tokens[i].token->value, &value_str);
+        value_trie.PrefixSearch(
+            value_str,
+            [key_id, pairs](StringPiece key, size_t prefix_len,
+                            const LoudsTrie &trie, LoudsTrie::Node node) {
+              if (prefix_len < key.size()) {
+                pairs->push_back(std::make_pair(
+                    trie.GetKeyIdOfTerminalNode(node), key_id));
+              }
+            });
+      }
+      std::sort(pairs->begin(), pairs->end());
+      pairs->erase(std::unique(pairs->begin(), pairs->end()), pairs->end());
+    }
+  });
+
+  std::vector<std::pair<uint32, uint32>> value_key_ids;
+  for (size_t k = 0; k < pairs_per_key.size(); ++k) {
+    value_key_ids.insert(value_key_ids.end(), pairs_per_key[k].begin(),
+                         pairs_per_key[k].end());
+    std::vector<std::pair<uint32, uint32>>().swap(pairs_per_key[k]);
+  }
+  BuildIdIndexImage(&value_key_ids, &bigram_index_);
+  VLOG(1) << "Bigram index for " << value_key_ids.size() << " pairs";
+}
+
+void SystemDictionaryBuilder::BuildPredictiveCostBounds(
+    const KeyInfoList &key_info_list) {
+  predictive_cost_bounds_.clear();
+  if (FLAGS_max_depth_of_predictive_cost_bounds < 0 ||
+      key_info_list.empty()) {
+    return;
+  }
+
+  std::vector<uint16> key_costs(key_info_list.size(),
+                                kPredictiveCostBoundNone);
+  for (KeyInfoList::const_iterator itr = key_info_list.begin();
+       itr != key_info_list.end(); ++itr) {
+    uint16 *key_cost = &key_costs[itr->id_in_key_trie];
+    for (size_t i = 0; i < itr->tokens.size(); ++i) {
+      *key_cost = std::min(*key_cost, GetDecodedCost(itr->tokens[i]));
+    }
+  }
+
+  // Since node ids of LOUDS are assigned in BFS order, the annotated nodes
+  // occupy the smallest ids and the section has no holes.
+  LoudsTrie key_trie;
+  CHECK(key_trie.Open(
+      reinterpret_cast<const uint8 *>(key_trie_builder_->image().data())));
+  ComputePredictiveCostBounds(key_trie, LoudsTrie::Node(), 0,
+                              FLAGS_max_depth_of_predictive_cost_bounds,
+                              key_costs, &predictive_cost_bounds_);
+  VLOG(1) << "Predictive cost bounds for "
+          << predictive_cost_bounds_.size() / 2 << " nodes";
+}
+
 }  // namespace dictionary
 }  // namespace mozc
@@ -35,12 +35,16 @@
 #include <memory>
 #include <ostream>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "base/port.h"
 #include "dictionary/system/words_info.h"
 
 namespace mozc {
+
+class ThreadPool;
+
 namespace storage {
 namespace louds {
 class BitVectorBasedArrayBuilder;
@@ -71,6 +75,30 @@ class SystemDictionaryBuilder {
   virtual ~SystemDictionaryBuilder();
   void BuildFromTokens(const std::vector<Token *> &tokens);
 
+  // Builds the tries and the token array on |num_threads| threads (default:
+  // 1).  The output is the same regardless of the number of threads.
+  void set_num_threads(int num_threads) { num_threads_ = num_threads; }
+
+  // How the token groups of a set of keys are spread over the token array.
+  struct TokenArrayLayoutStats {
+    TokenArrayLayoutStats()
+        : num_keys(0), token_bytes(0), touched_pages(0), min_pages(0) {}
+    // Number of the keys found in the dictionary.
+    size_t num_keys;
+    // Total size of their token groups in bytes.
+    size_t token_bytes;
+    // Number of distinct pages of the token array containing them.
+    size_t touched_pages;
+    // Number of pages they would occupy if they were contiguous.
+    size_t min_pages;
+  };
+
+  // Computes the layout stats of |keys| (readings) after BuildFromTokens().
+  // Pages are |page_size| bytes counted from the beginning of the token array
+  // section.  Used to evaluate the working set for a reading profile.
+  TokenArrayLayoutStats GetTokenArrayLayoutStats(
+      const std::vector<string> &keys, size_t page_size) const;
+
   void WriteToFile(const string &output_file) const;
   void WriteToStream(const string &intermediate_output_file_base_path,
                      std::ostream *output_stream) const;
@@ -89,6 +117,13 @@ class SystemDictionaryBuilder {
 
   void BuildTokenArray(const KeyInfoList &key_info_list);
 
+  void BuildPredictiveCostBounds(const KeyInfoList &key_info_list);
+
+  void BuildReverseLookupIndex(
+      std::vector<std::pair<uint32, uint32>> *value_key_ids);
+
+  void BuildBigramIndex(const KeyInfoList &key_info_list);
+
   void SetIdForValue(KeyInfoList *key_info_list) const;
   void SetIdForKey(KeyInfoList *key_info_list) const;
   void SortTokenInfo(KeyInfoList *key_info_list) const;
@@ -105,9 +140,23 @@ class SystemDictionaryBuilder {
   // mapping from {left_id, right_id} to POS index (0--255)
   std::map<uint32, int> frequent_pos_;
 
+  // Pairs of the minimum costs in the subtree and of the key for the shallow
+  // nodes of the key trie, indexed by node id.  See BuildPredictiveCostBounds.
+  std::vector<uint16> predictive_cost_bounds_;
+
+  // Image of the reverse lookup index section.  See words_info.h.
+  std::vector<uint32> reverse_lookup_index_;
+
+  // Image of the bigram index section.  See words_info.h.
+  std::vector<uint32> bigram_index_;
+
   const SystemDictionaryCodecInterface *codec_;
   const DictionaryFileCodecInterface *file_codec_;
 
+  int num_threads_;
+  // Alive only while BuildFromTokens() runs.  nullptr for a single thread.
+  std::unique_ptr<ThreadPool> pool_;
+
   DISALLOW_COPY_AND_ASSIGN(SystemDictionaryBuilder);
 };
 }  // namespace dictionary
@@ -32,6 +32,8 @@
 #include <algorithm>
 #include <cstdlib>
 #include <memory>
+#include <set>
+#include <sstream>
 #include <string>
 #include <utility>
 #include <vector>
@@ -62,6 +64,8 @@ DEFINE_int32(dictionary_test_size, 100000,
 DEFINE_int32(dictionary_reverse_lookup_test_size, 1000,
              "Number of tokens to run reverse lookup test.");
 DECLARE_int32(min_key_length_to_use_small_cost_encoding);
+DECLARE_bool(build_reverse_lookup_index);
+DECLARE_bool(build_bigram_index);
 
 namespace mozc {
 namespace dictionary {
@@ -88,6 +92,9 @@ class SystemDictionaryTest : public ::testing::Test {
     original_flags_min_key_length_to_use_small_cost_encoding_ =
         FLAGS_min_key_length_to_use_small_cost_encoding;
     FLAGS_min_key_length_to_use_small_cost_encoding = kint32max;
+    original_flags_build_reverse_lookup_index_ =
+        FLAGS_build_reverse_lookup_index;
+    original_flags_build_bigram_index_ = FLAGS_build_bigram_index;
 
     request_.Clear();
     config::ConfigHandler::GetDefaultConfig(&config_);
@@ -96,6 +103,9 @@ class SystemDictionaryTest : public ::testing::Test {
   void TearDown() override {
     FLAGS_min_key_length_to_use_small_cost_encoding =
         original_flags_min_key_length_to_use_small_cost_encoding_;
+    FLAGS_build_reverse_lookup_index =
+        original_flags_build_reverse_lookup_index_;
+    FLAGS_build_bigram_index = original_flags_build_bigram_index_;
 
     // This config initialization will be removed once ConversionRequest can
     // take config as an injected argument.
@@ -120,6 +130,8 @@ class SystemDictionaryTest : public ::testing::Test {
   commands::Request request_;
   const string dic_fn_;
   int original_flags_min_key_length_to_use_small_cost_encoding_;
+  bool original_flags_build_reverse_lookup_index_;
+  bool original_flags_build_bigram_index_;
 };
 
 void SystemDictionaryTest::BuildSystemDictionary(
@@ -537,6 +549,162 @@ TEST_F(SystemDictionaryTest, LookupPrefix) {
   }
 }
 
+TEST_F(SystemDictionaryTest, LookupPrefixWithKeyTrieChildCache) {
+  BuildSystemDictionary(text_dict_->tokens(), 10000);
+  unique_ptr<SystemDictionary> system_dic(
+      SystemDictionary::Builder(dic_fn_).Build());
+  ASSERT_TRUE(system_dic.get() != NULL)
+      << "Failed to open dictionary source:" << dic_fn_;
+  unique_ptr<SystemDictionary> cached_system_dic(
+      SystemDictionary::Builder(dic_fn_).SetKeyTrieChildCacheSize(16).Build());
+  ASSERT_TRUE(cached_system_dic.get() != NULL)
+      << "Failed to open dictionary source:" << dic_fn_;
+
+  // Simulates incremental typing so that the same prefixes are looked up
+  // repeatedly through the small cache.
+  const string kKey = "わたしのなまえはなかのです";
+  for (size_t len = 1; len <= Util::CharsLen(kKey); ++len) {
+    const string key = Util::SubString(kKey, 0, len);
+    for (size_t pos = 0; pos < len; ++pos) {
+      const StringPiece suffix = Util::SubStringPiece(key, pos);
+      CollectTokenCallback expected, actual;
+      system_dic->LookupPrefix(suffix, convreq_, &expected);
+      cached_system_dic->LookupPrefix(suffix, convreq_, &actual);
+      ASSERT_EQ(expected.tokens().size(), actual.tokens().size()) << suffix;
+      for (size_t i = 0; i < expected.tokens().size(); ++i) {
+        EXPECT_TRUE(CompareTokensForLookup(expected.tokens()[i],
+                                           actual.tokens()[i], false));
+      }
+      EXPECT_EQ(system_dic->HasKey(suffix), cached_system_dic->HasKey(suffix));
+    }
+  }
+}
+
+TEST_F(SystemDictionaryTest, LookupWithValueCache) {
+  BuildSystemDictionary(text_dict_->tokens(), 10000);
+  unique_ptr<SystemDictionary> system_dic(
+      SystemDictionary::Builder(dic_fn_).Build());
+  ASSERT_TRUE(system_dic.get() != NULL)
+      << "Failed to open dictionary source:" << dic_fn_;
+  EXPECT_TRUE(system_dic->value_cache() == NULL);
+  unique_ptr<SystemDictionary> cached_system_dic(
+      SystemDictionary::Builder(dic_fn_).SetValueCacheSize(64).Build());
+  ASSERT_TRUE(cached_system_dic.get() != NULL)
+      << "Failed to open dictionary source:" << dic_fn_;
+  ASSERT_TRUE(cached_system_dic->value_cache() != NULL);
+
+  // Looks up the same keys twice so that the second round hits the cache.
+  const string kKey = "わたしのなまえはなかのです";
+  for (int round = 0; round < 2; ++round) {
+    for (size_t pos = 0; pos < Util::CharsLen(kKey); ++pos) {
+      const StringPiece suffix = Util::SubStringPiece(kKey, pos);
+      CollectTokenCallback expected, actual;
+      system_dic->LookupPrefix(suffix, convreq_, &expected);
+      cached_system_dic->LookupPrefix(suffix, convreq_, &actual);
+      ASSERT_EQ(expected.tokens().size(), actual.tokens().size()) << suffix;
+      for (size_t i = 0; i < expected.tokens().size(); ++i) {
+        EXPECT_TRUE(CompareTokensForLookup(expected.tokens()[i],
+                                           actual.tokens()[i], false));
+      }
+
+      CollectTokenCallback expected_predictive, actual_predictive;
+      system_dic->LookupPredictive(suffix, convreq_, &expected_predictive);
+      cached_system_dic->LookupPredictive(suffix, convreq_,
+                                          &actual_predictive);
+      ASSERT_EQ(expected_predictive.tokens().size(),
+                actual_predictive.tokens().size()) << suffix;
+      for (size_t i = 0; i < expected_predictive.tokens().size(); ++i) {
+        EXPECT_TRUE(CompareTokensForLookup(expected_predictive.tokens()[i],
+                                           actual_predictive.tokens()[i],
+                                           false));
+      }
+    }
+  }
+  EXPECT_GT(cached_system_dic->value_cache()->hit_count(), 0);
+  EXPECT_GT(cached_system_dic->value_cache()->miss_count(), 0);
+}
+
+// Collects the tokens for each begin position, skipping every other one.
+class CollectTokensBatchCallback : public DictionaryInterface::BatchCallback {
+ public:
+  virtual DictionaryInterface::Callback *OnBeginPosition(size_t begin_pos) {
+    begin_positions_.push_back(begin_pos);
+    if (begin_positions_.size() % 2 == 0) {
+      return NULL;
+    }
+    callbacks_.push_back(new CollectTokenCallback);
+    return callbacks_.back();
+  }
+
+  virtual void OnEndPosition(size_t begin_pos) {
+    // A position must be finished before the next one begins.
+    EXPECT_EQ(begin_positions_.back(), begin_pos);
+    end_positions_.push_back(begin_pos);
+  }
+
+  ~CollectTokensBatchCallback() {
+    STLDeleteElements(&callbacks_);
+  }
+
+  const std::vector<size_t> &begin_positions() const {
+    return begin_positions_;
+  }
+  const std::vector<size_t> &end_positions() const { return end_positions_; }
+  const std::vector<CollectTokenCallback *> &callbacks() const {
+    return callbacks_;
+  }
+
+ private:
+  std::vector<size_t> begin_positions_;
+  std::vector<size_t> end_positions_;
+  std::vector<CollectTokenCallback *> callbacks_;
+};
+
+TEST_F(SystemDictionaryTest, LookupPrefixBatch) {
+  BuildSystemDictionary(text_dict_->tokens(), 10000);
+  unique_ptr<SystemDictionary> system_dic(
+      SystemDictionary::Builder(dic_fn_).Build());
+  ASSERT_TRUE(system_dic.get() != NULL)
+      << "Failed to open dictionary source:" << dic_fn_;
+
+  // Mixes characters of different encoded lengths.
+  const string kKey = "わたしのなまえは中野ですABC";
+  std::vector<size_t> begin_positions;
+  for (size_t pos = 0; pos < kKey.size();
+       pos += Util::OneCharLen(kKey.data() + pos)) {
+    begin_positions.push_back(pos);
+  }
+
+  for (int i = 0; i < 2; ++i) {
+    // The second iteration uses kana modifier insensitive lookup.
+    request_.set_kana_modifier_insensitive_conversion(i == 1);
+    config_.set_use_kana_modifier_insensitive_conversion(i == 1);
+
+    CollectTokensBatchCallback batch_callback;
+    system_dic->LookupPrefixBatch(kKey, begin_positions, convreq_,
+                                  &batch_callback);
+    EXPECT_EQ(begin_positions, batch_callback.begin_positions());
+    ASSERT_EQ((begin_positions.size() + 1) / 2,
+              batch_callback.end_positions().size());
+    ASSERT_EQ(batch_callback.end_positions().size(),
+              batch_callback.callbacks().size());
+    for (size_t j = 0; j < batch_callback.end_positions().size(); ++j) {
+      const size_t pos = batch_callback.end_positions()[j];
+      EXPECT_EQ(begin_positions[j * 2], pos);
+      CollectTokenCallback expected;
+      system_dic->LookupPrefix(StringPiece(kKey).substr(pos), convreq_,
+                               &expected);
+      const std::vector<Token> &actual =
+          batch_callback.callbacks()[j]->tokens();
+      ASSERT_EQ(expected.tokens().size(), actual.size()) << pos;
+      for (size_t k = 0; k < actual.size(); ++k) {
+        EXPECT_TRUE(CompareTokensForLookup(expected.tokens()[k], actual[k],
+                                           false));
+      }
+    }
+  }
+}
+
 TEST_F(SystemDictionaryTest, LookupPredictive) {
   std::vector<Token *> tokens;
   ScopedElementsDeleter<std::vector<Token *>> deleter(&tokens);
@@ -617,6 +785,50 @@ TEST_F(SystemDictionaryTest, LookupPredictive_CutOffEmulatingBFS) {
   EXPECT_FALSE(callback.IsFound(tokens[1]));
 }
 
+TEST_F(SystemDictionaryTest, LookupPredictive_CostOrdered) {
+  std::vector<Token *> tokens;
+  ScopedElementsDeleter<std::vector<Token *>> deleter(&tokens);
+
+  tokens.push_back(CreateToken("あい", "ai"));
+  tokens.back()->cost = 5000;
+  tokens.push_back(CreateToken("あいう", "aiu"));
+  tokens.back()->cost = 100;
+  tokens.push_back(CreateToken("あいうえ", "aiue"));
+  tokens.back()->cost = 3000;
+  // Deeper than the nodes annotated with cost bounds by default.
+  tokens.push_back(CreateToken("あいうえおか", "aiueoka"));
+  tokens.back()->cost = 50;
+  tokens.push_back(CreateToken("あか", "aka"));
+  tokens.back()->cost = 2000;
+
+  BuildSystemDictionary(tokens, 100);
+  unique_ptr<SystemDictionary> system_dic(
+      SystemDictionary::Builder(dic_fn_)
+          .SetOptions(SystemDictionary::ENABLE_COST_ORDERED_PREDICTION)
+          .Build());
+  ASSERT_TRUE(system_dic.get() != NULL)
+      << "Failed to open dictionary source: " << dic_fn_;
+
+  CollectTokenCallback callback;
+  system_dic->LookupPredictive("あ", convreq_, &callback);
+  ASSERT_EQ(5, callback.tokens().size());
+  EXPECT_EQ("あいうえおか", callback.tokens()[0].key);
+  EXPECT_EQ("あいう", callback.tokens()[1].key);
+  EXPECT_EQ("あか", callback.tokens()[2].key);
+  EXPECT_EQ("あいうえ", callback.tokens()[3].key);
+  EXPECT_EQ("あい", callback.tokens()[4].key);
+
+  // Without the option, keys are visited in BFS order.
+  system_dic.reset(SystemDictionary::Builder(dic_fn_).Build());
+  ASSERT_TRUE(system_dic.get() != NULL)
+      << "Failed to open dictionary source: " << dic_fn_;
+  callback.Clear();
+  system_dic->LookupPredictive("あ", convreq_, &callback);
+  ASSERT_EQ(5, callback.tokens().size());
+  EXPECT_EQ("あい", callback.tokens()[0].key);
+  EXPECT_EQ("あか", callback.tokens()[1].key);
+}
+
 TEST_F(SystemDictionaryTest, LookupExact) {
   std::vector<Token *> source_tokens;
 
@@ -787,6 +999,8 @@ TEST_F(SystemDictionaryTest, LookupReverse) {
 
 TEST_F(SystemDictionaryTest, LookupReverseIndex) {
   const std::vector<Token *> &source_tokens = text_dict_->tokens();
+  // Without the index section, the index is built in heap on demand.
+  FLAGS_build_reverse_lookup_index = false;
   BuildSystemDictionary(source_tokens, FLAGS_dictionary_test_size);
 
   unique_ptr<SystemDictionary> system_dic_without_index(
@@ -820,6 +1034,192 @@ TEST_F(SystemDictionaryTest, LookupReverseIndex) {
   }
 }
 
+TEST_F(SystemDictionaryTest, LookupReverseIndexSection) {
+  const std::vector<Token *> &source_tokens = text_dict_->tokens();
+  BuildSystemDictionary(source_tokens, FLAGS_dictionary_test_size);
+  unique_ptr<SystemDictionary> system_dic_with_section(
+      SystemDictionary::Builder(dic_fn_).Build());
+  ASSERT_TRUE(system_dic_with_section.get() != NULL)
+      << "Failed to open dictionary source:" << dic_fn_;
+
+  // Builds the same dictionary without the section on memory.
+  FLAGS_build_reverse_lookup_index = false;
+  std::vector<Token *> tokens;
+  for (size_t i = 0; i < source_tokens.size() &&
+                     tokens.size() < FLAGS_dictionary_test_size; ++i) {
+    tokens.push_back(source_tokens[i]);
+  }
+  SystemDictionaryBuilder builder;
+  builder.BuildFromTokens(tokens);
+  std::ostringstream image;
+  builder.WriteToStream("", &image);
+  const string image_str = image.str();
+  unique_ptr<SystemDictionary> system_dic_without_section(
+      SystemDictionary::Builder(image_str.data(), image_str.size()).Build());
+  ASSERT_TRUE(system_dic_without_section.get() != NULL);
+
+  int size = FLAGS_dictionary_reverse_lookup_test_size;
+  for (std::vector<Token *>::const_iterator it = source_tokens.begin();
+       size > 0 && it != source_tokens.end(); ++it, --size) {
+    const Token &t = **it;
+    CollectTokenCallback callback1, callback2;
+    system_dic_without_section->LookupReverse(t.value, convreq_, &callback1);
+    system_dic_with_section->LookupReverse(t.value, convreq_, &callback2);
+
+    const std::vector<Token> &tokens1 = callback1.tokens();
+    const std::vector<Token> &tokens2 = callback2.tokens();
+    ASSERT_EQ(tokens1.size(), tokens2.size());
+    for (size_t i = 0; i < tokens1.size(); ++i) {
+      EXPECT_TOKEN_EQ(tokens1[i], tokens2[i]);
+    }
+  }
+}
+
+TEST_F(SystemDictionaryTest, LookupReverseBatch) {
+  const std::vector<Token *> &source_tokens = text_dict_->tokens();
+  BuildSystemDictionary(source_tokens, FLAGS_dictionary_test_size);
+  unique_ptr<SystemDictionary> system_dic(
+      SystemDictionary::Builder(dic_fn_).Build());
+  ASSERT_TRUE(system_dic.get() != NULL)
+      << "Failed to open dictionary source:" << dic_fn_;
+
+  // Concatenates some values so that the key mixes kanji, kana and others.
+  string key;
+  for (size_t i = 0; i < source_tokens.size() && i < 20; ++i) {
+    key.append(source_tokens[i]->value);
+  }
+  std::vector<size_t> begin_positions;
+  for (size_t pos = 0; pos < key.size();
+       pos += Util::OneCharLen(key.data() + pos)) {
+    begin_positions.push_back(pos);
+  }
+
+  CollectTokensBatchCallback batch_callback;
+  system_dic->LookupReverseBatch(key, begin_positions, convreq_,
+                                 &batch_callback);
+  EXPECT_EQ(begin_positions, batch_callback.begin_positions());
+  ASSERT_EQ((begin_positions.size() + 1) / 2,
+            batch_callback.end_positions().size());
+  ASSERT_EQ(batch_callback.end_positions().size(),
+            batch_callback.callbacks().size());
+  // The first value is found at least from the head.
+  EXPECT_FALSE(batch_callback.callbacks()[0]->tokens().empty());
+  for (size_t j = 0; j < batch_callback.end_positions().size(); ++j) {
+    const size_t pos = batch_callback.end_positions()[j];
+    EXPECT_EQ(begin_positions[j * 2], pos);
+    CollectTokenCallback expected;
+    system_dic->LookupReverse(StringPiece(key).substr(pos), convreq_,
+                              &expected);
+    const std::vector<Token> &actual = batch_callback.callbacks()[j]->tokens();
+    ASSERT_EQ(expected.tokens().size(), actual.size()) << pos;
+    for (size_t k = 0; k < actual.size(); ++k) {
+      EXPECT_TOKEN_EQ(expected.tokens()[k], actual[k]);
+    }
+  }
+}
+
+TEST_F(SystemDictionaryTest, TokenArrayLayoutStats) {
+  const char *kKeyValues[][2] = {
+    {"ろく", "六"},
+    {"ろっぽんぎ", "六本木"},
+    {"ろっぽんぎ", "ロッポンギ"},
+    {"ろっぽんぎえき", "六本木駅"},
+  };
+  std::vector<unique_ptr<Token>> owned_tokens;
+  std::vector<Token *> tokens;
+  for (size_t i = 0; i < arraysize(kKeyValues); ++i) {
+    owned_tokens.emplace_back(CreateToken(kKeyValues[i][0], kKeyValues[i][1]));
+    tokens.push_back(owned_tokens.back().get());
+  }
+  SystemDictionaryBuilder builder;
+  builder.BuildFromTokens(tokens);
+
+  std::vector<string> keys;
+  keys.push_back("ろっぽんぎ");
+  keys.push_back("ろく");
+  keys.push_back("みち");  // Not in the dictionary.
+  const SystemDictionaryBuilder::TokenArrayLayoutStats stats =
+      builder.GetTokenArrayLayoutStats(keys, 4096);
+  EXPECT_EQ(2, stats.num_keys);
+  EXPECT_LT(0, stats.token_bytes);
+  EXPECT_EQ(1, stats.touched_pages);
+  EXPECT_EQ(1, stats.min_pages);
+
+  // With 1-byte pages, every byte of the token groups is a page of its own.
+  const SystemDictionaryBuilder::TokenArrayLayoutStats small_page_stats =
+      builder.GetTokenArrayLayoutStats(keys, 1);
+  EXPECT_EQ(stats.token_bytes, small_page_stats.token_bytes);
+  EXPECT_EQ(small_page_stats.token_bytes, small_page_stats.touched_pages);
+  EXPECT_EQ(small_page_stats.token_bytes, small_page_stats.min_pages);
+}
+
+TEST_F(SystemDictionaryTest, LookupPredictiveWithValuePrefix) {
+  const char *kKeyValues[][2] = {
+    {"ろく", "六"},
+    {"ろっぽんぎ", "六本木"},
+    {"ろっぽんぎ", "ロッポンギ"},
+    {"ろっぽんぎえき", "六本木駅"},
+    {"ろっぽんぎひるず", "六本木ヒルズ"},
+    {"ろっぽんぎあ", "ロッポンギア"},
+    {"ろっぽんぎこうえん", "六本木公園"},
+    {"ろっぽんぎ", "六本樹"},
+  };
+  std::vector<unique_ptr<Token>> owned_tokens;
+  std::vector<Token *> source_tokens;
+  for (size_t i = 0; i < arraysize(kKeyValues); ++i) {
+    owned_tokens.emplace_back(CreateToken(kKeyValues[i][0], kKeyValues[i][1]));
+    source_tokens.push_back(owned_tokens.back().get());
+  }
+  FLAGS_build_bigram_index = true;
+  BuildSystemDictionary(source_tokens, source_tokens.size());
+  unique_ptr<SystemDictionary> system_dic(
+      SystemDictionary::Builder(dic_fn_).Build());
+  ASSERT_TRUE(system_dic.get() != NULL)
+      << "Failed to open dictionary source:" << dic_fn_;
+
+  const char *kQueries[][2] = {
+    {"ろっぽんぎ", "六本木"},
+    {"ろっぽんぎひ", "六本木"},
+    {"ろっ", "六"},
+    {"ろく", "六"},
+    {"ろっぽんぎ", "ロッポンギ"},
+    {"ろっぽんぎ", "未知"},
+  };
+  for (size_t i = 0; i < arraysize(kQueries); ++i) {
+    const string key = kQueries[i][0];
+    const string value_prefix = kQueries[i][1];
+    // The continuations found by the predictive lookup.
+    CollectTokenCallback predictive_callback;
+    system_dic->LookupPredictive(key, convreq_, &predictive_callback);
+    std::set<std::pair<string, string>> expected;
+    for (const Token &token : predictive_callback.tokens()) {
+      if (Util::StartsWith(token.value, value_prefix) &&
+          token.value.size() > value_prefix.size()) {
+        expected.insert(std::make_pair(token.key, token.value));
+      }
+    }
+
+    CollectTokenCallback callback;
+    system_dic->LookupPredictiveWithValuePrefix(key, value_prefix, convreq_,
+                                                &callback);
+    std::set<std::pair<string, string>> actual;
+    for (const Token &token : callback.tokens()) {
+      EXPECT_TRUE(Util::StartsWith(token.key, key)) << token.key;
+      if (Util::StartsWith(token.value, value_prefix) &&
+          token.value.size() > value_prefix.size()) {
+        actual.insert(std::make_pair(token.key, token.value));
+      }
+    }
+    EXPECT_EQ(expected, actual) << key << " " << value_prefix;
+  }
+
+  // The index skips the tokens not continuing the value.
+  CollectTokenCallback callback;
+  system_dic->LookupPredictiveWithValuePrefix("ろっぽんぎ", "六本木",
+                                              convreq_, &callback);
+  EXPECT_EQ(3, callback.tokens().size());
+}
+
 TEST_F(SystemDictionaryTest, LookupReverseWithCache) {
   const string kDoraemon = "ドラえもん";
 
@@ -43,6 +43,21 @@
         'test_size': 'small',
       },
     },
+    {
+      'target_name': 'decoded_value_cache_test',
+      'type': 'executable',
+      'sources': [
+        'decoded_value_cache_test.cc',
+      ],
+      'dependencies': [
+        '../../base/base.gyp:base_core',
+        '../../testing/testing.gyp:gtest_main',
+        'system_dictionary.gyp:decoded_value_cache',
+      ],
+      'variables': {
+        'test_size': 'small',
+      },
+    },
     {
       'target_name': 'key_expansion_table_test',
       'type': 'executable',
@@ -104,6 +119,7 @@
       'target_name': 'system_dictionary_all_test',
       'type': 'none',
       'dependencies': [
+        'decoded_value_cache_test',
         'key_expansion_table_test',
         'system_dictionary_codec_test',
         'system_dictionary_test',
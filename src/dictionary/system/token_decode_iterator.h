@@ -38,6 +38,7 @@
 #include "base/util.h"
 #include "dictionary/dictionary_token.h"
 #include "dictionary/system/codec_interface.h"
+#include "dictionary/system/decoded_value_cache.h"
 #include "dictionary/system/words_info.h"
 #include "storage/louds/louds_trie.h"
 
@@ -46,14 +47,23 @@ namespace dictionary {
 
 class TokenDecodeIterator {
  public:
+  // |value_cache| memoizes the values decoded from |value_trie| if not null.
   TokenDecodeIterator(const SystemDictionaryCodecInterface *codec,
                       const storage::louds::LoudsTrie &value_trie,
                       const uint32 *frequent_pos,
                       StringPiece key,
-                      const uint8 *ptr);
+                      const uint8 *ptr,
+                      DecodedValueCache *value_cache = nullptr);
   ~TokenDecodeIterator() {}
 
-  const TokenInfo& Get() const { return token_info_; }
+  // Returns the current token info.  The key and value of its token are
+  // copied from the view on each call.
+  const TokenInfo& Get() const;
+  // Same as Get() but the key and value of the token are left unset.
+  const TokenInfo& GetInfoWithoutKeyValue() const { return token_info_; }
+  // Returns the current token without copying its key and value.  The view is
+  // valid until Next() is called.
+  const TokenView& GetView() const { return view_; }
   bool Done() const { return state_ == DONE; }
   void Next();
 
@@ -67,14 +77,21 @@ class TokenDecodeIterator {
   void NextInternal();
 
   void LookupValue(int id, string *value) const {
+    if (value_cache_ != nullptr && value_cache_->Lookup(id, value)) {
+      return;
+    }
     char buffer[storage::louds::LoudsTrie::kMaxDepth + 1];
     const StringPiece encoded_value = value_trie_->RestoreKeyString(id, buffer);
     codec_->DecodeValue(encoded_value, value);
+    if (value_cache_ != nullptr) {
+      value_cache_->Insert(id, *value);
+    }
   }
 
   const SystemDictionaryCodecInterface *codec_;
   const storage::louds::LoudsTrie *value_trie_;
   const uint32 *frequent_pos_;
+  DecodedValueCache *value_cache_;
 
   const StringPiece key_;
   // Katakana key will be lazily initialized.
@@ -84,7 +101,14 @@ class TokenDecodeIterator {
   const uint8 *ptr_;
 
   TokenInfo token_info_;
-  Token token_;
+  // Holds the fields decoded by the codec.  The key and value are filled by
+  // Get() only when a caller needs a Token.
+  mutable Token token_;
+  mutable bool token_has_key_;
+  // Key and value of the current token.  The value refers to |key_|,
+  // |key_katakana_| or |value_buffer_|.
+  TokenView view_;
+  string value_buffer_;
 
   DISALLOW_COPY_AND_ASSIGN(TokenDecodeIterator);
 };
@@ -96,18 +120,30 @@ inline TokenDecodeIterator::TokenDecodeIterator(
     const storage::louds::LoudsTrie &value_trie,
     const uint32 *frequent_pos,
     StringPiece key,
-    const uint8 *ptr)
+    const uint8 *ptr,
+    DecodedValueCache *value_cache)
     : codec_(codec),
       value_trie_(&value_trie),
       frequent_pos_(frequent_pos),
+      value_cache_(value_cache),
       key_(key),
       state_(HAS_NEXT),
       ptr_(ptr),
-      token_info_(nullptr) {
-  token_.key.assign(key.data(), key.size());
+      token_info_(nullptr),
+      token_has_key_(false) {
+  view_.key = key_;
   NextInternal();
 }
 
+inline const TokenInfo &TokenDecodeIterator::Get() const {
+  if (!token_has_key_) {
+    key_.CopyToString(&token_.key);
+    token_has_key_ = true;
+  }
+  view_.value.CopyToString(&token_.value);
+  return token_info_;
+}
+
 inline void TokenDecodeIterator::Next() {
   DCHECK_NE(state_, DONE);
   if (state_ == LAST_TOKEN) {
@@ -123,12 +159,12 @@ inline void TokenDecodeIterator::NextInternal() {
   token_info_.Clear();
   token_info_.token = &token_;
 
-  // Do not clear key in token.
   token_info_.token->attributes = Token::NONE;
 
   // This implementation is depending on the internal behavior of DecodeToken
   // especially which fields are updated or not. Important fields are:
-  // Token::key, Token::value : key and value are never updated.
+  // Token::key, Token::value : key and value are never updated.  They are
+  //   kept by |view_| instead.
   // Token::cost : always updated.
   // Token::lid, Token::rid : updated iff the pos_type is neither
   //   FREQUENT_POS nor SAME_AS_PREV_POS.
@@ -150,8 +186,9 @@ inline void TokenDecodeIterator::NextInternal() {
   // Fill remaining values.
   switch (token_info_.value_type) {
     case TokenInfo::DEFAULT_VALUE: {
-      token_.value.clear();
-      LookupValue(token_info_.id_in_value_trie, &token_.value);
+      value_buffer_.clear();
+      LookupValue(token_info_.id_in_value_trie, &value_buffer_);
+      view_.value = value_buffer_;
       break;
     }
     case TokenInfo::SAME_AS_PREV_VALUE: {
@@ -161,14 +198,14 @@ inline void TokenDecodeIterator::NextInternal() {
       break;
     }
     case TokenInfo::AS_IS_HIRAGANA: {
-      token_.value = token_.key;
+      view_.value = key_;
       break;
     }
     case TokenInfo::AS_IS_KATAKANA: {
       if (!key_.empty() && key_katakana_.empty()) {
         Util::HiraganaToKatakana(key_, &key_katakana_);
       }
-      token_.value = key_katakana_;
+      view_.value = key_katakana_;
       break;
     }
     default: {
@@ -178,8 +215,12 @@ inline void TokenDecodeIterator::NextInternal() {
   }
 
   if (token_info_.accent_encoding_type == TokenInfo::EMBEDDED_IN_TOKEN) {
-    token_.value.append(1, '_')
-                .append(Util::StringPrintf("%d", token_info_.accent_type));
+    if (view_.value.data() != value_buffer_.data()) {
+      view_.value.CopyToString(&value_buffer_);
+    }
+    value_buffer_.append(1, '_')
+                 .append(Util::StringPrintf("%d", token_info_.accent_type));
+    view_.value = value_buffer_;
   }
 
   if (token_info_.pos_type == TokenInfo::FREQUENT_POS) {
@@ -187,6 +228,11 @@ inline void TokenDecodeIterator::NextInternal() {
     token_.lid = pos >> 16;
     token_.rid = pos & 0xffff;
   }
+
+  view_.cost = token_.cost;
+  view_.lid = token_.lid;
+  view_.rid = token_.rid;
+  view_.attributes = token_.attributes;
 }
 
 }  // namespace dictionary
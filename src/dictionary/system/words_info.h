@@ -34,6 +34,8 @@
 
 #include <cstddef>
 
+#include "base/port.h"
+
 namespace mozc {
 namespace dictionary {
 
@@ -102,6 +104,24 @@ struct TokenInfo {
   int accent_type;
 };
 
+// The predictive cost bounds section is an array of uint16 pairs for the
+// shallow nodes of the key trie.  The i-th pair holds the minimum cost of the
+// tokens in the subtree of the node whose id is i + 1, and that of the tokens
+// of the node's own key.  kPredictiveCostBoundNone stands for no tokens.
+const uint16 kPredictiveCostBoundNone = 0xffff;
+
+// The reverse lookup index section is an array of uint32 mapping ids in the
+// value trie to ids in the key trie:
+//   [0]: the number of value ids, N
+//   [1, N + 2): offsets to the key ids of each value id, relative to [N + 2]
+//   [N + 2, ...): key ids whose tokens have the value, in ascending order
+// A key id appears as many times as its tokens having the value.
+
+// The bigram index section has the same layout as the reverse lookup index,
+// but maps ids in the value trie to the ids in the key trie having a token
+// whose value starts with, and is longer than, the value.  The key ids of
+// each value id are unique.
+
 }  // namespace dictionary
 }  // namespace mozc
 
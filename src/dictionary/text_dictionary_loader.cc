@@ -34,19 +34,22 @@
 #include "dictionary/text_dictionary_loader.h"
 
 #include <algorithm>
+#include <cstring>
 #include <limits>
 #include <memory>
 #include <string>
 #include <vector>
 
 #include "base/file_stream.h"
+#include "base/file_util.h"
 #include "base/flags.h"
 #include "base/iterator_adapter.h"
 #include "base/logging.h"
+#include "base/mmap.h"
 #include "base/multifile.h"
 #include "base/number_util.h"
-#include "base/stl_util.h"
 #include "base/string_piece.h"
+#include "base/thread_pool.h"
 #include "base/util.h"
 #include "dictionary/dictionary_token.h"
 #include "dictionary/pos_matcher.h"
@@ -105,6 +108,24 @@ inline bool SafeStrToInt(StringPiece s, int *n) {
   return ret;
 }
 
+// Splits |data| into the chunks of about |chunk_size| bytes at line
+// boundaries.
+void SplitIntoChunks(StringPiece data, size_t chunk_size,
+                     std::vector<StringPiece> *chunks) {
+  while (!data.empty()) {
+    size_t size = std::min(chunk_size, data.size());
+    if (size < data.size()) {
+      const void *newline =
+          memchr(data.data() + size, '\n', data.size() - size);
+      size = newline == nullptr
+                 ? data.size()
+                 : static_cast<const char *>(newline) - data.data() + 1;
+    }
+    chunks->push_back(data.substr(0, size));
+    data.remove_prefix(size);
+  }
+}
+
 // Helper functions to get const iterators.
 inline std::vector<Token *>::const_iterator CBegin(
     const std::vector<Token *> &tokens) {
@@ -120,11 +141,13 @@ inline std::vector<Token *>::const_iterator CEnd(
 
 TextDictionaryLoader::TextDictionaryLoader(const POSMatcher &pos_matcher)
     : zipcode_id_(pos_matcher.GetZipcodeId()),
-      isolated_word_id_(pos_matcher.GetIsolatedWordId()) {}
+      isolated_word_id_(pos_matcher.GetIsolatedWordId()),
+      num_threads_(1) {}
 
 TextDictionaryLoader::TextDictionaryLoader(uint16 zipcode_id,
                                            uint16 isolated_word_id)
-    : zipcode_id_(zipcode_id), isolated_word_id_(isolated_word_id) {}
+    : zipcode_id_(zipcode_id), isolated_word_id_(isolated_word_id),
+      num_threads_(1) {}
 
 TextDictionaryLoader::~TextDictionaryLoader() {
   Clear();
@@ -174,16 +197,51 @@ void TextDictionaryLoader::LoadWithLineLimit(
     tokens_.reserve(limit);
   }
 
-  // Read system dictionary.
+  // Read system dictionary.  The chunks of the files are parsed in waves of
+  // a few chunks per thread, which stop early when the |limit| is reached.
+  // The tokens beyond |limit| in the last wave are discarded.
   {
-    InputMultiFile file(dictionary_filename);
-    string line;
-    while (limit > 0 && file.ReadLine(&line)) {
-      Util::ChopReturns(&line);
-      Token *token = ParseTSVLine(line);
-      if (token) {
-        tokens_.push_back(token);
-        --limit;
+    const size_t kChunkSize = 1 << 20;
+    const size_t kChunksPerWave = std::max(1, num_threads_) * 2;
+    std::unique_ptr<ThreadPool> pool;
+    if (num_threads_ > 1) {
+      pool.reset(new ThreadPool(num_threads_));
+    }
+    std::vector<string> filenames;
+    Util::SplitStringUsing(dictionary_filename, ",", &filenames);
+    for (size_t i = 0; i < filenames.size() && limit > 0; ++i) {
+      Mmap mmap;
+      if (!mmap.Open(filenames[i].c_str(), "r")) {
+        // Mmap fails on an empty file.
+        LOG_IF(ERROR, !FileUtil::FileExists(filenames[i]))
+            << "Cannot open " << filenames[i];
+        continue;
+      }
+      std::vector<StringPiece> chunks;
+      SplitIntoChunks(StringPiece(mmap.begin(), mmap.size()), kChunkSize,
+                      &chunks);
+      for (size_t wave = 0; wave < chunks.size() && limit > 0;
+           wave += kChunksPerWave) {
+        const size_t num_chunks =
+            std::min(kChunksPerWave, chunks.size() - wave);
+        std::vector<std::vector<Token>> arenas(num_chunks);
+        ParallelFor(pool.get(), num_chunks,
+                    [this, &chunks, &arenas, wave](size_t begin, size_t end) {
+                      for (size_t j = begin; j < end; ++j) {
+                        ParseChunk(chunks[wave + j], &arenas[j]);
+                      }
+                    });
+        for (size_t j = 0; j < num_chunks && limit > 0; ++j) {
+          std::vector<Token> &arena = arenas[j];
+          const size_t num_tokens =
+              std::min(arena.size(), static_cast<size_t>(limit));
+          for (size_t k = 0; k < num_tokens; ++k) {
+            tokens_.push_back(&arena[k]);
+          }
+          limit -= num_tokens;
+          // Moving the vector keeps the addresses of the tokens.
+          token_arenas_.push_back(std::move(arena));
+        }
       }
     }
     LOG(INFO) << tokens_.size() << " tokens from " << dictionary_filename;
@@ -209,8 +267,9 @@ void TextDictionaryLoader::LoadWithLineLimit(
   const size_t tokens_size = tokens_.size();
   tokens_.resize(tokens_size + reading_correction_tokens.size());
   for (size_t i = 0; i < reading_correction_tokens.size(); ++i) {
-    // |tokens_| takes the ownership of each allocated token.
+    // |added_tokens_| takes the ownership of each allocated token.
     tokens_[tokens_size + i] = reading_correction_tokens[i];
+    added_tokens_.emplace_back(reading_correction_tokens[i]);
   }
 }
 
@@ -303,7 +362,9 @@ void TextDictionaryLoader::LoadReadingCorrectionTokens(
 }
 
 void TextDictionaryLoader::Clear() {
-  STLDeleteElements(&tokens_);
+  tokens_.clear();
+  token_arenas_.clear();
+  added_tokens_.clear();
 }
 
 void TextDictionaryLoader::CollectTokens(std::vector<Token *> *res) const {
@@ -312,17 +373,40 @@ void TextDictionaryLoader::CollectTokens(std::vector<Token *> *res) const {
   res->insert(res->end(), tokens_.begin(), tokens_.end());
 }
 
-Token *TextDictionaryLoader::ParseTSVLine(StringPiece line) const {
+void TextDictionaryLoader::ParseChunk(StringPiece data,
+                                      std::vector<Token> *arena) const {
+  size_t num_lines = std::count(data.begin(), data.end(), '\n');
+  if (!data.empty() && data[data.size() - 1] != '\n') {
+    ++num_lines;
+  }
+  arena->reserve(num_lines);
   std::vector<StringPiece> columns;
-  Util::SplitStringUsing(line, "\t", &columns);
-  return ParseTSV(columns);
+  while (!data.empty()) {
+    const size_t pos = data.find('\n');
+    StringPiece line = data.substr(0, pos);
+    data.remove_prefix(pos == StringPiece::npos ? data.size() : pos + 1);
+    while (!line.empty() && line[line.size() - 1] == '\r') {
+      line.remove_suffix(1);
+    }
+    arena->emplace_back();
+    if (!ParseTSVLine(line, &columns, &arena->back())) {
+      arena->pop_back();
+    }
+  }
+  DCHECK_LE(arena->size(), num_lines);
 }
 
-Token *TextDictionaryLoader::ParseTSV(
-    const std::vector<StringPiece> &columns) const {
-  CHECK_LE(5, columns.size()) << "Lack of columns: " << columns.size();
+bool TextDictionaryLoader::ParseTSVLine(StringPiece line,
+                                        std::vector<StringPiece> *columns,
+                                        Token *token) const {
+  columns->clear();
+  Util::SplitStringUsing(line, "\t", columns);
+  return ParseTSV(*columns, token);
+}
 
-  std::unique_ptr<Token> token(new Token);
+bool TextDictionaryLoader::ParseTSV(const std::vector<StringPiece> &columns,
+                                    Token *token) const {
+  CHECK_LE(5, columns.size()) << "Lack of columns: " << columns.size();
 
   // Parse key, lid, rid, cost, value.
   Util::NormalizeVoicedSoundMark(columns[0], &token->key);
@@ -337,10 +421,10 @@ Token *TextDictionaryLoader::ParseTSV(
   // Optionally, label (SPELLING_CORRECTION, ZIP_CODE, etc.) may be provided in
   // column 6.
   if (columns.size() > 5) {
-    CHECK(RewriteSpecialToken(token.get(), columns[5]))
+    CHECK(RewriteSpecialToken(token, columns[5]))
         << "Invalid label: " << columns[5];
   }
-  return token.release();
+  return true;
 }
 
 }  // namespace dictionary
@@ -30,6 +30,7 @@
 #ifndef MOZC_DICTIONARY_TEXT_DICTIONARY_LOADER_H_
 #define MOZC_DICTIONARY_TEXT_DICTIONARY_LOADER_H_
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -69,9 +70,17 @@ class TextDictionaryLoader {
   // Clears the loaded tokens.
   void Clear();
 
+  // Parses the lines of the system dictionary files on |num_threads| threads
+  // (default: 1).  The loaded tokens are the same and in the same order as
+  // with a single thread.  ParseTSV() must be thread-safe if it's more than 1.
+  // Each file is memory-mapped and split into chunks, whose lines are parsed
+  // without copying them into the tokens allocated from per-chunk arenas.
+  void set_num_threads(int num_threads) { num_threads_ = num_threads; }
+
   // Adds a token.  The ownership is taken by the loader.
   void AddToken(Token *token) {
     tokens_.push_back(token);
+    added_tokens_.emplace_back(token);
   }
 
   const std::vector<Token *> &tokens() const {
@@ -84,8 +93,10 @@ class TextDictionaryLoader {
   void CollectTokens(std::vector<Token *> *res) const;
 
  protected:
-  // Allows derived classes to implement custom filtering rules.
-  virtual Token *ParseTSV(const std::vector<StringPiece> &columns) const;
+  // Fills |token| from the columns of a line.  Returns false to skip the
+  // line; allows derived classes to implement custom filtering rules.
+  virtual bool ParseTSV(const std::vector<StringPiece> &columns,
+                        Token *token) const;
 
  private:
   static void LoadReadingCorrectionTokens(
@@ -102,11 +113,23 @@ class TextDictionaryLoader {
   // Otherwise, the method returns false.
   bool RewriteSpecialToken(Token *token, StringPiece label) const;
 
-  Token *ParseTSVLine(StringPiece line) const;
+  // |columns| is a buffer reused among the lines.
+  bool ParseTSVLine(StringPiece line, std::vector<StringPiece> *columns,
+                    Token *token) const;
+
+  // Parses the lines of |data| into |arena|.  |arena| has enough capacity
+  // not to be reallocated, so that the tokens have stable addresses.
+  void ParseChunk(StringPiece data, std::vector<Token> *arena) const;
 
   const uint16 zipcode_id_;
   const uint16 isolated_word_id_;
+  int num_threads_;
   std::vector<Token *> tokens_;
+  // Own the tokens pointed to by |tokens_|.  The tokens from the dictionary
+  // files are allocated in the arenas and the others are allocated one by
+  // one.
+  std::vector<std::vector<Token>> token_arenas_;
+  std::vector<std::unique_ptr<Token>> added_tokens_;
 
   FRIEND_TEST(TextDictionaryLoaderTest, RewriteSpecialTokenTest);
 };
@@ -156,6 +156,32 @@ TEST_F(TextDictionaryLoaderTest, BasicTest) {
   FileUtil::Unlink(filename);
 }
 
+TEST_F(TextDictionaryLoaderTest, MultiThreadTest) {
+  const string filename = FileUtil::JoinPath(FLAGS_test_tmpdir, "test.tsv");
+  {
+    OutputFileStream ofs(filename.c_str());
+    for (int i = 0; i < 1000; ++i) {
+      ofs << "key" << i << "\t" << i % 10 << "\t" << i % 20 << "\t" << i
+          << "\tvalue" << i << "\n";
+    }
+  }
+
+  unique_ptr<TextDictionaryLoader> loader(CreateTextDictionaryLoader());
+  loader->set_num_threads(4);
+  loader->LoadWithLineLimit(filename, "", 900);
+  const std::vector<Token *> &tokens = loader->tokens();
+  ASSERT_EQ(900, tokens.size());
+  for (int i = 0; i < 900; ++i) {
+    EXPECT_EQ("key" + std::to_string(i), tokens[i]->key);
+    EXPECT_EQ("value" + std::to_string(i), tokens[i]->value);
+    EXPECT_EQ(i % 10, tokens[i]->lid);
+    EXPECT_EQ(i % 20, tokens[i]->rid);
+    EXPECT_EQ(i, tokens[i]->cost);
+  }
+
+  FileUtil::Unlink(filename);
+}
+
 TEST_F(TextDictionaryLoaderTest, RewriteSpecialTokenTest) {
   unique_ptr<TextDictionaryLoader> loader(CreateTextDictionaryLoader());
   {
@@ -233,6 +259,47 @@ TEST_F(TextDictionaryLoaderTest, LoadMultipleFilesTest) {
   FileUtil::Unlink(filename2);
 }
 
+TEST_F(TextDictionaryLoaderTest, LoadLargeFileTest) {
+  // Spans multiple chunks, with CRLF line ends and without the last newline.
+  const string filename1 = FileUtil::JoinPath(FLAGS_test_tmpdir, "test1.tsv");
+  const string filename2 = FileUtil::JoinPath(FLAGS_test_tmpdir, "empty.tsv");
+  const int kNumLines = 100000;
+  {
+    OutputFileStream ofs(filename1.c_str(), std::ios::binary);
+    for (int i = 0; i < kNumLines; ++i) {
+      ofs << "key" << i << "\t1\t2\t" << i << "\tvalue" << i;
+      if (i + 1 < kNumLines) {
+        ofs << "\r\n";
+      }
+    }
+  }
+  {
+    OutputFileStream ofs(filename2.c_str());
+  }
+
+  for (int num_threads = 1; num_threads <= 3; num_threads += 2) {
+    unique_ptr<TextDictionaryLoader> loader(CreateTextDictionaryLoader());
+    loader->set_num_threads(num_threads);
+    loader->Load(filename2 + "," + filename1, "");
+    const std::vector<Token *> &tokens = loader->tokens();
+    ASSERT_EQ(kNumLines, tokens.size());
+    for (int i = 0; i < kNumLines; i += 999) {
+      EXPECT_EQ("key" + std::to_string(i), tokens[i]->key);
+      EXPECT_EQ("value" + std::to_string(i), tokens[i]->value);
+      EXPECT_EQ(i, tokens[i]->cost);
+    }
+    EXPECT_EQ("value" + std::to_string(kNumLines - 1), tokens.back()->value);
+
+    loader->LoadWithLineLimit(filename1, "", kNumLines / 2 + 1);
+    ASSERT_EQ(kNumLines / 2 + 1, loader->tokens().size());
+    EXPECT_EQ("key" + std::to_string(kNumLines / 2),
+              loader->tokens().back()->key);
+  }
+
+  FileUtil::Unlink(filename1);
+  FileUtil::Unlink(filename2);
+}
+
 TEST_F(TextDictionaryLoaderTest, ReadingCorrectionTest) {
   unique_ptr<TextDictionaryLoader> loader(CreateTextDictionaryLoader());
 
@@ -30,15 +30,20 @@
 #include "dictionary/user_dictionary.h"
 
 #include <algorithm>
+#include <cstring>
 #include <limits>
 #include <memory>
 #include <set>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "base/compiler_specific.h"
+#include "base/file_stream.h"
 #include "base/file_util.h"
 #include "base/hash.h"
 #include "base/logging.h"
+#include "base/mmap.h"
 #include "base/mutex.h"
 #include "base/singleton.h"
 #include "base/stl_util.h"
@@ -52,36 +57,31 @@
 #include "dictionary/user_dictionary_util.h"
 #include "dictionary/user_pos.h"
 #include "protocol/config.pb.h"
+#include "storage/louds/louds_trie.h"
+#include "storage/louds/louds_trie_builder.h"
 #include "usage_stats/usage_stats.h"
 
 namespace mozc {
 namespace dictionary {
 namespace {
 
-struct OrderByKey {
-  bool operator()(const UserPOS::Token *token, StringPiece key) const {
-    return token->key < key;
-  }
+using storage::louds::LoudsTrie;
+using storage::louds::LoudsTrieBuilder;
 
-  bool operator()(StringPiece key, const UserPOS::Token *token) const {
-    return key < token->key;
-  }
+// A token with the fingerprint of the storage entry it is generated from.
+struct SourcedToken {
+  UserPOS::Token token;
+  uint64 source;
 };
 
-struct OrderByKeyPrefix {
-  bool operator()(const UserPOS::Token *token, StringPiece prefix) const {
-    return StringPiece(token->key).substr(0, prefix.size()) < prefix;
+struct OrderByKeyThenById {
+  bool operator()(const UserPOS::Token &lhs, const UserPOS::Token &rhs) const {
+    const int comp = lhs.key.compare(rhs.key);
+    return comp == 0 ? (lhs.id < rhs.id) : (comp < 0);
   }
 
-  bool operator()(StringPiece prefix, const UserPOS::Token *token) const {
-    return prefix < StringPiece(token->key).substr(0, prefix.size());
-  }
-};
-
-struct OrderByKeyThenById {
-  bool operator()(const UserPOS::Token *lhs, const UserPOS::Token *rhs) const {
-    const int comp = lhs->key.compare(rhs->key);
-    return comp == 0 ? (lhs->id < rhs->id) : (comp < 0);
+  bool operator()(const SourcedToken &lhs, const SourcedToken &rhs) const {
+    return (*this)(lhs.token, rhs.token);
   }
 };
 
@@ -109,44 +109,334 @@ class UserDictionaryFileManager {
   DISALLOW_COPY_AND_ASSIGN(UserDictionaryFileManager);
 };
 
-void FillTokenFromUserPOSToken(const UserPOS::Token &user_pos_token,
-                               Token *token) {
-  token->key = user_pos_token.key;
-  token->value = user_pos_token.value;
-  token->cost = user_pos_token.cost;
-  token->lid = user_pos_token.id;
-  token->rid = user_pos_token.id;
-  token->attributes = Token::USER_DICTIONARY;
+// Format of the compiled image of user dictionary.  All the sections are
+// aligned to 4 bytes, and the strings are referred by offsets into the string
+// section so that the image can be mapped from a file as is.
+//
+// |ImageHeader|
+// |PackedToken tokens[num_tokens]|  (sorted by key and then by POS ID)
+// |uint64 token_sources[num_tokens]|  (fingerprints of the source entries)
+// |PackedKeyRange key_ranges[num_keys]|  (indexed by key ID of the trie)
+// |PackedSuppressionEntry suppression_entries[num_suppression_entries]|
+// |LOUDS trie of the keys|
+// |strings|
+const uint32 kImageMagic = 0x43445555;  // "UUDC"
+const uint32 kImageVersion = 2;
+
+struct PackedString {
+  uint32 offset;
+  uint32 size;
+};
+
+struct PackedToken {
+  PackedString key;
+  PackedString value;
+  PackedString comment;
+  uint16 id;
+  int16 cost;
+};
+
+struct PackedKeyRange {
+  uint32 begin;
+  uint32 end;
+};
+
+struct PackedSuppressionEntry {
+  PackedString key;
+  PackedString value;
+};
+
+struct ImageHeader {
+  uint32 magic;
+  uint32 version;
+  // Fingerprints of the source file and of the POS data the image is built
+  // with.  The image is discarded when either of them changes.
+  uint64 source_fingerprint;
+  uint64 pos_fingerprint;
+  uint32 num_tokens;
+  uint32 num_keys;
+  uint32 num_suppression_entries;
+  uint32 tokens_offset;
+  uint32 token_sources_offset;
+  uint32 key_ranges_offset;
+  uint32 suppression_entries_offset;
+  uint32 trie_offset;
+  uint32 trie_size;
+  uint32 strings_offset;
+  uint32 strings_size;
+};
+
+size_t Align4(size_t size) {
+  return (size + 3) & ~static_cast<size_t>(3);
+}
+
+template <typename T>
+void AppendPod(const T &value, string *image) {
+  image->append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+// Appends |str| to |strings| and returns the reference to it.
+PackedString AddString(StringPiece str, string *strings) {
+  PackedString result;
+  result.offset = static_cast<uint32>(strings->size());
+  result.size = static_cast<uint32>(str.size());
+  strings->append(str.data(), str.size());
+  return result;
+}
+
+bool IsValidString(const PackedString &str, uint32 strings_size) {
+  return str.offset <= strings_size && str.size <= strings_size - str.offset;
+}
+
+bool IsValidSection(uint32 offset, uint32 num, size_t element_size,
+                    size_t image_size) {
+  return offset % 4 == 0 && offset <= image_size &&
+      num <= (image_size - offset) / element_size;
+}
+
+// Checks the sizes in the header of LOUDS trie image, as LoudsTrie::Open()
+// crashes on broken ones.  See louds_trie.cc for the format.
+bool IsValidTrieImage(const char *data, uint32 size) {
+  if (size < 16) {
+    return false;
+  }
+  uint32 sizes[4];
+  memcpy(sizes, data, sizeof(sizes));
+  const uint64 louds_size = sizes[0];
+  const uint64 terminal_size = sizes[1];
+  const uint32 num_character_bits = sizes[2];
+  const uint64 edge_character_size = sizes[3];
+  return num_character_bits == 8 && edge_character_size > 0 &&
+      16 + louds_size + terminal_size + edge_character_size <= size;
+}
+
+// Returns the name of the compiled image of |filename|.
+string GetCompiledFileName(const string &filename) {
+  return filename + ".compiled";
+}
+
+bool GetFileFingerprint(const string &filename, uint64 *fingerprint) {
+  Mmap mmap;
+  if (!mmap.Open(filename.c_str(), "r")) {
+    return false;
+  }
+  *fingerprint = Hash::Fingerprint(StringPiece(mmap.begin(), mmap.size()));
+  return true;
+}
+
+uint64 GetUserPOSFingerprint(const UserPOSInterface &user_pos) {
+  std::vector<string> pos_list;
+  user_pos.GetPOSList(&pos_list);
+  string signature;
+  std::vector<UserPOS::Token> tokens;
+  for (size_t i = 0; i < pos_list.size(); ++i) {
+    signature.append(pos_list[i]);
+    if (!user_pos.GetTokens("key", "value", pos_list[i], &tokens)) {
+      continue;
+    }
+    for (size_t j = 0; j < tokens.size(); ++j) {
+      signature.append("\t" + tokens[j].key + "\t" + tokens[j].value);
+      AppendPod(tokens[j].id, &signature);
+      AppendPod(tokens[j].cost, &signature);
+    }
+    signature.append("\n");
+  }
+  return Hash::Fingerprint(signature);
+}
+
+bool WriteCompiledImage(const string &image, const string &filename) {
+  const string tmp_filename = filename + ".tmp";
+  {
+    OutputFileStream ofs(tmp_filename.c_str(),
+                         std::ios::binary | std::ios::out);
+    if (!ofs) {
+      LOG(ERROR) << "cannot open " << tmp_filename;
+      return false;
+    }
+    ofs.write(image.data(), image.size());
+    if (!ofs) {
+      LOG(ERROR) << "cannot write " << tmp_filename;
+      return false;
+    }
+  }
+  if (!FileUtil::AtomicRename(tmp_filename, filename)) {
+    LOG(ERROR) << "AtomicRename failed: " << filename;
+    FileUtil::Unlink(tmp_filename);
+    return false;
+  }
+  return true;
 }
 
 }  // namespace
 
-class UserDictionary::TokensIndex : public std::vector<UserPOS::Token *> {
+// Tokens sorted by key and then by POS ID, packed contiguously in an image
+// with a LOUDS trie of the distinct keys.  The key ID of the trie maps to the
+// range of the tokens having the key, so that exact and prefix lookups only
+// walk the trie along the query instead of scanning the tokens.  The image is
+// either built from UserDictionaryStorage or mapped from a compiled file.
+class UserDictionary::TokensIndex {
  public:
+  // A range [first, second) of token indices.
+  typedef std::pair<size_t, size_t> Range;
+
+  // A word entry of the storage with its normalized reading.
+  struct SourceEntry {
+    string reading;
+    const UserDictionaryStorage::UserDictionaryEntry *entry;
+    string comment;
+    // Fingerprint of the reading, the value, the POS and the comment, which
+    // identifies the tokens generated from the entry.
+    uint64 fingerprint;
+  };
+
+  // The valid and distinct entries of a storage.
+  struct SourceEntries {
+    std::vector<SourceEntry> words;
+    std::vector<std::pair<string, string>> suppression_entries;
+  };
+
   TokensIndex(const UserPOSInterface *user_pos,
               SuppressionDictionary *suppression_dictionary)
       : user_pos_(user_pos),
-        suppression_dictionary_(suppression_dictionary) {}
+        suppression_dictionary_(suppression_dictionary),
+        header_(nullptr), tokens_(nullptr), token_sources_(nullptr),
+        key_ranges_(nullptr), strings_(nullptr) {}
 
   ~TokensIndex() {
     Clear();
   }
 
   void Clear() {
-    STLDeleteElements(this);
-    clear();
+    trie_.Close();
+    mmap_.reset();
+    image_.clear();
+    header_ = nullptr;
+    tokens_ = nullptr;
+    token_sources_ = nullptr;
+    key_ranges_ = nullptr;
+    strings_ = nullptr;
+    comment_index_.clear();
   }
 
-  void Load(const user_dictionary::UserDictionaryStorage &storage) {
-    Clear();
-    std::set<uint64> seen;
-    std::vector<UserPOS::Token> tokens;
+  bool empty() const { return size() == 0; }
 
-    if (!suppression_dictionary_->IsLocked()) {
-      LOG(ERROR) << "SuppressionDictionary must be locked first";
+  size_t GetHeapMemoryUsage() const {
+    return sizeof(*this) + image_.capacity() + trie_.GetHeapMemoryUsage() +
+        sizeof(CommentIndexEntry) * comment_index_.capacity();
+  }
+  size_t size() const { return header_ == nullptr ? 0 : header_->num_tokens; }
+
+  StringPiece key(size_t i) const { return GetString(tokens_[i].key); }
+  StringPiece value(size_t i) const { return GetString(tokens_[i].value); }
+  StringPiece comment(size_t i) const {
+    return GetString(tokens_[i].comment);
+  }
+  uint16 id(size_t i) const { return tokens_[i].id; }
+  // Fingerprint of the storage entry the i-th token is generated from.
+  uint64 source(size_t i) const {
+    // The section is aligned only to 4 bytes.
+    uint64 result;
+    memcpy(&result, token_sources_ + sizeof(result) * i, sizeof(result));
+    return result;
+  }
+
+  // Fills |token| with the i-th token, referring to the strings in the image.
+  void FillToken(size_t i, TokenView *token) const {
+    token->key = key(i);
+    token->value = value(i);
+    token->cost = tokens_[i].cost;
+    token->lid = tokens_[i].id;
+    token->rid = tokens_[i].id;
+    token->attributes = Token::USER_DICTIONARY;
+  }
+
+  // Returns the tokens whose key is |key|.
+  Range FindExact(StringPiece key) const {
+    if (empty()) {
+      return Range(0, 0);
     }
-    suppression_dictionary_->Clear();
+    const int key_id = trie_.ExactSearch(key);
+    if (key_id < 0) {
+      return Range(0, 0);
+    }
+    return GetRange(key_id);
+  }
+
+  // True if any token has a comment.
+  bool has_comments() const { return !comment_index_.empty(); }
+
+  // Finds the comment of the first token of |query_key| and |query_value|
+  // having a non-empty comment.
+  bool FindComment(StringPiece query_key, StringPiece query_value,
+                   StringPiece *found) const {
+    const uint64 fp = GetCommentFingerprint(query_key, query_value);
+    for (auto iter = std::lower_bound(comment_index_.begin(),
+                                      comment_index_.end(),
+                                      CommentIndexEntry(fp, 0));
+         iter != comment_index_.end() && iter->first == fp; ++iter) {
+      // Verify the strings in case of a fingerprint collision.
+      const size_t i = iter->second;
+      if (key(i) == query_key && value(i) == query_value) {
+        *found = comment(i);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Returns the tokens whose key starts with |prefix|.
+  Range FindPredictive(StringPiece prefix) const {
+    // Binary search for the first key not less than |prefix| and then for
+    // the first key not starting with |prefix|.
+    size_t begin = 0, end = size();
+    while (begin < end) {
+      const size_t mid = begin + (end - begin) / 2;
+      if (key(mid).substr(0, prefix.size()) < prefix) {
+        begin = mid + 1;
+      } else {
+        end = mid;
+      }
+    }
+    const size_t first = begin;
+    end = size();
+    while (begin < end) {
+      const size_t mid = begin + (end - begin) / 2;
+      if (key(mid).substr(0, prefix.size()) == prefix) {
+        begin = mid + 1;
+      } else {
+        end = mid;
+      }
+    }
+    return Range(first, begin);
+  }
+
+  // Calls |func| with the tokens of each key which is a prefix of |key|, from
+  // the shortest one.  Stops if |func| returns false.
+  template <typename Func>
+  void ForEachPrefix(StringPiece key, Func func) const {
+    if (empty()) {
+      return;
+    }
+    LoudsTrie::Node node;
+    for (StringPiece::size_type i = 0; i < key.size(); ++i) {
+      if (!trie_.MoveToChildByLabel(key[i], &node)) {
+        return;
+      }
+      if (trie_.IsTerminalNode(node) &&
+          !func(GetRange(trie_.GetKeyIdOfTerminalNode(node)))) {
+        return;
+      }
+    }
+  }
 
+  // Returns the image built by Load().  Empty if the index is opened from a
+  // compiled file.
+  const string &image() const { return image_; }
+
+  // Collects the valid and distinct entries of |storage| into |entries|.
+  void Collect(const user_dictionary::UserDictionaryStorage &storage,
+               SourceEntries *entries) const {
+    std::set<uint64> seen;
     for (size_t i = 0; i < storage.dictionaries_size(); ++i) {
       const UserDictionaryStorage::UserDictionary &dic =
           storage.dictionaries(i);
@@ -177,11 +467,13 @@ MOZC_CLANG_DISABLE_WARNING(tautological-constant-out-of-range-compare);
 #endif  // MOZC_CLANG_HAS_WARNING(tautological-constant-out-of-range-compare)
         DCHECK_LE(entry.pos(), 255);
 MOZC_CLANG_POP_WARNING();
-        const uint64 fp = Hash::Fingerprint(reading +
-                                            "\t" +
-                                            entry.value() +
-                                            "\t" +
-                                            static_cast<char>(entry.pos()));
+        Hash::Fingerprinter fingerprinter;
+        fingerprinter.Append(reading);
+        fingerprinter.Append('\t');
+        fingerprinter.Append(entry.value());
+        fingerprinter.Append('\t');
+        fingerprinter.Append(static_cast<char>(entry.pos()));
+        const uint64 fp = fingerprinter.Fingerprint();
         if (!seen.insert(fp).second) {
           VLOG(1) << "Found dup item";
           continue;
@@ -189,34 +481,442 @@ MOZC_CLANG_POP_WARNING();
 
         // "抑制単語"
         if (entry.pos() == user_dictionary::UserDictionary::SUPPRESSION_WORD) {
-          suppression_dictionary_->AddEntry(reading, entry.value());
-        } else {
-          tokens.clear();
-          user_pos_->GetTokens(
-              reading, entry.value(),
-              UserDictionaryUtil::GetStringPosType(entry.pos()), &tokens);
-          for (size_t k = 0; k < tokens.size(); ++k) {
-            this->push_back(new UserPOS::Token(tokens[k]));
-            Util::StripWhiteSpaces(entry.comment(), &this->back()->comment);
-          }
+          entries->suppression_entries.push_back(
+              std::make_pair(reading, entry.value()));
+          continue;
         }
+        entries->words.push_back(SourceEntry());
+        SourceEntry *word = &entries->words.back();
+        word->reading.swap(reading);
+        word->entry = &entry;
+        Util::StripWhiteSpaces(entry.comment(), &word->comment);
+        // The comment is copied to the tokens, so it identifies them too.
+        fingerprinter.Append('\t');
+        fingerprinter.Append(word->comment);
+        word->fingerprint = fingerprinter.Fingerprint();
       }
     }
+  }
+
+  // Builds the index from all the |entries|.  |source_fingerprint| and
+  // |pos_fingerprint| are recorded in the image.
+  void Load(const SourceEntries &entries, uint64 source_fingerprint,
+            uint64 pos_fingerprint) {
+    Clear();
+    std::vector<UserPOS::Token> tokens;
+    std::vector<SourcedToken> all_tokens;
+    for (size_t i = 0; i < entries.words.size(); ++i) {
+      AppendTokens(entries.words[i], &tokens, &all_tokens);
+    }
 
     // Sort first by key and then by POS ID.
-    std::sort(this->begin(), this->end(), OrderByKeyThenById());
+    std::sort(all_tokens.begin(), all_tokens.end(), OrderByKeyThenById());
+    Build(all_tokens, entries, source_fingerprint, pos_fingerprint);
+  }
+
+  // Builds the index from |entries| by reusing the tokens of |base|, so that
+  // only the entries added since |base| was built go through
+  // UserPOS::GetTokens() and sorting.  Returns false without modifying the
+  // suppression dictionary if |base| cannot be reused or there are too many
+  // changes, for which Load() should be used instead.
+  bool Update(const SourceEntries &entries, const TokensIndex &base,
+              uint64 source_fingerprint, uint64 pos_fingerprint) {
+    if (base.empty() || base.header_->pos_fingerprint != pos_fingerprint) {
+      return false;
+    }
 
+    std::vector<uint64> sources(entries.words.size());
+    for (size_t i = 0; i < entries.words.size(); ++i) {
+      sources[i] = entries.words[i].fingerprint;
+    }
+    std::sort(sources.begin(), sources.end());
+    std::vector<uint64> base_sources(base.size());
+    for (size_t i = 0; i < base.size(); ++i) {
+      base_sources[i] = base.source(i);
+    }
+    std::sort(base_sources.begin(), base_sources.end());
+    base_sources.erase(std::unique(base_sources.begin(), base_sources.end()),
+                       base_sources.end());
+
+    std::vector<const SourceEntry *> added;
+    for (size_t i = 0; i < entries.words.size(); ++i) {
+      if (!std::binary_search(base_sources.begin(), base_sources.end(),
+                              entries.words[i].fingerprint)) {
+        added.push_back(&entries.words[i]);
+      }
+    }
+    // |sources| has no duplicates as the entries are distinct.
+    const size_t num_kept = sources.size() - added.size();
+    const size_t num_removed = base_sources.size() - num_kept;
+    const size_t kMinMaxChanges = 16;
+    if (added.size() + num_removed >
+        std::max(kMinMaxChanges, entries.words.size() / 8)) {
+      return false;
+    }
+
+    Clear();
+    // The tokens of |base| are already sorted.
+    std::vector<SourcedToken> kept_tokens;
+    kept_tokens.reserve(base.size());
+    for (size_t i = 0; i < base.size(); ++i) {
+      const uint64 source = base.source(i);
+      if (num_removed > 0 &&
+          !std::binary_search(sources.begin(), sources.end(), source)) {
+        continue;
+      }
+      kept_tokens.push_back(SourcedToken());
+      SourcedToken *kept = &kept_tokens.back();
+      base.key(i).CopyToString(&kept->token.key);
+      base.value(i).CopyToString(&kept->token.value);
+      base.comment(i).CopyToString(&kept->token.comment);
+      kept->token.id = base.id(i);
+      kept->token.cost = base.tokens_[i].cost;
+      kept->source = source;
+    }
+
+    std::vector<UserPOS::Token> tokens;
+    std::vector<SourcedToken> added_tokens;
+    for (size_t i = 0; i < added.size(); ++i) {
+      AppendTokens(*added[i], &tokens, &added_tokens);
+    }
+    std::sort(added_tokens.begin(), added_tokens.end(), OrderByKeyThenById());
+
+    std::vector<SourcedToken> all_tokens(kept_tokens.size() +
+                                         added_tokens.size());
+    std::merge(kept_tokens.begin(), kept_tokens.end(),
+               added_tokens.begin(), added_tokens.end(), all_tokens.begin(),
+               OrderByKeyThenById());
+    Build(all_tokens, entries, source_fingerprint, pos_fingerprint);
+    VLOG(1) << added.size() << " user dic entries added and " << num_removed
+            << " removed incrementally";
+    return true;
+  }
+
+  // Opens the compiled image at |filename| if it is built from the source of
+  // |source_fingerprint| with the POS data of |pos_fingerprint|.  On success,
+  // the suppression dictionary is also restored and unlocked.  Returns false
+  // without modifying the suppression dictionary otherwise.
+  bool Open(const string &filename, uint64 source_fingerprint,
+            uint64 pos_fingerprint) {
+    Clear();
+    std::unique_ptr<Mmap> mmap(new Mmap);
+    if (!mmap->Open(filename.c_str(), "r")) {
+      return false;
+    }
+    if (!Init(mmap->begin(), mmap->size()) ||
+        header_->source_fingerprint != source_fingerprint ||
+        header_->pos_fingerprint != pos_fingerprint) {
+      VLOG(1) << "Compiled user dictionary is obsolete or broken: "
+              << filename;
+      Clear();
+      return false;
+    }
+    mmap_ = std::move(mmap);
+
+    if (!suppression_dictionary_->IsLocked()) {
+      LOG(ERROR) << "SuppressionDictionary must be locked first";
+    }
+    suppression_dictionary_->Clear();
+    const PackedSuppressionEntry *suppression_entries =
+        reinterpret_cast<const PackedSuppressionEntry *>(
+            mmap_->begin() + header_->suppression_entries_offset);
+    for (size_t i = 0; i < header_->num_suppression_entries; ++i) {
+      suppression_dictionary_->AddEntry(
+          GetString(suppression_entries[i].key).as_string(),
+          GetString(suppression_entries[i].value).as_string());
+    }
     suppression_dictionary_->UnLock();
 
-    VLOG(1) << this->size() << " user dic entries loaded";
+    VLOG(1) << size() << " user dic entries loaded from " << filename;
 
     usage_stats::UsageStats::SetInteger("UserRegisteredWord",
-                                        static_cast<int>(this->size()));
+                                        static_cast<int>(size()));
+    return true;
   }
 
  private:
+  // A pair of the fingerprint of a key and a value, and the index of the
+  // token.
+  typedef std::pair<uint64, uint32> CommentIndexEntry;
+
+  static uint64 GetCommentFingerprint(StringPiece key, StringPiece value) {
+    Hash::Fingerprinter fingerprinter;
+    fingerprinter.Append(key);
+    fingerprinter.Append('\t');
+    fingerprinter.Append(value);
+    return fingerprinter.Fingerprint();
+  }
+
+  StringPiece GetString(const PackedString &str) const {
+    return StringPiece(strings_ + str.offset, str.size);
+  }
+
+  // Appends the tokens generated from |word| to |result|.  |tokens| is a
+  // buffer reused across the calls.
+  void AppendTokens(const SourceEntry &word,
+                    std::vector<UserPOS::Token> *tokens,
+                    std::vector<SourcedToken> *result) const {
+    tokens->clear();
+    user_pos_->GetTokens(
+        word.reading, word.entry->value(),
+        UserDictionaryUtil::GetStringPosType(word.entry->pos()), tokens);
+    for (size_t i = 0; i < tokens->size(); ++i) {
+      result->push_back(SourcedToken());
+      result->back().token.key.swap((*tokens)[i].key);
+      result->back().token.value.swap((*tokens)[i].value);
+      result->back().token.id = (*tokens)[i].id;
+      result->back().token.cost = (*tokens)[i].cost;
+      result->back().token.comment = word.comment;
+      result->back().source = word.fingerprint;
+    }
+  }
+
+  // Builds the index from the sorted |tokens| and restores the suppression
+  // dictionary from |entries|.  The suppression dictionary is unlocked.
+  void Build(const std::vector<SourcedToken> &tokens,
+             const SourceEntries &entries, uint64 source_fingerprint,
+             uint64 pos_fingerprint) {
+    if (!suppression_dictionary_->IsLocked()) {
+      LOG(ERROR) << "SuppressionDictionary must be locked first";
+    }
+    suppression_dictionary_->Clear();
+    for (size_t i = 0; i < entries.suppression_entries.size(); ++i) {
+      suppression_dictionary_->AddEntry(entries.suppression_entries[i].first,
+                                        entries.suppression_entries[i].second);
+    }
+
+    BuildImage(tokens, entries.suppression_entries, source_fingerprint,
+               pos_fingerprint);
+
+    suppression_dictionary_->UnLock();
+
+    VLOG(1) << size() << " user dic entries loaded";
+
+    usage_stats::UsageStats::SetInteger("UserRegisteredWord",
+                                        static_cast<int>(size()));
+  }
+
+  // Builds |comment_index_| from the tokens having a comment.  Only the first
+  // one is indexed for each pair of a key and a value, as the comment found
+  // first is used.
+  void BuildCommentIndex() {
+    comment_index_.clear();
+    for (size_t i = 0; i < size(); ++i) {
+      if (!comment(i).empty()) {
+        comment_index_.push_back(CommentIndexEntry(
+            GetCommentFingerprint(key(i), value(i)), static_cast<uint32>(i)));
+      }
+    }
+    // Stable so that the tokens of the same fingerprint stay in the order of
+    // the image.
+    std::stable_sort(comment_index_.begin(), comment_index_.end(),
+                     [](const CommentIndexEntry &lhs,
+                        const CommentIndexEntry &rhs) {
+                       return lhs.first < rhs.first;
+                     });
+    comment_index_.shrink_to_fit();
+  }
+
+  Range GetRange(int key_id) const {
+    DCHECK_GE(key_id, 0);
+    if (key_id >= header_->num_keys) {
+      // Only happens for a broken image.
+      return Range(0, 0);
+    }
+    return Range(key_ranges_[key_id].begin, key_ranges_[key_id].end);
+  }
+
+  // Builds |image_| from the sorted |tokens| and initializes the index.
+  void BuildImage(
+      const std::vector<SourcedToken> &tokens,
+      const std::vector<std::pair<string, string>> &suppression_entries,
+      uint64 source_fingerprint, uint64 pos_fingerprint) {
+    string strings;
+    std::vector<PackedToken> packed_tokens(tokens.size());
+    std::vector<PackedKeyRange> key_ranges;
+    LoudsTrieBuilder builder;
+    for (size_t i = 0; i < tokens.size(); ++i) {
+      const UserPOS::Token &token = tokens[i].token;
+      const bool is_new_key = (i == 0 || token.key != tokens[i - 1].token.key);
+      if (is_new_key) {
+        builder.Add(token.key);
+        packed_tokens[i].key = AddString(token.key, &strings);
+      } else {
+        // The tokens of the same key share the string.
+        packed_tokens[i].key = packed_tokens[i - 1].key;
+      }
+      packed_tokens[i].value = AddString(token.value, &strings);
+      packed_tokens[i].comment = AddString(token.comment, &strings);
+      packed_tokens[i].id = token.id;
+      packed_tokens[i].cost = token.cost;
+    }
+    string trie_image;
+    if (!tokens.empty()) {
+      builder.Build();
+      trie_image = builder.image();
+      for (size_t begin = 0; begin < tokens.size();) {
+        const string &key = tokens[begin].token.key;
+        size_t end = begin + 1;
+        while (end < tokens.size() && tokens[end].token.key == key) {
+          ++end;
+        }
+        const int key_id = builder.GetId(key);
+        DCHECK_GE(key_id, 0);
+        if (key_id >= key_ranges.size()) {
+          key_ranges.resize(key_id + 1);
+        }
+        key_ranges[key_id].begin = static_cast<uint32>(begin);
+        key_ranges[key_id].end = static_cast<uint32>(end);
+        begin = end;
+      }
+    }
+    std::vector<PackedSuppressionEntry> packed_suppression_entries(
+        suppression_entries.size());
+    for (size_t i = 0; i < suppression_entries.size(); ++i) {
+      packed_suppression_entries[i].key =
+          AddString(suppression_entries[i].first, &strings);
+      packed_suppression_entries[i].value =
+          AddString(suppression_entries[i].second, &strings);
+    }
+
+    ImageHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = kImageMagic;
+    header.version = kImageVersion;
+    header.source_fingerprint = source_fingerprint;
+    header.pos_fingerprint = pos_fingerprint;
+    header.num_tokens = static_cast<uint32>(packed_tokens.size());
+    header.num_keys = static_cast<uint32>(key_ranges.size());
+    header.num_suppression_entries =
+        static_cast<uint32>(packed_suppression_entries.size());
+    size_t offset = Align4(sizeof(header));
+    header.tokens_offset = static_cast<uint32>(offset);
+    offset += sizeof(PackedToken) * packed_tokens.size();
+    header.token_sources_offset = static_cast<uint32>(offset);
+    offset += sizeof(uint64) * tokens.size();
+    header.key_ranges_offset = static_cast<uint32>(offset);
+    offset += sizeof(PackedKeyRange) * key_ranges.size();
+    header.suppression_entries_offset = static_cast<uint32>(offset);
+    offset += sizeof(PackedSuppressionEntry) *
+        packed_suppression_entries.size();
+    header.trie_offset = static_cast<uint32>(offset);
+    header.trie_size = static_cast<uint32>(trie_image.size());
+    offset = Align4(offset + trie_image.size());
+    header.strings_offset = static_cast<uint32>(offset);
+    header.strings_size = static_cast<uint32>(strings.size());
+
+    image_.clear();
+    image_.reserve(offset + strings.size());
+    AppendPod(header, &image_);
+    image_.resize(header.tokens_offset, '\0');
+    for (size_t i = 0; i < packed_tokens.size(); ++i) {
+      AppendPod(packed_tokens[i], &image_);
+    }
+    for (size_t i = 0; i < tokens.size(); ++i) {
+      AppendPod(tokens[i].source, &image_);
+    }
+    for (size_t i = 0; i < key_ranges.size(); ++i) {
+      AppendPod(key_ranges[i], &image_);
+    }
+    for (size_t i = 0; i < packed_suppression_entries.size(); ++i) {
+      AppendPod(packed_suppression_entries[i], &image_);
+    }
+    image_.append(trie_image);
+    image_.resize(header.strings_offset, '\0');
+    image_.append(strings);
+
+    if (!Init(image_.data(), image_.size())) {
+      LOG(ERROR) << "Failed to initialize the user dictionary index";
+      Clear();
+    }
+  }
+
+  // Validates the image of |size| bytes at |data| and sets up the pointers.
+  // |data| needs to be aligned to 4 bytes.
+  bool Init(const char *data, size_t size) {
+    if (size < sizeof(ImageHeader)) {
+      return false;
+    }
+    const ImageHeader *header = reinterpret_cast<const ImageHeader *>(data);
+    if (header->magic != kImageMagic || header->version != kImageVersion ||
+        !IsValidSection(header->tokens_offset, header->num_tokens,
+                        sizeof(PackedToken), size) ||
+        !IsValidSection(header->token_sources_offset, header->num_tokens,
+                        sizeof(uint64), size) ||
+        !IsValidSection(header->key_ranges_offset, header->num_keys,
+                        sizeof(PackedKeyRange), size) ||
+        !IsValidSection(header->suppression_entries_offset,
+                        header->num_suppression_entries,
+                        sizeof(PackedSuppressionEntry), size) ||
+        !IsValidSection(header->trie_offset, header->trie_size, 1, size) ||
+        !IsValidSection(header->strings_offset, header->strings_size, 1,
+                        size)) {
+      return false;
+    }
+
+    // Check the references so that lookups never read out of the image.
+    const uint32 strings_size = header->strings_size;
+    const PackedToken *tokens =
+        reinterpret_cast<const PackedToken *>(data + header->tokens_offset);
+    for (size_t i = 0; i < header->num_tokens; ++i) {
+      if (!IsValidString(tokens[i].key, strings_size) ||
+          !IsValidString(tokens[i].value, strings_size) ||
+          !IsValidString(tokens[i].comment, strings_size)) {
+        return false;
+      }
+    }
+    const PackedKeyRange *key_ranges = reinterpret_cast<const PackedKeyRange *>(
+        data + header->key_ranges_offset);
+    for (size_t i = 0; i < header->num_keys; ++i) {
+      if (key_ranges[i].begin > key_ranges[i].end ||
+          key_ranges[i].end > header->num_tokens) {
+        return false;
+      }
+    }
+    const PackedSuppressionEntry *suppression_entries =
+        reinterpret_cast<const PackedSuppressionEntry *>(
+            data + header->suppression_entries_offset);
+    for (size_t i = 0; i < header->num_suppression_entries; ++i) {
+      if (!IsValidString(suppression_entries[i].key, strings_size) ||
+          !IsValidString(suppression_entries[i].value, strings_size)) {
+        return false;
+      }
+    }
+    if (header->num_tokens > 0 &&
+        (!IsValidTrieImage(data + header->trie_offset, header->trie_size) ||
+         !trie_.Open(reinterpret_cast<const uint8 *>(
+             data + header->trie_offset)))) {
+      return false;
+    }
+
+    header_ = header;
+    tokens_ = tokens;
+    token_sources_ = data + header->token_sources_offset;
+    key_ranges_ = key_ranges;
+    strings_ = data + header->strings_offset;
+    BuildCommentIndex();
+    return true;
+  }
+
   const UserPOSInterface *user_pos_;
   SuppressionDictionary *suppression_dictionary_;
+
+  // The image is owned by either |image_| or |mmap_|.
+  string image_;
+  std::unique_ptr<Mmap> mmap_;
+
+  const ImageHeader *header_;
+  const PackedToken *tokens_;
+  // Array of uint64, read with memcpy() as it may not be aligned to 8 bytes.
+  const char *token_sources_;
+  const PackedKeyRange *key_ranges_;
+  const char *strings_;
+  LoudsTrie trie_;
+  // Sorted by fingerprint.  Built on Init() as comments are rare, so that
+  // the image format doesn't need to change.
+  std::vector<CommentIndexEntry> comment_index_;
+
+  DISALLOW_COPY_AND_ASSIGN(TokensIndex);
 };
 
 class UserDictionary::UserDictionaryReloader : public Thread {
@@ -265,8 +965,23 @@ class UserDictionary::UserDictionaryReloader : public Thread {
   }
 
   void Run() override {
-    std::unique_ptr<UserDictionaryStorage> storage(new UserDictionaryStorage(
-        Singleton<UserDictionaryFileManager>::get()->GetFileName()));
+    const string filename =
+        Singleton<UserDictionaryFileManager>::get()->GetFileName();
+    const string compiled_filename = GetCompiledFileName(filename);
+
+    // Use the compiled image if the source file is not changed since it was
+    // built.  The fingerprint is taken before loading the file, so the image
+    // is rebuilt next time if the file is modified meanwhile.
+    uint64 source_fingerprint = 0;
+    bool has_fingerprint =
+        GetFileFingerprint(filename, &source_fingerprint);
+    if (has_fingerprint && !auto_register_mode_ &&
+        dic_->OpenCompiledImage(compiled_filename, source_fingerprint)) {
+      return;
+    }
+
+    std::unique_ptr<UserDictionaryStorage> storage(
+        new UserDictionaryStorage(filename));
 
     // Load from file
     if (!storage->Load()) {
@@ -279,6 +994,7 @@ class UserDictionary::UserDictionaryReloader : public Thread {
         storage->Save();
         storage->UnLock();
       }
+      has_fingerprint = false;
     }
 
     if (auto_register_mode_ &&
@@ -287,9 +1003,14 @@ class UserDictionary::UserDictionaryReloader : public Thread {
       auto_register_mode_ = false;
       return;
     }
+    if (auto_register_mode_) {
+      // The file has been rewritten.
+      has_fingerprint = false;
+    }
 
     auto_register_mode_ = false;
-    dic_->Load(*(storage.get()));
+    dic_->Load(*(storage.get()), source_fingerprint,
+               has_fingerprint ? compiled_filename : "");
   }
 
  private:
@@ -304,16 +1025,53 @@ class UserDictionary::UserDictionaryReloader : public Thread {
   DISALLOW_COPY_AND_ASSIGN(UserDictionaryReloader);
 };
 
+// Pins the tokens index of UserDictionary during a lookup.  Readers never
+// block: registration is a pair of atomic operations, retried only when
+// Swap() flips the epoch in between.
+class UserDictionary::ScopedTokensReader {
+ public:
+  explicit ScopedTokensReader(const UserDictionary *dic) : dic_(dic) {
+    while (true) {
+      epoch_ = dic_->epoch_.load() & 1;
+      dic_->readers_[epoch_].fetch_add(1);
+      // If Swap() flipped the epoch before the registration, it may not wait
+      // for this reader.  Register again in the new epoch.
+      if ((dic_->epoch_.load() & 1) == epoch_) {
+        break;
+      }
+      dic_->readers_[epoch_].fetch_sub(1);
+    }
+    tokens_ = dic_->tokens_.load();
+  }
+
+  ~ScopedTokensReader() {
+    dic_->readers_[epoch_].fetch_sub(1);
+  }
+
+  const TokensIndex *tokens() const { return tokens_; }
+
+ private:
+  const UserDictionary *dic_;
+  uint32 epoch_;
+  const TokensIndex *tokens_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedTokensReader);
+};
+
 UserDictionary::UserDictionary(const UserPOSInterface *user_pos,
                                POSMatcher pos_matcher,
                                SuppressionDictionary *suppression_dictionary)
     : ALLOW_THIS_IN_INITIALIZER_LIST(
           reloader_(new UserDictionaryReloader(this))),
       user_pos_(user_pos),
+      pos_fingerprint_(GetUserPOSFingerprint(*user_pos_)),
       pos_matcher_(pos_matcher),
       suppression_dictionary_(suppression_dictionary),
       tokens_(new TokensIndex(user_pos_.get(), suppression_dictionary)),
-      mutex_(new ReaderWriterMutex) {
+      epoch_(0),
+      swap_mutex_(new Mutex) {
+  readers_[0] = 0;
+  readers_[1] = 0;
   DCHECK(user_pos_.get());
   DCHECK(suppression_dictionary_);
   Reload();
@@ -321,7 +1079,12 @@ UserDictionary::UserDictionary(const UserPOSInterface *user_pos,
 
 UserDictionary::~UserDictionary() {
   reloader_->Join();
-  delete tokens_;
+  delete tokens_.load();
+}
+
+size_t UserDictionary::GetHeapMemoryUsage() const {
+  ScopedTokensReader reader(this);
+  return reader.tokens()->GetHeapMemoryUsage();
 }
 
 bool UserDictionary::HasKey(StringPiece key) const {
@@ -343,13 +1106,14 @@ void UserDictionary::LookupPredictive(
     StringPiece key,
     const ConversionRequest &conversion_request,
     Callback *callback) const {
-  scoped_reader_lock l(mutex_.get());
+  ScopedTokensReader reader(this);
+  const TokensIndex *tokens = reader.tokens();
 
   if (key.empty()) {
     VLOG(2) << "string of length zero is passed.";
     return;
   }
-  if (tokens_->empty()) {
+  if (tokens->empty()) {
     return;
   }
   if (conversion_request.config().incognito_mode()) {
@@ -357,12 +1121,12 @@ void UserDictionary::LookupPredictive(
   }
 
   // Find the starting point of iteration over dictionary contents.
-  Token token;
-  for (auto range = std::equal_range(tokens_->begin(), tokens_->end(), key,
-                                     OrderByKeyPrefix());
+  TokenView token;
+  for (auto range = tokens->FindPredictive(key);
        range.first != range.second; ++range.first) {
-    const UserPOS::Token &user_pos_token = **range.first;
-    switch (callback->OnKey(user_pos_token.key)) {
+    const size_t i = range.first;
+    const StringPiece token_key = tokens->key(i);
+    switch (callback->OnKey(token_key)) {
       case Callback::TRAVERSE_DONE:
         return;
       case Callback::TRAVERSE_NEXT_KEY:
@@ -371,12 +1135,12 @@ void UserDictionary::LookupPredictive(
       default:
         break;
     }
-    FillTokenFromUserPOSToken(user_pos_token, &token);
+    tokens->FillToken(i, &token);
     // Override POS IDs for suggest only words.
-    if (pos_matcher_.IsSuggestOnlyWord(user_pos_token.id)) {
+    if (pos_matcher_.IsSuggestOnlyWord(tokens->id(i))) {
       token.lid = token.rid = pos_matcher_.GetUnknownId();
     }
-    if (callback->OnToken(user_pos_token.key, user_pos_token.key, token) ==
+    if (callback->OnTokenView(token_key, token_key, token) ==
         Callback::TRAVERSE_DONE) {
       return;
     }
@@ -388,70 +1152,95 @@ void UserDictionary::LookupPrefix(
     StringPiece key,
     const ConversionRequest &conversion_request,
     Callback *callback) const {
-  scoped_reader_lock l(mutex_.get());
+  ScopedTokensReader reader(this);
+  const TokensIndex *tokens = reader.tokens();
 
   if (key.empty()) {
     LOG(WARNING) << "string of length zero is passed.";
     return;
   }
-  if (tokens_->empty()) {
+  if (tokens->empty()) {
     return;
   }
   if (conversion_request.config().incognito_mode()) {
     return;
   }
+  LookupPrefixImpl(*tokens, key, callback);
+}
 
-  // Find the starting point for iteration over dictionary contents.
-  const StringPiece first_char = key.substr(0, Util::OneCharLen(key.data()));
-  Token token;
-  for (auto it = std::lower_bound(tokens_->begin(), tokens_->end(), first_char,
-                                  OrderByKey());
-       it != tokens_->end(); ++it) {
-    const UserPOS::Token &user_pos_token = **it;
-    if (user_pos_token.key > key) {
-      break;
-    }
-    if (pos_matcher_.IsSuggestOnlyWord(user_pos_token.id)) {
+void UserDictionary::LookupPrefixBatch(
+    StringPiece key,
+    const std::vector<size_t> &begin_positions,
+    const ConversionRequest &conversion_request,
+    BatchCallback *batch_callback) const {
+  // Pin the tokens index once for all the positions.
+  ScopedTokensReader reader(this);
+  const TokensIndex *tokens = reader.tokens();
+  const bool skip_lookup =
+      tokens->empty() || conversion_request.config().incognito_mode();
+  for (size_t i = 0; i < begin_positions.size(); ++i) {
+    const size_t begin_pos = begin_positions[i];
+    Callback *callback = batch_callback->OnBeginPosition(begin_pos);
+    if (callback == nullptr) {
       continue;
     }
-    if (!Util::StartsWith(key, user_pos_token.key)) {
-      continue;
+    if (!skip_lookup && begin_pos < key.size()) {
+      LookupPrefixImpl(*tokens, key.substr(begin_pos), callback);
     }
-    switch (callback->OnKey(user_pos_token.key)) {
-      case Callback::TRAVERSE_DONE:
-        return;
-      case Callback::TRAVERSE_NEXT_KEY:
+    batch_callback->OnEndPosition(begin_pos);
+  }
+}
+
+void UserDictionary::LookupPrefixImpl(const TokensIndex &tokens,
+                                      StringPiece key,
+                                      Callback *callback) const {
+  // Walk the key trie along |key| and visit the tokens of each prefix.
+  TokenView token;
+  tokens.ForEachPrefix(key, [this, &tokens, callback, &token](
+      TokensIndex::Range range) {
+    for (; range.first != range.second; ++range.first) {
+      const size_t i = range.first;
+      if (pos_matcher_.IsSuggestOnlyWord(tokens.id(i))) {
         continue;
-      case Callback::TRAVERSE_CULL:
-        LOG(FATAL) << "UserDictionary doesn't support culling.";
-        break;
-      default:
-        break;
-    }
-    FillTokenFromUserPOSToken(user_pos_token, &token);
-    switch (callback->OnToken(user_pos_token.key, user_pos_token.key, token)) {
-      case Callback::TRAVERSE_DONE:
-        return;
-      case Callback::TRAVERSE_CULL:
-        LOG(FATAL) << "UserDictionary doesn't support culling.";
-        break;
-      default:
-        break;
+      }
+      const StringPiece token_key = tokens.key(i);
+      switch (callback->OnKey(token_key)) {
+        case Callback::TRAVERSE_DONE:
+          return false;
+        case Callback::TRAVERSE_NEXT_KEY:
+          continue;
+        case Callback::TRAVERSE_CULL:
+          LOG(FATAL) << "UserDictionary doesn't support culling.";
+          break;
+        default:
+          break;
+      }
+      tokens.FillToken(i, &token);
+      switch (callback->OnTokenView(token_key, token_key, token)) {
+        case Callback::TRAVERSE_DONE:
+          return false;
+        case Callback::TRAVERSE_CULL:
+          LOG(FATAL) << "UserDictionary doesn't support culling.";
+          break;
+        default:
+          break;
+      }
     }
-  }
+    return true;
+  });
 }
 
 void UserDictionary::LookupExact(
     StringPiece key,
     const ConversionRequest &conversion_request,
     Callback *callback) const {
-  scoped_reader_lock l(mutex_.get());
-  if (key.empty() || tokens_->empty() ||
+  ScopedTokensReader reader(this);
+  const TokensIndex *tokens = reader.tokens();
+  if (key.empty() || tokens->empty() ||
       conversion_request.config().incognito_mode()) {
     return;
   }
-  auto range = std::equal_range(tokens_->begin(), tokens_->end(), key,
-                                OrderByKey());
+  auto range = tokens->FindExact(key);
   if (range.first == range.second) {
     return;
   }
@@ -459,14 +1248,13 @@ void UserDictionary::LookupExact(
     return;
   }
 
-  Token token;
+  TokenView token;
   for (; range.first != range.second; ++range.first) {
-    const UserPOS::Token &user_pos_token = **range.first;
-    if (pos_matcher_.IsSuggestOnlyWord(user_pos_token.id)) {
+    if (pos_matcher_.IsSuggestOnlyWord(tokens->id(range.first))) {
       continue;
     }
-    FillTokenFromUserPOSToken(user_pos_token, &token);
-    if (callback->OnToken(key, key, token) != Callback::TRAVERSE_CONTINUE) {
+    tokens->FillToken(range.first, &token);
+    if (callback->OnTokenView(key, key, token) != Callback::TRAVERSE_CONTINUE) {
       return;
     }
   }
@@ -485,22 +1273,44 @@ bool UserDictionary::LookupComment(StringPiece key, StringPiece value,
     return false;
   }
 
-  scoped_reader_lock l(mutex_.get());
-  if (tokens_->empty()) {
+  ScopedTokensReader reader(this);
+  const TokensIndex *tokens = reader.tokens();
+  StringPiece found;
+  if (!tokens->has_comments() || !tokens->FindComment(key, value, &found)) {
     return false;
   }
+  found.CopyToString(comment);
+  return true;
+}
 
-  // Set the comment that was found first.
-  for (auto range = std::equal_range(tokens_->begin(), tokens_->end(), key,
-                                     OrderByKey());
-       range.first != range.second; ++range.first) {
-    const UserPOS::Token &token = **range.first;
-    if (token.value == value && !token.comment.empty()) {
-      comment->assign(token.comment);
-      return true;
+size_t UserDictionary::LookupComments(
+    const std::vector<std::pair<StringPiece, StringPiece>> &key_values,
+    const ConversionRequest &conversion_request,
+    std::vector<string> *comments) const {
+  comments->resize(key_values.size());
+  if (conversion_request.config().incognito_mode()) {
+    return 0;
+  }
+
+  // Holds the reader once for all the pairs.
+  ScopedTokensReader reader(this);
+  const TokensIndex *tokens = reader.tokens();
+  if (!tokens->has_comments()) {
+    return 0;
+  }
+  size_t num_found = 0;
+  StringPiece found;
+  for (size_t i = 0; i < key_values.size(); ++i) {
+    if (key_values[i].first.empty() || !(*comments)[i].empty()) {
+      continue;
+    }
+    if (tokens->FindComment(key_values[i].first, key_values[i].second,
+                            &found)) {
+      found.CopyToString(&(*comments)[i]);
+      ++num_found;
     }
   }
-  return false;
+  return num_found;
 }
 
 bool UserDictionary::Reload() {
@@ -524,9 +1334,14 @@ class FindValueCallback : public DictionaryInterface::Callback {
   explicit FindValueCallback(StringPiece value)
       : value_(value), found_(false) {}
 
-  virtual ResultType OnToken(StringPiece,  // key
-                             StringPiece,  // actual_key
+  virtual ResultType OnToken(StringPiece key, StringPiece actual_key,
                              const Token &token) {
+    return OnTokenView(key, actual_key, token);
+  }
+
+  virtual ResultType OnTokenView(StringPiece,  // key
+                                 StringPiece,  // actual_key
+                                 const TokenView &token) {
     if (token.value == value_) {
       found_ = true;
       return TRAVERSE_DONE;
@@ -571,21 +1386,29 @@ void UserDictionary::WaitForReloader() {
 
 void UserDictionary::Swap(TokensIndex *new_tokens) {
   DCHECK(new_tokens);
-  TokensIndex *old_tokens = tokens_;
-  {
-    scoped_writer_lock l(mutex_.get());
-    tokens_ = new_tokens;
+  scoped_lock l(swap_mutex_.get());
+  TokensIndex *old_tokens = tokens_.exchange(new_tokens);
+  // Readers registered in the new epoch load |new_tokens|, so only those in
+  // the previous epoch can still see |old_tokens|.
+  const uint32 old_epoch = epoch_.fetch_add(1) & 1;
+  while (readers_[old_epoch].load() != 0) {
+    Util::Sleep(0);
   }
   delete old_tokens;
 }
 
 bool UserDictionary::Load(
     const user_dictionary::UserDictionaryStorage &storage) {
-  size_t size = 0;
-  {
-    scoped_reader_lock l(mutex_.get());
-    size = tokens_->size();
-  }
+  return Load(storage, 0, "");
+}
+
+bool UserDictionary::Load(
+    const user_dictionary::UserDictionaryStorage &storage,
+    uint64 source_fingerprint, const string &compiled_filename) {
+  std::unique_ptr<TokensIndex> tokens(
+      new TokensIndex(user_pos_.get(), suppression_dictionary_));
+  TokensIndex::SourceEntries entries;
+  tokens->Collect(storage, &entries);
 
   // If UserDictionary is pretty big, we first remove the
   // current dictionary to save memory usage.
@@ -595,18 +1418,46 @@ bool UserDictionary::Load(
   const size_t kVeryBigUserDictionarySize = 100000;
 #endif
 
-  if (size >= kVeryBigUserDictionarySize) {
-    TokensIndex *dummy_empty_tokens = new TokensIndex(user_pos_.get(),
-                                                      suppression_dictionary_);
-    Swap(dummy_empty_tokens);
-  }
-
   suppression_dictionary_->Lock();
-  TokensIndex *tokens = new TokensIndex(user_pos_.get(),
-                                        suppression_dictionary_);
-  tokens->Load(storage);  // |suppression_dictionary_| is unlocked in Load().
+  // |suppression_dictionary_| is unlocked in Update() on success or in Load().
+  bool updated = false;
+  size_t size = 0;
+  {
+    // Small edits, e.g. a word added from the dictionary tool, are merged
+    // into the current tokens instead of generating all of them again.  The
+    // current tokens are not pinned for a very big dictionary, though.
+    ScopedTokensReader reader(this);
+    size = reader.tokens()->size();
+    updated = size < kVeryBigUserDictionarySize &&
+        tokens->Update(entries, *reader.tokens(), source_fingerprint,
+                       pos_fingerprint_);
+  }
+  if (!updated) {
+    if (size >= kVeryBigUserDictionarySize) {
+      TokensIndex *dummy_empty_tokens =
+          new TokensIndex(user_pos_.get(), suppression_dictionary_);
+      Swap(dummy_empty_tokens);
+    }
+    tokens->Load(entries, source_fingerprint, pos_fingerprint_);
+  }
   DCHECK(!suppression_dictionary_->IsLocked());
-  Swap(tokens);
+  if (!compiled_filename.empty()) {
+    WriteCompiledImage(tokens->image(), compiled_filename);
+  }
+  Swap(tokens.release());
+  return true;
+}
+
+bool UserDictionary::OpenCompiledImage(const string &compiled_filename,
+                                       uint64 source_fingerprint) {
+  std::unique_ptr<TokensIndex> tokens(
+      new TokensIndex(user_pos_.get(), suppression_dictionary_));
+  // |suppression_dictionary_| is unlocked in Open() on success.
+  if (!tokens->Open(compiled_filename, source_fingerprint,
+                    pos_fingerprint_)) {
+    return false;
+  }
+  Swap(tokens.release());
   return true;
 }
 
@@ -30,6 +30,7 @@
 #ifndef MOZC_DICTIONARY_USER_DICTIONARY_H_
 #define MOZC_DICTIONARY_USER_DICTIONARY_H_
 
+#include <atomic>
 #include <memory>
 #include <string>
 #include <vector>
@@ -44,7 +45,7 @@
 
 namespace mozc {
 
-class ReaderWriterMutex;
+class Mutex;
 
 namespace dictionary {
 
@@ -69,6 +70,10 @@ class UserDictionary : public DictionaryInterface {
   void LookupExact(StringPiece key,
                    const ConversionRequest &conversion_request,
                    Callback *callback) const override;
+  void LookupPrefixBatch(StringPiece key,
+                         const std::vector<size_t> &begin_positions,
+                         const ConversionRequest &conversion_request,
+                         BatchCallback *batch_callback) const override;
   void LookupReverse(StringPiece str,
                      const ConversionRequest &conversion_request,
                      Callback *callback) const override;
@@ -79,6 +84,10 @@ class UserDictionary : public DictionaryInterface {
   bool LookupComment(StringPiece key, StringPiece value,
                      const ConversionRequest &conversion_request,
                      string *comment) const override;
+  size_t LookupComments(
+      const std::vector<std::pair<StringPiece, StringPiece>> &key_values,
+      const ConversionRequest &conversion_request,
+      std::vector<string> *comments) const override;
 
   // Loads dictionary from UserDictionaryStorage.
   // mainly for unittesting
@@ -101,22 +110,54 @@ class UserDictionary : public DictionaryInterface {
       const ConversionRequest &conversion_request,
       user_dictionary::UserDictionary::PosType pos);
 
+  // Returns the estimated size of the memory allocated in heap for the
+  // current tokens, in bytes.  A compiled image mapped from the file is not
+  // included.
+  size_t GetHeapMemoryUsage() const;
+
   // Sets user dicitonary filename for unittesting
   static void SetUserDictionaryName(const string &filename);
 
  private:
   class TokensIndex;
   class UserDictionaryReloader;
+  class ScopedTokensReader;
+
+  // Looks up the prefixes of non-empty |key| in |tokens|.
+  void LookupPrefixImpl(const TokensIndex &tokens, StringPiece key,
+                        Callback *callback) const;
 
-  // Swaps internal tokens index to |new_tokens|.
+  // Swaps internal tokens index to |new_tokens|.  Waits for the readers that
+  // may still see the old index before deleting it.
   void Swap(TokensIndex *new_tokens);
 
+  // Loads |storage| and, if |compiled_filename| is not empty, saves the
+  // compiled image of it to |compiled_filename|, keyed by
+  // |source_fingerprint|.
+  bool Load(const user_dictionary::UserDictionaryStorage &storage,
+            uint64 source_fingerprint, const string &compiled_filename);
+
+  // Loads the compiled image saved by Load() if it was built from the source
+  // of |source_fingerprint| with the current POS data.
+  bool OpenCompiledImage(const string &compiled_filename,
+                         uint64 source_fingerprint);
+
   std::unique_ptr<UserDictionaryReloader> reloader_;
   std::unique_ptr<const UserPOSInterface> user_pos_;
+  // Fingerprint of the tokens generated by |user_pos_|, which invalidates
+  // the compiled images built with other POS data.
+  const uint64 pos_fingerprint_;
   const POSMatcher pos_matcher_;
   SuppressionDictionary *suppression_dictionary_;
-  TokensIndex *tokens_;
-  mutable std::unique_ptr<ReaderWriterMutex> mutex_;
+  // |tokens_| is handed over to readers without a lock.  A reader registers
+  // itself in |readers_| of the current |epoch_| before loading |tokens_|,
+  // and Swap() flips the epoch and waits for the readers registered in the
+  // previous one.  See ScopedTokensReader.
+  std::atomic<TokensIndex *> tokens_;
+  mutable std::atomic<uint32> epoch_;
+  mutable std::atomic<int32> readers_[2];
+  // Serializes Swap().
+  std::unique_ptr<Mutex> swap_mutex_;
 
   friend class UserDictionaryTest;
   DISALLOW_COPY_AND_ASSIGN(UserDictionary);
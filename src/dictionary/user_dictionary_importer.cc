@@ -35,11 +35,12 @@
 
 #include <algorithm>
 #include <map>
-#include <set>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
 #include "base/compiler_specific.h"
+#include "base/file_stream.h"
 #include "base/hash.h"
 #include "base/logging.h"
 #include "base/mmap.h"
@@ -65,11 +66,37 @@ MOZC_CLANG_DISABLE_WARNING(tautological-constant-out-of-range-compare);
 #endif  // MOZC_CLANG_HAS_WARNING(tautological-constant-out-of-range-compare)
   DCHECK_LE(entry.pos(), 255);
 MOZC_CLANG_POP_WARNING();
-  return Hash::Fingerprint(entry.key() + "\t" +
-                           entry.value() + "\t" +
-                           static_cast<char>(entry.pos()));
+  Hash::Fingerprinter fp;
+  fp.Append(entry.key());
+  fp.Append('\t');
+  fp.Append(entry.value());
+  fp.Append('\t');
+  fp.Append(static_cast<char>(entry.pos()));
+  return fp.Fingerprint();
 }
 
+// Splits |line| by tabs into at most |max_fields| fields in |fields|, allowing
+// empty fields.  Returns the number of the fields, which may be larger than
+// |max_fields| when the rest are ignored.
+size_t SplitTabSeparatedFields(StringPiece line, StringPiece *fields,
+                               size_t max_fields) {
+  size_t num_fields = 0;
+  while (true) {
+    const StringPiece::size_type tab = line.find('\t');
+    if (num_fields < max_fields) {
+      fields[num_fields] = line.substr(0, tab);
+    }
+    ++num_fields;
+    if (tab == StringPiece::npos) {
+      return num_fields;
+    }
+    line.remove_prefix(tab + 1);
+  }
+}
+
+// The size of the chunks read by FileTextLineIterator.
+const size_t kFileChunkSize = 64 * 1024;
+
 void NormalizePOS(const string &input, string *output) {
   string tmp;
   output->clear();
@@ -180,7 +207,8 @@ UserDictionaryImporter::ErrorType UserDictionaryImporter::ImportFromIterator(
 
   ErrorType ret = IMPORT_NO_ERROR;
 
-  std::set<uint64> existent_entries;
+  std::unordered_set<uint64> existent_entries;
+  existent_entries.reserve(user_dic->entries_size());
   for (size_t i = 0; i < user_dic->entries_size(); ++i) {
     existent_entries.insert(EntryFingerprint(user_dic->entries(i)));
   }
@@ -212,9 +240,11 @@ UserDictionaryImporter::ErrorType UserDictionaryImporter::ImportFromIterator(
       continue;
     }
 
+    // |entry| is cleared by ConvertEntry() for the next one, so just move
+    // it into the dictionary.
     UserDictionary::Entry *new_entry = user_dic->add_entries();
     DCHECK(new_entry);
-    new_entry->CopyFrom(entry);
+    new_entry->Swap(&entry);
   }
 
   return ret;
@@ -248,16 +278,15 @@ bool UserDictionaryImporter::StringTextLineIterator::Next(string *line) {
   }
 
   const StringPiece crlf("\r\n");
-  for (size_t i = position_; i < data_.length(); ++i) {
-    if (data_[i] == '\n' || data_[i] == '\r') {
-      const StringPiece next_line =
-          ClippedSubstr(data_, position_, i - position_);
-      line->assign(next_line.data(), next_line.size());
-      // Handles CR/LF issue.
-      const StringPiece possible_crlf = ClippedSubstr(data_, i, 2);
-      position_ = possible_crlf.compare(crlf) == 0 ? (i + 2) : (i + 1);
-      return true;
-    }
+  const StringPiece::size_type i = data_.find_first_of(crlf, position_);
+  if (i != StringPiece::npos) {
+    const StringPiece next_line =
+        ClippedSubstr(data_, position_, i - position_);
+    line->assign(next_line.data(), next_line.size());
+    // Handles CR/LF issue.
+    const StringPiece possible_crlf = ClippedSubstr(data_, i, 2);
+    position_ = possible_crlf.compare(crlf) == 0 ? (i + 2) : (i + 1);
+    return true;
   }
 
   const StringPiece next_line =
@@ -271,6 +300,85 @@ void UserDictionaryImporter::StringTextLineIterator::Reset() {
   position_ = 0;
 }
 
+UserDictionaryImporter::FileTextLineIterator::FileTextLineIterator(
+    const string &filename)
+    : ifs_(new InputFileStream(filename.c_str(), std::ios::binary)),
+      buffer_position_(0), position_(0), size_(0) {
+  if (!*ifs_) {
+    LOG(ERROR) << "Cannot open " << filename;
+    return;
+  }
+  ifs_->seekg(0, std::ios::end);
+  size_ = static_cast<size_t>(ifs_->tellg());
+  ifs_->seekg(0, std::ios::beg);
+}
+
+UserDictionaryImporter::FileTextLineIterator::~FileTextLineIterator() {}
+
+bool UserDictionaryImporter::FileTextLineIterator::IsAvailable() const {
+  return position_ < size_;
+}
+
+bool UserDictionaryImporter::FileTextLineIterator::FillBuffer() {
+  buffer_.resize(kFileChunkSize);
+  ifs_->read(&buffer_[0], kFileChunkSize);
+  buffer_.resize(static_cast<size_t>(ifs_->gcount()));
+  buffer_position_ = 0;
+  return !buffer_.empty();
+}
+
+bool UserDictionaryImporter::FileTextLineIterator::Next(string *line) {
+  if (!IsAvailable()) {
+    return false;
+  }
+
+  line->clear();
+  while (true) {
+    if (buffer_position_ == buffer_.size() && !FillBuffer()) {
+      // The file is shorter than expected, e.g., truncated while reading.
+      position_ = size_;
+      return true;
+    }
+    const string::size_type i = buffer_.find_first_of("\r\n",
+                                                      buffer_position_);
+    if (i == string::npos) {
+      // The line continues to the next chunk.
+      line->append(buffer_, buffer_position_, string::npos);
+      position_ += buffer_.size() - buffer_position_;
+      buffer_position_ = buffer_.size();
+      if (position_ >= size_) {
+        return true;
+      }
+      continue;
+    }
+    line->append(buffer_, buffer_position_, i - buffer_position_);
+    position_ += i + 1 - buffer_position_;
+    buffer_position_ = i + 1;
+    // Handles CR/LF issue.  LF of CR/LF can be in the next chunk.
+    if (buffer_[i] == '\r' && position_ < size_) {
+      if (buffer_position_ == buffer_.size()) {
+        FillBuffer();
+      }
+      if (buffer_position_ < buffer_.size() &&
+          buffer_[buffer_position_] == '\n') {
+        ++buffer_position_;
+        ++position_;
+      }
+    }
+    return true;
+  }
+}
+
+void UserDictionaryImporter::FileTextLineIterator::Reset() {
+  if (size_ > 0) {
+    ifs_->clear();
+    ifs_->seekg(0, std::ios::beg);
+  }
+  buffer_.clear();
+  buffer_position_ = 0;
+  position_ = 0;
+}
+
 UserDictionaryImporter::TextInputIterator::TextInputIterator(
     IMEType ime_type,
     TextLineIteratorInterface *iter)
@@ -315,7 +423,7 @@ bool UserDictionaryImporter::TextInputIterator::Next(RawEntry *entry) {
 
   entry->Clear();
 
-  string line;
+  string &line = line_;
   while (iter_->Next(&line)) {
     Util::ChopReturns(&line);
     // Skip empty lines.
@@ -333,19 +441,22 @@ bool UserDictionaryImporter::TextInputIterator::Next(RawEntry *entry) {
     VLOG(2) << line;
 
     std::vector<string> values;
+    StringPiece fields[4];
+    size_t num_fields = 0;
     switch (ime_type_) {
       case MSIME:
       case ATOK:
       case MOZC:
-        Util::SplitStringAllowEmpty(line, "\t", &values);
-        if (values.size() < 3) {
+        // Split in place as this is called for every line of large files.
+        num_fields = SplitTabSeparatedFields(line, fields, arraysize(fields));
+        if (num_fields < 3) {
           continue;  // Ignore this line.
         }
-        entry->key = values[0];
-        entry->value = values[1];
-        entry->pos = values[2];
-        if (values.size() >= 4) {
-          entry->comment = values[3];
+        fields[0].CopyToString(&entry->key);
+        fields[1].CopyToString(&entry->value);
+        fields[2].CopyToString(&entry->pos);
+        if (num_fields >= 4) {
+          fields[3].CopyToString(&entry->comment);
         }
         return true;
         break;
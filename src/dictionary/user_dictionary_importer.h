@@ -30,6 +30,7 @@
 #ifndef MOZC_DICTIONARY_USER_DICTIONARY_IMPORTER_H_
 #define MOZC_DICTIONARY_USER_DICTIONARY_IMPORTER_H_
 
+#include <memory>
 #include <string>
 
 #include "base/port.h"
@@ -38,6 +39,8 @@
 
 namespace mozc {
 
+class InputFileStream;
+
 // An utilitiy class for importing user dictionary from different devices,
 // including text files and MS-IME, Kotoeri, and ATOK(optional) user
 // dictionaries.
@@ -120,6 +123,36 @@ class UserDictionaryImporter {
     DISALLOW_COPY_AND_ASSIGN(StringTextLineIterator);
   };
 
+  // A reader of a UTF-8 text file.  The file is read in fixed size chunks, so
+  // that a large dictionary is imported without loading the whole file into
+  // memory.  This class resolves CR/LF issue in the same way as
+  // StringTextLineIterator.
+  class FileTextLineIterator : public TextLineIteratorInterface {
+   public:
+    explicit FileTextLineIterator(const string &filename);
+    virtual ~FileTextLineIterator();
+
+    virtual bool IsAvailable() const;
+    virtual bool Next(string *line);
+    virtual void Reset();
+
+    // The size of the file and the number of bytes consumed so far, e.g., for
+    // progress reports.
+    size_t size() const { return size_; }
+    size_t position() const { return position_; }
+
+   private:
+    // Reads the next chunk into |buffer_|.  Returns false at the end of file.
+    bool FillBuffer();
+
+    std::unique_ptr<InputFileStream> ifs_;
+    string buffer_;
+    size_t buffer_position_;
+    size_t position_;
+    size_t size_;
+    DISALLOW_COPY_AND_ASSIGN(FileTextLineIterator);
+  };
+
   // List of IMEs.
   enum IMEType {
     IME_AUTO_DETECT = 0,
@@ -168,6 +201,8 @@ class UserDictionaryImporter {
     IMEType ime_type_;
     TextLineIteratorInterface *iter_;
     string first_line_;
+    // Buffer reused for every line.
+    string line_;
 
     DISALLOW_COPY_AND_ASSIGN(TextInputIterator);
   };
@@ -32,6 +32,8 @@
 #include <string>
 #include <vector>
 
+#include "base/file_stream.h"
+#include "base/file_util.h"
 #include "base/util.h"
 #include "dictionary/user_dictionary_importer.h"
 #include "dictionary/user_dictionary_util.h"
@@ -666,4 +668,78 @@ TEST(UserDictionaryImporter, StringTextLineIterator) {
   }
 }
 
+TEST(UserDictionaryImporter, FileTextLineIterator) {
+  const string filename =
+      FileUtil::JoinPath(FLAGS_test_tmpdir, "file_text_line_iterator.txt");
+
+  // Lines of various lengths terminated by LF, CR and CRLF, so that the line
+  // breaks, including CRLF, straddle the chunks.
+  string data;
+  for (int i = 0; i < 30000; ++i) {
+    data.append(string(i % 37, 'a' + i % 26));
+    const char *kNewLines[] = {"\n", "\r", "\r\n", "\r\n\r\n"};
+    data.append(kNewLines[i % arraysize(kNewLines)]);
+  }
+  data.append("last");
+
+  {
+    OutputFileStream ofs(filename.c_str(), std::ios::binary);
+    ofs << data;
+  }
+
+  // The lines are the same as StringTextLineIterator.
+  UserDictionaryImporter::FileTextLineIterator iter(filename);
+  EXPECT_EQ(data.size(), iter.size());
+  for (int trial = 0; trial < 2; ++trial) {
+    UserDictionaryImporter::StringTextLineIterator expected_iter(data);
+    string expected, actual;
+    while (expected_iter.IsAvailable()) {
+      ASSERT_TRUE(expected_iter.Next(&expected));
+      ASSERT_TRUE(iter.IsAvailable());
+      ASSERT_TRUE(iter.Next(&actual));
+      ASSERT_EQ(expected, actual);
+    }
+    EXPECT_EQ("last", actual);
+    EXPECT_FALSE(iter.IsAvailable());
+    EXPECT_FALSE(iter.Next(&actual));
+    EXPECT_EQ(data.size(), iter.position());
+    iter.Reset();
+    EXPECT_EQ(0, iter.position());
+  }
+
+  FileUtil::Unlink(filename);
+}
+
+TEST(UserDictionaryImporter, ImportFromFileTest) {
+  const string filename =
+      FileUtil::JoinPath(FLAGS_test_tmpdir, "import_from_file.txt");
+  {
+    OutputFileStream ofs(filename.c_str(), std::ios::binary);
+    ofs << "!Microsoft IME Dictionary Tool\r\n"
+        << "きょうと\t京都\t名詞\r\n"
+        << "!コメント\r\n"
+        << "おおさか\t大阪\t地名\r\n"
+        << "きょうと\t京都\t名詞\r\n"
+        << "とうきょう\t東京\t地名\tコメント\textra\r\n";
+  }
+
+  UserDictionaryImporter::FileTextLineIterator iter(filename);
+  UserDictionaryStorage::UserDictionary user_dic;
+  EXPECT_EQ(UserDictionaryImporter::IMPORT_NO_ERROR,
+            UserDictionaryImporter::ImportFromTextLineIterator(
+                UserDictionaryImporter::MSIME, &iter, &user_dic));
+
+  // The duplicated entry is skipped.
+  ASSERT_EQ(3, user_dic.entries_size());
+  EXPECT_EQ("きょうと", user_dic.entries(0).key());
+  EXPECT_EQ("京都", user_dic.entries(0).value());
+  EXPECT_EQ("おおさか", user_dic.entries(1).key());
+  EXPECT_EQ("大阪", user_dic.entries(1).value());
+  EXPECT_EQ("とうきょう", user_dic.entries(2).key());
+  EXPECT_EQ("東京", user_dic.entries(2).value());
+  EXPECT_EQ("コメント", user_dic.entries(2).comment());
+
+  FileUtil::Unlink(filename);
+}
+
 }  // namespace mozc
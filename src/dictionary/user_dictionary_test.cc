@@ -30,17 +30,24 @@
 #include "dictionary/user_dictionary.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cstring>
+#include <map>
 #include <memory>
 #include <random>
 #include <sstream>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "base/file_stream.h"
 #include "base/file_util.h"
+#include "base/hash.h"
 #include "base/logging.h"
+#include "base/mmap.h"
 #include "base/port.h"
 #include "base/singleton.h"
+#include "base/thread.h"
 #include "base/util.h"
 #include "config/config_handler.h"
 #include "data_manager/testing/mock_data_manager.h"
@@ -188,6 +195,10 @@ string GenRandomAlphabet(int size) {
   return result;
 }
 
+}  // namespace
+
+// Defined outside of the anonymous namespace to be a friend of
+// UserDictionary.
 class UserDictionaryTest : public ::testing::Test {
  protected:
   UserDictionaryTest() {
@@ -257,6 +268,36 @@ class UserDictionaryTest : public ::testing::Test {
     std::vector<Entry> entries_;
   };
 
+  // Collects entries for each begin position except for |skipped_pos|.
+  class BatchEntryCollector : public DictionaryInterface::BatchCallback {
+   public:
+    explicit BatchEntryCollector(size_t skipped_pos)
+        : skipped_pos_(skipped_pos) {}
+
+    virtual DictionaryInterface::Callback *OnBeginPosition(size_t begin_pos) {
+      if (begin_pos == skipped_pos_) {
+        return nullptr;
+      }
+      return &collectors_[begin_pos];
+    }
+
+    virtual void OnEndPosition(size_t begin_pos) {
+      end_positions_.push_back(begin_pos);
+    }
+
+    const std::vector<Entry> &entries(size_t begin_pos) {
+      return collectors_[begin_pos].entries();
+    }
+    const std::vector<size_t> &end_positions() const {
+      return end_positions_;
+    }
+
+   private:
+    const size_t skipped_pos_;
+    std::map<size_t, EntryCollector> collectors_;
+    std::vector<size_t> end_positions_;
+  };
+
   void TestLookupPredictiveHelper(const Entry *expected,
                                   size_t expected_size,
                                   StringPiece key,
@@ -363,6 +404,11 @@ class UserDictionaryTest : public ::testing::Test {
     }
   }
 
+  static bool OpenCompiledImage(UserDictionary *dic, const string &filename,
+                                uint64 source_fingerprint) {
+    return dic->OpenCompiledImage(filename, source_fingerprint);
+  }
+
   // Helper function to lookup comment string from |dic|.
   string LookupComment(const UserDictionary& dic,
                        StringPiece key, StringPiece value) {
@@ -381,6 +427,8 @@ class UserDictionaryTest : public ::testing::Test {
   mozc::usage_stats::scoped_usage_stats_enabler usage_stats_enabler_;
 };
 
+namespace {
+
 TEST_F(UserDictionaryTest, TestLookupPredictive) {
   unique_ptr<UserDictionary> dic(CreateDictionaryWithMockPos());
   // Wait for async reload called from the constructor.
@@ -496,6 +544,38 @@ TEST_F(UserDictionaryTest, TestLookupPrefix) {
   TestLookupPrefixHelper(nullptr, 0, "starting", 8, *dic);
 }
 
+TEST_F(UserDictionaryTest, TestLookupPrefixBatch) {
+  unique_ptr<UserDictionary> dic(CreateDictionaryWithMockPos());
+  // Wait for async reload called from the constructor.
+  dic->WaitForReloader();
+
+  {
+    UserDictionaryStorage storage("");
+    LoadFromString(kUserDictionary0, &storage);
+    dic->Load(storage);
+  }
+
+  // "smilestarted" has "smile" at 0 and "star", "start" and "started" at 5.
+  const std::vector<size_t> begin_positions = {0, 1, 5, 6};
+  BatchEntryCollector collector(1);
+  dic->LookupPrefixBatch("smilestarted", begin_positions, convreq_,
+                         &collector);
+  const std::vector<size_t> kExpectedEndPositions = {0, 5, 6};
+  EXPECT_EQ(kExpectedEndPositions, collector.end_positions());
+
+  const Entry kExpected0[] = {
+    { "smile", "smile", 200, 200 },
+  };
+  CompareEntries(kExpected0, arraysize(kExpected0), collector.entries(0));
+  const Entry kExpected5[] = {
+    { "star", "star", 100, 100 },
+    { "start", "start", 200, 200 },
+    { "started", "started", 210, 210 },
+  };
+  CompareEntries(kExpected5, arraysize(kExpected5), collector.entries(5));
+  EXPECT_TRUE(collector.entries(6).empty());
+}
+
 TEST_F(UserDictionaryTest, TestLookupExact) {
   unique_ptr<UserDictionary> dic(CreateDictionaryWithMockPos());
   // Wait for async reload called from the constructor.
@@ -527,6 +607,49 @@ TEST_F(UserDictionaryTest, TestLookupExact) {
   TestLookupPrefixHelper(nullptr, 0, "水雲", strlen("水雲"), *dic);
 }
 
+TEST_F(UserDictionaryTest, TestLookupPrefixWithManyEntries) {
+  unique_ptr<UserDictionary> dic(CreateDictionaryWithMockPos());
+  // Wait for async reload called from the constructor.
+  dic->WaitForReloader();
+
+  std::vector<string> keys;
+  {
+    UserDictionaryStorage storage("");
+    UserDictionaryStorage::UserDictionary *dic_proto =
+        storage.add_dictionaries();
+    for (int i = 0; i < 1000; ++i) {
+      keys.push_back(GenRandomAlphabet(5));
+      UserDictionaryStorage::UserDictionaryEntry *entry =
+          dic_proto->add_entries();
+      entry->set_key(keys.back());
+      entry->set_value(keys.back());
+      entry->set_pos(user_dictionary::UserDictionary::NOUN);
+    }
+    dic->Load(storage);
+  }
+
+  // Compare with the linear scan over all the keys.
+  for (size_t i = 0; i < 100; ++i) {
+    const string query = keys[i] + GenRandomAlphabet(3);
+    std::vector<Entry> expected;
+    std::vector<string> matched_keys;
+    for (size_t j = 0; j < keys.size(); ++j) {
+      if (Util::StartsWith(query, keys[j])) {
+        matched_keys.push_back(keys[j]);
+      }
+    }
+    std::sort(matched_keys.begin(), matched_keys.end());
+    matched_keys.erase(std::unique(matched_keys.begin(), matched_keys.end()),
+                       matched_keys.end());
+    for (size_t j = 0; j < matched_keys.size(); ++j) {
+      const Entry entry = {matched_keys[j], matched_keys[j], 100, 100};
+      expected.push_back(entry);
+    }
+    TestLookupPrefixHelper(&expected[0], expected.size(),
+                           query.data(), query.size(), *dic);
+  }
+}
+
 TEST_F(UserDictionaryTest, TestLookupExactWithSuggestionOnlyWords) {
   unique_ptr<UserDictionary> user_dic(CreateDictionary());
   user_dic->WaitForReloader();
@@ -647,6 +770,70 @@ TEST_F(UserDictionaryTest, AsyncLoadTest) {
   FileUtil::Unlink(filename);
 }
 
+// Repeats LookupPrefix() for "started" until stopped, counting the lookups
+// that saw neither kUserDictionary0 nor kUserDictionary1 as a whole.
+class PrefixLookupThread : public Thread {
+ public:
+  PrefixLookupThread(const UserDictionary *dic,
+                     const ConversionRequest *convreq)
+      : dic_(dic), convreq_(convreq), stop_(false), num_lookups_(0),
+        num_inconsistent_results_(0) {}
+
+  void Run() override {
+    while (!stop_.load()) {
+      CollectTokenCallback callback;
+      dic_->LookupPrefix("started", *convreq_, &callback);
+      const size_t size = callback.tokens().size();
+      // 3 for kUserDictionary0 and 0 for kUserDictionary1.
+      if (size != 3 && size != 0) {
+        ++num_inconsistent_results_;
+      }
+      ++num_lookups_;
+    }
+  }
+
+  void Stop() { stop_ = true; }
+  int num_lookups() const { return num_lookups_; }
+  int num_inconsistent_results() const { return num_inconsistent_results_; }
+
+ private:
+  const UserDictionary *dic_;
+  const ConversionRequest *convreq_;
+  std::atomic<bool> stop_;
+  int num_lookups_;
+  int num_inconsistent_results_;
+};
+
+TEST_F(UserDictionaryTest, LookupWhileLoading) {
+  unique_ptr<UserDictionary> dic(CreateDictionaryWithMockPos());
+  // Wait for async reload called from the constructor.
+  dic->WaitForReloader();
+
+  UserDictionaryStorage storage0("");
+  LoadFromString(kUserDictionary0, &storage0);
+  UserDictionaryStorage storage1("");
+  LoadFromString(kUserDictionary1, &storage1);
+
+  PrefixLookupThread thread0(dic.get(), &convreq_);
+  PrefixLookupThread thread1(dic.get(), &convreq_);
+  thread0.SetJoinable(true);
+  thread1.SetJoinable(true);
+  thread0.Start("PrefixLookupThread");
+  thread1.Start("PrefixLookupThread");
+  for (int i = 0; i < 200; ++i) {
+    dic->Load(i % 2 == 0 ? storage0 : storage1);
+  }
+  thread0.Stop();
+  thread1.Stop();
+  thread0.Join();
+  thread1.Join();
+
+  EXPECT_EQ(0, thread0.num_inconsistent_results());
+  EXPECT_EQ(0, thread1.num_inconsistent_results());
+  EXPECT_LT(0, thread0.num_lookups());
+  EXPECT_LT(0, thread1.num_lookups());
+}
+
 TEST_F(UserDictionaryTest, AddToAutoRegisteredDictionary) {
   const string filename = FileUtil::JoinPath(FLAGS_test_tmpdir,
                                              "add_to_auto_registered.db");
@@ -731,6 +918,153 @@ TEST_F(UserDictionaryTest, AddToAutoRegisteredDictionary) {
   }
 }
 
+TEST_F(UserDictionaryTest, CompiledImage) {
+  const string filename = FileUtil::JoinPath(FLAGS_test_tmpdir,
+                                             "compiled_image_test.db");
+  const string compiled_filename = filename + ".compiled";
+  FileUtil::Unlink(filename);
+  FileUtil::Unlink(compiled_filename);
+  {
+    UserDictionaryStorage storage(filename);
+    EXPECT_TRUE(storage.Lock());
+    uint64 id = 0;
+    EXPECT_TRUE(storage.CreateDictionary("test", &id));
+    UserDictionaryStorage::UserDictionary *dic =
+        storage.mutable_dictionaries(0);
+    UserDictionaryStorage::UserDictionaryEntry *entry = dic->add_entries();
+    entry->set_key("start");
+    entry->set_value("start");
+    entry->set_pos(user_dictionary::UserDictionary::WA_GROUP1_VERB);
+    entry->set_comment("comment");
+    entry = dic->add_entries();
+    entry->set_key("suppress_key");
+    entry->set_value("suppress_value");
+    entry->set_pos(user_dictionary::UserDictionary::SUPPRESSION_WORD);
+    EXPECT_TRUE(storage.Save());
+    EXPECT_TRUE(storage.UnLock());
+  }
+  uint64 fingerprint = 0;
+  {
+    Mmap mmap;
+    ASSERT_TRUE(mmap.Open(filename.c_str(), "r"));
+    fingerprint = Hash::Fingerprint(StringPiece(mmap.begin(), mmap.size()));
+  }
+
+  UserDictionary::SetUserDictionaryName(filename);
+  {
+    // The reloader started from the constructor compiles the source.
+    unique_ptr<UserDictionary> dic(CreateDictionaryWithMockPos());
+    dic->WaitForReloader();
+    EXPECT_TRUE(FileUtil::FileExists(compiled_filename));
+  }
+
+  suppression_dictionary_->Lock();
+  suppression_dictionary_->Clear();
+  unique_ptr<UserDictionary> dic(CreateDictionaryWithMockPos());
+  dic->WaitForReloader();
+
+  // The compiled image is rejected for other sources.
+  suppression_dictionary_->Lock();
+  EXPECT_FALSE(OpenCompiledImage(dic.get(), compiled_filename,
+                                 fingerprint + 1));
+  EXPECT_TRUE(suppression_dictionary_->IsLocked());
+  EXPECT_TRUE(OpenCompiledImage(dic.get(), compiled_filename, fingerprint));
+  EXPECT_FALSE(suppression_dictionary_->IsLocked());
+
+  const Entry kExpected[] = {
+    { "start", "start", 200, 200 },
+    { "started", "started", 210, 210 },
+  };
+  TestLookupPrefixHelper(kExpected, arraysize(kExpected), "started", 7, *dic);
+  EXPECT_EQ("comment", LookupComment(*dic, "start", "start"));
+  EXPECT_TRUE(suppression_dictionary_->SuppressEntry("suppress_key",
+                                                     "suppress_value"));
+
+  // Broken images are rejected.  Unlink the file first as |dic| maps it.
+  FileUtil::Unlink(compiled_filename);
+  {
+    OutputFileStream ofs(compiled_filename.c_str(),
+                         std::ios::binary | std::ios::out);
+    ofs << "broken image";
+  }
+  suppression_dictionary_->Lock();
+  EXPECT_FALSE(OpenCompiledImage(dic.get(), compiled_filename, fingerprint));
+  suppression_dictionary_->UnLock();
+  TestLookupPrefixHelper(kExpected, arraysize(kExpected), "started", 7, *dic);
+
+  UserDictionary::SetUserDictionaryName("");
+  FileUtil::Unlink(filename);
+  FileUtil::Unlink(compiled_filename);
+}
+
+TEST_F(UserDictionaryTest, LoadSmallEdits) {
+  unique_ptr<UserDictionary> dic(CreateDictionaryWithMockPos());
+  // Wait for async reload called from the constructor.
+  dic->WaitForReloader();
+
+  UserDictionaryStorage storage("");
+  LoadFromString(kUserDictionary0, &storage);
+  dic->Load(storage);
+
+  // Add a word and a suppression word.
+  UserDictionaryStorage::UserDictionary *user_dic =
+      storage.mutable_dictionaries(0);
+  UserDictionaryStorage::UserDictionaryEntry *entry = user_dic->add_entries();
+  entry->set_key("stable");
+  entry->set_value("stable");
+  entry->set_pos(user_dictionary::UserDictionary::NOUN);
+  entry->set_comment("added");
+  entry = user_dic->add_entries();
+  entry->set_key("suppress_key");
+  entry->set_value("suppress_value");
+  entry->set_pos(user_dictionary::UserDictionary::SUPPRESSION_WORD);
+  suppression_dictionary_->Lock();
+  dic->Load(storage);
+  EXPECT_FALSE(suppression_dictionary_->IsLocked());
+
+  const Entry kExpected[] = {
+    { "stable", "stable", 100, 100 },
+  };
+  TestLookupPredictiveHelper(kExpected, arraysize(kExpected), "stab", *dic);
+  const Entry kExpectedStamp[] = {
+    { "stamp", "stamp", 100, 100 },
+  };
+  TestLookupPredictiveHelper(kExpectedStamp, arraysize(kExpectedStamp),
+                             "stam", *dic);
+  EXPECT_EQ("added", LookupComment(*dic, "stable", "stable"));
+  EXPECT_EQ("comment", LookupComment(*dic, "comment_key2", "comment_value2"));
+  EXPECT_TRUE(suppression_dictionary_->SuppressEntry("suppress_key",
+                                                     "suppress_value"));
+
+  // Remove "stamp" and the suppression word.
+  ASSERT_EQ("stamp", user_dic->entries(3).key());
+  user_dic->mutable_entries()->DeleteSubrange(3, 1);
+  user_dic->mutable_entries()->RemoveLast();
+  suppression_dictionary_->Lock();
+  dic->Load(storage);
+  EXPECT_FALSE(suppression_dictionary_->IsLocked());
+
+  TestLookupPredictiveHelper(kExpected, arraysize(kExpected), "stab", *dic);
+  TestLookupPredictiveHelper(nullptr, 0, "stam", *dic);
+  EXPECT_EQ("added", LookupComment(*dic, "stable", "stable"));
+  EXPECT_FALSE(suppression_dictionary_->SuppressEntry("suppress_key",
+                                                      "suppress_value"));
+
+  // The results are the same as those of the dictionary built from scratch.
+  unique_ptr<UserDictionary> expected_dic(CreateDictionaryWithMockPos());
+  expected_dic->WaitForReloader();
+  expected_dic->Load(storage);
+  const char *kKeys[] = {"s", "c"};
+  for (size_t i = 0; i < arraysize(kKeys); ++i) {
+    EntryCollector expected, actual;
+    expected_dic->LookupPredictive(kKeys[i], convreq_, &expected);
+    dic->LookupPredictive(kKeys[i], convreq_, &actual);
+    ASSERT_FALSE(expected.entries().empty());
+    CompareEntries(&expected.entries()[0], expected.entries().size(),
+                   actual.entries());
+  }
+}
+
 TEST_F(UserDictionaryTest, TestSuppressionDictionary) {
   unique_ptr<UserDictionary> user_dic(CreateDictionaryWithMockPos());
   user_dic->WaitForReloader();
@@ -965,6 +1299,53 @@ TEST_F(UserDictionaryTest, LookupComment) {
   EXPECT_TRUE(LookupComment(*dic, "mismatching_key", "comment_value4").empty());
 }
 
+TEST_F(UserDictionaryTest, LookupComments) {
+  unique_ptr<UserDictionary> dic(CreateDictionaryWithMockPos());
+  // Wait for async reload called from the constructor.
+  dic->WaitForReloader();
+
+  {
+    UserDictionaryStorage storage("");
+    UserDictionaryTest::LoadFromString(kUserDictionary0, &storage);
+    dic->Load(storage);
+  }
+
+  std::vector<std::pair<StringPiece, StringPiece>> key_values;
+  key_values.push_back(std::make_pair("comment_key1", "comment_value1"));
+  key_values.push_back(std::make_pair("comment_key2", "comment_value2"));
+  key_values.push_back(std::make_pair("comment_key3", "comment_value3"));
+  key_values.push_back(std::make_pair("comment_key4", "comment_value4"));
+  key_values.push_back(std::make_pair("comment_key2", "mismatching_value"));
+  key_values.push_back(std::make_pair("", "comment_value2"));
+  key_values.push_back(std::make_pair("comment_key2", "comment_value2"));
+
+  // The results are the same as LookupComment() for each pair.
+  std::vector<string> comments;
+  EXPECT_EQ(3, dic->LookupComments(key_values, convreq_, &comments));
+  ASSERT_EQ(key_values.size(), comments.size());
+  EXPECT_TRUE(comments[0].empty());
+  EXPECT_EQ("comment", comments[1]);
+  EXPECT_EQ("comment1", comments[2]);
+  EXPECT_TRUE(comments[3].empty());
+  EXPECT_TRUE(comments[4].empty());
+  EXPECT_TRUE(comments[5].empty());
+  EXPECT_EQ("comment", comments[6]);
+
+  // Comments already filled, e.g., by another dictionary, are kept.
+  comments.assign(key_values.size(), "");
+  comments[1] = "prev comment";
+  EXPECT_EQ(2, dic->LookupComments(key_values, convreq_, &comments));
+  EXPECT_EQ("prev comment", comments[1]);
+  EXPECT_EQ("comment1", comments[2]);
+
+  // Nothing is found in incognito mode.
+  config_.set_incognito_mode(true);
+  comments.clear();
+  EXPECT_EQ(0, dic->LookupComments(key_values, convreq_, &comments));
+  EXPECT_EQ(key_values.size(), comments.size());
+  config_.set_incognito_mode(false);
+}
+
 }  // namespace
 }  // namespace dictionary
 }  // namespace mozc
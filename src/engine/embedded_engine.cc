@@ -0,0 +1,150 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "engine/embedded_engine.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "base/logging.h"
+#include "converter/converter_interface.h"
+#include "converter/segments.h"
+#include "engine/engine_interface.h"
+
+namespace mozc {
+
+struct EmbeddedEngine::Slot {
+  Mutex mutex;
+  std::unique_ptr<EngineInterface> engine;
+};
+
+// Holds a slot during a call and releases it on destruction.
+class EmbeddedEngine::ScopedEngine {
+ public:
+  explicit ScopedEngine(EmbeddedEngine *owner)
+      : slot_(owner->AcquireSlot()) {}
+  ~ScopedEngine() { slot_->mutex.Unlock(); }
+
+  const ConverterInterface *converter() const {
+    return slot_->engine->GetConverter();
+  }
+
+ private:
+  Slot *slot_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedEngine);
+};
+
+EmbeddedEngine::EmbeddedEngine(
+    std::vector<std::unique_ptr<EngineInterface>> engines)
+    : next_slot_(0) {
+  CHECK(!engines.empty());
+  for (size_t i = 0; i < engines.size(); ++i) {
+    CHECK(engines[i]);
+    std::unique_ptr<Slot> slot(new Slot);
+    slot->engine = std::move(engines[i]);
+    slots_.push_back(std::move(slot));
+  }
+}
+
+EmbeddedEngine::~EmbeddedEngine() = default;
+
+EmbeddedEngine::Slot *EmbeddedEngine::AcquireSlot() {
+  const size_t start = next_slot_.fetch_add(1) % slots_.size();
+  for (size_t i = 0; i < slots_.size(); ++i) {
+    Slot *slot = slots_[(start + i) % slots_.size()].get();
+    if (slot->mutex.TryLock()) {
+      return slot;
+    }
+  }
+  // All the engines are busy.  Wait for the one the hint points to.
+  Slot *slot = slots_[start].get();
+  slot->mutex.Lock();
+  return slot;
+}
+
+bool EmbeddedEngine::Convert(const string &key, size_t max_candidates,
+                             std::vector<Segment> *segments) {
+  DCHECK(segments);
+  segments->clear();
+  if (key.empty() || max_candidates == 0) {
+    return false;
+  }
+
+  mozc::Segments result;
+  result.set_max_conversion_candidates_size(max_candidates);
+  {
+    ScopedEngine engine(this);
+    if (!engine.converter()->StartConversion(&result, key)) {
+      return false;
+    }
+  }
+
+  segments->resize(result.conversion_segments_size());
+  for (size_t i = 0; i < result.conversion_segments_size(); ++i) {
+    const mozc::Segment &segment = result.conversion_segment(i);
+    (*segments)[i].key = segment.key();
+    const size_t size = std::min(segment.candidates_size(), max_candidates);
+    for (size_t j = 0; j < size; ++j) {
+      (*segments)[i].candidates.push_back(segment.candidate(j).value);
+    }
+  }
+  return true;
+}
+
+bool EmbeddedEngine::Predict(const string &key, size_t max_candidates,
+                             std::vector<string> *candidates) {
+  DCHECK(candidates);
+  candidates->clear();
+  if (key.empty() || max_candidates == 0) {
+    return false;
+  }
+
+  mozc::Segments result;
+  result.set_max_prediction_candidates_size(max_candidates);
+  {
+    ScopedEngine engine(this);
+    if (!engine.converter()->StartPrediction(&result, key)) {
+      return false;
+    }
+  }
+  if (result.conversion_segments_size() == 0) {
+    return false;
+  }
+
+  const mozc::Segment &segment = result.conversion_segment(0);
+  const size_t size = std::min(segment.candidates_size(), max_candidates);
+  for (size_t i = 0; i < size; ++i) {
+    candidates->push_back(segment.candidate(i).value);
+  }
+  return true;
+}
+
+}  // namespace mozc
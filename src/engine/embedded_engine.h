@@ -0,0 +1,94 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef MOZC_ENGINE_EMBEDDED_ENGINE_H_
+#define MOZC_ENGINE_EMBEDDED_ENGINE_H_
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/mutex.h"
+#include "base/port.h"
+
+namespace mozc {
+
+class EngineInterface;
+
+// Thread-safe wrapper of a pool of engines to call the converter directly
+// from other programs, without sessions nor composers.  Converters are not
+// thread-safe, so each call takes an engine that no other thread is using.
+// Calls block only when all the engines are busy; the number of engines is
+// the practical limit of the parallelism.
+//
+// See embedded_engine_c.h for the C interface.
+class EmbeddedEngine {
+ public:
+  struct Segment {
+    string key;
+    // Candidate values in the order of the rank.
+    std::vector<string> candidates;
+  };
+
+  // Takes the ownership of |engines|, which must not be empty.
+  explicit EmbeddedEngine(
+      std::vector<std::unique_ptr<EngineInterface>> engines);
+  ~EmbeddedEngine();
+
+  // Converts |key| and stores up to |max_candidates| candidates of each
+  // segment into |segments|.
+  bool Convert(const string &key, size_t max_candidates,
+               std::vector<Segment> *segments);
+
+  // Stores up to |max_candidates| prediction candidates for |key| into
+  // |candidates|.
+  bool Predict(const string &key, size_t max_candidates,
+               std::vector<string> *candidates);
+
+  size_t num_engines() const { return slots_.size(); }
+
+ private:
+  struct Slot;
+  class ScopedEngine;
+
+  // Returns an unused slot with its mutex locked.
+  Slot *AcquireSlot();
+
+  std::vector<std::unique_ptr<Slot>> slots_;
+  // Hint of the slot to try first, to spread the calls over the slots.
+  std::atomic<size_t> next_slot_;
+
+  DISALLOW_COPY_AND_ASSIGN(EmbeddedEngine);
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_ENGINE_EMBEDDED_ENGINE_H_
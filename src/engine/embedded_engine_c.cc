@@ -0,0 +1,138 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "engine/embedded_engine_c.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "engine/embedded_engine.h"
+#include "engine/engine_factory.h"
+#include "engine/engine_interface.h"
+
+struct mozc_engine {
+  std::unique_ptr<mozc::EmbeddedEngine> impl;
+};
+
+struct mozc_result {
+  std::vector<mozc::EmbeddedEngine::Segment> segments;
+};
+
+namespace {
+
+const mozc::EmbeddedEngine::Segment *GetSegment(const mozc_result *result,
+                                                int segment) {
+  if (result == NULL || segment < 0 ||
+      segment >= static_cast<int>(result->segments.size())) {
+    return NULL;
+  }
+  return &result->segments[segment];
+}
+
+}  // namespace
+
+mozc_engine *mozc_engine_create(int num_engines) {
+  if (num_engines <= 0) {
+    return NULL;
+  }
+  std::vector<std::unique_ptr<mozc::EngineInterface>> engines;
+  for (int i = 0; i < num_engines; ++i) {
+    std::unique_ptr<mozc::EngineInterface> engine(
+        mozc::EngineFactory::Create());
+    if (!engine) {
+      return NULL;
+    }
+    engines.push_back(std::move(engine));
+  }
+  mozc_engine *engine = new mozc_engine;
+  engine->impl.reset(new mozc::EmbeddedEngine(std::move(engines)));
+  return engine;
+}
+
+void mozc_engine_free(mozc_engine *engine) {
+  delete engine;
+}
+
+mozc_result *mozc_engine_convert(mozc_engine *engine, const char *key,
+                                 int max_candidates) {
+  if (engine == NULL || key == NULL || max_candidates <= 0) {
+    return NULL;
+  }
+  std::unique_ptr<mozc_result> result(new mozc_result);
+  if (!engine->impl->Convert(key, max_candidates, &result->segments)) {
+    return NULL;
+  }
+  return result.release();
+}
+
+mozc_result *mozc_engine_predict(mozc_engine *engine, const char *key,
+                                 int max_candidates) {
+  if (engine == NULL || key == NULL || max_candidates <= 0) {
+    return NULL;
+  }
+  std::unique_ptr<mozc_result> result(new mozc_result);
+  result->segments.resize(1);
+  result->segments[0].key = key;
+  if (!engine->impl->Predict(key, max_candidates,
+                             &result->segments[0].candidates)) {
+    return NULL;
+  }
+  return result.release();
+}
+
+void mozc_result_free(mozc_result *result) {
+  delete result;
+}
+
+int mozc_result_segments_size(const mozc_result *result) {
+  return result == NULL ? 0 : static_cast<int>(result->segments.size());
+}
+
+const char *mozc_result_segment_key(const mozc_result *result, int segment) {
+  const mozc::EmbeddedEngine::Segment *s = GetSegment(result, segment);
+  return s == NULL ? NULL : s->key.c_str();
+}
+
+int mozc_result_candidates_size(const mozc_result *result, int segment) {
+  const mozc::EmbeddedEngine::Segment *s = GetSegment(result, segment);
+  return s == NULL ? 0 : static_cast<int>(s->candidates.size());
+}
+
+const char *mozc_result_candidate(const mozc_result *result, int segment,
+                                  int candidate) {
+  const mozc::EmbeddedEngine::Segment *s = GetSegment(result, segment);
+  if (s == NULL || candidate < 0 ||
+      candidate >= static_cast<int>(s->candidates.size())) {
+    return NULL;
+  }
+  return s->candidates[candidate].c_str();
+}
@@ -0,0 +1,85 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// C interface of EmbeddedEngine.  All the strings are NUL-terminated UTF-8.
+// The functions taking a mozc_engine may be called from multiple threads
+// concurrently.  A mozc_result is owned by the caller and is not thread-safe.
+//
+// Example:
+//   mozc_engine *engine = mozc_engine_create(4);
+//   mozc_result *result = mozc_engine_convert(engine, "きょうは", 5);
+//   for (int i = 0; i < mozc_result_segments_size(result); ++i) {
+//     printf("%s: %s\n", mozc_result_segment_key(result, i),
+//            mozc_result_candidate(result, i, 0));
+//   }
+//   mozc_result_free(result);
+//   mozc_engine_free(engine);
+
+#ifndef MOZC_ENGINE_EMBEDDED_ENGINE_C_H_
+#define MOZC_ENGINE_EMBEDDED_ENGINE_C_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+typedef struct mozc_engine mozc_engine;
+typedef struct mozc_result mozc_result;
+
+// Creates an engine pool with |num_engines| engines of the default data set.
+// Each engine holds its own converter, so |num_engines| bounds the number of
+// calls running in parallel.  Returns NULL on failure.
+mozc_engine *mozc_engine_create(int num_engines);
+void mozc_engine_free(mozc_engine *engine);
+
+// Converts |key| and returns up to |max_candidates| candidates per segment.
+// Returns NULL on failure.
+mozc_result *mozc_engine_convert(mozc_engine *engine, const char *key,
+                                 int max_candidates);
+
+// Predicts candidates for |key|.  The result has one segment whose key is
+// |key|.  Returns NULL on failure.
+mozc_result *mozc_engine_predict(mozc_engine *engine, const char *key,
+                                 int max_candidates);
+
+void mozc_result_free(mozc_result *result);
+
+// Accessors of a result.  The returned strings are valid until the result is
+// freed.  Out-of-range indices return 0 or NULL.
+int mozc_result_segments_size(const mozc_result *result);
+const char *mozc_result_segment_key(const mozc_result *result, int segment);
+int mozc_result_candidates_size(const mozc_result *result, int segment);
+const char *mozc_result_candidate(const mozc_result *result, int segment,
+                                  int candidate);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif  // __cplusplus
+
+#endif  // MOZC_ENGINE_EMBEDDED_ENGINE_C_H_
@@ -0,0 +1,121 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "engine/embedded_engine.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/thread.h"
+#include "engine/engine_interface.h"
+#include "engine/minimal_engine.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace {
+
+std::unique_ptr<EmbeddedEngine> CreateEmbeddedEngine(int num_engines) {
+  std::vector<std::unique_ptr<EngineInterface>> engines;
+  for (int i = 0; i < num_engines; ++i) {
+    engines.emplace_back(new MinimalEngine());
+  }
+  return std::unique_ptr<EmbeddedEngine>(
+      new EmbeddedEngine(std::move(engines)));
+}
+
+TEST(EmbeddedEngineTest, Convert) {
+  std::unique_ptr<EmbeddedEngine> engine = CreateEmbeddedEngine(1);
+  std::vector<EmbeddedEngine::Segment> segments;
+  ASSERT_TRUE(engine->Convert("きょう", 5, &segments));
+  // MinimalEngine returns the key as is in one segment.
+  ASSERT_EQ(1, segments.size());
+  ASSERT_EQ(1, segments[0].candidates.size());
+  EXPECT_EQ("きょう", segments[0].candidates[0]);
+
+  EXPECT_FALSE(engine->Convert("", 5, &segments));
+  EXPECT_TRUE(segments.empty());
+  EXPECT_FALSE(engine->Convert("きょう", 0, &segments));
+}
+
+TEST(EmbeddedEngineTest, Predict) {
+  std::unique_ptr<EmbeddedEngine> engine = CreateEmbeddedEngine(1);
+  std::vector<string> candidates;
+  ASSERT_TRUE(engine->Predict("きょ", 5, &candidates));
+  ASSERT_EQ(1, candidates.size());
+  EXPECT_EQ("きょ", candidates[0]);
+
+  EXPECT_FALSE(engine->Predict("", 5, &candidates));
+  EXPECT_TRUE(candidates.empty());
+}
+
+class ConvertThread : public Thread {
+ public:
+  ConvertThread(EmbeddedEngine *engine, int id)
+      : engine_(engine), id_(id), num_failures_(0) {}
+
+  void Run() override {
+    const string key = "key" + std::to_string(id_);
+    for (int i = 0; i < 1000; ++i) {
+      std::vector<EmbeddedEngine::Segment> segments;
+      if (!engine_->Convert(key, 1, &segments) || segments.size() != 1 ||
+          segments[0].candidates.size() != 1 ||
+          segments[0].candidates[0] != key) {
+        ++num_failures_;
+      }
+    }
+  }
+
+  int num_failures() const { return num_failures_; }
+
+ private:
+  EmbeddedEngine *engine_;
+  const int id_;
+  int num_failures_;
+};
+
+TEST(EmbeddedEngineTest, ConcurrentCalls) {
+  // More threads than engines so that some calls wait for a busy engine.
+  std::unique_ptr<EmbeddedEngine> engine = CreateEmbeddedEngine(2);
+  std::vector<std::unique_ptr<ConvertThread>> threads;
+  for (int i = 0; i < 8; ++i) {
+    threads.emplace_back(new ConvertThread(engine.get(), i));
+    threads.back()->SetJoinable(true);
+    threads.back()->Start("EmbeddedEngineTest");
+  }
+  for (size_t i = 0; i < threads.size(); ++i) {
+    threads[i]->Join();
+    EXPECT_EQ(0, threads[i]->num_failures());
+  }
+}
+
+}  // namespace
+}  // namespace mozc
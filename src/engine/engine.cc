@@ -31,7 +31,9 @@
 
 #include <utility>
 
+#include "base/flags.h"
 #include "base/logging.h"
+#include "base/parallel_initializer.h"
 #include "base/port.h"
 #include "converter/connector.h"
 #include "converter/converter.h"
@@ -57,6 +59,7 @@
 #include "prediction/predictor_interface.h"
 #include "prediction/suggestion_filter.h"
 #include "prediction/user_history_predictor.h"
+#include "protocol/commands.pb.h"
 #include "rewriter/rewriter.h"
 #include "rewriter/rewriter_interface.h"
 
@@ -69,14 +72,94 @@ using mozc::dictionary::UserDictionary;
 using mozc::dictionary::UserPOS;
 using mozc::dictionary::ValueDictionary;
 
+DECLARE_int32(parallel_init_threads);
+
+DEFINE_bool(lite_engine, false,
+            "Build the engine with the memory-lean profile for low-RAM "
+            "devices: no dense connector/segmenter tables, a smaller "
+            "connection cost cache and a smaller user history cache.");
+
 namespace mozc {
 namespace {
 
+// Sizes used by the lite profile.  They are the same as the ones on Android.
+const int kLiteConnectorCacheSize = 256;
+const size_t kLiteUserHistoryCacheSize = 2000;
+
+// Creates a connector that decodes the compressed matrix on demand, instead
+// of using the uncompressed matrix even if the data set has one.
+Connector *CreateLiteConnector(const DataManagerInterface &data_manager) {
+  const char *data = nullptr;
+  size_t size = 0;
+  data_manager.GetConnectorData(&data, &size);
+  return new Connector(data, size, kLiteConnectorCacheSize);
+}
+
+// Creates a segmenter that only uses the compressed bit-array.
+Segmenter *CreateLiteSegmenter(const DataManagerInterface &data_manager) {
+  size_t l_num_elements = 0;
+  size_t r_num_elements = 0;
+  const uint16 *l_table = nullptr;
+  const uint16 *r_table = nullptr;
+  size_t bitarray_num_bytes = 0;
+  const char *bitarray_data = nullptr;
+  const uint16 *boundary_data = nullptr;
+  data_manager.GetSegmenterData(&l_num_elements, &r_num_elements,
+                                &l_table, &r_table,
+                                &bitarray_num_bytes, &bitarray_data,
+                                &boundary_data);
+  return new Segmenter(l_num_elements, r_num_elements, l_table, r_table,
+                       bitarray_num_bytes, bitarray_data, boundary_data);
+}
+
+// Logs the size of the data each component refers to.  Data set sections
+// are mapped and shared between processes, while the user history cache is
+// allocated in heap as it grows; its size is estimated at 70 bytes/entry.
+void LogMemoryFootprint(const DataManagerInterface &data_manager, bool lite,
+                        size_t user_history_cache_size) {
+  const char *data = nullptr;
+  int dictionary_size = 0;
+  data_manager.GetSystemDictionaryData(&data, &dictionary_size);
+  size_t connector_size = 0;
+  data_manager.GetConnectorData(&data, &connector_size);
+  size_t dense_connector_size = 0;
+  size_t dense_segmenter_size = 0;
+#ifndef OS_ANDROID
+  // See Connector::CreateFromDataManager() and
+  // Segmenter::CreateFromDataManager() for when the dense tables are used.
+  if (!lite) {
+    data = nullptr;
+    data_manager.GetDenseConnectorData(&data, &dense_connector_size);
+    if (data == nullptr) {
+      dense_connector_size = 0;
+    }
+    data = nullptr;
+    data_manager.GetDenseSegmenterData(&data, &dense_segmenter_size);
+    if (data == nullptr) {
+      dense_segmenter_size = 0;
+    }
+  }
+#endif  // OS_ANDROID
+  size_t suggestion_filter_size = 0;
+  data_manager.GetSuggestionFilterData(&data, &suggestion_filter_size);
+  LOG(INFO) << "Engine memory footprint (" << (lite ? "lite" : "full")
+            << " profile): system dictionary " << dictionary_size
+            << " bytes, connector " << connector_size
+            << " + dense " << dense_connector_size
+            << " bytes, dense segmenter " << dense_segmenter_size
+            << " bytes, suggestion filter " << suggestion_filter_size
+            << " bytes, user history up to " << user_history_cache_size * 70
+            << " bytes (" << user_history_cache_size << " entries)";
+}
+
 class UserDataManagerImpl final : public UserDataManagerInterface {
  public:
-  explicit UserDataManagerImpl(PredictorInterface *predictor,
-                               RewriterInterface *rewriter)
-      : predictor_(predictor), rewriter_(rewriter) {}
+  // |converter| may learn in background with --async_learning; the
+  // operations below wait for it before touching the user data.
+  UserDataManagerImpl(const ConverterImpl *converter,
+                      PredictorInterface *predictor,
+                      RewriterInterface *rewriter)
+      : converter_(converter), predictor_(predictor), rewriter_(rewriter) {}
   ~UserDataManagerImpl() override;
 
   bool Sync() override;
@@ -89,6 +172,7 @@ class UserDataManagerImpl final : public UserDataManagerInterface {
   bool Wait() override;
 
  private:
+  const ConverterImpl *converter_;
   PredictorInterface *predictor_;
   RewriterInterface *rewriter_;
 
@@ -101,35 +185,42 @@ bool UserDataManagerImpl::Sync() {
   // TODO(noriyukit): In the current implementation, if rewriter_->Sync() fails,
   // predictor_->Sync() is never called. Check if we should call
   // predictor_->Sync() or not.
+  converter_->WaitForLearning();
   return rewriter_->Sync() && predictor_->Sync();
 }
 
 bool UserDataManagerImpl::Reload() {
   // TODO(noriyukit): The same TODO as Sync().
+  converter_->WaitForLearning();
   return rewriter_->Reload() && predictor_->Reload();
 }
 
 bool UserDataManagerImpl::ClearUserHistory() {
+  converter_->WaitForLearning();
   rewriter_->Clear();
   return true;
 }
 
 bool UserDataManagerImpl::ClearUserPrediction() {
+  converter_->WaitForLearning();
   predictor_->ClearAllHistory();
   return true;
 }
 
 bool UserDataManagerImpl::ClearUnusedUserPrediction() {
+  converter_->WaitForLearning();
   predictor_->ClearUnusedHistory();
   return true;
 }
 
 bool UserDataManagerImpl::ClearUserPredictionEntry(const string &key,
                                                    const string &value) {
+  converter_->WaitForLearning();
   return predictor_->ClearHistoryEntry(key, value);
 }
 
 bool UserDataManagerImpl::Wait() {
+  converter_->WaitForLearning();
   return predictor_->Wait();
 }
 
@@ -153,7 +244,12 @@ std::unique_ptr<Engine> Engine::CreateMobileEngine(
   return engine;
 }
 
-Engine::Engine() = default;
+Engine::Engine()
+    : system_dictionary_(nullptr),
+      predictor_(nullptr),
+      rewriter_(nullptr),
+      user_history_predictor_(nullptr) {}
+
 Engine::~Engine() = default;
 
 // Since the composite predictor class differs on desktop and mobile, Init()
@@ -172,18 +268,66 @@ void Engine::Init(
   pos_matcher_.reset(
       new dictionary::POSMatcher(data_manager->GetPOSMatcherData()));
 
-  user_dictionary_.reset(
-      new UserDictionary(UserPOS::CreateFromDataManager(*data_manager),
-                         *pos_matcher_,
-                         suppression_dictionary_.get()));
-  CHECK(user_dictionary_.get());
+  const bool lite = FLAGS_lite_engine;
 
-  const char *dictionary_data = NULL;
-  int dictionary_size = 0;
-  data_manager->GetSystemDictionaryData(&dictionary_data, &dictionary_size);
+  // The components below only depend on the data manager, the POS matcher and
+  // the suppression dictionary, so they can be constructed concurrently.
+  SystemDictionary *sysdic = nullptr;
+  {
+    ParallelInitializer initializer(FLAGS_parallel_init_threads);
+    initializer.Add("UserDictionary", [this, data_manager] {
+      user_dictionary_.reset(
+          new UserDictionary(UserPOS::CreateFromDataManager(*data_manager),
+                             *pos_matcher_,
+                             suppression_dictionary_.get()));
+    });
+    initializer.Add("SystemDictionary", [data_manager, &sysdic] {
+      const char *dictionary_data = NULL;
+      int dictionary_size = 0;
+      data_manager->GetSystemDictionaryData(&dictionary_data,
+                                            &dictionary_size);
+      sysdic =
+          SystemDictionary::Builder(dictionary_data, dictionary_size).Build();
+    });
+    initializer.Add("SuffixDictionary", [this, data_manager] {
+      StringPiece suffix_key_array_data, suffix_value_array_data;
+      const uint32 *token_array;
+      data_manager->GetSuffixDictionaryData(&suffix_key_array_data,
+                                            &suffix_value_array_data,
+                                            &token_array);
+      suffix_dictionary_.reset(new SuffixDictionary(suffix_key_array_data,
+                                                    suffix_value_array_data,
+                                                    token_array));
+    });
+    initializer.Add("Connector", [this, data_manager, lite] {
+      connector_.reset(lite ? CreateLiteConnector(*data_manager)
+                            : Connector::CreateFromDataManager(*data_manager));
+    });
+    initializer.Add("Segmenter", [this, data_manager, lite] {
+      segmenter_.reset(lite ? CreateLiteSegmenter(*data_manager)
+                            : Segmenter::CreateFromDataManager(*data_manager));
+    });
+    initializer.Add("PosGroup", [this, data_manager] {
+      pos_group_.reset(new PosGroup(data_manager->GetPosGroupData()));
+    });
+    initializer.Add("SuggestionFilter", [this, data_manager] {
+      const char *data = NULL;
+      size_t size = 0;
+      data_manager->GetSuggestionFilterData(&data, &size);
+      CHECK(data);
+      suggestion_filter_.reset(new SuggestionFilter(data, size));
+    });
+    initializer.Run("Engine dictionaries");
+  }
+  CHECK(user_dictionary_.get());
+  CHECK(sysdic);
+  CHECK(suffix_dictionary_.get());
+  CHECK(connector_.get());
+  CHECK(segmenter_.get());
+  CHECK(pos_group_.get());
+  CHECK(suggestion_filter_.get());
 
-  SystemDictionary *sysdic =
-      SystemDictionary::Builder(dictionary_data, dictionary_size).Build();
+  system_dictionary_ = sysdic;
   dictionary_.reset(new DictionaryImpl(
       sysdic,  // DictionaryImpl takes the ownership
       new ValueDictionary(*pos_matcher_, &sysdic->value_trie()),
@@ -192,33 +336,6 @@ void Engine::Init(
       pos_matcher_.get()));
   CHECK(dictionary_.get());
 
-  StringPiece suffix_key_array_data, suffix_value_array_data;
-  const uint32 *token_array;
-  data_manager->GetSuffixDictionaryData(&suffix_key_array_data,
-                                        &suffix_value_array_data,
-                                        &token_array);
-  suffix_dictionary_.reset(new SuffixDictionary(suffix_key_array_data,
-                                                suffix_value_array_data,
-                                                token_array));
-  CHECK(suffix_dictionary_.get());
-
-  connector_.reset(Connector::CreateFromDataManager(*data_manager));
-  CHECK(connector_.get());
-
-  segmenter_.reset(Segmenter::CreateFromDataManager(*data_manager));
-  CHECK(segmenter_.get());
-
-  pos_group_.reset(new PosGroup(data_manager->GetPosGroupData()));
-  CHECK(pos_group_.get());
-
-  {
-    const char *data = NULL;
-    size_t size = 0;
-    data_manager->GetSuggestionFilterData(&data, &size);
-    CHECK(data);
-    suggestion_filter_.reset(new SuggestionFilter(data, size));
-  }
-
   immutable_converter_.reset(new ImmutableConverterImpl(
       dictionary_.get(),
       suffix_dictionary_.get(),
@@ -240,46 +357,66 @@ void Engine::Init(
   converter_.reset(converter_impl);  // Involves cast to ConverterInterface*.
   CHECK(converter_.get());
 
+  const size_t user_history_cache_size =
+      lite ? kLiteUserHistoryCacheSize : UserHistoryPredictor::cache_size();
   {
     // Create a predictor with three sub-predictors, dictionary predictor, user
-    // history predictor, and extra predictor.
-    PredictorInterface *dictionary_predictor =
-        new DictionaryPredictor(*data_manager,
-                                converter_.get(),
-                                immutable_converter_.get(),
-                                dictionary_.get(),
-                                suffix_dictionary_.get(),
-                                connector_.get(),
-                                segmenter_.get(),
-                                pos_matcher_.get(),
-                                suggestion_filter_.get());
+    // history predictor, and extra predictor.  The sub-predictors and the
+    // rewriter only keep the pointer to the uninitialized converter, so they
+    // are constructed concurrently as well.
+    PredictorInterface *dictionary_predictor = nullptr;
+    UserHistoryPredictor *user_history_predictor = nullptr;
+    ParallelInitializer initializer(FLAGS_parallel_init_threads);
+    initializer.Add("DictionaryPredictor",
+                    [this, data_manager, &dictionary_predictor] {
+      dictionary_predictor =
+          new DictionaryPredictor(*data_manager,
+                                  converter_.get(),
+                                  immutable_converter_.get(),
+                                  dictionary_.get(),
+                                  suffix_dictionary_.get(),
+                                  connector_.get(),
+                                  segmenter_.get(),
+                                  pos_matcher_.get(),
+                                  suggestion_filter_.get());
+    });
+    initializer.Add("UserHistoryPredictor",
+                    [this, enable_content_word_learning,
+                     user_history_cache_size, &user_history_predictor] {
+      user_history_predictor =
+          new UserHistoryPredictor(dictionary_.get(),
+                                   pos_matcher_.get(),
+                                   suppression_dictionary_.get(),
+                                   enable_content_word_learning,
+                                   user_history_cache_size);
+    });
+    initializer.Add("RewriterImpl", [this, converter_impl, data_manager] {
+      rewriter_ = new RewriterImpl(converter_impl,
+                                   data_manager,
+                                   pos_group_.get(),
+                                   dictionary_.get());
+    });
+    initializer.Run("Engine predictors and rewriters");
     CHECK(dictionary_predictor);
-
-    PredictorInterface *user_history_predictor =
-        new UserHistoryPredictor(dictionary_.get(),
-                                 pos_matcher_.get(),
-                                 suppression_dictionary_.get(),
-                                 enable_content_word_learning);
     CHECK(user_history_predictor);
+    CHECK(rewriter_);
+    user_history_predictor_ = user_history_predictor;
 
     predictor_ = (*predictor_factory)(dictionary_predictor,
                                       user_history_predictor);
     CHECK(predictor_);
   }
 
-  rewriter_ = new RewriterImpl(converter_impl,
-                               data_manager,
-                               pos_group_.get(),
-                               dictionary_.get());
-  CHECK(rewriter_);
-
   converter_impl->Init(pos_matcher_.get(),
                        suppression_dictionary_.get(),
                        predictor_,
                        rewriter_,
                        immutable_converter_.get());
 
-  user_data_manager_.reset(new UserDataManagerImpl(predictor_, rewriter_));
+  user_data_manager_.reset(
+      new UserDataManagerImpl(converter_impl, predictor_, rewriter_));
+
+  LogMemoryFootprint(*data_manager, lite, user_history_cache_size);
 
   data_manager_.reset(data_manager);
 }
@@ -292,4 +429,49 @@ bool Engine::Reload() {
   return user_dictionary_->Reload();
 }
 
+bool Engine::GetRewriterStatistics(
+    commands::RewriterStatistics *statistics) const {
+  if (rewriter_ == nullptr) {
+    return false;
+  }
+  rewriter_->GetStatistics(statistics);
+  return true;
+}
+
+bool Engine::GetMemoryUsage(commands::MemoryUsage *usage) const {
+  DCHECK(usage);
+  if (system_dictionary_ != nullptr) {
+    commands::MemoryUsage::Entry *entry = usage->add_entry();
+    entry->set_name("SystemDictionary");
+    entry->set_heap_bytes(system_dictionary_->GetHeapMemoryUsage());
+    const char *data = nullptr;
+    int size = 0;
+    data_manager_->GetSystemDictionaryData(&data, &size);
+    entry->set_mapped_bytes(size);
+  }
+  if (user_dictionary_) {
+    commands::MemoryUsage::Entry *entry = usage->add_entry();
+    entry->set_name("UserDictionary");
+    entry->set_heap_bytes(user_dictionary_->GetHeapMemoryUsage());
+  }
+  if (connector_) {
+    commands::MemoryUsage::Entry *entry = usage->add_entry();
+    entry->set_name("Connector");
+    entry->set_heap_bytes(connector_->GetHeapMemoryUsage());
+  }
+  size_t num_entries = 0;
+  size_t heap_bytes = 0;
+  if (user_history_predictor_ != nullptr &&
+      user_history_predictor_->GetMemoryUsage(&num_entries, &heap_bytes)) {
+    commands::MemoryUsage::Entry *entry = usage->add_entry();
+    entry->set_name("UserHistoryPredictor");
+    entry->set_heap_bytes(heap_bytes);
+    entry->set_size(num_entries);
+  }
+  if (rewriter_ != nullptr) {
+    rewriter_->GetMemoryUsage(usage);
+  }
+  return true;
+}
+
 }  // namespace mozc
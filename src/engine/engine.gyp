@@ -118,6 +118,28 @@
       'conditions': [
       ],
     },
+    {
+      'target_name': 'embedded_engine',
+      'type': 'static_library',
+      'sources': [
+        'embedded_engine.cc',
+      ],
+      'dependencies': [
+        '../base/base.gyp:base',
+        '../converter/converter_base.gyp:segments',
+      ],
+    },
+    {
+      'target_name': 'embedded_engine_c',
+      'type': 'static_library',
+      'sources': [
+        'embedded_engine_c.cc',
+      ],
+      'dependencies': [
+        'embedded_engine',
+        'engine_factory',
+      ],
+    },
     {
       'target_name': 'minimal_engine',
       'type': 'static_library',
@@ -44,13 +44,15 @@ class Connector;
 class ConverterInterface;
 class ImmutableConverterInterface;
 class PredictorInterface;
-class RewriterInterface;
+class RewriterImpl;
 class Segmenter;
 class SuggestionFilter;
 class UserDataManagerInterface;
+class UserHistoryPredictor;
 
 namespace dictionary {
 class POSMatcher;
+class SystemDictionary;
 class UserDictionary;
 }  // namespace dictionary
 
@@ -111,6 +113,11 @@ class Engine : public EngineInterface {
     return data_manager_.get();
   }
 
+  bool GetRewriterStatistics(
+      commands::RewriterStatistics *statistics) const override;
+
+  bool GetMemoryUsage(commands::MemoryUsage *usage) const override;
+
  private:
   // Initializes the object by the given data manager and predictor factory
   // function.  Predictor factory is used to select DefaultPredictor and
@@ -128,6 +135,8 @@ class Engine : public EngineInterface {
   std::unique_ptr<dictionary::UserDictionary> user_dictionary_;
   std::unique_ptr<dictionary::DictionaryInterface> suffix_dictionary_;
   std::unique_ptr<dictionary::DictionaryInterface> dictionary_;
+  // Owned by |dictionary_|.
+  const dictionary::SystemDictionary *system_dictionary_;
   std::unique_ptr<const dictionary::PosGroup> pos_group_;
   std::unique_ptr<ImmutableConverterInterface> immutable_converter_;
   std::unique_ptr<const SuggestionFilter> suggestion_filter_;
@@ -136,7 +145,9 @@ class Engine : public EngineInterface {
   // but owned by converter_. Since this class creates these two, it'd be better
   // if Engine class owns these two instances.
   PredictorInterface *predictor_;
-  RewriterInterface *rewriter_;
+  RewriterImpl *rewriter_;
+  // Owned by |predictor_|.
+  const UserHistoryPredictor *user_history_predictor_;
 
   std::unique_ptr<ConverterInterface> converter_;
   std::unique_ptr<UserDataManagerInterface> user_data_manager_;
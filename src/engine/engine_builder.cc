@@ -34,7 +34,7 @@
 
 #include "base/file_util.h"
 #include "base/logging.h"
-#include "base/thread.h"
+#include "base/thread_pool.h"
 #include "data_manager/data_manager.h"
 #include "engine/engine.h"
 #include "protocol/engine_builder.pb.h"
@@ -60,55 +60,78 @@ EngineReloadResponse::Status ConvertStatus(DataManager::Status status) {
   return EngineReloadResponse::UNKNOWN_ERROR;
 }
 
-}  // namespace
-
-class EngineBuilder::Preparator : public Thread {
- public:
-  explicit Preparator(const EngineReloadRequest &request) {
-    *response_.mutable_request() = request;
+std::unique_ptr<EngineInterface> CreateEngine(
+    EngineReloadRequest::EngineType engine_type,
+    std::unique_ptr<DataManager> data_manager) {
+  switch (engine_type) {
+    case EngineReloadRequest::DESKTOP:
+      return Engine::CreateDesktopEngine(std::move(data_manager));
+    case EngineReloadRequest::MOBILE:
+      return Engine::CreateMobileEngine(std::move(data_manager));
+    default:
+      LOG(DFATAL) << "Should not reach here";
+      break;
   }
+  return nullptr;
+}
 
-  ~Preparator() override = default;
+}  // namespace
 
-  void Run() override {
-    const EngineReloadRequest &request = response_.request();
+struct EngineBuilder::Preparation {
+  EngineReloadResponse response;
+  std::unique_ptr<EngineInterface> engine;
+};
 
-    std::unique_ptr<DataManager> tmp_data_manager(new DataManager());
-    const DataManager::Status status = InitDataManager(request,
-                                                       tmp_data_manager.get());
-    if (status != DataManager::Status::OK) {
-      LOG(ERROR) << "Failed to load data [" << status << "] "
-                 << request.Utf8DebugString();
-      response_.set_status(ConvertStatus(status));
-      return;
-    }
+namespace {
 
-    if (request.has_install_location() &&
-        !FileUtil::AtomicRename(request.file_path(),
-                                request.install_location())) {
-      LOG(ERROR) << "Atomic rename faild: " << request.Utf8DebugString();
-      response_.set_status(EngineReloadResponse::INSTALL_FAILURE);
-      return;
-    }
+DataManager::Status InitDataManager(const EngineReloadRequest &request,
+                                    DataManager *data_manager) {
+  if (request.has_magic_number()) {
+    return data_manager->InitFromFile(request.file_path(),
+                                      request.magic_number());
+  }
+  return data_manager->InitFromFile(request.file_path());
+}
 
-    response_.set_status(EngineReloadResponse::RELOAD_READY);
-    data_manager_ = std::move(tmp_data_manager);
+}  // namespace
+
+// static
+EngineBuilder::Preparation EngineBuilder::Prepare(
+    const EngineReloadRequest &request) {
+  Preparation preparation;
+  *preparation.response.mutable_request() = request;
+
+  std::unique_ptr<DataManager> tmp_data_manager(new DataManager());
+  const DataManager::Status status = InitDataManager(request,
+                                                     tmp_data_manager.get());
+  if (status != DataManager::Status::OK) {
+    LOG(ERROR) << "Failed to load data [" << status << "] "
+               << request.Utf8DebugString();
+    preparation.response.set_status(ConvertStatus(status));
+    return preparation;
   }
 
- private:
-  DataManager::Status InitDataManager(const EngineReloadRequest &request,
-                                      DataManager *data_manager) {
-    if (request.has_magic_number()) {
-      return data_manager->InitFromFile(request.file_path(),
-                                        request.magic_number());
-    }
-    return data_manager->InitFromFile(request.file_path());
+  if (request.has_install_location() &&
+      !FileUtil::AtomicRename(request.file_path(),
+                              request.install_location())) {
+    LOG(ERROR) << "Atomic rename faild: " << request.Utf8DebugString();
+    preparation.response.set_status(EngineReloadResponse::INSTALL_FAILURE);
+    return preparation;
   }
 
-  friend class EngineBuilder;
-  EngineReloadResponse response_;
-  std::unique_ptr<DataManager> data_manager_;
-};
+  // The whole engine is built here so that the serving thread only needs to
+  // swap the pointer.  Construction only reads the immutable data manager
+  // and the user profile, which the running engine never blocks on.
+  preparation.engine =
+      CreateEngine(request.engine_type(), std::move(tmp_data_manager));
+  if (!preparation.engine) {
+    LOG(ERROR) << "Failed to build engine: " << request.Utf8DebugString();
+    preparation.response.set_status(EngineReloadResponse::UNKNOWN_ERROR);
+    return preparation;
+  }
+  preparation.response.set_status(EngineReloadResponse::RELOAD_READY);
+  return preparation;
+}
 
 EngineBuilder::EngineBuilder() = default;
 EngineBuilder::~EngineBuilder() = default;
@@ -116,70 +139,54 @@ EngineBuilder::~EngineBuilder() = default;
 void EngineBuilder::PrepareAsync(const EngineReloadRequest &request,
                                  EngineReloadResponse *response) {
   *response->mutable_request() = request;
-  if (preparator_) {
-    if (preparator_->IsRunning()) {
+  if (preparation_) {
+    if (!preparation_->IsReady()) {
       response->set_status(EngineReloadResponse::ALREADY_RUNNING);
       return;
     }
-    preparator_->Join();
     VLOG(1) << "Previously loaded data is discarded";
   }
-  preparator_.reset(new Preparator(request));
-  preparator_->SetJoinable(true);
-  preparator_->Start("EngineBuilder::Preparator");
+  // Runs on the shared pool rather than a dedicated thread, at a low
+  // priority as the current engine keeps serving meanwhile.
+  preparation_ = ThreadPool::GetSharedPool()->Async<Preparation>(
+      ThreadPool::LOW, [request]() { return Prepare(request); });
   response->set_status(EngineReloadResponse::ACCEPTED);
 }
 
 void EngineBuilder::Wait() {
-  if (preparator_) {
-    preparator_->Join();
+  if (preparation_) {
+    preparation_->Wait();
   }
 }
 
 bool EngineBuilder::HasResponse() const {
-  return preparator_ && !preparator_->IsRunning();
+  return preparation_ && preparation_->IsReady();
 }
 
 void EngineBuilder::GetResponse(EngineReloadResponse *response) const {
   if (!HasResponse()) {
     return;
   }
-  *response = preparator_->response_;
+  *response = preparation_->Get().response;
 }
 
 std::unique_ptr<EngineInterface> EngineBuilder::BuildFromPreparedData() {
-  std::unique_ptr<EngineInterface> engine;
-
   if (!HasResponse() ||
-      !preparator_->data_manager_ ||
-      preparator_->response_.status() != EngineReloadResponse::RELOAD_READY) {
+      !preparation_->Get().engine ||
+      preparation_->Get().response.status() !=
+          EngineReloadResponse::RELOAD_READY) {
     LOG(ERROR) << "Build() is called in invalid state";
-    return engine;
-  }
-
-  switch (preparator_->response_.request().engine_type()) {
-    case EngineReloadRequest::DESKTOP:
-      engine =
-          Engine::CreateDesktopEngine(std::move(preparator_->data_manager_));
-      break;
-    case EngineReloadRequest::MOBILE:
-      engine =
-          Engine::CreateMobileEngine(std::move(preparator_->data_manager_));
-      break;
-    default:
-      LOG(DFATAL) << "Should not reach here";
-      break;
+    return nullptr;
   }
-
-  return engine;
+  return std::move(preparation_->Get().engine);
 }
 
 void EngineBuilder::Clear() {
-  if (!preparator_) {
+  if (!preparation_) {
     return;
   }
-  preparator_->Join();
-  preparator_.reset();
+  preparation_->Wait();
+  preparation_.reset();
 }
 
 }  // namespace mozc
@@ -33,6 +33,7 @@
 #include <memory>
 
 #include "base/port.h"
+#include "base/thread_pool.h"
 #include "engine/engine_builder_interface.h"
 
 namespace mozc {
@@ -42,8 +43,8 @@ class EngineBuilder : public EngineBuilderInterface {
   EngineBuilder();
   ~EngineBuilder() override;
 
-  // Implementation of EngineBuilderInterface.  PrepareAsync() is implemented
-  // using Thread.
+  // Implementation of EngineBuilderInterface.  PrepareAsync() runs on
+  // ThreadPool::GetSharedPool().
   void PrepareAsync(const EngineReloadRequest &request,
                     EngineReloadResponse *response) override;
   bool HasResponse() const override;
@@ -51,12 +52,16 @@ class EngineBuilder : public EngineBuilderInterface {
   std::unique_ptr<EngineInterface> BuildFromPreparedData() override;
   void Clear() override;
 
-  // Waits for internal thread to complete.
+  // Waits for the preparation to complete.
   void Wait();
 
  private:
-  class Preparator;
-  std::unique_ptr<Preparator> preparator_;
+  struct Preparation;
+
+  // Loads the data and builds the engine for |request|.
+  static Preparation Prepare(const EngineReloadRequest &request);
+
+  std::shared_ptr<TaskFuture<Preparation>> preparation_;
 
   DISALLOW_COPY_AND_ASSIGN(EngineBuilder);
 };
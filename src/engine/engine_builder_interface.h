@@ -58,8 +58,10 @@ class EngineBuilderInterface {
   // Gets the response to PrepareAsync() if available.
   virtual void GetResponse(EngineReloadResponse *response) const = 0;
 
-  // Builds an engine using the data requested by PrepareAsync().
-  // May return nullptr if bad data was requested in PrepareAsync().
+  // Returns the engine built from the data requested by PrepareAsync().
+  // Implementations may construct the engine in the background so that this
+  // call is cheap.  May return nullptr if bad data was requested in
+  // PrepareAsync() or if the engine has already been taken.
   virtual std::unique_ptr<EngineInterface> BuildFromPreparedData() = 0;
 
   // Clears internal states to accept next request.
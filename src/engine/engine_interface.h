@@ -37,6 +37,11 @@
 
 namespace mozc {
 
+namespace commands {
+class MemoryUsage;
+class RewriterStatistics;
+}  // namespace commands
+
 class ConverterInterface;
 class PredictorInterface;
 class UserDataManagerInterface;
@@ -73,6 +78,19 @@ class EngineInterface {
   // Gets the data manager.
   virtual const DataManagerInterface *GetDataManager() const = 0;
 
+  // Fills the per-rewriter statistics for debugging.  Returns false if the
+  // engine doesn't collect them.
+  virtual bool GetRewriterStatistics(
+      commands::RewriterStatistics *statistics) const {
+    return false;
+  }
+
+  // Adds the estimated memory usage of the components to |usage|.  Returns
+  // false if the engine doesn't support it.
+  virtual bool GetMemoryUsage(commands::MemoryUsage *usage) const {
+    return false;
+  }
+
  protected:
   EngineInterface() {}
 
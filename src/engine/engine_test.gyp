@@ -44,6 +44,16 @@
         '../testing/testing.gyp:mozctest',
       ],
     },
+    {
+      'target_name': 'embedded_engine_test',
+      'type': 'executable',
+      'sources': ['embedded_engine_test.cc'],
+      'dependencies': [
+        'engine.gyp:embedded_engine',
+        'engine.gyp:minimal_engine',
+        '../testing/testing.gyp:gtest_main',
+      ],
+    },
     {
       'target_name': 'install_engine_builder_test_src',
       'type': 'none',
@@ -61,6 +71,7 @@
       'target_name': 'engine_all_test',
       'type': 'none',
       'dependencies': [
+        'embedded_engine_test',
         'engine_builder_test',
       ],
     },
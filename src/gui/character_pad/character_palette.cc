@@ -30,18 +30,21 @@
 #include "gui/character_pad/character_palette.h"
 
 #include <QtGui/QtGui>
+#include <QtWidgets/QHeaderView>
 #include <QtWidgets/QMessageBox>
 
+#include <vector>
+
 #ifdef OS_WIN
 #include <Windows.h>
 #endif  // OS_WIN
 
 #include "base/logging.h"
-#include "base/util.h"
 #include "client/client.h"
 #include "config/stats_config_util.h"
 #include "gui/base/win_util.h"
 #include "gui/character_pad/data/local_character_map.h"
+#include "gui/character_pad/character_palette_table_model.h"
 #include "gui/character_pad/data/unicode_blocks.h"
 #include "gui/character_pad/selection_handler.h"
 #include "protocol/commands.pb.h"
@@ -50,8 +53,6 @@ namespace mozc {
 namespace gui {
 namespace {
 
-const char32 kHexBase = 16;
-
 const char kUNICODEName[]  = "Unicode";
 const char kCP932Name[]    = "Shift JIS";
 const char kJISX0201Name[] = "JISX 0201";
@@ -92,7 +93,8 @@ QTreeWidgetItem *AddItem(QTreeWidgetItem *parent, const char *name) {
 
 CharacterPalette::CharacterPalette(QWidget *parent)
     : QMainWindow(parent),
-      usage_stats_enabled_(mozc::config::StatsConfigUtil::IsEnabled()) {
+      usage_stats_enabled_(mozc::config::StatsConfigUtil::IsEnabled()),
+      table_model_(new CharacterPaletteTableModel(this)) {
   // To reduce the disk IO of reading the stats config, we load it only when the
   // class is initialized. There is no problem because the config dialog (on
   // Mac) and the administrator dialog (on Windows) say that the usage stats
@@ -102,6 +104,7 @@ CharacterPalette::CharacterPalette(QWidget *parent)
     client_.reset(client::ClientFactory::NewClient());
   }
   setupUi(this);
+  tableWidget->setModel(table_model_);
 
   fontComboBox->setWritingSystem(
       static_cast<QFontDatabase::WritingSystem>(QFontDatabase::Any));
@@ -120,9 +123,9 @@ CharacterPalette::CharacterPalette(QWidget *parent)
   fontComboBox->setCurrentFont(tableWidget->font());
 
   QObject::connect(tableWidget,
-                   SIGNAL(itemSelected(const QTableWidgetItem*)),
+                   SIGNAL(itemSelected(const QModelIndex &)),
                    this,
-                   SLOT(itemSelected(const QTableWidgetItem*)));
+                   SLOT(itemSelected(const QModelIndex &)));
 
   // Category Tree
   QObject::connect(categoryTreeWidget,
@@ -230,10 +233,9 @@ void CharacterPalette::updateFontSize(int index) {
   updateTableSize();
   tableWidget->adjustSize();
 
-  QTableWidgetItem *item = tableWidget->currentItem();
-  if (item != NULL) {
-    tableWidget->scrollToItem(item,
-                              QAbstractItemView::PositionAtCenter);
+  const QModelIndex index = tableWidget->currentIndex();
+  if (index.isValid()) {
+    tableWidget->scrollTo(index, QAbstractItemView::PositionAtCenter);
   }
 }
 
@@ -255,13 +257,11 @@ void CharacterPalette::updateTableSize() {
   const int height = static_cast<int>(rect.height() * 1.2);
 #endif
 
-  for (int j = 0; j < tableWidget->columnCount(); ++j) {
-    tableWidget->setColumnWidth(j, width);
-  }
-  for (int j = 0; j < tableWidget->rowCount(); ++j) {
-    tableWidget->setRowHeight(j, height);
-  }
-  tableWidget->setLookupResultItem(NULL);
+  // Setting the default sizes doesn't iterate over the rows, which are
+  // more than 4000 for the Unicode tables.
+  tableWidget->horizontalHeader()->setDefaultSectionSize(width);
+  tableWidget->verticalHeader()->setDefaultSectionSize(height);
+  tableWidget->setLookupResultIndex(QModelIndex());
 }
 
 void CharacterPalette::categorySelected(QTreeWidgetItem *item,
@@ -291,7 +291,7 @@ void CharacterPalette::categorySelected(QTreeWidgetItem *item,
   }
 }
 
-void CharacterPalette::itemSelected(const QTableWidgetItem *item) {
+void CharacterPalette::itemSelected(const QModelIndex &index) {
   if (!usage_stats_enabled_) {
     return;
   }
@@ -308,41 +308,10 @@ void CharacterPalette::itemSelected(const QTableWidgetItem *item) {
 
 // Unicode operations
 void CharacterPalette::showUnicodeTableByRange(const UnicodeRange &range) {
-  tableWidget->hide();
-  tableWidget->clear();
-
-  QStringList column_header;
-  for (int col = 0; col < kHexBase; ++col) {
-    column_header << QString::number(col, kHexBase).toUpper();
-  }
-
-  QStringList row_header;
-  for (char32 ucs4 = range.first; ucs4 <= range.last; ucs4 += kHexBase) {
-    QString str;
-    str.sprintf("U+%3.3X0", ucs4 / kHexBase);
-    row_header << str;
-  }
-
-  tableWidget->setColumnCount(kHexBase);
-  tableWidget->setRowCount(row_header.size());
-
-  tableWidget->setHorizontalHeaderLabels(column_header);
-  tableWidget->setVerticalHeaderLabels(row_header);
-
-  const char32 offset = range.first / kHexBase;
-  for (char32 ucs4 = range.first; ucs4 <= range.last; ++ucs4) {
-    const char32 ucs4s[] = { ucs4 };
-    QTableWidgetItem *item =
-        new QTableWidgetItem(QString::fromUcs4(ucs4s, arraysize(ucs4s)));
-    item->setTextAlignment(Qt::AlignCenter);
-    tableWidget->setItem(ucs4 / kHexBase - offset, ucs4 % kHexBase, item);
-    tableWidget->setEditTriggers(QAbstractItemView::NoEditTriggers);
-  }
-
-  tableWidget->scrollToItem(tableWidget->item(0, 0),
-                            QAbstractItemView::PositionAtTop);
-  tableWidget->setLookupResultItem(NULL);
-  tableWidget->show();
+  table_model_->SetUnicodeRange(range.first, range.last);
+  tableWidget->scrollTo(table_model_->IndexOfCode(range.first),
+                        QAbstractItemView::PositionAtTop);
+  tableWidget->setLookupResultIndex(QModelIndex());
 }
 
 void CharacterPalette::showSJISBlockTable(const QString &name) {
@@ -360,18 +329,13 @@ void CharacterPalette::showSJISBlockTable(const QString &name) {
 
   showLocalTable(kCP932Map, kCP932MapSize);
 
-  tableWidget->hide();
-  QTableWidgetItem *item = tableWidget->item(block->from / kHexBase -
-                                             kCP932Map[0].from / kHexBase,
-                                             block->from % kHexBase);
-
-  if (item != NULL) {
-    tableWidget->scrollToItem(item, QAbstractItemView::PositionAtTop);
-    item->setSelected(true);
+  const QModelIndex index = table_model_->IndexOfCode(block->from);
+  if (index.isValid()) {
+    tableWidget->scrollTo(index, QAbstractItemView::PositionAtTop);
+    tableWidget->setCurrentIndex(index);
   }
 
-  tableWidget->setLookupResultItem(NULL);
-  tableWidget->show();
+  tableWidget->setLookupResultIndex(QModelIndex());
 }
 
 void CharacterPalette::showUnicodeTableByBlockName(const QString &block_name) {
@@ -386,50 +350,19 @@ void CharacterPalette::showUnicodeTableByBlockName(const QString &block_name) {
 // Local table
 void CharacterPalette::showLocalTable(const LocalCharacterMap *local_map,
                                       size_t local_map_size) {
-  tableWidget->hide();
-  tableWidget->clear();
-
-  QStringList column_header;
-  for (int col = 0; col < kHexBase; ++col) {
-    column_header << QString::number(col, kHexBase).toUpper();
-  }
-
-  // find range
-  const int from_start = local_map[0].from;
-  const int from_end   = local_map[local_map_size - 1].from + kHexBase;
-
-  QStringList row_header;
-  for (int i = from_start; i < from_end; i += kHexBase) {
-    QString str;
-    str.sprintf("0x%X0", i / kHexBase);
-    row_header << str;
-  }
-
-  tableWidget->setColumnCount(kHexBase);
-  tableWidget->setRowCount(row_header.size());
-
-  tableWidget->setHorizontalHeaderLabels(column_header);
-  tableWidget->setVerticalHeaderLabels(row_header);
-
-  const int offset = from_start / kHexBase;
+  // Builds the flat index from the code to the character, which the model
+  // looks up when a cell is painted.  local_map is sorted by the code.
+  const uint32 first = local_map[0].from;
+  const uint32 last = local_map[local_map_size - 1].from;
+  std::vector<char32> cells(last - first + 1, 0);
   for (size_t i = 0; i < local_map_size; ++i) {
-    // We do not use QString(QChar(i)) but Util::UCS4ToUTF8 because
-    // QChar is only 16-bit.
-    string utf8;
-    Util::UCS4ToUTF8(local_map[i].ucs2, &utf8);
-    QTableWidgetItem *item = new QTableWidgetItem(
-        QString::fromUtf8(utf8.data(), utf8.size()));
-    item->setTextAlignment(Qt::AlignCenter);
-    tableWidget->setItem(local_map[i].from / kHexBase - offset,
-                         local_map[i].from % kHexBase, item);
-    tableWidget->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    cells[local_map[i].from - first] = local_map[i].ucs2;
   }
+  table_model_->SetLocalCells(first, &cells);
 
-  tableWidget->scrollToItem(tableWidget->item(0, 0),
-                            QAbstractItemView::PositionAtCenter);
-
-  tableWidget->setLookupResultItem(NULL);
-  tableWidget->show();
+  tableWidget->scrollTo(table_model_->IndexOfCode(first),
+                        QAbstractItemView::PositionAtCenter);
+  tableWidget->setLookupResultIndex(QModelIndex());
 }
 
 }  // namespace gui
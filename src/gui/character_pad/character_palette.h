@@ -47,6 +47,7 @@ class ClientInterface;
 }  // namespace client
 
 namespace gui {
+class CharacterPaletteTableModel;
 
 class CharacterPalette :  public QMainWindow,
                           private Ui::CharacterPalette {
@@ -81,7 +82,7 @@ class CharacterPalette :  public QMainWindow,
   void updateFontSize(int index);
   void updateFont(const QFont &font);
   void categorySelected(QTreeWidgetItem *item, int column);
-  void itemSelected(const QTableWidgetItem *item);
+  void itemSelected(const QModelIndex &index);
 
  protected:
   std::unique_ptr<client::ClientInterface> client_;
@@ -102,6 +103,8 @@ class CharacterPalette :  public QMainWindow,
   void showSJISBlockTable(const QString &name);
 
   QMap<QString, UnicodeRange> unicode_block_map_;
+  // Owned by this window as a QObject child.
+  CharacterPaletteTableModel *table_model_;
 };
 }  // namespace gui
 }  // namespace mozc
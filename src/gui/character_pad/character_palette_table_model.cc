@@ -0,0 +1,160 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "gui/character_pad/character_palette_table_model.h"
+
+#include "base/logging.h"
+
+namespace mozc {
+namespace gui {
+namespace {
+const int kHexBase = 16;
+}  // namespace
+
+CharacterPaletteTableModel::CharacterPaletteTableModel(QObject *parent)
+    : QAbstractTableModel(parent),
+      is_unicode_(true),
+      first_row_code_(0),
+      first_(0),
+      last_(0) {
+}
+
+CharacterPaletteTableModel::~CharacterPaletteTableModel() {}
+
+void CharacterPaletteTableModel::SetUnicodeRange(char32 first, char32 last) {
+  DCHECK_LE(first, last);
+  beginResetModel();
+  is_unicode_ = true;
+  first_row_code_ = first / kHexBase * kHexBase;
+  first_ = first;
+  last_ = last;
+  cells_.clear();
+  endResetModel();
+}
+
+void CharacterPaletteTableModel::SetLocalCells(uint32 first,
+                                               std::vector<char32> *cells) {
+  DCHECK(cells);
+  DCHECK(!cells->empty());
+  beginResetModel();
+  is_unicode_ = false;
+  first_row_code_ = first / kHexBase * kHexBase;
+  first_ = first;
+  last_ = first + cells->size() - 1;
+  cells_.swap(*cells);
+  endResetModel();
+}
+
+QModelIndex CharacterPaletteTableModel::IndexOfCode(uint32 code) const {
+  if (code < first_ || code > last_) {
+    return QModelIndex();
+  }
+  return index((code - first_row_code_) / kHexBase,
+               (code - first_row_code_) % kHexBase);
+}
+
+char32 CharacterPaletteTableModel::GetCharacter(int row, int column) const {
+  const uint32 code = first_row_code_ + row * kHexBase + column;
+  if (code < first_ || code > last_) {
+    return 0;
+  }
+  if (is_unicode_) {
+    return code;
+  }
+  return cells_[code - first_];
+}
+
+QString CharacterPaletteTableModel::GetText(const QModelIndex &index) const {
+  if (!index.isValid()) {
+    return QString();
+  }
+  const char32 ucs4 = GetCharacter(index.row(), index.column());
+  if (ucs4 == 0) {
+    return QString();
+  }
+  // We do not use QString(QChar(ucs4)) because QChar is only 16-bit.
+  const uint ucs4s[] = { ucs4 };
+  return QString::fromUcs4(ucs4s, arraysize(ucs4s));
+}
+
+int CharacterPaletteTableModel::rowCount(const QModelIndex &parent) const {
+  if (parent.isValid() || last_ < first_row_code_) {
+    return 0;
+  }
+  return (last_ - first_row_code_) / kHexBase + 1;
+}
+
+int CharacterPaletteTableModel::columnCount(const QModelIndex &parent) const {
+  return parent.isValid() ? 0 : kHexBase;
+}
+
+QVariant CharacterPaletteTableModel::data(const QModelIndex &index,
+                                          int role) const {
+  switch (role) {
+    case Qt::DisplayRole: {
+      const QString text = GetText(index);
+      return text.isEmpty() ? QVariant() : QVariant(text);
+    }
+    case Qt::TextAlignmentRole:
+      return static_cast<int>(Qt::AlignCenter);
+    default:
+      return QVariant();
+  }
+}
+
+QVariant CharacterPaletteTableModel::headerData(int section,
+                                                Qt::Orientation orientation,
+                                                int role) const {
+  if (role != Qt::DisplayRole) {
+    return QVariant();
+  }
+  if (orientation == Qt::Horizontal) {
+    return QString::number(section, kHexBase).toUpper();
+  }
+  const uint32 row_code = first_row_code_ / kHexBase + section;
+  QString str;
+  if (is_unicode_) {
+    str.sprintf("U+%3.3X0", row_code);
+  } else {
+    str.sprintf("0x%X0", row_code);
+  }
+  return str;
+}
+
+Qt::ItemFlags CharacterPaletteTableModel::flags(
+    const QModelIndex &index) const {
+  if (!index.isValid() || GetCharacter(index.row(), index.column()) == 0) {
+    return Qt::NoItemFlags;
+  }
+  return Qt::ItemIsEnabled | Qt::ItemIsSelectable;
+}
+
+}  // namespace gui
+}  // namespace mozc
@@ -0,0 +1,96 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// Table model of the character palette.  The characters are never stored in
+// QTableWidgetItems; each cell is materialized from a flat codepoint index
+// only when the view paints it.
+
+#ifndef MOZC_GUI_CHARACTER_PAD_CHARACTER_PALETTE_TABLE_MODEL_H_
+#define MOZC_GUI_CHARACTER_PAD_CHARACTER_PALETTE_TABLE_MODEL_H_
+
+#include <QtCore/QAbstractTableModel>
+
+#include <vector>
+
+#include "base/port.h"
+
+namespace mozc {
+namespace gui {
+
+class CharacterPaletteTableModel : public QAbstractTableModel {
+ public:
+  explicit CharacterPaletteTableModel(QObject *parent);
+  virtual ~CharacterPaletteTableModel();
+
+  // Shows the Unicode characters from |first| to |last|.  Rows are labeled
+  // as "U+XXX0".
+  void SetUnicodeRange(char32 first, char32 last);
+
+  // Shows the characters in |cells|, where |cells|[i] is the character of
+  // the code |first| + i in a local character set, or 0 if the code has no
+  // character.  Rows are labeled as "0xXXX0".  |cells| is swapped into the
+  // model.
+  void SetLocalCells(uint32 first, std::vector<char32> *cells);
+
+  // Returns the index of the cell for |code|, which is a codepoint for
+  // Unicode ranges or a code of the local character set.
+  QModelIndex IndexOfCode(uint32 code) const;
+
+  // Returns the text of the cell, or an empty string for an empty cell.
+  QString GetText(const QModelIndex &index) const;
+
+  // QAbstractTableModel implementation.
+  int rowCount(const QModelIndex &parent) const;
+  int columnCount(const QModelIndex &parent) const;
+  QVariant data(const QModelIndex &index, int role) const;
+  QVariant headerData(int section, Qt::Orientation orientation,
+                      int role) const;
+  Qt::ItemFlags flags(const QModelIndex &index) const;
+
+ private:
+  // Returns the character in the cell, or 0 if the cell is empty.
+  char32 GetCharacter(int row, int column) const;
+
+  bool is_unicode_;
+  // The first code of the first row, which is aligned to 16.
+  uint32 first_row_code_;
+  // The code range shown in the table.
+  uint32 first_;
+  uint32 last_;
+  // Characters of the local character set.  Unused for Unicode ranges.
+  std::vector<char32> cells_;
+
+  DISALLOW_COPY_AND_ASSIGN(CharacterPaletteTableModel);
+};
+
+}  // namespace gui
+}  // namespace mozc
+
+#endif  // MOZC_GUI_CHARACTER_PAD_CHARACTER_PALETTE_TABLE_MODEL_H_
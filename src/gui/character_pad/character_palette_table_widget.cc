@@ -31,6 +31,7 @@
 
 #include <QtGui/QtGui>
 #include <QtCore/QTextCodec>
+#include <QtWidgets/QHeaderView>
 #include <QtWidgets/QToolTip>
 
 #include "gui/character_pad/selection_handler.h"
@@ -40,38 +41,51 @@ namespace mozc {
 namespace gui {
 
 CharacterPaletteTableWidget::CharacterPaletteTableWidget(QWidget *parent)
-    : QTableWidget(parent),
-      lookup_result_item_(NULL) {
+    : QTableView(parent) {
   setMouseTracking(true);
   setSelectionMode(QAbstractItemView::SingleSelection);
   setSelectionBehavior(QAbstractItemView::SelectItems);
+  setEditTriggers(QAbstractItemView::NoEditTriggers);
+  // All the cells have the same size, so the view doesn't need to measure
+  // each row and column.
+  horizontalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+  verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+}
+
+QString CharacterPaletteTableWidget::GetText(const QModelIndex &index) const {
+  if (!index.isValid()) {
+    return QString();
+  }
+  return index.data(Qt::DisplayRole).toString();
 }
 
 void CharacterPaletteTableWidget::mouseReleaseEvent(QMouseEvent *event) {
   if (event->button() != Qt::LeftButton) {
     return;
   }
-  QTableWidgetItem *item = itemAt(event->pos());
-  if (item == NULL) {
+  const QModelIndex index = indexAt(event->pos());
+  const QString text = GetText(index);
+  if (text.isEmpty()) {
     return;
   }
-  SelectionHandler::Select(item->text());
-  emit itemSelected(item);
+  SelectionHandler::Select(text);
+  emit itemSelected(index);
 }
 
 void CharacterPaletteTableWidget::mouseMoveEvent(QMouseEvent *event) {
-  QTableWidgetItem *item = itemAt(event->pos());
-  if (item == NULL) {
+  const QModelIndex index = indexAt(event->pos());
+  const QString text = GetText(index);
+  if (text.isEmpty()) {
     return;
   }
 
-  if (lookup_result_item_ == NULL || lookup_result_item_ == item) {
-    setCurrentItem(item);
-    QTableWidget::mousePressEvent(event);
+  if (!lookup_result_index_.isValid() || lookup_result_index_ == index) {
+    setCurrentIndex(index);
+    QTableView::mousePressEvent(event);
     QToolTip::showText(event->globalPos(),
-                       UnicodeUtil::GetToolTip(font(), item->text()),
+                       UnicodeUtil::GetToolTip(font(), text),
                        this);
-    setLookupResultItem(NULL);
+    setLookupResultIndex(QModelIndex());
   }
 }
 }  // namespace gui
@@ -30,33 +30,38 @@
 #ifndef MOZC_GUI_CHARACTER_PAD_CHARACTER_PALETTE_TABLE_WIDGET_H_
 #define MOZC_GUI_CHARACTER_PAD_CHARACTER_PALETTE_TABLE_WIDGET_H_
 
-#include <QtWidgets/QTableWidget>
+#include <QtCore/QModelIndex>
+#include <QtWidgets/QTableView>
 
 class QTextCodec;
-class QTableWidgetItem;
 
 namespace mozc {
 namespace gui {
 
-class CharacterPaletteTableWidget : public QTableWidget {
+// The view of the character palette.  The cells are provided by
+// CharacterPaletteTableModel, so only the visible cells are materialized.
+class CharacterPaletteTableWidget : public QTableView {
   Q_OBJECT;
 
  public:
   explicit CharacterPaletteTableWidget(QWidget *parent);
 
-  void setLookupResultItem(QTableWidgetItem *item) {
-    lookup_result_item_ = item;
+  void setLookupResultIndex(const QModelIndex &index) {
+    lookup_result_index_ = index;
   }
 
  signals:
-  void itemSelected(const QTableWidgetItem *item);
+  void itemSelected(const QModelIndex &index);
 
  protected:
   void mouseReleaseEvent(QMouseEvent *event);
   void mouseMoveEvent(QMouseEvent *event);
 
  private:
-  QTableWidgetItem *lookup_result_item_;
+  // Returns the text of the cell at |index|.
+  QString GetText(const QModelIndex &index) const;
+
+  QPersistentModelIndex lookup_result_index_;
 };
 }  // namspace gui
 }  // namespace mozc
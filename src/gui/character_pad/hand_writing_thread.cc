@@ -96,17 +96,23 @@ void HandWritingThread::Start() {
 
 void HandWritingThread::SetStrokes(const handwriting::Strokes &strokes) {
   CopyStrokes(strokes, &strokes_, &strokes_mutex_);
-  // This is absolutely thread-unsafe but practically no problems.
+  QMutexLocker l(&strokes_mutex_);
   Clock::GetTimeOfDay(&strokes_sec_, &strokes_usec_);
 }
 
+bool HandWritingThread::IsLatestStrokes(uint64 sec, uint32 usec) {
+  QMutexLocker l(&strokes_mutex_);
+  return strokes_sec_ == sec && strokes_usec_ == usec;
+}
+
 void HandWritingThread::GetCandidates(std::vector<string> *candidates) {
   CopyCandidates(candidates_, candidates, &candidates_mutex_);
 }
 
 void HandWritingThread::startRecognition() {
-  if (last_requested_sec_ == strokes_sec_ &&
-      last_requested_usec_ == strokes_usec_) {
+  // Requests queued while the previous recognition was running are coalesced
+  // here: all of them see the latest strokes, so only the first one runs.
+  if (IsLatestStrokes(last_requested_sec_, last_requested_usec_)) {
     LOG(WARNING) << "Already sent that stroke";
     return;
   }
@@ -114,16 +120,28 @@ void HandWritingThread::startRecognition() {
   emit statusUpdated(status);
 
   handwriting::Strokes strokes;
-  CopyStrokes(strokes_, &strokes, &strokes_mutex_);
+  uint64 strokes_sec = 0;
+  uint32 strokes_usec = 0;
+  {
+    QMutexLocker l(&strokes_mutex_);
+    strokes = strokes_;
+    strokes_sec = strokes_sec_;
+    strokes_usec = strokes_usec_;
+  }
   if (strokes.empty()) {
     return;
   }
 
   std::vector<string> candidates;
   status = handwriting::HandwritingManager::Recognize(strokes, &candidates);
+  last_requested_sec_ = strokes_sec;
+  last_requested_usec_ = strokes_usec;
+  if (!IsLatestStrokes(strokes_sec, strokes_usec)) {
+    // A new stroke has arrived during the recognition and its request is
+    // already queued.  The result for the stale strokes is discarded.
+    return;
+  }
   CopyCandidates(candidates, &candidates_, &candidates_mutex_);
-  last_requested_sec_ = strokes_sec_;
-  last_requested_usec_ = strokes_usec_;
   emit candidatesUpdated();
   emit statusUpdated(status);
 }
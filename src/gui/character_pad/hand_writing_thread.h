@@ -70,6 +70,9 @@ class HandWritingThread : public QThread {
   void statusUpdated(mozc::handwriting::HandwritingStatus status);
 
  private:
+  // Returns true if the strokes set by SetStrokes() have the timestamp.
+  bool IsLatestStrokes(uint64 sec, uint32 usec);
+
   handwriting::Strokes strokes_;
   std::vector<string> candidates_;
 
@@ -0,0 +1,231 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "gui/dictionary_tool/dictionary_content_table_model.h"
+
+#include <algorithm>
+#include <string>
+
+#include "base/logging.h"
+#include "dictionary/user_dictionary_util.h"
+
+namespace mozc {
+namespace gui {
+
+using ::mozc::user_dictionary::UserDictionary;
+
+namespace {
+
+const string &GetText(const UserDictionary::Entry &entry, int column) {
+  switch (column) {
+    case DictionaryContentTableModel::READING_COLUMN:
+      return entry.key();
+    case DictionaryContentTableModel::WORD_COLUMN:
+      return entry.value();
+    case DictionaryContentTableModel::COMMENT_COLUMN:
+      return entry.comment();
+    default:
+      LOG(DFATAL) << "Unexpected column: " << column;
+      return entry.key();
+  }
+}
+
+// Orders entries by the text shown in the column.
+class EntryLess {
+ public:
+  EntryLess(int column, Qt::SortOrder order)
+      : column_(column), order_(order) {}
+
+  bool operator()(const UserDictionary::Entry *lhs,
+                  const UserDictionary::Entry *rhs) const {
+    if (order_ == Qt::DescendingOrder) {
+      std::swap(lhs, rhs);
+    }
+    if (column_ == DictionaryContentTableModel::CATEGORY_COLUMN) {
+      return strcmp(UserDictionaryUtil::GetStringPosType(lhs->pos()),
+                    UserDictionaryUtil::GetStringPosType(rhs->pos())) < 0;
+    }
+    return GetText(*lhs, column_) < GetText(*rhs, column_);
+  }
+
+ private:
+  const int column_;
+  const Qt::SortOrder order_;
+};
+
+}  // namespace
+
+DictionaryContentTableModel::DictionaryContentTableModel(QObject *parent)
+    : QAbstractTableModel(parent), dictionary_(NULL) {
+}
+
+DictionaryContentTableModel::~DictionaryContentTableModel() {}
+
+void DictionaryContentTableModel::SetDictionary(
+    UserDictionary *dictionary) {
+  beginResetModel();
+  dictionary_ = dictionary;
+  endResetModel();
+}
+
+void DictionaryContentTableModel::SetHeaderLabels(const QStringList &labels) {
+  header_labels_ = labels;
+  emit headerDataChanged(Qt::Horizontal, 0, NUM_COLUMNS - 1);
+}
+
+int DictionaryContentTableModel::size() const {
+  return dictionary_ == NULL ? 0 : dictionary_->entries_size();
+}
+
+const UserDictionary::Entry &DictionaryContentTableModel::entry(
+    int row) const {
+  DCHECK(dictionary_);
+  return dictionary_->entries(row);
+}
+
+int DictionaryContentTableModel::AddEntry(UserDictionary::PosType pos) {
+  DCHECK(dictionary_);
+  const int row = dictionary_->entries_size();
+  beginInsertRows(QModelIndex(), row, row);
+  dictionary_->add_entries()->set_pos(pos);
+  endInsertRows();
+  return row;
+}
+
+void DictionaryContentTableModel::RemoveEntries(const std::vector<int> &rows) {
+  if (dictionary_ == NULL || rows.empty()) {
+    return;
+  }
+  beginResetModel();
+  std::vector<bool> removed(dictionary_->entries_size(), false);
+  for (size_t i = 0; i < rows.size(); ++i) {
+    DCHECK(i == 0 || rows[i - 1] > rows[i]);
+    removed[rows[i]] = true;
+  }
+  // Compacts the remaining entries in one pass.
+  int size = 0;
+  for (int i = 0; i < dictionary_->entries_size(); ++i) {
+    if (removed[i]) {
+      continue;
+    }
+    if (i != size) {
+      dictionary_->mutable_entries()->SwapElements(i, size);
+    }
+    ++size;
+  }
+  while (dictionary_->entries_size() > size) {
+    dictionary_->mutable_entries()->RemoveLast();
+  }
+  endResetModel();
+}
+
+int DictionaryContentTableModel::rowCount(const QModelIndex &parent) const {
+  return parent.isValid() ? 0 : size();
+}
+
+int DictionaryContentTableModel::columnCount(const QModelIndex &parent) const {
+  return parent.isValid() ? 0 : NUM_COLUMNS;
+}
+
+QVariant DictionaryContentTableModel::data(const QModelIndex &index,
+                                           int role) const {
+  if (!index.isValid() || index.row() >= size() ||
+      (role != Qt::DisplayRole && role != Qt::EditRole)) {
+    return QVariant();
+  }
+  const UserDictionary::Entry &dic_entry = entry(index.row());
+  if (index.column() == CATEGORY_COLUMN) {
+    return QString::fromUtf8(
+        UserDictionaryUtil::GetStringPosType(dic_entry.pos()));
+  }
+  const string &text = GetText(dic_entry, index.column());
+  return QString::fromUtf8(text.data(), text.size());
+}
+
+bool DictionaryContentTableModel::setData(const QModelIndex &index,
+                                          const QVariant &value, int role) {
+  if (!index.isValid() || index.row() >= size() || role != Qt::EditRole) {
+    return false;
+  }
+  UserDictionary::Entry *dic_entry =
+      dictionary_->mutable_entries(index.row());
+  const string text = value.toString().toStdString();
+  switch (index.column()) {
+    case READING_COLUMN:
+      dic_entry->set_key(text);
+      break;
+    case WORD_COLUMN:
+      dic_entry->set_value(text);
+      break;
+    case CATEGORY_COLUMN:
+      dic_entry->set_pos(UserDictionaryUtil::ToPosType(text.c_str()));
+      break;
+    case COMMENT_COLUMN:
+      dic_entry->set_comment(text);
+      break;
+    default:
+      return false;
+  }
+  UserDictionaryUtil::SanitizeEntry(dic_entry);
+  emit dataChanged(index, index);
+  return true;
+}
+
+QVariant DictionaryContentTableModel::headerData(int section,
+                                                 Qt::Orientation orientation,
+                                                 int role) const {
+  if (role != Qt::DisplayRole || orientation != Qt::Horizontal ||
+      section < 0 || section >= header_labels_.size()) {
+    return QAbstractTableModel::headerData(section, orientation, role);
+  }
+  return header_labels_[section];
+}
+
+Qt::ItemFlags DictionaryContentTableModel::flags(
+    const QModelIndex &index) const {
+  if (!index.isValid()) {
+    return Qt::NoItemFlags;
+  }
+  return Qt::ItemIsEnabled | Qt::ItemIsSelectable | Qt::ItemIsEditable;
+}
+
+void DictionaryContentTableModel::sort(int column, Qt::SortOrder order) {
+  if (dictionary_ == NULL || column < 0 || column >= NUM_COLUMNS) {
+    return;
+  }
+  beginResetModel();
+  std::stable_sort(dictionary_->mutable_entries()->pointer_begin(),
+                   dictionary_->mutable_entries()->pointer_end(),
+                   EntryLess(column, order));
+  endResetModel();
+}
+
+}  // namespace gui
+}  // namespace mozc
@@ -0,0 +1,101 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef MOZC_GUI_DICTIONARY_TOOL_DICTIONARY_CONTENT_TABLE_MODEL_H_
+#define MOZC_GUI_DICTIONARY_TOOL_DICTIONARY_CONTENT_TABLE_MODEL_H_
+
+#include <QtCore/QAbstractTableModel>
+#include <QtCore/QStringList>
+
+#include <vector>
+
+#include "base/port.h"
+#include "protocol/user_dictionary_storage.pb.h"
+
+namespace mozc {
+namespace gui {
+
+// Table model which shows the entries of a user dictionary.  The entries are
+// read from and written to the UserDictionary in the storage directly, so no
+// per-cell object is created and the view only asks for the visible cells.
+class DictionaryContentTableModel : public QAbstractTableModel {
+ public:
+  enum Column {
+    READING_COLUMN = 0,
+    WORD_COLUMN = 1,
+    CATEGORY_COLUMN = 2,
+    COMMENT_COLUMN = 3,
+    NUM_COLUMNS = 4,
+  };
+
+  explicit DictionaryContentTableModel(QObject *parent);
+  virtual ~DictionaryContentTableModel();
+
+  // Sets the dictionary to be shown.  |dictionary| is not owned and must
+  // outlive the model or be replaced before it is deleted.  NULL clears the
+  // table.
+  void SetDictionary(user_dictionary::UserDictionary *dictionary);
+
+  void SetHeaderLabels(const QStringList &labels);
+
+  // Returns the number of entries in the dictionary.
+  int size() const;
+
+  const user_dictionary::UserDictionary::Entry &entry(int row) const;
+
+  // Appends an empty entry with |pos| and returns its row.
+  int AddEntry(user_dictionary::UserDictionary::PosType pos);
+
+  // Removes the entries in |rows|, which must be sorted in descending order
+  // without duplicates.  The order of the remaining entries is kept.
+  void RemoveEntries(const std::vector<int> &rows);
+
+  // QAbstractTableModel implementation.
+  int rowCount(const QModelIndex &parent) const;
+  int columnCount(const QModelIndex &parent) const;
+  QVariant data(const QModelIndex &index, int role) const;
+  bool setData(const QModelIndex &index, const QVariant &value, int role);
+  QVariant headerData(int section, Qt::Orientation orientation,
+                      int role) const;
+  Qt::ItemFlags flags(const QModelIndex &index) const;
+  // Sorts the entries in the dictionary itself so that the order is saved.
+  void sort(int column, Qt::SortOrder order);
+
+ private:
+  user_dictionary::UserDictionary *dictionary_;
+  QStringList header_labels_;
+
+  DISALLOW_COPY_AND_ASSIGN(DictionaryContentTableModel);
+};
+
+}  // namespace gui
+}  // namespace mozc
+
+#endif  // MOZC_GUI_DICTIONARY_TOOL_DICTIONARY_CONTENT_TABLE_MODEL_H_
@@ -32,7 +32,7 @@
 #include <QtGui/QtGui>
 
 DictionaryContentTableWidget::DictionaryContentTableWidget(QWidget *parent)
-    : QTableWidget(parent) {}
+    : QTableView(parent) {}
 
 void DictionaryContentTableWidget::paintEvent(QPaintEvent *event) {
   QTableView::paintEvent(event);
@@ -48,16 +48,17 @@ void DictionaryContentTableWidget::paintEvent(QPaintEvent *event) {
 
   QRect rect;
   int alternate_index = 0;
-  if (rowCount() == 0) {
+  const int row_count = model() == NULL ? 0 : model()->rowCount();
+  if (row_count == 0) {
     rect.setRect(0, 0, 1, kDefaultHeight);
     alternate_index = 1;
   } else {
-    QTableWidgetItem *last_item = item(rowCount() - 1, 0);
-    if (last_item == NULL) {
+    const QModelIndex last_index = model()->index(row_count - 1, 0);
+    if (!last_index.isValid()) {
       return;
     }
-    rect = visualItemRect(last_item);
-    alternate_index = rowCount();
+    rect = visualRect(last_index);
+    alternate_index = row_count;
   }
 
   int start_offset = rect.y() + rect.height();
@@ -78,7 +79,7 @@ void DictionaryContentTableWidget::mouseDoubleClickEvent(QMouseEvent *event) {
 
   // When empty area is double-clicked, emit a signal
 #ifdef OS_MACOSX
-  if (NULL == itemAt(event->pos())) {
+  if (!indexAt(event->pos()).isValid()) {
     emit emptyAreaClicked();
   }
 #endif  // OS_MACOSX
@@ -30,12 +30,12 @@
 #ifndef MOZC_GUI_DICTIONARY_TOOL_DICTIONARY_CONTENT_TABLE_WIDGET_H_
 #define MOZC_GUI_DICTIONARY_TOOL_DICTIONARY_CONTENT_TABLE_WIDGET_H_
 
-#include <QtWidgets/QTableWidget>
+#include <QtWidgets/QTableView>
 
 namespace mozc {
 namespace gui {
 
-class DictionaryContentTableWidget : public QTableWidget {
+class DictionaryContentTableWidget : public QTableView {
   Q_OBJECT;
  public:
 
@@ -52,7 +52,6 @@
 #include <string>
 #include <vector>
 
-#include "base/file_stream.h"
 #include "base/logging.h"
 #include "base/run_level.h"
 #include "base/util.h"
@@ -66,6 +65,7 @@
 #include "gui/base/msime_user_dictionary_importer.h"
 #include "gui/base/win_util.h"
 #include "gui/config_dialog/combobox_delegate.h"
+#include "gui/dictionary_tool/dictionary_content_table_model.h"
 #include "gui/dictionary_tool/find_dialog.h"
 #include "gui/dictionary_tool/import_dialog.h"
 #include "protocol/user_dictionary_storage.pb.h"
@@ -83,7 +83,7 @@ using ::mozc::user_dictionary::UserDictionaryStorage;
 // to reload all user dictionary.
 const int kSessionTimeout = 100000;
 
-int GetTableHeight(QTableWidget *widget) {
+int GetTableHeight(QTableView *widget) {
   // Dragon Hack:
   // Here we use "龍" to calc font size, as it looks almsot square
   const char kHexBaseChar[] = "龍";
@@ -185,46 +185,22 @@ class MultiByteTextLineIterator
       const string &filename,
       const QString &message, QWidget *parent)
       : encoding_type_(encoding_type),
-        ifs_(new InputFileStream(filename.c_str())),
+        iter_(filename),
         first_line_(true) {
-    const std::streampos begin = ifs_->tellg();
-    ifs_->seekg(0, std::ios::end);
-    const size_t size = static_cast<size_t>(ifs_->tellg() - begin);
-    ifs_->seekg(0, std::ios::beg);
-    progress_.reset(CreateProgressDialog(message, parent, size));
+    progress_.reset(CreateProgressDialog(message, parent, iter_.size()));
   }
 
   bool IsAvailable() const {
-    // This means that neither failbit nor badbit is set.
-    // TODO(yukawa): Consider to remove |ifs_->eof()|. Furthermore, we should
-    // replace IsAvailable() with something easier to understand, e.g.,
-    // Done() or HasNext().
-    return ifs_->good() || ifs_->eof();
+    return iter_.IsAvailable();
   }
 
   bool Next(string *line)  {
-    if (!ifs_->good()) {
+    // The file is read in chunks, handling CR only text as well.
+    if (!iter_.Next(line)) {
       return false;
     }
 
-    // Can't use getline as getline doesn't support CR only text.
-    char ch;
-    string output_line;
-    while (ifs_->good()) {
-      ifs_->get(ch);
-      if (output_line.empty() && ch == '\n') {
-        continue;
-      }
-      if (ch == '\n' || ch == '\r') {
-        break;
-      } else {
-        output_line += ch;
-      }
-    }
-
-    progress_->setValue(ifs_->tellg());
-
-    *line = output_line;
+    progress_->setValue(iter_.position());
 
     // We can't use QTextCodec as QTextCodec is not enabled by default.
     // We won't enable it as it increases the binary size.
@@ -246,15 +222,13 @@ class MultiByteTextLineIterator
   }
 
   void Reset() {
-    // Clear state bit (eofbit, failbit, badbit).
-    ifs_->clear();
-    ifs_->seekg(0, std::ios_base::beg);
+    iter_.Reset();
     first_line_ = true;
   }
 
  private:
   UserDictionaryImporter::EncodingType encoding_type_;
-  std::unique_ptr<InputFileStream> ifs_;
+  UserDictionaryImporter::FileTextLineIterator iter_;
   std::unique_ptr<QProgressDialog> progress_;
   bool first_line_;
 };
@@ -304,7 +278,8 @@ DictionaryTool::DictionaryTool(QWidget *parent)
       import_dialog_(NULL), find_dialog_(NULL),
       session_(new UserDictionarySession(
           UserDictionaryUtil::GetUserDictionaryFileName())),
-      current_dic_id_(0), modified_(false), monitoring_user_edit_(false),
+      content_model_(NULL),
+      monitoring_user_edit_(false),
       window_title_(tr("Mozc")),
       dic_menu_(new QMenu),
       new_action_(NULL), rename_action_(NULL),
@@ -316,6 +291,8 @@ DictionaryTool::DictionaryTool(QWidget *parent)
       max_entry_size_(mozc::UserDictionaryStorage::max_entry_size()),
       pos_list_provider_(new POSListProvider()) {
   setupUi(this);
+  content_model_ = new DictionaryContentTableModel(this);
+  dic_content_->setModel(content_model_);
 
   // Create and set up ImportDialog object.
   import_dialog_ = new ImportDialog(this);
@@ -408,11 +385,10 @@ DictionaryTool::DictionaryTool(QWidget *parent)
   }
 
   // Set up the main table widget for dictionary contents.
-  dic_content_->setColumnCount(4);
   QStringList header_labels;
   header_labels << tr("Reading") << tr("Word")
                 << tr("Category") << tr("Comment");
-  dic_content_->setHorizontalHeaderLabels(header_labels);
+  content_model_->SetHeaderLabels(header_labels);
 
 #ifdef OS_MACOSX
   // This is a workaround for MacOSX.
@@ -548,7 +524,6 @@ void DictionaryTool::closeEvent(QCloseEvent *event) {
   // TableView is submitted to the model
   dic_menu_button_->setFocus(Qt::MouseFocusReason);
 
-  SyncToStorage();
   SaveAndReloadServer();
 
   if (session_->mutable_storage()->GetLastError()
@@ -563,7 +538,6 @@ void DictionaryTool::closeEvent(QCloseEvent *event) {
 }
 
 void DictionaryTool::OnDeactivate() {
-  SyncToStorage();
   SaveAndReloadServer();
 }
 
@@ -587,14 +561,10 @@ bool DictionaryTool::eventFilter(QObject *obj, QEvent *event) {
 }
 
 void DictionaryTool::OnDictionarySelectionChanged() {
-  SyncToStorage();
-
   DictionaryInfo dic_info = current_dictionary();
   if (dic_info.item == NULL) {
-    current_dic_id_ = 0;
     StopMonitoringUserEdit();
-    dic_content_->clearContents();
-    dic_content_->setRowCount(0);
+    content_model_->SetDictionary(NULL);
     dic_content_->setEnabled(false);
     StartMonitoringUserEdit();
     new_word_button_->setEnabled(false);
@@ -604,7 +574,6 @@ void DictionaryTool::OnDictionarySelectionChanged() {
     import_append_action_->setEnabled(false);
     export_action_->setEnabled(false);
   } else {
-    current_dic_id_ = dic_info.id;
     max_entry_size_ = mozc::UserDictionaryStorage::max_entry_size();
     SetupDicContentEditor(dic_info);
   }
@@ -629,33 +598,9 @@ void DictionaryTool::SetupDicContentEditor(
   import_append_action_->setEnabled(true);
   export_action_->setEnabled(true);
 
-  setUpdatesEnabled(false);
-
-  dic_content_->clearContents();
-  dic_content_->setRowCount(dic->entries_size());
-
-  {
-    std::unique_ptr<QProgressDialog> progress(CreateProgressDialog(
-        tr("Updating the current view data..."),
-        this,
-        dic->entries_size()));
-
-    for (size_t i = 0; i < dic->entries_size(); ++i) {
-      dic_content_->setItem(
-          i, 0, new QTableWidgetItem(dic->entries(i).key().c_str()));
-      dic_content_->setItem(
-          i, 1, new QTableWidgetItem(dic->entries(i).value().c_str()));
-      dic_content_->setItem(
-          i, 2, new QTableWidgetItem(
-              UserDictionaryUtil::GetStringPosType(dic->entries(i).pos())));
-      dic_content_->setItem(
-          i, 3, new QTableWidgetItem(dic->entries(i).comment().c_str()));
-      progress->setValue(i);
-    }
-  }
-
-  setUpdatesEnabled(true);
-  dic_content_->repaint();
+  // The model reads the entries from the storage when the cells are shown,
+  // so this doesn't depend on the size of the dictionary.
+  content_model_->SetDictionary(dic);
   dic_content_->setEnabled(true);
 
   StartMonitoringUserEdit();
@@ -663,10 +608,8 @@ void DictionaryTool::SetupDicContentEditor(
   // Update state of other GUI components.
   UpdateUIStatus();
 
-  const bool dictionary_is_full = dic_content_->rowCount() >= max_entry_size_;
+  const bool dictionary_is_full = content_model_->size() >= max_entry_size_;
   new_word_button_->setEnabled(!dictionary_is_full);
-
-  modified_ = false;
 }
 
 void DictionaryTool::CreateDictionary() {
@@ -685,8 +628,6 @@ void DictionaryTool::CreateDictionary() {
     return;  // canceld by user
   }
 
-  SyncToStorage();
-
   CreateDictionaryHelper(dic_name);
 }
 
@@ -706,13 +647,15 @@ void DictionaryTool::DeleteDictionary() {
     return;
   }
 
+  // The model refers to the entries of the dictionary to be deleted.
+  content_model_->SetDictionary(NULL);
   if (!session_->mutable_storage()->DeleteDictionary(dic_info.id)) {
     LOG(ERROR) << "Failed to delete the dictionary.";
     ReportError();
+    OnDictionarySelectionChanged();
     return;
   }
 
-  modified_ = false;
   QListWidgetItem *item = dic_list_->takeItem(dic_info.row);
   delete item;
 
@@ -778,7 +721,7 @@ void DictionaryTool::ImportAndAppendDictionary() {
     return;
   }
 
-  if (dic_content_->rowCount() >= max_entry_size_) {
+  if (content_model_->size() >= max_entry_size_) {
     QMessageBox::critical(this, window_title_,
                           tr("You can't have more than %1 "
                              "words in one dictionary.").arg(max_entry_size_));
@@ -875,7 +818,6 @@ void DictionaryTool::ImportHelper(
   }
 
   // Everything looks Okey so far. Now starting import operation.
-  SyncToStorage();
 
   // Open dictionary
   std::unique_ptr<UserDictionaryImporter::TextLineIteratorInterface> iter(
@@ -939,8 +881,6 @@ void DictionaryTool::ImportFromDefaultIME() {
     return;
   }
 
-  SyncToStorage();
-
   UserDictionary *dic =
       session_->mutable_storage()->GetUserDictionary(dic_info.id);
   DCHECK(dic);
@@ -990,8 +930,6 @@ void DictionaryTool::ExportDictionary() {
     return;
   }
 
-  SyncToStorage();
-
   if (!session_->mutable_storage()->ExportDictionary(dic_info.id, file_name)) {
     LOG(ERROR) << "Failed to export the dictionary.";
     ReportError();
@@ -1003,8 +941,7 @@ void DictionaryTool::ExportDictionary() {
 }
 
 void DictionaryTool::AddWord() {
-  const int row = dic_content_->rowCount();
-  if (row >= max_entry_size_) {
+  if (content_model_->size() >= max_entry_size_) {
     QMessageBox::information(
         this, window_title_,
         tr("You can't have more than %1 words in one dictionary.").arg(
@@ -1012,19 +949,17 @@ void DictionaryTool::AddWord() {
     return;
   }
 
-  dic_content_->insertRow(row);
-  dic_content_->setItem(row, 0, new QTableWidgetItem(""));
-  dic_content_->setItem(row, 1, new QTableWidgetItem(""));
-  dic_content_->setItem(row, 2, new QTableWidgetItem(default_pos_));
-  dic_content_->setItem(row, 3, new QTableWidgetItem(""));
+  const int row = content_model_->AddEntry(
+      UserDictionaryUtil::ToPosType(default_pos_.toStdString().c_str()));
 
   if (row + 1 >= max_entry_size_) {
     new_word_button_->setEnabled(false);
   }
 
-  QTableWidgetItem *item = dic_content_->item(row, 0);
-  dic_content_->setCurrentItem(item);
-  dic_content_->editItem(item);
+  const QModelIndex index = content_model_->index(
+      row, DictionaryContentTableModel::READING_COLUMN);
+  dic_content_->setCurrentIndex(index);
+  dic_content_->edit(index);
 
   UpdateUIStatus();
 }
@@ -1033,13 +968,14 @@ void DictionaryTool::GetSortedSelectedRows(std::vector<int> *rows) const {
   DCHECK(rows);
   rows->clear();
 
-  const QList<QTableWidgetItem *> items = dic_content_->selectedItems();
-  if (items.empty()) {
+  const QModelIndexList indexes =
+      dic_content_->selectionModel()->selectedIndexes();
+  if (indexes.empty()) {
     return;
   }
-  rows->reserve(items.count());
-  for (int i = 0; i < items.size(); ++i) {
-    rows->push_back(items[i]->row());
+  rows->reserve(indexes.count());
+  for (int i = 0; i < indexes.size(); ++i) {
+    rows->push_back(indexes[i].row());
   }
 
   sort(rows->begin(), rows->end(), std::greater<int>());
@@ -1080,50 +1016,31 @@ void DictionaryTool::DeleteWord() {
     return;
   }
 
-  setUpdatesEnabled(false);
-
-  {
-    std::unique_ptr<QProgressDialog> progress(
-        CreateProgressDialog(
-            tr("Deleting the selected words..."),
-            this,
-            rows.size()));
-
-    for (size_t i = 0; i < rows.size(); ++i) {
-      dic_content_->removeRow(rows[i]);
-      progress->setValue(i);
-    }
-  }
-
-  setUpdatesEnabled(true);
+  content_model_->RemoveEntries(rows);
   dic_content_->setEnabled(true);
 
-  if (dic_content_->rowCount() < max_entry_size_) {
+  if (content_model_->size() < max_entry_size_) {
     new_word_button_->setEnabled(true);
   }
 
   UpdateUIStatus();
-  dic_content_->repaint();
-
-  modified_ = true;
 }
 
 void DictionaryTool::EditPOS(const string &pos) {
-  const QList<QTableWidgetItem *> items =
-      dic_content_->selectedItems();
-  if (items.empty()) {
+  std::vector<int> rows;
+  GetSortedSelectedRows(&rows);
+  if (rows.empty()) {
     return;
   }
 
   const QString new_pos = QString::fromUtf8(pos.c_str());
-  setUpdatesEnabled(false);
-
-  for (int i = 0; i < items.size(); ++i) {
-    const int row = items[i]->row();
-    dic_content_->setItem(row, 2, new QTableWidgetItem(new_pos));
+  for (size_t i = 0; i < rows.size(); ++i) {
+    content_model_->setData(
+        content_model_->index(rows[i],
+                              DictionaryContentTableModel::CATEGORY_COLUMN),
+        new_pos, Qt::EditRole);
   }
 
-  setUpdatesEnabled(true);
   dic_content_->setEnabled(true);
 }
 
@@ -1162,52 +1079,26 @@ void DictionaryTool::MoveTo(int dictionary_row) {
     return;
   }
 
-  setUpdatesEnabled(false);
-
-  {
-    // add |rows.size()| items and remove |rows.size()| items
-    const int progress_max = rows.size() * 2;
-    std::unique_ptr<QProgressDialog> progress(
-        CreateProgressDialog(
-            tr("Moving the selected words..."),
-            this,
-            progress_max));
-
-    int progress_index = 0;
-    if (target_dict) {
-      for (size_t i = 0; i < rows.size(); ++i) {
-        UserDictionary::Entry *entry = target_dict->add_entries();
-        const int row = rows[i];
-        entry->set_key(dic_content_->item(row, 0)->text().toStdString());
-        entry->set_value(dic_content_->item(row, 1)->text().toStdString());
-        entry->set_pos(UserDictionaryUtil::ToPosType(
-            dic_content_->item(row, 2)->text().toStdString().c_str()));
-        entry->set_comment(dic_content_->item(row, 3)->text().toStdString());
-        UserDictionaryUtil::SanitizeEntry(entry);
-        progress->setValue(progress_index);
-        ++progress_index;
-      }
-    }
-    for (size_t i = 0; i < rows.size(); ++i) {
-      dic_content_->removeRow(rows[i]);
-      progress->setValue(progress_index);
-      ++progress_index;
+  if (target_dict) {
+    // |rows| is in descending order, so the entries are added in reverse to
+    // keep their order.
+    for (std::vector<int>::const_reverse_iterator it = rows.rbegin();
+         it != rows.rend(); ++it) {
+      UserDictionary::Entry *entry = target_dict->add_entries();
+      entry->CopyFrom(content_model_->entry(*it));
+      UserDictionaryUtil::SanitizeEntry(entry);
     }
   }
-
-  setUpdatesEnabled(true);
+  content_model_->RemoveEntries(rows);
   dic_content_->setEnabled(true);
 
   UpdateUIStatus();
-  dic_content_->repaint();
-
-  modified_ = true;
 }
 
 void DictionaryTool::EditComment() {
-  const QList<QTableWidgetItem *> items =
-      dic_content_->selectedItems();
-  if (items.empty()) {
+  std::vector<int> rows;
+  GetSortedSelectedRows(&rows);
+  if (rows.empty()) {
     return;
   }
 
@@ -1221,13 +1112,13 @@ void DictionaryTool::EditComment() {
     return;
   }
 
-  setUpdatesEnabled(false);
-  for (int i = 0; i < items.size(); ++i) {
-    const int row = items[i]->row();
-    dic_content_->setItem(row, 3, new QTableWidgetItem(new_comment));
+  for (size_t i = 0; i < rows.size(); ++i) {
+    content_model_->setData(
+        content_model_->index(rows[i],
+                              DictionaryContentTableModel::COMMENT_COLUMN),
+        new_comment, Qt::EditRole);
   }
 
-  setUpdatesEnabled(true);
   dic_content_->setEnabled(true);
 }
 
@@ -1239,10 +1130,12 @@ void DictionaryTool::CloseWindow() {
   this->close();
 }
 
-void DictionaryTool::OnItemChanged(QTableWidgetItem *item) {
-  if (item->column() == 0 &&
-      !item->text().isEmpty() &&
-      !UserDictionaryUtil::IsValidReading(item->text().toStdString())) {
+void DictionaryTool::OnDataChanged(const QModelIndex &top_left,
+                                   const QModelIndex &unused_bottom_right) {
+  const QString text = top_left.data(Qt::DisplayRole).toString();
+  if (top_left.column() == DictionaryContentTableModel::READING_COLUMN &&
+      !text.isEmpty() &&
+      !UserDictionaryUtil::IsValidReading(text.toStdString())) {
     QMessageBox::critical(
         this, window_title_,
         tr("An invalid character is included in the reading."));
@@ -1251,29 +1144,26 @@ void DictionaryTool::OnItemChanged(QTableWidgetItem *item) {
   UpdateUIStatus();
 
   sort_state_.sorted = false;
-  modified_ = true;
 }
 
 void DictionaryTool::OnHeaderClicked(int logicalIndex) {
   if (sort_state_.sorted &&
       sort_state_.column == logicalIndex &&
       sort_state_.order == Qt::AscendingOrder) {
-    dic_content_->sortItems(logicalIndex, Qt::DescendingOrder);
+    content_model_->sort(logicalIndex, Qt::DescendingOrder);
     sort_state_.order = Qt::DescendingOrder;
   } else {
-    dic_content_->sortItems(logicalIndex, Qt::AscendingOrder);
+    content_model_->sort(logicalIndex, Qt::AscendingOrder);
     sort_state_.sorted = true;
     sort_state_.column = logicalIndex;
     sort_state_.order = Qt::AscendingOrder;
   }
-  modified_ = true;
 }
 
 void DictionaryTool::OnContextMenuRequestedForContent(const QPoint &pos) {
-  QTableWidgetItem *item = dic_content_->itemAt(pos);
   // When the mouse pointer is not on an item of the table widget, we
   // don't show context menu.
-  if (item == NULL) {
+  if (!dic_content_->indexAt(pos).isValid()) {
     return;
   }
 
@@ -1282,13 +1172,14 @@ void DictionaryTool::OnContextMenuRequestedForContent(const QPoint &pos) {
 
   // Count the number of selected words and create delete menu with an
   // appropriate text.
-  const QList<QTableWidgetItem *> items = dic_content_->selectedItems();
+  const QModelIndexList indexes =
+      dic_content_->selectionModel()->selectedIndexes();
   QString delete_menu_text = tr("Delete this word");
   QString move_to_menu_text = tr("Move this word to");
-  if (items.size() > 0) {
-    const int first_row = items[0]->row();
-    for (int i = 1; i < items.size(); ++i) {
-      if (items[i]->row() != first_row) {
+  if (indexes.size() > 0) {
+    const int first_row = indexes[0].row();
+    for (int i = 1; i < indexes.size(); ++i) {
+      if (indexes[i].row() != first_row) {
         // More than one words are selected.
         delete_menu_text = tr("Delete the selected words");
         move_to_menu_text = tr("Move the selected words to");
@@ -1398,35 +1289,6 @@ DictionaryTool::DictionaryInfo DictionaryTool::current_dictionary() const {
   return retval;
 }
 
-void DictionaryTool::SyncToStorage() {
-  if (current_dic_id_ == 0 || !modified_) {
-    return;
-  }
-
-  UserDictionary *dic =
-      session_->mutable_storage()->GetUserDictionary(current_dic_id_);
-
-  if (dic == NULL) {
-    LOG(ERROR) << "No save dictionary: " << current_dic_id_;
-    return;
-  }
-
-  dic->clear_entries();
-
-  for (int i = 0; i < dic_content_->rowCount(); ++i) {
-    UserDictionary::Entry *entry =
-        dic->add_entries();
-    entry->set_key(dic_content_->item(i, 0)->text().toStdString());
-    entry->set_value(dic_content_->item(i, 1)->text().toStdString());
-    entry->set_pos(UserDictionaryUtil::ToPosType(
-        dic_content_->item(i, 2)->text().toStdString().c_str()));
-    entry->set_comment(dic_content_->item(i, 3)->text().toStdString());
-    UserDictionaryUtil::SanitizeEntry(entry);
-  }
-
-  modified_ = false;
-}
-
 void DictionaryTool::CreateDictionaryHelper(const QString &dic_name) {
   uint64 new_dic_id = 0;
   if (!session_->mutable_storage()->CreateDictionary(
@@ -1520,8 +1382,9 @@ void DictionaryTool::StartMonitoringUserEdit() {
   if (monitoring_user_edit_) {
     return;
   }
-  connect(dic_content_, SIGNAL(itemChanged(QTableWidgetItem *)),
-          this, SLOT(OnItemChanged(QTableWidgetItem *)));
+  connect(content_model_,
+          SIGNAL(dataChanged(const QModelIndex &, const QModelIndex &)),
+          this, SLOT(OnDataChanged(const QModelIndex &, const QModelIndex &)));
   monitoring_user_edit_ = true;
 }
 
@@ -1529,8 +1392,10 @@ void DictionaryTool::StopMonitoringUserEdit() {
   if (!monitoring_user_edit_) {
     return;
   }
-  disconnect(dic_content_, SIGNAL(itemChanged(QTableWidgetItem *)),
-             this, SLOT(OnItemChanged(QTableWidgetItem *)));
+  disconnect(content_model_,
+             SIGNAL(dataChanged(const QModelIndex &, const QModelIndex &)),
+             this,
+             SLOT(OnDataChanged(const QModelIndex &, const QModelIndex &)));
   monitoring_user_edit_ = false;
 }
 
@@ -1597,16 +1462,16 @@ void DictionaryTool::UpdateUIStatus() {
 
   const bool is_enable_new_word =
       dic_list_->count() > 0 &&
-      dic_content_->rowCount() < max_entry_size_;
+      content_model_->size() < max_entry_size_;
 
   new_word_button_->setEnabled(is_enable_new_word);
-  delete_word_button_->setEnabled(dic_content_->rowCount() > 0);
+  delete_word_button_->setEnabled(content_model_->size() > 0);
 
   const DictionaryInfo dic_info = current_dictionary();
   if (dic_info.item != NULL) {
     statusbar_message_ =  QString(tr("%1: %2 entries")).arg(
         dic_info.item->text()).arg(
-            dic_content_->rowCount());
+            content_model_->size());
   } else {
     statusbar_message_.clear();
   }
@@ -57,6 +57,7 @@ class UserDictionarySession;
 
 namespace gui {
 
+class DictionaryContentTableModel;
 class ImportDialog;
 class FindDialog;
 
@@ -95,7 +96,8 @@ class DictionaryTool : public QMainWindow,
 
   // Signals to be connected with a particular action by the user.
   void OnDictionarySelectionChanged();
-  void OnItemChanged(QTableWidgetItem *unused_item);
+  void OnDataChanged(const QModelIndex &top_left,
+                     const QModelIndex &unused_bottom_right);
   void OnHeaderClicked(int logicalIndex);
   void OnDeactivate();
 
@@ -116,9 +118,6 @@ class DictionaryTool : public QMainWindow,
   // Returns information on the current dictionary.
   DictionaryInfo current_dictionary() const;
 
-  // Save content of the current dictionary to the UserDictionaryStorage
-  void SyncToStorage();
-
   // Setup GUI components to edit dictionary contents for a given
   // dictionary.
   void SetupDicContentEditor(const DictionaryInfo &dic_info);
@@ -189,15 +188,10 @@ class DictionaryTool : public QMainWindow,
   FindDialog   *find_dialog_;
   std::unique_ptr<mozc::user_dictionary::UserDictionarySession> session_;
 
-  // ID of current selected dictionary. This needs to be maintained
-  // separate from selection on the list widget because data is saved
-  // on the previous dictionary after the selection on the widget is
-  // changed. It takes -1 when no dictionary is selected.
-  uint64 current_dic_id_;
-
-  // Whether any change has been made on the current dictionary and
-  // not been saved.
-  bool modified_;
+  // Model of the table widget for dictionary contents. It refers to the
+  // entries of the current dictionary in |session_| directly, so edits on
+  // the table don't need to be synced to the storage.
+  DictionaryContentTableModel *content_model_;
 
   // Holds information on whether dictionary entires are sorted, key
   // column of sort and order of sort.
@@ -30,7 +30,7 @@
 #include "gui/dictionary_tool/find_dialog.h"
 
 #include <QtGui/QtGui>
-#include <QtWidgets/QTableWidget>
+#include <QtWidgets/QTableView>
 #include <QtWidgets/QMessageBox>
 
 #include "base/logging.h"
@@ -42,10 +42,10 @@ const char kYellowSelectionStyleSheet[] =
     "selection-background-color : yellow;";
 }
 
-FindDialog::FindDialog(QWidget *parent, QTableWidget *table)
+FindDialog::FindDialog(QWidget *parent, QTableView *table)
     : QDialog(parent,
               Qt::WindowTitleHint | Qt::WindowSystemMenuHint),
-      table_(table), last_item_(NULL) {
+      table_(table) {
   setupUi(this);
   setModal(false);
 
@@ -71,13 +71,13 @@ void FindDialog::showEvent(QShowEvent *event) {
     QuerylineEdit->selectAll();
   }
   FindForwardpushButton->setDefault(true);
-  last_item_ = NULL;
+  last_index_ = QModelIndex();
   UpdateUIStatus();
 }
 
 void FindDialog::closeEvent(QCloseEvent *event) {
   table_->setStyleSheet("");
-  last_item_ = NULL;
+  last_index_ = QModelIndex();
 }
 
 void FindDialog::UpdateUIStatus() {
@@ -87,10 +87,12 @@ void FindDialog::UpdateUIStatus() {
 }
 
 bool FindDialog::Match(const QString &query, int row, int column) {
-  if (last_item_ != NULL && last_item_ == table_->item(row, column)) {
+  const QModelIndex index = table_->model()->index(row, column);
+  if (last_index_.isValid() && last_index_ == index) {
     return false;
   }
-  const QString &value = table_->item(row, column)->text();
+  // The text is taken from the model so that no cell widget is created.
+  const QString value = index.data(Qt::DisplayRole).toString();
   return value.contains(query, Qt::CaseInsensitive);
 }
 
@@ -106,14 +108,16 @@ void FindDialog::FindBackward() {
 
 void FindDialog::Find(FindDialog::Direction direction) {
   const QString &query = QuerylineEdit->text();
-  const int start_row = std::max(0, table_->currentRow());
-  int start_column = std::min(1, std::max(0, table_->currentColumn()));
+  const QModelIndex current_index = table_->currentIndex();
+  const int row_count = table_->model()->rowCount();
+  const int start_row = std::max(0, current_index.row());
+  int start_column = std::min(1, std::max(0, current_index.column()));
   int matched_column = -1;
   int matched_row = -1;
 
   switch (direction) {
     case FORWARD:
-      for (int row = start_row; row < table_->rowCount(); ++row) {
+      for (int row = start_row; row < row_count; ++row) {
         for (int column = start_column; column < 2; ++column) {
           start_column = 0;
           if (Match(query, row, column)) {
@@ -143,14 +147,15 @@ void FindDialog::Find(FindDialog::Direction direction) {
   FOUND:
 
   if (matched_row >= 0 && matched_column >= 0) {
-    QTableWidgetItem *item = table_->item(matched_row, matched_column);
-    DCHECK(item);
-    last_item_ = item;
+    const QModelIndex index =
+        table_->model()->index(matched_row, matched_column);
+    DCHECK(index.isValid());
+    last_index_ = index;
     table_->setStyleSheet(kYellowSelectionStyleSheet);
-    table_->setCurrentItem(item);
-    table_->scrollToItem(item);
+    table_->setCurrentIndex(index);
+    table_->scrollTo(index);
   } else {
-    last_item_ = NULL;
+    last_index_ = QModelIndex();
     QMessageBox::information(this, this->windowTitle(),
                              tr("Cannot find pattern %1").arg(query));
   }
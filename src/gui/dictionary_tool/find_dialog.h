@@ -30,12 +30,12 @@
 #ifndef MOZC_GUI_DICTIONARY_TOOL_FIND_DIALOG_H_
 #define MOZC_GUI_DICTIONARY_TOOL_FIND_DIALOG_H_
 
+#include <QtCore/QPersistentModelIndex>
 #include <QtWidgets/QDialog>
 
 #include "gui/dictionary_tool/ui_find_dialog.h"
 
-class QTableWidget;
-class QTableWidgetItem;
+class QTableView;
 
 namespace mozc {
 namespace gui {
@@ -45,7 +45,7 @@ class FindDialog : public QDialog,
   Q_OBJECT
 
  public:
-  FindDialog(QWidget *parent, QTableWidget *table);
+  FindDialog(QWidget *parent, QTableView *table);
   virtual ~FindDialog();
 
  protected:
@@ -67,8 +67,8 @@ class FindDialog : public QDialog,
   bool Match(const QString &query, int row, int column);
   void Find(Direction direction);
 
-  QTableWidget *table_;
-  QTableWidgetItem *last_item_;
+  QTableView *table_;
+  QPersistentModelIndex last_index_;
 };
 }  // namespace gui
 }  // namespace mozc
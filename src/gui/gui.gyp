@@ -396,6 +396,7 @@
         '<(gen_out_dir)/character_pad/data/local_character_map.h',
         '<(gen_out_dir)/dictionary_tool/moc_zero_width_splitter.cc',
         'character_pad/character_pad_libmain.cc',
+        'character_pad/character_palette_table_model.cc',
         'character_pad/character_palette_table_widget.cc',
         'character_pad/character_palette.cc',
         'character_pad/hand_writing_canvas.cc',
@@ -652,6 +653,7 @@
         '<(gen_out_dir)/dictionary_tool/moc_zero_width_splitter.cc',
         'config_dialog/combobox_delegate.cc',
         'dictionary_tool/dictionary_tool.cc',
+        'dictionary_tool/dictionary_content_table_model.cc',
         'dictionary_tool/dictionary_content_table_widget.cc',
         'dictionary_tool/dictionary_tool_libmain.cc',
         'dictionary_tool/find_dialog.cc',
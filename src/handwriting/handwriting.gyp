@@ -65,6 +65,7 @@
       ],
       'dependencies': [
         '../base/base.gyp:base',
+        '../storage/storage.gyp:storage',
       ],
     },
   ],
@@ -31,20 +31,46 @@
 
 #include <set>
 
+#include "base/hash.h"
 #include "base/logging.h"
+#include "base/mutex.h"
 #include "base/singleton.h"
 #include "handwriting/handwriting_manager.h"
+#include "storage/lru_cache.h"
 
 namespace mozc {
 namespace handwriting {
+namespace {
+
+// The number of recognition results to be cached.  The same set of strokes is
+// recognized again when the last stroke is reverted or the recognition is
+// restarted.
+const size_t kResultCacheSize = 32;
+
+uint64 GetStrokesFingerprint(const Strokes &strokes) {
+  string key;
+  for (size_t i = 0; i < strokes.size(); ++i) {
+    const uint32 size = strokes[i].size();
+    key.append(reinterpret_cast<const char *>(&size), sizeof(size));
+    if (size > 0) {
+      key.append(reinterpret_cast<const char *>(&strokes[i][0]),
+                 sizeof(Point) * size);
+    }
+  }
+  return Hash::Fingerprint(key);
+}
+
+}  // namespace
 
 class HandwritingManagerImpl {
  public:
-  HandwritingManagerImpl() : module_(NULL) {}
+  HandwritingManagerImpl() : module_(NULL), cache_(kResultCacheSize) {}
   virtual ~HandwritingManagerImpl() {}
 
   void SetHandwritingModule(HandwritingInterface *module) {
+    scoped_lock l(&mutex_);
     module_ = module;
+    cache_.Clear();
   }
 
   HandwritingStatus Recognize(const Strokes &strokes,
@@ -52,7 +78,22 @@ class HandwritingManagerImpl {
     DCHECK(module_);
     DCHECK(candidates);
     candidates->clear();
-    return module_->Recognize(strokes, candidates);
+    const uint64 fingerprint = GetStrokesFingerprint(strokes);
+    {
+      scoped_lock l(&mutex_);
+      const std::vector<string> *cached = cache_.Lookup(fingerprint);
+      if (cached != NULL) {
+        *candidates = *cached;
+        return HANDWRITING_NO_ERROR;
+      }
+    }
+    const HandwritingStatus status = module_->Recognize(strokes, candidates);
+    // Errors are not cached since they may be temporary (e.g. network error).
+    if (status == HANDWRITING_NO_ERROR) {
+      scoped_lock l(&mutex_);
+      cache_.Insert(fingerprint, *candidates);
+    }
+    return status;
   }
 
   HandwritingStatus Commit(const Strokes &strokes, const string &result) {
@@ -62,6 +103,9 @@ class HandwritingManagerImpl {
 
  private:
   HandwritingInterface * module_;
+  // Maps the fingerprint of strokes to the recognition result.
+  mutable storage::LRUCache<uint64, std::vector<string> > cache_;
+  mutable Mutex mutex_;
 };
 
 // static
@@ -74,6 +74,9 @@ class HandwritingManager {
   // owner of the module should be the caller of this function.
   static void SetHandwritingModule(HandwritingInterface *module);
 
+  // Recognizes |strokes| with the module.  Successful results are cached per
+  // set of strokes, so recognizing the same strokes again (e.g. after the
+  // last stroke is reverted) doesn't invoke the module.
   static HandwritingStatus Recognize(const Strokes &strokes,
                                      std::vector<string> *candidates);
   static HandwritingStatus Commit(const Strokes &strokes, const string &result);
@@ -46,12 +46,14 @@ class MockHandwriting : public HandwritingInterface {
  public:
   MockHandwriting()
       : commit_counter_(0),
+        recognize_counter_(0),
         return_status_(HANDWRITING_NO_ERROR) {
   }
 
   virtual HandwritingStatus Recognize(const Strokes &unused_strokes,
                                       std::vector<string> *candidates) const {
     CHECK(candidates);
+    ++recognize_counter_;
     candidates->clear();
     for (size_t i = 0; i < candidates_.size(); ++i) {
       candidates->push_back(candidates_[i]);
@@ -80,6 +82,10 @@ class MockHandwriting : public HandwritingInterface {
     commit_counter_ = 0;
   }
 
+  int GetRecognizeCounter() {
+    return recognize_counter_;
+  }
+
   void SetReturnStatus(HandwritingStatus status) {
     return_status_ = status;
   }
@@ -87,6 +93,7 @@ class MockHandwriting : public HandwritingInterface {
  private:
   std::vector<string> candidates_;
   int commit_counter_;
+  mutable int recognize_counter_;
   HandwritingStatus return_status_;
 };
 }  // namespace
@@ -122,6 +129,43 @@ TEST_F(HandwritingManagerTest, Recognize) {
   }
 }
 
+TEST_F(HandwritingManagerTest, RecognizeWithCache) {
+  std::vector<string> expected_candidates;
+  expected_candidates.push_back("foo");
+  mock_handwriting_.SetCandidates(expected_candidates);
+
+  Strokes strokes(1);
+  strokes[0].push_back(std::make_pair(0.1f, 0.2f));
+  std::vector<string> result;
+  EXPECT_EQ(HANDWRITING_NO_ERROR,
+            HandwritingManager::Recognize(strokes, &result));
+  EXPECT_EQ(expected_candidates, result);
+  EXPECT_EQ(1, mock_handwriting_.GetRecognizeCounter());
+
+  // The same strokes hit the cache.
+  result.clear();
+  EXPECT_EQ(HANDWRITING_NO_ERROR,
+            HandwritingManager::Recognize(strokes, &result));
+  EXPECT_EQ(expected_candidates, result);
+  EXPECT_EQ(1, mock_handwriting_.GetRecognizeCounter());
+
+  // Different strokes are recognized by the module.
+  strokes[0].push_back(std::make_pair(0.3f, 0.4f));
+  EXPECT_EQ(HANDWRITING_NO_ERROR,
+            HandwritingManager::Recognize(strokes, &result));
+  EXPECT_EQ(2, mock_handwriting_.GetRecognizeCounter());
+
+  // Errors are not cached.
+  strokes[0].push_back(std::make_pair(0.5f, 0.6f));
+  mock_handwriting_.SetReturnStatus(HANDWRITING_NETWORK_ERROR);
+  EXPECT_EQ(HANDWRITING_NETWORK_ERROR,
+            HandwritingManager::Recognize(strokes, &result));
+  mock_handwriting_.SetReturnStatus(HANDWRITING_NO_ERROR);
+  EXPECT_EQ(HANDWRITING_NO_ERROR,
+            HandwritingManager::Recognize(strokes, &result));
+  EXPECT_EQ(4, mock_handwriting_.GetRecognizeCounter());
+}
+
 TEST_F(HandwritingManagerTest, Commit) {
   mock_handwriting_.ClearCommitCounter();
   EXPECT_EQ(0, mock_handwriting_.GetCommitCounter());
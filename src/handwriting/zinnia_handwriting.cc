@@ -31,6 +31,7 @@
 
 #include "handwriting/zinnia_handwriting.h"
 
+#include <algorithm>
 #include <memory>
 #include <string>
 
@@ -71,6 +72,8 @@ ZinniaHandwriting::ZinniaHandwriting(StringPiece model_file)
       zinnia_model_error_(false) {
   DCHECK(recognizer_.get());
   DCHECK(character_.get());
+  character_->set_width(kBoxSize);
+  character_->set_height(kBoxSize);
 
   if (!mmap_->Open(model_file.as_string().c_str())) {
     LOG(ERROR) << "Cannot open model file:" << model_file;
@@ -92,15 +95,21 @@ HandwritingStatus ZinniaHandwriting::Recognize(
     return HANDWRITING_ERROR;
   }
 
-  character_->clear();
-  character_->set_width(kBoxSize);
-  character_->set_height(kBoxSize);
-  for (size_t i = 0; i < strokes.size(); ++i) {
+  if (character_strokes_.size() > strokes.size() ||
+      !std::equal(character_strokes_.begin(), character_strokes_.end(),
+                  strokes.begin())) {
+    character_->clear();
+    character_->set_width(kBoxSize);
+    character_->set_height(kBoxSize);
+    character_strokes_.clear();
+  }
+  for (size_t i = character_strokes_.size(); i < strokes.size(); ++i) {
     for (size_t j = 0; j < strokes[i].size(); ++j) {
       character_->add(i,
                       static_cast<int>(kBoxSize * strokes[i][j].first),
                       static_cast<int>(kBoxSize * strokes[i][j].second));
     }
+    character_strokes_.push_back(strokes[i]);
   }
 
   const int kMaxResultSize = 100;
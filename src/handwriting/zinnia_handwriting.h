@@ -61,6 +61,10 @@ class ZinniaHandwriting : public HandwritingInterface {
  private:
   std::unique_ptr<zinnia::Recognizer> recognizer_;
   std::unique_ptr<zinnia::Character> character_;
+  // The strokes which have been added to |character_|.  Since the strokes are
+  // recognized every time a stroke is added, only the new strokes are added
+  // to |character_| when this is a prefix of the strokes to be recognized.
+  mutable Strokes character_strokes_;
   std::unique_ptr<Mmap> mmap_;
   bool zinnia_model_error_;
 
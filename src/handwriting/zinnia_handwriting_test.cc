@@ -66,6 +66,38 @@ TEST_F(ZinniaHandwritingTest, Recognize) {
   EXPECT_EQ("一", results[0]);
 }
 
+TEST_F(ZinniaHandwritingTest, RecognizeIncrementally) {
+  Strokes strokes;
+  Stroke stroke;
+  stroke.push_back(std::make_pair(0.2, 0.3));
+  stroke.push_back(std::make_pair(0.8, 0.3));
+  strokes.push_back(stroke);
+
+  std::vector<string> results;
+  EXPECT_EQ(HANDWRITING_NO_ERROR, zinnia_->Recognize(strokes, &results));
+
+  // Only the second stroke is added to the character inside the module.  The
+  // result should be the same as the one of the recognition from scratch.
+  stroke.clear();
+  stroke.push_back(std::make_pair(0.1, 0.7));
+  stroke.push_back(std::make_pair(0.9, 0.7));
+  strokes.push_back(stroke);
+  EXPECT_EQ(HANDWRITING_NO_ERROR, zinnia_->Recognize(strokes, &results));
+
+  const string filepath = mozc::testing::GetSourceFileOrDie({
+      "handwriting", "handwriting-ja.model"});
+  ZinniaHandwriting fresh_zinnia(filepath);
+  std::vector<string> expected;
+  EXPECT_EQ(HANDWRITING_NO_ERROR, fresh_zinnia.Recognize(strokes, &expected));
+  EXPECT_EQ(expected, results);
+
+  // Reverting the last stroke rebuilds the character.
+  strokes.pop_back();
+  EXPECT_EQ(HANDWRITING_NO_ERROR, zinnia_->Recognize(strokes, &results));
+  EXPECT_EQ(HANDWRITING_NO_ERROR, fresh_zinnia.Recognize(strokes, &expected));
+  EXPECT_EQ(expected, results);
+}
+
 TEST_F(ZinniaHandwritingTest, Commit) {
   Strokes strokes;
   string result;
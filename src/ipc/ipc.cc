@@ -108,6 +108,34 @@ IPCClientFactory *IPCClientFactory::GetIPCClientFactory() {
   return Singleton<IPCClientFactory>::get();
 }
 
+SharedMemoryIPCClientFactory::~SharedMemoryIPCClientFactory() {
+}
+
+IPCClientInterface *SharedMemoryIPCClientFactory::NewClient(
+    const string &name, const string &path_name) {
+  IPCClient *client = new IPCClient(name, path_name);
+#if defined(OS_LINUX) && !defined(OS_ANDROID)
+  // The halves for the requests and the responses are much larger than the
+  // socket buffers.  The pages are allocated only when touched.
+  const size_t kSharedMemorySize = 4 << 20;
+  if (client->Connected() && !client->EnableSharedMemory(kSharedMemorySize)) {
+    client->EnablePersistentConnection();
+  }
+#endif  // OS_LINUX && !OS_ANDROID
+  return client;
+}
+
+IPCClientInterface *SharedMemoryIPCClientFactory::NewClient(
+    const string &name) {
+  return NewClient(name, "");
+}
+
+// static
+SharedMemoryIPCClientFactory *
+SharedMemoryIPCClientFactory::GetIPCClientFactory() {
+  return Singleton<SharedMemoryIPCClientFactory>::get();
+}
+
 uint32 IPCClient::GetServerProtocolVersion() const {
   DCHECK(ipc_path_manager_);
   return ipc_path_manager_->GetServerProtocolVersion();
@@ -36,6 +36,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "base/scoped_handle.h"
 #include "base/port.h"
@@ -51,8 +52,10 @@ enum {
 };
 
 // increment this value if protocol has changed.
+// 4: Persistent connections on Linux.
+// 5: Shared memory on Linux.
 enum {
-  IPC_PROTOCOL_VERSION = 3,
+  IPC_PROTOCOL_VERSION = 5,
 };
 
 enum IPCErrorType {
@@ -84,6 +87,12 @@ class IPCClientInterface {
 
   // return last error
   virtual IPCErrorType GetLastIPCError() const = 0;
+
+  // Keeps the connection for the following Call()s.  Returns false if the
+  // connection cannot be kept, in which case Call() can be used only once.
+  virtual bool EnablePersistentConnection() {
+    return false;
+  }
 };
 
 #ifdef OS_MACOSX
@@ -147,7 +156,8 @@ class IPCClient : public IPCClientInterface {
   // When Server doesn't send response within timeout, 'Call' returns false.
   // When timeout (in msec) is set -1, 'Call' waits forever.
   // Note that on Linux and Windows, Call() closes the socket_. This means you
-  // cannot call the Call() function more than once.
+  // cannot call the Call() function more than once, unless
+  // EnablePersistentConnection() succeeds.
   bool Call(const char *request,
             size_t request_size,
             char *response,
@@ -162,6 +172,20 @@ class IPCClient : public IPCClientInterface {
   // Do not use it unless version mismatch happens
   static bool TerminateServer(const string &name);
 
+#if defined(OS_LINUX) && !defined(OS_ANDROID)
+  // Sends the following requests on the same socket, each framed with its
+  // size.  If the server has closed the connection, e.g. on restart, Call()
+  // reconnects and sends the request again.
+  bool EnablePersistentConnection() override;
+
+  // Same as EnablePersistentConnection(), and passes the requests and the
+  // responses through a shared memory of |size| bytes instead of the socket.
+  // The first half is for the requests and the rest for the responses, and
+  // larger messages still go through the socket.  Must be called before
+  // EnablePersistentConnection().
+  bool EnableSharedMemory(size_t size);
+#endif
+
 #ifdef OS_MACOSX
   void SetMachPortManager(MachPortManagerInterface *manager) {
     mach_port_manager_ = manager;
@@ -171,6 +195,16 @@ class IPCClient : public IPCClientInterface {
  private:
   void Init(const string &name, const string &server_path);
 
+#if defined(OS_LINUX) && !defined(OS_ANDROID)
+  // Sends the header of the persistent connection.
+  bool StartPersistentConnection();
+  void Reconnect();
+  bool SendPersistentRequest(const char *request, size_t request_size,
+                             int32 timeout);
+  bool RecvPersistentResponse(char *response, size_t *response_size,
+                              int32 timeout);
+#endif
+
 #ifdef OS_WIN
   // Windows
   ScopedHandle pipe_handle_;
@@ -180,6 +214,13 @@ class IPCClient : public IPCClientInterface {
   MachPortManagerInterface *mach_port_manager_;
 #else
   int socket_;
+  // Kept to reconnect the persistent connection.
+  string name_;
+  string server_path_;
+  bool persistent_ = false;
+  int shared_memory_fd_ = -1;
+  char *shared_memory_ = nullptr;
+  size_t shared_memory_size_ = 0;
 #endif
   bool connected_;
   IPCPathManager *ipc_path_manager_;
@@ -214,6 +255,22 @@ class IPCClientFactory : public IPCClientFactoryInterface {
   static IPCClientFactory *GetIPCClientFactory();
 };
 
+// Creates IPCClient objects passing the messages through shared memory where
+// supported, i.e. on Linux with a server of the same protocol version.  They
+// are plain IPCClient objects otherwise.  The clients keep the connection,
+// so reuse one for the following calls.
+class SharedMemoryIPCClientFactory : public IPCClientFactoryInterface {
+ public:
+  virtual ~SharedMemoryIPCClientFactory();
+
+  virtual IPCClientInterface *NewClient(const string &name,
+                                        const string &path_name);
+  virtual IPCClientInterface *NewClient(const string &name);
+
+  // Return a singleton instance.
+  static SharedMemoryIPCClientFactory *GetIPCClientFactory();
+};
+
 // Synchronous, Single-thread IPC Server
 // Usage:
 // class MyEchoServer: public IPCServer {
@@ -247,11 +304,33 @@ class IPCServer {
 
   // Implement a server algorithm in subclass.
   // If 'Process' return false, server finishes select loop
+  // On Linux, it is called for each request on a persistent connection, too.
   virtual bool Process(const char *request,
                        size_t request_size,
                        char *response,
                        size_t *response_size) = 0;
 
+  // Processes |request| if it doesn't need to be ordered with the other
+  // requests, e.g. a request which doesn't touch any session.  Returns false
+  // to leave the request to Process().  This is called only in the
+  // concurrent mode, on the worker threads, so it must be thread-safe.
+  virtual bool TryProcessConcurrently(const char *request,
+                                      size_t request_size,
+                                      char *response,
+                                      size_t *response_size) {
+    return false;
+  }
+
+  // Enables the concurrent mode if |num_workers| is positive.  In the mode,
+  // Loop() only accepts connections, and |num_workers| threads receive the
+  // requests and try TryProcessConcurrently().  The other requests are
+  // passed to Process() one by one on a single thread in the order they are
+  // received, so Process() still needn't be thread-safe.  Must be called
+  // before Loop().  Currently only implemented with UNIX domain sockets.
+  void set_num_workers(int num_workers) {
+    num_workers_ = num_workers;
+  }
+
   // Start select loop. It goes into infinite loop.
   void Loop();
 
@@ -275,13 +354,23 @@ class IPCServer {
 #endif
 
  private:
+#if defined(OS_LINUX) && !defined(OS_ANDROID)
+  // Loop() without and with the concurrent mode.
+  void LoopSingleThread();
+  void LoopConcurrently();
+#endif
+
   char request_[IPC_REQUESTSIZE];
   char response_[IPC_RESPONSESIZE];
   bool connected_;
   std::unique_ptr<Thread> server_thread_;
 
 #ifdef OS_WIN
-  ScopedHandle pipe_handle_;
+  // Instances of the named pipe created up front, and the events signaled
+  // when a client connects to them.  While one instance is served, the next
+  // client can connect to another one without waiting for the disconnection.
+  std::vector<std::unique_ptr<ScopedHandle>> pipe_handles_;
+  std::vector<std::unique_ptr<ScopedHandle>> connect_events_;
   ScopedHandle pipe_event_;
   ScopedHandle quit_event_;
 #elif defined(OS_MACOSX)
@@ -293,6 +382,7 @@ class IPCServer {
 #endif
 
   int timeout_;
+  int num_workers_ = 0;
 };
 
 }   // namespace mozc
@@ -54,9 +54,11 @@
 #include <memory>  // for std::unique_ptr
 #endif
 
+#include "base/clock.h"
 #include "base/const.h"
 #include "base/file_stream.h"
 #include "base/file_util.h"
+#include "base/flags.h"
 #ifdef OS_WIN
 #include "base/unverified_sha1.h"
 #endif  // OS_WIN
@@ -74,6 +76,11 @@
 #include "ipc/ipc.h"
 #include "ipc/ipc.pb.h"
 
+DEFINE_int32(ipc_path_reload_check_interval_msec, 0,
+             "If positive, the timestamp of the ipc key file is checked at "
+             "most once per this interval, and the cached path info is used "
+             "in between.");
+
 namespace mozc {
 namespace {
 
@@ -175,7 +182,8 @@ IPCPathManager::IPCPathManager(const string &name)
       ipc_path_info_(new ipc::IPCPathInfo),
       name_(name),
       server_pid_(0),
-      last_modified_(-1) {}
+      last_modified_(-1),
+      last_checked_msec_(0) {}
 
 IPCPathManager::~IPCPathManager() {}
 
@@ -232,6 +240,7 @@ bool IPCPathManager::SavePathName() {
   VLOG(1) << "ServerIPCKey: " << ipc_path_info_->key();
 
   last_modified_ = GetIPCFileTimeStamp();
+  last_checked_msec_ = GetCurrentTimeInMsec();
   return true;
 }
 
@@ -439,6 +448,18 @@ bool IPCPathManager::ShouldReload() const {
 #else
   scoped_lock l(mutex_.get());
 
+  // Within the check interval, trust the path info loaded last time and
+  // avoid stat(2) on every connection.
+  const uint64 now_msec = GetCurrentTimeInMsec();
+  if (FLAGS_ipc_path_reload_check_interval_msec > 0 &&
+      last_modified_ != static_cast<time_t>(-1) &&
+      now_msec >= last_checked_msec_ &&
+      now_msec - last_checked_msec_ <
+          static_cast<uint64>(FLAGS_ipc_path_reload_check_interval_msec)) {
+    return false;
+  }
+  last_checked_msec_ = now_msec;
+
   time_t last_modified = GetIPCFileTimeStamp();
   if (last_modified == last_modified_) {
     return false;
@@ -464,6 +485,14 @@ time_t IPCPathManager::GetIPCFileTimeStamp() const {
 #endif  // OS_WIN
 }
 
+// static
+uint64 IPCPathManager::GetCurrentTimeInMsec() {
+  uint64 sec = 0;
+  uint32 usec = 0;
+  Clock::GetTimeOfDay(&sec, &usec);
+  return sec * 1000 + usec / 1000;
+}
+
 bool IPCPathManager::LoadPathNameInternal() {
   scoped_lock l(mutex_.get());
 
@@ -545,6 +574,7 @@ bool IPCPathManager::LoadPathNameInternal() {
   VLOG(1) << "ProtocolVersion: " << ipc_path_info_->protocol_version();
 
   last_modified_ = GetIPCFileTimeStamp();
+  last_checked_msec_ = GetCurrentTimeInMsec();
   return true;
 }
 }  // namespace mozc
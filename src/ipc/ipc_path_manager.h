@@ -117,6 +117,7 @@ class IPCPathManager {
  private:
   FRIEND_TEST(IPCPathManagerTest, ReloadTest);
   FRIEND_TEST(IPCPathManagerTest, PathNameTest);
+  FRIEND_TEST(IPCPathManagerTest, ReloadCheckIntervalTest);
 
   bool LoadPathNameInternal();
 
@@ -126,6 +127,9 @@ class IPCPathManager {
   // Returns the last modified timestamp of the IPC file.
   time_t GetIPCFileTimeStamp() const;
 
+  // Returns the current wall-clock time in milliseconds.
+  static uint64 GetCurrentTimeInMsec();
+
   std::unique_ptr<ProcessMutex> path_mutex_;   // lock ipc path file
   std::unique_ptr<Mutex> mutex_;   // mutex for methods
   std::unique_ptr<ipc::IPCPathInfo> ipc_path_info_;
@@ -133,6 +137,9 @@ class IPCPathManager {
   string server_path_;   // cache for server_path
   uint32 server_pid_;    // cache for pid of server_path
   time_t last_modified_;
+  // When the timestamp of the ipc file was checked last time. Used to
+  // throttle stat(2) with --ipc_path_reload_check_interval_msec.
+  mutable uint64 last_checked_msec_;
 #ifdef OS_WIN
   std::map<string, std::wstring> expected_server_ntpath_cache_;
 #endif  // OS_WIN
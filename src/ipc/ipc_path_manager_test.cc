@@ -39,6 +39,7 @@
 #include "base/port.h"
 #include "base/file_stream.h"
 #include "base/file_util.h"
+#include "base/flags.h"
 #include "base/process_mutex.h"
 #include "base/system_util.h"
 #include "base/thread.h"
@@ -49,6 +50,7 @@
 #include "testing/base/public/gunit.h"
 
 DECLARE_string(test_tmpdir);
+DECLARE_int32(ipc_path_reload_check_interval_msec);
 
 namespace mozc {
 namespace {
@@ -158,6 +160,37 @@ TEST_F(IPCPathManagerTest, ReloadTest) {
 #endif  // OS_WIN
 }
 
+TEST_F(IPCPathManagerTest, ReloadCheckIntervalTest) {
+#ifndef OS_WIN
+  const int32 original_interval = FLAGS_ipc_path_reload_check_interval_msec;
+  IPCPathManager *manager =
+      IPCPathManager::GetIPCPathManager("reload_interval_test");
+
+  EXPECT_TRUE(manager->CreateNewPathName());
+  EXPECT_TRUE(manager->SavePathName());
+
+  EXPECT_TRUE(manager->path_mutex_->UnLock());
+  Util::Sleep(1000);  // msec
+  string filename = FileUtil::JoinPath(
+      SystemUtil::GetUserProfileDirectory(), ".reload_interval_test.ipc");
+  OutputFileStream outf(filename.c_str());
+  outf << "foobar";
+  outf.close();
+
+  // The modification is not noticed within the check interval.
+  FLAGS_ipc_path_reload_check_interval_msec = 60 * 60 * 1000;
+  EXPECT_FALSE(manager->ShouldReload());
+
+  // Once the interval has passed, the timestamp is checked again.
+  manager->last_checked_msec_ = 0;
+  EXPECT_TRUE(manager->ShouldReload());
+
+  FLAGS_ipc_path_reload_check_interval_msec = 0;
+  EXPECT_TRUE(manager->ShouldReload());
+  FLAGS_ipc_path_reload_check_interval_msec = original_interval;
+#endif  // OS_WIN
+}
+
 TEST_F(IPCPathManagerTest, PathNameTest) {
   IPCPathManager *manager =
       IPCPathManager::GetIPCPathManager("path_name_test");
@@ -29,10 +29,19 @@
 
 #include "ipc/ipc.h"
 
+#if defined(OS_LINUX) && !defined(OS_ANDROID)
+#include <sys/resource.h>
+#include <sys/select.h>
+#include <unistd.h>
+#endif  // OS_LINUX && !OS_ANDROID
+
 #include <algorithm>
+#include <atomic>
+#include <memory>
 #include <vector>
 
 #include "base/flags.h"
+#include "base/logging.h"
 #include "base/port.h"
 #include "base/system_util.h"
 #include "base/thread.h"
@@ -121,6 +130,63 @@ class EchoServer: public mozc::IPCServer {
     return true;
   }
 };
+
+#if defined(OS_LINUX) && !defined(OS_ANDROID)
+// Echoes "fast" requests on the workers and the others after a while.
+class ConcurrentEchoServer : public EchoServer {
+ public:
+  ConcurrentEchoServer(const string &path,
+                       int32 num_connections,
+                       int32 timeout)
+      : EchoServer(path, num_connections, timeout) {
+    set_num_workers(2);
+  }
+
+  bool Process(const char *input_buffer,
+               size_t input_length,
+               char *output_buffer,
+               size_t *output_length) override {
+    mozc::Util::Sleep(500);
+    return EchoServer::Process(input_buffer, input_length,
+                               output_buffer, output_length);
+  }
+
+  bool TryProcessConcurrently(const char *input_buffer,
+                              size_t input_length,
+                              char *output_buffer,
+                              size_t *output_length) override {
+    if (input_length < 4 || ::memcmp("fast", input_buffer, 4) != 0) {
+      return false;
+    }
+    ::memcpy(output_buffer, input_buffer, input_length);
+    *output_length = input_length;
+    return true;
+  }
+};
+
+class SlowCall : public mozc::Thread {
+ public:
+  SlowCall() : done_(false) {}
+
+  void Run() override {
+    mozc::IPCClient con(kServerAddress, "");
+    ASSERT_TRUE(con.Connected());
+    const string input = "slow";
+    char buf[32];
+    size_t length = sizeof(buf);
+    EXPECT_TRUE(con.Call(input.data(), input.size(), buf, &length, 3000));
+    EXPECT_EQ(input, string(buf, length));
+    done_ = true;
+  }
+
+  bool done() const {
+    return done_;
+  }
+
+ private:
+  std::atomic<bool> done_;
+};
+#endif  // OS_LINUX && !OS_ANDROID
 }  // namespace
 
 TEST(IPCTest, IPCTest) {
@@ -168,3 +234,202 @@ TEST(IPCTest, IPCTest) {
 
   con.Wait();
 }
+
+#if defined(OS_LINUX) && !defined(OS_ANDROID)
+TEST(IPCTest, ConcurrentServer) {
+  mozc::SystemUtil::SetUserProfileDirectory(FLAGS_test_tmpdir);
+
+  ConcurrentEchoServer con(kServerAddress, 10, 3000);
+  con.LoopAndReturn();
+
+  SlowCall slow;
+  slow.SetJoinable(true);
+  slow.Start("ConcurrentServer");
+  mozc::Util::Sleep(100);
+
+  // Answered while the slow request is still in Process().
+  {
+    mozc::IPCClient fast(kServerAddress, "");
+    ASSERT_TRUE(fast.Connected());
+    const string input = "fast";
+    char buf[32];
+    size_t length = sizeof(buf);
+    EXPECT_TRUE(fast.Call(input.data(), input.size(), buf, &length, 3000));
+    EXPECT_EQ(input, string(buf, length));
+    EXPECT_FALSE(slow.done());
+  }
+  slow.Join();
+  EXPECT_TRUE(slow.done());
+
+  // Both kinds of requests on a persistent connection.
+  {
+    mozc::IPCClient persistent(kServerAddress, "");
+    ASSERT_TRUE(persistent.Connected());
+    ASSERT_TRUE(persistent.EnablePersistentConnection());
+    const char *kInputs[] = {"fast1", "slow1", "fast2", "slow2"};
+    for (size_t i = 0; i < arraysize(kInputs); ++i) {
+      const string input = kInputs[i];
+      char buf[32];
+      size_t length = sizeof(buf);
+      EXPECT_TRUE(persistent.Call(input.data(), input.size(), buf, &length,
+                                  3000));
+      EXPECT_EQ(input, string(buf, length));
+    }
+  }
+
+  mozc::IPCClient kill(kServerAddress, "");
+  const char kill_cmd[32] = "kill";
+  char output[32];
+  size_t output_size = sizeof(output);
+  kill.Call(kill_cmd, strlen(kill_cmd), output, &output_size, 3000);
+
+  con.Wait();
+}
+#endif  // OS_LINUX && !OS_ANDROID
+
+#if defined(OS_LINUX) && !defined(OS_ANDROID)
+TEST(IPCTest, PersistentConnection) {
+  mozc::SystemUtil::SetUserProfileDirectory(FLAGS_test_tmpdir);
+
+  std::unique_ptr<EchoServer> server(
+      new EchoServer(kServerAddress, 10, 1000));
+  server->LoopAndReturn();
+
+  mozc::IPCClient persistent(kServerAddress, "");
+  ASSERT_TRUE(persistent.Connected());
+  ASSERT_TRUE(persistent.EnablePersistentConnection());
+  char buf[8192];
+  for (int i = 0; i < 100; ++i) {
+    string input = "test";
+    input += GenRandomString(mozc::Util::Random(4000));
+    size_t length = sizeof(buf);
+    ASSERT_TRUE(persistent.Call(input.data(), input.size(), buf, &length,
+                                1000));
+    EXPECT_EQ(input, string(buf, length));
+
+    // One-shot connections are served in between.
+    mozc::IPCClient one_shot(kServerAddress, "");
+    ASSERT_TRUE(one_shot.Connected());
+    length = sizeof(buf);
+    ASSERT_TRUE(one_shot.Call(input.data(), input.size(), buf, &length,
+                              1000));
+    EXPECT_EQ(input, string(buf, length));
+  }
+
+  {
+    mozc::IPCClient kill(kServerAddress, "");
+    const char kill_cmd[32] = "kill";
+    size_t length = sizeof(buf);
+    kill.Call(kill_cmd, strlen(kill_cmd), buf, &length, 1000);
+    server->Wait();
+  }
+
+  // Reconnects to the restarted server.
+  server.reset(new EchoServer(kServerAddress, 10, 1000));
+  server->LoopAndReturn();
+  const string input = "restarted";
+  size_t length = sizeof(buf);
+  EXPECT_TRUE(persistent.Call(input.data(), input.size(), buf, &length,
+                              1000));
+  EXPECT_EQ(input, string(buf, length));
+
+  // "kill" on the persistent connection.
+  const char kill_cmd[32] = "kill";
+  length = sizeof(buf);
+  persistent.Call(kill_cmd, strlen(kill_cmd), buf, &length, 1000);
+  server->Wait();
+}
+#endif  // OS_LINUX && !OS_ANDROID
+
+#if defined(OS_LINUX) && !defined(OS_ANDROID)
+TEST(IPCTest, SharedMemory) {
+  mozc::SystemUtil::SetUserProfileDirectory(FLAGS_test_tmpdir);
+
+  EchoServer server(kServerAddress, 10, 1000);
+  server.LoopAndReturn();
+
+  mozc::IPCClient client(kServerAddress, "");
+  ASSERT_TRUE(client.Connected());
+  ASSERT_TRUE(client.EnableSharedMemory(1 << 20));
+  EXPECT_TRUE(client.EnablePersistentConnection());
+
+  // Larger than IPC_REQUESTSIZE and IPC_RESPONSESIZE.
+  const size_t kSize = 300 * 1024;
+  std::unique_ptr<char[]> buf(new char[kSize]);
+  for (int i = 0; i < 10; ++i) {
+    string input = "test";
+    input += GenRandomString(kSize - 4 - i);
+    size_t length = kSize;
+    ASSERT_TRUE(client.Call(input.data(), input.size(), buf.get(), &length,
+                            1000));
+    EXPECT_EQ(input, string(buf.get(), length));
+  }
+
+  // Clients from the factory reuse the connection.
+  std::unique_ptr<mozc::IPCClientInterface> factory_client(
+      mozc::SharedMemoryIPCClientFactory::GetIPCClientFactory()->NewClient(
+          kServerAddress));
+  ASSERT_TRUE(factory_client->Connected());
+  EXPECT_TRUE(factory_client->EnablePersistentConnection());
+  for (int i = 0; i < 10; ++i) {
+    const string input = "test" + GenRandomString(100);
+    size_t length = kSize;
+    ASSERT_TRUE(factory_client->Call(input.data(), input.size(), buf.get(),
+                                     &length, 1000));
+    EXPECT_EQ(input, string(buf.get(), length));
+  }
+
+  const char kill_cmd[32] = "kill";
+  size_t length = kSize;
+  client.Call(kill_cmd, strlen(kill_cmd), buf.get(), &length, 1000);
+  server.Wait();
+}
+#endif  // OS_LINUX && !OS_ANDROID
+
+#if defined(OS_LINUX) && !defined(OS_ANDROID)
+TEST(IPCTest, LargeDescriptorNumber) {
+  mozc::SystemUtil::SetUserProfileDirectory(FLAGS_test_tmpdir);
+
+  // Occupy the descriptors below FD_SETSIZE so that the sockets get larger
+  // numbers, which select() cannot handle.
+  rlimit limit;
+  ASSERT_EQ(0, ::getrlimit(RLIMIT_NOFILE, &limit));
+  if (limit.rlim_max < FD_SETSIZE + 64) {
+    LOG(WARNING) << "Cannot open enough files. Skipped.";
+    return;
+  }
+  const rlim_t original_limit = limit.rlim_cur;
+  limit.rlim_cur = std::max<rlim_t>(limit.rlim_cur, FD_SETSIZE + 64);
+  ASSERT_EQ(0, ::setrlimit(RLIMIT_NOFILE, &limit));
+  std::vector<int> fds;
+  while (fds.empty() || fds.back() < FD_SETSIZE) {
+    const int fd = ::dup(0);
+    ASSERT_LE(0, fd);
+    fds.push_back(fd);
+  }
+
+  EchoServer server(kServerAddress, 10, 1000);
+  server.LoopAndReturn();
+  char buf[8192];
+  for (int i = 0; i < 10; ++i) {
+    mozc::IPCClient client(kServerAddress, "");
+    ASSERT_TRUE(client.Connected());
+    const string input = "test" + GenRandomString(4000);
+    size_t length = sizeof(buf);
+    ASSERT_TRUE(client.Call(input.data(), input.size(), buf, &length, 1000));
+    EXPECT_EQ(input, string(buf, length));
+  }
+
+  mozc::IPCClient kill(kServerAddress, "");
+  const char kill_cmd[32] = "kill";
+  size_t length = sizeof(buf);
+  kill.Call(kill_cmd, strlen(kill_cmd), buf, &length, 1000);
+  server.Wait();
+
+  for (size_t i = 0; i < fds.size(); ++i) {
+    ::close(fds[i]);
+  }
+  limit.rlim_cur = original_limit;
+  ::setrlimit(RLIMIT_NOFILE, &limit);
+}
+#endif  // OS_LINUX && !OS_ANDROID
@@ -36,21 +36,29 @@
 #include <fcntl.h>
 #include <libgen.h>
 #include <netinet/in.h>
+#include <poll.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
-#include <sys/time.h>
 #include <sys/types.h>
 #include <sys/un.h>
 #include <sys/wait.h>
+#include <time.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <atomic>
 #include <cerrno>
 #include <cstring>
 #include <cstdlib>
+#include <memory>
+#include <vector>
 
 #include "base/file_util.h"
 #include "base/logging.h"
+#include "base/mutex.h"
 #include "base/thread.h"
+#include "base/thread_pool.h"
 #include "ipc/ipc_path_manager.h"
 
 #ifndef UNIX_PATH_MAX
@@ -63,6 +71,30 @@ namespace {
 
 const int kInvalidSocket = -1;
 
+// Sent by the client at the beginning of a persistent connection.  After
+// that, each request and response is preceded by its size in 4 bytes, little
+// endian.  Requests of the one-shot connection are delimited by the
+// half-close instead, and never start with '\0' in practice as they are
+// serialized protocol buffers.
+const char kPersistentConnectionHeader[] = {'\0', 'M', 'Z', 'P'};
+// Sent instead of kPersistentConnectionHeader with a memfd attached.  The
+// first half of the memory is for the requests and the rest is for the
+// responses.
+const char kSharedMemoryConnectionHeader[] = {'\0', 'M', 'Z', 'S'};
+const size_t kConnectionHeaderSize = sizeof(kPersistentConnectionHeader);
+const uint32 kPersistentConnectionProtocolVersion = 4;
+const uint32 kSharedMemoryProtocolVersion = 5;
+
+// Set to the size of a message whose body is in the shared memory instead of
+// following the size.
+const uint32 kSharedMemoryFlag = 0x80000000;
+// The server rejects larger shared memory.
+const off_t kMaxSharedMemorySize = 64 << 20;
+
+// Idle persistent connections kept by the server.  The oldest one is closed
+// when a new one exceeds the limit.
+const size_t kMaxPersistentConnections = 32;
+
 void mkdir_p(const string &dirname) {
   const string parent_dir = FileUtil::Dirname(dirname);
   struct stat st;
@@ -73,51 +105,55 @@ void mkdir_p(const string &dirname) {
   FileUtil::CreateDirectory(dirname);
 }
 
-bool IsReadTimeout(int socket, int timeout) {
+// Returns the deadline |timeout| msec later for WaitForSocket().  Returns -1
+// if |timeout| is negative, i.e. there is no deadline.
+int64 GetDeadline(int timeout) {
   if (timeout < 0) {
-    return false;
+    return -1;
   }
-  fd_set fds;
-  struct timeval tv;
-  FD_ZERO(&fds);
-  FD_SET(socket, &fds);
-  tv.tv_sec = timeout / 1000;
-  tv.tv_usec = 1000 * (timeout % 1000);
-  if (select(socket + 1, &fds, NULL, NULL, &tv) < 0) {
-    // Mac OS X and glibc implementations of strerror() return a pointer to a
-    // string literal whenever errno is in a valid range, and thus thread-safe.
-    // Probably we don't have to use the cumbersome strerror_r() function.
-    LOG(WARNING) << "select() failed: " << strerror(errno);
-    return true;
-  }
-  if (FD_ISSET(socket, &fds)) {
-    return false;
-  }
-
-  LOG(ERROR) << "FD_ISSET failed";
-  return true;
+  timespec now;
+  ::clock_gettime(CLOCK_MONOTONIC, &now);
+  return static_cast<int64>(now.tv_sec) * 1000 + now.tv_nsec / 1000000 +
+         timeout;
 }
 
-bool IsWriteTimeout(int socket, int timeout) {
-  if (timeout < 0) {
-    return false;
-  }
-  fd_set fds;
-  struct timeval tv;
-  FD_ZERO(&fds);
-  FD_SET(socket, &fds);
-  tv.tv_sec = timeout / 1000;
-  tv.tv_usec = 1000 * (timeout % 1000);
-  if (select(socket + 1, NULL, &fds, NULL, &tv) < 0) {
-    LOG(WARNING) << "select() failed: " << strerror(errno);
-    return true;
-  }
-  if (FD_ISSET(socket, &fds)) {
-    return false;
+// Waits until |socket| is ready for |events| (POLLIN or POLLOUT).  Returns
+// false if |deadline| from GetDeadline() has passed or poll() fails.  Unlike
+// select(), poll() works with any descriptor number, which matters in the
+// hosts with many files open.
+bool WaitForSocket(int socket, int16 events, int64 deadline) {
+  while (true) {
+    int timeout = -1;
+    if (deadline >= 0) {
+      timeout = static_cast<int>(
+          std::max<int64>(deadline - GetDeadline(0), 0));
+    }
+    pollfd fd;
+    fd.fd = socket;
+    fd.events = events;
+    fd.revents = 0;
+    const int result = ::poll(&fd, 1, timeout);
+    if (result > 0) {
+      return true;
+    }
+    if (result == 0) {
+      return false;
+    }
+    if (errno != EINTR) {
+      // Mac OS X and glibc implementations of strerror() return a pointer to
+      // a string literal whenever errno is in a valid range, and thus
+      // thread-safe.  Probably we don't have to use the cumbersome
+      // strerror_r() function.
+      LOG(WARNING) << "poll() failed: " << strerror(errno);
+      return false;
+    }
   }
+}
 
-  LOG(ERROR) << "FD_ISSET failed";
-  return true;
+// Returns true if a non-blocking socket operation has failed only because
+// the socket is not ready.
+bool IsNotReady() {
+  return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
 }
 
 bool IsPeerValid(int socket, pid_t *pid) {
@@ -152,14 +188,21 @@ bool SendMessage(int socket,
                  const char *buf,
                  size_t buf_length, int timeout,
                  IPCErrorType *last_ipc_error) {
+  // Waits only when the socket buffer is full, with one deadline for the
+  // whole message.
+  const int64 deadline = GetDeadline(timeout);
   size_t buf_length_left = buf_length;
   while (buf_length_left > 0) {
-    if (IsWriteTimeout(socket, timeout)) {
-      LOG(WARNING) << "Write timeout " << timeout;
-      *last_ipc_error = IPC_TIMEOUT_ERROR;
-      return false;
+    const ssize_t l = ::send(socket, buf, buf_length_left,
+                             MSG_NOSIGNAL | MSG_DONTWAIT);
+    if (l < 0 && IsNotReady()) {
+      if (!WaitForSocket(socket, POLLOUT, deadline)) {
+        LOG(WARNING) << "Write timeout " << timeout;
+        *last_ipc_error = IPC_TIMEOUT_ERROR;
+        return false;
+      }
+      continue;
     }
-    const ssize_t l = ::send(socket, buf, buf_length_left, MSG_NOSIGNAL);
     if (l < 0) {
       // An error occurs.
       LOG(ERROR) << "an error occurred during sending \""
@@ -184,16 +227,23 @@ bool RecvMessage(int socket,
     *last_ipc_error = IPC_UNKNOWN_ERROR;
     return false;
   }
+  // Waits only when no data is available, with one deadline for the whole
+  // message.
+  const int64 deadline = GetDeadline(timeout);
   ssize_t buf_left = *buf_length;
   ssize_t read_length = 0;
   *buf_length = 0;
   do {
-    if (IsReadTimeout(socket, timeout)) {
-      LOG(WARNING) << "Read timeout " << timeout;
-      *last_ipc_error = IPC_TIMEOUT_ERROR;
-      return false;
+    read_length = ::recv(socket, buf, buf_left, MSG_DONTWAIT);
+    if (read_length < 0 && IsNotReady()) {
+      if (!WaitForSocket(socket, POLLIN, deadline)) {
+        LOG(WARNING) << "Read timeout " << timeout;
+        *buf_length = 0;
+        *last_ipc_error = IPC_TIMEOUT_ERROR;
+        return false;
+      }
+      continue;
     }
-    read_length = ::recv(socket, buf, buf_left, 0);
     if (read_length < 0) {
       LOG(ERROR) << "an error occurred during recv(): " << strerror(errno);
       *buf_length = 0;
@@ -208,6 +258,246 @@ bool RecvMessage(int socket,
   return true;
 }
 
+bool SendFrameHeader(int socket, uint32 header, int timeout,
+                     IPCErrorType *last_ipc_error) {
+  const char buf[4] = {
+    static_cast<char>(header & 0xff),
+    static_cast<char>((header >> 8) & 0xff),
+    static_cast<char>((header >> 16) & 0xff),
+    static_cast<char>((header >> 24) & 0xff),
+  };
+  return SendMessage(socket, buf, sizeof(buf), timeout, last_ipc_error);
+}
+
+// Receives the size sent by SendFrameHeader().  Sets IPC_NO_CONNECTION if the
+// peer has closed the connection before it.
+bool RecvFrameHeader(int socket, uint32 *header, int timeout,
+                     IPCErrorType *last_ipc_error) {
+  char buf[4];
+  size_t length = sizeof(buf);
+  if (!RecvMessage(socket, buf, &length, timeout, last_ipc_error)) {
+    return false;
+  }
+  if (length != sizeof(buf)) {
+    *last_ipc_error = (length == 0) ? IPC_NO_CONNECTION : IPC_READ_ERROR;
+    return false;
+  }
+  *header = static_cast<uint8>(buf[0]) |
+            (static_cast<uint8>(buf[1]) << 8) |
+            (static_cast<uint8>(buf[2]) << 16) |
+            (static_cast<uint32>(static_cast<uint8>(buf[3])) << 24);
+  return true;
+}
+
+// Receives the |size| bytes following the header into |buf|.
+bool RecvFrameBody(int socket,
+                   char *buf,
+                   size_t buf_length,
+                   uint32 size,
+                   int timeout,
+                   IPCErrorType *last_ipc_error) {
+  if (size > buf_length) {
+    LOG(ERROR) << "Too large message: " << size;
+    *last_ipc_error = IPC_READ_ERROR;
+    return false;
+  }
+  if (size == 0) {
+    return true;
+  }
+  size_t received = size;
+  if (!RecvMessage(socket, buf, &received, timeout, last_ipc_error)) {
+    return false;
+  }
+  if (received != size) {
+    LOG(ERROR) << "Truncated message: " << received << " < " << size;
+    *last_ipc_error = IPC_READ_ERROR;
+    return false;
+  }
+  return true;
+}
+
+bool SendFrame(int socket,
+               const char *buf,
+               size_t buf_length, int timeout,
+               IPCErrorType *last_ipc_error) {
+  return SendFrameHeader(socket, static_cast<uint32>(buf_length), timeout,
+                         last_ipc_error) &&
+         SendMessage(socket, buf, buf_length, timeout, last_ipc_error);
+}
+
+// Sends |buf| with |fd| attached.
+bool SendMessageWithFd(int socket,
+                       const char *buf,
+                       size_t buf_length,
+                       int fd,
+                       int timeout,
+                       IPCErrorType *last_ipc_error) {
+  iovec iov;
+  iov.iov_base = const_cast<char *>(buf);
+  iov.iov_len = buf_length;
+  char control[CMSG_SPACE(sizeof(fd))];
+  ::memset(control, 0, sizeof(control));
+  msghdr msg;
+  ::memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+  cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(fd));
+  ::memcpy(CMSG_DATA(cmsg), &fd, sizeof(fd));
+  const int64 deadline = GetDeadline(timeout);
+  ssize_t l = 0;
+  while ((l = ::sendmsg(socket, &msg, MSG_NOSIGNAL | MSG_DONTWAIT)) < 0 &&
+         IsNotReady()) {
+    if (!WaitForSocket(socket, POLLOUT, deadline)) {
+      LOG(WARNING) << "Write timeout " << timeout;
+      *last_ipc_error = IPC_TIMEOUT_ERROR;
+      return false;
+    }
+  }
+  if (l < 0) {
+    LOG(ERROR) << "an error occurred during sendmsg(): " << strerror(errno);
+    *last_ipc_error = IPC_WRITE_ERROR;
+    return false;
+  }
+  if (static_cast<size_t>(l) < buf_length) {
+    return SendMessage(socket, buf + l, buf_length - l, timeout,
+                       last_ipc_error);
+  }
+  return true;
+}
+
+// Same as RecvMessage(), and also receives a file descriptor attached to the
+// message into |fd|.  Sets -1 to |fd| if nothing is attached.
+bool RecvMessageWithFd(int socket,
+                       char *buf,
+                       size_t *buf_length,
+                       int *fd,
+                       int timeout,
+                       IPCErrorType *last_ipc_error) {
+  *fd = -1;
+  if (*buf_length == 0) {
+    LOG(WARNING) << "buf_length is 0";
+    *last_ipc_error = IPC_UNKNOWN_ERROR;
+    return false;
+  }
+  ssize_t buf_left = *buf_length;
+  ssize_t read_length = 0;
+  *buf_length = 0;
+  bool error = false;
+  const int64 deadline = GetDeadline(timeout);
+  do {
+    iovec iov;
+    iov.iov_base = buf;
+    iov.iov_len = buf_left;
+    char control[CMSG_SPACE(sizeof(*fd))];
+    msghdr msg;
+    ::memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    read_length = ::recvmsg(socket, &msg, MSG_CMSG_CLOEXEC | MSG_DONTWAIT);
+    if (read_length < 0 && IsNotReady()) {
+      if (!WaitForSocket(socket, POLLIN, deadline)) {
+        LOG(WARNING) << "Read timeout " << timeout;
+        *last_ipc_error = IPC_TIMEOUT_ERROR;
+        error = true;
+        break;
+      }
+      continue;
+    }
+    if (read_length < 0) {
+      LOG(ERROR) << "an error occurred during recvmsg(): " << strerror(errno);
+      *last_ipc_error = IPC_READ_ERROR;
+      error = true;
+      break;
+    }
+    for (cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL;
+         cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+      if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS ||
+          cmsg->cmsg_len != CMSG_LEN(sizeof(*fd))) {
+        continue;
+      }
+      int received_fd = -1;
+      ::memcpy(&received_fd, CMSG_DATA(cmsg), sizeof(received_fd));
+      if (*fd < 0) {
+        *fd = received_fd;
+      } else {
+        ::close(received_fd);
+      }
+    }
+    *buf_length += read_length;
+    buf += read_length;
+    buf_left -= read_length;
+  } while (read_length != 0 && buf_left > 0);
+
+  if (error) {
+    if (*fd >= 0) {
+      ::close(*fd);
+      *fd = -1;
+    }
+    *buf_length = 0;
+    return false;
+  }
+  VLOG(1) << *buf_length << " bytes received";
+  return true;
+}
+
+// Creates a memfd of |size| bytes which cannot be resized.  Returns -1 on
+// failure.
+int CreateSharedMemory(size_t size) {
+#ifdef MFD_ALLOW_SEALING
+  const int fd = ::memfd_create("mozc_ipc", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  if (fd < 0) {
+    LOG(WARNING) << "memfd_create() failed: " << strerror(errno);
+    return -1;
+  }
+  if (::ftruncate(fd, size) != 0 ||
+      ::fcntl(fd, F_ADD_SEALS,
+              F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) != 0) {
+    LOG(WARNING) << "cannot prepare the shared memory: " << strerror(errno);
+    ::close(fd);
+    return -1;
+  }
+  return fd;
+#else
+  return -1;
+#endif  // MFD_ALLOW_SEALING
+}
+
+// Maps the memfd created by CreateSharedMemory() and sets its size to |size|.
+// Checks the seals since the server would crash if the client shrank it.
+// Returns NULL on failure.
+char *MapSharedMemory(int fd, size_t *size) {
+#ifdef MFD_ALLOW_SEALING
+  const int seals = ::fcntl(fd, F_GET_SEALS);
+  if (seals < 0 || (seals & F_SEAL_SHRINK) == 0) {
+    LOG(ERROR) << "The shared memory is not sealed";
+    return NULL;
+  }
+  struct stat st;
+  if (::fstat(fd, &st) != 0 || st.st_size <= 0 ||
+      st.st_size > kMaxSharedMemorySize) {
+    LOG(ERROR) << "Invalid shared memory";
+    return NULL;
+  }
+  void *memory = ::mmap(NULL, st.st_size, PROT_READ | PROT_WRITE,
+                        MAP_SHARED, fd, 0);
+  if (memory == MAP_FAILED) {
+    LOG(ERROR) << "mmap() failed: " << strerror(errno);
+    return NULL;
+  }
+  *size = st.st_size;
+  return static_cast<char *>(memory);
+#else
+  return NULL;
+#endif  // MFD_ALLOW_SEALING
+}
+
 void SetCloseOnExecFlag(int fd) {
   int flags = ::fcntl(fd, F_GETFD, 0);
   if (flags < 0) {
@@ -227,6 +517,159 @@ void SetCloseOnExecFlag(int fd) {
 bool IsAbstractSocket(const string& address) {
   return (!address.empty()) && (address[0] == '\0');
 }
+
+// An accepted connection on the server, which may be persistent and have a
+// shared memory attached.  Closes the socket on destruction.
+class ServerConnection {
+ public:
+  explicit ServerConnection(int socket)
+      : socket_(socket),
+        persistent_(false),
+        shared_memory_(NULL),
+        shared_memory_size_(0),
+        last_request_shared_(false) {}
+
+  ~ServerConnection() {
+    if (shared_memory_ != NULL) {
+      ::munmap(shared_memory_, shared_memory_size_);
+    }
+    ::close(socket_);
+  }
+
+  int socket() const {
+    return socket_;
+  }
+
+  bool persistent() const {
+    return persistent_;
+  }
+
+  // Receives the first request on the accepted socket into |buf| and sets
+  // |*request| to it.  If the client starts a persistent connection instead,
+  // sets NULL to |*request|, since the requests on it may come later.
+  bool ReceiveFirst(char *buf,
+                    size_t *buf_length,
+                    const char **request,
+                    int timeout,
+                    IPCErrorType *last_ipc_error) {
+    *request = NULL;
+    size_t head_length = std::min(*buf_length, kConnectionHeaderSize);
+    int fd = -1;
+    if (!RecvMessageWithFd(socket_, buf, &head_length, &fd, timeout,
+                           last_ipc_error)) {
+      return false;
+    }
+    if (head_length == kConnectionHeaderSize &&
+        ::memcmp(buf, kSharedMemoryConnectionHeader, head_length) == 0) {
+      if (fd < 0) {
+        LOG(ERROR) << "No shared memory is attached";
+        *last_ipc_error = IPC_READ_ERROR;
+        return false;
+      }
+      shared_memory_ = MapSharedMemory(fd, &shared_memory_size_);
+      ::close(fd);
+      if (shared_memory_ == NULL) {
+        *last_ipc_error = IPC_READ_ERROR;
+        return false;
+      }
+      persistent_ = true;
+      return true;
+    }
+    if (fd >= 0) {
+      ::close(fd);
+    }
+    if (head_length == kConnectionHeaderSize &&
+        ::memcmp(buf, kPersistentConnectionHeader, head_length) == 0) {
+      persistent_ = true;
+      return true;
+    }
+
+    *request = buf;
+    size_t rest_length = *buf_length - head_length;
+    if (head_length < kConnectionHeaderSize || rest_length == 0) {
+      // Already reached the end of the request or the buffer.
+      *buf_length = head_length;
+      return true;
+    }
+    if (!RecvMessage(socket_, buf + head_length, &rest_length, timeout,
+                     last_ipc_error)) {
+      return false;
+    }
+    *buf_length = head_length + rest_length;
+    return true;
+  }
+
+  // Receives the next request on the persistent connection, either into
+  // |buf| or in the shared memory, and sets |*request| to it.
+  bool Receive(char *buf,
+               size_t *buf_length,
+               const char **request,
+               int timeout,
+               IPCErrorType *last_ipc_error) {
+    uint32 header = 0;
+    if (!RecvFrameHeader(socket_, &header, timeout, last_ipc_error)) {
+      return false;
+    }
+    last_request_shared_ = (header & kSharedMemoryFlag) != 0;
+    if (last_request_shared_) {
+      const size_t length = header & ~kSharedMemoryFlag;
+      if (shared_memory_ == NULL || length > shared_memory_size_ / 2) {
+        LOG(ERROR) << "Invalid request in the shared memory: " << length;
+        *last_ipc_error = IPC_READ_ERROR;
+        return false;
+      }
+      *request = shared_memory_;
+      *buf_length = length;
+      return true;
+    }
+    if (!RecvFrameBody(socket_, buf, *buf_length, header, timeout,
+                       last_ipc_error)) {
+      return false;
+    }
+    *request = buf;
+    *buf_length = header;
+    return true;
+  }
+
+  // Returns the shared memory for the response if the last request came
+  // through it, and sets its size to |size|.  Otherwise returns NULL.
+  char *GetSharedResponseBuffer(size_t *size) {
+    if (!last_request_shared_) {
+      return NULL;
+    }
+    const size_t offset = shared_memory_size_ / 2;
+    *size = shared_memory_size_ - offset;
+    return shared_memory_ + offset;
+  }
+
+  // Sends the response to the last request.  |response| must be the buffer
+  // returned by GetSharedResponseBuffer() if it isn't NULL.
+  bool Send(const char *response,
+            size_t size,
+            int timeout,
+            IPCErrorType *last_ipc_error) {
+    if (!persistent_) {
+      if (size == 0) {
+        return true;
+      }
+      return SendMessage(socket_, response, size, timeout, last_ipc_error);
+    }
+    if (last_request_shared_) {
+      return SendFrameHeader(socket_, kSharedMemoryFlag | size, timeout,
+                             last_ipc_error);
+    }
+    return SendFrame(socket_, response, size, timeout, last_ipc_error);
+  }
+
+ private:
+  const int socket_;
+  bool persistent_;
+  char *shared_memory_;
+  size_t shared_memory_size_;
+  bool last_request_shared_;
+
+  DISALLOW_COPY_AND_ASSIGN(ServerConnection);
+};
 }  // namespace
 
 // Client
@@ -246,6 +689,8 @@ IPCClient::IPCClient(const string &name, const string &server_path)
 
 void IPCClient::Init(const string &name, const string &server_path) {
   last_ipc_error_ = IPC_NO_CONNECTION;
+  name_ = name;
+  server_path_ = server_path;
 
   // Try twice, because key may be changed.
   IPCPathManager *manager = IPCPathManager::GetIPCPathManager(name);
@@ -314,6 +759,10 @@ IPCClient::~IPCClient() {
     }
     socket_ = kInvalidSocket;
   }
+  if (shared_memory_ != NULL) {
+    ::munmap(shared_memory_, shared_memory_size_);
+    ::close(shared_memory_fd_);
+  }
   connected_ = false;
   VLOG(1) << "connection closed (IPCClient destructed)";
 }
@@ -325,6 +774,35 @@ bool IPCClient::Call(const char *request_,
                      size_t *response_size,
                      int32 timeout) {
   last_ipc_error_ = IPC_NO_ERROR;
+  if (persistent_) {
+    // Retry once on a new connection if the server has closed the old one.
+    for (int trial = 0; trial < 2; ++trial) {
+      if (trial > 0 || !connected_) {
+        Reconnect();
+        if (!connected_) {
+          return false;
+        }
+      }
+      size_t size = *response_size;
+      if (SendPersistentRequest(request_, input_length, timeout) &&
+          RecvPersistentResponse(response_, &size, timeout)) {
+        *response_size = size;
+        VLOG(1) << "Call succeeded";
+        return true;
+      }
+      // Don't reuse the connection, which may have a pending response.
+      ::close(socket_);
+      socket_ = kInvalidSocket;
+      connected_ = false;
+      if (last_ipc_error_ != IPC_WRITE_ERROR &&
+          last_ipc_error_ != IPC_NO_CONNECTION) {
+        break;
+      }
+    }
+    LOG(ERROR) << "Call failed on the persistent connection";
+    return false;
+  }
+
   if (!SendMessage(socket_, request_, input_length, timeout,
                    &last_ipc_error_)) {
     LOG(ERROR) << "SendMessage failed";
@@ -352,6 +830,112 @@ bool IPCClient::Connected() const {
   return connected_;
 }
 
+bool IPCClient::EnablePersistentConnection() {
+  if (persistent_) {
+    return true;
+  }
+  if (!connected_ ||
+      GetServerProtocolVersion() < kPersistentConnectionProtocolVersion) {
+    return false;
+  }
+  if (!StartPersistentConnection()) {
+    return false;
+  }
+  persistent_ = true;
+  return true;
+}
+
+bool IPCClient::EnableSharedMemory(size_t size) {
+  if (persistent_) {
+    return shared_memory_ != NULL;
+  }
+  if (!connected_ ||
+      GetServerProtocolVersion() < kSharedMemoryProtocolVersion) {
+    return false;
+  }
+  const int fd = CreateSharedMemory(size);
+  if (fd < 0) {
+    return false;
+  }
+  char *memory = MapSharedMemory(fd, &size);
+  if (memory == NULL) {
+    ::close(fd);
+    return false;
+  }
+  shared_memory_fd_ = fd;
+  shared_memory_ = memory;
+  shared_memory_size_ = size;
+  if (!StartPersistentConnection()) {
+    return false;
+  }
+  persistent_ = true;
+  return true;
+}
+
+bool IPCClient::StartPersistentConnection() {
+  if (shared_memory_ != NULL) {
+    return SendMessageWithFd(socket_, kSharedMemoryConnectionHeader,
+                             kConnectionHeaderSize, shared_memory_fd_, -1,
+                             &last_ipc_error_);
+  }
+  return SendMessage(socket_, kPersistentConnectionHeader,
+                     kConnectionHeaderSize, -1, &last_ipc_error_);
+}
+
+bool IPCClient::SendPersistentRequest(const char *request,
+                                      size_t request_size,
+                                      int32 timeout) {
+  if (shared_memory_ == NULL || request_size > shared_memory_size_ / 2) {
+    return SendFrame(socket_, request, request_size, timeout,
+                     &last_ipc_error_);
+  }
+  ::memcpy(shared_memory_, request, request_size);
+  return SendFrameHeader(socket_, kSharedMemoryFlag | request_size, timeout,
+                         &last_ipc_error_);
+}
+
+bool IPCClient::RecvPersistentResponse(char *response,
+                                       size_t *response_size,
+                                       int32 timeout) {
+  uint32 header = 0;
+  if (!RecvFrameHeader(socket_, &header, timeout, &last_ipc_error_)) {
+    return false;
+  }
+  if ((header & kSharedMemoryFlag) == 0) {
+    if (!RecvFrameBody(socket_, response, *response_size, header, timeout,
+                       &last_ipc_error_)) {
+      return false;
+    }
+    *response_size = header;
+    return true;
+  }
+  const size_t size = header & ~kSharedMemoryFlag;
+  const size_t offset = shared_memory_size_ / 2;
+  if (shared_memory_ == NULL || size > shared_memory_size_ - offset ||
+      size > *response_size) {
+    LOG(ERROR) << "Invalid response in the shared memory: " << size;
+    last_ipc_error_ = IPC_READ_ERROR;
+    return false;
+  }
+  ::memcpy(response, shared_memory_ + offset, size);
+  *response_size = size;
+  return true;
+}
+
+void IPCClient::Reconnect() {
+  if (socket_ != kInvalidSocket) {
+    ::close(socket_);
+    socket_ = kInvalidSocket;
+  }
+  connected_ = false;
+  Init(name_, server_path_);
+  if (connected_ && !StartPersistentConnection()) {
+    ::close(socket_);
+    socket_ = kInvalidSocket;
+    connected_ = false;
+  }
+}
+
 // Server
 IPCServer::IPCServer(const string &name,
                      int32 num_connections,
@@ -443,47 +1027,316 @@ bool IPCServer::Connected() const {
 }
 
 void IPCServer::Loop() {
+  if (num_workers_ > 0) {
+    LoopConcurrently();
+  } else {
+    LoopSingleThread();
+  }
+
+  ::shutdown(socket_, SHUT_RDWR);
+  ::close(socket_);
+  if (!IsAbstractSocket(server_address_)) {
+    // When abstract namespace is used, unlink() is not necessary.
+    ::unlink(server_address_.c_str());
+  }
+  connected_ = false;
+  socket_ = kInvalidSocket;
+}
+
+void IPCServer::LoopSingleThread() {
   // The most portable and straightforward single-thread server
   bool error = false;
   IPCErrorType last_ipc_error = IPC_NO_ERROR;
   pid_t pid = 0;
+  // Idle persistent connections, oldest first.
+  std::vector<std::unique_ptr<ServerConnection>> connections;
+  std::vector<pollfd> fds;
   while (!error) {
+    fds.resize(connections.size() + 1);
+    for (size_t i = 0; i < connections.size(); ++i) {
+      fds[i].fd = connections[i]->socket();
+      fds[i].events = POLLIN;
+    }
+    fds.back().fd = socket_;
+    fds.back().events = POLLIN;
+    if (::poll(&fds[0], fds.size(), -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      LOG(FATAL) << "poll() failed: " << strerror(errno);
+      return;
+    }
+
+    // Serve the persistent connections first.  Iterates backward to remove
+    // the closed ones.
+    for (size_t i = connections.size(); i > 0 && !error; --i) {
+      if (fds[i - 1].revents == 0) {
+        continue;
+      }
+      ServerConnection *connection = connections[i - 1].get();
+      const char *request = NULL;
+      size_t request_size = sizeof(request_);
+      bool keep = connection->Receive(&request_[0], &request_size, &request,
+                                      timeout_, &last_ipc_error);
+      if (keep) {
+        size_t response_size = sizeof(response_);
+        char *response = connection->GetSharedResponseBuffer(&response_size);
+        if (response == NULL) {
+          response = &response_[0];
+        }
+        if (!Process(request, request_size, response, &response_size)) {
+          LOG(WARNING) << "Process() failed";
+          error = true;
+        }
+        keep = connection->Send(response, response_size, timeout_,
+                                &last_ipc_error);
+      }
+      if (!keep) {
+        connections.erase(connections.begin() + (i - 1));
+      }
+    }
+    if (error || fds.back().revents == 0) {
+      continue;
+    }
+
     const int new_sock = ::accept(socket_, NULL, NULL);
     if (new_sock < 0) {
       LOG(FATAL) << "accept() failed: " << strerror(errno);
       return;
     }
     if (!IsPeerValid(new_sock, &pid)) {
+      ::close(new_sock);
       continue;
     }
+    std::unique_ptr<ServerConnection> connection(
+        new ServerConnection(new_sock));
+    const char *request = NULL;
     size_t request_size = sizeof(request_);
+    if (!connection->ReceiveFirst(&request_[0], &request_size, &request,
+                                  timeout_, &last_ipc_error)) {
+      continue;
+    }
+    if (connection->persistent()) {
+      if (connections.size() >= kMaxPersistentConnections) {
+        connections.erase(connections.begin());
+      }
+      connections.push_back(std::move(connection));
+      continue;
+    }
     size_t response_size = sizeof(response_);
-    if (RecvMessage(new_sock,
-                    &request_[0],
-                    &request_size, timeout_, &last_ipc_error)) {
-      if (!Process(&request_[0], request_size,
-                   &response_[0], &response_size)) {
+    if (!Process(request, request_size, &response_[0], &response_size)) {
+      LOG(WARNING) << "Process() failed";
+      error = true;
+    }
+    connection->Send(&response_[0], response_size, timeout_,
+                     &last_ipc_error);
+  }
+}
+
+void IPCServer::LoopConcurrently() {
+  // Destroyed after the pools, which run the pending tasks on destruction.
+  std::atomic<bool> stopped(false);
+  // Persistent connections handed back after a response, and the pipe to
+  // wake up poll() below for them.
+  Mutex returned_mutex;
+  std::vector<std::shared_ptr<ServerConnection>> returned_connections;
+  int wakeup_pipe[2];
+  if (::pipe(wakeup_pipe) != 0) {
+    LOG(ERROR) << "pipe() failed: " << strerror(errno);
+    LoopSingleThread();
+    return;
+  }
+  SetCloseOnExecFlag(wakeup_pipe[0]);
+  SetCloseOnExecFlag(wakeup_pipe[1]);
+  // A full pipe already wakes up poll().
+  ::fcntl(wakeup_pipe[1], F_SETFL, O_NONBLOCK);
+  const int wakeup_fd = wakeup_pipe[1];
+  auto wake_up = [wakeup_fd]() {
+    const char c = 0;
+    if (::write(wakeup_fd, &c, 1) < 0 && errno != EAGAIN) {
+      LOG(WARNING) << "write() failed: " << strerror(errno);
+    }
+  };
+
+  // Keeps |connection| for the next request if it is persistent.  Otherwise
+  // it is closed when the last reference goes away.
+  auto release = [&stopped, &returned_mutex, &returned_connections, wake_up](
+      std::shared_ptr<ServerConnection> connection) {
+    if (!connection->persistent() || stopped) {
+      return;
+    }
+    {
+      scoped_lock l(&returned_mutex);
+      returned_connections.push_back(std::move(connection));
+    }
+    wake_up();
+  };
+
+  // Idle persistent connections, oldest first.  Only the loop thread
+  // touches them.
+  std::vector<std::shared_ptr<ServerConnection>> connections;
+  {
+    // Declared before |workers| so that it outlives the tasks scheduled
+    // from the workers.
+    ThreadPool ordered_pool(1);
+    ThreadPool workers(num_workers_);
+
+    // Runs on the |ordered_pool| thread.  |buffer| holds |request| unless it
+    // is in the shared memory.
+    auto process_in_order = [this, &stopped, wake_up, release](
+        std::shared_ptr<ServerConnection> connection,
+        std::shared_ptr<string> buffer,
+        const char *request, size_t request_size) {
+      if (stopped) {
+        return;
+      }
+      size_t response_size = sizeof(response_);
+      char *response = connection->GetSharedResponseBuffer(&response_size);
+      if (response == NULL) {
+        response = &response_[0];
+      }
+      IPCErrorType last_ipc_error = IPC_NO_ERROR;
+      if (!Process(request, request_size, response, &response_size)) {
         LOG(WARNING) << "Process() failed";
-        error = true;
+        stopped = true;
+        wake_up();
       }
-      if (response_size > 0) {
-        SendMessage(new_sock,
-                    &response_[0],
-                    response_size, timeout_, &last_ipc_error);
+      if (connection->Send(response, response_size, timeout_,
+                           &last_ipc_error)) {
+        release(connection);
       }
-    }
+    };
 
-    ::close(new_sock);
-  }
+    // Runs on one of the |workers| threads.  |first| is true for a newly
+    // accepted connection.
+    auto receive = [this, &stopped, &ordered_pool, release,
+                    process_in_order](
+        std::shared_ptr<ServerConnection> connection, bool first) {
+      if (stopped) {
+        return;
+      }
+      std::shared_ptr<string> buffer(new string(IPC_REQUESTSIZE, '\0'));
+      const char *request = NULL;
+      size_t request_size = buffer->size();
+      IPCErrorType last_ipc_error = IPC_NO_ERROR;
+      const bool received =
+          first ? connection->ReceiveFirst(&(*buffer)[0], &request_size,
+                                           &request, timeout_,
+                                           &last_ipc_error)
+                : connection->Receive(&(*buffer)[0], &request_size,
+                                      &request, timeout_, &last_ipc_error);
+      if (!received) {
+        return;
+      }
+      if (request == NULL) {
+        // The persistent connection has started, and the requests will come
+        // later on it.
+        release(connection);
+        return;
+      }
+      std::unique_ptr<char[]> local_response;
+      size_t response_size = 0;
+      char *response = connection->GetSharedResponseBuffer(&response_size);
+      if (response == NULL) {
+        local_response.reset(new char[IPC_RESPONSESIZE]);
+        response = local_response.get();
+        response_size = IPC_RESPONSESIZE;
+      }
+      if (TryProcessConcurrently(request, request_size,
+                                 response, &response_size)) {
+        if (connection->Send(response, response_size, timeout_,
+                             &last_ipc_error)) {
+          release(connection);
+        }
+        return;
+      }
+      ordered_pool.Schedule([connection, buffer, request, request_size,
+                             process_in_order]() {
+        process_in_order(connection, buffer, request, request_size);
+      });
+    };
 
-  ::shutdown(socket_, SHUT_RDWR);
-  ::close(socket_);
-  if (!IsAbstractSocket(server_address_)) {
-    // When abstract namespace is used, unlink() is not necessary.
-    ::unlink(server_address_.c_str());
+    pid_t pid = 0;
+    std::vector<pollfd> fds;
+    while (!stopped) {
+      {
+        scoped_lock l(&returned_mutex);
+        for (size_t i = 0; i < returned_connections.size(); ++i) {
+          connections.push_back(std::move(returned_connections[i]));
+        }
+        returned_connections.clear();
+      }
+      while (connections.size() > kMaxPersistentConnections) {
+        connections.erase(connections.begin());
+      }
+
+      fds.resize(connections.size() + 2);
+      for (size_t i = 0; i < connections.size(); ++i) {
+        fds[i].fd = connections[i]->socket();
+        fds[i].events = POLLIN;
+      }
+      pollfd *wakeup = &fds[connections.size()];
+      wakeup->fd = wakeup_pipe[0];
+      wakeup->events = POLLIN;
+      pollfd *listener = &fds[connections.size() + 1];
+      listener->fd = socket_;
+      listener->events = POLLIN;
+      if (::poll(&fds[0], fds.size(), -1) < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        LOG(FATAL) << "poll() failed: " << strerror(errno);
+        return;
+      }
+      if (stopped) {
+        break;
+      }
+      if (wakeup->revents != 0) {
+        char buf[64];
+        if (::read(wakeup_pipe[0], buf, sizeof(buf)) < 0) {
+          LOG(WARNING) << "read() failed: " << strerror(errno);
+        }
+      }
+
+      // Hand the connections with a request to the workers.  Iterates
+      // backward to remove them.
+      for (size_t i = connections.size(); i > 0; --i) {
+        if (fds[i - 1].revents == 0) {
+          continue;
+        }
+        std::shared_ptr<ServerConnection> connection =
+            std::move(connections[i - 1]);
+        connections.erase(connections.begin() + (i - 1));
+        workers.Schedule([connection, receive]() {
+          receive(connection, false);
+        });
+      }
+
+      if (listener->revents == 0) {
+        continue;
+      }
+      const int new_sock = ::accept(socket_, NULL, NULL);
+      if (new_sock < 0) {
+        LOG(FATAL) << "accept() failed: " << strerror(errno);
+        return;
+      }
+      if (!IsPeerValid(new_sock, &pid)) {
+        ::close(new_sock);
+        continue;
+      }
+      std::shared_ptr<ServerConnection> connection(
+          new ServerConnection(new_sock));
+      workers.Schedule([connection, receive]() {
+        receive(connection, true);
+      });
+    }
   }
-  connected_ = false;
-  socket_ = kInvalidSocket;
+
+  // All the tasks have finished here.
+  connections.clear();
+  returned_connections.clear();
+  ::close(wakeup_pipe[0]);
+  ::close(wakeup_pipe[1]);
 }
 
 void IPCServer::Terminate() {
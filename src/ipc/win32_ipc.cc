@@ -37,6 +37,7 @@
 
 #include <algorithm>
 #include <string>
+#include <vector>
 
 #include "base/const.h"
 #include "base/cpu_stats.h"
@@ -57,6 +58,8 @@ const bool kReadTypeACK = true;
 const bool kReadTypeData = false;
 const bool kSendTypeData = false;
 const int kMaxSuccessiveConnectionFailureCount = 5;
+// The maximum number of the named pipe instances created by IPCServer.
+const size_t kMaxPipeInstances = 4;
 
 size_t GetNumberOfProcessors() {
   // thread-safety is not required.
@@ -453,6 +456,42 @@ void MaybeDisableFileCompletionNotification(HANDLE device_handle) {
                                        FILE_SKIP_SET_EVENT_ON_HANDLE);
 }
 
+enum ConnectResult {
+  kConnectPending,
+  kConnectDone,
+  kConnectError,
+};
+
+// Starts accepting a client on |pipe_handle|.  |overlapped| must be kept
+// until the operation completes when kConnectPending is returned.
+ConnectResult StartConnectNamedPipe(HANDLE pipe_handle, HANDLE wait_handle,
+                                    OVERLAPPED *overlapped) {
+  while (true) {
+    if (!InitOverlapped(overlapped, wait_handle)) {
+      return kConnectError;
+    }
+    const BOOL result = ::ConnectNamedPipe(pipe_handle, overlapped);
+    const DWORD connect_named_pipe_error = ::GetLastError();
+    if (result != FALSE) {
+      return kConnectDone;
+    }
+    if (connect_named_pipe_error == ERROR_PIPE_CONNECTED) {
+      // Already connected. Nothing to do.
+      return kConnectDone;
+    }
+    if (connect_named_pipe_error == ERROR_IO_PENDING) {
+      // Actually this is async operation.
+      return kConnectPending;
+    }
+    if (connect_named_pipe_error != ERROR_NO_DATA) {
+      LOG(FATAL) << "Unexpected error: " << connect_named_pipe_error;
+      return kConnectError;
+    }
+    // client already closes the connection
+    ::DisconnectNamedPipe(pipe_handle);
+  }
+}
+
 }  // namespace
 
 IPCServer::IPCServer(const string &name,
@@ -483,33 +522,51 @@ IPCServer::IPCServer(const string &name,
     return;
   }
 
-  // Create a named pipe.
+  // Create the instances of the named pipe.  All of them are created here so
+  // that no instance is left for other processes.
   std::wstring wserver_address;
   Util::UTF8ToWide(server_address, &wserver_address);
-  HANDLE handle = ::CreateNamedPipe(wserver_address.c_str(),
-                                    PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED |
-                                    FILE_FLAG_FIRST_PIPE_INSTANCE,
-                                    PIPE_TYPE_MESSAGE |
-                                    PIPE_READMODE_MESSAGE |
-                                    PIPE_WAIT,
-                                    (num_connections <= 0
-                                     ? PIPE_UNLIMITED_INSTANCES
-                                     : num_connections),
-                                    sizeof(request_),
-                                    sizeof(response_),
-                                    0,
-                                    &security_attributes);
-  const DWORD create_named_pipe_error = ::GetLastError();
+  const size_t num_instances =
+      (num_connections <= 0)
+      ? kMaxPipeInstances
+      : std::min(static_cast<size_t>(num_connections), kMaxPipeInstances);
+  DWORD create_named_pipe_error = 0;
+  for (size_t i = 0; i < num_instances; ++i) {
+    const DWORD open_mode =
+        PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED |
+        (pipe_handles_.empty() ? FILE_FLAG_FIRST_PIPE_INSTANCE : 0);
+    HANDLE handle = ::CreateNamedPipe(wserver_address.c_str(),
+                                      open_mode,
+                                      PIPE_TYPE_MESSAGE |
+                                      PIPE_READMODE_MESSAGE |
+                                      PIPE_WAIT,
+                                      (num_connections <= 0
+                                       ? PIPE_UNLIMITED_INSTANCES
+                                       : num_connections),
+                                      sizeof(request_),
+                                      sizeof(response_),
+                                      0,
+                                      &security_attributes);
+    create_named_pipe_error = ::GetLastError();
+    if (INVALID_HANDLE_VALUE == handle) {
+      break;
+    }
+    pipe_handles_.push_back(
+        std::unique_ptr<ScopedHandle>(new ScopedHandle(handle)));
+    connect_events_.push_back(std::unique_ptr<ScopedHandle>(
+        new ScopedHandle(CreateManualResetEvent())));
+    MaybeDisableFileCompletionNotification(handle);
+  }
   ::LocalFree(security_attributes.lpSecurityDescriptor);
 
-  if (INVALID_HANDLE_VALUE == handle) {
+  if (pipe_handles_.empty()) {
     LOG(FATAL) << "CreateNamedPipe failed" << create_named_pipe_error;
     return;
   }
-
-  pipe_handle_.reset(handle);
-
-  MaybeDisableFileCompletionNotification(pipe_handle_.get());
+  if (pipe_handles_.size() < num_instances) {
+    LOG(WARNING) << "Only " << pipe_handles_.size() << " of " << num_instances
+                 << " pipe instances are created: " << create_named_pipe_error;
+  }
 
   if (!manager->SavePathName()) {
     LOG(ERROR) << "Cannot save IPC path name";
@@ -553,54 +610,81 @@ void IPCServer::Terminate() {
 void IPCServer::Loop() {
   IPCErrorType last_ipc_error = IPC_NO_ERROR;
 
+  const size_t num_instances = pipe_handles_.size();
+  std::vector<OVERLAPPED> overlapped(num_instances);
+  // True while ConnectNamedPipe() is in progress on the instance.
+  std::vector<bool> pending(num_instances, false);
+  std::vector<HANDLE> wait_handles(num_instances + 1);
+  wait_handles[0] = quit_event_.get();
+  for (size_t i = 0; i < num_instances; ++i) {
+    wait_handles[i + 1] = connect_events_[i]->get();
+  }
+
   int successive_connection_failure_count = 0;
   while (connected_) {
-    OVERLAPPED overlapped;
-    if (!InitOverlapped(&overlapped, pipe_event_.get())) {
-      connected_ = false;
-      return;
+    // Lets all the idle instances accept a client, and picks up one which is
+    // already connected if any.
+    size_t ready = num_instances;
+    for (size_t i = 0; i < num_instances && ready == num_instances; ++i) {
+      if (pending[i]) {
+        continue;
+      }
+      switch (StartConnectNamedPipe(pipe_handles_[i]->get(),
+                                    connect_events_[i]->get(),
+                                    &overlapped[i])) {
+        case kConnectPending:
+          pending[i] = true;
+          break;
+        case kConnectDone:
+          ready = i;
+          break;
+        default:
+          connected_ = false;
+          break;
+      }
+    }
+    if (!connected_) {
+      break;
     }
 
-    const BOOL result = ::ConnectNamedPipe(pipe_handle_.get(), &overlapped);
-    const DWORD connect_named_pipe_error = ::GetLastError();
-    if (result == FALSE) {
-      if (connect_named_pipe_error == ERROR_PIPE_CONNECTED) {
-        // Already connected. Nothing to do.
-      } else if (connect_named_pipe_error == ERROR_NO_DATA) {
-        // client already closes the connection
-        ::DisconnectNamedPipe(pipe_handle_.get());
-        continue;
-      } else if (connect_named_pipe_error == ERROR_IO_PENDING) {
-        // Actually this is async operation.
-        DWORD ignored = 0;
-        IPCErrorType ipc_error = IPC_NO_ERROR;
-        if (!SafeWaitOverlappedResult(pipe_handle_.get(), quit_event_.get(),
-                                      INFINITE, &overlapped, &ignored,
-                                      &ipc_error, kReadTypeData)) {
-          if (ipc_error == IPC_QUIT_EVENT_SIGNALED) {
-            VLOG(1) << "Recived Conrol event from other thread";
-            connected_ = false;
-            return;
-          }
-          ++successive_connection_failure_count;
-          if (successive_connection_failure_count >=
-              kMaxSuccessiveConnectionFailureCount) {
-            LOG(ERROR) << "Give up to connect named pipe.";
-            connected_ = false;
-            return;
-          }
-          ::DisconnectNamedPipe(pipe_handle_.get());
-          continue;
+    if (ready == num_instances) {
+      const DWORD wait_result = ::WaitForMultipleObjects(
+          static_cast<DWORD>(wait_handles.size()), &wait_handles[0],
+          FALSE, INFINITE);
+      if (wait_result == WAIT_OBJECT_0) {
+        VLOG(1) << "Recived Conrol event from other thread";
+        connected_ = false;
+        break;
+      }
+      if (wait_result >= WAIT_OBJECT_0 + wait_handles.size()) {
+        LOG(ERROR) << "Unknown result: " << wait_result
+                   << ", Error: " << ::GetLastError();
+        connected_ = false;
+        break;
+      }
+      ready = wait_result - WAIT_OBJECT_0 - 1;
+      pending[ready] = false;
+      DWORD ignored = 0;
+      if (!::GetOverlappedResult(pipe_handles_[ready]->get(),
+                                 &overlapped[ready], &ignored, FALSE)) {
+        LOG(ERROR) << "GetOverlappedResult() failed: " << ::GetLastError();
+        ++successive_connection_failure_count;
+        if (successive_connection_failure_count >=
+            kMaxSuccessiveConnectionFailureCount) {
+          LOG(ERROR) << "Give up to connect named pipe.";
+          connected_ = false;
+          break;
         }
-      } else {
-        LOG(FATAL) << "Unexpected error: " << connect_named_pipe_error;
+        ::DisconnectNamedPipe(pipe_handles_[ready]->get());
+        continue;
       }
     }
 
     successive_connection_failure_count = 0;
+    const HANDLE pipe_handle = pipe_handles_[ready]->get();
     // Retrieve an incoming message.
     size_t request_size = sizeof(request_);
-    if (RecvIPCMessage(pipe_handle_.get(), pipe_event_.get(),
+    if (RecvIPCMessage(pipe_handle, pipe_event_.get(),
                        &request_[0], &request_size, timeout_,
                        kReadTypeData, &last_ipc_error)) {
       size_t response_size = sizeof(response_);
@@ -613,12 +697,12 @@ void IPCServer::Loop() {
       // instead of checking ACK message
       if (response_size == 0) {
         LOG(WARNING) << "Process() return 0 result";
-        ::DisconnectNamedPipe(pipe_handle_.get());
+        ::DisconnectNamedPipe(pipe_handle);
         continue;
       }
 
       // Send a response
-      SendIPCMessage(pipe_handle_.get(), pipe_event_.get(),
+      SendIPCMessage(pipe_handle, pipe_event_.get(),
                      &response_[0], response_size, timeout_, &last_ipc_error);
     }
 
@@ -636,7 +720,7 @@ void IPCServer::Loop() {
     char ack_request[1] = {0};
     size_t ack_request_size = 1;
     static const int kAckTimeout = 100;
-    if (!RecvIPCMessage(pipe_handle_.get(), pipe_event_.get(),
+    if (!RecvIPCMessage(pipe_handle, pipe_event_.get(),
                         ack_request, &ack_request_size, kAckTimeout,
                         kReadTypeACK, &last_ipc_error)) {
       // This case happens when the client did not recive the server's response
@@ -645,9 +729,14 @@ void IPCServer::Loop() {
       LOG(WARNING) << "Client didn't respond within "
                    << kAckTimeout << " msec.";
     }
-    ::DisconnectNamedPipe(pipe_handle_.get());
+    ::DisconnectNamedPipe(pipe_handle);
   }
 
+  for (size_t i = 0; i < num_instances; ++i) {
+    if (pending[i] && !HasOverlappedIoCompleted(&overlapped[i])) {
+      SafeCancelIO(pipe_handles_[i]->get(), &overlapped[i]);
+    }
+  }
   connected_ = false;
 }
 
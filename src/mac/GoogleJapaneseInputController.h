@@ -31,8 +31,10 @@
 #import "mac/common.h"
 
 #include <string>
+#include <vector>
 
 #include "base/port_string.h"
+#include "composer/key_event_util.h"
 
 // For mozc::commands::CompositionMode
 #include "protocol/renderer_command.pb.h"
@@ -93,6 +95,16 @@ class RendererInterface;
   // key events.
   KeyCodeMap *keyCodeMap_;
 
+  // |precompositionKeys_| is a snapshot of the keys assigned in
+  // precomposition mode, taken from the config of the server.
+  std::vector<mozc::KeyInformation> *precompositionKeys_;
+
+  // |serverIsIdle_| is YES while the server has neither composition nor
+  // suggestion and the last key was echoed back.  Then the server does
+  // nothing for keys with modifiers outside |precompositionKeys_|, so
+  // they are returned to the application without the server call.
+  BOOL serverIsIdle_;
+
   // |clientBundle_| is the Bundle ID of the client application which
   // the controller communicates with.
   string *clientBundle_;
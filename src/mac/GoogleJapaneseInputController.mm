@@ -56,6 +56,7 @@
 #include "protocol/config.pb.h"
 #include "renderer/renderer_client.h"
 #include "session/ime_switch_util.h"
+#include "session/key_info_util.h"
 
 using mozc::commands::Candidates;
 using mozc::commands::Capability;
@@ -71,6 +72,9 @@ using mozc::config::ImeSwitchUtil;
 using mozc::kProductNameInEnglish;
 using mozc::once_t;
 using mozc::CallOnce;
+using mozc::KeyEventUtil;
+using mozc::KeyInfoUtil;
+using mozc::KeyInformation;
 using mozc::MacProcess;
 
 namespace {
@@ -92,6 +96,25 @@ const int kMaxSurroundingLength = 20;
 // surrounding text takes too much time. So we set this limitation.
 const int kGetSurroundingTextClientLengthLimit = 1000;
 
+// Returns true if the server just echoes back |key| when it has neither
+// composition nor suggestion.  Keys without Ctrl or Alt may insert
+// characters, and modifier-only keys can toggle the input mode, so both
+// are always sent to the server.
+bool IsEchoedBackWhenIdle(const KeyEvent &key,
+                          const std::vector<KeyInformation> &precompositionKeys) {
+  const uint32 modifiers = KeyEventUtil::GetModifiers(key);
+  if (!KeyEventUtil::HasCtrl(modifiers) && !KeyEventUtil::HasAlt(modifiers)) {
+    return false;
+  }
+  if (!key.has_key_code() && !key.has_special_key()) {
+    return false;
+  }
+  // The server looks up its keymap with the normalized key.
+  KeyEvent normalized;
+  KeyEventUtil::NormalizeModifiers(key, &normalized);
+  return !KeyInfoUtil::ContainsKey(precompositionKeys, normalized);
+}
+
 NSString *GetLabelForSuffix(const string &suffix) {
   string label = mozc::MacUtil::GetLabelForSuffix(suffix);
   return [[NSString stringWithUTF8String:label.c_str()] retain];
@@ -188,6 +211,8 @@ bool IsBannedApplication(const std::set<string>* bundleIdSet,
     return self;
   }
   keyCodeMap_ = [[KeyCodeMap alloc] init];
+  precompositionKeys_ = new(std::nothrow) std::vector<KeyInformation>;
+  serverIsIdle_ = NO;
   clientBundle_ = new(std::nothrow) string;
   replacementRange_ = NSMakeRange(NSNotFound, 0);
   originalString_ = [[NSMutableString alloc] init];
@@ -208,7 +233,8 @@ bool IsBannedApplication(const std::set<string>* bundleIdSet,
   // We don't check the return value of NSBundle because it fails during tests.
   [NSBundle loadNibNamed:@"Config" owner:self];
   if (!originalString_ || !composedString_ || !candidateController_ ||
-      !rendererCommand_ || !mozcClient_ || !clientBundle_) {
+      !rendererCommand_ || !mozcClient_ || !clientBundle_ ||
+      !precompositionKeys_) {
     [self release];
     self = nil;
   } else {
@@ -239,6 +265,7 @@ bool IsBannedApplication(const std::set<string>* bundleIdSet,
   [composedString_ release];
   [imkClientForTest_ release];
   delete clientBundle_;
+  delete precompositionKeys_;
   delete candidateController_;
   delete mozcClient_;
   delete rendererCommand_;
@@ -380,6 +407,9 @@ bool IsBannedApplication(const std::set<string>* bundleIdSet,
 #pragma mark internal methods
 
 - (void)handleConfig {
+  // The keymap may change with the config.
+  serverIsIdle_ = NO;
+
   // Get the config and set client-side behaviors
   Config config;
   if (!mozcClient_->GetConfig(&config)) {
@@ -393,6 +423,7 @@ bool IsBannedApplication(const std::set<string>* bundleIdSet,
   }
   [keyCodeMap_ setInputMode:input_mode];
   yenSignCharacter_ = config.yen_sign_character();
+  *precompositionKeys_ = KeyInfoUtil::ExtractSortedPrecompositionKeys(config);
 
   if (config.use_japanese_layout()) {
     // Apple does not have "Japanese" layout actually -- here sets
@@ -465,6 +496,7 @@ bool IsBannedApplication(const std::set<string>* bundleIdSet,
   if (mode_ == new_mode) {
     return;
   }
+  serverIsIdle_ = NO;
   if (mode_ != mozc::commands::DIRECT && new_mode == mozc::commands::DIRECT) {
     [self switchModeToDirect:sender];
   } else if (new_mode != mozc::commands::DIRECT) {
@@ -581,6 +613,7 @@ bool IsBannedApplication(const std::set<string>* bundleIdSet,
 }
 
 - (void)processOutput:(const mozc::commands::Output *)output client:(id)sender {
+  serverIsIdle_ = NO;
   if (output == nullptr) {
     return;
   }
@@ -743,6 +776,7 @@ bool IsBannedApplication(const std::set<string>* bundleIdSet,
     return;
   }
   [self commitText:[[composedString_ string] UTF8String] client:sender];
+  serverIsIdle_ = NO;
 
   SessionCommand command;
   Output output;
@@ -963,6 +997,10 @@ bool IsBannedApplication(const std::set<string>* bundleIdSet,
     return NO;
   }
 
+  if (serverIsIdle_ && IsEchoedBackWhenIdle(keyEvent, *precompositionKeys_)) {
+    return NO;
+  }
+
   // Send the key event to the server actually
   Output output;
 
@@ -983,10 +1021,14 @@ bool IsBannedApplication(const std::set<string>* bundleIdSet,
     [self fillSurroundingContext:&context client:sender];
   }
   if (!mozcClient_->SendKeyWithContext(keyEvent, context, &output)) {
+    serverIsIdle_ = NO;
     return NO;
   }
 
   [self processOutput:&output client:sender];
+  serverIsIdle_ =
+      !output.consumed() && [composedString_ length] == 0 &&
+      rendererCommand_->output().candidates().candidate_size() == 0;
   return output.consumed();
 }
 
@@ -419,6 +419,25 @@ BOOL SendKeyEvent(unsigned short keyCode,
   return [controller handleEvent:kanaKeyEvent client:client];
 }
 
+BOOL SendCtrlKeyEvent(unsigned short keyCode, NSString *character,
+                      GoogleJapaneseInputController *controller,
+                      MockClient *client) {
+  unichar controlCode = [character characterAtIndex:0] - 'a' + 1;
+  NSEvent *ctrlKeyEvent =
+      [NSEvent keyEventWithType:NSKeyDown
+                       location:NSZeroPoint
+                  modifierFlags:NSControlKeyMask
+                      timestamp:0
+                   windowNumber:0
+                        context:nil
+                     characters:[NSString stringWithCharacters:&controlCode
+                                                        length:1]
+    charactersIgnoringModifiers:character
+                      isARepeat:NO
+                        keyCode:keyCode];
+  return [controller handleEvent:ctrlKeyEvent client:client];
+}
+
 TEST_F(GoogleJapaneseInputControllerTest, UpdateComposedString) {
   // If preedit is nullptr, it still calls setMarkedText, with an empty string.
   NSMutableAttributedString *expected =
@@ -676,6 +695,43 @@ TEST_F(GoogleJapaneseInputControllerTest, handleConfig) {
       << [mock_client_.overriddenLayout UTF8String];
 }
 
+TEST_F(GoogleJapaneseInputControllerTest, SkipKeysEchoedBackWhenIdle) {
+  mozc::config::Config config;
+  config.set_session_keymap(mozc::config::Config::CUSTOM);
+  config.set_custom_keymap_table(
+      "status\tkey\tcommand\n"
+      "Precomposition\tCtrl b\tUndo\n");
+  mock_mozc_client_->SetConfig(config);
+  mock_mozc_client_->SetBoolFunctionReturn("GetConfig", true);
+  [controller_ handleConfig];
+
+  controller_.mode = mozc::commands::HIRAGANA;
+  mock_mozc_client_->SetBoolFunctionReturn("SendKeyWithContext", true);
+  mozc::commands::Output output;
+  output.set_consumed(false);
+  mock_mozc_client_->set_output_SendKeyWithContext(output);
+
+  // The first key goes to the server, which echoes it back.
+  EXPECT_EQ(NO, SendCtrlKeyEvent(kVK_ANSI_A, @"a", controller_, mock_client_));
+  EXPECT_EQ(1, mock_mozc_client_->GetFunctionCallCount("SendKeyWithContext"));
+
+  // Now the server is idle.  Unassigned keys are not sent.
+  EXPECT_EQ(NO, SendCtrlKeyEvent(kVK_ANSI_A, @"a", controller_, mock_client_));
+  EXPECT_EQ(1, mock_mozc_client_->GetFunctionCallCount("SendKeyWithContext"));
+
+  // Keys in the keymap are still sent.
+  EXPECT_EQ(NO, SendCtrlKeyEvent(kVK_ANSI_B, @"b", controller_, mock_client_));
+  EXPECT_EQ(2, mock_mozc_client_->GetFunctionCallCount("SendKeyWithContext"));
+
+  // A consumed key makes the following keys go to the server again.
+  output.set_consumed(true);
+  mock_mozc_client_->set_output_SendKeyWithContext(output);
+  EXPECT_EQ(YES, SendCtrlKeyEvent(kVK_ANSI_B, @"b", controller_, mock_client_));
+  EXPECT_EQ(3, mock_mozc_client_->GetFunctionCallCount("SendKeyWithContext"));
+  EXPECT_EQ(YES, SendCtrlKeyEvent(kVK_ANSI_A, @"a", controller_, mock_client_));
+  EXPECT_EQ(4, mock_mozc_client_->GetFunctionCallCount("SendKeyWithContext"));
+}
+
 TEST_F(GoogleJapaneseInputControllerTest, DoubleTapKanaReconvert) {
   // tap (short) tap -> emit undo command
   controller_.mode = mozc::commands::HIRAGANA;
@@ -48,6 +48,7 @@
         '../protocol/protocol.gyp:renderer_proto',
         '../renderer/renderer.gyp:renderer_client',
         '../session/session_base.gyp:ime_switch_util',
+        '../session/session_base.gyp:key_info_util',
         '../testing/testing.gyp:gtest_main',
         'gen_key_mappings',
       ],
@@ -283,6 +284,7 @@
             '../renderer/renderer.gyp:renderer_client',
             '../server/server.gyp:mozc_server',
             '../session/session_base.gyp:ime_switch_util',
+            '../session/session_base.gyp:key_info_util',
             'gen_client_info_plist',
             'gen_key_mappings',
           ],
@@ -33,6 +33,7 @@
 #include <cctype>
 #include <climits>   // INT_MAX
 #include <cmath>
+#include <iterator>
 #include <list>
 #include <map>
 #include <set>
@@ -40,9 +41,13 @@
 #include <utility>
 #include <vector>
 
+#include "base/allocation_stats.h"
 #include "base/flags.h"
 #include "base/logging.h"
 #include "base/number_util.h"
+#include "base/stopwatch.h"
+#include "base/thread_pool.h"
+#include "base/trace_events.h"
 #include "base/util.h"
 #include "composer/composer.h"
 #include "converter/connector.h"
@@ -66,6 +71,14 @@
 DEFINE_bool(enable_expansion_for_dictionary_predictor,
             false,
             "enable ambiguity expansion for dictionary_predictor");
+DEFINE_int32(prediction_latency_budget_usec, 0,
+             "Per-keystroke latency budget of the dictionary predictor in "
+             "microseconds.  When positive, the realtime conversion size and "
+             "the lookup limits are scaled to meet it.  0 disables it.");
+DEFINE_int32(dictionary_predictor_aggregation_threads, 0,
+             "The number of threads running the aggregation stages of the "
+             "dictionary predictor in parallel with the realtime conversion.  "
+             "0 means the stages run sequentially on the calling thread.");
 
 DECLARE_bool(enable_typing_correction);
 
@@ -76,6 +89,7 @@ using commands::Request;
 using dictionary::DictionaryInterface;
 using dictionary::POSMatcher;
 using dictionary::Token;
+using dictionary::TokenView;
 using usage_stats::UsageStats;
 
 // Used to emulate positive infinity for cost. This value is set for those
@@ -91,6 +105,30 @@ const int kInfinity = (2 << 20);
 const size_t kSuggestionMaxResultsSize = 256;
 const size_t kPredictionMaxResultsSize = 100000;
 
+// The number of the recent history keys whose zero query candidates are
+// cached.
+const size_t kZeroQueryCacheSize = 16;
+
+// Typing correction is skipped when the other stages have found more results.
+const size_t kMaxResultsSizeForTypingCorrection = 10000;
+
+// The result buffers kept for the following requests.  A buffer grown beyond
+// the capacity by a large PREDICTION request is released instead.
+const size_t kMaxPooledResults = 4;
+const size_t kMaxPooledResultsCapacity = 4 * kSuggestionMaxResultsSize;
+
+// Returns the pool running the aggregation stages in parallel, or nullptr if
+// they run sequentially.
+ThreadPool *GetAggregationThreadPool() {
+  if (FLAGS_dictionary_predictor_aggregation_threads <= 0) {
+    return nullptr;
+  }
+  // Intentionally leaked so that the workers outlive all the predictors.
+  static ThreadPool *pool =
+      new ThreadPool(FLAGS_dictionary_predictor_aggregation_threads);
+  return pool;
+}
+
 // Returns true if the |target| may be reduncant result.
 bool MaybeRedundant(const string &reference, const string &target) {
   return Util::StartsWith(target, reference);
@@ -190,9 +228,14 @@ class DictionaryPredictor::PredictiveLookupCallback
     return TRAVERSE_CONTINUE;
   }
 
-  ResultType OnToken(StringPiece,  // key
-                     StringPiece,  // actual_key
+  ResultType OnToken(StringPiece key, StringPiece actual_key,
                      const Token &token) override {
+    return OnTokenView(key, actual_key, token);
+  }
+
+  ResultType OnTokenView(StringPiece,  // key
+                         StringPiece,  // actual_key
+                         const TokenView &token) override {
     results_->push_back(Result());
     results_->back().InitializeByTokenAndTypes(token, types_);
     results_->back().wcost += penalty_;
@@ -227,8 +270,8 @@ class DictionaryPredictor::PredictiveBigramLookupCallback :
                                  subsequent_chars, is_zero_query, results),
         history_value_(history_value) {}
 
-  virtual ResultType OnToken(StringPiece key, StringPiece expanded_key,
-                             const Token &token) {
+  virtual ResultType OnTokenView(StringPiece key, StringPiece expanded_key,
+                                 const TokenView &token) {
     // Skip the token if its value doesn't start with the previous user input,
     // |history_value_|.
     if (!Util::StartsWith(token.value, history_value_) ||
@@ -236,7 +279,7 @@ class DictionaryPredictor::PredictiveBigramLookupCallback :
       return TRAVERSE_CONTINUE;
     }
     ResultType result_type =
-        PredictiveLookupCallback::OnToken(key, expanded_key, token);
+        PredictiveLookupCallback::OnTokenView(key, expanded_key, token);
     if (is_zero_query_) {
       results_->back().SetSourceInfoForZeroQuery(
           ZERO_QUERY_BIGRAM);
@@ -288,7 +331,13 @@ DictionaryPredictor::DictionaryPredictor(
       suggestion_filter_(suggestion_filter),
       counter_suffix_word_id_(pos_matcher->GetCounterSuffixWordId()),
       general_symbol_id_(pos_matcher->GetGeneralSymbolId()),
-      predictor_name_("DictionaryPredictor") {
+      predictor_name_("DictionaryPredictor"),
+      zero_query_cache_(kZeroQueryCacheSize),
+      zero_query_suffix_limit_(0) {
+  if (FLAGS_prediction_latency_budget_usec > 0) {
+    latency_budget_.reset(new LatencyBudget(
+        static_cast<uint64>(FLAGS_prediction_latency_budget_usec)));
+  }
   StringPiece zero_query_token_array_data;
   StringPiece zero_query_string_array_data;
   StringPiece zero_query_number_token_array_data;
@@ -368,19 +417,52 @@ void DictionaryPredictor::MaybeRecordUsageStats(
 
 bool DictionaryPredictor::PredictForRequest(const ConversionRequest &request,
                                             Segments *segments) const {
+  ScopedAllocationStage allocation_stage(AllocationStats::PREDICTOR);
   if (segments == NULL) {
     return false;
   }
 
+  Stopwatch stopwatch = Stopwatch::StartNew();
   std::vector<Result> results;
-  if (!AggregatePrediction(request, segments, &results)) {
-    return false;
+  AcquireResultsBuffer(&results);
+  bool result = AggregatePrediction(request, segments, &results);
+  if (result) {
+    SetCost(request, *segments, &results);
+    RemovePrediction(request, *segments, &results);
+    result = AddPredictionToCandidates(request, segments, &results);
+  }
+  ReleaseResultsBuffer(&results);
+  if (latency_budget_) {
+    latency_budget_->Record(
+        static_cast<uint64>(stopwatch.GetElapsedMicroseconds()));
   }
+  return result;
+}
 
-  SetCost(request, *segments, &results);
-  RemovePrediction(request, *segments, &results);
+void DictionaryPredictor::AcquireResultsBuffer(
+    std::vector<Result> *results) const {
+  DCHECK(results);
+  scoped_lock l(&results_pool_mutex_);
+  if (results_pool_.empty()) {
+    return;
+  }
+  results->swap(results_pool_.back());
+  results_pool_.pop_back();
+}
 
-  return AddPredictionToCandidates(request, segments, &results);
+void DictionaryPredictor::ReleaseResultsBuffer(
+    std::vector<Result> *results) const {
+  DCHECK(results);
+  // Don't keep the buffer grown by an unusually large request.
+  if (results->capacity() > kMaxPooledResultsCapacity) {
+    return;
+  }
+  results->clear();
+  scoped_lock l(&results_pool_mutex_);
+  if (results_pool_.size() < kMaxPooledResults) {
+    results_pool_.push_back(std::vector<Result>());
+    results_pool_.back().swap(*results);
+  }
 }
 
 bool DictionaryPredictor::AggregatePrediction(
@@ -404,13 +486,64 @@ bool DictionaryPredictor::AggregatePrediction(
     // Therefore, we use only the realtime conversion result.
     AggregateRealtimeConversion(prediction_types, request, segments, results);
   } else {
-    AggregateRealtimeConversion(prediction_types, request, segments, results);
-    AggregateUnigramPrediction(prediction_types, request, *segments, results);
-    AggregateBigramPrediction(prediction_types, request, *segments, results);
-    AggregateSuffixPrediction(prediction_types, request, *segments, results);
-    AggregateEnglishPrediction(prediction_types, request, *segments, results);
-    AggregateTypeCorrectingPrediction(prediction_types, request, *segments,
-                                      results);
+    // Once the request is canceled, the remaining aggregators are skipped and
+    // the results found so far are returned.
+    typedef void (DictionaryPredictor::*Aggregator)(
+        PredictionTypes, const ConversionRequest &, const Segments &,
+        std::vector<Result> *) const;
+    static const Aggregator kAggregators[] = {
+      &DictionaryPredictor::AggregateUnigramPrediction,
+      &DictionaryPredictor::AggregateBigramPrediction,
+      &DictionaryPredictor::AggregateSuffixPrediction,
+      &DictionaryPredictor::AggregateEnglishPrediction,
+      &DictionaryPredictor::AggregateTypeCorrectingPrediction,
+    };
+    ThreadPool *pool = GetAggregationThreadPool();
+    if (pool == nullptr) {
+      AggregateRealtimeConversion(prediction_types, request, segments,
+                                  results);
+      for (size_t i = 0; i < arraysize(kAggregators); ++i) {
+        if (request.IsCanceled()) {
+          VLOG(1) << "Prediction is canceled";
+          break;
+        }
+        (this->*kAggregators[i])(prediction_types, request, *segments,
+                                 results);
+      }
+    } else {
+      // The realtime conversion modifies |segments| while it runs, so the
+      // other stages read a copy.  They only read the dictionaries and
+      // write to their own buffers, which are appended in the same order as
+      // the sequential run.  They don't look at the candidates of the
+      // conversion segment, so those are not copied.
+      Segments snapshot;
+      snapshot.CopyFromWithoutConversionCandidates(*segments);
+      std::vector<std::vector<Result>> stage_results(arraysize(kAggregators));
+      BlockingCounter counter(arraysize(kAggregators));
+      for (size_t i = 0; i < arraysize(kAggregators); ++i) {
+        pool->Schedule([this, i, prediction_types, &request, &snapshot,
+                        &stage_results, &counter]() {
+          if (!request.IsCanceled()) {
+            (this->*kAggregators[i])(prediction_types, request, snapshot,
+                                     &stage_results[i]);
+          }
+          counter.DecrementCount();
+        });
+      }
+      AggregateRealtimeConversion(prediction_types, request, segments,
+                                  results);
+      counter.Wait();
+      for (size_t i = 0; i < stage_results.size(); ++i) {
+        if (kAggregators[i] ==
+                &DictionaryPredictor::AggregateTypeCorrectingPrediction &&
+            results->size() > kMaxResultsSizeForTypingCorrection) {
+          continue;
+        }
+        results->insert(results->end(),
+                        std::make_move_iterator(stage_results[i].begin()),
+                        std::make_move_iterator(stage_results[i].end()));
+      }
+    }
   }
 
   if (results->empty()) {
@@ -468,34 +601,36 @@ bool DictionaryPredictor::AddPredictionToCandidates(
   Segment *segment = segments->mutable_conversion_segment(0);
   DCHECK(segment);
 
+  // Results which can never be added are moved out of the heap range first,
+  // so that the heap is built only over the live results.
+  const std::vector<Result>::iterator heap_end = std::partition(
+      results->begin(), results->end(), [](const Result &result) {
+        return result.types != NO_PREDICTION && result.cost < kInfinity;
+      });
+  const size_t heap_size = heap_end - results->begin();
+
   // Instead of sorting all the results, we construct a heap.
   // This is done in linear time and
   // we can pop as many results as we need efficiently.
-  std::make_heap(results->begin(), results->end(), ResultCostLess());
+  std::make_heap(results->begin(), heap_end, ResultCostLess());
 
   const size_t size =
-      std::min(segments->max_prediction_candidates_size(), results->size());
+      std::min(segments->max_prediction_candidates_size(), heap_size);
 
   int added = 0;
-  std::set<string> seen;
+  // Popped results are never moved again, so |seen| can refer to their
+  // values without copying them.
+  std::set<StringPiece> seen;
 
   int added_suffix = 0;
   bool cursor_at_tail =
       request.has_composer() &&
       request.composer().GetCursor() == request.composer().GetLength();
 
-  for (size_t i = 0; i < results->size(); ++i) {
+  for (size_t i = 0; i < heap_size && added < size; ++i) {
     // Pop a result from a heap. Please pay attention not to use results->at(i).
-    std::pop_heap(results->begin(), results->end() - i, ResultCostLess());
-    const Result &result = results->at(results->size() - i - 1);
-
-    if (added >= size || result.cost >= kInfinity) {
-      break;
-    }
-
-    if (result.types == NO_PREDICTION) {
-      continue;
-    }
+    std::pop_heap(results->begin(), heap_end - i, ResultCostLess());
+    const Result &result = results->at(heap_size - i - 1);
 
     // If mixed_conversion is true, we don't filter the results which have
     // the exact same key as the input.
@@ -515,16 +650,11 @@ bool DictionaryPredictor::AddPredictionToCandidates(
       continue;
     }
 
-    string key, value;
+    StringPiece key(result.key), value(result.value);
     if (result.types & BIGRAM) {
       // remove the prefix of history key and history value.
-      key = result.key.substr(history_key.size(),
-                              result.key.size() - history_key.size());
-      value = result.value.substr(history_value.size(),
-                                  result.value.size() - history_value.size());
-    } else {
-      key = result.key;
-      value = result.value;
+      key = ClippedSubstr(key, history_key.size());
+      value = ClippedSubstr(value, history_value.size());
     }
 
     if (!seen.insert(value).second) {
@@ -550,10 +680,10 @@ bool DictionaryPredictor::AddPredictionToCandidates(
     DCHECK(candidate);
 
     candidate->Init();
-    candidate->content_key = key;
-    candidate->content_value = value;
-    candidate->key = key;
-    candidate->value = value;
+    key.CopyToString(&candidate->key);
+    value.CopyToString(&candidate->value);
+    candidate->content_key = candidate->key;
+    candidate->content_value = candidate->value;
     candidate->lid = result.lid;
     candidate->rid = result.rid;
     candidate->wcost = result.wcost;
@@ -664,14 +794,19 @@ class FindValueCallback : public DictionaryInterface::Callback {
   explicit FindValueCallback(StringPiece target_value)
       : target_value_(target_value), found_(false) {}
 
-  virtual ResultType OnToken(StringPiece,  // key
-                             StringPiece,  // actual_key
+  virtual ResultType OnToken(StringPiece key, StringPiece actual_key,
                              const Token &token) {
+    return OnTokenView(key, actual_key, token);
+  }
+
+  virtual ResultType OnTokenView(StringPiece,  // key
+                                 StringPiece,  // actual_key
+                                 const TokenView &token) {
     if (token.value != target_value_) {
       return TRAVERSE_CONTINUE;
     }
     found_ = true;
-    token_ = token;
+    token.CopyTo(&token_);
     return TRAVERSE_DONE;
   }
 
@@ -694,10 +829,10 @@ class FindValueCallback : public DictionaryInterface::Callback {
 }  // namespace
 
 void DictionaryPredictor::Result::InitializeByTokenAndTypes(
-    const Token &token, PredictionTypes types) {
+    const TokenView &token, PredictionTypes types) {
   SetTypesAndTokenAttributes(types, token.attributes);
-  key = token.key;
-  value = token.value;
+  token.key.CopyToString(&key);
+  token.value.CopyToString(&value);
   wcost = token.cost;
   lid = token.lid;
   rid = token.rid;
@@ -1002,7 +1137,7 @@ void DictionaryPredictor::ApplyPenaltyForKeyExpansion(
 }
 
 size_t DictionaryPredictor::GetMissSpelledPosition(
-    const string &key, const string &value) const {
+    StringPiece key, StringPiece value) const {
   string hiragana_value;
   Util::KatakanaToHiragana(value, &hiragana_value);
   // value is mixed type. return true if key == request_key.
@@ -1149,6 +1284,9 @@ size_t DictionaryPredictor::GetRealtimeCandidateMaxSize(
     default:
       size = 0;  // Never reach here
   }
+  if (latency_budget_ && size > 0) {
+    size = latency_budget_->Scale(size, 1);
+  }
 
   return std::min(max_size, size);
 }
@@ -1156,11 +1294,14 @@ size_t DictionaryPredictor::GetRealtimeCandidateMaxSize(
 bool DictionaryPredictor::PushBackTopConversionResult(
     const ConversionRequest &request,
     const Segments &segments,
+    Lattice *lattice,
     std::vector<Result> *results) const {
   DCHECK_EQ(1, segments.conversion_segments_size());
 
+  // The conversion below replaces the conversion segment, so its
+  // candidates are not copied.
   Segments tmp_segments;
-  tmp_segments.CopyFrom(segments);
+  tmp_segments.CopyFromWithoutConversionCandidates(segments);
   tmp_segments.set_max_conversion_candidates_size(20);
   ConversionRequest tmp_request;
   tmp_request.CopyFrom(request);
@@ -1170,6 +1311,9 @@ bool DictionaryPredictor::PushBackTopConversionResult(
   // This method emulates usual converter's behavior so here disable
   // partial candidates.
   tmp_request.set_create_partial_candidates(false);
+  // |tmp_segments| has its own lattice, so share the one of |segments| to
+  // avoid looking up the dictionary for the same key twice.
+  tmp_request.set_lattice(lattice);
   if (!converter_->StartConversionForRequest(tmp_request, &tmp_segments)) {
     return false;
   }
@@ -1220,6 +1364,7 @@ void DictionaryPredictor::AggregateRealtimeConversion(
     const ConversionRequest &request,
     Segments *segments,
     std::vector<Result> *results) const {
+  MOZC_TRACE_SCOPE("AggregateRealtimeConversion");
   if (!(types & REALTIME)) {
     return;
   }
@@ -1235,11 +1380,17 @@ void DictionaryPredictor::AggregateRealtimeConversion(
   Segment *segment = segments->mutable_conversion_segment(0);
   DCHECK(!segment->key().empty());
 
-  // First insert a top conversion result.
+  // First insert a top conversion result.  It shares the lattice with the
+  // immutable converter below, so each key is looked up only once.
   if (request.use_actual_converter_for_realtime_conversion()) {
-    if (!PushBackTopConversionResult(request, *segments, results)) {
+    Lattice *lattice = (request.lattice() != NULL) ?
+        request.lattice() : segments->mutable_cached_lattice();
+    if (!PushBackTopConversionResult(request, *segments, lattice, results)) {
       LOG(WARNING) << "Realtime conversion with converter failed";
     }
+    if (request.IsCanceled()) {
+      return;
+    }
   }
 
   // In what follows, add results from immutable converter.
@@ -1308,6 +1459,12 @@ size_t DictionaryPredictor::GetCandidateCutoffThreshold(
          segments.request_type() == Segments::SUGGESTION);
   if (segments.request_type() == Segments::PREDICTION) {
     // If PREDICTION, many candidates are needed than SUGGESTION.
+    // SUGGESTION isn't scaled because its threshold also decides when the
+    // results are too ambiguous to show.
+    if (latency_budget_) {
+      return latency_budget_->Scale(kPredictionMaxResultsSize,
+                                    kSuggestionMaxResultsSize);
+    }
     return kPredictionMaxResultsSize;
   }
   return kSuggestionMaxResultsSize;
@@ -1318,6 +1475,7 @@ void DictionaryPredictor::AggregateUnigramPrediction(
     const ConversionRequest &request,
     const Segments &segments,
     std::vector<Result> *results) const {
+  MOZC_TRACE_SCOPE("AggregateUnigramPrediction");
   if (!(types & UNIGRAM)) {
     return;
   }
@@ -1441,6 +1599,7 @@ void DictionaryPredictor::AggregateBigramPrediction(
     const ConversionRequest &request,
     const Segments &segments,
     std::vector<Result> *results) const {
+  MOZC_TRACE_SCOPE("AggregateBigramPrediction");
   if (!(types & BIGRAM)) {
     return;
   }
@@ -1648,7 +1807,8 @@ void DictionaryPredictor::GetPredictiveResultsForBigram(
     PredictiveBigramLookupCallback callback(
         types, lookup_limit, input_key.size(), NULL, history_value,
         is_zero_query, results);
-    dictionary.LookupPredictive(input_key, request, &callback);
+    dictionary.LookupPredictiveWithValuePrefix(input_key, history_value,
+                                               request, &callback);
     return;
   }
 
@@ -1667,7 +1827,8 @@ void DictionaryPredictor::GetPredictiveResultsForBigram(
                                           expanded.empty() ? NULL : &expanded,
                                           history_value, is_zero_query,
                                           results);
-  dictionary.LookupPredictive(input_key, request, &callback);
+  dictionary.LookupPredictiveWithValuePrefix(input_key, history_value, request,
+                                             &callback);
 }
 
 void DictionaryPredictor::GetPredictiveResultsForEnglish(
@@ -1804,6 +1965,43 @@ bool DictionaryPredictor::GetZeroQueryCandidatesForKey(
   return !results->empty();
 }
 
+bool DictionaryPredictor::GetZeroQueryCandidatesForKeyWithCache(
+    const ConversionRequest &request, const string &key,
+    const ZeroQueryDict &dict, std::vector<ZeroQueryResult> *results) const {
+  DCHECK(results);
+  // The candidates depend on the dictionary and the available emoji
+  // carriers as well as the key.
+  string cache_key(1, &dict == &zero_query_number_dict_ ? 'n' : 'z');
+  cache_key.append(std::to_string(request.request().available_emoji_carrier()));
+  cache_key.append(1, '\t');
+  cache_key.append(key);
+
+  scoped_lock l(&zero_query_cache_mutex_);
+  const std::vector<ZeroQueryResult> *cached =
+      zero_query_cache_.Lookup(cache_key);
+  if (cached != nullptr) {
+    *results = *cached;
+    return !results->empty();
+  }
+  const bool found = GetZeroQueryCandidatesForKey(request, key, dict, results);
+  zero_query_cache_.Insert(cache_key, *results);
+  return found;
+}
+
+void DictionaryPredictor::AppendZeroQuerySuffixResults(
+    const ConversionRequest &request, const Segments &segments,
+    size_t lookup_limit, std::vector<Result> *results) const {
+  scoped_lock l(&zero_query_cache_mutex_);
+  if (zero_query_suffix_limit_ != lookup_limit) {
+    zero_query_suffix_results_.clear();
+    GetPredictiveResults(*suffix_dictionary_, "", request, segments, SUFFIX,
+                         lookup_limit, &zero_query_suffix_results_);
+    zero_query_suffix_limit_ = lookup_limit;
+  }
+  results->insert(results->end(), zero_query_suffix_results_.begin(),
+                  zero_query_suffix_results_.end());
+}
+
 // static
 void DictionaryPredictor::AppendZeroQueryToResults(
     const std::vector<ZeroQueryResult> &candidates, uint16 lid, uint16 rid,
@@ -1838,16 +2036,16 @@ bool DictionaryPredictor::AggregateNumberZeroQueryPrediction(
   }
 
   std::vector<ZeroQueryResult> candidates_for_number_key;
-  GetZeroQueryCandidatesForKey(request,
-                               number_key,
-                               zero_query_number_dict_,
-                               &candidates_for_number_key);
+  GetZeroQueryCandidatesForKeyWithCache(request,
+                                        number_key,
+                                        zero_query_number_dict_,
+                                        &candidates_for_number_key);
 
   std::vector<ZeroQueryResult> default_candidates_for_number;
-  GetZeroQueryCandidatesForKey(request,
-                               "default",
-                               zero_query_number_dict_,
-                               &default_candidates_for_number);
+  GetZeroQueryCandidatesForKeyWithCache(request,
+                                        "default",
+                                        zero_query_number_dict_,
+                                        &default_candidates_for_number);
   DCHECK(!default_candidates_for_number.empty());
 
   AppendZeroQueryToResults(candidates_for_number_key,
@@ -1875,10 +2073,10 @@ bool DictionaryPredictor::AggregateZeroQueryPrediction(
   const string &history_value = last_segment.candidate(0).value;
 
   std::vector<ZeroQueryResult> candidates;
-  if (!GetZeroQueryCandidatesForKey(request,
-                                    history_value,
-                                    zero_query_dict_,
-                                    &candidates)) {
+  if (!GetZeroQueryCandidatesForKeyWithCache(request,
+                                             history_value,
+                                             zero_query_dict_,
+                                             &candidates)) {
     return false;
   }
 
@@ -1892,6 +2090,7 @@ void DictionaryPredictor::AggregateSuffixPrediction(
     const ConversionRequest &request,
     const Segments &segments,
     std::vector<Result> *results) const {
+  MOZC_TRACE_SCOPE("AggregateSuffixPrediction");
   if (!(types & SUFFIX)) {
     return;
   }
@@ -1912,6 +2111,11 @@ void DictionaryPredictor::AggregateSuffixPrediction(
   }
 
   const size_t cutoff_threshold = GetCandidateCutoffThreshold(segments);
+  if (is_zero_query) {
+    AppendZeroQuerySuffixResults(request, segments, cutoff_threshold,
+                                 results);
+    return;
+  }
   const string kEmptyHistoryKey = "";
   GetPredictiveResults(*suffix_dictionary_, kEmptyHistoryKey, request,
                        segments, SUFFIX, cutoff_threshold, results);
@@ -1922,6 +2126,7 @@ void DictionaryPredictor::AggregateEnglishPrediction(
     const ConversionRequest &request,
     const Segments &segments,
     std::vector<Result> *results) const {
+  MOZC_TRACE_SCOPE("AggregateEnglishPrediction");
   if (!(types & ENGLISH)) {
     return;
   }
@@ -1949,6 +2154,7 @@ void DictionaryPredictor::AggregateTypeCorrectingPrediction(
     const ConversionRequest &request,
     const Segments &segments,
     std::vector<Result> *results) const {
+  MOZC_TRACE_SCOPE("AggregateTypeCorrectingPrediction");
   if (!(types & TYPING_CORRECTION)) {
     return;
   }
@@ -1956,7 +2162,7 @@ void DictionaryPredictor::AggregateTypeCorrectingPrediction(
   DCHECK(dictionary_);
 
   const size_t prev_results_size = results->size();
-  if (prev_results_size > 10000) {
+  if (prev_results_size > kMaxResultsSizeForTypingCorrection) {
     return;
   }
 
@@ -31,9 +31,11 @@
 #define MOZC_PREDICTION_DICTIONARY_PREDICTOR_H_
 
 #include <functional>
+#include <memory>
 #include <string>
 #include <vector>
 
+#include "base/mutex.h"
 #include "base/util.h"
 #include "converter/connector.h"
 #include "converter/converter_interface.h"
@@ -44,10 +46,12 @@
 #include "dictionary/dictionary_interface.h"
 #include "dictionary/dictionary_token.h"
 #include "dictionary/pos_matcher.h"
+#include "prediction/latency_budget.h"
 #include "prediction/predictor_interface.h"
 #include "prediction/suggestion_filter.h"
 #include "prediction/zero_query_dict.h"
 #include "request/conversion_request.h"
+#include "storage/lru_cache.h"
 // for FRIEND_TEST()
 #include "testing/base/public/gunit_prod.h"
 
@@ -110,7 +114,7 @@ class DictionaryPredictor : public PredictorInterface {
                candidate_attributes(0), source_info(0),
                consumed_key_size(0) {}
 
-    void InitializeByTokenAndTypes(const dictionary::Token &token,
+    void InitializeByTokenAndTypes(const dictionary::TokenView &token,
                                    PredictionTypes types);
     void SetTypesAndTokenAttributes(
         PredictionTypes prediction_types,
@@ -208,6 +212,7 @@ class DictionaryPredictor : public PredictorInterface {
   FRIEND_TEST(DictionaryPredictorTest,
               GetRealtimeCandidateMaxSizeWithActualConverter);
   FRIEND_TEST(DictionaryPredictorTest, GetCandidateCutoffThreshold);
+  FRIEND_TEST(DictionaryPredictorTest, AdaptToLatencyBudget);
   FRIEND_TEST(DictionaryPredictorTest, AggregateUnigramPrediction);
   FRIEND_TEST(DictionaryPredictorTest, AggregateBigramPrediction);
   FRIEND_TEST(DictionaryPredictorTest, AggregateZeroQueryBigramPrediction);
@@ -231,6 +236,7 @@ class DictionaryPredictor : public PredictorInterface {
   FRIEND_TEST(DictionaryPredictorTest, SetDescription);
   FRIEND_TEST(DictionaryPredictorTest, SetDebugDescription);
   FRIEND_TEST(DictionaryPredictorTest, GetZeroQueryCandidates);
+  FRIEND_TEST(DictionaryPredictorTest, ZeroQueryCache);
 
   typedef std::pair<string, ZeroQueryType> ZeroQueryResult;
 
@@ -243,10 +249,32 @@ class DictionaryPredictor : public PredictorInterface {
       const ZeroQueryDict &dict,
       std::vector<ZeroQueryResult> *results);
 
+  // Same as GetZeroQueryCandidatesForKey() but remembers the candidates for
+  // the recent keys, as zero query is requested after every commit.
+  bool GetZeroQueryCandidatesForKeyWithCache(
+      const ConversionRequest &request,
+      const string &key,
+      const ZeroQueryDict &dict,
+      std::vector<ZeroQueryResult> *results) const;
+
+  // Appends the suffix predictions for zero query, i.e., the first
+  // |lookup_limit| entries of the suffix dictionary.  They don't depend on
+  // the history, so they are looked up once per |lookup_limit|.
+  void AppendZeroQuerySuffixResults(const ConversionRequest &request,
+                                    const Segments &segments,
+                                    size_t lookup_limit,
+                                    std::vector<Result> *results) const;
+
   static void AppendZeroQueryToResults(
       const std::vector<ZeroQueryResult> &candidates,
       uint16 lid, uint16 rid, std::vector<Result> *results);
 
+  // Moves a result buffer left by a previous request into the empty
+  // |results|, so that its capacity is reused.
+  void AcquireResultsBuffer(std::vector<Result> *results) const;
+  // Clears |results| and keeps its buffer for the following requests.
+  void ReleaseResultsBuffer(std::vector<Result> *results) const;
+
   // Returns false if no results were aggregated.
   bool AggregatePrediction(const ConversionRequest &request,
                            Segments *segments,
@@ -334,8 +362,7 @@ class DictionaryPredictor : public PredictorInterface {
   // key: "ろっぽんぎ"5
   // value: "六本木"
   // returns 5 (charslen("六本木"))
-  size_t GetMissSpelledPosition(const string &key,
-                                const string &value) const;
+  size_t GetMissSpelledPosition(StringPiece key, StringPiece value) const;
 
   // Returns language model cost of |token| given prediciton type |type|.
   // |rid| is the right id of previous word (token).
@@ -453,9 +480,11 @@ class DictionaryPredictor : public PredictorInterface {
   size_t GetCandidateCutoffThreshold(const Segments &segments) const;
 
   // Generates a top conversion result from |converter_| and adds its result to
-  // |results|.
+  // |results|.  The conversion builds its lattice into |lattice|, which the
+  // following realtime conversion of the same key reuses.
   bool PushBackTopConversionResult(const ConversionRequest &request,
                                    const Segments &segments,
+                                   Lattice *lattice,
                                    std::vector<Result> *results) const;
 
   void MaybeRecordUsageStats(const Segment::Candidate &candidate) const;
@@ -480,6 +509,18 @@ class DictionaryPredictor : public PredictorInterface {
   const string predictor_name_;
   ZeroQueryDict zero_query_dict_;
   ZeroQueryDict zero_query_number_dict_;
+  // Guards the zero query caches below.
+  mutable Mutex zero_query_cache_mutex_;
+  mutable storage::LRUCache<string, std::vector<ZeroQueryResult>>
+      zero_query_cache_;
+  mutable std::vector<Result> zero_query_suffix_results_;
+  mutable size_t zero_query_suffix_limit_;
+  // Guards |results_pool_|.
+  mutable Mutex results_pool_mutex_;
+  mutable std::vector<std::vector<Result>> results_pool_;
+  // Scales the realtime conversion size and the lookup limits to meet
+  // --prediction_latency_budget_usec.  NULL when the budget is disabled.
+  std::unique_ptr<LatencyBudget> latency_budget_;
 
   DISALLOW_COPY_AND_ASSIGN(DictionaryPredictor);
 };
@@ -78,6 +78,8 @@
 #include "usage_stats/usage_stats_testing_util.h"
 
 DECLARE_bool(enable_expansion_for_dictionary_predictor);
+DECLARE_int32(prediction_latency_budget_usec);
+DECLARE_int32(dictionary_predictor_aggregation_threads);
 
 namespace mozc {
 namespace {
@@ -814,6 +816,43 @@ TEST_F(DictionaryPredictorTest, OnOffTest) {
   EXPECT_FALSE(predictor->PredictForRequest(*convreq_, &segments));
 }
 
+TEST_F(DictionaryPredictorTest, ParallelAggregation) {
+  unique_ptr<MockDataAndPredictor> data_and_predictor(
+      CreateDictionaryPredictorWithMockData());
+  const DictionaryPredictor *predictor =
+      data_and_predictor->dictionary_predictor();
+  config_->set_use_dictionary_suggest(true);
+  config_->set_use_realtime_conversion(true);
+
+  const char *kKeys[] = {"ぐーぐるあ", "てすと", "あ"};
+  const int32 default_threads = FLAGS_dictionary_predictor_aggregation_threads;
+  for (size_t i = 0; i < arraysize(kKeys); ++i) {
+    // The parallel run returns the same candidates in the same order.
+    Segments expected, actual;
+    FLAGS_dictionary_predictor_aggregation_threads = 0;
+    MakeSegmentsForPrediction(kKeys[i], &expected);
+    const bool expected_result =
+        predictor->PredictForRequest(*convreq_, &expected);
+
+    FLAGS_dictionary_predictor_aggregation_threads = 4;
+    MakeSegmentsForPrediction(kKeys[i], &actual);
+    EXPECT_EQ(expected_result,
+              predictor->PredictForRequest(*convreq_, &actual));
+
+    ASSERT_EQ(expected.conversion_segments_size(),
+              actual.conversion_segments_size());
+    const Segment &expected_segment = expected.conversion_segment(0);
+    const Segment &actual_segment = actual.conversion_segment(0);
+    ASSERT_EQ(expected_segment.candidates_size(),
+              actual_segment.candidates_size()) << kKeys[i];
+    for (size_t j = 0; j < expected_segment.candidates_size(); ++j) {
+      EXPECT_EQ(expected_segment.candidate(j).value,
+                actual_segment.candidate(j).value);
+    }
+  }
+  FLAGS_dictionary_predictor_aggregation_threads = default_threads;
+}
+
 TEST_F(DictionaryPredictorTest, PartialSuggestion) {
   unique_ptr<MockDataAndPredictor> data_and_predictor(
       CreateDictionaryPredictorWithMockData());
@@ -1706,6 +1745,47 @@ TEST_F(DictionaryPredictorTest, GetCandidateCutoffThreshold) {
   EXPECT_LE(suggestion, prediction);
 }
 
+TEST_F(DictionaryPredictorTest, AdaptToLatencyBudget) {
+  const int32 default_budget = FLAGS_prediction_latency_budget_usec;
+  FLAGS_prediction_latency_budget_usec = 1000;
+  unique_ptr<MockDataAndPredictor> data_and_predictor(
+      CreateDictionaryPredictorWithMockData());
+  FLAGS_prediction_latency_budget_usec = default_budget;
+  const DictionaryPredictor *predictor =
+      data_and_predictor->dictionary_predictor();
+  ASSERT_TRUE(predictor->latency_budget_ != nullptr);
+
+  Segments segments;
+  segments.set_request_type(Segments::PREDICTION);
+  const size_t kMaxSize = 100;
+  const size_t default_cutoff =
+      predictor->GetCandidateCutoffThreshold(segments);
+  const size_t default_realtime_size =
+      predictor->GetRealtimeCandidateMaxSize(segments, true, kMaxSize);
+
+  // Slow predictions make the limits smaller.
+  for (size_t i = 0; i < LatencyBudget::kWindowSize * 4; ++i) {
+    predictor->latency_budget_->Record(5000);
+  }
+  EXPECT_GT(default_cutoff, predictor->GetCandidateCutoffThreshold(segments));
+  EXPECT_GT(default_realtime_size,
+            predictor->GetRealtimeCandidateMaxSize(segments, true, kMaxSize));
+  EXPECT_LE(1, predictor->GetRealtimeCandidateMaxSize(segments, true,
+                                                       kMaxSize));
+  segments.set_request_type(Segments::SUGGESTION);
+  EXPECT_LE(predictor->GetCandidateCutoffThreshold(segments),
+            default_cutoff);
+
+  // Fast predictions make them larger, up to |kMaxSize|.
+  segments.set_request_type(Segments::PREDICTION);
+  for (size_t i = 0; i < LatencyBudget::kWindowSize * 8; ++i) {
+    predictor->latency_budget_->Record(10);
+  }
+  EXPECT_LT(default_cutoff, predictor->GetCandidateCutoffThreshold(segments));
+  EXPECT_GE(kMaxSize,
+            predictor->GetRealtimeCandidateMaxSize(segments, true, kMaxSize));
+}
+
 TEST_F(DictionaryPredictorTest, AggregateSuffixPrediction) {
   unique_ptr<MockDataAndPredictor> data_and_predictor(new MockDataAndPredictor);
   data_and_predictor->Init(NULL, new TestSuffixDictionary());
@@ -3106,6 +3186,49 @@ TEST_F(DictionaryPredictorTest, PredictNCandidates) {
   }
 }
 
+TEST_F(DictionaryPredictorTest, AddPredictionToCandidatesSkipsDuplicates) {
+  unique_ptr<MockDataAndPredictor> data_and_predictor(
+      CreateDictionaryPredictorWithMockData());
+  const TestableDictionaryPredictor *predictor =
+      data_and_predictor->dictionary_predictor();
+
+  std::vector<TestableDictionaryPredictor::Result> results;
+  const int kTestSize = 10;
+  for (size_t i = 0; i < kTestSize; ++i) {
+    results.push_back(TestableDictionaryPredictor::MakeEmptyResult());
+    TestableDictionaryPredictor::Result *result = &results.back();
+    // Every value appears twice; the lower cost one should be added.
+    result->key = string(1, 'a' + i);
+    result->value = string(1, 'A' + i / 2);
+    result->wcost = i;
+    result->cost = i + 1000;
+    result->SetTypesAndTokenAttributes(TestableDictionaryPredictor::REALTIME,
+                                       Token::NONE);
+  }
+  // The result removed by RemovePrediction is never added.
+  results[0].types = TestableDictionaryPredictor::NO_PREDICTION;
+  std::random_shuffle(results.begin(), results.end());
+
+  Segments segments;
+  MakeSegmentsForSuggestion("test", &segments);
+  segments.set_max_prediction_candidates_size(kTestSize);
+
+  predictor->AddPredictionToCandidates(*convreq_,
+                                       &segments, &results);
+
+  ASSERT_EQ(1, segments.conversion_segments_size());
+  const Segment &segment = segments.conversion_segment(0);
+  ASSERT_EQ(kTestSize / 2, segment.candidates_size());
+  EXPECT_EQ("b", segment.candidate(0).key);
+  EXPECT_EQ("A", segment.candidate(0).value);
+  EXPECT_EQ("b", segment.candidate(0).content_key);
+  EXPECT_EQ("A", segment.candidate(0).content_value);
+  for (size_t i = 1; i < segment.candidates_size(); ++i) {
+    EXPECT_EQ(string(1, 'a' + 2 * i), segment.candidate(i).key);
+    EXPECT_EQ(string(1, 'A' + i), segment.candidate(i).value);
+  }
+}
+
 TEST_F(DictionaryPredictorTest, SuggestFilteredwordForExactMatchOnMobile) {
   unique_ptr<MockDataAndPredictor> data_and_predictor(
       CreateDictionaryPredictorWithMockData());
@@ -3359,6 +3482,64 @@ TEST_F(DictionaryPredictorTest, GetZeroQueryCandidates) {
   }
 }
 
+TEST_F(DictionaryPredictorTest, ZeroQueryCache) {
+  unique_ptr<MockDataAndPredictor> data_and_predictor(
+      CreateDictionaryPredictorWithMockData());
+  const DictionaryPredictor *predictor =
+      data_and_predictor->dictionary_predictor();
+
+  commands::Request client_request;
+  composer::Table table;
+  const config::Config &config = config::ConfigHandler::DefaultConfig();
+  composer::Composer composer(&table, &client_request, &config);
+
+  // The cached candidates are the same as the uncached ones, and are kept
+  // per available emoji carriers.
+  const int32 kCarriers[] = {
+    0,
+    commands::Request::UNICODE_EMOJI,
+    commands::Request::DOCOMO_EMOJI | commands::Request::UNICODE_EMOJI,
+  };
+  for (size_t i = 0; i < arraysize(kCarriers); ++i) {
+    client_request.set_available_emoji_carrier(kCarriers[i]);
+    const ConversionRequest request(&composer, &client_request, &config);
+    std::vector<DictionaryPredictor::ZeroQueryResult> expected;
+    const bool expected_result =
+        DictionaryPredictor::GetZeroQueryCandidatesForKey(
+            request, "あ", predictor->zero_query_dict_, &expected);
+    for (int trial = 0; trial < 2; ++trial) {
+      std::vector<DictionaryPredictor::ZeroQueryResult> actual;
+      EXPECT_EQ(expected_result,
+                predictor->GetZeroQueryCandidatesForKeyWithCache(
+                    request, "あ", predictor->zero_query_dict_, &actual));
+      EXPECT_EQ(expected, actual);
+    }
+    EXPECT_EQ(i + 1, predictor->zero_query_cache_.Size());
+  }
+
+  // The suffix predictions for zero query are the same as the lookup.
+  Segments segments;
+  MakeSegmentsForSuggestion("", &segments);
+  const ConversionRequest request(&composer, &client_request, &config);
+  const size_t kLimit = 10;
+  std::vector<DictionaryPredictor::Result> expected;
+  DictionaryPredictor::GetPredictiveResults(
+      *predictor->suffix_dictionary_, "", request, segments,
+      DictionaryPredictor::SUFFIX, kLimit, &expected);
+  for (int trial = 0; trial < 2; ++trial) {
+    std::vector<DictionaryPredictor::Result> actual;
+    predictor->AppendZeroQuerySuffixResults(request, segments, kLimit,
+                                            &actual);
+    ASSERT_EQ(expected.size(), actual.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+      EXPECT_EQ(expected[i].key, actual[i].key);
+      EXPECT_EQ(expected[i].value, actual[i].value);
+      EXPECT_EQ(expected[i].wcost, actual[i].wcost);
+      EXPECT_EQ(expected[i].source_info, actual[i].source_info);
+    }
+  }
+}
+
 namespace {
 void SetSegmentForCommit(const string &candidate_value,
                          int candidate_source_info, Segments *segments) {
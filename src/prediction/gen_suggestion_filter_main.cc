@@ -28,6 +28,7 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <algorithm>
+#include <iostream>
 #include <memory>
 #include <string>
 
@@ -39,6 +40,7 @@
 #include "base/logging.h"
 #include "base/util.h"
 #include "storage/existence_filter.h"
+#include "storage/existence_filter_builder.h"
 
 DEFINE_string(input, "", "per-line suggestion filter list");
 DEFINE_string(output, "", "output bloom filter");
@@ -46,6 +48,16 @@ DEFINE_bool(header, true,
             "make header file instead of raw bloom filter");
 DEFINE_string(name, "SuggestionFilterData",
               "name for variable name in the header file");
+DEFINE_double(error_rate, 0.00001, "target false positive rate");
+DEFINE_bool(tune, false,
+            "choose the size, the number of hashes and the format of the "
+            "filter for --error_rate within --min_bytes and --max_bytes, "
+            "instead of the fixed minimum size");
+DEFINE_int32(min_bytes, 0, "minimum size of the tuned filter");
+DEFINE_int32(max_bytes, 0, "maximum size of the tuned filter (0: no limit)");
+DEFINE_string(holdout, "",
+              "per-line word list not in the filter, used to measure the "
+              "false positive rate of the tuned filter");
 
 namespace {
 void ReadWords(const string &name, std::vector<uint64> *words) {
@@ -65,6 +77,7 @@ const size_t kMinimumFilterBytes = 100 * 1000;
 }  // namespace
 
 using mozc::storage::ExistenceFilter;
+using mozc::storage::ExistenceFilterBuilder;
 
 // read per-line word list and generate
 // bloom filter in raw byte array or header file format
@@ -83,18 +96,40 @@ int main(int argc, char **argv) {
 
   LOG(INFO) << words.size() << " words found";
 
-  static const float kErrorRate = 0.00001;
-  const size_t num_bytes =
-      std::max(ExistenceFilter::MinFilterSizeInBytesForErrorRate(kErrorRate,
-                                                                 words.size()),
-               kMinimumFilterBytes);
+  std::unique_ptr<ExistenceFilter> filter;
+  if (FLAGS_tune) {
+    std::vector<uint64> holdout;
+    if (!FLAGS_holdout.empty()) {
+      ReadWords(FLAGS_holdout, &holdout);
+    }
+    ExistenceFilterBuilder::Options options;
+    options.target_error_rate = FLAGS_error_rate;
+    options.min_bytes = FLAGS_min_bytes;
+    options.max_bytes = FLAGS_max_bytes;
+    ExistenceFilterBuilder::Report report;
+    filter.reset(ExistenceFilterBuilder::Build(words, holdout, options,
+                                               &report));
+    std::cout << "bytes: " << report.size_in_bytes
+              << " k: " << report.parameters.header.k
+              << " format: " << report.parameters.header.format
+              << " estimated error rate: "
+              << report.parameters.estimated_error_rate
+              << " measured error rate: " << report.measured_error_rate
+              << " (" << report.num_false_positives << "/"
+              << report.num_holdout << ")" << std::endl;
+  } else {
+    const size_t num_bytes =
+        std::max(ExistenceFilter::MinFilterSizeInBytesForErrorRate(
+                     FLAGS_error_rate, words.size()),
+                 kMinimumFilterBytes);
 
-  LOG(INFO) << "num_bytes: " << num_bytes;
+    LOG(INFO) << "num_bytes: " << num_bytes;
 
-  std::unique_ptr<ExistenceFilter> filter(
-      ExistenceFilter::CreateOptimal(num_bytes, words.size()));
-  for (size_t i = 0; i < words.size(); ++i) {
-    filter->Insert(words[i]);
+    filter.reset(ExistenceFilter::CreateOptimal(num_bytes, words.size(),
+                                                ExistenceFilter::BLOCKED));
+    for (size_t i = 0; i < words.size(); ++i) {
+      filter->Insert(words[i]);
+    }
   }
 
   char *buf = NULL;
@@ -0,0 +1,96 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "prediction/latency_budget.h"
+
+#include <algorithm>
+
+#include "base/logging.h"
+
+namespace mozc {
+namespace {
+
+// Multiplied to the scale on each adjustment.
+const double kShrinkFactor = 0.75;
+const double kGrowFactor = 1.25;
+
+}  // namespace
+
+const size_t LatencyBudget::kWindowSize;
+const size_t LatencyBudget::kAdjustInterval;
+const double LatencyBudget::kMinScale = 0.25;
+const double LatencyBudget::kMaxScale = 2.0;
+
+LatencyBudget::LatencyBudget(uint64 budget_usec)
+    : budget_usec_(budget_usec),
+      next_index_(0),
+      num_records_(0),
+      scale_(1.0) {
+  DCHECK_GT(budget_usec_, 0);
+  latencies_.reserve(kWindowSize);
+}
+
+LatencyBudget::~LatencyBudget() {}
+
+void LatencyBudget::Record(uint64 usec) {
+  scoped_lock l(&mutex_);
+  if (latencies_.size() < kWindowSize) {
+    latencies_.push_back(usec);
+  } else {
+    latencies_[next_index_] = usec;
+  }
+  next_index_ = (next_index_ + 1) % kWindowSize;
+  if (++num_records_ % kAdjustInterval != 0) {
+    return;
+  }
+
+  std::vector<uint64> sorted(latencies_);
+  const size_t p90_index = sorted.size() * 9 / 10;
+  std::nth_element(sorted.begin(), sorted.begin() + p90_index, sorted.end());
+  const uint64 p90_usec = sorted[p90_index];
+  if (p90_usec > budget_usec_) {
+    scale_ = std::max(kMinScale, scale_ * kShrinkFactor);
+  } else if (p90_usec < budget_usec_ / 2) {
+    scale_ = std::min(kMaxScale, scale_ * kGrowFactor);
+  }
+  VLOG(2) << "p90: " << p90_usec << " usec, budget: " << budget_usec_
+          << " usec, scale: " << scale_;
+}
+
+double LatencyBudget::GetScale() const {
+  scoped_lock l(&mutex_);
+  return scale_;
+}
+
+size_t LatencyBudget::Scale(size_t size, size_t min_size) const {
+  const size_t scaled = static_cast<size_t>(size * GetScale());
+  return std::max(scaled, min_size);
+}
+
+}  // namespace mozc
@@ -0,0 +1,81 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Adapts the amount of prediction work to a per-keystroke latency budget.
+
+#ifndef MOZC_PREDICTION_LATENCY_BUDGET_H_
+#define MOZC_PREDICTION_LATENCY_BUDGET_H_
+
+#include <vector>
+
+#include "base/mutex.h"
+#include "base/port.h"
+
+namespace mozc {
+
+// Tracks the latencies of the recent predictions and derives a scale of the
+// lookup limits from them.  Every kAdjustInterval records, the 90th
+// percentile of the last kWindowSize latencies is compared with the budget;
+// the scale shrinks when it is over the budget and grows when it is under
+// half of the budget, within [kMinScale, kMaxScale].  Thread-safe.
+class LatencyBudget {
+ public:
+  static const size_t kWindowSize = 32;
+  static const size_t kAdjustInterval = 8;
+  static const double kMinScale;
+  static const double kMaxScale;
+
+  explicit LatencyBudget(uint64 budget_usec);
+  ~LatencyBudget();
+
+  void Record(uint64 usec);
+
+  // Returns the current scale, which starts at 1.0.
+  double GetScale() const;
+
+  // Returns |size| multiplied by the current scale, but at least |min_size|.
+  size_t Scale(size_t size, size_t min_size) const;
+
+  uint64 budget_usec() const { return budget_usec_; }
+
+ private:
+  const uint64 budget_usec_;
+  mutable Mutex mutex_;
+  // Ring buffer of the recent latencies.
+  std::vector<uint64> latencies_;
+  size_t next_index_;
+  size_t num_records_;
+  double scale_;
+
+  DISALLOW_COPY_AND_ASSIGN(LatencyBudget);
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_PREDICTION_LATENCY_BUDGET_H_
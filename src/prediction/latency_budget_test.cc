@@ -0,0 +1,95 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "prediction/latency_budget.h"
+
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace {
+
+void RecordRepeatedly(uint64 usec, size_t count, LatencyBudget *budget) {
+  for (size_t i = 0; i < count; ++i) {
+    budget->Record(usec);
+  }
+}
+
+TEST(LatencyBudgetTest, InitialScale) {
+  LatencyBudget budget(1000);
+  EXPECT_DOUBLE_EQ(1.0, budget.GetScale());
+  EXPECT_EQ(100, budget.Scale(100, 1));
+  EXPECT_EQ(10, budget.Scale(0, 10));
+}
+
+TEST(LatencyBudgetTest, AdjustsEveryInterval) {
+  LatencyBudget budget(1000);
+  RecordRepeatedly(5000, LatencyBudget::kAdjustInterval - 1, &budget);
+  EXPECT_DOUBLE_EQ(1.0, budget.GetScale());
+  budget.Record(5000);
+  EXPECT_GT(1.0, budget.GetScale());
+}
+
+TEST(LatencyBudgetTest, ShrinksWhenSlow) {
+  LatencyBudget budget(1000);
+  RecordRepeatedly(5000, LatencyBudget::kWindowSize * 4, &budget);
+  EXPECT_DOUBLE_EQ(LatencyBudget::kMinScale, budget.GetScale());
+  EXPECT_EQ(25, budget.Scale(100, 1));
+  EXPECT_EQ(1, budget.Scale(2, 1));
+}
+
+TEST(LatencyBudgetTest, GrowsWhenFast) {
+  LatencyBudget budget(1000);
+  RecordRepeatedly(100, LatencyBudget::kWindowSize * 4, &budget);
+  EXPECT_DOUBLE_EQ(LatencyBudget::kMaxScale, budget.GetScale());
+  EXPECT_EQ(200, budget.Scale(100, 1));
+}
+
+TEST(LatencyBudgetTest, KeepsScaleWithinBudget) {
+  LatencyBudget budget(1000);
+  // Between half of the budget and the budget.
+  RecordRepeatedly(800, LatencyBudget::kWindowSize * 4, &budget);
+  EXPECT_DOUBLE_EQ(1.0, budget.GetScale());
+}
+
+TEST(LatencyBudgetTest, UsesPercentileOfRecentLatencies) {
+  LatencyBudget budget(1000);
+  RecordRepeatedly(5000, LatencyBudget::kWindowSize, &budget);
+  const double slow_scale = budget.GetScale();
+  EXPECT_GT(1.0, slow_scale);
+
+  // Once the slow latencies leave the window, a few outliers under 10% of
+  // the window don't keep the scale small.
+  for (size_t i = 0; i < LatencyBudget::kWindowSize * 2; ++i) {
+    budget.Record(i % 16 == 0 ? 5000 : 100);
+  }
+  EXPECT_LT(slow_scale, budget.GetScale());
+}
+
+}  // namespace
+}  // namespace mozc
@@ -39,6 +39,7 @@
       'hard_dependency': 1,
       'sources': [
         'dictionary_predictor.cc',
+        'latency_budget.cc',
         'predictor.cc',
         'user_history_predictor.cc',
       ],
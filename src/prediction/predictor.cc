@@ -30,11 +30,14 @@
 #include "prediction/predictor.h"
 
 #include <algorithm>
+#include <memory>
+#include <set>
 #include <string>
 #include <vector>
 
 #include "base/flags.h"
 #include "base/logging.h"
+#include "base/thread_pool.h"
 #include "converter/segments.h"
 #include "protocol/commands.pb.h"
 #include "protocol/config.pb.h"
@@ -42,6 +45,10 @@
 DECLARE_bool(enable_expansion_for_dictionary_predictor);
 DECLARE_bool(enable_expansion_for_user_history_predictor);
 
+DEFINE_bool(enable_concurrent_prediction, false,
+            "If true, the user history predictor and the dictionary predictor "
+            "run in parallel and their candidates are merged afterwards.");
+
 namespace mozc {
 namespace {
 
@@ -130,6 +137,62 @@ bool BasePredictor::Reload() {
   return user_history_predictor_->Reload();
 }
 
+bool BasePredictor::PredictConcurrently(const ConversionRequest &request,
+                                        size_t history_max_size,
+                                        size_t dictionary_max_added,
+                                        size_t max_size,
+                                        Segments *segments) const {
+  if (segments->conversion_segments_size() <= 0) {
+    LOG(ERROR) << "No conversion segments found";
+    return false;
+  }
+  const size_t base_size = GetCandidatesSize(*segments);
+
+  // The history predictor only reads the other segments, so it's enough to
+  // give it a copy.  The task refers to the locals, so it has to be waited
+  // for before returning.
+  Segments history_segments;
+  history_segments.CopyFrom(*segments);
+  history_segments.set_max_prediction_candidates_size(history_max_size);
+  std::shared_ptr<TaskFuture<bool>> history_result =
+      ThreadPool::GetSharedPool()->Async<bool>(
+          ThreadPool::HIGH, [this, &request, &history_segments]() {
+            return user_history_predictor_->PredictForRequest(
+                request, &history_segments);
+          });
+
+  segments->set_max_prediction_candidates_size(
+      std::min(max_size, base_size + dictionary_max_added));
+  bool result = dictionary_predictor_->PredictForRequest(request, segments);
+  result |= history_result->Get();
+
+  // The user history candidates go before the dictionary ones.
+  const Segment &history_segment = history_segments.conversion_segment(0);
+  Segment *segment = segments->mutable_conversion_segment(0);
+  const size_t dictionary_size = segment->candidates_size();
+  Segment::CandidateEditor editor(segment);
+  std::set<string> history_values;
+  for (size_t i = base_size; i < history_segment.candidates_size(); ++i) {
+    const Segment::Candidate &candidate = history_segment.candidate(i);
+    editor.Insert(base_size)->CopyFrom(candidate);
+    history_values.insert(candidate.value);
+  }
+  size_t total_size = history_segment.candidates_size();
+  size_t added = 0;
+  for (size_t i = base_size; i < dictionary_size; ++i) {
+    if (total_size >= max_size || added >= dictionary_max_added ||
+        history_values.find(segment->candidate(i).value) !=
+        history_values.end()) {
+      editor.Erase(i);
+      continue;
+    }
+    ++total_size;
+    ++added;
+  }
+  editor.Apply();
+  return result;
+}
+
 // static
 PredictorInterface *DefaultPredictor::CreateDefaultPredictor(
     PredictorInterface *dictionary_predictor,
@@ -162,6 +225,10 @@ bool DefaultPredictor::PredictForRequest(const ConversionRequest &request,
         9, std::max(1, static_cast<int>(request.config().suggestions_size())));
   }
 
+  if (FLAGS_enable_concurrent_prediction) {
+    return PredictConcurrently(request, size, size, size, segments);
+  }
+
   bool result = false;
   int remained_size = size;
   segments->set_max_prediction_candidates_size(static_cast<size_t>(size));
@@ -224,6 +291,13 @@ bool MobilePredictor::PredictForRequest(const ConversionRequest &request,
     case Segments::SUGGESTION: {
       // Suggestion is triggered at every character insertion.
       // So here we should use slow predictors.
+      if (FLAGS_enable_concurrent_prediction) {
+        const size_t base_size = GetCandidatesSize(*segments);
+        result = PredictConcurrently(
+            request, base_size + history_suggestion_size, 20,
+            base_size + history_suggestion_size + 20, segments);
+        break;
+      }
       size = GetCandidatesSize(*segments) + history_suggestion_size;
       segments->set_max_prediction_candidates_size(size);
       result |= user_history_predictor_->PredictForRequest(request, segments);
@@ -249,6 +323,12 @@ bool MobilePredictor::PredictForRequest(const ConversionRequest &request,
       break;
     }
     case Segments::PREDICTION: {
+      if (FLAGS_enable_concurrent_prediction) {
+        result = PredictConcurrently(
+            request, GetCandidatesSize(*segments) + history_suggestion_size,
+            kMobilePredictionSize, kMobilePredictionSize, segments);
+        break;
+      }
       size = GetCandidatesSize(*segments) + history_suggestion_size;
       segments->set_max_prediction_candidates_size(size);
       result |= user_history_predictor_->PredictForRequest(request, segments);
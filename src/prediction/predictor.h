@@ -77,6 +77,20 @@ class BasePredictor : public PredictorInterface {
   //                        Segments *segments) const = 0;
 
  protected:
+  // Runs |user_history_predictor_| on the shared thread pool while
+  // |dictionary_predictor_| runs on this thread, each on its own candidates,
+  // and merges the results as the sequential calls do: the user history
+  // predictor adds up to |history_max_size| candidates in total and comes
+  // first, and the dictionary predictor adds up to |dictionary_max_added|
+  // candidates after them as long as the total is within |max_size|.  The
+  // dictionary candidates with the same value as a user history candidate
+  // are dropped.
+  bool PredictConcurrently(const ConversionRequest &request,
+                           size_t history_max_size,
+                           size_t dictionary_max_added,
+                           size_t max_size,
+                           Segments *segments) const;
+
   std::unique_ptr<PredictorInterface> dictionary_predictor_;
   std::unique_ptr<PredictorInterface> user_history_predictor_;
 };
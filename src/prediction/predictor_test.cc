@@ -32,7 +32,9 @@
 #include <cstddef>
 #include <memory>
 #include <string>
+#include <vector>
 
+#include "base/flags.h"
 #include "base/logging.h"
 #include "base/singleton.h"
 #include "base/system_util.h"
@@ -53,6 +55,8 @@
 #include "testing/base/public/googletest.h"
 #include "testing/base/public/gunit.h"
 
+DECLARE_bool(enable_concurrent_prediction);
+
 using std::unique_ptr;
 
 using mozc::dictionary::DictionaryMock;
@@ -115,6 +119,48 @@ class NullPredictor : public PredictorInterface {
   const string predictor_name_;
 };
 
+// Adds the candidates of |values| as far as max_prediction_candidates_size()
+// allows.
+class CandidatePredictor : public PredictorInterface {
+ public:
+  explicit CandidatePredictor(const std::vector<string> &values)
+      : values_(values), predictor_name_("CandidatePredictor") {}
+
+  bool PredictForRequest(const ConversionRequest &request,
+                         Segments *segments) const override {
+    Segment *segment = segments->mutable_conversion_segment(0);
+    for (size_t i = 0; i < values_.size() &&
+         segment->candidates_size() <
+         segments->max_prediction_candidates_size(); ++i) {
+      Segment::Candidate *candidate = segment->push_back_candidate();
+      candidate->Init();
+      candidate->key = segment->key();
+      candidate->value = values_[i];
+    }
+    return !values_.empty();
+  }
+
+  const string &GetPredictorName() const override {
+    return predictor_name_;
+  }
+
+ private:
+  const std::vector<string> values_;
+  const string predictor_name_;
+};
+
+string GetCandidateValues(const Segments &segments) {
+  string values;
+  const Segment &segment = segments.conversion_segment(0);
+  for (size_t i = 0; i < segment.candidates_size(); ++i) {
+    if (i > 0) {
+      values += ",";
+    }
+    values += segment.candidate(i).value;
+  }
+  return values;
+}
+
 class MockPredictor : public PredictorInterface {
  public:
   MockPredictor() = default;
@@ -162,6 +208,31 @@ TEST_F(MobilePredictorTest, CallPredictorsForMobileSuggestion) {
   EXPECT_TRUE(predictor->PredictForRequest(*convreq_, &segments));
 }
 
+TEST_F(MobilePredictorTest, PredictConcurrentlyForMobileSuggestion) {
+  FLAGS_enable_concurrent_prediction = true;
+  std::vector<string> dictionary_values;
+  for (int i = 0; i < 30; ++i) {
+    dictionary_values.push_back("d" + std::to_string(i));
+  }
+  unique_ptr<MobilePredictor> predictor(new MobilePredictor(
+      new CandidatePredictor(dictionary_values),
+      new CandidatePredictor({"h0", "h1", "h2", "h3"})));
+
+  Segments segments;
+  segments.set_request_type(Segments::SUGGESTION);
+  segments.add_segment()->set_key("key");
+  EXPECT_TRUE(predictor->PredictForRequest(*convreq_, &segments));
+  // Three user history candidates for zero query suggestion and 20
+  // dictionary candidates.
+  const Segment &segment = segments.conversion_segment(0);
+  ASSERT_EQ(23, segment.candidates_size());
+  EXPECT_EQ("h0", segment.candidate(0).value);
+  EXPECT_EQ("h2", segment.candidate(2).value);
+  EXPECT_EQ("d0", segment.candidate(3).value);
+  EXPECT_EQ("d19", segment.candidate(22).value);
+  FLAGS_enable_concurrent_prediction = false;
+}
+
 TEST_F(MobilePredictorTest, CallPredictorsForMobilePartialSuggestion) {
   unique_ptr<MobilePredictor> predictor(
       new MobilePredictor(new CheckCandSizePredictor(20),
@@ -349,6 +420,30 @@ TEST_F(PredictorTest, CallPredictForRequet) {
 }
 
 
+TEST_F(PredictorTest, PredictConcurrently) {
+  FLAGS_enable_concurrent_prediction = true;
+  const int suggestions_size =
+      config::ConfigHandler::DefaultConfig().suggestions_size();
+  ASSERT_EQ(3, suggestions_size);
+  unique_ptr<DefaultPredictor> predictor(new DefaultPredictor(
+      new CandidatePredictor({"b", "c", "d"}),
+      new CandidatePredictor({"a", "b"})));
+
+  Segments segments;
+  segments.set_request_type(Segments::PREDICTION);
+  segments.add_segment()->set_key("key");
+  EXPECT_TRUE(predictor->PredictForRequest(*convreq_, &segments));
+  // The duplicated dictionary candidate "b" is dropped.
+  EXPECT_EQ("a,b,c,d", GetCandidateValues(segments));
+
+  segments.Clear();
+  segments.set_request_type(Segments::SUGGESTION);
+  segments.add_segment()->set_key("key");
+  EXPECT_TRUE(predictor->PredictForRequest(*convreq_, &segments));
+  EXPECT_EQ("a,b,c", GetCandidateValues(segments));
+  FLAGS_enable_concurrent_prediction = false;
+}
+
 TEST_F(PredictorTest, DisableAllSuggestion) {
   NullPredictor *predictor1 = new NullPredictor(true);
   NullPredictor *predictor2 = new NullPredictor(true);
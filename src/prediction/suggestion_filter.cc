@@ -53,4 +53,12 @@ bool SuggestionFilter::IsBadSuggestion(const string &text) const {
   return filter_->Exists(Hash::Fingerprint(lower_text));
 }
 
+bool SuggestionFilter::IsBadSuggestionFingerprint(
+    uint64 lower_text_fingerprint) const {
+  if (filter_.get() == nullptr) {
+    return false;
+  }
+  return filter_->Exists(lower_text_fingerprint);
+}
+
 }  // namespace mozc
@@ -48,6 +48,10 @@ class SuggestionFilter {
 
   bool IsBadSuggestion(const string &text) const;
 
+  // Same as IsBadSuggestion() but takes Hash::Fingerprint() of the text that
+  // is already lower-cased by Util::LowerString().
+  bool IsBadSuggestionFingerprint(uint64 lower_text_fingerprint) const;
+
  private:
   std::unique_ptr<mozc::storage::ExistenceFilter> filter_;
 
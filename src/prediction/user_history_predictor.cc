@@ -34,14 +34,19 @@
 #include <climits>
 #include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
+#include "base/allocation_stats.h"
 #include "base/clock.h"
 #include "base/config_file_stream.h"
+#include "base/file_util.h"
 #include "base/flags.h"
 #include "base/hash.h"
 #include "base/logging.h"
 #include "base/mozc_hash_set.h"
 #include "base/thread.h"
+#include "base/trace_events.h"
 #include "base/trie.h"
 #include "base/util.h"
 #include "composer/composer.h"
@@ -65,6 +70,20 @@ DEFINE_bool(enable_expansion_for_user_history_predictor,
             false,
             "enable ambiguity expansion for user_history_predictor.");
 
+DEFINE_bool(enable_user_history_journal,
+            false,
+            "append the changed user history entries to a journal instead "
+            "of rewriting the whole history file on every save.");
+DEFINE_int32(user_history_journal_max_size,
+             256 * 1024,
+             "compact the user history journal into the history file when "
+             "the journal exceeds this size in bytes.");
+DEFINE_int32(user_history_cold_tier_size,
+             0,
+             "keep up to this number of entries evicted from the user "
+             "history in a separate file, which is looked up when the "
+             "history can't fill the suggestions.  0 disables it.");
+
 namespace mozc {
 namespace {
 
@@ -146,6 +165,23 @@ bool IsSentenceLikeCandidate(const Segment::Candidate &candidate) {
 }
 
 // Returns romanaized string.
+// The number of the leading bytes of romanized keys indexed for the roman
+// fuzzy match.  Each element of the index is these bytes packed into uint64.
+const size_t kRomanIndexPrefixSize = sizeof(uint64);
+
+// Packs the first kRomanIndexPrefixSize bytes of |str| into an integer so that
+// the order of the integers matches the lexicographical order of the prefixes.
+uint64 PackRomanPrefix(StringPiece str) {
+  uint64 packed = 0;
+  for (size_t i = 0; i < kRomanIndexPrefixSize; ++i) {
+    packed <<= 8;
+    if (i < str.size()) {
+      packed |= static_cast<uint8>(str[i]);
+    }
+  }
+  return packed;
+}
+
 string ToRoman(const string &str) {
   string result;
   Util::HiraganaToRomanji(str, &result);
@@ -279,7 +315,10 @@ bool UserHistoryPredictor::IsPrivacySensitive(const Segments *segments) const {
 }
 
 UserHistoryStorage::UserHistoryStorage(const string &filename)
-    : storage_(new storage::EncryptedStringStorage(filename)) {
+    : journal_filename_(filename + ".journal"),
+      storage_(new storage::EncryptedStringStorage(filename)),
+      journal_storage_(
+          new storage::EncryptedStringStorage(journal_filename_)) {
 }
 
 UserHistoryStorage::~UserHistoryStorage() {}
@@ -320,6 +359,54 @@ bool UserHistoryStorage::Save() const {
   return true;
 }
 
+bool UserHistoryStorage::AppendToJournal() const {
+  string output;
+  if (!AppendToString(&output)) {
+    LOG(ERROR) << "AppendToString failed";
+    return false;
+  }
+
+  if (!journal_storage_->Append(output)) {
+    LOG(ERROR) << "Can't append user history journal.";
+    return false;
+  }
+
+  return true;
+}
+
+bool UserHistoryStorage::LoadJournal(std::vector<UserHistory> *records) const {
+  DCHECK(records);
+  records->clear();
+  if (!FileUtil::FileExists(journal_filename_)) {
+    return true;
+  }
+
+  std::vector<string> inputs;
+  if (!journal_storage_->LoadRecords(&inputs)) {
+    LOG(ERROR) << "Can't load user history journal.";
+    return false;
+  }
+
+  records->resize(inputs.size());
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    if (!(*records)[i].ParseFromString(inputs[i])) {
+      LOG(WARNING) << "ParseFromString failed. journal looks broken";
+      records->resize(i);
+      break;
+    }
+  }
+
+  VLOG(1) << "Loaded user history journal, size=" << records->size();
+  return true;
+}
+
+void UserHistoryStorage::ClearJournal() const {
+  if (FileUtil::FileExists(journal_filename_) &&
+      !FileUtil::Unlink(journal_filename_)) {
+    LOG(ERROR) << "Can't remove user history journal.";
+  }
+}
+
 UserHistoryPredictor::EntryPriorityQueue::EntryPriorityQueue()
     : pool_(kEntryPoolSize) {}
 
@@ -394,13 +481,33 @@ UserHistoryPredictor::UserHistoryPredictor(
     const POSMatcher *pos_matcher,
     const SuppressionDictionary *suppression_dictionary,
     bool enable_content_word_learning)
+    : UserHistoryPredictor(dictionary, pos_matcher, suppression_dictionary,
+                           enable_content_word_learning,
+                           UserHistoryPredictor::cache_size()) {}
+
+UserHistoryPredictor::UserHistoryPredictor(
+    const DictionaryInterface *dictionary,
+    const POSMatcher *pos_matcher,
+    const SuppressionDictionary *suppression_dictionary,
+    bool enable_content_word_learning,
+    size_t cache_size)
     : dictionary_(dictionary),
       pos_matcher_(pos_matcher),
       suppression_dictionary_(suppression_dictionary),
       predictor_name_("UserHistoryPredictor"),
       content_word_learning_enabled_(enable_content_word_learning),
       updated_(false),
-      dic_(new DicCache(UserHistoryPredictor::cache_size())) {
+      cache_size_(cache_size),
+      dic_(new DicCache(cache_size_)),
+      journal_needs_snapshot_(true),
+      journal_id_(0),
+      journal_size_(0),
+      key_index_dic_(nullptr),
+      key_index_modification_count_(0),
+      roman_index_dic_(nullptr),
+      roman_index_modification_count_(0),
+      cold_tier_clear_unused_(false),
+      cold_tier_updated_(false) {
   AsyncLoad();  // non-blocking
   // Load()  blocking version can be used if any
 }
@@ -415,6 +522,10 @@ string UserHistoryPredictor::GetUserHistoryFileName() {
   return ConfigFileStream::GetFileName(kFileName);
 }
 
+string UserHistoryPredictor::GetColdTierFileName() {
+  return GetUserHistoryFileName() + ".cold";
+}
+
 // Returns revert id
 // static
 uint16 UserHistoryPredictor::revert_id() {
@@ -445,6 +556,30 @@ bool UserHistoryPredictor::CheckSyncerAndDelete() const {
   return true;
 }
 
+bool UserHistoryPredictor::GetMemoryUsage(size_t *num_entries,
+                                          size_t *heap_bytes) const {
+  DCHECK(num_entries);
+  DCHECK(heap_bytes);
+  if (!CheckSyncerAndDelete()) {  // now loading/saving
+    return false;
+  }
+  *num_entries = dic_->Size();
+  *heap_bytes = dic_->GetHeapMemoryUsage() +
+                key_index_.capacity() * sizeof(KeyIndexElement) +
+                roman_index_.capacity() * sizeof(RomanIndexElement);
+  for (const DicElement *elm = dic_->Head(); elm != nullptr; elm = elm->next) {
+    // sizeof(Entry) is already counted as a part of the element.
+    *heap_bytes += elm->value.SpaceUsed() - sizeof(Entry);
+  }
+  for (size_t i = 0; i < demoted_entries_.size(); ++i) {
+    *heap_bytes += demoted_entries_[i].SpaceUsed();
+  }
+  if (cold_tier_) {
+    *heap_bytes += cold_tier_->SpaceUsed();
+  }
+  return true;
+}
+
 bool UserHistoryPredictor::Sync() {
   return AsyncSave();
   // return Save();   blocking version
@@ -494,21 +629,175 @@ bool UserHistoryPredictor::Load() {
     return false;
   }
 
-  for (size_t i = 0; i < history.entries_size(); ++i) {
-    dic_->Insert(EntryFingerprint(history.entries(i)),
-                 history.entries(i));
+  // The entries are saved from the oldest one, so the ones before the last
+  // |cache_size_| entries would be evicted right after the insertion.  The
+  // parsed entries are moved into the cache instead of being copied, which
+  // halves the peak heap usage of loading.
+  const int num_entries = history.entries_size();
+  for (int i = std::max<int>(0, num_entries - cache_size_); i < num_entries;
+       ++i) {
+    InsertParsedEntry(history.mutable_entries(i));
   }
 
   VLOG(1) << "Loaded user histroy, size=" << history.entries_size();
 
+  // Replays the journal on top of the snapshot even when the journal mode is
+  // disabled, so that turning the mode off doesn't lose the recent entries.
+  // The next Save() then writes them into a new snapshot.
+  journal_id_ = history.journal_id();
+  journal_needs_snapshot_ = (journal_id_ == 0);
+  journal_size_ = 0;
+  if (journal_id_ != 0) {
+    std::vector<user_history_predictor::UserHistory> records;
+    history.LoadJournal(&records);
+    for (size_t i = 0; i < records.size(); ++i) {
+      user_history_predictor::UserHistory *record = &records[i];
+      if (record->journal_id() != journal_id_) {
+        // Left by a crash after the snapshot was renewed.
+        continue;
+      }
+      journal_size_ += record->ByteSize();
+      for (size_t j = 0; j < record->erased_entry_fps_size(); ++j) {
+        dic_->Erase(record->erased_entry_fps(j));
+      }
+      for (size_t j = 0; j < record->entries_size(); ++j) {
+        InsertParsedEntry(record->mutable_entries(j));
+      }
+    }
+  }
+
   return true;
 }
 
+bool UserHistoryPredictor::SaveColdTier() {
+  // Entries demoted later are newer, and all of them are newer than the
+  // entries already in the file.
+  std::vector<const Entry *> entries;
+  for (auto it = demoted_entries_.rbegin(); it != demoted_entries_.rend();
+       ++it) {
+    entries.push_back(&*it);
+  }
+  const user_history_predictor::UserHistory &old_tier = GetColdTier();
+  for (size_t i = 0; i < old_tier.entries_size(); ++i) {
+    entries.push_back(&old_tier.entries(i));
+  }
+  std::stable_sort(entries.begin(), entries.end(),
+                   [](const Entry *x, const Entry *y) {
+                     return x->last_access_time() > y->last_access_time();
+                   });
+
+  // Keeps the newest entry for each fingerprint, except for the ones which
+  // are back in |dic_| or cleared.
+  std::vector<const Entry *> kept;
+  std::set<uint32> seen;
+  const size_t max_size =
+      std::max<int32>(0, FLAGS_user_history_cold_tier_size);
+  for (size_t i = 0; i < entries.size() && kept.size() < max_size; ++i) {
+    const uint32 fp = EntryFingerprint(*entries[i]);
+    if (!seen.insert(fp).second || dic_->HasKey(fp) ||
+        IsClearedFromColdTier(*entries[i])) {
+      continue;
+    }
+    kept.push_back(entries[i]);
+  }
+  std::sort(kept.begin(), kept.end(), [](const Entry *x, const Entry *y) {
+    return x->key() < y->key();
+  });
+
+  UserHistoryStorage new_tier(GetColdTierFileName());
+  for (size_t i = 0; i < kept.size(); ++i) {
+    new_tier.add_entries()->CopyFrom(*kept[i]);
+  }
+  bool result = true;
+  if (new_tier.entries_size() == 0) {
+    if (FileUtil::FileExists(GetColdTierFileName()) &&
+        !FileUtil::Unlink(GetColdTierFileName())) {
+      LOG(ERROR) << "Can't remove the user history cold tier.";
+      result = false;
+    }
+  } else if (!new_tier.Save()) {
+    LOG(ERROR) << "Can't save the user history cold tier.";
+    result = false;
+  }
+
+  // |kept| refers to the old entries, which are released here.
+  cold_tier_.reset(new user_history_predictor::UserHistory);
+  cold_tier_->Swap(&new_tier);
+  demoted_entries_.clear();
+  cold_tier_erased_fps_.clear();
+  cold_tier_clear_unused_ = false;
+  cold_tier_updated_ = false;
+  return result;
+}
+
+const user_history_predictor::UserHistory &
+UserHistoryPredictor::GetColdTier() const {
+  if (cold_tier_) {
+    return *cold_tier_;
+  }
+  cold_tier_.reset(new user_history_predictor::UserHistory);
+  if (!FileUtil::FileExists(GetColdTierFileName())) {
+    return *cold_tier_;
+  }
+  UserHistoryStorage storage(GetColdTierFileName());
+  if (!storage.Load()) {
+    LOG(ERROR) << "Can't load the user history cold tier.";
+    return *cold_tier_;
+  }
+  cold_tier_->Swap(&storage);
+  const auto &entries = cold_tier_->entries();
+  if (!std::is_sorted(entries.begin(), entries.end(),
+                      [](const Entry &x, const Entry &y) {
+                        return x.key() < y.key();
+                      })) {
+    LOG(WARNING) << "The user history cold tier is not sorted.";
+    cold_tier_->clear_entries();
+  }
+  return *cold_tier_;
+}
+
+bool UserHistoryPredictor::IsClearedFromColdTier(const Entry &entry) const {
+  return (cold_tier_clear_unused_ && entry.suggestion_freq() == 0) ||
+         cold_tier_erased_fps_.count(EntryFingerprint(entry)) > 0;
+}
+
+UserHistoryPredictor::DicElement *UserHistoryPredictor::InsertToDic(
+    uint32 dic_key) {
+  const bool is_new_key = !dic_->HasKey(dic_key);
+  const DicElement *tail = dic_->Tail();
+  if (FLAGS_user_history_cold_tier_size > 0 && is_new_key &&
+      tail != nullptr && dic_->Size() >= cache_size_ &&
+      !tail->value.key().empty() && !tail->value.removed()) {
+    // The links to the other entries are dropped, as most of them are
+    // evicted as well.
+    demoted_entries_.push_back(tail->value);
+    demoted_entries_.back().clear_next_entries();
+    cold_tier_updated_ = true;
+  }
+  DicElement *elm = dic_->Insert(dic_key);
+  if (elm != nullptr && is_new_key) {
+    // The element may be recycled from the evicted entry.
+    elm->value.Clear();
+  }
+  return elm;
+}
+
+void UserHistoryPredictor::InsertParsedEntry(Entry *entry) {
+  DicElement *elm = dic_->Insert(EntryFingerprint(*entry));
+  if (elm != nullptr) {
+    elm->value.Swap(entry);
+  }
+}
+
 bool UserHistoryPredictor::Save() {
   if (!updated_) {
     return true;
   }
 
+  if (cold_tier_updated_) {
+    SaveColdTier();
+  }
+
   // Do not check incognito_mode or use_history_suggest in Config here.
   // The input data should not have been inserted when those flags are on.
 
@@ -519,11 +808,50 @@ bool UserHistoryPredictor::Save() {
 
   const string filename = GetUserHistoryFileName();
 
+  // In the journal mode, only the entries changed since the last save are
+  // appended to the journal, in the LRU order so that replaying them restores
+  // the order.  The journal is compacted into a new snapshot once it grows
+  // past --user_history_journal_max_size.
+  if (FLAGS_enable_user_history_journal && !journal_needs_snapshot_ &&
+      journal_size_ <
+          static_cast<size_t>(FLAGS_user_history_journal_max_size)) {
+    UserHistoryStorage delta(filename);
+    delta.set_journal_id(journal_id_);
+    for (const DicElement *elm = tail; elm != nullptr; elm = elm->prev) {
+      if (journal_updated_fps_.count(elm->key) > 0) {
+        delta.add_entries()->CopyFrom(elm->value);
+      }
+    }
+    for (std::set<uint32>::const_iterator it = journal_erased_fps_.begin();
+         it != journal_erased_fps_.end(); ++it) {
+      if (dic_->LookupWithoutInsert(*it) == nullptr) {
+        delta.add_erased_entry_fps(*it);
+      }
+    }
+    if (delta.AppendToJournal()) {
+      journal_size_ += delta.ByteSize();
+      journal_updated_fps_.clear();
+      journal_erased_fps_.clear();
+      updated_ = false;
+      return true;
+    }
+    LOG(WARNING) << "Falls back to saving the whole user history";
+  }
+
   UserHistoryStorage history(filename);
   for (const DicElement *elm = tail; elm != nullptr; elm = elm->prev) {
     history.add_entries()->CopyFrom(elm->value);
   }
 
+  uint64 journal_id = 0;
+  if (FLAGS_enable_user_history_journal) {
+    while (journal_id == 0) {
+      Util::GetRandomSequence(reinterpret_cast<char *>(&journal_id),
+                              sizeof(journal_id));
+    }
+    history.set_journal_id(journal_id);
+  }
+
   // Updates usage stats here.
   UsageStats::SetInteger(
       "UserHistoryPredictorEntrySize",
@@ -534,6 +862,15 @@ bool UserHistoryPredictor::Save() {
     return false;
   }
 
+  // The records of the old journal are stale even if the removal fails, as
+  // their id doesn't match the new snapshot.
+  history.ClearJournal();
+  journal_id_ = journal_id;
+  journal_needs_snapshot_ = (journal_id == 0);
+  journal_size_ = 0;
+  journal_updated_fps_.clear();
+  journal_erased_fps_.clear();
+
   updated_ = false;
 
   return true;
@@ -546,7 +883,21 @@ bool UserHistoryPredictor::ClearAllHistory() {
   VLOG(1) << "Clearing user prediction";
   // Renews DicCache as LRUCache tries to reuse the internal value by
   // using FreeList
-  dic_.reset(new DicCache(UserHistoryPredictor::cache_size()));
+  dic_.reset(new DicCache(cache_size_));
+  // The new cache may be allocated at the same address.
+  key_index_dic_ = nullptr;
+  roman_index_dic_ = nullptr;
+  journal_needs_snapshot_ = true;
+
+  demoted_entries_.clear();
+  cold_tier_erased_fps_.clear();
+  cold_tier_clear_unused_ = false;
+  cold_tier_updated_ = false;
+  cold_tier_.reset(new user_history_predictor::UserHistory);
+  if (FileUtil::FileExists(GetColdTierFileName()) &&
+      !FileUtil::Unlink(GetColdTierFileName())) {
+    LOG(ERROR) << "Can't remove the user history cold tier.";
+  }
 
   // insert a dummy event entry.
   InsertEvent(Entry::CLEAN_ALL_EVENT);
@@ -586,6 +937,11 @@ bool UserHistoryPredictor::ClearUnusedHistory() {
 
   // Inserts a dummy event entry.
   InsertEvent(Entry::CLEAN_UNUSED_EVENT);
+  journal_needs_snapshot_ = true;
+  if (FLAGS_user_history_cold_tier_size > 0) {
+    cold_tier_clear_unused_ = true;
+    cold_tier_updated_ = true;
+  }
 
   updated_ = true;
 
@@ -732,7 +1088,29 @@ bool UserHistoryPredictor::ClearHistoryEntry(const string &key,
       }
     }
   }
+  if (FLAGS_user_history_cold_tier_size > 0) {
+    // The entry may also be in the cold tier, where it is erased entirely as
+    // the cold tier doesn't keep the links to the entry.
+    const uint32 fp = Fingerprint(key, value);
+    const auto &entries = GetColdTier().entries();
+    const bool in_cold_tier =
+        std::any_of(entries.begin(), entries.end(),
+                    [fp](const Entry &entry) {
+                      return EntryFingerprint(entry) == fp;
+                    }) ||
+        std::any_of(demoted_entries_.begin(), demoted_entries_.end(),
+                    [fp](const Entry &entry) {
+                      return EntryFingerprint(entry) == fp;
+                    });
+    if (in_cold_tier && cold_tier_erased_fps_.insert(fp).second) {
+      cold_tier_updated_ = true;
+      deleted = true;
+    }
+  }
   if (deleted) {
+    // Rewrites the snapshot so that the deleted entry doesn't remain in the
+    // journal.
+    journal_needs_snapshot_ = true;
     updated_ = true;
   }
   return deleted;
@@ -1181,6 +1559,8 @@ bool UserHistoryPredictor::Predict(Segments *segments) const {
 
 bool UserHistoryPredictor::PredictForRequest(const ConversionRequest &request,
                                              Segments *segments) const {
+  MOZC_TRACE_SCOPE("UserHistoryPredictor::Predict");
+  ScopedAllocationStage allocation_stage(AllocationStats::PREDICTOR);
   if (!CheckSyncerAndDelete()) {
     LOG(WARNING) << "Syncer is running";
     return false;
@@ -1330,32 +1710,270 @@ void UserHistoryPredictor::GetResultsFromHistoryDictionary(
   unique_ptr<Trie<string>> expanded;
   GetInputKeyFromSegments(request, segments, &input_key, &base_key, &expanded);
 
-  int trial = 0;
-  for (const DicElement *elm = dic_->Head(); elm != nullptr; elm = elm->next) {
-    if (!IsValidEntryIgnoringRemovedField(
-            elm->value, request.request().available_emoji_carrier())) {
-      continue;
-    }
-    if (segments.request_type() == Segments::SUGGESTION &&
-        trial++ >= kMaxSuggestionTrial) {
-      VLOG(2) << "too many trials";
-      break;
-    }
-
+  // Looks up an element and returns false if enough results are found.
+  const auto lookup = [&](const DicElement *elm) {
     // Lookup key from elm_value and prev_entry.
     // If a new entry is found, the entry is pushed to the results.
     // TODO(team): make KanaFuzzyLookupEntry().
     if (!LookupEntry(request_type, input_key, base_key, expanded.get(),
                      &(elm->value), prev_entry, results) &&
         !RomanFuzzyLookupEntry(roman_input_key, &(elm->value), results)) {
+      return true;
+    }
+    // already found enough results.
+    return results->size() < max_results_size;
+  };
+
+  std::vector<std::pair<size_t, const DicElement *>> elements;
+  if (GetCandidateElements(base_key, expanded.get(), roman_input_key,
+                           &elements)) {
+    // Only the entries that may match are visited in the LRU order.  The
+    // number of trials is approximated by the position in the LRU list.
+    for (const auto &rank_and_element : elements) {
+      if (!IsValidEntryIgnoringRemovedField(
+              rank_and_element.second->value,
+              request.request().available_emoji_carrier())) {
+        continue;
+      }
+      if (segments.request_type() == Segments::SUGGESTION &&
+          rank_and_element.first >= kMaxSuggestionTrial) {
+        VLOG(2) << "too many trials";
+        break;
+      }
+      if (!lookup(rank_and_element.second)) {
+        break;
+      }
+    }
+  } else {
+    int trial = 0;
+    for (const DicElement *elm = dic_->Head(); elm != nullptr;
+         elm = elm->next) {
+      if (!IsValidEntryIgnoringRemovedField(
+              elm->value, request.request().available_emoji_carrier())) {
+        continue;
+      }
+      if (segments.request_type() == Segments::SUGGESTION &&
+          trial++ >= kMaxSuggestionTrial) {
+        VLOG(2) << "too many trials";
+        break;
+      }
+      if (!lookup(elm)) {
+        break;
+      }
+    }
+  }
+
+  if (FLAGS_user_history_cold_tier_size > 0 &&
+      results->size() < segments.max_prediction_candidates_size()) {
+    GetResultsFromColdTier(request_type, request, input_key, base_key,
+                           expanded.get(), prev_entry, results);
+  }
+}
+
+void UserHistoryPredictor::GetResultsFromColdTier(
+    RequestType request_type,
+    const ConversionRequest &request,
+    const string &input_key,
+    const string &key_base,
+    const Trie<string> *key_expanded,
+    const Entry *prev_entry,
+    EntryPriorityQueue *results) const {
+  // Zero query suggestion relies on the links between the entries, which
+  // the cold tier doesn't keep.
+  if (key_base.empty()) {
+    return;
+  }
+  const uint32 available_emoji_carrier =
+      request.request().available_emoji_carrier();
+  size_t trial = 0;
+  const auto lookup = [&](const Entry &entry) {
+    if (dic_->HasKey(EntryFingerprint(entry)) ||
+        IsClearedFromColdTier(entry) ||
+        !IsValidEntryIgnoringRemovedField(entry, available_emoji_carrier)) {
+      return;
+    }
+    LookupEntry(request_type, input_key, key_base, key_expanded, &entry,
+                prev_entry, results);
+  };
+
+  // The entries demoted since the last save are not in |cold_tier_| yet.
+  for (size_t i = 0; i < demoted_entries_.size() &&
+                     trial < kMaxSuggestionTrial; ++i, ++trial) {
+    if (Util::StartsWith(demoted_entries_[i].key(), key_base)) {
+      lookup(demoted_entries_[i]);
+    }
+  }
+
+  const auto &entries = GetColdTier().entries();
+  auto it = std::lower_bound(entries.begin(), entries.end(), key_base,
+                             [](const Entry &entry, const string &key) {
+                               return entry.key() < key;
+                             });
+  for (; it != entries.end() && trial < kMaxSuggestionTrial &&
+         Util::StartsWith(it->key(), key_base); ++it, ++trial) {
+    lookup(*it);
+  }
+}
+
+void UserHistoryPredictor::MaybeRebuildKeyIndex() const {
+  if (key_index_dic_ == dic_.get() &&
+      key_index_modification_count_ == dic_->modification_count()) {
+    return;
+  }
+  key_index_.clear();
+  size_t lru_rank = 0;
+  for (const DicElement *elm = dic_->Head(); elm != nullptr;
+       elm = elm->next, ++lru_rank) {
+    if (elm->value.key().empty()) {
+      // Event entries never match by key.
       continue;
     }
+    key_index_.push_back(
+        KeyIndexElement{elm->value.key(), lru_rank, elm});
+  }
+  std::sort(key_index_.begin(), key_index_.end(),
+            [](const KeyIndexElement &x, const KeyIndexElement &y) {
+              return x.key < y.key;
+            });
+  key_index_dic_ = dic_.get();
+  key_index_modification_count_ = dic_->modification_count();
+}
 
-    // already found enough results.
-    if (results->size() >= max_results_size) {
-      break;
+void UserHistoryPredictor::MaybeRebuildRomanIndex() const {
+  if (roman_index_dic_ == dic_.get() &&
+      roman_index_modification_count_ == dic_->modification_count()) {
+    return;
+  }
+  roman_index_.clear();
+  size_t lru_rank = 0;
+  for (const DicElement *elm = dic_->Head(); elm != nullptr;
+       elm = elm->next, ++lru_rank) {
+    if (elm->value.key().empty()) {
+      continue;
+    }
+    // RomanFuzzyPrefixMatch() allows one deletion from the entry.  Deleting a
+    // byte beyond the indexed ones leaves the indexed prefix as is.
+    const string roman = ToRoman(elm->value.key());
+    const StringPiece head(roman.data(),
+                           std::min(roman.size(), kRomanIndexPrefixSize + 1));
+    roman_index_.push_back(
+        RomanIndexElement{PackRomanPrefix(head), lru_rank, elm});
+    for (size_t i = 0; i < head.size(); ++i) {
+      const string deleted =
+          head.substr(0, i).as_string() + head.substr(i + 1).as_string();
+      roman_index_.push_back(
+          RomanIndexElement{PackRomanPrefix(deleted), lru_rank, elm});
+    }
+  }
+  std::sort(roman_index_.begin(), roman_index_.end(),
+            [](const RomanIndexElement &x, const RomanIndexElement &y) {
+              return x.packed_prefix < y.packed_prefix;
+            });
+  roman_index_dic_ = dic_.get();
+  roman_index_modification_count_ = dic_->modification_count();
+}
+
+void UserHistoryPredictor::GetRomanFuzzyCandidateElements(
+    const string &roman_input_key,
+    std::vector<std::pair<size_t, const DicElement *>> *elements) const {
+  MaybeRebuildRomanIndex();
+
+  // A matching key starts with the input after deleting one of its bytes, or
+  // starts with the input where one edit of the input is applied.  Edits
+  // beyond the indexed bytes don't change the prefix to look up.
+  std::vector<string> queries;
+  queries.push_back(roman_input_key);
+  for (size_t i = 0;
+       i < roman_input_key.size() && i < kRomanIndexPrefixSize; ++i) {
+    if (i + 1 < roman_input_key.size() &&
+        roman_input_key[i] != roman_input_key[i + 1]) {
+      string swapped = roman_input_key;
+      std::swap(swapped[i], swapped[i + 1]);
+      queries.push_back(swapped);
+    }
+    if (!isalnum(roman_input_key[i])) {
+      // The voice sound mark '-' matches any non-alphanumeric character.
+      string replaced = roman_input_key;
+      replaced[i] = '-';
+      queries.push_back(replaced);
+    }
+  }
+
+  for (const string &query : queries) {
+    const size_t size = std::min(query.size(), kRomanIndexPrefixSize);
+    const uint64 begin = PackRomanPrefix(query.substr(0, size));
+    const uint64 end =
+        size == kRomanIndexPrefixSize
+            ? begin
+            : begin | ((static_cast<uint64>(1) <<
+                        (8 * (kRomanIndexPrefixSize - size))) - 1);
+    for (auto iter = std::lower_bound(
+             roman_index_.begin(), roman_index_.end(), begin,
+             [](const RomanIndexElement &x, uint64 packed) {
+               return x.packed_prefix < packed;
+             });
+         iter != roman_index_.end() && iter->packed_prefix <= end; ++iter) {
+      elements->push_back(std::make_pair(iter->lru_rank, iter->element));
+    }
+  }
+}
+
+bool UserHistoryPredictor::GetCandidateElements(
+    const string &key_base, const Trie<string> *key_expanded,
+    const string &roman_input_key,
+    std::vector<std::pair<size_t, const DicElement *>> *elements) const {
+  DCHECK(elements);
+  std::vector<string> prefixes;
+  if (!key_base.empty()) {
+    prefixes.push_back(key_base);
+  } else if (key_expanded != nullptr) {
+    // The expanded keys are stored as values of the trie.
+    key_expanded->LookUpPredictiveAll("", &prefixes);
+    for (const string &prefix : prefixes) {
+      if (prefix.empty()) {
+        return false;
+      }
     }
+  } else {
+    // Zero query suggestion matches every entry.
+    return false;
   }
+
+  MaybeRebuildKeyIndex();
+  const auto key_less = [](const KeyIndexElement &x, StringPiece key) {
+    return x.key < key;
+  };
+  const auto add_element = [elements](const KeyIndexElement &x) {
+    elements->push_back(std::make_pair(x.lru_rank, x.element));
+  };
+
+  // Keys starting with one of the prefixes.
+  for (const string &prefix : prefixes) {
+    for (auto iter = std::lower_bound(key_index_.begin(), key_index_.end(),
+                                      StringPiece(prefix), key_less);
+         iter != key_index_.end() && Util::StartsWith(iter->key, prefix);
+         ++iter) {
+      add_element(*iter);
+    }
+  }
+  // Keys that are proper prefixes of |key_base|.
+  for (size_t len = 1; len < key_base.size(); ++len) {
+    const StringPiece key(key_base.data(), len);
+    for (auto iter = std::lower_bound(key_index_.begin(), key_index_.end(),
+                                      key, key_less);
+         iter != key_index_.end() && iter->key == key; ++iter) {
+      add_element(*iter);
+    }
+  }
+  if (!roman_input_key.empty()) {
+    GetRomanFuzzyCandidateElements(roman_input_key, elements);
+  }
+
+  // Expanded prefixes and fuzzy matches may overlap.
+  std::sort(elements->begin(), elements->end());
+  elements->erase(std::unique(elements->begin(), elements->end()),
+                  elements->end());
+  return true;
 }
 
 // static
@@ -1564,12 +2182,14 @@ void UserHistoryPredictor::InsertEvent(EntryType type) {
   const uint32 dic_key = Fingerprint("", "", type);
 
   CHECK(dic_.get());
-  DicElement *e = dic_->Insert(dic_key);
+  DicElement *e = InsertToDic(dic_key);
   if (e == nullptr) {
     VLOG(2) << "insert failed";
     return;
   }
 
+  journal_updated_fps_.insert(dic_key);
+
   Entry *entry = &(e->value);
   DCHECK(entry);
   entry->Clear();
@@ -1627,12 +2247,14 @@ void UserHistoryPredictor::Insert(const string &key,
     // add a treatment for UPDATE_ENTRY mode
   }
 
-  DicElement *e = dic_->Insert(dic_key);
+  DicElement *e = InsertToDic(dic_key);
   if (e == nullptr) {
     VLOG(2) << "insert failed";
     return;
   }
 
+  journal_updated_fps_.insert(dic_key);
+
   Entry *entry = &(e->value);
   DCHECK(entry);
 
@@ -1941,8 +2563,9 @@ void UserHistoryPredictor::InsertHistory(RequestType request_type,
          Util::CharsLen(conversion_segment.value) > 1)) {
       return;
     }
-    Entry *history_entry = dic_->MutableLookupWithoutInsert(
-        LearningSegmentFingerprint(history_segment));
+    const uint32 history_fp = LearningSegmentFingerprint(history_segment);
+    Entry *history_entry = dic_->MutableLookupWithoutInsert(history_fp);
+    journal_updated_fps_.insert(history_fp);
     NextEntry next_entry;
     if (segments->request_type() == Segments::CONVERSION) {
       next_entry.set_entry_fp(LearningSegmentFingerprint(conversion_segment));
@@ -1971,8 +2594,11 @@ void UserHistoryPredictor::Revert(Segments *segments) {
         segments->revert_entry(i);
     if (revert_entry.id == UserHistoryPredictor::revert_id() &&
         revert_entry.revert_entry_type == Segments::RevertEntry::CREATE_ENTRY) {
-      VLOG(2) << "Erasing the key: " << StringToUint32(revert_entry.key);
-      dic_->Erase(StringToUint32(revert_entry.key));
+      const uint32 dic_key = StringToUint32(revert_entry.key);
+      VLOG(2) << "Erasing the key: " << dic_key;
+      dic_->Erase(dic_key);
+      journal_updated_fps_.erase(dic_key);
+      journal_erased_fps_.insert(dic_key);
     }
   }
 }
@@ -2069,7 +2695,11 @@ uint32 UserHistoryPredictor::Fingerprint(const string &key,
     // Since we have already used the fingerprint function for next entries and
     // next entries are saved in user's local machine, we are not able
     // to change the Fingerprint function for the old key/value type.
-    return Hash::Fingerprint32(key + kDelimiter + value);
+    Hash::Fingerprinter fp;
+    fp.Append(key);
+    fp.Append(kDelimiter);
+    fp.Append(value);
+    return fp.Fingerprint32();
   } else {
     return Hash::Fingerprint32(static_cast<uint8>(type));
   }
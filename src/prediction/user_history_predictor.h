@@ -72,8 +72,20 @@ class UserHistoryStorage : public mozc::user_history_predictor::UserHistory {
   // Saves history into encrypted file.
   bool Save() const;
 
+  // Appends history to the journal file next to the snapshot as one delta
+  // record.
+  bool AppendToJournal() const;
+
+  // Loads the delta records appended by AppendToJournal() in order.
+  bool LoadJournal(std::vector<UserHistory> *records) const;
+
+  // Removes the journal file, e.g. after a new snapshot is saved.
+  void ClearJournal() const;
+
  private:
+  const string journal_filename_;
   std::unique_ptr<storage::StringStorageInterface> storage_;
+  std::unique_ptr<storage::StringStorageInterface> journal_storage_;
 };
 
 // UserHistoryPredictor is NOT thread safe.
@@ -88,12 +100,25 @@ class UserHistoryPredictor : public PredictorInterface {
       const dictionary::POSMatcher *pos_matcher,
       const dictionary::SuppressionDictionary *suppression_dictionary,
       bool enable_content_word_learning);
+  // Limits the number of history entries to |cache_size| instead of
+  // cache_size().  Entries beyond the limit are evicted on load.
+  UserHistoryPredictor(
+      const dictionary::DictionaryInterface *dictionary,
+      const dictionary::POSMatcher *pos_matcher,
+      const dictionary::SuppressionDictionary *suppression_dictionary,
+      bool enable_content_word_learning,
+      size_t cache_size);
   ~UserHistoryPredictor() override;
 
   void set_content_word_learning_enabled(bool value) {
     content_word_learning_enabled_ = value;
   }
 
+  // Returns the number of entries in the history and the estimated size of
+  // the memory they use, in bytes.  Returns false while the history is being
+  // loaded or saved.
+  bool GetMemoryUsage(size_t *num_entries, size_t *heap_bytes) const;
+
   bool Predict(Segments *segments) const;
   bool PredictForRequest(const ConversionRequest &request,
                          Segments *segments) const override;
@@ -127,6 +152,9 @@ class UserHistoryPredictor : public PredictorInterface {
   // Gets user history filename.
   static string GetUserHistoryFileName();
 
+  // Returns the file name of the cold tier (--user_history_cold_tier_size).
+  static string GetColdTierFileName();
+
   const string &GetPredictorName() const override { return predictor_name_; }
 
   // From user_history_predictor.proto
@@ -141,7 +169,7 @@ class UserHistoryPredictor : public PredictorInterface {
   static uint32 EntryFingerprint(const Entry &entry);
   static uint32 SegmentFingerprint(const Segment &segment);
 
-  // Returns the size of cache.
+  // Returns the default size of cache.
   static uint32 cache_size();
 
   // Returns the size of next entries.
@@ -244,6 +272,11 @@ class UserHistoryPredictor : public PredictorInterface {
   FRIEND_TEST(UserHistoryPredictorTest, MaybeRomanMisspelledKey);
   FRIEND_TEST(UserHistoryPredictorTest, GetRomanMisspelledKey);
   FRIEND_TEST(UserHistoryPredictorTest, RomanFuzzyLookupEntry);
+  FRIEND_TEST(UserHistoryPredictorTest, GetCandidateElements);
+  FRIEND_TEST(UserHistoryPredictorTest, RomanFuzzyIndexLongKeys);
+  FRIEND_TEST(UserHistoryPredictorTest, JournalSaveAndLoad);
+  FRIEND_TEST(UserHistoryPredictorTest, LoadKeepsMostRecentEntries);
+  FRIEND_TEST(UserHistoryPredictorTest, ColdTier);
   FRIEND_TEST(UserHistoryPredictorTest, ExpandedLookupRoman);
   FRIEND_TEST(UserHistoryPredictorTest, ExpandedLookupKana);
   FRIEND_TEST(UserHistoryPredictorTest, GetMatchTypeFromInputRoman);
@@ -386,6 +419,37 @@ class UserHistoryPredictor : public PredictorInterface {
 
   bool CheckSyncerAndDelete() const;
 
+  // Moves |entry| parsed from the history file into |dic_| as the newest
+  // entry.  |entry| is left with unspecified contents.
+  void InsertParsedEntry(Entry *entry);
+
+  // Inserts |dic_key| into |dic_| like DicCache::Insert(), except that the
+  // value of a new key is always cleared.  If the insertion evicts the least
+  // recently used entry, the entry is demoted to the cold tier when it is
+  // enabled.
+  DicElement *InsertToDic(uint32 dic_key);
+
+  // Returns the cold tier entries sorted by key, loading them from the file
+  // on the first call.
+  const user_history_predictor::UserHistory &GetColdTier() const;
+
+  // Returns true if the cold tier entry |entry| has been cleared since the
+  // cold tier was last saved.
+  bool IsClearedFromColdTier(const Entry &entry) const;
+
+  // Looks up the cold tier entries whose keys start with |key_base| and adds
+  // the matching ones to |results| like GetResultsFromHistoryDictionary().
+  void GetResultsFromColdTier(RequestType request_type,
+                              const ConversionRequest &request,
+                              const string &input_key,
+                              const string &key_base,
+                              const Trie<string> *key_expanded,
+                              const Entry *prev_entry,
+                              EntryPriorityQueue *results) const;
+
+  // Merges the demoted entries into the cold tier file.
+  bool SaveColdTier();
+
   // If |entry| is the target of prediction,
   // create a new result and insert it to |results|.
   // Can set |prev_entry| if there is a history segment just before |input_key|.
@@ -432,6 +496,31 @@ class UserHistoryPredictor : public PredictorInterface {
       const Entry *prev_entry,
       EntryPriorityQueue *results) const;
 
+  // Rebuilds |key_index_| if |dic_| has been modified since the last build.
+  void MaybeRebuildKeyIndex() const;
+
+  // Rebuilds |roman_index_| if |dic_| has been modified since the last build.
+  void MaybeRebuildRomanIndex() const;
+
+  // Appends the elements of |dic_| whose romanized keys may match
+  // |roman_input_key| by RomanFuzzyPrefixMatch() to |elements|.  The result
+  // is a superset of the actual matches.
+  void GetRomanFuzzyCandidateElements(
+      const string &roman_input_key,
+      std::vector<std::pair<size_t, const DicElement *>> *elements) const;
+
+  // Collects the elements of |dic_| whose keys may match the input, i.e., keys
+  // starting with |key_base| (or with one of |key_expanded| if |key_base| is
+  // empty), keys that are prefixes of |key_base| and, if |roman_input_key| is
+  // not empty, keys that may match it by the roman fuzzy match.  The elements
+  // are sorted in the LRU order and paired with their positions in the LRU
+  // list.  Returns false for zero query suggestion, where all the entries are
+  // targets.
+  bool GetCandidateElements(
+      const string &key_base, const Trie<string> *key_expanded,
+      const string &roman_input_key,
+      std::vector<std::pair<size_t, const DicElement *>> *elements) const;
+
   // Gets input data from segments.
   // These input data include ambiguities.
   static void GetInputKeyFromSegments(
@@ -533,8 +622,60 @@ class UserHistoryPredictor : public PredictorInterface {
 
   bool content_word_learning_enabled_;
   bool updated_;
+  const size_t cache_size_;
   std::unique_ptr<DicCache> dic_;
   mutable std::unique_ptr<UserHistoryPredictorSyncer> syncer_;
+
+  // States of the journal mode (--enable_user_history_journal), where Save()
+  // appends the entries changed since the last save to the journal instead of
+  // rewriting the snapshot.  |journal_id_| is the id of the loaded or saved
+  // snapshot, and |journal_size_| is the total size of its journal records.
+  // |journal_needs_snapshot_| forces the next Save() to write a snapshot,
+  // e.g. after entries are cleared so that they don't remain in the journal.
+  std::set<uint32> journal_updated_fps_;
+  std::set<uint32> journal_erased_fps_;
+  bool journal_needs_snapshot_;
+  uint64 journal_id_;
+  size_t journal_size_;
+
+  // Elements of |dic_| sorted by key, used to find the entries matching the
+  // input without scanning the whole LRU list.  The index is rebuilt lazily
+  // when |dic_| or its modification count differs from the one it was built
+  // from.
+  struct KeyIndexElement {
+    StringPiece key;
+    size_t lru_rank;  // Position in the LRU list.
+    const DicElement *element;
+  };
+  mutable std::vector<KeyIndexElement> key_index_;
+  mutable const DicCache *key_index_dic_;
+  mutable uint64 key_index_modification_count_;
+
+  // Deletion neighborhood of the romanized keys for the roman fuzzy match.
+  // For each element, the first bytes of its romanized key and the strings
+  // made by deleting one of the first bytes from it are packed into integers
+  // and sorted, so that an input prefix or its swapped variants find the
+  // candidates by range lookups.  Built only when the roman fuzzy match is
+  // used, and rebuilt in the same way as |key_index_|.
+  struct RomanIndexElement {
+    uint64 packed_prefix;
+    size_t lru_rank;
+    const DicElement *element;
+  };
+  mutable std::vector<RomanIndexElement> roman_index_;
+  mutable const DicCache *roman_index_dic_;
+  mutable uint64 roman_index_modification_count_;
+
+  // States of the cold tier (--user_history_cold_tier_size), which keeps the
+  // entries evicted from |dic_| in a separate file.  The file is read only
+  // when the entries in |dic_| can't fill the suggestions, and then
+  // |cold_tier_| caches its entries sorted by key.  The demoted entries and
+  // the clear requests are applied to the file by the next Save().
+  std::vector<Entry> demoted_entries_;
+  std::set<uint32> cold_tier_erased_fps_;
+  bool cold_tier_clear_unused_;
+  bool cold_tier_updated_;
+  mutable std::unique_ptr<user_history_predictor::UserHistory> cold_tier_;
 };
 
 }  // namespace mozc
@@ -56,6 +56,8 @@
 #include "usage_stats/usage_stats_testing_util.h"
 
 DECLARE_bool(enable_expansion_for_user_history_predictor);
+DECLARE_bool(enable_user_history_journal);
+DECLARE_int32(user_history_cold_tier_size);
 
 namespace mozc {
 namespace {
@@ -156,11 +158,15 @@ bool FindCandidateByValue(const string &value, const Segments &segments) {
 class UserHistoryPredictorTest : public ::testing::Test {
  public:
   UserHistoryPredictorTest()
-      : default_expansion_(FLAGS_enable_expansion_for_user_history_predictor) {
+      : default_expansion_(FLAGS_enable_expansion_for_user_history_predictor),
+        default_journal_(FLAGS_enable_user_history_journal),
+        default_cold_tier_size_(FLAGS_user_history_cold_tier_size) {
   }
 
   ~UserHistoryPredictorTest() override {
     FLAGS_enable_expansion_for_user_history_predictor = default_expansion_;
+    FLAGS_enable_user_history_journal = default_journal_;
+    FLAGS_user_history_cold_tier_size = default_cold_tier_size_;
   }
 
  protected:
@@ -181,6 +187,8 @@ class UserHistoryPredictorTest : public ::testing::Test {
 
   void TearDown() override {
     FLAGS_enable_expansion_for_user_history_predictor = default_expansion_;
+    FLAGS_enable_user_history_journal = default_journal_;
+    FLAGS_user_history_cold_tier_size = default_cold_tier_size_;
 
     mozc::usage_stats::UsageStats::ClearAllStatsForTest();
   }
@@ -340,6 +348,8 @@ class UserHistoryPredictorTest : public ::testing::Test {
   }
 
   const bool default_expansion_;
+  const bool default_journal_;
+  const int32 default_cold_tier_size_;
   unique_ptr<DataAndPredictor> data_and_predictor_;
   mozc::usage_stats::scoped_usage_stats_enabler usage_stats_enabler_;
 };
@@ -2234,6 +2244,138 @@ TEST_F(UserHistoryPredictorTest, UserHistoryStorage) {
   FileUtil::Unlink(filename);
 }
 
+TEST_F(UserHistoryPredictorTest, JournalSaveAndLoad) {
+  FLAGS_enable_user_history_journal = true;
+  // Clearing the history writes a snapshot on which the journal is based.
+  UserHistoryPredictor *predictor = GetUserHistoryPredictorWithClearedHistory();
+  EXPECT_NE(0, predictor->journal_id_);
+  EXPECT_EQ(0, predictor->journal_size_);
+
+  Segments segments;
+  MakeSegmentsForConversion("わたしのなまえはなかのです", &segments);
+  AddCandidate("私の名前は中野です", &segments);
+  predictor->Finish(*convreq_, &segments);
+  EXPECT_TRUE(predictor->Save());
+  EXPECT_LT(0, predictor->journal_size_);
+
+  segments.Clear();
+  MakeSegmentsForConversion("こんにちは", &segments);
+  AddCandidate("今日は", &segments);
+  predictor->Finish(*convreq_, &segments);
+  predictor->Revert(&segments);
+  segments.Clear();
+  MakeSegmentsForConversion("ぐーぐる", &segments);
+  AddCandidate("グーグル", &segments);
+  predictor->Finish(*convreq_, &segments);
+  EXPECT_TRUE(predictor->Save());
+
+  // Reloads the snapshot and replays the journal.
+  predictor->dic_->Clear();
+  EXPECT_TRUE(predictor->Load());
+  EXPECT_TRUE(IsSuggested(predictor, "わたしの", "私の名前は中野です"));
+  EXPECT_TRUE(IsSuggested(predictor, "ぐーぐ", "グーグル"));
+  EXPECT_FALSE(IsSuggested(predictor, "こんにち", "今日は"));
+
+  // Saving without the journal mode compacts the journal into the snapshot.
+  FLAGS_enable_user_history_journal = false;
+  predictor->updated_ = true;
+  EXPECT_TRUE(predictor->Save());
+  EXPECT_EQ(0, predictor->journal_id_);
+  EXPECT_FALSE(FileUtil::FileExists(
+      predictor->GetUserHistoryFileName() + ".journal"));
+  predictor->dic_->Clear();
+  EXPECT_TRUE(predictor->Load());
+  EXPECT_TRUE(IsSuggested(predictor, "わたしの", "私の名前は中野です"));
+  EXPECT_TRUE(IsSuggested(predictor, "ぐーぐ", "グーグル"));
+}
+
+TEST_F(UserHistoryPredictorTest, LoadKeepsMostRecentEntries) {
+  UserHistoryPredictor *predictor = GetUserHistoryPredictorWithClearedHistory();
+  const char *kEntries[][2] = {
+      {"かいぎしつ", "会議室"},
+      {"かいぎちゅう", "会議中"},
+      {"かいぎろく", "会議録"},
+  };
+  for (const auto &entry : kEntries) {
+    Segments segments;
+    MakeSegmentsForConversion(entry[0], &segments);
+    AddCandidate(entry[1], &segments);
+    predictor->Finish(*convreq_, &segments);
+  }
+  EXPECT_TRUE(predictor->Save());
+
+  testing::MockDataManager data_manager;
+  DictionaryMock dictionary;
+  SuppressionDictionary suppression_dictionary;
+  const dictionary::POSMatcher pos_matcher(data_manager.GetPOSMatcherData());
+  UserHistoryPredictor small_predictor(&dictionary, &pos_matcher,
+                                       &suppression_dictionary, false, 2);
+  small_predictor.Wait();
+  small_predictor.dic_->Clear();
+  EXPECT_TRUE(small_predictor.Load());
+  EXPECT_EQ(2, small_predictor.dic_->Size());
+  EXPECT_TRUE(IsSuggested(&small_predictor, "かいぎち", "会議中"));
+  EXPECT_TRUE(IsSuggested(&small_predictor, "かいぎろ", "会議録"));
+  EXPECT_FALSE(IsSuggested(&small_predictor, "かいぎし", "会議室"));
+}
+
+TEST_F(UserHistoryPredictorTest, ColdTier) {
+  FLAGS_user_history_cold_tier_size = 10;
+  testing::MockDataManager data_manager;
+  DictionaryMock dictionary;
+  SuppressionDictionary suppression_dictionary;
+  const dictionary::POSMatcher pos_matcher(data_manager.GetPOSMatcherData());
+  std::unique_ptr<UserHistoryPredictor> predictor(new UserHistoryPredictor(
+      &dictionary, &pos_matcher, &suppression_dictionary, false, 2));
+  predictor->Wait();
+  predictor->ClearAllHistory();
+  predictor->Wait();
+
+  const char *kEntries[][2] = {
+      {"かいぎしつ", "会議室"},
+      {"かいぎちゅう", "会議中"},
+      {"かいぎろく", "会議録"},
+  };
+  for (const auto &entry : kEntries) {
+    Segments segments;
+    MakeSegmentsForConversion(entry[0], &segments);
+    AddCandidate(entry[1], &segments);
+    predictor->Finish(*convreq_, &segments);
+  }
+
+  // The evicted entry is still suggested from the cold tier.
+  EXPECT_EQ(1, predictor->demoted_entries_.size());
+  EXPECT_TRUE(IsSuggested(predictor.get(), "かいぎし", "会議室"));
+  EXPECT_TRUE(IsSuggested(predictor.get(), "かいぎち", "会議中"));
+
+  // The cold tier is saved to its own file and read by another instance.
+  EXPECT_TRUE(predictor->Save());
+  EXPECT_TRUE(predictor->demoted_entries_.empty());
+  EXPECT_TRUE(FileUtil::FileExists(UserHistoryPredictor::GetColdTierFileName()));
+  predictor.reset(new UserHistoryPredictor(
+      &dictionary, &pos_matcher, &suppression_dictionary, false, 2));
+  predictor->Wait();
+  EXPECT_EQ(nullptr, predictor->cold_tier_.get());
+  EXPECT_TRUE(IsSuggested(predictor.get(), "かいぎし", "会議室"));
+  EXPECT_EQ(1, predictor->cold_tier_->entries_size());
+
+  // The cold tier is not looked up if the history fills the suggestions.
+  predictor->cold_tier_.reset();
+  Segments segments;
+  MakeSegmentsForSuggestion("かいぎ", &segments);
+  segments.set_max_prediction_candidates_size(2);
+  EXPECT_TRUE(predictor->PredictForRequest(*convreq_, &segments));
+  EXPECT_EQ(nullptr, predictor->cold_tier_.get());
+
+  // Clearing an entry also clears it from the cold tier.
+  EXPECT_TRUE(predictor->ClearHistoryEntry("かいぎしつ", "会議室"));
+  EXPECT_FALSE(IsSuggested(predictor.get(), "かいぎし", "会議室"));
+  EXPECT_TRUE(predictor->Save());
+  EXPECT_EQ(0, predictor->cold_tier_->entries_size());
+  EXPECT_FALSE(
+      FileUtil::FileExists(UserHistoryPredictor::GetColdTierFileName()));
+}
+
 TEST_F(UserHistoryPredictorTest, RomanFuzzyPrefixMatch) {
   // same
   EXPECT_FALSE(UserHistoryPredictor::RomanFuzzyPrefixMatch("abc", "abc"));
@@ -2355,6 +2497,101 @@ TEST_F(UserHistoryPredictorTest, RomanFuzzyLookupEntry) {
   EXPECT_FALSE(predictor->RomanFuzzyLookupEntry("g=guru", &entry, &results));
 }
 
+TEST_F(UserHistoryPredictorTest, GetCandidateElements) {
+  UserHistoryPredictor *predictor = GetUserHistoryPredictorWithClearedHistory();
+  InsertEntry(predictor, "あか", "赤");
+  InsertEntry(predictor, "あ", "亜");
+  InsertEntry(predictor, "あかい", "赤い");
+  InsertEntry(predictor, "いか", "烏賊");
+  InsertEntry(predictor, "あお", "青");
+
+  const auto get_values = [predictor](
+      const string &key_base, const Trie<string> *key_expanded,
+      const string &roman_input_key, std::vector<string> *values) {
+    std::vector<std::pair<size_t, const UserHistoryPredictor::DicElement *>>
+        elements;
+    values->clear();
+    if (!predictor->GetCandidateElements(key_base, key_expanded,
+                                         roman_input_key, &elements)) {
+      return false;
+    }
+    for (const auto &rank_and_element : elements) {
+      values->push_back(rank_and_element.second->value.value());
+    }
+    return true;
+  };
+
+  // Entries starting with the key and prefixes of the key, in the LRU order.
+  std::vector<string> values;
+  ASSERT_TRUE(get_values("あか", nullptr, "", &values));
+  EXPECT_EQ((std::vector<string>{"赤い", "亜", "赤"}), values);
+
+  unique_ptr<Trie<string>> expanded(new Trie<string>);
+  expanded->AddEntry("い", "い");
+  expanded->AddEntry("あお", "あお");
+  ASSERT_TRUE(get_values("", expanded.get(), "", &values));
+  EXPECT_EQ((std::vector<string>{"青", "烏賊"}), values);
+
+  // The index follows modifications.
+  InsertEntry(predictor, "あかり", "明かり");
+  ASSERT_TRUE(get_values("あか", nullptr, "", &values));
+  EXPECT_EQ((std::vector<string>{"明かり", "赤い", "亜", "赤"}), values);
+
+  // Zero query suggestion scans all the entries.
+  EXPECT_FALSE(get_values("", nullptr, "", &values));
+
+  // Roman fuzzy match candidates are a superset of the matching entries.
+  ASSERT_TRUE(get_values("あｋい", nullptr, "akia", &values));
+  EXPECT_EQ((std::vector<string>{"明かり", "赤い", "亜"}), values);
+  const char *kRomanInputs[] = {
+      "akia", "kaa", "aak", "ak", "iak", "oa", "akrai", "a-k",
+  };
+  for (const char *roman_input : kRomanInputs) {
+    ASSERT_TRUE(get_values("ｚ", nullptr, roman_input, &values));
+    for (const auto *elm = predictor->dic_->Head(); elm != nullptr;
+         elm = elm->next) {
+      string roman;
+      Util::HiraganaToRomanji(elm->value.key(), &roman);
+      if (UserHistoryPredictor::RomanFuzzyPrefixMatch(roman, roman_input)) {
+        EXPECT_NE(values.end(), std::find(values.begin(), values.end(),
+                                          elm->value.value()))
+            << roman_input << " " << roman;
+      }
+    }
+  }
+}
+
+TEST_F(UserHistoryPredictorTest, RomanFuzzyIndexLongKeys) {
+  UserHistoryPredictor *predictor = GetUserHistoryPredictorWithClearedHistory();
+  // Romanized keys longer than the indexed prefix.
+  InsertEntry(predictor, "わたしのなまえ", "私の名前");
+  InsertEntry(predictor, "わたしのなかま", "私の仲間");
+
+  string roman;
+  Util::HiraganaToRomanji("わたしのなまえ", &roman);
+  ASSERT_LT(10, roman.size());
+  // Swap and deletion beyond the indexed prefix.
+  string swapped = roman;
+  std::swap(swapped[9], swapped[10]);
+  string deleted = roman;
+  deleted.erase(9, 1);
+
+  std::vector<std::pair<size_t, const UserHistoryPredictor::DicElement *>>
+      elements;
+  for (const string &roman_input : {swapped, deleted}) {
+    ASSERT_TRUE(UserHistoryPredictor::RomanFuzzyPrefixMatch(roman,
+                                                            roman_input));
+    elements.clear();
+    ASSERT_TRUE(predictor->GetCandidateElements("ｚ", nullptr, roman_input,
+                                                &elements));
+    bool found = false;
+    for (const auto &rank_and_element : elements) {
+      found |= (rank_and_element.second->value.value() == "私の名前");
+    }
+    EXPECT_TRUE(found) << roman_input;
+  }
+}
+
 namespace {
 struct LookupTestData {
   const string entry_key;
@@ -4114,4 +4351,36 @@ TEST_F(UserHistoryPredictorTest, PunctuationLink_Desktop) {
   }
 }
 
+TEST_F(UserHistoryPredictorTest, CustomCacheSize) {
+  testing::MockDataManager data_manager;
+  DictionaryMock dictionary;
+  SuppressionDictionary suppression_dictionary;
+  const dictionary::POSMatcher pos_matcher(data_manager.GetPOSMatcherData());
+  UserHistoryPredictor predictor(&dictionary, &pos_matcher,
+                                 &suppression_dictionary, false, 2);
+  predictor.Wait();
+  predictor.ClearAllHistory();
+  predictor.Wait();
+
+  const char *kEntries[][2] = {
+      {"かいぎしつ", "会議室"},
+      {"かいぎちゅう", "会議中"},
+      {"かいぎろく", "会議録"},
+  };
+  for (const auto &entry : kEntries) {
+    Segments segments;
+    MakeSegmentsForConversion(entry[0], &segments);
+    AddCandidate(entry[1], &segments);
+    predictor.Finish(*convreq_, &segments);
+  }
+
+  // Only the two most recent entries are kept.
+  Segments segments;
+  MakeSegmentsForPrediction("かいぎ", &segments);
+  EXPECT_TRUE(predictor.PredictForRequest(*convreq_, &segments));
+  EXPECT_FALSE(FindCandidateByValue("会議室", segments));
+  EXPECT_TRUE(FindCandidateByValue("会議中", segments));
+  EXPECT_TRUE(FindCandidateByValue("会議録", segments));
+}
+
 }  // namespace mozc
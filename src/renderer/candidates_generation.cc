@@ -0,0 +1,100 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "renderer/candidates_generation.h"
+
+#include <string>
+
+#include "base/hash.h"
+#include "protocol/candidates.pb.h"
+
+namespace mozc {
+namespace renderer {
+namespace {
+
+void ClearFocus(commands::Candidates *candidates) {
+  candidates->clear_focused_index();
+  if (candidates->has_usages()) {
+    candidates->mutable_usages()->clear_focused_index();
+  }
+  if (candidates->has_subcandidates()) {
+    ClearFocus(candidates->mutable_subcandidates());
+  }
+}
+
+void CopyFocus(const commands::Candidates &focus,
+               commands::Candidates *candidates) {
+  if (focus.has_focused_index()) {
+    candidates->set_focused_index(focus.focused_index());
+  }
+  if (focus.has_usages() && focus.usages().has_focused_index() &&
+      candidates->has_usages()) {
+    candidates->mutable_usages()->set_focused_index(
+        focus.usages().focused_index());
+  }
+  if (focus.has_subcandidates() && candidates->has_subcandidates()) {
+    CopyFocus(focus.subcandidates(), candidates->mutable_subcandidates());
+  }
+}
+
+}  // namespace
+
+uint64 CandidatesGeneration::Get(const commands::Candidates &candidates) {
+  commands::Candidates contents;
+  contents.CopyFrom(candidates);
+  ClearFocus(&contents);
+  return Hash::Fingerprint(contents.SerializeAsString());
+}
+
+void CandidatesGeneration::ExtractFocus(const commands::Candidates &candidates,
+                                        commands::Candidates *focus) {
+  focus->Clear();
+  focus->set_size(candidates.size());
+  focus->set_position(candidates.position());
+  if (candidates.has_focused_index()) {
+    focus->set_focused_index(candidates.focused_index());
+  }
+  if (candidates.has_usages() && candidates.usages().has_focused_index()) {
+    focus->mutable_usages()->set_focused_index(
+        candidates.usages().focused_index());
+  }
+  if (candidates.has_subcandidates()) {
+    ExtractFocus(candidates.subcandidates(), focus->mutable_subcandidates());
+  }
+}
+
+void CandidatesGeneration::ApplyFocus(const commands::Candidates &focus,
+                                      commands::Candidates *candidates) {
+  ClearFocus(candidates);
+  CopyFocus(focus, candidates);
+}
+
+}  // namespace renderer
+}  // namespace mozc
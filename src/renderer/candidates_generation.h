@@ -0,0 +1,71 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef MOZC_RENDERER_CANDIDATES_GENERATION_H_
+#define MOZC_RENDERER_CANDIDATES_GENERATION_H_
+
+#include "base/port.h"
+
+namespace mozc {
+namespace commands {
+class Candidates;
+}  // namespace commands
+
+namespace renderer {
+
+// Helpers to send only the focus state of the candidates to the renderer
+// when their contents are unchanged. The contents are identified by their
+// generation, which ignores the focus state.
+// this is pure static class
+class CandidatesGeneration {
+ public:
+  // Returns the generation of the contents of |candidates|.
+  static uint64 Get(const commands::Candidates &candidates);
+
+  // Copies the focus state of |candidates| and its nested subcandidates and
+  // usages to |focus|. Other contents are not copied except for the
+  // required fields.
+  static void ExtractFocus(const commands::Candidates &candidates,
+                           commands::Candidates *focus);
+
+  // Replaces the focus state of |candidates|, which holds the contents of
+  // the same generation, with the one extracted by ExtractFocus().
+  static void ApplyFocus(const commands::Candidates &focus,
+                         commands::Candidates *candidates);
+
+ private:
+  CandidatesGeneration() {}
+  ~CandidatesGeneration() {}
+};
+
+}  // namespace renderer
+}  // namespace mozc
+
+#endif  // MOZC_RENDERER_CANDIDATES_GENERATION_H_
@@ -0,0 +1,102 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "renderer/candidates_generation.h"
+
+#include "protocol/candidates.pb.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace renderer {
+namespace {
+
+using commands::Candidates;
+
+void FillCandidates(Candidates *candidates) {
+  candidates->set_size(2);
+  candidates->set_position(0);
+  candidates->set_focused_index(0);
+  for (int i = 0; i < 2; ++i) {
+    Candidates::Candidate *candidate = candidates->add_candidate();
+    candidate->set_index(i);
+    candidate->set_value(i == 0 ? "value0" : "value1");
+  }
+  commands::InformationList *usages = candidates->mutable_usages();
+  usages->set_focused_index(0);
+  usages->add_information()->set_description("description");
+
+  Candidates *subcandidates = candidates->mutable_subcandidates();
+  subcandidates->set_size(1);
+  subcandidates->set_position(1);
+  subcandidates->set_focused_index(0);
+  Candidates::Candidate *candidate = subcandidates->add_candidate();
+  candidate->set_index(0);
+  candidate->set_value("subvalue0");
+}
+
+TEST(CandidatesGenerationTest, GetIgnoresFocus) {
+  Candidates candidates;
+  FillCandidates(&candidates);
+  const uint64 generation = CandidatesGeneration::Get(candidates);
+
+  candidates.set_focused_index(1);
+  candidates.mutable_usages()->set_focused_index(1);
+  candidates.mutable_subcandidates()->clear_focused_index();
+  EXPECT_EQ(generation, CandidatesGeneration::Get(candidates));
+
+  candidates.mutable_candidate(1)->set_value("value2");
+  EXPECT_NE(generation, CandidatesGeneration::Get(candidates));
+}
+
+TEST(CandidatesGenerationTest, ExtractAndApplyFocus) {
+  Candidates candidates;
+  FillCandidates(&candidates);
+  candidates.set_focused_index(1);
+  candidates.mutable_subcandidates()->clear_focused_index();
+
+  Candidates focus;
+  CandidatesGeneration::ExtractFocus(candidates, &focus);
+  EXPECT_TRUE(focus.IsInitialized());
+  EXPECT_EQ(0, focus.candidate_size());
+  EXPECT_EQ(1, focus.focused_index());
+  EXPECT_EQ(0, focus.usages().focused_index());
+  EXPECT_EQ(0, focus.usages().information_size());
+  EXPECT_FALSE(focus.subcandidates().has_focused_index());
+
+  // Contents of the same generation with another focus state.
+  Candidates restored;
+  FillCandidates(&restored);
+  CandidatesGeneration::ApplyFocus(focus, &restored);
+  EXPECT_EQ(candidates.SerializeAsString(), restored.SerializeAsString());
+}
+
+}  // namespace
+}  // namespace renderer
+}  // namespace mozc
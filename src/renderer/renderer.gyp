@@ -60,6 +60,17 @@
         '../base/base.gyp:base',
       ],
     },
+    {
+      'target_name': 'candidates_generation',
+      'type': 'static_library',
+      'sources': [
+        'candidates_generation.cc',
+      ],
+      'dependencies': [
+        '../base/base.gyp:base',
+        '../protocol/protocol.gyp:commands_proto',
+      ],
+    },
     {
       'target_name': 'renderer_client',
       'type': 'static_library',
@@ -68,6 +79,7 @@
       ],
       'dependencies': [
         '../base/base.gyp:base',
+        'candidates_generation',
         '../ipc/ipc.gyp:ipc',
         '../protocol/protocol.gyp:commands_proto',
         '../protocol/protocol.gyp:config_proto',
@@ -87,7 +99,22 @@
         '../ipc/ipc.gyp:ipc',
         '../protocol/protocol.gyp:commands_proto',
         '../protocol/protocol.gyp:renderer_proto',
+        'candidates_generation',
+      ],
+    },
+    {
+      'target_name': 'candidates_generation_test',
+      'type': 'executable',
+      'sources': [
+        'candidates_generation_test.cc',
+      ],
+      'dependencies': [
+        '../testing/testing.gyp:gtest_main',
+        'candidates_generation',
       ],
+      'variables': {
+        'test_size': 'small',
+      },
     },
     {
       'target_name': 'renderer_client_test',
@@ -180,6 +207,7 @@
       'target_name': 'renderer_all_test',
       'type': 'none',
       'dependencies': [
+        'candidates_generation_test',
         'renderer_client_test',
         'renderer_server_test',
         'renderer_style_handler_test',
@@ -33,19 +33,23 @@
 #include <cstddef>
 #include <memory>
 #include <string>
+#include <utility>
 
 #include "base/clock.h"
+#include "base/hash.h"
 #include "base/logging.h"
 #include "base/mutex.h"
 #include "base/process.h"
 #include "base/run_level.h"
 #include "base/system_util.h"
 #include "base/thread.h"
+#include "base/unnamed_event.h"
 #include "base/util.h"
 #include "base/version.h"
 #include "ipc/ipc.h"
 #include "ipc/named_event.h"
 #include "protocol/renderer_command.pb.h"
+#include "renderer/candidates_generation.h"
 
 #ifdef OS_MACOSX
 #include "base/mac_util.h"
@@ -66,11 +70,23 @@ const size_t kMaxErrorTimes         = 5;
 const uint64 kRetryIntervalTime     = 30;  // 30 sec
 const char   kServiceName[]         = "renderer";
 
-inline void CallCommand(IPCClientInterface *client,
-                        const commands::RendererCommand &command) {
-  string buf;
-  command.SerializeToString(&buf);
+// UPDATE commands are sent at most once per frame (about 60 fps).
+const int    kUpdateIntervalMsec    = 16;
+// An UPDATE command identical to the last one is skipped, and unchanged
+// candidates are omitted, only within this interval so that the renderer
+// eventually catches up even if another client has updated it in the
+// meantime.
+const uint64 kUpdateRefreshIntervalMsec = 1000;
+
+uint64 GetTimeInMsec() {
+  uint64 sec = 0;
+  uint32 usec = 0;
+  Clock::GetTimeOfDay(&sec, &usec);
+  return sec * 1000 + usec / 1000;
+}
 
+inline bool CallSerializedCommand(IPCClientInterface *client,
+                                  const string &buf) {
   // basically, we don't need to get the result
   char result[32];
   size_t result_size = sizeof(result);
@@ -79,10 +95,63 @@ inline void CallCommand(IPCClientInterface *client,
                     result, &result_size,
                     kIPCTimeout)) {
     LOG(ERROR) << "Cannot send the request: ";
+    return false;
   }
+  return true;
+}
+
+inline bool CallCommand(IPCClientInterface *client,
+                        const commands::RendererCommand &command) {
+  string buf;
+  command.SerializeToString(&buf);
+  return CallSerializedCommand(client, buf);
 }
 }  // namespace
 
+// Sends the UPDATE commands coalesced by RendererClient when the update
+// interval elapses.
+class RendererClient::UpdateSender : public Thread {
+ public:
+  explicit UpdateSender(RendererClient *client)
+      : client_(client), quit_(false) {}
+
+  virtual ~UpdateSender() {
+    if (!IsRunning()) {
+      return;
+    }
+    quit_ = true;
+    event_.Notify();
+    Join();
+  }
+
+  void Notify() {
+    event_.Notify();
+  }
+
+  virtual void Run() {
+    while (!quit_) {
+      event_.Wait(-1);
+      // Waits for the end of the current frame. The destructor interrupts
+      // the wait.
+      int wait_msec = 0;
+      while (!quit_ && (wait_msec = client_->GetUpdateWaitMsec()) > 0) {
+        event_.Wait(wait_msec);
+      }
+      if (quit_) {
+        break;
+      }
+      client_->FlushPendingUpdate();
+    }
+  }
+
+ private:
+  RendererClient *client_;
+  volatile bool quit_;
+  UnnamedEvent event_;
+
+  DISALLOW_COPY_AND_ASSIGN(UpdateSender);
+};
+
 class RendererLauncher : public RendererLauncherInterface,
                          public Thread {
  public:
@@ -322,7 +391,14 @@ RendererClient::RendererClient()
       version_mismatch_nums_(0),
       ipc_client_factory_interface_(IPCClientFactory::GetIPCClientFactory()),
       renderer_launcher_(new RendererLauncher),
-      renderer_launcher_interface_(NULL) {
+      renderer_launcher_interface_(NULL),
+      update_interval_msec_(kUpdateIntervalMsec),
+      last_update_time_(0),
+      last_update_fingerprint_(0),
+      pending_update_fingerprint_(0),
+      omit_unchanged_candidates_(true),
+      last_candidates_generation_(0),
+      last_candidates_time_(0) {
   renderer_launcher_interface_ = renderer_launcher_.get();
 
   name_ = kServiceName;
@@ -336,6 +412,12 @@ RendererClient::RendererClient()
 }
 
 RendererClient::~RendererClient() {
+  update_sender_.reset();
+  {
+    scoped_lock l(&mutex_);
+    SendPendingUpdate();
+    update_interval_msec_ = 0;
+  }
   if (!IsAvailable() || !is_window_visible_) {
     return;
   }
@@ -411,6 +493,16 @@ void RendererClient::set_suppress_error_dialog(bool suppress) {
   renderer_launcher_interface_->set_suppress_error_dialog(suppress);
 }
 
+void RendererClient::set_update_interval_msec(int msec) {
+  scoped_lock l(&mutex_);
+  update_interval_msec_ = msec;
+}
+
+void RendererClient::set_omit_unchanged_candidates(bool omit) {
+  scoped_lock l(&mutex_);
+  omit_unchanged_candidates_ = omit;
+}
+
 bool RendererClient::ExecCommand(const commands::RendererCommand &command) {
   if (renderer_launcher_interface_ == NULL) {
     LOG(ERROR) << "RendererLauncher is NULL";
@@ -422,6 +514,90 @@ bool RendererClient::ExecCommand(const commands::RendererCommand &command) {
     return false;
   }
 
+  if (command.type() != commands::RendererCommand::UPDATE) {
+    scoped_lock l(&mutex_);
+    // Sends the pending update first to keep the order of the commands.
+    SendPendingUpdate();
+    return ExecCommandInternal(command, 0);
+  }
+
+  const uint64 fingerprint = Hash::Fingerprint(command.SerializeAsString());
+  const uint64 now = GetTimeInMsec();
+
+  scoped_lock l(&mutex_);
+  if (pending_update_.get() != NULL) {
+    // An update is already scheduled for the current frame. Replaces it with
+    // the latest one, or drops it if the renderer already shows |command|.
+    if (fingerprint == last_update_fingerprint_) {
+      pending_update_.reset();
+    } else {
+      pending_update_->CopyFrom(command);
+      pending_update_fingerprint_ = fingerprint;
+    }
+    return true;
+  }
+
+  if (fingerprint == last_update_fingerprint_ &&
+      now < last_update_time_ + kUpdateRefreshIntervalMsec) {
+    VLOG(2) << "Skips the UPDATE command identical to the last one";
+    return true;
+  }
+
+  if (update_interval_msec_ > 0 &&
+      now < last_update_time_ + update_interval_msec_) {
+    pending_update_.reset(new commands::RendererCommand);
+    pending_update_->CopyFrom(command);
+    pending_update_fingerprint_ = fingerprint;
+    if (update_sender_.get() == NULL) {
+      update_sender_.reset(new UpdateSender(this));
+      update_sender_->Start("RendererUpdate");
+    }
+    update_sender_->Notify();
+    return true;
+  }
+
+  return ExecCommandInternal(command, fingerprint);
+}
+
+void RendererClient::SendPendingUpdate() {
+  if (pending_update_.get() == NULL) {
+    return;
+  }
+  std::unique_ptr<commands::RendererCommand> command(
+      std::move(pending_update_));
+  ExecCommandInternal(*command, pending_update_fingerprint_);
+}
+
+int RendererClient::GetUpdateWaitMsec() {
+  scoped_lock l(&mutex_);
+  const uint64 next_update_time = last_update_time_ + update_interval_msec_;
+  const uint64 now = GetTimeInMsec();
+  return now < next_update_time ? static_cast<int>(next_update_time - now) : 0;
+}
+
+void RendererClient::FlushPendingUpdate() {
+  scoped_lock l(&mutex_);
+  SendPendingUpdate();
+}
+
+bool RendererClient::ExecCommandInternal(
+    const commands::RendererCommand &command, uint64 fingerprint) {
+  // The renderer state is unknown until |command| is delivered. NOOP keeps
+  // the state of the renderer while the others replace it.
+  const uint64 now = GetTimeInMsec();
+  const uint64 previous_candidates_generation = last_candidates_generation_;
+  uint64 delivered_fingerprint = 0;
+  uint64 delivered_candidates_generation = 0;
+  if (command.type() == commands::RendererCommand::UPDATE) {
+    delivered_fingerprint = fingerprint;
+    last_update_time_ = now;
+  } else if (command.type() == commands::RendererCommand::NOOP) {
+    delivered_fingerprint = last_update_fingerprint_;
+    delivered_candidates_generation = last_candidates_generation_;
+  }
+  last_update_fingerprint_ = 0;
+  last_candidates_generation_ = 0;
+
   if (!renderer_launcher_interface_->CanConnect()) {
     renderer_launcher_interface_->SetPendingCommand(command);
     // Check CanConnect() again, as the status might be changed
@@ -499,7 +675,43 @@ bool RendererClient::ExecCommand(const commands::RendererCommand &command) {
     return true;
   }
 
-  CallCommand(client.get(), command);
+  string buf;
+  if (command.type() == commands::RendererCommand::UPDATE &&
+      command.output().has_candidates()) {
+    delivered_candidates_generation =
+        CandidatesGeneration::Get(command.output().candidates());
+    if (omit_unchanged_candidates_ &&
+        delivered_candidates_generation == previous_candidates_generation &&
+        now < last_candidates_time_ + kUpdateRefreshIntervalMsec) {
+      // The renderer already has the contents of the candidates. Sends only
+      // their focus state.
+      commands::RendererCommand compact_command;
+      compact_command.CopyFrom(command);
+      CandidatesGeneration::ExtractFocus(
+          command.output().candidates(),
+          compact_command.mutable_output()->mutable_candidates());
+      compact_command.set_candidates_generation(
+          delivered_candidates_generation);
+      compact_command.set_candidates_omitted(true);
+      compact_command.SerializeToString(&buf);
+    } else {
+      command.SerializeToString(&buf);
+      // Concatenated messages are merged on parsing, so the generation is
+      // appended without copying |command|.
+      commands::RendererCommand generation_command;
+      generation_command.set_candidates_generation(
+          delivered_candidates_generation);
+      generation_command.AppendToString(&buf);
+      last_candidates_time_ = now;
+    }
+  } else {
+    command.SerializeToString(&buf);
+  }
+
+  if (CallSerializedCommand(client.get(), buf)) {
+    last_update_fingerprint_ = delivered_fingerprint;
+    last_candidates_generation_ = delivered_candidates_generation;
+  }
 
   return true;
 }
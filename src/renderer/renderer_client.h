@@ -33,6 +33,7 @@
 #include <memory>
 #include <string>
 
+#include "base/mutex.h"
 #include "base/port.h"
 #include "renderer/renderer_interface.h"
 
@@ -124,9 +125,37 @@ class RendererClient : public RendererInterface {
   // Sets the flag of error dialog suppression.
   void set_suppress_error_dialog(bool suppress);
 
+  // Sets the minimum interval between two UPDATE commands sent to the
+  // renderer. UPDATE commands issued within the interval are coalesced and
+  // only the latest one is sent when the interval elapses.
+  // 0 disables the coalescing.
+  void set_update_interval_msec(int msec);
+
+  // If true, the contents of the candidates are omitted from UPDATE commands
+  // while they are unchanged, and only their focus state is sent. The
+  // renderer restores the contents it received before. Default is true.
+  void set_omit_unchanged_candidates(bool omit);
+
  private:
+  class UpdateSender;
+
   IPCClientInterface *CreateIPCClient() const;
 
+  // Sends |command| to the renderer. |fingerprint| is the fingerprint of
+  // an UPDATE command and is remembered once the command is delivered.
+  // |mutex_| must be held.
+  bool ExecCommandInternal(const commands::RendererCommand &command,
+                           uint64 fingerprint);
+
+  // Sends the pending UPDATE command if any. |mutex_| must be held.
+  void SendPendingUpdate();
+
+  // Returns the time in msec until the current update interval elapses.
+  int GetUpdateWaitMsec();
+
+  // Sends the pending UPDATE command if any. Called from |update_sender_|.
+  void FlushPendingUpdate();
+
   bool is_window_visible_;
   bool disable_renderer_path_check_;
   int  version_mismatch_nums_;
@@ -137,6 +166,25 @@ class RendererClient : public RendererInterface {
 
   std::unique_ptr<RendererLauncherInterface> renderer_launcher_;
   RendererLauncherInterface *renderer_launcher_interface_;
+
+  // Guards the IPC state above and the update coalescing state below, so
+  // that UPDATE commands are delivered in the order they are issued.
+  Mutex mutex_;
+  int update_interval_msec_;
+  // Time in msec when the last UPDATE command was sent.
+  uint64 last_update_time_;
+  // Fingerprint of the last UPDATE command delivered to the renderer.
+  // 0 when the state of the renderer is unknown.
+  uint64 last_update_fingerprint_;
+  std::unique_ptr<commands::RendererCommand> pending_update_;
+  uint64 pending_update_fingerprint_;
+  bool omit_unchanged_candidates_;
+  // Generation of the candidates last delivered to the renderer.
+  // 0 when the state of the renderer is unknown.
+  uint64 last_candidates_generation_;
+  // Time in msec when the contents of the candidates were last sent.
+  uint64 last_candidates_time_;
+  std::unique_ptr<UpdateSender> update_sender_;
 };
 
 }  // namespace renderer
@@ -31,12 +31,15 @@
 
 #include <string>
 
+#include "base/clock.h"
+#include "base/clock_mock.h"
 #include "base/logging.h"
 #include "base/number_util.h"
 #include "base/port.h"
 #include "base/util.h"
 #include "base/version.h"
 #include "ipc/ipc.h"
+#include "protocol/candidates.pb.h"
 #include "protocol/renderer_command.pb.h"
 #include "renderer/renderer_interface.h"
 #include "testing/base/public/gunit.h"
@@ -62,6 +65,7 @@ int g_counter = 0;
 bool g_connected = false;
 uint32 g_server_protocol_version = IPC_PROTOCOL_VERSION;
 string g_server_product_version;
+commands::RendererCommand g_last_update;
 
 class TestIPCClient : public IPCClientInterface {
  public:
@@ -94,6 +98,11 @@ class TestIPCClient : public IPCClientInterface {
                     size_t *response_size,
                     int32 timeout) {
     g_counter++;
+    commands::RendererCommand command;
+    if (command.ParseFromArray(request, request_size) &&
+        command.type() == commands::RendererCommand::UPDATE) {
+      g_last_update.CopyFrom(command);
+    }
     return true;
   }
 
@@ -109,6 +118,10 @@ class TestIPCClient : public IPCClientInterface {
     return g_counter;
   }
 
+  static const commands::RendererCommand &last_update() {
+    return g_last_update;
+  }
+
   static void set_server_protocol_version(uint32 version) {
     g_server_protocol_version = version;
   }
@@ -588,5 +601,176 @@ TEST(RendererClient, SetPendingCommandTest) {
     EXPECT_FALSE(launcher.is_set_pending_command_called());
   }
 }
+
+TEST(RendererClient, SkipIdenticalUpdateTest) {
+  TestIPCClientFactory factory;
+  TestRendererLauncher launcher;
+
+  RendererClient client;
+
+  client.SetIPCClientFactory(&factory);
+  client.SetRendererLauncherInterface(&launcher);
+  client.set_update_interval_msec(0);
+
+  commands::RendererCommand command;
+  command.set_type(commands::RendererCommand::UPDATE);
+  command.set_visible(true);
+  command.mutable_output()->set_id(1);
+
+  launcher.Reset();
+  launcher.set_can_connect(true);
+  TestIPCClient::set_connected(true);
+  TestIPCClient::Reset();
+
+  EXPECT_TRUE(client.ExecCommand(command));
+  EXPECT_EQ(1, TestIPCClient::counter());
+
+  // The renderer already shows the same content.
+  EXPECT_TRUE(client.ExecCommand(command));
+  EXPECT_EQ(1, TestIPCClient::counter());
+
+  command.mutable_output()->set_id(2);
+  EXPECT_TRUE(client.ExecCommand(command));
+  EXPECT_EQ(2, TestIPCClient::counter());
+
+  // A command not delivered to the renderer is not remembered.
+  TestIPCClient::set_connected(false);
+  command.mutable_output()->set_id(3);
+  EXPECT_TRUE(client.ExecCommand(command));
+  EXPECT_EQ(2, TestIPCClient::counter());
+  TestIPCClient::set_connected(true);
+  EXPECT_TRUE(client.ExecCommand(command));
+  EXPECT_EQ(3, TestIPCClient::counter());
+}
+
+TEST(RendererClient, CoalesceUpdateTest) {
+  // Stops the clock so that the update interval never elapses in this test.
+  ClockMock clock(1000, 0);
+  Clock::SetClockForUnitTest(&clock);
+
+  TestIPCClientFactory factory;
+  TestRendererLauncher launcher;
+
+  {
+    RendererClient client;
+
+    client.SetIPCClientFactory(&factory);
+    client.SetRendererLauncherInterface(&launcher);
+    client.set_update_interval_msec(1000);
+
+    commands::RendererCommand command;
+    command.set_type(commands::RendererCommand::UPDATE);
+    command.set_visible(true);
+
+    launcher.Reset();
+    launcher.set_can_connect(true);
+    TestIPCClient::set_connected(true);
+    TestIPCClient::Reset();
+
+    // The first update is sent immediately.
+    command.mutable_output()->set_id(1);
+    EXPECT_TRUE(client.ExecCommand(command));
+    EXPECT_EQ(1, TestIPCClient::counter());
+    EXPECT_EQ(1, TestIPCClient::last_update().output().id());
+
+    // The following updates are coalesced until the frame ends.
+    command.mutable_output()->set_id(2);
+    EXPECT_TRUE(client.ExecCommand(command));
+    command.mutable_output()->set_id(3);
+    EXPECT_TRUE(client.ExecCommand(command));
+    EXPECT_EQ(1, TestIPCClient::counter());
+
+    // Other commands flush the pending update to keep the order.
+    commands::RendererCommand noop;
+    noop.set_type(commands::RendererCommand::NOOP);
+    EXPECT_TRUE(client.ExecCommand(noop));
+    EXPECT_EQ(3, TestIPCClient::counter());
+    EXPECT_EQ(3, TestIPCClient::last_update().output().id());
+
+    // The pending update is dropped when it is back to the delivered one.
+    command.mutable_output()->set_id(4);
+    EXPECT_TRUE(client.ExecCommand(command));
+    command.mutable_output()->set_id(3);
+    EXPECT_TRUE(client.ExecCommand(command));
+    EXPECT_TRUE(client.ExecCommand(noop));
+    EXPECT_EQ(4, TestIPCClient::counter());
+    EXPECT_EQ(3, TestIPCClient::last_update().output().id());
+
+    // The pending update is sent when the client is destroyed.
+    command.mutable_output()->set_id(5);
+    EXPECT_TRUE(client.ExecCommand(command));
+    EXPECT_EQ(4, TestIPCClient::counter());
+  }
+  EXPECT_EQ(5, TestIPCClient::counter());
+  EXPECT_EQ(5, TestIPCClient::last_update().output().id());
+
+  Clock::SetClockForUnitTest(NULL);
+}
+
+TEST(RendererClient, OmitUnchangedCandidatesTest) {
+  TestIPCClientFactory factory;
+  TestRendererLauncher launcher;
+
+  RendererClient client;
+
+  client.SetIPCClientFactory(&factory);
+  client.SetRendererLauncherInterface(&launcher);
+  client.set_update_interval_msec(0);
+
+  commands::RendererCommand command;
+  command.set_type(commands::RendererCommand::UPDATE);
+  command.set_visible(true);
+  commands::Candidates *candidates =
+      command.mutable_output()->mutable_candidates();
+  candidates->set_size(2);
+  candidates->set_position(0);
+  candidates->set_focused_index(0);
+  for (int i = 0; i < 2; ++i) {
+    commands::Candidates::Candidate *candidate = candidates->add_candidate();
+    candidate->set_index(i);
+    candidate->set_value("value");
+  }
+
+  launcher.Reset();
+  launcher.set_can_connect(true);
+  TestIPCClient::set_connected(true);
+  TestIPCClient::Reset();
+
+  // The contents are sent with their generation.
+  EXPECT_TRUE(client.ExecCommand(command));
+  EXPECT_EQ(1, TestIPCClient::counter());
+  EXPECT_TRUE(TestIPCClient::last_update().has_candidates_generation());
+  EXPECT_FALSE(TestIPCClient::last_update().candidates_omitted());
+  EXPECT_EQ(2, TestIPCClient::last_update().output().candidates().
+            candidate_size());
+  const uint64 generation =
+      TestIPCClient::last_update().candidates_generation();
+
+  // Only the focus is moved.
+  candidates->set_focused_index(1);
+  EXPECT_TRUE(client.ExecCommand(command));
+  EXPECT_EQ(2, TestIPCClient::counter());
+  EXPECT_EQ(generation, TestIPCClient::last_update().candidates_generation());
+  EXPECT_TRUE(TestIPCClient::last_update().candidates_omitted());
+  EXPECT_EQ(0, TestIPCClient::last_update().output().candidates().
+            candidate_size());
+  EXPECT_EQ(1, TestIPCClient::last_update().output().candidates().
+            focused_index());
+
+  // The contents are changed.
+  candidates->mutable_candidate(1)->set_value("value1");
+  EXPECT_TRUE(client.ExecCommand(command));
+  EXPECT_EQ(3, TestIPCClient::counter());
+  EXPECT_NE(generation, TestIPCClient::last_update().candidates_generation());
+  EXPECT_FALSE(TestIPCClient::last_update().candidates_omitted());
+
+  client.set_omit_unchanged_candidates(false);
+  candidates->set_focused_index(0);
+  EXPECT_TRUE(client.ExecCommand(command));
+  EXPECT_EQ(4, TestIPCClient::counter());
+  EXPECT_FALSE(TestIPCClient::last_update().candidates_omitted());
+  EXPECT_EQ(2, TestIPCClient::last_update().output().candidates().
+            candidate_size());
+}
 }  // namespace renderer
 }  // namespace mozc
@@ -34,6 +34,8 @@
 #endif  // OS_WIN
 
 #include <algorithm>
+#include <deque>
+#include <utility>
 
 #include "base/compiler_specific.h"
 #include "base/const.h"
@@ -46,8 +48,10 @@
 #include "ipc/ipc.h"
 #include "ipc/named_event.h"
 #include "ipc/process_watch_dog.h"
+#include "protocol/candidates.pb.h"
 #include "protocol/config.pb.h"
 #include "protocol/renderer_command.pb.h"
+#include "renderer/candidates_generation.h"
 #include "renderer/renderer_interface.h"
 
 // By default, mozc_renderer quits when user-input continues to be
@@ -67,12 +71,16 @@ namespace renderer {
 
 namespace {
 #ifdef OS_WIN
-const int kNumConnections   = 1;
+// See the comment in session_server.cc.
+const int kNumConnections   = 2;
 #else
 const int kNumConnections   = 10;
 #endif  // OS_WIN or not
 const int kIPCServerTimeOut = 1000;
 const char kServiceName[]   = "renderer";
+// The renderer may be shared by several clients, so the candidates of a few
+// recent generations are kept.
+const size_t kMaxCandidatesCacheSize = 4;
 
 string GetServiceName() {
   string name = kServiceName;
@@ -167,13 +175,51 @@ class RendererServerSendCommand : public client::SendCommandInterface {
   DISALLOW_COPY_AND_ASSIGN(RendererServerSendCommand);
 };
 
+// Keeps the candidates of the recent generations to restore the candidates
+// omitted from RendererCommand.
+class CandidatesCache {
+ public:
+  CandidatesCache() {}
+
+  void Insert(uint64 generation, const commands::Candidates &candidates) {
+    for (size_t i = 0; i < entries_.size(); ++i) {
+      if (entries_[i].first == generation) {
+        if (i > 0) {
+          std::swap(entries_[0], entries_[i]);
+        }
+        return;
+      }
+    }
+    if (entries_.size() >= kMaxCandidatesCacheSize) {
+      entries_.pop_back();
+    }
+    entries_.push_front(std::make_pair(generation, candidates));
+  }
+
+  // Returns NULL if the candidates of |generation| are not kept.
+  const commands::Candidates *Lookup(uint64 generation) const {
+    for (size_t i = 0; i < entries_.size(); ++i) {
+      if (entries_[i].first == generation) {
+        return &entries_[i].second;
+      }
+    }
+    return NULL;
+  }
+
+ private:
+  std::deque<std::pair<uint64, commands::Candidates>> entries_;
+
+  DISALLOW_COPY_AND_ASSIGN(CandidatesCache);
+};
+
 RendererServer::RendererServer()
     : IPCServer(GetServiceName(), kNumConnections, kIPCServerTimeOut),
       timeout_(0),
       renderer_interface_(NULL),
       ALLOW_THIS_IN_INITIALIZER_LIST(
           watch_dog_(new ParentApplicationWatchDog(this))),
-      send_command_(new RendererServerSendCommand) {
+      send_command_(new RendererServerSendCommand),
+      candidates_cache_(new CandidatesCache) {
   if (FLAGS_restricted) {
     FLAGS_timeout =
         std::min(FLAGS_timeout, 60);  // set 60sec with restricted mode
@@ -276,6 +322,35 @@ bool RendererServer::ExecCommandInternal(
     }
   }
 
+  if (command.type() == commands::RendererCommand::UPDATE &&
+      command.candidates_omitted()) {
+    commands::RendererCommand restored_command;
+    restored_command.CopyFrom(command);
+    const commands::Candidates *contents =
+        candidates_cache_->Lookup(command.candidates_generation());
+    if (contents == NULL) {
+      // The client refreshes the contents soon.
+      LOG(WARNING) << "Unknown candidates generation: "
+                   << command.candidates_generation();
+      restored_command.mutable_output()->clear_candidates();
+    } else {
+      commands::Candidates *candidates =
+          restored_command.mutable_output()->mutable_candidates();
+      candidates->CopyFrom(*contents);
+      CandidatesGeneration::ApplyFocus(command.output().candidates(),
+                                       candidates);
+    }
+    restored_command.clear_candidates_omitted();
+    return renderer_interface_->ExecCommand(restored_command);
+  }
+
+  if (command.type() == commands::RendererCommand::UPDATE &&
+      command.has_candidates_generation() &&
+      command.output().has_candidates()) {
+    candidates_cache_->Insert(command.candidates_generation(),
+                              command.output().candidates());
+  }
+
   if (renderer_interface_->ExecCommand(command)) {
     return true;
   }
@@ -40,6 +40,7 @@
 namespace mozc {
 namespace renderer {
 
+class CandidatesCache;
 class RendererInterface;
 class RendererServerSendCommand;
 class ParentApplicationWatchDog;
@@ -95,6 +96,7 @@ class RendererServer : public IPCServer {
   RendererInterface *renderer_interface_;
   std::unique_ptr<ParentApplicationWatchDog> watch_dog_;
   std::unique_ptr<RendererServerSendCommand> send_command_;
+  std::unique_ptr<CandidatesCache> candidates_cache_;
 
   DISALLOW_COPY_AND_ASSIGN(RendererServer);
 };
@@ -37,6 +37,8 @@
 #include "base/system_util.h"
 #include "base/util.h"
 #include "ipc/ipc_test_util.h"
+#include "renderer/candidates_generation.h"
+#include "protocol/candidates.pb.h"
 #include "protocol/renderer_command.pb.h"
 #include "renderer/renderer_client.h"
 #include "renderer/renderer_interface.h"
@@ -60,6 +62,7 @@ class TestRenderer : public RendererInterface {
       return false;
     }
     counter_++;
+    last_command_.CopyFrom(command);
     return true;
   }
 
@@ -71,6 +74,10 @@ class TestRenderer : public RendererInterface {
     return counter_;
   }
 
+  const commands::RendererCommand &last_command() const {
+    return last_command_;
+  }
+
   void Shutdown() {
     finished_ = true;
   }
@@ -78,6 +85,7 @@ class TestRenderer : public RendererInterface {
  private:
   int counter_;
   bool finished_;
+  commands::RendererCommand last_command_;
 };
 
 class TestRendererServer : public RendererServer {
@@ -179,5 +187,50 @@ TEST_F(RendererServerTest, IPCTest) {
   server->Wait();
 }
 
+TEST_F(RendererServerTest, RestoreOmittedCandidatesTest) {
+  std::unique_ptr<TestRendererServer> server(new TestRendererServer);
+  TestRenderer renderer;
+  server->SetRendererInterface(&renderer);
+
+  commands::RendererCommand command;
+  command.set_type(commands::RendererCommand::UPDATE);
+  command.set_visible(true);
+  commands::Candidates *candidates =
+      command.mutable_output()->mutable_candidates();
+  candidates->set_size(2);
+  candidates->set_position(0);
+  candidates->set_focused_index(0);
+  for (int i = 0; i < 2; ++i) {
+    commands::Candidates::Candidate *candidate = candidates->add_candidate();
+    candidate->set_index(i);
+    candidate->set_value("value");
+  }
+  const uint64 generation = CandidatesGeneration::Get(*candidates);
+  command.set_candidates_generation(generation);
+  EXPECT_TRUE(server->AsyncExecCommand(
+      new string(command.SerializeAsString())));
+  EXPECT_EQ(2, renderer.last_command().output().candidates().
+            candidate_size());
+
+  // Only the focus state is sent.
+  candidates->set_focused_index(1);
+  commands::RendererCommand compact_command;
+  compact_command.CopyFrom(command);
+  CandidatesGeneration::ExtractFocus(
+      *candidates, compact_command.mutable_output()->mutable_candidates());
+  compact_command.set_candidates_omitted(true);
+  EXPECT_TRUE(server->AsyncExecCommand(
+      new string(compact_command.SerializeAsString())));
+  EXPECT_FALSE(renderer.last_command().candidates_omitted());
+  EXPECT_EQ(candidates->SerializeAsString(),
+            renderer.last_command().output().candidates().SerializeAsString());
+
+  // The candidates of an unknown generation are not rendered.
+  compact_command.set_candidates_generation(generation + 1);
+  EXPECT_TRUE(server->AsyncExecCommand(
+      new string(compact_command.SerializeAsString())));
+  EXPECT_FALSE(renderer.last_command().output().has_candidates());
+}
+
 }  // namespace renderer
 }  // namespace mozc
@@ -83,13 +83,20 @@ CandidateWindow::CandidateWindow(
       table_layout_(table_layout),
       text_renderer_(text_renderer),
       draw_tool_(draw_tool),
-      cairo_factory_(cairo_factory) {
+      cairo_factory_(cairo_factory),
+      paint_rect_(0, 0, 0, 0) {
 }
 
 bool CandidateWindow::OnPaint(GtkWidget *widget, GdkEventExpose* event) {
   draw_tool_->Reset(cairo_factory_->CreateCairoInstance(
       GetCanvasWidget()->window));
 
+  // The drawing out of the exposed area is clipped.  Skip rendering the
+  // texts there.
+  if (event != NULL) {
+    paint_rect_ = Rect(event->area.x, event->area.y,
+                       event->area.width, event->area.height);
+  }
   DrawBackground();
   DrawShortcutBackground();
   DrawSelectedRect();
@@ -98,9 +105,20 @@ bool CandidateWindow::OnPaint(GtkWidget *widget, GdkEventExpose* event) {
   DrawVScrollBar();
   DrawFooter();
   DrawFrame();
+  paint_rect_ = Rect(0, 0, 0, 0);
   return true;
 }
 
+bool CandidateWindow::IsInPaintRect(const Rect &rect) const {
+  if (paint_rect_.IsRectEmpty()) {
+    return true;
+  }
+  return rect.Left() < paint_rect_.Right() &&
+         paint_rect_.Left() < rect.Right() &&
+         rect.Top() < paint_rect_.Bottom() &&
+         paint_rect_.Top() < rect.Bottom();
+}
+
 void CandidateWindow::DrawBackground() {
   const Rect window_rect(Point(0, 0), GetWindowSize());
   draw_tool_->FillRect(window_rect, kDefaultBackgroundColor);
@@ -144,6 +162,10 @@ void CandidateWindow::DrawSelectedRect() {
 
 void CandidateWindow::DrawCells() {
   for (size_t i = 0; i < candidates_.candidate_size(); ++i) {
+    if (!paint_rect_.IsRectEmpty() &&
+        !IsInPaintRect(table_layout_->GetRowRect(i))) {
+      continue;
+    }
     const commands::Candidates::Candidate &candidate
         = candidates_.candidate(i);
     string shortcut, value, description;
@@ -387,6 +409,20 @@ Size CandidateWindow::Update(const commands::Candidates &candidates) {
       (candidates_.category()  == commands::USAGE))
       << "Unknown candidate category" << candidates_.category();
 
+  if (IsFocusMoveOnly(candidates)) {
+    // The layout is kept as is.  Redraw the rows of the previous and the new
+    // focus, and the index in the footer.
+    RedrawFocusedRow(GetCandidateArrayIndexByCandidateIndex(
+        candidates_, candidates_.focused_index()));
+    candidates_.set_focused_index(candidates.focused_index());
+    RedrawFocusedRow(GetCandidateArrayIndexByCandidateIndex(
+        candidates_, candidates_.focused_index()));
+    if (candidates_.has_footer() && candidates_.footer().index_visible()) {
+      RedrawRect(table_layout_->GetFooterRect());
+    }
+    return table_layout_->GetTotalSize();
+  }
+
   candidates_.CopyFrom(candidates);
 
   table_layout_->Initialize(candidates_.candidate_size(), NUMBER_OF_COLUMNS);
@@ -406,6 +442,38 @@ Size CandidateWindow::Update(const commands::Candidates &candidates) {
   return table_layout_->GetTotalSize();
 }
 
+bool CandidateWindow::IsFocusMoveOnly(
+    const commands::Candidates &candidates) const {
+  if (!table_layout_->IsLayoutFrozen() ||
+      !candidates_.has_focused_index() || !candidates.has_focused_index()) {
+    return false;
+  }
+  // The index in the footer has to fit in the current footer.
+  if (candidates.has_footer() && candidates.footer().index_visible() &&
+      text_renderer_->GetPixelSize(
+          FontSpec::FONTSET_FOOTER_INDEX,
+          GetIndexGuideString(candidates_)).width !=
+      text_renderer_->GetPixelSize(
+          FontSpec::FONTSET_FOOTER_INDEX,
+          GetIndexGuideString(candidates)).width) {
+    return false;
+  }
+  commands::Candidates focus_moved;
+  focus_moved.CopyFrom(candidates_);
+  focus_moved.set_focused_index(candidates.focused_index());
+  return focus_moved.SerializeAsString() == candidates.SerializeAsString();
+}
+
+void CandidateWindow::RedrawFocusedRow(int row) {
+  if (row < 0 || row >= candidates_.candidate_size()) {
+    return;
+  }
+  // The frame of the selected row is stroked on the border of the row.
+  Rect rect = table_layout_->GetRowRect(row);
+  rect.DeflateRect(-1, -1);
+  RedrawRect(rect);
+}
+
 void CandidateWindow::GetDisplayString(
     const commands::Candidates::Candidate &candidate,
     string *shortcut,
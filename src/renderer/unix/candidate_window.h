@@ -123,6 +123,15 @@ class CandidateWindow : public GtkWindowBase {
   void UpdateCandidatesSize(bool *has_description);
   void UpdateGap2Size(bool has_description);
 
+  // Returns true if |candidates| differs from the current ones only in the
+  // focused index, and the current layout fits |candidates| as is.  Such an
+  // update, e.g., moving the focus on a page, redraws only the changed rows.
+  bool IsFocusMoveOnly(const commands::Candidates &candidates) const;
+  // Redraws the row of a focused candidate at the array index |row|.
+  void RedrawFocusedRow(int row);
+  // Returns true if |rect| needs to be drawn in the current OnPaint.
+  bool IsInPaintRect(const Rect &rect) const;
+
   // TODO(nona): Remove FRIEND_TEST
   FRIEND_TEST(CandidateWindowTest, DrawBackgroundTest);
   FRIEND_TEST(CandidateWindowTest, DrawShortcutBackgroundTest);
@@ -144,6 +153,8 @@ class CandidateWindow : public GtkWindowBase {
   FRIEND_TEST(CandidateWindowTest, UpdateGap2SizeTest);
   FRIEND_TEST(CandidateWindowTest, OnMouseLeftUpTest);
   FRIEND_TEST(CandidateWindowTest, GetSelectedRowIndexTest);
+  FRIEND_TEST(CandidateWindowTest, UpdateFocusMoveOnlyTest);
+  FRIEND_TEST(CandidateWindowTest, DrawCellsInPaintRectTest);
 
   commands::Candidates candidates_;
   std::unique_ptr<TableLayoutInterface> table_layout_;
@@ -151,6 +162,9 @@ class CandidateWindow : public GtkWindowBase {
   std::unique_ptr<DrawToolInterface> draw_tool_;
   std::unique_ptr<CairoFactoryInterface> cairo_factory_;
   client::SendCommandInterface *send_command_interface_;
+  // The area to be drawn by the current OnPaint.  Empty means the whole
+  // window.
+  Rect paint_rect_;
   DISALLOW_COPY_AND_ASSIGN(CandidateWindow);
 };
 
@@ -1156,6 +1156,85 @@ TEST_F(CandidateWindowTest, UpdateTest) {
   // TODO(nona): Implement this test.
 }
 
+TEST_F(CandidateWindowTest, UpdateFocusMoveOnlyTest) {
+  const Size kTotalSize(100, 200);
+  {
+    SCOPED_TRACE("Moving the focus redraws only the focused rows.");
+    CandidateWindowTestKit testkit = SetUpCandidateWindow();
+    SetTestCandidates(10, true, true, true, false, false,
+                      &testkit.window->candidates_);
+    testkit.window->candidates_.set_focused_index(2);
+    commands::Candidates candidates;
+    candidates.CopyFrom(testkit.window->candidates_);
+    candidates.set_focused_index(3);
+
+    EXPECT_CALL(*testkit.table_layout_mock, IsLayoutFrozen())
+        .WillRepeatedly(Return(true));
+    EXPECT_CALL(*testkit.table_layout_mock, Initialize(_, _)).Times(0);
+    EXPECT_CALL(*testkit.table_layout_mock, GetRowRect(2))
+        .WillOnce(Return(Rect(10, 20, 30, 40)));
+    EXPECT_CALL(*testkit.table_layout_mock, GetRowRect(3))
+        .WillOnce(Return(Rect(10, 60, 30, 40)));
+    EXPECT_CALL(*testkit.gtk_mock,
+                GtkWidgetQueueDrawArea(kDummyWindow, 9, 19, 32, 42));
+    EXPECT_CALL(*testkit.gtk_mock,
+                GtkWidgetQueueDrawArea(kDummyWindow, 9, 59, 32, 42));
+    EXPECT_CALL(*testkit.table_layout_mock, GetTotalSize())
+        .WillOnce(Return(kTotalSize));
+
+    const Size size = testkit.window->Update(candidates);
+    EXPECT_EQ(kTotalSize.width, size.width);
+    EXPECT_EQ(kTotalSize.height, size.height);
+    EXPECT_EQ(3, testkit.window->candidates_.focused_index());
+    FinalizeTestKit(&testkit);
+  }
+  {
+    SCOPED_TRACE("Changing the candidates lays out the table again.");
+    CandidateWindowTestKit testkit = SetUpCandidateWindow();
+    SetTestCandidates(10, true, true, true, false, false,
+                      &testkit.window->candidates_);
+    testkit.window->candidates_.set_focused_index(2);
+    commands::Candidates candidates;
+    SetTestCandidates(10, true, true, false, false, false, &candidates);
+    candidates.set_focused_index(3);
+
+    EXPECT_CALL(*testkit.table_layout_mock, IsLayoutFrozen())
+        .WillRepeatedly(Return(true));
+    EXPECT_CALL(*testkit.table_layout_mock, Initialize(10, _));
+    EXPECT_CALL(*testkit.table_layout_mock, FreezeLayout());
+
+    testkit.window->Update(candidates);
+    EXPECT_FALSE(testkit.window->candidates_.candidate(0).annotation()
+                 .has_description());
+    FinalizeTestKit(&testkit);
+  }
+}
+
+TEST_F(CandidateWindowTest, DrawCellsInPaintRectTest) {
+  CandidateWindowTestKit testkit = SetUpCandidateWindow();
+  SetTestCandidates(2, true, false, false, false, false,
+                    &testkit.window->candidates_);
+  testkit.window->paint_rect_ = Rect(0, 0, 100, 10);
+
+  const Rect kValueRect(0, 0, 100, 10);
+  EXPECT_CALL(*testkit.table_layout_mock, GetRowRect(0))
+      .WillOnce(Return(Rect(0, 0, 100, 10)));
+  EXPECT_CALL(*testkit.table_layout_mock, GetRowRect(1))
+      .WillOnce(Return(Rect(0, 10, 100, 10)));
+  EXPECT_CALL(*testkit.table_layout_mock,
+              GetCellRect(0, CandidateWindow::COLUMN_CANDIDATE))
+      .WillOnce(Return(kValueRect));
+  EXPECT_CALL(*testkit.table_layout_mock,
+              GetCellRect(1, CandidateWindow::COLUMN_CANDIDATE))
+      .Times(0);
+  EXPECT_CALL(*testkit.text_renderer_mock, RenderText(
+      GetExpectedValue(0, false, false), RectEq(kValueRect),
+      FontSpecInterface::FONTSET_CANDIDATE));
+
+  testkit.window->DrawCells();
+  FinalizeTestKit(&testkit);
+}
+
 TEST_F(CandidateWindowTest, UpdateGap1SizeTest) {
   CandidateWindowTestKit testkit = SetUpCandidateWindow();
 
@@ -79,6 +79,8 @@ class GtkWindowBase : public GtkWindowInterface {
   virtual void Move(const Point &pos);
   virtual void Resize(const Size &size);
   virtual void Redraw();
+  // Redraws only |rect| in the client coordinates.
+  virtual void RedrawRect(const Rect &rect);
 
   virtual void Initialize();
   virtual Size Update(const commands::Candidates &candidates);
@@ -37,6 +37,15 @@ namespace mozc {
 namespace renderer {
 namespace gtk {
 
+namespace {
+
+// The maximum number of the strings whose sizes are cached.  The cache is
+// cleared when it gets full, as the strings shown in the candidate window
+// change in bursts, e.g., on each conversion.
+const size_t kMaxPixelSizeCacheSize = 1024;
+
+}  // namespace
+
 TextRenderer::TextRenderer(FontSpecInterface *font_spec)
   : font_spec_(font_spec),
     pango_(nullptr) {
@@ -44,6 +53,7 @@ TextRenderer::TextRenderer(FontSpecInterface *font_spec)
 
 void TextRenderer::Initialize(GdkDrawable *drawable) {
   pango_.reset(new PangoWrapper(drawable));
+  pixel_size_cache_.clear();
 }
 
 void TextRenderer::SetUpPangoLayout(const string &str,
@@ -60,8 +70,18 @@ void TextRenderer::SetUpPangoLayout(const string &str,
 
 Size TextRenderer::GetPixelSize(FontSpecInterface::FONT_TYPE font_type,
                                 const string &str) {
+  const PixelSizeCache::key_type key(font_type, str);
+  const PixelSizeCache::const_iterator it = pixel_size_cache_.find(key);
+  if (it != pixel_size_cache_.end()) {
+    return it->second;
+  }
   PangoLayoutWrapper layout(pango_->GetContext());
-  return GetPixelSizeInternal(font_type, str, &layout);
+  const Size size = GetPixelSizeInternal(font_type, str, &layout);
+  if (pixel_size_cache_.size() >= kMaxPixelSizeCacheSize) {
+    pixel_size_cache_.clear();
+  }
+  pixel_size_cache_.insert(std::make_pair(key, size));
+  return size;
 }
 
 Size TextRenderer::GetPixelSizeInternal(FontSpecInterface::FONT_TYPE font_type,
@@ -113,6 +133,7 @@ void TextRenderer::RenderTextInternal(const string& text,
 
 void TextRenderer::ReloadFontConfig(const string &font_description) {
   font_spec_->Reload(font_description);
+  pixel_size_cache_.clear();
 }
 }  // namespace gtk
 }  // namespace renderer
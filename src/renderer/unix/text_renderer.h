@@ -32,7 +32,10 @@
 
 #include <gtk/gtk.h>
 
+#include <map>
 #include <memory>
+#include <string>
+#include <utility>
 
 #include "base/port.h"
 #include "renderer/unix/font_spec_interface.h"
@@ -67,6 +70,10 @@ class TextRenderer : public TextRendererInterface {
   FRIEND_TEST(TextRendererTest, GetPixelSizeTest);
   FRIEND_TEST(TextRendererTest, GetMultilinePixelSizeTest);
   FRIEND_TEST(TextRendererTest, RenderTextTest);
+  FRIEND_TEST(TextRendererTest, PixelSizeCacheTest);
+
+  typedef std::map<std::pair<FontSpecInterface::FONT_TYPE, string>, Size>
+      PixelSizeCache;
 
   void SetUpPangoLayout(const string &str,
                         FontSpecInterface::FONT_TYPE font_type,
@@ -84,6 +91,10 @@ class TextRenderer : public TextRendererInterface {
                                      PangoLayoutWrapperInterface *layout);
   std::unique_ptr<FontSpecInterface> font_spec_;
   std::unique_ptr<PangoWrapperInterface> pango_;
+  // The sizes of the strings measured by GetPixelSize.  The candidate window
+  // measures the same strings, e.g., the footer and the candidates on a page,
+  // on every update.  Cleared when the fonts are changed.
+  PixelSizeCache pixel_size_cache_;
 
   DISALLOW_COPY_AND_ASSIGN(TextRenderer);
 };
@@ -263,6 +263,28 @@ TEST_F(TextRendererTest, ReloadFontConfigTest) {
   text_renderer.ReloadFontConfig(kDummyFontDescription);
 }
 
+TEST_F(TextRendererTest, PixelSizeCacheTest) {
+  FontSpecMock *font_spec_mock = new FontSpecMock();
+  TextRenderer text_renderer(font_spec_mock);
+  PangoWrapperMock *pango_mock = SetUpPangoMock(&text_renderer);
+
+  const FontSpecInterface::FONT_TYPE font_type
+      = FontSpecInterface::FONTSET_CANDIDATE;
+  text_renderer.pixel_size_cache_[std::make_pair(font_type, "hoge")]
+      = Size(12, 34);
+
+  // The cached size is returned without creating a layout.
+  EXPECT_CALL(*pango_mock, GetContext()).Times(0);
+  const Size actual_size = text_renderer.GetPixelSize(font_type, "hoge");
+  EXPECT_EQ(12, actual_size.width);
+  EXPECT_EQ(34, actual_size.height);
+
+  // The cache is cleared when the fonts are changed.
+  EXPECT_CALL(*font_spec_mock, Reload("Foo"));
+  text_renderer.ReloadFontConfig("Foo");
+  EXPECT_TRUE(text_renderer.pixel_size_cache_.empty());
+}
+
 }  // namespace gtk
 }  // namespace renderer
 }  // namespace mozc
@@ -32,6 +32,7 @@
 #include <windows.h>
 
 #include <sstream>
+#include <vector>
 
 #include "base/coordinates.h"
 #include "base/logging.h"
@@ -207,6 +208,56 @@ std::wstring GetDisplayStringByColumn(
   return display_string;
 }
 
+// Returns true if the row of |index| looks the same in both candidates.
+bool IsSameRow(const commands::Candidates &candidates1,
+               const commands::Candidates &candidates2,
+               int index) {
+  const COLUMN_TYPE kColumnTypes[] =
+      {COLUMN_SHORTCUT, COLUMN_CANDIDATE, COLUMN_DESCRIPTION};
+  const commands::Candidates::Candidate &candidate1 =
+      candidates1.candidate(index);
+  const commands::Candidates::Candidate &candidate2 =
+      candidates2.candidate(index);
+  if (candidate1.has_information_id() != candidate2.has_information_id()) {
+    return false;
+  }
+  for (size_t i = 0; i < arraysize(kColumnTypes); ++i) {
+    if (GetDisplayStringByColumn(candidate1, kColumnTypes[i]) !=
+        GetDisplayStringByColumn(candidate2, kColumnTypes[i])) {
+      return false;
+    }
+  }
+  const bool focused1 = (GetFocusedArrayIndex(candidates1) == index);
+  const bool focused2 = (GetFocusedArrayIndex(candidates2) == index);
+  return focused1 == focused2;
+}
+
+// Stores the geometry of |table_layout| which determines whether the
+// previous rendering can be partially reused.
+void GetLayoutGeometry(const TableLayout &table_layout,
+                       std::vector<int> *geometry) {
+  geometry->clear();
+  const Size total_size = table_layout.GetTotalSize();
+  geometry->push_back(total_size.width);
+  geometry->push_back(total_size.height);
+  geometry->push_back(table_layout.number_of_rows());
+  std::vector<Rect> rects;
+  for (int i = 0; i < table_layout.number_of_columns(); ++i) {
+    rects.push_back(table_layout.GetColumnRect(i));
+  }
+  if (table_layout.number_of_rows() > 0) {
+    rects.push_back(table_layout.GetRowRect(0));
+  }
+  rects.push_back(table_layout.GetVScrollBarRect());
+  rects.push_back(table_layout.GetFooterRect());
+  for (size_t i = 0; i < rects.size(); ++i) {
+    geometry->push_back(rects[i].Left());
+    geometry->push_back(rects[i].Top());
+    geometry->push_back(rects[i].Width());
+    geometry->push_back(rects[i].Height());
+  }
+}
+
 // Loads a DIB from a Win32 resource in the specified module and returns its
 // handle.  This function will fail if you try to load a top-down bitmap in
 // Windows XP.
@@ -233,6 +284,7 @@ CandidateWindow::CandidateWindow()
       footer_logo_display_size_(0, 0),
       metrics_changed_(false),
       mouse_moving_(true),
+      whole_window_damaged_(true),
       text_renderer_(TextRenderer::Create()),
       table_layout_(new TableLayout),
       send_command_interface_(nullptr) {
@@ -371,10 +423,14 @@ void CandidateWindow::OnPaint(CDCHandle dc) {
   this->GetClientRect(&client_rect);
 
   if (dc != nullptr) {
+    paint_rect_ = client_rect;
     CMemoryDC memdc(dc, client_rect);
     DoPaint(memdc.m_hDC);
   } else  {
     CPaintDC paint_dc(this->m_hWnd);
+    // Only the invalidated region is copied to the screen, so the cells
+    // outside of it need not be drawn.
+    paint_rect_ = paint_dc.m_ps.rcPaint;
     { // Create a copy of |paint_dc| and render the candidate strings in it.
       // The image rendered to this |memdc| is to be copied into the original
       // |paint_dc| in its destructor. So, we don't have to explicitly call
@@ -441,14 +497,28 @@ void CandidateWindow::OnSettingChange(UINT uFlags, LPCTSTR /*lpszSection*/) {
 }
 
 void CandidateWindow::UpdateLayout(const commands::Candidates &candidates) {
+  // Keep the previous state to find the region to be redrawn.
+  commands::Candidates previous_candidates;
+  previous_candidates.Swap(candidates_.get());
+  std::vector<int> previous_geometry;
+  bool layout_reusable = table_layout_->IsLayoutFrozen();
+  if (layout_reusable) {
+    GetLayoutGeometry(*table_layout_, &previous_geometry);
+  }
+
   candidates_->CopyFrom(candidates);
 
   // If we detect any change of font parameters, update text renderer
   if (metrics_changed_) {
     text_renderer_->OnThemeChanged();
     metrics_changed_ = false;
+    layout_reusable = false;
   }
 
+  // Redraw the whole window unless the damaged region is found below.
+  damaged_rect_ = Rect(Point(0, 0), Size(0, 0));
+  whole_window_damaged_ = true;
+
   switch (candidates_->category()) {
     case commands::CONVERSION:
     case commands::PREDICTION:
@@ -607,6 +677,62 @@ void CandidateWindow::UpdateLayout(const commands::Candidates &candidates) {
   table_layout_->EnsureCellSize(COLUMN_GAP2, gap2_size);
 
   table_layout_->FreezeLayout();
+
+  if (layout_reusable &&
+      previous_candidates.category() == candidates_->category()) {
+    std::vector<int> geometry;
+    GetLayoutGeometry(*table_layout_, &geometry);
+    if (geometry == previous_geometry) {
+      UpdateDamagedRect(previous_candidates);
+    }
+  }
+}
+
+void CandidateWindow::UpdateDamagedRect(
+    const commands::Candidates &previous_candidates) {
+  DCHECK(table_layout_->IsLayoutFrozen()) << "Table layout is not frozen.";
+  DCHECK_EQ(previous_candidates.candidate_size(),
+            candidates_->candidate_size());
+
+  CRect damaged_rect;
+  for (size_t i = 0; i < candidates_->candidate_size(); ++i) {
+    if (!IsSameRow(previous_candidates, *candidates_, i)) {
+      const CRect row_rect = ToCRect(table_layout_->GetRowRect(i));
+      damaged_rect.UnionRect(&damaged_rect, &row_rect);
+    }
+  }
+
+  if (previous_candidates.footer().SerializeAsString() !=
+          candidates_->footer().SerializeAsString() ||
+      GetIndexGuideString(previous_candidates) !=
+          GetIndexGuideString(*candidates_)) {
+    const CRect footer_rect = ToCRect(table_layout_->GetFooterRect());
+    damaged_rect.UnionRect(&damaged_rect, &footer_rect);
+  }
+
+  if (candidates_->candidate_size() > 0 &&
+      (previous_candidates.size() != candidates_->size() ||
+       previous_candidates.candidate(0).index() !=
+           candidates_->candidate(0).index())) {
+    const CRect vscroll_rect = ToCRect(table_layout_->GetVScrollBarRect());
+    damaged_rect.UnionRect(&damaged_rect, &vscroll_rect);
+  }
+
+  damaged_rect_ = Rect(damaged_rect.left, damaged_rect.top,
+                       damaged_rect.Width(), damaged_rect.Height());
+  whole_window_damaged_ = false;
+}
+
+void CandidateWindow::InvalidateDamagedRect() {
+  if (whole_window_damaged_) {
+    Invalidate();
+    return;
+  }
+  if (damaged_rect_.IsRectEmpty()) {
+    return;
+  }
+  const CRect damaged_rect = ToCRect(damaged_rect_);
+  InvalidateRect(&damaged_rect);
 }
 
 void CandidateWindow::SetSendCommandInterface(
@@ -664,6 +790,10 @@ void CandidateWindow::DrawCells(CDCHandle dc) {
 
     std::vector<TextRenderingInfo> display_list;
     for (size_t i = 0; i < candidates_->candidate_size(); ++i) {
+      CRect row_rect = ToCRect(table_layout_->GetRowRect(i));
+      if (!row_rect.IntersectRect(&row_rect, &paint_rect_)) {
+        continue;
+      }
       const commands::Candidates::Candidate &candidate =
           candidates_->candidate(i);
       const std::wstring display_string =
@@ -115,6 +115,11 @@ class CandidateWindow : public ATL::CWindowImpl<CandidateWindow,
   void set_mouse_moving(bool moving);
 
   void UpdateLayout(const commands::Candidates &candidates);
+
+  // Invalidates the region changed by the last UpdateLayout().  The whole
+  // window is invalidated when the layout is changed, while only the changed
+  // cells are invalidated for focus moves and page flips.
+  void InvalidateDamagedRect();
   void SetSendCommandInterface(
       client::SendCommandInterface *send_command_interface);
 
@@ -136,6 +141,10 @@ class CandidateWindow : public ATL::CWindowImpl<CandidateWindow,
   void DrawBackground(WTL::CDCHandle dc);
   void DrawFrame(WTL::CDCHandle dc);
 
+  // Finds the region to be redrawn by comparing |previous_candidates| with
+  // the current ones, assuming that the layout is unchanged.
+  void UpdateDamagedRect(const commands::Candidates &previous_candidates);
+
   // Handles candidate selection by mouse.
   void HandleMouseEvent(
       UINT nFlags, const WTL::CPoint &point, bool close_candidatewindow);
@@ -154,6 +163,11 @@ class CandidateWindow : public ATL::CWindowImpl<CandidateWindow,
   int indicator_width_;
   bool metrics_changed_;
   bool mouse_moving_;
+  // The region changed by the last UpdateLayout().
+  Rect damaged_rect_;
+  bool whole_window_damaged_;
+  // The region to be painted in the current WM_PAINT.
+  WTL::CRect paint_rect_;
 
   DISALLOW_COPY_AND_ASSIGN(CandidateWindow);
 };
@@ -37,7 +37,9 @@
 #include <d2d1.h>
 #include <dwrite.h>
 
+#include <map>
 #include <memory>
+#include <tuple>
 
 #include "base/logging.h"
 #include "base/system_util.h"
@@ -62,6 +64,38 @@ using ::mozc::renderer::RendererStyleHandler;
 
 namespace {
 
+// The maximum number of the entries in each text cache.  The cache is just
+// cleared when it gets full, which seldom happens since a candidate window
+// shows only a few dozens of strings.
+const size_t kMaxTextCacheSize = 1024;
+
+// Key of the text caches: font type, layout width, layout height and text.
+// The width is -1 for a single line text, and the height is 0 when it is
+// not constrained.
+typedef std::tuple<TextRenderer::FONT_TYPE, int, int, std::wstring>
+    TextCacheKey;
+
+// Caches the sizes of the measured strings.
+typedef std::map<TextCacheKey, Size> TextSizeCache;
+
+bool LookupTextSizeCache(const TextSizeCache &cache, const TextCacheKey &key,
+                         Size *size) {
+  const auto it = cache.find(key);
+  if (it == cache.end()) {
+    return false;
+  }
+  *size = it->second;
+  return true;
+}
+
+void InsertTextSizeCache(const TextCacheKey &key, const Size &size,
+                         TextSizeCache *cache) {
+  if (cache->size() >= kMaxTextCacheSize) {
+    cache->clear();
+  }
+  cache->insert(std::make_pair(key, size));
+}
+
 WTL::CRect ToCRect(const Rect &rect) {
   return WTL::CRect(rect.Left(), rect.Top(), rect.Right(), rect.Bottom());
 }
@@ -206,6 +240,8 @@ class GdiTextRenderer : public TextRenderer {
  private:
   // TextRenderer overrides:
   virtual void OnThemeChanged() {
+    size_cache_.clear();
+
     // delete old fonts
     for (size_t i = 0; i < SIZE_OF_FONT_TYPE; ++i) {
       if (!render_info_[i].font.IsNull()) {
@@ -224,22 +260,36 @@ class GdiTextRenderer : public TextRenderer {
 
   virtual Size MeasureString(FONT_TYPE font_type,
                              const std::wstring &str) const {
+    const TextCacheKey key(font_type, -1, 0, str);
+    Size size;
+    if (LookupTextSizeCache(size_cache_, key, &size)) {
+      return size;
+    }
     const auto previous_font = mem_dc_.SelectFont(render_info_[font_type].font);
     CRect rect;
     mem_dc_.DrawTextW(str.c_str(), str.length(), &rect,
                       DT_NOPREFIX | DT_LEFT | DT_SINGLELINE | DT_CALCRECT);
     mem_dc_.SelectFont(previous_font);
-    return Size(rect.Width(), rect.Height());
+    size = Size(rect.Width(), rect.Height());
+    InsertTextSizeCache(key, size, &size_cache_);
+    return size;
   }
 
   virtual Size MeasureStringMultiLine(
       FONT_TYPE font_type, const std::wstring &str, const int width) const {
+    const TextCacheKey key(font_type, width, 0, str);
+    Size size;
+    if (LookupTextSizeCache(size_cache_, key, &size)) {
+      return size;
+    }
     const auto previous_font = mem_dc_.SelectFont(render_info_[font_type].font);
     CRect rect(0, 0, width, 0);
     mem_dc_.DrawTextW(str.c_str(), str.length(), &rect,
                       DT_NOPREFIX | DT_LEFT | DT_WORDBREAK | DT_CALCRECT);
     mem_dc_.SelectFont(previous_font);
-    return Size(rect.Width(), rect.Height());
+    size = Size(rect.Width(), rect.Height());
+    InsertTextSizeCache(key, size, &size_cache_);
+    return size;
   }
 
   virtual void RenderText(CDCHandle dc,
@@ -277,6 +327,7 @@ class GdiTextRenderer : public TextRenderer {
   };
   std::unique_ptr<RenderInfo[]> render_info_;
   mutable CDC mem_dc_;
+  mutable TextSizeCache size_cache_;
 
   DISALLOW_COPY_AND_ASSIGN(GdiTextRenderer);
 };
@@ -324,6 +375,9 @@ class DirectWriteTextRenderer : public TextRenderer {
 
   // TextRenderer overrides:
   virtual void OnThemeChanged() {
+    size_cache_.clear();
+    layout_cache_.clear();
+
     // delete old fonts
     render_info_.clear();
     render_info_.resize(SIZE_OF_FONT_TYPE);
@@ -424,24 +478,57 @@ class DirectWriteTextRenderer : public TextRenderer {
     dc_render_target_->SetTransform(D2D1::Matrix3x2F::Identity());
     for (size_t i = 0; i < display_list.size(); ++i) {
       const auto &item = display_list[i];
-      const D2D1_RECT_F render_rect = {
+      const D2D1_POINT_2F origin = {
         static_cast<float>(item.rect.Left()),
         static_cast<float>(item.rect.Top()),
-        static_cast<float>(item.rect.Right()),
-        static_cast<float>(item.rect.Bottom()),
       };
-      dc_render_target_->DrawText(item.text.data(),
-                                  item.text.size(),
-                                  render_info_[font_type].format_to_render,
-                                  render_rect,
-                                  brush,
-                                  option);
+      // The text layout is reused as long as the text and the cell size are
+      // unchanged, which is typical for focus moves.
+      CComPtr<IDWriteTextLayout> layout =
+          GetRenderLayout(font_type, item.text, item.rect.size);
+      if (layout == nullptr) {
+        continue;
+      }
+      dc_render_target_->DrawTextLayout(origin, layout, brush, option);
     }
     return dc_render_target_->EndDraw();
   }
 
+  // Returns the text layout to render |text| in a rectangle of |size|,
+  // which is equivalent to what ID2D1RenderTarget::DrawText creates.
+  CComPtr<IDWriteTextLayout> GetRenderLayout(FONT_TYPE font_type,
+                                             const std::wstring &text,
+                                             const Size &size) const {
+    const TextCacheKey key(font_type, size.width, size.height, text);
+    const auto it = layout_cache_.find(key);
+    if (it != layout_cache_.end()) {
+      return it->second;
+    }
+    CComPtr<IDWriteTextLayout> layout;
+    const HRESULT hr = dwrite_factory_->CreateTextLayout(
+        text.data(),
+        text.size(),
+        render_info_[font_type].format_to_render,
+        static_cast<FLOAT>(size.width),
+        static_cast<FLOAT>(size.height),
+        &layout);
+    if (FAILED(hr)) {
+      return nullptr;
+    }
+    if (layout_cache_.size() >= kMaxTextCacheSize) {
+      layout_cache_.clear();
+    }
+    layout_cache_.insert(std::make_pair(key, layout));
+    return layout;
+  }
+
   Size MeasureStringImpl(FONT_TYPE font_type, const std::wstring &str,
                          const int width, bool use_width) const {
+    const TextCacheKey key(font_type, (use_width ? width : -1), 0, str);
+    Size size;
+    if (LookupTextSizeCache(size_cache_, key, &size)) {
+      return size;
+    }
     HRESULT hr = S_OK;
     const FLOAT kLayoutLimit = 100000.0f;
     CComPtr<IDWriteTextLayout> layout;
@@ -459,8 +546,10 @@ class DirectWriteTextRenderer : public TextRenderer {
     if (FAILED(hr)) {
       return Size();
     }
-    return Size(ceilf(metrix.widthIncludingTrailingWhitespace),
+    size = Size(ceilf(metrix.widthIncludingTrailingWhitespace),
                 ceilf(metrix.height));
+    InsertTextSizeCache(key, size, &size_cache_);
+    return size;
   }
 
   static D2D1_COLOR_F ToD2DColor(COLORREF color_ref) {
@@ -556,6 +645,8 @@ class DirectWriteTextRenderer : public TextRenderer {
   mutable CComPtr<ID2D1DCRenderTarget> dc_render_target_;
   CComPtr<IDWriteGdiInterop> dwrite_interop_;
   std::vector<RenderInfo> render_info_;
+  mutable TextSizeCache size_cache_;
+  mutable std::map<TextCacheKey, CComPtr<IDWriteTextLayout>> layout_cache_;
 
   DISALLOW_COPY_AND_ASSIGN(DirectWriteTextRenderer);
 };
@@ -431,13 +431,13 @@ void WindowManager::UpdateLayoutIMM32(
     // in terms of visual effect on DWM-enabled desktop.
     cascading_window_->SendMessageW(WM_NCACTIVATE, FALSE);
     if (candidate_changed) {
-      main_window_->Invalidate();
-      cascading_window_->Invalidate();
+      main_window_->InvalidateDamagedRect();
+      cascading_window_->InvalidateDamagedRect();
     }
   } else {
     // no cascading window
     if (candidate_changed) {
-      main_window_->Invalidate();
+      main_window_->InvalidateDamagedRect();
     }
     cascading_window_->ShowWindow(SW_HIDE);
   }
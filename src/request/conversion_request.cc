@@ -29,6 +29,7 @@
 
 #include "request/conversion_request.h"
 
+#include "base/clock.h"
 #include "base/logging.h"
 #include "config/config_handler.h"
 #include "protocol/commands.pb.h"
@@ -39,6 +40,10 @@ ConversionRequest::ConversionRequest()
     : composer_(NULL),
       request_(&commands::Request::default_instance()),
       config_(&config::ConfigHandler::DefaultConfig()),
+      workspace_(NULL),
+      lattice_(NULL),
+      cancel_flag_(NULL),
+      deadline_ticks_(0),
       use_actual_converter_for_realtime_conversion_(false),
       composer_key_selection_(CONVERSION_KEY),
       skip_slow_rewriters_(false),
@@ -50,6 +55,10 @@ ConversionRequest::ConversionRequest(const composer::Composer *c,
     : composer_(c),
       request_(request),
       config_(config),
+      workspace_(NULL),
+      lattice_(NULL),
+      cancel_flag_(NULL),
+      deadline_ticks_(0),
       use_actual_converter_for_realtime_conversion_(false),
       composer_key_selection_(CONVERSION_KEY),
       skip_slow_rewriters_(false),
@@ -88,6 +97,42 @@ void ConversionRequest::set_config(const config::Config *config) {
   config_ = config;
 }
 
+ConverterWorkspace *ConversionRequest::workspace() const {
+  return workspace_;
+}
+
+void ConversionRequest::set_workspace(ConverterWorkspace *workspace) {
+  workspace_ = workspace;
+}
+
+Lattice *ConversionRequest::lattice() const {
+  return lattice_;
+}
+
+void ConversionRequest::set_lattice(Lattice *lattice) {
+  lattice_ = lattice;
+}
+
+void ConversionRequest::set_cancel_flag(const std::atomic<bool> *cancel_flag) {
+  cancel_flag_ = cancel_flag;
+}
+
+void ConversionRequest::SetTimeout(uint32 timeout_msec) {
+  if (timeout_msec == 0) {
+    deadline_ticks_ = 0;
+    return;
+  }
+  deadline_ticks_ =
+      Clock::GetTicks() + Clock::GetFrequency() * timeout_msec / 1000;
+}
+
+bool ConversionRequest::IsCanceled() const {
+  if (cancel_flag_ != NULL && cancel_flag_->load(std::memory_order_relaxed)) {
+    return true;
+  }
+  return deadline_ticks_ != 0 && Clock::GetTicks() >= deadline_ticks_;
+}
+
 bool ConversionRequest::use_actual_converter_for_realtime_conversion() const {
   return use_actual_converter_for_realtime_conversion_;
 }
@@ -132,6 +177,10 @@ void ConversionRequest::CopyFrom(const ConversionRequest &request) {
   composer_ = request.composer_;
   request_ = request.request_;
   config_ = request.config_;
+  workspace_ = request.workspace_;
+  lattice_ = request.lattice_;
+  cancel_flag_ = request.cancel_flag_;
+  deadline_ticks_ = request.deadline_ticks_;
   use_actual_converter_for_realtime_conversion_ =
       request.use_actual_converter_for_realtime_conversion_;
   composer_key_selection_ = request.composer_key_selection_;
@@ -30,11 +30,15 @@
 #ifndef MOZC_REQUEST_CONVERSION_REQUEST_H_
 #define MOZC_REQUEST_CONVERSION_REQUEST_H_
 
+#include <atomic>
 #include <string>
 
 #include "base/port.h"
 
 namespace mozc {
+class ConverterWorkspace;
+class Lattice;
+
 // Protocol buffers, commands::Request and config::Config should be forward
 // declaration instead of include header files.  Otherwise, we need to specify
 // 'hard_dependency' to all affected rules in the GYP files.
@@ -98,6 +102,27 @@ class ConversionRequest {
   const config::Config &config() const;
   void set_config(const config::Config *config);
 
+  // Scratch state the converter may reuse across conversions.  NULL (default)
+  // makes the converter allocate its buffers on every conversion.
+  ConverterWorkspace *workspace() const;
+  void set_workspace(ConverterWorkspace *workspace);
+
+  // Lattice the immutable converter builds into instead of the one cached by
+  // Segments.  Conversions of the same key sharing it look up the dictionary
+  // only once.  NULL (default) uses the lattice of Segments.
+  Lattice *lattice() const;
+  void set_lattice(Lattice *lattice);
+
+  // Cancellation of the request.  The converter, the predictors and the
+  // rewriters check IsCanceled() between their steps and, once it becomes
+  // true, skip the remaining work and return what they have so far.  The
+  // request is canceled when |cancel_flag| (not owned; NULL by default) is
+  // set or when the deadline passes.
+  void set_cancel_flag(const std::atomic<bool> *cancel_flag);
+  // Sets the deadline to |timeout_msec| milliseconds from now.  0 clears it.
+  void SetTimeout(uint32 timeout_msec);
+  bool IsCanceled() const;
+
   void CopyFrom(const ConversionRequest &request);
 
   // TODO(noriyukit): Remove these methods after removing skip_slow_rewriters_
@@ -118,9 +143,22 @@ class ConversionRequest {
   // Input config.
   const config::Config *config_;
 
+  // Optional scratch state of the converter, not owned.
+  ConverterWorkspace *workspace_;
+
+  // Optional lattice shared by conversions, not owned.
+  Lattice *lattice_;
+
+  // Optional cancellation flag, not owned.
+  const std::atomic<bool> *cancel_flag_;
+
+  // Deadline in Clock::GetTicks().  0 means no deadline.
+  uint64 deadline_ticks_;
+
   // If true, insert a top candidate from the actual (non-immutable) converter
-  // to realtime conversion results. Note that setting this true causes a big
-  // performance loss (3 times slower).
+  // to realtime conversion results. Note that setting this true causes a
+  // performance loss even though the converter shares the lattice with the
+  // realtime conversion; see DictionaryPredictor.
   bool use_actual_converter_for_realtime_conversion_;
 
   // Which composer's method to use for conversion key; see the comment around
@@ -29,44 +29,211 @@
 
 #include "rewriter/calculator/calculator_interface.h"
 
-// Following include directives are used in parser.c included by anonymous
-// namespace. We need to do this outside the namespace, otherwise features
-// declared in those header files are included by the namespace as well, which
-// causes build error.
-#include <assert.h>
-#include <stdio.h>
-#ifdef OS_WIN
-#include <float.h>
-#endif
-#include <string.h>
-
+#include <cerrno>
 #include <cmath>
-#include <map>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <string>
-#include <vector>
 
-#include "base/compiler_specific.h"
 #include "base/logging.h"
-#include "base/number_util.h"
+#include "base/port.h"
 #include "base/singleton.h"
 #include "base/string_piece.h"
 #include "base/util.h"
 
-// parser.c is a source file auto-generated by Lemon Parser.  It is not compiled
-// directly and is included as a part of calculator.cc.  It defines global
-// symbols with the same names as symbols defined in other files, so we put the
-// whole thing in an anonymous namespace.
+namespace mozc {
 namespace {
 
-bool IsFinite(double x) {
-  return std::isfinite(x);
-}
+enum TokenType {
+  INTEGER,
+  PLUS,
+  MINUS,
+  TIMES,
+  DIVIDE,
+  MOD,
+  POW,
+  LP,
+  RP,
+  UNARY_PLUS,
+  UNARY_MINUS,
+};
 
-#include "rewriter/calculator/parser.c"
-}  // namespace
+// Evaluates a stream of tokens by operator precedence with fixed-size
+// stacks.  The precedence and the associativity are the same as the former
+// Lemon grammar:
+//   %left  PLUS MINUS.
+//   %left  DIVIDE TIMES MOD.
+//   %right POW UNARY_PLUS UNARY_MINUS.
+// PLUS and MINUS are treated as unary operators when an operand is expected.
+class Evaluator {
+ public:
+  Evaluator()
+      : num_values_(0), num_operators_(0), expect_operand_(true) {}
 
-namespace mozc {
-namespace {
+  bool AddValue(double value) {
+    if (!expect_operand_ || num_values_ == kMaxStackDepth) {
+      return false;
+    }
+    values_[num_values_++] = value;
+    expect_operand_ = false;
+    return true;
+  }
+
+  bool AddOperator(TokenType type) {
+    if (expect_operand_) {
+      // Only prefix operators are allowed in front of an operand.
+      if (type == PLUS) {
+        return PushOperator(UNARY_PLUS);
+      }
+      if (type == MINUS) {
+        return PushOperator(UNARY_MINUS);
+      }
+      if (type == LP) {
+        return PushOperator(LP);
+      }
+      return false;
+    }
+    if (type == LP) {
+      return false;
+    }
+    if (type == RP) {
+      while (num_operators_ > 0 && operators_[num_operators_ - 1] != LP) {
+        if (!Reduce()) {
+          return false;
+        }
+      }
+      if (num_operators_ == 0) {
+        return false;
+      }
+      --num_operators_;  // Pops LP.
+      return true;
+    }
+    while (num_operators_ > 0 && operators_[num_operators_ - 1] != LP &&
+           ShouldReduceBefore(operators_[num_operators_ - 1], type)) {
+      if (!Reduce()) {
+        return false;
+      }
+    }
+    expect_operand_ = true;
+    return PushOperator(type);
+  }
+
+  // Returns false on a syntax error or an arithmetic error such as overflow
+  // and divide-by-zero.
+  bool Finish(double *result) {
+    if (expect_operand_) {
+      return false;
+    }
+    while (num_operators_ > 0) {
+      if (operators_[num_operators_ - 1] == LP || !Reduce()) {
+        return false;
+      }
+    }
+    DCHECK_EQ(1, num_values_);
+    *result = values_[0];
+    return IsFinite(*result);
+  }
+
+ private:
+  // Lemon's default stack depth.
+  static const size_t kMaxStackDepth = 100;
+
+  static bool IsFinite(double x) {
+    return std::isfinite(x);
+  }
+
+  static int GetPrecedence(TokenType type) {
+    switch (type) {
+      case PLUS:
+      case MINUS:
+        return 1;
+      case TIMES:
+      case DIVIDE:
+      case MOD:
+        return 2;
+      default:
+        return 3;
+    }
+  }
+
+  // Returns true if |top| on the stack is applied before |next| is pushed.
+  static bool ShouldReduceBefore(TokenType top, TokenType next) {
+    const int top_precedence = GetPrecedence(top);
+    const int next_precedence = GetPrecedence(next);
+    if (top_precedence != next_precedence) {
+      return top_precedence > next_precedence;
+    }
+    // POW and the unary operators are right associative.
+    return next_precedence != 3;
+  }
+
+  bool PushOperator(TokenType type) {
+    if (num_operators_ == kMaxStackDepth) {
+      return false;
+    }
+    operators_[num_operators_++] = type;
+    return true;
+  }
+
+  // Applies the operator on the top of the stack.
+  bool Reduce() {
+    DCHECK_GT(num_operators_, 0);
+    const TokenType type = operators_[--num_operators_];
+    if (type == UNARY_PLUS || type == UNARY_MINUS) {
+      DCHECK_GT(num_values_, 0);
+      if (type == UNARY_MINUS) {
+        values_[num_values_ - 1] = -values_[num_values_ - 1];
+      }
+      return true;
+    }
+    DCHECK_GT(num_values_, 1);
+    const double rhs = values_[--num_values_];
+    const double lhs = values_[num_values_ - 1];
+    double value = 0.0;
+    switch (type) {
+      case PLUS:
+        value = lhs + rhs;
+        break;
+      case MINUS:
+        value = lhs - rhs;
+        break;
+      case TIMES:
+        value = lhs * rhs;
+        break;
+      case DIVIDE:
+        if (rhs == 0.0) {
+          return false;
+        }
+        value = lhs / rhs;
+        break;
+      case MOD:
+        if (rhs == 0.0) {
+          return false;
+        }
+        value = std::fmod(lhs, rhs);
+        break;
+      case POW:
+        value = std::pow(lhs, rhs);
+        break;
+      default:
+        return false;
+    }
+    if (!IsFinite(value)) {
+      return false;
+    }
+    values_[num_values_ - 1] = value;
+    return true;
+  }
+
+  double values_[kMaxStackDepth];
+  TokenType operators_[kMaxStackDepth];
+  size_t num_values_;
+  size_t num_operators_;
+  bool expect_operand_;
+
+  DISALLOW_COPY_AND_ASSIGN(Evaluator);
+};
 
 class CalculatorImpl : public CalculatorInterface {
  public:
@@ -75,41 +242,56 @@ class CalculatorImpl : public CalculatorInterface {
   virtual bool CalculateString(const string &key, string *result) const;
 
  private:
-  typedef std::vector<std::pair<int, double> > TokenSequence;
-
-  // Max byte length of operator character
-  static const size_t kMaxLengthOfOperator = 3;
   static const size_t kBufferSizeOfOutputNumber = 32;
+  // Max length of a number token.  Longer numbers are rejected.
+  static const size_t kMaxLengthOfNumber = 64;
 
-  // Tokenizes |expression_body| and sets the tokens into |tokens|.
-  // It returns false if |expression_body| includes an invalid token or
-  // does not include both of a number token and an operator token.
-  // Parenthesis is not considered as an operator.
-  bool Tokenize(StringPiece expression_body, TokenSequence *tokens) const;
+  // Returns false if |expression_body| contains a byte which never appears in
+  // an expression.  This rejects most of the keys with a single table scan.
+  bool MayBeExpression(StringPiece expression_body) const;
 
-  // Perform calculation with a given sequence of token.
-  bool CalculateTokens(const TokenSequence &tokens,
-                       double *result_value) const;
+  // Tokenizes |expression_body| and evaluates the tokens without heap
+  // allocation.  It returns false if |expression_body| includes an invalid
+  // token, does not include both of a number token and an operator token, or
+  // the calculation fails.  Parenthesis is not considered as an operator.
+  bool Evaluate(StringPiece expression_body, double *result_value) const;
 
-  // Mapping from operator character such as '+' to the corresponding
-  // token type such as PLUS.
-  std::map<string, int> operator_map_;
+  bool is_expression_byte_[256];
 };
 
+// Returns the half-width form of |ucs4| if it is a full-width ASCII
+// character, in the same way as Util::FullWidthAsciiToHalfWidthAscii().
+char32 ToHalfWidthAscii(char32 ucs4) {
+  if (ucs4 == 0x3000) {  // "　"
+    return ' ';
+  }
+  if (ucs4 == 0x2212) {  // "−"
+    return '-';
+  }
+  // "！" to "～" except for "－".
+  if (ucs4 >= 0xFF01 && ucs4 <= 0xFF5E && ucs4 != 0xFF0D) {
+    return ucs4 - 0xFEE0;
+  }
+  return ucs4;
+}
+
+bool IsEqualSign(StringPiece str) {
+  return str == "=" || str == "＝";
+}
+
 CalculatorImpl::CalculatorImpl() {
-  operator_map_["+"] = PLUS;
-  operator_map_["-"] = MINUS;
-  // "ー". It is called cho-ompu, onbiki, bobiki, or "nobashi-bou" casually.
-  // It is not a full-width hyphen, and may appear in conversion segments by
-  // typing '-' more than one time continuouslly.
-  operator_map_["ー"] = MINUS;
-  operator_map_["*"] = TIMES;
-  operator_map_["/"] = DIVIDE;
-  operator_map_["・"] = DIVIDE;  // "･". Consider it as "/".
-  operator_map_["%"] = MOD;
-  operator_map_["^"] = POW;
-  operator_map_["("] = LP;
-  operator_map_[")"] = RP;
+  memset(is_expression_byte_, 0, sizeof(is_expression_byte_));
+  for (const char *c = "0123456789. \t=+-*/%^()"; *c != '\0'; ++c) {
+    is_expression_byte_[static_cast<uint8>(*c)] = true;
+  }
+  // Continuation bytes and the lead bytes of the full-width characters,
+  // "−", "ー" and "・".
+  for (int i = 0x80; i <= 0xBF; ++i) {
+    is_expression_byte_[i] = true;
+  }
+  is_expression_byte_[0xE2] = true;
+  is_expression_byte_[0xE3] = true;
+  is_expression_byte_[0xEF] = true;
 }
 
 // Basic arithmetic operations are available.
@@ -120,35 +302,29 @@ bool CalculatorImpl::CalculateString(const string &key, string *result) const {
     LOG(ERROR) << "Key is empty.";
     return false;
   }
-  string normalized_key;
-  Util::FullWidthAsciiToHalfWidthAscii(key, &normalized_key);
 
+  const StringPiece whole_key(key);
+  const size_t front_length = Util::OneCharLen(key.c_str());
   StringPiece expression_body;
-  if (normalized_key.front() == '=') {
+  if (IsEqualSign(whole_key.substr(0, front_length))) {
     // Expression starts with '='.
-    expression_body =
-        StringPiece(normalized_key.data() + 1, normalized_key.size() - 1);
-  } else if (normalized_key.back() == '=') {
+    expression_body = whole_key.substr(front_length);
+  } else if (Util::EndsWith(whole_key, "=")) {
     // Expression is ended with '='.
-    expression_body =
-        StringPiece(normalized_key.data(), normalized_key.size() - 1);
+    expression_body = whole_key.substr(0, whole_key.size() - 1);
+  } else if (Util::EndsWith(whole_key, "＝")) {
+    expression_body = whole_key.substr(0, whole_key.size() - strlen("＝"));
   } else {
     // Expression does not start nor end with '='.
     result->clear();
     return false;
   }
 
-  TokenSequence tokens;
-  if (!Tokenize(expression_body, &tokens)) {
-    // normalized_key is not valid sequence of tokens
-    result->clear();
-    return false;
-  }
-
   double result_value = 0.0;
-  if (!CalculateTokens(tokens, &result_value)) {
-    // Calculation is failed. Syntax error or arithmetic error such as
-    // overflow, divide-by-zero, etc.
+  if (!MayBeExpression(expression_body) ||
+      !Evaluate(expression_body, &result_value)) {
+    // |key| is not a valid expression, or calculation is failed by a syntax
+    // error or an arithmetic error such as overflow, divide-by-zero, etc.
     result->clear();
     return false;
   }
@@ -158,88 +334,116 @@ bool CalculatorImpl::CalculateString(const string &key, string *result) const {
   return true;
 }
 
-bool CalculatorImpl::Tokenize(StringPiece expression_body,
-                              TokenSequence *tokens) const {
+bool CalculatorImpl::MayBeExpression(StringPiece expression_body) const {
+  for (size_t i = 0; i < expression_body.size(); ++i) {
+    if (!is_expression_byte_[static_cast<uint8>(expression_body[i])]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool CalculatorImpl::Evaluate(StringPiece expression_body,
+                              double *result_value) const {
+  DCHECK(result_value);
   const char *current = expression_body.data();
-  const char *end     = expression_body.data() + expression_body.size();
+  const char *end = expression_body.data() + expression_body.size();
   int num_operator = 0;  // Number of operators appeared
-  int num_value    = 0;  // Number of values appeared
-
-  DCHECK(tokens);
-  tokens->clear();
+  int num_value = 0;     // Number of values appeared
+  Evaluator evaluator;
 
   while (current < end) {
+    size_t mblen = 0;
+    char32 c = ToHalfWidthAscii(Util::UTF8ToUCS4(current, end, &mblen));
     // Skip spaces
-    while ((*current == ' ') || (*current == '\t')) {
-      ++current;
+    while ((c == ' ') || (c == '\t')) {
+      current += mblen;
+      if (current == end) {
+        // Spaces at the end are invalid.
+        return false;
+      }
+      c = ToHalfWidthAscii(Util::UTF8ToUCS4(current, end, &mblen));
     }
-    const char *token_begin = current;
 
     // Read value token
-    while (((*current >= '0') && (*current <= '9')) || (*current == '.')) {
-      ++current;
-    }
-    if (token_begin < current) {
-      string number_token(token_begin, current - token_begin);
-      double value = 0.0;
-      if (!NumberUtil::SafeStrToDouble(number_token, &value)) {
+    if (((c >= '0') && (c <= '9')) || (c == '.')) {
+      char number_token[kMaxLengthOfNumber + 1];
+      size_t length = 0;
+      do {
+        if (length == kMaxLengthOfNumber) {
+          return false;
+        }
+        number_token[length++] = static_cast<char>(c);
+        current += mblen;
+        if (current == end) {
+          break;
+        }
+        c = ToHalfWidthAscii(Util::UTF8ToUCS4(current, end, &mblen));
+      } while (((c >= '0') && (c <= '9')) || (c == '.'));
+      number_token[length] = '\0';
+
+      char *end_ptr = nullptr;
+      errno = 0;
+      const double value = std::strtod(number_token, &end_ptr);
+      if (errno != 0 || end_ptr != number_token + length ||
+          !std::isfinite(value) || !evaluator.AddValue(value)) {
         return false;
       }
-      tokens->push_back(std::make_pair(INTEGER, value));
       ++num_value;
       continue;
     }
 
     // Read operator token
-    for (size_t length = 1; length <= kMaxLengthOfOperator; ++length) {
-      if (current + length > end) {
+    TokenType type;
+    switch (c) {
+      case '+':
+        type = PLUS;
+        break;
+      case '-':
+      // "ー". It is called cho-ompu, onbiki, bobiki, or "nobashi-bou"
+      // casually.  It is not a full-width hyphen, and may appear in
+      // conversion segments by typing '-' more than one time continuouslly.
+      case 0x30FC:
+        type = MINUS;
+        break;
+      case '*':
+        type = TIMES;
+        break;
+      case '/':
+      case 0x30FB:  // "・". Consider it as "/".
+        type = DIVIDE;
+        break;
+      case '%':
+        type = MOD;
+        break;
+      case '^':
+        type = POW;
+        break;
+      case '(':
+        type = LP;
+        break;
+      case ')':
+        type = RP;
+        break;
+      default:
         // Invalid token
         return false;
-      }
-      string window(current, length);
-      std::map<string, int>::const_iterator op_it = operator_map_.find(window);
-      if (op_it == operator_map_.end()) {
-        continue;
-      }
-      tokens->push_back(std::make_pair(op_it->second, 0.0));
-      current += length;
-      // Does not count parenthesis as an operator.
-      if ((op_it->second != LP) && (op_it->second != RP)) {
-        ++num_operator;
-      }
-      break;
     }
-    if (token_begin < current) {
-      continue;
+    if (!evaluator.AddOperator(type)) {
+      return false;
+    }
+    current += mblen;
+    // Does not count parenthesis as an operator.
+    if ((type != LP) && (type != RP)) {
+      ++num_operator;
     }
-
-    // Invalid token
-    return false;
   }
 
   if (num_operator == 0 || num_value == 0) {
     // Must contain at least one operator and one value.
     return false;
   }
-  return true;
-}
-
-bool CalculatorImpl::CalculateTokens(const TokenSequence &tokens,
-                                     double *result_value) const {
-  DCHECK(result_value);
-  void *parser = ParseAlloc(malloc);
-  Result result;
-  for (size_t i = 0; i < tokens.size(); ++i) {
-    Parse(parser, tokens[i].first, tokens[i].second, &result);
-  }
-  Parse(parser, 0, 0.0, &result);
-  ParseFree(parser, free);
-
-  if (result.error_type != Result::ACCEPTED) {
-    return false;
-  }
-  *result_value = result.value;
-  return true;
+  return evaluator.Finish(result_value);
 }
 
 CalculatorInterface *g_calculator = NULL;
@@ -41,16 +41,6 @@
       'dependencies': [
         '../../base/base.gyp:base',
       ],
-      'msvs_disabled_warnings': [
-        # switch statement contains 'default' but no 'case' labels
-        # http://msdn.microsoft.com/en-us/library/te26h1tz.aspx
-        # The parser code generated by Lemon parser contains this.
-        '4065',
-        # 'type' : forcing value to bool 'true' or 'false'
-        # (performance warning)
-        # http://msdn.microsoft.com/en-us/library/b6801kcy.aspx
-        '4800',
-      ],
     },
     {
       'target_name': 'calculator_mock',
@@ -128,6 +128,33 @@ TEST(CalculatorTest, BasicTest) {
   VerifyCalculationInString(calculator, "7472.4-7465.6=", "6.8");
 }
 
+TEST(CalculatorTest, PrecedenceTest) {
+  CalculatorInterface *calculator = CalculatorFactory::GetCalculator();
+
+  VerifyCalculation(calculator, "1+2*3=", "7");
+  VerifyCalculation(calculator, "10-4-3=", "3");
+  VerifyCalculation(calculator, "12/2/3=", "2");
+  // '^' and the unary operators are right associative.
+  VerifyCalculation(calculator, "2^3^2=", "512");
+  VerifyCalculation(calculator, "-2^2=", "-4");
+  VerifyCalculation(calculator, "2^-1=", "0.5");
+  VerifyCalculation(calculator, "--3=", "3");
+  VerifyCalculation(calculator, "+3*-2=", "-6");
+
+  // Syntax errors.
+  VerifyRejection(calculator, "1+=");
+  VerifyRejection(calculator, "*1+2=");
+  VerifyRejection(calculator, "(1+2=");
+  VerifyRejection(calculator, "1+2)=");
+  VerifyRejection(calculator, "1 2+3=");
+  VerifyRejection(calculator, "1.2.3+1=");
+  // Arithmetic errors.
+  VerifyRejection(calculator, "1/0=");
+  VerifyRejection(calculator, "1%0=");
+  VerifyRejection(calculator, "10^1000=");
+  VerifyRejection(calculator, "(-8)^0.5=");
+}
+
 // Test large number of queries.  Test data is located at
 // data/test/calculator/testset.txt.
 // In this file, each test case is written in one line in the format
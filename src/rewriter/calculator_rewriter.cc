@@ -53,12 +53,30 @@ CalculatorRewriter::CalculatorRewriter(
 CalculatorRewriter::~CalculatorRewriter() {}
 
 int CalculatorRewriter::capability(const ConversionRequest &request) const {
+  if (!request.config().use_calculator()) {
+    return RewriterInterface::NOT_AVAILABLE;
+  }
   if (request.request().mixed_conversion()) {
     return RewriterInterface::ALL;
   }
   return RewriterInterface::CONVERSION;
 }
 
+// The calculator only accepts the expressions starting or ending with '='.
+bool CalculatorRewriter::IsTriggeredBy(const ConversionRequest &request,
+                                       const Segments &segments) {
+  const size_t segments_size = segments.conversion_segments_size();
+  if (!request.config().use_calculator() || segments_size == 0) {
+    return false;
+  }
+  const string &first_key = segments.conversion_segment(0).key();
+  const string &last_key = segments.conversion_segment(segments_size - 1).key();
+  return Util::StartsWith(first_key, "=") ||
+         Util::StartsWith(first_key, "＝") ||
+         Util::EndsWith(last_key, "=") ||
+         Util::EndsWith(last_key, "＝");
+}
+
 // Rewrites candidates when conversion segments of |segments| represents an
 // expression that can be calculated. In such case, if |segments| consists
 // of multiple segments, it merges them by calling ConverterInterface::
@@ -54,6 +54,20 @@ class CalculatorRewriter : public RewriterInterface {
   virtual bool Rewrite(const ConversionRequest &request,
                        Segments *segments) const;
 
+  virtual bool has_trigger() const {
+    return true;
+  }
+
+  virtual bool IsTriggered(const ConversionRequest &request,
+                           const Segments &segments) const {
+    return IsTriggeredBy(request, segments);
+  }
+
+  // Returns false if Rewrite() never modifies |segments|.  It is also used
+  // as the trigger of LazyRewriter.
+  static bool IsTriggeredBy(const ConversionRequest &request,
+                            const Segments &segments);
+
  private:
   // Inserts a candidate with the string into the |segment|.
   // Position of insertion is indicated by |insert_pos|. It returns false if
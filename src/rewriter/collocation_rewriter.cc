@@ -32,6 +32,7 @@
 #include <algorithm>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "base/flags.h"
@@ -552,6 +553,26 @@ class CollocationRewriter::CollocationFilter {
     return filter_->Exists(id);
   }
 
+  // Returns the index of the first of |rights| that makes a collocation with
+  // |left|, or rights.size() if none.  All the pairs are fingerprinted first
+  // so that the filter can prefetch them at once.  |rights| must not contain
+  // an empty string.
+  size_t FindFirst(const string &left,
+                   const std::vector<string> &rights) const {
+    if (left.empty() || rights.empty()) {
+      return rights.size();
+    }
+    std::vector<uint64> ids(rights.size());
+    string key(left);
+    for (size_t i = 0; i < rights.size(); ++i) {
+      DCHECK(!rights[i].empty());
+      key.resize(left.size());
+      key.append(rights[i]);
+      ids[i] = Hash::Fingerprint(key);
+    }
+    return filter_->FindFirst(ids.data(), ids.size());
+  }
+
  private:
   std::unique_ptr<ExistenceFilter> filter_;
 
@@ -621,9 +642,9 @@ bool CollocationRewriter::RewriteFromPrevSegment(
 
   const size_t i_max = std::min(seg->candidates_size(), kCandidateSize);
 
-  // Reuse |curs| and |cur| in the loop as this method is performance critical.
-  std::vector<string> curs;
-  string cur;
+  // Reuse |curs| and |normalized_curs| in the loop as this method is
+  // performance critical.
+  std::vector<string> curs, normalized_curs;
   for (size_t i = 0; i < i_max; ++i) {
     if (seg->candidate(i).cost > seg->candidate(0).cost + kMaxCostDiff) {
       continue;
@@ -639,19 +660,24 @@ bool CollocationRewriter::RewriteFromPrevSegment(
       continue;
     }
 
-    for (int j = 0; j < curs.size(); ++j) {
-      cur.clear();
+    normalized_curs.clear();
+    for (size_t j = 0; j < curs.size(); ++j) {
+      string cur;
       CollocationUtil::GetNormalizedScript(curs[j], false, &cur);
-      if (collocation_filter_->Exists(prev, cur)) {
-        VLOG_IF(3, i != 0) << prev << cur << " "
-                           << seg->candidate(0).value << "->"
-                           << seg->candidate(i).value;
-        seg->move_candidate(i, 0);
-        seg->mutable_candidate(0)->attributes
-            |= Segment::Candidate::CONTEXT_SENSITIVE;
-        return true;
+      if (!cur.empty()) {
+        normalized_curs.push_back(std::move(cur));
       }
     }
+    const size_t found = collocation_filter_->FindFirst(prev, normalized_curs);
+    if (found < normalized_curs.size()) {
+      VLOG_IF(3, i != 0) << prev << normalized_curs[found] << " "
+                         << seg->candidate(0).value << "->"
+                         << seg->candidate(i).value;
+      seg->move_candidate(i, 0);
+      seg->mutable_candidate(0)->attributes
+          |= Segment::Candidate::CONTEXT_SENSITIVE;
+      return true;
+    }
   }
   return false;
 }
@@ -661,15 +687,18 @@ bool CollocationRewriter::RewriteUsingNextSegment(Segment *next_seg,
   const size_t i_max = std::min(seg->candidates_size(), kCandidateSize);
   const size_t j_max = std::min(next_seg->candidates_size(), kCandidateSize);
 
-  // Cache the results for the next segment
-  std::vector<int> next_seg_ok(j_max);  // Avoiding std::vector<bool>
-  std::vector<std::vector<string> > normalized_string(j_max);
+  // Cache the normalized strings of the next segment in the order of the
+  // lookups, with the indices of their candidates.
+  std::vector<string> normalized_nexts;
+  std::vector<size_t> next_indices;
 
   // Reuse |nexts| in the loop as this method is performance critical.
   std::vector<string> nexts;
   for (size_t j = 0; j < j_max; ++j) {
-    next_seg_ok[j] = 0;
-
+    if (next_seg->candidate(j).cost >
+        next_seg->candidate(0).cost + kMaxCostDiff) {
+      continue;
+    }
     if (IsName(next_seg->candidate(j))) {
       continue;
     }
@@ -682,14 +711,19 @@ bool CollocationRewriter::RewriteUsingNextSegment(Segment *next_seg,
       continue;
     }
 
-    next_seg_ok[j] = 1;
     for (std::vector<string>::const_iterator it = nexts.begin();
          it != nexts.end(); ++it) {
-      normalized_string[j].push_back(string());
-      CollocationUtil::GetNormalizedScript(
-          *it, false, &normalized_string[j].back());
+      string next;
+      CollocationUtil::GetNormalizedScript(*it, false, &next);
+      if (!next.empty()) {
+        normalized_nexts.push_back(std::move(next));
+        next_indices.push_back(j);
+      }
     }
   }
+  if (normalized_nexts.empty()) {
+    return false;
+  }
 
   // Reuse |curs| and |cur| in the loop as this method is performance critical.
   std::vector<string> curs;
@@ -712,31 +746,22 @@ bool CollocationRewriter::RewriteUsingNextSegment(Segment *next_seg,
     for (int k = 0; k < curs.size(); ++k) {
       cur.clear();
       CollocationUtil::GetNormalizedScript(curs[k], true, &cur);
-      for (size_t j = 0; j < j_max; ++j) {
-        if (next_seg->candidate(j).cost >
-            next_seg->candidate(0).cost + kMaxCostDiff) {
-          continue;
-        }
-        if (!next_seg_ok[j]) {
-          continue;
-        }
-
-        for (int l = 0; l < normalized_string[j].size(); ++l) {
-          const string &next = normalized_string[j][l];
-          if (collocation_filter_->Exists(cur, next)) {
-            DCHECK(VerifyNaturalContent(
-                next_seg->candidate(j), next_seg->candidate(0), RIGHT))
-                << "IsNaturalContent() should not fail here.";
-            seg->move_candidate(i, 0);
-            seg->mutable_candidate(0)->attributes
-                |= Segment::Candidate::CONTEXT_SENSITIVE;
-            next_seg->move_candidate(j, 0);
-            next_seg->mutable_candidate(0)->attributes
-                |= Segment::Candidate::CONTEXT_SENSITIVE;
-            return true;
-          }
-        }
+      const size_t found =
+          collocation_filter_->FindFirst(cur, normalized_nexts);
+      if (found == normalized_nexts.size()) {
+        continue;
       }
+      const size_t j = next_indices[found];
+      DCHECK(VerifyNaturalContent(
+          next_seg->candidate(j), next_seg->candidate(0), RIGHT))
+          << "IsNaturalContent() should not fail here.";
+      seg->move_candidate(i, 0);
+      seg->mutable_candidate(0)->attributes
+          |= Segment::Candidate::CONTEXT_SENSITIVE;
+      next_seg->move_candidate(j, 0);
+      next_seg->mutable_candidate(0)->attributes
+          |= Segment::Candidate::CONTEXT_SENSITIVE;
+      return true;
     }
   }
   return false;
@@ -62,15 +62,20 @@ bool CorrectionRewriter::LookupCorrection(
   CHECK(results);
   results->clear();
 
-  using Iter = SerializedStringArray::const_iterator;
-  std::pair<Iter, Iter> range = std::equal_range(error_array_.begin(),
-                                            error_array_.end(),
-                                            key);
-  for (; range.first != range.second; ++range.first) {
-    const StringPiece v = value_array_[range.first.index()];
+  PerfectHashIndex::Range range;
+  if (error_index_.IsBuilt()) {
+    range = error_index_.Find(key,
+                              [this](size_t i) { return error_array_[i]; });
+  } else {
+    const auto iters =
+        std::equal_range(error_array_.begin(), error_array_.end(), key);
+    range.first = iters.first.index();
+    range.second = iters.second.index();
+  }
+  for (size_t i = range.first; i < range.second; ++i) {
+    const StringPiece v = value_array_[i];
     if (value.empty() || value == v) {
-      results->emplace_back(v, *range.first,
-                            correction_array_[range.first.index()]);
+      results->emplace_back(v, error_array_[i], correction_array_[i]);
     }
   }
   return !results->empty();
@@ -87,6 +92,8 @@ CorrectionRewriter::CorrectionRewriter(StringPiece value_array_data,
   correction_array_.Set(correction_array_data);
   DCHECK_EQ(value_array_.size(), error_array_.size());
   DCHECK_EQ(value_array_.size(), correction_array_.size());
+  error_index_.Build(error_array_.size(),
+                     [this](size_t i) { return error_array_[i]; });
 }
 
 // static
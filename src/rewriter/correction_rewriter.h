@@ -34,6 +34,7 @@
 #include <string>
 #include <vector>
 
+#include "base/perfect_hash_index.h"
 #include "base/serialized_string_array.h"
 #include "base/string_piece.h"
 #include "rewriter/rewriter_interface.h"
@@ -91,6 +92,7 @@ class CorrectionRewriter : public RewriterInterface  {
   SerializedStringArray value_array_;
   SerializedStringArray error_array_;
   SerializedStringArray correction_array_;
+  PerfectHashIndex error_index_;
 };
 
 }  // namespace mozc
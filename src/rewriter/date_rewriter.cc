@@ -40,12 +40,17 @@
 #include <algorithm>
 #include <cstdio>
 #include <ctime>
+#include <map>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "base/clock.h"
+#include "base/hash.h"
 #include "base/logging.h"
+#include "base/mutex.h"
 #include "base/number_util.h"
+#include "base/singleton.h"
 #include "base/util.h"
 #include "composer/composer.h"
 #include "composer/table.h"
@@ -1456,6 +1461,117 @@ enum {
   REWRITE_DATE_AND_CURRENT_TIME
 };
 
+// Handlers of the readings triggering the date/time candidates, in the order
+// of priority.
+enum TriggerHandler {
+  TRIGGER_DATE,
+  TRIGGER_WEEKDAY,
+  TRIGGER_MONTH,
+  TRIGGER_YEAR,
+  TRIGGER_CURRENT_TIME,
+  TRIGGER_DATE_AND_CURRENT_TIME,
+};
+
+struct DateTrigger {
+  uint64 fingerprint;  // Fingerprint of |data->key|.
+  const DateData *data;
+  TriggerHandler handler;
+};
+
+// Table from the fingerprint of a reading to the date data of the reading, so
+// that a segment is matched against all the tables by one binary search.
+class DateTriggerTable {
+ public:
+  typedef std::pair<const DateTrigger *, const DateTrigger *> Range;
+
+  DateTriggerTable() {
+    Add(kDateData, arraysize(kDateData), TRIGGER_DATE);
+    Add(kWeekDayData, arraysize(kWeekDayData), TRIGGER_WEEKDAY);
+    Add(kMonthData, arraysize(kMonthData), TRIGGER_MONTH);
+    Add(kYearData, arraysize(kYearData), TRIGGER_YEAR);
+    Add(kCurrentTimeData, arraysize(kCurrentTimeData), TRIGGER_CURRENT_TIME);
+    Add(kDateAndCurrentTimeData, arraysize(kDateAndCurrentTimeData),
+        TRIGGER_DATE_AND_CURRENT_TIME);
+    // Stable so that the triggers of the same reading stay in the order of
+    // priority.
+    std::stable_sort(triggers_.begin(), triggers_.end(),
+                     [](const DateTrigger &lhs, const DateTrigger &rhs) {
+                       return lhs.fingerprint < rhs.fingerprint;
+                     });
+  }
+
+  // Returns the triggers whose fingerprint is the same as |key|.  The caller
+  // needs to verify the key of each data.
+  Range Find(StringPiece key) const {
+    const uint64 fingerprint = Hash::Fingerprint(key);
+    const DateTrigger *begin = triggers_.data();
+    const DateTrigger *end = begin + triggers_.size();
+    begin = std::lower_bound(
+        begin, end, fingerprint,
+        [](const DateTrigger &trigger, uint64 fp) {
+          return trigger.fingerprint < fp;
+        });
+    const DateTrigger *last = begin;
+    while (last != end && last->fingerprint == fingerprint) {
+      ++last;
+    }
+    return Range(begin, last);
+  }
+
+ private:
+  void Add(const DateData *data, size_t size, TriggerHandler handler) {
+    for (size_t i = 0; i < size; ++i) {
+      const DateTrigger trigger = {Hash::Fingerprint(data[i].key), &data[i],
+                                   handler};
+      triggers_.push_back(trigger);
+    }
+  }
+
+  std::vector<DateTrigger> triggers_;
+
+  DISALLOW_COPY_AND_ASSIGN(DateTriggerTable);
+};
+
+// Cache of the formatted date/time candidates keyed by the rewrite type and
+// the date or time they are formatted for.  The formats only depend on the
+// key, so the cache is just cleared when the date rolls over so as not to
+// grow.
+class FormattedDateTimeCache {
+ public:
+  FormattedDateTimeCache() : day_(-1) {}
+
+  // Returns true and sets |results| if the candidates of |type| and |key| are
+  // cached.  |now| is the current time.
+  bool Lookup(const struct tm &now, int type, int64 key,
+              std::vector<string> *results) {
+    scoped_lock l(&mutex_);
+    const int day = (now.tm_year + 1900) * 1000 + now.tm_yday;
+    if (day != day_) {
+      entries_.clear();
+      day_ = day;
+      return false;
+    }
+    const auto iter = entries_.find(std::make_pair(type, key));
+    if (iter == entries_.end()) {
+      return false;
+    }
+    *results = iter->second;
+    return true;
+  }
+
+  void Insert(int type, int64 key, const std::vector<string> &results) {
+    scoped_lock l(&mutex_);
+    entries_[std::make_pair(type, key)] = results;
+  }
+
+ private:
+  Mutex mutex_;
+  int day_;
+  std::map<std::pair<int, int64>, std::vector<string>> entries_;
+
+  DISALLOW_COPY_AND_ASSIGN(FormattedDateTimeCache);
+};
+
 bool AdToEraForCourt(const YearData *data, int size,
                      int year, std::vector<string> *results) {
   for (int i = size - 1; i >= 0; --i) {
@@ -1755,194 +1871,156 @@ bool DateRewriter::RewriteTime(Segment *segment,
             ? size
             : std::max(cand_idx + 1, kMinimumDateCandidateIdx);
 
-    struct tm t_st;
-    std::vector<string> era;
-    switch (type) {
-      case REWRITE_DATE: {
-        if (!Clock::GetTmWithOffsetSecond(&t_st, diff * 86400)) {
-          LOG(ERROR) << "GetTmWithOffsetSecond() failed";
-          return false;
-        }
-        std::vector<string> results;
-        ConvertDateWithYear(t_st.tm_year + 1900, t_st.tm_mon + 1, t_st.tm_mday,
-                            &results);
-        if (AdToEra(t_st.tm_year + 1900, &era) && !era.empty()) {
-          results.push_back(Util::StringPrintf(
-              "%s年%d月%d日",
-              era[0].c_str(), t_st.tm_mon + 1, t_st.tm_mday));
-        }
-        results.push_back(Util::StringPrintf("%s曜日",
-                                             kWeekDayString[t_st.tm_wday]));
-
-        for (std::vector<string>::reverse_iterator rit = results.rbegin();
-             rit != results.rend(); ++rit) {
-          Insert(cand, insert_idx , *rit, description, segment);
-        }
-        return true;
-      }
-
-      case REWRITE_MONTH: {
-        if (!Clock::GetCurrentTm(&t_st)) {
-          LOG(ERROR) << "GetCurrentTm failed";
-          return false;
-        }
-        const int month = (t_st.tm_mon + diff + 12) % 12 + 1;
-        Insert(cand, insert_idx, Util::StringPrintf("%d月", month),
-               description, segment);
-        Insert(cand, insert_idx, Util::StringPrintf("%d", month), description,
-               segment);
-        return true;
-      }
-
-      case REWRITE_YEAR: {
-        if (!Clock::GetCurrentTm(&t_st)) {
-          LOG(ERROR) << "GetCurrentTm failed";
-          return false;
-        }
-        const int year = (t_st.tm_year + diff + 1900);
-        if (AdToEra(year, &era) && !era.empty()) {
-          Insert(cand, insert_idx,
-                 Util::StringPrintf("%s年", era[0].c_str()),
-                 description, segment);
-        }
-        Insert(cand, insert_idx, Util::StringPrintf("%d年", year),
-               description, segment);
-        Insert(cand, insert_idx, Util::StringPrintf("%d", year), description,
-               segment);
-        return true;
-      }
-
-      case REWRITE_CURRENT_TIME: {
-        if (!Clock::GetCurrentTm(&t_st)) {
-          LOG(ERROR) << "GetCurrentTm failed";
-          return false;
-        }
-        std::vector<string> times;
-        ConvertTime(t_st.tm_hour, t_st.tm_min, &times);
-        for (std::vector<string>::reverse_iterator rit = times.rbegin();
-             rit != times.rend(); ++rit) {
-          Insert(cand, insert_idx, *rit, description, segment);
-        }
-        return true;
-      }
-
-      case REWRITE_DATE_AND_CURRENT_TIME: {
-        if (!Clock::GetCurrentTm(&t_st)) {
-          LOG(ERROR) << "GetCurrentTm failed";
-          return false;
-        }
-        // Y/MM/DD H:MM
-        const string ymmddhmm = Util::StringPrintf("%d/%2.2d/%2.2d %2d:%2.2d",
-                                                   t_st.tm_year + 1900,
-                                                   t_st.tm_mon + 1,
-                                                   t_st.tm_mday,
-                                                   t_st.tm_hour,
-                                                   t_st.tm_min);
-        Insert(cand, insert_idx, ymmddhmm, description, segment);
-        return true;
-      }
+    std::vector<string> results;
+    if (!FormatDateTime(type, diff, &results)) {
+      return false;
     }
-  }
-
-  return false;
-}
-
-bool DateRewriter::RewriteDate(Segment *segment) {
-  for (size_t i = 0; i < arraysize(kDateData); ++i) {
-    if (RewriteTime(segment,
-                    kDateData[i].key, kDateData[i].value,
-                    kDateData[i].description,
-                    REWRITE_DATE,
-                    kDateData[i].diff)) {
-      VLOG(1) << "RewriteDate: "
-              << kDateData[i].key << " " << kDateData[i].value;
-      return true;
-    }
-  }
-  return false;
-}
-
-bool DateRewriter::RewriteMonth(Segment *segment) {
-  for (size_t i = 0; i < arraysize(kMonthData); ++i) {
-    if (RewriteTime(segment,
-                    kMonthData[i].key, kMonthData[i].value,
-                    kMonthData[i].description,
-                    REWRITE_MONTH,
-                    kMonthData[i].diff)) {
-      VLOG(1) << "RewriteMonth: "
-              << kMonthData[i].key << " " << kMonthData[i].value;
-      return true;
+    for (std::vector<string>::reverse_iterator rit = results.rbegin();
+         rit != results.rend(); ++rit) {
+      Insert(cand, insert_idx, *rit, description, segment);
     }
+    return true;
   }
-  return false;
-}
 
-bool DateRewriter::RewriteYear(Segment *segment) {
-  for (size_t i = 0; i < arraysize(kYearData); ++i) {
-    if (RewriteTime(segment,
-                    kYearData[i].key, kYearData[i].value,
-                    kYearData[i].description,
-                    REWRITE_YEAR,
-                    kYearData[i].diff)) {
-      VLOG(1) << "RewriteYear: "
-              << kYearData[i].key << " " << kYearData[i].value;
-      return true;
-    }
-  }
   return false;
 }
 
-bool DateRewriter::RewriteWeekday(Segment *segment) {
+bool DateRewriter::FormatDateTime(int type, int diff,
+                                  std::vector<string> *results) {
   struct tm t_st;
   if (!Clock::GetCurrentTm(&t_st)) {
     LOG(ERROR) << "GetCurrentTm failed";
     return false;
   }
+  const struct tm now = t_st;
 
-  for (size_t i = 0; i < arraysize(kWeekDayData); ++i) {
-    const int weekday = kWeekDayData[i].diff % 7;
-    const int additional_dates = (weekday + 7 - t_st.tm_wday) % 7;
-    if (RewriteTime(segment,
-                    kWeekDayData[i].key, kWeekDayData[i].value,
-                    kWeekDayData[i].description,
-                    REWRITE_DATE,
-                    additional_dates)) {
-      VLOG(1) << "RewriteWeekday: "
-              << kWeekDayData[i].key << " " << kWeekDayData[i].value;
-      return true;
-    }
+  // Key of the cache, identifying the date or time to be formatted.
+  int64 cache_key = 0;
+  switch (type) {
+    case REWRITE_DATE:
+      if (!Clock::GetTmWithOffsetSecond(&t_st, diff * 86400)) {
+        LOG(ERROR) << "GetTmWithOffsetSecond() failed";
+        return false;
+      }
+      cache_key = (t_st.tm_year + 1900) * 10000 + (t_st.tm_mon + 1) * 100 +
+                  t_st.tm_mday;
+      break;
+    case REWRITE_MONTH:
+      cache_key = (t_st.tm_mon + diff + 12) % 12 + 1;
+      break;
+    case REWRITE_YEAR:
+      cache_key = t_st.tm_year + diff + 1900;
+      break;
+    case REWRITE_CURRENT_TIME:
+      cache_key = t_st.tm_hour * 60 + t_st.tm_min;
+      break;
+    case REWRITE_DATE_AND_CURRENT_TIME:
+      cache_key = ((t_st.tm_year + 1900) * 10000LL +
+                   (t_st.tm_mon + 1) * 100 + t_st.tm_mday) * 10000 +
+                  t_st.tm_hour * 100 + t_st.tm_min;
+      break;
+    default:
+      LOG(DFATAL) << "Unknown type: " << type;
+      return false;
+  }
+  FormattedDateTimeCache *cache = Singleton<FormattedDateTimeCache>::get();
+  if (cache->Lookup(now, type, cache_key, results)) {
+    return true;
   }
 
-  return false;
-}
+  // The results are in the order of the candidates.
+  std::vector<string> era;
+  switch (type) {
+    case REWRITE_DATE: {
+      ConvertDateWithYear(t_st.tm_year + 1900, t_st.tm_mon + 1, t_st.tm_mday,
+                          results);
+      if (AdToEra(t_st.tm_year + 1900, &era) && !era.empty()) {
+        results->push_back(Util::StringPrintf(
+            "%s年%d月%d日",
+            era[0].c_str(), t_st.tm_mon + 1, t_st.tm_mday));
+      }
+      results->push_back(Util::StringPrintf("%s曜日",
+                                            kWeekDayString[t_st.tm_wday]));
+      break;
+    }
 
-bool DateRewriter::RewriteCurrentTime(Segment *segment) {
-  for (size_t i = 0; i < arraysize(kCurrentTimeData); ++i) {
-    if (RewriteTime(segment,
-                    kCurrentTimeData[i].key, kCurrentTimeData[i].value,
-                    kCurrentTimeData[i].description,
-                    REWRITE_CURRENT_TIME,
-                    0)) {
-      VLOG(1) << "RewriteCurrentTime: "
-              << kCurrentTimeData[i].key << " "
-              << kCurrentTimeData[i].value;
-      return true;
+    case REWRITE_MONTH: {
+      const int month = static_cast<int>(cache_key);
+      results->push_back(Util::StringPrintf("%d", month));
+      results->push_back(Util::StringPrintf("%d月", month));
+      break;
+    }
+
+    case REWRITE_YEAR: {
+      const int year = static_cast<int>(cache_key);
+      results->push_back(Util::StringPrintf("%d", year));
+      results->push_back(Util::StringPrintf("%d年", year));
+      if (AdToEra(year, &era) && !era.empty()) {
+        results->push_back(Util::StringPrintf("%s年", era[0].c_str()));
+      }
+      break;
+    }
+
+    case REWRITE_CURRENT_TIME: {
+      ConvertTime(t_st.tm_hour, t_st.tm_min, results);
+      break;
+    }
+
+    case REWRITE_DATE_AND_CURRENT_TIME: {
+      // Y/MM/DD H:MM
+      results->push_back(Util::StringPrintf("%d/%2.2d/%2.2d %2d:%2.2d",
+                                            t_st.tm_year + 1900,
+                                            t_st.tm_mon + 1,
+                                            t_st.tm_mday,
+                                            t_st.tm_hour,
+                                            t_st.tm_min));
+      break;
     }
   }
-  return false;
+  cache->Insert(type, cache_key, *results);
+  return true;
 }
 
-bool DateRewriter::RewriteDateAndCurrentTime(Segment *segment) {
-  for (size_t i = 0; i < arraysize(kDateAndCurrentTimeData); ++i) {
-    if (RewriteTime(segment,
-                    kDateAndCurrentTimeData[i].key,
-                    kDateAndCurrentTimeData[i].value,
-                    kDateAndCurrentTimeData[i].description,
-                    REWRITE_DATE_AND_CURRENT_TIME,
-                    0)) {
-      VLOG(1) << "RewriteDateAndCurrentTime: "
-              << kDateAndCurrentTimeData[i].key << " "
-              << kDateAndCurrentTimeData[i].value;
+bool DateRewriter::RewriteDateTime(Segment *segment) {
+  const DateTriggerTable::Range range =
+      Singleton<DateTriggerTable>::get()->Find(segment->key());
+  for (const DateTrigger *trigger = range.first; trigger != range.second;
+       ++trigger) {
+    const DateData &data = *trigger->data;
+    int type = REWRITE_DATE;
+    int diff = data.diff;
+    switch (trigger->handler) {
+      case TRIGGER_DATE:
+        break;
+      case TRIGGER_WEEKDAY: {
+        struct tm t_st;
+        if (!Clock::GetCurrentTm(&t_st)) {
+          LOG(ERROR) << "GetCurrentTm failed";
+          return false;
+        }
+        const int weekday = data.diff % 7;
+        diff = (weekday + 7 - t_st.tm_wday) % 7;
+        break;
+      }
+      case TRIGGER_MONTH:
+        type = REWRITE_MONTH;
+        break;
+      case TRIGGER_YEAR:
+        type = REWRITE_YEAR;
+        break;
+      case TRIGGER_CURRENT_TIME:
+        type = REWRITE_CURRENT_TIME;
+        diff = 0;
+        break;
+      case TRIGGER_DATE_AND_CURRENT_TIME:
+        type = REWRITE_DATE_AND_CURRENT_TIME;
+        diff = 0;
+        break;
+    }
+    // RewriteTime() verifies the key against fingerprint collisions.
+    if (RewriteTime(segment, data.key, data.value, data.description, type,
+                    diff)) {
+      VLOG(1) << "RewriteDateTime: " << data.key << " " << data.value;
       return true;
     }
   }
@@ -2288,6 +2366,9 @@ DateRewriter::DateRewriter() = default;
 DateRewriter::~DateRewriter() = default;
 
 int DateRewriter::capability(const ConversionRequest &request) const {
+  if (!request.config().use_date_conversion()) {
+    return RewriterInterface::NOT_AVAILABLE;
+  }
   if (request.request().mixed_conversion()) {
     return RewriterInterface::ALL;
   }
@@ -2319,10 +2400,7 @@ bool DateRewriter::Rewrite(const ConversionRequest &request,
       return false;
     }
 
-    if (RewriteDate(seg) || RewriteWeekday(seg) ||
-        RewriteMonth(seg) || RewriteYear(seg) ||
-        RewriteCurrentTime(seg) ||
-        RewriteDateAndCurrentTime(seg)) {
+    if (RewriteDateTime(seg)) {
       modified = true;
     } else if (i + 1 < segments->segments_size() &&
                RewriteEra(seg, segments->segment(i + 1))) {
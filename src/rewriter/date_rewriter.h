@@ -72,15 +72,16 @@ class DateRewriter : public RewriterInterface {
                           const char *value,
                           const char *description,
                           int type, int diff);
-  static bool RewriteDate(Segment *segment);
-  static bool RewriteMonth(Segment *segment);
-  static bool RewriteYear(Segment *segment);
-  static bool RewriteCurrentTime(Segment *segment);
-  static bool RewriteDateAndCurrentTime(Segment *segment);
+  // Formats the candidates of |type| for |diff| from the current time, in
+  // the order to be shown.  The results are cached until the date rolls over.
+  static bool FormatDateTime(int type, int diff, std::vector<string> *results);
+  // Rewrites |segment| if its key is one of the readings of dates, weekdays,
+  // months, years or the current time, e.g., "きょう".  The tables of the
+  // readings are looked up by a precomputed hash table.
+  static bool RewriteDateTime(Segment *segment);
   static bool RewriteEra(Segment *current_segment,
                          const Segment &next_segment);
   static bool RewriteAd(Segment *segment);
-  static bool RewriteWeekday(Segment *segment);
 
   // When only one conversion segment has consecutive number characters,
   // this function adds date and time candidates.
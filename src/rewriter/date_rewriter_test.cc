@@ -334,6 +334,49 @@ TEST_F(DateRewriterTest, DateRewriteTest) {
   Clock::SetClockForUnitTest(nullptr);
 }
 
+// The formatted candidates are cached, which shouldn't be visible when the
+// clock moves.
+TEST_F(DateRewriterTest, DateRewriteAfterClockMovesTest) {
+  std::unique_ptr<ClockMock> mock_clock(
+      new ClockMock(kTestSeconds, kTestMicroSeconds));
+  Clock::SetClockForUnitTest(mock_clock.get());
+
+  DateRewriter rewriter;
+  Segments segments;
+  const ConversionRequest request;
+
+  for (int i = 0; i < 2; ++i) {
+    InitSegment("きょう", "今日", &segments);
+    EXPECT_TRUE(rewriter.Rewrite(request, &segments));
+    EXPECT_TRUE(ContainCandidate(segments, "2011/04/18"));
+    EXPECT_TRUE(ContainCandidate(segments, "月曜日"));
+    InitSegment("いま", "今", &segments);
+    EXPECT_TRUE(rewriter.Rewrite(request, &segments));
+    EXPECT_TRUE(ContainCandidate(segments, "15:06"));
+  }
+
+  // One minute later.
+  mock_clock->SetTime(kTestSeconds + 60, kTestMicroSeconds);
+  InitSegment("いま", "今", &segments);
+  EXPECT_TRUE(rewriter.Rewrite(request, &segments));
+  EXPECT_TRUE(ContainCandidate(segments, "15:07"));
+  EXPECT_FALSE(ContainCandidate(segments, "15:06"));
+
+  // The date rolls over.
+  mock_clock->SetTime(kTestSeconds + 86400, kTestMicroSeconds);
+  InitSegment("きょう", "今日", &segments);
+  EXPECT_TRUE(rewriter.Rewrite(request, &segments));
+  EXPECT_TRUE(ContainCandidate(segments, "2011/04/19"));
+  EXPECT_TRUE(ContainCandidate(segments, "火曜日"));
+  EXPECT_FALSE(ContainCandidate(segments, "2011/04/18"));
+  InitSegment("きのう", "昨日", &segments);
+  EXPECT_TRUE(rewriter.Rewrite(request, &segments));
+  EXPECT_TRUE(ContainCandidate(segments, "2011/04/18"));
+  EXPECT_TRUE(ContainCandidate(segments, "月曜日"));
+
+  Clock::SetClockForUnitTest(nullptr);
+}
+
 TEST_F(DateRewriterTest, ADToERA) {
   DateRewriter rewriter;
   std::vector<string> results;
@@ -88,6 +88,12 @@ DiceRewriter::DiceRewriter() = default;
 
 DiceRewriter::~DiceRewriter() = default;
 
+bool DiceRewriter::IsTriggeredBy(const ConversionRequest &request,
+                                 const Segments &segments) {
+  return segments.conversion_segments_size() == 1 &&
+         segments.conversion_segment(0).key() == "さいころ";
+}
+
 bool DiceRewriter::Rewrite(const ConversionRequest &request,
                            Segments *segments) const {
   if (segments->conversion_segments_size() != 1) {
@@ -73,7 +73,13 @@ void Token::MergeFrom(const Token &token) {
 }
 
 uint64 Token::GetID() const {
-  return Hash::Fingerprint(key_ + "\t" + value_ + "\t" + pos_);
+  Hash::Fingerprinter fp;
+  fp.Append(key_);
+  fp.Append('\t');
+  fp.Append(value_);
+  fp.Append('\t');
+  fp.Append(pos_);
+  return fp.Fingerprint();
 }
 
 static const size_t kTokenSize = 1000;
@@ -58,24 +58,17 @@ const char kEmojiKey[] = "えもじ";
 // Where to insert emoji candidate by default.
 const size_t kDefaultInsertPos = 6;
 
-// Inserts a candidate to the segment at insert_position.
-// Returns true if succeeded, otherwise false. Also, if succeeded, increments
-// the insert_position to represent the next insert position.
-bool InsertCandidate(StringPiece key,
+// Stages a candidate to be inserted at |insert_position|.  |description| is
+// the whole description of the candidate including "絵文字".
+void InsertCandidate(StringPiece key,
                      StringPiece value,
                      StringPiece description,
                      int cost,
-                     Segment *segment,
-                     size_t *insert_position) {
-  Segment::Candidate *candidate = segment->insert_candidate(*insert_position);
-  if (candidate == NULL) {
-    LOG(ERROR) << "cannot insert candidate at " << insert_position
-               << "th position nor tail of candidates.";
-    return false;
-  }
-  ++*insert_position;
+                     size_t insert_position,
+                     Segment::CandidateEditor *editor) {
+  Segment::Candidate *candidate = editor->Insert(insert_position);
+  DCHECK(candidate);
 
-  candidate->Init();
   // Fill 0 (BOS/EOS) pos code intentionally.
   candidate->lid = 0;
   candidate->rid = 0;
@@ -84,15 +77,19 @@ bool InsertCandidate(StringPiece key,
   candidate->content_value.assign(value.data(), value.size());
   candidate->key.assign(key.data(), key.size());
   candidate->content_key.assign(key.data(), key.size());
-  candidate->description.assign(kEmoji);
-  if (!description.empty()) {
-    Util::AppendStringWithDelimiter(
-        " ", description, &(candidate->description));
-  }
+  candidate->description.assign(description.data(), description.size());
   candidate->attributes |= Segment::Candidate::NO_VARIANTS_EXPANSION;
   candidate->attributes |= Segment::Candidate::CONTEXT_SENSITIVE;
+}
 
-  return true;
+// Returns the description of an emoji candidate, "絵文字" followed by
+// |description| if it is not empty.
+string RenderDescription(StringPiece description) {
+  string result = kEmoji;
+  if (!description.empty()) {
+    Util::AppendStringWithDelimiter(" ", description, &result);
+  }
+  return result;
 }
 
 // Merges two descriptions.  Connects them if one is not a substring of the
@@ -116,19 +113,20 @@ void AddDescription(StringPiece adding, std::vector<string> *descriptions) {
 bool InsertEmojiData(StringPiece key,
                      EmojiRewriter::EmojiDataIterator iter,
                      const SerializedStringArray &string_array,
+                     StringPiece utf8_description,
                      int cost,
                      int32 available_carrier,
-                     Segment *segment,
-                     size_t *insert_position) {
+                     size_t insert_position,
+                     Segment::CandidateEditor *editor) {
   bool inserted = false;
 
   StringPiece utf8_emoji = string_array[iter.emoji_index()];
 
   // Fill a candidate of Unicode 6.0 emoji.
   if ((available_carrier & Request::UNICODE_EMOJI) && !utf8_emoji.empty()) {
-    inserted |= InsertCandidate(
-        key, utf8_emoji, string_array[iter.description_utf8_index()],
-        cost, segment, insert_position);
+    InsertCandidate(key, utf8_emoji, utf8_description, cost,
+                    insert_position, editor);
+    inserted = true;
   }
 
   std::vector<string> descriptions;
@@ -150,8 +148,9 @@ bool InsertEmojiData(StringPiece key,
     string description;
     Util::UCS4ToUTF8Append(iter.android_pua(), &android_pua);
     Util::JoinStrings(descriptions, " ", &description);
-    inserted |= InsertCandidate(
-        key, android_pua, description.c_str(), cost, segment, insert_position);
+    InsertCandidate(key, android_pua, RenderDescription(description), cost,
+                    insert_position, editor);
+    inserted = true;
   }
 
   return inserted;
@@ -162,55 +161,48 @@ int GetEmojiCost(const Segment &segment) {
   return segment.candidates_size() == 0 ? 0 : segment.candidate(0).cost;
 }
 
-bool InsertAllEmojiData(StringPiece key,
-                        EmojiRewriter::EmojiDataIterator begin,
-                        EmojiRewriter::EmojiDataIterator end,
-                        const SerializedStringArray &string_array,
-                        int32 available_carrier,
-                        Segment *segment) {
-  bool inserted = false;
-
-  // Insert all candidates at the tail of the segment.
-  size_t insert_position = segment->candidates_size();
-  int cost = GetEmojiCost(*segment);
-  for (; begin != end; ++begin) {
-    inserted |= InsertEmojiData(key, begin, string_array, cost,
-                                available_carrier,
-                                segment, &insert_position);
-  }
-  return inserted;
-}
+}  // namespace
 
-bool InsertToken(StringPiece key,
-                 EmojiRewriter::IteratorRange range,
-                 const SerializedStringArray &string_array,
-                 int32 available_carrier,
-                 Segment *segment) {
+bool EmojiRewriter::InsertEmojiCandidates(StringPiece key,
+                                          IteratorRange range,
+                                          size_t insert_position,
+                                          int32 available_carrier,
+                                          Segment *segment) const {
   bool inserted = false;
-
-  size_t insert_position =
-      std::min(segment->candidates_size(), kDefaultInsertPos);
-  int cost = GetEmojiCost(*segment);
+  const int cost = GetEmojiCost(*segment);
+  // Staged candidates at the same position keep their order, so the tokens
+  // are inserted at |insert_position| as a block.
+  Segment::CandidateEditor editor(segment);
   for (; range.first != range.second; ++range.first) {
     inserted |= InsertEmojiData(
-        key, range.first, string_array, cost, available_carrier,
-        segment, &insert_position);
+        key, range.first, string_array_,
+        utf8_descriptions_[range.first - begin()], cost, available_carrier,
+        insert_position, &editor);
   }
+  editor.Apply();
   return inserted;
 }
 
-}  // namespace
-
 EmojiRewriter::EmojiRewriter(const DataManagerInterface &data_manager) {
   StringPiece string_array_data;
   data_manager.GetEmojiRewriterData(&token_array_data_, &string_array_data);
   DCHECK(SerializedStringArray::VerifyData(string_array_data));
   string_array_.Set(string_array_data);
+  key_index_.Build(end() - begin(), [this](size_t i) { return GetKey(i); });
+
+  utf8_descriptions_.reserve(end() - begin());
+  for (auto iter = begin(); iter != end(); ++iter) {
+    utf8_descriptions_.push_back(
+        RenderDescription(string_array_[iter.description_utf8_index()]));
+  }
 }
 
 EmojiRewriter::~EmojiRewriter() = default;
 
 int EmojiRewriter::capability(const ConversionRequest &request) const {
+  if (!request.config().use_emoji_conversion()) {
+    return RewriterInterface::NOT_AVAILABLE;
+  }
   // The capability of the EmojiRewriter is up to the client's request.
   // Note that the bit representation of RewriterInterface::CapabilityType
   // and Request::RewriterCapability should exactly same, so it is ok
@@ -264,6 +256,12 @@ bool EmojiRewriter::IsEmojiCandidate(const Segment::Candidate &candidate) {
 
 std::pair<EmojiRewriter::EmojiDataIterator, EmojiRewriter::EmojiDataIterator>
 EmojiRewriter::LookUpToken(StringPiece key) const {
+  if (key_index_.IsBuilt()) {
+    const PerfectHashIndex::Range range =
+        key_index_.Find(key, [this](size_t i) { return GetKey(i); });
+    return IteratorRange(begin() + range.first, begin() + range.second);
+  }
+
   // Search string array for key.
   auto iter = std::lower_bound(string_array_.begin(), string_array_.end(), key);
   if (iter == string_array_.end() || *iter != key) {
@@ -286,8 +284,10 @@ bool EmojiRewriter::RewriteCandidates(
 
     if (reading == kEmojiKey) {
       // When key is "えもじ", we expect to expand all Emoji characters.
-      modified |= InsertAllEmojiData(reading, begin(), end(), string_array_,
-                                     available_emoji_carrier, segment);
+      // Insert all candidates at the tail of the segment.
+      modified |= InsertEmojiCandidates(
+          reading, IteratorRange(begin(), end()), segment->candidates_size(),
+          available_emoji_carrier, segment);
       continue;
     }
     const auto range = LookUpToken(reading);
@@ -295,8 +295,10 @@ bool EmojiRewriter::RewriteCandidates(
       VLOG(2) << "Token not found: " << reading;
       continue;
     }
-    modified |= InsertToken(reading, range, string_array_,
-                            available_emoji_carrier, segment);
+    modified |= InsertEmojiCandidates(
+        reading, range,
+        std::min(segment->candidates_size(), kDefaultInsertPos),
+        available_emoji_carrier, segment);
   }
   return modified;
 }
@@ -32,8 +32,11 @@
 
 #include <cstddef>
 #include <iterator>
+#include <string>
 #include <utility>
+#include <vector>
 
+#include "base/perfect_hash_index.h"
 #include "base/serialized_string_array.h"
 #include "base/string_piece.h"
 #include "converter/segments.h"
@@ -91,7 +94,8 @@ class EmojiRewriter : public RewriterInterface {
   //
   // Here, index is the position in the string array at which the corresponding
   // string value is stored.  Tokens are sorted in order of key so that it can
-  // be search by binary search.
+  // be search by binary search.  At runtime, tokens are looked up through a
+  // PerfectHashIndex built over the keys.
   //
   // The following iterator class can be used to iterate over token array.
   class EmojiDataIterator
@@ -227,6 +231,9 @@ class EmojiRewriter : public RewriterInterface {
   bool Rewrite(const ConversionRequest &request,
                Segments *segments) const override;
 
+  // Emoji candidates are only inserted.
+  bool is_parallelizable() const override { return true; }
+
   // Counts the number of segments in which emoji candidates are selected,
   // and stores the result as usage stats.
   // NOTE: This method is expected to be called after the segments are processed
@@ -259,8 +266,25 @@ class EmojiRewriter : public RewriterInterface {
 
   IteratorRange LookUpToken(StringPiece key) const;
 
+  // Inserts the emoji candidates of |range| at |insert_position| of
+  // |segment|.  Returns true if any candidate is inserted.
+  bool InsertEmojiCandidates(StringPiece key,
+                             IteratorRange range,
+                             size_t insert_position,
+                             int32 available_carrier,
+                             Segment *segment) const;
+
+  // Returns the key of the |i|-th token.
+  StringPiece GetKey(size_t i) const {
+    return string_array_[(begin() + i).key_index()];
+  }
+
   StringPiece token_array_data_;
   SerializedStringArray string_array_;
+  PerfectHashIndex key_index_;
+  // Descriptions of Unicode emoji candidates rendered on construction,
+  // indexed by the position of the token.
+  std::vector<string> utf8_descriptions_;
 
   DISALLOW_COPY_AND_ASSIGN(EmojiRewriter);
 };
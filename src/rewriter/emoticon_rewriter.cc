@@ -234,6 +234,9 @@ EmoticonRewriter::EmoticonRewriter(StringPiece token_array_data,
 EmoticonRewriter::~EmoticonRewriter() = default;
 
 int EmoticonRewriter::capability(const ConversionRequest &request) const {
+  if (!request.config().use_emoticon_conversion()) {
+    return RewriterInterface::NOT_AVAILABLE;
+  }
   if (request.request().mixed_conversion()) {
     return RewriterInterface::ALL;
   }
@@ -54,6 +54,8 @@ class EmoticonRewriter : public RewriterInterface  {
   bool Rewrite(const ConversionRequest &request,
                Segments *segments) const override;
 
+  bool is_parallelizable() const override { return true; }
+
  private:
   bool RewriteCandidate(Segments *segments) const;
 
@@ -109,6 +109,8 @@ bool EnglishVariantsRewriter::ExpandEnglishVariantsWithSegment(
 
   bool modified = false;
 
+  // Variants are staged and inserted in one pass after the loop.
+  Segment::CandidateEditor editor(seg);
   for (size_t i = 0; i < seg->candidates_size(); ++i) {
     Segment::Candidate *original_candidate = seg->mutable_candidate(i);
     DCHECK(original_candidate);
@@ -133,9 +135,8 @@ bool EnglishVariantsRewriter::ExpandEnglishVariantsWithSegment(
                                 &variants)) {
         CHECK(!variants.empty());
         for (size_t j = 0; j < variants.size(); ++j) {
-          Segment::Candidate *new_candidate = seg->insert_candidate(i + j + 1);
+          Segment::Candidate *new_candidate = editor.Insert(i + 1);
           DCHECK(new_candidate);
-          new_candidate->Init();
           Util::ConcatStrings(variants[j],
                               original_candidate->functional_value(),
                               &new_candidate->value);
@@ -151,8 +152,6 @@ bool EnglishVariantsRewriter::ExpandEnglishVariantsWithSegment(
           new_candidate->attributes |=
               Segment::Candidate::NO_VARIANTS_EXPANSION;
         }
-
-        i += variants.size();
       }
     } else if (IsEnglishCandidate(original_candidate)) {
       // Fix variants for English candidate
@@ -161,6 +160,7 @@ bool EnglishVariantsRewriter::ExpandEnglishVariantsWithSegment(
           Segment::Candidate::NO_VARIANTS_EXPANSION;
     }
   }
+  editor.Apply();
 
   return modified;
 }
@@ -181,6 +181,12 @@ FortuneRewriter::FortuneRewriter() {}
 
 FortuneRewriter::~FortuneRewriter() {}
 
+bool FortuneRewriter::IsTriggeredBy(const ConversionRequest &request,
+                                    const Segments &segments) {
+  return segments.conversion_segments_size() == 1 &&
+         segments.conversion_segment(0).key() == "おみくじ";
+}
+
 bool FortuneRewriter::Rewrite(const ConversionRequest &request,
                               Segments *segments) const {
   if (segments->conversion_segments_size() != 1) {
@@ -44,6 +44,20 @@ class FortuneRewriter : public RewriterInterface  {
 
   virtual bool Rewrite(const ConversionRequest &request,
                        Segments *segments) const;
+
+  virtual bool has_trigger() const {
+    return true;
+  }
+
+  virtual bool IsTriggered(const ConversionRequest &request,
+                           const Segments &segments) const {
+    return IsTriggeredBy(request, segments);
+  }
+
+  // Returns false if Rewrite() never modifies |segments|.  It is also used
+  // as the trigger of LazyRewriter.
+  static bool IsTriggeredBy(const ConversionRequest &request,
+                            const Segments &segments);
 };
 
 }  // namespace mozc
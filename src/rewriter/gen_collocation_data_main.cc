@@ -50,20 +50,31 @@ DEFINE_string(collocation_data, "", "collocation data text");
 DEFINE_string(output, "", "output file name (default: stdout)");
 DEFINE_double(error_rate, 0.00001, "error rate");
 DEFINE_bool(binary_mode, false, "outputs binary file");
+DEFINE_bool(tune, false,
+            "choose the parameters of the filter for --error_rate and "
+            "--max_bytes with ExistenceFilterBuilder");
+DEFINE_int32(max_bytes, 0, "maximum size of the tuned filter (0: no limit)");
+DEFINE_string(holdout, "",
+              "entries not in the data, in the same format, used to measure "
+              "the false positive rate of the tuned filter");
 
 namespace mozc {
 namespace {
 
-void Convert() {
-  InputFileStream ifs(FLAGS_collocation_data.c_str());
+void ReadEntries(const string &filename, std::vector<string> *entries) {
+  InputFileStream ifs(filename.c_str());
   string line;
-  std::vector<string> entries;
   while (!getline(ifs, line).fail()) {
     if (line.empty()) {
       continue;
     }
-    entries.push_back(line);
+    entries->push_back(line);
   }
+}
+
+void Convert() {
+  std::vector<string> entries;
+  ReadEntries(FLAGS_collocation_data, &entries);
 
   std::ostream *ofs = &std::cout;
   if (!FLAGS_output.empty()) {
@@ -75,10 +86,23 @@ void Convert() {
     }
   }
 
-  if (FLAGS_binary_mode) {
+  const string kNameSpace = "CollocationData";
+  if (FLAGS_tune) {
+    std::vector<string> holdout;
+    if (!FLAGS_holdout.empty()) {
+      ReadEntries(FLAGS_holdout, &holdout);
+    }
+    storage::ExistenceFilterBuilder::Options options;
+    options.target_error_rate = FLAGS_error_rate;
+    options.max_bytes = FLAGS_max_bytes;
+    if (FLAGS_binary_mode) {
+      OutputTunedExistenceBinary(entries, holdout, options, ofs);
+    } else {
+      OutputTunedExistenceHeader(entries, holdout, options, kNameSpace, ofs);
+    }
+  } else if (FLAGS_binary_mode) {
     OutputExistenceBinary(entries, ofs, FLAGS_error_rate);
   } else {
-    const string kNameSpace = "CollocationData";
     OutputExistenceHeader(entries, kNameSpace, ofs, FLAGS_error_rate);
   }
 
@@ -54,30 +54,42 @@ DEFINE_string(suppression_data, "", "suppression data text");
 DEFINE_string(output, "", "output file name (default: stdout)");
 DEFINE_double(error_rate, 0.00001, "error rate");
 DEFINE_bool(binary_mode, false, "outputs binary file");
+DEFINE_bool(tune, false,
+            "choose the parameters of the filter for --error_rate and "
+            "--max_bytes with ExistenceFilterBuilder");
+DEFINE_int32(max_bytes, 0, "maximum size of the tuned filter (0: no limit)");
+DEFINE_string(holdout, "",
+              "entries not in the data, in the same format, used to measure "
+              "the false positive rate of the tuned filter");
 
 namespace mozc {
 namespace {
 
+const char kSeparator[] = "\t";
+
+void ReadEntries(const string &filename, std::vector<string> *entries) {
+  InputFileStream ifs(filename.c_str());
+  string line;
+
+  while (!getline(ifs, line).fail()) {
+    if (line.empty()) {
+      continue;
+    }
+    std::vector<string> fields;
+    Util::SplitStringUsing(line, kSeparator, &fields);
+    CHECK_GE(fields.size(), 2);
+    entries->push_back(fields[0] + kSeparator + fields[1]);
+  }
+}
+
 void Convert() {
-  const char kSeparator[] = "\t";
   std::vector<string> entries;
 
   if (FLAGS_suppression_data.empty()) {
     const string kDummyStr = "__NO_DATA__";
     entries.push_back(kDummyStr + kSeparator + kDummyStr);
   } else {
-    InputFileStream ifs(FLAGS_suppression_data.c_str());
-    string line;
-
-    while (!getline(ifs, line).fail()) {
-      if (line.empty()) {
-        continue;
-      }
-      std::vector<string> fields;
-      Util::SplitStringUsing(line, kSeparator, &fields);
-      CHECK_GE(fields.size(), 2);
-      entries.push_back(fields[0] + kSeparator + fields[1]);
-    }
+    ReadEntries(FLAGS_suppression_data, &entries);
   }
 
   std::ostream *ofs = &std::cout;
@@ -90,10 +102,23 @@ void Convert() {
     }
   }
 
-  if (FLAGS_binary_mode) {
+  const string kNameSpace = "CollocationSuppressionData";
+  if (FLAGS_tune) {
+    std::vector<string> holdout;
+    if (!FLAGS_holdout.empty()) {
+      ReadEntries(FLAGS_holdout, &holdout);
+    }
+    storage::ExistenceFilterBuilder::Options options;
+    options.target_error_rate = FLAGS_error_rate;
+    options.max_bytes = FLAGS_max_bytes;
+    if (FLAGS_binary_mode) {
+      OutputTunedExistenceBinary(entries, holdout, options, ofs);
+    } else {
+      OutputTunedExistenceHeader(entries, holdout, options, kNameSpace, ofs);
+    }
+  } else if (FLAGS_binary_mode) {
     OutputExistenceBinary(entries, ofs, FLAGS_error_rate);
   } else {
-    const string kNameSpace = "CollocationSuppressionData";
     OutputExistenceHeader(entries, kNameSpace, ofs, FLAGS_error_rate);
   }
 
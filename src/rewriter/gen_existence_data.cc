@@ -43,6 +43,7 @@
 #include "storage/existence_filter.h"
 
 using mozc::storage::ExistenceFilter;
+using mozc::storage::ExistenceFilterBuilder;
 
 namespace mozc {
 namespace {
@@ -56,7 +57,8 @@ void GenExistenceData(const std::vector<string> &entries,
       error_rate, n);
   LOG(INFO) << "entry: " << n << " err: " << error_rate << " bytes: " << m;
 
-  std::unique_ptr<ExistenceFilter> filter(ExistenceFilter::CreateOptimal(m, n));
+  std::unique_ptr<ExistenceFilter> filter(
+      ExistenceFilter::CreateOptimal(m, n, ExistenceFilter::BLOCKED));
   DCHECK(filter.get());
 
   for (size_t i = 0; i < entries.size(); ++i) {
@@ -66,15 +68,29 @@ void GenExistenceData(const std::vector<string> &entries,
   filter->Write(existence_data, existence_data_size);
 }
 
-}  // namespace
+void GenTunedExistenceData(const std::vector<string> &entries,
+                           const std::vector<string> &holdout,
+                           const ExistenceFilterBuilder::Options &options,
+                           char **existence_data,
+                           size_t *existence_data_size) {
+  std::vector<uint64> ids(entries.size());
+  for (size_t i = 0; i < entries.size(); ++i) {
+    ids[i] = Hash::Fingerprint(entries[i]);
+  }
+  std::vector<uint64> holdout_ids(holdout.size());
+  for (size_t i = 0; i < holdout.size(); ++i) {
+    holdout_ids[i] = Hash::Fingerprint(holdout[i]);
+  }
 
-void OutputExistenceHeader(const std::vector<string> &entries,
-                           const string &data_namespace, std::ostream *ofs,
-                           double error_rate) {
-  char *existence_data = NULL;
-  size_t existence_data_size = 0;
-  GenExistenceData(entries, error_rate, &existence_data, &existence_data_size);
+  std::unique_ptr<ExistenceFilter> filter(
+      ExistenceFilterBuilder::Build(ids, holdout_ids, options, NULL));
+  DCHECK(filter.get());
+  filter->Write(existence_data, existence_data_size);
+}
 
+void WriteExistenceHeader(const string &data_namespace,
+                          char *existence_data, size_t existence_data_size,
+                          std::ostream *ofs) {
   *ofs << "// This header file is generated by "
        << "gen_existence_data." << std::endl;
 
@@ -88,11 +104,49 @@ void OutputExistenceHeader(const std::vector<string> &entries,
   *ofs << "}  // namespace " << data_namespace << std::endl;
 }
 
+}  // namespace
+
+void OutputExistenceHeader(const std::vector<string> &entries,
+                           const string &data_namespace, std::ostream *ofs,
+                           double error_rate) {
+  char *existence_data = NULL;
+  size_t existence_data_size = 0;
+  GenExistenceData(entries, error_rate, &existence_data, &existence_data_size);
+  WriteExistenceHeader(data_namespace, existence_data, existence_data_size,
+                       ofs);
+  delete [] existence_data;
+}
+
 void OutputExistenceBinary(const std::vector<string> &entries,
                            std::ostream *ofs, double error_rate) {
   char *existence_data = NULL;
   size_t existence_data_size = 0;
   GenExistenceData(entries, error_rate, &existence_data, &existence_data_size);
   ofs->write(existence_data, existence_data_size);
+  delete [] existence_data;
+}
+
+void OutputTunedExistenceHeader(
+    const std::vector<string> &entries, const std::vector<string> &holdout,
+    const ExistenceFilterBuilder::Options &options,
+    const string &data_namespace, std::ostream *ofs) {
+  char *existence_data = NULL;
+  size_t existence_data_size = 0;
+  GenTunedExistenceData(entries, holdout, options, &existence_data,
+                        &existence_data_size);
+  WriteExistenceHeader(data_namespace, existence_data, existence_data_size,
+                       ofs);
+  delete [] existence_data;
+}
+
+void OutputTunedExistenceBinary(
+    const std::vector<string> &entries, const std::vector<string> &holdout,
+    const ExistenceFilterBuilder::Options &options, std::ostream *ofs) {
+  char *existence_data = NULL;
+  size_t existence_data_size = 0;
+  GenTunedExistenceData(entries, holdout, options, &existence_data,
+                        &existence_data_size);
+  ofs->write(existence_data, existence_data_size);
+  delete [] existence_data;
 }
 }  // namespace mozc
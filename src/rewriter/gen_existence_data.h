@@ -35,6 +35,7 @@
 #include <vector>
 
 #include "base/port_string.h"
+#include "storage/existence_filter_builder.h"
 
 namespace mozc {
 
@@ -44,6 +45,18 @@ void OutputExistenceHeader(const std::vector<string> &entries,
 void OutputExistenceBinary(const std::vector<string> &entries,
                            std::ostream *ofs, double error_rate);
 
+// Same as above, but the filter is tuned by storage::ExistenceFilterBuilder
+// for |options|.  |holdout| lists the strings not in |entries| to measure
+// the false positive rate with.
+void OutputTunedExistenceHeader(
+    const std::vector<string> &entries, const std::vector<string> &holdout,
+    const storage::ExistenceFilterBuilder::Options &options,
+    const string &data_namespace, std::ostream *ofs);
+void OutputTunedExistenceBinary(
+    const std::vector<string> &entries, const std::vector<string> &holdout,
+    const storage::ExistenceFilterBuilder::Options &options,
+    std::ostream *ofs);
+
 }  // namespace mozc
 
 #endif  // MOZC_REWRITER_GEN_EXISTENCE_DATA_H_
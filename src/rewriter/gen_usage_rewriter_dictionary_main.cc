@@ -36,12 +36,14 @@
 //    --output_conjugation_index=conj_index.data
 //    --output_usage_item_array=usage_item_array.data
 //    --output_string_array=string_array.data
+//    --output_key_value_index=key_value_index.data
+//    --output_value_index=value_index.data
 //
 // * Prerequisite
 // Little endian is assumed.
 //
 // * Output file format
-// The output data consists of five files:
+// The output data consists of seven files:
 //
 // ** String array
 // All the strings (e.g., usage of word) are stored in this array and are
@@ -91,12 +93,26 @@
 // index is the conjugation type of this key value pair, and its conjugation
 // suffix types are retrieved using conjugation suffix index and conjugation
 // suffix array.
+//
+// ** Key value index
+// Array of uint32 pairs (usage item index, conjugation suffix index), each of
+// which represents the conjugated key value pair
+//   (key + key_suffix, value + value_suffix).
+// The pairs are sorted by the conjugated key and then by the conjugated value,
+// and are unique; if several items produce the same key value pair, the last
+// one in the usage item array wins.  The rewriter binary-searches this array
+// directly, so the index can be shared by processes mapping the data file.
+//
+// ** Value index
+// The same as the key value index but sorted and made unique only by the
+// conjugated value.  Used for the heuristic lookup ignoring keys.
 
 #include <algorithm>
 #include <iostream>
 #include <map>
 #include <set>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "base/file_stream.h"
@@ -114,6 +130,9 @@ DEFINE_string(output_conjugation_suffix, "", "output conjugation suffix array");
 DEFINE_string(output_conjugation_index, "", "output conjugation index array");
 DEFINE_string(output_usage_item_array, "", "output array of usage items");
 DEFINE_string(output_string_array, "", "output string array");
+DEFINE_string(output_key_value_index, "",
+              "output index sorted by conjugated key and value");
+DEFINE_string(output_value_index, "", "output index sorted by conjugated value");
 
 namespace mozc {
 namespace {
@@ -306,6 +325,8 @@ void Convert() {
 
   // Output conjugation suffix data.
   std::vector<int> conjugation_index(conjugation_list.size() + 1);
+  // (value suffix, key suffix) pairs in the same order as the output.
+  std::vector<std::pair<string, string>> conjugation_suffixes;
   {
     OutputFileStream ostream(FLAGS_output_conjugation_suffix.c_str(),
                              std::ios_base::out | std::ios_base::binary);
@@ -318,6 +339,7 @@ void Convert() {
         const uint32 index = Lookup(string_index, "");
         ostream.write(reinterpret_cast<const char *>(&index), 4);
         ostream.write(reinterpret_cast<const char *>(&index), 4);
+        conjugation_suffixes.emplace_back("", "");
         ++out_count;
       } else {
         using StrPair = std::pair<string, string>;
@@ -331,6 +353,7 @@ void Convert() {
           const uint32 key_suffix_index = Lookup(string_index, kv.second);
           ostream.write(reinterpret_cast<const char *>(&value_suffix_index), 4);
           ostream.write(reinterpret_cast<const char *>(&key_suffix_index), 4);
+          conjugation_suffixes.push_back(kv);
           ++out_count;
         }
       }
@@ -364,6 +387,42 @@ void Convert() {
     }
   }
 
+  // Output key value index and value index.  std::map keeps the last item
+  // for duplicated keys, which is the semantics the rewriter relies on.
+  {
+    using StrPair = std::pair<string, string>;
+    using IndexEntry = std::pair<uint32, uint32>;
+    std::map<StrPair, IndexEntry> key_value_index;
+    std::map<string, IndexEntry> value_index;
+    for (size_t i = 0; i < usage_entries.size(); ++i) {
+      const UsageItem &item = usage_entries[i];
+      for (int j = conjugation_index[item.conjugation_id];
+           j < conjugation_index[item.conjugation_id + 1]; ++j) {
+        const StrPair &suffix = conjugation_suffixes[j];
+        const string value = item.value + suffix.first;
+        const IndexEntry entry(i, j);
+        key_value_index[StrPair(item.key + suffix.second, value)] = entry;
+        value_index[value] = entry;
+      }
+    }
+    if (!FLAGS_output_key_value_index.empty()) {
+      OutputFileStream ostream(FLAGS_output_key_value_index.c_str(),
+                               std::ios_base::out | std::ios_base::binary);
+      for (const auto &kv : key_value_index) {
+        ostream.write(reinterpret_cast<const char *>(&kv.second.first), 4);
+        ostream.write(reinterpret_cast<const char *>(&kv.second.second), 4);
+      }
+    }
+    if (!FLAGS_output_value_index.empty()) {
+      OutputFileStream ostream(FLAGS_output_value_index.c_str(),
+                               std::ios_base::out | std::ios_base::binary);
+      for (const auto &kv : value_index) {
+        ostream.write(reinterpret_cast<const char *>(&kv.second.first), 4);
+        ostream.write(reinterpret_cast<const char *>(&kv.second.second), 4);
+      }
+    }
+  }
+
   // Output string array.
   {
     std::vector<StringPiece> strs;
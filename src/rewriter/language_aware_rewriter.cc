@@ -49,11 +49,20 @@ namespace mozc {
 using dictionary::DictionaryInterface;
 using dictionary::POSMatcher;
 
+namespace {
+
+// The number of the memoized dictionary lookups, which covers the
+// compositions of a few words typed recently.
+const size_t kRawQueryRankCacheSize = 32;
+
+}  // namespace
+
 LanguageAwareRewriter::LanguageAwareRewriter(
     const POSMatcher &pos_matcher,
     const DictionaryInterface *dictionary)
     : unknown_id_(pos_matcher.GetUnknownId()),
-      dictionary_(dictionary) {}
+      dictionary_(dictionary),
+      raw_query_rank_cache_(kRawQueryRankCacheSize) {}
 
 LanguageAwareRewriter::~LanguageAwareRewriter() = default;
 
@@ -95,10 +104,8 @@ int LanguageAwareRewriter::capability(
   return (RewriterInterface::SUGGESTION | RewriterInterface::PREDICTION);
 }
 
-namespace {
-bool IsRawQuery(const composer::Composer &composer,
-                const DictionaryInterface *dictionary,
-                int *rank) {
+bool LanguageAwareRewriter::IsRawQuery(const composer::Composer &composer,
+                                       int *rank) const {
   string raw_text;
   composer.GetRawString(&raw_text);
 
@@ -141,24 +148,45 @@ bool IsRawQuery(const composer::Composer &composer,
     return true;
   }
 
-  // If the composition is storead as a key in the dictionary like
-  // "はな" (hana), "たけ" (take), the query is not handled as a raw query.
-  // It is a little conservative, but a safer way.
-  if (dictionary->HasKey(key)) {
+  const int dictionary_rank = GetRawQueryRankFromDictionary(key, raw_text);
+  if (dictionary_rank < 0) {
     return false;
   }
+  *rank = dictionary_rank;
+  return true;
+}
+
+int LanguageAwareRewriter::GetRawQueryRankFromDictionary(
+    const string &key, const string &raw_text) const {
+  // |key| has no alphabet characters, so the tab can't be a part of it.
+  const string cache_key = key + "\t" + raw_text;
+  {
+    scoped_lock l(&raw_query_rank_cache_mutex_);
+    const int *cached_rank = raw_query_rank_cache_.Lookup(cache_key);
+    if (cached_rank != NULL) {
+      return *cached_rank;
+    }
+  }
 
+  // If the composition is storead as a key in the dictionary like
+  // "はな" (hana), "たけ" (take), the query is not handled as a raw query.
+  // It is a little conservative, but a safer way.
+  //
   // If the input text is stored in the dictionary, it is perhaps a raw query.
   // For example, the input characters of "れもヴぇ" (remove) is in the
   // dictionary, so it is treated as a raw text.
-  if (dictionary->HasValue(raw_text)) {
-    *rank = 2;
-    return true;
+  int rank = -1;
+  if (!dictionary_->HasKey(key) && dictionary_->HasValue(raw_text)) {
+    rank = 2;
   }
 
-  return false;
+  scoped_lock l(&raw_query_rank_cache_mutex_);
+  raw_query_rank_cache_.Insert(cache_key, rank);
+  return rank;
 }
 
+namespace {
+
 // Get T13n candidate ids from existing candidates.
 void GetAlphabetIds(const Segment &segment, uint16 *lid, uint16 *rid) {
   DCHECK(lid);
@@ -191,7 +219,7 @@ bool LanguageAwareRewriter::FillRawText(
   }
 
   int rank = 0;
-  if (!IsRawQuery(request.composer(), dictionary_, &rank)) {
+  if (!IsRawQuery(request.composer(), &rank)) {
     return false;
   }
 
@@ -229,6 +257,12 @@ bool LanguageAwareRewriter::FillRawText(
   return true;
 }
 
+bool LanguageAwareRewriter::Reload() {
+  scoped_lock l(&raw_query_rank_cache_mutex_);
+  raw_query_rank_cache_.Clear();
+  return true;
+}
+
 bool LanguageAwareRewriter::Rewrite(
     const ConversionRequest &request, Segments *segments) const {
   if (!IsEnabled(request)) {
@@ -30,13 +30,20 @@
 #ifndef MOZC_REWRITER_LANGUAGE_AWARE_REWRITER_H_
 #define MOZC_REWRITER_LANGUAGE_AWARE_REWRITER_H_
 
+#include <string>
+
+#include "base/mutex.h"
 #include "base/port.h"
 #include "converter/segments.h"
 #include "dictionary/dictionary_interface.h"
 #include "dictionary/pos_matcher.h"
 #include "rewriter/rewriter_interface.h"
+#include "storage/lru_cache.h"
 
 namespace mozc {
+namespace composer {
+class Composer;
+}  // namespace composer
 
 class LanguageAwareRewriter : public RewriterInterface {
  public:
@@ -51,14 +58,34 @@ class LanguageAwareRewriter : public RewriterInterface {
 
   virtual void Finish(const ConversionRequest &request, Segments *segments);
 
+  // Clears the memo of the dictionary lookups.
+  virtual bool Reload();
+
  private:
   // Fills the raw text if the query does not look like Japanese.
   bool FillRawText(const ConversionRequest &request,
                    Segments *segments) const;
 
+  // Returns true if the composition looks like a raw query, i.e., English
+  // typed in the Roman-Hiragana mode, and sets the rank of the candidate.
+  bool IsRawQuery(const composer::Composer &composer, int *rank) const;
+
+  // Returns the rank of the raw query candidate decided from the dictionary
+  // for the query |key| typed as |raw_text|, or -1 if it isn't a raw query.
+  // The results are memoized, as the same composition is rewritten several
+  // times, e.g., for the suggestion, the prediction and after a backspace.
+  // The user dictionary doesn't support HasKey() and HasValue(), so the
+  // results don't change while the engine is alive.
+  int GetRawQueryRankFromDictionary(const string &key,
+                                    const string &raw_text) const;
+
   const uint16 unknown_id_;
   const dictionary::DictionaryInterface *dictionary_;
 
+  // Guards |raw_query_rank_cache_|.
+  mutable Mutex raw_query_rank_cache_mutex_;
+  mutable storage::LRUCache<string, int> raw_query_rank_cache_;
+
   DISALLOW_COPY_AND_ASSIGN(LanguageAwareRewriter);
 };
 
@@ -253,6 +253,37 @@ TEST_F(LanguageAwareRewriterTest, LanguageAwareInput) {
   }
 }
 
+TEST_F(LanguageAwareRewriterTest, MemoizeDictionaryLookups) {
+  unique_ptr<LanguageAwareRewriter> rewriter(CreateLanguageAwareRewriter());
+
+  {
+    // "house" is not in the dictionary yet.
+    string composition;
+    Segments segments;
+    EXPECT_FALSE(RewriteWithLanguageAwareInput(rewriter.get(), "house",
+                                               &composition, &segments));
+  }
+
+  dictionary_mock_->AddLookupExact("house", "house", "house", Token::NONE);
+  {
+    // The result of the lookups above is reused for the same composition.
+    string composition;
+    Segments segments;
+    EXPECT_FALSE(RewriteWithLanguageAwareInput(rewriter.get(), "house",
+                                               &composition, &segments));
+  }
+
+  // Reload() forgets the results.
+  EXPECT_TRUE(rewriter->Reload());
+  {
+    string composition;
+    Segments segments;
+    EXPECT_TRUE(RewriteWithLanguageAwareInput(rewriter.get(), "house",
+                                              &composition, &segments));
+    EXPECT_EQ("house", segments.conversion_segment(0).candidate(0).value);
+  }
+}
+
 TEST_F(LanguageAwareRewriterTest, LanguageAwareInputUsageStats) {
   unique_ptr<LanguageAwareRewriter> rewriter(CreateLanguageAwareRewriter());
 
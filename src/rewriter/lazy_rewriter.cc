@@ -0,0 +1,130 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "rewriter/lazy_rewriter.h"
+
+#include <utility>
+
+#include "base/logging.h"
+
+namespace mozc {
+
+LazyRewriter::LazyRewriter(Trigger trigger, Factory factory)
+    : trigger_(trigger), factory_(std::move(factory)), constructed_(nullptr) {
+  DCHECK(trigger_);
+  DCHECK(factory_);
+}
+
+LazyRewriter::~LazyRewriter() = default;
+
+bool LazyRewriter::IsTriggered(const ConversionRequest &request,
+                               const Segments &segments) const {
+  if (!(*trigger_)(request, segments)) {
+    return false;
+  }
+  Get();
+  return true;
+}
+
+int LazyRewriter::capability(const ConversionRequest &request) const {
+  return Get()->capability(request);
+}
+
+bool LazyRewriter::Rewrite(const ConversionRequest &request,
+                           Segments *segments) const {
+  DCHECK(segments);
+  if (!(*trigger_)(request, *segments)) {
+    return false;
+  }
+  return Get()->Rewrite(request, segments);
+}
+
+bool LazyRewriter::is_parallelizable() const {
+  return Get()->is_parallelizable();
+}
+
+bool LazyRewriter::Focus(Segments *segments, size_t segment_index,
+                         int candidate_index) const {
+  RewriterInterface *rewriter = GetConstructed();
+  if (rewriter == nullptr) {
+    return true;
+  }
+  return rewriter->Focus(segments, segment_index, candidate_index);
+}
+
+void LazyRewriter::Finish(const ConversionRequest &request,
+                          Segments *segments) {
+  RewriterInterface *rewriter = GetConstructed();
+  if (rewriter != nullptr) {
+    rewriter->Finish(request, segments);
+  }
+}
+
+bool LazyRewriter::Sync() {
+  RewriterInterface *rewriter = GetConstructed();
+  return rewriter == nullptr || rewriter->Sync();
+}
+
+bool LazyRewriter::Reload() {
+  RewriterInterface *rewriter = GetConstructed();
+  return rewriter == nullptr || rewriter->Reload();
+}
+
+void LazyRewriter::Clear() {
+  RewriterInterface *rewriter = GetConstructed();
+  if (rewriter != nullptr) {
+    rewriter->Clear();
+  }
+}
+
+size_t LazyRewriter::GetHeapMemoryUsage() const {
+  RewriterInterface *rewriter = GetConstructed();
+  return rewriter == nullptr ? 0 : rewriter->GetHeapMemoryUsage();
+}
+
+RewriterInterface *LazyRewriter::Get() const {
+  RewriterInterface *rewriter = GetConstructed();
+  if (rewriter != nullptr) {
+    return rewriter;
+  }
+  scoped_lock lock(&mutex_);
+  if (rewriter_ == nullptr) {
+    rewriter_.reset(factory_());
+    CHECK(rewriter_);
+    constructed_.store(rewriter_.get(), std::memory_order_release);
+  }
+  return rewriter_.get();
+}
+
+RewriterInterface *LazyRewriter::GetConstructed() const {
+  return constructed_.load(std::memory_order_acquire);
+}
+
+}  // namespace mozc
@@ -0,0 +1,98 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef MOZC_REWRITER_LAZY_REWRITER_H_
+#define MOZC_REWRITER_LAZY_REWRITER_H_
+
+#include <atomic>
+#include <functional>
+#include <memory>
+
+#include "base/mutex.h"
+#include "base/port.h"
+#include "rewriter/rewriter_interface.h"
+
+namespace mozc {
+
+class ConversionRequest;
+class Segments;
+
+// Defers the construction of a rarely triggered rewriter until its trigger
+// first matches.  The trigger must not depend on the state of the rewriter.
+// Since Finish() etc. are not forwarded before the construction, it is only
+// for rewriters that learn nothing from the segments they do not rewrite.
+class LazyRewriter : public RewriterInterface {
+ public:
+  typedef bool (*Trigger)(const ConversionRequest &request,
+                          const Segments &segments);
+  typedef std::function<RewriterInterface *()> Factory;
+
+  LazyRewriter(Trigger trigger, Factory factory);
+  ~LazyRewriter() override;
+
+  bool has_trigger() const override { return true; }
+
+  // Constructs the rewriter when |trigger| returns true.
+  bool IsTriggered(const ConversionRequest &request,
+                   const Segments &segments) const override;
+
+  int capability(const ConversionRequest &request) const override;
+  bool Rewrite(const ConversionRequest &request,
+               Segments *segments) const override;
+  bool is_parallelizable() const override;
+  bool Focus(Segments *segments, size_t segment_index,
+             int candidate_index) const override;
+  void Finish(const ConversionRequest &request, Segments *segments) override;
+  bool Sync() override;
+  bool Reload() override;
+  void Clear() override;
+  size_t GetHeapMemoryUsage() const override;
+
+  // Returns true if the rewriter has been constructed.
+  bool constructed() const { return GetConstructed() != nullptr; }
+
+ private:
+  // Returns the rewriter, constructing it if necessary.
+  RewriterInterface *Get() const;
+  // Returns the rewriter, or nullptr if it has not been constructed yet.
+  RewriterInterface *GetConstructed() const;
+
+  const Trigger trigger_;
+  const Factory factory_;
+  mutable Mutex mutex_;
+  mutable std::unique_ptr<RewriterInterface> rewriter_;
+  mutable std::atomic<RewriterInterface *> constructed_;
+
+  DISALLOW_COPY_AND_ASSIGN(LazyRewriter);
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_REWRITER_LAZY_REWRITER_H_
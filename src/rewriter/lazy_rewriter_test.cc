@@ -0,0 +1,153 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "rewriter/lazy_rewriter.h"
+
+#include <string>
+
+#include "converter/segments.h"
+#include "request/conversion_request.h"
+#include "rewriter/merger_rewriter.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace {
+
+// Inserts a candidate to the segment whose key is "trigger".
+class TriggeredRewriter : public RewriterInterface {
+ public:
+  explicit TriggeredRewriter(int *rewrite_count)
+      : rewrite_count_(rewrite_count) {}
+
+  bool Rewrite(const ConversionRequest &request,
+               Segments *segments) const override {
+    ++*rewrite_count_;
+    if (!IsTriggeredBy(request, *segments)) {
+      return false;
+    }
+    Segment::Candidate *candidate =
+        segments->mutable_conversion_segment(0)->add_candidate();
+    candidate->Init();
+    candidate->value = "triggered";
+    return true;
+  }
+
+  static bool IsTriggeredBy(const ConversionRequest &request,
+                            const Segments &segments) {
+    return segments.conversion_segments_size() == 1 &&
+           segments.conversion_segment(0).key() == "trigger";
+  }
+
+ private:
+  int *rewrite_count_;
+};
+
+void InitSegments(const string &key, Segments *segments) {
+  segments->Clear();
+  segments->set_request_type(Segments::CONVERSION);
+  Segment *segment = segments->add_segment();
+  segment->set_key(key);
+  Segment::Candidate *candidate = segment->add_candidate();
+  candidate->Init();
+  candidate->key = key;
+  candidate->value = key;
+}
+
+TEST(LazyRewriterTest, ConstructOnFirstTrigger) {
+  int construct_count = 0;
+  int rewrite_count = 0;
+  LazyRewriter rewriter(&TriggeredRewriter::IsTriggeredBy,
+                        [&construct_count, &rewrite_count] {
+                          ++construct_count;
+                          return new TriggeredRewriter(&rewrite_count);
+                        });
+  EXPECT_TRUE(rewriter.has_trigger());
+  EXPECT_FALSE(rewriter.constructed());
+
+  const ConversionRequest request;
+  Segments segments;
+  InitSegments("key", &segments);
+  EXPECT_FALSE(rewriter.IsTriggered(request, segments));
+  EXPECT_FALSE(rewriter.Rewrite(request, &segments));
+  EXPECT_TRUE(rewriter.Focus(&segments, 0, 0));
+  rewriter.Finish(request, &segments);
+  EXPECT_TRUE(rewriter.Sync());
+  EXPECT_TRUE(rewriter.Reload());
+  rewriter.Clear();
+  EXPECT_EQ(0, rewriter.GetHeapMemoryUsage());
+  EXPECT_FALSE(rewriter.constructed());
+  EXPECT_EQ(0, construct_count);
+  EXPECT_EQ(0, rewrite_count);
+
+  InitSegments("trigger", &segments);
+  EXPECT_TRUE(rewriter.IsTriggered(request, segments));
+  EXPECT_TRUE(rewriter.constructed());
+  EXPECT_EQ(RewriterInterface::CONVERSION, rewriter.capability(request));
+  EXPECT_TRUE(rewriter.Rewrite(request, &segments));
+  EXPECT_EQ(2, segments.conversion_segment(0).candidates_size());
+  EXPECT_EQ("triggered", segments.conversion_segment(0).candidate(1).value);
+  EXPECT_EQ(1, construct_count);
+  EXPECT_EQ(1, rewrite_count);
+
+  // The rewriter is constructed only once.
+  InitSegments("trigger", &segments);
+  EXPECT_TRUE(rewriter.IsTriggered(request, segments));
+  EXPECT_TRUE(rewriter.Rewrite(request, &segments));
+  EXPECT_EQ(1, construct_count);
+  EXPECT_EQ(2, rewrite_count);
+}
+
+TEST(LazyRewriterTest, MergerRewriterSkipsUntriggeredRewriter) {
+  int construct_count = 0;
+  int rewrite_count = 0;
+  MergerRewriter merger;
+  merger.AddRewriter(new LazyRewriter(&TriggeredRewriter::IsTriggeredBy,
+                                      [&construct_count, &rewrite_count] {
+                                        ++construct_count;
+                                        return new TriggeredRewriter(
+                                            &rewrite_count);
+                                      }),
+                     "TriggeredRewriter");
+
+  const ConversionRequest request;
+  Segments segments;
+  InitSegments("key", &segments);
+  EXPECT_FALSE(merger.Rewrite(request, &segments));
+  EXPECT_EQ(0, construct_count);
+  EXPECT_EQ(0, rewrite_count);
+
+  InitSegments("trigger", &segments);
+  EXPECT_TRUE(merger.Rewrite(request, &segments));
+  EXPECT_EQ(1, construct_count);
+  EXPECT_EQ(1, rewrite_count);
+}
+
+}  // namespace
+}  // namespace mozc
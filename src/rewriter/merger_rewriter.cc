@@ -0,0 +1,366 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "rewriter/merger_rewriter.h"
+
+#include <memory>
+#include <vector>
+
+#include "base/allocation_stats.h"
+#include "base/logging.h"
+#include "base/stopwatch.h"
+#include "base/trace_events.h"
+#include "usage_stats/usage_stats.h"
+
+namespace mozc {
+namespace {
+
+bool IsSameCandidate(const Segment::Candidate &lhs,
+                     const Segment::Candidate &rhs) {
+  return lhs.key == rhs.key &&
+      lhs.value == rhs.value &&
+      lhs.content_key == rhs.content_key &&
+      lhs.content_value == rhs.content_value &&
+      lhs.consumed_key_size == rhs.consumed_key_size &&
+      lhs.prefix == rhs.prefix &&
+      lhs.suffix == rhs.suffix &&
+      lhs.description == rhs.description &&
+      lhs.usage_id == rhs.usage_id &&
+      lhs.usage_title == rhs.usage_title &&
+      lhs.usage_description == rhs.usage_description &&
+      lhs.cost == rhs.cost &&
+      lhs.wcost == rhs.wcost &&
+      lhs.structure_cost == rhs.structure_cost &&
+      lhs.lid == rhs.lid &&
+      lhs.rid == rhs.rid &&
+      lhs.attributes == rhs.attributes &&
+      lhs.source_info == rhs.source_info &&
+      lhs.style == rhs.style &&
+      lhs.command == rhs.command &&
+      lhs.inner_segment_boundary == rhs.inner_segment_boundary;
+}
+
+// Finds the candidates of |base| in |target| in order.  On success,
+// (*positions)[j] is the index of base.candidate(j) in |target|, and
+// (*positions)[base.candidates_size()] is target.candidates_size().  Returns
+// false if |target| is not |base| with some candidates inserted.
+bool MatchCandidates(const Segment &base, const Segment &target,
+                     std::vector<size_t> *positions) {
+  if (base.key() != target.key() ||
+      base.segment_type() != target.segment_type() ||
+      base.meta_candidates_size() != target.meta_candidates_size()) {
+    return false;
+  }
+  positions->clear();
+  size_t j = 0;
+  for (size_t i = 0; i < target.candidates_size(); ++i) {
+    if (j < base.candidates_size() &&
+        IsSameCandidate(base.candidate(j), target.candidate(i))) {
+      positions->push_back(i);
+      ++j;
+    }
+  }
+  if (j != base.candidates_size()) {
+    return false;
+  }
+  positions->push_back(target.candidates_size());
+  return true;
+}
+
+// Inserts the candidates that |rewritten| added to |base| into |segments|.
+// Both |base| and |segments| are the segments before the rewrite, possibly
+// with candidates inserted into |segments| by other rewriters.  The new
+// candidates are placed before the same base candidate as in |rewritten|, and
+// after the candidates inserted there by the previous rewriters.  Returns
+// false without modifying |segments| if |rewritten| is not |base| with
+// inserted candidates.
+bool MergeInsertedCandidates(const Segments &base, const Segments &rewritten,
+                             Segments *segments) {
+  if (base.segments_size() != rewritten.segments_size() ||
+      base.segments_size() != segments->segments_size()) {
+    return false;
+  }
+  std::vector<std::vector<size_t>> rewritten_positions(base.segments_size());
+  std::vector<std::vector<size_t>> current_positions(base.segments_size());
+  for (size_t i = 0; i < base.segments_size(); ++i) {
+    if (!MatchCandidates(base.segment(i), rewritten.segment(i),
+                         &rewritten_positions[i]) ||
+        !MatchCandidates(base.segment(i), segments->segment(i),
+                         &current_positions[i])) {
+      return false;
+    }
+  }
+
+  for (size_t i = 0; i < base.segments_size(); ++i) {
+    const Segment &rewritten_segment = rewritten.segment(i);
+    const std::vector<size_t> &anchors = rewritten_positions[i];
+    const std::vector<size_t> &positions = current_positions[i];
+    Segment *segment = segments->mutable_segment(i);
+    size_t inserted = 0;
+    for (size_t j = 0; j < anchors.size(); ++j) {
+      // Candidates in [begin, anchors[j]) were inserted before the j-th base
+      // candidate.
+      const size_t begin = (j == 0) ? 0 : anchors[j - 1] + 1;
+      for (size_t k = begin; k < anchors[j]; ++k) {
+        segment->insert_candidate(positions[j] + inserted)->CopyFrom(
+            rewritten_segment.candidate(k));
+        ++inserted;
+      }
+    }
+  }
+  return true;
+}
+
+uint64 GetElapsedMicroseconds(Stopwatch *stopwatch) {
+  return static_cast<uint64>(stopwatch->GetElapsedMicroseconds());
+}
+
+void Add(std::atomic<uint64> *counter, uint64 value) {
+  counter->fetch_add(value, std::memory_order_relaxed);
+}
+
+uint64 Load(const std::atomic<uint64> &counter) {
+  return counter.load(std::memory_order_relaxed);
+}
+
+}  // namespace
+
+void MergerRewriter::GetRewritePlan(const ConversionRequest &request,
+                                    const Segments &segments,
+                                    std::vector<size_t> *plan) const {
+  plan->clear();
+  int type = RewriterInterface::NOT_AVAILABLE;
+  switch (segments.request_type()) {
+    case Segments::CONVERSION:
+      type = RewriterInterface::CONVERSION;
+      break;
+    case Segments::PREDICTION:
+    case Segments::PARTIAL_PREDICTION:
+      type = RewriterInterface::PREDICTION;
+      break;
+    case Segments::SUGGESTION:
+    case Segments::PARTIAL_SUGGESTION:
+      type = RewriterInterface::SUGGESTION;
+      break;
+    case Segments::REVERSE_CONVERSION:
+    default:
+      return;
+  }
+  for (size_t i = 0; i < rewriters_.size(); ++i) {
+    if (rewriters_[i]->capability(request) & type) {
+      plan->push_back(i);
+    }
+  }
+}
+
+bool MergerRewriter::Rewrite(const ConversionRequest &request,
+                             Segments *segments) const {
+  DCHECK(segments);
+  ScopedAllocationStage allocation_stage(AllocationStats::REWRITER);
+  Stopwatch stopwatch = Stopwatch::StartNew();
+  std::vector<size_t> plan;
+  GetRewritePlan(request, *segments, &plan);
+  bool result = false;
+  for (size_t p = 0; p < plan.size();) {
+    // Once the request is canceled, the remaining rewriters are skipped.
+    if (request.IsCanceled()) {
+      VLOG(1) << "Rewrite is canceled";
+      break;
+    }
+    const size_t i = plan[p];
+    if (!IsTriggered(i, request, *segments)) {
+      ++p;
+      continue;
+    }
+    if (thread_pool_ == nullptr || !rewriters_[i]->is_parallelizable()) {
+      result |= RewriteWithStatistics(i, request, segments);
+      ++p;
+      continue;
+    }
+    // Collect the consecutive parallelizable rewriters.  Untriggered
+    // rewriters in between are skipped as in the sequential mode.
+    std::vector<size_t> group;
+    for (; p < plan.size(); ++p) {
+      const size_t j = plan[p];
+      if (!IsTriggered(j, request, *segments)) {
+        continue;
+      }
+      if (!rewriters_[j]->is_parallelizable()) {
+        break;
+      }
+      group.push_back(j);
+    }
+    result |= RewriteInParallel(request, group, segments);
+  }
+
+  if (segments->request_type() == Segments::SUGGESTION &&
+      segments->conversion_segments_size() == 1 &&
+      !request.request().mixed_conversion()) {
+    const size_t max_suggestions = request.config().suggestions_size();
+    Segment *segment = segments->mutable_conversion_segment(0);
+    const size_t candidate_size = segment->candidates_size();
+    if (candidate_size > max_suggestions) {
+      segment->erase_candidates(max_suggestions,
+                                candidate_size - max_suggestions);
+    }
+  }
+  usage_stats::UsageStats::UpdateTiming("RewriterElapsedTimeUSec",
+                                       GetElapsedMicroseconds(&stopwatch));
+  return result;
+}
+
+void MergerRewriter::Finish(const ConversionRequest &request,
+                            Segments *segments) {
+  for (size_t i = 0; i < rewriters_.size(); ++i) {
+    Stopwatch stopwatch = Stopwatch::StartNew();
+    rewriters_[i]->Finish(request, segments);
+    Add(&statistics_[i]->finish_count, 1);
+    Add(&statistics_[i]->finish_time_usec, GetElapsedMicroseconds(&stopwatch));
+  }
+}
+
+bool MergerRewriter::Sync() {
+  bool result = false;
+  for (size_t i = 0; i < rewriters_.size(); ++i) {
+    Stopwatch stopwatch = Stopwatch::StartNew();
+    result |= rewriters_[i]->Sync();
+    Add(&statistics_[i]->sync_count, 1);
+    Add(&statistics_[i]->sync_time_usec, GetElapsedMicroseconds(&stopwatch));
+  }
+  return result;
+}
+
+void MergerRewriter::GetStatistics(
+    commands::RewriterStatistics *statistics) const {
+  DCHECK(statistics);
+  statistics->Clear();
+  for (size_t i = 0; i < rewriters_.size(); ++i) {
+    const Statistics &stats = *statistics_[i];
+    commands::RewriterStatistics::Entry *entry = statistics->add_entry();
+    entry->set_name(names_[i]);
+    entry->set_rewrite_count(Load(stats.rewrite_count));
+    entry->set_rewrite_modified_count(Load(stats.rewrite_modified_count));
+    entry->set_rewrite_time_usec(Load(stats.rewrite_time_usec));
+    entry->set_finish_count(Load(stats.finish_count));
+    entry->set_finish_time_usec(Load(stats.finish_time_usec));
+    entry->set_sync_count(Load(stats.sync_count));
+    entry->set_sync_time_usec(Load(stats.sync_time_usec));
+  }
+}
+
+void MergerRewriter::GetMemoryUsage(commands::MemoryUsage *usage) const {
+  DCHECK(usage);
+  for (size_t i = 0; i < rewriters_.size(); ++i) {
+    const size_t heap_bytes = rewriters_[i]->GetHeapMemoryUsage();
+    if (heap_bytes == 0) {
+      continue;
+    }
+    commands::MemoryUsage::Entry *entry = usage->add_entry();
+    entry->set_name(names_[i]);
+    entry->set_heap_bytes(heap_bytes);
+  }
+}
+
+void MergerRewriter::ResetStatistics() {
+  for (size_t i = 0; i < statistics_.size(); ++i) {
+    Statistics *stats = statistics_[i];
+    stats->rewrite_count.store(0, std::memory_order_relaxed);
+    stats->rewrite_modified_count.store(0, std::memory_order_relaxed);
+    stats->rewrite_time_usec.store(0, std::memory_order_relaxed);
+    stats->finish_count.store(0, std::memory_order_relaxed);
+    stats->finish_time_usec.store(0, std::memory_order_relaxed);
+    stats->sync_count.store(0, std::memory_order_relaxed);
+    stats->sync_time_usec.store(0, std::memory_order_relaxed);
+  }
+}
+
+bool MergerRewriter::RewriteWithStatistics(size_t index,
+                                           const ConversionRequest &request,
+                                           Segments *segments) const {
+  MOZC_TRACE_SCOPE(names_[index].empty() ? StringPiece("Rewrite")
+                                         : StringPiece(names_[index]));
+  Stopwatch stopwatch = Stopwatch::StartNew();
+  const bool result = rewriters_[index]->Rewrite(request, segments);
+  Statistics *stats = statistics_[index];
+  Add(&stats->rewrite_count, 1);
+  if (result) {
+    Add(&stats->rewrite_modified_count, 1);
+  }
+  Add(&stats->rewrite_time_usec, GetElapsedMicroseconds(&stopwatch));
+  return result;
+}
+
+bool MergerRewriter::RewriteInParallel(
+    const ConversionRequest &request,
+    const std::vector<size_t> &group,
+    Segments *segments) const {
+  DCHECK(thread_pool_);
+  if (group.size() == 1) {
+    return RewriteWithStatistics(group[0], request, segments);
+  }
+
+  // The first rewriter runs on this thread.  The others run on copies.
+  Segments base;
+  base.CopyFrom(*segments);
+  std::vector<std::unique_ptr<Segments>> copies(group.size());
+  std::vector<char> results(group.size(), false);
+  BlockingCounter counter(static_cast<int>(group.size() - 1));
+  for (size_t i = 1; i < group.size(); ++i) {
+    copies[i].reset(new Segments);
+    copies[i]->CopyFrom(base);
+    const size_t index = group[i];
+    Segments *copy = copies[i].get();
+    char *result = &results[i];
+    thread_pool_->Schedule([this, &request, &counter, index, copy, result]() {
+      *result = RewriteWithStatistics(index, request, copy);
+      counter.DecrementCount();
+    });
+  }
+  results[0] = RewriteWithStatistics(group[0], request, segments);
+  counter.Wait();
+
+  bool result = results[0];
+  bool sequential = false;
+  for (size_t i = 1; i < group.size(); ++i) {
+    if (!sequential) {
+      if (MergeInsertedCandidates(base, *copies[i], segments)) {
+        result |= results[i];
+        continue;
+      }
+      // This rewriter (or the previous one) did more than insertion.
+      VLOG(1) << "Falls back to the sequential rewrite.";
+      sequential = true;
+    }
+    result |= RewriteWithStatistics(group[i], request, segments);
+  }
+  return result;
+}
+
+}  // namespace mozc
@@ -30,9 +30,13 @@
 #ifndef MOZC_REWRITER_MERGER_REWRITER_H_
 #define MOZC_REWRITER_MERGER_REWRITER_H_
 
+#include <atomic>
+#include <memory>
+#include <string>
 #include <vector>
 
 #include "base/stl_util.h"
+#include "base/thread_pool.h"
 #include "config/config_handler.h"
 #include "converter/segments.h"
 #include "protocol/commands.pb.h"
@@ -47,6 +51,7 @@ class MergerRewriter : public RewriterInterface {
   MergerRewriter() {}
   virtual ~MergerRewriter() {
     STLDeleteElements(&rewriters_);
+    STLDeleteElements(&statistics_);
   }
 
   // return true if rewriter can be called with the segments.
@@ -78,32 +83,40 @@ class MergerRewriter : public RewriterInterface {
 
   // This instance owns the rewriter.
   void AddRewriter(RewriterInterface *rewriter) {
-    rewriters_.push_back(rewriter);
+    AddRewriter(rewriter, "");
   }
 
-  virtual bool Rewrite(const ConversionRequest &request,
-                       Segments *segments) const {
-    bool result = false;
-    for (size_t i = 0; i < rewriters_.size(); ++i) {
-      if (CheckCapablity(request, segments, rewriters_[i])) {
-        result |= rewriters_[i]->Rewrite(request, segments);
-      }
-    }
+  // |name| is used to identify the rewriter in GetStatistics().
+  void AddRewriter(RewriterInterface *rewriter, const string &name) {
+    rewriters_.push_back(rewriter);
+    has_trigger_.push_back(rewriter->has_trigger());
+    names_.push_back(name);
+    statistics_.push_back(new Statistics);
+  }
 
-    if (segments->request_type() == Segments::SUGGESTION &&
-        segments->conversion_segments_size() == 1 &&
-        !request.request().mixed_conversion()) {
-      const size_t max_suggestions = request.config().suggestions_size();
-      Segment *segment = segments->mutable_conversion_segment(0);
-      const size_t candidate_size = segment->candidates_size();
-      if (candidate_size > max_suggestions) {
-        segment->erase_candidates(max_suggestions,
-                                  candidate_size - max_suggestions);
-      }
-    }
-    return result;
+  // Fills the number of calls and the elapsed time of Rewrite(), Finish() and
+  // Sync() of each rewriter, accumulated since the construction or the last
+  // ResetStatistics().
+  void GetStatistics(commands::RewriterStatistics *statistics) const;
+  void ResetStatistics();
+
+  // Adds an entry to |usage| for each rewriter that allocates its internal
+  // data in heap.  See RewriterInterface::GetHeapMemoryUsage().
+  void GetMemoryUsage(commands::MemoryUsage *usage) const;
+
+  // Runs consecutive rewriters whose is_parallelizable() is true on
+  // |num_threads| worker threads.  Each of them rewrites a copy of the
+  // segments, and the inserted candidates are merged into the segments in the
+  // order of AddRewriter().  If a rewriter turns out to have modified the
+  // existing candidates, it and the following rewriters of the group are run
+  // again sequentially, so the result stays deterministic.
+  void EnableParallelRewrite(int num_threads) {
+    thread_pool_.reset(new ThreadPool(num_threads));
   }
 
+  virtual bool Rewrite(const ConversionRequest &request,
+                       Segments *segments) const;
+
   // This method is mainly called when user puts SPACE key
   // and changes the focused candidate.
   // In this method, Converter will find bracketing matching.
@@ -122,20 +135,10 @@ class MergerRewriter : public RewriterInterface {
   }
 
   // Hook(s) for all mutable operations
-  virtual void Finish(const ConversionRequest &request, Segments *segments) {
-    for (size_t i = 0; i < rewriters_.size(); ++i) {
-      rewriters_[i]->Finish(request, segments);
-    }
-  }
+  virtual void Finish(const ConversionRequest &request, Segments *segments);
 
   // Syncs internal data to local file system.
-  virtual bool Sync() {
-    bool result = false;
-    for (size_t i = 0; i < rewriters_.size(); ++i) {
-      result |= rewriters_[i]->Sync();
-    }
-    return result;
-  }
+  virtual bool Sync();
 
   // Reloads internal data from local file system.
   virtual bool Reload() {
@@ -154,7 +157,50 @@ class MergerRewriter : public RewriterInterface {
   }
 
  private:
+  // Counters are updated with relaxed atomic operations, as Rewrite() may be
+  // called from the worker threads.
+  struct Statistics {
+    Statistics()
+        : rewrite_count(0), rewrite_modified_count(0), rewrite_time_usec(0),
+          finish_count(0), finish_time_usec(0),
+          sync_count(0), sync_time_usec(0) {}
+
+    std::atomic<uint64> rewrite_count;
+    std::atomic<uint64> rewrite_modified_count;
+    std::atomic<uint64> rewrite_time_usec;
+    std::atomic<uint64> finish_count;
+    std::atomic<uint64> finish_time_usec;
+    std::atomic<uint64> sync_count;
+    std::atomic<uint64> sync_time_usec;
+  };
+
+  // Fills |plan| with the indices of the rewriters capable of the request
+  // type of |segments|, in the order of AddRewriter().  capability() of each
+  // rewriter is called only here, once per Rewrite().
+  void GetRewritePlan(const ConversionRequest &request,
+                      const Segments &segments,
+                      std::vector<size_t> *plan) const;
+
+  // Returns true if the |index|-th rewriter is triggered by |segments|.
+  bool IsTriggered(size_t index, const ConversionRequest &request,
+                   const Segments &segments) const {
+    return !has_trigger_[index] ||
+           rewriters_[index]->IsTriggered(request, segments);
+  }
+
+  // Calls Rewrite() of the |index|-th rewriter and records its statistics.
+  bool RewriteWithStatistics(size_t index, const ConversionRequest &request,
+                             Segments *segments) const;
+  bool RewriteInParallel(const ConversionRequest &request,
+                         const std::vector<size_t> &group,
+                         Segments *segments) const;
+
   std::vector<RewriterInterface *> rewriters_;
+  // Cache of has_trigger() of |rewriters_|.
+  std::vector<bool> has_trigger_;
+  std::vector<string> names_;
+  std::vector<Statistics *> statistics_;
+  std::unique_ptr<ThreadPool> thread_pool_;
 
   DISALLOW_COPY_AND_ASSIGN(MergerRewriter);
 };
@@ -29,11 +29,16 @@
 
 #include "rewriter/merger_rewriter.h"
 
+#include <algorithm>
+#include <atomic>
 #include <string>
 
+#include "base/clock.h"
+#include "base/clock_mock.h"
 #include "base/system_util.h"
 #include "config/config_handler.h"
 #include "converter/segments.h"
+#include "protocol/commands.pb.h"
 #include "protocol/config.pb.h"
 #include "request/conversion_request.h"
 #include "testing/base/public/gunit.h"
@@ -101,11 +106,129 @@ class TestRewriter : public RewriterInterface {
   int capability_;
 };
 
+// Records the calls of capability() and IsTriggered() as well as Rewrite().
+class TriggeredRewriter : public TestRewriter {
+ public:
+  TriggeredRewriter(string *buffer, const string &name, int capability)
+      : TestRewriter(buffer, name, true, capability),
+        buffer_(buffer), name_(name) {}
+
+  virtual int capability(const ConversionRequest &request) const {
+    buffer_->append(name_ + ".capability();");
+    return TestRewriter::capability(request);
+  }
+
+  virtual bool has_trigger() const {
+    return true;
+  }
+
+  virtual bool IsTriggered(const ConversionRequest &request,
+                           const Segments &segments) const {
+    buffer_->append(name_ + ".IsTriggered();");
+    return true;
+  }
+
+ private:
+  string *buffer_;
+  const string name_;
+};
+
+// Inserts a candidate of |value| at |position| (or at the end) of each
+// conversion segment.  If |modify| is true, also modifies the first candidate.
+class InsertingRewriter : public RewriterInterface {
+ public:
+  InsertingRewriter(const string &value, size_t position, bool modify)
+      : value_(value), position_(position), modify_(modify) {}
+
+  virtual bool Rewrite(const ConversionRequest &request,
+                       Segments *segments) const {
+    for (size_t i = 0; i < segments->conversion_segments_size(); ++i) {
+      Segment *segment = segments->mutable_conversion_segment(i);
+      if (modify_ && segment->candidates_size() > 0) {
+        segment->mutable_candidate(0)->description = value_;
+      }
+      const size_t position = std::min(position_, segment->candidates_size());
+      Segment::Candidate *candidate = segment->insert_candidate(position);
+      candidate->Init();
+      candidate->key = segment->key();
+      candidate->value = value_;
+    }
+    return true;
+  }
+
+  virtual bool is_parallelizable() const {
+    return true;
+  }
+
+ private:
+  const string value_;
+  const size_t position_;
+  const bool modify_;
+};
+
+// Advances |clock| by |usec| microseconds in each call.
+class SlowRewriter : public RewriterInterface {
+ public:
+  SlowRewriter(ClockMock *clock, uint64 usec, bool return_value)
+      : clock_(clock), usec_(usec), return_value_(return_value) {}
+
+  virtual bool Rewrite(const ConversionRequest &request,
+                       Segments *segments) const {
+    clock_->PutClockForwardByTicks(usec_ * 1000);
+    return return_value_;
+  }
+
+  virtual void Finish(const ConversionRequest &request, Segments *segments) {
+    clock_->PutClockForwardByTicks(usec_ * 1000);
+  }
+
+  virtual bool Sync() {
+    clock_->PutClockForwardByTicks(usec_ * 1000);
+    return return_value_;
+  }
+
+ private:
+  ClockMock *clock_;
+  const uint64 usec_;
+  const bool return_value_;
+};
+
+void InitSegments(Segments *segments) {
+  segments->set_request_type(Segments::CONVERSION);
+  for (size_t i = 0; i < 2; ++i) {
+    Segment *segment = segments->add_segment();
+    segment->set_key("key");
+    for (size_t j = 0; j < 3; ++j) {
+      Segment::Candidate *candidate = segment->add_candidate();
+      candidate->Init();
+      candidate->key = "key";
+      candidate->value = string("value") + static_cast<char>('0' + j);
+    }
+  }
+}
+
+string GetValues(const Segments &segments) {
+  string values;
+  for (size_t i = 0; i < segments.conversion_segments_size(); ++i) {
+    const Segment &segment = segments.conversion_segment(i);
+    for (size_t j = 0; j < segment.candidates_size(); ++j) {
+      values.append(segment.candidate(j).value);
+      values.append(" ");
+    }
+    values.append("| ");
+  }
+  return values;
+}
+
 class MergerRewriterTest : public testing::Test {
  protected:
   virtual void SetUp() {
     SystemUtil::SetUserProfileDirectory(FLAGS_test_tmpdir);
   }
+
+  virtual void TearDown() {
+    Clock::SetClockForUnitTest(nullptr);
+  }
 };
 
 TEST_F(MergerRewriterTest, Rewrite) {
@@ -133,6 +256,130 @@ TEST_F(MergerRewriterTest, Rewrite) {
             call_result);
 }
 
+TEST_F(MergerRewriterTest, RewritePlan) {
+  string call_result;
+  MergerRewriter merger;
+  Segments segments;
+  const ConversionRequest request;
+
+  segments.set_request_type(Segments::CONVERSION);
+  merger.AddRewriter(new TriggeredRewriter(
+      &call_result, "a", RewriterInterface::NOT_AVAILABLE));
+  merger.AddRewriter(new TriggeredRewriter(
+      &call_result, "b", RewriterInterface::CONVERSION));
+  merger.AddRewriter(new TriggeredRewriter(
+      &call_result, "c", RewriterInterface::SUGGESTION));
+  EXPECT_TRUE(merger.Rewrite(request, &segments));
+  // Incapable rewriters are neither triggered nor called.
+  EXPECT_EQ("a.capability();"
+            "b.capability();"
+            "c.capability();"
+            "b.IsTriggered();"
+            "b.Rewrite();",
+            call_result);
+
+  call_result.clear();
+  segments.set_request_type(Segments::REVERSE_CONVERSION);
+  EXPECT_FALSE(merger.Rewrite(request, &segments));
+  EXPECT_EQ("", call_result);
+}
+
+TEST_F(MergerRewriterTest, CanceledRewrite) {
+  // The ticks of ClockMock are in nanoseconds.
+  ClockMock clock(1000, 0);
+  Clock::SetClockForUnitTest(&clock);
+
+  MergerRewriter merger;
+  merger.AddRewriter(new SlowRewriter(&clock, 600, false), "a");
+  merger.AddRewriter(new SlowRewriter(&clock, 600, true), "b");
+  merger.AddRewriter(new SlowRewriter(&clock, 600, true), "c");
+  Segments segments;
+  segments.set_request_type(Segments::CONVERSION);
+
+  // The deadline passes while "b" is running, so "c" is skipped.
+  {
+    ConversionRequest request;
+    request.SetTimeout(1);
+    EXPECT_FALSE(request.IsCanceled());
+    EXPECT_TRUE(merger.Rewrite(request, &segments));
+    EXPECT_TRUE(request.IsCanceled());
+  }
+  commands::RewriterStatistics statistics;
+  merger.GetStatistics(&statistics);
+  ASSERT_EQ(3, statistics.entry_size());
+  EXPECT_EQ(1, statistics.entry(0).rewrite_count());
+  EXPECT_EQ(1, statistics.entry(1).rewrite_count());
+  EXPECT_EQ(0, statistics.entry(2).rewrite_count());
+
+  // Nothing runs for a canceled request.
+  merger.ResetStatistics();
+  {
+    std::atomic<bool> canceled(true);
+    ConversionRequest request;
+    request.set_cancel_flag(&canceled);
+    EXPECT_FALSE(merger.Rewrite(request, &segments));
+    canceled = false;
+    EXPECT_TRUE(merger.Rewrite(request, &segments));
+  }
+  merger.GetStatistics(&statistics);
+  for (int i = 0; i < statistics.entry_size(); ++i) {
+    EXPECT_EQ(1, statistics.entry(i).rewrite_count());
+  }
+}
+
+TEST_F(MergerRewriterTest, ParallelRewrite) {
+  MergerRewriter merger;
+  merger.EnableParallelRewrite(2);
+  merger.AddRewriter(new InsertingRewriter("a", 1, false));
+  merger.AddRewriter(new InsertingRewriter("b", 1, false));
+  merger.AddRewriter(new InsertingRewriter("c", 10, false));
+  merger.AddRewriter(new InsertingRewriter("d", 0, false));
+
+  Segments segments;
+  InitSegments(&segments);
+  const ConversionRequest request;
+  EXPECT_TRUE(merger.Rewrite(request, &segments));
+  // The candidates inserted at the same position are ordered as the
+  // rewriters are added.
+  const char kExpected[] =
+      "d value0 a b value1 value2 c | d value0 a b value1 value2 c | ";
+  EXPECT_EQ(kExpected, GetValues(segments));
+
+  // The result is deterministic.
+  for (int i = 0; i < 10; ++i) {
+    Segments segments2;
+    InitSegments(&segments2);
+    EXPECT_TRUE(merger.Rewrite(request, &segments2));
+    EXPECT_EQ(kExpected, GetValues(segments2));
+  }
+}
+
+TEST_F(MergerRewriterTest, ParallelRewriteFallsBackToSequential) {
+  MergerRewriter merger;
+  merger.EnableParallelRewrite(2);
+  merger.AddRewriter(new InsertingRewriter("a", 10, false));
+  // Modifies the existing candidate, so it and the following rewriters run
+  // sequentially.
+  merger.AddRewriter(new InsertingRewriter("b", 0, true));
+  merger.AddRewriter(new InsertingRewriter("c", 0, false));
+
+  Segments parallel;
+  InitSegments(&parallel);
+  const ConversionRequest request;
+  EXPECT_TRUE(merger.Rewrite(request, &parallel));
+
+  MergerRewriter sequential_merger;
+  sequential_merger.AddRewriter(new InsertingRewriter("a", 10, false));
+  sequential_merger.AddRewriter(new InsertingRewriter("b", 0, true));
+  sequential_merger.AddRewriter(new InsertingRewriter("c", 0, false));
+  Segments sequential;
+  InitSegments(&sequential);
+  EXPECT_TRUE(sequential_merger.Rewrite(request, &sequential));
+
+  EXPECT_EQ(GetValues(sequential), GetValues(parallel));
+  EXPECT_EQ("b", parallel.conversion_segment(0).candidate(2).description);
+}
+
 TEST_F(MergerRewriterTest, RewriteSuggestion) {
   string call_result;
   MergerRewriter merger;
@@ -356,4 +603,61 @@ TEST_F(MergerRewriterTest, Clear) {
             call_result);
 }
 
+TEST_F(MergerRewriterTest, Statistics) {
+  // The ticks of ClockMock are in nanoseconds.
+  ClockMock clock(1000, 0);
+  Clock::SetClockForUnitTest(&clock);
+
+  MergerRewriter merger;
+  merger.AddRewriter(new SlowRewriter(&clock, 10, false), "slow");
+  merger.AddRewriter(new SlowRewriter(&clock, 200, true), "slower");
+  merger.AddRewriter(new SlowRewriter(&clock, 30, false));
+
+  Segments segments;
+  segments.set_request_type(Segments::CONVERSION);
+  const ConversionRequest request;
+  EXPECT_TRUE(merger.Rewrite(request, &segments));
+  EXPECT_TRUE(merger.Rewrite(request, &segments));
+  merger.Finish(request, &segments);
+  EXPECT_TRUE(merger.Sync());
+
+  commands::RewriterStatistics statistics;
+  merger.GetStatistics(&statistics);
+  ASSERT_EQ(3, statistics.entry_size());
+  EXPECT_EQ("slow", statistics.entry(0).name());
+  EXPECT_EQ(2, statistics.entry(0).rewrite_count());
+  EXPECT_EQ(0, statistics.entry(0).rewrite_modified_count());
+  EXPECT_EQ(20, statistics.entry(0).rewrite_time_usec());
+  EXPECT_EQ(1, statistics.entry(0).finish_count());
+  EXPECT_EQ(10, statistics.entry(0).finish_time_usec());
+  EXPECT_EQ(1, statistics.entry(0).sync_count());
+  EXPECT_EQ(10, statistics.entry(0).sync_time_usec());
+
+  EXPECT_EQ("slower", statistics.entry(1).name());
+  EXPECT_EQ(2, statistics.entry(1).rewrite_count());
+  EXPECT_EQ(2, statistics.entry(1).rewrite_modified_count());
+  EXPECT_EQ(400, statistics.entry(1).rewrite_time_usec());
+  EXPECT_EQ(200, statistics.entry(1).finish_time_usec());
+  EXPECT_EQ(200, statistics.entry(1).sync_time_usec());
+
+  EXPECT_EQ("", statistics.entry(2).name());
+  EXPECT_EQ(60, statistics.entry(2).rewrite_time_usec());
+
+  // Incapable rewriters are not counted.
+  segments.set_request_type(Segments::SUGGESTION);
+  merger.Rewrite(request, &segments);
+  merger.GetStatistics(&statistics);
+  EXPECT_EQ(2, statistics.entry(0).rewrite_count());
+
+  merger.ResetStatistics();
+  merger.GetStatistics(&statistics);
+  ASSERT_EQ(3, statistics.entry_size());
+  for (int i = 0; i < statistics.entry_size(); ++i) {
+    EXPECT_EQ(0, statistics.entry(i).rewrite_count());
+    EXPECT_EQ(0, statistics.entry(i).rewrite_time_usec());
+    EXPECT_EQ(0, statistics.entry(i).finish_count());
+    EXPECT_EQ(0, statistics.entry(i).sync_count());
+  }
+}
+
 }  // namespace mozc
@@ -52,6 +52,11 @@ bool NormalizeCandidate(Segment::Candidate *candidate,
   if (candidate->attributes & Segment::Candidate::USER_DICTIONARY) {
     return false;
   }
+  // Most candidates are already normalized; don't build copies for them.
+  if (!TextNormalizer::IsNormalizationNeeded(candidate->value) &&
+      !TextNormalizer::IsNormalizationNeeded(candidate->content_value)) {
+    return false;
+  }
 
   string value, content_value;
   switch (type) {
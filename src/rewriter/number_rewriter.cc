@@ -151,56 +151,64 @@ void GetRewriteCandidateInfos(
 // http://b/issue?id=2872048
 const int kArabicNumericOffset = 5;
 
-void PushBackCandidate(const string &value, const string &desc,
-                       NumberUtil::NumberString::Style style,
-                       std::vector<Segment::Candidate> *results) {
-  bool found = false;
-  for (std::vector<Segment::Candidate>::const_iterator it = results->begin();
-       it != results->end(); ++it) {
-    if (it->value == value) {
-      found = true;
-      break;
-    }
-  }
-  if (!found) {
-    Segment::Candidate cand;
-    cand.value = value;
-    cand.description = desc;
-    cand.style = style;
-    results->push_back(cand);
-  }
+// Returns the suffix of |cand| following the content value, e.g., particles.
+StringPiece GetSuffix(const Segment::Candidate &cand) {
+  return StringPiece(cand.value).substr(cand.content_value.size());
 }
 
-void SetCandidatesInfo(const Segment::Candidate &arabic_cand,
-                       std::vector<Segment::Candidate> *candidates) {
-  const string suffix(
-      arabic_cand.value, arabic_cand.content_value.size(),
-      arabic_cand.value.size() - arabic_cand.content_value.size());
+// Returns true if |value| is |number| followed by |suffix|.  Compares without
+// building the value of the converted candidate.
+bool IsNumberWithSuffix(const string &value,
+                        const NumberUtil::NumberString &number,
+                        StringPiece suffix) {
+  return value.size() == number.value.size() + suffix.size() &&
+         value.compare(0, number.value.size(), number.value) == 0 &&
+         value.compare(number.value.size(), suffix.size(), suffix.data(),
+                       suffix.size()) == 0;
+}
 
-  for (std::vector<Segment::Candidate>::iterator it = candidates->begin();
-       it != candidates->end(); ++it) {
-    it->content_value.assign(it->value);
-    it->value.append(suffix);
+// Removes the numbers of the same value as a preceding one, in place.
+void UniqueNumbers(std::vector<NumberUtil::NumberString> *numbers) {
+  size_t size = 0;
+  for (size_t i = 0; i < numbers->size(); ++i) {
+    bool found = false;
+    for (size_t j = 0; j < size; ++j) {
+      if ((*numbers)[j].value == (*numbers)[i].value) {
+        found = true;
+        break;
+      }
+    }
+    if (found) {
+      continue;
+    }
+    if (size != i) {
+      (*numbers)[size] = std::move((*numbers)[i]);
+    }
+    ++size;
   }
+  numbers->erase(numbers->begin() + size, numbers->end());
 }
 
-class CheckValueOperator {
- public:
-  explicit CheckValueOperator(const string &v) : find_value_(&v) {}
-  bool operator() (const Segment::Candidate &cand) const {
-    return (cand.value == *find_value_);
+// Returns the first one of |numbers| which is the same as |value| with
+// |suffix|, or the end.
+std::vector<NumberUtil::NumberString>::const_iterator FindNumber(
+    const std::vector<NumberUtil::NumberString> &numbers, StringPiece suffix,
+    const string &value) {
+  for (auto iter = numbers.begin(); iter != numbers.end(); ++iter) {
+    if (IsNumberWithSuffix(value, *iter, suffix)) {
+      return iter;
+    }
   }
-
- private:
-  const string *find_value_;
-};
+  return numbers.end();
+}
 
 // If we have the candidates to be inserted before the base candidate,
 // delete them.
 // TODO(toshiyuki): Delete candidates between base pos and insert pos
 // if necessary.
 void EraseExistingCandidates(
-    const std::vector<Segment::Candidate> &results,
+    const std::vector<NumberUtil::NumberString> &results,
+    StringPiece suffix,
     int base_candidate_pos,
     Segment *seg,
     std::vector<RewriteCandidateInfo> *rewrite_candidate_info_list) {
@@ -208,10 +216,8 @@ void EraseExistingCandidates(
   // Remember base candidate value
   for (int pos = base_candidate_pos - 1; pos >= 0; --pos) {
     // Simple liner search. |results| size is small. (at most 10 or so)
-    const std::vector<Segment::Candidate>::const_iterator iter =
-        std::find_if(results.begin(), results.end(),
-                     CheckValueOperator(seg->candidate(pos).value));
-    if (iter == results.end()) {
+    if (FindNumber(results, suffix, seg->candidate(pos).value) ==
+        results.end()) {
       continue;
     }
 
@@ -228,27 +234,33 @@ void EraseExistingCandidates(
 
 // This is a utility function for InsertCandidate and UpdateCandidate.
 // Do not use this function directly.
+// The value of |cand| is built from |content_value| and |suffix| in place.
 void MergeCandidateInfoInternal(const Segment::Candidate &base_cand,
-                                const Segment::Candidate &result_cand,
+                                StringPiece content_value, StringPiece suffix,
+                                StringPiece description,
+                                NumberUtil::NumberString::Style style,
                                 Segment::Candidate *cand) {
   DCHECK(cand);
   cand->key = base_cand.key;
-  cand->value = result_cand.value;
+  cand->value.reserve(content_value.size() + suffix.size());
+  cand->value.assign(content_value.data(), content_value.size());
+  cand->value.append(suffix.data(), suffix.size());
   cand->content_key = base_cand.content_key;
-  cand->content_value = result_cand.content_value;
+  cand->content_value.assign(content_value.data(), content_value.size());
   cand->consumed_key_size = base_cand.consumed_key_size;
   cand->cost = base_cand.cost;
   cand->lid = base_cand.lid;
   cand->rid = base_cand.rid;
-  cand->style = result_cand.style;
+  cand->style = style;
 
   if (base_cand.attributes & Segment::Candidate::PARTIALLY_KEY_CONSUMED) {
     cand->description.assign("部分");
-    if (!result_cand.description.empty()) {
-      cand->description.append(1, '\n').append(result_cand.description);
+    if (!description.empty()) {
+      cand->description.append(1, '\n').append(description.data(),
+                                               description.size());
     }
   } else {
-    cand->description.assign(result_cand.description);
+    cand->description.assign(description.data(), description.size());
   }
 
   // Don't want to have FULL_WIDTH form for Hex/Oct/BIN..etc.
@@ -264,17 +276,20 @@ void MergeCandidateInfoInternal(const Segment::Candidate &base_cand,
 void InsertCandidate(Segment *segment,
                      int32 insert_position,
                      const Segment::Candidate &base_cand,
-                     const Segment::Candidate &result_cand) {
+                     const NumberUtil::NumberString &result,
+                     StringPiece suffix) {
   DCHECK(segment);
   Segment::Candidate *c = segment->insert_candidate(insert_position);
   c->Init();
-  MergeCandidateInfoInternal(base_cand, result_cand, c);
+  MergeCandidateInfoInternal(base_cand, result.value, suffix,
+                             result.description, result.style, c);
 }
 
 void UpdateCandidate(Segment *segment,
                      int32 update_position,
                      const Segment::Candidate &base_cand,
-                     const Segment::Candidate &result_cand) {
+                     const NumberUtil::NumberString &result,
+                     StringPiece suffix) {
   DCHECK(segment);
   Segment::Candidate *c = segment->mutable_candidate(update_position);
   // Do not call |c->Init()| for an existing candidate.
@@ -286,13 +301,14 @@ void UpdateCandidate(Segment *segment,
   //    Segment::Candidate::USER_DICTIONARY bit in |c|, we cannot not call
   //    |c->Init()|. Note that neither |base_cand| nor |result[0]| has
   //    valid value in its |attributes|.
-  MergeCandidateInfoInternal(base_cand, result_cand, c);
+  MergeCandidateInfoInternal(base_cand, result.value, suffix,
+                             result.description, result.style, c);
 }
 
-void InsertConvertedCandidates(const std::vector<Segment::Candidate> &results,
-                               const Segment::Candidate &base_cand,
-                               int base_candidate_pos,
-                               int insert_pos, Segment *seg) {
+void InsertConvertedCandidates(
+    const std::vector<NumberUtil::NumberString> &results,
+    const Segment::Candidate &base_cand, int base_candidate_pos,
+    int insert_pos, Segment *seg) {
   if (results.empty()) {
     return;
   }
@@ -307,25 +323,26 @@ void InsertConvertedCandidates(const std::vector<Segment::Candidate> &results,
   // Sometimes original base candidate is different from converted candidate
   // For example, "千万" v.s. "一千万", or "一二三" v.s. "百二十三".
   // We don't want to rewrite "千万" to "一千万".
+  const StringPiece suffix = GetSuffix(base_cand);
   {
     const string &base_value = seg->candidate(base_candidate_pos).value;
-    std::vector<Segment::Candidate>::const_iterator itr = std::find_if(
-        results.begin(), results.end(), CheckValueOperator(base_value));
+    const auto itr = FindNumber(results, suffix, base_value);
     if (itr != results.end() &&
         itr->style != NumberUtil::NumberString::NUMBER_KANJI &&
         itr->style != NumberUtil::NumberString::NUMBER_KANJI_ARABIC) {
       // Update exsisting base candidate
-      UpdateCandidate(seg, base_candidate_pos, base_cand, results[0]);
+      UpdateCandidate(seg, base_candidate_pos, base_cand, results[0], suffix);
     } else {
       // Insert candidate just below the base candidate
-      InsertCandidate(seg, base_candidate_pos + 1, base_cand, results[0]);
+      InsertCandidate(seg, base_candidate_pos + 1, base_cand, results[0],
+                      suffix);
       ++insert_pos;
     }
   }
 
   // Insert others
   for (size_t i = 1; i < results.size(); ++i) {
-    InsertCandidate(seg, insert_pos++, base_cand, results[i]);
+    InsertCandidate(seg, insert_pos++, base_cand, results[i], suffix);
   }
 }
 
@@ -339,29 +356,55 @@ int GetInsertPos(int base_pos, const Segment &segment, RewriteType type) {
   }
 }
 
-void InsertHalfArabic(const string &half_arabic,
+bool InsertHalfArabic(StringPiece half_arabic,
                       std::vector<NumberUtil::NumberString> *output) {
   output->push_back(
       NumberUtil::NumberString(half_arabic, "",
                                NumberUtil::NumberString::DEFAULT_STYLE));
+  return true;
 }
 
+typedef bool (*NumberConverter)(StringPiece arabic,
+                                std::vector<NumberUtil::NumberString> *output);
+
+// The converters generating the number styles for each rewrite type, in the
+// order of candidates.
+const NumberConverter kArabicFirstConverters[] = {
+  &InsertHalfArabic,
+  &NumberUtil::ArabicToWideArabic,
+  &NumberUtil::ArabicToSeparatedArabic,
+  &NumberUtil::ArabicToKanji,
+  &NumberUtil::ArabicToOtherForms,
+};
+
+const NumberConverter kKanjiFirstConverters[] = {
+  &NumberUtil::ArabicToKanji,
+  &InsertHalfArabic,
+  &NumberUtil::ArabicToWideArabic,
+  &NumberUtil::ArabicToSeparatedArabic,
+  &NumberUtil::ArabicToOtherForms,
+};
+
+// Upper bound of the number of the styles, so that |output| is allocated
+// once.
+const size_t kMaxNumberStyles = 24;
+
 void GetNumbers(RewriteType type, bool exec_radix_conversion,
                 const string &arabic_content_value,
                 std::vector<NumberUtil::NumberString> *output) {
   DCHECK(output);
+  output->reserve(kMaxNumberStyles);
+  const NumberConverter *converters = nullptr;
+  size_t num_converters = 0;
   if (type == ARABIC_FIRST) {
-    InsertHalfArabic(arabic_content_value, output);
-    NumberUtil::ArabicToWideArabic(arabic_content_value, output);
-    NumberUtil::ArabicToSeparatedArabic(arabic_content_value, output);
-    NumberUtil::ArabicToKanji(arabic_content_value, output);
-    NumberUtil::ArabicToOtherForms(arabic_content_value, output);
+    converters = kArabicFirstConverters;
+    num_converters = arraysize(kArabicFirstConverters);
   } else if (type == KANJI_FIRST) {
-    NumberUtil::ArabicToKanji(arabic_content_value, output);
-    InsertHalfArabic(arabic_content_value, output);
-    NumberUtil::ArabicToWideArabic(arabic_content_value, output);
-    NumberUtil::ArabicToSeparatedArabic(arabic_content_value, output);
-    NumberUtil::ArabicToOtherForms(arabic_content_value, output);
+    converters = kKanjiFirstConverters;
+    num_converters = arraysize(kKanjiFirstConverters);
+  }
+  for (size_t i = 0; i < num_converters; ++i) {
+    (*converters[i])(arabic_content_value, output);
   }
 
   if (exec_radix_conversion) {
@@ -393,7 +436,13 @@ bool RewriteOneSegment(
         // Rewrite for number suffix
         const int insert_pos = std::min(
             info.position + 1, static_cast<int>(seg->candidates_size()));
-        InsertCandidate(seg, insert_pos, info.candidate, info.candidate);
+        Segment::Candidate *c = seg->insert_candidate(insert_pos);
+        c->Init();
+        MergeCandidateInfoInternal(info.candidate,
+                                   info.candidate.content_value,
+                                   GetSuffix(info.candidate),
+                                   info.candidate.description,
+                                   info.candidate.style, c);
         modified = true;
         continue;
       }
@@ -401,20 +450,18 @@ bool RewriteOneSegment(
                  << arabic_content_value;
       break;
     }
-    std::vector<NumberUtil::NumberString> output;
-    GetNumbers(info.type, exec_radix_conversion, arabic_content_value, &output);
-    std::vector<Segment::Candidate> converted_numbers;
-    for (int j = 0; j < output.size(); ++j) {
-      PushBackCandidate(output[j].value, output[j].description,
-                        output[j].style, &converted_numbers);
-    }
-    SetCandidatesInfo(info.candidate, &converted_numbers);
+    // The converted numbers are kept as the content values, and the values
+    // of the candidates are built with the suffix on insertion.
+    std::vector<NumberUtil::NumberString> converted_numbers;
+    GetNumbers(info.type, exec_radix_conversion, arabic_content_value,
+               &converted_numbers);
+    UniqueNumbers(&converted_numbers);
 
     // Caution!!!: This invocation will update the data inside of the
     // rewrite_candidate_infos. Thus, |info| also can be updated as well
     // regardless of whether it's const reference-ness.
-    EraseExistingCandidates(converted_numbers, info.position,
-                            seg, &rewrite_candidate_infos);
+    EraseExistingCandidates(converted_numbers, GetSuffix(info.candidate),
+                            info.position, seg, &rewrite_candidate_infos);
     int insert_pos = GetInsertPos(info.position, *seg, info.type);
     DCHECK_LT(info.position, insert_pos);
     InsertConvertedCandidates(
@@ -440,6 +487,9 @@ NumberRewriter::NumberRewriter(const DataManagerInterface *data_manager)
 NumberRewriter::~NumberRewriter() {}
 
 int NumberRewriter::capability(const ConversionRequest &request) const {
+  if (!request.config().use_number_conversion()) {
+    return RewriterInterface::NOT_AVAILABLE;
+  }
   if (request.request().mixed_conversion()) {
     return RewriterInterface::ALL;
   }
@@ -29,8 +29,14 @@
 
 #include "rewriter/rewriter.h"
 
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
 #include "base/flags.h"
 #include "base/logging.h"
+#include "base/parallel_initializer.h"
 #include "converter/converter_interface.h"
 #include "data_manager/data_manager_interface.h"
 #include "dictionary/pos_group.h"
@@ -48,6 +54,7 @@
 #include "rewriter/fortune_rewriter.h"
 #include "rewriter/katakana_promotion_rewriter.h"
 #include "rewriter/language_aware_rewriter.h"
+#include "rewriter/lazy_rewriter.h"
 #include "rewriter/merger_rewriter.h"
 #include "rewriter/normalization_rewriter.h"
 #include "rewriter/number_rewriter.h"
@@ -68,6 +75,12 @@
 #endif  // NO_USAGE_REWRITER
 
 DEFINE_bool(use_history_rewriter, true, "Use history rewriter or not.");
+DEFINE_int32(parallel_rewriter_threads, 0,
+             "The number of threads to run independent rewriters in "
+             "parallel.  0 runs all the rewriters sequentially.");
+DEFINE_int32(parallel_init_threads, 0,
+             "The number of threads to construct independent engine "
+             "components in parallel.  0 constructs them sequentially.");
 
 namespace mozc {
 namespace {
@@ -87,44 +100,115 @@ RewriterImpl::RewriterImpl(const ConverterInterface *parent_converter,
   DCHECK(pos_group);
   // |dictionary| can be NULL
 
-  AddRewriter(new UserDictionaryRewriter);
-  AddRewriter(new FocusCandidateRewriter(data_manager));
-  AddRewriter(new LanguageAwareRewriter(pos_matcher_, dictionary));
-  AddRewriter(new TransliterationRewriter(pos_matcher_));
-  AddRewriter(new EnglishVariantsRewriter);
-  AddRewriter(new NumberRewriter(data_manager));
-  AddRewriter(new CollocationRewriter(data_manager));
-  AddRewriter(new SingleKanjiRewriter(*data_manager));
-  AddRewriter(new EmojiRewriter(*data_manager));
-  AddRewriter(EmoticonRewriter::CreateFromDataManager(*data_manager).release());
-  AddRewriter(new CalculatorRewriter(parent_converter));
-  AddRewriter(new SymbolRewriter(parent_converter, data_manager));
-  AddRewriter(new UnicodeRewriter(parent_converter));
-  AddRewriter(new VariantsRewriter(pos_matcher_));
-  AddRewriter(new ZipcodeRewriter(&pos_matcher_));
-  AddRewriter(new DiceRewriter);
+  // Most rewriters load their tables from the data manager on construction
+  // and do not depend on each other, so they are constructed through
+  // ParallelInitializer and then added in the order they rewrite segments.
+  std::vector<std::pair<string, std::function<RewriterInterface *()>>>
+      factories;
+  const auto add = [&factories](const string &name,
+                                std::function<RewriterInterface *()> factory) {
+    factories.push_back(std::make_pair(name, std::move(factory)));
+  };
+  // Rarely triggered rewriters are constructed on their first trigger.
+  const auto add_lazy = [&add](const string &name,
+                               LazyRewriter::Trigger trigger,
+                               LazyRewriter::Factory factory) {
+    add(name, [trigger, factory] {
+      return new LazyRewriter(trigger, factory);
+    });
+  };
+
+  add("UserDictionaryRewriter",
+      [] { return new UserDictionaryRewriter; });
+  add("FocusCandidateRewriter",
+      [data_manager] { return new FocusCandidateRewriter(data_manager); });
+  add("LanguageAwareRewriter", [this, dictionary] {
+    return new LanguageAwareRewriter(pos_matcher_, dictionary);
+  });
+  add("TransliterationRewriter",
+      [this] { return new TransliterationRewriter(pos_matcher_); });
+  add("EnglishVariantsRewriter",
+      [] { return new EnglishVariantsRewriter; });
+  add("NumberRewriter",
+      [data_manager] { return new NumberRewriter(data_manager); });
+  add("CollocationRewriter",
+      [data_manager] { return new CollocationRewriter(data_manager); });
+  add("SingleKanjiRewriter",
+      [data_manager] { return new SingleKanjiRewriter(*data_manager); });
+  add("EmojiRewriter",
+      [data_manager] { return new EmojiRewriter(*data_manager); });
+  add("EmoticonRewriter", [data_manager] {
+    return EmoticonRewriter::CreateFromDataManager(*data_manager).release();
+  });
+  add_lazy("CalculatorRewriter", &CalculatorRewriter::IsTriggeredBy,
+           [parent_converter] {
+             return new CalculatorRewriter(parent_converter);
+           });
+  add("SymbolRewriter", [parent_converter, data_manager] {
+    return new SymbolRewriter(parent_converter, data_manager);
+  });
+  add_lazy("UnicodeRewriter", &UnicodeRewriter::IsTriggeredBy,
+           [parent_converter] {
+             return new UnicodeRewriter(parent_converter);
+           });
+  add("VariantsRewriter",
+      [this] { return new VariantsRewriter(pos_matcher_); });
+  add_lazy("ZipcodeRewriter", &ZipcodeRewriter::IsTriggeredBy,
+           [this] { return new ZipcodeRewriter(&pos_matcher_); });
+  add_lazy("DiceRewriter", &DiceRewriter::IsTriggeredBy,
+           [] { return new DiceRewriter; });
 
   if (FLAGS_use_history_rewriter) {
-    AddRewriter(new UserBoundaryHistoryRewriter(parent_converter));
-    AddRewriter(new UserSegmentHistoryRewriter(&pos_matcher_, pos_group));
+    add("UserBoundaryHistoryRewriter", [parent_converter] {
+      return new UserBoundaryHistoryRewriter(parent_converter);
+    });
+    add("UserSegmentHistoryRewriter", [this, pos_group] {
+      return new UserSegmentHistoryRewriter(&pos_matcher_, pos_group);
+    });
   }
 
-  AddRewriter(new DateRewriter);
-  AddRewriter(new FortuneRewriter);
+  add("DateRewriter", [] { return new DateRewriter; });
+  add_lazy("FortuneRewriter", &FortuneRewriter::IsTriggeredBy,
+           [] { return new FortuneRewriter; });
 #ifndef OS_ANDROID
   // CommandRewriter is not tested well on Android.
   // So we temporarily disable it.
   // TODO(yukawa, team): Enable CommandRewriter on Android if necessary.
-  AddRewriter(new CommandRewriter);
+  add("CommandRewriter", [] { return new CommandRewriter; });
 #endif  // !OS_ANDROID
 #ifndef NO_USAGE_REWRITER
-  AddRewriter(new UsageRewriter(data_manager, dictionary));
+  add("UsageRewriter", [data_manager, dictionary] {
+    return new UsageRewriter(data_manager, dictionary);
+  });
 #endif  // NO_USAGE_REWRITER
-  AddRewriter(new VersionRewriter(data_manager->GetDataVersion()));
-  AddRewriter(CorrectionRewriter::CreateCorrectionRewriter(data_manager));
-  AddRewriter(new KatakanaPromotionRewriter);
-  AddRewriter(new NormalizationRewriter);
-  AddRewriter(new RemoveRedundantCandidateRewriter);
+  add_lazy("VersionRewriter", &VersionRewriter::IsTriggeredBy,
+           [data_manager] {
+             return new VersionRewriter(data_manager->GetDataVersion());
+           });
+  add("CorrectionRewriter", [data_manager] {
+    return CorrectionRewriter::CreateCorrectionRewriter(data_manager);
+  });
+  add("KatakanaPromotionRewriter",
+      [] { return new KatakanaPromotionRewriter; });
+  add("NormalizationRewriter", [] { return new NormalizationRewriter; });
+  add("RemoveRedundantCandidateRewriter",
+      [] { return new RemoveRedundantCandidateRewriter; });
+
+  std::vector<RewriterInterface *> rewriters(factories.size(), nullptr);
+  ParallelInitializer initializer(FLAGS_parallel_init_threads);
+  for (size_t i = 0; i < factories.size(); ++i) {
+    initializer.Add(factories[i].first, [&factories, &rewriters, i] {
+      rewriters[i] = factories[i].second();
+    });
+  }
+  initializer.Run("RewriterImpl");
+  for (size_t i = 0; i < factories.size(); ++i) {
+    AddRewriter(rewriters[i], factories[i].first);
+  }
+
+  if (FLAGS_parallel_rewriter_threads > 0) {
+    EnableParallelRewrite(FLAGS_parallel_rewriter_threads);
+  }
 }
 
 }  // namespace mozc
@@ -58,6 +58,8 @@
         'fortune_rewriter.cc',
         'katakana_promotion_rewriter.cc',
         'language_aware_rewriter.cc',
+        'lazy_rewriter.cc',
+        'merger_rewriter.cc',
         'normalization_rewriter.cc',
         'number_compound_util.cc',
         'number_rewriter.cc',
@@ -78,6 +80,7 @@
       'dependencies': [
         '../base/base.gyp:base',
         '../base/base.gyp:config_file_stream',
+        '../base/base.gyp:perfect_hash_index',
         '../base/base.gyp:serialized_string_array',
         '../composer/composer.gyp:composer',
         '../config/config.gyp:character_form_manager',
@@ -90,6 +93,7 @@
         '../protocol/protocol.gyp:config_proto',
         '../request/request.gyp:conversion_request',
         '../storage/storage.gyp:storage',
+        '../transliteration/transliteration.gyp:transliteration',
         '../usage_stats/usage_stats_base.gyp:usage_stats',
         'calculator/calculator.gyp:calculator',
         'rewriter_base.gyp:gen_rewriter_files#host',
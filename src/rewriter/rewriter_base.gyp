@@ -72,6 +72,8 @@
                 '<(gen_out_dir)/usage_conj_suffix.data',
                 '<(gen_out_dir)/usage_item_array.data',
                 '<(gen_out_dir)/usage_string_array.data',
+                '<(gen_out_dir)/usage_key_value_index.data',
+                '<(gen_out_dir)/usage_value_index.data',
               ],
               'action': [
                 '<(generator)',
@@ -82,6 +84,8 @@
                 '--output_conjugation_index=<(gen_out_dir)/usage_conj_index.data',
                 '--output_usage_item_array=<(gen_out_dir)/usage_item_array.data',
                 '--output_string_array=<(gen_out_dir)/usage_string_array.data',
+                '--output_key_value_index=<(gen_out_dir)/usage_key_value_index.data',
+                '--output_value_index=<(gen_out_dir)/usage_value_index.data',
               ],
             },
           ],
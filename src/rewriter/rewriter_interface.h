@@ -52,6 +52,9 @@ class RewriterInterface {
   // return capablity of this rewriter.
   // If (capability() & CONVERSION), this rewriter
   // is called after StartConversion().
+  // Return NOT_AVAILABLE when the rewriter is disabled by the config, so
+  // that MergerRewriter can skip it without calling IsTriggered() nor
+  // Rewrite().  capability() is called once per Rewrite() of MergerRewriter.
   virtual int capability(const ConversionRequest &request) const {
     return CONVERSION;
   }
@@ -59,6 +62,29 @@ class RewriterInterface {
   virtual bool Rewrite(const ConversionRequest &request,
                        Segments *segments) const = 0;
 
+  // Returns true if IsTriggered() is implemented.  This is queried once when
+  // the rewriter is added to MergerRewriter, so that IsTriggered() is not
+  // called for the rewriters that do not have a trigger.
+  virtual bool has_trigger() const {
+    return false;
+  }
+
+  // A cheap pre-check of Rewrite().  Returns false if Rewrite() never
+  // modifies |segments|, e.g., when the key is not a trigger word of the
+  // rewriter.  It is called before capability().
+  virtual bool IsTriggered(const ConversionRequest &request,
+                           const Segments &segments) const {
+    return true;
+  }
+
+  // Returns true if Rewrite() only inserts new candidates, i.e., doesn't
+  // modify, remove nor reorder the existing candidates and segments, and
+  // can be called from multiple threads at the same time.  MergerRewriter
+  // may run such rewriters concurrently on copies of the segments.
+  virtual bool is_parallelizable() const {
+    return false;
+  }
+
   // This method is mainly called when user puts SPACE key
   // and changes the focused candidate.
   // In this method, Converter will find bracketing matching.
@@ -82,6 +108,11 @@ class RewriterInterface {
   // clear internal data
   virtual void Clear() {}
 
+  // Returns the estimated size of the internal data (e.g., caches and
+  // indices) allocated in heap, in bytes.  Data mapped from the data set is
+  // not included.
+  virtual size_t GetHeapMemoryUsage() const { return 0; }
+
  protected:
   RewriterInterface() {}
 };
@@ -36,6 +36,7 @@
 #include <string>
 #include <vector>
 
+#include "base/flags.h"
 #include "base/logging.h"
 #include "base/util.h"
 #include "config/config_handler.h"
@@ -48,9 +49,22 @@
 
 using mozc::dictionary::POSMatcher;
 
+DEFINE_bool(defer_single_kanji_expansion, false,
+            "Insert only the first page of single kanji candidates in "
+            "conversion and append the rest when the focus reaches them");
+
 namespace mozc {
 namespace {
 
+// Adding 8000 to the single kanji cost
+// Note that this cost does not make no effect.
+// Here we set the cost just in case.
+const int kOffsetCost = 8000;
+
+// The number of single kanji candidates inserted by Rewrite() when
+// the expansion is deferred.  It is about a page of the candidate window.
+const size_t kNumNonDeferredCandidates = 9;
+
 // A random access iterator over uint32 array that increments a pointer by N:
 // iter     -> array[0]
 // iter + 1 -> array[N]
@@ -154,6 +168,25 @@ class Uint32ArrayIterator
   const uint32 *ptr_;
 };
 
+// Returns the key of the |i|-th entry of a token array consisting of N uint32
+// indices per entry, where the first index of each entry points to the key in
+// |string_array|.  Used to build and query PerfectHashIndex.
+template <size_t N>
+class TokenKeyAt {
+ public:
+  TokenKeyAt(StringPiece token_array, const SerializedStringArray &string_array)
+      : token_array_(reinterpret_cast<const uint32 *>(token_array.data())),
+        string_array_(string_array) {}
+
+  StringPiece operator()(size_t i) const {
+    return string_array_[token_array_[N * i]];
+  }
+
+ private:
+  const uint32 *token_array_;
+  const SerializedStringArray &string_array_;
+};
+
 // Looks up single kanji list from key (reading).  Returns false if not found.
 // The underlying token array, |single_kanji_token_array|, has the following
 // format:
@@ -170,9 +203,11 @@ class Uint32ArrayIterator
 // | ...              |
 //
 // Here, each element is of uint32 type.  Each of actual string values are
-// stored in |single_kanji_string_array| at its index.
+// stored in |single_kanji_string_array| at its index.  |kanji_index| is the
+// PerfectHashIndex over the keys of the token array.
 bool LookupKanjiList(StringPiece single_kanji_token_array,
                      const SerializedStringArray &single_kanji_string_array,
+                     const PerfectHashIndex &kanji_index,
                      const string &key, std::vector<string> *kanji_list) {
   DCHECK(kanji_list);
   const uint32* token_array =
@@ -180,14 +215,25 @@ bool LookupKanjiList(StringPiece single_kanji_token_array,
   const size_t token_array_size =
       single_kanji_token_array.size() / sizeof(uint32);
 
-  const Uint32ArrayIterator<2> end(token_array + token_array_size);
-  const auto iter = std::lower_bound(
-      Uint32ArrayIterator<2>(token_array), end, key,
-      [&single_kanji_string_array](uint32 index, const string &target_key) {
-        return single_kanji_string_array[index] < target_key;
-      });
-  if (iter == end || single_kanji_string_array[iter[0]] != key) {
-    return false;
+  Uint32ArrayIterator<2> iter(token_array);
+  if (kanji_index.IsBuilt()) {
+    const PerfectHashIndex::Range range = kanji_index.Find(
+        key, TokenKeyAt<2>(single_kanji_token_array,
+                           single_kanji_string_array));
+    if (range.first == range.second) {
+      return false;
+    }
+    iter += range.first;
+  } else {
+    const Uint32ArrayIterator<2> end(token_array + token_array_size);
+    iter = std::lower_bound(
+        iter, end, key,
+        [&single_kanji_string_array](uint32 index, const string &target_key) {
+          return single_kanji_string_array[index] < target_key;
+        });
+    if (iter == end || single_kanji_string_array[iter[0]] != key) {
+      return false;
+    }
   }
   const StringPiece values = single_kanji_string_array[iter[1]];
   Util::SplitStringToUtf8Chars(values, kanji_list);
@@ -215,10 +261,12 @@ bool LookupKanjiList(StringPiece single_kanji_token_array,
 //
 // Here, each element is of uint32 type.  Actual strings of target and original
 // are stored in |variant_string_array|, while strings of variant type are
-// stored in |variant_type|.
+// stored in |variant_type|.  |variant_index| is the PerfectHashIndex over the
+// targets of the token array.
 void GenerateDescription(StringPiece variant_token_array,
                          const SerializedStringArray &variant_string_array,
                          const SerializedStringArray &variant_type,
+                         const PerfectHashIndex &variant_index,
                          const string &key, string *desc) {
   DCHECK(desc);
   const uint32 *token_array =
@@ -226,14 +274,24 @@ void GenerateDescription(StringPiece variant_token_array,
   const size_t token_array_size =
       variant_token_array.size() / sizeof(uint32);
 
-  const Uint32ArrayIterator<3> end(token_array + token_array_size);
-  const auto iter = std::lower_bound(
-      Uint32ArrayIterator<3>(token_array), end, key,
-      [&variant_string_array](uint32 index, const string &target_key) {
-        return variant_string_array[index] < target_key;
-      });
-  if (iter == end || variant_string_array[iter[0]] != key) {
-    return;
+  Uint32ArrayIterator<3> iter(token_array);
+  if (variant_index.IsBuilt()) {
+    const PerfectHashIndex::Range range = variant_index.Find(
+        key, TokenKeyAt<3>(variant_token_array, variant_string_array));
+    if (range.first == range.second) {
+      return;
+    }
+    iter += range.first;
+  } else {
+    const Uint32ArrayIterator<3> end(token_array + token_array_size);
+    iter = std::lower_bound(
+        iter, end, key,
+        [&variant_string_array](uint32 index, const string &target_key) {
+          return variant_string_array[index] < target_key;
+        });
+    if (iter == end || variant_string_array[iter[0]] != key) {
+      return;
+    }
   }
   const StringPiece original = variant_string_array[iter[1]];
   const uint32 type_id = iter[2];
@@ -251,6 +309,7 @@ void AddDescriptionForExsistingCandidates(
     StringPiece variant_token_array,
     const SerializedStringArray &variant_string_array,
     const SerializedStringArray &variant_type,
+    const PerfectHashIndex &variant_index,
     Segment *segment) {
   DCHECK(segment);
   for (size_t i = 0; i < segment->candidates_size(); ++i) {
@@ -259,13 +318,15 @@ void AddDescriptionForExsistingCandidates(
       continue;
     }
     GenerateDescription(variant_token_array, variant_string_array,
-                        variant_type, cand->value, &cand->description);
+                        variant_type, variant_index, cand->value,
+                        &cand->description);
   }
 }
 
 void FillCandidate(StringPiece variant_token_array,
                    const SerializedStringArray &variant_string_array,
                    const SerializedStringArray &variant_type,
+                   const PerfectHashIndex &variant_index,
                    const string &key, const string &value,
                    int cost, uint16 single_kanji_id,
                    Segment::Candidate *cand) {
@@ -279,18 +340,22 @@ void FillCandidate(StringPiece variant_token_array,
   cand->attributes |= Segment::Candidate::CONTEXT_SENSITIVE;
   cand->attributes |= Segment::Candidate::NO_VARIANTS_EXPANSION;
   GenerateDescription(variant_token_array, variant_string_array,
-                      variant_type, value, &cand->description);
+                      variant_type, variant_index, value, &cand->description);
 }
 
-// Insert SingleKanji into segment.
+// Insert SingleKanji of kanji_list[begin, end) into segment.
 void InsertCandidate(StringPiece variant_token_array,
                      const SerializedStringArray &variant_string_array,
                      const SerializedStringArray &variant_type,
+                     const PerfectHashIndex &variant_index,
                      bool is_single_segment,
                      uint16 single_kanji_id,
                      const std::vector<string> &kanji_list,
+                     size_t begin, size_t end,
                      Segment *segment) {
   DCHECK(segment);
+  DCHECK_LE(begin, end);
+  DCHECK_LE(end, kanji_list.size());
   if (segment->candidates_size() == 0) {
     LOG(WARNING) << "candidates_size is 0";
     return;
@@ -300,20 +365,31 @@ void InsertCandidate(StringPiece variant_token_array,
                                  segment->key() :
                                  segment->candidate(0).key);
 
-  // Adding 8000 to the single kanji cost
-  // Note that this cost does not make no effect.
-  // Here we set the cost just in case.
-  const int kOffsetCost = 8000;
-
   // Append single-kanji
-  for (size_t i = 0; i < kanji_list.size(); ++i) {
+  for (size_t i = begin; i < end; ++i) {
     Segment::Candidate *c = segment->push_back_candidate();
     FillCandidate(variant_token_array, variant_string_array,
-                  variant_type, candidate_key, kanji_list[i],
+                  variant_type, variant_index, candidate_key, kanji_list[i],
                   kOffsetCost + i, single_kanji_id, c);
   }
 }
 
+// Returns true if |segment| has the candidate of kanji_list[index] inserted
+// by InsertCandidate().
+bool HasInsertedCandidate(const Segment &segment, uint16 single_kanji_id,
+                          const std::vector<string> &kanji_list,
+                          size_t index) {
+  for (size_t i = 0; i < segment.candidates_size(); ++i) {
+    const Segment::Candidate &c = segment.candidate(i);
+    if (c.lid == single_kanji_id && c.rid == single_kanji_id &&
+        c.cost == kOffsetCost + static_cast<int>(index) &&
+        c.value == kanji_list[index]) {
+      return true;
+    }
+  }
+  return false;
+}
+
 void InsertNounPrefix(const POSMatcher &pos_matcher,
                       Segment *segment,
                       SerializedDictionary::iterator begin,
@@ -385,6 +461,13 @@ SingleKanjiRewriter::SingleKanjiRewriter(
   DCHECK(SerializedStringArray::VerifyData(variant_string_array_data));
   variant_string_array_.Set(variant_string_array_data);
 
+  kanji_index_.Build(
+      single_kanji_token_array_.size() / (2 * sizeof(uint32)),
+      TokenKeyAt<2>(single_kanji_token_array_, single_kanji_string_array_));
+  variant_index_.Build(
+      variant_token_array_.size() / (3 * sizeof(uint32)),
+      TokenKeyAt<3>(variant_token_array_, variant_string_array_));
+
   DCHECK(SerializedDictionary::VerifyData(noun_prefix_token_array_data,
                                           noun_prefix_string_array_data));
   noun_prefix_dictionary_.reset(new SerializedDictionary(
@@ -395,6 +478,9 @@ SingleKanjiRewriter::SingleKanjiRewriter(
 SingleKanjiRewriter::~SingleKanjiRewriter() {}
 
 int SingleKanjiRewriter::capability(const ConversionRequest &request) const {
+  if (!request.config().use_single_kanji_conversion()) {
+    return RewriterInterface::NOT_AVAILABLE;
+  }
   if (request.request().mixed_conversion()) {
     return RewriterInterface::ALL;
   }
@@ -411,25 +497,35 @@ bool SingleKanjiRewriter::Rewrite(const ConversionRequest &request,
   bool modified = false;
   const size_t segments_size = segments->conversion_segments_size();
   const bool is_single_segment = (segments_size == 1);
+  const bool defer_expansion =
+      FLAGS_defer_single_kanji_expansion &&
+      segments->request_type() == Segments::CONVERSION;
   for (size_t i = 0; i < segments_size; ++i) {
     AddDescriptionForExsistingCandidates(
         variant_token_array_,
         variant_string_array_,
         variant_type_array_,
+        variant_index_,
         segments->mutable_conversion_segment(i));
 
     const string &key = segments->conversion_segment(i).key();
     std::vector<string> kanji_list;
     if (!LookupKanjiList(single_kanji_token_array_, single_kanji_string_array_,
-                         key, &kanji_list)) {
+                         kanji_index_, key, &kanji_list)) {
       continue;
     }
+    // The rest are appended by Focus() if the user goes down to them.
+    const size_t end =
+        defer_expansion ?
+        std::min(kanji_list.size(), kNumNonDeferredCandidates) :
+        kanji_list.size();
     InsertCandidate(variant_token_array_,
                     variant_string_array_,
                     variant_type_array_,
+                    variant_index_,
                     is_single_segment,
                     pos_matcher_.GetGeneralSymbolId(),
-                    kanji_list,
+                    kanji_list, 0, end,
                     segments->mutable_conversion_segment(i));
 
     modified = true;
@@ -469,4 +565,45 @@ bool SingleKanjiRewriter::Rewrite(const ConversionRequest &request,
 
   return modified;
 }
+bool SingleKanjiRewriter::Focus(Segments *segments,
+                                size_t segment_index,
+                                int candidate_index) const {
+  if (!FLAGS_defer_single_kanji_expansion ||
+      segments->request_type() != Segments::CONVERSION ||
+      candidate_index < 0) {
+    return true;
+  }
+
+  // Appends the deferred candidates when the focus reaches the last page.
+  Segment *segment = segments->mutable_segment(segment_index);
+  if (candidate_index + kNumNonDeferredCandidates <
+      segment->candidates_size()) {
+    return true;
+  }
+  std::vector<string> kanji_list;
+  if (!LookupKanjiList(single_kanji_token_array_, single_kanji_string_array_,
+                       kanji_index_, segment->key(), &kanji_list) ||
+      kanji_list.size() <= kNumNonDeferredCandidates) {
+    return true;
+  }
+  // The segment was not rewritten in the deferred mode, or the deferred
+  // candidates are already there.
+  const uint16 single_kanji_id = pos_matcher_.GetGeneralSymbolId();
+  if (!HasInsertedCandidate(*segment, single_kanji_id, kanji_list,
+                            kNumNonDeferredCandidates - 1) ||
+      HasInsertedCandidate(*segment, single_kanji_id, kanji_list,
+                           kNumNonDeferredCandidates)) {
+    return true;
+  }
+  InsertCandidate(variant_token_array_,
+                  variant_string_array_,
+                  variant_type_array_,
+                  variant_index_,
+                  segments->conversion_segments_size() == 1,
+                  single_kanji_id,
+                  kanji_list, kNumNonDeferredCandidates, kanji_list.size(),
+                  segment);
+  return true;
+}
+
 }  // namespace mozc
@@ -32,6 +32,7 @@
 
 #include <memory>
 
+#include "base/perfect_hash_index.h"
 #include "base/port.h"
 #include "base/serialized_string_array.h"
 #include "data_manager/data_manager_interface.h"
@@ -51,16 +52,25 @@ class SingleKanjiRewriter : public RewriterInterface  {
   bool Rewrite(const ConversionRequest &request,
                Segments *segments) const override;
 
+  // With --defer_single_kanji_expansion, Rewrite() inserts only the first
+  // single kanji candidates and this appends the rest when the focused
+  // candidate comes near the end of the segment.
+  bool Focus(Segments *segments,
+             size_t segment_index,
+             int candidate_index) const override;
+
  private:
   const dictionary::POSMatcher pos_matcher_;
 
   StringPiece single_kanji_token_array_;
   SerializedStringArray single_kanji_string_array_;
+  PerfectHashIndex kanji_index_;
 
   SerializedStringArray variant_type_array_;
 
   StringPiece variant_token_array_;
   SerializedStringArray variant_string_array_;
+  PerfectHashIndex variant_index_;
 
   // Since noun_prefix_dictionary_ is just a tentative workaround,
   // we copy the SingleKanji structure so that we can remove this workaround
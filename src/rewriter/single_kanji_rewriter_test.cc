@@ -33,6 +33,7 @@
 #include <memory>
 #include <string>
 
+#include "base/flags.h"
 #include "base/system_util.h"
 #include "base/util.h"
 #include "config/config_handler.h"
@@ -44,6 +45,8 @@
 #include "testing/base/public/googletest.h"
 #include "testing/base/public/gunit.h"
 
+DECLARE_bool(defer_single_kanji_expansion);
+
 namespace mozc {
 
 using dictionary::POSMatcher;
@@ -228,4 +231,50 @@ TEST_F(SingleKanjiRewriterTest, AddDescriptionTest) {
   EXPECT_EQ("亜の旧字体", segment->candidate(0).description);
 }
 
+TEST_F(SingleKanjiRewriterTest, DeferredExpansionTest) {
+  SingleKanjiRewriter rewriter(*data_manager_);
+
+  // Fully expanded candidates for comparison.
+  Segments expected;
+  {
+    Segment *segment = expected.add_segment();
+    segment->set_key("あ");
+    Segment::Candidate *candidate = segment->add_candidate();
+    candidate->Init();
+    candidate->key = segment->key();
+    candidate->content_key = segment->key();
+    candidate->value = "cand";
+    candidate->content_value = candidate->value;
+  }
+  Segments segments;
+  segments.CopyFrom(expected);
+  EXPECT_TRUE(rewriter.Rewrite(default_request_, &expected));
+  const size_t expanded_size = expected.segment(0).candidates_size();
+  ASSERT_LT(20, expanded_size);
+
+  FLAGS_defer_single_kanji_expansion = true;
+  EXPECT_TRUE(rewriter.Rewrite(default_request_, &segments));
+  const Segment &segment = segments.segment(0);
+  const size_t deferred_size = segment.candidates_size();
+  EXPECT_GT(expanded_size, deferred_size);
+
+  // Focus far from the end doesn't expand the candidates.
+  EXPECT_TRUE(rewriter.Focus(&segments, 0, 0));
+  EXPECT_EQ(deferred_size, segment.candidates_size());
+
+  EXPECT_TRUE(rewriter.Focus(&segments, 0, deferred_size - 1));
+  ASSERT_EQ(expanded_size, segment.candidates_size());
+  for (size_t i = 0; i < expanded_size; ++i) {
+    EXPECT_EQ(expected.segment(0).candidate(i).value,
+              segment.candidate(i).value);
+    EXPECT_EQ(expected.segment(0).candidate(i).description,
+              segment.candidate(i).description);
+  }
+
+  // Once expanded, no more candidates are appended.
+  EXPECT_TRUE(rewriter.Focus(&segments, 0, expanded_size - 1));
+  EXPECT_EQ(expanded_size, segment.candidates_size());
+  FLAGS_defer_single_kanji_expansion = false;
+}
+
 }  // namespace mozc
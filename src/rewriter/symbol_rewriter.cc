@@ -147,12 +147,18 @@ bool SymbolRewriter::InSameSymbolGroup(
                       rhs.description().data(), cmp_len) == 0;
 }
 
+const SymbolRewriter::TokenInfo &SymbolRewriter::GetTokenInfo(
+    SerializedDictionary::const_iterator iter) const {
+  const size_t index = iter - dictionary_->begin();
+  DCHECK_LT(index, token_info_.size());
+  return token_info_[index];
+}
+
 // Insert Symbol into segment.
-// static function
 void SymbolRewriter::InsertCandidates(
     const SerializedDictionary::IterRange &range,
     bool context_sensitive,
-    Segment *segment) {
+    Segment *segment) const {
   if (segment->candidates_size() == 0) {
     LOG(WARNING) << "candiadtes_size is 0";
     return;
@@ -200,11 +206,14 @@ void SymbolRewriter::InsertCandidates(
   size_t inserted_count = 0;
   bool finish_first_part = false;
   const Segment::Candidate &base_candidate = segment->candidate(0);
+  // Positions given to the editor are the ones before the insertions, so all
+  // the symbols of the first part are inserted at |offset| in order.
+  Segment::CandidateEditor editor(segment);
   for (auto iter = range.first; iter != range.second; ++iter) {
-    Segment::Candidate *candidate = segment->insert_candidate(offset);
+    const TokenInfo &info = GetTokenInfo(iter);
+    Segment::Candidate *candidate = editor.Insert(offset);
     DCHECK(candidate);
 
-    candidate->Init();
     candidate->lid = iter.lid();
     candidate->rid = iter.rid();
     candidate->cost = base_candidate.cost;
@@ -217,18 +226,10 @@ void SymbolRewriter::InsertCandidates(
     if (context_sensitive) {
       candidate->attributes |= Segment::Candidate::CONTEXT_SENSITIVE;
     }
-
-    // The first two consist of two characters but the one of characters doesn't
-    // have alternative character.
-    if (candidate->value == "“”" || candidate->value == "‘’" ||
-        candidate->value == "w" || candidate->value == "www") {
+    if (info.no_variants_expansion) {
       candidate->attributes |= Segment::Candidate::NO_VARIANTS_EXPANSION;
     }
-
-    candidate->description = GetDescription(candidate->value,
-                                            iter.description(),
-                                            iter.additional_description());
-    ++offset;
+    candidate->description = info.description;
     ++inserted_count;
 
     // Insert to latter position
@@ -238,18 +239,16 @@ void SymbolRewriter::InsertCandidates(
         !finish_first_part &&
         inserted_count >= kMaxInsertToMedium &&
         range_size - inserted_count >= 5 &&
-        // Do not divide symbols which seem to be in the same group
-        // providing that they are not platform dependent characters.
-        (!InSameSymbolGroup(iter, next) || IsPlatformDependent(next))) {
+        GetTokenInfo(next).splittable_before) {
       offset = segment->candidates_size();
       finish_first_part = true;
     }
   }
+  editor.Apply();
 }
 
-// static
 void SymbolRewriter::AddDescForCurrentCandidates(
-    const SerializedDictionary::IterRange &range, Segment *segment) {
+    const SerializedDictionary::IterRange &range, Segment *segment) const {
   for (size_t i = 0; i < segment->candidates_size(); ++i) {
     Segment::Candidate *candidate = segment->mutable_candidate(i);
     string full_width_value, half_width_value;
@@ -260,10 +259,7 @@ void SymbolRewriter::AddDescForCurrentCandidates(
       if (candidate->value == iter.value() ||
           full_width_value == iter.value() ||
           half_width_value == iter.value()) {
-        candidate->description =
-            GetDescription(candidate->value,
-                           iter.description(),
-                           iter.additional_description());
+        candidate->description = GetTokenInfo(iter).description;
         break;
       }
     }
@@ -335,11 +331,31 @@ SymbolRewriter::SymbolRewriter(const ConverterInterface *parent_converter,
   DCHECK(SerializedDictionary::VerifyData(token_array_data, string_array_data));
   dictionary_.reset(new SerializedDictionary(token_array_data,
                                              string_array_data));
+
+  token_info_.resize(dictionary_->size());
+  for (auto iter = dictionary_->begin(); iter != dictionary_->end(); ++iter) {
+    TokenInfo *info = &token_info_[iter - dictionary_->begin()];
+    const string value = iter.value().as_string();
+    info->description = GetDescription(value, iter.description(),
+                                       iter.additional_description());
+    // The first two consist of two characters but the one of characters
+    // doesn't have alternative character.
+    info->no_variants_expansion =
+        (value == "“”" || value == "‘’" || value == "w" || value == "www");
+    // Do not divide symbols which seem to be in the same group providing
+    // that they are not platform dependent characters.
+    info->splittable_before =
+        iter == dictionary_->begin() ||
+        !InSameSymbolGroup(iter - 1, iter) || IsPlatformDependent(iter);
+  }
 }
 
 SymbolRewriter::~SymbolRewriter() {}
 
 int SymbolRewriter::capability(const ConversionRequest &request) const {
+  if (!request.config().use_symbol_conversion()) {
+    return RewriterInterface::NOT_AVAILABLE;
+  }
   if (request.request().mixed_conversion()) {
     return RewriterInterface::ALL;
   }
@@ -32,6 +32,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "data_manager/serialized_dictionary.h"
 #include "rewriter/rewriter_interface.h"
@@ -63,6 +64,18 @@ class SymbolRewriter : public RewriterInterface  {
   FRIEND_TEST(SymbolRewriterTest, TriggerRewriteDescriptionTest);
   FRIEND_TEST(SymbolRewriterTest, SplitDescriptionTest);
 
+  // Data derived from each dictionary token, computed once on construction
+  // so that inserting the symbols of a reading only copies strings.
+  struct TokenInfo {
+    // The description rendered by GetDescription().
+    string description;
+    // True if the candidate shouldn't be expanded by VariantsRewriter.
+    bool no_variants_expansion;
+    // True if the symbols of a reading may be split into the first and the
+    // latter parts just before this token.
+    bool splittable_before;
+  };
+
   // Some characters may have different description for full/half width forms.
   // Here we just change the description in this function.
   static const string GetDescription(const string &value,
@@ -83,13 +96,17 @@ class SymbolRewriter : public RewriterInterface  {
                                 SerializedDictionary::const_iterator rhs);
 
   // Insert Symbol into segment.
-  static void InsertCandidates(const SerializedDictionary::IterRange &range,
-                               bool context_sensitive,
-                               Segment *segment);
+  void InsertCandidates(const SerializedDictionary::IterRange &range,
+                        bool context_sensitive,
+                        Segment *segment) const;
 
   // Add symbol desc to exsisting candidates
-  static void AddDescForCurrentCandidates(
-      const SerializedDictionary::IterRange &range, Segment *segment);
+  void AddDescForCurrentCandidates(
+      const SerializedDictionary::IterRange &range, Segment *segment) const;
+
+  // Returns the precomputed data of the token pointed by |iter|.
+  const TokenInfo &GetTokenInfo(
+      SerializedDictionary::const_iterator iter) const;
 
   // Insert symbols using connected all segments.
   bool RewriteEntireCandidate(const ConversionRequest &request,
@@ -100,6 +117,8 @@ class SymbolRewriter : public RewriterInterface  {
 
   const ConverterInterface *parent_converter_;
   std::unique_ptr<SerializedDictionary> dictionary_;
+  // Indexed by the position of the token in |dictionary_|.
+  std::vector<TokenInfo> token_info_;
 };
 
 }  // namespace mozc
@@ -148,27 +148,9 @@ void ModifyT13nsForGodan(const string &key, std::vector<string> *t13ns) {
   const string &half_ascii = dst.empty() ? key : dst;
   string full_ascii;
   Util::HalfWidthAsciiToFullWidthAscii(half_ascii, &full_ascii);
-  string half_ascii_upper = half_ascii;
-  string half_ascii_lower = half_ascii;
-  string half_ascii_capitalized = half_ascii;
-  Util::UpperString(&half_ascii_upper);
-  Util::LowerString(&half_ascii_lower);
-  Util::CapitalizeString(&half_ascii_capitalized);
-  string full_ascii_upper = full_ascii;
-  string full_ascii_lower = full_ascii;
-  string full_ascii_capitalized = full_ascii;
-  Util::UpperString(&full_ascii_upper);
-  Util::LowerString(&full_ascii_lower);
-  Util::CapitalizeString(&full_ascii_capitalized);
-
   (*t13ns)[transliteration::HALF_ASCII] = half_ascii;
-  (*t13ns)[transliteration::HALF_ASCII_UPPER] = half_ascii_upper;
-  (*t13ns)[transliteration::HALF_ASCII_LOWER] = half_ascii_lower;
-  (*t13ns)[transliteration::HALF_ASCII_CAPITALIZED] = half_ascii_capitalized;
   (*t13ns)[transliteration::FULL_ASCII] = full_ascii;
-  (*t13ns)[transliteration::FULL_ASCII_UPPER] = full_ascii_upper;
-  (*t13ns)[transliteration::FULL_ASCII_LOWER] = full_ascii_lower;
-  (*t13ns)[transliteration::FULL_ASCII_CAPITALIZED] = full_ascii_capitalized;
+  transliteration::T13n::FillAsciiCaseVariants(t13ns);
 }
 
 bool IsTransliterated(const std::vector<string> &t13ns) {
@@ -286,36 +268,16 @@ bool TransliterationRewriter::FillT13nsFromKey(Segments *segments) const {
     string full_katakana, ascii;
     Util::HiraganaToKatakana(hiragana, &full_katakana);
     Util::HiraganaToRomanji(hiragana, &ascii);
-    string half_ascii, full_ascii, half_katakana;
-    Util::FullWidthAsciiToHalfWidthAscii(ascii, &half_ascii);
-    Util::HalfWidthAsciiToFullWidthAscii(half_ascii, &full_ascii);
-    Util::FullWidthToHalfWidth(full_katakana, &half_katakana);
-    string half_ascii_upper = half_ascii;
-    string half_ascii_lower = half_ascii;
-    string half_ascii_capitalized = half_ascii;
-    Util::UpperString(&half_ascii_upper);
-    Util::LowerString(&half_ascii_lower);
-    Util::CapitalizeString(&half_ascii_capitalized);
-    string full_ascii_upper = full_ascii;
-    string full_ascii_lower = full_ascii;
-    string full_ascii_capitalized = full_ascii;
-    Util::UpperString(&full_ascii_upper);
-    Util::LowerString(&full_ascii_lower);
-    Util::CapitalizeString(&full_ascii_capitalized);
-
-    std::vector<string> t13ns;
-    t13ns.resize(transliteration::NUM_T13N_TYPES);
+    std::vector<string> t13ns(transliteration::NUM_T13N_TYPES);
     t13ns[transliteration::HIRAGANA] = hiragana;
-    t13ns[transliteration::FULL_KATAKANA] = full_katakana;
-    t13ns[transliteration::HALF_KATAKANA] = half_katakana;
-    t13ns[transliteration::HALF_ASCII] = half_ascii;
-    t13ns[transliteration::HALF_ASCII_UPPER] = half_ascii_upper;
-    t13ns[transliteration::HALF_ASCII_LOWER] = half_ascii_lower;
-    t13ns[transliteration::HALF_ASCII_CAPITALIZED] = half_ascii_capitalized;
-    t13ns[transliteration::FULL_ASCII] = full_ascii;
-    t13ns[transliteration::FULL_ASCII_UPPER] = full_ascii_upper;
-    t13ns[transliteration::FULL_ASCII_LOWER] = full_ascii_lower;
-    t13ns[transliteration::FULL_ASCII_CAPITALIZED] = full_ascii_capitalized;
+    Util::FullWidthToHalfWidth(full_katakana,
+                               &t13ns[transliteration::HALF_KATAKANA]);
+    t13ns[transliteration::FULL_KATAKANA].swap(full_katakana);
+    Util::FullWidthAsciiToHalfWidthAscii(ascii,
+                                         &t13ns[transliteration::HALF_ASCII]);
+    Util::HalfWidthAsciiToFullWidthAscii(t13ns[transliteration::HALF_ASCII],
+                                         &t13ns[transliteration::FULL_ASCII]);
+    transliteration::T13n::FillAsciiCaseVariants(&t13ns);
 
     NormalizeT13ns(&t13ns);
     modified |= SetTransliterations(t13ns, segment->key(), segment);
@@ -203,6 +203,21 @@ bool UnicodeRewriter::RewriteFromUnicodeCharFormat(
   return true;
 }
 
+bool UnicodeRewriter::IsTriggeredBy(const ConversionRequest &request,
+                                    const Segments &segments) {
+  if (segments.conversion_segments_size() == 0) {
+    return false;
+  }
+  // Reverse conversion of a single character.
+  if (request.has_composer() &&
+      segments.conversion_segments_size() == 1 &&
+      Util::CharsLen(request.composer().source_text()) == 1) {
+    return true;
+  }
+  // "U+xxxx" may be split into multiple segments.
+  return Util::StartsWith(segments.conversion_segment(0).key(), "U");
+}
+
 bool UnicodeRewriter::Rewrite(const ConversionRequest &request,
                               Segments *segments) const {
   DCHECK(segments);
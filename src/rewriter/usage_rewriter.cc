@@ -31,7 +31,11 @@
 
 #include "rewriter/usage_rewriter.h"
 
+#include <algorithm>
+#include <map>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "base/logging.h"
 #include "base/serialized_string_array.h"
@@ -49,11 +53,43 @@ using mozc::dictionary::POSMatcher;
 
 namespace mozc {
 
+namespace {
+
+// Compares |prefix| + |suffix| with |target| without concatenating them.
+int CompareConcatenation(StringPiece prefix, StringPiece suffix,
+                         StringPiece target) {
+  const size_t len = std::min(prefix.size(), target.size());
+  const int result = prefix.substr(0, len).compare(target.substr(0, len));
+  if (result != 0) {
+    return result;
+  }
+  if (prefix.size() > target.size()) {
+    return 1;
+  }
+  target.remove_prefix(len);
+  return suffix.compare(target);
+}
+
+void AppendIndexEntry(const std::pair<uint32, uint32> &entry,
+                      std::vector<uint32> *index) {
+  index->push_back(entry.first);
+  index->push_back(entry.second);
+}
+
+}  // namespace
+
 UsageRewriter::UsageRewriter(const DataManagerInterface *data_manager,
                              const DictionaryInterface *dictionary)
     : pos_matcher_(data_manager->GetPOSMatcherData()),
       dictionary_(dictionary),
-      base_conjugation_suffix_(nullptr) {
+      base_conjugation_suffix_(nullptr),
+      conjugation_suffix_(nullptr),
+      usage_items_(nullptr),
+      num_usage_items_(0),
+      key_value_index_(nullptr),
+      key_value_index_size_(0),
+      value_index_(nullptr),
+      value_index_size_(0) {
   StringPiece base_conjugation_suffix_data;
   StringPiece conjugation_suffix_data;
   StringPiece conjugation_suffix_index_data;
@@ -66,43 +102,115 @@ UsageRewriter::UsageRewriter(const DataManagerInterface *data_manager,
                                      &string_array_data);
   base_conjugation_suffix_ =
       reinterpret_cast<const uint32 *>(base_conjugation_suffix_data.data());
-  const uint32 *conjugation_suffix =
+  conjugation_suffix_ =
       reinterpret_cast<const uint32 *>(conjugation_suffix_data.data());
-  const uint32 *conjugation_suffix_data_index =
-      reinterpret_cast<const uint32 *>(conjugation_suffix_index_data.data());
+  usage_items_ = usage_items_data.data();
+  num_usage_items_ = usage_items_data.size() / kUsageItemByteLength;
 
   DCHECK(SerializedStringArray::VerifyData(string_array_data));
   string_array_.Set(string_array_data);
 
-  UsageDictItemIterator begin(usage_items_data.data());
-  UsageDictItemIterator end(usage_items_data.data() + usage_items_data.size());
-
-  // TODO(taku): To reduce memory footprint, better to replace it with
-  // binary search over the conjugation_suffix_data diretly.
-  for (; begin != end; ++begin) {
-    for (size_t i = conjugation_suffix_data_index[begin.conjugation_id()];
-         i < conjugation_suffix_data_index[begin.conjugation_id() + 1];
-         ++i) {
-      const StringPiece key = string_array_[begin.key_index()];
-      const StringPiece value = string_array_[begin.value_index()];
-      const StringPiece key_suffix =
-          string_array_[conjugation_suffix[2 * i + 1]];
-      const StringPiece value_suffix =
-          string_array_[conjugation_suffix[2 * i]];
-      StrPair key_value1;
-      Util::ConcatStrings(key, key_suffix, &key_value1.first);
-      Util::ConcatStrings(value, value_suffix, &key_value1.second);
-      key_value_usageitem_map_[key_value1] = begin;
-
-      StrPair key_value2("", key_value1.second);
-      key_value_usageitem_map_[key_value2] = begin;
+  StringPiece key_value_index_data;
+  StringPiece value_index_data;
+  data_manager->GetUsageRewriterIndexData(&key_value_index_data,
+                                          &value_index_data);
+  if (num_usage_items_ > 0 && key_value_index_data.empty()) {
+    BuildIndices(reinterpret_cast<const uint32 *>(
+        conjugation_suffix_index_data.data()));
+    key_value_index_data.set(
+        reinterpret_cast<const char *>(key_value_index_buffer_.data()),
+        key_value_index_buffer_.size() * sizeof(uint32));
+    value_index_data.set(
+        reinterpret_cast<const char *>(value_index_buffer_.data()),
+        value_index_buffer_.size() * sizeof(uint32));
+  }
+  key_value_index_ =
+      reinterpret_cast<const uint32 *>(key_value_index_data.data());
+  key_value_index_size_ = key_value_index_data.size() / (2 * sizeof(uint32));
+  value_index_ = reinterpret_cast<const uint32 *>(value_index_data.data());
+  value_index_size_ = value_index_data.size() / (2 * sizeof(uint32));
+}
+
+void UsageRewriter::BuildIndices(const uint32 *conjugation_suffix_index) {
+  // Same as gen_usage_rewriter_dictionary_main.cc; std::map keeps the last
+  // item for duplicated keys.
+  using StrPair = std::pair<string, string>;
+  using IndexEntry = std::pair<uint32, uint32>;
+  std::map<StrPair, IndexEntry> key_value_index;
+  std::map<string, IndexEntry> value_index;
+  UsageDictItemIterator iter(usage_items_);
+  for (uint32 i = 0; i < num_usage_items_; ++i, ++iter) {
+    const StringPiece key = string_array_[iter.key_index()];
+    const StringPiece value = string_array_[iter.value_index()];
+    for (uint32 j = conjugation_suffix_index[iter.conjugation_id()];
+         j < conjugation_suffix_index[iter.conjugation_id() + 1];
+         ++j) {
+      StrPair key_value;
+      Util::ConcatStrings(key, string_array_[conjugation_suffix_[2 * j + 1]],
+                          &key_value.first);
+      Util::ConcatStrings(value, string_array_[conjugation_suffix_[2 * j]],
+                          &key_value.second);
+      const IndexEntry entry(i, j);
+      value_index[key_value.second] = entry;
+      key_value_index[key_value] = entry;
+    }
+  }
+  key_value_index_buffer_.reserve(2 * key_value_index.size());
+  for (const auto &kv : key_value_index) {
+    AppendIndexEntry(kv.second, &key_value_index_buffer_);
+  }
+  value_index_buffer_.reserve(2 * value_index.size());
+  for (const auto &kv : value_index) {
+    AppendIndexEntry(kv.second, &value_index_buffer_);
+  }
+}
+
+int UsageRewriter::CompareEntry(const uint32 *entry, StringPiece key,
+                                StringPiece value, bool compare_key) const {
+  const UsageDictItemIterator item(
+      usage_items_ + kUsageItemByteLength * entry[0]);
+  const uint32 *suffix = conjugation_suffix_ + 2 * entry[1];
+  if (compare_key) {
+    const int result = CompareConcatenation(string_array_[item.key_index()],
+                                            string_array_[suffix[1]], key);
+    if (result != 0) {
+      return result;
     }
   }
+  return CompareConcatenation(string_array_[item.value_index()],
+                              string_array_[suffix[0]], value);
+}
+
+UsageRewriter::UsageDictItemIterator UsageRewriter::FindEntry(
+    const uint32 *index, size_t size, StringPiece key, StringPiece value,
+    bool compare_key) const {
+  // Lower bound of (key, value).
+  size_t begin = 0;
+  size_t end = size;
+  while (begin < end) {
+    const size_t mid = begin + (end - begin) / 2;
+    if (CompareEntry(index + 2 * mid, key, value, compare_key) < 0) {
+      begin = mid + 1;
+    } else {
+      end = mid;
+    }
+  }
+  if (begin == size ||
+      CompareEntry(index + 2 * begin, key, value, compare_key) != 0) {
+    return UsageDictItemIterator();
+  }
+  return UsageDictItemIterator(
+      usage_items_ + kUsageItemByteLength * index[2 * begin]);
 }
 
 UsageRewriter::~UsageRewriter() {
 }
 
+size_t UsageRewriter::GetHeapMemoryUsage() const {
+  return (key_value_index_buffer_.capacity() +
+          value_index_buffer_.capacity()) * sizeof(uint32);
+}
+
 // static
 // "合いました" => "合い"
 string UsageRewriter::GetKanjiPrefixAndOneHiragana(const string &word) {
@@ -153,16 +261,16 @@ UsageRewriter::LookupUnmatchedUsageHeuristically(
     return UsageDictItemIterator();
   }
 
-  // key is empty;
-  StrPair key_value("", value);
-  const auto itr = key_value_usageitem_map_.find(key_value);
-  if (itr == key_value_usageitem_map_.end()) {
+  // Lookup by value only.
+  const UsageDictItemIterator iter =
+      FindEntry(value_index_, value_index_size_, "", value, false);
+  if (!iter.IsValid()) {
     return UsageDictItemIterator();
   }
   // Check result key part is a prefix of the content_key.
-  const StringPiece key = string_array_[itr->second.key_index()];
+  const StringPiece key = string_array_[iter.key_index()];
   if (Util::StartsWith(candidate.content_key, key)) {
-    return itr->second;
+    return iter;
   }
 
   return UsageDictItemIterator();
@@ -170,12 +278,11 @@ UsageRewriter::LookupUnmatchedUsageHeuristically(
 
 UsageRewriter::UsageDictItemIterator UsageRewriter::LookupUsage(
     const Segment::Candidate &candidate) const {
-  const string &key = candidate.content_key;
-  const string &value = candidate.content_value;
-  StrPair key_value(key, value);
-  const auto itr = key_value_usageitem_map_.find(key_value);
-  if (itr != key_value_usageitem_map_.end()) {
-    return itr->second;
+  const UsageDictItemIterator iter =
+      FindEntry(key_value_index_, key_value_index_size_,
+                candidate.content_key, candidate.content_value, true);
+  if (iter.IsValid()) {
+    return iter;
   }
 
   return LookupUnmatchedUsageHeuristically(candidate);
@@ -202,28 +309,38 @@ bool UsageRewriter::Rewrite(const ConversionRequest &request,
   // dictionary.  Since just the uniqueness in one Segments is sufficient, for
   // usage from the user dictionary, we simply assign sequential numbers larger
   // than the maximum ID of the embedded usage dictionary.
-  int32 usage_id_for_user_comment = key_value_usageitem_map_.size();
-  string comment;
+  int32 usage_id_for_user_comment = num_usage_items_;
+  std::vector<std::pair<StringPiece, StringPiece>> key_values;
+  std::vector<string> comments;
   for (size_t i = 0; i < segments->conversion_segments_size(); ++i) {
     Segment *segment = segments->mutable_conversion_segment(i);
     DCHECK(segment);
+
+    // First, search the user dictionary for the comments of all the
+    // candidates at once.
+    comments.clear();
+    if (dictionary_ != NULL) {
+      key_values.clear();
+      for (size_t j = 0; j < segment->candidates_size(); ++j) {
+        key_values.push_back(
+            std::make_pair(StringPiece(segment->candidate(j).content_key),
+                           StringPiece(segment->candidate(j).content_value)));
+      }
+      if (dictionary_->LookupComments(key_values, request, &comments) == 0) {
+        comments.clear();
+      }
+    }
+
     for (size_t j = 0; j < segment->candidates_size(); ++j) {
       ++usage_id_for_user_comment;
 
-      // First, search the user dictionary for comment.
-      if (dictionary_ != NULL) {
-        if (dictionary_->LookupComment(segment->candidate(j).content_key,
-                                       segment->candidate(j).content_value,
-                                       request,
-                                       &comment)) {
-          Segment::Candidate *candidate = segment->mutable_candidate(j);
-          candidate->usage_id = usage_id_for_user_comment;
-          candidate->usage_title = segment->candidate(j).content_value;
-          candidate->usage_description = comment;
-          comment.clear();
-          modified = true;
-          continue;
-        }
+      if (j < comments.size() && !comments[j].empty()) {
+        Segment::Candidate *candidate = segment->mutable_candidate(j);
+        candidate->usage_id = usage_id_for_user_comment;
+        candidate->usage_title = candidate->content_value;
+        candidate->usage_description.swap(comments[j]);
+        modified = true;
+        continue;
       }
 
       // If comment isn't in the user dictionary, search the system usage
@@ -32,9 +32,8 @@
 
 #ifndef NO_USAGE_REWRITER
 
-#include <map>
 #include <string>
-#include <utility>
+#include <vector>
 
 #include "base/port.h"
 #include "base/serialized_string_array.h"
@@ -56,6 +55,10 @@ class UsageRewriter : public RewriterInterface  {
   virtual bool Rewrite(const ConversionRequest &request,
                        Segments *segments) const;
 
+  // Returns the size of the indices built in heap for the data sets without
+  // the index sections.
+  virtual size_t GetHeapMemoryUsage() const;
+
   // better to show usage when user type "tab" key.
   virtual int capability(const ConversionRequest &request) const {
     return CONVERSION | PREDICTION;
@@ -104,19 +107,45 @@ class UsageRewriter : public RewriterInterface  {
     const char *ptr_;
   };
 
-  using StrPair = std::pair<string, string>;
   static string GetKanjiPrefixAndOneHiragana(const string &word);
 
+  // Builds the sorted indices in heap for data sets without them.  See
+  // gen_usage_rewriter_dictionary_main.cc for the format.
+  void BuildIndices(const uint32 *conjugation_suffix_index);
+
+  // Compares the conjugated key value pair of an index entry with
+  // (|key|, |value|).  Keys are ignored if |compare_key| is false.
+  int CompareEntry(const uint32 *entry, StringPiece key, StringPiece value,
+                   bool compare_key) const;
+
+  // Binary-searches |index| of |size| entries for (|key|, |value|).
+  UsageDictItemIterator FindEntry(const uint32 *index, size_t size,
+                                  StringPiece key, StringPiece value,
+                                  bool compare_key) const;
+
   UsageDictItemIterator LookupUnmatchedUsageHeuristically(
       const Segment::Candidate &candidate) const;
   UsageDictItemIterator LookupUsage(
       const Segment::Candidate &candidate) const;
 
-  std::map<StrPair, UsageDictItemIterator> key_value_usageitem_map_;
   const dictionary::POSMatcher pos_matcher_;
   const dictionary::DictionaryInterface *dictionary_;
   const uint32 *base_conjugation_suffix_;
+  const uint32 *conjugation_suffix_;
+  const char *usage_items_;
+  size_t num_usage_items_;
   SerializedStringArray string_array_;
+
+  // Arrays of (usage item index, conjugation suffix index) pairs, sorted by
+  // conjugated key value pairs and by conjugated values, respectively.  They
+  // usually point to the data set, so processes mapping the same data file
+  // share them.
+  const uint32 *key_value_index_;
+  size_t key_value_index_size_;
+  const uint32 *value_index_;
+  size_t value_index_size_;
+  std::vector<uint32> key_value_index_buffer_;
+  std::vector<uint32> value_index_buffer_;
 };
 
 }  // namespace mozc
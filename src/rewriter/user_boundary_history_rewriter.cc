@@ -247,6 +247,7 @@ bool UserBoundaryHistoryRewriter::ResizeOrInsert(
 
   std::deque<std::pair<string, size_t>> keys(target_segments_size -
                                    history_segments_size);
+  std::vector<ConverterInterface::ResizeSegmentRequest> resizes;
   for (size_t i = history_segments_size; i < target_segments_size; ++i) {
     const Segment &segment = segments->segment(i);
     keys[i - history_segments_size].first = segment.key();
@@ -288,11 +289,11 @@ bool UserBoundaryHistoryRewriter::ResizeOrInsert(
                     << " " << static_cast<int>(length_array[5])
                     << " " << static_cast<int>(length_array[6])
                     << " " << static_cast<int>(length_array[7]);
-            parent_converter_->ResizeSegment(segments,
-                                             request,
-                                             i - history_segments_size,
-                                             j + 1,
-                                             length_array, 8);
+            ConverterInterface::ResizeSegmentRequest resize;
+            resize.start_segment_index = i - history_segments_size;
+            resize.segments_size = j + 1;
+            resize.new_size_array.assign(length_array, length_array + 8);
+            resizes.push_back(resize);
             i += (j + target_segments_size - old_segments_size);
             result = true;
             break;
@@ -321,6 +322,11 @@ bool UserBoundaryHistoryRewriter::ResizeOrInsert(
     keys.pop_front();  // delete first item
   }
 
+  // All the learned boundaries are applied with one conversion.
+  if (!resizes.empty()) {
+    parent_converter_->ResizeSegments(segments, request, resizes);
+  }
+
   return result;
 }
 
@@ -331,4 +337,8 @@ void UserBoundaryHistoryRewriter::Clear() {
   }
 }
 
+size_t UserBoundaryHistoryRewriter::GetHeapMemoryUsage() const {
+  return storage_.get() == NULL ? 0 : storage_->GetHeapMemoryUsage();
+}
+
 }  // namespace mozc
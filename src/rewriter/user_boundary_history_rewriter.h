@@ -63,6 +63,8 @@ class UserBoundaryHistoryRewriter : public RewriterInterface {
 
   virtual void Clear();
 
+  virtual size_t GetHeapMemoryUsage() const;
+
  private:
   bool ResizeOrInsert(Segments *segments, const ConversionRequest &request,
                       int type) const;
@@ -541,24 +541,20 @@ do { \
   } \
 } while (0)
 
-#define FETCH_FEATURE(func, base_key, base_value, weight)                    \
+#define APPEND_FEATURE(func, base_key, base_value, weight)                   \
   do {                                                                       \
     if (func(segments, segment_index, base_key, base_value, &feature_key)) { \
-      const FeatureValue *v = reinterpret_cast<const FeatureValue *>(        \
-          storage_->Lookup(feature_key, &last_access_time_result));          \
-      if (v != NULL && v->IsValid()) {                                       \
-        *score = std::max(*score, weight);                                   \
-        *last_access_time =                                                  \
-            std::max(*last_access_time, last_access_time_result);            \
-      }                                                                      \
+      feature_keys->push_back(feature_key);                                  \
+      feature_scores->push_back(weight);                                     \
     }                                                                        \
   } while (0)
 
-bool UserSegmentHistoryRewriter::GetScore(const Segments &segments,
-                                          size_t segment_index,
-                                          int candidate_index,
-                                          uint32 *score,
-                                          uint32 *last_access_time) const {
+void UserSegmentHistoryRewriter::AppendFeatures(
+    const Segments &segments,
+    size_t segment_index,
+    int candidate_index,
+    std::vector<string> *feature_keys,
+    std::vector<uint32> *feature_scores) const {
   const size_t segments_size = segments.conversion_segments_size();
   const Segment::Candidate &top_candidate =
       segments.segment(segment_index).candidate(0);
@@ -576,14 +572,10 @@ bool UserSegmentHistoryRewriter::GetScore(const Segments &segments,
       (candidate.attributes & Segment::Candidate::CONTEXT_SENSITIVE) ||
       (segments.segment(segment_index).candidate(0).attributes &
        Segment::Candidate::CONTEXT_SENSITIVE);
-  DCHECK(score);
-  DCHECK(last_access_time);
-
-  *score = 0;
-  *last_access_time = 0;
+  DCHECK(feature_keys);
+  DCHECK(feature_scores);
 
-  // They are used inside FETCH_FEATURE
-  uint32 last_access_time_result = 0;
+  // Used inside APPEND_FEATURE
   string feature_key;
 
   const uint32 trigram_score       = (segments_size == 3) ? 180 : 30;
@@ -592,41 +584,39 @@ bool UserSegmentHistoryRewriter::GetScore(const Segments &segments,
   const uint32 unigram_score       = (segments_size == 1) ? 36  : 6;
   const uint32 single_score        = (segments_size == 1) ? 90  : 15;
 
-  FETCH_FEATURE(GetFeatureLR, all_key, all_value, trigram_score);
-  FETCH_FEATURE(GetFeatureLL, all_key, all_value, trigram_score);
-  FETCH_FEATURE(GetFeatureRR, all_key, all_value, trigram_score);
-  FETCH_FEATURE(GetFeatureL,  all_key, all_value, bigram_score);
-  FETCH_FEATURE(GetFeatureR,  all_key, all_value, bigram_score);
-  FETCH_FEATURE(GetFeatureS,  all_key, all_value, single_score);
-  FETCH_FEATURE(GetFeatureLN, content_key, content_value, bigram_number_score);
-  FETCH_FEATURE(GetFeatureRN, content_key, content_value, bigram_number_score);
+  APPEND_FEATURE(GetFeatureLR, all_key, all_value, trigram_score);
+  APPEND_FEATURE(GetFeatureLL, all_key, all_value, trigram_score);
+  APPEND_FEATURE(GetFeatureRR, all_key, all_value, trigram_score);
+  APPEND_FEATURE(GetFeatureL,  all_key, all_value, bigram_score);
+  APPEND_FEATURE(GetFeatureR,  all_key, all_value, bigram_score);
+  APPEND_FEATURE(GetFeatureS,  all_key, all_value, single_score);
+  APPEND_FEATURE(GetFeatureLN, content_key, content_value, bigram_number_score);
+  APPEND_FEATURE(GetFeatureRN, content_key, content_value, bigram_number_score);
 
   const bool is_replaceable = Replaceable(top_candidate, candidate);
 
   if (!context_sensitive && is_replaceable) {
-    FETCH_FEATURE(GetFeatureC,  all_key, all_value, unigram_score);
+    APPEND_FEATURE(GetFeatureC,  all_key, all_value, unigram_score);
   }
 
   if (!is_replaceable) {
-    return (*score > 0);
+    return;
   }
 
-  FETCH_FEATURE(GetFeatureLR, content_key, content_value, trigram_score / 2);
-  FETCH_FEATURE(GetFeatureLL, content_key, content_value, trigram_score / 2);
-  FETCH_FEATURE(GetFeatureRR, content_key, content_value, trigram_score / 2);
-  FETCH_FEATURE(GetFeatureL,  content_key, content_value, bigram_score / 2);
-  FETCH_FEATURE(GetFeatureR,  content_key, content_value, bigram_score / 2);
-  FETCH_FEATURE(GetFeatureS,  content_key, content_value, single_score / 2);
-  FETCH_FEATURE(GetFeatureLN, content_key,
+  APPEND_FEATURE(GetFeatureLR, content_key, content_value, trigram_score / 2);
+  APPEND_FEATURE(GetFeatureLL, content_key, content_value, trigram_score / 2);
+  APPEND_FEATURE(GetFeatureRR, content_key, content_value, trigram_score / 2);
+  APPEND_FEATURE(GetFeatureL,  content_key, content_value, bigram_score / 2);
+  APPEND_FEATURE(GetFeatureR,  content_key, content_value, bigram_score / 2);
+  APPEND_FEATURE(GetFeatureS,  content_key, content_value, single_score / 2);
+  APPEND_FEATURE(GetFeatureLN, content_key,
                 content_value, bigram_number_score / 2);
-  FETCH_FEATURE(GetFeatureRN, content_key,
+  APPEND_FEATURE(GetFeatureRN, content_key,
                 content_value, bigram_number_score / 2);
 
   if (!context_sensitive) {
-    FETCH_FEATURE(GetFeatureC,  content_key, content_value, unigram_score / 2);
+    APPEND_FEATURE(GetFeatureC,  content_key, content_value, unigram_score / 2);
   }
-
-  return (*score > 0);
 }
 
 // Returns true if |lhs| candidate can be replaceable with |rhs|.
@@ -991,24 +981,51 @@ bool UserSegmentHistoryRewriter::Rewrite(const ConversionRequest &request,
     DVLOG_IF(2, (segment->candidates_size() < max_candidates_size))
         << "Cannot expand candidates. ignored. Rewrite may be failed";
 
-    // for each all candidates expanded
-    std::vector<ScoreType> scores;
-    for (size_t l = 0;
-         l < segment->candidates_size() + segment->meta_candidates_size();
-         ++l) {
+    // Collects the features of all the candidates expanded, and looks them
+    // up at once.  The features of the l-th candidate are in
+    // [feature_begins[l], feature_begins[l + 1]).
+    const size_t num_candidates =
+        segment->candidates_size() + segment->meta_candidates_size();
+    std::vector<int> candidate_indices(num_candidates);
+    std::vector<size_t> feature_begins(num_candidates + 1);
+    std::vector<string> feature_keys;
+    std::vector<uint32> feature_scores;
+    for (size_t l = 0; l < num_candidates; ++l) {
       int j = static_cast<int>(l);
       if (j >= static_cast<int>(segment->candidates_size())) {
         j -= static_cast<int>(segment->candidates_size() +
                               transliteration::NUM_T13N_TYPES);
       }
+      candidate_indices[l] = j;
+      feature_begins[l] = feature_keys.size();
+      AppendFeatures(*segments, i, j, &feature_keys, &feature_scores);
+    }
+    feature_begins[num_candidates] = feature_keys.size();
 
+    std::vector<const char *> feature_values;
+    std::vector<uint32> feature_access_times;
+    storage_->BatchLookup(feature_keys, &feature_values,
+                          &feature_access_times);
+
+    std::vector<ScoreType> scores;
+    for (size_t l = 0; l < num_candidates; ++l) {
       uint32 score = 0;
       uint32 last_access_time = 0;
-      if (GetScore(*segments, i, j, &score, &last_access_time)) {
+      for (size_t k = feature_begins[l]; k < feature_begins[l + 1]; ++k) {
+        const FeatureValue *v =
+            reinterpret_cast<const FeatureValue *>(feature_values[k]);
+        if (v != NULL && v->IsValid()) {
+          score = std::max(score, feature_scores[k]);
+          last_access_time =
+              std::max(last_access_time, feature_access_times[k]);
+        }
+      }
+      if (score > 0) {
         scores.push_back(ScoreType());
         scores.back().score = score;
         scores.back().last_access_time = last_access_time;
-        scores.back().candidate = segment->mutable_candidate(j);
+        scores.back().candidate = segment->mutable_candidate(
+            candidate_indices[l]);
       }
     }
 
@@ -1029,6 +1046,10 @@ void UserSegmentHistoryRewriter::Clear() {
   }
 }
 
+size_t UserSegmentHistoryRewriter::GetHeapMemoryUsage() const {
+  return storage_.get() == NULL ? 0 : storage_->GetHeapMemoryUsage();
+}
+
 bool UserSegmentHistoryRewriter::IsPunctuation(
     const Segment &seg,
     const Segment::Candidate &candidate) const {
@@ -65,14 +65,19 @@ class UserSegmentHistoryRewriter : public RewriterInterface {
 
   virtual void Clear();
 
+  virtual size_t GetHeapMemoryUsage() const;
+
  private:
   bool IsAvailable(const ConversionRequest &request,
                    const Segments &segments) const;
-  bool GetScore(const Segments &segments,
-                size_t segment_index,
-                int candidate_index,
-                uint32 *score,
-                uint32 *last_access_time) const;
+  // Appends the feature keys of the |candidate_index|-th candidate in the
+  // |segment_index|-th segment and their scores, so that the features of all
+  // the candidates can be looked up at once.
+  void AppendFeatures(const Segments &segments,
+                      size_t segment_index,
+                      int candidate_index,
+                      std::vector<string> *feature_keys,
+                      std::vector<uint32> *feature_scores) const;
   bool Replaceable(const Segment::Candidate &lhs,
                    const Segment::Candidate &rhs) const;
   void RememberFirstCandidate(const Segments &segments,
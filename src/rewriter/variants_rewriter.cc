@@ -34,6 +34,7 @@
 
 #include "base/logging.h"
 #include "base/number_util.h"
+#include "base/singleton.h"
 #include "base/string_piece.h"
 #include "base/util.h"
 #include "config/character_form_manager.h"
@@ -88,25 +89,69 @@ void AppendString(StringPiece src, string *dst) {
 // "&-()" => true (all symbol and all half)
 // "&-（）" => false (all symbol but contains both full/half width)
 // "google" => false (not symbol)
-bool HasCharacterFormDescription(const string &value) {
+// |classification| is the result of Util::ClassifyString(value).
+bool HasCharacterFormDescription(
+    const string &value, const Util::StringClassification &classification) {
   if (value.empty()) {
     return false;
   }
-  Util::FormType prev = Util::UNKNOWN_FORM;
+  const uint32 symbol_mask = 1 << Util::UNKNOWN_SCRIPT;
+  return (classification.script_type_mask & ~symbol_mask) == 0 &&
+         classification.form_type != Util::UNKNOWN_FORM;
+}
 
-  for (ConstChar32Iterator iter(value); !iter.Done(); iter.Next()) {
-    const char32 ucs4 = iter.Get();
-    const Util::FormType type = Util::GetFormType(ucs4);
-    if (prev != Util::UNKNOWN_FORM && prev != type) {
-      return false;
-    }
-    if (Util::UNKNOWN_SCRIPT != Util::GetScriptType(ucs4)) {
-      return false;
+namespace {
+
+// The descriptions made only of the fixed labels, which most candidates get,
+// built once instead of being concatenated for every candidate.  Indexed by
+// the width label ("", "[全]" or "[半]"), the character form message and
+// whether the "<機種依存文字>" label is appended.
+class FixedDescriptionTable {
+ public:
+  enum Width {
+    NO_WIDTH,
+    FULL,
+    HALF,
+    WIDTH_SIZE,
+  };
+  enum Form {
+    NO_FORM,
+    HIRAGANA,
+    KATAKANA,
+    NUMBER,
+    ALPHABET,
+    FORM_SIZE,
+  };
+
+  FixedDescriptionTable() {
+    const char *kWidths[WIDTH_SIZE] = {
+        "", VariantsRewriter::kFullWidth, VariantsRewriter::kHalfWidth,
+    };
+    const char *kForms[FORM_SIZE] = {
+        "", VariantsRewriter::kHiragana, VariantsRewriter::kKatakana,
+        VariantsRewriter::kNumber, VariantsRewriter::kAlphabet,
+    };
+    for (int width = 0; width < WIDTH_SIZE; ++width) {
+      for (int form = 0; form < FORM_SIZE; ++form) {
+        string *description = &descriptions_[width][form][0];
+        *description = kWidths[width];
+        AppendString(kForms[form], description);
+        descriptions_[width][form][1] = *description;
+        AppendString(VariantsRewriter::kPlatformDependent,
+                     &descriptions_[width][form][1]);
+      }
     }
-    prev = type;
   }
-  return true;
-}
+
+  const string &Get(Width width, Form form, bool platform_dependent) const {
+    return descriptions_[width][form][platform_dependent ? 1 : 0];
+  }
+
+ private:
+  string descriptions_[WIDTH_SIZE][FORM_SIZE][2];
+};
+
+}  // namespace
 
 VariantsRewriter::VariantsRewriter(const POSMatcher pos_matcher)
     : pos_matcher_(pos_matcher) {}
@@ -155,14 +200,18 @@ void VariantsRewriter::SetDescription(const POSMatcher &pos_matcher,
                                       int description_type,
                                       Segment::Candidate *candidate) {
   StringPiece character_form_message;
+  FixedDescriptionTable::Form form = FixedDescriptionTable::NO_FORM;
+
+  // All the properties of the value used below are computed in one pass.
+  Util::StringClassification classification;
+  Util::ClassifyString(candidate->value, &classification);
 
   // Add Character form.
   if (description_type & CHARACTER_FORM) {
-    const Util::ScriptType type =
-        Util::GetScriptTypeWithoutSymbols(candidate->value);
-    switch (type) {
+    switch (classification.script_type_without_symbols) {
       case Util::HIRAGANA:
         character_form_message = StringPiece(kHiragana);
+        form = FixedDescriptionTable::HIRAGANA;
         // don't need to set full/half, because hiragana only has
         // full form
         description_type &= ~FULL_HALF_WIDTH;
@@ -170,14 +219,17 @@ void VariantsRewriter::SetDescription(const POSMatcher &pos_matcher,
       case Util::KATAKANA:
         // character_form_message = "カタカナ";
         character_form_message = StringPiece(kKatakana);
+        form = FixedDescriptionTable::KATAKANA;
         break;
       case Util::NUMBER:
         // character_form_message = "数字";
         character_form_message = StringPiece(kNumber);
+        form = FixedDescriptionTable::NUMBER;
         break;
       case Util::ALPHABET:
         // character_form_message = "アルファベット";
         character_form_message = StringPiece(kAlphabet);
+        form = FixedDescriptionTable::ALPHABET;
         break;
       case Util::KANJI:
       case Util::EMOJI:
@@ -187,7 +239,7 @@ void VariantsRewriter::SetDescription(const POSMatcher &pos_matcher,
         break;
       case Util::UNKNOWN_SCRIPT:   // mixed character
         if ((description_type & FULL_HALF_WIDTH_WITH_UNKNOWN) ||
-            HasCharacterFormDescription(candidate->value)) {
+            HasCharacterFormDescription(candidate->value, classification)) {
           description_type |= FULL_HALF_WIDTH;
         } else {
           description_type &= ~FULL_HALF_WIDTH;
@@ -204,28 +256,52 @@ void VariantsRewriter::SetDescription(const POSMatcher &pos_matcher,
   // description.
   if (!candidate->description.empty()) {
     character_form_message = StringPiece();
+    form = FixedDescriptionTable::NO_FORM;
   }
 
-  string description;
   // full/half char description
+  FixedDescriptionTable::Width width = FixedDescriptionTable::NO_WIDTH;
   if (description_type & FULL_HALF_WIDTH) {
-    const Util::FormType form = Util::GetFormType(candidate->value);
-    switch (form) {
+    switch (classification.form_type) {
       case Util::FULL_WIDTH:
-        // description = "[全]";
-        description = kFullWidth;
+        width = FixedDescriptionTable::FULL;
         break;
       case Util::HALF_WIDTH:
-        // description = "[半]";
-        description = kHalfWidth;
+        width = FixedDescriptionTable::HALF;
         break;
       default:
         break;
     }
   } else if (description_type & FULL_WIDTH) {
+    width = FixedDescriptionTable::FULL;
+  } else if (description_type & HALF_WIDTH) {
+    width = FixedDescriptionTable::HALF;
+  }
+  const bool platform_dependent =
+      (description_type & PLATFORM_DEPENDENT_CHARACTER) &&
+      classification.character_set >= Util::JISX0212;
+
+  // Most candidates get only the fixed labels, which are looked up from the
+  // table and assigned into the buffer the candidate already has.
+  if (candidate->description.empty() &&
+      candidate->value != "\\" && candidate->value != "＼" &&
+      candidate->value != "¥" && candidate->value != "￥" &&
+      !((description_type & ZIPCODE) &&
+        pos_matcher.IsZipcode(candidate->lid) &&
+        candidate->lid == candidate->rid) &&
+      !((description_type & SPELLING_CORRECTION) &&
+        (candidate->attributes & Segment::Candidate::SPELLING_CORRECTION))) {
+    candidate->description.assign(Singleton<FixedDescriptionTable>::get()->Get(
+        width, form, platform_dependent));
+    candidate->attributes |= Segment::Candidate::NO_EXTRA_DESCRIPTION;
+    return;
+  }
+
+  string description;
+  if (width == FixedDescriptionTable::FULL) {
     // description = "[全]";
     description = kFullWidth;
-  } else if (description_type & HALF_WIDTH) {
+  } else if (width == FixedDescriptionTable::HALF) {
     // description = "[半]";
     description = kHalfWidth;
   }
@@ -250,8 +326,7 @@ void VariantsRewriter::SetDescription(const POSMatcher &pos_matcher,
   }
 
   // Platform dependent char description
-  if (description_type & PLATFORM_DEPENDENT_CHARACTER &&
-      Util::GetCharacterSet(candidate->value) >= Util::JISX0212) {
+  if (platform_dependent) {
     AppendString(kPlatformDependent, &description);
   }
 
@@ -307,6 +382,9 @@ bool VariantsRewriter::RewriteSegment(RewriteType type, Segment *seg) const {
   string default_content_value, alternative_content_value;
   std::vector<uint32> default_inner_segment_boundary;
   std::vector<uint32> alternative_inner_segment_boundary;
+  // Inserted candidates are staged so that expanding many candidates doesn't
+  // shift the candidate list on every insertion.
+  Segment::CandidateEditor editor(seg);
   for (size_t i = 0; i < seg->candidates_size(); ++i) {
     Segment::Candidate *original_candidate = seg->mutable_candidate(i);
     DCHECK(original_candidate);
@@ -370,10 +448,9 @@ bool VariantsRewriter::RewriteSegment(RewriteType type, Segment *seg) const {
     if (type == EXPAND_VARIANT) {
       // Insert default candidate to position |i| and
       // rewrite original(|i+1|) to altenative
-      Segment::Candidate *new_candidate = seg->insert_candidate(i);
+      Segment::Candidate *new_candidate = editor.Insert(i);
       DCHECK(new_candidate);
 
-      new_candidate->Init();
       new_candidate->key = original_candidate->key;
       new_candidate->value = default_value;
       new_candidate->content_key = original_candidate->content_key;
@@ -389,7 +466,6 @@ bool VariantsRewriter::RewriteSegment(RewriteType type, Segment *seg) const {
       original_candidate->content_value = alternative_content_value;
       SetDescription(pos_matcher_,
                      alternative_description_type, original_candidate);
-      ++i;  // skip inserted candidate
     } else if (type == SELECT_VARIANT) {
       // Rewrite original to default
       original_candidate->value = default_value;
@@ -401,6 +477,7 @@ bool VariantsRewriter::RewriteSegment(RewriteType type, Segment *seg) const {
     }
     modified = true;
   }
+  editor.Apply();
   return modified;
 }
 
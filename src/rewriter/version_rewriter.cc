@@ -121,6 +121,19 @@ int VersionRewriter::capability(const ConversionRequest &request) const {
   return RewriterInterface::CONVERSION;
 }
 
+bool VersionRewriter::IsTriggeredBy(const ConversionRequest &request,
+                                    const Segments &segments) {
+  for (size_t i = 0; i < segments.conversion_segments_size(); ++i) {
+    const string &key = segments.conversion_segment(i).key();
+    for (size_t j = 0; j < arraysize(kKeyCandList); ++j) {
+      if (key == kKeyCandList[j].key) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
 bool VersionRewriter::Rewrite(const ConversionRequest &request,
                               Segments *segments) const {
   bool result = false;
@@ -51,6 +51,18 @@ class VersionRewriter : public RewriterInterface  {
   bool Rewrite(const ConversionRequest &request,
                Segments *segments) const override;
 
+  bool has_trigger() const override { return true; }
+
+  bool IsTriggered(const ConversionRequest &request,
+                   const Segments &segments) const override {
+    return IsTriggeredBy(request, segments);
+  }
+
+  // Returns false if Rewrite() never modifies |segments|.  It is also used
+  // as the trigger of LazyRewriter.
+  static bool IsTriggeredBy(const ConversionRequest &request,
+                            const Segments &segments);
+
  private:
   class VersionDataImpl;
   std::unique_ptr<VersionDataImpl> impl_;
@@ -131,6 +131,16 @@ ZipcodeRewriter::ZipcodeRewriter(const POSMatcher *pos_matcher)
 
 ZipcodeRewriter::~ZipcodeRewriter() = default;
 
+// The keys of the zipcode entries start with a digit, e.g., "100-0001".
+bool ZipcodeRewriter::IsTriggeredBy(const ConversionRequest &request,
+                                    const Segments &segments) {
+  if (segments.conversion_segments_size() != 1) {
+    return false;
+  }
+  const string &key = segments.conversion_segment(0).key();
+  return !key.empty() && key[0] >= '0' && key[0] <= '9';
+}
+
 bool ZipcodeRewriter::Rewrite(const ConversionRequest &request,
                               Segments *segments) const {
   if (segments->conversion_segments_size() != 1) {
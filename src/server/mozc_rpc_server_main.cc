@@ -34,23 +34,33 @@
 #pragma comment(lib, "ws2_32.lib")
 using ssize_t = SSIZE_T;
 #else
+#include <errno.h>
 #include <fcntl.h>
 #include <netdb.h>
 #include <netinet/in.h>
+#include <poll.h>
 #include <sys/socket.h>
 #include <unistd.h>
 #endif  // OS_WIN
 
+#include <algorithm>
 #include <cstddef>
 #include <cstring>
+#include <map>
 #include <memory>
+#include <set>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "base/flags.h"
 #include "base/init_mozc.h"
+#include "base/logging.h"
+#include "base/mutex.h"
 #include "base/singleton.h"
+#include "base/stopwatch.h"
 #include "base/system_util.h"
+#include "base/thread_pool.h"
 #include "engine/engine_factory.h"
 #include "protocol/commands.pb.h"
 #include "session/random_keyevents_generator.h"
@@ -64,6 +74,20 @@ DEFINE_int32(client_test_size, 100, "client test size");
 DEFINE_int32(port, 8000, "port of RPC server");
 DEFINE_int32(rpc_timeout, 60000, "timeout");
 DEFINE_string(user_profile_directory, "", "user profile directory");
+DEFINE_int32(rpc_num_workers, 1,
+             "number of worker threads of the server.  Each worker owns a "
+             "session handler and an engine");
+DEFINE_int32(rpc_max_connections, 1024,
+             "maximum number of connections the server accepts at a time");
+DEFINE_int32(rpc_max_queue_depth, 64,
+             "maximum number of requests queued per worker.  Connections "
+             "are not read while the queue of their worker is full");
+DEFINE_int32(rpc_metrics_interval, 60,
+             "interval in seconds to log the latency and queue depth metrics "
+             "of the server.  0 disables the metrics log");
+DEFINE_bool(rpc_delete_sessions_on_close, false,
+            "if true, the server deletes the sessions created through a "
+            "connection when the connection is closed");
 
 namespace mozc {
 
@@ -83,6 +107,10 @@ bool Recv(int socket, char *buf,
       LOG(ERROR) << "an error occurred during recv()";
       return false;
     }
+    if (read_size == 0) {
+      LOG(ERROR) << "the connection is closed by the peer";
+      return false;
+    }
     buf += read_size;
     buf_left -= read_size;
   }
@@ -122,27 +150,69 @@ void CloseSocket(int client_socket) {
 #endif
 }
 
+bool SetNonBlocking(int socket) {
+#ifdef OS_WIN
+  u_long on = 1;
+  return ::ioctlsocket(socket, FIONBIO, &on) == 0;
+#else
+  const int flags = ::fcntl(socket, F_GETFL, 0);
+  return flags >= 0 && ::fcntl(socket, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+}
+
+void SetCloseOnExec(int socket) {
+#ifndef OS_WIN
+  int flags = ::fcntl(socket, F_GETFD, 0);
+  CHECK_GE(flags, 0) << "fcntl(F_GETFD) failed";
+  flags |= FD_CLOEXEC;
+  CHECK_EQ(::fcntl(socket, F_SETFD, flags), 0) << "fctl(F_SETFD) failed";
+#endif
+}
+
+bool WouldBlock() {
+#ifdef OS_WIN
+  return ::WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+  return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#endif
+}
+
+int Poll(std::vector<struct pollfd> *fds, int timeout) {
+#ifdef OS_WIN
+  return ::WSAPoll(fds->data(), fds->size(), timeout);
+#else
+  return ::poll(fds->data(), fds->size(), timeout);
+#endif
+}
+
 // Standalone RPCServer.
+//
+// A single I/O thread multiplexes all the connections with poll() and hands
+// the decoded requests to the workers.  Each worker owns a SessionHandler
+// and an engine and evaluates its requests on its own thread, so the
+// handlers, which are not thread-safe, are never shared.  A session stays
+// on the worker that created it; new sessions go to the worker with the
+// fewest sessions.  Commands without a session, e.g. SET_CONFIG, go to the
+// first worker.
+//
+// A connection may send any number of requests in the same framing as
+// before.  They are evaluated one at a time in order.  A connection is not
+// read while its request is in flight or waits for a full queue, and new
+// connections are not accepted beyond --rpc_max_connections, so a slow
+// server pushes back on the clients through TCP flow control.
+//
 // TODO(taku): Make a RPC class inherited from IPCInterface.
 // This allows us to reuse client::Session library and SessionServer.
 class RPCServer {
  public:
   RPCServer() : server_socket_(kInvalidSocket),
-                handler_(new SessionHandler(
-                    std::unique_ptr<Engine>(EngineFactory::Create()))) {
+                next_connection_id_(1) {
     struct sockaddr_in sin;
 
     server_socket_ = ::socket(AF_INET, SOCK_STREAM, 0);
 
     CHECK_NE(server_socket_, kInvalidSocket) << "socket failed";
-
-#ifndef OS_WIN
-    int flags = ::fcntl(server_socket_, F_GETFD, 0);
-    CHECK_GE(flags, 0) << "fcntl(F_GETFD) failed";
-    flags |= FD_CLOEXEC;
-    CHECK_EQ(::fcntl(server_socket_, F_SETFD, flags), 0)
-        << "fctl(F_SETFD) failed";
-#endif
+    SetCloseOnExec(server_socket_);
 
     ::memset(&sin, 0, sizeof(sin));
     sin.sin_port = htons(FLAGS_port);
@@ -161,88 +231,582 @@ class RPCServer {
 
     CHECK_GE(::listen(server_socket_, SOMAXCONN), 0) << "listen failed";
     CHECK_NE(server_socket_, 0);
+    CHECK(SetNonBlocking(server_socket_)) << "cannot make socket non-blocking";
 
-    handler_->AddObserver(Singleton<session::SessionUsageObserver>::get());
+#ifdef OS_WIN
+    wake_up_read_ = kInvalidSocket;
+    wake_up_write_ = kInvalidSocket;
+#else
+    int fds[2];
+    CHECK_EQ(::pipe(fds), 0) << "pipe failed";
+    wake_up_read_ = fds[0];
+    wake_up_write_ = fds[1];
+    SetCloseOnExec(wake_up_read_);
+    SetCloseOnExec(wake_up_write_);
+    CHECK(SetNonBlocking(wake_up_read_));
+    CHECK(SetNonBlocking(wake_up_write_));
+#endif  // OS_WIN
+
+    const int num_workers = std::max(FLAGS_rpc_num_workers, 1);
+    for (int i = 0; i < num_workers; ++i) {
+      workers_.emplace_back(new Worker(this));
+    }
+    // SessionUsageObserver is not thread-safe, so only the first worker
+    // reports the usage stats.
+    workers_[0]->handler()->AddObserver(
+        Singleton<session::SessionUsageObserver>::get());
+    metrics_stopwatch_ = Stopwatch::StartNew();
   }
 
   ~RPCServer() {
+    // Joins the workers first as they notify |wake_up_write_|.
+    workers_.clear();
+    for (Job *job : completed_jobs_) {
+      delete job;
+    }
+    for (const auto &connection : connections_) {
+      CloseSocket(connection.second->socket);
+    }
     CloseSocket(server_socket_);
     server_socket_ = kInvalidSocket;
+#ifndef OS_WIN
+    ::close(wake_up_read_);
+    ::close(wake_up_write_);
+#endif  // OS_WIN
   }
 
   void Loop() {
-    LOG(INFO) << "Start Mozc RPCServer";
+    LOG(INFO) << "Start Mozc RPCServer with " << workers_.size()
+              << " worker(s)";
 
+    std::vector<struct pollfd> fds;
+    std::vector<uint64> fd_connection_ids;
     while (true) {
-      const int client_socket = ::accept(server_socket_, NULL, NULL);
+      fds.clear();
+      fd_connection_ids.clear();
+      AddPollFd(wake_up_read_, POLLIN, 0, &fds, &fd_connection_ids);
+      if (connections_.size() <
+          static_cast<size_t>(FLAGS_rpc_max_connections)) {
+        AddPollFd(server_socket_, POLLIN, 0, &fds, &fd_connection_ids);
+      }
+      for (const auto &entry : connections_) {
+        const Connection &connection = *entry.second;
+        short events = 0;
+        if (IsReadable(connection)) {
+          events |= POLLIN;
+        }
+        if (connection.output_pos < connection.output.size()) {
+          events |= POLLOUT;
+        }
+        AddPollFd(connection.socket, events, entry.first,
+                  &fds, &fd_connection_ids);
+      }
 
-      if (client_socket == kInvalidSocket) {
-        LOG(ERROR) << "accept failed";
+      if (Poll(&fds, kPollTimeoutMsec) < 0 && !WouldBlock()) {
+        LOG(ERROR) << "poll failed";
         continue;
       }
 
-      uint32 request_size = 0;
-      // Receive the size of data.
-      if (!Recv(client_socket, reinterpret_cast<char *>(&request_size),
-                sizeof(request_size), FLAGS_rpc_timeout)) {
-        LOG(ERROR) << "Cannot receive request_size header.";
+      for (size_t i = 0; i < fds.size(); ++i) {
+        if (fds[i].revents == 0) {
+          continue;
+        }
+        if (fds[i].fd == wake_up_read_) {
+          DrainWakeUp();
+        } else if (fds[i].fd == server_socket_) {
+          AcceptConnections();
+        } else {
+          HandleConnectionEvent(fd_connection_ids[i], fds[i].revents);
+        }
+      }
+
+      HandleCompletedJobs();
+      DispatchRequests();
+      MaybeLogMetrics();
+    }
+  }
+
+ private:
+  // Maximum time to block in poll().  On Windows there is no pipe to wake
+  // up the I/O thread, so completed jobs are picked up by this interval.
+#ifdef OS_WIN
+  static const int kPollTimeoutMsec = 5;
+#else
+  static const int kPollTimeoutMsec = 1000;
+#endif  // OS_WIN
+
+  struct Connection {
+    Connection() : socket(kInvalidSocket), output_pos(0), pending_worker(0),
+                   in_flight(false), closed(false) {}
+
+    int socket;
+    // Received bytes not decoded yet.
+    string input;
+    // Encoded responses and the position of the next byte to send.
+    string output;
+    size_t output_pos;
+    // Decoded request waiting for its worker to have room in the queue.
+    std::unique_ptr<commands::Command> pending;
+    size_t pending_worker;
+    // True while a request of this connection is evaluated.
+    bool in_flight;
+    // True after the peer closed the connection or an error happened.  The
+    // connection is released when no request is in flight.
+    bool closed;
+    // Sessions created through this connection.
+    std::set<uint64> session_ids;
+  };
+
+  struct Job {
+    // 0 if the response is not sent to any connection.
+    uint64 connection_id;
+    size_t worker;
+    commands::Command command;
+    // Measures the time from the dispatch to the completion.
+    Stopwatch latency;
+    int64 eval_usec;
+  };
+
+  // Evaluates jobs with its own session handler on its own thread.
+  class Worker {
+   public:
+    explicit Worker(RPCServer *server)
+        : queue_depth(0),
+          num_sessions(0),
+          server_(server),
+          handler_(new SessionHandler(
+              std::unique_ptr<Engine>(EngineFactory::Create()))),
+          pool_(new ThreadPool(1)) {}
+
+    ~Worker() {
+      // Runs the remaining jobs before the handler is destroyed.
+      pool_.reset();
+    }
+
+    // Takes the ownership of |job|.
+    void Schedule(Job *job) {
+      ++queue_depth;
+      pool_->Schedule([this, job]() {
+        Stopwatch stopwatch = Stopwatch::StartNew();
+        if (!handler_->EvalCommand(&job->command)) {
+          LOG(ERROR) << "EvalCommand failed";
+        }
+        job->eval_usec =
+            static_cast<int64>(stopwatch.GetElapsedMicroseconds());
+        server_->CompleteJob(job);
+      });
+    }
+
+    SessionHandler *handler() { return handler_.get(); }
+
+    // Only accessed from the I/O thread.
+    int queue_depth;
+    int num_sessions;
+
+   private:
+    RPCServer *server_;
+    std::unique_ptr<SessionHandler> handler_;
+    std::unique_ptr<ThreadPool> pool_;
+
+    DISALLOW_COPY_AND_ASSIGN(Worker);
+  };
+
+  static void AddPollFd(int socket, short events, uint64 connection_id,
+                        std::vector<struct pollfd> *fds,
+                        std::vector<uint64> *connection_ids) {
+    if (socket == kInvalidSocket) {
+      return;
+    }
+    struct pollfd fd;
+    fd.fd = socket;
+    fd.events = events;
+    fd.revents = 0;
+    fds->push_back(fd);
+    connection_ids->push_back(connection_id);
+  }
+
+  // A connection is read only when it has no request to process, so that
+  // a busy server stops receiving from its clients.
+  static bool IsReadable(const Connection &connection) {
+    return !connection.closed && !connection.in_flight &&
+           !connection.pending && !HasFrame(connection.input);
+  }
+
+  static bool HasFrame(const string &input) {
+    uint32 size = 0;
+    if (input.size() < sizeof(size)) {
+      return false;
+    }
+    ::memcpy(&size, input.data(), sizeof(size));
+    size = ntohl(size);
+    if (size == 0 || size >= kMaxRequestSize) {
+      // Let DecodeRequest() reject it.
+      return true;
+    }
+    return input.size() >= sizeof(size) + size;
+  }
+
+  // Called on the worker threads.
+  void CompleteJob(Job *job) {
+    {
+      scoped_lock l(&completed_jobs_mutex_);
+      completed_jobs_.push_back(job);
+    }
+#ifndef OS_WIN
+    const char kWakeUp = 0;
+    // The pipe being full is fine since the I/O thread is woken up anyway.
+    if (::write(wake_up_write_, &kWakeUp, 1) < 0 && !WouldBlock()) {
+      LOG(ERROR) << "cannot wake up the I/O thread";
+    }
+#endif  // OS_WIN
+  }
+
+  void DrainWakeUp() {
+#ifndef OS_WIN
+    char buf[256];
+    while (::read(wake_up_read_, buf, sizeof(buf)) > 0) {
+    }
+#endif  // OS_WIN
+  }
+
+  void AcceptConnections() {
+    while (connections_.size() <
+           static_cast<size_t>(FLAGS_rpc_max_connections)) {
+      const int client_socket = ::accept(server_socket_, NULL, NULL);
+      if (client_socket == kInvalidSocket) {
+        if (!WouldBlock()) {
+          LOG(ERROR) << "accept failed";
+        }
+        return;
+      }
+      SetCloseOnExec(client_socket);
+      if (!SetNonBlocking(client_socket)) {
+        LOG(ERROR) << "cannot make socket non-blocking";
         CloseSocket(client_socket);
         continue;
       }
-      request_size = ntohl(request_size);
-      CHECK_GT(request_size, 0);
-      CHECK_LT(request_size, kMaxRequestSize);
-
-      // Receive the body of serialized protobuf.
-      std::unique_ptr<char[]> request_str(new char[request_size]);
-      if (!Recv(client_socket,
-                request_str.get(), request_size, FLAGS_rpc_timeout)) {
-        LOG(ERROR) << "cannot receive body of request.";
-        CloseSocket(client_socket);
+      std::unique_ptr<Connection> connection(new Connection);
+      connection->socket = client_socket;
+      connections_[next_connection_id_++] = std::move(connection);
+    }
+  }
+
+  void HandleConnectionEvent(uint64 connection_id, short revents) {
+    auto it = connections_.find(connection_id);
+    if (it == connections_.end()) {
+      return;
+    }
+    Connection *connection = it->second.get();
+    if (revents & POLLIN) {
+      Receive(connection);
+    }
+    if (revents & POLLOUT) {
+      SendOutput(connection);
+    }
+    if (revents & (POLLERR | POLLNVAL)) {
+      connection->closed = true;
+    } else if ((revents & POLLHUP) && !(revents & POLLIN)) {
+      connection->closed = true;
+    }
+    MaybeReleaseConnection(connection_id);
+  }
+
+  void Receive(Connection *connection) {
+    char buf[8192];
+    while (!HasFrame(connection->input)) {
+      const ssize_t size = ::recv(connection->socket, buf, sizeof(buf), 0);
+      if (size > 0) {
+        connection->input.append(buf, size);
         continue;
       }
+      if (size < 0 && WouldBlock()) {
+        return;
+      }
+      // The peer closed the connection or an error happened.
+      connection->closed = true;
+      return;
+    }
+  }
 
-      commands::Command command;
-      if (!command.mutable_input()->ParseFromArray(request_str.get(),
-                                                   request_size)) {
-        LOG(ERROR) << "ParseFromArray failed";
-        CloseSocket(client_socket);
+  void SendOutput(Connection *connection) {
+#if defined(OS_WIN)
+    const int kFlag = 0;
+#elif defined(OS_MACOSX)
+    const int kFlag = SO_NOSIGPIPE;
+#else
+    const int kFlag = MSG_NOSIGNAL;
+#endif
+    while (connection->output_pos < connection->output.size()) {
+      const ssize_t size = ::send(
+          connection->socket,
+          connection->output.data() + connection->output_pos,
+          connection->output.size() - connection->output_pos, kFlag);
+      if (size < 0) {
+        if (!WouldBlock()) {
+          LOG(ERROR) << "an error occurred during sending";
+          connection->closed = true;
+        }
+        return;
+      }
+      connection->output_pos += size;
+    }
+    connection->output.clear();
+    connection->output_pos = 0;
+  }
+
+  void MaybeReleaseConnection(uint64 connection_id) {
+    auto it = connections_.find(connection_id);
+    if (it == connections_.end()) {
+      return;
+    }
+    Connection *connection = it->second.get();
+    if (!connection->closed || connection->in_flight) {
+      return;
+    }
+    if (FLAGS_rpc_delete_sessions_on_close) {
+      for (const uint64 id : connection->session_ids) {
+        auto session = session_workers_.find(id);
+        if (session == session_workers_.end()) {
+          continue;
+        }
+        Job *job = new Job;
+        job->connection_id = 0;
+        job->worker = session->second;
+        job->command.mutable_input()->set_type(
+            commands::Input::DELETE_SESSION);
+        job->command.mutable_input()->set_id(id);
+        job->latency = Stopwatch::StartNew();
+        job->eval_usec = 0;
+        workers_[job->worker]->Schedule(job);
+      }
+    }
+    CloseSocket(connection->socket);
+    connections_.erase(it);
+  }
+
+  // Decodes the next request of each idle connection and hands it to the
+  // worker if its queue has room.
+  void DispatchRequests() {
+    std::vector<uint64> invalid_connections;
+    for (auto &entry : connections_) {
+      Connection *connection = entry.second.get();
+      if (connection->closed || connection->in_flight) {
         continue;
       }
+      if (!connection->pending) {
+        if (!HasFrame(connection->input)) {
+          continue;
+        }
+        if (!DecodeRequest(connection)) {
+          connection->closed = true;
+          invalid_connections.push_back(entry.first);
+          continue;
+        }
+      }
+      Worker *worker = workers_[connection->pending_worker].get();
+      if (worker->queue_depth >= FLAGS_rpc_max_queue_depth) {
+        continue;
+      }
+      Job *job = new Job;
+      job->connection_id = entry.first;
+      job->worker = connection->pending_worker;
+      job->command.Swap(connection->pending.get());
+      job->latency = Stopwatch::StartNew();
+      job->eval_usec = 0;
+      connection->pending.reset();
+      connection->in_flight = true;
+      worker->Schedule(job);
+    }
+    for (const uint64 id : invalid_connections) {
+      MaybeReleaseConnection(id);
+    }
+  }
 
-      CHECK(handler_->EvalCommand(&command));
+  bool DecodeRequest(Connection *connection) {
+    uint32 request_size = 0;
+    ::memcpy(&request_size, connection->input.data(), sizeof(request_size));
+    request_size = ntohl(request_size);
+    if (request_size == 0 || request_size >= kMaxRequestSize) {
+      LOG(ERROR) << "Invalid request size: " << request_size;
+      return false;
+    }
+    std::unique_ptr<commands::Command> command(new commands::Command);
+    if (!command->mutable_input()->ParseFromArray(
+            connection->input.data() + sizeof(request_size), request_size)) {
+      LOG(ERROR) << "ParseFromArray failed";
+      return false;
+    }
+    connection->input.erase(0, sizeof(request_size) + request_size);
+    connection->pending_worker = SelectWorker(command->input());
+    connection->pending = std::move(command);
+    return true;
+  }
 
-      string output_str;
-      // Return the result.
-      CHECK(command.output().SerializeToString(&output_str));
+  size_t SelectWorker(const commands::Input &input) {
+    if (input.type() == commands::Input::CREATE_SESSION) {
+      size_t best = 0;
+      for (size_t i = 1; i < workers_.size(); ++i) {
+        if (workers_[i]->num_sessions < workers_[best]->num_sessions) {
+          best = i;
+        }
+      }
+      return best;
+    }
+    if (input.has_id()) {
+      const auto it = session_workers_.find(input.id());
+      if (it != session_workers_.end()) {
+        return it->second;
+      }
+    }
+    return 0;
+  }
 
-      uint32 output_size = output_str.size();
-      CHECK_GT(output_size, 0);
-      CHECK_LT(output_size, kMaxOutputSize);
-      output_size = htonl(output_size);
+  void HandleCompletedJobs() {
+    std::vector<Job *> jobs;
+    {
+      scoped_lock l(&completed_jobs_mutex_);
+      jobs.swap(completed_jobs_);
+    }
+    for (Job *job_ptr : jobs) {
+      std::unique_ptr<Job> job(job_ptr);
+      Worker *worker = workers_[job->worker].get();
+      --worker->queue_depth;
+      RecordLatency(job->latency.GetElapsedMicroseconds(), job->eval_usec);
+      UpdateSessions(*job);
+
+      auto it = connections_.find(job->connection_id);
+      if (it == connections_.end()) {
+        continue;
+      }
+      Connection *connection = it->second.get();
+      connection->in_flight = false;
+      if (!connection->closed) {
+        EncodeResponse(job->command.output(), connection);
+        SendOutput(connection);
+      }
+      MaybeReleaseConnection(job->connection_id);
+    }
+  }
 
-      if (!Send(client_socket, reinterpret_cast<char *>(&output_size),
-                sizeof(output_size), FLAGS_rpc_timeout) ||
-          !Send(client_socket, output_str.data(), output_str.size(),
-                FLAGS_rpc_timeout)) {
-        LOG(ERROR) << "Cannot send reply.";
+  void UpdateSessions(const Job &job) {
+    const commands::Input &input = job.command.input();
+    const commands::Output &output = job.command.output();
+    if (output.error_code() != commands::Output::SESSION_SUCCESS) {
+      return;
+    }
+    Connection *connection = NULL;
+    const auto it = connections_.find(job.connection_id);
+    if (it != connections_.end()) {
+      connection = it->second.get();
+    }
+    if (input.type() == commands::Input::CREATE_SESSION) {
+      session_workers_[output.id()] = job.worker;
+      ++workers_[job.worker]->num_sessions;
+      if (connection != NULL) {
+        connection->session_ids.insert(output.id());
+      }
+    } else if (input.type() == commands::Input::DELETE_SESSION) {
+      if (session_workers_.erase(input.id()) > 0) {
+        --workers_[job.worker]->num_sessions;
+      }
+      if (connection != NULL) {
+        connection->session_ids.erase(input.id());
       }
+    }
+  }
+
+  static void EncodeResponse(const commands::Output &output,
+                             Connection *connection) {
+    string output_str;
+    CHECK(output.SerializeToString(&output_str));
+    uint32 output_size = output_str.size();
+    CHECK_GT(output_size, 0);
+    CHECK_LT(output_size, kMaxOutputSize);
+    output_size = htonl(output_size);
+    connection->output.append(reinterpret_cast<const char *>(&output_size),
+                              sizeof(output_size));
+    connection->output.append(output_str);
+  }
+
+  void RecordLatency(double latency_usec, int64 eval_usec) {
+    ++metrics_.num_requests;
+    metrics_.total_latency_usec += static_cast<int64>(latency_usec);
+    metrics_.max_latency_usec = std::max(
+        metrics_.max_latency_usec, static_cast<int64>(latency_usec));
+    metrics_.total_eval_usec += eval_usec;
+  }
 
-      CloseSocket(client_socket);
+  void MaybeLogMetrics() {
+    if (FLAGS_rpc_metrics_interval <= 0 ||
+        metrics_stopwatch_.GetElapsedMilliseconds() <
+            FLAGS_rpc_metrics_interval * 1000) {
+      return;
+    }
+    int total_queue_depth = 0;
+    int max_queue_depth = 0;
+    for (const auto &worker : workers_) {
+      total_queue_depth += worker->queue_depth;
+      max_queue_depth = std::max(max_queue_depth, worker->queue_depth);
+    }
+    size_t num_waiting = 0;
+    for (const auto &entry : connections_) {
+      if (entry.second->pending) {
+        ++num_waiting;
+      }
     }
+    const int64 n = std::max<int64>(metrics_.num_requests, 1);
+    LOG(INFO) << "RPCServer metrics: connections=" << connections_.size()
+              << " sessions=" << session_workers_.size()
+              << " requests=" << metrics_.num_requests
+              << " avg_latency_usec=" << metrics_.total_latency_usec / n
+              << " max_latency_usec=" << metrics_.max_latency_usec
+              << " avg_eval_usec=" << metrics_.total_eval_usec / n
+              << " queue_depth=" << total_queue_depth
+              << " max_worker_queue_depth=" << max_queue_depth
+              << " waiting_connections=" << num_waiting;
+    metrics_ = Metrics();
+    metrics_stopwatch_ = Stopwatch::StartNew();
   }
 
- private:
+  // Accumulated since the last report.
+  struct Metrics {
+    Metrics() : num_requests(0), total_latency_usec(0), max_latency_usec(0),
+                total_eval_usec(0) {}
+    int64 num_requests;
+    int64 total_latency_usec;
+    int64 max_latency_usec;
+    int64 total_eval_usec;
+  };
+
   int server_socket_;
-  std::unique_ptr<SessionHandler> handler_;
+  int wake_up_read_;
+  int wake_up_write_;
+  uint64 next_connection_id_;
+  std::map<uint64, std::unique_ptr<Connection>> connections_;
+  // Worker index of each session.
+  std::map<uint64, size_t> session_workers_;
+  Mutex completed_jobs_mutex_;
+  std::vector<Job *> completed_jobs_;
+  Metrics metrics_;
+  Stopwatch metrics_stopwatch_;
+  std::vector<std::unique_ptr<Worker>> workers_;
+
+  DISALLOW_COPY_AND_ASSIGN(RPCServer);
 };
 
 // Standalone RPCClient.
 // TODO(taku): Make a RPC class inherited from IPCInterface.
 // This allows us to reuse client::Session library and SessionServer.
+//
+// All the calls share one connection, which is opened by the first call.
 class RPCClient {
  public:
-  RPCClient() : id_(0) {}
+  RPCClient() : id_(0), socket_(kInvalidSocket) {}
+  ~RPCClient() {
+    if (socket_ != kInvalidSocket) {
+      CloseSocket(socket_);
+    }
+  }
 
   bool CreateSession() {
     id_ = 0;
@@ -280,8 +844,7 @@ class RPCClient {
   }
 
  private:
-  bool Call(const commands::Input &input,
-            commands::Output *output) const {
+  void Connect() const {
     struct addrinfo hints, *res;
     ::memset(&hints, 0, sizeof(hints));
     hints.ai_socktype = SOCK_STREAM;
@@ -300,6 +863,17 @@ class RPCClient {
                        res->ai_addr, res->ai_addrlen), 0)
         << "connect failed";
 
+    ::freeaddrinfo(res);
+    socket_ = client_socket;
+  }
+
+  bool Call(const commands::Input &input,
+            commands::Output *output) const {
+    if (socket_ == kInvalidSocket) {
+      Connect();
+    }
+    const int client_socket = socket_;
+
     string request_str;
     CHECK(input.SerializeToString(&request_str));
     uint32 request_size = request_str.size();
@@ -325,14 +899,11 @@ class RPCClient {
 
     CHECK(output->ParseFromArray(output_str.get(), output_size));
 
-    ::freeaddrinfo(res);
-
-    CloseSocket(client_socket);
-
     return true;
   }
 
   uint64 id_;
+  mutable int socket_;
 };
 
 // Wrapper class for WSAStartup on Windows.
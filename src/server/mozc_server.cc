@@ -33,9 +33,12 @@
 #include <windows.h>
 #endif
 
+#include <algorithm>
 #include <cstddef>
 #include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "base/crash_report_handler.h"
 #include "base/flags.h"
@@ -45,14 +48,79 @@
 #include "base/run_level.h"
 #include "base/singleton.h"
 #include "base/system_util.h"
+#include "base/thread.h"
 #include "base/util.h"
 #include "config/stats_config_util.h"
 #include "session/session_server.h"
 
 DECLARE_bool(restricted);   // in SessionHandler
+DECLARE_bool(warm_up_data_set);  // in DataManager
+DECLARE_int32(session_server_shards);  // in SessionServer
+
+DEFINE_bool(prespawn, false,
+            "The server is launched ahead of the first client, e.g. at login. "
+            "It initializes itself at background priority and warms up the "
+            "data set.");
+
+DEFINE_bool(log_singleton_stats, false,
+            "Logs the construction time of the singletons once the server "
+            "is ready, slowest first.");
 
 namespace {
 mozc::SessionServer *g_session_server = NULL;
+
+void LogSingletonStats() {
+  std::vector<mozc::SingletonStats::Entry> entries =
+      mozc::SingletonStats::GetEntries();
+  std::stable_sort(entries.begin(), entries.end(),
+                   [](const mozc::SingletonStats::Entry &lhs,
+                      const mozc::SingletonStats::Entry &rhs) {
+                     return lhs.construction_usec > rhs.construction_usec;
+                   });
+  LOG(INFO) << entries.size() << " singletons are constructed";
+  for (size_t i = 0; i < entries.size(); ++i) {
+    LOG(INFO) << entries[i].construction_usec << " usec: " << entries[i].name;
+  }
+}
+
+// Creates the session server on a background priority thread so that the
+// initialization of a pre-spawned server does not slow down the other
+// programs starting at the same time. The threads created during the
+// initialization, e.g. the loaders of the user data, may inherit the
+// priority, which is intended.
+class SessionServerBuilder : public mozc::Thread {
+ public:
+  SessionServerBuilder() {}
+
+  void Run() override {
+    if (!mozc::Thread::LowerCurrentThreadPriority()) {
+      LOG(WARNING) << "Failed to lower the thread priority";
+    }
+    session_server_.reset(new mozc::SessionServer);
+  }
+
+  std::unique_ptr<mozc::SessionServer> release() {
+    return std::move(session_server_);
+  }
+
+ private:
+  std::unique_ptr<mozc::SessionServer> session_server_;
+
+  DISALLOW_COPY_AND_ASSIGN(SessionServerBuilder);
+};
+
+std::unique_ptr<mozc::SessionServer> CreateSessionServer() {
+  // Session shards serve the requests, so they must not be created at
+  // background priority.
+  if (!FLAGS_prespawn || FLAGS_session_server_shards > 0) {
+    return std::unique_ptr<mozc::SessionServer>(new mozc::SessionServer);
+  }
+  SessionServerBuilder builder;
+  builder.SetJoinable(true);
+  builder.Start("SessionServerBuilder");
+  builder.Join();
+  return builder.release();
+}
 }
 
 namespace mozc {
@@ -95,6 +163,12 @@ void InitMozcAndMozcServer(const char *arg0,
     FLAGS_restricted = true;
   }
 
+  if (FLAGS_prespawn) {
+    // Nobody is waiting for the pre-spawned server yet. Page in the data set
+    // in the background so that the first request does not wait for it.
+    FLAGS_warm_up_data_set = true;
+  }
+
   return;
 }
 
@@ -107,14 +181,17 @@ int MozcServer::Run() {
   }
 
   {
-    std::unique_ptr<mozc::SessionServer> session_server(
-        new mozc::SessionServer);
+    std::unique_ptr<mozc::SessionServer> session_server =
+        CreateSessionServer();
     g_session_server = session_server.get();
     CHECK(g_session_server);
     if (!g_session_server->Connected()) {
       LOG(ERROR) << "SessionServer initialization failed";
       return -1;
     }
+    if (FLAGS_log_singleton_stats) {
+      LogSingletonStats();
+    }
 
 #if defined(OS_WIN)
     // On Windows, ShutdownSessionCallback is not called intentionally in order
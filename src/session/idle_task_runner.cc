@@ -0,0 +1,184 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "session/idle_task_runner.h"
+
+#include <algorithm>
+
+#include "base/clock.h"
+#include "base/logging.h"
+#include "base/scheduler.h"
+#include "base/thread.h"
+
+namespace mozc {
+namespace session {
+namespace {
+
+uint64 GetTimeInMsec() {
+  uint64 sec = 0;
+  uint32 usec = 0;
+  Clock::GetTimeOfDay(&sec, &usec);
+  return sec * 1000 + usec / 1000;
+}
+
+}  // namespace
+
+class IdleTaskRunner::RunnerThread : public Thread {
+ public:
+  explicit RunnerThread(IdleTaskRunner *runner) : runner_(runner) {}
+
+  void Run() override {
+    Thread::LowerCurrentThreadPriority();
+    runner_->RunLoop();
+  }
+
+ private:
+  IdleTaskRunner *runner_;
+
+  DISALLOW_COPY_AND_ASSIGN(RunnerThread);
+};
+
+IdleTaskRunner::IdleTaskRunner(uint32 idle_window_msec, Mutex *mutex)
+    : idle_window_msec_(idle_window_msec),
+      task_mutex_(mutex),
+      stopping_(false) {
+  DCHECK_GT(idle_window_msec_, 0);
+}
+
+IdleTaskRunner::~IdleTaskRunner() {
+  {
+    scoped_lock l(&mutex_);
+    stopping_ = true;
+  }
+  if (thread_) {
+    wake_up_.Notify();
+    thread_->Join();
+  }
+  RunPendingTasks();
+}
+
+void IdleTaskRunner::Post(const string &name, std::function<void()> task) {
+  scoped_lock l(&mutex_);
+  bool replaced = false;
+  for (size_t i = 0; i < tasks_.size(); ++i) {
+    if (tasks_[i].first == name) {
+      tasks_[i].second = std::move(task);
+      replaced = true;
+      break;
+    }
+  }
+  if (!replaced) {
+    tasks_.push_back(Task(name, std::move(task)));
+  }
+  if (!thread_) {
+    thread_.reset(new RunnerThread(this));
+    thread_->SetJoinable(true);
+    thread_->Start("IdleTaskRunner");
+  }
+  wake_up_.Notify();
+}
+
+void IdleTaskRunner::RunPendingTasks() {
+  Task task;
+  while (PopTask(&task)) {
+    VLOG(1) << "Running " << task.first;
+    if (task_mutex_ != NULL) {
+      scoped_lock l(task_mutex_);
+      task.second();
+    } else {
+      task.second();
+    }
+  }
+}
+
+size_t IdleTaskRunner::num_pending_tasks() const {
+  scoped_lock l(&mutex_);
+  return tasks_.size();
+}
+
+uint64 IdleTaskRunner::GetRemainingWaitTime() const {
+  const uint64 idle_time =
+      Scheduler::GetLastUserActivityTime() + idle_window_msec_;
+  const uint64 now = GetTimeInMsec();
+  return now < idle_time ? idle_time - now : 0;
+}
+
+bool IdleTaskRunner::PopTask(Task *task) {
+  scoped_lock l(&mutex_);
+  if (tasks_.empty()) {
+    return false;
+  }
+  *task = std::move(tasks_.front());
+  tasks_.pop_front();
+  return true;
+}
+
+void IdleTaskRunner::RunLoop() {
+  while (true) {
+    int wait_msec = 0;
+    {
+      scoped_lock l(&mutex_);
+      if (stopping_) {
+        return;
+      }
+      if (tasks_.empty()) {
+        wait_msec = -1;  // Waits for Post().
+      } else {
+        wait_msec = static_cast<int>(
+            std::min<uint64>(GetRemainingWaitTime(), kint32max));
+      }
+    }
+    if (wait_msec != 0) {
+      wake_up_.Wait(wait_msec);
+      continue;
+    }
+
+    if (task_mutex_ != NULL) {
+      scoped_lock task_lock(task_mutex_);
+      RunNextTaskIfIdle();
+    } else {
+      RunNextTaskIfIdle();
+    }
+  }
+}
+
+void IdleTaskRunner::RunNextTaskIfIdle() {
+  // The user may have resumed typing while waiting for |task_mutex_|.
+  if (GetRemainingWaitTime() > 0) {
+    return;
+  }
+  Task task;
+  if (PopTask(&task)) {
+    VLOG(1) << "Running " << task.first << " in idle time";
+    task.second();
+  }
+}
+
+}  // namespace session
+}  // namespace mozc
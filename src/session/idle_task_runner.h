@@ -0,0 +1,106 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Runs the maintenance tasks of the server while the user is not typing.
+
+#ifndef MOZC_SESSION_IDLE_TASK_RUNNER_H_
+#define MOZC_SESSION_IDLE_TASK_RUNNER_H_
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "base/mutex.h"
+#include "base/port.h"
+#include "base/unnamed_event.h"
+
+namespace mozc {
+namespace session {
+
+// Defers the posted tasks until Scheduler::NotifyUserActivity() has not been
+// called for the idle window, then runs them one by one on a low priority
+// background thread.  The activity is checked again before every task, so the
+// remaining tasks wait for the next idle time as soon as the user resumes
+// typing.  A task already running is not interrupted.
+//
+// Usage:
+//   IdleTaskRunner runner(5000, &mutex);
+//   runner.Post("SyncUserData", [engine]() { engine->Sync(); });
+class IdleTaskRunner {
+ public:
+  // |idle_window_msec| must be positive.  |mutex| is held while a task runs
+  // so that the tasks are serialized with the commands.  It can be null.
+  IdleTaskRunner(uint32 idle_window_msec, Mutex *mutex);
+  // Runs all the pending tasks on the calling thread.
+  ~IdleTaskRunner();
+
+  // Schedules |task|.  If a task of the same |name| is pending, it is
+  // replaced by |task| instead of running twice.  This method is
+  // thread-safe.
+  void Post(const string &name, std::function<void()> task);
+
+  // Runs all the pending tasks on the calling thread without waiting for the
+  // idle time.
+  void RunPendingTasks();
+
+  size_t num_pending_tasks() const;
+
+ private:
+  class RunnerThread;
+  typedef std::pair<string, std::function<void()>> Task;
+
+  // Returns the msec to wait until the user gets idle, or 0 if idle now.
+  uint64 GetRemainingWaitTime() const;
+  // Pops the first pending task to |task|.  Returns false if nothing is
+  // pending.
+  bool PopTask(Task *task);
+  // Runs the first pending task unless the user is active.
+  void RunNextTaskIfIdle();
+  // Runs on |thread_| until the destruction.
+  void RunLoop();
+
+  const uint32 idle_window_msec_;
+  Mutex *task_mutex_;
+
+  // Guards the members below.
+  mutable Mutex mutex_;
+  std::deque<Task> tasks_;
+  bool stopping_;
+  UnnamedEvent wake_up_;
+  std::unique_ptr<RunnerThread> thread_;
+
+  DISALLOW_COPY_AND_ASSIGN(IdleTaskRunner);
+};
+
+}  // namespace session
+}  // namespace mozc
+
+#endif  // MOZC_SESSION_IDLE_TASK_RUNNER_H_
@@ -0,0 +1,104 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "session/idle_task_runner.h"
+
+#include <atomic>
+#include <memory>
+
+#include "base/clock.h"
+#include "base/mutex.h"
+#include "base/scheduler.h"
+#include "base/unnamed_event.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace session {
+namespace {
+
+const int kTimeout = 30 * 1000;  // 30 sec.
+const uint32 kLongWindow = 60 * 60 * 1000;  // 1 hour.
+
+uint64 GetTimeInMsec() {
+  uint64 sec = 0;
+  uint32 usec = 0;
+  Clock::GetTimeOfDay(&sec, &usec);
+  return sec * 1000 + usec / 1000;
+}
+
+TEST(IdleTaskRunnerTest, RunsAfterIdleWindow) {
+  const uint32 kWindow = 100;
+  Mutex mutex;
+  IdleTaskRunner runner(kWindow, &mutex);
+  Scheduler::NotifyUserActivity();
+  const uint64 activity_time = Scheduler::GetLastUserActivityTime();
+
+  std::atomic<uint64> run_time(0);
+  UnnamedEvent event;
+  runner.Post("Task", [&run_time, &event]() {
+    run_time = GetTimeInMsec();
+    event.Notify();
+  });
+  ASSERT_TRUE(event.Wait(kTimeout));
+  EXPECT_LE(activity_time + kWindow, run_time);
+  EXPECT_EQ(0, runner.num_pending_tasks());
+}
+
+TEST(IdleTaskRunnerTest, CoalescesTasksOfSameName) {
+  int sync_value = 0;
+  int reload_count = 0;
+  {
+    IdleTaskRunner runner(kLongWindow, nullptr);
+    Scheduler::NotifyUserActivity();
+    runner.Post("Sync", [&sync_value]() { sync_value = 1; });
+    runner.Post("Reload", [&reload_count]() { ++reload_count; });
+    runner.Post("Sync", [&sync_value]() { sync_value = 2; });
+    EXPECT_EQ(2, runner.num_pending_tasks());
+    EXPECT_EQ(0, sync_value);
+    EXPECT_EQ(0, reload_count);
+  }
+  // The pending tasks run on the destruction.
+  EXPECT_EQ(2, sync_value);
+  EXPECT_EQ(1, reload_count);
+}
+
+TEST(IdleTaskRunnerTest, RunPendingTasks) {
+  IdleTaskRunner runner(kLongWindow, nullptr);
+  Scheduler::NotifyUserActivity();
+  int count = 0;
+  runner.Post("Task1", [&count]() { ++count; });
+  runner.Post("Task2", [&count]() { ++count; });
+  runner.RunPendingTasks();
+  EXPECT_EQ(2, count);
+  EXPECT_EQ(0, runner.num_pending_tasks());
+}
+
+}  // namespace
+}  // namespace session
+}  // namespace mozc
@@ -123,8 +123,13 @@ void ImeContext::CopyContext(const ImeContext &src, ImeContext *dest) {
 
   dest->set_state(src.state());
 
-  dest->SetRequest(src.request_);
-  dest->SetConfig(src.config_);
+  // The composer, the converter and the key event transformer above are
+  // copied with the request and the config of |src|.  Thus the pointers are
+  // just copied, instead of calling SetConfig(), which reloads the tables
+  // built from the config.
+  dest->request_ = src.request_;
+  dest->config_ = src.config_;
+  dest->keymap_ = src.keymap_;
 
   dest->mutable_client_capability()->CopyFrom(src.client_capability());
   dest->mutable_application_info()->CopyFrom(src.application_info());
@@ -187,6 +187,8 @@ TEST(ImeContextTest, CopyContext) {
     source.mutable_converter()->Convert(source.composer());
     const string &kQuick = "早い";
     source.mutable_composer()->set_source_text(kQuick);
+    // A temporary keymap different from the config.
+    source.set_keymap(config::Config::MSIME);
 
     string composition;
     source.composer().GetQueryForConversion(&composition);
@@ -211,6 +213,7 @@ TEST(ImeContextTest, CopyContext) {
     EXPECT_EQ("庵", output.preedit().segment(0).value());
 
     EXPECT_EQ(kQuick, destination.composer().source_text());
+    EXPECT_EQ(config::Config::MSIME, destination.keymap());
   }
 }
 
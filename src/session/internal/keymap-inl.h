@@ -39,6 +39,15 @@
 namespace mozc {
 namespace keymap {
 
+// Mixes the bits of |key|, whose lower bits are often the same among the
+// rules.
+inline size_t GetKeyInformationHash(KeyInformation key) {
+  key ^= key >> 33;
+  key *= 0xff51afd7ed558ccdULL;
+  key ^= key >> 33;
+  return static_cast<size_t>(key);
+}
+
 template<typename T>
 bool KeyMap<T>::GetCommand(const commands::KeyEvent &key_event,
                            CommandsType* command) const {
@@ -51,20 +60,39 @@ bool KeyMap<T>::GetCommand(const commands::KeyEvent &key_event,
     return false;
   }
 
-  typename KeyToCommandMap::const_iterator it = keymap_.find(key);
-  if (it != keymap_.end()) {
+  if (Find(key, command)) {
+    return true;
+  }
+
+  if (KeyEventUtil::MaybeGetKeyStub(normalized_key_event, &key) &&
+      Find(key, command)) {
+    return true;
+  }
+
+  return false;
+}
+
+template<typename T>
+bool KeyMap<T>::Find(KeyInformation key, CommandsType *command) const {
+  if (!compiled_) {
+    typename KeyToCommandMap::const_iterator it = keymap_.find(key);
+    if (it == keymap_.end()) {
+      return false;
+    }
     *command = it->second;
     return true;
   }
 
-  if (KeyEventUtil::MaybeGetKeyStub(normalized_key_event, &key)) {
-    it = keymap_.find(key);
-    if (it != keymap_.end()) {
-      *command = it->second;
+  if (table_.empty()) {
+    return false;
+  }
+  for (size_t i = GetKeyInformationHash(key) & mask_; table_[i].used;
+       i = (i + 1) & mask_) {
+    if (table_[i].key == key) {
+      *command = table_[i].command;
       return true;
     }
   }
-
   return false;
 }
 
@@ -77,12 +105,43 @@ bool KeyMap<T>::AddRule(const commands::KeyEvent &key_event,
   }
 
   keymap_[key] = command;
+  compiled_ = false;
+  table_.clear();
   return true;
 }
 
 template<typename T>
 void KeyMap<T>::Clear() {
   keymap_.clear();
+  compiled_ = false;
+  table_.clear();
+}
+
+template<typename T>
+void KeyMap<T>::Compile() {
+  table_.clear();
+  mask_ = 0;
+  if (!keymap_.empty()) {
+    // Keep the load factor at 1/2 or below.
+    size_t capacity = 8;
+    while (capacity < keymap_.size() * 2) {
+      capacity *= 2;
+    }
+    const Slot kEmptySlot = { 0, CommandsType(), false };
+    table_.resize(capacity, kEmptySlot);
+    mask_ = capacity - 1;
+    for (typename KeyToCommandMap::const_iterator it = keymap_.begin();
+         it != keymap_.end(); ++it) {
+      size_t i = GetKeyInformationHash(it->first) & mask_;
+      while (table_[i].used) {
+        i = (i + 1) & mask_;
+      }
+      table_[i].key = it->first;
+      table_[i].command = it->second;
+      table_[i].used = true;
+    }
+  }
+  compiled_ = true;
 }
 
 }  // namespace keymap
@@ -83,6 +83,16 @@ void KeyMapManager::Reset() {
   keymap_prediction_.Clear();
 }
 
+void KeyMapManager::Compile() {
+  keymap_direct_.Compile();
+  keymap_precomposition_.Compile();
+  keymap_composition_.Compile();
+  keymap_conversion_.Compile();
+  keymap_zero_query_suggestion_.Compile();
+  keymap_suggestion_.Compile();
+  keymap_prediction_.Compile();
+}
+
 bool KeyMapManager::Initialize(const config::Config::SessionKeymap keymap) {
   keymap_ = keymap;
   // Clear the previous keymaps.
@@ -216,6 +226,8 @@ bool KeyMapManager::LoadStreamWithErrors(std::istream *ifs,
   key_event.Clear();
   KeyParser::ParseKey("Shift", &key_event);
   keymap_composition_.AddRule(key_event, CompositionState::INSERT_CHARACTER);
+
+  Compile();
   return true;
 }
 
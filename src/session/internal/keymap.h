@@ -36,6 +36,7 @@
 #include <map>
 #include <set>
 #include <string>
+#include <vector>
 
 #include "composer/key_event_util.h"
 #include "protocol/config.pb.h"
@@ -54,14 +55,33 @@ class KeyMap : public KeyMapInterface<typename T::Commands> {
  public:
   typedef typename T::Commands CommandsType;
 
+  KeyMap() : mask_(0), compiled_(false) {}
+
   bool GetCommand(const commands::KeyEvent &key_event,
                   CommandsType *command) const;
   bool AddRule(const commands::KeyEvent &key_event, CommandsType command);
   void Clear();
 
+  // Builds a flat hash table from the rules so that GetCommand() doesn't walk
+  // the map.  AddRule() and Clear() discard the table until the next call.
+  void Compile();
+
  private:
+  struct Slot {
+    KeyInformation key;
+    CommandsType command;
+    bool used;
+  };
+
+  bool Find(KeyInformation key, CommandsType *command) const;
+
   typedef std::map<KeyInformation, CommandsType> KeyToCommandMap;
   KeyToCommandMap keymap_;
+
+  // Open-addressing table compiled from |keymap_|, probed linearly.
+  std::vector<Slot> table_;
+  size_t mask_;
+  bool compiled_;
 };
 
 class KeyMapManager {
@@ -133,6 +153,8 @@ class KeyMapManager {
   friend class KeyMapTest;
 
   void Reset();
+  // Compiles all the keymaps.  Called after rules are loaded.
+  void Compile();
   void InitCommandData();
 
   bool ParseCommandDirect(const string &command_string,
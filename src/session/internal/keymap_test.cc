@@ -37,6 +37,7 @@
 #include <vector>
 
 #include "base/config_file_stream.h"
+#include "base/port.h"
 #include "base/system_util.h"
 #include "composer/key_parser.h"
 #include "config/config_handler.h"
@@ -257,6 +258,61 @@ TEST_F(KeyMapTest, GetCommandKeyStub) {
   EXPECT_EQ(PrecompositionState::INSERT_CHARACTER, command);
 }
 
+TEST_F(KeyMapTest, CompiledKeyMap) {
+  KeyMap<PrecompositionState> keymap;
+  PrecompositionState::Commands command;
+  commands::KeyEvent key_event;
+
+  // An empty keymap can be compiled.
+  keymap.Compile();
+  KeyParser::ParseKey("a", &key_event);
+  EXPECT_FALSE(keymap.GetCommand(key_event, &command));
+
+  // Register enough rules to make collisions in the table.
+  const char *kKeys[] = {
+    "a", "b", "c", "Space", "Enter", "Ctrl a", "Ctrl b", "Shift Space",
+    "Alt Space", "Ctrl Shift a", "F1", "F2", "Left", "Right", "Up", "Down",
+  };
+  for (size_t i = 0; i < arraysize(kKeys); ++i) {
+    key_event.Clear();
+    KeyParser::ParseKey(kKeys[i], &key_event);
+    EXPECT_TRUE(keymap.AddRule(key_event, PrecompositionState::INSERT_SPACE));
+  }
+  commands::KeyEvent stub_key_event;
+  stub_key_event.set_special_key(commands::KeyEvent::TEXT_INPUT);
+  EXPECT_TRUE(keymap.AddRule(stub_key_event,
+                             PrecompositionState::INSERT_CHARACTER));
+  keymap.Compile();
+
+  for (size_t i = 0; i < arraysize(kKeys); ++i) {
+    key_event.Clear();
+    KeyParser::ParseKey(kKeys[i], &key_event);
+    EXPECT_TRUE(keymap.GetCommand(key_event, &command)) << kKeys[i];
+    EXPECT_EQ(PrecompositionState::INSERT_SPACE, command);
+  }
+  key_event.Clear();
+  KeyParser::ParseKey("Ctrl c", &key_event);
+  EXPECT_FALSE(keymap.GetCommand(key_event, &command));
+  // Falls back to the key stub.
+  key_event.Clear();
+  KeyParser::ParseKey("d", &key_event);
+  EXPECT_TRUE(keymap.GetCommand(key_event, &command));
+  EXPECT_EQ(PrecompositionState::INSERT_CHARACTER, command);
+
+  // Rules added after compilation are effective.
+  key_event.Clear();
+  KeyParser::ParseKey("a", &key_event);
+  EXPECT_TRUE(keymap.AddRule(key_event, PrecompositionState::REVERT));
+  EXPECT_TRUE(keymap.GetCommand(key_event, &command));
+  EXPECT_EQ(PrecompositionState::REVERT, command);
+  keymap.Compile();
+  EXPECT_TRUE(keymap.GetCommand(key_event, &command));
+  EXPECT_EQ(PrecompositionState::REVERT, command);
+
+  keymap.Clear();
+  EXPECT_FALSE(keymap.GetCommand(key_event, &command));
+}
+
 TEST_F(KeyMapTest, GetKeyMapFileName) {
   EXPECT_STREQ("system://atok.tsv",
                KeyMapManager::GetKeyMapFileName(config::Config::ATOK));
@@ -52,11 +52,10 @@ namespace {
 
 using config::Config;
 
-std::vector<KeyInformation> ExtractSortedDirectModeKeysFromStream(
-    std::istream *ifs) {
-  const char kModeDirect[] = "Direct";
-  const char kModeDirectInput[] = "DirectInput";
-
+// Returns a sorted list of keys assigned in the modes which |is_target_mode|
+// accepts.
+std::vector<KeyInformation> ExtractSortedKeysFromStream(
+    std::istream *ifs, bool (*is_target_mode)(const string &mode)) {
   std::vector<KeyInformation> result;
 
   string line;
@@ -74,7 +73,7 @@ std::vector<KeyInformation> ExtractSortedDirectModeKeysFromStream(
       LOG(ERROR) << "Invalid format: " << line;
       continue;
     }
-    if (!(rules[0] == kModeDirect || rules[0] == kModeDirectInput)) {
+    if (!is_target_mode(rules[0])) {
       continue;
     }
     commands::KeyEvent key_event;
@@ -90,20 +89,18 @@ std::vector<KeyInformation> ExtractSortedDirectModeKeysFromStream(
   return result;
 }
 
-std::vector<KeyInformation> ExtractSortedDirectModeKeysFromFile(
-      const string &filename) {
+std::vector<KeyInformation> ExtractSortedKeysFromFile(
+      const string &filename, bool (*is_target_mode)(const string &mode)) {
   std::unique_ptr<std::istream> ifs(ConfigFileStream::LegacyOpen(filename));
   if (ifs.get() == NULL) {
     DLOG(FATAL) << "could not open file: " << filename;
     return std::vector<KeyInformation>();
   }
-  return ExtractSortedDirectModeKeysFromStream(ifs.get());
+  return ExtractSortedKeysFromStream(ifs.get(), is_target_mode);
 }
 
-}  // namespace
-
-std::vector<KeyInformation> KeyInfoUtil::ExtractSortedDirectModeKeys(
-    const config::Config &config) {
+std::vector<KeyInformation> ExtractSortedKeys(
+    const config::Config &config, bool (*is_target_mode)(const string &mode)) {
   const config::Config::SessionKeymap &keymap = config.session_keymap();
   if (keymap == Config::CUSTOM) {
     const string &custom_keymap_table = config.custom_keymap_table();
@@ -111,13 +108,33 @@ std::vector<KeyInformation> KeyInfoUtil::ExtractSortedDirectModeKeys(
       LOG(WARNING) << "custom_keymap_table is empty. use default setting";
       const char *default_keymapfile = keymap::KeyMapManager::GetKeyMapFileName(
           config::ConfigHandler::GetDefaultKeyMap());
-      return ExtractSortedDirectModeKeysFromFile(default_keymapfile);
+      return ExtractSortedKeysFromFile(default_keymapfile, is_target_mode);
     }
     std::istringstream ifs(custom_keymap_table);
-    return ExtractSortedDirectModeKeysFromStream(&ifs);
+    return ExtractSortedKeysFromStream(&ifs, is_target_mode);
   }
   const char *keymap_file = keymap::KeyMapManager::GetKeyMapFileName(keymap);
-  return ExtractSortedDirectModeKeysFromFile(keymap_file);
+  return ExtractSortedKeysFromFile(keymap_file, is_target_mode);
+}
+
+bool IsDirectMode(const string &mode) {
+  return mode == "Direct" || mode == "DirectInput";
+}
+
+bool IsPrecompositionMode(const string &mode) {
+  return mode == "Precomposition";
+}
+
+}  // namespace
+
+std::vector<KeyInformation> KeyInfoUtil::ExtractSortedDirectModeKeys(
+    const config::Config &config) {
+  return ExtractSortedKeys(config, IsDirectMode);
+}
+
+std::vector<KeyInformation> KeyInfoUtil::ExtractSortedPrecompositionKeys(
+    const config::Config &config) {
+  return ExtractSortedKeys(config, IsPrecompositionMode);
 }
 
 bool KeyInfoUtil::ContainsKey(const std::vector<KeyInformation> &sorted_keys,
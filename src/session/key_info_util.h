@@ -49,6 +49,12 @@ class KeyInfoUtil {
   static std::vector<KeyInformation> ExtractSortedDirectModeKeys(
       const config::Config &config);
 
+  // Returns a sorted list of KeyInformation that is assigned in PRECOMPOSITION
+  // mode.  While there is neither composition nor suggestion, the server
+  // echoes back any key with modifiers that is not in the list.
+  static std::vector<KeyInformation> ExtractSortedPrecompositionKeys(
+      const config::Config &config);
+
   // Returns true if |sorted_keys| contains |key_event|. |sorted_keys| must be
   // sorted.
   static bool ContainsKey(const std::vector<KeyInformation> &sorted_keys,
@@ -86,6 +86,32 @@ TEST(KeyInfoUtilTest, ExtractSortedDirectModeKeys) {
   }
 }
 
+TEST(KeyInfoUtilTest, ExtractSortedPrecompositionKeys) {
+  Config config;
+  ConfigHandler::GetDefaultConfig(&config);
+
+  const char kCustomKeymapTable[] =
+      "status\tkey\tcommand\n"
+      "DirectInput\tHenkan\tIMEOn\n"
+      "Precomposition\tCtrl Backspace\tUndo\n"
+      "Precomposition\tCtrl m\tIMEOff\n"
+      "Composition\tCtrl n\tConvert\n";
+  config.set_session_keymap(Config::CUSTOM);
+  config.set_custom_keymap_table(kCustomKeymapTable);
+
+  const auto &actual = KeyInfoUtil::ExtractSortedPrecompositionKeys(config);
+
+  std::vector<KeyInformation> expected;
+  PushKey("Ctrl Backspace", &expected);
+  PushKey("Ctrl m", &expected);
+  std::sort(expected.begin(), expected.end());
+
+  ASSERT_EQ(expected.size(), actual.size());
+  for (size_t i = 0; i < expected.size(); ++i) {
+    EXPECT_EQ(expected[i], actual[i]);
+  }
+}
+
 TEST(KeyInfoUtilTest, ContainsKey) {
   std::vector<KeyInformation> direct_mode_keys;
   PushKey("HENKAN", &direct_mode_keys);
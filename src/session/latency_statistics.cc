@@ -0,0 +1,188 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "session/latency_statistics.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "base/logging.h"
+#include "protocol/commands.pb.h"
+
+namespace mozc {
+namespace session {
+namespace {
+
+const uint64 kSubBucketCount = 1 << LatencyHistogram::kSubBucketBits;
+
+// Returns the position of the most significant bit of |value| > 0.
+int GetMostSignificantBit(uint64 value) {
+  DCHECK_GT(value, 0);
+  int bit = 0;
+  while (value >>= 1) {
+    ++bit;
+  }
+  return bit;
+}
+
+}  // namespace
+
+LatencyHistogram::LatencyHistogram()
+    : count_(0), total_usec_(0), max_usec_(0) {}
+
+LatencyHistogram::~LatencyHistogram() {}
+
+// static
+size_t LatencyHistogram::GetBucketIndex(uint64 usec) {
+  if (usec < kSubBucketCount) {
+    return static_cast<size_t>(usec);
+  }
+  // The top kSubBucketBits + 1 bits of |usec| select the bucket.
+  const int shift = GetMostSignificantBit(usec) - kSubBucketBits;
+  return static_cast<size_t>((shift + 1) * kSubBucketCount +
+                             (usec >> shift) - kSubBucketCount);
+}
+
+// static
+uint64 LatencyHistogram::GetBucketUpperBound(size_t index) {
+  if (index < kSubBucketCount) {
+    return index;
+  }
+  const int shift = static_cast<int>(index / kSubBucketCount) - 1;
+  const uint64 lower = (kSubBucketCount + index % kSubBucketCount) << shift;
+  return lower + ((static_cast<uint64>(1) << shift) - 1);
+}
+
+void LatencyHistogram::Record(uint64 usec) {
+  const size_t index = GetBucketIndex(usec);
+  if (index >= buckets_.size()) {
+    buckets_.resize(index + 1, 0);
+  }
+  ++buckets_[index];
+  ++count_;
+  total_usec_ += usec;
+  max_usec_ = std::max(max_usec_, usec);
+}
+
+uint64 LatencyHistogram::GetPercentile(double percentile) const {
+  if (count_ == 0) {
+    return 0;
+  }
+  const uint64 rank = std::max<uint64>(
+      1, static_cast<uint64>(std::ceil(count_ * percentile / 100.0)));
+  uint64 accumulated = 0;
+  for (size_t i = 0; i < buckets_.size(); ++i) {
+    accumulated += buckets_[i];
+    if (accumulated >= rank) {
+      return std::min(GetBucketUpperBound(i), max_usec_);
+    }
+  }
+  return max_usec_;
+}
+
+void LatencyHistogram::CopyTo(
+    commands::LatencyStatistics::Histogram *histogram) const {
+  histogram->set_count(count_);
+  histogram->set_total_usec(total_usec_);
+  histogram->set_max_usec(max_usec_);
+  histogram->set_p50_usec(GetPercentile(50.0));
+  histogram->set_p90_usec(GetPercentile(90.0));
+  histogram->set_p99_usec(GetPercentile(99.0));
+  for (size_t i = 0; i < buckets_.size(); ++i) {
+    if (buckets_[i] == 0) {
+      continue;
+    }
+    commands::LatencyStatistics::Bucket *bucket = histogram->add_bucket();
+    bucket->set_upper_bound_usec(GetBucketUpperBound(i));
+    bucket->set_count(buckets_[i]);
+  }
+}
+
+LatencyStatistics::LatencyStatistics() {}
+
+LatencyStatistics::~LatencyStatistics() {}
+
+// static
+const char *LatencyStatistics::GetStageName(Stage stage) {
+  switch (stage) {
+    case PARSE:
+      return "parse";
+    case LOCK:
+      return "lock";
+    case EVAL:
+      return "eval";
+    case OBSERVER:
+      return "observer";
+    case SERIALIZE:
+      return "serialize";
+    case TOTAL:
+      return "total";
+    default:
+      LOG(DFATAL) << "Unknown stage: " << stage;
+      return "";
+  }
+}
+
+// static
+string LatencyStatistics::GetCommandName(const commands::Input &input) {
+  string name = commands::Input::CommandType_Name(input.type());
+  if (input.type() == commands::Input::SEND_COMMAND && input.has_command()) {
+    name.append("/");
+    name.append(
+        commands::SessionCommand::CommandType_Name(input.command().type()));
+  }
+  return name;
+}
+
+void LatencyStatistics::Record(const string &command, Stage stage,
+                               uint64 usec) {
+  scoped_lock l(&mutex_);
+  histograms_[std::make_pair(command, stage)].Record(usec);
+}
+
+void LatencyStatistics::GetStatistics(
+    commands::LatencyStatistics *statistics) const {
+  scoped_lock l(&mutex_);
+  statistics->Clear();
+  for (const auto &entry : histograms_) {
+    commands::LatencyStatistics::Histogram *histogram =
+        statistics->add_histogram();
+    histogram->set_command(entry.first.first);
+    histogram->set_stage(GetStageName(entry.first.second));
+    entry.second.CopyTo(histogram);
+  }
+}
+
+void LatencyStatistics::Clear() {
+  scoped_lock l(&mutex_);
+  histograms_.clear();
+}
+
+}  // namespace session
+}  // namespace mozc
@@ -0,0 +1,135 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Latency histograms of the commands evaluated by the server.
+
+#ifndef MOZC_SESSION_LATENCY_STATISTICS_H_
+#define MOZC_SESSION_LATENCY_STATISTICS_H_
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/mutex.h"
+#include "base/port.h"
+
+namespace mozc {
+namespace commands {
+class Input;
+class LatencyStatistics_Histogram;
+class LatencyStatistics;
+}  // namespace commands
+
+namespace session {
+
+// Log-linear (HDR-style) histogram of latencies in microseconds.  The values
+// less than 2^kSubBucketBits are counted exactly, and every larger power of
+// two is split into 2^kSubBucketBits buckets, so the relative error of a
+// percentile is less than 1 / 2^kSubBucketBits.  The buckets are allocated up
+// to the largest value recorded so far.
+class LatencyHistogram {
+ public:
+  static const int kSubBucketBits = 4;
+
+  LatencyHistogram();
+  ~LatencyHistogram();
+
+  void Record(uint64 usec);
+
+  uint64 count() const { return count_; }
+  uint64 total_usec() const { return total_usec_; }
+  uint64 max_usec() const { return max_usec_; }
+
+  // Returns the upper bound of the bucket containing the |percentile|%
+  // value, where |percentile| is in (0, 100].  Returns 0 if empty.
+  uint64 GetPercentile(double percentile) const;
+
+  void CopyTo(commands::LatencyStatistics_Histogram *histogram) const;
+
+  // Exposed for testing.
+  static size_t GetBucketIndex(uint64 usec);
+  static uint64 GetBucketUpperBound(size_t index);
+
+ private:
+  std::vector<uint64> buckets_;
+  uint64 count_;
+  uint64 total_usec_;
+  uint64 max_usec_;
+};
+
+// Thread-safe collection of the latency histograms keyed by the kind of the
+// command and the stage of its evaluation.
+class LatencyStatistics {
+ public:
+  enum Stage {
+    // Parsing the request received via IPC.
+    PARSE = 0,
+    // Waiting for the converter mutex, e.g., held by the speculative
+    // conversion.
+    LOCK,
+    // Evaluating the command, i.e., the composer, the converter, the
+    // predictors, the rewriters and building the output.
+    EVAL,
+    // Notifying the observers, e.g., updating the usage stats.
+    OBSERVER,
+    // Serializing the response sent via IPC.
+    SERIALIZE,
+    // The whole evaluation in SessionHandler, from LOCK to OBSERVER.
+    TOTAL,
+    NUM_STAGES,
+  };
+
+  LatencyStatistics();
+  ~LatencyStatistics();
+
+  static const char *GetStageName(Stage stage);
+
+  // Returns the name of the kind of |input|, e.g., "SEND_KEY" and
+  // "SEND_COMMAND/SUBMIT".
+  static string GetCommandName(const commands::Input &input);
+
+  void Record(const string &command, Stage stage, uint64 usec);
+
+  // Fills the histograms in the order of the command names and the stages.
+  void GetStatistics(commands::LatencyStatistics *statistics) const;
+
+  void Clear();
+
+ private:
+  mutable Mutex mutex_;
+  std::map<std::pair<string, Stage>, LatencyHistogram> histograms_;
+
+  DISALLOW_COPY_AND_ASSIGN(LatencyStatistics);
+};
+
+}  // namespace session
+}  // namespace mozc
+
+#endif  // MOZC_SESSION_LATENCY_STATISTICS_H_
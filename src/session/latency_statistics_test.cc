@@ -0,0 +1,121 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "session/latency_statistics.h"
+
+#include "protocol/commands.pb.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace session {
+namespace {
+
+TEST(LatencyHistogramTest, BucketIndex) {
+  // Small values are counted exactly.
+  for (uint64 usec = 0; usec < 32; ++usec) {
+    EXPECT_EQ(usec, LatencyHistogram::GetBucketIndex(usec));
+    EXPECT_EQ(usec, LatencyHistogram::GetBucketUpperBound(usec));
+  }
+  // 32 and 33 share a bucket.
+  EXPECT_EQ(LatencyHistogram::GetBucketIndex(32),
+            LatencyHistogram::GetBucketIndex(33));
+  EXPECT_EQ(33, LatencyHistogram::GetBucketUpperBound(
+      LatencyHistogram::GetBucketIndex(32)));
+
+  // Every value is in the bucket whose upper bound is within the relative
+  // error, and the indices are monotonic.
+  size_t prev_index = 0;
+  for (uint64 usec = 1; usec < (1ULL << 40); usec = usec * 3 / 2 + 1) {
+    const size_t index = LatencyHistogram::GetBucketIndex(usec);
+    const uint64 upper_bound = LatencyHistogram::GetBucketUpperBound(index);
+    EXPECT_LE(usec, upper_bound);
+    EXPECT_LE(upper_bound - usec,
+              usec >> LatencyHistogram::kSubBucketBits);
+    EXPECT_LT(LatencyHistogram::GetBucketUpperBound(index - 1), usec);
+    EXPECT_LE(prev_index, index);
+    prev_index = index;
+  }
+}
+
+TEST(LatencyHistogramTest, Percentile) {
+  LatencyHistogram histogram;
+  EXPECT_EQ(0, histogram.GetPercentile(99.0));
+
+  for (uint64 usec = 1; usec <= 100; ++usec) {
+    histogram.Record(usec * 1000);
+  }
+  EXPECT_EQ(100, histogram.count());
+  EXPECT_EQ(5050000, histogram.total_usec());
+  EXPECT_EQ(100000, histogram.max_usec());
+
+  const uint64 p50 = histogram.GetPercentile(50.0);
+  EXPECT_LE(50000, p50);
+  EXPECT_GE(50000 + (50000 >> LatencyHistogram::kSubBucketBits), p50);
+  const uint64 p99 = histogram.GetPercentile(99.0);
+  EXPECT_LE(99000, p99);
+  EXPECT_GE(100000, p99);
+  EXPECT_EQ(100000, histogram.GetPercentile(100.0));
+}
+
+TEST(LatencyStatisticsTest, GetStatistics) {
+  commands::Input send_key;
+  send_key.set_type(commands::Input::SEND_KEY);
+  commands::Input submit;
+  submit.set_type(commands::Input::SEND_COMMAND);
+  submit.mutable_command()->set_type(commands::SessionCommand::SUBMIT);
+  EXPECT_EQ("SEND_KEY", LatencyStatistics::GetCommandName(send_key));
+  EXPECT_EQ("SEND_COMMAND/SUBMIT", LatencyStatistics::GetCommandName(submit));
+
+  LatencyStatistics statistics;
+  statistics.Record("SEND_KEY", LatencyStatistics::EVAL, 100);
+  statistics.Record("SEND_KEY", LatencyStatistics::EVAL, 300);
+  statistics.Record("SEND_KEY", LatencyStatistics::TOTAL, 400);
+  statistics.Record("SEND_COMMAND/SUBMIT", LatencyStatistics::EVAL, 10);
+
+  commands::LatencyStatistics output;
+  statistics.GetStatistics(&output);
+  ASSERT_EQ(3, output.histogram_size());
+  EXPECT_EQ("SEND_COMMAND/SUBMIT", output.histogram(0).command());
+  EXPECT_EQ("eval", output.histogram(0).stage());
+  EXPECT_EQ("SEND_KEY", output.histogram(1).command());
+  EXPECT_EQ("eval", output.histogram(1).stage());
+  EXPECT_EQ(2, output.histogram(1).count());
+  EXPECT_EQ(400, output.histogram(1).total_usec());
+  EXPECT_EQ(300, output.histogram(1).max_usec());
+  EXPECT_EQ(2, output.histogram(1).bucket_size());
+  EXPECT_EQ("total", output.histogram(2).stage());
+
+  statistics.Clear();
+  statistics.GetStatistics(&output);
+  EXPECT_EQ(0, output.histogram_size());
+}
+
+}  // namespace
+}  // namespace session
+}  // namespace mozc
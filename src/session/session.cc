@@ -35,10 +35,12 @@
 #include <string>
 #include <vector>
 
+#include "base/allocation_stats.h"
 #include "base/clock.h"
 #include "base/logging.h"
 #include "base/port.h"
 #include "base/singleton.h"
+#include "base/trace_events.h"
 #include "base/url.h"
 #include "base/util.h"
 #include "base/version.h"
@@ -50,6 +52,7 @@
 #include "engine/user_data_manager_interface.h"
 #include "protocol/commands.pb.h"
 #include "protocol/config.pb.h"
+#include "protocol/state.pb.h"
 #include "session/internal/ime_context.h"
 #include "session/internal/key_event_transformer.h"
 #include "session/internal/keymap.h"
@@ -240,8 +243,17 @@ void Session::InitContext(ImeContext *context) const {
 void Session::PushUndoContext() {
   // TODO(komatsu): Support multiple undo.
   prev_context_.reset(new ImeContext);
-  InitContext(prev_context_.get());
+  // CopyContext() replaces the converter and copies the other members, so
+  // only the composer is needed here instead of InitContext().
+  prev_context_->set_composer(new composer::Composer(
+      NULL, &context_->GetRequest(), &context_->GetConfig()));
+  // The commands pushing the undo context overwrite the output of |context_|
+  // when they finish, so the output is moved to the undo context instead of
+  // being copied.
+  commands::Output output;
+  output.Swap(context_->mutable_output());
   ImeContext::CopyContext(*context_, prev_context_.get());
+  prev_context_->mutable_output()->Swap(&output);
 }
 
 void Session::PopUndoContext() {
@@ -373,6 +385,7 @@ bool Session::SendCommand(commands::Command *command) {
       break;
   }
 
+  MaybeOmitUnchangedAllCandidateWords(command->mutable_output());
   return result;
 }
 
@@ -475,6 +488,7 @@ bool Session::TestSendKey(commands::Command *command) {
 }
 
 bool Session::SendKey(commands::Command *command) {
+  MOZC_TRACE_SCOPE("Session::SendKey");
   UpdateTime();
   UpdatePreferences(command);
   TransformInput(command->mutable_input());
@@ -508,6 +522,7 @@ bool Session::SendKey(commands::Command *command) {
   }
 
   SessionUsageStatsUtil::AddSendKeyOutputStats(command->output());
+  MaybeOmitUnchangedAllCandidateWords(command->mutable_output());
 
   return result;
 }
@@ -951,6 +966,8 @@ void Session::UpdatePreferences(commands::Command *command) {
   if (command->input().has_capability()) {
     context_->mutable_client_capability()->CopyFrom(
         command->input().capability());
+    context_->mutable_converter()->set_fill_all_candidate_words(
+        !command->input().capability().omit_all_candidate_words());
   }
 
   // Update config values modified temporarily.
@@ -1379,6 +1396,40 @@ bool Session::MaybeSelectCandidate(commands::Command *command) {
 
 void Session::set_client_capability(const commands::Capability &capability) {
   context_->mutable_client_capability()->CopyFrom(capability);
+  context_->mutable_converter()->set_fill_all_candidate_words(
+      !capability.omit_all_candidate_words());
+  last_all_candidate_words_.clear();
+}
+
+void Session::MaybeOmitUnchangedAllCandidateWords(commands::Output *output) {
+  if (!context_->client_capability().omit_unchanged_all_candidate_words()) {
+    return;
+  }
+  if (!output->has_all_candidate_words()) {
+    // The client discards its list.
+    last_all_candidate_words_.clear();
+    return;
+  }
+
+  // Moving the focus changes only focused_index.  Compare the rest.
+  commands::CandidateList *all_candidate_words =
+      output->mutable_all_candidate_words();
+  const bool has_focused_index = all_candidate_words->has_focused_index();
+  const uint32 focused_index = all_candidate_words->focused_index();
+  all_candidate_words->clear_focused_index();
+  string serialized;
+  all_candidate_words->SerializeToString(&serialized);
+  if (has_focused_index) {
+    all_candidate_words->set_focused_index(focused_index);
+  }
+
+  if (!last_all_candidate_words_.empty() &&
+      serialized == last_all_candidate_words_) {
+    all_candidate_words->clear_candidates();
+    output->set_all_candidate_words_unchanged(true);
+    return;
+  }
+  last_all_candidate_words_.swap(serialized);
 }
 
 void Session::set_application_info(const commands::ApplicationInfo
@@ -1398,6 +1449,70 @@ uint64 Session::last_command_time() const {
   return context_->last_command_time();
 }
 
+string Session::GetSegmentsDebugString() const {
+  return context_->converter().GetSegmentsDebugString();
+}
+
+bool Session::Hibernate(string *state) const {
+  DCHECK(state);
+  if (context_->state() != ImeContext::PRECOMPOSITION &&
+      context_->state() != ImeContext::DIRECT) {
+    return false;
+  }
+  if (!context_->composer().Empty() || context_->converter().IsActive()) {
+    return false;
+  }
+
+  protocol::HibernatedSession hibernated;
+  hibernated.set_create_time(context_->create_time());
+  hibernated.set_last_command_time(context_->last_command_time());
+  hibernated.set_direct_mode(context_->state() == ImeContext::DIRECT);
+  hibernated.set_input_mode(context_->composer().GetInputMode());
+  hibernated.set_comeback_input_mode(
+      context_->composer().GetComebackInputMode());
+  hibernated.mutable_capability()->CopyFrom(context_->client_capability());
+  hibernated.mutable_application_info()->CopyFrom(
+      context_->application_info());
+  return hibernated.SerializeToString(state);
+}
+
+bool Session::Rehydrate(const string &state) {
+  protocol::HibernatedSession hibernated;
+  if (!hibernated.ParseFromString(state)) {
+    LOG(ERROR) << "Broken hibernated session";
+    return false;
+  }
+  context_->set_create_time(hibernated.create_time());
+  context_->set_last_command_time(hibernated.last_command_time());
+  context_->set_state(hibernated.direct_mode() ? ImeContext::DIRECT
+                                               : ImeContext::PRECOMPOSITION);
+  composer::Composer *composer = context_->mutable_composer();
+  composer->SetInputMode(static_cast<transliteration::TransliterationType>(
+      hibernated.comeback_input_mode()));
+  if (hibernated.input_mode() != hibernated.comeback_input_mode()) {
+    composer->SetTemporaryInputMode(
+        static_cast<transliteration::TransliterationType>(
+            hibernated.input_mode()));
+  }
+  set_client_capability(hibernated.capability());
+  set_application_info(hibernated.application_info());
+  return true;
+}
+
+size_t Session::GetEstimatedHeapBytes() const {
+  // Counts the objects owned by the contexts and the last outputs, which
+  // hold the candidates sent to the client.  The segments inside of the
+  // converters are not counted, so this is a lower bound.
+  size_t size = sizeof(*this) + last_all_candidate_words_.capacity();
+  for (const ImeContext *context : {context_.get(), prev_context_.get()}) {
+    if (context != NULL) {
+      size += sizeof(ImeContext) + sizeof(composer::Composer) +
+              sizeof(SessionConverter) + context->output().SpaceUsed();
+    }
+  }
+  return size;
+}
+
 bool Session::InsertCharacter(commands::Command *command) {
   if (!command->input().has_key()) {
     LOG(ERROR) << "No key event: " << command->input().DebugString();
@@ -2636,6 +2751,7 @@ void Session::OutputFromState(commands::Command *command) {
 }
 
 void Session::Output(commands::Command *command) {
+  ScopedAllocationStage allocation_stage(AllocationStats::OUTPUT);
   OutputMode(command);
   context_->mutable_converter()->PopOutput(
       context_->composer(), command->mutable_output());
@@ -2661,6 +2777,7 @@ void Session::OutputMode(commands::Command *command) const {
 }
 
 void Session::OutputComposition(commands::Command *command) const {
+  ScopedAllocationStage allocation_stage(AllocationStats::OUTPUT);
   OutputMode(command);
   commands::Preedit *preedit = command->mutable_output()->mutable_preedit();
   SessionOutput::FillPreedit(context_->composer(), preedit);
@@ -47,6 +47,7 @@
         '../converter/converter_base.gyp:converter_util',
         '../protocol/protocol.gyp:commands_proto',
         '../protocol/protocol.gyp:config_proto',
+        '../protocol/protocol.gyp:state_proto',
         '../request/request.gyp:conversion_request',
         '../transliteration/transliteration.gyp:transliteration',
         '../usage_stats/usage_stats_base.gyp:usage_stats',
@@ -90,6 +91,8 @@
       'target_name': 'session_handler',
       'type': 'static_library',
       'sources': [
+        'idle_task_runner.cc',
+        'latency_statistics.cc',
         'session_handler.cc',
         'session_observer_handler.cc',
       ],
@@ -171,6 +174,25 @@
         'session_server',
       ],
     },
+    {
+      'target_name': 'session_replay_benchmark',
+      'type': 'executable',
+      'sources': [
+        'session_replay_benchmark.cc',
+      ],
+      'dependencies': [
+        '../base/base.gyp:allocation_hook',
+        '../base/base.gyp:base',
+        '../composer/composer.gyp:key_parser',
+        '../config/config.gyp:config_handler',
+        '../data_manager/data_manager_base.gyp:data_manager',
+        '../engine/engine.gyp:engine',
+        '../protocol/protocol.gyp:commands_proto',
+        '../protocol/protocol.gyp:config_proto',
+        'session_base.gyp:request_test_util',
+        'session_handler',
+      ],
+    },
     {
       'target_name': 'gen_session_stress_test_data',
       'type': 'none',
@@ -260,6 +260,12 @@ class Session : public SessionInterface {
   // return 0 (default value) if no command is executed in this session.
   virtual uint64 last_command_time() const;
 
+  virtual string GetSegmentsDebugString() const;
+
+  virtual bool Hibernate(string *state) const;
+  virtual bool Rehydrate(const string &state);
+  virtual size_t GetEstimatedHeapBytes() const;
+
   // TODO(komatsu): delete this funciton.
   // For unittest only
   mozc::composer::Composer *get_internal_composer_only_for_unittest();
@@ -280,8 +286,16 @@ class Session : public SessionInterface {
   std::unique_ptr<ImeContext> context_;
   std::unique_ptr<ImeContext> prev_context_;
 
+  // Serialized all_candidate_words last sent to the client without its
+  // focused_index.  Empty if the client doesn't keep it.
+  string last_all_candidate_words_;
+
   void InitContext(ImeContext *context) const;
 
+  // Omit the candidates of all_candidate_words in |output| if the client
+  // accepts it and they are the same as the ones sent last time.
+  void MaybeOmitUnchangedAllCandidateWords(mozc::commands::Output *output);
+
   void PushUndoContext();
   void PopUndoContext();
   void ClearUndoContext();
@@ -32,18 +32,28 @@
 #include "session/session_converter.h"
 
 #include <algorithm>
+#include <atomic>
+#include <deque>
 #include <limits>
+#include <memory>
 #include <string>
+#include <vector>
 
+#include "base/allocation_stats.h"
+#include "base/clock.h"
 #include "base/flags.h"
 #include "base/logging.h"
+#include "base/mutex.h"
 #include "base/port.h"
 #include "base/text_normalizer.h"
+#include "base/thread_pool.h"
 #include "base/util.h"
 #include "composer/composer.h"
+#include "composer/type_corrected_query.h"
 #include "config/config_handler.h"
 #include "converter/converter_interface.h"
 #include "converter/converter_util.h"
+#include "converter/converter_workspace.h"
 #include "converter/segments.h"
 #include "protocol/commands.pb.h"
 #include "protocol/config.pb.h"
@@ -67,6 +77,21 @@ DEFINE_bool(use_actual_converter_for_realtime_conversion,
             "If true, use the actual (non-immutable) converter for real "
             "time conversion.");
 
+DEFINE_bool(speculative_conversion, false,
+            "If true, convert the composition on a background thread after "
+            "suggestion so that the next conversion can reuse the result.");
+DEFINE_int32(speculative_conversion_delay_msec, 200,
+             "Idle time in milliseconds after suggestion before starting "
+             "the speculative conversion.");
+DEFINE_int32(suggestion_deadline_msec, 0,
+             "Deadline in milliseconds of a suggestion request.  When it "
+             "passes, the converter returns the candidates found so far.  "
+             "0 disables the deadline.");
+DEFINE_int32(suggestion_cache_size, 0,
+             "The number of the recent suggestion results kept per session "
+             "to reuse when the same composition is suggested again, e.g., "
+             "after a backspace.  0 disables the cache.");
+
 namespace mozc {
 namespace session {
 
@@ -102,8 +127,118 @@ const char *GetCandidateShortcuts(
   return shortcut;
 }
 
+// Returns the string identifying the inputs of a conversion.  The result of
+// a speculative conversion is reusable only when this key is unchanged.
+string GetSpeculativeConversionKey(const composer::Composer &composer,
+                                   const ConversionPreferences &preferences,
+                                   const Segments &segments) {
+  string key;
+  composer.GetQueryForConversion(&key);
+  key.append(Util::StringPrintf("\t%d\t%d", preferences.use_history,
+                                preferences.max_history_size));
+  for (size_t i = 0; i < segments.history_segments_size(); ++i) {
+    const Segment &segment = segments.history_segment(i);
+    key.append("\t").append(segment.key());
+    if (segment.candidates_size() > 0) {
+      key.append("\t").append(segment.candidate(0).value);
+    }
+  }
+  return key;
+}
+
+// Returns the string identifying the inputs of a suggestion, which are more
+// than those of a conversion as the suggestion also depends on the pending
+// input and the cursor.
+string GetSuggestionCacheKey(const composer::Composer &composer,
+                             const ConversionPreferences &preferences,
+                             const Segments &segments) {
+  string key;
+  composer.GetRawString(&key);
+  string text;
+  composer.GetStringForPreedit(&text);
+  key.append("\t").append(text);
+  composer.GetQueryForPrediction(&text);
+  key.append("\t").append(text);
+  key.append("\t").append(composer.source_text());
+  key.append(Util::StringPrintf(
+      "\t%d\t%d\t%d\t%d\t%d\t%d",
+      static_cast<int>(composer.GetCursor()),
+      static_cast<int>(composer.GetLength()),
+      static_cast<int>(composer.GetInputMode()),
+      static_cast<int>(composer.GetInputFieldType()),
+      preferences.use_history, preferences.max_history_size));
+  std::vector<composer::TypeCorrectedQuery> queries;
+  composer.GetTypeCorrectedQueriesForPrediction(&queries);
+  for (size_t i = 0; i < queries.size(); ++i) {
+    key.append("\t").append(queries[i].base);
+    for (const string &expanded : queries[i].expanded) {
+      key.append(" ").append(expanded);
+    }
+    key.append(Util::StringPrintf(" %d", queries[i].cost));
+  }
+  for (size_t i = 0; i < segments.history_segments_size(); ++i) {
+    const Segment &segment = segments.history_segment(i);
+    key.append("\t").append(segment.key());
+    if (segment.candidates_size() > 0) {
+      const Segment::Candidate &candidate = segment.candidate(0);
+      key.append("\t").append(candidate.value);
+      key.append(Util::StringPrintf(" %d %d", candidate.lid, candidate.rid));
+    }
+  }
+  return key;
+}
+
+// The cached suggestions older than this are not reused, as some rewriters
+// depend on the time.
+const uint64 kSuggestionCacheLifetimeSec = 10;
+
+// Incremented by SessionConverter::InvalidateSuggestionCaches().  The cache
+// entries of older generations are ignored.
+std::atomic<uint64> g_suggestion_cache_generation(0);
+
+ThreadPool *GetSpeculativeConversionThreadPool() {
+  // Intentionally leaked so that the worker outlives all the sessions.
+  static ThreadPool *pool = new ThreadPool(1);
+  return pool;
+}
+
+// Guards |g_running_conversion_canceled|.
+Mutex *GetRunningConversionMutex() {
+  static Mutex *mutex = new Mutex;
+  return mutex;
+}
+
+// The cancel flag of the speculative conversion running on the worker, or
+// NULL if the worker is idle.
+std::atomic<bool> *g_running_conversion_canceled = NULL;
+
 }  // namespace
 
+struct SessionConverter::SpeculativeConversion {
+  SpeculativeConversion() : composer(NULL, NULL, NULL) {}
+
+  // Set by the session thread to abandon the conversion.
+  std::atomic<bool> canceled{false};
+
+  // The members below are guarded by GetConverterMutex().
+  bool done = false;
+  bool succeeded = false;
+  string key;
+  composer::Composer composer;
+  Segments segments;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(SpeculativeConversion);
+};
+
+struct SessionConverter::SuggestionCacheEntry {
+  string key;
+  uint64 generation;
+  uint64 time;
+  Segments::RequestType request_type;
+  Segment segment;
+};
+
 const size_t SessionConverter::kConsumedAllCharacters =
     std::numeric_limits<size_t>::max();
 
@@ -114,6 +249,7 @@ SessionConverter::SessionConverter(const ConverterInterface *converter,
       state_(COMPOSITION),
       converter_(converter),
       segments_(new Segments),
+      workspace_(new ConverterWorkspace),
       segment_index_(0),
       result_(new commands::Result),
       candidate_list_(new CandidateList(true)),
@@ -127,7 +263,31 @@ SessionConverter::SessionConverter(const ConverterInterface *converter,
   SetConfig(config);
 }
 
-SessionConverter::~SessionConverter() {}
+SessionConverter::~SessionConverter() {
+  // Waits for the running speculative conversion, which refers to
+  // |converter_|, |request_| and |config_|.
+  scoped_lock l(GetConverterMutex());
+  CancelSpeculativeConversion();
+}
+
+// static
+Mutex *SessionConverter::GetConverterMutex() {
+  static Mutex *mutex = new Mutex;
+  return mutex;
+}
+
+// static
+void SessionConverter::PreemptSpeculativeConversion() {
+  scoped_lock l(GetRunningConversionMutex());
+  if (g_running_conversion_canceled != NULL) {
+    g_running_conversion_canceled->store(true);
+  }
+}
+
+// static
+void SessionConverter::InvalidateSuggestionCaches() {
+  ++g_suggestion_cache_generation;
+}
 
 bool SessionConverter::CheckState(
     SessionConverterInterface::States states) const {
@@ -154,12 +314,15 @@ bool SessionConverter::ConvertWithPreferences(
   segments_->set_request_type(Segments::CONVERSION);
   SetConversionPreferences(preferences, segments_.get());
 
-  const ConversionRequest conversion_request(&composer, request_, config_);
-  if (!converter_->StartConversionForRequest(conversion_request,
-                                             segments_.get())) {
-    LOG(WARNING) << "StartConversionForRequest() failed";
-    ResetState();
-    return false;
+  if (!TakeSpeculativeConversion(composer, preferences)) {
+    ConversionRequest conversion_request(&composer, request_, config_);
+    conversion_request.set_workspace(workspace_.get());
+    if (!converter_->StartConversionForRequest(conversion_request,
+                                               segments_.get())) {
+      LOG(WARNING) << "StartConversionForRequest() failed";
+      ResetState();
+      return false;
+    }
   }
 
   segment_index_ = 0;
@@ -342,7 +505,8 @@ bool SessionConverter::SwitchKanaType(const composer::Composer &composer) {
     if (segments_->conversion_segments_size() != 1) {
       string composition;
       GetPreedit(0, segments_->conversion_segments_size(), &composition);
-      const ConversionRequest conversion_request(&composer, request_, config_);
+      ConversionRequest conversion_request(&composer, request_, config_);
+      conversion_request.set_workspace(workspace_.get());
       converter_->ResizeSegment(segments_.get(),
                                 conversion_request,
                                 0, Util::CharsLen(composition));
@@ -422,13 +586,30 @@ bool SessionConverter::SuggestWithPreferences(
     return false;
   }
 
+  MaybeStartSpeculativeConversion(composer, preferences);
+
   // Initialize the segments for suggestion.
   SetConversionPreferences(preferences, segments_.get());
 
+  const uint64 cache_generation = g_suggestion_cache_generation.load();
+  string cache_key;
+  if (FLAGS_suggestion_cache_size > 0) {
+    cache_key = GetSuggestionCacheKey(composer, preferences, *segments_);
+  }
+  const bool cache_hit =
+      !cache_key.empty() && TakeSuggestionCache(cache_key, cache_generation);
+
   ConversionRequest conversion_request(&composer, request_, config_);
+  conversion_request.set_workspace(workspace_.get());
+  if (FLAGS_suggestion_deadline_msec > 0) {
+    conversion_request.SetTimeout(
+        static_cast<uint32>(FLAGS_suggestion_deadline_msec));
+  }
   const size_t cursor = composer.GetCursor();
-  if (cursor == composer.GetLength() || cursor == 0 ||
-      !request_->mixed_conversion()) {
+  if (cache_hit) {
+    // |segments_| has the cached result.
+  } else if (cursor == composer.GetLength() || cursor == 0 ||
+             !request_->mixed_conversion()) {
     conversion_request.set_create_partial_candidates(
         request_->auto_partial_suggestion());
     conversion_request.set_use_actual_converter_for_realtime_conversion(
@@ -460,6 +641,10 @@ bool SessionConverter::SuggestWithPreferences(
     }
   }
   DCHECK_EQ(1, segments_->conversion_segments_size());
+  // The result cut off by the deadline is not worth reusing.
+  if (!cache_hit && !cache_key.empty() && !conversion_request.IsCanceled()) {
+    InsertSuggestionCache(cache_key, cache_generation);
+  }
 
   // Copy current suggestions so that we can merge
   // prediction/suggestions later
@@ -510,6 +695,7 @@ bool SessionConverter::PredictWithPreferences(
 
   if (predict_expand || predict_first) {
     ConversionRequest conversion_request(&composer, request_, config_);
+    conversion_request.set_workspace(workspace_.get());
     conversion_request.set_use_actual_converter_for_realtime_conversion(
         FLAGS_use_actual_converter_for_realtime_conversion);
     if (!converter_->StartPredictionForRequest(conversion_request,
@@ -576,6 +762,7 @@ bool SessionConverter::ExpandSuggestionWithPreferences(
   // existing segments.
 
   ConversionRequest conversion_request(&composer, request_, config_);
+  conversion_request.set_workspace(workspace_.get());
 
   const size_t cursor = composer.GetCursor();
   if (cursor == composer.GetLength() || cursor == 0 ||
@@ -658,6 +845,9 @@ void SessionConverter::Reset() {
   // Even if composition mode, call ResetConversion
   // in order to clear history segments.
   converter_->ResetConversion(segments_.get());
+  // The session is going to be idle, e.g., on focus out.  Releases the
+  // buffers kept warm for the conversions of the next keystrokes.
+  workspace_->Clear();
 
   if (CheckState(COMPOSITION)) {
     return;
@@ -687,6 +877,7 @@ void SessionConverter::Commit(const composer::Composer &composer,
   CommitUsageStats(state_, context);
   ConversionRequest conversion_request(&composer, request_, config_);
   converter_->FinishConversion(conversion_request, segments_.get());
+  InvalidateSuggestionCaches();
   ResetState();
 }
 
@@ -736,6 +927,7 @@ bool SessionConverter::CommitSuggestionInternal(
     CommitUsageStats(SessionConverterInterface::SUGGESTION, context);
     ConversionRequest conversion_request(&composer, request_, config_);
     converter_->FinishConversion(conversion_request, segments_.get());
+    InvalidateSuggestionCaches();
     DCHECK_EQ(0, segments_->conversion_segments_size());
     ResetState();
   }
@@ -831,6 +1023,7 @@ void SessionConverter::CommitSegmentsInternal(
     candidate_ids.push_back(GetCandidateIndexForConverter(i));
   }
   converter_->CommitSegments(segments_.get(), candidate_ids);
+  InvalidateSuggestionCaches();
 
   // Commit the [0, segments_to_commit - 1] conversion segment.
   CommitUsageStatsWithSegmentsSize(state_, context, segments_to_commit);
@@ -857,6 +1050,7 @@ void SessionConverter::CommitPreedit(const composer::Composer &composer,
   CommitUsageStats(SessionConverterInterface::COMPOSITION, context);
   ConversionRequest conversion_request(&composer, request_, config_);
   converter_->FinishConversion(conversion_request, segments_.get());
+  InvalidateSuggestionCaches();
   ResetState();
 }
 
@@ -878,6 +1072,7 @@ void SessionConverter::CommitHead(
 
 void SessionConverter::Revert() {
   converter_->RevertConversion(segments_.get());
+  InvalidateSuggestionCaches();
 }
 
 void SessionConverter::SegmentFocusInternal(size_t index) {
@@ -935,7 +1130,8 @@ void SessionConverter::ResizeSegmentWidth(const composer::Composer &composer,
   }
   ResetResult();
 
-  const ConversionRequest conversion_request(&composer, request_, config_);
+  ConversionRequest conversion_request(&composer, request_, config_);
+  conversion_request.set_workspace(workspace_.get());
   if (!converter_->ResizeSegment(segments_.get(),
                                  conversion_request,
                                  segment_index_, delta)) {
@@ -1115,6 +1311,7 @@ void MaybeFillConfig(Segment::Candidate::Command command,
 
 void SessionConverter::FillOutput(
     const composer::Composer &composer, commands::Output *output) const {
+  ScopedAllocationStage allocation_stage(AllocationStats::OUTPUT);
   if (output == NULL) {
     LOG(ERROR) << "output is NULL.";
     return;
@@ -1154,7 +1351,8 @@ void SessionConverter::FillOutput(
   }
 
   // All candidate words
-  if (CheckState(SUGGESTION | PREDICTION | CONVERSION)) {
+  if (CheckState(SUGGESTION | PREDICTION | CONVERSION) &&
+      fill_all_candidate_words_) {
     FillAllCandidateWords(output->mutable_all_candidate_words());
   }
 }
@@ -1167,6 +1365,10 @@ void SessionConverter::SetConversionPreferences(
   segments->set_max_history_segments_size(preferences.max_history_size);
 }
 
+string SessionConverter::GetSegmentsDebugString() const {
+  return segments_->DebugString();
+}
+
 SessionConverter* SessionConverter::Clone() const {
   SessionConverter *session_converter =
       new SessionConverter(converter_, request_, config_);
@@ -1187,6 +1389,7 @@ SessionConverter* SessionConverter::Clone() const {
   session_converter->request_ = request_;
   session_converter->config_ = config_;
   session_converter->use_cascading_window_ = use_cascading_window_;
+  session_converter->fill_all_candidate_words_ = fill_all_candidate_words_;
   session_converter->selected_candidate_indices_ = selected_candidate_indices_;
 
   if (session_converter->CheckState(SUGGESTION | PREDICTION | CONVERSION)) {
@@ -1204,6 +1407,7 @@ void SessionConverter::ResetResult() {
 }
 
 void SessionConverter::ResetState() {
+  CancelSpeculativeConversion();
   state_ = COMPOSITION;
   segment_index_ = 0;
   previous_suggestions_.clear();
@@ -1212,11 +1416,158 @@ void SessionConverter::ResetState() {
   selected_candidate_indices_.clear();
 }
 
+void SessionConverter::MaybeStartSpeculativeConversion(
+    const composer::Composer &composer,
+    const ConversionPreferences &preferences) {
+  CancelSpeculativeConversion();
+  if (!FLAGS_speculative_conversion || composer.Empty()) {
+    return;
+  }
+
+  std::shared_ptr<SpeculativeConversion> speculative_conversion(
+      new SpeculativeConversion);
+  speculative_conversion->key =
+      GetSpeculativeConversionKey(composer, preferences, *segments_);
+  speculative_conversion->composer.CopyFrom(composer);
+  // The conversion replaces the conversion segments, so only the history
+  // is worth copying.
+  speculative_conversion->segments.CopyFromWithoutConversionCandidates(
+      *segments_);
+  speculative_conversion->segments.set_request_type(Segments::CONVERSION);
+  SetConversionPreferences(preferences, &speculative_conversion->segments);
+  speculative_conversion_ = speculative_conversion;
+
+  const ConverterInterface *converter = converter_;
+  const commands::Request *request = request_;
+  const config::Config *config = config_;
+  const uint32 delay_msec =
+      static_cast<uint32>(std::max(0, FLAGS_speculative_conversion_delay_msec));
+  GetSpeculativeConversionThreadPool()->Schedule(
+      [speculative_conversion, converter, request, config, delay_msec]() {
+        // Sleeps in short steps so that a canceled conversion doesn't keep
+        // the worker busy.
+        const uint32 kSleepStepMsec = 10;
+        for (uint32 slept = 0;
+             slept < delay_msec && !speculative_conversion->canceled;
+             slept += kSleepStepMsec) {
+          Util::Sleep(std::min(kSleepStepMsec, delay_msec - slept));
+        }
+        scoped_lock l(GetConverterMutex());
+        if (speculative_conversion->canceled) {
+          return;
+        }
+        {
+          scoped_lock running_lock(GetRunningConversionMutex());
+          g_running_conversion_canceled = &speculative_conversion->canceled;
+        }
+        ConversionRequest conversion_request(
+            &speculative_conversion->composer, request, config);
+        conversion_request.set_cancel_flag(&speculative_conversion->canceled);
+        const bool succeeded = converter->StartConversionForRequest(
+            conversion_request, &speculative_conversion->segments);
+        {
+          scoped_lock running_lock(GetRunningConversionMutex());
+          g_running_conversion_canceled = NULL;
+        }
+        // A conversion canceled halfway has partial candidates only.
+        speculative_conversion->succeeded =
+            succeeded && !speculative_conversion->canceled;
+        speculative_conversion->done = true;
+      });
+}
+
+bool SessionConverter::TakeSpeculativeConversion(
+    const composer::Composer &composer,
+    const ConversionPreferences &preferences) {
+  if (!speculative_conversion_) {
+    return false;
+  }
+  scoped_lock l(GetConverterMutex());
+  std::shared_ptr<SpeculativeConversion> speculative_conversion;
+  speculative_conversion.swap(speculative_conversion_);
+  speculative_conversion->canceled = true;
+  if (!speculative_conversion->done || !speculative_conversion->succeeded ||
+      speculative_conversion->key !=
+          GetSpeculativeConversionKey(composer, preferences, *segments_)) {
+    return false;
+  }
+  // The worker is done with the segments, and nobody else refers to them.
+  segments_->Swap(&speculative_conversion->segments);
+  return true;
+}
+
+void SessionConverter::CancelSpeculativeConversion() {
+  if (speculative_conversion_) {
+    speculative_conversion_->canceled = true;
+    speculative_conversion_.reset();
+  }
+}
+
+bool SessionConverter::HasFinishedSpeculativeConversion() const {
+  scoped_lock l(GetConverterMutex());
+  return speculative_conversion_ && speculative_conversion_->done;
+}
+
+bool SessionConverter::TakeSuggestionCache(const string &key,
+                                           uint64 generation) {
+  const uint64 now = Clock::GetTime();
+  for (auto it = suggestion_cache_.begin(); it != suggestion_cache_.end();
+       ++it) {
+    SuggestionCacheEntry *entry = it->get();
+    if (entry->key != key) {
+      continue;
+    }
+    if (entry->generation != generation ||
+        now >= entry->time + kSuggestionCacheLifetimeSec) {
+      suggestion_cache_.erase(it);
+      return false;
+    }
+    segments_->set_request_type(entry->request_type);
+    segments_->clear_conversion_segments();
+    segments_->add_segment()->CopyFrom(entry->segment);
+    // Moves the entry to the front.
+    std::unique_ptr<SuggestionCacheEntry> taken(std::move(*it));
+    suggestion_cache_.erase(it);
+    suggestion_cache_.push_front(std::move(taken));
+    return true;
+  }
+  return false;
+}
+
+void SessionConverter::InsertSuggestionCache(const string &key,
+                                             uint64 generation) {
+  DCHECK_EQ(1, segments_->conversion_segments_size());
+  std::unique_ptr<SuggestionCacheEntry> entry;
+  while (suggestion_cache_.size() >=
+         static_cast<size_t>(FLAGS_suggestion_cache_size)) {
+    // Reuses the oldest entry and its candidates.
+    entry = std::move(suggestion_cache_.back());
+    suggestion_cache_.pop_back();
+  }
+  if (!entry) {
+    entry.reset(new SuggestionCacheEntry);
+  }
+  entry->key = key;
+  entry->generation = generation;
+  entry->time = Clock::GetTime();
+  entry->request_type = segments_->request_type();
+  entry->segment.CopyFrom(segments_->conversion_segment(0));
+  suggestion_cache_.push_front(std::move(entry));
+}
+
 void SessionConverter::SegmentFocus() {
   DCHECK(CheckState(SUGGESTION | PREDICTION | CONVERSION));
+  const size_t candidates_size =
+      segments_->conversion_segment(segment_index_).candidates_size();
   converter_->FocusSegmentValue(segments_.get(),
                                 segment_index_,
                                 GetCandidateIndexForConverter(segment_index_));
+  // Rewriters may append candidates deferred until the focus reaches them,
+  // e.g. SingleKanjiRewriter.
+  if (segments_->conversion_segment(segment_index_).candidates_size() >
+      candidates_size) {
+    AppendCandidateList();
+  }
 }
 
 void SessionConverter::SegmentFix() {
@@ -1579,11 +1930,15 @@ void SessionConverter::FillAllCandidateWords(
 }
 
 void SessionConverter::SetRequest(const commands::Request *request) {
+  CancelSpeculativeConversion();
+  suggestion_cache_.clear();
   request_ = request;
   candidate_list_->set_page_size(request->candidate_page_size());
 }
 
 void SessionConverter::SetConfig(const config::Config *config) {
+  CancelSpeculativeConversion();
+  suggestion_cache_.clear();
   config_ = config;
   updated_command_ = Segment::Candidate::DEFAULT_COMMAND;
   selection_shortcut_ =  config->selection_shortcut();
@@ -32,6 +32,7 @@
 #ifndef MOZC_SESSION_SESSION_CONVERTER_H_
 #define MOZC_SESSION_SESSION_CONVERTER_H_
 
+#include <deque>
 #include <memory>
 #include <string>
 #include <vector>
@@ -40,6 +41,9 @@
 #include "session/session_converter_interface.h"
 
 namespace mozc {
+class ConverterWorkspace;
+class Mutex;
+
 namespace commands {
 class CandidateList;
 class Candidates;
@@ -66,6 +70,22 @@ class SessionConverter : public SessionConverterInterface {
                    const config::Config *config);
   virtual ~SessionConverter();
 
+  // Returns the mutex serializing the accesses to the converter.  The session
+  // handler holds it while evaluating a command, and the speculative
+  // conversion started by Suggest holds it while converting.
+  static Mutex *GetConverterMutex();
+
+  // Cancels the speculative conversion running on the background thread, if
+  // any, so that the caller doesn't wait for a result that the next command
+  // will probably make stale.  Callable without GetConverterMutex().
+  static void PreemptSpeculativeConversion();
+
+  // Makes the suggestion caches of all the sessions drop their results.
+  // Call this when the results may change for the same input, e.g., when the
+  // user history or the dictionaries are changed.  Callable without
+  // GetConverterMutex().
+  static void InvalidateSuggestionCaches();
+
   // Checks if the current state is in the state bitmap.
   virtual bool CheckState(States) const;
 
@@ -258,6 +278,8 @@ class SessionConverter : public SessionConverterInterface {
   // Currently, converter_ is not copied.
   virtual SessionConverter *Clone() const;
 
+  virtual string GetSegmentsDebugString() const;
+
   // Fills protocol buffers with all flatten candidate words.
   void FillAllCandidateWords(commands::CandidateList *candidates) const;
 
@@ -270,6 +292,10 @@ class SessionConverter : public SessionConverterInterface {
     use_cascading_window_ = use_cascading_window;
   }
 
+  virtual void set_fill_all_candidate_words(bool fill_all_candidate_words) {
+    fill_all_candidate_words_ = fill_all_candidate_words;
+  }
+
   // Meaning that all the composition characters are consumed.
   // c.f. CommitSuggestionInternal
   static const size_t kConsumedAllCharacters;
@@ -283,6 +309,30 @@ class SessionConverter : public SessionConverterInterface {
   // Resets the session state variables.
   void ResetState();
 
+  // Schedules the conversion of |composer| on the background thread, which
+  // runs after the user has been idle for a while.  Does nothing unless
+  // --speculative_conversion is enabled.
+  struct SpeculativeConversion;
+  void MaybeStartSpeculativeConversion(
+      const composer::Composer &composer,
+      const ConversionPreferences &preferences);
+  // Moves the result of the speculative conversion to |segments_| if it has
+  // finished for the same composition, history and preferences.  Never waits
+  // for an unfinished conversion.
+  bool TakeSpeculativeConversion(const composer::Composer &composer,
+                                 const ConversionPreferences &preferences);
+  void CancelSpeculativeConversion();
+  bool HasFinishedSpeculativeConversion() const;
+
+  // Recent suggestion results, which are reused when the same composition
+  // is suggested again, e.g., after a backspace.  Enabled by
+  // --suggestion_cache_size.  |generation| is the one taken before the
+  // suggestion, so that the results computed during an invalidation are
+  // dropped.
+  struct SuggestionCacheEntry;
+  bool TakeSuggestionCache(const string &key, uint64 generation);
+  void InsertSuggestionCache(const string &key, uint64 generation);
+
   // Notifies the converter that the current segment is focused.
   void SegmentFocus();
 
@@ -366,6 +416,9 @@ class SessionConverter : public SessionConverterInterface {
 
   const ConverterInterface *converter_;
   std::unique_ptr<Segments> segments_;
+  // Scratch state of the converter reused by the conversions of this
+  // session.  Not shared with the speculative conversion.
+  std::unique_ptr<ConverterWorkspace> workspace_;
   size_t segment_index_;
 
   // Previous suggestions to be merged with the current predictions.
@@ -387,6 +440,16 @@ class SessionConverter : public SessionConverterInterface {
   bool use_cascading_window_;
   config::Config::SelectionShortcut selection_shortcut_;
 
+  // False if the client doesn't use all_candidate_words.
+  bool fill_all_candidate_words_ = true;
+
+  // Pending or finished speculative conversion, shared with the background
+  // task.
+  std::shared_ptr<SpeculativeConversion> speculative_conversion_;
+
+  // Most recent first.
+  std::deque<std::unique_ptr<SuggestionCacheEntry>> suggestion_cache_;
+
   // Indicates whether config_ will be updated by the command candidate.
   Segment::Candidate::Command updated_command_;
 
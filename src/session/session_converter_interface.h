@@ -257,6 +257,12 @@ class SessionConverterInterface {
 
   virtual void set_use_cascading_window(bool use_cascading_window) = 0;
 
+  // Whether Output::all_candidate_words is filled.  True by default.
+  virtual void set_fill_all_candidate_words(bool fill_all_candidate_words) = 0;
+
+  // Returns the debug string of the segments for logging.
+  virtual string GetSegmentsDebugString() const { return string(); }
+
  private:
   DISALLOW_COPY_AND_ASSIGN(SessionConverterInterface);
 };
@@ -62,6 +62,10 @@
 #include "usage_stats/usage_stats.h"
 #include "usage_stats/usage_stats_testing_util.h"
 
+DECLARE_bool(speculative_conversion);
+DECLARE_int32(speculative_conversion_delay_msec);
+DECLARE_int32(suggestion_cache_size);
+
 namespace mozc {
 namespace session {
 
@@ -161,6 +165,18 @@ class SessionConverterTest : public ::testing::Test {
     converter->AppendCandidateList();
   }
 
+  // Returns true when the speculative conversion of |converter| finishes
+  // within a second.
+  static bool WaitForSpeculativeConversion(const SessionConverter &converter) {
+    for (int i = 0; i < 100; ++i) {
+      if (converter.HasFinishedSpeculativeConversion()) {
+        return true;
+      }
+      Util::Sleep(10);
+    }
+    return false;
+  }
+
   // set result for "あいうえお"
   static void SetAiueo(Segments *segments) {
     segments->Clear();
@@ -2373,6 +2389,149 @@ TEST_F(SessionConverterTest, ReloadConfig) {
   }
 }
 
+TEST_F(SessionConverterTest, OmitAllCandidateWords) {
+  SessionConverter converter(
+      convertermock_.get(), request_.get(), config_.get());
+  converter.set_fill_all_candidate_words(false);
+  Segments segments;
+  SetKamaboko(&segments);
+  const string kKamabokono = "かまぼこの";
+  const string kInbou = "いんぼう";
+  composer_->InsertCharacterPreedit(kKamabokono + kInbou);
+
+  FillT13Ns(&segments, composer_.get());
+  convertermock_->SetStartConversionForRequest(&segments, true);
+
+  EXPECT_TRUE(converter.Convert(*composer_));
+  converter.CandidateNext(*composer_);
+  ASSERT_TRUE(IsCandidateListVisible(converter));
+
+  commands::Output output;
+  converter.PopOutput(*composer_, &output);
+  EXPECT_TRUE(output.has_preedit());
+  EXPECT_TRUE(output.has_candidates());
+  EXPECT_EQ(1, output.candidates().focused_index());
+  EXPECT_FALSE(output.has_all_candidate_words());
+
+  // The setting is kept by the clone used for undo.
+  std::unique_ptr<SessionConverter> cloned(converter.Clone());
+  output.Clear();
+  cloned->FillOutput(*composer_, &output);
+  EXPECT_TRUE(output.has_candidates());
+  EXPECT_FALSE(output.has_all_candidate_words());
+}
+
+TEST_F(SessionConverterTest, SpeculativeConversion) {
+  const bool original_speculative_conversion = FLAGS_speculative_conversion;
+  const int32 original_delay_msec = FLAGS_speculative_conversion_delay_msec;
+  FLAGS_speculative_conversion = true;
+  FLAGS_speculative_conversion_delay_msec = 0;
+
+  SessionConverter converter(
+      convertermock_.get(), request_.get(), config_.get());
+  const string kKamabokono = "かまぼこの";
+  const string kInbou = "いんぼう";
+  composer_->InsertCharacterPreedit(kKamabokono + kInbou);
+
+  Segments kamaboko_segments;
+  SetKamaboko(&kamaboko_segments);
+  FillT13Ns(&kamaboko_segments, composer_.get());
+  Segments aiueo_segments;
+  SetAiueo(&aiueo_segments);
+  Segments suggestion_segments;
+  {
+    suggestion_segments.set_request_type(Segments::SUGGESTION);
+    Segment *segment = suggestion_segments.add_segment();
+    segment->set_key(kKamabokono + kInbou);
+    Segment::Candidate *candidate = segment->add_candidate();
+    candidate->value = "かまぼこの陰謀";
+    candidate->content_key = kKamabokono + kInbou;
+  }
+  convertermock_->SetStartSuggestionForRequest(&suggestion_segments, true);
+
+  {
+    // The result converted during the idle time is used as is.
+    convertermock_->SetStartConversionForRequest(&kamaboko_segments, true);
+    EXPECT_TRUE(converter.Suggest(*composer_));
+    ASSERT_TRUE(WaitForSpeculativeConversion(converter));
+    convertermock_->SetStartConversionForRequest(&aiueo_segments, true);
+    EXPECT_TRUE(converter.Convert(*composer_));
+    Segments segments;
+    GetSegments(converter, &segments);
+    ASSERT_EQ(2, segments.conversion_segments_size());
+    EXPECT_EQ(kKamabokono, segments.conversion_segment(0).key());
+    converter.Cancel();
+  }
+
+  {
+    // The result is discarded once the composition changes.
+    EXPECT_TRUE(converter.Suggest(*composer_));
+    ASSERT_TRUE(WaitForSpeculativeConversion(converter));
+    composer_->InsertCharacterPreedit("あ");
+    convertermock_->SetStartConversionForRequest(&kamaboko_segments, true);
+    EXPECT_TRUE(converter.Convert(*composer_));
+    Segments segments;
+    GetSegments(converter, &segments);
+    ASSERT_EQ(2, segments.conversion_segments_size());
+    EXPECT_EQ(kKamabokono, segments.conversion_segment(0).key());
+  }
+
+  FLAGS_speculative_conversion = original_speculative_conversion;
+  FLAGS_speculative_conversion_delay_msec = original_delay_msec;
+}
+
+TEST_F(SessionConverterTest, SuggestionCache) {
+  const int32 original_cache_size = FLAGS_suggestion_cache_size;
+  FLAGS_suggestion_cache_size = 4;
+
+  SessionConverter converter(
+      convertermock_.get(), request_.get(), config_.get());
+  auto set_suggestion = [this](const string &key, const string &value) {
+    Segments segments;
+    segments.set_request_type(Segments::SUGGESTION);
+    Segment *segment = segments.add_segment();
+    segment->set_key(key);
+    Segment::Candidate *candidate = segment->add_candidate();
+    candidate->value = value;
+    candidate->content_key = key;
+    convertermock_->SetStartSuggestionForRequest(&segments, true);
+  };
+  auto get_top_value = [&converter]() {
+    Segments segments;
+    GetSegments(converter, &segments);
+    return segments.conversion_segment(0).candidate(0).value;
+  };
+
+  composer_->InsertCharacterPreedit("も");
+  set_suggestion("も", "桃");
+  EXPECT_TRUE(converter.Suggest(*composer_));
+  EXPECT_EQ("桃", get_top_value());
+
+  composer_->InsertCharacterPreedit("ず");
+  set_suggestion("もず", "百舌");
+  EXPECT_TRUE(converter.Suggest(*composer_));
+  EXPECT_EQ("百舌", get_top_value());
+
+  // The result for the same composition is reused after a backspace.
+  composer_->Backspace();
+  set_suggestion("も", "藻");
+  EXPECT_TRUE(converter.Suggest(*composer_));
+  EXPECT_EQ("桃", get_top_value());
+
+  // The cached results are dropped after learning, for example.
+  SessionConverter::InvalidateSuggestionCaches();
+  EXPECT_TRUE(converter.Suggest(*composer_));
+  EXPECT_EQ("藻", get_top_value());
+
+  // And when the config is changed.
+  set_suggestion("も", "喪");
+  converter.SetConfig(config_.get());
+  EXPECT_TRUE(converter.Suggest(*composer_));
+  EXPECT_EQ("喪", get_top_value());
+
+  FLAGS_suggestion_cache_size = original_cache_size;
+}
+
 TEST_F(SessionConverterTest, OutputAllCandidateWords) {
   SessionConverter converter(
       convertermock_.get(), request_.get(), config_.get());
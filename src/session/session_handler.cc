@@ -33,6 +33,7 @@
 #include "session/session_handler.h"
 
 #include <algorithm>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
@@ -40,16 +41,21 @@
 #include "base/clock.h"
 #include "base/flags.h"
 #include "base/logging.h"
+#include "base/mutex.h"
 #include "base/port.h"
 #ifndef MOZC_DISABLE_SESSION_WATCHDOG
 #include "base/process.h"
 #endif  // MOZC_DISABLE_SESSION_WATCHDOG
+#include "base/scheduler.h"
 #include "base/singleton.h"
 #include "base/stopwatch.h"
+#include "base/thread_pool.h"
+#include "base/trace_events.h"
 #include "base/util.h"
 #include "composer/table.h"
 #include "config/character_form_manager.h"
 #include "config/config_handler.h"
+#include "data_manager/data_manager_interface.h"
 #include "dictionary/user_dictionary_session_handler.h"
 #include "engine/engine_interface.h"
 #include "engine/user_data_manager_interface.h"
@@ -57,7 +63,10 @@
 #include "protocol/config.pb.h"
 #include "protocol/user_dictionary_storage.pb.h"
 #include "session/generic_storage_manager.h"
+#include "session/idle_task_runner.h"
+#include "session/latency_statistics.h"
 #include "session/session.h"
+#include "session/session_converter.h"
 #include "session/session_observer_handler.h"
 #ifndef MOZC_DISABLE_SESSION_WATCHDOG
 #include "session/session_watch_dog.h"
@@ -98,9 +107,35 @@ DEFINE_int32(last_create_session_timeout, 300,
 DEFINE_bool(restricted, false,
             "Launch server with restricted setting");
 
+DEFINE_int32(slow_command_threshold_msec, 0,
+             "Logs the commands taking longer than this with the debug "
+             "string of their segments.  0 disables the logging.");
+
+DEFINE_bool(preempt_speculative_conversion, true,
+            "If true, a session command cancels the running speculative "
+            "conversion instead of waiting for it to finish.");
+
+DEFINE_int32(hibernate_idle_session_sec, 0,
+             "Serializes the sessions not used for this time to release "
+             "their memory.  They are restored on their next commands.  "
+             "0 disables the hibernation.");
+
+DEFINE_int32(idle_maintenance_window_msec, 0,
+             "Defers the maintenance tasks such as syncing the user data "
+             "until no key event arrives for this time.  0 runs them "
+             "immediately.");
+
+DEFINE_int32(hot_data_resident_budget_kb, 0,
+             "Pages in up to this size of the hot sections of the data set "
+             "on every cleanup, so that the first key event after an idle "
+             "period doesn't wait for page faults.  0 disables it.");
+
 namespace mozc {
 
 namespace {
+// The number of the stale sessions removed in an idle slice.
+const size_t kMaxSessionsToRemovePerIdleSlice = 4;
+
 bool IsApplicationAlive(const session::SessionInterface *session) {
 #ifndef MOZC_DISABLE_SESSION_WATCHDOG
   const commands::ApplicationInfo &info = session->application_info();
@@ -165,11 +200,17 @@ void SessionHandler::Init(
   engine_builder_ = std::move(engine_builder);
   observer_handler_.reset(new session::SessionObserverHandler());
   stopwatch_.reset(new Stopwatch);
+  latency_statistics_.reset(new session::LatencyStatistics);
   user_dictionary_session_handler_.reset(
       new user_dictionary::UserDictionarySessionHandler);
   table_manager_.reset(new composer::TableManager);
   request_.reset(new commands::Request);
   config_.reset(new config::Config);
+  if (FLAGS_idle_maintenance_window_msec > 0) {
+    idle_task_runner_.reset(new session::IdleTaskRunner(
+        FLAGS_idle_maintenance_window_msec,
+        session::SessionConverter::GetConverterMutex()));
+  }
 
   if (FLAGS_restricted) {
     VLOG(1) << "Server starts with restricted mode";
@@ -194,6 +235,7 @@ void SessionHandler::Init(
 #endif  // MOZC_DISABLE_SESSION_WATCHDOG
 
   config::ConfigHandler::GetConfig(config_.get());
+  config_generation_ = 0;
 
   // allow [2..128] sessions
   max_session_size_ = std::max(2, std::min(FLAGS_max_session_size, 128));
@@ -208,6 +250,8 @@ void SessionHandler::Init(
 }
 
 SessionHandler::~SessionHandler() {
+  // Finishes the pending session commands before deleting the sessions.
+  session_shards_.clear();
   for (SessionElement *element =
            const_cast<SessionElement *>(session_map_->Head());
        element != nullptr; element = element->next) {
@@ -246,8 +290,10 @@ bool SessionHandler::StartWatchDog() {
 
 void SessionHandler::SetConfig(const config::Config &config) {
   *config_ = config;
-  const composer::Table *table = table_manager_->GetTable(
+  config_generation_ = 0;
+  table_ = table_manager_->GetSharedTable(
       *request_, *config_, *engine_->GetDataManager());
+  const composer::Table *table = table_.get();
   for (SessionElement *element =
            const_cast<SessionElement *>(session_map_->Head());
        element != NULL; element = element->next) {
@@ -262,13 +308,17 @@ void SessionHandler::SetConfig(const config::Config &config) {
 
 bool SessionHandler::SyncData(commands::Command *command) {
   VLOG(1) << "Syncing user data";
-  engine_->GetUserDataManager()->Sync();
+  RunWhenIdle("SyncUserData", [this]() { SyncUserData(); });
   return true;
 }
 
 bool SessionHandler::Shutdown(commands::Command *command) {
   VLOG(1) << "Shutdown server";
   SyncData(command);
+  if (idle_task_runner_) {
+    // Doesn't wait for the idle time any more.
+    idle_task_runner_->RunPendingTasks();
+  }
   is_available_ = false;
   UsageStats::IncrementCount("ShutDown");
   return true;
@@ -277,17 +327,26 @@ bool SessionHandler::Shutdown(commands::Command *command) {
 bool SessionHandler::Reload(commands::Command *command) {
   VLOG(1) << "Reloading server";
   {
-    config::Config config;
-    config::ConfigHandler::GetConfig(&config);
-    SetConfig(config);
+    const uint64 config_generation =
+        config::ConfigHandler::GetConfigGeneration();
+    SetConfig(*config::ConfigHandler::GetSharedConfig());
+    config_generation_ = config_generation;
   }
-  engine_->Reload();
+  // The cached suggestions may be out of date once the dictionaries are
+  // reloaded.  The results computed until the reload finishes are dropped
+  // as well.
+  session::SessionConverter::InvalidateSuggestionCaches();
+  RunWhenIdle("ReloadEngine", [this]() {
+    engine_->Reload();
+    session::SessionConverter::InvalidateSuggestionCaches();
+  });
   return true;
 }
 
 bool SessionHandler::ClearUserHistory(commands::Command *command) {
   VLOG(1) << "Clearing user history";
   engine_->GetUserDataManager()->ClearUserHistory();
+  session::SessionConverter::InvalidateSuggestionCaches();
   UsageStats::IncrementCount("ClearUserHistory");
   return true;
 }
@@ -295,6 +354,7 @@ bool SessionHandler::ClearUserHistory(commands::Command *command) {
 bool SessionHandler::ClearUserPrediction(commands::Command *command) {
   VLOG(1) << "Clearing user prediction";
   engine_->GetUserDataManager()->ClearUserPrediction();
+  session::SessionConverter::InvalidateSuggestionCaches();
   UsageStats::IncrementCount("ClearUserPrediction");
   return true;
 }
@@ -302,6 +362,7 @@ bool SessionHandler::ClearUserPrediction(commands::Command *command) {
 bool SessionHandler::ClearUnusedUserPrediction(commands::Command *command) {
   VLOG(1) << "Clearing unused user prediction";
   engine_->GetUserDataManager()->ClearUnusedUserPrediction();
+  session::SessionConverter::InvalidateSuggestionCaches();
   UsageStats::IncrementCount("ClearUnusedUserPrediction");
   return true;
 }
@@ -462,11 +523,34 @@ bool SessionHandler::ClearStorage(commands::Command *command) {
 }
 
 bool SessionHandler::EvalCommand(commands::Command *command) {
+  MOZC_TRACE_SCOPE("SessionHandler::EvalCommand");
   if (!is_available_) {
     LOG(ERROR) << "SessionHandler is not available.";
     return false;
   }
 
+  // The speculative conversion was started for the previous keystroke, so
+  // drops it rather than making the latest one wait for it.
+  if (FLAGS_preempt_speculative_conversion &&
+      IsSessionCommand(command->input())) {
+    session::SessionConverter::PreemptSpeculativeConversion();
+  }
+  if (IsSessionCommand(command->input())) {
+    // Postpones the idle-only scheduled jobs while the user is typing.
+    Scheduler::NotifyUserActivity();
+  }
+
+  Stopwatch lock_stopwatch = Stopwatch::StartNew();
+  // Keeps the speculative conversion from running during the command.
+  scoped_lock l(session::SessionConverter::GetConverterMutex());
+  const uint64 lock_usec =
+      static_cast<uint64>(lock_stopwatch.GetElapsedMicroseconds());
+  const bool count_allocations = AllocationStats::IsHookInstalled();
+  AllocationStats::Counters allocations_before = {};
+  if (count_allocations) {
+    allocations_before = AllocationStats::GetThreadCounters();
+  }
+
   bool eval_succeeded = false;
   stopwatch_->Reset();
   stopwatch_->Start();
@@ -535,12 +619,29 @@ bool SessionHandler::EvalCommand(commands::Command *command) {
     case commands::Input::SEND_ENGINE_RELOAD_REQUEST:
       eval_succeeded = SendEngineReloadRequest(command);
       break;
+    case commands::Input::GET_REWRITER_STATISTICS:
+      eval_succeeded = GetRewriterStatistics(command);
+      break;
+    case commands::Input::GET_LATENCY_STATISTICS:
+      eval_succeeded = GetLatencyStatistics(command);
+      break;
+    case commands::Input::GET_MEMORY_USAGE:
+      eval_succeeded = GetMemoryUsage(command);
+      break;
+    case commands::Input::GET_TRACE_EVENTS:
+      eval_succeeded = GetTraceEvents(command);
+      break;
+    case commands::Input::GET_ALLOCATION_STATISTICS:
+      eval_succeeded = GetAllocationStatistics(command);
+      break;
     case commands::Input::NO_OPERATION:
       eval_succeeded = NoOperation(command);
       break;
     default:
       eval_succeeded = false;
   }
+  const uint64 eval_usec =
+      static_cast<uint64>(stopwatch_->GetElapsedMicroseconds());
 
   if (eval_succeeded) {
     UsageStats::IncrementCount("SessionAllEvent");
@@ -561,12 +662,274 @@ bool SessionHandler::EvalCommand(commands::Command *command) {
   }
 
   stopwatch_->Stop();
-  UsageStats::UpdateTiming("ElapsedTimeUSec",
-                           stopwatch_->GetElapsedMicroseconds());
+  const uint64 elapsed_usec =
+      static_cast<uint64>(stopwatch_->GetElapsedMicroseconds());
+  UsageStats::UpdateTiming("ElapsedTimeUSec", elapsed_usec);
+  RecordLatency(*command, lock_usec, eval_usec, elapsed_usec);
+  if (count_allocations) {
+    RecordAllocations(*command, allocations_before);
+  }
 
   return is_available_;
 }
 
+void SessionHandler::RecordLatency(const commands::Command &command,
+                                   uint64 lock_usec, uint64 eval_usec,
+                                   uint64 elapsed_usec) {
+  using session::LatencyStatistics;
+  const string name = LatencyStatistics::GetCommandName(command.input());
+  latency_statistics_->Record(name, LatencyStatistics::LOCK, lock_usec);
+  latency_statistics_->Record(name, LatencyStatistics::EVAL, eval_usec);
+  latency_statistics_->Record(name, LatencyStatistics::OBSERVER,
+                              elapsed_usec - eval_usec);
+  const uint64 total_usec = lock_usec + elapsed_usec;
+  latency_statistics_->Record(name, LatencyStatistics::TOTAL, total_usec);
+
+  if (FLAGS_slow_command_threshold_msec <= 0 ||
+      total_usec <
+          static_cast<uint64>(FLAGS_slow_command_threshold_msec) * 1000) {
+    return;
+  }
+  string segments;
+  if (IsSessionCommand(command.input())) {
+    const session::SessionInterface *const *session =
+        session_map_->LookupWithoutInsert(command.input().id());
+    if (session != NULL) {
+      segments = (*session)->GetSegmentsDebugString();
+    }
+  }
+  LOG(WARNING) << "Slow command: " << name << " took " << total_usec
+               << " usec (lock: " << lock_usec << ", eval: " << eval_usec
+               << ")\n" << command.DebugString() << segments;
+}
+
+void SessionHandler::RecordAllocations(
+    const commands::Command &command,
+    const AllocationStats::Counters &before) {
+  const AllocationStats::Counters after = AllocationStats::GetThreadCounters();
+  CommandAllocations *record = &command_allocations_[
+      session::LatencyStatistics::GetCommandName(command.input())];
+  ++record->command_count;
+  for (int i = 0; i < AllocationStats::NUM_STAGES; ++i) {
+    record->counters.allocations[i] +=
+        after.allocations[i] - before.allocations[i];
+    record->counters.bytes[i] += after.bytes[i] - before.bytes[i];
+  }
+}
+
+// static
+bool SessionHandler::IsSessionCommand(const commands::Input &input) {
+  if (!input.has_id()) {
+    return false;
+  }
+  switch (input.type()) {
+    case commands::Input::SEND_KEY:
+    case commands::Input::TEST_SEND_KEY:
+    case commands::Input::SEND_COMMAND:
+      return true;
+    default:
+      return false;
+  }
+}
+
+void SessionHandler::RunWhenIdle(const string &name,
+                                 std::function<void()> task) {
+  if (!idle_task_runner_) {
+    task();
+    return;
+  }
+  idle_task_runner_->Post(name, std::move(task));
+}
+
+void SessionHandler::RemoveStaleSessionsWhenIdle(
+    uint64 create_session_timeout, uint64 last_command_timeout) {
+  RunWhenIdle("RemoveStaleSessions",
+              [this, create_session_timeout, last_command_timeout]() {
+    const size_t max_sessions =
+        idle_task_runner_ ? kMaxSessionsToRemovePerIdleSlice : 0;
+    if (RemoveStaleSessions(create_session_timeout, last_command_timeout,
+                            max_sessions)) {
+      RemoveStaleSessionsWhenIdle(create_session_timeout,
+                                  last_command_timeout);
+    }
+  });
+}
+
+bool SessionHandler::RemoveStaleSessions(uint64 create_session_timeout,
+                                         uint64 last_command_timeout,
+                                         size_t max_sessions) {
+  const uint64 current_time = Clock::GetTime();
+  for (auto it = hibernated_sessions_.begin();
+       it != hibernated_sessions_.end();) {
+    if (current_time - it->second.hibernate_time >= last_command_timeout) {
+      VLOG(1) << "Hibernated session ID " << it->first << " is removed";
+      it = hibernated_sessions_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  if (last_session_empty_time_ == 0 && session_map_->Size() == 0 &&
+      hibernated_sessions_.empty()) {
+    last_session_empty_time_ = current_time;
+  }
+
+  std::vector<SessionID> remove_ids;
+  bool has_more = false;
+  for (SessionElement *element =
+           const_cast<SessionElement *>(session_map_->Head());
+       element != NULL; element = element->next) {
+    session::SessionInterface *session = element->value;
+    bool is_stale = false;
+    if (!IsApplicationAlive(session)) {
+      VLOG(2) << "Application is not alive. Removing: " << element->key;
+      is_stale = true;
+    } else if (session->last_command_time() == 0) {
+      // no command is exectuted
+      is_stale = (current_time - session->create_session_time()) >=
+          create_session_timeout;
+    } else {  // some commands are executed already
+      is_stale = (current_time - session->last_command_time()) >=
+          last_command_timeout;
+    }
+    if (!is_stale) {
+      continue;
+    }
+    if (max_sessions > 0 && remove_ids.size() >= max_sessions) {
+      has_more = true;
+      break;
+    }
+    remove_ids.push_back(element->key);
+  }
+
+  for (size_t i = 0; i < remove_ids.size(); ++i) {
+    DeleteSessionID(remove_ids[i]);
+    VLOG(1) << "Session ID " << remove_ids[i] << " is removed by server";
+  }
+  return has_more;
+}
+
+void SessionHandler::ApplySessionSettings(
+    session::SessionInterface *session) {
+  session->SetConfig(config_.get());
+  session->SetRequest(request_.get());
+  session->SetTable(table_.get());
+}
+
+bool SessionHandler::EvictOldestSession() {
+  const SessionElement *oldest_element = session_map_->Tail();
+  if (oldest_element == NULL) {
+    LOG(ERROR) << "oldest SessionElement is NULL";
+    return false;
+  }
+  const SessionID oldest_id = oldest_element->key;
+  if (FLAGS_hibernate_idle_session_sec > 0 && HibernateSession(oldest_id)) {
+    VLOG(1) << "Session is FULL, oldest SessionID "
+            << oldest_id << " is hibernated";
+    return true;
+  }
+  delete oldest_element->value;
+  session_map_->Erase(oldest_id);
+  VLOG(1) << "Session is FULL, oldest SessionID "
+          << oldest_id << " is removed";
+  return true;
+}
+
+void SessionHandler::HibernateIdleSessions() {
+  const uint64 current_time = Clock::GetTime();
+  const uint64 idle_sec = FLAGS_hibernate_idle_session_sec;
+  std::vector<SessionID> idle_ids;
+  for (const SessionElement *element = session_map_->Head();
+       element != NULL; element = element->next) {
+    const session::SessionInterface *session = element->value;
+    const uint64 last_time = session->last_command_time() != 0
+                                 ? session->last_command_time()
+                                 : session->create_session_time();
+    if (current_time - last_time >= idle_sec) {
+      idle_ids.push_back(element->key);
+    }
+  }
+  for (size_t i = 0; i < idle_ids.size(); ++i) {
+    HibernateSession(idle_ids[i]);
+  }
+}
+
+bool SessionHandler::HibernateSession(SessionID id) {
+  const session::SessionInterface *const *session =
+      session_map_->LookupWithoutInsert(id);
+  if (session == NULL || *session == NULL) {
+    return false;
+  }
+  HibernatedSession hibernated;
+  if (!(*session)->Hibernate(&hibernated.state)) {
+    return false;
+  }
+  hibernated.hibernate_time = Clock::GetTime();
+  const size_t session_bytes = (*session)->GetEstimatedHeapBytes();
+  if (session_bytes > hibernated.state.size()) {
+    hibernation_reclaimed_bytes_ += session_bytes - hibernated.state.size();
+  }
+  delete *session;
+  session_map_->Erase(id);
+  hibernated_sessions_[id] = std::move(hibernated);
+  UsageStats::IncrementCount("SessionHibernated");
+  VLOG(1) << "Session ID " << id << " is hibernated";
+  return true;
+}
+
+void SessionHandler::MaybeRehydrateSession(SessionID id) {
+  auto it = hibernated_sessions_.find(id);
+  if (it == hibernated_sessions_.end()) {
+    return;
+  }
+  std::unique_ptr<session::SessionInterface> session(NewSession());
+  ApplySessionSettings(session.get());
+  const bool rehydrated = session->Rehydrate(it->second.state);
+  hibernated_sessions_.erase(it);
+  if (!rehydrated) {
+    return;
+  }
+  if (session_map_->Size() >= max_session_size_ && !EvictOldestSession()) {
+    return;
+  }
+  session_map_->Insert(id)->value = session.release();
+  VLOG(1) << "Session ID " << id << " is rehydrated";
+}
+
+void SessionHandler::SyncUserData() {
+  if (engine_->GetUserDataManager()) {
+    engine_->GetUserDataManager()->Sync();
+  }
+}
+
+void SessionHandler::StartSessionShards(int num_shards) {
+  DCHECK(session_shards_.empty());
+  for (int i = 0; i < num_shards; ++i) {
+    session_shards_.emplace_back(new ThreadPool(1));
+  }
+}
+
+bool SessionHandler::EvalSessionCommand(commands::Command *command) {
+  DCHECK(IsSessionCommand(command->input()));
+  if (session_shards_.empty()) {
+    return EvalCommand(command);
+  }
+
+  // A single-threaded pool runs the tasks in the scheduled order, which
+  // keeps the commands of each session in order.  The command itself is
+  // still evaluated under the converter mutex, as EvalCommand() is not
+  // thread-safe.
+  ThreadPool *shard =
+      session_shards_[command->input().id() % session_shards_.size()].get();
+  bool result = false;
+  BlockingCounter done(1);
+  shard->Schedule([this, command, &result, &done]() {
+    result = EvalCommand(command);
+    done.DecrementCount();
+  });
+  done.Wait();
+  return result;
+}
+
 session::SessionInterface *SessionHandler::NewSession() {
   // Session doesn't take the ownership of engine.
   return new session::Session(engine_.get());
@@ -588,6 +951,7 @@ void SessionHandler::MaybeUpdateStoredConfig(commands::Command *command) {
 
 bool SessionHandler::SendKey(commands::Command *command) {
   const SessionID id = command->input().id();
+  MaybeRehydrateSession(id);
   session::SessionInterface **session = session_map_->MutableLookup(id);
   if (session == NULL || *session == NULL) {
     LOG(WARNING) << "SessionID " << id << " is not available";
@@ -600,6 +964,7 @@ bool SessionHandler::SendKey(commands::Command *command) {
 
 bool SessionHandler::TestSendKey(commands::Command *command) {
   const SessionID id = command->input().id();
+  MaybeRehydrateSession(id);
   session::SessionInterface **session = session_map_->MutableLookup(id);
   if (session == NULL || *session == NULL) {
     LOG(WARNING) << "SessionID " << id << " is not available";
@@ -611,6 +976,7 @@ bool SessionHandler::TestSendKey(commands::Command *command) {
 
 bool SessionHandler::SendCommand(commands::Command *command) {
   const SessionID id = command->input().id();
+  MaybeRehydrateSession(id);
   session::SessionInterface **session =
     const_cast<session::SessionInterface **>(session_map_->Lookup(id));
   if (session == NULL || *session == NULL) {
@@ -638,18 +1004,8 @@ bool SessionHandler::CreateSession(commands::Command *command) {
   last_create_session_time_ = current_time;
 
   // if session map is FULL, remove the oldest item from the LRU
-  SessionElement *oldest_element = NULL;
-  if (session_map_->Size() >= max_session_size_) {
-    oldest_element = const_cast<SessionElement *>(session_map_->Tail());
-    if (oldest_element == NULL) {
-      LOG(ERROR) << "oldest SessionElement is NULL";
-      return false;
-    }
-    delete oldest_element->value;
-    oldest_element->value = NULL;
-    session_map_->Erase(oldest_element->key);
-    VLOG(1) << "Session is FULL, oldest SessionID "
-            << oldest_element->key << " is removed";
+  if (session_map_->Size() >= max_session_size_ && !EvictOldestSession()) {
+    return false;
   }
 
   if (engine_builder_ &&
@@ -659,13 +1015,24 @@ bool SessionHandler::CreateSession(commands::Command *command) {
         command->mutable_output()->mutable_engine_reload_response();
     engine_builder_->GetResponse(response);
     if (response->status() == EngineReloadResponse::RELOAD_READY) {
+      // The new engine was built in the background, so only the pointer swap
+      // happens here.  No session is alive, so the old engine is quiescent.
+      std::unique_ptr<EngineInterface> new_engine =
+          engine_builder_->BuildFromPreparedData();
+      LOG_IF(FATAL, !new_engine) << "Critical failure in engine replace";
       if (engine_->GetUserDataManager()) {
         engine_->GetUserDataManager()->Wait();
       }
-      engine_.reset();
-      engine_ = engine_builder_->BuildFromPreparedData();
-      LOG_IF(FATAL, !engine_) << "Critical failure in engine replace";
+      // Destroying the old engine saves the user history it has learned.
+      engine_ = std::move(new_engine);
+      // The new engine loaded the user history before the old engine saved
+      // it, so load it again to carry over the latest learning.
+      if (engine_->GetUserDataManager()) {
+        engine_->GetUserDataManager()->Reload();
+      }
+      session::SessionConverter::InvalidateSuggestionCaches();
       table_manager_->ClearCaches();
+      table_.reset();
       response->set_status(EngineReloadResponse::RELOADED);
     }
     engine_builder_->Clear();
@@ -682,8 +1049,13 @@ bool SessionHandler::CreateSession(commands::Command *command) {
   element->value = session;
   command->mutable_output()->set_id(new_id);
 
-  // The oldes item should be reused
-  DCHECK(oldest_element == NULL || oldest_element == element);
+#ifndef MOZC_DISABLE_SESSION_WATCHDOG
+  // Asks the watch dog to reclaim the stale sessions before the session map
+  // gets full and the oldest session is evicted.
+  if (session_map_->Size() >= max_session_size_ * 3 / 4) {
+    session_watch_dog_->RequestCleanup();
+  }
+#endif  // MOZC_DISABLE_SESSION_WATCHDOG
 
   if (command->input().has_capability()) {
     session->set_client_capability(command->input().capability());
@@ -700,11 +1072,15 @@ bool SessionHandler::CreateSession(commands::Command *command) {
   }
 
   // Ensure the onmemory config is same as the locally stored one
-  // because the local data could be changed by sync.
-  {
-    config::Config config;
-    config::ConfigHandler::GetConfig(&config);
-    SetConfig(config);
+  // because the local data could be changed by sync.  Skips the update of
+  // the sessions unless a new config has been published since the last time.
+  const uint64 config_generation =
+      config::ConfigHandler::GetConfigGeneration();
+  if (config_generation != config_generation_) {
+    SetConfig(*config::ConfigHandler::GetSharedConfig());
+    config_generation_ = config_generation;
+  } else {
+    ApplySessionSettings(session);
   }
 
   // session is not empty.
@@ -717,9 +1093,7 @@ bool SessionHandler::CreateSession(commands::Command *command) {
 
 bool SessionHandler::DeleteSession(commands::Command *command) {
   DeleteSessionID(command->input().id());
-  if (engine_->GetUserDataManager()) {
-    engine_->GetUserDataManager()->Sync();
-  }
+  RunWhenIdle("SyncUserData", [this]() { SyncUserData(); });
   return true;
 }
 
@@ -760,35 +1134,26 @@ bool SessionHandler::Cleanup(commands::Command *command) {
   const uint64 last_command_timeout =
       suspend_time + std::max(10, std::min(FLAGS_last_command_timeout, 7200));
 
-  std::vector<SessionID> remove_ids;
-  for (SessionElement *element =
-           const_cast<SessionElement *>(session_map_->Head());
-       element != NULL; element = element->next) {
-    session::SessionInterface *session = element->value;
-    if (!IsApplicationAlive(session)) {
-      VLOG(2) << "Application is not alive. Removing: " << element->key;
-      remove_ids.push_back(element->key);
-    } else if (session->last_command_time() == 0) {
-      // no command is exectuted
-      if ((current_time - session->create_session_time()) >=
-          create_session_timeout) {
-        remove_ids.push_back(element->key);
-      }
-    } else {  // some commands are executed already
-      if ((current_time - session->last_command_time()) >=
-          last_command_timeout) {
-        remove_ids.push_back(element->key);
-      }
-    }
-  }
-
-  for (size_t i = 0; i < remove_ids.size(); ++i) {
-    DeleteSessionID(remove_ids[i]);
-    VLOG(1) << "Session ID " << remove_ids[i] << " is removed by server";
+  // The stale sessions are reclaimed a few at a time in the idle slices
+  // when the maintenance tasks are deferred.
+  RemoveStaleSessionsWhenIdle(create_session_timeout, last_command_timeout);
+  if (FLAGS_hibernate_idle_session_sec > 0) {
+    RunWhenIdle("HibernateIdleSessions",
+                [this]() { HibernateIdleSessions(); });
   }
 
   // Sync all data. This is a regression bug fix http://b/3033708
-  engine_->GetUserDataManager()->Sync();
+  RunWhenIdle("SyncUserData", [this]() { SyncUserData(); });
+
+  if (FLAGS_hot_data_resident_budget_kb > 0) {
+    RunWhenIdle("TouchHotData", [this]() {
+      const DataManagerInterface *data_manager = engine_->GetDataManager();
+      if (data_manager != nullptr) {
+        data_manager->TouchHotData(
+            static_cast<size_t>(FLAGS_hot_data_resident_budget_kb) * 1024);
+      }
+    });
+  }
 
   // timeout is enabled.
   if (FLAGS_timeout > 0 &&
@@ -827,6 +1192,75 @@ bool SessionHandler::SendEngineReloadRequest(commands::Command *command) {
   return true;
 }
 
+bool SessionHandler::GetRewriterStatistics(commands::Command *command) {
+  return engine_->GetRewriterStatistics(
+      command->mutable_output()->mutable_rewriter_statistics());
+}
+
+bool SessionHandler::GetLatencyStatistics(commands::Command *command) {
+  latency_statistics_->GetStatistics(
+      command->mutable_output()->mutable_latency_statistics());
+  return true;
+}
+
+bool SessionHandler::GetMemoryUsage(commands::Command *command) {
+  commands::MemoryUsage *usage =
+      command->mutable_output()->mutable_memory_usage();
+  // The engine part is optional, e.g., EngineStub doesn't support it.
+  engine_->GetMemoryUsage(usage);
+  commands::MemoryUsage::Entry *entry = usage->add_entry();
+  entry->set_name("Sessions");
+  entry->set_size(session_map_->Size());
+  uint64 session_bytes = 0;
+  for (const SessionElement *element = session_map_->Head();
+       element != NULL; element = element->next) {
+    session_bytes += element->value->GetEstimatedHeapBytes();
+  }
+  entry->set_heap_bytes(session_bytes);
+
+  if (FLAGS_hibernate_idle_session_sec <= 0 && hibernated_sessions_.empty()) {
+    return true;
+  }
+  entry = usage->add_entry();
+  entry->set_name("HibernatedSessions");
+  entry->set_size(hibernated_sessions_.size());
+  uint64 hibernated_bytes = 0;
+  for (const auto &hibernated : hibernated_sessions_) {
+    hibernated_bytes += hibernated.second.state.size();
+  }
+  entry->set_heap_bytes(hibernated_bytes);
+  entry->set_reclaimed_bytes(hibernation_reclaimed_bytes_);
+  return true;
+}
+
+bool SessionHandler::GetTraceEvents(commands::Command *command) {
+  TraceEvents::GetChromeTraceJson(
+      command->mutable_output()->mutable_trace_events_json());
+  return true;
+}
+
+bool SessionHandler::GetAllocationStatistics(commands::Command *command) {
+  commands::AllocationStatistics *statistics =
+      command->mutable_output()->mutable_allocation_statistics();
+  statistics->set_enabled(AllocationStats::IsHookInstalled());
+  for (const auto &it : command_allocations_) {
+    for (int i = 0; i < AllocationStats::NUM_STAGES; ++i) {
+      if (it.second.counters.allocations[i] == 0) {
+        continue;
+      }
+      commands::AllocationStatistics::Entry *entry =
+          statistics->add_entry();
+      entry->set_command(it.first);
+      entry->set_stage(AllocationStats::GetStageName(
+          static_cast<AllocationStats::Stage>(i)));
+      entry->set_command_count(it.second.command_count);
+      entry->set_allocations(it.second.counters.allocations[i]);
+      entry->set_bytes(it.second.counters.bytes[i]);
+    }
+  }
+  return true;
+}
+
 bool SessionHandler::NoOperation(commands::Command *command) {
   return true;
 }
@@ -838,7 +1272,8 @@ SessionID SessionHandler::CreateNewSessionID() {
     Util::GetRandomSequence(reinterpret_cast<char *>(&id), sizeof(id));
     // don't allow id == 0, as it is reserved for
     // "invalid id"
-    if (id != 0 && !session_map_->HasKey(id)) {
+    if (id != 0 && !session_map_->HasKey(id) &&
+        hibernated_sessions_.count(id) == 0) {
       break;
     }
 
@@ -849,6 +1284,9 @@ SessionID SessionHandler::CreateNewSessionID() {
 }
 
 bool SessionHandler::DeleteSessionID(SessionID id) {
+  if (hibernated_sessions_.erase(id) > 0) {
+    return true;
+  }
   session::SessionInterface **session = session_map_->MutableLookup(id);
   if (session == NULL || *session == NULL) {
     LOG_IF(WARNING, id != 0) << "cannot find SessionID " << id;
@@ -860,7 +1298,7 @@ bool SessionHandler::DeleteSessionID(SessionID id) {
 
   // if session gets empty, save the timestamp
   if (last_session_empty_time_ == 0 &&
-      session_map_->Size() == 0) {
+      session_map_->Size() == 0 && hibernated_sessions_.empty()) {
     last_session_empty_time_ = Clock::GetTime();
   }
 
@@ -32,10 +32,13 @@
 #ifndef MOZC_SESSION_SESSION_HANDLER_H_
 #define MOZC_SESSION_SESSION_HANDLER_H_
 
+#include <functional>
 #include <map>
 #include <memory>
 #include <string>
+#include <vector>
 
+#include "base/allocation_stats.h"
 #include "base/port.h"
 #include "composer/table.h"
 #include "engine/engine_builder_interface.h"
@@ -62,13 +65,17 @@ class SessionWatchDog;
 // enabling session watch dog for android.
 #endif  // MOZC_DISABLE_SESSION_WATCHDOG
 class Stopwatch;
+class ThreadPool;
 
 namespace commands {
 class Command;
+class Input;
 class Request;
 }  // namespace commands
 
 namespace session {
+class IdleTaskRunner;
+class LatencyStatistics;
 class SessionInterface;
 class SessionObserverHandler;
 class SessionObserverInterface;
@@ -93,6 +100,21 @@ class SessionHandler : public SessionHandlerInterface {
   // Starts watch dog timer to cleanup sessions.
   bool StartWatchDog() override;
 
+  // Returns true if |input| is a command to a single session, which can be
+  // passed to EvalSessionCommand().
+  static bool IsSessionCommand(const commands::Input &input);
+
+  // Starts |num_shards| threads evaluating the session commands.  Each
+  // session is bound to one of them by its ID.  Must be called before
+  // EvalSessionCommand() is called.
+  void StartSessionShards(int num_shards);
+
+  // Evaluates the session command on the thread bound to its session and
+  // waits for the result.  The commands of a session are evaluated in the
+  // order of the calls.  Falls back to EvalCommand() without the shards.
+  // Thread-safe.
+  bool EvalSessionCommand(commands::Command *command);
+
   // NewSession returns new Sessoin.
   // Client needs to delete it properly
   session::SessionInterface *NewSession();
@@ -104,6 +126,12 @@ class SessionHandler : public SessionHandlerInterface {
 
   const EngineInterface &engine() const { return *engine_; }
 
+  // Latency histograms of the evaluated commands.  SessionServer also records
+  // the IPC stages to it.  Thread-safe.
+  session::LatencyStatistics *latency_statistics() {
+    return latency_statistics_.get();
+  }
+
  private:
   FRIEND_TEST(SessionHandlerTest, StorageTest);
 
@@ -142,12 +170,68 @@ class SessionHandler : public SessionHandlerInterface {
   bool Cleanup(commands::Command *command);
   bool SendUserDictionaryCommand(commands::Command *command);
   bool SendEngineReloadRequest(commands::Command *command);
+  bool GetRewriterStatistics(commands::Command *command);
+  bool GetLatencyStatistics(commands::Command *command);
+  bool GetMemoryUsage(commands::Command *command);
+  bool GetTraceEvents(commands::Command *command);
+  bool GetAllocationStatistics(commands::Command *command);
   bool NoOperation(commands::Command *command);
 
+  // Records the latencies of the stages of EvalCommand() for |command|, and
+  // logs it if slower than --slow_command_threshold_msec.
+  void RecordLatency(const commands::Command &command, uint64 lock_usec,
+                     uint64 eval_usec, uint64 elapsed_usec);
+  // Adds the allocations made on this thread since |before| to the ones of
+  // |command|.
+  void RecordAllocations(const commands::Command &command,
+                         const AllocationStats::Counters &before);
+
+  // Runs |task| when the user gets idle with --idle_maintenance_window_msec,
+  // or immediately otherwise.  Pending tasks of the same |name| are
+  // coalesced.
+  void RunWhenIdle(const string &name, std::function<void()> task);
+  // Syncs the user data such as the user history.
+  void SyncUserData();
+  // Removes the sessions which are not accessed within the timeouts in sec,
+  // a few sessions per idle slice.
+  void RemoveStaleSessionsWhenIdle(uint64 create_session_timeout,
+                                   uint64 last_command_timeout);
+  // Removes up to |max_sessions| stale sessions, or all of them if 0.
+  // Returns true if some stale sessions are left.
+  bool RemoveStaleSessions(uint64 create_session_timeout,
+                           uint64 last_command_timeout, size_t max_sessions);
+
+  // Sets the config, the request and the table of this handler to
+  // |session|.
+  void ApplySessionSettings(session::SessionInterface *session);
+  // Removes the least recently used session from |session_map_| to make a
+  // room.  The session is hibernated if possible, or deleted otherwise.
+  // Returns false if there is no session.
+  bool EvictOldestSession();
+  // Hibernates the sessions which have not been used for
+  // --hibernate_idle_session_sec.
+  void HibernateIdleSessions();
+  // Moves the session of |id| from |session_map_| to |hibernated_sessions_|
+  // if it can be hibernated.
+  bool HibernateSession(SessionID id);
+  // Restores the session of |id| into |session_map_| if it is hibernated.
+  void MaybeRehydrateSession(SessionID id);
+
   SessionID CreateNewSessionID();
   bool DeleteSessionID(SessionID id);
 
   std::unique_ptr<SessionMap> session_map_;
+  // The sessions released from |session_map_| by HibernateSession(), which
+  // are restored on their next commands.
+  struct HibernatedSession {
+    // Serialized by SessionInterface::Hibernate().
+    string state;
+    // The time of the hibernation in sec.
+    uint64 hibernate_time;
+  };
+  std::map<SessionID, HibernatedSession> hibernated_sessions_;
+  // Estimated bytes released by hibernating the sessions so far.
+  uint64 hibernation_reclaimed_bytes_ = 0;
 #ifndef MOZC_DISABLE_SESSION_WATCHDOG
   std::unique_ptr<SessionWatchDog> session_watch_dog_;
 #else  // MOZC_DISABLE_SESSION_WATCHDOG
@@ -165,11 +249,30 @@ class SessionHandler : public SessionHandlerInterface {
   std::unique_ptr<EngineBuilderInterface> engine_builder_;
   std::unique_ptr<session::SessionObserverHandler> observer_handler_;
   std::unique_ptr<Stopwatch> stopwatch_;
+  std::unique_ptr<session::LatencyStatistics> latency_statistics_;
+  // The allocations recorded by RecordAllocations(), keyed by
+  // LatencyStatistics::GetCommandName().
+  struct CommandAllocations {
+    uint64 command_count = 0;
+    AllocationStats::Counters counters = {};
+  };
+  std::map<string, CommandAllocations> command_allocations_;
   std::unique_ptr<user_dictionary::UserDictionarySessionHandler>
       user_dictionary_session_handler_;
   std::unique_ptr<composer::TableManager> table_manager_;
+  // The table set to the sessions.  Kept here since the table manager may
+  // evict it from its caches.
+  std::shared_ptr<const composer::Table> table_;
   std::unique_ptr<commands::Request> request_;
   std::unique_ptr<config::Config> config_;
+  // ConfigHandler::GetConfigGeneration() of |config_|, or 0 if |config_| was
+  // not taken from ConfigHandler.
+  uint64 config_generation_ = 0;
+  // Single-threaded pools evaluating the session commands.
+  std::vector<std::unique_ptr<ThreadPool>> session_shards_;
+  // Defers the maintenance tasks while the user is typing.  Declared after
+  // |engine_| since the pending tasks use it on the destruction.
+  std::unique_ptr<session::IdleTaskRunner> idle_task_runner_;
 
   DISALLOW_COPY_AND_ASSIGN(SessionHandler);
 };
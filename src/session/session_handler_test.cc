@@ -35,8 +35,10 @@
 #include <string>
 #include <vector>
 
+#include "base/allocation_stats.h"
 #include "base/clock_mock.h"
 #include "base/port.h"
+#include "base/trace_events.h"
 #include "base/util.h"
 #include "config/config_handler.h"
 #include "converter/converter_mock.h"
@@ -58,6 +60,8 @@ DECLARE_int32(max_session_size);
 DECLARE_int32(create_session_min_interval);
 DECLARE_int32(last_command_timeout);
 DECLARE_int32(last_create_session_timeout);
+DECLARE_int32(hibernate_idle_session_sec);
+DECLARE_bool(trace_events);
 
 namespace mozc {
 
@@ -311,6 +315,51 @@ TEST_F(SessionHandlerTest, ShutdownTest) {
   EXPECT_COUNT_STATS("SessionAllEvent", 2);
 }
 
+TEST_F(SessionHandlerTest, EvalSessionCommandInShards) {
+  SessionHandler handler(CreateMockDataEngine());
+  handler.StartSessionShards(2);
+
+  std::vector<uint64> session_ids(3);
+  for (size_t i = 0; i < session_ids.size(); ++i) {
+    EXPECT_TRUE(CreateSession(&handler, &session_ids[i]));
+  }
+
+  // Interleaves the keys to the sessions bound to the different shards.
+  const char kKeys[] = "ai";
+  for (size_t i = 0; i < arraysize(kKeys) - 1; ++i) {
+    for (size_t j = 0; j < session_ids.size(); ++j) {
+      commands::Command command;
+      commands::Input *input = command.mutable_input();
+      input->set_id(session_ids[j]);
+      input->set_type(commands::Input::SEND_KEY);
+      input->mutable_key()->set_key_code(kKeys[i]);
+      ASSERT_TRUE(SessionHandler::IsSessionCommand(command.input()));
+      EXPECT_TRUE(handler.EvalSessionCommand(&command));
+      EXPECT_EQ(session_ids[j], command.output().id());
+      EXPECT_TRUE(command.output().consumed());
+    }
+  }
+
+  for (size_t i = 0; i < session_ids.size(); ++i) {
+    commands::Command command;
+    commands::Input *input = command.mutable_input();
+    input->set_id(session_ids[i]);
+    input->set_type(commands::Input::SEND_COMMAND);
+    input->mutable_command()->set_type(commands::SessionCommand::SUBMIT);
+    EXPECT_TRUE(handler.EvalSessionCommand(&command));
+    EXPECT_EQ("あい", command.output().result().value());
+    EXPECT_TRUE(DeleteSession(&handler, session_ids[i]));
+  }
+
+  // The commands not bound to a session are not evaluated in the shards.
+  commands::Input input;
+  input.set_type(commands::Input::SEND_KEY);
+  EXPECT_FALSE(SessionHandler::IsSessionCommand(input));
+  input.set_id(session_ids[0]);
+  input.set_type(commands::Input::DELETE_SESSION);
+  EXPECT_FALSE(SessionHandler::IsSessionCommand(input));
+}
+
 TEST_F(SessionHandlerTest, ClearHistoryTest) {
   SessionHandler handler(CreateMockDataEngine());
 
@@ -575,6 +624,192 @@ TEST_F(SessionHandlerTest, EmojiUsageStatsTest) {
   EXPECT_COUNT_STATS("CommitUnicodeEmoji", 2);
 }
 
+TEST_F(SessionHandlerTest, GetRewriterStatistics) {
+  {
+    SessionHandler handler(CreateMockDataEngine());
+    commands::Command command;
+    command.mutable_input()->set_type(
+        commands::Input::GET_REWRITER_STATISTICS);
+    EXPECT_TRUE(handler.EvalCommand(&command));
+    const commands::RewriterStatistics &statistics =
+        command.output().rewriter_statistics();
+    ASSERT_LT(0, statistics.entry_size());
+    EXPECT_EQ("UserDictionaryRewriter", statistics.entry(0).name());
+  }
+  {
+    // EngineStub doesn't collect the statistics.
+    SessionHandler handler(std::unique_ptr<EngineStub>(new EngineStub()));
+    commands::Command command;
+    command.mutable_input()->set_type(
+        commands::Input::GET_REWRITER_STATISTICS);
+    handler.EvalCommand(&command);
+    EXPECT_EQ(commands::Output::SESSION_FAILURE,
+              command.output().error_code());
+  }
+}
+
+TEST_F(SessionHandlerTest, GetMemoryUsage) {
+  {
+    SessionHandler handler(CreateMockDataEngine());
+    uint64 id = 0;
+    EXPECT_TRUE(CreateSession(&handler, &id));
+    commands::Command command;
+    command.mutable_input()->set_type(commands::Input::GET_MEMORY_USAGE);
+    EXPECT_TRUE(handler.EvalCommand(&command));
+    const commands::MemoryUsage &usage = command.output().memory_usage();
+    ASSERT_LT(1, usage.entry_size());
+    EXPECT_EQ("SystemDictionary", usage.entry(0).name());
+    EXPECT_LT(0, usage.entry(0).mapped_bytes());
+    const commands::MemoryUsage::Entry &sessions =
+        usage.entry(usage.entry_size() - 1);
+    EXPECT_EQ("Sessions", sessions.name());
+    EXPECT_EQ(1, sessions.size());
+  }
+  {
+    // EngineStub doesn't report the usage, but the sessions are reported.
+    SessionHandler handler(std::unique_ptr<EngineStub>(new EngineStub()));
+    commands::Command command;
+    command.mutable_input()->set_type(commands::Input::GET_MEMORY_USAGE);
+    EXPECT_TRUE(handler.EvalCommand(&command));
+    const commands::MemoryUsage &usage = command.output().memory_usage();
+    ASSERT_EQ(1, usage.entry_size());
+    EXPECT_EQ("Sessions", usage.entry(0).name());
+    EXPECT_EQ(0, usage.entry(0).size());
+  }
+}
+
+TEST_F(SessionHandlerTest, GetTraceEvents) {
+  const bool original_trace_events = FLAGS_trace_events;
+  FLAGS_trace_events = true;
+  TraceEvents::Clear();
+
+  SessionHandler handler(CreateMockDataEngine());
+  uint64 id = 0;
+  EXPECT_TRUE(CreateSession(&handler, &id));
+
+  commands::Command command;
+  command.mutable_input()->set_type(commands::Input::GET_TRACE_EVENTS);
+  EXPECT_TRUE(handler.EvalCommand(&command));
+  const string &json = command.output().trace_events_json();
+  EXPECT_TRUE(Util::StartsWith(json, "{\"traceEvents\":["));
+  // The evaluation of CREATE_SESSION has finished.
+  EXPECT_NE(string::npos, json.find("\"SessionHandler::EvalCommand\""));
+
+  FLAGS_trace_events = original_trace_events;
+  TraceEvents::Clear();
+}
+
+TEST_F(SessionHandlerTest, GetAllocationStatistics) {
+  SessionHandler handler(CreateMockDataEngine());
+  uint64 id = 0;
+  EXPECT_TRUE(CreateSession(&handler, &id));
+
+  commands::Command command;
+  command.mutable_input()->set_type(
+      commands::Input::GET_ALLOCATION_STATISTICS);
+  EXPECT_TRUE(handler.EvalCommand(&command));
+  const commands::AllocationStatistics &statistics =
+      command.output().allocation_statistics();
+  EXPECT_EQ(AllocationStats::IsHookInstalled(), statistics.enabled());
+  if (!statistics.enabled()) {
+    // No allocation is counted without the hook.
+    EXPECT_EQ(0, statistics.entry_size());
+    return;
+  }
+  bool found = false;
+  for (const auto &entry : statistics.entry()) {
+    EXPECT_LT(0, entry.allocations());
+    if (entry.command() == "CREATE_SESSION") {
+      EXPECT_EQ(1, entry.command_count());
+      found = true;
+    }
+  }
+  EXPECT_TRUE(found);
+}
+
+TEST_F(SessionHandlerTest, HibernateIdleSession) {
+  const int32 idle_sec = FLAGS_hibernate_idle_session_sec = 10;
+  ClockMock clock(1000, 0);
+  Clock::SetClockForUnitTest(&clock);
+
+  SessionHandler handler(CreateMockDataEngine());
+  uint64 id = 0;
+  EXPECT_TRUE(CreateSession(&handler, &id));
+
+  commands::Command command;
+  command.mutable_input()->set_type(commands::Input::GET_MEMORY_USAGE);
+  EXPECT_TRUE(handler.EvalCommand(&command));
+  {
+    const commands::MemoryUsage &usage = command.output().memory_usage();
+    const commands::MemoryUsage::Entry &sessions =
+        usage.entry(usage.entry_size() - 2);
+    EXPECT_EQ("Sessions", sessions.name());
+    EXPECT_EQ(1, sessions.size());
+    EXPECT_LT(0, sessions.heap_bytes());
+    const commands::MemoryUsage::Entry &hibernated =
+        usage.entry(usage.entry_size() - 1);
+    EXPECT_EQ("HibernatedSessions", hibernated.name());
+    EXPECT_EQ(0, hibernated.size());
+  }
+
+  clock.PutClockForward(idle_sec, 0);
+  EXPECT_TRUE(CleanUp(&handler, id));
+
+  command.Clear();
+  command.mutable_input()->set_type(commands::Input::GET_MEMORY_USAGE);
+  EXPECT_TRUE(handler.EvalCommand(&command));
+  {
+    const commands::MemoryUsage &usage = command.output().memory_usage();
+    EXPECT_EQ(0, usage.entry(usage.entry_size() - 2).size());
+    const commands::MemoryUsage::Entry &hibernated =
+        usage.entry(usage.entry_size() - 1);
+    EXPECT_EQ(1, hibernated.size());
+    EXPECT_LT(0, hibernated.heap_bytes());
+    EXPECT_LT(0, hibernated.reclaimed_bytes());
+  }
+
+  // The session is restored by the next command.
+  EXPECT_TRUE(IsGoodSession(&handler, id));
+  command.Clear();
+  command.mutable_input()->set_type(commands::Input::GET_MEMORY_USAGE);
+  EXPECT_TRUE(handler.EvalCommand(&command));
+  {
+    const commands::MemoryUsage &usage = command.output().memory_usage();
+    EXPECT_EQ(1, usage.entry(usage.entry_size() - 2).size());
+    EXPECT_EQ(0, usage.entry(usage.entry_size() - 1).size());
+  }
+
+  // A hibernated session can be deleted.
+  clock.PutClockForward(idle_sec, 0);
+  EXPECT_TRUE(CleanUp(&handler, id));
+  EXPECT_TRUE(DeleteSession(&handler, id));
+  EXPECT_FALSE(IsGoodSession(&handler, id));
+
+  FLAGS_hibernate_idle_session_sec = 0;
+}
+
+TEST_F(SessionHandlerTest, GetLatencyStatistics) {
+  SessionHandler handler(CreateMockDataEngine());
+  uint64 id = 0;
+  EXPECT_TRUE(CreateSession(&handler, &id));
+
+  commands::Command command;
+  command.mutable_input()->set_type(commands::Input::GET_LATENCY_STATISTICS);
+  EXPECT_TRUE(handler.EvalCommand(&command));
+  const commands::LatencyStatistics &statistics =
+      command.output().latency_statistics();
+  // Each stage of CREATE_SESSION is recorded once.
+  ASSERT_EQ(4, statistics.histogram_size());
+  for (int i = 0; i < statistics.histogram_size(); ++i) {
+    EXPECT_EQ("CREATE_SESSION", statistics.histogram(i).command());
+    EXPECT_EQ(1, statistics.histogram(i).count());
+  }
+  EXPECT_EQ("lock", statistics.histogram(0).stage());
+  EXPECT_EQ("eval", statistics.histogram(1).stage());
+  EXPECT_EQ("observer", statistics.histogram(2).stage());
+  EXPECT_EQ("total", statistics.histogram(3).stage());
+}
+
 // Tests the interaction with EngineBuilderInterface for successful Engine
 // reload event.
 TEST_F(SessionHandlerTest, EngineReload_SuccessfulScenario) {
@@ -32,6 +32,8 @@
 #ifndef MOZC_SESSION_SESSION_INTERFACE_H_
 #define MOZC_SESSION_SESSION_INTERFACE_H_
 
+#include <string>
+
 #include "base/port.h"
 #include "protocol/config.pb.h"
 
@@ -85,6 +87,21 @@ class SessionInterface {
 
   // return 0 (default value) if no command is executed in this session.
   virtual uint64 last_command_time() const = 0;
+
+  // Returns the debug string of the segments of the converter for logging.
+  virtual string GetSegmentsDebugString() const { return string(); }
+
+  // Serializes the state of this session into |state| if it is idle enough,
+  // i.e., it has no composition nor conversion, to be restored later by
+  // Rehydrate() of a new session.  Returns false otherwise.  Currently, this
+  // is especial for session::Session.
+  virtual bool Hibernate(string *state) const { return false; }
+
+  // Restores the state serialized by Hibernate().
+  virtual bool Rehydrate(const string &state) { return false; }
+
+  // Returns the estimated bytes allocated by this session.
+  virtual size_t GetEstimatedHeapBytes() const { return 0; }
 };
 
 }  // namespace session
@@ -0,0 +1,533 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Benchmark replaying the session scenarios against an in-process
+// SessionHandler.
+//
+// Replays the scenario files of data/test/session/scenario, i.e., the format
+// of session_handler_scenario_test.cc, with the engine built from a fixed data
+// set file.  The EXPECT_* lines are ignored.  Reports the throughput, the
+// latency percentiles of the commands, the number of heap allocations and the
+// peak RSS for each scenario, and writes them as JSON to --json_output for
+// regression tracking.  The user history is cleared before every run so that
+// the runs are repeatable.
+//
+// Usage:
+//   session_replay_benchmark --engine_data=/path/to/mozc.data
+//       --user_profile_dir=/tmp/mozc_benchmark
+//       --scenario_files=data/test/session/scenario/conversion.txt,...
+
+#ifndef OS_WIN
+#include <sys/resource.h>
+#endif  // OS_WIN
+
+#include <algorithm>
+#include <iostream>  // NOLINT
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/allocation_stats.h"
+#include "base/file_stream.h"
+#include "base/file_util.h"
+#include "base/flags.h"
+#include "base/init_mozc.h"
+#include "base/logging.h"
+#include "base/number_util.h"
+#include "base/port.h"
+#include "base/stopwatch.h"
+#include "base/system_util.h"
+#include "base/util.h"
+#include "composer/key_parser.h"
+#include "config/config_handler.h"
+#include "data_manager/data_manager.h"
+#include "engine/engine.h"
+#include "protocol/commands.pb.h"
+#include "protocol/config.pb.h"
+#include "session/request_test_util.h"
+#include "session/session_handler.h"
+
+DEFINE_string(engine_data, "", "Path to the data set file (mozc.data)");
+DEFINE_string(magic, "", "Expected magic number of the data set file");
+DEFINE_string(engine_type, "desktop", "\"desktop\" or \"mobile\"");
+DEFINE_string(user_profile_dir, "",
+              "Directory of the user profile.  Required so that the benchmark "
+              "doesn't touch the history of the actual user.");
+DEFINE_string(scenario_files, "", "Comma separated list of scenario files");
+DEFINE_int32(iterations, 5, "Number of measured runs of each scenario");
+DEFINE_int32(warmup_iterations, 1,
+             "Number of runs of each scenario before the measured ones");
+DEFINE_string(json_output, "", "File to write the results as JSON");
+
+namespace mozc {
+namespace {
+
+// Returns the peak resident set size of the process in bytes, or 0 if
+// unknown.  Note that it is the peak since the process started.
+uint64 GetPeakRSSBytes() {
+#ifdef OS_WIN
+  return 0;
+#else  // OS_WIN
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+#ifdef OS_MACOSX
+  return static_cast<uint64>(usage.ru_maxrss);
+#else  // OS_MACOSX
+  // Kilobytes on Linux.
+  return static_cast<uint64>(usage.ru_maxrss) * 1024;
+#endif  // OS_MACOSX
+#endif  // OS_WIN
+}
+
+struct ScenarioResult {
+  string name;
+  std::vector<double> latencies_usec;
+  uint64 num_keys = 0;
+  uint64 num_allocations = 0;
+  uint64 allocated_bytes = 0;
+  // Breakdown of |num_allocations| by AllocationStats::Stage.
+  uint64 stage_allocations[AllocationStats::NUM_STAGES] = {};
+  uint64 peak_rss_bytes = 0;
+  // Lines which are neither replayed nor EXPECT_*.
+  uint64 num_skipped_lines = 0;
+};
+
+double Percentile(const std::vector<double> &sorted, double p) {
+  if (sorted.empty()) {
+    return 0.0;
+  }
+  const size_t index = std::min(
+      sorted.size() - 1, static_cast<size_t>(p * (sorted.size() - 1) + 0.5));
+  return sorted[index];
+}
+
+// Replays the lines of a scenario to a session of |handler|.
+class ScenarioReplayer {
+ public:
+  ScenarioReplayer(SessionHandler *handler, const commands::Request &request)
+      : handler_(handler), id_(0), request_(request) {}
+
+  // Creates a new session with the default request and config, and clears
+  // the user history.
+  void StartSession() {
+    commands::Input input;
+    input.set_type(commands::Input::CLEAR_USER_HISTORY);
+    CHECK(Eval(&input, nullptr));
+    input.set_type(commands::Input::CLEAR_USER_PREDICTION);
+    CHECK(Eval(&input, nullptr));
+
+    input.Clear();
+    input.set_type(commands::Input::SET_CONFIG);
+    config::ConfigHandler::GetDefaultConfig(input.mutable_config());
+    CHECK(Eval(&input, nullptr));
+    input.Clear();
+    input.set_type(commands::Input::SET_REQUEST);
+    *input.mutable_request() = request_;
+    CHECK(Eval(&input, nullptr));
+
+    input.Clear();
+    input.set_type(commands::Input::CREATE_SESSION);
+    commands::Output output;
+    CHECK(Eval(&input, &output));
+    id_ = output.id();
+    current_request_ = request_;
+    last_output_.Clear();
+  }
+
+  void EndSession() {
+    commands::Input input;
+    input.set_type(commands::Input::DELETE_SESSION);
+    input.set_id(id_);
+    Eval(&input, nullptr);
+  }
+
+  // Replays |columns| of a scenario line.  The latencies of the commands are
+  // added to |result| unless it is NULL.
+  void Replay(const std::vector<string> &columns, ScenarioResult *result) {
+    const string &command = columns[0];
+    commands::Input input;
+    input.set_id(id_);
+    if (command == "RESET_CONTEXT") {
+      SetSessionCommand(commands::SessionCommand::RESET_CONTEXT, &input);
+      Run(&input, result);
+    } else if (command == "SEND_KEYS" && columns.size() >= 2) {
+      for (size_t i = 0; i < columns[1].size(); ++i) {
+        input.set_type(commands::Input::SEND_KEY);
+        input.mutable_key()->Clear();
+        input.mutable_key()->set_key_code(columns[1][i]);
+        Run(&input, result);
+        CountKey(result);
+      }
+    } else if (command == "SEND_KANA_KEYS" && columns.size() >= 3 &&
+               columns[1].size() == Util::CharsLen(columns[2])) {
+      for (size_t i = 0; i < columns[1].size(); ++i) {
+        input.set_type(commands::Input::SEND_KEY);
+        input.mutable_key()->Clear();
+        input.mutable_key()->set_key_code(columns[1][i]);
+        input.mutable_key()->set_key_string(Util::SubString(columns[2], i, 1));
+        Run(&input, result);
+        CountKey(result);
+      }
+    } else if ((command == "SEND_KEY" || command == "TEST_SEND_KEY") &&
+               columns.size() >= 2 &&
+               KeyParser::ParseKey(columns[1], input.mutable_key())) {
+      input.set_type(command == "SEND_KEY" ? commands::Input::SEND_KEY
+                                           : commands::Input::TEST_SEND_KEY);
+      Run(&input, result);
+      CountKey(result);
+    } else if ((command == "SELECT_CANDIDATE" ||
+                command == "SUBMIT_CANDIDATE") && columns.size() >= 2) {
+      SetSessionCommand(command == "SELECT_CANDIDATE"
+                            ? commands::SessionCommand::SELECT_CANDIDATE
+                            : commands::SessionCommand::SUBMIT_CANDIDATE,
+                        &input);
+      input.mutable_command()->set_id(NumberUtil::SimpleAtoi(columns[1]));
+      Run(&input, result);
+    } else if ((command == "SELECT_CANDIDATE_BY_VALUE" ||
+                command == "SUBMIT_CANDIDATE_BY_VALUE") &&
+               columns.size() >= 2) {
+      int id = 0;
+      if (!GetCandidateIdByValue(columns[1], &id)) {
+        Skip(result);
+        return;
+      }
+      SetSessionCommand(command == "SELECT_CANDIDATE_BY_VALUE"
+                            ? commands::SessionCommand::SELECT_CANDIDATE
+                            : commands::SessionCommand::SUBMIT_CANDIDATE,
+                        &input);
+      input.mutable_command()->set_id(id);
+      Run(&input, result);
+    } else if (command == "UNDO_OR_REWIND") {
+      SetSessionCommand(commands::SessionCommand::UNDO_OR_REWIND, &input);
+      Run(&input, result);
+    } else if (command == "SWITCH_INPUT_MODE" && columns.size() >= 2) {
+      commands::CompositionMode mode;
+      if (!commands::CompositionMode_Parse(columns[1], &mode)) {
+        Skip(result);
+        return;
+      }
+      SetSessionCommand(commands::SessionCommand::SWITCH_INPUT_MODE, &input);
+      input.mutable_command()->set_composition_mode(mode);
+      Run(&input, result);
+    } else if (command == "SET_DEFAULT_REQUEST" ||
+               command == "SET_MOBILE_REQUEST") {
+      current_request_.Clear();
+      if (command == "SET_MOBILE_REQUEST") {
+        commands::RequestForUnitTest::FillMobileRequest(&current_request_);
+      }
+      input.set_type(commands::Input::SET_REQUEST);
+      *input.mutable_request() = current_request_;
+      Run(&input, result);
+    } else if (command == "UPDATE_MOBILE_KEYBOARD" && columns.size() >= 3) {
+      commands::Request::SpecialRomanjiTable table;
+      commands::Request::SpaceOnAlphanumeric space;
+      if (!commands::Request::SpecialRomanjiTable_Parse(columns[1], &table) ||
+          !commands::Request::SpaceOnAlphanumeric_Parse(columns[2], &space)) {
+        Skip(result);
+        return;
+      }
+      current_request_.set_special_romanji_table(table);
+      current_request_.set_space_on_alphanumeric(space);
+      input.set_type(commands::Input::SET_REQUEST);
+      *input.mutable_request() = current_request_;
+      Run(&input, result);
+    } else if (command == "CLEAR_ALL" || command == "CLEAR_USER_PREDICTION") {
+      if (command == "CLEAR_ALL") {
+        SetSessionCommand(commands::SessionCommand::RESET_CONTEXT, &input);
+        Run(&input, result);
+        input.clear_command();
+      }
+      input.set_type(commands::Input::CLEAR_USER_PREDICTION);
+      Run(&input, result);
+    } else if (!Util::StartsWith(command, "EXPECT_")) {
+      Skip(result);
+    }
+  }
+
+ private:
+  static void SetSessionCommand(commands::SessionCommand::CommandType type,
+                                commands::Input *input) {
+    input->set_type(commands::Input::SEND_COMMAND);
+    input->mutable_command()->set_type(type);
+  }
+
+  static void CountKey(ScenarioResult *result) {
+    if (result != nullptr) {
+      ++result->num_keys;
+    }
+  }
+
+  static void Skip(ScenarioResult *result) {
+    if (result != nullptr) {
+      ++result->num_skipped_lines;
+    }
+  }
+
+  bool GetCandidateIdByValue(const string &value, int *id) const {
+    const commands::CandidateList &candidates =
+        last_output_.all_candidate_words();
+    for (int i = 0; i < candidates.candidates_size(); ++i) {
+      if (candidates.candidates(i).value() == value) {
+        *id = candidates.candidates(i).id();
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Evaluates |input| and its callback as TestSessionClient does, and records
+  // the latency.
+  void Run(commands::Input *input, ScenarioResult *result) {
+    Stopwatch stopwatch = Stopwatch::StartNew();
+    command_.Clear();
+    *command_.mutable_input() = *input;
+    handler_->EvalCommand(&command_);
+    if (command_.output().has_callback() &&
+        command_.output().callback().has_session_command()) {
+      commands::Input callback;
+      callback.set_type(commands::Input::SEND_COMMAND);
+      callback.set_id(id_);
+      *callback.mutable_command() =
+          command_.output().callback().session_command();
+      command_.Clear();
+      *command_.mutable_input() = callback;
+      handler_->EvalCommand(&command_);
+    }
+    stopwatch.Stop();
+    last_output_.Swap(command_.mutable_output());
+    if (result != nullptr) {
+      result->latencies_usec.push_back(stopwatch.GetElapsedMicroseconds());
+    }
+  }
+
+  bool Eval(commands::Input *input, commands::Output *output) {
+    command_.Clear();
+    *command_.mutable_input() = *input;
+    const bool succeeded = handler_->EvalCommand(&command_);
+    if (output != nullptr) {
+      *output = command_.output();
+    }
+    return succeeded;
+  }
+
+  SessionHandler *handler_;
+  uint64 id_;
+  const commands::Request request_;
+  commands::Request current_request_;
+  commands::Command command_;
+  commands::Output last_output_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScenarioReplayer);
+};
+
+void LoadScenario(const string &filename,
+                  std::vector<std::vector<string>> *lines) {
+  InputFileStream ifs(filename.c_str());
+  CHECK(ifs) << "Cannot open " << filename;
+  string line;
+  while (!std::getline(ifs, line).fail()) {
+    Util::ChopReturns(&line);
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    lines->push_back(std::vector<string>());
+    Util::SplitStringUsing(line, "\t", &lines->back());
+    if (lines->back().empty()) {
+      lines->pop_back();
+    }
+  }
+}
+
+void RunScenario(const string &filename, SessionHandler *handler,
+                 const commands::Request &request, ScenarioResult *result) {
+  std::vector<std::vector<string>> lines;
+  LoadScenario(filename, &lines);
+  result->name = FileUtil::Basename(filename);
+
+  ScenarioReplayer replayer(handler, request);
+  for (int i = 0; i < FLAGS_warmup_iterations + FLAGS_iterations; ++i) {
+    const bool measured = (i >= FLAGS_warmup_iterations);
+    replayer.StartSession();
+    const uint64 num_allocations = AllocationStats::GetTotalAllocations();
+    const uint64 allocated_bytes = AllocationStats::GetTotalBytes();
+    const AllocationStats::Counters counters =
+        AllocationStats::GetThreadCounters();
+    for (const std::vector<string> &columns : lines) {
+      replayer.Replay(columns, measured ? result : nullptr);
+    }
+    if (measured) {
+      result->num_allocations +=
+          AllocationStats::GetTotalAllocations() - num_allocations;
+      result->allocated_bytes +=
+          AllocationStats::GetTotalBytes() - allocated_bytes;
+      const AllocationStats::Counters current =
+          AllocationStats::GetThreadCounters();
+      for (int stage = 0; stage < AllocationStats::NUM_STAGES; ++stage) {
+        result->stage_allocations[stage] +=
+            current.allocations[stage] - counters.allocations[stage];
+      }
+    }
+    replayer.EndSession();
+  }
+  result->peak_rss_bytes = GetPeakRSSBytes();
+}
+
+string EscapeJsonString(const string &str) {
+  string escaped;
+  for (const char c : str) {
+    if (c == '"' || c == '\\') {
+      escaped.push_back('\\');
+    }
+    escaped.push_back(c);
+  }
+  return escaped;
+}
+
+// Prints |result| to |os|, and to |json| as a JSON object.
+void PrintResult(const ScenarioResult &result, std::ostream *os,
+                 string *json) {
+  std::vector<double> sorted(result.latencies_usec);
+  std::sort(sorted.begin(), sorted.end());
+  double total_usec = 0.0;
+  for (const double usec : sorted) {
+    total_usec += usec;
+  }
+  const double commands_per_sec =
+      total_usec > 0.0 ? sorted.size() * 1e6 / total_usec : 0.0;
+  const double keys_per_sec =
+      total_usec > 0.0 ? result.num_keys * 1e6 / total_usec : 0.0;
+  const int iterations = std::max(1, FLAGS_iterations);
+  const uint64 allocations_per_run = result.num_allocations / iterations;
+  const uint64 allocated_bytes_per_run = result.allocated_bytes / iterations;
+
+  *os << Util::StringPrintf(
+      "%-36s commands=%-6d keys=%-6llu commands/sec=%.0f keys/sec=%.0f "
+      "p50=%.2fus p90=%.2fus p99=%.2fus max=%.2fus allocations/run=%llu "
+      "allocated_bytes/run=%llu peak_rss=%lluKB",
+      result.name.c_str(), static_cast<int>(sorted.size()),
+      static_cast<unsigned long long>(result.num_keys),  // NOLINT
+      commands_per_sec, keys_per_sec,
+      Percentile(sorted, 0.5), Percentile(sorted, 0.9),
+      Percentile(sorted, 0.99), sorted.empty() ? 0.0 : sorted.back(),
+      static_cast<unsigned long long>(allocations_per_run),  // NOLINT
+      static_cast<unsigned long long>(allocated_bytes_per_run),  // NOLINT
+      static_cast<unsigned long long>(result.peak_rss_bytes / 1024))  // NOLINT
+      << std::endl;
+  string stage_json;
+  *os << "  allocations/run by stage:";
+  for (int i = 0; i < AllocationStats::NUM_STAGES; ++i) {
+    const char *stage_name = AllocationStats::GetStageName(
+        static_cast<AllocationStats::Stage>(i));
+    const unsigned long long allocations =  // NOLINT
+        result.stage_allocations[i] / iterations;
+    *os << " " << stage_name << "=" << allocations;
+    stage_json.append(Util::StringPrintf("%s\"%s\": %llu",
+                                         i > 0 ? ", " : "", stage_name,
+                                         allocations));
+  }
+  *os << std::endl;
+  if (result.num_skipped_lines > 0) {
+    *os << "  skipped lines: " << result.num_skipped_lines << std::endl;
+  }
+
+  json->append(Util::StringPrintf(
+      "{\"name\": \"%s\", \"commands\": %d, \"keys\": %llu, "
+      "\"commands_per_sec\": %.2f, \"keys_per_sec\": %.2f, "
+      "\"p50_usec\": %.2f, \"p90_usec\": %.2f, \"p99_usec\": %.2f, "
+      "\"max_usec\": %.2f, \"allocations_per_run\": %llu, "
+      "\"allocated_bytes_per_run\": %llu, \"peak_rss_bytes\": %llu, "
+      "\"stage_allocations_per_run\": {%s}, \"skipped_lines\": %llu}",
+      EscapeJsonString(result.name).c_str(), static_cast<int>(sorted.size()),
+      static_cast<unsigned long long>(result.num_keys),  // NOLINT
+      commands_per_sec, keys_per_sec,
+      Percentile(sorted, 0.5), Percentile(sorted, 0.9),
+      Percentile(sorted, 0.99), sorted.empty() ? 0.0 : sorted.back(),
+      static_cast<unsigned long long>(allocations_per_run),  // NOLINT
+      static_cast<unsigned long long>(allocated_bytes_per_run),  // NOLINT
+      static_cast<unsigned long long>(result.peak_rss_bytes),  // NOLINT
+      stage_json.c_str(),
+      static_cast<unsigned long long>(result.num_skipped_lines)));  // NOLINT
+}
+
+}  // namespace
+}  // namespace mozc
+
+int main(int argc, char **argv) {
+  mozc::InitMozc(argv[0], &argc, &argv, false);
+  CHECK(!FLAGS_engine_data.empty()) << "--engine_data is required";
+  CHECK(!FLAGS_user_profile_dir.empty()) << "--user_profile_dir is required";
+  CHECK(!FLAGS_scenario_files.empty()) << "--scenario_files is required";
+
+  mozc::FileUtil::CreateDirectory(FLAGS_user_profile_dir);
+  mozc::SystemUtil::SetUserProfileDirectory(FLAGS_user_profile_dir);
+
+  std::unique_ptr<mozc::DataManager> data_manager(new mozc::DataManager);
+  const mozc::DataManager::Status status =
+      FLAGS_magic.empty()
+          ? data_manager->InitFromFile(FLAGS_engine_data)
+          : data_manager->InitFromFile(FLAGS_engine_data, FLAGS_magic);
+  CHECK_EQ(status, mozc::DataManager::Status::OK);
+
+  mozc::commands::Request request;
+  std::unique_ptr<mozc::Engine> engine;
+  if (FLAGS_engine_type == "desktop") {
+    engine = mozc::Engine::CreateDesktopEngine(std::move(data_manager));
+  } else if (FLAGS_engine_type == "mobile") {
+    engine = mozc::Engine::CreateMobileEngine(std::move(data_manager));
+    mozc::commands::RequestForUnitTest::FillMobileRequest(&request);
+  } else {
+    LOG(FATAL) << "Invalid type: --engine_type=" << FLAGS_engine_type;
+  }
+  CHECK(engine);
+  mozc::SessionHandler handler(std::move(engine));
+
+  std::vector<string> files;
+  mozc::Util::SplitStringUsing(FLAGS_scenario_files, ",", &files);
+  string json = "{\"engine_type\": \"" +
+                mozc::EscapeJsonString(FLAGS_engine_type) +
+                "\", \"scenarios\": [";
+  for (size_t i = 0; i < files.size(); ++i) {
+    mozc::ScenarioResult result;
+    mozc::RunScenario(files[i], &handler, request, &result);
+    if (i > 0) {
+      json.append(", ");
+    }
+    mozc::PrintResult(result, &std::cout, &json);
+  }
+  json.append("]}\n");
+
+  if (!FLAGS_json_output.empty()) {
+    mozc::OutputFileStream ofs(FLAGS_json_output.c_str());
+    CHECK(ofs) << "Cannot open " << FLAGS_json_output;
+    ofs << json;
+  }
+  return 0;
+}
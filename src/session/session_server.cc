@@ -34,13 +34,17 @@
 #include <memory>
 #include <string>
 
+#include "base/flags.h"
 #include "base/logging.h"
 #include "base/port.h"
+#include "base/protobuf/arena.h"
 #include "base/scheduler.h"
+#include "base/stopwatch.h"
 #include "engine/engine_factory.h"
 #include "ipc/ipc.h"
 #include "ipc/named_event.h"
 #include "protocol/commands.pb.h"
+#include "session/latency_statistics.h"
 #include "session/session_handler.h"
 #include "session/session_usage_observer.h"
 #include "usage_stats/usage_stats_uploader.h"
@@ -50,8 +54,9 @@ namespace {
 #ifdef OS_WIN
 // On Windows, multiple processes can create named pipe objects whose names are
 // the same. To reduce the potential risk of DOS, we limit the maximum number
-// of pipe instances to 1 here.
-const int kNumConnections   = 1;
+// of pipe instances here.  IPCServer creates all of them up front, so that no
+// instance is left for other processes.
+const int kNumConnections   = 2;
 #else
 const int kNumConnections   = 10;
 #endif  // OS_WIN
@@ -59,31 +64,87 @@ const int kNumConnections   = 10;
 const int kTimeOut = 5000;  // 5000msec
 const char kSessionName[] = "session";
 const char kEventName[] = "session";
+const size_t kArenaBlockSize = 64 * 1024;
+// Usage stats are uploaded only after the user stops typing for this time.
+const uint32 kUsageStatsIdlePeriod = 60 * 1000;  // 1 min
+
+// Serializes |output| into |response|.  Returns false if it doesn't fit.
+bool SerializeOutput(const mozc::commands::Output &output,
+                     char *response, size_t *response_size) {
+  const int size = output.ByteSize();
+
+  // TODO(taku) automatically increase the buffer.
+  // Needs to fix IPCServer as well
+  if (*response_size < static_cast<size_t>(size)) {
+    LOG(WARNING) << "response size < output.size";
+    *response_size = 0;
+    return false;
+  }
+
+  // Serialize directly into the response buffer.  ByteSize() has cached
+  // the sizes of the sub messages.
+  if (!output.SerializeToArray(response, size)) {
+    LOG(WARNING) << "SerializeToArray() failed";
+    *response_size = 0;
+    return false;
+  }
+  *response_size = size;
+  return true;
+}
+
+// Records the latencies of the IPC stages of |input|.
+void RecordIPCLatency(const mozc::commands::Input &input, uint64 parse_usec,
+                      uint64 serialize_usec,
+                      mozc::session::LatencyStatistics *statistics) {
+  using mozc::session::LatencyStatistics;
+  const string name = LatencyStatistics::GetCommandName(input);
+  statistics->Record(name, LatencyStatistics::PARSE, parse_usec);
+  statistics->Record(name, LatencyStatistics::SERIALIZE, serialize_usec);
+}
 
 }  // namespace
 
+DEFINE_int32(session_server_workers, 0,
+             "Number of worker threads receiving the requests.  "
+             "Requests independent of the sessions are answered on the "
+             "workers.  0 means a single-threaded server.");
+
+DEFINE_int32(session_server_shards, 0,
+             "Number of threads evaluating the commands to the sessions "
+             "when --session_server_workers is positive.  0 means that "
+             "they are evaluated on the same thread as the other commands.");
+
 namespace mozc {
 
 SessionServer::SessionServer()
     : IPCServer(kSessionName, kNumConnections, kTimeOut),
       usage_observer_(new session::SessionUsageObserver()),
       session_handler_(new SessionHandler(
-      std::unique_ptr<Engine>(EngineFactory::Create()))) {
+      std::unique_ptr<Engine>(EngineFactory::Create()))),
+      arena_block_(new char[kArenaBlockSize]) {
   using usage_stats::UsageStatsUploader;
+  set_num_workers(FLAGS_session_server_workers);
+  if (FLAGS_session_server_workers > 0 && FLAGS_session_server_shards > 0) {
+    session_handler_->StartSessionShards(FLAGS_session_server_shards);
+  }
+
   // start session watch dog timer
   session_handler_->StartWatchDog();
   session_handler_->AddObserver(usage_observer_.get());
 
   // start usage stats timer
   // send usage stats within 6 min later
-  Scheduler::AddJob(Scheduler::JobSetting(
+  Scheduler::JobSetting usage_stats_job(
       "UsageStatsTimer",
       UsageStatsUploader::kDefaultScheduleInterval,
       UsageStatsUploader::kDefaultScheduleMaxInterval,
       UsageStatsUploader::kDefaultSchedulerDelay,
       UsageStatsUploader::kDefaultSchedulerRandomDelay,
       &UsageStatsUploader::Send,
-      nullptr));
+      nullptr);
+  // Don't upload while the user is typing.
+  usage_stats_job.set_idle_period(kUsageStatsIdlePeriod);
+  Scheduler::AddJob(usage_stats_job);
 
   // Send a notification event to the UI.
   NamedEventNotifier notifier(kEventName);
@@ -109,40 +170,87 @@ bool SessionServer::Process(const char *request,
     return false;   // shutdown the server if handler doesn't exist
   }
 
-  commands::Command command;   // can define as a private member?
-  if (!command.mutable_input()->ParseFromArray(request, request_size)) {
+  // The command and all its sub messages are freed at once with the arena.
+  protobuf::ArenaOptions options;
+  options.initial_block = arena_block_.get();
+  options.initial_block_size = kArenaBlockSize;
+  protobuf::Arena arena(options);
+  commands::Command *command =
+      protobuf::Arena::CreateMessage<commands::Command>(&arena);
+  Stopwatch stopwatch = Stopwatch::StartNew();
+  if (!command->mutable_input()->ParseFromArray(request, request_size)) {
     LOG(WARNING) << "Invalid request";
     *response_size = 0;
     return true;
   }
+  const uint64 parse_usec =
+      static_cast<uint64>(stopwatch.GetElapsedMicroseconds());
 
-  if (!session_handler_->EvalCommand(&command)) {
+  if (!session_handler_->EvalCommand(command)) {
     LOG(WARNING) << "EvalCommand() returned false. Exiting the loop.";
     *response_size = 0;
     return false;
   }
 
-  string output;
-  if (!command.output().SerializeToString(&output)) {
-    LOG(WARNING) << "SerializeToString() failed";
-    *response_size = 0;
+  stopwatch.Reset();
+  stopwatch.Start();
+  const bool serialized =
+      SerializeOutput(command->output(), response, response_size);
+  RecordIPCLatency(command->input(), parse_usec,
+                   static_cast<uint64>(stopwatch.GetElapsedMicroseconds()),
+                   session_handler_->latency_statistics());
+  if (!serialized) {
     return true;
   }
 
-  // TODO(taku) automatically increase the buffer.
-  // Needs to fix IPCServer as well
-  if (*response_size < output.size()) {
-    LOG(WARNING) << "response size < output.size";
-    *response_size = 0;
-    return true;
-  }
+  // debug message
+  VLOG(2) << command->DebugString();
 
-  ::memcpy(response, output.data(), output.size());
-  *response_size = output.size();
+  return true;
+}
 
-  // debug message
-  VLOG(2) << command.DebugString();
+bool SessionServer::TryProcessConcurrently(const char *request,
+                                           size_t request_size,
+                                           char *response,
+                                           size_t *response_size) {
+  commands::Command command;
+  Stopwatch stopwatch = Stopwatch::StartNew();
+  if (!command.mutable_input()->ParseFromArray(request, request_size)) {
+    // Let Process() handle the error.
+    return false;
+  }
+  const uint64 parse_usec =
+      static_cast<uint64>(stopwatch.GetElapsedMicroseconds());
+
+  // NO_OPERATION touches neither the sessions nor the engine, so it doesn't
+  // have to wait for the other commands.  It is used by the clients to check
+  // that the server is alive.
+  if (command.input().type() == commands::Input::NO_OPERATION) {
+    // As SessionHandler::EvalCommand() does, always fill the ID so that the
+    // response is not empty.
+    command.mutable_output()->set_id(command.input().id());
+    SerializeOutput(command.output(), response, response_size);
+    return true;
+  }
 
+  // The commands to a session only have to be ordered with the other
+  // commands to the same session, which the session shards take care of.
+  if (FLAGS_session_server_shards <= 0 ||
+      !SessionHandler::IsSessionCommand(command.input()) ||
+      !session_handler_->IsAvailable()) {
+    return false;
+  }
+  if (!session_handler_->EvalSessionCommand(&command)) {
+    // The handler is being shut down.  The next Process() exits the loop.
+    *response_size = 0;
+    return true;
+  }
+  stopwatch.Reset();
+  stopwatch.Start();
+  SerializeOutput(command.output(), response, response_size);
+  RecordIPCLatency(command.input(), parse_usec,
+                   static_cast<uint64>(stopwatch.GetElapsedMicroseconds()),
+                   session_handler_->latency_statistics());
   return true;
 }
 }  // namespace mozc
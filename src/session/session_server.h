@@ -39,7 +39,7 @@
 
 namespace mozc {
 class EngineInterface;
-class SessionHandlerInterface;
+class SessionHandler;
 
 namespace session {
 class SessionUsageObserver;
@@ -67,9 +67,18 @@ class SessionServer: public IPCServer {
                char *response,
                size_t *response_size) override;
 
+  bool TryProcessConcurrently(const char *request,
+                              size_t request_size,
+                              char *response,
+                              size_t *response_size) override;
+
  private:
   std::unique_ptr<session::SessionUsageObserver> usage_observer_;
-  std::unique_ptr<SessionHandlerInterface> session_handler_;
+  std::unique_ptr<SessionHandler> session_handler_;
+  // The first block of the arena where Process() allocates the command.
+  // It is reused across the requests so that most requests do not need
+  // any heap allocation for the protobuf messages.
+  std::unique_ptr<char[]> arena_block_;
 
   DISALLOW_COPY_AND_ASSIGN(SessionServer);
 };
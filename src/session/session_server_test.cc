@@ -35,6 +35,8 @@
 
 #include "base/scheduler.h"
 #include "base/system_util.h"
+#include "ipc/ipc.h"
+#include "protocol/commands.pb.h"
 #include "testing/base/public/googletest.h"
 #include "testing/base/public/gunit.h"
 
@@ -80,4 +82,38 @@ TEST_F(SessionServerTest, SetSchedulerJobTest) {
   EXPECT_TRUE(job_recorder->HasJob("SaveCachedStats"));
   Scheduler::SetSchedulerHandler(NULL);
 }
+
+TEST_F(SessionServerTest, Process) {
+  std::unique_ptr<JobRecorder> job_recorder(new JobRecorder);
+  Scheduler::SetSchedulerHandler(job_recorder.get());
+  std::unique_ptr<SessionServer> session_server(new SessionServer);
+
+  // The commands are allocated on the arena reused across the requests.
+  uint64 id = 0;
+  for (int i = 0; i < 3; ++i) {
+    commands::Input input;
+    input.set_type(commands::Input::CREATE_SESSION);
+    string request;
+    ASSERT_TRUE(input.SerializeToString(&request));
+    std::vector<char> response(IPC_RESPONSESIZE);
+    size_t response_size = response.size();
+    ASSERT_TRUE(session_server->Process(request.data(), request.size(),
+                                        response.data(), &response_size));
+    commands::Output output;
+    ASSERT_TRUE(output.ParseFromArray(response.data(), response_size));
+    EXPECT_NE(0, output.id());
+    EXPECT_NE(id, output.id());
+    id = output.id();
+  }
+
+  // An invalid request is ignored.
+  const char kInvalidRequest[] = "\xff\xff\xff";
+  std::vector<char> response(IPC_RESPONSESIZE);
+  size_t response_size = response.size();
+  EXPECT_TRUE(session_server->Process(kInvalidRequest,
+                                      sizeof(kInvalidRequest) - 1,
+                                      response.data(), &response_size));
+  EXPECT_EQ(0, response_size);
+  Scheduler::SetSchedulerHandler(NULL);
+}
 }  // namespace mozc
@@ -1047,6 +1047,42 @@ TEST_F(SessionTest, InputMode) {
   EXPECT_EQ(mozc::commands::HALF_ASCII, command.output().mode());
 }
 
+TEST_F(SessionTest, HibernateAndRehydrate) {
+  std::unique_ptr<Session> session(new Session(engine_.get()));
+  InitSessionToPrecomposition(session.get());
+  commands::Capability capability;
+  capability.set_text_deletion(commands::Capability::DELETE_PRECEDING_TEXT);
+  session->set_client_capability(capability);
+  commands::Command command;
+  EXPECT_TRUE(session->InputModeHalfASCII(&command));
+
+  // A session with a composition cannot be hibernated.
+  string state;
+  SendKey("a", session.get(), &command);
+  EXPECT_FALSE(session->Hibernate(&state));
+  EXPECT_GT(session->GetEstimatedHeapBytes(), 0);
+
+  command.Clear();
+  session->Commit(&command);
+  ASSERT_TRUE(session->Hibernate(&state));
+  EXPECT_FALSE(state.empty());
+
+  std::unique_ptr<Session> rehydrated(new Session(engine_.get()));
+  ASSERT_TRUE(rehydrated->Rehydrate(state));
+  EXPECT_EQ(session->create_session_time(),
+            rehydrated->create_session_time());
+  EXPECT_EQ(session->last_command_time(), rehydrated->last_command_time());
+  EXPECT_EQ(commands::Capability::DELETE_PRECEDING_TEXT,
+            rehydrated->context().client_capability().text_deletion());
+
+  // The input mode is restored.
+  command.Clear();
+  rehydrated->GetStatus(&command);
+  EXPECT_EQ(commands::HALF_ASCII, command.output().mode());
+
+  EXPECT_FALSE(rehydrated->Rehydrate("broken"));
+}
+
 TEST_F(SessionTest, SelectCandidate) {
   std::unique_ptr<Session> session(new Session(engine_.get()));
   InitSessionToPrecomposition(session.get());
@@ -2236,6 +2272,64 @@ TEST_F(SessionTest, OutputAllCandidateWords) {
   }
 }
 
+TEST_F(SessionTest, OmitUnchangedAllCandidateWords) {
+  std::unique_ptr<Session> session(new Session(engine_.get()));
+  InitSessionToPrecomposition(session.get());
+  commands::Capability capability;
+  capability.set_omit_unchanged_all_candidate_words(true);
+  session->set_client_capability(capability);
+  commands::Command command;
+
+  Segments segments;
+  SetAiueo(&segments);
+  InsertCharacterChars("aiueo", session.get(), &command);
+
+  ConversionRequest request;
+  SetComposer(session.get(), &request);
+  FillT13Ns(request, &segments);
+  GetConverterMock()->SetStartConversionForRequest(&segments, true);
+
+  command.Clear();
+  SendKey("Space", session.get(), &command);
+  int candidates_size = 0;
+  {
+    const commands::Output &output = command.output();
+    ASSERT_TRUE(output.has_all_candidate_words());
+    EXPECT_FALSE(output.all_candidate_words_unchanged());
+    EXPECT_EQ(0, output.all_candidate_words().focused_index());
+    candidates_size = output.all_candidate_words().candidates_size();
+    EXPECT_LT(0, candidates_size);
+  }
+
+  // Only the focus moves.
+  command.Clear();
+  SendKey("Space", session.get(), &command);
+  {
+    const commands::Output &output = command.output();
+    ASSERT_TRUE(output.has_all_candidate_words());
+    EXPECT_TRUE(output.all_candidate_words_unchanged());
+    EXPECT_EQ(1, output.all_candidate_words().focused_index());
+    EXPECT_EQ(commands::CONVERSION, output.all_candidate_words().category());
+    EXPECT_EQ(0, output.all_candidate_words().candidates_size());
+  }
+
+  // After the list is dropped by the commit, it is sent again.
+  command.Clear();
+  SendKey("Enter", session.get(), &command);
+  EXPECT_FALSE(command.output().has_all_candidate_words());
+
+  InsertCharacterChars("aiueo", session.get(), &command);
+  GetConverterMock()->SetStartConversionForRequest(&segments, true);
+  command.Clear();
+  SendKey("Space", session.get(), &command);
+  {
+    const commands::Output &output = command.output();
+    ASSERT_TRUE(output.has_all_candidate_words());
+    EXPECT_FALSE(output.all_candidate_words_unchanged());
+    EXPECT_EQ(candidates_size, output.all_candidate_words().candidates_size());
+  }
+}
+
 TEST_F(SessionTest, UndoForComposition) {
   Session session(engine_.get());
   InitSessionToPrecomposition(&session);
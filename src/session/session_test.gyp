@@ -154,6 +154,8 @@
       'target_name': 'session_module_test',
       'type': 'executable',
       'sources': [
+        'idle_task_runner_test.cc',
+        'latency_statistics_test.cc',
         'output_util_test.cc',
         'session_observer_handler_test.cc',
         'session_usage_observer_test.cc',
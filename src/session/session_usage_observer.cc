@@ -29,17 +29,23 @@
 
 #include "session/session_usage_observer.h"
 
+#include <atomic>
 #include <climits>
 #include <map>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "base/clock.h"
+#include "base/flags.h"
 #include "base/logging.h"
 #include "base/mutex.h"
 #include "base/number_util.h"
 #include "base/port.h"
 #include "base/scheduler.h"
+#include "base/spsc_queue.h"
+#include "base/thread.h"
+#include "base/unnamed_event.h"
 #include "config/stats_config_util.h"
 #include "protocol/commands.pb.h"
 #include "protocol/state.pb.h"
@@ -49,6 +55,11 @@
 using mozc::protocol::SessionState;
 using mozc::usage_stats::UsageStats;
 
+DEFINE_bool(async_session_usage_observer, false,
+            "Evaluates the usage stats of the commands on a low priority "
+            "background thread instead of the thread evaluating the "
+            "commands.");
+
 namespace mozc {
 namespace session {
 
@@ -61,9 +72,17 @@ const uint32 kSaveCacheStatsInterval = 10 * 60 * 1000;  // 10 min
 // Reduce the frequency to save battery.
 const uint32 kSaveCacheStatsInterval = 2 * 60 * 60 * 1000;  // 2 hours
 #endif  // !OS_ANDROID
+const uint32 kSaveCacheStatsIdlePeriod = 10 * 1000;  // 10 sec
 
 const size_t kMaxSession = 64;
 
+// Number of the commands buffered for the background thread.  The commands
+// arriving while the queue is full are dropped.
+const size_t kCommandQueueCapacity = 256;
+// The background thread wakes up at this interval, or earlier when the queue
+// gets half full, and processes all the queued commands at once.
+const int kCommandQueueIntervalMsec = 500;
+
 // Adds double value to DoubleValueStats.
 // DoubleValueStats contains (num, total, square_total).
 void AddToDoubleValueStats(
@@ -110,18 +129,65 @@ bool IsSessionIndependentCommand(commands::Input::CommandType type) {
 }
 }  // namespace
 
-SessionUsageObserver::SessionUsageObserver() {
-  Scheduler::AddJob(Scheduler::JobSetting(
+// Background thread processing the queued commands in batches.
+class SessionUsageObserver::CommandConsumer : public Thread {
+ public:
+  explicit CommandConsumer(SessionUsageObserver *observer)
+      : observer_(observer), stopping_(false) {}
+
+  void Run() override {
+    Thread::LowerCurrentThreadPriority();
+    while (!stopping_.load(std::memory_order_acquire)) {
+      wake_up_.Wait(kCommandQueueIntervalMsec);
+      observer_->ProcessQueuedCommands();
+    }
+    // Processes the commands queued before Stop().
+    observer_->ProcessQueuedCommands();
+  }
+
+  void WakeUp() {
+    wake_up_.Notify();
+  }
+
+  void Stop() {
+    stopping_.store(true, std::memory_order_release);
+    wake_up_.Notify();
+    Join();
+  }
+
+ private:
+  SessionUsageObserver *observer_;
+  std::atomic<bool> stopping_;
+  UnnamedEvent wake_up_;
+
+  DISALLOW_COPY_AND_ASSIGN(CommandConsumer);
+};
+
+SessionUsageObserver::SessionUsageObserver() : num_dropped_commands_(0) {
+  if (FLAGS_async_session_usage_observer) {
+    command_queue_.reset(
+        new SpscQueue<commands::Command>(kCommandQueueCapacity));
+    command_consumer_.reset(new CommandConsumer(this));
+    command_consumer_->SetJoinable(true);
+    command_consumer_->Start("SessionUsageObserver");
+  }
+  Scheduler::JobSetting job_setting(
       kStatsJobName,
       kSaveCacheStatsInterval,  // default interval
       kSaveCacheStatsInterval,  // max interval
       kSaveCacheStatsInterval,  // delay start
       0,  // random delay 0 (no internet connection from this job)
       &SessionUsageObserver::SaveCachedStats,
-      &usage_cache_));
+      &usage_cache_);
+  // Writing to the disk is postponed while the user is typing.
+  job_setting.set_idle_period(kSaveCacheStatsIdlePeriod);
+  Scheduler::AddJob(job_setting);
 }
 
 SessionUsageObserver::~SessionUsageObserver() {
+  if (command_consumer_) {
+    command_consumer_->Stop();
+  }
   SaveCachedStats(&usage_cache_);
   Scheduler::RemoveJob(kStatsJobName);
 }
@@ -506,6 +572,34 @@ void SessionUsageObserver::LogTouchEvent(const commands::Input &input,
 
 void SessionUsageObserver::EvalCommandHandler(
     const commands::Command &command) {
+  if (!command_queue_) {
+    ProcessCommand(command);
+    return;
+  }
+
+  // Only copies the command here so as not to delay the response.
+  commands::Command copied_command(command);
+  if (!command_queue_->Push(std::move(copied_command))) {
+    num_dropped_commands_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  if (command_queue_->size() >= command_queue_->capacity() / 2) {
+    command_consumer_->WakeUp();
+  }
+}
+
+void SessionUsageObserver::ProcessQueuedCommands() {
+  commands::Command command;
+  while (command_queue_->Pop(&command)) {
+    ProcessCommand(command);
+  }
+  const uint32 num_dropped =
+      num_dropped_commands_.exchange(0, std::memory_order_relaxed);
+  LOG_IF(WARNING, num_dropped > 0)
+      << num_dropped << " commands were dropped from the usage stats";
+}
+
+void SessionUsageObserver::ProcessCommand(const commands::Command &command) {
   const commands::Input &input = command.input();
   const commands::Output &output = command.output();
 
@@ -30,11 +30,14 @@
 #ifndef MOZC_SESSION_SESSION_USAGE_OBSERVER_H_
 #define MOZC_SESSION_SESSION_USAGE_OBSERVER_H_
 
+#include <atomic>
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "base/port.h"
+#include "base/spsc_queue.h"
 #include "protocol/state.pb.h"
 #include "session/session_observer_interface.h"
 #include "usage_stats/usage_stats.h"
@@ -55,9 +58,14 @@ class SessionUsageObserver : public SessionObserverInterface {
   SessionUsageObserver();
   virtual ~SessionUsageObserver();
 
+  // Updates the stats with |command|.  With --async_session_usage_observer,
+  // only queues a copy of |command|, which is processed later on a low
+  // priority background thread.  All the queued commands are processed
+  // before the destruction.
   virtual void EvalCommandHandler(const commands::Command &command);
 
  private:
+  class CommandConsumer;
   struct UsageCache {
     // The structure of touch_event_stat_cache_ and miss_touch_event_stat_cache_
     // is as following:
@@ -80,6 +88,12 @@ class SessionUsageObserver : public SessionObserverInterface {
   // Function type should be |bool Func(void *)| for using scheduler.
   static bool SaveCachedStats(void *data);
 
+  // Updates the stats with |command|.
+  void ProcessCommand(const commands::Command &command);
+  // Processes all the commands in |command_queue_|.  Called only by
+  // |command_consumer_|.
+  void ProcessQueuedCommands();
+
   void EvalCreateSession(const commands::Input &input,
                         const commands::Output &output,
                         std::map<uint64, protocol::SessionState> *states);
@@ -112,6 +126,13 @@ class SessionUsageObserver : public SessionObserverInterface {
   // Because it will not be so large, reallocation will rarely happen.
   std::vector<commands::Input_TouchEvent> last_touchevents_;
 
+  // Commands waiting for |command_consumer_|.  Both are null unless
+  // --async_session_usage_observer is set.  EvalCommandHandler() is the only
+  // producer, which the session handler calls under its lock.
+  std::unique_ptr<SpscQueue<commands::Command>> command_queue_;
+  std::unique_ptr<CommandConsumer> command_consumer_;
+  std::atomic<uint32> num_dropped_commands_;
+
   DISALLOW_COPY_AND_ASSIGN(SessionUsageObserver);
 };
 }  // namespace session
@@ -51,6 +51,7 @@
 using mozc::usage_stats::Stats;
 using mozc::usage_stats::UsageStats;
 
+DECLARE_bool(async_session_usage_observer);
 DECLARE_string(test_tmpdir);
 
 namespace mozc {
@@ -232,6 +233,35 @@ TEST_F(SessionUsageObserverTest, ClientSideStatsSoftwareKeyboardLayout) {
   EXPECT_INTEGER_STATS("SoftwareKeyboardLayoutPortrait", 3);
 }
 
+TEST_F(SessionUsageObserverTest, AsyncObserver) {
+  const bool original_flag = FLAGS_async_session_usage_observer;
+  FLAGS_async_session_usage_observer = true;
+  std::unique_ptr<SessionUsageObserver> observer(new SessionUsageObserver);
+
+  commands::Command command;
+  command.mutable_input()->set_type(commands::Input::CREATE_SESSION);
+  command.mutable_input()->set_id(1);
+  command.mutable_output()->set_id(1);
+  observer->EvalCommandHandler(command);
+
+  command.mutable_input()->set_type(commands::Input::SEND_COMMAND);
+  commands::SessionCommand *session_command =
+      command.mutable_input()->mutable_command();
+  session_command->set_type(commands::SessionCommand::USAGE_STATS_EVENT);
+  session_command->set_usage_stats_event(
+      commands::SessionCommand::SOFTWARE_KEYBOARD_LAYOUT_LANDSCAPE);
+  // Fewer than the queue capacity so that no command is dropped.
+  for (int i = 1; i <= 100; ++i) {
+    session_command->set_usage_stats_event_int_value(i);
+    observer->EvalCommandHandler(command);
+  }
+
+  // All the queued commands are processed in order before the destruction.
+  observer.reset();
+  EXPECT_INTEGER_STATS("SoftwareKeyboardLayoutLandscape", 100);
+  FLAGS_async_session_usage_observer = original_flag;
+}
+
 TEST_F(SessionUsageObserverTest, SubmittedCandidateRow) {
   SessionUsageObserver observer;
 
@@ -37,12 +37,18 @@
 
 #include "base/clock.h"
 #include "base/cpu_stats.h"
+#include "base/flags.h"
 #include "base/logging.h"
 #include "base/port.h"
+#include "base/scheduler.h"
 #include "base/system_util.h"
 #include "base/unnamed_event.h"
 #include "client/client_interface.h"
 
+DEFINE_bool(event_driven_watch_dog, false,
+            "Send Cleanup command when the user is idle instead of "
+            "polling the CPU loads.");
+
 namespace mozc {
 namespace {
 
@@ -61,11 +67,23 @@ const float kMinimumAllCPULoad = 0.33f;
 // Average CPU load for last 10secs.
 // If the load > kMinimumLatestCPULoad, don't send Cleanup
 const float kMinimumLatestCPULoad = 0.66f;
+
+// In the event driven mode, Cleanup is sent after the user has not
+// sent any key event for this period.
+const uint64 kCleanupIdlePeriodMsec = 10 * 1000;
+
+uint64 GetTimeInMsec() {
+  uint64 sec = 0;
+  uint32 usec = 0;
+  Clock::GetTimeOfDay(&sec, &usec);
+  return sec * 1000 + usec / 1000;
+}
 }  // namespace
 
 SessionWatchDog::SessionWatchDog(int32 interval_sec)
     : interval_sec_(interval_sec),
-      client_(NULL), cpu_stats_(NULL), event_(new UnnamedEvent) {
+      client_(NULL), cpu_stats_(NULL), event_(new UnnamedEvent),
+      stop_requested_(false), cleanup_requested_(false) {
   // allow [1..600].
   interval_sec_ = std::max(1, std::min(interval_sec_, 600));
   DCHECK(event_->IsAvailable())
@@ -89,12 +107,24 @@ void SessionWatchDog::Terminate() {
     return;
   }
 
+  stop_requested_ = true;
   if (!event_->Notify()) {
     LOG(ERROR) << "UnnamedEvent::Notify() failed";
     Thread::Terminate();
   }
 
   Join();
+  stop_requested_ = false;
+}
+
+void SessionWatchDog::RequestCleanup() {
+  if (!FLAGS_event_driven_watch_dog || !IsRunning()) {
+    return;
+  }
+  // Notifies only once until the request is consumed by Run().
+  if (!cleanup_requested_.exchange(true)) {
+    event_->Notify();
+  }
 }
 
 void SessionWatchDog::Run() {
@@ -117,6 +147,14 @@ void SessionWatchDog::Run() {
     return;
   }
 
+  if (FLAGS_event_driven_watch_dog) {
+    RunEventDriven();
+  } else {
+    RunCPUPolling();
+  }
+}
+
+void SessionWatchDog::RunCPUPolling() {
   // CPU load check
   // add volatile to store this array in stack
   volatile float cpu_loads[16];  // 60/5 = 12 is the minimal size
@@ -183,53 +221,101 @@ void SessionWatchDog::Run() {
 
     last_cleanup_time = current_cleanup_time;
 
-    VLOG(2) << "Sending Cleanup command";
-    client_->set_timeout(kCleanupTimeout);
-    if (client_->Cleanup()) {
-      VLOG(2) << "Cleanup command succeeded";
-      continue;
+    if (!SendCleanupCommand()) {
+      return;
     }
+  }
+}
 
-    LOG(WARNING) << "Cleanup failed "
-                 << "execute PingCommand to check server is running";
+void SessionWatchDog::RunEventDriven() {
+  while (true) {
+    const uint64 sleep_start_time = Clock::GetTime();
+    VLOG(1) << "Start sleeping " << interval_sec_ << " sec";
+    if (event_->Wait(interval_sec_ * 1000) && stop_requested_) {
+      VLOG(1) << "Received stop signal";
+      return;
+    }
+    const bool requested = cleanup_requested_.exchange(false);
+
+    // If the real sleep time is longer than 2 * interval(), assume that
+    // the computer went to suspend mode.
+    if (!requested &&
+        Clock::GetTime() - sleep_start_time > 2 * interval()) {
+      VLOG(1) << "Don't send cleanup because "
+              << "Server went to suspend mode.";
+      continue;
+    }
 
-    bool failed = true;
-    client_->Reset();
-    client_->set_timeout(kPingTimeout);
-    for (int i = 0; i < kPingTrial; ++i) {
-      if (event_->Wait(kPingInterval)) {
+    // Waits until the user becomes idle.
+    while (true) {
+      const uint64 idle_time =
+          Scheduler::GetLastUserActivityTime() + kCleanupIdlePeriodMsec;
+      const uint64 now = GetTimeInMsec();
+      if (now >= idle_time) {
+        break;
+      }
+      if (event_->Wait(static_cast<int>(idle_time - now)) &&
+          stop_requested_) {
         VLOG(1) << "Received stop signal";
         return;
       }
-      if (client_->PingServer()) {
-        VLOG(2) << "Ping command succeeded";
-        failed = false;
-        break;
-      }
-      LOG(ERROR) << "Ping command failed, waiting "
-                 << kPingInterval << " msec, trial: "
-                 << i;
     }
+    cleanup_requested_ = false;
 
-    if (failed) {
-      if (event_->Wait(100)) {
-        VLOG(1) << "Parent thread is already terminated";
-        return;
-      }
+    if (!SendCleanupCommand()) {
+      return;
+    }
+  }
+}
+
+bool SessionWatchDog::SendCleanupCommand() {
+  VLOG(2) << "Sending Cleanup command";
+  client_->set_timeout(kCleanupTimeout);
+  if (client_->Cleanup()) {
+    VLOG(2) << "Cleanup command succeeded";
+    return true;
+  }
+
+  LOG(WARNING) << "Cleanup failed "
+               << "execute PingCommand to check server is running";
+
+  bool failed = true;
+  client_->Reset();
+  client_->set_timeout(kPingTimeout);
+  for (int i = 0; i < kPingTrial; ++i) {
+    if (event_->Wait(kPingInterval) && stop_requested_) {
+      VLOG(1) << "Received stop signal";
+      return false;
+    }
+    if (client_->PingServer()) {
+      VLOG(2) << "Ping command succeeded";
+      failed = false;
+      break;
+    }
+    LOG(ERROR) << "Ping command failed, waiting "
+               << kPingInterval << " msec, trial: "
+               << i;
+  }
+
+  if (failed) {
+    if (event_->Wait(100) && stop_requested_) {
+      VLOG(1) << "Parent thread is already terminated";
+      return false;
+    }
 #ifndef NO_LOGGING
-      // We have received crash dumps caused by the following LOG(FATAL).
-      // Unfortunately, we cannot investigate the cause of this error,
-      // as the crash dump doesn't contain any logging information.
-      // Here we temporary save the user name into stack in order
-      // to obtain the log file before the LOG(FATAL).
-      char user_name[32];
-      const string tmp = SystemUtil::GetUserNameAsString();
-      strncpy(user_name, tmp.c_str(), sizeof(user_name));
-      VLOG(1) << "user_name: " << user_name;
+    // We have received crash dumps caused by the following LOG(FATAL).
+    // Unfortunately, we cannot investigate the cause of this error,
+    // as the crash dump doesn't contain any logging information.
+    // Here we temporary save the user name into stack in order
+    // to obtain the log file before the LOG(FATAL).
+    char user_name[32];
+    const string tmp = SystemUtil::GetUserNameAsString();
+    strncpy(user_name, tmp.c_str(), sizeof(user_name));
+    VLOG(1) << "user_name: " << user_name;
 #endif
-      LOG(FATAL) << "Cleanup commands failed. Rasing exception...";
-    }
+    LOG(FATAL) << "Cleanup commands failed. Rasing exception...";
   }
+  return true;
 }
 
 bool SessionWatchDog::CanSendCleanupCommand(
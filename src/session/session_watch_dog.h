@@ -32,6 +32,7 @@
 #ifndef MOZC_SESSION_SESSION_WATCH_DOG_H_
 #define MOZC_SESSION_SESSION_WATCH_DOG_H_
 
+#include <atomic>
 #include <memory>
 
 #include "base/port.h"
@@ -46,6 +47,9 @@ class ClientInterface;
 
 // SessionWatchDog class sends Cleanup command to Sessionhandler
 // for every some specified seconds.
+// With --event_driven_watch_dog, it doesn't sample the CPU loads. Instead,
+// it sends Cleanup command once the user becomes idle, either after the
+// interval or as soon as RequestCleanup() is called.
 class SessionWatchDog : public Thread {
  public:
   // return the interval sec of watch dog timer
@@ -67,6 +71,10 @@ class SessionWatchDog : public Thread {
   // inherited from Thread class
   void Terminate();
 
+  // Wakes up the watch dog to send Cleanup command when the user becomes
+  // idle.  This is a no-op unless --event_driven_watch_dog is true.
+  void RequestCleanup();
+
   // inherited from Thread class
   // start watch dog timer and return immediately
   // virtual void Start();
@@ -85,10 +93,20 @@ class SessionWatchDog : public Thread {
  private:
   virtual void Run();
 
+  // Main loops of the CPU polling and the event driven modes.
+  void RunCPUPolling();
+  void RunEventDriven();
+
+  // Sends Cleanup command and checks the server is alive if it fails.
+  // Returns false if the stop signal is received.
+  bool SendCleanupCommand();
+
   int32 interval_sec_;
   client::ClientInterface *client_;
   CPUStatsInterface *cpu_stats_;
   std::unique_ptr<UnnamedEvent> event_;
+  std::atomic<bool> stop_requested_;
+  std::atomic<bool> cleanup_requested_;
 
   DISALLOW_COPY_AND_ASSIGN(SessionWatchDog);
 };
@@ -34,6 +34,7 @@
 
 #include "base/port.h"
 #include "base/cpu_stats.h"
+#include "base/flags.h"
 #include "base/logging.h"
 #include "base/mutex.h"
 #include "base/util.h"
@@ -41,6 +42,8 @@
 #include "testing/base/public/gunit.h"
 #include "testing/base/public/googletest.h"
 
+DECLARE_bool(event_driven_watch_dog);
+
 namespace mozc {
 namespace {
 
@@ -216,4 +219,38 @@ TEST_F(SessionWatchDogTest, SessionCanSendCleanupCommandTest) {
   EXPECT_TRUE(watchdog.CanSendCleanupCommand(cpu_loads, 4, 1, 0));
 }
 
+TEST_F(SessionWatchDogTest, EventDrivenTest) {
+  const bool original_event_driven = FLAGS_event_driven_watch_dog;
+  FLAGS_event_driven_watch_dog = true;
+
+  static const int32 kInterval = 1;  // for every 1sec
+  mozc::SessionWatchDog watchdog(kInterval);
+  mozc::client::ClientMock client;
+  InitializeClient(&client);
+  // CPU loads must not be sampled.
+  mozc::TestCPUStats stats;
+
+  watchdog.SetClientInterface(&client);
+  watchdog.SetCPUStatsInterface(&stats);
+
+  // RequestCleanup() is ignored while the watch dog is not running.
+  watchdog.RequestCleanup();
+  watchdog.Start("SessionWatchDogTest");
+  mozc::Util::Sleep(100);
+  EXPECT_EQ(0, client.GetFunctionCallCount("Cleanup"));
+
+  // Cleanup is sent without waiting for the interval.
+  watchdog.RequestCleanup();
+  mozc::Util::Sleep(300);
+  EXPECT_EQ(1, client.GetFunctionCallCount("Cleanup"));
+
+  // Cleanup is also sent after the interval.
+  mozc::Util::Sleep(1500);
+  EXPECT_LE(2, client.GetFunctionCallCount("Cleanup"));
+
+  watchdog.Terminate();
+  EXPECT_FALSE(watchdog.IsRunning());
+  FLAGS_event_driven_watch_dog = original_event_driven;
+}
+
 }  // namespace mozc
@@ -35,6 +35,7 @@
 
 #include <cstring>
 #include <string>
+#include <vector>
 
 #include "base/encryptor.h"
 #include "base/file_stream.h"
@@ -53,6 +54,24 @@ const size_t kSaltSize = 32;
 
 // Maximum file size (64Mbyte)
 const size_t kMaxFileSize = 64 * 1024 * 1024;
+
+// Each record written by Append() is prefixed with the size of the following
+// salt and encrypted body, in little endian.
+const size_t kRecordHeaderSize = 4;
+
+void AppendRecordHeader(uint32 size, string *output) {
+  for (size_t i = 0; i < kRecordHeaderSize; ++i) {
+    output->push_back(static_cast<char>((size >> (8 * i)) & 0xff));
+  }
+}
+
+uint32 ReadRecordHeader(const char *ptr) {
+  uint32 size = 0;
+  for (size_t i = 0; i < kRecordHeaderSize; ++i) {
+    size |= static_cast<uint32>(static_cast<uint8>(ptr[i])) << (8 * i);
+  }
+  return size;
+}
 }  // namespace
 
 EncryptedStringStorage::EncryptedStringStorage(const string &filename)
@@ -192,5 +211,89 @@ bool EncryptedStringStorage::Encrypt(const string &salt, string *data) const {
   return true;
 }
 
+bool EncryptedStringStorage::Append(const string &input) const {
+  string body, salt;
+  salt.resize(kSaltSize);
+  Util::GetRandomSequence(&salt[0], kSaltSize);
+
+  body.assign(input);
+  if (!Encrypt(salt, &body)) {
+    return false;
+  }
+
+  // Writes the record with a single call so that a crash leaves at most one
+  // truncated record at the end of the file.
+  string record;
+  record.reserve(kRecordHeaderSize + kSaltSize + body.size());
+  AppendRecordHeader(static_cast<uint32>(kSaltSize + body.size()), &record);
+  record.append(salt);
+  record.append(body);
+
+  {
+    OutputFileStream ofs(filename_.c_str(),
+                         std::ios::out | std::ios::app | std::ios::binary);
+    if (!ofs) {
+      LOG(ERROR) << "failed to open: " << filename_;
+      return false;
+    }
+    ofs.write(record.data(), record.size());
+    ofs.flush();
+    if (!ofs) {
+      LOG(ERROR) << "failed to append: " << filename_;
+      return false;
+    }
+  }
+
+#ifdef OS_WIN
+  if (!FileUtil::HideFile(filename_)) {
+    LOG(ERROR) << "Cannot make hidden: " << filename_
+               << " " << ::GetLastError();
+  }
+#endif
+
+  return true;
+}
+
+bool EncryptedStringStorage::LoadRecords(std::vector<string> *records) const {
+  DCHECK(records);
+  records->clear();
+
+  Mmap mmap;
+  if (!mmap.Open(filename_.c_str(), "r")) {
+    LOG(ERROR) << "cannot open: " << filename_;
+    return false;
+  }
+
+  if (mmap.size() > kMaxFileSize) {
+    LOG(ERROR) << "file size is too big.";
+    return false;
+  }
+
+  const char *ptr = mmap.begin();
+  const char *end = mmap.end();
+  while (ptr < end) {
+    if (static_cast<size_t>(end - ptr) < kRecordHeaderSize) {
+      LOG(WARNING) << "truncated record header";
+      break;
+    }
+    const uint32 size = ReadRecordHeader(ptr);
+    ptr += kRecordHeaderSize;
+    if (size < kSaltSize || static_cast<size_t>(end - ptr) < size) {
+      LOG(WARNING) << "truncated record";
+      break;
+    }
+    const string salt(ptr, kSaltSize);
+    string data(ptr + kSaltSize, size - kSaltSize);
+    ptr += size;
+    if (!Decrypt(salt, &data)) {
+      LOG(WARNING) << "broken record";
+      break;
+    }
+    records->push_back(data);
+  }
+
+  return true;
+}
+
 }  // namespace storage
 }  // namespace mozc
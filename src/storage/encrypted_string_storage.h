@@ -31,6 +31,7 @@
 #define MOZC_STORAGE_ENCRYPTED_STRING_STORAGE_H_
 
 #include <string>
+#include <vector>
 
 #include "base/port.h"
 
@@ -43,6 +44,16 @@ class StringStorageInterface {
 
   virtual bool Load(string *output) const = 0;
   virtual bool Save(const string &input) const = 0;
+
+  // Appends |input| to the file as an independent record, so that small
+  // updates don't rewrite the whole file.  A file written by Append() must be
+  // read by LoadRecords(), not by Load().
+  virtual bool Append(const string &input) const = 0;
+
+  // Loads the records written by Append() in order.  A broken record, e.g.
+  // one partially written at a crash, and all the following ones are
+  // dropped.
+  virtual bool LoadRecords(std::vector<string> *records) const = 0;
 };
 
 class EncryptedStringStorage : public StringStorageInterface {
@@ -52,6 +63,8 @@ class EncryptedStringStorage : public StringStorageInterface {
 
   virtual bool Load(string *output) const;
   virtual bool Save(const string &input) const;
+  virtual bool Append(const string &input) const;
+  virtual bool LoadRecords(std::vector<string> *records) const;
 
  protected:
   virtual bool Encrypt(const string &salt, string *data) const;
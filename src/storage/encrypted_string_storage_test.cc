@@ -31,6 +31,7 @@
 
 #include <iostream>
 #include <memory>
+#include <vector>
 
 #include "base/file_stream.h"
 #include "base/file_util.h"
@@ -125,6 +126,31 @@ TEST_F(EncryptedStringStorageTest, Encrypt) {
   EXPECT_LT(original_data.size(), result.size());
   EXPECT_TRUE(result.find(original_data) == string::npos);
 }
+
+// The mock on Android remembers only the last encrypted data.
+TEST_F(EncryptedStringStorageTest, AppendAndLoadRecords) {
+  FileUtil::Unlink(filename_);
+  ASSERT_TRUE(storage_->Append("first"));
+  ASSERT_TRUE(storage_->Append("second"));
+  ASSERT_TRUE(storage_->Append("third"));
+
+  std::vector<string> records;
+  ASSERT_TRUE(storage_->LoadRecords(&records));
+  ASSERT_EQ(3, records.size());
+  EXPECT_EQ("first", records[0]);
+  EXPECT_EQ("second", records[1]);
+  EXPECT_EQ("third", records[2]);
+
+  // A partially written record at the end is dropped.
+  {
+    OutputFileStream ofs(filename_.c_str(),
+                         std::ios::out | std::ios::app | std::ios::binary);
+    ofs.write("\x40\x00\x00\x00broken", 10);
+  }
+  ASSERT_TRUE(storage_->LoadRecords(&records));
+  ASSERT_EQ(3, records.size());
+  EXPECT_EQ("third", records[2]);
+}
 #endif  // OS_ANDROID
 
 }  // namespace storage
@@ -46,6 +46,26 @@ inline uint64 RotateLeft64(uint64 original, int num_bits) {
   return (original << (64 - num_bits)) | (original >> num_bits);
 }
 
+// Number of bits in a block of the BLOCKED format, i.e. a cache line.
+const uint32 kFilterBlockBits = 512;
+// Number of the bits of a hash to locate a bit in a block.
+const int kFilterBlockIndexBits = 9;
+// The format is stored above the number of hashes in the header.
+const int kFormatShift = 8;
+const int kNumHashesMask = (1 << kFormatShift) - 1;
+
+// Mixes all the bits of |hash| into the lower bits, so that the bits in a
+// block are independent of the choice of the block.  This is the finalizer
+// of MurmurHash3.
+inline uint64 MixBits(uint64 hash) {
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdULL;
+  hash ^= hash >> 33;
+  hash *= 0xc4ceb9fe1a85ec53ULL;
+  hash ^= hash >> 33;
+  return hash;
+}
+
 inline uint32 BitsToWords(uint32 bits) {
   uint32 words = (bits + 31) >> 5;
   if (bits > 0 && words == 0) {
@@ -63,6 +83,8 @@ class ExistenceFilter::BlockBitmap {
   void Clear();
   bool Get(uint32 index) const;
   void Set(uint32 index);
+  // Hints the CPU to start loading the word of the bit at |index|.
+  void Prefetch(uint32 index) const;
 
   // REQUIRES: "iter" is zero, or was set by a preceding call
   // to GetMutableFragment().
@@ -149,21 +171,22 @@ void ExistenceFilter::BlockBitmap::Clear() {
 }
 
 ExistenceFilter::ExistenceFilter(uint32 m, uint32 n, int k)
-    : vec_size_(m ? m : 1),
-      expected_nelts_(n),
-      num_hashes_(k) {
-  CHECK_LT(num_hashes_, 8);
-  rep_.reset(new BlockBitmap(m ? m : 1, true));
-  rep_->Clear();
-}
+    : ExistenceFilter(m, n, k, CLASSIC, true) {}
+
+ExistenceFilter::ExistenceFilter(uint32 m, uint32 n, int k, Format format)
+    : ExistenceFilter(m, n, k, format, true) {}
 
 // this is private constructor
-ExistenceFilter::ExistenceFilter(uint32 m, uint32 n, int k,
+ExistenceFilter::ExistenceFilter(uint32 m, uint32 n, int k, Format format,
                                  bool is_mutable)
     : vec_size_(m ? m : 1),
       expected_nelts_(n),
-      num_hashes_(k) {
+      num_hashes_(k),
+      format_(format) {
   CHECK_LT(num_hashes_, 8);
+  if (format_ == BLOCKED) {
+    CHECK_EQ(0, vec_size_ % kFilterBlockBits);
+  }
   rep_.reset(new BlockBitmap(m ? m : 1, is_mutable));
   rep_->Clear();
 }
@@ -172,16 +195,26 @@ ExistenceFilter::ExistenceFilter(uint32 m, uint32 n, int k,
 ExistenceFilter *
 ExistenceFilter::CreateImmutableExietenceFilter(uint32 m,
                                                 uint32 n,
-                                                int k) {
-  return new ExistenceFilter(m, n, k, false);
+                                                int k,
+                                                Format format) {
+  return new ExistenceFilter(m, n, k, format, false);
 }
 
 ExistenceFilter* ExistenceFilter::CreateOptimal(size_t size_in_bytes,
                                                 uint32 estimated_insertions) {
+  return CreateOptimal(size_in_bytes, estimated_insertions, CLASSIC);
+}
+
+ExistenceFilter* ExistenceFilter::CreateOptimal(size_t size_in_bytes,
+                                                uint32 estimated_insertions,
+                                                Format format) {
   CHECK_LT(size_in_bytes, (1 << 29))
                              << "Requested size is too big";
   CHECK_GT(estimated_insertions, 0);
-  const uint32 m = size_in_bytes * 8;
+  uint32 m = size_in_bytes * 8;
+  if (format == BLOCKED) {
+    m = (m + kFilterBlockBits - 1) / kFilterBlockBits * kFilterBlockBits;
+  }
   const uint32 n = estimated_insertions;
 
   int optimal_k = static_cast<int>((static_cast<float>(m) / n * log(2.0))
@@ -195,7 +228,7 @@ ExistenceFilter* ExistenceFilter::CreateOptimal(size_t size_in_bytes,
 
   VLOG(1) << "optimal_k: " << optimal_k;
 
-  ExistenceFilter *filter = new ExistenceFilter(m, n, optimal_k);
+  ExistenceFilter *filter = new ExistenceFilter(m, n, optimal_k, format);
   CHECK(filter);
   return filter;
 }
@@ -214,6 +247,14 @@ inline bool ExistenceFilter::BlockBitmap::Get(uint32 index) const {
   return (block_[bindex][windex] >> bitpos) & 1;
 }
 
+inline void ExistenceFilter::BlockBitmap::Prefetch(uint32 index) const {
+#if defined(__GNUC__) || defined(__clang__)
+  const uint32 bindex = index >> kBlockShift;
+  const uint32 windex = (index & kBlockMask) >> 5;
+  __builtin_prefetch(&block_[bindex][windex]);
+#endif  // __GNUC__ || __clang__
+}
+
 inline void ExistenceFilter::BlockBitmap::Set(uint32 index) {
   const uint32 bindex = index >> kBlockShift;
   const uint32 windex = (index & kBlockMask) >> 5;
@@ -236,7 +277,27 @@ bool ExistenceFilter::BlockBitmap::GetMutableFragment(uint32 *iter,
   return true;
 }
 
+inline uint32 ExistenceFilter::GetBlockOffset(uint64 hash) const {
+  // Maps the upper 32 bits to [0, num_blocks) without a division.
+  const uint64 num_blocks = vec_size_ / kFilterBlockBits;
+  return static_cast<uint32>(((hash >> 32) * num_blocks) >> 32) *
+      kFilterBlockBits;
+}
+
 bool ExistenceFilter::Exists(uint64 hash) const {
+  if (format_ == BLOCKED) {
+    // All the probes hit the same cache line.
+    const uint32 offset = GetBlockOffset(hash);
+    uint64 bits = MixBits(hash);
+    for (size_t i = 0; i < num_hashes_; ++i) {
+      if (!rep_->Get(offset + (bits & (kFilterBlockBits - 1)))) {
+        return false;
+      }
+      bits >>= kFilterBlockIndexBits;
+    }
+    return true;
+  }
+
   for (size_t i = 0; i < num_hashes_; ++i) {
     hash = RotateLeft64(hash, 8);
     uint32 index = hash % vec_size_;
@@ -247,7 +308,31 @@ bool ExistenceFilter::Exists(uint64 hash) const {
   return true;
 }
 
+size_t ExistenceFilter::FindFirst(const uint64 *hashes, size_t size) const {
+  if (format_ == BLOCKED) {
+    for (size_t i = 0; i < size; ++i) {
+      rep_->Prefetch(GetBlockOffset(hashes[i]));
+    }
+  }
+  for (size_t i = 0; i < size; ++i) {
+    if (Exists(hashes[i])) {
+      return i;
+    }
+  }
+  return size;
+}
+
 void ExistenceFilter::Insert(uint64 hash) {
+  if (format_ == BLOCKED) {
+    const uint32 offset = GetBlockOffset(hash);
+    uint64 bits = MixBits(hash);
+    for (size_t i = 0; i < num_hashes_; ++i) {
+      rep_->Set(offset + (bits & (kFilterBlockBits - 1)));
+      bits >>= kFilterBlockIndexBits;
+    }
+    return;
+  }
+
   for (size_t i = 0; i < num_hashes_; ++i) {
     hash = RotateLeft64(hash, 8);
     uint32 index = hash % vec_size_;
@@ -276,7 +361,8 @@ size_t ExistenceFilter::MinFilterSizeInBytesForErrorRate(float error_rate,
 // allocate 'buf' and write filter to the buf.
 // 'size' will hold the size of buf
 void ExistenceFilter::Write(char **buf, size_t *size) {
-  const int require_bytes = sizeof(Header) + Size();
+  const int require_bytes = sizeof(vec_size_) + sizeof(expected_nelts_) +
+      sizeof(num_hashes_) + Size();
 
   *buf = new char[require_bytes];
   CHECK(*buf);
@@ -289,10 +375,14 @@ void ExistenceFilter::Write(char **buf, size_t *size) {
   buf_ptr += sizeof(vec_size_);
   memcpy(buf_ptr, &expected_nelts_, sizeof(expected_nelts_));
   buf_ptr += sizeof(expected_nelts_);
-  memcpy(buf_ptr, &num_hashes_, sizeof(num_hashes_));
-  buf_ptr += sizeof(num_hashes_);
+  // The old readers reject the BLOCKED data as it has too many hashes.
+  const int32 hashes_and_format =
+      num_hashes_ | (static_cast<int32>(format_) << kFormatShift);
+  memcpy(buf_ptr, &hashes_and_format, sizeof(hashes_and_format));
+  buf_ptr += sizeof(hashes_and_format);
   LOG(INFO) << "Write header : vec_size" << vec_size_ << " expected_nelts "
-            << expected_nelts_ << " num_hashes " << num_hashes_;
+            << expected_nelts_ << " num_hashes " << num_hashes_
+            << " format " << format_;
 
   // write bitmap
   char **fragment_ptr = NULL;
@@ -314,12 +404,29 @@ bool ExistenceFilter::ReadHeader(const char *buf, Header* header) {
   buf += sizeof(header->m);
   memcpy(&(header->n), buf, sizeof(header->n));
   buf += sizeof(header->n);
-  memcpy(&(header->k), buf, sizeof(header->k));
-  buf += sizeof(header->k);
+  int hashes_and_format = 0;
+  memcpy(&hashes_and_format, buf, sizeof(hashes_and_format));
+  buf += sizeof(hashes_and_format);
+  header->k = hashes_and_format & kNumHashesMask;
   if (header->k >= 8 || header->k <= 0) {
     LOG(ERROR) << "Bad number of hashes (header->k)";
     return false;
   }
+  switch (hashes_and_format >> kFormatShift) {
+    case CLASSIC:
+      header->format = CLASSIC;
+      break;
+    case BLOCKED:
+      header->format = BLOCKED;
+      if (header->m == 0 || header->m % kFilterBlockBits != 0) {
+        LOG(ERROR) << "Bad size of the blocked filter (header->m)";
+        return false;
+      }
+      break;
+    default:
+      LOG(ERROR) << "Unknown format: " << (hashes_and_format >> kFormatShift);
+      return false;
+  }
   return true;
 }
 
@@ -353,7 +460,8 @@ ExistenceFilter* ExistenceFilter::Read(const char *buf, size_t size) {
   ExistenceFilter* filter =
       ExistenceFilter::CreateImmutableExietenceFilter(header.m,
                                                       header.n,
-                                                      header.k);
+                                                      header.k,
+                                                      header.format);
   char **ptr = NULL;
   size_t n = 0;
   size_t read = 0;
@@ -40,21 +40,39 @@ namespace storage {
 // Bloom filter
 class ExistenceFilter {
  public:
+  // Layout of the bits.  Stored in the header with the number of hashes.
+  enum Format {
+    // The k bits of a value are spread over the whole bit vector.
+    CLASSIC = 0,
+    // The k bits of a value are in one 512-bit block, i.e. one cache line,
+    // picked by the hash.  Slightly more false positives than CLASSIC for
+    // the same size, but a lookup touches only one cache line.
+    BLOCKED = 1,
+  };
+
   struct Header {
     uint32 m;
     uint32 n;
     int k;
+    Format format;
   };
 
   // 'm' is the number of bits in the bit vector
   // 'n' is the number of values that will be stored
   // 'k' is the number of hash values to use per insert/lookup
   // k must be less than 8
+  // For BLOCKED, m must be a multiple of 512.
   ExistenceFilter(uint32 m, uint32 n, int k);
+  ExistenceFilter(uint32 m, uint32 n, int k, Format format);
   ~ExistenceFilter();
 
   static ExistenceFilter* CreateOptimal(size_t size_in_bytes,
                                         uint32 estimated_insertions);
+  // Same as above but with |format|.  For BLOCKED, the size is rounded up to
+  // a multiple of 64 bytes.
+  static ExistenceFilter* CreateOptimal(size_t size_in_bytes,
+                                        uint32 estimated_insertions,
+                                        Format format);
 
   void Clear();
 
@@ -66,6 +84,11 @@ class ExistenceFilter {
   // It may return some false positives
   bool Exists(uint64 hash) const;
 
+  // Returns the index of the first of hashes[0, size) that Exists(), or
+  // |size| if none does.  For BLOCKED, the blocks of all the hashes are
+  // prefetched before the first probe.
+  size_t FindFirst(const uint64 *hashes, size_t size) const;
+
   // Returns the size (in bytes) of the bloom filter
   size_t Size() const;
 
@@ -87,16 +110,21 @@ class ExistenceFilter {
   class BlockBitmap;
 
   // private constructor for ExistenceFilter::Read();
-  ExistenceFilter(uint32 m, uint32 n, int k, bool is_mutable);
+  ExistenceFilter(uint32 m, uint32 n, int k, Format format, bool is_mutable);
 
   static ExistenceFilter *CreateImmutableExietenceFilter(uint32 m,
                                                          uint32 n,
-                                                         int k);
+                                                         int k,
+                                                         Format format);
+
+  // Returns the index of the first bit of the block for |hash| in BLOCKED.
+  uint32 GetBlockOffset(uint64 hash) const;
 
   std::unique_ptr<BlockBitmap> rep_;  // points to bitmap
   const uint32 vec_size_;  // size of bitmap (in bits)
   const uint32 expected_nelts_;  // expected number of inserts
   const int32 num_hashes_;  // number of hashes per lookup
+  const Format format_;
 
   DISALLOW_COPY_AND_ASSIGN(ExistenceFilter);
 };
@@ -0,0 +1,248 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "storage/existence_filter_builder.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "base/logging.h"
+
+namespace mozc {
+namespace storage {
+namespace {
+
+// Bits of a block of the BLOCKED format.
+const uint32 kBlockBits = 512;
+// The sizes are searched in these units, i.e. a word of the bit vector for
+// CLASSIC and a block for BLOCKED.
+const size_t kClassicUnitBytes = 4;
+const size_t kBlockedUnitBytes = kBlockBits / 8;
+// The number of bits has to fit in uint32.
+const size_t kMaxFilterBytes = (static_cast<size_t>(1) << 29) -
+    kBlockedUnitBytes;
+const int kMaxNumHashes = 7;
+
+struct Candidate {
+  Candidate() : found(false), size_in_bytes(0) {}
+
+  bool found;
+  size_t size_in_bytes;
+  ExistenceFilterBuilder::Parameters parameters;
+};
+
+void SetCandidate(size_t size_in_bytes, uint32 n, int k,
+                  ExistenceFilter::Format format, double error_rate,
+                  Candidate *candidate) {
+  candidate->found = true;
+  candidate->size_in_bytes = size_in_bytes;
+  candidate->parameters.header.m = static_cast<uint32>(size_in_bytes * 8);
+  candidate->parameters.header.n = n;
+  candidate->parameters.header.k = k;
+  candidate->parameters.header.format = format;
+  candidate->parameters.estimated_error_rate = error_rate;
+}
+
+}  // namespace
+
+ExistenceFilterBuilder::Options::Options()
+    : target_error_rate(0.01),
+      min_bytes(0),
+      max_bytes(0),
+      max_blocked_overhead(0.25) {}
+
+// static
+double ExistenceFilterBuilder::EstimateErrorRate(
+    uint32 m, uint32 n, int k, ExistenceFilter::Format format) {
+  if (n == 0) {
+    return 0.0;
+  }
+  if (m == 0) {
+    return 1.0;
+  }
+  if (format == ExistenceFilter::CLASSIC) {
+    return pow(1.0 - exp(-1.0 * k * n / m), k);
+  }
+
+  // A block with i values has a bit set with the probability
+  // 1 - (1 - 1/512)^(k * i).  The terms far from the mean are negligible.
+  const double num_blocks = std::max<uint32>(m / kBlockBits, 1);
+  const double lambda = n / num_blocks;
+  const double log_lambda = log(lambda);
+  const double log_unset = log(1.0 - 1.0 / kBlockBits);
+  const double spread = 10.0 * sqrt(lambda) + 10.0;
+  const int begin = static_cast<int>(std::max(0.0, floor(lambda - spread)));
+  const int end = static_cast<int>(ceil(lambda + spread));
+  double error_rate = 0.0;
+  for (int i = begin; i <= end; ++i) {
+    const double probability = exp(-lambda + i * log_lambda - lgamma(i + 1.0));
+    error_rate += probability * pow(1.0 - exp(log_unset * k * i), k);
+  }
+  return std::min(error_rate, 1.0);
+}
+
+// static
+bool ExistenceFilterBuilder::ChooseParameters(uint32 n, const Options &options,
+                                              Parameters *parameters) {
+  DCHECK(parameters);
+  const ExistenceFilter::Format kFormats[] = {
+    ExistenceFilter::CLASSIC, ExistenceFilter::BLOCKED,
+  };
+  Candidate best[arraysize(kFormats)];
+  // The most accurate filter within the budget, used if none meets the
+  // target.
+  Candidate most_accurate;
+
+  const size_t max_bytes =
+      (options.max_bytes == 0) ? kMaxFilterBytes :
+      std::min(options.max_bytes, kMaxFilterBytes);
+  for (size_t i = 0; i < arraysize(kFormats); ++i) {
+    const ExistenceFilter::Format format = kFormats[i];
+    if (format == ExistenceFilter::BLOCKED &&
+        options.max_blocked_overhead < 0) {
+      continue;
+    }
+    const size_t unit = (format == ExistenceFilter::BLOCKED) ?
+        kBlockedUnitBytes : kClassicUnitBytes;
+    const size_t min_units =
+        std::max<size_t>((options.min_bytes + unit - 1) / unit, 1);
+    const size_t max_units = std::max(max_bytes / unit, min_units);
+
+    for (int k = 1; k <= kMaxNumHashes; ++k) {
+      const double max_size_error_rate =
+          EstimateErrorRate(max_units * unit * 8, n, k, format);
+      if (!most_accurate.found ||
+          max_size_error_rate <
+          most_accurate.parameters.estimated_error_rate) {
+        SetCandidate(max_units * unit, n, k, format, max_size_error_rate,
+                     &most_accurate);
+      }
+      if (max_size_error_rate > options.target_error_rate) {
+        continue;
+      }
+
+      // The error rate decreases as the filter grows.
+      size_t low = min_units;
+      size_t high = max_units;
+      while (low < high) {
+        const size_t middle = low + (high - low) / 2;
+        if (EstimateErrorRate(middle * unit * 8, n, k, format) <=
+            options.target_error_rate) {
+          high = middle;
+        } else {
+          low = middle + 1;
+        }
+      }
+      const double error_rate = EstimateErrorRate(low * unit * 8, n, k,
+                                                  format);
+      // At the same size, e.g. at |min_bytes|, the more accurate one wins.
+      if (!best[i].found || low * unit < best[i].size_in_bytes ||
+          (low * unit == best[i].size_in_bytes &&
+           error_rate < best[i].parameters.estimated_error_rate)) {
+        SetCandidate(low * unit, n, k, format, error_rate, &best[i]);
+      }
+    }
+  }
+
+  const Candidate &classic = best[0];
+  const Candidate &blocked = best[1];
+  if (blocked.found &&
+      (!classic.found ||
+       blocked.size_in_bytes <=
+       classic.size_in_bytes * (1.0 + options.max_blocked_overhead))) {
+    *parameters = blocked.parameters;
+    return true;
+  }
+  if (classic.found) {
+    *parameters = classic.parameters;
+    return true;
+  }
+  *parameters = most_accurate.parameters;
+  return false;
+}
+
+// static
+ExistenceFilter *ExistenceFilterBuilder::Build(
+    const std::vector<uint64> &values, const std::vector<uint64> &holdout,
+    const Options &options, Report *report) {
+  Report local_report;
+  if (report == NULL) {
+    report = &local_report;
+  }
+
+  Parameters &parameters = report->parameters;
+  report->meets_target =
+      ChooseParameters(values.size(), options, &parameters);
+  const ExistenceFilter::Header &header = parameters.header;
+  ExistenceFilter *filter =
+      new ExistenceFilter(header.m, header.n, header.k, header.format);
+  for (size_t i = 0; i < values.size(); ++i) {
+    filter->Insert(values[i]);
+  }
+  report->size_in_bytes = filter->Size();
+
+  std::vector<uint64> sorted_values(values);
+  std::sort(sorted_values.begin(), sorted_values.end());
+  report->num_holdout = 0;
+  report->num_false_positives = 0;
+  for (size_t i = 0; i < holdout.size(); ++i) {
+    if (std::binary_search(sorted_values.begin(), sorted_values.end(),
+                           holdout[i])) {
+      continue;
+    }
+    ++report->num_holdout;
+    if (filter->Exists(holdout[i])) {
+      ++report->num_false_positives;
+    }
+  }
+  report->measured_error_rate =
+      (report->num_holdout == 0) ? 0.0 :
+      static_cast<double>(report->num_false_positives) / report->num_holdout;
+  if (report->num_holdout > 0 &&
+      report->measured_error_rate > options.target_error_rate) {
+    report->meets_target = false;
+  }
+
+  LOG(INFO) << "ExistenceFilter: m " << header.m << " n " << header.n
+            << " k " << header.k << " format " << header.format
+            << " bytes " << report->size_in_bytes
+            << " estimated error rate " << parameters.estimated_error_rate
+            << " measured error rate " << report->measured_error_rate
+            << " (" << report->num_false_positives << "/"
+            << report->num_holdout << ")";
+  if (!report->meets_target) {
+    LOG(WARNING) << "The filter does not meet the target error rate "
+                 << options.target_error_rate;
+  }
+  return filter;
+}
+
+}  // namespace storage
+}  // namespace mozc
@@ -0,0 +1,109 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef MOZC_STORAGE_EXISTENCE_FILTER_BUILDER_H_
+#define MOZC_STORAGE_EXISTENCE_FILTER_BUILDER_H_
+
+#include <vector>
+
+#include "base/port.h"
+#include "storage/existence_filter.h"
+
+namespace mozc {
+namespace storage {
+
+// Chooses the parameters of an ExistenceFilter for a target false positive
+// rate and a memory budget, and builds the filter.  Used by the data
+// generators instead of hand-picked (m, n, k).
+class ExistenceFilterBuilder {
+ public:
+  struct Options {
+    Options();
+
+    // The false positive rate to achieve.
+    double target_error_rate;
+    // Bounds of the size of the bit vector in bytes.  0 for |max_bytes|
+    // means no limit other than the one of the format.
+    size_t min_bytes;
+    size_t max_bytes;
+    // BLOCKED is chosen when it is at most this ratio larger than CLASSIC
+    // for the same target, as its lookup touches only one cache line.
+    // Negative for never.
+    double max_blocked_overhead;
+  };
+
+  struct Parameters {
+    // m, n, k and format of the filter.
+    ExistenceFilter::Header header;
+    double estimated_error_rate;
+  };
+
+  struct Report {
+    Parameters parameters;
+    size_t size_in_bytes;
+    // Number of the holdout values not inserted into the filter, and the
+    // number of them the filter accepts.
+    size_t num_holdout;
+    size_t num_false_positives;
+    // num_false_positives / num_holdout, or 0 without holdout values.
+    double measured_error_rate;
+    // False if the estimated or the measured error rate exceeds the target.
+    bool meets_target;
+  };
+
+  // Returns the expected false positive rate of a filter of |m| bits with
+  // |n| values and |k| hashes.  For BLOCKED, the number of values per block
+  // is modeled as a Poisson distribution.
+  static double EstimateErrorRate(uint32 m, uint32 n, int k,
+                                  ExistenceFilter::Format format);
+
+  // Chooses the smallest filter for |n| values that meets the target of
+  // |options|.  Returns false if no filter within |options.max_bytes| meets
+  // it, in which case |parameters| is the most accurate filter of the
+  // budget.
+  static bool ChooseParameters(uint32 n, const Options &options,
+                               Parameters *parameters);
+
+  // Builds a filter of |values| with the parameters chosen for |options|
+  // and measures its false positive rate against |holdout|, the values
+  // which must not be accepted.  The holdout values found in |values| are
+  // ignored.  |report| can be NULL.  The caller owns the returned filter.
+  static ExistenceFilter *Build(const std::vector<uint64> &values,
+                                const std::vector<uint64> &holdout,
+                                const Options &options, Report *report);
+
+ private:
+  DISALLOW_IMPLICIT_CONSTRUCTORS(ExistenceFilterBuilder);
+};
+
+}  // namespace storage
+}  // namespace mozc
+
+#endif  // MOZC_STORAGE_EXISTENCE_FILTER_BUILDER_H_
@@ -0,0 +1,147 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "storage/existence_filter_builder.h"
+
+#include <memory>
+#include <vector>
+
+#include "base/hash.h"
+#include "base/port.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace storage {
+namespace {
+
+void MakeValues(int begin, int end, std::vector<uint64> *values) {
+  for (int i = begin; i < end; ++i) {
+    values->push_back(Hash::Fingerprint(i));
+  }
+}
+
+TEST(ExistenceFilterBuilderTest, EstimateErrorRate) {
+  // (1 - e^(-kn/m))^k
+  EXPECT_NEAR(0.0216,
+              ExistenceFilterBuilder::EstimateErrorRate(
+                  8000, 1000, 5, ExistenceFilter::CLASSIC),
+              0.0001);
+  EXPECT_EQ(0.0, ExistenceFilterBuilder::EstimateErrorRate(
+      8192, 0, 5, ExistenceFilter::BLOCKED));
+
+  // The uneven load of the blocks costs some accuracy.
+  const double classic = ExistenceFilterBuilder::EstimateErrorRate(
+      1 << 20, 100000, 7, ExistenceFilter::CLASSIC);
+  const double blocked = ExistenceFilterBuilder::EstimateErrorRate(
+      1 << 20, 100000, 7, ExistenceFilter::BLOCKED);
+  EXPECT_LT(classic, blocked);
+  EXPECT_LT(blocked, classic * 2);
+}
+
+TEST(ExistenceFilterBuilderTest, ChooseParameters) {
+  ExistenceFilterBuilder::Options options;
+  options.target_error_rate = 0.001;
+  ExistenceFilterBuilder::Parameters parameters;
+  ASSERT_TRUE(ExistenceFilterBuilder::ChooseParameters(10000, options,
+                                                       &parameters));
+  EXPECT_EQ(ExistenceFilter::BLOCKED, parameters.header.format);
+  EXPECT_EQ(10000, parameters.header.n);
+  EXPECT_EQ(0, parameters.header.m % 512);
+  EXPECT_LE(parameters.estimated_error_rate, 0.001);
+  const uint32 blocked_m = parameters.header.m;
+
+  // The smallest classic filter is not much smaller than the estimate for
+  // the optimal k.
+  options.max_blocked_overhead = -1.0;
+  ASSERT_TRUE(ExistenceFilterBuilder::ChooseParameters(10000, options,
+                                                       &parameters));
+  EXPECT_EQ(ExistenceFilter::CLASSIC, parameters.header.format);
+  EXPECT_LE(parameters.estimated_error_rate, 0.001);
+  EXPECT_LE(parameters.header.m, blocked_m);
+  EXPECT_GE(parameters.header.m / 8,
+            ExistenceFilter::MinFilterSizeInBytesForErrorRate(0.001, 10000));
+  EXPECT_LE(parameters.header.m / 8,
+            ExistenceFilter::MinFilterSizeInBytesForErrorRate(0.001, 10000) +
+            4);
+
+  // The minimum size makes the filter more accurate than the target.
+  options.min_bytes = 1 << 20;
+  ASSERT_TRUE(ExistenceFilterBuilder::ChooseParameters(10000, options,
+                                                       &parameters));
+  EXPECT_EQ(8 << 20, parameters.header.m);
+  EXPECT_EQ(7, parameters.header.k);
+
+  // Too small budget.
+  options.min_bytes = 0;
+  options.max_bytes = 1000;
+  options.max_blocked_overhead = 0.25;
+  EXPECT_FALSE(ExistenceFilterBuilder::ChooseParameters(10000, options,
+                                                        &parameters));
+  EXPECT_LE(parameters.header.m / 8, 1000);
+  EXPECT_GT(parameters.estimated_error_rate, 0.001);
+}
+
+TEST(ExistenceFilterBuilderTest, Build) {
+  std::vector<uint64> values;
+  MakeValues(0, 20000, &values);
+  std::vector<uint64> holdout;
+  // The first values are in the filter and not counted.
+  MakeValues(10000, 210000, &holdout);
+
+  ExistenceFilterBuilder::Options options;
+  options.target_error_rate = 0.01;
+  ExistenceFilterBuilder::Report report;
+  std::unique_ptr<ExistenceFilter> filter(
+      ExistenceFilterBuilder::Build(values, holdout, options, &report));
+  ASSERT_TRUE(filter.get());
+  for (size_t i = 0; i < values.size(); ++i) {
+    EXPECT_TRUE(filter->Exists(values[i]));
+  }
+  EXPECT_EQ(filter->Size(), report.size_in_bytes);
+  EXPECT_EQ(190000, report.num_holdout);
+  EXPECT_TRUE(report.meets_target);
+  EXPECT_LT(report.measured_error_rate, 0.01);
+  EXPECT_GT(report.measured_error_rate,
+            report.parameters.estimated_error_rate / 2);
+
+  char *buf = NULL;
+  size_t size = 0;
+  filter->Write(&buf, &size);
+  ExistenceFilter::Header header;
+  ASSERT_TRUE(ExistenceFilter::ReadHeader(buf, &header));
+  EXPECT_EQ(report.parameters.header.m, header.m);
+  EXPECT_EQ(report.parameters.header.k, header.k);
+  EXPECT_EQ(report.parameters.header.format, header.format);
+  delete [] buf;
+}
+
+}  // namespace
+}  // namespace storage
+}  // namespace mozc
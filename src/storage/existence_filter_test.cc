@@ -43,7 +43,8 @@ namespace mozc {
 namespace storage {
 namespace {
 
-void CheckValues(ExistenceFilter* filter, int m, int n) {
+// Returns the number of false positives.
+int CheckValues(ExistenceFilter* filter, int m, int n) {
   int false_positives = 0;
   for (int i = 0; i < 2 * n; ++i) {
     uint64 hash = Hash::Fingerprint(i);
@@ -59,11 +60,12 @@ void CheckValues(ExistenceFilter* filter, int m, int n) {
   }
 
   LOG(INFO) << "false_positives: " << false_positives;
+  return false_positives;
 }
 
-void RunTest(int m, int n) {
-  LOG(INFO) << "Test " << m << " " << n;
-  ExistenceFilter *filter = ExistenceFilter::CreateOptimal(m, n);
+void RunTest(int m, int n, ExistenceFilter::Format format) {
+  LOG(INFO) << "Test " << m << " " << n << " " << format;
+  ExistenceFilter *filter = ExistenceFilter::CreateOptimal(m, n, format);
 
   for (int i = 0; i < n; ++i) {
     int val = i * 2;
@@ -71,14 +73,23 @@ void RunTest(int m, int n) {
     filter->Insert(hash);
   }
 
-  CheckValues(filter, m, n);
+  const int false_positives = CheckValues(filter, m, n);
+  // The filters are built for 1% of false positives.  The blocked filter
+  // has a few more.
+  EXPECT_LT(false_positives, n / 50);
 
   char *buf = NULL;
   size_t size = 0;
   filter->Write(&buf, &size);
   LOG(INFO) << "write size: " << size;
+  EXPECT_EQ(12 + filter->Size(), size);
+
+  ExistenceFilter::Header header;
+  ASSERT_TRUE(ExistenceFilter::ReadHeader(buf, &header));
+  EXPECT_EQ(format, header.format);
+
   ExistenceFilter *filter2 = ExistenceFilter::Read(buf, size);
-  CheckValues(filter2, m, n);
+  EXPECT_EQ(false_positives, CheckValues(filter2, m, n));
   delete filter2;
   delete[] buf;
 
@@ -90,7 +101,40 @@ void RunTest(int m, int n) {
 TEST(ExistenceFilterTest, RunTest) {
   int n = 50000;
   int m = ExistenceFilter::MinFilterSizeInBytesForErrorRate(0.01, 50000);
-  RunTest(m, n);
+  RunTest(m, n, ExistenceFilter::CLASSIC);
+}
+
+TEST(ExistenceFilterTest, RunTestBlocked) {
+  int n = 50000;
+  int m = ExistenceFilter::MinFilterSizeInBytesForErrorRate(0.01, 50000);
+  RunTest(m, n, ExistenceFilter::BLOCKED);
+}
+
+TEST(ExistenceFilterTest, ReadHeaderTest) {
+  std::unique_ptr<ExistenceFilter> filter(
+      ExistenceFilter::CreateOptimal(100, 10, ExistenceFilter::BLOCKED));
+  char *buf = NULL;
+  size_t size = 0;
+  filter->Write(&buf, &size);
+
+  ExistenceFilter::Header header;
+  ASSERT_TRUE(ExistenceFilter::ReadHeader(buf, &header));
+  // The size is rounded up to a multiple of the 512-bit block.
+  EXPECT_EQ(1024, header.m);
+  EXPECT_EQ(10, header.n);
+  EXPECT_EQ(ExistenceFilter::BLOCKED, header.format);
+
+  // Unknown formats are rejected.
+  buf[9] = 2;
+  EXPECT_FALSE(ExistenceFilter::ReadHeader(buf, &header));
+  buf[9] = 1;
+
+  // The blocked filter must consist of whole blocks.
+  const uint32 kBadSize = 1000;
+  memcpy(buf, &kBadSize, sizeof(kBadSize));
+  EXPECT_FALSE(ExistenceFilter::ReadHeader(buf, &header));
+
+  delete [] buf;
 }
 
 TEST(ExistenceFilterTest, MinFilterSizeEstimateTest) {
@@ -164,5 +208,28 @@ TEST(ExistenceFilterTest, InsertAndExistsTest) {
   }
 }
 
+TEST(ExistenceFilterTest, FindFirstTest) {
+  const ExistenceFilter::Format kFormats[] = {
+    ExistenceFilter::CLASSIC, ExistenceFilter::BLOCKED,
+  };
+  for (size_t i = 0; i < arraysize(kFormats); ++i) {
+    std::unique_ptr<ExistenceFilter> filter(
+        ExistenceFilter::CreateOptimal(1024, 3, kFormats[i]));
+    filter->Insert(Hash::Fingerprint("b"));
+    filter->Insert(Hash::Fingerprint("d"));
+
+    const uint64 kHashes[] = {
+      Hash::Fingerprint("a"), Hash::Fingerprint("b"),
+      Hash::Fingerprint("c"), Hash::Fingerprint("d"),
+    };
+    EXPECT_EQ(1, filter->FindFirst(kHashes, arraysize(kHashes)));
+    EXPECT_EQ(1, filter->FindFirst(kHashes + 2, 2));
+    EXPECT_EQ(0, filter->FindFirst(kHashes + 3, 1));
+    // Returns the size if none exists.
+    EXPECT_EQ(1, filter->FindFirst(kHashes, 1));
+    EXPECT_EQ(0, filter->FindFirst(kHashes, 0));
+  }
+}
+
 }  // namespace storage
 }  // namespace mozc
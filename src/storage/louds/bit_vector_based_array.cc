@@ -44,6 +44,30 @@ inline int ReadInt32(const uint8 *data) {
   return *reinterpret_cast<const int32*>(data);
 }
 
+// Returns the number of consecutive 1-bits from the |index|-th bit of |bits|,
+// in the same bit order as SimpleSuccinctBitVectorIndex::Get().
+inline int CountOnes(const uint8 *bits, int index) {
+  const uint8 *ptr = bits + index / 8;
+  const int shift = index % 8;
+  uint32 byte = *ptr >> shift;
+  int count = 0;
+  while (byte & 1) {
+    ++count;
+    byte >>= 1;
+  }
+  if (count < 8 - shift) {
+    return count;
+  }
+  // Skip the bytes of all 1-bits at once.
+  for (++ptr; *ptr == 0xFF; ++ptr) {
+    count += 8;
+  }
+  for (byte = *ptr; byte & 1; byte >>= 1) {
+    ++count;
+  }
+  return count;
+}
+
 }  // namespace
 
 void BitVectorBasedArray::Open(const uint8 *image) {
@@ -54,6 +78,7 @@ void BitVectorBasedArray::Open(const uint8 *image) {
   CHECK_EQ(ReadInt32(image + 12), 0);
 
   index_.Init(image + 16, index_length, kLb0CacheSize, kLb1CacheSize);
+  bits_ = image + 16;
   base_length_ = base_length;
   step_length_ = step_length;
   data_ = reinterpret_cast<const char*>(image + 16 + index_length);
@@ -61,6 +86,7 @@ void BitVectorBasedArray::Open(const uint8 *image) {
 
 void BitVectorBasedArray::Close() {
   index_.Reset();
+  bits_ = nullptr;
   base_length_ = 0;
   step_length_ = 0;
   data_ = 0;
@@ -80,6 +106,29 @@ const char *BitVectorBasedArray::Get(size_t index, size_t *length) const {
   return data_ + data_index;
 }
 
+void BitVectorBasedArray::GetRange(size_t begin, size_t num,
+                                   const char **elements,
+                                   size_t *lengths) const {
+  DCHECK(elements);
+  if (num == 0) {
+    return;
+  }
+  int bit_index = index_.Select0(begin + 1);
+  const char *data =
+      data_ + base_length_ * begin + step_length_ * index_.Rank1(bit_index);
+  for (size_t i = 0; i < num; ++i) {
+    // Each element is a 0-bit followed by 1-bits, as many as the steps.
+    const int num_steps = CountOnes(bits_, bit_index + 1);
+    const size_t length = base_length_ + step_length_ * num_steps;
+    elements[i] = data;
+    if (lengths != nullptr) {
+      lengths[i] = length;
+    }
+    data += length;
+    bit_index += num_steps + 1;
+  }
+}
+
 }  // namespace louds
 }  // namespace storage
 }  // namespace mozc
@@ -41,7 +41,7 @@ namespace louds {
 // supporting Rank/Select operations.
 class BitVectorBasedArray {
  public:
-  BitVectorBasedArray() {
+  BitVectorBasedArray() : bits_(nullptr) {
   }
 
   void Open(const uint8 *image);
@@ -51,8 +51,20 @@ class BitVectorBasedArray {
   // Note: the result may contain '\0' chars, or may NOT be '\0'-terminated.
   const char *Get(size_t index, size_t *length) const;
 
+  // Same as calling Get() for each of the |num| elements starting at |begin|,
+  // but locates only the first element with the index and reads the rest in
+  // one sequential pass over the bit vector and the data.  |elements| and
+  // |lengths| must have |num| slots.  |lengths| can be nullptr.
+  void GetRange(size_t begin, size_t num,
+                const char **elements, size_t *lengths) const;
+
+  // Returns the size of the index allocated in heap, in bytes.
+  size_t GetHeapMemoryUsage() const { return index_.GetHeapMemoryUsage(); }
+
  private:
   SimpleSuccinctBitVectorIndex index_;
+  // The bit vector indexed by |index_|.
+  const uint8 *bits_;
   size_t base_length_;
   size_t step_length_;
   const char *data_;
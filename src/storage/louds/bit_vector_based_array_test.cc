@@ -82,4 +82,37 @@ TEST_F(BitVectorBasedArrayTest, Get) {
 
   array.Close();
 }
+
+TEST_F(BitVectorBasedArrayTest, GetRange) {
+  // Lengths up to 40 bytes make runs of 1-bits longer than a byte.
+  const size_t kNumElements = 300;
+  BitVectorBasedArrayBuilder builder;
+  for (size_t i = 0; i < kNumElements; ++i) {
+    builder.Add(string(i * 7 % 41, static_cast<char>('a' + i % 26)));
+  }
+  builder.SetSize(2, 1);
+  builder.Build();
+
+  BitVectorBasedArray array;
+  array.Open(reinterpret_cast<const uint8*>(builder.image().data()));
+  const char *elements[kNumElements];
+  size_t lengths[kNumElements];
+  for (size_t begin = 0; begin < kNumElements; begin += 37) {
+    const size_t num = kNumElements - begin;
+    array.GetRange(begin, num, elements, lengths);
+    for (size_t i = 0; i < num; ++i) {
+      size_t length;
+      const char *expected = array.Get(begin + i, &length);
+      EXPECT_EQ(expected, elements[i]) << begin + i;
+      EXPECT_EQ(length, lengths[i]) << begin + i;
+    }
+  }
+
+  // |lengths| is optional.
+  array.GetRange(10, 5, elements, nullptr);
+  size_t length;
+  EXPECT_EQ(array.Get(14, &length), elements[4]);
+
+  array.Close();
+}
 }  // namespace
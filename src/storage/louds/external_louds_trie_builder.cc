@@ -0,0 +1,445 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "storage/louds/external_louds_trie_builder.h"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/file_stream.h"
+#include "base/file_util.h"
+#include "base/logging.h"
+#include "base/port.h"
+#include "base/util.h"
+
+namespace mozc {
+namespace storage {
+namespace louds {
+namespace {
+
+const size_t kCopyBufferSize = 1 << 16;
+
+// A word is stored in a temporary file as its 32-bit length in little endian
+// followed by its bytes.
+void WriteWord(const string &word, std::ostream *os) {
+  const uint32 length = static_cast<uint32>(word.size());
+  const char header[4] = {
+    static_cast<char>(length & 0xFF),
+    static_cast<char>((length >> 8) & 0xFF),
+    static_cast<char>((length >> 16) & 0xFF),
+    static_cast<char>((length >> 24) & 0xFF),
+  };
+  os->write(header, sizeof(header));
+  os->write(word.data(), word.size());
+}
+
+bool ReadWord(std::istream *is, string *word) {
+  unsigned char header[4];
+  if (!is->read(reinterpret_cast<char *>(header), sizeof(header))) {
+    return false;
+  }
+  const uint32 length = header[0] | (header[1] << 8) | (header[2] << 16) |
+                        (static_cast<uint32>(header[3]) << 24);
+  word->resize(length);
+  return length == 0 || is->read(&(*word)[0], length);
+}
+
+// Reads the words of a temporary file one by one.
+class WordReader {
+ public:
+  explicit WordReader(const string &path)
+      : stream_(path.c_str(), std::ios_base::in | std::ios_base::binary),
+        done_(!stream_) {
+  }
+
+  bool ok() const { return !!stream_ || stream_.eof(); }
+  bool done() const { return done_; }
+  const string &word() const { return word_; }
+
+  // Reads the next word.  Returns false at the end of the file.
+  bool Next() {
+    done_ = done_ || !ReadWord(&stream_, &word_);
+    return !done_;
+  }
+
+ private:
+  InputFileStream stream_;
+  string word_;
+  bool done_;
+
+  DISALLOW_COPY_AND_ASSIGN(WordReader);
+};
+
+class WordReaderGreater {
+ public:
+  bool operator()(const WordReader *lhs, const WordReader *rhs) const {
+    return lhs->word() > rhs->word();
+  }
+};
+
+// Same as BitStream but flushes the bytes to a file.
+class BitFileStream {
+ public:
+  explicit BitFileStream(const string &path)
+      : stream_(path.c_str(), std::ios_base::out | std::ios_base::binary),
+        byte_size_(0), num_bits_(0) {
+  }
+
+  bool ok() const { return !!stream_; }
+  size_t ByteSize() const { return byte_size_; }
+
+  void PushBit(int bit) {
+    DCHECK(bit == 0 || bit == 1);
+    const size_t shift = num_bits_ % 8;
+    if (shift == 0) {
+      if (buffer_.size() >= kCopyBufferSize) {
+        Flush();
+      }
+      buffer_.push_back('\0');
+      ++byte_size_;
+    }
+    *buffer_.rbegin() |= (bit & 1) << shift;
+    ++num_bits_;
+  }
+
+  // Fills the padding (0-bit) until the size is aligned to 32bit boundary,
+  // and flushes the file.
+  void FillPadding32AndFlush() {
+    const size_t remaining = byte_size_ % 4;
+    if (remaining != 0) {
+      buffer_.append(4 - remaining, '\0');
+      byte_size_ += 4 - remaining;
+    }
+    num_bits_ = byte_size_ * 8;
+    Flush();
+    stream_.close();
+  }
+
+ private:
+  void Flush() {
+    stream_.write(buffer_.data(), buffer_.size());
+    buffer_.clear();
+  }
+
+  OutputFileStream stream_;
+  string buffer_;
+  size_t byte_size_;
+  size_t num_bits_;
+
+  DISALLOW_COPY_AND_ASSIGN(BitFileStream);
+};
+
+void PushInt(size_t value, string* image) {
+  // Make sure the value is fit in the 32-bit value.
+  CHECK_EQ(value & ~0xFFFFFFFF, 0);
+
+  // Output LSB to MSB.
+  image->push_back(static_cast<char>(value & 0xFF));
+  image->push_back(static_cast<char>((value >> 8) & 0xFF));
+  image->push_back(static_cast<char>((value >> 16) & 0xFF));
+  image->push_back(static_cast<char>((value >> 24) & 0xFF));
+}
+
+bool AppendFile(const string &path, std::ostream *os) {
+  InputFileStream is(path.c_str(), std::ios_base::in | std::ios_base::binary);
+  if (!is) {
+    return false;
+  }
+  std::unique_ptr<char[]> buffer(new char[kCopyBufferSize]);
+  while (is.read(buffer.get(), kCopyBufferSize) || is.gcount() > 0) {
+    os->write(buffer.get(), is.gcount());
+  }
+  return !!*os;
+}
+
+}  // namespace
+
+ExternalLoudsTrieBuilder::ExternalLoudsTrieBuilder(const string &temp_dir,
+                                                   size_t max_buffer_size)
+    : temp_dir_(temp_dir),
+      max_buffer_size_(max_buffer_size),
+      built_(false),
+      buffer_size_(0) {
+}
+
+ExternalLoudsTrieBuilder::~ExternalLoudsTrieBuilder() {
+  for (size_t i = 0; i < temp_paths_.size(); ++i) {
+    if (FileUtil::FileExists(temp_paths_[i])) {
+      FileUtil::Unlink(temp_paths_[i]);
+    }
+  }
+}
+
+bool ExternalLoudsTrieBuilder::Add(const string &word) {
+  CHECK(!built_);
+  CHECK(!word.empty());
+  buffer_.push_back(word);
+  buffer_size_ += word.size() + sizeof(string);
+  if (buffer_size_ < max_buffer_size_) {
+    return true;
+  }
+  return FlushBuffer();
+}
+
+bool ExternalLoudsTrieBuilder::Build(const string &output_path,
+                                     const IdCallback &id_callback) {
+  CHECK(!built_);
+  built_ = true;
+
+  if (!FlushBuffer()) {
+    return false;
+  }
+  const string sorted_path = NewTempFile();
+  if (!MergeRuns(sorted_path) || !WriteTrie(sorted_path, output_path)) {
+    return false;
+  }
+  return !id_callback || CallIdCallback(sorted_path, id_callback);
+}
+
+bool ExternalLoudsTrieBuilder::FlushBuffer() {
+  if (buffer_.empty()) {
+    return true;
+  }
+  std::sort(buffer_.begin(), buffer_.end());
+  buffer_.erase(std::unique(buffer_.begin(), buffer_.end()), buffer_.end());
+
+  const string path = NewTempFile();
+  OutputFileStream os(path.c_str(),
+                      std::ios_base::out | std::ios_base::binary);
+  for (size_t i = 0; i < buffer_.size(); ++i) {
+    WriteWord(buffer_[i], &os);
+  }
+  os.close();
+  if (!os) {
+    LOG(ERROR) << "Failed to write " << path;
+    return false;
+  }
+  run_paths_.push_back(path);
+
+  // Releases the memory, not only the words.
+  std::vector<string>().swap(buffer_);
+  buffer_size_ = 0;
+  return true;
+}
+
+bool ExternalLoudsTrieBuilder::MergeRuns(const string &sorted_path) {
+  std::vector<std::unique_ptr<WordReader>> readers;
+  std::vector<WordReader *> heap;
+  for (size_t i = 0; i < run_paths_.size(); ++i) {
+    readers.emplace_back(new WordReader(run_paths_[i]));
+    if (readers.back()->Next()) {
+      heap.push_back(readers.back().get());
+    }
+  }
+  std::make_heap(heap.begin(), heap.end(), WordReaderGreater());
+
+  OutputFileStream os(sorted_path.c_str(),
+                      std::ios_base::out | std::ios_base::binary);
+  string last_word;
+  while (!heap.empty()) {
+    std::pop_heap(heap.begin(), heap.end(), WordReaderGreater());
+    WordReader *reader = heap.back();
+    if (reader->word() != last_word) {
+      last_word = reader->word();
+      WriteWord(last_word, &os);
+      if (length_counts_.size() <= last_word.size()) {
+        length_counts_.resize(last_word.size() + 1, 0);
+      }
+      ++length_counts_[last_word.size()];
+    }
+    if (reader->Next()) {
+      std::push_heap(heap.begin(), heap.end(), WordReaderGreater());
+    } else {
+      heap.pop_back();
+    }
+  }
+  os.close();
+
+  for (size_t i = 0; i < readers.size(); ++i) {
+    if (!readers[i]->ok()) {
+      LOG(ERROR) << "Failed to read " << run_paths_[i];
+      return false;
+    }
+  }
+  if (!os) {
+    LOG(ERROR) << "Failed to write " << sorted_path;
+    return false;
+  }
+
+  // The runs are no longer needed.
+  for (size_t i = 0; i < run_paths_.size(); ++i) {
+    FileUtil::Unlink(run_paths_[i]);
+  }
+  run_paths_.clear();
+  return true;
+}
+
+bool ExternalLoudsTrieBuilder::WriteTrie(const string &sorted_path,
+                                         const string &output_path) {
+  const string trie_path = NewTempFile();
+  const string terminal_path = NewTempFile();
+  const string edge_path = NewTempFile();
+  BitFileStream trie_stream(trie_path);
+  BitFileStream terminal_stream(terminal_path);
+  OutputFileStream edge_stream(edge_path.c_str(),
+                               std::ios_base::out | std::ios_base::binary);
+  string edge_character;
+  size_t num_edges = 0;
+
+  // Push root.
+  trie_stream.PushBit(1);
+  trie_stream.PushBit(0);
+  edge_character.push_back('\0');
+  terminal_stream.PushBit(0);
+
+  // This is the traversal of LoudsTrieBuilder::Build(); see the comment
+  // there.  Instead of removing the terminal entries after each depth, each
+  // pass skips the words shorter than the depth.  The words as long as the
+  // depth are kept for the stop bits of the leaves.
+  for (size_t depth = 0; depth < length_counts_.size(); ++depth) {
+    WordReader reader(sorted_path);
+    auto next_entry = [&reader, depth](string *word) {
+      while (reader.Next()) {
+        if (reader.word().length() >= depth) {
+          *word = reader.word();
+          return true;
+        }
+      }
+      return false;
+    };
+
+    string prev, word, next;
+    bool has_prev = false;
+    bool has_word = next_entry(&word);
+    while (has_word) {
+      const bool has_next = next_entry(&next);
+      if (word.length() > depth &&
+          (!has_prev ||
+           // Same as LoudsTrieBuilder::Build().
+           word.compare(0, depth + 1, prev.c_str(), 0, depth + 1) != 0)) {
+        // This is the first string of this node. Output an edge.
+        trie_stream.PushBit(1);
+        edge_character.push_back(word[depth]);
+        if (word.length() == depth + 1) {
+          // This is a terminal node.
+          terminal_stream.PushBit(1);
+        } else {
+          terminal_stream.PushBit(0);
+        }
+      }
+
+      if (!has_next || word.compare(0, depth, next, 0, depth) != 0) {
+        // This is the last child (string) for the parent.
+        trie_stream.PushBit(0);
+      }
+
+      prev.swap(word);
+      word.swap(next);
+      has_prev = true;
+      has_word = has_next;
+    }
+    if (!reader.ok()) {
+      LOG(ERROR) << "Failed to read " << sorted_path;
+      return false;
+    }
+
+    if (edge_character.size() >= kCopyBufferSize) {
+      num_edges += edge_character.size();
+      edge_stream.write(edge_character.data(), edge_character.size());
+      edge_character.clear();
+    }
+  }
+  num_edges += edge_character.size();
+  edge_stream.write(edge_character.data(), edge_character.size());
+  edge_stream.close();
+
+  // Set 32-bits alignment.
+  trie_stream.FillPadding32AndFlush();
+  terminal_stream.FillPadding32AndFlush();
+  if (!trie_stream.ok() || !terminal_stream.ok() || !edge_stream) {
+    LOG(ERROR) << "Failed to write the trie to " << temp_dir_;
+    return false;
+  }
+
+  // Output
+  string header;
+  PushInt(trie_stream.ByteSize(), &header);
+  PushInt(terminal_stream.ByteSize(), &header);
+  // The num bits of each character annoated to each edge.
+  PushInt(8, &header);
+  PushInt(num_edges, &header);
+
+  OutputFileStream os(output_path.c_str(),
+                      std::ios_base::out | std::ios_base::binary);
+  os.write(header.data(), header.size());
+  if (!AppendFile(trie_path, &os) || !AppendFile(terminal_path, &os) ||
+      !AppendFile(edge_path, &os)) {
+    LOG(ERROR) << "Failed to write " << output_path;
+    return false;
+  }
+  os.close();
+  return !!os;
+}
+
+bool ExternalLoudsTrieBuilder::CallIdCallback(
+    const string &sorted_path, const IdCallback &id_callback) const {
+  // The terminals of each depth are output in the sorted order of the words,
+  // after all the shorter words.  So the id of a word is the number of the
+  // shorter words plus its rank among the words of the same length.
+  std::vector<int> next_ids(length_counts_.size(), 0);
+  int num_words = 0;
+  for (size_t length = 0; length < length_counts_.size(); ++length) {
+    next_ids[length] = num_words;
+    num_words += length_counts_[length];
+  }
+
+  WordReader reader(sorted_path);
+  while (reader.Next()) {
+    const string &word = reader.word();
+    id_callback(word, next_ids[word.size()]++);
+  }
+  if (!reader.ok()) {
+    LOG(ERROR) << "Failed to read " << sorted_path;
+    return false;
+  }
+  return true;
+}
+
+string ExternalLoudsTrieBuilder::NewTempFile() {
+  temp_paths_.push_back(FileUtil::JoinPath(
+      temp_dir_, Util::StringPrintf("louds_trie_builder.%p.%d", this,
+                                    static_cast<int>(temp_paths_.size()))));
+  return temp_paths_.back();
+}
+
+}  // namespace louds
+}  // namespace storage
+}  // namespace mozc
@@ -0,0 +1,100 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MOZC_STORAGE_LOUDS_EXTERNAL_LOUDS_TRIE_BUILDER_H_
+#define MOZC_STORAGE_LOUDS_EXTERNAL_LOUDS_TRIE_BUILDER_H_
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "base/port.h"
+
+namespace mozc {
+namespace storage {
+namespace louds {
+
+// Builds the same image as LoudsTrieBuilder for word lists that don't fit
+// in memory.  Added words are buffered up to |max_buffer_size| bytes, then
+// sorted and spilled to a run file in |temp_dir|.  Build() merges the runs
+// into one sorted file and makes a pass over it per depth of the trie,
+// streaming the bits and the edge characters to temporary files, which are
+// concatenated into the output file at the end.
+class ExternalLoudsTrieBuilder {
+ public:
+  // Receives each word with its key id, in the sorted order of the words.
+  // The ids are the same as LoudsTrieBuilder::GetId().
+  typedef std::function<void(const string &word, int id)> IdCallback;
+
+  ExternalLoudsTrieBuilder(const string &temp_dir, size_t max_buffer_size);
+  // Removes the temporary files.
+  ~ExternalLoudsTrieBuilder();
+
+  // Adds the word to the builder. It is necessary to call this method,
+  // before Build invocation.
+  bool Add(const string &word);
+
+  // Writes the trie image to |output_path| and calls |id_callback| for each
+  // word unless it is empty.  Returns false on an I/O error.
+  bool Build(const string &output_path, const IdCallback &id_callback);
+
+ private:
+  // Sorts |buffer_| and writes it to a new run file.
+  bool FlushBuffer();
+  // Merges the run files into |sorted_path|, removing the duplicates, and
+  // counts the words of each length into |length_counts_|.
+  bool MergeRuns(const string &sorted_path);
+  // Streams the LOUDS bits, the terminal bits and the edge characters of
+  // the words in |sorted_path| to |output_path|.
+  bool WriteTrie(const string &sorted_path, const string &output_path);
+  bool CallIdCallback(const string &sorted_path,
+                      const IdCallback &id_callback) const;
+
+  // Returns a new temporary file path, which is removed by the destructor.
+  string NewTempFile();
+
+  const string temp_dir_;
+  const size_t max_buffer_size_;
+  bool built_;
+
+  std::vector<string> buffer_;
+  size_t buffer_size_;
+  std::vector<string> run_paths_;
+  std::vector<string> temp_paths_;
+  // The number of the words for each length.
+  std::vector<size_t> length_counts_;
+
+  DISALLOW_COPY_AND_ASSIGN(ExternalLoudsTrieBuilder);
+};
+
+}  // namespace louds
+}  // namespace storage
+}  // namespace mozc
+
+#endif  // MOZC_STORAGE_LOUDS_EXTERNAL_LOUDS_TRIE_BUILDER_H_
@@ -0,0 +1,122 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "storage/louds/external_louds_trie_builder.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "base/file_stream.h"
+#include "base/file_util.h"
+#include "base/port.h"
+#include "base/util.h"
+#include "storage/louds/louds_trie_builder.h"
+#include "testing/base/public/googletest.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace storage {
+namespace louds {
+namespace {
+
+class ExternalLoudsTrieBuilderTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    output_path_ = FileUtil::JoinPath(FLAGS_test_tmpdir, "louds_trie.data");
+  }
+
+  void TearDown() override {
+    if (FileUtil::FileExists(output_path_)) {
+      FileUtil::Unlink(output_path_);
+    }
+  }
+
+  // Builds |words| by both the builders and checks that the images and the
+  // ids are the same.
+  void ExpectSameAsLoudsTrieBuilder(const std::vector<string> &words,
+                                    size_t max_buffer_size) {
+    LoudsTrieBuilder expected;
+    ExternalLoudsTrieBuilder builder(FLAGS_test_tmpdir, max_buffer_size);
+    for (size_t i = 0; i < words.size(); ++i) {
+      expected.Add(words[i]);
+      ASSERT_TRUE(builder.Add(words[i]));
+    }
+    expected.Build();
+
+    std::map<string, int> ids;
+    ASSERT_TRUE(builder.Build(output_path_,
+                              [&ids](const string &word, int id) {
+                                EXPECT_TRUE(ids.emplace(word, id).second);
+                              }));
+    InputFileStream is(output_path_.c_str(),
+                       std::ios_base::in | std::ios_base::binary);
+    EXPECT_EQ(expected.image(), is.Read());
+
+    for (size_t i = 0; i < words.size(); ++i) {
+      EXPECT_EQ(expected.GetId(words[i]), ids[words[i]]) << words[i];
+    }
+  }
+
+  string output_path_;
+};
+
+TEST_F(ExternalLoudsTrieBuilderTest, Basic) {
+  const char *kWords[] = {
+    "a", "aa", "ab", "abc", "abd", "b", "bcd", "bcde", "bd", "ac", "aaa",
+  };
+  const std::vector<string> words(kWords, kWords + arraysize(kWords));
+  // In memory.
+  ExpectSameAsLoudsTrieBuilder(words, 1 << 20);
+  // A run per word.
+  ExpectSameAsLoudsTrieBuilder(words, 1);
+}
+
+TEST_F(ExternalLoudsTrieBuilderTest, Empty) {
+  ExpectSameAsLoudsTrieBuilder(std::vector<string>(), 1);
+}
+
+TEST_F(ExternalLoudsTrieBuilderTest, RandomWords) {
+  std::vector<string> words;
+  for (int i = 0; i < 3000; ++i) {
+    string word;
+    const int length = Util::Random(8) + 1;
+    for (int j = 0; j < length; ++j) {
+      // A small alphabet for shared prefixes and duplicates.
+      word.push_back(static_cast<char>('a' + Util::Random(4)));
+    }
+    words.push_back(word);
+  }
+  ExpectSameAsLoudsTrieBuilder(words, 4096);
+}
+
+}  // namespace
+}  // namespace louds
+}  // namespace storage
+}  // namespace mozc
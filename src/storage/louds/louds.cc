@@ -81,6 +81,14 @@ void Louds::Init(const uint8 *image, int length,
   }
 }
 
+size_t Louds::GetHeapMemoryUsage() const {
+  size_t size = index_.GetHeapMemoryUsage();
+  if (select_cache_) {
+    size += (select0_cache_size_ + select1_cache_size_) * sizeof(int);
+  }
+  return size;
+}
+
 void Louds::Reset() {
   index_.Reset();
   select_cache_.reset();
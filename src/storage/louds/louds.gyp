@@ -67,6 +67,17 @@
         'bit_stream',
       ],
     },
+    {
+      'target_name': 'external_louds_trie_builder',
+      'type': 'static_library',
+      'toolsets': ['target', 'host'],
+      'sources': [
+        'external_louds_trie_builder.cc',
+      ],
+      'dependencies': [
+        '../../base/base.gyp:base',
+      ],
+    },
     # Implementation of an array of string based on bit vector.
     {
       'target_name': 'bit_vector_based_array',
@@ -116,5 +127,20 @@
         '../../base/base.gyp:base',
       ],
     },
+    {
+      'target_name': 'louds_benchmark',
+      'type': 'executable',
+      'sources': [
+        'louds_benchmark.cc',
+      ],
+      'dependencies': [
+        '../../base/base.gyp:base',
+        'bit_vector_based_array',
+        'bit_vector_based_array_builder',
+        'louds_trie',
+        'louds_trie_builder',
+        'simple_succinct_bit_vector_index',
+      ],
+    },
   ],
 }
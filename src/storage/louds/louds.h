@@ -87,6 +87,7 @@ class Louds {
     int edge_index_;
     int node_id_;
     friend class Louds;
+    friend class LoudsTrie;  // For the child node cache.
   };
 
   Louds();
@@ -109,6 +110,10 @@ class Louds {
   // Explicitly clears the internal bit array.
   void Reset();
 
+  // Returns the size of the index and the select cache allocated in heap, in
+  // bytes.
+  size_t GetHeapMemoryUsage() const;
+
   // APIs for traversal (all the methods are inline for performance).
 
   // Initializes a Node instance from node ID.
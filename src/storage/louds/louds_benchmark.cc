@@ -0,0 +1,400 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Microbenchmark for the succinct data structures in storage/louds.
+//
+// Builds a key trie, a value trie and a BitVectorBasedArray from the source
+// dictionary files, then reports the average and percentile time per call of
+// LoudsTrie::ExactSearch, PrefixSearch and RestoreKeyString,
+// BitVectorBasedArray::Get and SimpleSuccinctBitVectorIndex::Rank1, Select0
+// and Select1 on the LOUDS bit vector of the key trie, for each of the given
+// cache sizes.  As a single call takes only tens of nanoseconds, calls are
+// timed in batches of --batch_size and the per-call time of each batch is
+// used as a sample.
+//
+// Usage:
+//   louds_benchmark --dictionary_files=data/dictionary_oss/dictionary00.txt,
+//       data/dictionary_oss/dictionary01.txt --cache_sizes=0,256,1024,4096
+
+#include <algorithm>
+#include <iostream>  // NOLINT
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "base/file_stream.h"
+#include "base/flags.h"
+#include "base/init_mozc.h"
+#include "base/logging.h"
+#include "base/number_util.h"
+#include "base/port.h"
+#include "base/stopwatch.h"
+#include "base/string_piece.h"
+#include "base/util.h"
+#include "storage/louds/bit_vector_based_array.h"
+#include "storage/louds/bit_vector_based_array_builder.h"
+#include "storage/louds/louds_trie.h"
+#include "storage/louds/louds_trie_builder.h"
+#include "storage/louds/simple_succinct_bit_vector_index.h"
+
+DEFINE_string(dictionary_files,
+              "data/dictionary_oss/dictionary00.txt,"
+              "data/dictionary_oss/dictionary01.txt,"
+              "data/dictionary_oss/dictionary02.txt,"
+              "data/dictionary_oss/dictionary03.txt,"
+              "data/dictionary_oss/dictionary04.txt,"
+              "data/dictionary_oss/dictionary05.txt,"
+              "data/dictionary_oss/dictionary06.txt,"
+              "data/dictionary_oss/dictionary07.txt,"
+              "data/dictionary_oss/dictionary08.txt,"
+              "data/dictionary_oss/dictionary09.txt",
+              "Comma separated list of source dictionary files.  The first "
+              "column (reading) is used for the key trie and the fifth "
+              "column (surface form) for the value trie.");
+DEFINE_string(cache_sizes, "0,64,256,1024,4096",
+              "Comma separated list of cache sizes.  Each size is used for "
+              "all of the lb0, lb1, select0, select1 and terminal bit vector "
+              "caches at once.");
+DEFINE_int32(chunk_size, 32,
+             "Chunk size in bytes of SimpleSuccinctBitVectorIndex used for the "
+             "Rank/Select cases");
+DEFINE_int32(num_queries, 100000,
+             "Number of queries issued for each case per iteration");
+DEFINE_int32(batch_size, 100, "Number of calls timed as a single sample");
+DEFINE_int32(iterations, 3, "Number of times each case is repeated");
+DEFINE_int32(seed, 0, "Seed of the random query order");
+
+namespace mozc {
+namespace storage {
+namespace louds {
+namespace {
+
+// Per-call time samples of one benchmark case.
+struct BenchmarkResult {
+  string name;
+  std::vector<double> latencies_nsec;
+};
+
+double Percentile(const std::vector<double> &sorted, double p) {
+  if (sorted.empty()) {
+    return 0.0;
+  }
+  const size_t index = std::min(
+      sorted.size() - 1, static_cast<size_t>(p * (sorted.size() - 1) + 0.5));
+  return sorted[index];
+}
+
+void PrintResult(const BenchmarkResult &result, std::ostream *os) {
+  std::vector<double> sorted(result.latencies_nsec);
+  std::sort(sorted.begin(), sorted.end());
+  double total_nsec = 0.0;
+  for (const double nsec : sorted) {
+    total_nsec += nsec;
+  }
+  *os << Util::StringPrintf(
+      "  %-24s avg=%.1fns p50=%.1fns p90=%.1fns p99=%.1fns max=%.1fns",
+      result.name.c_str(), sorted.empty() ? 0.0 : total_nsec / sorted.size(),
+      Percentile(sorted, 0.5), Percentile(sorted, 0.9),
+      Percentile(sorted, 0.99), sorted.empty() ? 0.0 : sorted.back())
+      << std::endl;
+}
+
+// Calls |func| for each element of |queries| and records the per-call time of
+// every batch.  The return values of |func| are accumulated to |checksum| so
+// that the calls are not optimized away.
+template <typename Query, typename Func>
+void Run(const string &name, const std::vector<Query> &queries, Func func,
+         uint64 *checksum, BenchmarkResult *result) {
+  const size_t batch_size = std::max(1, FLAGS_batch_size);
+  result->name = name;
+  result->latencies_nsec.reserve(
+      (queries.size() / batch_size + 1) * FLAGS_iterations);
+  for (int iter = 0; iter < FLAGS_iterations; ++iter) {
+    for (size_t begin = 0; begin < queries.size(); begin += batch_size) {
+      const size_t end = std::min(queries.size(), begin + batch_size);
+      uint64 sum = 0;
+      Stopwatch stopwatch = Stopwatch::StartNew();
+      for (size_t i = begin; i < end; ++i) {
+        sum += func(queries[i]);
+      }
+      stopwatch.Stop();
+      result->latencies_nsec.push_back(
+          static_cast<double>(stopwatch.GetElapsedNanoseconds()) /
+          (end - begin));
+      *checksum += sum;
+    }
+  }
+}
+
+struct Dictionary {
+  std::vector<string> keys;
+  std::vector<string> values;
+  // Surface forms of each key joined by '\t', in the same order as |keys|.
+  std::vector<string> key_values;
+};
+
+void LoadDictionary(const std::vector<string> &filenames,
+                    Dictionary *dictionary) {
+  std::set<string> keys, values;
+  std::vector<std::pair<string, string>> entries;
+  for (const string &filename : filenames) {
+    InputFileStream ifs(filename.c_str());
+    CHECK(ifs) << "Cannot open " << filename;
+    string line;
+    while (!std::getline(ifs, line).fail()) {
+      Util::ChopReturns(&line);
+      std::vector<string> columns;
+      Util::SplitStringUsing(line, "\t", &columns);
+      if (columns.size() < 5) {
+        continue;
+      }
+      keys.insert(columns[0]);
+      values.insert(columns[4]);
+      entries.emplace_back(columns[0], columns[4]);
+    }
+  }
+  CHECK(!keys.empty()) << "No entry in " << FLAGS_dictionary_files;
+  dictionary->keys.assign(keys.begin(), keys.end());
+  dictionary->values.assign(values.begin(), values.end());
+  std::sort(entries.begin(), entries.end());
+  dictionary->key_values.resize(dictionary->keys.size());
+  size_t key_index = 0;
+  for (const auto &entry : entries) {
+    while (dictionary->keys[key_index] != entry.first) {
+      ++key_index;
+    }
+    string *joined = &dictionary->key_values[key_index];
+    if (!joined->empty()) {
+      joined->append("\t");
+    }
+    joined->append(entry.second);
+  }
+}
+
+// Returns the image of |words| and the ID assigned to each word.
+void BuildTrie(const std::vector<string> &words, string *image,
+               std::vector<int> *ids) {
+  LoudsTrieBuilder builder;
+  for (const string &word : words) {
+    builder.Add(word);
+  }
+  builder.Build();
+  *image = builder.image();
+  ids->clear();
+  for (const string &word : words) {
+    ids->push_back(builder.GetId(word));
+  }
+}
+
+int ReadInt32(const uint8 *data) {
+  return data[0] | (data[1] << 8) | (data[2] << 16) | (data[3] << 24);
+}
+
+void RunTrieCases(const string &label, const string &trie_image,
+                  const std::vector<string> &words, const std::vector<int> &ids,
+                  const std::vector<size_t> &cache_sizes, std::mt19937 *random,
+                  uint64 *checksum) {
+  const uint8 *image = reinterpret_cast<const uint8 *>(trie_image.data());
+
+  std::uniform_int_distribution<size_t> word_dist(0, words.size() - 1);
+  std::vector<StringPiece> hit_queries, miss_queries;
+  std::vector<int> id_queries;
+  for (int i = 0; i < FLAGS_num_queries; ++i) {
+    const size_t index = word_dist(*random);
+    hit_queries.push_back(words[index]);
+    id_queries.push_back(ids[index]);
+  }
+  // Misses share the longest possible prefix with a word in the trie, which
+  // is the worst case for ExactSearch.
+  std::vector<string> miss_keys;
+  miss_keys.reserve(FLAGS_num_queries);
+  for (const StringPiece query : hit_queries) {
+    miss_keys.push_back(query.as_string() + "\xFF");
+    miss_queries.push_back(miss_keys.back());
+  }
+
+  std::cout << label << ": " << words.size() << " words, " << trie_image.size()
+            << " bytes" << std::endl;
+  for (const size_t cache_size : cache_sizes) {
+    LoudsTrie trie;
+    CHECK(trie.Open(image, cache_size, cache_size, cache_size, cache_size,
+                    cache_size));
+    std::cout << " cache_size=" << cache_size << std::endl;
+
+    BenchmarkResult result;
+    Run("ExactSearch(hit)", hit_queries,
+        [&trie](StringPiece key) { return trie.ExactSearch(key); }, checksum,
+        &result);
+    PrintResult(result, &std::cout);
+
+    result = BenchmarkResult();
+    Run("ExactSearch(miss)", miss_queries,
+        [&trie](StringPiece key) { return trie.ExactSearch(key); }, checksum,
+        &result);
+    PrintResult(result, &std::cout);
+
+    result = BenchmarkResult();
+    Run("PrefixSearch", hit_queries,
+        [&trie](StringPiece key) {
+          int num_prefixes = 0;
+          trie.PrefixSearch(
+              key, [&num_prefixes](StringPiece, StringPiece::size_type,
+                                   const LoudsTrie &, LoudsTrie::Node) {
+                ++num_prefixes;
+              });
+          return num_prefixes;
+        },
+        checksum, &result);
+    PrintResult(result, &std::cout);
+
+    result = BenchmarkResult();
+    char buf[LoudsTrie::kMaxDepth + 1];
+    Run("RestoreKeyString", id_queries,
+        [&trie, &buf](int id) { return trie.RestoreKeyString(id, buf).size(); },
+        checksum, &result);
+    PrintResult(result, &std::cout);
+  }
+
+  // The LOUDS bit vector of the trie, which is laid out as described in
+  // LoudsTrie::Open().
+  const int louds_size = ReadInt32(image);
+  const uint8 *louds_image = image + 16;
+  std::cout << " LOUDS bit vector: " << louds_size << " bytes" << std::endl;
+  for (const size_t cache_size : cache_sizes) {
+    SimpleSuccinctBitVectorIndex index(FLAGS_chunk_size);
+    index.Init(louds_image, louds_size, cache_size, cache_size);
+    std::cout << " cache_size=" << cache_size << std::endl;
+
+    std::uniform_int_distribution<int> pos_dist(0, louds_size * 8);
+    std::uniform_int_distribution<int> num0_dist(1, index.GetNum0Bits());
+    std::uniform_int_distribution<int> num1_dist(1, index.GetNum1Bits());
+    std::vector<int> rank_queries, select0_queries, select1_queries;
+    for (int i = 0; i < FLAGS_num_queries; ++i) {
+      rank_queries.push_back(pos_dist(*random));
+      select0_queries.push_back(num0_dist(*random));
+      select1_queries.push_back(num1_dist(*random));
+    }
+
+    BenchmarkResult result;
+    Run("Rank1", rank_queries, [&index](int n) { return index.Rank1(n); },
+        checksum, &result);
+    PrintResult(result, &std::cout);
+
+    result = BenchmarkResult();
+    Run("Select0", select0_queries,
+        [&index](int n) { return index.Select0(n); }, checksum, &result);
+    PrintResult(result, &std::cout);
+
+    result = BenchmarkResult();
+    Run("Select1", select1_queries,
+        [&index](int n) { return index.Select1(n); }, checksum, &result);
+    PrintResult(result, &std::cout);
+  }
+}
+
+void RunArrayCase(const std::vector<string> &elements, std::mt19937 *random,
+                  uint64 *checksum) {
+  // The same element sizes as the token array of the system dictionary.
+  BitVectorBasedArrayBuilder builder;
+  for (const string &element : elements) {
+    builder.Add(element);
+  }
+  builder.SetSize(4, 2);
+  builder.Build();
+  const string &image = builder.image();
+
+  BitVectorBasedArray array;
+  array.Open(reinterpret_cast<const uint8 *>(image.data()));
+  std::cout << "BitVectorBasedArray: " << elements.size() << " elements, "
+            << image.size() << " bytes" << std::endl;
+
+  std::uniform_int_distribution<size_t> index_dist(0, elements.size() - 1);
+  std::vector<size_t> queries;
+  for (int i = 0; i < FLAGS_num_queries; ++i) {
+    queries.push_back(index_dist(*random));
+  }
+  BenchmarkResult result;
+  Run("Get", queries,
+      [&array](size_t index) {
+        size_t length = 0;
+        const char *data = array.Get(index, &length);
+        return length + static_cast<uint8>(data[0]);
+      },
+      checksum, &result);
+  PrintResult(result, &std::cout);
+}
+
+}  // namespace
+}  // namespace louds
+}  // namespace storage
+}  // namespace mozc
+
+int main(int argc, char **argv) {
+  mozc::InitMozc(argv[0], &argc, &argv, false);
+
+  std::vector<string> filenames;
+  mozc::Util::SplitStringUsing(FLAGS_dictionary_files, ",", &filenames);
+  std::vector<string> cache_size_strs;
+  mozc::Util::SplitStringUsing(FLAGS_cache_sizes, ",", &cache_size_strs);
+  std::vector<size_t> cache_sizes;
+  for (const string &str : cache_size_strs) {
+    uint32 size = 0;
+    CHECK(mozc::NumberUtil::SafeStrToUInt32(str, &size))
+        << "Invalid cache size: " << str;
+    cache_sizes.push_back(size);
+  }
+
+  mozc::storage::louds::Dictionary dictionary;
+  mozc::storage::louds::LoadDictionary(filenames, &dictionary);
+
+  std::mt19937 random(FLAGS_seed);
+  uint64 checksum = 0;
+
+  string key_image, value_image;
+  std::vector<int> key_ids, value_ids;
+  mozc::Stopwatch stopwatch = mozc::Stopwatch::StartNew();
+  mozc::storage::louds::BuildTrie(dictionary.keys, &key_image, &key_ids);
+  mozc::storage::louds::BuildTrie(dictionary.values, &value_image,
+                                  &value_ids);
+  stopwatch.Stop();
+  std::cout << "Build: " << stopwatch.GetElapsedMilliseconds() << "ms"
+            << std::endl;
+
+  mozc::storage::louds::RunTrieCases("Key trie", key_image, dictionary.keys,
+                                     key_ids, cache_sizes, &random, &checksum);
+  mozc::storage::louds::RunTrieCases("Value trie", value_image,
+                                     dictionary.values, value_ids, cache_sizes,
+                                     &random, &checksum);
+  mozc::storage::louds::RunArrayCase(dictionary.key_values, &random,
+                                     &checksum);
+
+  std::cout << "Checksum: " << checksum << std::endl;
+  return 0;
+}
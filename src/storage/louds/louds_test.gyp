@@ -58,6 +58,21 @@
         'test_size': 'small',
       },
     },
+    {
+      'target_name': 'external_louds_trie_builder_test',
+      'type': 'executable',
+      'sources': [
+        'external_louds_trie_builder_test.cc',
+      ],
+      'dependencies': [
+        '../../testing/testing.gyp:gtest_main',
+        'louds.gyp:external_louds_trie_builder',
+        'louds.gyp:louds_trie_builder',
+      ],
+      'variables': {
+        'test_size': 'small',
+      },
+    },
     {
       'target_name': 'bit_vector_based_array_test',
       'type': 'executable',
@@ -108,6 +123,7 @@
       'dependencies': [
         'bit_stream_test',
         'bit_vector_based_array_test',
+        'external_louds_trie_builder_test',
         'louds_test',
         'louds_trie_test',
         'simple_succinct_bit_vector_index_test',
@@ -43,6 +43,19 @@ inline int32 ReadInt32(const uint8 *data) {
   // TODO(noriyukit): static assertion for the endian.
   return *reinterpret_cast<const int32*>(data);
 }
+
+// Node ids of parents need to fit in 24 bits to be cached.
+const int kMaxCachedNodeId = (1 << 24) - 1;
+const uint32 kChildFoundFlag = 0x80000000;
+
+inline uint32 ChildCacheKey(int node_id, char label) {
+  return (static_cast<uint32>(node_id) << 8) | static_cast<uint8>(label);
+}
+
+inline size_t ChildCacheSlot(uint32 key, size_t mask) {
+  // Multiplicative hashing to spread sibling labels and nearby node ids.
+  return ((key * 0x9E3779B1u) >> 7) & mask;
+}
 }  // namespace
 
 bool LoudsTrie::Open(const uint8 *image,
@@ -99,17 +112,73 @@ void LoudsTrie::Close() {
   louds_.Reset();
   terminal_bit_vector_.Reset();
   edge_character_ = nullptr;
+  child_cache_.reset();
+  child_cache_mask_ = 0;
+}
+
+void LoudsTrie::EnableChildCache(size_t size) {
+  if (size == 0) {
+    child_cache_.reset();
+    child_cache_mask_ = 0;
+    return;
+  }
+  size_t capacity = 1;
+  while (capacity < size) {
+    capacity <<= 1;
+  }
+  child_cache_.reset(new std::atomic<uint64>[capacity]);
+  for (size_t i = 0; i < capacity; ++i) {
+    child_cache_[i].store(0, std::memory_order_relaxed);
+  }
+  child_cache_mask_ = capacity - 1;
+}
+
+size_t LoudsTrie::GetHeapMemoryUsage() const {
+  size_t size = louds_.GetHeapMemoryUsage() +
+                terminal_bit_vector_.GetHeapMemoryUsage();
+  if (child_cache_) {
+    size += (child_cache_mask_ + 1) * sizeof(std::atomic<uint64>);
+  }
+  return size;
 }
 
 bool LoudsTrie::MoveToChildByLabel(char label, Node *node) const {
+  const int parent_node_id = node->node_id();
+  const bool use_cache =
+      child_cache_ != nullptr && parent_node_id <= kMaxCachedNodeId;
+  uint32 key = 0;
+  std::atomic<uint64> *slot = nullptr;
+  if (use_cache) {
+    key = ChildCacheKey(parent_node_id, label);
+    slot = &child_cache_[ChildCacheSlot(key, child_cache_mask_)];
+    const uint64 entry = slot->load(std::memory_order_relaxed);
+    if (static_cast<uint32>(entry >> 32) == key) {
+      // The node id of a child is determined by its edge index and the node
+      // id of its parent; see Louds::MoveToFirstChild().
+      const uint32 value = static_cast<uint32>(entry);
+      node->edge_index_ = static_cast<int>(value & ~kChildFoundFlag);
+      node->node_id_ = node->edge_index_ - parent_node_id + 1;
+      return (value & kChildFoundFlag) != 0;
+    }
+  }
+
+  bool found = false;
   MoveToFirstChild(node);
   while (IsValidNode(*node)) {
     if (GetEdgeLabelToParentNode(*node) == label) {
-      return true;
+      found = true;
+      break;
     }
     MoveToNextSibling(node);
   }
-  return false;
+
+  if (use_cache) {
+    const uint32 value =
+        static_cast<uint32>(node->edge_index_) | (found ? kChildFoundFlag : 0);
+    slot->store((static_cast<uint64>(key) << 32) | value,
+                std::memory_order_relaxed);
+  }
+  return found;
 }
 
 bool LoudsTrie::Traverse(StringPiece key, Node *node) const {
@@ -30,6 +30,7 @@
 #ifndef MOZC_STORAGE_LOUDS_LOUDS_TRIE_H_
 #define MOZC_STORAGE_LOUDS_LOUDS_TRIE_H_
 
+#include <atomic>
 #include <memory>
 
 #include "base/port.h"
@@ -49,7 +50,7 @@ class LoudsTrie {
   // This class stores a traversal state.
   typedef Louds::Node Node;
 
-  LoudsTrie() : edge_character_(nullptr) {}
+  LoudsTrie() : edge_character_(nullptr), child_cache_mask_(0) {}
   ~LoudsTrie() {}
 
   // Opens the binary image and constructs the data structure.  The first four
@@ -73,6 +74,19 @@ class LoudsTrie {
   // clean up too).
   void Close();
 
+  // Enables the cache for MoveToChildByLabel(), which memoizes the destination
+  // of (parent node, label) transitions including the ones that fail.  This
+  // helps incremental typing, where the same prefixes are traversed again on
+  // every keystroke.  |size| is the number of entries (rounded up to a power
+  // of two); 0 disables the cache.  The cache is direct-mapped, so recently
+  // used edges evict older ones sharing the same slot.  Accesses to the cache
+  // are lock-free and thread safe.  Must be called after Open().
+  void EnableChildCache(size_t size);
+
+  // Returns the size of the indices and the caches allocated in heap, in
+  // bytes.  The trie image itself is not included.
+  size_t GetHeapMemoryUsage() const;
+
   // Generic APIs for tree traversal, some of which are delegated from Louds
   // class; see louds.h.
 
@@ -210,6 +224,13 @@ class LoudsTrie {
   // In other words, id=2 in louds_ corresponds to edge_character_[1].
   const char *edge_character_;
 
+  // Cache for MoveToChildByLabel().  Each entry packs the cache key
+  // (parent node id << 8 | label) into the upper 32 bits, and the edge index
+  // of the destination into the lower 31 bits together with a found flag in
+  // bit 31.  An entry of 0 is empty as the super root is never a parent.
+  std::unique_ptr<std::atomic<uint64>[]> child_cache_;
+  size_t child_cache_mask_;
+
   DISALLOW_COPY_AND_ASSIGN(LoudsTrie);
 };
 
@@ -433,6 +433,44 @@ TEST(LoudsTrieTest, ExactSearch) {
 }
 INSTANTIATE_TEST_CASE(GenHasKeyTest);
 
+TEST(LoudsTrieTest, ChildCache) {
+  LoudsTrieBuilder builder;
+  const char *kKeys[] = {"a", "abc", "abcd", "ae", "aecd", "b", "bcx"};
+  for (size_t i = 0; i < arraysize(kKeys); ++i) {
+    builder.Add(kKeys[i]);
+  }
+  builder.Build();
+
+  LoudsTrie trie, cached_trie;
+  trie.Open(reinterpret_cast<const uint8 *>(builder.image().data()));
+  cached_trie.Open(reinterpret_cast<const uint8 *>(builder.image().data()));
+
+  const char *kQueries[] = {
+      "a", "ab", "abc", "abcd", "abcde", "ae", "aec", "aecd", "aecx",
+      "b", "bc", "bcx", "bcxy", "c", "",
+  };
+  // Cache sizes smaller than the number of edges force evictions.
+  const size_t kCacheSizes[] = {1, 3, 1024};
+  for (size_t i = 0; i < arraysize(kCacheSizes); ++i) {
+    cached_trie.EnableChildCache(kCacheSizes[i]);
+    // The second round is answered from the cache.
+    for (int round = 0; round < 2; ++round) {
+      for (size_t j = 0; j < arraysize(kQueries); ++j) {
+        const StringPiece query = kQueries[j];
+        LoudsTrie::Node expected, actual;
+        EXPECT_EQ(trie.Traverse(query, &expected),
+                  cached_trie.Traverse(query, &actual)) << query;
+        EXPECT_EQ(expected, actual) << query;
+        EXPECT_EQ(trie.ExactSearch(query), cached_trie.ExactSearch(query))
+            << query;
+      }
+    }
+  }
+
+  cached_trie.EnableChildCache(0);
+  EXPECT_EQ(trie.ExactSearch("aecd"), cached_trie.ExactSearch("aecd"));
+}
+
 TEST_P(LoudsTrieTest, PrefixSearch) {
   LoudsTrieBuilder builder;
   builder.Add("aa");
@@ -37,6 +37,11 @@
 #include "base/logging.h"
 #include "base/port.h"
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define MOZC_USE_X86_BIT_INSTRUCTIONS
+#endif  // __GNUC__ && (__x86_64__ || __i386__)
+
 namespace mozc {
 namespace storage {
 namespace louds {
@@ -64,10 +69,13 @@ class ZeroBitAdapter : public AdapterBase<int> {
 };
 
 #ifdef __GNUC__
-// TODO(hidehiko): Support XMM and 64-bits popcount for 64bits architectures.
 inline int BitCount1(uint32 x) {
   return __builtin_popcount(x);
 }
+
+inline int BitCount1(uint64 x) {
+  return __builtin_popcountll(x);
+}
 #else
 int BitCount1(uint32 x) {
   x = ((x & 0xaaaaaaaa) >> 1) + (x & 0x55555555);
@@ -94,12 +102,70 @@ inline bool IsPowerOfTwo(int value) {
 // Returns 1-bits in the data[0] ... data[length - 1].
 int Count1Bits(const uint32 *data, int length) {
   int num_bits = 0;
+#ifdef __GNUC__
+  // Two words are counted at once with a 64-bit popcount.  The data is only
+  // guaranteed to be 32-bit aligned, so words are combined in registers.
+  for (; length >= 2; data += 2, length -= 2) {
+    num_bits += BitCount1(static_cast<uint64>(data[0]) |
+                          (static_cast<uint64>(data[1]) << 32));
+  }
+#endif  // __GNUC__
   for (; length > 0; ++data, --length) {
     num_bits += BitCount1(*data);
   }
   return num_bits;
 }
 
+// Returns the position (0-origin) of the n-th (1-origin) 1-bit in |word|.
+// The |word| must have at least n 1-bits.  This version narrows down the byte
+// containing the target bit first so that at most 8 bits are scanned.
+int SelectInWordPortable(uint32 word, int n) {
+  int base = 0;
+  for (; base < 24; base += 8, word >>= 8) {
+    const int bit_count = BitCount1(word & 0xFF);
+    if (bit_count >= n) {
+      break;
+    }
+    n -= bit_count;
+  }
+  for (;; ++base, word >>= 1) {
+    n -= (word & 1);
+    if (n == 0) {
+      return base;
+    }
+  }
+}
+
+#ifdef MOZC_USE_X86_BIT_INSTRUCTIONS
+// PDEP deposits the n-th 1-bit of |word| to the position of the n-th bit, so
+// the target position is given by the count of trailing zeros.
+__attribute__((target("bmi2")))
+int SelectInWordBmi2(uint32 word, int n) {
+  return __builtin_ctz(_pdep_u32(1u << (n - 1), word));
+}
+
+typedef int (*SelectInWordFunc)(uint32 word, int n);
+
+SelectInWordFunc GetSelectInWordFunc() {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("bmi2") ? &SelectInWordBmi2
+                                        : &SelectInWordPortable;
+}
+#endif  // MOZC_USE_X86_BIT_INSTRUCTIONS
+
+inline int SelectInWord(uint32 word, int n) {
+  DCHECK_GT(n, 0);
+  DCHECK_GE(BitCount1(word), n);
+#ifdef MOZC_USE_X86_BIT_INSTRUCTIONS
+  // The CPU feature is detected only once.  Function-local static
+  // initialization is thread safe.
+  static const SelectInWordFunc select_in_word = GetSelectInWordFunc();
+  return select_in_word(word, n);
+#else  // MOZC_USE_X86_BIT_INSTRUCTIONS
+  return SelectInWordPortable(word, n);
+#endif  // MOZC_USE_X86_BIT_INSTRUCTIONS
+}
+
 // Stores index (the camulative number of the 1-bits from begin of each chunk).
 void InitIndex(
     const uint8 *data, int length, int chunk_size, std::vector<int> *index) {
@@ -200,6 +266,11 @@ void SimpleSuccinctBitVectorIndex::Reset() {
   lb1_cache_.clear();
 }
 
+size_t SimpleSuccinctBitVectorIndex::GetHeapMemoryUsage() const {
+  return index_.capacity() * sizeof(int) +
+         (lb0_cache_.capacity() + lb1_cache_.capacity()) * sizeof(const int *);
+}
+
 int SimpleSuccinctBitVectorIndex::Rank1(int n) const {
   // Look up pre-computed 1-bits for the preceding chunks.
   const int num_chunks = n / (chunk_size_ * 8);
@@ -254,14 +325,8 @@ int SimpleSuccinctBitVectorIndex::Select0(int n) const {
     ++ptr;
   }
 
-  int index = (ptr - reinterpret_cast<const uint32 *>(data_)) * 32;
-  for (uint32 word = ~(*ptr); n > 0; word >>= 1, ++index) {
-    n -= (word & 1);
-  }
-
-  // Index points to the "next bit" of the target one.
-  // Thus, subtract one to adjust.
-  return index - 1;
+  const int index = (ptr - reinterpret_cast<const uint32 *>(data_)) * 32;
+  return index + SelectInWord(~(*ptr), n);
 }
 
 int SimpleSuccinctBitVectorIndex::Select1(int n) const {
@@ -293,14 +358,8 @@ int SimpleSuccinctBitVectorIndex::Select1(int n) const {
     ++ptr;
   }
 
-  int index = (ptr - reinterpret_cast<const uint32 *>(data_)) * 32;
-  for (uint32 word = *ptr; n > 0; word >>= 1, ++index) {
-    n -= (word & 1);
-  }
-
-  // Index points to the "next bit" of the target one.
-  // Thus, subtract one to adjust.
-  return index - 1;
+  const int index = (ptr - reinterpret_cast<const uint32 *>(data_)) * 32;
+  return index + SelectInWord(*ptr, n);
 }
 
 }  // namespace louds
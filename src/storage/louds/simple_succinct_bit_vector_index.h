@@ -98,6 +98,10 @@ class SimpleSuccinctBitVectorIndex {
   int GetNum1Bits() const { return index_.back(); }
   int GetNum0Bits() const { return 8 * length_ - index_.back(); }
 
+  // Returns the size of the rank/select index allocated in heap, in bytes.
+  // The bit vector itself is not included.
+  size_t GetHeapMemoryUsage() const;
+
  private:
   const uint8 *data_;
   int length_;
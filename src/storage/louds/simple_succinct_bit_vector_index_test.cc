@@ -29,6 +29,11 @@
 
 #include "storage/louds/simple_succinct_bit_vector_index.h"
 
+#include <string>
+#include <vector>
+
+#include "base/port.h"
+#include "base/util.h"
 #include "testing/base/public/gunit.h"
 
 namespace {
@@ -190,4 +195,49 @@ TEST_P(SimpleSuccinctBitVectorIndexTest, Pattern2) {
 }
 INSTANTIATE_TEST_CASE(GenPattern2Test);
 
+TEST_P(SimpleSuccinctBitVectorIndexTest, RandomBits) {
+  const CacheSizeParam &param = GetParam();
+
+  // Select is answered by in-word bit operations which may be dispatched to
+  // CPU specific instructions, so compare the results with a naive scan over
+  // random data of various densities.
+  for (int density = 1; density < 8; density += 3) {
+    string data(2048, '\0');
+    for (size_t i = 0; i < data.size(); ++i) {
+      uint8 byte = 0;
+      for (int bit = 0; bit < 8; ++bit) {
+        if (::mozc::Util::Random(8) < density) {
+          byte |= (1 << bit);
+        }
+      }
+      data[i] = static_cast<char>(byte);
+    }
+
+    for (int chunk_size = 4; chunk_size <= 64; chunk_size *= 2) {
+      SimpleSuccinctBitVectorIndex bit_vector(chunk_size);
+      bit_vector.Init(reinterpret_cast<const uint8 *>(data.data()),
+                      data.length(), param.first, param.second);
+
+      std::vector<int> zero_positions, one_positions;
+      for (int i = 0; i < data.size() * 8; ++i) {
+        EXPECT_EQ(one_positions.size(), bit_vector.Rank1(i)) << i;
+        if (bit_vector.Get(i)) {
+          one_positions.push_back(i);
+        } else {
+          zero_positions.push_back(i);
+        }
+      }
+      ASSERT_EQ(zero_positions.size(), bit_vector.GetNum0Bits());
+      ASSERT_EQ(one_positions.size(), bit_vector.GetNum1Bits());
+      for (size_t i = 0; i < zero_positions.size(); ++i) {
+        EXPECT_EQ(zero_positions[i], bit_vector.Select0(i + 1)) << i;
+      }
+      for (size_t i = 0; i < one_positions.size(); ++i) {
+        EXPECT_EQ(one_positions[i], bit_vector.Select1(i + 1)) << i;
+      }
+    }
+  }
+}
+INSTANTIATE_TEST_CASE(GenRandomBitsTest);
+
 }  // namespace
@@ -96,6 +96,10 @@ class LRUCache {
   // Returns the number of entries currently in the cache.
   size_t Size() const;
 
+  // Returns the size of the allocated blocks and the lookup table in bytes.
+  // Memory allocated by the keys and the values themselves is not included.
+  size_t GetHeapMemoryUsage() const;
+
   bool HasKey(const Key &key) const;
 
   // Returns the head of LRU list
@@ -105,6 +109,11 @@ class LRUCache {
   // Returns the tail of LRU list
   const Element *Tail() const { return lru_tail_; }
 
+  // Returns a counter incremented whenever an element is inserted or removed
+  // (i.e., whenever the key set or the LRU order may change).  Callers can
+  // compare it to keep data derived from the cache in sync.
+  uint64 modification_count() const { return modification_count_; }
+
  private:
   // Allocates a new block containing next_block_size_ elements, updates
   // next_block_size_ appropriately, and pushes the elements in the new block
@@ -155,6 +164,7 @@ class LRUCache {
   size_t block_capacity_;   // how many Elements can be stored in current blocks
   size_t next_block_size_;  // size of the next block to allocate
   size_t max_elements_;     // maximum elements to hold
+  uint64 modification_count_;
 
   DISALLOW_COPY_AND_ASSIGN(LRUCache);
 };
@@ -271,6 +281,7 @@ bool LRUCache<Key, Value>::Evict(Element* e) {
   if (e != NULL) {
     int erased = table_->erase(e->key);
     CHECK_EQ(erased, 1);
+    ++modification_count_;
     RemoveFromLRU(e);
     PushFreeList(e);
     return true;
@@ -285,7 +296,8 @@ LRUCache<Key, Value>::LRUCache(size_t max_elements)
     lru_tail_(NULL),
     block_count_(0),
     block_capacity_(0),
-    max_elements_(max_elements) {
+    max_elements_(max_elements),
+    modification_count_(0) {
   ::memset(blocks_, 0, sizeof(blocks_));
   table_ = new Table;
   CHECK(table_);
@@ -345,6 +357,7 @@ LRUCache<Key, Value>::Insert(const Key& key) {
   }
   e->key = key;
   (*table_)[key] = e;
+  ++modification_count_;
   PushLRUHead(e);
 
   return e;
@@ -388,6 +401,7 @@ bool LRUCache<Key, Value>::Erase(const Key& key) {
 template<typename Key, typename Value>
 void LRUCache<Key, Value>::Clear() {
   table_->clear();
+  ++modification_count_;
   Element* e = lru_head_;
   while (e != NULL) {
     Element* next = e->next;
@@ -407,6 +421,15 @@ size_t LRUCache<Key, Value>::Size() const {
   return table_->size();
 }
 
+template<typename Key, typename Value>
+size_t LRUCache<Key, Value>::GetHeapMemoryUsage() const {
+  // Each node of std::map holds the value, three links and a color.
+  const size_t kTableNodeSize =
+      sizeof(typename Table::value_type) + 4 * sizeof(void *);
+  return block_capacity_ * sizeof(Element) + sizeof(Table) +
+         table_->size() * kTableNodeSize;
+}
+
 }  // namespace storage
 }  // namespace mozc
 #endif  // MOZC_STORAGE_LRU_CACHE_H_
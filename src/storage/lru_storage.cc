@@ -33,7 +33,6 @@
 #include <cstdlib>
 #include <cstring>
 #include <ctime>
-#include <map>
 #include <memory>
 #include <set>
 #include <string>
@@ -85,6 +84,13 @@ void Update(char *ptr, uint64 fp, const char *value, size_t value_size) {
   memcpy(ptr + 12, value, value_size);
 }
 
+// Hints the CPU to start loading the cache line of |ptr|.
+inline void Prefetch(const void *ptr) {
+#if defined(__GNUC__) || defined(__clang__)
+  __builtin_prefetch(ptr);
+#endif  // __GNUC__ || __clang__
+}
+
 class CompareByTimeStamp {
  public:
   bool operator()(const char *a, const char *b) const {
@@ -106,6 +112,116 @@ class LRUStorage::Node {
   DISALLOW_COPY_AND_ASSIGN(Node);
 };
 
+// Open addressing hash table from fingerprints to nodes with linear probing.
+// The table is kept at most half full, so that a lookup usually probes one
+// or two buckets, which are contiguous in memory unlike the nodes of a
+// balanced tree.  Fingerprints are already well mixed, so their low bits are
+// used as the bucket index as is.
+class LRUStorage::NodeIndex {
+ public:
+  NodeIndex() : size_(0), mask_(kInitialCapacity - 1),
+                buckets_(kInitialCapacity) {
+  }
+
+  Node *Find(uint64 fp) const {
+    for (size_t i = fp & mask_; buckets_[i].node != NULL;
+         i = (i + 1) & mask_) {
+      if (buckets_[i].fp == fp) {
+        return buckets_[i].node;
+      }
+    }
+    return NULL;
+  }
+
+  void PrefetchBucket(uint64 fp) const {
+    Prefetch(&buckets_[fp & mask_]);
+  }
+
+  // Does nothing if |fp| already exists, like std::map::insert.
+  void Insert(uint64 fp, Node *node) {
+    DCHECK(node);
+    if ((size_ + 1) * 2 > buckets_.size()) {
+      Rehash(buckets_.size() * 2);
+    }
+    size_t i = fp & mask_;
+    for (; buckets_[i].node != NULL; i = (i + 1) & mask_) {
+      if (buckets_[i].fp == fp) {
+        return;
+      }
+    }
+    buckets_[i].fp = fp;
+    buckets_[i].node = node;
+    ++size_;
+  }
+
+  void Erase(uint64 fp) {
+    size_t i = fp & mask_;
+    for (; buckets_[i].node != NULL; i = (i + 1) & mask_) {
+      if (buckets_[i].fp == fp) {
+        break;
+      }
+    }
+    if (buckets_[i].node == NULL) {
+      return;
+    }
+    // Shifts the following buckets back instead of leaving a tombstone, so
+    // that the probe sequences stay short after many evictions.
+    for (size_t j = (i + 1) & mask_; buckets_[j].node != NULL;
+         j = (j + 1) & mask_) {
+      const size_t home = buckets_[j].fp & mask_;
+      // Keeps the bucket if its home is cyclically in (i, j].
+      if ((i <= j) ? (i < home && home <= j) : (i < home || home <= j)) {
+        continue;
+      }
+      buckets_[i] = buckets_[j];
+      i = j;
+    }
+    buckets_[i].node = NULL;
+    --size_;
+  }
+
+  size_t GetHeapMemoryUsage() const {
+    return sizeof(*this) + buckets_.capacity() * sizeof(Bucket);
+  }
+
+  void Clear() {
+    size_ = 0;
+    mask_ = kInitialCapacity - 1;
+    std::vector<Bucket>(kInitialCapacity).swap(buckets_);
+  }
+
+ private:
+  static const size_t kInitialCapacity = 64;
+
+  struct Bucket {
+    Bucket() : fp(0), node(NULL) {}
+    uint64 fp;
+    Node *node;  // NULL if the bucket is empty.
+  };
+
+  void Rehash(size_t capacity) {
+    std::vector<Bucket> old_buckets(capacity);
+    old_buckets.swap(buckets_);
+    mask_ = capacity - 1;
+    for (size_t i = 0; i < old_buckets.size(); ++i) {
+      if (old_buckets[i].node == NULL) {
+        continue;
+      }
+      size_t j = old_buckets[i].fp & mask_;
+      while (buckets_[j].node != NULL) {
+        j = (j + 1) & mask_;
+      }
+      buckets_[j] = old_buckets[i];
+    }
+  }
+
+  size_t size_;
+  size_t mask_;
+  std::vector<Bucket> buckets_;
+
+  DISALLOW_COPY_AND_ASSIGN(NodeIndex);
+};
+
 class LRUStorage::LRUList {
  public:
   explicit LRUList(size_t max_size)
@@ -155,6 +271,10 @@ class LRUStorage::LRUList {
     return size_;
   }
 
+  size_t GetHeapMemoryUsage() const {
+    return sizeof(*this) + size_ * sizeof(Node);
+  }
+
   Node *GetLastNode() {
     return last_;
   }
@@ -269,7 +389,6 @@ bool LRUStorage::Clear() {
   }
   memset(mmap_->begin() + offset, '\0', mmap_->size() - offset);
   lru_list_.reset();
-  map_.clear();
   Open(mmap_->begin(), mmap_->size());
   return true;
 }
@@ -343,7 +462,8 @@ LRUStorage::LRUStorage()
       size_(0),
       seed_(0),
       last_item_(NULL),
-      begin_(NULL), end_(NULL) {}
+      begin_(NULL), end_(NULL),
+      index_(new NodeIndex) {}
 
 LRUStorage::~LRUStorage() {
   Close();
@@ -479,12 +599,12 @@ bool LRUStorage::Open(char *ptr, size_t ptr_size) {
   std::stable_sort(ary.begin(), ary.end(), CompareByTimeStamp());
 
   lru_list_.reset(new LRUList(size_));
-  map_.clear();
+  index_->Clear();
   last_item_ = NULL;
   for (size_t i = 0; i < ary.size(); ++i) {
     if (GetTimeStamp(ary[i]) != 0) {
       Node *node = lru_list_->Add(ary[i]);
-      map_.insert(std::make_pair(GetFP(ary[i]), node));
+      index_->Insert(GetFP(ary[i]), node);
     } else if (last_item_ == NULL) {
       last_item_ = ary[i];
     }
@@ -497,7 +617,7 @@ void LRUStorage::Close() {
   filename_.clear();
   mmap_.reset();
   lru_list_.reset();
-  map_.clear();
+  index_->Clear();
 }
 
 const char* LRUStorage::Lookup(const string &key) const {
@@ -508,12 +628,41 @@ const char* LRUStorage::Lookup(const string &key) const {
 const char* LRUStorage::Lookup(const string &key,
                                uint32 *last_access_time) const {
   const uint64 fp = Hash::FingerprintWithSeed(key, seed_);
-  std::map<uint64, Node *>::const_iterator it = map_.find(fp);
-  if (it == map_.end()) {
+  const Node *node = index_->Find(fp);
+  if (node == NULL) {
     return NULL;
   }
-  *last_access_time = GetTimeStamp(it->second->value);
-  return GetValue(it->second->value);
+  *last_access_time = GetTimeStamp(node->value);
+  return GetValue(node->value);
+}
+
+void LRUStorage::BatchLookup(const std::vector<string> &keys,
+                             std::vector<const char *> *values,
+                             std::vector<uint32> *last_access_times) const {
+  DCHECK(values);
+  DCHECK(last_access_times);
+  values->assign(keys.size(), NULL);
+  last_access_times->assign(keys.size(), 0);
+
+  // Each pass issues the loads of the next one before any of them is used.
+  std::vector<uint64> fps(keys.size());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    fps[i] = Hash::FingerprintWithSeed(keys[i], seed_);
+    index_->PrefetchBucket(fps[i]);
+  }
+  std::vector<const Node *> nodes(keys.size());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    nodes[i] = index_->Find(fps[i]);
+    if (nodes[i] != NULL) {
+      Prefetch(nodes[i]->value);
+    }
+  }
+  for (size_t i = 0; i < keys.size(); ++i) {
+    if (nodes[i] != NULL) {
+      (*values)[i] = GetValue(nodes[i]->value);
+      (*last_access_times)[i] = GetTimeStamp(nodes[i]->value);
+    }
+  }
 }
 
 bool LRUStorage::GetAllValues(std::vector<string> *values) const {
@@ -540,10 +689,10 @@ bool LRUStorage::Touch(const string &key) {
   }
 
   const uint64 fp = Hash::FingerprintWithSeed(key, seed_);
-  std::map<uint64, Node *>::iterator it = map_.find(fp);
-  if (it != map_.end()) {     // find in the cache
-    Update(it->second->value);
-    lru_list_->MoveToTop(it->second);
+  Node *node = index_->Find(fp);
+  if (node != NULL) {     // find in the cache
+    Update(node->value);
+    lru_list_->MoveToTop(node);
     return true;
   }
   return false;
@@ -555,26 +704,27 @@ bool LRUStorage::Insert(const string &key, const char *value) {
   }
 
   const uint64 fp = Hash::FingerprintWithSeed(key, seed_);
-  std::map<uint64, Node *>::iterator it = map_.find(fp);
-  if (it != map_.end()) {     // find in the cache
-    Update(it->second->value, fp, value, value_size_);
-    lru_list_->MoveToTop(it->second);
+  Node *found = index_->Find(fp);
+  if (found != NULL) {     // find in the cache
+    Update(found->value, fp, value, value_size_);
+    lru_list_->MoveToTop(found);
   } else if (lru_list_->size() >= size_ ||
              last_item_ == NULL) {  // not found, but cache is FULL
     Node *node = lru_list_->GetLastNode();
     const uint64 old_fp = GetFP(node->value);  // remove oldest item
-    std::map<uint64, Node *>::iterator old_it = map_.find(old_fp);
-    if (old_it != map_.end()) {
-      map_.erase(old_it);
+    // The oldest slot may be shadowed by another slot with the same
+    // fingerprint, which owns the index entry.
+    if (index_->Find(old_fp) == node) {
+      index_->Erase(old_fp);
     }
     lru_list_->MoveToTop(node);
     Update(node->value, fp, value, value_size_);
-    map_.insert(std::make_pair(fp, node));
+    index_->Insert(fp, node);
   } else if (last_item_ < mmap_->end()) {  // not found, cahce is not FULL
     Node *node = lru_list_->Add(last_item_);
     lru_list_->MoveToTop(node);
     Update(node->value, fp, value, value_size_);
-    map_.insert(std::make_pair(fp, node));
+    index_->Insert(fp, node);
     last_item_ += (value_size_ + 12);
     if (last_item_ >= mmap_->end()) {
       last_item_ = NULL;
@@ -593,10 +743,10 @@ bool LRUStorage::TryInsert(const string &key, const char *value) {
   }
 
   const uint64 fp = Hash::FingerprintWithSeed(key, seed_);
-  std::map<uint64, Node *>::iterator it = map_.find(fp);
-  if (it != map_.end()) {     // find in the cache
-    Update(it->second->value, fp, value, value_size_);
-    lru_list_->MoveToTop(it->second);
+  Node *node = index_->Find(fp);
+  if (node != NULL) {     // find in the cache
+    Update(node->value, fp, value, value_size_);
+    lru_list_->MoveToTop(node);
   }
 
   return true;
@@ -622,6 +772,17 @@ const string &LRUStorage::filename() const {
   return filename_;
 }
 
+size_t LRUStorage::GetHeapMemoryUsage() const {
+  size_t size = 0;
+  if (index_) {
+    size += index_->GetHeapMemoryUsage();
+  }
+  if (lru_list_) {
+    size += lru_list_->GetHeapMemoryUsage();
+  }
+  return size;
+}
+
 void LRUStorage::Write(size_t i,
                        uint64 fp,
                        const string &value,
@@ -30,7 +30,6 @@
 #ifndef MOZC_STORAGE_LRU_STORAGE_H_
 #define MOZC_STORAGE_LRU_STORAGE_H_
 
-#include <map>
 #include <memory>
 #include <string>
 #include <vector>
@@ -65,6 +64,14 @@ class LRUStorage {
 
   const char *Lookup(const string &key) const;
 
+  // Looks up |keys| at once.  (*values)[i] and (*last_access_times)[i] are
+  // set to the result for keys[i], or NULL and 0 if not found.  The slots of
+  // all the keys are prefetched before they are read, so that the cache misses
+  // for different keys overlap.
+  void BatchLookup(const std::vector<string> &keys,
+                   std::vector<const char *> *values,
+                   std::vector<uint32> *last_access_times) const;
+
   // Returns all values.
   // The order is new to old (*values->begin() is the newest).
   bool GetAllValues(std::vector<string> *values) const;
@@ -95,6 +102,10 @@ class LRUStorage {
   uint32 seed() const;
   const string &filename() const;
 
+  // Returns the size of the index and the LRU list allocated in heap, in
+  // bytes.  The values are stored in the mapped file and not included.
+  size_t GetHeapMemoryUsage() const;
+
   // Write one entry at |i| th index.
   // i must be 0 <= i < size.
   // This data will not update the index of the storage.
@@ -127,6 +138,7 @@ class LRUStorage {
  private:
   class LRUList;
   class Node;
+  class NodeIndex;
 
   // load from memory buffer
   bool Open(char *ptr, size_t ptr_size);
@@ -138,7 +150,7 @@ class LRUStorage {
   char *begin_;
   char *end_;
   string filename_;
-  std::map<uint64, Node *> map_;
+  std::unique_ptr<NodeIndex> index_;
   std::unique_ptr<LRUList> lru_list_;
   std::unique_ptr<Mmap> mmap_;
 
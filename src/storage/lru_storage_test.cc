@@ -30,6 +30,7 @@
 #include "storage/lru_storage.h"
 
 #include <algorithm>
+#include <cstring>
 #include <set>
 #include <string>
 #include <utility>
@@ -152,6 +153,116 @@ struct Entry {
   string value;
 };
 
+TEST_F(LRUStorageTest, TouchEvictAndReopen) {
+  const size_t kSize = 100;
+  const string filename = GetTemporaryFilePath();
+  LRUStorage::CreateStorageFile(filename.c_str(), 4, kSize, 0xff02);
+  LRUStorage storage;
+  ASSERT_TRUE(storage.Open(filename.c_str()));
+
+  // Many evictions interleaved with touches and updates shouldn't break the
+  // index of the storage.
+  LRUCache<string, uint32> cache(kSize);
+  for (uint32 i = 0; i < kSize * 20; ++i) {
+    const string key = "key" + std::to_string(Util::Random(kSize * 3));
+    if (Util::Random(3) == 0) {
+      EXPECT_EQ(cache.Lookup(key) != NULL, storage.Touch(key));
+      continue;
+    }
+    cache.Insert(key, i);
+    storage.Insert(key, reinterpret_cast<const char *>(&i));
+  }
+  for (uint32 i = 0; i < kSize * 3; ++i) {
+    const string key = "key" + std::to_string(i);
+    const uint32 *expected = cache.Lookup(key);
+    const uint32 *actual =
+        reinterpret_cast<const uint32 *>(storage.Lookup(key));
+    ASSERT_EQ(expected == NULL, actual == NULL) << key;
+    if (expected != NULL) {
+      EXPECT_EQ(*expected, *actual);
+    }
+  }
+
+  // The index is rebuilt from the file.
+  LRUStorage reopened;
+  ASSERT_TRUE(reopened.Open(filename.c_str()));
+  EXPECT_EQ(storage.used_size(), reopened.used_size());
+  for (uint32 i = 0; i < kSize * 3; ++i) {
+    const string key = "key" + std::to_string(i);
+    const char *expected = storage.Lookup(key);
+    const char *actual = reopened.Lookup(key);
+    ASSERT_EQ(expected == NULL, actual == NULL) << key;
+    if (expected != NULL) {
+      EXPECT_EQ(0, memcmp(expected, actual, 4));
+    }
+  }
+}
+
+TEST_F(LRUStorageTest, HeapMemoryUsage) {
+  const size_t kSize = 1000;
+  const string filename = GetTemporaryFilePath();
+  LRUStorage::CreateStorageFile(filename.c_str(), 4, kSize, 0xff02);
+  LRUStorage storage;
+  ASSERT_TRUE(storage.Open(filename.c_str()));
+  LRUCache<string, uint32> cache(kSize);
+  const size_t initial_storage_usage = storage.GetHeapMemoryUsage();
+  const size_t initial_cache_usage = cache.GetHeapMemoryUsage();
+
+  for (uint32 i = 0; i < kSize; ++i) {
+    const string key = "key" + std::to_string(i);
+    storage.Insert(key, reinterpret_cast<const char *>(&i));
+    cache.Insert(key, i);
+  }
+  EXPECT_LT(initial_storage_usage, storage.GetHeapMemoryUsage());
+  EXPECT_LE(initial_cache_usage + kSize * sizeof(uint32),
+            cache.GetHeapMemoryUsage());
+
+  // The number of entries is bounded, so is the memory usage.
+  const size_t storage_usage = storage.GetHeapMemoryUsage();
+  const size_t cache_usage = cache.GetHeapMemoryUsage();
+  for (uint32 i = kSize; i < kSize * 2; ++i) {
+    const string key = "key" + std::to_string(i);
+    storage.Insert(key, reinterpret_cast<const char *>(&i));
+    cache.Insert(key, i);
+  }
+  EXPECT_EQ(storage_usage, storage.GetHeapMemoryUsage());
+  EXPECT_EQ(cache_usage, cache.GetHeapMemoryUsage());
+}
+
+TEST_F(LRUStorageTest, BatchLookup) {
+  const string filename = GetTemporaryFilePath();
+  LRUStorage::CreateStorageFile(filename.c_str(), 4, 10, 0xff02);
+  LRUStorage storage;
+  ASSERT_TRUE(storage.Open(filename.c_str()));
+  for (uint32 i = 0; i < 5; ++i) {
+    storage.Insert("key" + std::to_string(i),
+                   reinterpret_cast<const char *>(&i));
+  }
+
+  std::vector<string> keys;
+  keys.push_back("key3");
+  keys.push_back("unknown");
+  keys.push_back("key0");
+  keys.push_back("key3");
+  std::vector<const char *> values;
+  std::vector<uint32> last_access_times;
+  storage.BatchLookup(keys, &values, &last_access_times);
+  ASSERT_EQ(keys.size(), values.size());
+  ASSERT_EQ(keys.size(), last_access_times.size());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    uint32 expected_time = 0;
+    EXPECT_EQ(storage.Lookup(keys[i], &expected_time), values[i]) << keys[i];
+    if (values[i] != NULL) {
+      EXPECT_EQ(expected_time, last_access_times[i]);
+    } else {
+      EXPECT_EQ(0, last_access_times[i]);
+    }
+  }
+  EXPECT_TRUE(values[1] == NULL);
+  EXPECT_EQ(3, *reinterpret_cast<const uint32 *>(values[0]));
+  EXPECT_EQ(0, *reinterpret_cast<const uint32 *>(values[2]));
+}
+
 TEST_F(LRUStorageTest, ReadWriteTest) {
   const int kSize[] = {10, 100, 1000, 10000};
   const string file = GetTemporaryFilePath();
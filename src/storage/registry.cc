@@ -33,6 +33,7 @@
 #include <string>
 
 #include "base/file_util.h"
+#include "base/flags.h"
 #include "base/logging.h"
 #include "base/mutex.h"
 #include "base/singleton.h"
@@ -40,6 +41,10 @@
 #include "storage/storage_interface.h"
 #include "storage/tiny_storage.h"
 
+DEFINE_bool(use_log_structured_registry, false,
+            "Store the registry in the log structured TinyStorage, which "
+            "updates the changed entries in place.");
+
 namespace mozc {
 namespace storage {
 
@@ -54,7 +59,9 @@ const char kRegistryFileName[] = ".registry.db";   // hidden file
 class StorageInitializer {
  public:
   StorageInitializer() :
-      default_storage_(TinyStorage::New()), current_storage_(NULL) {
+      default_storage_(FLAGS_use_log_structured_registry ?
+                       TinyStorage::NewLogStructured() : TinyStorage::New()),
+      current_storage_(NULL) {
     if (!default_storage_->Open(FileUtil::JoinPath(
             SystemUtil::GetUserProfileDirectory(), kRegistryFileName))) {
       LOG(ERROR) << "cannot open registry";
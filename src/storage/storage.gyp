@@ -36,6 +36,7 @@
       'sources': [
         'encrypted_string_storage.cc',
         'existence_filter.cc',
+        'existence_filter_builder.cc',
         'lru_storage.cc',
         'memory_storage.cc',
         'registry.cc',
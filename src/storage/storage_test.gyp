@@ -34,6 +34,7 @@
       'type': 'executable',
       'sources': [
         'encrypted_string_storage_test.cc',
+        'existence_filter_builder_test.cc',
         'existence_filter_test.cc',
         'lru_storage_test.cc',
         'memory_storage_test.cc',
@@ -33,10 +33,12 @@
 #include <Windows.h>
 #endif  // OS_WIN
 
+#include <algorithm>
 #include <cstring>
 #include <map>
 #include <memory>
 #include <string>
+#include <unordered_map>
 
 #include "base/file_stream.h"
 #include "base/file_util.h"
@@ -84,63 +86,11 @@ bool IsInvalid(const string &key, const string &value, size_t size) {
   return false;
 }
 
-class TinyStorageImpl : public StorageInterface {
- public:
-  TinyStorageImpl();
-  virtual ~TinyStorageImpl();
-
-  virtual bool Open(const string &filename);
-  virtual bool Sync();
-  virtual bool Lookup(const string &key, string *value) const;
-  virtual bool Insert(const string &key, const string &value);
-  virtual bool Erase(const string &key);
-  virtual bool Clear();
-  virtual size_t Size() const {
-    return dic_.size();
-  }
-
- private:
-  string filename_;
-  bool should_sync_;
-  std::map<string, string> dic_;
-
-  DISALLOW_COPY_AND_ASSIGN(TinyStorageImpl);
-};
-
-TinyStorageImpl::TinyStorageImpl() : should_sync_(true) {
-  // the each entry consumes at most
-  // sizeof(uint32) * 2 (key/value length) +
-  // kMaxKeySize + kMaxValueSize
-  DCHECK_GT(
-      kMaxFileSize,
-      kMaxElementSize * (kMaxKeySize + kMaxValueSize + sizeof(uint32) * 2));
-}
-
-TinyStorageImpl::~TinyStorageImpl() {
-  if (should_sync_) {
-    Sync();
-  }
-}
-
-bool TinyStorageImpl::Open(const string &filename) {
-  Mmap mmap;
-  dic_.clear();
-  filename_ = filename;
-  if (!mmap.Open(filename.c_str(), "r")) {
-    LOG(WARNING) << "cannot open:" << filename;
-    // here we return true if we cannot open the file.
-    // it happens mostly when file doesn't exist.
-    // we just make an empty file from scratch here.
-    return true;
-  }
-
-  if (mmap.size() > kMaxFileSize) {
-    LOG(ERROR) << "tring to open too big file";
-    return false;
-  }
-
-  char *begin = mmap.begin();
-  const char *end = mmap.end();
+// Parses the storage file in [begin, end) into |dic|.  See
+// TinyStorageImpl::Sync() for the format.
+bool ParseStorage(char *begin, char *end, std::map<string, string> *dic) {
+  const size_t file_size = end - begin;
+  char *const file_begin = begin;
 
   uint32 version = 0;
   uint32 magic = 0;
@@ -152,7 +102,7 @@ bool TinyStorageImpl::Open(const string &filename) {
     return false;
   }
 
-  if ((magic ^ kStorageMagicId) != mmap.size()) {
+  if ((magic ^ kStorageMagicId) != file_size) {
     LOG(ERROR) << "file magic is broken";
     return false;
   }
@@ -201,14 +151,72 @@ bool TinyStorageImpl::Open(const string &filename) {
     const string value(begin, value_size);
     begin += value_size;
 
-    if (IsInvalid(key, value, dic_.size())) {
+    if (IsInvalid(key, value, dic->size())) {
       return false;
     }
 
-    dic_.insert(std::make_pair(key, value));
+    dic->insert(std::make_pair(key, value));
   }
 
-  if (static_cast<size_t>(begin - mmap.begin()) != mmap.size()) {
+  return static_cast<size_t>(begin - file_begin) == file_size;
+}
+
+class TinyStorageImpl : public StorageInterface {
+ public:
+  TinyStorageImpl();
+  virtual ~TinyStorageImpl();
+
+  virtual bool Open(const string &filename);
+  virtual bool Sync();
+  virtual bool Lookup(const string &key, string *value) const;
+  virtual bool Insert(const string &key, const string &value);
+  virtual bool Erase(const string &key);
+  virtual bool Clear();
+  virtual size_t Size() const {
+    return dic_.size();
+  }
+
+ private:
+  string filename_;
+  bool should_sync_;
+  std::map<string, string> dic_;
+
+  DISALLOW_COPY_AND_ASSIGN(TinyStorageImpl);
+};
+
+TinyStorageImpl::TinyStorageImpl() : should_sync_(true) {
+  // the each entry consumes at most
+  // sizeof(uint32) * 2 (key/value length) +
+  // kMaxKeySize + kMaxValueSize
+  DCHECK_GT(
+      kMaxFileSize,
+      kMaxElementSize * (kMaxKeySize + kMaxValueSize + sizeof(uint32) * 2));
+}
+
+TinyStorageImpl::~TinyStorageImpl() {
+  if (should_sync_) {
+    Sync();
+  }
+}
+
+bool TinyStorageImpl::Open(const string &filename) {
+  Mmap mmap;
+  dic_.clear();
+  filename_ = filename;
+  if (!mmap.Open(filename.c_str(), "r")) {
+    LOG(WARNING) << "cannot open:" << filename;
+    // here we return true if we cannot open the file.
+    // it happens mostly when file doesn't exist.
+    // we just make an empty file from scratch here.
+    return true;
+  }
+
+  if (mmap.size() > kMaxFileSize) {
+    LOG(ERROR) << "tring to open too big file";
+    return false;
+  }
+
+  if (!ParseStorage(mmap.begin(), mmap.end(), &dic_)) {
     LOG(ERROR) << "file is broken: " << filename_;
     dic_.clear();
     return false;
@@ -331,6 +339,349 @@ bool TinyStorageImpl::Clear() {
   return Sync();
 }
 
+
+// Log structured variant of TinyStorageImpl.  The file is memory-mapped and
+// updated in place, so Insert() and Erase() write only the record of the key
+// instead of rewriting the whole file.
+//
+// Format of storage:
+// |magic(uint32 kLogStorageMagicId)|version(uint32)|used_size(uint32)|
+// followed by the records in [kLogHeaderSize, used_size):
+// |key_size(uint32)|value_capacity(uint32)|value_size(uint32)|
+// |key(key_size)|value(value_capacity)| ...
+// value_size is kErasedValueSize if the record is erased or superseded.
+// The rest of the file is reserved for the records appended later.
+const uint32 kLogStorageVersion = 0;
+const uint32 kLogStorageMagicId = 0x7a3c9e15;  // random seed
+const uint32 kErasedValueSize = 0xFFFFFFFF;
+const size_t kLogHeaderSize = sizeof(uint32) * 3;
+const size_t kLogRecordHeaderSize = sizeof(uint32) * 3;
+const size_t kMinLogFileSize = 4096;
+// Values have this granularity of capacity to be updated in place when
+// they grow a little.
+const size_t kValueAlignment = 8;
+// Compacts the file on Sync() if the erased records are larger than this.
+const size_t kMaxErasedBytes = 64 * 1024;
+
+uint32 LoadUint32(const char *ptr) {
+  uint32 value = 0;
+  memcpy(&value, ptr, sizeof(value));
+  return value;
+}
+
+void StoreUint32(uint32 value, char *ptr) {
+  memcpy(ptr, &value, sizeof(value));
+}
+
+size_t GetValueCapacity(size_t value_size) {
+  return std::max(kValueAlignment,
+                  (value_size + kValueAlignment - 1) / kValueAlignment *
+                  kValueAlignment);
+}
+
+class LogStructuredTinyStorageImpl : public StorageInterface {
+ public:
+  LogStructuredTinyStorageImpl() : used_size_(0), erased_bytes_(0) {}
+  virtual ~LogStructuredTinyStorageImpl() {}
+
+  virtual bool Open(const string &filename);
+  virtual bool Sync();
+  virtual bool Lookup(const string &key, string *value) const;
+  virtual bool Insert(const string &key, const string &value);
+  virtual bool Erase(const string &key);
+  virtual bool Clear();
+  virtual size_t Size() const {
+    return index_.size();
+  }
+
+ private:
+  // Writes a new file of |file_size| bytes holding |entries|.
+  bool WriteFile(const std::map<string, string> &entries,
+                 size_t file_size) const;
+  // Maps the file and builds |index_|.
+  bool MapFile();
+  // Rewrites the file with the live records, reserving at least |extra|
+  // free bytes.
+  bool Compact(size_t extra);
+  // Marks the record at |offset| as erased.
+  void EraseRecord(uint32 offset);
+
+  string filename_;
+  std::unique_ptr<Mmap> mmap_;
+  // Offsets of the live records of each key.
+  std::unordered_map<string, uint32> index_;
+  size_t used_size_;
+  size_t erased_bytes_;
+
+  DISALLOW_COPY_AND_ASSIGN(LogStructuredTinyStorageImpl);
+};
+
+bool LogStructuredTinyStorageImpl::Open(const string &filename) {
+  filename_ = filename;
+  mmap_.reset();
+  index_.clear();
+
+  std::map<string, string> entries;
+  {
+    Mmap mmap;
+    if (mmap.Open(filename.c_str(), "r") && mmap.size() >= sizeof(uint32) &&
+        LoadUint32(mmap.begin()) == kLogStorageMagicId) {
+      mmap.Close();
+      return MapFile();
+    }
+    // Converts the file of TinyStorageImpl, if any.
+    if (mmap.size() > 0 && !ParseStorage(mmap.begin(), mmap.end(), &entries)) {
+      LOG(ERROR) << "file is broken: " << filename_;
+      return false;
+    }
+  }
+  return WriteFile(entries, kMinLogFileSize) && MapFile();
+}
+
+bool LogStructuredTinyStorageImpl::WriteFile(
+    const std::map<string, string> &entries, size_t file_size) const {
+  const string output_filename = filename_ + ".tmp";
+  OutputFileStream ofs(output_filename.c_str(),
+                       std::ios::binary | std::ios::out);
+  if (!ofs) {
+    LOG(ERROR) << "cannot open " << output_filename;
+    return false;
+  }
+
+  string buffer(kLogHeaderSize, '\0');
+  for (std::map<string, string>::const_iterator it = entries.begin();
+       it != entries.end(); ++it) {
+    const string &key = it->first;
+    const string &value = it->second;
+    char record_header[kLogRecordHeaderSize];
+    StoreUint32(key.size(), record_header);
+    StoreUint32(GetValueCapacity(value.size()), record_header + 4);
+    StoreUint32(value.size(), record_header + 8);
+    buffer.append(record_header, kLogRecordHeaderSize);
+    buffer.append(key);
+    buffer.append(value);
+    buffer.append(GetValueCapacity(value.size()) - value.size(), '\0');
+  }
+  StoreUint32(kLogStorageMagicId, &buffer[0]);
+  StoreUint32(kLogStorageVersion, &buffer[4]);
+  StoreUint32(buffer.size(), &buffer[8]);
+  if (buffer.size() < file_size) {
+    buffer.append(file_size - buffer.size(), '\0');
+  }
+  ofs.write(buffer.data(), buffer.size());
+  // should call close(). Othrwise AtomicRename will be failed.
+  ofs.close();
+
+  if (!FileUtil::AtomicRename(output_filename, filename_)) {
+    LOG(ERROR) << "AtomicRename failed";
+    return false;
+  }
+
+#ifdef OS_WIN
+  if (!FileUtil::HideFile(filename_)) {
+    LOG(ERROR) << "Cannot make hidden: " << filename_
+               << " " << ::GetLastError();
+  }
+#endif
+
+  return true;
+}
+
+bool LogStructuredTinyStorageImpl::MapFile() {
+  index_.clear();
+  used_size_ = 0;
+  erased_bytes_ = 0;
+  mmap_.reset(new Mmap);
+  if (!mmap_->Open(filename_.c_str(), "r+")) {
+    LOG(ERROR) << "cannot open " << filename_;
+    mmap_.reset();
+    return false;
+  }
+
+  const char *begin = mmap_->begin();
+  const size_t file_size = mmap_->size();
+  if (file_size < kLogHeaderSize || file_size > kMaxFileSize ||
+      LoadUint32(begin) != kLogStorageMagicId) {
+    LOG(ERROR) << "file magic is broken";
+    mmap_.reset();
+    return false;
+  }
+  if (LoadUint32(begin + 4) != kLogStorageVersion) {
+    LOG(ERROR) << "Incompatible version";
+    mmap_.reset();
+    return false;
+  }
+  const size_t used_size = LoadUint32(begin + 8);
+  if (used_size < kLogHeaderSize || used_size > file_size) {
+    LOG(ERROR) << "used size is broken";
+    mmap_.reset();
+    return false;
+  }
+
+  size_t offset = kLogHeaderSize;
+  while (offset < used_size) {
+    if (offset + kLogRecordHeaderSize > used_size) {
+      LOG(ERROR) << "record header is broken";
+      mmap_.reset();
+      return false;
+    }
+    const size_t key_size = LoadUint32(begin + offset);
+    const size_t value_capacity = LoadUint32(begin + offset + 4);
+    const uint32 value_size = LoadUint32(begin + offset + 8);
+    const size_t record_size =
+        kLogRecordHeaderSize + key_size + value_capacity;
+    if (key_size >= kMaxKeySize || value_capacity > used_size ||
+        offset + record_size > used_size ||
+        (value_size != kErasedValueSize && value_size > value_capacity)) {
+      LOG(ERROR) << "record is broken";
+      mmap_.reset();
+      return false;
+    }
+    if (value_size == kErasedValueSize) {
+      erased_bytes_ += record_size;
+    } else {
+      const string key(begin + offset + kLogRecordHeaderSize, key_size);
+      std::unordered_map<string, uint32>::iterator it = index_.find(key);
+      if (it != index_.end()) {
+        // Only the last record is valid if the file was not synced.
+        EraseRecord(it->second);
+      }
+      index_[key] = static_cast<uint32>(offset);
+    }
+    offset += record_size;
+  }
+  used_size_ = used_size;
+  return true;
+}
+
+bool LogStructuredTinyStorageImpl::Compact(size_t extra) {
+  std::map<string, string> entries;
+  for (std::unordered_map<string, uint32>::const_iterator it = index_.begin();
+       it != index_.end(); ++it) {
+    string value;
+    Lookup(it->first, &value);
+    entries.insert(std::make_pair(it->first, value));
+  }
+  const size_t live_size = used_size_ - erased_bytes_;
+  // Leaves the room as large as the live records to amortize the
+  // compaction.
+  const size_t file_size =
+      std::max(kMinLogFileSize, (live_size + extra) * 2);
+  if (file_size > kMaxFileSize) {
+    LOG(ERROR) << "too big file";
+    return false;
+  }
+  // Unmaps the file before replacing it, as required on Windows.
+  mmap_.reset();
+  if (!WriteFile(entries, file_size)) {
+    // Keeps using the current file.
+    MapFile();
+    return false;
+  }
+  return MapFile();
+}
+
+void LogStructuredTinyStorageImpl::EraseRecord(uint32 offset) {
+  char *record = mmap_->begin() + offset;
+  StoreUint32(kErasedValueSize, record + 8);
+  erased_bytes_ += kLogRecordHeaderSize + LoadUint32(record) +
+                   LoadUint32(record + 4);
+}
+
+bool LogStructuredTinyStorageImpl::Sync() {
+  if (mmap_ == NULL) {
+    LOG(ERROR) << "storage is not opened";
+    return false;
+  }
+  // The mapped file is already updated.  Only compacts the file
+  // occasionally.
+  if (erased_bytes_ > kMaxErasedBytes && erased_bytes_ > used_size_ / 2) {
+    return Compact(0);
+  }
+  return true;
+}
+
+bool LogStructuredTinyStorageImpl::Insert(const string &key,
+                                          const string &value) {
+  std::unordered_map<string, uint32>::iterator it = index_.find(key);
+  if (IsInvalid(key, value, it == index_.end() ? index_.size() : 0)) {
+    LOG(WARNING) << "invalid key/value is passed";
+    return false;
+  }
+  if (mmap_ == NULL) {
+    LOG(ERROR) << "storage is not opened";
+    return false;
+  }
+
+  if (it != index_.end()) {
+    char *record = mmap_->begin() + it->second;
+    if (value.size() <= LoadUint32(record + 4)) {
+      // Updates the value in place.
+      memcpy(record + kLogRecordHeaderSize + key.size(), value.data(),
+             value.size());
+      StoreUint32(value.size(), record + 8);
+      return true;
+    }
+  }
+
+  const size_t value_capacity = GetValueCapacity(value.size());
+  const size_t record_size =
+      kLogRecordHeaderSize + key.size() + value_capacity;
+  if (used_size_ + record_size > mmap_->size()) {
+    if (!Compact(record_size)) {
+      return false;
+    }
+    it = index_.find(key);
+  }
+  // The old record is superseded after the compaction, which keeps it if
+  // the compaction fails.
+  if (it != index_.end()) {
+    EraseRecord(it->second);
+  }
+
+  // Appends the record, and then commits it by updating the used size.
+  char *record = mmap_->begin() + used_size_;
+  StoreUint32(key.size(), record);
+  StoreUint32(value_capacity, record + 4);
+  StoreUint32(value.size(), record + 8);
+  memcpy(record + kLogRecordHeaderSize, key.data(), key.size());
+  memcpy(record + kLogRecordHeaderSize + key.size(), value.data(),
+         value.size());
+  index_[key] = static_cast<uint32>(used_size_);
+  used_size_ += record_size;
+  StoreUint32(used_size_, mmap_->begin() + 8);
+  return true;
+}
+
+bool LogStructuredTinyStorageImpl::Erase(const string &key) {
+  std::unordered_map<string, uint32>::iterator it = index_.find(key);
+  if (it == index_.end()) {
+    VLOG(2) << "cannot erase key: " << key;
+    return false;
+  }
+  EraseRecord(it->second);
+  index_.erase(it);
+  return true;
+}
+
+bool LogStructuredTinyStorageImpl::Lookup(const string &key,
+                                          string *value) const {
+  std::unordered_map<string, uint32>::const_iterator it = index_.find(key);
+  if (it == index_.end()) {
+    VLOG(3) << "cannot find key: " << key;
+    return false;
+  }
+  const char *record = mmap_->begin() + it->second;
+  value->assign(record + kLogRecordHeaderSize + key.size(),
+                LoadUint32(record + 8));
+  return true;
+}
+
+bool LogStructuredTinyStorageImpl::Clear() {
+  index_.clear();
+  mmap_.reset();
+  return WriteFile(std::map<string, string>(), kMinLogFileSize) && MapFile();
+}
 }  // namespace
 
 StorageInterface *TinyStorage::Create(const char *filename) {
@@ -346,5 +697,19 @@ StorageInterface *TinyStorage::New() {
   return new TinyStorageImpl;
 }
 
+StorageInterface *TinyStorage::CreateLogStructured(const char *filename) {
+  std::unique_ptr<LogStructuredTinyStorageImpl> storage(
+      new LogStructuredTinyStorageImpl);
+  if (!storage->Open(filename)) {
+    LOG(ERROR) << "cannot open " << filename;
+    return NULL;
+  }
+  return storage.release();
+}
+
+StorageInterface *TinyStorage::NewLogStructured() {
+  return new LogStructuredTinyStorageImpl;
+}
+
 }  // namespace storage
 }  // namespace mozc
@@ -48,6 +48,13 @@ class TinyStorage {
   static StorageInterface *New();
   static StorageInterface *Create(const char *filename);
 
+  // Returns a log structured implementation, which memory-maps the file
+  // and writes only the updated records in place instead of rewriting the
+  // whole file on Sync().  The file is compacted occasionally.  A file
+  // written by New() is converted on Open().
+  static StorageInterface *NewLogStructured();
+  static StorageInterface *CreateLogStructured(const char *filename);
+
  private:
   DISALLOW_IMPLICIT_CONSTRUCTORS(TinyStorage);
 };
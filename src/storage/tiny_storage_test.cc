@@ -36,6 +36,7 @@
 #include <utility>
 #include <vector>
 
+#include "base/file_stream.h"
 #include "base/file_util.h"
 #include "base/port.h"
 #include "storage/storage_interface.h"
@@ -57,6 +58,12 @@ void CreateKeyValue(std::map<string, string> *output, int size) {
   }
 }
 
+int64 GetFileSize(const string &filename) {
+  InputFileStream ifs(filename.c_str(), std::ios::binary);
+  ifs.seekg(0, std::ios::end);
+  return ifs.tellg();
+}
+
 }  // namespace
 
 class TinyStorageTest : public testing::Test {
@@ -172,5 +179,89 @@ TEST_F(TinyStorageTest, TinyStorageTest) {
   }
 }
 
+TEST_F(TinyStorageTest, LogStructuredTest) {
+  const string filename = GetTemporaryFilePath();
+  std::map<string, string> target;
+  CreateKeyValue(&target, 1000);
+  {
+    std::unique_ptr<StorageInterface> storage(TinyStorage::NewLogStructured());
+    EXPECT_TRUE(storage->Open(filename));
+    for (std::map<string, string>::const_iterator it = target.begin();
+         it != target.end(); ++it) {
+      EXPECT_TRUE(storage->Insert(it->first, it->second));
+    }
+    EXPECT_EQ(target.size(), storage->Size());
+    EXPECT_TRUE(storage->Erase("key0"));
+    EXPECT_FALSE(storage->Erase("key0"));
+    EXPECT_TRUE(storage->Sync());
+  }
+  target.erase("key0");
+
+  std::unique_ptr<StorageInterface> storage(
+      TinyStorage::CreateLogStructured(filename.c_str()));
+  ASSERT_NE(nullptr, storage.get());
+  EXPECT_EQ(target.size(), storage->Size());
+  for (std::map<string, string>::const_iterator it = target.begin();
+       it != target.end(); ++it) {
+    string value;
+    EXPECT_TRUE(storage->Lookup(it->first, &value));
+    EXPECT_EQ(it->second, value);
+  }
+  string value;
+  EXPECT_FALSE(storage->Lookup("key0", &value));
+
+  EXPECT_TRUE(storage->Clear());
+  EXPECT_EQ(0, storage->Size());
+  EXPECT_FALSE(storage->Lookup("key1", &value));
+}
+
+TEST_F(TinyStorageTest, LogStructuredInPlaceUpdate) {
+  const string filename = GetTemporaryFilePath();
+  std::unique_ptr<StorageInterface> storage(
+      TinyStorage::CreateLogStructured(filename.c_str()));
+  ASSERT_NE(nullptr, storage.get());
+  EXPECT_TRUE(storage->Insert("key", "12345678"));
+  int64 file_size = GetFileSize(filename);
+  for (int i = 0; i < 10000; ++i) {
+    EXPECT_TRUE(storage->Insert("key", std::to_string(i)));
+  }
+  // The values fit in the capacity of the first record.
+  EXPECT_EQ(file_size, GetFileSize(filename));
+
+  // A longer value is appended, and the file grows as needed.
+  const string long_value(3000, 'x');
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_TRUE(storage->Insert("key", long_value + std::to_string(i)));
+    EXPECT_TRUE(storage->Insert("key" + std::to_string(i), long_value));
+    EXPECT_TRUE(storage->Erase("key" + std::to_string(i)));
+  }
+  EXPECT_TRUE(storage->Sync());
+  EXPECT_EQ(1, storage->Size());
+
+  std::unique_ptr<StorageInterface> storage2(
+      TinyStorage::CreateLogStructured(filename.c_str()));
+  ASSERT_NE(nullptr, storage2.get());
+  string value;
+  EXPECT_TRUE(storage2->Lookup("key", &value));
+  EXPECT_EQ(long_value + "99", value);
+  EXPECT_EQ(1, storage2->Size());
+}
+
+TEST_F(TinyStorageTest, LogStructuredConvertsTinyStorage) {
+  const string filename = GetTemporaryFilePath();
+  {
+    std::unique_ptr<StorageInterface> storage(TinyStorage::New());
+    EXPECT_TRUE(storage->Open(filename));
+    EXPECT_TRUE(storage->Insert("key", "value"));
+    EXPECT_TRUE(storage->Sync());
+  }
+  std::unique_ptr<StorageInterface> storage(
+      TinyStorage::CreateLogStructured(filename.c_str()));
+  ASSERT_NE(nullptr, storage.get());
+  string value;
+  EXPECT_TRUE(storage->Lookup("key", &value));
+  EXPECT_EQ("value", value);
+}
+
 }  // namespace storage
 }  // namespace mozc
@@ -31,8 +31,72 @@
 
 #include "transliteration/transliteration.h"
 
+#include "base/logging.h"
+#include "base/util.h"
+
 namespace mozc {
 namespace transliteration {
+namespace {
+
+// Upper-cases/lower-cases half-width and full-width alphabets in the same way
+// as Util::UpperString and Util::LowerString.
+char32 ToUpper(char32 c) {
+  if (('a' <= c && c <= 'z') || (0xFF41 <= c && c <= 0xFF5A)) {
+    return c - 0x20;
+  }
+  return c;
+}
+
+char32 ToLower(char32 c) {
+  if (('A' <= c && c <= 'Z') || (0xFF21 <= c && c <= 0xFF3A)) {
+    return c + 0x20;
+  }
+  return c;
+}
+
+// Appends |converted| to |output|.  The original bytes are copied when the
+// character is not changed.
+void AppendChar(char32 original, char32 converted, const char *begin,
+                size_t mblen, string *output) {
+  if (converted == original) {
+    output->append(begin, mblen);
+  } else {
+    Util::UCS4ToUTF8Append(converted, output);
+  }
+}
+
+// Generates the upper, lower and capitalized forms of |text| in one traversal.
+void GenerateCaseVariants(const string &text, string *upper, string *lower,
+                          string *capitalized) {
+  upper->clear();
+  lower->clear();
+  capitalized->clear();
+  upper->reserve(text.size());
+  lower->reserve(text.size());
+  capitalized->reserve(text.size());
+  const char *begin = text.data();
+  const char *const end = text.data() + text.size();
+  while (begin < end) {
+    size_t mblen = 0;
+    const char32 c = Util::UTF8ToUCS4(begin, end, &mblen);
+    if (mblen == 0) {
+      // Invalid UTF-8 sequence.  Keeps the rest as is like Util::LowerString.
+      upper->append(begin, end - begin);
+      lower->append(begin, end - begin);
+      capitalized->append(begin, end - begin);
+      return;
+    }
+    const char32 upper_c = ToUpper(c);
+    const char32 lower_c = ToLower(c);
+    AppendChar(c, upper_c, begin, mblen, upper);
+    AppendChar(c, lower_c, begin, mblen, lower);
+    AppendChar(c, (begin == text.data()) ? upper_c : lower_c, begin, mblen,
+               capitalized);
+    begin += mblen;
+  }
+}
+
+}  // namespace
 
 // static
 bool T13n::IsInFullAsciiTypes(TransliterationType type) {
@@ -84,5 +148,19 @@ TransliterationType T13n::ToggleHalfAsciiTypes(
           HALF_ASCII);
 }
 
+// static
+void T13n::FillAsciiCaseVariants(Transliterations *t13ns) {
+  DCHECK(t13ns);
+  DCHECK_EQ(NUM_T13N_TYPES, t13ns->size());
+  GenerateCaseVariants((*t13ns)[HALF_ASCII],
+                       &(*t13ns)[HALF_ASCII_UPPER],
+                       &(*t13ns)[HALF_ASCII_LOWER],
+                       &(*t13ns)[HALF_ASCII_CAPITALIZED]);
+  GenerateCaseVariants((*t13ns)[FULL_ASCII],
+                       &(*t13ns)[FULL_ASCII_UPPER],
+                       &(*t13ns)[FULL_ASCII_LOWER],
+                       &(*t13ns)[FULL_ASCII_CAPITALIZED]);
+}
+
 }  // namespace transliteration
 }  // namespace mozc
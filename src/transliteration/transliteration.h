@@ -106,6 +106,11 @@ class T13n {
   static TransliterationType ToggleHalfAsciiTypes(
       TransliterationType current_type);
 
+  // Fill the upper, lower and capitalized variants of HALF_ASCII and
+  // FULL_ASCII in |t13ns| from its HALF_ASCII and FULL_ASCII entries.  Each
+  // entry is traversed only once.  |t13ns| must have NUM_T13N_TYPES entries.
+  static void FillAsciiCaseVariants(Transliterations *t13ns);
+
  private:
   DISALLOW_IMPLICIT_CONSTRUCTORS(T13n);
 };
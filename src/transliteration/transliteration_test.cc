@@ -126,5 +126,29 @@ TEST(T13nTest, ToggleHalfAsciiTypes) {
   EXPECT_EQ(HALF_ASCII, T13n::ToggleHalfAsciiTypes(HALF_ASCII_CAPITALIZED));
 }
 
+TEST(T13nTest, FillAsciiCaseVariants) {
+  Transliterations t13ns(NUM_T13N_TYPES);
+  t13ns[HALF_ASCII] = "mOZc-1";
+  t13ns[FULL_ASCII] = "ｍＯＺｃ−１";
+  T13n::FillAsciiCaseVariants(&t13ns);
+  EXPECT_EQ("MOZC-1", t13ns[HALF_ASCII_UPPER]);
+  EXPECT_EQ("mozc-1", t13ns[HALF_ASCII_LOWER]);
+  EXPECT_EQ("Mozc-1", t13ns[HALF_ASCII_CAPITALIZED]);
+  EXPECT_EQ("ＭＯＺＣ−１", t13ns[FULL_ASCII_UPPER]);
+  EXPECT_EQ("ｍｏｚｃ−１", t13ns[FULL_ASCII_LOWER]);
+  EXPECT_EQ("Ｍｏｚｃ−１", t13ns[FULL_ASCII_CAPITALIZED]);
+
+  // Non-alphabet characters are kept as is.
+  t13ns[HALF_ASCII] = "1ABあ";
+  t13ns[FULL_ASCII] = "";
+  T13n::FillAsciiCaseVariants(&t13ns);
+  EXPECT_EQ("1ABあ", t13ns[HALF_ASCII_UPPER]);
+  EXPECT_EQ("1abあ", t13ns[HALF_ASCII_LOWER]);
+  EXPECT_EQ("1abあ", t13ns[HALF_ASCII_CAPITALIZED]);
+  EXPECT_EQ("", t13ns[FULL_ASCII_UPPER]);
+  EXPECT_EQ("", t13ns[FULL_ASCII_LOWER]);
+  EXPECT_EQ("", t13ns[FULL_ASCII_CAPITALIZED]);
+}
+
 }  // namespace transliteration
 }  // namespace mozc
@@ -72,12 +72,21 @@ void PrintGreetingMessage() {
 
 // Main loop, which takes an input line as a command and print a corresponding
 // result returned by Mozc server in S-expression.
+//
+// mozc.el may send several commands before reading their responses, each of
+// which is identified by its event ID.  Commands which arrive in one read are
+// processed in a row and their responses are flushed together.
 void ProcessLoop() {
   using mozc::emacs::ErrorExit;
 
+  // Lets std::cin buffer the input by itself so that in_avail() tells whether
+  // the next command has already arrived.
+  std::ios::sync_with_stdio(false);
+
   mozc::emacs::ClientPool client_pool;
   mozc::commands::Command command;
   string line;
+  string response;
 
   while (getline(std::cin, line)) {
     command.clear_input();
@@ -113,15 +122,17 @@ void ProcessLoop() {
     mozc::emacs::RemoveUsageData(command.mutable_output());
 
     // Output results.
-    std::vector<string> buffer;
-    mozc::emacs::PrintMessage(command.output(), &buffer);
-    string output;
-    mozc::Util::JoinStrings(buffer, "", &output);
-    fprintf(stdout,
-            "((emacs-event-id . %u)(emacs-session-id . %u)(output . %s))\n",
-            event_id, session_id, output.c_str());
-    fflush(stdout);
+    response.assign(mozc::Util::StringPrintf(
+        "((emacs-event-id . %u)(emacs-session-id . %u)(output . ",
+        event_id, session_id));
+    mozc::emacs::PrintMessage(command.output(), &response);
+    response.append("))\n");
+    fwrite(response.data(), 1, response.size(), stdout);
+    if (std::cin.rdbuf()->in_avail() <= 0) {
+      fflush(stdout);
+    }
   }
+  fflush(stdout);
 }
 
 }  // namespace
@@ -51,13 +51,15 @@ void PrintField(
     const protobuf::Message &message,
     const protobuf::Reflection &reflection,
     const protobuf::FieldDescriptor &field,
-    std::vector<string>* output);
+    string *output);
 void PrintFieldValue(
     const protobuf::Message &message,
     const protobuf::Reflection &reflection,
     const protobuf::FieldDescriptor &field,
     int index,
-    std::vector<string>* output);
+    string *output);
+void AppendNormalizedSymbol(const string &symbol, string *output);
+void AppendQuotedString(const string &str, string *output);
 }  // namespace
 
 
@@ -176,23 +178,23 @@ void ParseInputLine(
 // - other types are expressed as is
 //
 // Input parameter 'message' is a protocol buffer to be output.
-// 'output' is a text buffer to output 'message'.
+// 'output' is a text buffer to which 'message' is appended.
 //
 // This function never outputs newlines except for ones in strings.
 void PrintMessage(
     const protobuf::Message &message,
-    std::vector<string>* output) {
+    string *output) {
   DCHECK(output);
 
   const protobuf::Reflection *reflection = message.GetReflection();
   std::vector<const protobuf::FieldDescriptor*> fields;
   reflection->ListFields(message, &fields);
 
-  output->push_back("(");
+  output->push_back('(');
   for (int i = 0; i < fields.size(); ++i) {
     PrintField(message, *reflection, *fields[i], output);
   }
-  output->push_back(")");
+  output->push_back(')');
 }
 
 
@@ -214,10 +216,9 @@ string NormalizeSymbol(const string &symbol) {
 //
 // Control characters, including newline('\n'), in a given string remain as is.
 string QuoteString(const string &str) {
-  string tmp, escaped_body;
-  mozc::Util::StringReplace(str, "\\", "\\\\", true, &tmp);
-  mozc::Util::StringReplace(tmp, "\"", "\\\"", true, &escaped_body);
-  return "\"" + escaped_body + "\"";
+  string quoted;
+  AppendQuotedString(str, &quoted);
+  return quoted;
 }
 
 // Unquotes and unescapes a double-quoted string.
@@ -381,27 +382,27 @@ void PrintField(
     const protobuf::Message &message,
     const protobuf::Reflection &reflection,
     const protobuf::FieldDescriptor &field,
-    std::vector<string>* output) {
-  output->push_back("(");
-  output->push_back(NormalizeSymbol(field.name()));
+    string *output) {
+  output->push_back('(');
+  AppendNormalizedSymbol(field.name(), output);
 
   if (!field.is_repeated()) {
-    output->push_back(" . ");  // Print an object as a value.
+    output->append(" . ");  // Print an object as a value.
     PrintFieldValue(message, reflection, field, -1 /* dummy arg */, output);
   } else {
-    output->push_back(" ");  // Print objects as a list.
+    output->push_back(' ');  // Print objects as a list.
     const int count = reflection.FieldSize(message, &field);
     const bool is_message =
         field.cpp_type() == protobuf::FieldDescriptor::CPPTYPE_MESSAGE;
     for (int i = 0; i < count; ++i) {
       if (i != 0 && !is_message) {
-        output->push_back(" ");
+        output->push_back(' ');
       }
       PrintFieldValue(message, reflection, field, i, output);
     }
   }
 
-  output->push_back(")");
+  output->push_back(')');
 }
 
 // Prints a value of a field of a protocol buffer in S-expression.
@@ -422,7 +423,7 @@ void PrintFieldValue(
     const protobuf::Reflection &reflection,
     const protobuf::FieldDescriptor &field,
     int index,
-    std::vector<string>* output) {
+    string *output) {
 #define GET_FIELD_VALUE(METHOD_TYPE)                                \
     (field.is_repeated() ?                                          \
      reflection.GetRepeated##METHOD_TYPE(message, &field, index) :  \
@@ -432,7 +433,7 @@ void PrintFieldValue(
     // Number (integer and floating point)
 #define PRINT_FIELD_VALUE(PROTO_CPP_TYPE, METHOD_TYPE, CPP_TYPE, FORMAT)    \
     case protobuf::FieldDescriptor::CPPTYPE_##PROTO_CPP_TYPE:               \
-        output->push_back(mozc::Util::StringPrintf(                         \
+        output->append(mozc::Util::StringPrintf(                            \
             FORMAT, static_cast<CPP_TYPE>(GET_FIELD_VALUE(METHOD_TYPE))));  \
         break;
 
@@ -452,20 +453,20 @@ void PrintFieldValue(
 #undef PRINT_FIELD_VALUE
 
     case protobuf::FieldDescriptor::CPPTYPE_BOOL:  // bool
-      output->push_back(GET_FIELD_VALUE(Bool) ? "t" : "nil");
+      output->append(GET_FIELD_VALUE(Bool) ? "t" : "nil");
       break;
 
     case protobuf::FieldDescriptor::CPPTYPE_ENUM:  // enum
-      output->push_back(NormalizeSymbol(GET_FIELD_VALUE(Enum)->name()));
+      AppendNormalizedSymbol(GET_FIELD_VALUE(Enum)->name(), output);
       break;
 
     case protobuf::FieldDescriptor::CPPTYPE_STRING: {  // string
-      string str;
-      str = field.is_repeated() ?
-            reflection.GetRepeatedStringReference(
-                message, &field, index, &str) :
-            reflection.GetStringReference(message, &field, &str);
-      output->push_back(QuoteString(str));
+      string scratch;
+      const string &str = field.is_repeated() ?
+          reflection.GetRepeatedStringReference(
+              message, &field, index, &scratch) :
+          reflection.GetStringReference(message, &field, &scratch);
+      AppendQuotedString(str, output);
       break;
     }
 
@@ -478,6 +479,34 @@ void PrintFieldValue(
 #undef GET_FIELD_VALUE
 }
 
+// Appends a symbol normalized in the way of NormalizeSymbol().  Names of
+// protobuf fields and enum values are ASCII, so only ASCII letters are
+// lowered here.
+void AppendNormalizedSymbol(const string &symbol, string *output) {
+  for (string::const_iterator i = symbol.begin(); i != symbol.end(); ++i) {
+    if (*i == '_') {
+      output->push_back('-');
+    } else if ('A' <= *i && *i <= 'Z') {
+      output->push_back(*i - 'A' + 'a');
+    } else {
+      output->push_back(*i);
+    }
+  }
+}
+
+// Appends a string literal quoted in the way of QuoteString().
+void AppendQuotedString(const string &str, string *output) {
+  output->reserve(output->size() + str.size() + 2);
+  output->push_back('\"');
+  for (string::const_iterator i = str.begin(); i != str.end(); ++i) {
+    if (*i == '\\' || *i == '\"') {
+      output->push_back('\\');
+    }
+    output->push_back(*i);
+  }
+  output->push_back('\"');
+}
+
 }  // namespace
 }  // namespace emacs
 }  // namespace mozc
@@ -76,11 +76,12 @@ void ParseInputLine(
 // - other types are expressed as is
 //
 // Input parameter 'message' is a protocol buffer to be output.
-// 'output' is a text buffer to output 'message'.
+// 'output' is a text buffer to which 'message' is appended.  Values are
+// written into it directly, so the caller can reuse one buffer across
+// responses.
 //
 // This function never outputs newlines except for ones in strings.
-void PrintMessage(const mozc::protobuf::Message &message,
-                  std::vector<string>* output);
+void PrintMessage(const mozc::protobuf::Message &message, string *output);
 
 
 // Utilities
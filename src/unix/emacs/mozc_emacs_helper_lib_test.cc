@@ -32,7 +32,6 @@
 #include <algorithm>
 
 #include "base/protobuf/message.h"
-#include "base/util.h"
 #include "protocol/commands.pb.h"
 #include "testing/base/public/googletest.h"
 #include "testing/base/public/gunit.h"
@@ -55,10 +54,8 @@ class MozcEmacsHelperLibTest : public testing::Test {
 
   void PrintAndTestSexpr(
       const mozc::protobuf::Message &message, const string &sexpr) {
-    std::vector<string> buffer;
-    mozc::emacs::PrintMessage(message, &buffer);
     string output;
-    mozc::Util::JoinStrings(buffer, "", &output);
+    mozc::emacs::PrintMessage(message, &output);
     EXPECT_EQ(sexpr, output);
   }
 
@@ -215,6 +212,12 @@ TEST_F(MozcEmacsHelperLibTest, PrintMessage) {
                            "(value . \"なし\")))))"
      "(key . ((special-key . page-up)"
              "(modifier-keys key-down shift))))");
+
+  // PrintMessage appends to the given buffer.
+  string buffer = "(output . ";
+  mozc::emacs::PrintMessage(key_event, &buffer);
+  EXPECT_EQ("(output . ((special-key . page-up)"
+            "(modifier-keys key-down shift))", buffer);
 }
 
 TEST_F(MozcEmacsHelperLibTest, NormalizeSymbol) {
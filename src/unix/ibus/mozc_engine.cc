@@ -36,6 +36,7 @@
 #include <map>
 #include <sstream>
 #include <string>
+#include <utility>
 
 #include "base/clock.h"
 #include "base/const.h"
@@ -47,6 +48,7 @@
 #include "base/singleton.h"
 #include "base/system_util.h"
 #include "base/util.h"
+#include "client/async_client.h"
 #include "client/client.h"
 #include "protocol/commands.pb.h"
 #include "protocol/config.pb.h"
@@ -74,6 +76,9 @@
 DEFINE_bool(use_mozc_renderer, true,
             "The engine tries to use mozc_renderer if available.");
 #endif  // ENABLE_GTK_RENDERER
+DEFINE_bool(async_key_event, true,
+            "The engine does not block the IBus main loop while mozc_server "
+            "is processing key events.");
 
 namespace {
 
@@ -158,19 +163,11 @@ namespace mozc {
 namespace ibus {
 
 namespace {
-struct SurroundingTextInfo {
-  SurroundingTextInfo()
-      : relative_selected_length(0) {}
-  int32 relative_selected_length;
-  string preceding_text;
-  string selection_text;
-  string following_text;
-};
-
 bool GetSurroundingText(IBusEngine *engine,
 #ifdef MOZC_ENABLE_X11_SELECTION_MONITOR
                         SelectionMonitorInterface *selection_monitor,
 #endif  // MOZC_ENABLE_X11_SELECTION_MONITOR
+                        SurroundingTextCache *cache,
                         SurroundingTextInfo *info) {
   if (!(engine->client_capabilities & IBUS_CAP_SURROUNDING_TEXT)) {
     VLOG(1) << "Give up CONVERT_REVERSE due to client_capabilities: "
@@ -198,20 +195,10 @@ bool GetSurroundingText(IBusEngine *engine,
   }
 #endif  // MOZC_ENABLE_X11_SELECTION_MONITOR
 
-  if (!SurroundingTextUtil::GetSafeDelta(cursor_pos, anchor_pos,
-                                         &info->relative_selected_length)) {
+  if (!cache->Get(surrounding_text, cursor_pos, anchor_pos, info)) {
     LOG(ERROR) << "Too long text selection.";
     return false;
   }
-
-  const size_t selection_start = std::min(cursor_pos, anchor_pos);
-  const size_t selection_length = abs(info->relative_selected_length);
-  Util::SubStringPiece(surrounding_text, 0, selection_start)
-      .CopyToString(&info->preceding_text);
-  Util::SubStringPiece(surrounding_text, selection_start, selection_length)
-      .CopyToString(&info->selection_text);
-  Util::SubStringPiece(surrounding_text, selection_start + selection_length)
-      .CopyToString(&info->following_text);
   return true;
 }
 
@@ -221,6 +208,9 @@ std::unique_ptr<client::ClientInterface> CreateAndConfigureClient() {
   // Currently client capability is fixed.
   commands::Capability capability;
   capability.set_text_deletion(commands::Capability::DELETE_PRECEDING_TEXT);
+  // Neither the candidate window of IBus nor the renderer uses
+  // all_candidate_words.
+  capability.set_omit_all_candidate_words(true);
   client->set_client_capability(capability);
   return client;
 }
@@ -243,6 +233,39 @@ CandidateWindowHandlerInterface *createGtkCandidateWindowHandler(
 
 }  // namespace
 
+struct MozcEngine::PendingKeyEvent {
+  PendingKeyEvent(IBusEngine *engine,
+                  guint keyval,
+                  guint keycode,
+                  guint modifiers,
+                  bool sent)
+      : engine(engine),
+        keyval(keyval),
+        keycode(keycode),
+        modifiers(modifiers),
+        sent(sent),
+        done(!sent),
+        succeeded(false) {
+    g_object_ref(engine);
+  }
+  ~PendingKeyEvent() {
+    g_object_unref(engine);
+  }
+
+  IBusEngine *engine;
+  const guint keyval;
+  const guint keycode;
+  const guint modifiers;
+  // False if the key event is just forwarded to the client.
+  const bool sent;
+  // Written by the worker thread of |async_client_|.
+  bool done;
+  bool succeeded;
+  commands::Output output;
+
+  DISALLOW_COPY_AND_ASSIGN(PendingKeyEvent);
+};
+
 MozcEngine::MozcEngine()
     : last_sync_time_(Clock::GetTime()),
       key_event_handler_(new KeyEventHandler),
@@ -258,7 +281,8 @@ MozcEngine::MozcEngine()
           new renderer::RendererClient())),
 #endif  // ENABLE_GTK_RENDERER
       ibus_candidate_window_handler_(new IBusCandidateWindowHandler()),
-      preedit_method_(config::Config::ROMAN) {
+      preedit_method_(config::Config::ROMAN),
+      idle_source_id_(0) {
 #ifdef MOZC_ENABLE_X11_SELECTION_MONITOR
   if (selection_monitor_.get() != NULL) {
     selection_monitor_->StartMonitoring();
@@ -270,6 +294,16 @@ MozcEngine::MozcEngine()
 }
 
 MozcEngine::~MozcEngine() {
+  if (async_client_.get() != NULL) {
+    // The pending key events are not applied as the clients are going away.
+    async_client_->Flush();
+    scoped_lock l(&pending_key_events_mutex_);
+    if (idle_source_id_ != 0) {
+      g_source_remove(idle_source_id_);
+      idle_source_id_ = 0;
+    }
+  }
+  pending_key_events_.clear();
   SyncData(true);
 }
 
@@ -278,6 +312,7 @@ void MozcEngine::CandidateClicked(
     guint index,
     guint button,
     guint state) {
+  WaitForPendingKeyEvents();
   if (index >= unique_candidate_ids_.size()) {
     return;
   }
@@ -302,12 +337,15 @@ void MozcEngine::CursorUp(IBusEngine *engine) {
 }
 
 void MozcEngine::Disable(IBusEngine *engine) {
+  WaitForPendingKeyEvents();
   RevertSession(engine);
+  surrounding_text_cache_.Invalidate();
   GetCandidateWindowHandler(engine)->Hide(engine);
   key_event_handler_->Clear();
 }
 
 void MozcEngine::Enable(IBusEngine *engine) {
+  WaitForPendingKeyEvents();
   // Launch mozc_server
   client_->EnsureConnection();
   UpdatePreeditMethod();
@@ -324,11 +362,14 @@ void MozcEngine::Enable(IBusEngine *engine) {
 }
 
 void MozcEngine::FocusIn(IBusEngine *engine) {
+  WaitForPendingKeyEvents();
+  surrounding_text_cache_.Invalidate();
   property_handler_->Register(engine);
   UpdatePreeditMethod();
 }
 
 void MozcEngine::FocusOut(IBusEngine *engine) {
+  WaitForPendingKeyEvents();
   GetCandidateWindowHandler(engine)->Hide(engine);
   property_handler_->ResetContentType(engine);
 
@@ -361,8 +402,12 @@ gboolean MozcEngine::ProcessKeyEvent(
   VLOG(2) << "keyval: " << keyval
           << ", keycode: " << keycode
           << ", modifiers: " << modifiers;
+  // Apply the responses which have already arrived so that the states below
+  // are as fresh as possible.
+  ProcessPendingKeyEvents();
+
   if (property_handler_->IsDisabled()) {
-    return FALSE;
+    return PassThroughKeyEvent(engine, keyval, keycode, modifiers);
   }
 
   // TODO(yusukes): use |layout| in IBusEngineDesc if possible.
@@ -373,28 +418,39 @@ gboolean MozcEngine::ProcessKeyEvent(
   if (!key_event_handler_->GetKeyEvent(
           keyval, keycode, modifiers, preedit_method_, layout_is_jp, &key)) {
     // Doesn't send a key event to mozc_server.
-    return FALSE;
+    return PassThroughKeyEvent(engine, keyval, keycode, modifiers);
   }
 
   VLOG(2) << key.DebugString();
-  if (!property_handler_->IsActivated() &&
-      !config::ImeSwitchUtil::IsDirectModeCommand(key)) {
-    return FALSE;
+  // While preceding key events are pending, the activation state and the
+  // composition mode known here may be outdated, e.g. when one of them turns
+  // on IME. Leave them to mozc_server in that case.
+  const bool has_pending_key_events = !pending_key_events_.empty();
+  if (!has_pending_key_events) {
+    if (!property_handler_->IsActivated() &&
+        !config::ImeSwitchUtil::IsDirectModeCommand(key)) {
+      return FALSE;
+    }
+    key.set_activated(property_handler_->IsActivated());
+    key.set_mode(property_handler_->GetOriginalCompositionMode());
   }
 
-  key.set_activated(property_handler_->IsActivated());
-  key.set_mode(property_handler_->GetOriginalCompositionMode());
-
   commands::Context context;
   SurroundingTextInfo surrounding_text_info;
   if (GetSurroundingText(engine,
 #ifdef MOZC_ENABLE_X11_SELECTION_MONITOR
                          selection_monitor_.get(),
 #endif  // MOZC_ENABLE_X11_SELECTION_MONITOR
+                         &surrounding_text_cache_,
                          &surrounding_text_info)) {
     context.set_preceding_text(surrounding_text_info.preceding_text);
     context.set_following_text(surrounding_text_info.following_text);
   }
+
+  if (FLAGS_async_key_event) {
+    return SendKeyAsync(engine, keyval, keycode, modifiers, key, context);
+  }
+
   commands::Output output;
   if (!client_->SendKeyWithContext(key, context, &output)) {
     LOG(ERROR) << "SendKey failed";
@@ -409,9 +465,98 @@ gboolean MozcEngine::ProcessKeyEvent(
   return consumed ? TRUE : FALSE;
 }
 
+gboolean MozcEngine::SendKeyAsync(IBusEngine *engine,
+                                  guint keyval,
+                                  guint keycode,
+                                  guint modifiers,
+                                  const commands::KeyEvent &key,
+                                  const commands::Context &context) {
+  if (async_client_.get() == NULL) {
+    async_client_.reset(new client::AsyncClient(client_.get(), false));
+  }
+  PendingKeyEvent *event =
+      new PendingKeyEvent(engine, keyval, keycode, modifiers, true);
+  pending_key_events_.push_back(std::unique_ptr<PendingKeyEvent>(event));
+  async_client_->SendKeyAsync(
+      key, context,
+      [this, event](uint64 sequence, bool succeeded,
+                    const commands::Output &output) {
+        scoped_lock l(&pending_key_events_mutex_);
+        event->succeeded = succeeded;
+        event->output.CopyFrom(output);
+        event->done = true;
+        if (idle_source_id_ == 0) {
+          idle_source_id_ = g_idle_add(ProcessPendingKeyEventsCallback, this);
+        }
+      });
+  // The key event is forwarded later if mozc_server does not consume it.
+  return TRUE;
+}
+
+gboolean MozcEngine::PassThroughKeyEvent(IBusEngine *engine,
+                                         guint keyval,
+                                         guint keycode,
+                                         guint modifiers) {
+  if (pending_key_events_.empty()) {
+    return FALSE;
+  }
+  pending_key_events_.push_back(std::unique_ptr<PendingKeyEvent>(
+      new PendingKeyEvent(engine, keyval, keycode, modifiers, false)));
+  return TRUE;
+}
+
+void MozcEngine::ProcessPendingKeyEvents() {
+  while (!pending_key_events_.empty()) {
+    {
+      scoped_lock l(&pending_key_events_mutex_);
+      if (!pending_key_events_.front()->done) {
+        return;
+      }
+    }
+    std::unique_ptr<PendingKeyEvent> event(
+        std::move(pending_key_events_.front()));
+    pending_key_events_.pop_front();
+
+    bool consumed = false;
+    if (event->sent) {
+      if (event->succeeded) {
+        VLOG(2) << event->output.DebugString();
+        UpdateAll(event->engine, event->output);
+        consumed = event->output.consumed();
+      } else {
+        LOG(ERROR) << "SendKey failed";
+      }
+    }
+    if (!consumed) {
+      ibus_engine_forward_key_event(event->engine, event->keyval,
+                                    event->keycode, event->modifiers);
+    }
+  }
+}
+
+void MozcEngine::WaitForPendingKeyEvents() {
+  if (async_client_.get() == NULL) {
+    return;
+  }
+  async_client_->Flush();
+  ProcessPendingKeyEvents();
+}
+
+// static
+gboolean MozcEngine::ProcessPendingKeyEventsCallback(gpointer user_data) {
+  MozcEngine *mozc_engine = static_cast<MozcEngine *>(user_data);
+  {
+    scoped_lock l(&mozc_engine->pending_key_events_mutex_);
+    mozc_engine->idle_source_id_ = 0;
+  }
+  mozc_engine->ProcessPendingKeyEvents();
+  return FALSE;  // Removes the idle source.
+}
+
 void MozcEngine::PropertyActivate(IBusEngine *engine,
                                   const gchar *property_name,
                                   guint property_state) {
+  WaitForPendingKeyEvents();
   property_handler_->ProcessPropertyActivate(engine, property_name,
                                              property_state);
 }
@@ -427,7 +572,11 @@ void MozcEngine::PropertyShow(IBusEngine *engine,
 }
 
 void MozcEngine::Reset(IBusEngine *engine) {
+  WaitForPendingKeyEvents();
   RevertSession(engine);
+  // Reset is sent when the client moves the cursor by itself, e.g. mouse
+  // click. The cached text is no longer reliable.
+  surrounding_text_cache_.Invalidate();
 }
 
 void MozcEngine::SetCapabilities(IBusEngine *engine,
@@ -446,6 +595,7 @@ void MozcEngine::SetCursorLocation(IBusEngine *engine,
 void MozcEngine::SetContentType(IBusEngine *engine,
                                 guint purpose,
                                 guint hints) {
+  WaitForPendingKeyEvents();
   const bool prev_disabled =
       property_handler_->IsDisabled();
   property_handler_->UpdateContentType(engine);
@@ -512,12 +662,13 @@ bool MozcEngine::UpdateDeletionRange(IBusEngine *engine,
     ibus_engine_delete_surrounding_text(
         engine,
         output.deletion_range().offset(), output.deletion_range().length());
+    surrounding_text_cache_.Invalidate();
   }
   return true;
 }
 
 bool MozcEngine::UpdateResult(IBusEngine *engine,
-                              const commands::Output &output) const {
+                              const commands::Output &output) {
   if (!output.has_result()) {
     VLOG(2) << "output doesn't contain result";
     return true;
@@ -526,6 +677,7 @@ bool MozcEngine::UpdateResult(IBusEngine *engine,
   IBusText *text = ibus_text_new_from_string(output.result().value().c_str());
   ibus_engine_commit_text(engine, text);
   // |text| is released by ibus_engine_commit_text.
+  surrounding_text_cache_.OnCommit(output.result().value());
   return true;
 }
 
@@ -643,6 +795,7 @@ bool MozcEngine::ExecuteCallback(IBusEngine *engine,
 #ifdef MOZC_ENABLE_X11_SELECTION_MONITOR
                               selection_monitor_.get(),
 #endif  // MOZC_ENABLE_X11_SELECTION_MONITOR
+                              &surrounding_text_cache_,
                               &surrounding_text_info)) {
         return false;
       }
@@ -653,6 +806,10 @@ bool MozcEngine::ExecuteCallback(IBusEngine *engine,
       return false;
   }
 
+  if (async_client_.get() != NULL) {
+    // The worker thread may still be sending the following key events.
+    async_client_->Flush();
+  }
   commands::Output new_output;
   if (!client_->SendCommand(session_command, &new_output)) {
     LOG(ERROR) << "Callback Command Failed";
@@ -30,18 +30,22 @@
 #ifndef MOZC_UNIX_IBUS_MOZC_ENGINE_H_
 #define MOZC_UNIX_IBUS_MOZC_ENGINE_H_
 
+#include <deque>
 #include <memory>
 #include <set>
 #include <vector>
 
+#include "base/mutex.h"
 #include "base/port.h"
 #include "protocol/commands.pb.h"
 #include "testing/base/public/gunit_prod.h"
 #include "unix/ibus/engine_interface.h"
+#include "unix/ibus/surrounding_text_util.h"
 
 namespace mozc {
 
 namespace client {
+class AsyncClient;
 class ClientInterface;
 }
 
@@ -114,7 +118,7 @@ class MozcEngine : public EngineInterface {
   // based on the content of |output|.
   bool UpdateAll(IBusEngine *engine, const commands::Output &output);
   // Inserts a result text based on the content of |output|.
-  bool UpdateResult(IBusEngine *engine, const commands::Output &output) const;
+  bool UpdateResult(IBusEngine *engine, const commands::Output &output);
   // Updates |unique_candidate_ids_|.
   bool UpdateCandidateIDMapping(const commands::Output &output);
   // Updates the deletion range message based on the content of |output|.
@@ -141,6 +145,38 @@ class MozcEngine : public EngineInterface {
   CandidateWindowHandlerInterface *GetCandidateWindowHandler(
       IBusEngine *engine);
 
+  struct PendingKeyEvent;
+
+  // Sends |key| to mozc_server without waiting for the response and returns
+  // TRUE. The output is applied later on the main loop, and the key event is
+  // forwarded to the client if it turns out not to be consumed.
+  gboolean SendKeyAsync(IBusEngine *engine,
+                        guint keyval,
+                        guint keycode,
+                        guint modifiers,
+                        const commands::KeyEvent &key,
+                        const commands::Context &context);
+
+  // Returns FALSE for a key event which is not sent to mozc_server. While
+  // preceding key events are still waiting for the responses, the key event
+  // is instead forwarded after them so that the order is kept, and TRUE is
+  // returned.
+  gboolean PassThroughKeyEvent(IBusEngine *engine,
+                               guint keyval,
+                               guint keycode,
+                               guint modifiers);
+
+  // Applies the outputs of the pending key events in the order they were
+  // sent, up to the first one which is still waiting for the response.
+  void ProcessPendingKeyEvents();
+
+  // Waits for all the pending key events and applies their outputs. Must be
+  // called before using |client_| directly.
+  void WaitForPendingKeyEvents();
+
+  // The idle callback which calls ProcessPendingKeyEvents on the main loop.
+  static gboolean ProcessPendingKeyEventsCallback(gpointer user_data);
+
   uint64 last_sync_time_;
   std::unique_ptr<KeyEventHandler> key_event_handler_;
   std::unique_ptr<client::ClientInterface> client_;
@@ -163,6 +199,20 @@ class MozcEngine : public EngineInterface {
   // Unique IDs of candidates that are currently shown.
   std::vector<int32> unique_candidate_ids_;
 
+  // Surrounding text of the focused client, maintained across commits.
+  SurroundingTextCache surrounding_text_cache_;
+
+  // Key events sent asynchronously, in the order they were sent. Only the
+  // main loop adds and removes the entries.
+  std::deque<std::unique_ptr<PendingKeyEvent>> pending_key_events_;
+  // Guards the responses in |pending_key_events_| and |idle_source_id_|,
+  // which are written by the worker thread of |async_client_|.
+  Mutex pending_key_events_mutex_;
+  guint idle_source_id_;
+  // Created on the first asynchronous key event. Declared last so that the
+  // queued requests are processed before the members above are destroyed.
+  std::unique_ptr<client::AsyncClient> async_client_;
+
   friend class LaunchToolTest;
   FRIEND_TEST(LaunchToolTest, LaunchToolTest);
 
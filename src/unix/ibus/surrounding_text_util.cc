@@ -188,5 +188,63 @@ bool SurroundingTextUtil::GetAnchorPosFromSelection(
                                  cursor_pos, anchor_pos);
 }
 
+SurroundingTextCache::SurroundingTextCache()
+    : valid_(false),
+      cursor_pos_(0),
+      anchor_pos_(0) {}
+
+bool SurroundingTextCache::Get(const string &surrounding_text,
+                               guint cursor_pos,
+                               guint anchor_pos,
+                               SurroundingTextInfo *info) {
+  DCHECK(info);
+  if (valid_ && cursor_pos == cursor_pos_ && anchor_pos == anchor_pos_ &&
+      surrounding_text == surrounding_text_) {
+    *info = info_;
+    return true;
+  }
+
+  valid_ = false;
+  int32 relative_selected_length = 0;
+  if (!SurroundingTextUtil::GetSafeDelta(cursor_pos, anchor_pos,
+                                         &relative_selected_length)) {
+    return false;
+  }
+
+  const size_t selection_start = std::min(cursor_pos, anchor_pos);
+  const size_t selection_length = abs(relative_selected_length);
+  info_.relative_selected_length = relative_selected_length;
+  Util::SubStringPiece(surrounding_text, 0, selection_start)
+      .CopyToString(&info_.preceding_text);
+  Util::SubStringPiece(surrounding_text, selection_start, selection_length)
+      .CopyToString(&info_.selection_text);
+  Util::SubStringPiece(surrounding_text, selection_start + selection_length)
+      .CopyToString(&info_.following_text);
+
+  surrounding_text_ = surrounding_text;
+  cursor_pos_ = cursor_pos;
+  anchor_pos_ = anchor_pos;
+  valid_ = true;
+  *info = info_;
+  return true;
+}
+
+void SurroundingTextCache::OnCommit(const string &committed_text) {
+  if (!valid_) {
+    return;
+  }
+  info_.preceding_text.append(committed_text);
+  info_.selection_text.clear();
+  info_.relative_selected_length = 0;
+}
+
+void SurroundingTextCache::Invalidate() {
+  valid_ = false;
+  surrounding_text_.clear();
+  cursor_pos_ = 0;
+  anchor_pos_ = 0;
+  info_ = SurroundingTextInfo();
+}
+
 }  // namespace ibus
 }  // namespace mozc
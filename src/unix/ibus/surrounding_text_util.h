@@ -38,6 +38,15 @@
 namespace mozc {
 namespace ibus {
 
+struct SurroundingTextInfo {
+  SurroundingTextInfo()
+      : relative_selected_length(0) {}
+  int32 relative_selected_length;
+  string preceding_text;
+  string selection_text;
+  string following_text;
+};
+
 class SurroundingTextUtil {
  public:
   // Calculates |from| - |to| and stores the result into |delta| with
@@ -68,6 +77,45 @@ class SurroundingTextUtil {
   DISALLOW_IMPLICIT_CONSTRUCTORS(SurroundingTextUtil);
 };
 
+// Keeps the surrounding text reported by the client split into preceding,
+// selected and following text so that it is re-split only when the client
+// reports a different text or cursor position. Text committed by the engine
+// is appended to the cached preceding text immediately because the client
+// reports the new surrounding text asynchronously, typically after the next
+// key event has already been sent to the server.
+class SurroundingTextCache {
+ public:
+  SurroundingTextCache();
+
+  // Stores the split surrounding text into |info|. |surrounding_text|,
+  // |cursor_pos| and |anchor_pos| are the values reported by the client.
+  // When they are the same as the last call, the cached result (including
+  // the text committed since then) is returned without splitting the text
+  // again. Returns false when the selection is too long.
+  bool Get(const string &surrounding_text,
+           guint cursor_pos,
+           guint anchor_pos,
+           SurroundingTextInfo *info);
+
+  // Appends |committed_text| to the cached preceding text. The committed text
+  // replaces the selection, if any.
+  void OnCommit(const string &committed_text);
+
+  // Discards the cached text. Should be called when the cached text can no
+  // longer be maintained incrementally, e.g. when the focus moves or the
+  // preceding text is deleted.
+  void Invalidate();
+
+ private:
+  bool valid_;
+  string surrounding_text_;
+  guint cursor_pos_;
+  guint anchor_pos_;
+  SurroundingTextInfo info_;
+
+  DISALLOW_COPY_AND_ASSIGN(SurroundingTextCache);
+};
+
 }  // namespace ibus
 }  // namespace mozc
 
@@ -161,5 +161,86 @@ TEST(SurroundingTextUtilTest, GetAnchorPosFromSelection) {
   EXPECT_EQ(0, anchor_pos);
 }
 
+TEST(SurroundingTextCacheTest, Get) {
+  SurroundingTextCache cache;
+  SurroundingTextInfo info;
+
+  EXPECT_TRUE(cache.Get("あいうえお", 2, 2, &info));
+  EXPECT_EQ("あい", info.preceding_text);
+  EXPECT_EQ("", info.selection_text);
+  EXPECT_EQ("うえお", info.following_text);
+  EXPECT_EQ(0, info.relative_selected_length);
+
+  // Forward selection.
+  EXPECT_TRUE(cache.Get("あいうえお", 1, 3, &info));
+  EXPECT_EQ("あ", info.preceding_text);
+  EXPECT_EQ("いう", info.selection_text);
+  EXPECT_EQ("えお", info.following_text);
+  EXPECT_EQ(-2, info.relative_selected_length);
+
+  // Backward selection.
+  EXPECT_TRUE(cache.Get("あいうえお", 3, 1, &info));
+  EXPECT_EQ("あ", info.preceding_text);
+  EXPECT_EQ("いう", info.selection_text);
+  EXPECT_EQ("えお", info.following_text);
+  EXPECT_EQ(2, info.relative_selected_length);
+
+  const guint kTooLargeGUint =
+      static_cast<guint>(std::numeric_limits<int32>::max()) + 42;
+  EXPECT_FALSE(cache.Get("あいうえお", kTooLargeGUint, 0, &info));
+}
+
+TEST(SurroundingTextCacheTest, OnCommit) {
+  SurroundingTextCache cache;
+  SurroundingTextInfo info;
+
+  // Nothing is cached yet.
+  cache.OnCommit("か");
+  EXPECT_TRUE(cache.Get("あい", 2, 2, &info));
+  EXPECT_EQ("あい", info.preceding_text);
+
+  // The client has not reported the new surrounding text yet.
+  cache.OnCommit("か");
+  EXPECT_TRUE(cache.Get("あい", 2, 2, &info));
+  EXPECT_EQ("あいか", info.preceding_text);
+  EXPECT_EQ("", info.following_text);
+
+  cache.OnCommit("き");
+  EXPECT_TRUE(cache.Get("あい", 2, 2, &info));
+  EXPECT_EQ("あいかき", info.preceding_text);
+
+  // The client reports the new surrounding text.
+  EXPECT_TRUE(cache.Get("あいかきく", 4, 4, &info));
+  EXPECT_EQ("あいかき", info.preceding_text);
+  EXPECT_EQ("く", info.following_text);
+
+  // The committed text replaces the selection.
+  EXPECT_TRUE(cache.Get("あいう", 1, 2, &info));
+  cache.OnCommit("か");
+  EXPECT_TRUE(cache.Get("あいう", 1, 2, &info));
+  EXPECT_EQ("あか", info.preceding_text);
+  EXPECT_EQ("", info.selection_text);
+  EXPECT_EQ("う", info.following_text);
+  EXPECT_EQ(0, info.relative_selected_length);
+}
+
+TEST(SurroundingTextCacheTest, Invalidate) {
+  SurroundingTextCache cache;
+  SurroundingTextInfo info;
+
+  EXPECT_TRUE(cache.Get("あい", 2, 2, &info));
+  cache.OnCommit("か");
+  cache.Invalidate();
+
+  // The text reported by the client is used as is.
+  EXPECT_TRUE(cache.Get("あい", 2, 2, &info));
+  EXPECT_EQ("あい", info.preceding_text);
+
+  cache.Invalidate();
+  cache.OnCommit("か");
+  EXPECT_TRUE(cache.Get("あい", 2, 2, &info));
+  EXPECT_EQ("あい", info.preceding_text);
+}
+
 }  // namespace ibus
 }  // namespace mozc
@@ -30,9 +30,15 @@
 #include "usage_stats/usage_stats.h"
 
 #include <algorithm>
+#include <atomic>
+#include <cstring>
 #include <numeric>
+#include <utility>
+#include <vector>
 
 #include "base/logging.h"
+#include "base/mutex.h"
+#include "base/singleton.h"
 #include "config/stats_config_util.h"
 #include "storage/registry.h"
 #include "usage_stats/usage_stats.pb.h"
@@ -105,6 +111,186 @@ bool SetterInternal(const string &name, const Stats &stats) {
   }
   return true;
 }
+
+const uint32 kNoMinTime = 0xFFFFFFFF;
+
+// Updates of a stats item which are not merged into the registry yet.  All
+// the members are updated with relaxed atomic operations, so recording a
+// stats item costs a few atomic instructions instead of a round trip of
+// Stats through the registry.
+struct PendingStats {
+  PendingStats()
+      : count(0), num_timings(0), total_time(0), min_time(kNoMinTime),
+        max_time(0), int_value(0), has_int_value(false),
+        boolean_value(false), has_boolean_value(false) {}
+
+  std::atomic<uint32> count;
+  std::atomic<uint32> num_timings;
+  std::atomic<uint64> total_time;
+  std::atomic<uint32> min_time;
+  std::atomic<uint32> max_time;
+  std::atomic<int32> int_value;
+  std::atomic<bool> has_int_value;
+  std::atomic<bool> boolean_value;
+  std::atomic<bool> has_boolean_value;
+};
+
+// The in-memory table of PendingStats indexed in the order of kStatsList.
+class PendingStatsTable {
+ public:
+  PendingStatsTable() : sorted_indices_(arraysize(kStatsList)) {
+    for (size_t i = 0; i < sorted_indices_.size(); ++i) {
+      sorted_indices_[i] = i;
+    }
+    std::sort(sorted_indices_.begin(), sorted_indices_.end(),
+              [](size_t lhs, size_t rhs) {
+                return strcmp(kStatsList[lhs], kStatsList[rhs]) < 0;
+              });
+  }
+
+  // Returns the pending stats of |name| by binary search, or NULL if |name|
+  // is not in the list.
+  PendingStats *Get(const string &name) {
+    size_t begin = 0;
+    size_t end = sorted_indices_.size();
+    while (begin < end) {
+      const size_t mid = begin + (end - begin) / 2;
+      const size_t index = sorted_indices_[mid];
+      const int result = strcmp(name.c_str(), kStatsList[index]);
+      if (result == 0) {
+        return &stats_[index];
+      }
+      if (result < 0) {
+        end = mid;
+      } else {
+        begin = mid + 1;
+      }
+    }
+    return NULL;
+  }
+
+  // Merges the pending stats into the registry and resets them.  The pending
+  // stats are discarded if usage stats is disabled.
+  void Flush() {
+    scoped_lock l(&flush_mutex_);
+    const bool enabled = config::StatsConfigUtil::IsEnabled();
+    for (size_t i = 0; i < arraysize(kStatsList); ++i) {
+      PendingStats *pending = &stats_[i];
+      const uint32 count =
+          pending->count.exchange(0, std::memory_order_relaxed);
+      if (enabled && count > 0) {
+        MergeCount(kStatsList[i], count);
+      }
+      const uint32 num_timings =
+          pending->num_timings.exchange(0, std::memory_order_relaxed);
+      if (num_timings > 0) {
+        const uint64 total_time =
+            pending->total_time.exchange(0, std::memory_order_relaxed);
+        const uint32 min_time =
+            pending->min_time.exchange(kNoMinTime, std::memory_order_relaxed);
+        const uint32 max_time =
+            pending->max_time.exchange(0, std::memory_order_relaxed);
+        if (enabled) {
+          MergeTiming(kStatsList[i], num_timings, total_time, min_time,
+                      max_time);
+        }
+      }
+      if (pending->has_int_value.exchange(false, std::memory_order_acquire) &&
+          enabled) {
+        Stats stats;
+        stats.set_name(kStatsList[i]);
+        stats.set_type(Stats::INTEGER);
+        stats.set_int_value(
+            pending->int_value.load(std::memory_order_relaxed));
+        SetterInternal(kStatsList[i], stats);
+      }
+      if (pending->has_boolean_value.exchange(false,
+                                              std::memory_order_acquire) &&
+          enabled) {
+        Stats stats;
+        stats.set_name(kStatsList[i]);
+        stats.set_type(Stats::BOOLEAN);
+        stats.set_boolean_value(
+            pending->boolean_value.load(std::memory_order_relaxed));
+        SetterInternal(kStatsList[i], stats);
+      }
+    }
+  }
+
+  // Discards all the pending stats.
+  void Clear() {
+    scoped_lock l(&flush_mutex_);
+    for (size_t i = 0; i < arraysize(kStatsList); ++i) {
+      PendingStats *pending = &stats_[i];
+      pending->count.store(0, std::memory_order_relaxed);
+      pending->num_timings.store(0, std::memory_order_relaxed);
+      pending->total_time.store(0, std::memory_order_relaxed);
+      pending->min_time.store(kNoMinTime, std::memory_order_relaxed);
+      pending->max_time.store(0, std::memory_order_relaxed);
+      pending->has_int_value.store(false, std::memory_order_relaxed);
+      pending->has_boolean_value.store(false, std::memory_order_relaxed);
+    }
+  }
+
+ private:
+  static void MergeCount(const string &name, uint32 count) {
+    Stats stats;
+    if (GetterInternal(name, Stats::COUNT, &stats)) {
+      stats.set_count(stats.count() + count);
+    } else {
+      stats.set_name(name);
+      stats.set_type(Stats::COUNT);
+      stats.set_count(count);
+    }
+    SetterInternal(name, stats);
+  }
+
+  static void MergeTiming(const string &name, uint32 num_timings,
+                          uint64 total_time, uint32 min_time,
+                          uint32 max_time) {
+    Stats stats;
+    if (GetterInternal(name, Stats::TIMING, &stats)) {
+      stats.set_num_timings(stats.num_timings() + num_timings);
+      stats.set_total_time(stats.total_time() + total_time);
+      stats.set_min_time(std::min(stats.min_time(), min_time));
+      stats.set_max_time(std::max(stats.max_time(), max_time));
+    } else {
+      stats.set_name(name);
+      stats.set_type(Stats::TIMING);
+      stats.set_num_timings(num_timings);
+      stats.set_total_time(total_time);
+      stats.set_min_time(min_time);
+      stats.set_max_time(max_time);
+    }
+    stats.set_avg_time(stats.total_time() / stats.num_timings());
+    SetterInternal(name, stats);
+  }
+
+  std::vector<size_t> sorted_indices_;
+  PendingStats stats_[arraysize(kStatsList)];
+  Mutex flush_mutex_;
+};
+
+PendingStats *GetPendingStats(const string &name) {
+  DCHECK(UsageStats::IsListed(name)) << name << " is not in the list";
+  return Singleton<PendingStatsTable>::get()->Get(name);
+}
+
+void UpdateMin(std::atomic<uint32> *min_value, uint32 value) {
+  uint32 current = min_value->load(std::memory_order_relaxed);
+  while (value < current &&
+         !min_value->compare_exchange_weak(current, value,
+                                           std::memory_order_relaxed)) {
+  }
+}
+
+void UpdateMax(std::atomic<uint32> *max_value, uint32 value) {
+  uint32 current = max_value->load(std::memory_order_relaxed);
+  while (value > current &&
+         !max_value->compare_exchange_weak(current, value,
+                                           std::memory_order_relaxed)) {
+  }
+}
 }  // namespace
 
 bool UsageStats::IsListed(const string &name) {
@@ -117,6 +303,9 @@ bool UsageStats::IsListed(const string &name) {
 }
 
 void UsageStats::ClearStats() {
+  // Integer and boolean stats are kept in the registry, so they are merged
+  // first together with the others.
+  Flush();
   string stats_str;
   Stats stats;
   for (size_t i = 0; i < arraysize(kStatsList); ++i) {
@@ -139,6 +328,7 @@ void UsageStats::ClearStats() {
 }
 
 void UsageStats::ClearAllStatsForTest() {
+  Singleton<PendingStatsTable>::get()->Clear();
   for (size_t i = 0; i < arraysize(kStatsList); ++i) {
     const string key = string(kRegistryPrefix) + kStatsList[i];
     storage::Registry::Erase(key);
@@ -146,79 +336,49 @@ void UsageStats::ClearAllStatsForTest() {
 }
 
 void UsageStats::IncrementCountBy(const string &name, uint32 val) {
-  DCHECK(IsListed(name)) << name << " is not in the list";
-  if (!config::StatsConfigUtil::IsEnabled()) {
+  PendingStats *pending = GetPendingStats(name);
+  if (pending == NULL) {
     return;
   }
-
-  Stats stats;
-  if (GetterInternal(name, Stats::COUNT, &stats)) {
-    stats.set_count(stats.count() + val);
-  } else {
-    stats.set_name(name);
-    stats.set_type(Stats::COUNT);
-    stats.set_count(val);
-  }
-
-  SetterInternal(name, stats);
+  pending->count.fetch_add(val, std::memory_order_relaxed);
 }
 
 void UsageStats::UpdateTiming(const string &name, uint32 val) {
-  DCHECK(IsListed(name)) << name << " is not in the list";
-  if (!config::StatsConfigUtil::IsEnabled()) {
+  PendingStats *pending = GetPendingStats(name);
+  if (pending == NULL) {
     return;
   }
-
-  Stats stats;
-  if (GetterInternal(name, Stats::TIMING, &stats)) {
-    stats.set_num_timings(stats.num_timings() + 1);
-    stats.set_total_time(stats.total_time() + val);
-    stats.set_avg_time(stats.total_time() / stats.num_timings());
-    stats.set_min_time(std::min(stats.min_time(), val));
-    stats.set_max_time(std::max(stats.max_time(), val));
-  } else {
-    stats.set_name(name);
-    stats.set_type(Stats::TIMING);
-    stats.set_num_timings(1);
-    stats.set_total_time(val);
-    stats.set_avg_time(val);
-    stats.set_min_time(val);
-    stats.set_max_time(val);
-  }
-
-  SetterInternal(name, stats);
+  pending->total_time.fetch_add(val, std::memory_order_relaxed);
+  UpdateMin(&pending->min_time, val);
+  UpdateMax(&pending->max_time, val);
+  pending->num_timings.fetch_add(1, std::memory_order_relaxed);
 }
 
 void UsageStats::SetInteger(const string &name, int val) {
-  DCHECK(IsListed(name)) << name << " is not in the list";
-  if (!config::StatsConfigUtil::IsEnabled()) {
+  PendingStats *pending = GetPendingStats(name);
+  if (pending == NULL) {
     return;
   }
-
-  Stats stats;
-  stats.set_name(name);
-  stats.set_type(Stats::INTEGER);
-  stats.set_int_value(val);
-
-  SetterInternal(name, stats);
+  pending->int_value.store(val, std::memory_order_relaxed);
+  pending->has_int_value.store(true, std::memory_order_release);
 }
 
 void UsageStats::SetBoolean(const string &name, bool val) {
-  DCHECK(IsListed(name)) << name << " is not in the list";
-  if (!config::StatsConfigUtil::IsEnabled()) {
+  PendingStats *pending = GetPendingStats(name);
+  if (pending == NULL) {
     return;
   }
+  pending->boolean_value.store(val, std::memory_order_relaxed);
+  pending->has_boolean_value.store(true, std::memory_order_release);
+}
 
-  Stats stats;
-  stats.set_name(name);
-  stats.set_type(Stats::BOOLEAN);
-  stats.set_boolean_value(val);
-
-  SetterInternal(name, stats);
+void UsageStats::Flush() {
+  Singleton<PendingStatsTable>::get()->Flush();
 }
 
 bool UsageStats::GetCountForTest(const string &name, uint32 *value) {
   CHECK(value != NULL);
+  Flush();
   Stats stats;
   if (!GetterInternal(name, Stats::COUNT, &stats)) {
     return false;
@@ -234,6 +394,7 @@ bool UsageStats::GetCountForTest(const string &name, uint32 *value) {
 
 bool UsageStats::GetIntegerForTest(const string &name, int32 *value) {
   CHECK(value != NULL);
+  Flush();
   Stats stats;
   if (!GetterInternal(name, Stats::INTEGER, &stats)) {
     return false;
@@ -249,6 +410,7 @@ bool UsageStats::GetIntegerForTest(const string &name, int32 *value) {
 
 bool UsageStats::GetBooleanForTest(const string &name, bool *value) {
   CHECK(value != NULL);
+  Flush();
   Stats stats;
   if (!GetterInternal(name, Stats::BOOLEAN, &stats)) {
     return false;
@@ -268,6 +430,7 @@ bool UsageStats::GetTimingForTest(const string &name,
                                   uint32 *avg_time,
                                   uint32 *min_time,
                                   uint32 *max_time) {
+  Flush();
   Stats stats;
   if (!GetterInternal(name, Stats::TIMING, &stats)) {
     return false;
@@ -302,6 +465,7 @@ bool UsageStats::GetTimingForTest(const string &name,
 }
 
 bool UsageStats::GetVirtualKeyboardForTest(const string &name, Stats *stats) {
+  Flush();
   if (!GetterInternal(name, Stats::VIRTUAL_KEYBOARD, stats)) {
     return false;
   }
@@ -316,6 +480,7 @@ bool UsageStats::GetVirtualKeyboardForTest(const string &name, Stats *stats) {
 }
 
 bool UsageStats::GetStatsForTest(const string &name, Stats *stats) {
+  Flush();
   return LoadStats(name, stats);
 }
 
@@ -368,6 +533,7 @@ void UsageStats::StoreTouchEventStats(
 }
 
 bool UsageStats::Sync() {
+  Flush();
   if (!storage::Registry::Sync()) {
     LOG(ERROR) << "sync failed";
     return false;
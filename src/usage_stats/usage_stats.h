@@ -42,6 +42,9 @@ typedef std::map<uint32, Stats::TouchEventStats> TouchEventStatsMap;
 
 class UsageStats {
  public:
+  // The count, timing, integer and boolean stats are accumulated in memory
+  // and merged into the registry by Flush() or Sync().
+
   // Updates count value
   // Increments val to current value
   static void IncrementCountBy(const string &name, uint32 val);
@@ -77,6 +80,10 @@ class UsageStats {
       const string &name,
       const std::map<string, TouchEventStatsMap> &touch_stats);
 
+  // Merges the stats accumulated in memory into the registry.  The stats are
+  // discarded if usage stats is disabled.
+  static void Flush();
+
   // Synchronizes (writes) usage data into disk. Returns false on failure.
   static bool Sync();
 
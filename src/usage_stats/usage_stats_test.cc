@@ -40,6 +40,7 @@
 #include "storage/storage_interface.h"
 #include "testing/base/public/gunit.h"
 #include "usage_stats/usage_stats.pb.h"
+#include "usage_stats/usage_stats_testing_util.h"
 
 DECLARE_string(test_tmpdir);
 
@@ -51,6 +52,7 @@ class UsageStatsTest : public ::testing::Test {
   virtual void SetUp() {
     SystemUtil::SetUserProfileDirectory(FLAGS_test_tmpdir);
     EXPECT_TRUE(storage::Registry::Clear());
+    UsageStats::ClearAllStatsForTest();
     mozc::config::StatsConfigUtil::SetHandler(&stats_config_util_);
   }
   virtual void TearDown() {
@@ -208,6 +210,35 @@ void SetEventStats(
 }
 }  // namespace
 
+TEST_F(UsageStatsTest, FlushTest) {
+  const char kCountKey[] = "ShutDown";
+  const char kTimingKey[] = "ElapsedTimeUSec";
+
+  // The updates are kept in memory until Flush().
+  UsageStats::IncrementCountBy(kCountKey, 2);
+  UsageStats::UpdateTiming(kTimingKey, 5);
+  string stats_str;
+  EXPECT_FALSE(storage::Registry::Lookup("usage_stats.ShutDown", &stats_str));
+  UsageStats::Flush();
+  EXPECT_COUNT_STATS(kCountKey, 2);
+  EXPECT_TIMING_STATS(kTimingKey, 5, 1, 5, 5);
+
+  // The next updates are merged into the registry.
+  UsageStats::IncrementCountBy(kCountKey, 3);
+  UsageStats::UpdateTiming(kTimingKey, 1);
+  UsageStats::UpdateTiming(kTimingKey, 9);
+  EXPECT_TRUE(UsageStats::Sync());
+  EXPECT_COUNT_STATS(kCountKey, 5);
+  EXPECT_TIMING_STATS(kTimingKey, 15, 3, 1, 9);
+
+  // The updates are discarded if usage stats is disabled.
+  config::StatsConfigUtil::SetEnabled(false);
+  UsageStats::IncrementCount(kCountKey);
+  UsageStats::Flush();
+  config::StatsConfigUtil::SetEnabled(true);
+  EXPECT_COUNT_STATS(kCountKey, 5);
+}
+
 TEST_F(UsageStatsTest, StoreTouchEventStats) {
   string stats_str;
   EXPECT_FALSE(storage::Registry::Lookup("usage_stats.VirtualKeyboardStats",
@@ -58,6 +58,7 @@
         '../testing/testing.gyp:gtest_main',
         'usage_stats_base.gyp:usage_stats',
         'usage_stats_base.gyp:usage_stats_protocol',
+        'usage_stats_testing_util',
       ],
       'variables': {
         'test_size': 'small',
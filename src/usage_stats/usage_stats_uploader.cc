@@ -248,6 +248,7 @@ void UsageStatsUploader::SetClientIdHandler(
 
 void UsageStatsUploader::LoadStats(UploadUtil *uploader) {
   DCHECK(uploader);
+  UsageStats::Flush();
   string stats_str;
   Stats stats;
   for (size_t i = 0; i < arraysize(kStatsList); ++i) {
@@ -167,6 +167,7 @@ class UsageStatsUploaderTest : public ::testing::Test {
     TestableUsageStatsUploader::SetClientIdHandler(&client_id_);
     HTTPClient::SetHTTPClientHandler(&client_);
     EXPECT_TRUE(storage::Registry::Clear());
+    UsageStats::ClearAllStatsForTest();
 
     // save test stats
     UsageStats::IncrementCountBy(kCountStatsKey, kCountStatsDefaultValue);
@@ -36,7 +36,9 @@
 #include <atlbase.h>
 #include <atlcom.h>
 
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "base/logging.h"
 #include "base/util.h"
@@ -96,6 +98,34 @@ HRESULT QueryInterfaceImpl(
   return S_OK;
 }
 
+// Applies the outputs queued in the private context followed by |output| (if
+// any) in a single edit session, then updates the UI only once. Every edit
+// session that updates the context goes through this function so that the
+// queued outputs are never applied out of order.
+HRESULT UpdateContextWithPendingOutputs(TipTextService *text_service,
+                                        ITfContext *context,
+                                        TfEditCookie write_cookie,
+                                        const Output *output) {
+  std::vector<Output> outputs;
+  TipPrivateContext *private_context = text_service->GetPrivateContext(context);
+  if (private_context != nullptr) {
+    outputs.swap(*private_context->mutable_pending_outputs());
+    private_context->set_edit_session_requested(false);
+    if (private_context->layout_change_pending()) {
+      private_context->set_layout_change_pending(false);
+      // Ignore the returned code as TipUiHandler::UpdateUI will be called
+      // anyway.
+      text_service->GetThreadContext()->GetInputModeManager()->
+          OnMoveFocusedWindow();
+    }
+  }
+  if (output != nullptr) {
+    outputs.push_back(*output);
+  }
+  return TipEditSessionImpl::UpdateContext(
+      text_service, context, write_cookie, outputs);
+}
+
 // This class is an implementation class for the ITfEditSession classes, which
 // is an observer for exclusively updating the text store of a TSF thread
 // manager.
@@ -134,6 +164,16 @@ class AsyncLayoutChangeEditSessionImpl : public ITfEditSession {
     text_service_->GetThreadContext()->GetInputModeManager()->
         OnMoveFocusedWindow();
 
+    TipPrivateContext *private_context =
+        text_service_->GetPrivateContext(context_);
+    if (private_context != nullptr &&
+        !private_context->mutable_pending_outputs()->empty()) {
+      // Outputs are still waiting for their edit session. This session has
+      // read-only access, so just leave them to the pending session, which
+      // updates the UI as well.
+      private_context->set_layout_change_pending(false);
+      return S_OK;
+    }
     TipEditSessionImpl::UpdateUI(text_service_, context_, read_cookie);
     return S_OK;
   }
@@ -152,8 +192,13 @@ bool OnLayoutChangedAsyncImpl(TipTextService *text_service,
     return false;
   }
 
-  if (context == nullptr) {
-    return false;
+  TipPrivateContext *private_context = text_service->GetPrivateContext(context);
+  if (private_context != nullptr &&
+      private_context->edit_session_requested()) {
+    // An edit session for the pending outputs will update the UI anyway.
+    // Fold this layout change into it rather than requesting another one.
+    private_context->set_layout_change_pending(true);
+    return true;
   }
 
   CComPtr<ITfEditSession> edit_session(new AsyncLayoutChangeEditSessionImpl(
@@ -327,8 +372,8 @@ class AsyncSwitchInputModeEditSessionImpl : public ITfEditSession {
         return E_FAIL;
       }
     }
-    return TipEditSessionImpl::UpdateContext(
-        text_service_, context_, write_cookie, output);
+    return UpdateContextWithPendingOutputs(
+        text_service_, context_, write_cookie, &output);
   }
 
  private:
@@ -407,8 +452,8 @@ class AsyncSessionCommandEditSessionImpl : public ITfEditSession {
     if (!private_context->GetClient()->SendCommand(session_command_, &output)) {
       return E_FAIL;
     }
-    return TipEditSessionImpl::UpdateContext(
-        text_service_, context_, write_cookie, output);
+    return UpdateContextWithPendingOutputs(
+        text_service_, context_, write_cookie, &output);
   }
 
  private:
@@ -587,17 +632,24 @@ bool IsCandidateFocused(const Output &output, uint32 candidate_id) {
 
 // This class is an implementation class for the ITfEditSession classes, which
 // is an observer for exclusively updating the text store of a TSF thread
-// manager.
-class SyncEditSessionImpl : public ITfEditSession {
+// manager. Unlike other edit sessions, this class does not own the output to
+// be applied. Instead, it applies all the outputs queued in the private
+// context, so that outputs which arrive while an asynchronous edit session is
+// waiting to be granted are merged into that single edit session.
+class PendingOutputEditSessionImpl : public ITfEditSession {
  public:
-  SyncEditSessionImpl(CComPtr<TipTextService> text_service,
-                      CComPtr<ITfContext> context,
-                      const Output &output)
+  // |unmanaged_output| is applied only when |context| has no private
+  // context. Can be nullptr.
+  PendingOutputEditSessionImpl(CComPtr<TipTextService> text_service,
+                               CComPtr<ITfContext> context,
+                               const Output *unmanaged_output)
       : text_service_(text_service),
         context_(context) {
-    output_.CopyFrom(output);
+    if (unmanaged_output != nullptr) {
+      unmanaged_output_.reset(new Output(*unmanaged_output));
+    }
   }
-  ~SyncEditSessionImpl() {}
+  ~PendingOutputEditSessionImpl() {}
 
   // The IUnknown interface methods.
   STDMETHODIMP QueryInterface(REFIID interface_id, void **object) {
@@ -620,17 +672,32 @@ class SyncEditSessionImpl : public ITfEditSession {
   // This function is called back by the TSF thread manager when an edit
   // request is granted.
   virtual STDMETHODIMP DoEditSession(TfEditCookie write_cookie) {
-    return TipEditSessionImpl::UpdateContext(
-        text_service_, context_, write_cookie, output_);
+    TipPrivateContext *private_context =
+        text_service_->GetPrivateContext(context_);
+    if (private_context == nullptr) {
+      if (!unmanaged_output_) {
+        return E_FAIL;
+      }
+      return UpdateContextWithPendingOutputs(
+          text_service_, context_, write_cookie, unmanaged_output_.get());
+    }
+    if (private_context->mutable_pending_outputs()->empty() &&
+        !private_context->layout_change_pending()) {
+      // Another edit session has already applied the pending outputs.
+      private_context->set_edit_session_requested(false);
+      return S_OK;
+    }
+    return UpdateContextWithPendingOutputs(
+        text_service_, context_, write_cookie, nullptr);
   }
 
  private:
   TipRefCount ref_count_;
   CComPtr<TipTextService> text_service_;
   CComPtr<ITfContext> context_;
-  Output output_;
+  std::unique_ptr<Output> unmanaged_output_;
 
-  DISALLOW_COPY_AND_ASSIGN(SyncEditSessionImpl);
+  DISALLOW_COPY_AND_ASSIGN(PendingOutputEditSessionImpl);
 };
 
 enum EditSessionMode {
@@ -657,11 +724,26 @@ bool OnOutputReceivedImpl(TipTextService *text_service,
     }
   }
 
+  // Queue |new_output| first so that outputs are applied in the order they
+  // arrive regardless of which edit session is granted first. An unmanaged
+  // context has no queue, so the edit session owns |new_output| instead.
+  TipPrivateContext *private_context = text_service->GetPrivateContext(context);
+  if (private_context != nullptr) {
+    private_context->mutable_pending_outputs()->push_back(new_output);
+    if (mode == kAsync && private_context->edit_session_requested()) {
+      // An asynchronous edit session is already waiting to be granted. It
+      // will apply |new_output| together with the preceding ones and update
+      // the UI only once.
+      return true;
+    }
+  }
+
   // When RequestEditSession fails, it does not maintain the reference count.
   // So we need to ensure that AddRef/Release should be called at least once
   // per object.
-  CComPtr<ITfEditSession> edit_session(new SyncEditSessionImpl(
-      text_service, context, new_output));
+  CComPtr<ITfEditSession> edit_session(new PendingOutputEditSessionImpl(
+      text_service, context,
+      private_context == nullptr ? &new_output : nullptr));
 
   DWORD edit_session_flag = TF_ES_READWRITE;
   switch (mode) {
@@ -685,6 +767,15 @@ bool OnOutputReceivedImpl(TipTextService *text_service,
       edit_session,
       edit_session_flag,
       &edit_session_result);
+  if (private_context != nullptr) {
+    if (SUCCEEDED(hr) && edit_session_result == TF_S_ASYNC) {
+      private_context->set_edit_session_requested(true);
+    } else if (!private_context->edit_session_requested()) {
+      // No edit session is going to apply the queued output. Drop it rather
+      // than applying it at an unexpected timing later.
+      private_context->mutable_pending_outputs()->clear();
+    }
+  }
   if (FAILED(hr)) {
     return false;
   }
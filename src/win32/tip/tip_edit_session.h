@@ -58,6 +58,9 @@ class TipEditSession {
                                    const commands::Output &new_output);
 
   // Begins an async edit session with |new_output| to update the context.
+  // When an async edit session is already waiting to be granted for
+  // |context|, |new_output| is merged into it so that successive outputs are
+  // applied and the UI is updated in one edit session.
   static bool OnOutputReceivedAsync(TipTextService *text_service,
                                     ITfContext *context,
                                     const commands::Output &new_output);
@@ -37,6 +37,7 @@
 #include <msctf.h>
 
 #include <string>
+#include <vector>
 
 #include "base/logging.h"
 #include "base/util.h"
@@ -679,6 +680,23 @@ HRESULT TipEditSessionImpl::UpdateContext(
   return result;
 }
 
+HRESULT TipEditSessionImpl::UpdateContext(
+    TipTextService *text_service,
+    ITfContext *context,
+    TfEditCookie write_cookie,
+    const std::vector<commands::Output> &outputs) {
+  HRESULT result = S_OK;
+  for (size_t i = 0; i < outputs.size(); ++i) {
+    result = DoEditSessionInComposition(
+        text_service, context, write_cookie, outputs[i]);
+    if (FAILED(result)) {
+      break;
+    }
+  }
+  UpdateUI(text_service, context, write_cookie);
+  return result;
+}
+
 void TipEditSessionImpl::UpdateUI(TipTextService *text_service,
                                   ITfContext *context,
                                   TfEditCookie read_cookie) {
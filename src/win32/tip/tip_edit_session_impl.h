@@ -32,6 +32,8 @@
 
 #include <msctf.h>
 
+#include <vector>
+
 #include "base/port.h"
 
 namespace mozc {
@@ -76,6 +78,13 @@ class TipEditSessionImpl {
                                TfEditCookie write_cookie,
                                const commands::Output &output);
 
+  // Same as above but applies all the |outputs| in order and invokes UI
+  // update only once at the end.
+  static HRESULT UpdateContext(TipTextService *text_service,
+                               ITfContext *context,
+                               TfEditCookie write_cookie,
+                               const std::vector<commands::Output> &outputs);
+
   // A core logic of UI handler. This function does
   // - Invokes UI update.
   static void UpdateUI(TipTextService *text_service,
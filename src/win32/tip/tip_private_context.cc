@@ -32,6 +32,7 @@
 #include <msctf.h>
 
 #include <memory>
+#include <vector>
 
 #include "base/win_util.h"
 #include "client/client_interface.h"
@@ -61,7 +62,9 @@ class TipPrivateContext::InternalState {
                 DWORD text_layout_sink_cookie)
     : client_(ClientFactory::NewClient()),
       text_edit_sink_cookie_(text_edit_sink_cookie),
-      text_layout_sink_cookie_(text_layout_sink_cookie) {
+      text_layout_sink_cookie_(text_layout_sink_cookie),
+      edit_session_requested_(false),
+      layout_change_pending_(false) {
   }
   unique_ptr<client::ClientInterface> client_;
   SurrogatePairObserver surrogate_pair_observer_;
@@ -73,6 +76,10 @@ class TipPrivateContext::InternalState {
 
   const DWORD text_edit_sink_cookie_;
   const DWORD text_layout_sink_cookie_;
+
+  std::vector<commands::Output> pending_outputs_;
+  bool edit_session_requested_;
+  bool layout_change_pending_;
 };
 
 TipPrivateContext::TipPrivateContext(DWORD text_edit_sink_cookie,
@@ -154,6 +161,26 @@ DWORD TipPrivateContext::text_layout_sink_cookie() const {
   return state_->text_layout_sink_cookie_;
 }
 
+std::vector<Output> *TipPrivateContext::mutable_pending_outputs() {
+  return &state_->pending_outputs_;
+}
+
+bool TipPrivateContext::edit_session_requested() const {
+  return state_->edit_session_requested_;
+}
+
+void TipPrivateContext::set_edit_session_requested(bool requested) {
+  state_->edit_session_requested_ = requested;
+}
+
+bool TipPrivateContext::layout_change_pending() const {
+  return state_->layout_change_pending_;
+}
+
+void TipPrivateContext::set_layout_change_pending(bool pending) {
+  state_->layout_change_pending_ = pending;
+}
+
 }  // namespace tsf
 }  // namespace win32
 }  // namespace mozc
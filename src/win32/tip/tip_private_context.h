@@ -33,6 +33,7 @@
 #include <Windows.h>
 
 #include <memory>
+#include <vector>
 
 #include "base/port.h"
 
@@ -78,6 +79,17 @@ class TipPrivateContext {
   DWORD text_edit_sink_cookie() const;
   DWORD text_layout_sink_cookie() const;
 
+  // Outputs which are waiting for an asynchronous edit session. They are
+  // applied in order by the next edit session granted for this context.
+  std::vector<commands::Output> *mutable_pending_outputs();
+  // True while an asynchronous edit session for the pending outputs has been
+  // requested but not granted yet.
+  bool edit_session_requested() const;
+  void set_edit_session_requested(bool requested);
+  // True when a layout change arrived while an edit session was requested.
+  bool layout_change_pending() const;
+  void set_layout_change_pending(bool pending);
+
  private:
   class InternalState;
   std::unique_ptr<InternalState> state_;